@@ -253,6 +253,12 @@ public:
   // NonUniform attribute.
   static const char kDxilNonUniformAttributeMDName[];
 
+  // Uniformity attribute, for drivers. Values that vary between lanes are
+  // not marked.
+  static const char kDxilUniformityAttributeMDName[];
+  static const unsigned kDxilUniformityUniform = 0;
+  static const unsigned kDxilUniformityWaveUniform = 1;
+
   // Variable debug layout metadata.
   static const char kDxilVariableDebugLayoutMDName[];
 
@@ -554,6 +560,7 @@ public:
   static void MarkPrecise(llvm::Instruction *inst);
   static bool IsMarkedNonUniform(const llvm::Instruction *inst);
   static void MarkNonUniform(llvm::Instruction *inst);
+  static void MarkUniformity(llvm::Instruction *inst, unsigned uniformity);
   static bool GetVariableDebugLayout(llvm::DbgDeclareInst *inst,
     unsigned &StartOffsetInBits, std::vector<DxilDIArrayDim> &ArrayDims);
   static void SetVariableDebugLayout(llvm::DbgDeclareInst *inst,
@@ -32,6 +32,7 @@ class LLVMContext;
 class Module;
 class Function;
 class Instruction;
+class MDNode;
 class MDTuple;
 class MDOperand;
 class DebugInfoFinder;
@@ -41,6 +42,7 @@ namespace hlsl {
 
 class ShaderModel;
 class OP;
+class DxilOpCallIndex;
 struct DxilFunctionProps;
 
 class DxilEntryProps;
@@ -58,6 +60,8 @@ public:
   llvm::LLVMContext &GetCtx() const;
   llvm::Module *GetModule() const;
   OP *GetOP() const;
+  // Call sites of DXIL operations, by opcode.
+  DxilOpCallIndex &GetOpCallIndex();
   void SetShaderModel(const ShaderModel *pSM, bool bUseMinPrecision = true);
   const ShaderModel *GetShaderModel() const;
   void GetDxilVersion(unsigned &DxilMajor, unsigned &DxilMinor) const;
@@ -188,6 +192,16 @@ public:
   void ReEmitDxilResources();
   /// Deserialize DXIL metadata form into in-memory form.
   void LoadDxilMetadata();
+  /// DXIL named metadata saved by SaveDxilMetadata().
+  typedef std::vector<std::pair<std::string, std::vector<llvm::MDNode *>>>
+      DxilMetadataSnapshot;
+  /// Save the DXIL named metadata, so that after emitting metadata for another
+  /// purpose, such as reflection, RestoreDxilMetadata() can put it back
+  /// without emitting it again from the in-memory form.
+  void SaveDxilMetadata(DxilMetadataSnapshot &Snapshot) const;
+  /// Replace the DXIL named metadata with a snapshot. The validator version
+  /// and LLVM used are still emitted from the in-memory form.
+  void RestoreDxilMetadata(const DxilMetadataSnapshot &Snapshot);
   /// Return true if non-fatal metadata error was detected.
   bool HasMetadataErrors();
 
@@ -241,6 +255,12 @@ public:
   ShaderFlags m_ShaderFlags;
   void CollectShaderFlagsForModule(ShaderFlags &Flags);
 
+  // Flags used by a single function. These are cached: the cache is refreshed
+  // by CollectShaderFlagsForModule, and entries of removed functions dropped.
+  ShaderFlags GetShaderFlagsForFunction(const llvm::Function *F) const;
+  // Drop the cached flags of F after changing it, or of all functions if null.
+  void InvalidateShaderFlags(const llvm::Function *F = nullptr);
+
   // Check if DxilModule contains multi component UAV Loads.
   // This funciton must be called after unused resources are removed from DxilModule
   bool ModuleHasMulticomponentUAVLoads();
@@ -356,6 +376,7 @@ private:
   bool m_ForceZeroStoreLifetimes;
 
   std::unique_ptr<OP> m_pOP;
+  std::unique_ptr<DxilOpCallIndex> m_pOpCallIndex;
   size_t m_pUnused;
 
   // LLVM used.
@@ -367,6 +388,9 @@ private:
   // EntryProps for shader functions.
   DxilEntryPropsMap  m_DxilEntryPropsMap;
 
+  // Cached result of ShaderFlags::CollectShaderFlags for each function.
+  mutable std::unordered_map<const llvm::Function *, ShaderFlags> m_FunctionShaderFlags;
+
   // Keeps track of patch constant functions used by hull shaders
   std::unordered_set<const llvm::Function *>  m_PatchConstantFunctions;
 
@@ -0,0 +1,63 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// DxilOpCallIndex.h                                                         //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Index of DXIL operation call sites by opcode.                             //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "dxc/DXIL/DxilConstants.h"
+#include "llvm/ADT/SmallVector.h"
+
+#include <memory>
+#include <unordered_map>
+
+namespace llvm {
+class CallInst;
+class Function;
+}
+
+namespace hlsl {
+
+class OP;
+
+/// Finds the calls to a DXIL operation without scanning the module.
+///
+/// DXIL operation functions are shared by every opcode of an opcode class,
+/// so finding the calls to one opcode otherwise means decoding the opcode of
+/// every call to the class. The calls to each function are indexed the first
+/// time its class is queried. Deleted calls drop out of the index through
+/// value handles, and a function whose use count no longer matches its
+/// indexed calls, because calls were added or retargeted, is indexed again.
+/// Passes that change the opcode argument of an existing call must call
+/// Invalidate.
+class DxilOpCallIndex {
+public:
+  explicit DxilOpCallIndex(OP *pOP);
+  ~DxilOpCallIndex();
+
+  // Appends the calls to opcode to Calls, grouped by overload.
+  void GetCalls(DXIL::OpCode opcode,
+                llvm::SmallVectorImpl<llvm::CallInst *> &Calls);
+  bool HasCalls(DXIL::OpCode opcode);
+
+  void RemoveFunction(llvm::Function *F);
+  void Invalidate();
+
+private:
+  class CallHandle;
+  struct FunctionCalls;
+
+  FunctionCalls &GetFunctionCalls(llvm::Function *F);
+
+  OP *m_pOP;
+  std::unordered_map<const llvm::Function *, std::unique_ptr<FunctionCalls>>
+      m_FunctionCalls;
+};
+
+} // namespace hlsl
@@ -17,6 +17,7 @@ class Module;
 class Type;
 class StructType;
 class Function;
+class FunctionType;
 class Constant;
 class Value;
 class Instruction;
@@ -144,12 +145,22 @@ private:
   llvm::Type *m_pResRetType[kNumTypeOverloads];
   llvm::Type *m_pCBufferRetType[kNumTypeOverloads];
 
+  // Overloads on the types below kUserDefineTypeSlot are unique per context,
+  // so they are also kept by type slot and found without hashing.
+  static const unsigned kNumScalarTypeOverloads = kUserDefineTypeSlot;
+
   struct OpCodeCacheItem {
     llvm::SmallMapVector<llvm::Type *, llvm::Function *, 8> pOverloads;
+    llvm::Function *pScalarOverloads[kNumScalarTypeOverloads];
+    llvm::FunctionType *pScalarFuncTypes[kNumScalarTypeOverloads];
   };
   OpCodeCacheItem m_OpCodeClassCache[(unsigned)OpCodeClass::NumOpClasses];
-  std::unordered_map<const llvm::Function *, OpCodeClass> m_FunctionToOpClass;
+  // Functions are tagged with their OpCodeClass + 1 for the reverse lookup.
   void UpdateCache(OpCodeClass opClass, llvm::Type * Ty, llvm::Function *F);
+  // Function attributes of the declarations, by OpCodeProperty::FuncAttr.
+  llvm::AttributeSet m_FuncAttributes[llvm::Attribute::EndAttrKinds];
+  llvm::FunctionType *GetOpFuncType(OpCode opCode, llvm::Type *pOverloadType);
+  llvm::AttributeSet GetOpFuncAttributes(OpCode opCode);
 private:
   // Static properties.
   struct OpCodeProperty {
@@ -171,6 +182,8 @@ private:
   static llvm::StringRef GetTypeName(llvm::Type *Ty, std::string &str);
   static llvm::StringRef ConstructOverloadName(llvm::Type *Ty, DXIL::OpCode opCode,
                                                std::string &funcNameStorage);
+  static llvm::StringRef ConstructOverloadName(llvm::Type *Ty, DXIL::OpCode opCode,
+                                               llvm::SmallVectorImpl<char> &funcNameStorage);
 };
 
 } // namespace hlsl
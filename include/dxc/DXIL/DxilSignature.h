@@ -40,6 +40,10 @@ public:
   const DxilSignatureElement &GetElement(unsigned idx) const;
   const std::vector<std::unique_ptr<DxilSignatureElement> > &GetElements() const;
 
+  // Removes the elements whose flag is set and renumbers the rest. Returns
+  // the new ID of each old element, or UINT_MAX for the removed ones.
+  std::vector<unsigned> DeleteElements(const std::vector<bool> &Deleted);
+
   // Returns true if all signature elements that should be allocated are allocated
   bool IsFullyAllocated() const;
 
@@ -12,6 +12,7 @@
 #pragma once
 #include "llvm/ADT/StringRef.h"
 #include "llvm/ADT/MapVector.h"
+#include "llvm/ADT/StringMap.h"
 #include "dxc/DXIL/DxilConstants.h"
 #include "dxc/DXIL/DxilCompType.h"
 #include "dxc/DXIL/DxilInterpolationMode.h"
@@ -44,6 +45,8 @@ struct DxilMatrixAnnotation {
 
 /// Use this class to represent type annotation for structure field.
 class DxilFieldAnnotation {
+  friend class DxilTypeSystem;
+
 public:
   DxilFieldAnnotation();
   
@@ -88,9 +91,11 @@ private:
   DxilMatrixAnnotation m_Matrix;
   llvm::MDNode *m_ResourceAttribute;
   unsigned m_CBufferOffset;
-  std::string m_Semantic;
+  // Strings are immutable and shared by copies of the annotation, e.g. in a
+  // linked or cloned module. Null when empty.
+  std::shared_ptr<const std::string> m_Semantic;
   InterpolationMode m_InterpMode;
-  std::string m_FieldName;
+  std::shared_ptr<const std::string> m_FieldName;
   bool m_bCBufferVarUsed; // true if this field represents a top level variable in CB structure, and it is used.
 };
 
@@ -302,6 +307,12 @@ private:
   PayloadAnnotationMap m_PayloadAnnotations;
   FunctionAnnotationMap m_FunctionAnnotations;
 
+  // Field names and semantics of finished annotations, so that the fields of
+  // many structures share one copy of each string.
+  llvm::StringMap<std::shared_ptr<const std::string>> m_StringPool;
+  void InternStrings(DxilFieldAnnotation &FA);
+  void InternString(std::shared_ptr<const std::string> &Str);
+
   DXIL::LowPrecisionMode m_LowPrecisionMode;
 
   llvm::StructType *GetNormFloatType(CompType CT, unsigned NumComps);
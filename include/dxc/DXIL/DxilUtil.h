@@ -126,6 +126,11 @@ namespace dxilutil {
     llvm::LLVMContext &Ctx, std::string &DiagStr);
   std::unique_ptr<llvm::Module> LoadModuleFromBitcodeLazy(std::unique_ptr<llvm::MemoryBuffer> &&MB,
     llvm::LLVMContext &Ctx, std::string &DiagStr);
+  // Loads function bodies on demand and drops all debug info while reading,
+  // for callers that only inspect the program.
+  std::unique_ptr<llvm::Module> LoadModuleFromBitcodeWithoutDebugInfo(
+    std::unique_ptr<llvm::MemoryBuffer> &&MB, llvm::LLVMContext &Ctx,
+    std::string &DiagStr);
   void PrintDiagnosticHandler(const llvm::DiagnosticInfo &DI, void *Context);
   bool IsIntegerOrFloatingPointType(llvm::Type *Ty);
   // Returns true if type contains HLSL Object type (resource)
@@ -156,6 +161,12 @@ namespace dxilutil {
   bool IsConvergentMarker(llvm::Value *V);
   llvm::Value *GetConvergentSource(llvm::Value *V);
 
+  // Identifies the buffer a handle refers to, for passes that group accesses
+  // by buffer: separate handles for the same buffer give the global they were
+  // created from when possible, or else the handle. Handle annotations are
+  // looked through.
+  llvm::Value *GetBufferKeyForHandle(llvm::Value *Handle);
+
   /// If value is a bitcast to base class pattern, equivalent
   /// to a getelementptr X, 0, 0, 0...  turn it into the appropriate gep.
   /// This can enhance SROA and other transforms that want type-safe pointers,
@@ -23,17 +23,19 @@ namespace hlsl {
   class AbstractMemoryStream;
 }
 
-class DxcContainerBuilder : public IDxcContainerBuilder {
+class DxcContainerBuilder : public IDxcContainerBuilder2 {
 public:
   HRESULT STDMETHODCALLTYPE Load(_In_ IDxcBlob *pDxilContainerHeader) override; // Loads DxilContainer to the builder
   HRESULT STDMETHODCALLTYPE AddPart(_In_ UINT32 fourCC, _In_ IDxcBlob *pSource) override; // Add the given part with fourCC
   HRESULT STDMETHODCALLTYPE RemovePart(_In_ UINT32 fourCC) override;                // Remove the part with fourCC
   HRESULT STDMETHODCALLTYPE SerializeContainer(_Out_ IDxcOperationResult **ppResult) override; // Builds a container of the given container builder state
+  HRESULT STDMETHODCALLTYPE CreateDelta(_In_ IDxcBlob *pBase, _In_ IDxcBlob *pTarget, _COM_Outptr_ IDxcBlob **ppDelta) override; // Delta that rebuilds pTarget from pBase
+  HRESULT STDMETHODCALLTYPE ApplyDelta(_In_ IDxcBlob *pBase, _In_ IDxcBlob *pDelta, _COM_Outptr_ IDxcBlob **ppTarget) override; // Rebuild the target of a delta
 
   DXC_MICROCOM_TM_ADDREF_RELEASE_IMPL()
   DXC_MICROCOM_TM_CTOR(DxcContainerBuilder)
   HRESULT STDMETHODCALLTYPE QueryInterface(REFIID riid, void **ppvObject) override {
-    return DoBasicQueryInterface<IDxcContainerBuilder>(this, riid, ppvObject);
+    return DoBasicQueryInterface<IDxcContainerBuilder, IDxcContainerBuilder2>(this, riid, ppvObject);
   }
 
   void Init(const char *warning = nullptr) {
@@ -44,6 +44,8 @@ enum class DxilShaderHashFlags : uint32_t {
   None = 0,           // No flags defined.
   IncludesSource = 1, // This flag indicates that the shader hash was computed
                       // taking into account source information (-Zss)
+  XXHash64 = 2,       // Digest is the XXH64 hash of the bitcode with seeds 0
+                      // and 1, little endian, instead of MD5 (-Qfast_hash)
 };
 
 typedef struct DxilShaderHash {
@@ -433,6 +435,23 @@ DxilContainerHeader *IsDxilContainerLike(void *ptr, size_t length);
 /// Checks whether the DXIL container is valid and in-bounds.
 bool IsValidDxilContainer(const DxilContainerHeader *pHeader, size_t length);
 
+/// Hashes of the parts of a shader container that decide whether shaders can
+/// be combined in a pipeline state. A hash is 0 when its part is absent.
+/// Identical hashes mean byte-identical parts, so pipeline caches can compare
+/// these instead of parsing the signature, root signature and PSV parts.
+struct DxilContainerFingerprint {
+  uint64_t InputSignature;            // ISG1
+  uint64_t OutputSignature;           // OSG1, including stream assignments
+  uint64_t PatchConstOrPrimSignature; // PSG1
+  uint64_t RootSignature;             // RTS0
+  uint64_t ResourceBindings;          // PSV0 resource types and ranges
+};
+
+/// Computes the fingerprint of a valid DXIL container. Returns false if the
+/// PSV0 part is present but malformed.
+bool GetDxilContainerFingerprint(const DxilContainerHeader *pHeader,
+                                 DxilContainerFingerprint *pFingerprint);
+
 /// Use this type as a unary predicate functor.
 struct DxilPartIsType {
   uint32_t IsFourCC;
@@ -581,6 +600,7 @@ enum class SerializeDxilFlags : uint32_t {
   StripReflectionFromDxilPart = 1 << 3, // Strip Reflection info from DXIL part.
   IncludeReflectionPart       = 1 << 4, // Include reflection in STAT part.
   StripRootSignature          = 1 << 5, // Strip Root Signature from main shader container.
+  FastShaderHash              = 1 << 6, // Compute the shader hash with XXH64 instead of MD5.
 };
 inline SerializeDxilFlags& operator |=(SerializeDxilFlags& l, const SerializeDxilFlags& r) {
   l = static_cast<SerializeDxilFlags>(static_cast<int>(l) | static_cast<int>(r));
@@ -243,6 +243,16 @@ struct PSVComponentMask {
       Mask[ComponentIndex >> 5] &= ~(1 << (ComponentIndex & 0x1F));
   }
   bool IsValid() { return Mask != nullptr; }
+  // Writes the 4-bit component mask of each vector to pVectorMasks[0..NumVectors).
+  // Works a dword (8 vectors) at a time rather than testing each component.
+  void GetVectorMasks(uint8_t *pVectorMasks) const {
+    for (uint32_t v = 0; v < NumVectors; v += 8) {
+      uint32_t bits = Mask[v >> 3];
+      uint32_t count = NumVectors - v < 8 ? NumVectors - v : 8;
+      for (uint32_t i = 0; i < count; ++i)
+        pVectorMasks[v + i] = (uint8_t)((bits >> (i * 4)) & 0xF);
+    }
+  }
 };
 
 struct PSVDependencyTable {
@@ -363,6 +373,37 @@ public:
   uint32_t GetDynamicIndexMask() const { return !m_pElement0 ? 0 : (uint32_t)m_pElement0->DynamicMaskAndStream & 0xF; }
 };
 
+// Caller-provided arrays that DxilPipelineStateValidation::Decode*Elements
+// fill with one signature, one field per array. Null arrays are skipped; the
+// others must hold as many entries as the signature has elements.
+struct PSVSignatureElementArrays
+{
+  const char **SemanticNames = nullptr;
+  const uint32_t **SemanticIndexes = nullptr;   // Rows entries each
+  uint8_t *Rows = nullptr;
+  uint8_t *Cols = nullptr;
+  int32_t *StartRows = nullptr;                 // -1 if not allocated
+  int32_t *StartCols = nullptr;                 // -1 if not allocated
+  uint8_t *ColMasks = nullptr;                  // columns used, 0 if not allocated
+  PSVSemanticKind *SemanticKinds = nullptr;
+  uint8_t *ComponentTypes = nullptr;
+  uint8_t *InterpolationModes = nullptr;
+  uint8_t *OutputStreams = nullptr;
+  uint8_t *DynamicIndexMasks = nullptr;
+};
+
+// Caller-provided arrays for DxilPipelineStateValidation::DecodeResourceBindings.
+// ResKinds and ResFlags are zero for PSV data older than PSVResourceBindInfo1.
+struct PSVResourceBindArrays
+{
+  uint32_t *ResTypes = nullptr;
+  uint32_t *Spaces = nullptr;
+  uint32_t *LowerBounds = nullptr;
+  uint32_t *UpperBounds = nullptr;
+  uint32_t *ResKinds = nullptr;
+  uint32_t *ResFlags = nullptr;
+};
+
 #define MAX_PSV_VERSION 2
 
 struct PSVInitInfo
@@ -484,6 +525,8 @@ public:
 private:
   bool ReadOrWrite(const void *pBits, uint32_t *pSize, RWMode mode,
                    const PSVInitInfo &initInfo = PSVInitInfo(MAX_PSV_VERSION));
+  uint32_t DecodeElements(const void *pElements, uint32_t numElements,
+                          const PSVSignatureElementArrays &arrays) const;
 
 public:
   bool InitFromPSV0(const void* pBits, uint32_t size) {
@@ -582,6 +625,38 @@ public:
     return PSVSignatureElement(m_StringTable, m_SemanticIndexTable, pElement0);
   }
 
+  // Bulk signature access: decode every element of a signature in one pass.
+  // Return the number of elements written.
+  uint32_t DecodeInputElements(const PSVSignatureElementArrays &arrays) const {
+    return DecodeElements(m_pSigInputElements, GetSigInputElements(), arrays);
+  }
+  uint32_t DecodeOutputElements(const PSVSignatureElementArrays &arrays) const {
+    return DecodeElements(m_pSigOutputElements, GetSigOutputElements(), arrays);
+  }
+  uint32_t DecodePatchConstOrPrimElements(const PSVSignatureElementArrays &arrays) const {
+    return DecodeElements(m_pSigPatchConstOrPrimElements, GetSigPatchConstOrPrimElements(), arrays);
+  }
+
+  // Bulk resource access: decode every resource binding in one pass.
+  // Returns the number of bindings written.
+  uint32_t DecodeResourceBindings(const PSVResourceBindArrays &arrays) const {
+    if (!m_pPSVResourceBindInfo || m_uPSVResourceBindInfoSize < sizeof(PSVResourceBindInfo0))
+      return 0;
+    bool bHasInfo1 = m_uPSVResourceBindInfoSize >= sizeof(PSVResourceBindInfo1);
+    const uint8_t *pRecord = reinterpret_cast<const uint8_t *>(m_pPSVResourceBindInfo);
+    for (uint32_t i = 0; i < m_uResourceCount; ++i, pRecord += m_uPSVResourceBindInfoSize) {
+      const PSVResourceBindInfo0 *pBind0 = reinterpret_cast<const PSVResourceBindInfo0 *>(pRecord);
+      if (arrays.ResTypes) arrays.ResTypes[i] = pBind0->ResType;
+      if (arrays.Spaces) arrays.Spaces[i] = pBind0->Space;
+      if (arrays.LowerBounds) arrays.LowerBounds[i] = pBind0->LowerBound;
+      if (arrays.UpperBounds) arrays.UpperBounds[i] = pBind0->UpperBound;
+      const PSVResourceBindInfo1 *pBind1 = bHasInfo1 ? reinterpret_cast<const PSVResourceBindInfo1 *>(pRecord) : nullptr;
+      if (arrays.ResKinds) arrays.ResKinds[i] = pBind1 ? pBind1->ResKind : 0;
+      if (arrays.ResFlags) arrays.ResFlags[i] = pBind1 ? pBind1->ResFlags : 0;
+    }
+    return m_uResourceCount;
+  }
+
   PSVShaderKind GetShaderKind() const {
     if (m_pPSVRuntimeInfo1 && m_pPSVRuntimeInfo1->ShaderStage < (uint8_t)PSVShaderKind::Invalid)
       return (PSVShaderKind)m_pPSVRuntimeInfo1->ShaderStage;
@@ -628,6 +703,24 @@ public:
     return PSVDependencyTable();
   }
 
+  // Component masks per output vector, see PSVComponentMask::GetVectorMasks.
+  // pVectorMasks must hold the output vector count of the stream (or of the
+  // patch constant/primitive signature). Return false if there is no mask.
+  bool GetViewIDOutputVectorMasks(uint8_t *pVectorMasks, unsigned streamIndex = 0) const {
+    PSVComponentMask mask = GetViewIDOutputMask(streamIndex);
+    if (!mask.Mask)
+      return false;
+    mask.GetVectorMasks(pVectorMasks);
+    return true;
+  }
+  bool GetViewIDPCOutputVectorMasks(uint8_t *pVectorMasks) const {
+    PSVComponentMask mask = GetViewIDPCOutputMask();
+    if (!mask.Mask)
+      return false;
+    mask.GetVectorMasks(pVectorMasks);
+    return true;
+  }
+
   bool GetNumThreads(uint32_t *pNumThreadsX, uint32_t *pNumThreadsY, uint32_t *pNumThreadsZ) {
     if (m_pPSVRuntimeInfo2) {
       if (pNumThreadsX) *pNumThreadsX = m_pPSVRuntimeInfo2->NumThreadsX;
@@ -883,6 +976,33 @@ inline bool DxilPipelineStateValidation::ReadOrWrite(
   return true;
 }
 
+inline uint32_t DxilPipelineStateValidation::DecodeElements(
+    const void *pElements, uint32_t numElements,
+    const PSVSignatureElementArrays &arrays) const {
+  if (!pElements || m_uPSVSignatureElementSize < sizeof(PSVSignatureElement0))
+    return 0;
+  const uint8_t *pRecord = reinterpret_cast<const uint8_t *>(pElements);
+  for (uint32_t i = 0; i < numElements; ++i, pRecord += m_uPSVSignatureElementSize) {
+    const PSVSignatureElement0 *pElement0 = reinterpret_cast<const PSVSignatureElement0 *>(pRecord);
+    bool bAllocated = !!(pElement0->ColsAndStart & 0x40);
+    uint32_t cols = pElement0->ColsAndStart & 0xF;
+    uint32_t startCol = (pElement0->ColsAndStart >> 4) & 0x3;
+    if (arrays.SemanticNames) arrays.SemanticNames[i] = m_StringTable.Get(pElement0->SemanticName);
+    if (arrays.SemanticIndexes) arrays.SemanticIndexes[i] = m_SemanticIndexTable.Get(pElement0->SemanticIndexes);
+    if (arrays.Rows) arrays.Rows[i] = pElement0->Rows;
+    if (arrays.Cols) arrays.Cols[i] = (uint8_t)cols;
+    if (arrays.StartRows) arrays.StartRows[i] = bAllocated ? (int32_t)pElement0->StartRow : -1;
+    if (arrays.StartCols) arrays.StartCols[i] = bAllocated ? (int32_t)startCol : -1;
+    if (arrays.ColMasks) arrays.ColMasks[i] = bAllocated ? (uint8_t)((((1u << cols) - 1) << startCol) & 0xF) : 0;
+    if (arrays.SemanticKinds) arrays.SemanticKinds[i] = (PSVSemanticKind)pElement0->SemanticKind;
+    if (arrays.ComponentTypes) arrays.ComponentTypes[i] = pElement0->ComponentType;
+    if (arrays.InterpolationModes) arrays.InterpolationModes[i] = pElement0->InterpolationMode;
+    if (arrays.OutputStreams) arrays.OutputStreams[i] = (pElement0->DynamicMaskAndStream >> 4) & 0x3;
+    if (arrays.DynamicIndexMasks) arrays.DynamicIndexMasks[i] = pElement0->DynamicMaskAndStream & 0xF;
+  }
+  return numElements;
+}
+
 namespace hlsl {
 
   class ViewIDValidator {
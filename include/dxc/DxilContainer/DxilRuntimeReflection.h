@@ -706,6 +706,17 @@ public:
   virtual bool InitFromRDAT(const void *pRDAT, size_t size) = 0;
   // DxilRuntimeReflection owns the memory pointed to by DxilLibraryDesc
   virtual const DxilLibraryDesc GetLibraryReflection() = 0;
+  // Find a function by its mangled or unmangled name.
+  // Returns nullptr if there is no such function.
+  virtual const DxilFunctionDesc *FindFunction(LPCWSTR name) = 0;
+  // Find a subobject by name. Returns nullptr if there is no such subobject.
+  virtual const DxilSubobjectDesc *FindSubobject(LPCWSTR name) = 0;
+  // Get the SubobjectToExportsAssociation subobjects that list exportName
+  // among their exports, in table order. Associations with an empty export
+  // list apply by default and are not included. Returns nullptr and sets
+  // *pNumAssociations to 0 if there are none.
+  virtual const DxilSubobjectDesc *const *
+  GetAssociationsForExport(LPCWSTR exportName, uint32_t *pNumAssociations) = 0;
 };
 
 DxilRuntimeReflection *CreateDxilRuntimeReflection();
@@ -13,6 +13,7 @@
 #include <unordered_map>
 #include <vector>
 #include <memory>
+#include <string>
 #include <cwchar>
 
 namespace hlsl {
@@ -312,6 +313,7 @@ private:
   typedef std::vector<DxilResourceDesc *> ResourceRefList;
   typedef std::vector<DxilFunctionDesc> FunctionList;
   typedef std::vector<DxilSubobjectDesc> SubobjectList;
+  typedef std::vector<const DxilSubobjectDesc *> SubobjectRefList;
 
   DxilRuntimeData m_RuntimeData;
   StringMap m_StringMap;
@@ -324,6 +326,9 @@ private:
   std::unordered_map<DxilFunctionDesc *, ResourceRefList> m_FuncToResMap;
   std::unordered_map<DxilFunctionDesc *, WStringList> m_FuncToDependenciesMap;
   std::unordered_map<DxilSubobjectDesc *, WStringList> m_SubobjectToExportsMap;
+  std::unordered_map<std::wstring, const DxilFunctionDesc *> m_FunctionsByName;
+  std::unordered_map<std::wstring, const DxilSubobjectDesc *> m_SubobjectsByName;
+  std::unordered_map<std::wstring, SubobjectRefList> m_AssociationsByExport;
   bool m_initialized;
 
   const wchar_t *GetWideString(const char *ptr);
@@ -351,6 +356,11 @@ public:
   // This call will allocate memory for GetLibraryReflection call
   bool InitFromRDAT(const void *pRDAT, size_t size) override;
   const DxilLibraryDesc GetLibraryReflection() override;
+  const DxilFunctionDesc *FindFunction(LPCWSTR name) override;
+  const DxilSubobjectDesc *FindSubobject(LPCWSTR name) override;
+  const DxilSubobjectDesc *const *
+  GetAssociationsForExport(LPCWSTR exportName,
+                           uint32_t *pNumAssociations) override;
 };
 
 void DxilRuntimeReflection_impl::AddString(const char *ptr) {
@@ -410,6 +420,33 @@ const DxilLibraryDesc DxilRuntimeReflection_impl::GetLibraryReflection() {
   return reflection;
 }
 
+const DxilFunctionDesc *DxilRuntimeReflection_impl::FindFunction(LPCWSTR name) {
+  if (!m_initialized || !name)
+    return nullptr;
+  auto it = m_FunctionsByName.find(name);
+  return it != m_FunctionsByName.end() ? it->second : nullptr;
+}
+
+const DxilSubobjectDesc *DxilRuntimeReflection_impl::FindSubobject(LPCWSTR name) {
+  if (!m_initialized || !name)
+    return nullptr;
+  auto it = m_SubobjectsByName.find(name);
+  return it != m_SubobjectsByName.end() ? it->second : nullptr;
+}
+
+const DxilSubobjectDesc *const *
+DxilRuntimeReflection_impl::GetAssociationsForExport(
+    LPCWSTR exportName, uint32_t *pNumAssociations) {
+  *pNumAssociations = 0;
+  if (!m_initialized || !exportName)
+    return nullptr;
+  auto it = m_AssociationsByExport.find(exportName);
+  if (it == m_AssociationsByExport.end())
+    return nullptr;
+  *pNumAssociations = (uint32_t)it->second.size();
+  return it->second.data();
+}
+
 void DxilRuntimeReflection_impl::InitializeReflection() {
   auto indexTable = m_RuntimeData.GetContext().IndexTable;
   m_IndexData.assign(indexTable.Data(), indexTable.Data() + indexTable.Count());
@@ -419,6 +456,32 @@ void DxilRuntimeReflection_impl::InitializeReflection() {
   AddResources();
   AddFunctions();
   AddSubobjects();
+
+  // Index by name once the lists are complete, since the descs are referenced
+  // by pointer. Mangled names win over unmangled ones, and the first of
+  // several overloads sharing an unmangled name is found.
+  m_FunctionsByName.reserve(m_Functions.size() * 2);
+  for (const DxilFunctionDesc &desc : m_Functions)
+    m_FunctionsByName.emplace(desc.Name, &desc);
+  for (const DxilFunctionDesc &desc : m_Functions)
+    m_FunctionsByName.emplace(desc.UnmangledName, &desc);
+  m_SubobjectsByName.reserve(m_Subobjects.size());
+  for (const DxilSubobjectDesc &desc : m_Subobjects)
+    m_SubobjectsByName.emplace(desc.Name, &desc);
+
+  // Invert the associations so resolving the subobjects of every export of a
+  // state object is linear in the total number of association exports.
+  for (const DxilSubobjectDesc &desc : m_Subobjects) {
+    if (desc.Kind != DXIL::SubobjectKind::SubobjectToExportsAssociation)
+      continue;
+    const auto &assoc = desc.SubobjectToExportsAssociation;
+    for (uint32_t i = 0; i < assoc.NumExports; ++i) {
+      SubobjectRefList &list = m_AssociationsByExport[assoc.Exports[i]];
+      // An association may list the same export more than once.
+      if (list.empty() || list.back() != &desc)
+        list.push_back(&desc);
+    }
+  }
 }
 
 void DxilRuntimeReflection_impl::AddResources() {
@@ -11,12 +11,13 @@
 ///////////////////////////////////////////////////////////////////////////////
 
 #include <cstdint>
+#include <vector>
 
 namespace llvm {
 class AllocaInst;
+class Function;
 class Instruction;
 class LLVMContext;
-class MDNode;
 class StoreInst;
 class Value;
 }  // namespace llvm
@@ -30,26 +31,43 @@ void AddMD(llvm::LLVMContext &Ctx, llvm::Instruction *pI, std::uint32_t InstNum)
 bool FromInst(llvm::Instruction *pI, std::uint32_t *pInstNum);
 }  // namespace PixDxilInstNum
 
-namespace PixDxilReg {
-static constexpr char MDName[] = "pix-dxil-reg";
-static constexpr uint32_t ID = 0;
+// The virtual register assignments of a function are kept in a single side
+// table attached to the function and keyed by pix-dxil-inst-num, instead of
+// one metadata node per instruction.
+namespace PixDxilRegTable {
+static constexpr char MDName[] = "pix-dxil-reg-table";
+
+class Builder {
+public:
+  void AddReg(llvm::Instruction *pI, std::uint32_t RegNum);
+  void AddAllocaReg(llvm::AllocaInst *pAlloca, std::uint32_t RegNum,
+                    std::uint32_t Count);
+  bool FindAllocaReg(llvm::AllocaInst *pAlloca, std::uint32_t *pRegBase,
+                     std::uint32_t *pRegSize) const;
+  void AddAllocaRegWrite(llvm::StoreInst *pSt, llvm::AllocaInst *pAlloca,
+                         llvm::Value *Index);
+  void Emit(llvm::Function *F);
+
+private:
+  // Flattened records, in increasing instruction number:
+  //   Regs:    { InstNum, RegNum }
+  //   Allocas: { InstNum, RegNum, Count }
+  //   Writes:  { InstNum, RegBase, RegSize, IndexKind, Index }
+  std::vector<std::uint32_t> m_Regs;
+  std::vector<std::uint32_t> m_Allocas;
+  std::vector<std::uint32_t> m_Writes;
+};
+}  // namespace PixDxilRegTable
 
-void AddMD(llvm::LLVMContext &Ctx, llvm::Instruction *pI, std::uint32_t RegNum);
+namespace PixDxilReg {
 bool FromInst(llvm::Instruction *pI, std::uint32_t *pRegNum);
 }  // namespace PixDxilReg
 
 namespace PixAllocaReg {
-static constexpr char MDName[] = "pix-alloca-reg";
-static constexpr uint32_t ID = 1;
-
-void AddMD(llvm::LLVMContext &Ctx, llvm::AllocaInst *pAlloca, std::uint32_t RegNum, std::uint32_t Count);
 bool FromInst(llvm::AllocaInst *pAlloca, std::uint32_t *pRegBase, std::uint32_t *pRegSize);
 }  // namespace PixAllocaReg
 
 namespace PixAllocaRegWrite {
-static constexpr char MDName[] = "pix-alloca-reg-write";
-static constexpr uint32_t ID = 2;
-void AddMD(llvm::LLVMContext &Ctx, llvm::StoreInst *pSt, llvm::MDNode *pAllocaReg, llvm::Value *Index);
 bool FromInst(llvm::StoreInst *pI, std::uint32_t *pRegBase, std::uint32_t *pRegSize, llvm::Value **pIndex);
 }  // namespace PixAllocaRegWrite
-}  // namespace pix_dxil
\ No newline at end of file
+}  // namespace pix_dxil
@@ -15,6 +15,8 @@
 #define __DXC_ROOTSIGNATURE__
 
 #include <stdint.h>
+#include <mutex>
+#include <vector>
 
 #include "dxc/Support/WinAdapter.h"
 
@@ -370,6 +372,46 @@ void DeserializeRootSignature(_In_reads_bytes_(SrcDataSizeInBytes) const void *p
                               _In_ uint32_t SrcDataSizeInBytes,
                               _Out_ const DxilVersionedRootSignatureDesc **ppRootSignature);
 
+// Read-only view of a serialized root signature. Initialize checks all the
+// counts and offsets once; parameters, descriptor ranges and static samplers
+// are then read in place, without building a DxilVersionedRootSignatureDesc.
+// Root descriptors and descriptor ranges are returned in their 1.1 form, with
+// the flags a 1.0 root signature is upconverted to.
+class DxilRootSignatureView {
+public:
+  DxilRootSignatureView() : m_pData(nullptr), m_Size(0) {}
+
+  // Returns false if the data is not a valid serialized root signature.
+  bool Initialize(_In_reads_bytes_(SrcDataSizeInBytes) const void *pSrcData,
+                  _In_ uint32_t SrcDataSizeInBytes);
+
+  DxilRootSignatureVersion GetVersion() const;
+  DxilRootSignatureFlags GetFlags() const;
+
+  uint32_t GetNumParameters() const;
+  DxilRootParameterType GetParameterType(uint32_t Index) const;
+  DxilShaderVisibility GetShaderVisibility(uint32_t Index) const;
+  // Requires a Constants32Bit parameter.
+  const DxilRootConstants &GetConstants(uint32_t Index) const;
+  // Requires a CBV, SRV or UAV parameter.
+  DxilRootDescriptor1 GetDescriptor(uint32_t Index) const;
+  // Require a DescriptorTable parameter.
+  uint32_t GetNumDescriptorRanges(uint32_t Index) const;
+  DxilDescriptorRange1 GetDescriptorRange(uint32_t Index, uint32_t RangeIndex) const;
+
+  uint32_t GetNumStaticSamplers() const;
+  const DxilStaticSamplerDesc &GetStaticSampler(uint32_t Index) const;
+
+private:
+  const char *m_pData;
+  uint32_t m_Size;
+
+  bool IsInBounds(uint32_t Offset, uint32_t Count, uint32_t ElementSize) const;
+  const DxilContainerRootSignatureDesc &GetDesc() const;
+  const DxilContainerRootParameter &GetParameter(uint32_t Index) const;
+  const DxilContainerRootDescriptorTable &GetDescriptorTable(uint32_t Index) const;
+};
+
 // Takes PSV - pipeline state validation data, not shader container.
 bool VerifyRootSignatureWithShaderPSV(_In_ const DxilVersionedRootSignatureDesc *pDesc,
                                       _In_ DXIL::ShaderKind ShaderKind,
@@ -382,6 +424,46 @@ bool VerifyRootSignature(_In_ const DxilVersionedRootSignatureDesc *pDesc,
                          _In_ llvm::raw_ostream &DiagStream,
                          _In_ bool bAllowReservedRegisterSpace);
 
+// Serialized root signatures known to pass standalone verification without
+// reserved register spaces. SerializeRootSignature marks what it produces, so
+// validating a container with a root signature compiled in this process does
+// not verify it again.
+void MarkRootSignatureVerified(_In_reads_bytes_(Size) const void *pData, _In_ uint32_t Size);
+bool IsRootSignatureVerified(_In_reads_bytes_(Size) const void *pData, _In_ uint32_t Size);
+
+// Maps byte strings to byte strings across the compiles of a process, for the
+// handful of root signatures that many shaders share. Holds at most
+// MaxEntries entries and replaces the oldest one when full. Entries are
+// allocated with malloc rather than the thread's IMalloc, since they outlive
+// the compile that adds them. Thread-safe.
+class RootSignatureByteCache {
+public:
+  ~RootSignatureByteCache();
+
+  // Copies the value stored for the key into pValue, if not null. Returns
+  // false if the key is not in the cache.
+  bool Lookup(_In_reads_bytes_(KeySize) const void *pKey, _In_ size_t KeySize,
+              _Out_opt_ std::vector<uint8_t> *pValue);
+  void Add(_In_reads_bytes_(KeySize) const void *pKey, _In_ size_t KeySize,
+           _In_reads_bytes_(ValueSize) const void *pValue,
+           _In_ size_t ValueSize);
+
+private:
+  struct Entry {
+    size_t Hash;
+    size_t KeySize;
+    size_t ValueSize;
+    uint8_t *pBytes; // The key followed by the value.
+  };
+  static const unsigned MaxEntries = 32;
+  std::mutex m_Mutex;
+  Entry m_Entries[MaxEntries] = {};
+  unsigned m_NumEntries = 0;
+  unsigned m_NextReplaced = 0;
+
+  const Entry *Find(size_t Hash, const void *pKey, size_t KeySize) const;
+};
+
 } // namespace hlsl
 
 #endif // __DXC_ROOTSIGNATURE__
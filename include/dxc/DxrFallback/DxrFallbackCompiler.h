@@ -2,6 +2,7 @@
 
 #include <map>
 #include <memory>
+#include <set>
 #include <string>
 #include <vector>
 
@@ -11,6 +12,7 @@ namespace llvm
   class Function;
   class Module;
   class Type;
+  class Value;
 }
 
 // Combines DXIL raytracing shaders together into a compute shader.
@@ -45,6 +47,19 @@ class DxrFallbackCompiler
 public:
   typedef std::map<int, std::string> IntToFuncNameMap;
 
+  // How the scheduler loop runs state functions.
+  //   Serial   - every lane runs its own next state function each iteration,
+  //              so lanes at different states diverge in the dispatch switch
+  //   Coherent - each iteration only the lanes at one state ID run, picked
+  //              with wave intrinsics as the most common of a few candidates
+  //              (the first lane's state and the wave minimum and maximum),
+  //              while the other lanes wait
+  enum class DispatchStrategy
+  {
+    Serial,
+    Coherent
+  };
+
   // If findCalledShaders is true, then the list of shaderNames is expanded to 
   // include shader functions (functions with attribute "exp-shader") that are 
   // called by functions in shaderNames. Shader entry state IDs are still
@@ -58,6 +73,13 @@ public:
   // 3 - dump intermediate stages of SFT to file
   void setDebugOutputLevel(int val);
 
+  // Used by link() when it creates the dispatch. Serial by default.
+  void setDispatchStrategy(DispatchStrategy val);
+
+  // Lets compile() transform the shaders on several threads when there are
+  // enough of them. On by default; turned off for testing.
+  void setParallelTransform(bool val);
+
   // Returns the entry state id for each of shaderNames. The transformations 
   // are performed in place on the module.
   void compile(std::vector<int>& shaderEntryStateIds, std::vector<unsigned int> &shaderStackSizes, IntToFuncNameMap *pCachedMap);
@@ -75,6 +97,8 @@ private:
   unsigned m_maxAttributeSize = 0;
   bool m_findCalledShaders = false;
   int m_debugOutputLevel = 0;
+  DispatchStrategy m_dispatchStrategy = DispatchStrategy::Serial;
+  bool m_parallelTransform = true;
 
   StringToFuncMap m_shaderMap;
 
@@ -84,6 +108,7 @@ private:
   void lowerReportHit();
   void lowerTraceRay(llvm::Type* runtimeDataArgTy);
   void createStateFunctions(IntToFuncMap& stateFunctionMap, std::vector<int>& shaderEntryStateIds, std::vector<unsigned int>& shaderStackSizes, int baseStateId, const std::vector<std::string>& shaderNames, llvm::Type* runtimeDataArgTy);
+  bool createStateFunctionsInParallel(IntToFuncMap& stateFunctionMap, std::vector<int>& shaderEntryStateIds, std::vector<unsigned int>& shaderStackSizes, int baseStateId, const std::vector<std::string>& shaderNames, llvm::Type* runtimeDataArgTy, const std::set<llvm::Value*>& resources);
   void createLaunchParams(llvm::Function* func);
   void createStack(llvm::Function* func);
   void createStateDispatch(llvm::Function* func, const IntToFuncMap& stateFunctionMap, llvm::Type* runtimeDataArgTy);
@@ -91,6 +116,7 @@ private:
 
   llvm::Type* getRuntimeDataArgType();
   llvm::Function* createDispatchFunction(const IntToFuncMap &stateFunctionMap, llvm::Type* runtimeDataArgTy);
+  llvm::Function* createCoherentDispatchFunction(llvm::Function* dispatchFunc, llvm::Type* runtimeDataArgTy);
 
   // These functions return calls only in shaders in m_shaderMap.
   std::vector<llvm::CallInst*> getCallsInShadersToFunction(const std::string& funcName);
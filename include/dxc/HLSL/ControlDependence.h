@@ -44,8 +44,8 @@ private:
   BasicBlockSet m_EmptyBBSet;
 
   llvm::BasicBlock *GetIPostDom(PostDomRelationType &PostDomRel, llvm::BasicBlock *pBB);
-  void ComputeRevTopOrderRec(PostDomRelationType &PostDomRel, llvm::BasicBlock *pBB,
-                             BasicBlockVector &RevTopOrder, BasicBlockSet &VisitedBBs);
+  void ComputeRevTopOrder(PostDomRelationType &PostDomRel, llvm::BasicBlock *pRootBB,
+                          BasicBlockVector &RevTopOrder);
 };
 
 } // end of hlsl namespace
@@ -11,6 +11,9 @@
 
 #pragma once
 
+#include <map>
+#include <string>
+
 namespace llvm {
 class Module;
 class ModulePass;
@@ -46,6 +49,7 @@ namespace llvm {
 /// Note that this pass is designed for use with the legacy pass manager.
 ModulePass *createDxilLowerCreateHandleForLibPass();
 ModulePass *createDxilAllocateResourcesForLibPass();
+ModulePass *createDxilRemoveUnusedResourcesPass();
 ModulePass *createDxilCleanupDynamicResourceHandlePass();
 ModulePass *createDxilEliminateOutputDynamicIndexingPass();
 ModulePass *createDxilGenerationPass(bool NotOptimized, hlsl::HLSLExtensionsCodegenHelper *extensionsHelper);
@@ -59,6 +63,8 @@ ModulePass *createDxilConvergentClearPass();
 ModulePass *createDxilDeadFunctionEliminationPass();
 ModulePass *createHLDeadFunctionEliminationPass();
 ModulePass *createHLPreprocessPass();
+FunctionPass *createHLInlineCleanupPass();
+ModulePass *createHLPadGroupSharedPass();
 ModulePass *createDxilPrecisePropagatePass();
 FunctionPass *createDxilPreserveAllOutputsPass();
 FunctionPass *createDxilPromoteLocalResources();
@@ -66,7 +72,19 @@ ModulePass *createDxilPromoteStaticResources();
 ModulePass *createDxilLegalizeResources();
 ModulePass *createDxilLegalizeEvalOperationsPass();
 FunctionPass *createDxilLegalizeSampleOffsetPass();
-FunctionPass *createDxilSimpleGVNHoistPass();
+FunctionPass *createDxilSimpleGVNHoistPass(unsigned MaxPressure);
+FunctionPass *createDxilCoalesceCBufferLoadsPass();
+FunctionPass *createDxilCombineRawBufferAccessesPass();
+FunctionPass *createDxilMeshOutputStoreEliminationPass();
+FunctionPass *createDxilUniformityOptPass(bool FoldWaveOps = true);
+FunctionPass *createDxilAnnotateUniformityPass();
+FunctionPass *createDxilFormDot2AddHalfPass();
+FunctionPass *createDxilRematerializePass(unsigned MaxPressure);
+FunctionPass *createDxilClusterFetchesPass();
+ModulePass *createDxilSpecializeConstantArgsPass();
+ModulePass *createDxilSpecializeCBufferPass();
+ModulePass *createDxilSpecializeCBufferPass(
+    const std::map<std::string, std::string> &Values);
 ModulePass *createInvalidateUndefResourcesPass();
 FunctionPass *createSimplifyInstPass();
 ModulePass *createDxilTranslateRawBuffer();
@@ -79,6 +97,7 @@ ModulePass *createDxilRenameResourcesPass();
 
 void initializeDxilLowerCreateHandleForLibPass(llvm::PassRegistry&);
 void initializeDxilAllocateResourcesForLibPass(llvm::PassRegistry&);
+void initializeDxilRemoveUnusedResourcesPass(llvm::PassRegistry&);
 void initializeDxilCleanupDynamicResourceHandlePass(llvm::PassRegistry &);
 void initializeDxilEliminateOutputDynamicIndexingPass(llvm::PassRegistry&);
 void initializeDxilGenerationPassPass(llvm::PassRegistry&);
@@ -91,6 +110,8 @@ void initializeDxilExpandTrigIntrinsicsPass(llvm::PassRegistry&);
 void initializeDxilDeadFunctionEliminationPass(llvm::PassRegistry&);
 void initializeHLDeadFunctionEliminationPass(llvm::PassRegistry&);
 void initializeHLPreprocessPass(llvm::PassRegistry&);
+void initializeHLInlineCleanupPass(llvm::PassRegistry&);
+void initializeHLPadGroupSharedPass(llvm::PassRegistry&);
 void initializeDxilConvergentMarkPass(llvm::PassRegistry&);
 void initializeDxilConvergentClearPass(llvm::PassRegistry&);
 void initializeDxilPrecisePropagatePassPass(llvm::PassRegistry&);
@@ -101,6 +122,16 @@ void initializeDxilLegalizeResourcesPass(llvm::PassRegistry&);
 void initializeDxilLegalizeEvalOperationsPass(llvm::PassRegistry&);
 void initializeDxilLegalizeSampleOffsetPassPass(llvm::PassRegistry&);
 void initializeDxilSimpleGVNHoistPass(llvm::PassRegistry&);
+void initializeDxilCoalesceCBufferLoadsPass(llvm::PassRegistry&);
+void initializeDxilCombineRawBufferAccessesPass(llvm::PassRegistry&);
+void initializeDxilMeshOutputStoreEliminationPass(llvm::PassRegistry&);
+void initializeDxilUniformityOptPass(llvm::PassRegistry&);
+void initializeDxilAnnotateUniformityPass(llvm::PassRegistry&);
+void initializeDxilFormDot2AddHalfPass(llvm::PassRegistry&);
+void initializeDxilRematerializePass(llvm::PassRegistry&);
+void initializeDxilClusterFetchesPass(llvm::PassRegistry&);
+void initializeDxilSpecializeConstantArgsPass(llvm::PassRegistry&);
+void initializeDxilSpecializeCBufferPass(llvm::PassRegistry&);
 void initializeInvalidateUndefResourcesPass(llvm::PassRegistry&);
 void initializeSimplifyInstPass(llvm::PassRegistry&);
 void initializeDxilTranslateRawBufferPass(llvm::PassRegistry&);
@@ -11,6 +11,7 @@
 
 #pragma once
 
+#include "llvm/ADT/ArrayRef.h"
 #include "llvm/ADT/StringRef.h"
 #include "dxc/DXIL/DxilSemantic.h"
 #include "dxc/DXIL/DxilInterpolationMode.h"
@@ -68,4 +69,22 @@ class DxilSignature;
 // Packs the signature elements per DXIL constraints and returns the number of rows used for the signature.
 unsigned PackDxilSignature(DxilSignature &sig, DXIL::PackingStrategy packing);
 
+class DxilModule;
+// Packs the outputs of Producer and the inputs of Consumer, the stage that
+// follows it in the same pipeline, to the same layout, after removing the
+// arbitrary-semantic elements Consumer never reads from both. Returns false
+// if the pair is not supported or nothing changed.
+bool PackInterstageSignatures(DxilModule &Producer, DxilModule &Consumer,
+                              DXIL::PackingStrategy packing);
+// Removes the arbitrary-semantic outputs of Producer that no element of
+// ConsumerInputs, the input signature of the next stage, overlaps, and the
+// stores to components its usage masks leave out, along with the code that
+// only computed them. The masks must include every component the consumer
+// reads. Returns false if nothing changed.
+bool EliminateUnreadOutputs(DxilModule &Producer,
+                            const DxilSignature &ConsumerInputs);
+// Packs each pair of adjacent stages, given in pipeline order.
+bool PackPipelineSignatures(llvm::ArrayRef<DxilModule *> Stages,
+                            DXIL::PackingStrategy packing);
+
 } // namespace hlsl
@@ -0,0 +1,30 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// DxilPerfReport.h                                                          //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Static cost estimate of a DXIL module, for -Qperf-report.                 //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+namespace llvm {
+class Module;
+class raw_ostream;
+}
+
+namespace hlsl {
+
+// Writes a static cost estimate of the DXIL in M to OS as JSON: the
+// DxilCounters for the module, and for each function with a body its
+// instructions by class, as written and multiplied by the trip counts of
+// the loops around them, its peak live 32-bit values, its cbuffer rows and
+// its dynamically indexed temporaries. The weighted counts are folded into
+// a single cost per function and for the module, which is only meaningful
+// compared with earlier reports for the same shader.
+void WriteDxilPerfReport(llvm::Module &M, llvm::raw_ostream &OS);
+
+} // namespace hlsl
@@ -0,0 +1,62 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// DxilRegisterPressure.h                                                    //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Estimates how many 32-bit values a DXIL function keeps live.              //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SetVector.h"
+
+namespace llvm {
+  class BasicBlock;
+  class Function;
+  class Instruction;
+  class Type;
+  class Use;
+}
+
+namespace hlsl {
+
+// Drivers allocate registers from their own code, so this is only an
+// estimate: every live SSA value counts as the number of 32-bit components
+// of its type, at the point it is most likely to be kept. Liveness is found
+// the way DxrFallback's LiveValues does it, by walking up from each use to
+// the definition, but is kept per block.
+class RegisterPressure {
+public:
+  typedef llvm::SmallSetVector<llvm::Instruction *, 16> LiveSet;
+
+  void Compute(llvm::Function *F);
+  void Clear();
+
+  // Values live on entry to and on exit from BB.
+  const LiveSet &GetLiveIn(llvm::BasicBlock *BB) const;
+  const LiveSet &GetLiveOut(llvm::BasicBlock *BB) const;
+  // Pressure on exit from BB, and the highest pressure inside BB.
+  unsigned GetLiveOutPressure(llvm::BasicBlock *BB) const;
+  unsigned GetMaxPressure(llvm::BasicBlock *BB) const;
+  unsigned GetMaxPressure() const { return m_MaxPressure; }
+
+  static unsigned GetRegisterCount(llvm::Type *Ty);
+
+private:
+  struct BlockInfo {
+    LiveSet LiveIn;
+    LiveSet LiveOut;
+    unsigned LiveOutPressure = 0;
+    unsigned MaxPressure = 0;
+  };
+  llvm::DenseMap<llvm::BasicBlock *, BlockInfo> m_Blocks;
+  unsigned m_MaxPressure = 0;
+
+  void MarkUse(llvm::Instruction *Def, llvm::Use &U);
+  void ComputeBlockPressure(llvm::BasicBlock *BB, BlockInfo &Info);
+};
+
+} // end of hlsl namespace
@@ -12,6 +12,7 @@
 #pragma once
 
 #include "dxc/Support/Global.h"
+#include <algorithm>
 #include <set>
 #include <map>
 
@@ -52,13 +53,24 @@ public:
       return false;
     if (pos < m_FirstFree)
       pos = m_FirstFree;
+    bool fromSearchStart = false;
+    if (align == 1) {
+      T_index start = GetSearchStart(size);
+      if (pos <= start) {
+        pos = start;
+        fromSearchStart = true;
+      }
+    }
     if (!UpdatePos(pos, size, align))
       return false;
     T_index end = pos + (size - 1);
     auto next = m_Spans.lower_bound(Span(nullptr, pos, end));
-    if (next == m_Spans.end() || end < next->start)
-      return true;  // it fits here
-    return Find(size, next, pos, align);
+    if (next != m_Spans.end() && !(end < next->start) &&
+        !Find(size, next, pos, align))
+      return false;
+    if (fromSearchStart)
+      SetSearchStart(size, pos);
+    return true;
   }
 
   // Finds the farthest position at which an element could be allocated.
@@ -79,17 +91,21 @@ public:
       return false;
     if (m_AllocationFull)
       return false;
-    pos = m_FirstFree;
+    pos = (align == 1) ? GetSearchStart(size) : m_FirstFree;
     if (!UpdatePos(pos, size, align))
       return false;
     auto result = m_Spans.emplace(element, pos, pos + (size - 1));
     if (result.second) {
+      if (align == 1)
+        SetSearchStart(size, pos);
       AdvanceFirstFree(result.first);
       return true;
     }
     // Collision, find a gap from iterator
     if (!Find(size, result.first, pos, align))
       return false;
+    if (align == 1)
+      SetSearchStart(size, pos);
     result = m_Spans.emplace(element, pos, pos + (size - 1));
     return result.second;
   }
@@ -155,6 +171,22 @@ private:
     return true;
   }
 
+  // Spans are never removed, only added or merged into larger ones, so once
+  // the first gap that fits a size is found, no gap of that size or larger
+  // can open up before it. Remember where each size was last found, so that
+  // repeated searches do not walk the same spans again.
+  T_index GetSearchStart(T_index size) {
+    auto it = m_SearchStart.upper_bound(size);
+    if (it == m_SearchStart.begin())
+      return m_FirstFree;
+    --it;
+    return std::max(it->second, m_FirstFree);
+  }
+  void SetSearchStart(T_index size, T_index pos) {
+    T_index &start = m_SearchStart[size];
+    start = std::max(start, pos);
+  }
+
   // Advance m_FirstFree if it's in span
   void AdvanceFirstFree(typename SpanSet::const_iterator it) {
     if (it->start <= m_FirstFree && m_FirstFree <= it->end) {
@@ -195,6 +227,8 @@ private:
 
 private:
   SpanSet m_Spans;
+  // Size -> position before which no gap of that size exists.
+  std::map<T_index, T_index> m_SearchStart;
   T_index m_Min, m_Max, m_FirstFree;
   const T_element *m_Unbounded;
   bool m_AllocationFull;
@@ -0,0 +1,72 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// DxilUniformityAnalysis.h                                                  //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Computes how much each value of a DXIL function varies across threads.    //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+#include "llvm/ADT/DenseMap.h"
+
+#include <vector>
+
+namespace llvm {
+  class Function;
+  class Instruction;
+  class LoopInfo;
+  class PostDominatorTree;
+  class TerminatorInst;
+  class Value;
+  class raw_ostream;
+}
+
+namespace hlsl {
+
+// Ordered from least to most varying.
+enum class Uniformity : unsigned {
+  Uniform,     // Same for every thread of the dispatch or draw.
+  WaveUniform, // Same for every active lane of a wave.
+  Divergent,   // May differ between lanes of a wave.
+};
+
+// Unlike WaveSensitivityAnalysis, which tracks what depends on wave
+// operations, this classifies values by what drivers can keep in scalar
+// registers. Wave operations that reduce across the wave give wave-uniform
+// results, and a branch on a value makes the phis where its paths meet, and
+// the uses of values leaving a loop it exits, vary as much as that value.
+class UniformityAnalysis {
+public:
+  void Compute(llvm::Function *F, llvm::PostDominatorTree &PDT,
+               llvm::LoopInfo &LI);
+  void Clear();
+  Uniformity GetUniformity(llvm::Value *V) const;
+  bool IsUniform(llvm::Value *V) const {
+    return GetUniformity(V) == Uniformity::Uniform;
+  }
+  bool IsWaveUniform(llvm::Value *V) const {
+    return GetUniformity(V) != Uniformity::Divergent;
+  }
+  void print(llvm::raw_ostream &OS);
+  void dump();
+
+private:
+  llvm::Function *m_pFunc = nullptr;
+  llvm::PostDominatorTree *m_pPDT = nullptr;
+  llvm::LoopInfo *m_pLI = nullptr;
+  // Instructions not in the map are uniform.
+  llvm::DenseMap<llvm::Instruction *, Uniformity> m_State;
+  // Divergence that comes from control flow rather than operands.
+  llvm::DenseMap<llvm::Instruction *, Uniformity> m_SyncState;
+  std::vector<llvm::Instruction *> m_WorkList;
+
+  Uniformity ComputeInst(llvm::Instruction *I) const;
+  void Update(llvm::Instruction *I);
+  void UpdateSync(llvm::Instruction *I, Uniformity U);
+  void PropagateBranch(llvm::TerminatorInst *TI, Uniformity U);
+};
+
+} // end of hlsl namespace
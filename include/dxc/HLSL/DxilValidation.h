@@ -95,11 +95,27 @@ HRESULT ValidateDxilContainer(_In_reads_bytes_(ContainerSize) const void *pConta
                               _In_ llvm::raw_ostream &DiagStream);
 
 // Full container validation, including ValidateDxilModule, with debug module
+// If bAllowCachedResult is true, a DXIL part that passed validation earlier in
+// this process is not validated again, and when the container parts checked
+// against it are unchanged too, nothing is.
 HRESULT ValidateDxilContainer(_In_reads_bytes_(ContainerSize) const void *pContainer,
                               _In_ uint32_t ContainerSize,
                               const void *pOptDebugBitcode,
                               uint32_t OptDebugBitcodeSize,
-                              _In_ llvm::raw_ostream &DiagStream);
+                              _In_ llvm::raw_ostream &DiagStream,
+                              bool bAllowCachedResult = false);
+
+// While in scope, modules validated on the current thread check their
+// function bodies serially. Callers that already validate several modules
+// concurrently use this to avoid starting threads from each worker.
+class SerialFunctionValidationScope {
+private:
+  bool m_prevSerial;
+
+public:
+  SerialFunctionValidationScope();
+  ~SerialFunctionValidationScope();
+};
 
 class PrintDiagnosticContext {
 private:
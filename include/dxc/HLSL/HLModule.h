@@ -278,11 +278,15 @@ private:
   std::unordered_map<const llvm::Function *, std::unique_ptr<DxilFunctionProps>>  m_DxilFunctionPropsMap;
   std::unordered_set<llvm::Function *>  m_PatchConstantFunctions;
 
-  // Resource bindings for res in cb.
-  // Key = CbID << 32 | ConstantIdx. Val is reg binding.
-  std::unordered_map<uint64_t, unsigned> m_SrvBindingInCB;
-  std::unordered_map<uint64_t, unsigned> m_UavBindingInCB;
-  std::unordered_map<uint64_t, unsigned> m_SamplerBindingInCB;
+  // Resource bindings for res in cb, sorted by Key.
+  // Key = CbID << 32 | ConstantIdx. Val is reg binding of each class.
+  struct RegBindingInCB {
+    uint64_t Key;
+    unsigned Srv;
+    unsigned Uav;
+    unsigned Sampler;
+  };
+  std::vector<RegBindingInCB> m_RegBindingInCB;
 
 private:
   llvm::LLVMContext &m_Ctx;
@@ -12,7 +12,9 @@
 #pragma once
 
 #include "dxc/HLSL/HLSLExtensionsCodegenHelper.h"
+#include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/StringRef.h"
+#include <map>
 #include <string>
 #include <unordered_map>
 
@@ -34,6 +36,21 @@ namespace hlsl {
       virtual ~HLResourceLookup() {}
   };
 
+  // Lowering decisions that depend only on the extension function being
+  // lowered. One cache is shared by every ExtensionLowering in a module so
+  // each unique extension signature is resolved once.
+  struct ExtensionLoweringCache {
+    // Custom names from the codegen helper, by extension opcode.
+    std::unordered_map<unsigned, std::string> IntrinsicNames;
+    // Dxil opcodes from the codegen helper, by extension opcode.
+    // OP::OpCode::NumOpCodes records that the opcode has no mapping.
+    std::unordered_map<unsigned, OP::OpCode> DxilOpcodes;
+    // Lowered declarations, by high-level extension function and the
+    // strategy that produced them. A null entry records that the strategy
+    // does not apply to the function.
+    std::map<std::pair<llvm::Function *, unsigned>, llvm::Function *> LoweredFunctions;
+  };
+
   // Lowers HLSL extensions from HL operation to DXIL operation.
   class ExtensionLowering {
   public:
@@ -48,8 +65,10 @@ namespace hlsl {
     };
 
     // Create the lowering using the given strategy and custom codegen helper.
-    ExtensionLowering(llvm::StringRef strategy, HLSLExtensionsCodegenHelper *helper, OP& hlslOp, HLResourceLookup &resourceHelper);
-    ExtensionLowering(Strategy strategy, HLSLExtensionsCodegenHelper *helper, OP& hlslOp, HLResourceLookup &resourceHelper);
+    // Decisions are memoized in cache when one is given, or in a cache
+    // private to this lowering otherwise.
+    ExtensionLowering(llvm::StringRef strategy, HLSLExtensionsCodegenHelper *helper, OP& hlslOp, HLResourceLookup &resourceHelper, ExtensionLoweringCache *cache = nullptr);
+    ExtensionLowering(Strategy strategy, HLSLExtensionsCodegenHelper *helper, OP& hlslOp, HLResourceLookup &resourceHelper, ExtensionLoweringCache *cache = nullptr);
 
     // Translate the HL op call to a DXIL op call.
     // Returns a new value if translation was successful.
@@ -78,6 +97,12 @@ namespace hlsl {
     OP &m_hlslOp;
     HLResourceLookup &m_hlResourceLookup;
     std::string m_extraStrategyInfo;
+    ExtensionLoweringCache m_ownedCache;
+    ExtensionLoweringCache &m_cache;
+
+    llvm::Function *GetLoweredFunction(llvm::CallInst *CI, Strategy strategy,
+                                       llvm::function_ref<llvm::Function *()> create);
+    bool GetDxilOpcode(unsigned extOpcode, OP::OpCode &dxilOpcode);
 
     llvm::Value *Unknown(llvm::CallInst *CI);
     llvm::Value *NoTranslation(llvm::CallInst *CI);
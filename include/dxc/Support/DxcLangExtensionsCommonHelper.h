@@ -260,4 +260,58 @@ public:
     return (_helper_field_).SetTargetTriple(name);                   \
   } \
 
+// Use this macro instead when the helper is updated through a function, such
+// as one that applies the change to a copy. _update_ is called with a
+// function that takes the DxcLangExtensionsCommonHelper to change and returns
+// an HRESULT.
+#define DXC_LANGEXTENSIONS_HELPER_UPDATE_IMPL(_update_) \
+  HRESULT STDMETHODCALLTYPE RegisterIntrinsicTable(_In_ IDxcIntrinsicTable *pTable) override { \
+    DxcThreadMalloc TM(m_pMalloc); \
+    return _update_([&](DxcLangExtensionsCommonHelper &helper) { \
+      return helper.RegisterIntrinsicTable(pTable); \
+    }); \
+  } \
+  HRESULT STDMETHODCALLTYPE RegisterSemanticDefine(LPCWSTR name) override { \
+    DxcThreadMalloc TM(m_pMalloc); \
+    return _update_([&](DxcLangExtensionsCommonHelper &helper) { \
+      return helper.RegisterSemanticDefine(name); \
+    }); \
+  } \
+  HRESULT STDMETHODCALLTYPE RegisterSemanticDefineExclusion(LPCWSTR name) override { \
+    DxcThreadMalloc TM(m_pMalloc); \
+    return _update_([&](DxcLangExtensionsCommonHelper &helper) { \
+      return helper.RegisterSemanticDefineExclusion(name); \
+    }); \
+  } \
+  HRESULT STDMETHODCALLTYPE RegisterNonOptSemanticDefine(LPCWSTR name) override { \
+    DxcThreadMalloc TM(m_pMalloc); \
+    return _update_([&](DxcLangExtensionsCommonHelper &helper) { \
+      return helper.RegisterNonOptSemanticDefine(name); \
+    }); \
+  } \
+  HRESULT STDMETHODCALLTYPE RegisterDefine(LPCWSTR name) override { \
+    DxcThreadMalloc TM(m_pMalloc); \
+    return _update_([&](DxcLangExtensionsCommonHelper &helper) { \
+      return helper.RegisterDefine(name); \
+    }); \
+  } \
+  HRESULT STDMETHODCALLTYPE SetSemanticDefineValidator(_In_ IDxcSemanticDefineValidator* pValidator) override { \
+    DxcThreadMalloc TM(m_pMalloc); \
+    return _update_([&](DxcLangExtensionsCommonHelper &helper) { \
+      return helper.SetSemanticDefineValidator(pValidator); \
+    }); \
+  } \
+  HRESULT STDMETHODCALLTYPE SetSemanticDefineMetaDataName(LPCSTR name) override { \
+    DxcThreadMalloc TM(m_pMalloc); \
+    return _update_([&](DxcLangExtensionsCommonHelper &helper) { \
+      return helper.SetSemanticDefineMetaDataName(name); \
+    }); \
+  } \
+  HRESULT STDMETHODCALLTYPE SetTargetTriple(LPCSTR name) override { \
+    DxcThreadMalloc TM(m_pMalloc); \
+    return _update_([&](DxcLangExtensionsCommonHelper &helper) { \
+      return helper.SetTargetTriple(name); \
+    }); \
+  } \
+
 } // namespace hlsl
@@ -25,6 +25,7 @@ typedef _Return_type_success_(return >= 0) long HRESULT;
 #endif // _WIN32
 
 #include <stdarg.h>
+#include <new>
 #include <system_error>
 #include "dxc/Support/exception.h"
 #include "dxc/Support/WinAdapter.h"
@@ -74,6 +75,58 @@ private:
   IMalloc *pPrior;
 };
 
+// Creates an arena allocator that carves allocations out of large chunks
+// taken from pBackingOrNull (the thread's allocator if null, or the C heap
+// if there is no thread allocator either). Free only
+// reclaims the most recent allocation; everything else is returned at once
+// when the arena is released. The arena is not thread-safe and is meant for
+// short-lived scratch data that is dropped in bulk.
+HRESULT DxcCreateArenaMalloc(IMalloc *pBackingOrNull,
+                             IMalloc **ppArena) throw();
+
+// Used by DxcMallocAllocator to call into an IMalloc without its definition.
+void *DxcMallocAlloc(IMalloc *pMalloc, size_t size) throw();
+void DxcMallocFree(IMalloc *pMalloc, void *ptr) throw();
+
+// An STL allocator over an IMalloc, eg one created by DxcCreateArenaMalloc.
+// The allocator does not hold a reference; the IMalloc must outlive any
+// container using it.
+template <typename T> class DxcMallocAllocator {
+public:
+  typedef T value_type;
+
+  explicit DxcMallocAllocator(IMalloc *pMalloc) throw() : m_pMalloc(pMalloc) {}
+  template <typename U>
+  DxcMallocAllocator(const DxcMallocAllocator<U> &other) throw()
+      : m_pMalloc(other.GetMalloc()) {}
+
+  T *allocate(size_t n) {
+    void *P = DxcMallocAlloc(m_pMalloc, n * sizeof(T));
+    if (P == nullptr)
+      throw std::bad_alloc();
+    return static_cast<T *>(P);
+  }
+  void deallocate(T *p, size_t) throw() { DxcMallocFree(m_pMalloc, p); }
+
+  IMalloc *GetMalloc() const throw() { return m_pMalloc; }
+
+  template <typename U> struct rebind { typedef DxcMallocAllocator<U> other; };
+
+private:
+  IMalloc *m_pMalloc;
+};
+
+template <typename T, typename U>
+bool operator==(const DxcMallocAllocator<T> &a,
+                const DxcMallocAllocator<U> &b) throw() {
+  return a.GetMalloc() == b.GetMalloc();
+}
+template <typename T, typename U>
+bool operator!=(const DxcMallocAllocator<T> &a,
+                const DxcMallocAllocator<U> &b) throw() {
+  return a.GetMalloc() != b.GetMalloc();
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 // Error handling support.
 void CheckLLVMErrorCode(const std::error_code &ec);
@@ -122,6 +122,11 @@ public:
   llvm::StringRef OutputReflectionFile; // OPT_Fre
   llvm::StringRef OutputRootSigFile; // OPT_Frs
   llvm::StringRef OutputShaderHashFile; // OPT_Fsh
+  llvm::StringRef OutputSpirvFile; // OPT_Fspv
+  llvm::StringRef TimeTraceFile; // OPT_ftime_trace_EQ
+  llvm::StringRef PassReportFile; // OPT_Qpass_report_EQ
+  llvm::StringRef MemoryReportFile; // OPT_Qmemory_report_EQ
+  llvm::StringRef PerfReportFile; // OPT_Qperf_report_EQ
   llvm::StringRef OutputFileForDependencies; // OPT_write_dependencies_to
   llvm::StringRef Preprocess; // OPT_P
   llvm::StringRef TargetProfile; // OPT_target_profile
@@ -136,6 +141,9 @@ public:
   llvm::StringRef DefaultLinkage; // OPT_default_linkage
   llvm::StringRef ImportBindingTable;    // OPT_import_binding_table
   llvm::StringRef BindingTableDefine; // OPT_binding_table_define
+  llvm::StringRef ProfileUse; // OPT_fprofile_use_EQ
+  llvm::StringRef BatchFile; // OPT_batch
+  unsigned BatchJobs = 0; // OPT_j
   unsigned DefaultTextCodePage = DXC_CP_UTF8; // OPT_encoding
 
   bool AllResourcesBound = false; // OPT_all_resources_bound
@@ -145,12 +153,17 @@ public:
   bool CodeGenHighLevel = false; // OPT_fcgl
   bool AllowPreserveValues = false; // OPT_preserve_intermediate_values
   bool DebugInfo = false; // OPT__SLASH_Zi
+  bool DebugLineTablesOnly = false; // OPT_Zi_lines
   bool DebugNameForBinary = false; // OPT_Zsb
   bool DebugNameForSource = false; // OPT_Zss
+  bool FastShaderHash = false; // OPT_Qfast_hash
   bool DumpBin = false;        // OPT_dumpbin
   bool DumpDependencies = false;  // OPT_dump_dependencies
   bool WriteDependencies = false; // OPT_write_dependencies
+  bool ScanDependencies = false; // OPT_dependency_scan
+  bool DependencyGraphJson = false; // OPT_dependency_graph_json
   bool Link = false;        // OPT_link
+  bool Serve = false;       // OPT_serve
   bool WarningAsError = false; // OPT__SLASH_WX
   bool IEEEStrict = false;     // OPT_Gis
   bool IgnoreLineDirectives = false; // OPT_ignore_line_directives
@@ -159,6 +172,7 @@ public:
   bool DisableValidation = false; // OPT_VD
   unsigned OptLevel = 0;      // OPT_O0/O1/O2/O3
   bool DisableOptimizations = false; // OPT_Od
+  bool FastDevBuild = false; // OPT_Odev
   bool AvoidFlowControl = false;     // OPT_Gfa
   bool PreferFlowControl = false;    // OPT_Gfp
   bool EnableStrictMode = false;     // OPT_Ges
@@ -203,11 +217,22 @@ public:
   bool ResMayAlias = false; // OPT_res_may_alias
   unsigned long ValVerMajor = UINT_MAX, ValVerMinor = UINT_MAX; // OPT_validator_version
   unsigned ScanLimit = 0; // OPT_memdep_block_scan_limit
+  unsigned UnrollMaxFunctionInstructions = 0; // OPT_unroll_max_function_instructions
+  unsigned UnrollMaxModuleInstructions = 0; // OPT_unroll_max_module_instructions
+  unsigned UnrollTimeLimit = 0; // OPT_unroll_time_limit
+  unsigned MaxRegisterPressure = 0; // OPT_max_register_pressure
   bool ForceZeroStoreLifetimes = false; // OPT_force_zero_store_lifetimes
   bool EnableLifetimeMarkers = false; // OPT_enable_lifetime_markers
   bool EnableTemplates = false; // OPT_enable_templates
   bool EnableOperatorOverloading = false; // OPT_enable_operator_overloading
   bool StrictUDTCasting = false; // OPT_strict_udt_casting
+  bool TimeTrace = false; // OPT_ftime_trace, OPT_ftime_trace_EQ
+  bool PassReport = false; // OPT_Qpass_report, OPT_Qpass_report_EQ
+  bool MemoryReport = false; // OPT_Qmemory_report, OPT_Qmemory_report_EQ
+  bool PerfReport = false; // OPT_Qperf_report, OPT_Qperf_report_EQ
+  unsigned DeadlineMs = 0; // OPT_Qdeadline, zero means no deadline
+  unsigned MemoryLimitMB = 0; // OPT_Qmemory_limit, zero means no limit
+  bool LibIncremental = false; // OPT_Qlib_incremental
 
   // Experimental option to enable short-circuiting operators
   bool EnableShortCircuit = false; // OPT_enable_short_circuit
@@ -217,6 +242,7 @@ public:
   // Optimization pass enables, disables and selects
   std::map<std::string, bool> DxcOptimizationToggles; // OPT_opt_enable & OPT_opt_disable
   std::map<std::string, std::string> DxcOptimizationSelects; // OPT_opt_select
+  std::map<std::string, std::string> SpecializedCBufferValues; // OPT_specialize_cbuffer
 
   std::set<std::string> IgnoreSemDefs; // OPT_ignore_semdef
   std::map<std::string, std::string> OverrideSemDefs; // OPT_override_semdef
@@ -231,16 +257,16 @@ public:
 
   std::vector<std::string> Warnings;
 
-  bool IsRootSignatureProfile();
-  bool IsLibraryProfile();
+  bool IsRootSignatureProfile() const;
+  bool IsLibraryProfile() const;
 
   // Helpers to clarify interpretation of flags for behavior in implementation
-  bool GenerateFullDebugInfo(); // Zi
-  bool GeneratePDB();           // Zi or Zs
-  bool EmbedDebugInfo();        // Qembed_debug
-  bool EmbedPDBName();          // Zi or Fd
-  bool DebugFileIsDirectory();  // Fd ends in '\\'
-  llvm::StringRef GetPDBName(); // Fd name
+  bool GenerateFullDebugInfo() const; // Zi
+  bool GeneratePDB() const;           // Zi or Zs
+  bool EmbedDebugInfo() const;        // Qembed_debug
+  bool EmbedPDBName() const;          // Zi or Fd
+  bool DebugFileIsDirectory() const;  // Fd ends in '\\'
+  llvm::StringRef GetPDBName() const; // Fd name
 
   // SPIRV Change Starts
 #ifdef ENABLE_SPIRV_CODEGEN
@@ -20,6 +20,8 @@
 #include "llvm/ADT/StringRef.h"
 #include "llvm/Option/ArgList.h"
 
+#include <chrono>
+
 namespace clang {
 namespace spirv {
 
@@ -87,6 +89,11 @@ struct SpirvCodeGenOptions {
 
   // String representation of all command line options.
   std::string clOptions;
+
+  /// When to abort the compile (-Qdeadline); checked between functions and
+  /// between the stages after emission.
+  std::chrono::steady_clock::time_point deadline =
+      std::chrono::steady_clock::time_point::max();
 };
 
 } // namespace spirv
@@ -196,17 +196,9 @@
 
 // Event Tracing for Windows (ETW) provides application programmers the ability
 // to start and stop event tracing sessions, instrument an application to
-// provide trace events, and consume trace events.
-#define DxcEtw_DXCompilerCreateInstance_Start()
-#define DxcEtw_DXCompilerCreateInstance_Stop(hr)
-#define DxcEtw_DXCompilerCompile_Start()
-#define DxcEtw_DXCompilerCompile_Stop(hr)
-#define DxcEtw_DXCompilerDisassemble_Start()
-#define DxcEtw_DXCompilerDisassemble_Stop(hr)
-#define DxcEtw_DXCompilerPreprocess_Start()
-#define DxcEtw_DXCompilerPreprocess_Stop(hr)
-#define DxcEtw_DxcValidation_Start()
-#define DxcEtw_DxcValidation_Stop(hr)
+// provide trace events, and consume trace events. Elsewhere the same events
+// are USDT probes, if enabled.
+#include "dxc/Tracing/DxcUsdt.h"
 
 #define UInt32Add UIntAdd
 #define Int32ToUInt32 IntToUInt
@@ -33,16 +33,68 @@ public:
   }
 };
 
+// Writes to a caller-provided IStream. Callers should flush before
+// destruction so that write failures are reported where they can be caught.
+class raw_com_stream_ostream : public llvm::raw_ostream {
+private:
+  CComPtr<IStream> m_pStream;
+  uint64_t m_written = 0;
+  HRESULT m_hr = S_OK;
+  // Write failures are recorded rather than thrown, so that flushing from
+  // the destructor, possibly while unwinding, cannot terminate.
+  void write_impl(const char *Ptr, size_t Size) override {
+    while (Size > 0 && SUCCEEDED(m_hr)) {
+      ULONG cbToWrite = (ULONG)std::min<size_t>(Size, ULONG_MAX);
+      ULONG cbWritten = 0;
+      m_hr = m_pStream->Write(Ptr, cbToWrite, &cbWritten);
+      if (SUCCEEDED(m_hr) && cbWritten == 0)
+        m_hr = E_FAIL;
+      Ptr += cbWritten;
+      Size -= cbWritten;
+      m_written += cbWritten;
+    }
+  }
+  uint64_t current_pos() const override { return m_written; }
+public:
+  raw_com_stream_ostream(IStream *pStream) : m_pStream(pStream) { }
+  ~raw_com_stream_ostream() override {
+    flush();
+  }
+  /// Flushes and returns the first write failure, or S_OK. Output after a
+  /// failure is discarded.
+  HRESULT GetStatus() {
+    flush();
+    return m_hr;
+  }
+};
+
 namespace {
+// Text outputs are stored in the result's code page. A matching, null
+// terminated blob is referenced in place; anything else is converted or
+// copied in a single allocation.
+HRESULT TranslateBlobForOutput(IDxcBlob *pBlob, UINT32 codePage,
+                               IDxcBlobEncoding **ppBlobEncoding) {
+  if (codePage == DXC_CP_WIDE) {
+    CComPtr<IDxcBlobWide> pBlobWide;
+    IFR(hlsl::DxcGetBlobAsWide(pBlob, nullptr, &pBlobWide));
+    *ppBlobEncoding = pBlobWide.Detach();
+  } else {
+    CComPtr<IDxcBlobUtf8> pBlobUtf8;
+    IFR(hlsl::DxcGetBlobAsUtf8(pBlob, nullptr, &pBlobUtf8));
+    *ppBlobEncoding = pBlobUtf8.Detach();
+  }
+  return S_OK;
+}
+
 HRESULT TranslateUtf8StringForOutput(
     _In_opt_count_(size) LPCSTR pStr, SIZE_T size, UINT32 codePage, IDxcBlobEncoding **ppBlobEncoding) {
   CComPtr<IDxcBlobEncoding> pBlobEncoding;
-  IFR(hlsl::DxcCreateBlobWithEncodingOnHeapCopy(pStr, size, DXC_CP_UTF8, &pBlobEncoding));
   if (codePage == DXC_CP_WIDE) {
-    CComPtr<IDxcBlobWide> pBlobWide;
-    IFT(hlsl::DxcGetBlobAsWide(pBlobEncoding, nullptr, &pBlobWide))
-      pBlobEncoding = pBlobWide;
+    // Convert straight from the caller's buffer.
+    IFR(hlsl::DxcCreateBlobWithEncodingFromPinned(pStr, size, DXC_CP_UTF8, &pBlobEncoding));
+    return TranslateBlobForOutput(pBlobEncoding, codePage, ppBlobEncoding);
   }
+  IFR(hlsl::DxcCreateBlobWithEncodingOnHeapCopy(pStr, size, DXC_CP_UTF8, &pBlobEncoding));
   *ppBlobEncoding = pBlobEncoding.Detach();
   return S_OK;
 }
@@ -50,12 +102,12 @@ HRESULT TranslateUtf8StringForOutput(
 HRESULT TranslateWideStringForOutput(
     _In_opt_count_(size) LPCWSTR pStr, SIZE_T size, UINT32 codePage, IDxcBlobEncoding **ppBlobEncoding) {
   CComPtr<IDxcBlobEncoding> pBlobEncoding;
-  IFR(hlsl::DxcCreateBlobWithEncodingOnHeapCopy(pStr, size, DXC_CP_WIDE, &pBlobEncoding));
   if (codePage == DXC_CP_UTF8) {
-    CComPtr<IDxcBlobUtf8> pBlobUtf8;
-    IFT(hlsl::DxcGetBlobAsUtf8(pBlobEncoding, nullptr, &pBlobUtf8))
-      pBlobEncoding = pBlobUtf8;
+    // Convert straight from the caller's buffer.
+    IFR(hlsl::DxcCreateBlobWithEncodingFromPinned(pStr, size, DXC_CP_WIDE, &pBlobEncoding));
+    return TranslateBlobForOutput(pBlobEncoding, codePage, ppBlobEncoding);
   }
+  IFR(hlsl::DxcCreateBlobWithEncodingOnHeapCopy(pStr, size, DXC_CP_WIDE, &pBlobEncoding));
   *ppBlobEncoding = pBlobEncoding.Detach();
   return S_OK;
 }
@@ -67,11 +119,8 @@ HRESULT TranslateStringBlobForOutput(IDxcBlob *pBlob, UINT32 codePage, IDxcBlobE
   UINT32 inputCP;
   IFR(pEncoding->GetEncoding(&known, &inputCP));
   IFRBOOL(known, E_INVALIDARG);
-  if (inputCP == DXC_CP_UTF8) {
-    return TranslateUtf8StringForOutput((LPCSTR)pBlob->GetBufferPointer(), pBlob->GetBufferSize(), codePage, ppBlobEncoding);
-  } else if (inputCP == DXC_CP_WIDE) {
-    return TranslateWideStringForOutput((LPCWSTR)pBlob->GetBufferPointer(), pBlob->GetBufferSize(), codePage, ppBlobEncoding);
-  }
+  if (inputCP == DXC_CP_UTF8 || inputCP == DXC_CP_WIDE)
+    return TranslateBlobForOutput(pBlob, codePage, ppBlobEncoding);
   return E_INVALIDARG;
 }
 }
@@ -91,18 +140,23 @@ inline DxcOutputType DxcGetOutputType(DXC_OUT_KIND kind) {
   case DXC_OUT_SHADER_HASH:
   case DXC_OUT_REFLECTION:
   case DXC_OUT_ROOT_SIGNATURE:
+  case DXC_OUT_SPIRV:
     return DxcOutputType_Blob;
   case DXC_OUT_ERRORS:
   case DXC_OUT_DISASSEMBLY:
   case DXC_OUT_HLSL:
   case DXC_OUT_TEXT:
+  case DXC_OUT_TIME_TRACE:
+  case DXC_OUT_PASS_REPORT:
+  case DXC_OUT_MEMORY_REPORT:
+  case DXC_OUT_PERF_REPORT:
     return DxcOutputType_Text;
   }
   return DxcOutputType_None;
 }
 
 // Update when new results are allowed
-static const unsigned kNumDxcOutputTypes = DXC_OUT_EXTRA_OUTPUTS;
+static const unsigned kNumDxcOutputTypes = DXC_OUT_SPIRV;
 static const SIZE_T kAutoSize = (SIZE_T)-1;
 static const LPCWSTR DxcOutNoName = nullptr;
 
@@ -124,10 +178,12 @@ struct DxcOutputObject {
       IFR(pUnknown->QueryInterface(&pBlob));
       CComPtr<IDxcBlobEncoding> pEncoding;
       // If not blob encoding, assume utf-8 text
-      if (FAILED(TranslateStringBlobForOutput(pBlob, codePage, &pEncoding)))
-        IFR(TranslateUtf8StringForOutput(
-          (LPCSTR)pBlob->GetBufferPointer(), pBlob->GetBufferSize(),
-          codePage, &pEncoding));
+      if (FAILED(TranslateStringBlobForOutput(pBlob, codePage, &pEncoding))) {
+        CComPtr<IDxcBlobEncoding> pUtf8;
+        IFR(hlsl::DxcCreateBlobEncodingFromBlob(pBlob, 0, 0, true, DXC_CP_UTF8,
+                                                nullptr, &pUtf8));
+        IFR(TranslateBlobForOutput(pUtf8, codePage, &pEncoding));
+      }
       object = pEncoding;
     } else {
       object = pUnknown;
@@ -150,7 +206,7 @@ struct DxcOutputObject {
     if (size == kAutoSize)
       size = wcslen(pText);
     CComPtr<IDxcBlobEncoding> pBlobEncoding;
-    IFR(TranslateWideStringForOutput(pText, size, codePage, &pBlobEncoding));
+    IFR(TranslateWideStringForOutput(pText, size * sizeof(wchar_t), codePage, &pBlobEncoding));
     object = pBlobEncoding;
     return S_OK;
   }
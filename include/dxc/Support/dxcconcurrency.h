@@ -0,0 +1,26 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// dxcconcurrency.h                                                          //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Provides a helper that spreads independent work items over threads.      //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <functional>
+
+namespace hlsl {
+
+// Calls work(i) for every i below count, on up to one thread per hardware
+// thread. The calling thread is one of the workers; if a thread cannot be
+// started, the remaining work runs on the threads that did start. work must
+// not throw, and sets up any per-thread state, such as DxcThreadMalloc, for
+// itself.
+void RunConcurrently(unsigned count,
+                     const std::function<void(unsigned)> &work);
+
+} // namespace hlsl
@@ -13,6 +13,7 @@
 
 #include "dxc/dxcapi.h"
 #include "llvm/Support/MSFileSystem.h"
+#include <functional>
 #include <string>
 
 namespace clang {
@@ -39,9 +40,17 @@ public:
   virtual void GetStdOutpuHandleStream(IStream **ppResultStream) = 0;
   virtual void WriteStdErrToStream(llvm::raw_string_ostream &s) = 0;
   virtual void EnableDisplayIncludeProcess() = 0;
+  // Serves the source and every included file with everything other than
+  // preprocessor directives blanked out, keeping line numbers, so that only
+  // the directives need to be lexed when scanning dependencies.
+  virtual void EnableDirectivesOnly() = 0;
   virtual HRESULT CreateStdStreams(_In_ IMalloc *pMalloc) = 0;
   virtual HRESULT RegisterOutputStream(LPCWSTR pName, IStream *pStream) = 0;
   virtual HRESULT UnRegisterOutputStream() = 0;
+  // Visits every lookup made through the include handler, in order. pBlob is
+  // null for names the handler could not provide.
+  virtual void EnumerateIncludeLookups(
+      const std::function<void(LPCWSTR pName, IDxcBlobUtf8 *pBlob)> &Fn) = 0;
 };
 
 DxcArgsFileSystem *
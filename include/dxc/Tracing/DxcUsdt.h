@@ -0,0 +1,63 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// DxcUsdt.h                                                                 //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Provides the DxcEtw_ events on platforms without ETW, as USDT probes of   //
+// the dxcompiler provider when built with HLSL_ENABLE_USDT, and as nothing  //
+// otherwise.                                                                //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#ifdef DXC_ENABLE_USDT
+#include <sys/sdt.h>
+#define DXC_USDT_PROBE(name) DTRACE_PROBE(dxcompiler, name)
+#define DXC_USDT_PROBE1(name, a) DTRACE_PROBE1(dxcompiler, name, a)
+#define DXC_USDT_PROBE4(name, a, b, c, d)                                      \
+  DTRACE_PROBE4(dxcompiler, name, a, b, c, d)
+#else
+#define DXC_USDT_PROBE(name)
+#define DXC_USDT_PROBE1(name, a)
+#define DXC_USDT_PROBE4(name, a, b, c, d)
+#endif
+
+// The events of dxcetw.man. Stop events take the HRESULT of the operation.
+#define DxcEtw_DXCompilerInitialization_Start()                                \
+  DXC_USDT_PROBE(initialization_start)
+#define DxcEtw_DXCompilerInitialization_Stop(hr)                               \
+  DXC_USDT_PROBE1(initialization_stop, (int)(hr))
+#define DxcEtw_DXCompilerShutdown_Start() DXC_USDT_PROBE(shutdown_start)
+#define DxcEtw_DXCompilerShutdown_Stop(hr)                                     \
+  DXC_USDT_PROBE1(shutdown_stop, (int)(hr))
+#define DxcEtw_DXCompilerCreateInstance_Start()                                \
+  DXC_USDT_PROBE(create_instance_start)
+#define DxcEtw_DXCompilerCreateInstance_Stop(hr)                               \
+  DXC_USDT_PROBE1(create_instance_stop, (int)(hr))
+#define DxcEtw_DXCompilerCompile_Start() DXC_USDT_PROBE(compile_start)
+#define DxcEtw_DXCompilerCompile_Stop(hr)                                      \
+  DXC_USDT_PROBE1(compile_stop, (int)(hr))
+#define DxcEtw_DXCompilerDisassemble_Start() DXC_USDT_PROBE(disassemble_start)
+#define DxcEtw_DXCompilerDisassemble_Stop(hr)                                  \
+  DXC_USDT_PROBE1(disassemble_stop, (int)(hr))
+#define DxcEtw_DXCompilerPreprocess_Start() DXC_USDT_PROBE(preprocess_start)
+#define DxcEtw_DXCompilerPreprocess_Stop(hr)                                   \
+  DXC_USDT_PROBE1(preprocess_stop, (int)(hr))
+#define DxcEtw_DxcValidation_Start() DXC_USDT_PROBE(validation_start)
+#define DxcEtw_DxcValidation_Stop(hr)                                          \
+  DXC_USDT_PROBE1(validation_stop, (int)(hr))
+
+// The phases of a compile and the passes run in them: the ranges of the time
+// trace, e.g. "Parse", "CodeGen", "Per-module passes", "Validation" or
+// "Assemble container". Names and details are not NUL-terminated, so each is
+// passed as a pointer and a length; the detail is the function a pass ran on,
+// if any.
+#define DxcUsdt_RangeBegin(name, detail)                                       \
+  DXC_USDT_PROBE4(range_begin, (name).data(), (name).size(), (detail).data(),  \
+                  (detail).size())
+#define DxcUsdt_RangeEnd(name, detail)                                         \
+  DXC_USDT_PROBE4(range_end, (name).data(), (name).size(), (detail).data(),    \
+                  (detail).size())
@@ -363,6 +363,30 @@ public:
   ) = 0;
 };
 
+struct DxcLinkJob {
+  _Maybenull_ LPCWSTR pEntryName;               // Entry point name
+  LPCWSTR pTargetProfile;                       // Shader profile to link
+  _Maybenull_ const LPCWSTR *pArguments;        // Array of pointers to arguments
+  UINT32 ArgCount;                              // Number of arguments
+};
+
+CROSS_PLATFORM_UUIDOF(IDxcLinker2, "8b3a7c51-2f4e-4d6a-9c1b-6e0f5a2d7b94")
+struct IDxcLinker2 : public IDxcLinker {
+  // Links several entry points against the same libraries, as if by calling
+  // Link on each. Jobs run concurrently; each thread loads its own lazy copy
+  // of the registered libraries, so only functions that a job uses are
+  // materialized. ppResults receives one result per job, in job order.
+  virtual HRESULT STDMETHODCALLTYPE LinkBatch(
+    _In_count_(jobCount) const DxcLinkJob *pJobs, // Jobs to link
+    _In_ UINT32 jobCount,                         // Number of jobs
+    _In_count_(libCount)
+        const LPCWSTR *pLibNames,                 // Array of library names to link
+    _In_ UINT32 libCount,                         // Number of libraries to link
+    _Out_writes_(jobCount)
+        IDxcOperationResult **ppResults           // One result per job: status, buffer, and errors
+  ) = 0;
+};
+
 /////////////////////////
 // Latest interfaces. Please use these
 ////////////////////////
@@ -446,6 +470,57 @@ struct IDxcUtils : public IUnknown {
     _In_ IDxcBlob *pPDBBlob, _COM_Outptr_ IDxcBlob **ppHash, _COM_Outptr_ IDxcBlob **ppContainer) = 0;
 };
 
+// An include handler that loads each file once and shares it between every
+// compile it is passed to, on any compiler and any thread. Pass it as the
+// pIncludeHandler argument of Compile.
+CROSS_PLATFORM_UUIDOF(IDxcIncludeCache, "b8e3c6a4-5d27-4f31-9a0e-7c42d1f5e893")
+struct IDxcIncludeCache : public IDxcIncludeHandler {
+  // Same as LoadSource, but returns the contents as UTF-8. Contents with no
+  // known encoding are converted from codePage. Converted blobs are cached
+  // too, so compiles using the same code page share one copy per file.
+  virtual HRESULT STDMETHODCALLTYPE LoadSourceUtf8(
+    _In_z_ LPCWSTR pFilename,                                   // Candidate filename.
+    _In_ UINT32 codePage,                                       // Code page for contents with no known encoding.
+    _COM_Outptr_result_maybenull_ IDxcBlobUtf8 **ppIncludeSource // Resultant source object for included file, nullptr if not found.
+  ) = 0;
+
+  // Drop the cached result for pFilename, or every cached result if null, so
+  // that the next lookup loads it again.
+  virtual HRESULT STDMETHODCALLTYPE Invalidate(
+    _In_opt_z_ LPCWSTR pFilename) = 0;
+
+  // Number of lookups served from the cache and forwarded to the loader.
+  virtual HRESULT STDMETHODCALLTYPE GetCacheStatistics(
+    _Out_ UINT64 *pHits, _Out_ UINT64 *pMisses) = 0;
+};
+
+CROSS_PLATFORM_UUIDOF(IDxcUtils2, "0c4e2a5f-3b8d-4e71-a6c9-1f7d8b2e4a60")
+struct IDxcUtils2 : public IDxcUtils {
+  // Create an include cache. Files are loaded through pInner, or from disk if
+  // pInner is null. Files loaded from disk are keyed on their path plus their
+  // size and last write time, and are reloaded when either changes; results
+  // from pInner are kept until invalidated.
+  virtual HRESULT STDMETHODCALLTYPE CreateIncludeCache(
+    _In_opt_ IDxcIncludeHandler *pInner,
+    _COM_Outptr_ IDxcIncludeCache **ppResult) = 0;
+};
+
+CROSS_PLATFORM_UUIDOF(IDxcUtils3, "d2a7e415-6c3b-4f90-8e1d-5b94c0a7f263")
+struct IDxcUtils3 : public IDxcUtils2 {
+  // Share the objects returned by CreateReflection and
+  // IDxcContainerReflection::GetPartReflection across the process. Objects
+  // are keyed on the container's HASH part, or the MD5 of the reflected parts
+  // if there is none, and the requested interface, so reflecting the same
+  // shader again returns the same object; treat it as immutable. Up to
+  // maxEntries objects are kept, releasing the least recently used first.
+  // 0 disables the cache and releases every cached object.
+  virtual HRESULT STDMETHODCALLTYPE SetReflectionCacheSize(
+    UINT32 maxEntries) = 0;
+
+  // Release every cached reflection object, keeping the cache enabled.
+  virtual HRESULT STDMETHODCALLTYPE FlushReflectionCache() = 0;
+};
+
 // For use with IDxcResult::[Has|Get]Output dxcOutKind argument
 // Note: text outputs returned from version 2 APIs are UTF-8 or UTF-16 based on -encoding option
 typedef enum DXC_OUT_KIND {
@@ -460,6 +535,11 @@ typedef enum DXC_OUT_KIND {
   DXC_OUT_REFLECTION = 8,     // IDxcBlob - RDAT part with reflection data
   DXC_OUT_ROOT_SIGNATURE = 9, // IDxcBlob - Serialized root signature output
   DXC_OUT_EXTRA_OUTPUTS  = 10,// IDxcExtraResults - Extra outputs
+  DXC_OUT_TIME_TRACE = 11,    // IDxcBlobUtf8 or IDxcBlobWide - Chrome trace-event JSON of compile phase timings (-ftime-trace)
+  DXC_OUT_PASS_REPORT = 12,   // IDxcBlobUtf8 or IDxcBlobWide - JSON with time, instruction count change and peak memory per pass (-Qpass-report)
+  DXC_OUT_MEMORY_REPORT = 13, // IDxcBlobUtf8 or IDxcBlobWide - JSON with allocations and peak memory of the compile and each phase (-Qmemory-report)
+  DXC_OUT_PERF_REPORT = 14,   // IDxcBlobUtf8 or IDxcBlobWide - JSON with a static cost estimate of the DXIL per function (-Qperf-report)
+  DXC_OUT_SPIRV = 15,         // IDxcBlob - SPIR-V module compiled alongside the DXIL (-Fspv)
 
   DXC_OUT_FORCE_DWORD = 0xFFFFFFFF
 } DXC_OUT_KIND;
@@ -490,6 +570,9 @@ struct IDxcExtraOutputs : public IUnknown {
     _COM_Outptr_opt_result_maybenull_ IDxcBlobWide **ppOutputName) = 0;
 };
 
+// One compiler object can be used by several threads at once. Compiles use
+// the language extensions and container events handler registered when they
+// start; changing them does not affect compiles already running.
 CROSS_PLATFORM_UUIDOF(IDxcCompiler3, "228B4687-5A6A-4730-900C-9702B2203F54")
 struct IDxcCompiler3 : public IUnknown {
   // Compile a single entry point to the target shader model,
@@ -511,11 +594,248 @@ struct IDxcCompiler3 : public IUnknown {
     ) = 0;
 };
 
+struct DxcCompileJob {
+  const DxcBuffer *pSource;                     // Source text to compile
+  _Maybenull_ LPCWSTR *pArguments;              // Array of pointers to arguments
+  UINT32 ArgCount;                              // Number of arguments
+};
+
+CROSS_PLATFORM_UUIDOF(IDxcCompiler4, "5d1a1a33-0cc3-4b7b-8fd8-2b4a6c8e3f17")
+struct IDxcCompiler4 : public IDxcCompiler3 {
+  // Compile several sources, typically permutations of one shader, as if by
+  // calling Compile on each. Jobs run concurrently and every file loaded
+  // through pIncludeHandler is loaded once and shared by all jobs, so the
+  // handler must return the same contents for the same name. Jobs whose
+  // preprocessed source and code generation options match are compiled once,
+  // and each still gets its own output names. ppResults receives one result
+  // per job, in job order.
+  virtual HRESULT STDMETHODCALLTYPE CompileBatch(
+    _In_count_(jobCount) const DxcCompileJob *pJobs, // Jobs to compile
+    _In_ UINT32 jobCount,                         // Number of jobs
+    _In_opt_ IDxcIncludeHandler *pIncludeHandler, // user-provided interface to handle #include directives (optional)
+    _In_ REFIID riid,                             // IDxcResult or IDxcOperationResult
+    _Out_writes_(jobCount) LPVOID *ppResults      // One result per job: status, buffer, and errors
+  ) = 0;
+};
+
+// Compiler arguments parsed and validated once by
+// IDxcCompiler5::ParseArguments. Objects are immutable and can be used by
+// concurrent compiles.
+CROSS_PLATFORM_UUIDOF(IDxcParsedArguments, "e4a1c7d2-8b36-4f0e-9c5a-2d7f61b3e849")
+struct IDxcParsedArguments : public IUnknown {
+  // The arguments these were parsed from, including any variant defines.
+  virtual LPCWSTR* STDMETHODCALLTYPE GetArguments() = 0;
+  virtual UINT32 STDMETHODCALLTYPE GetCount() = 0;
+
+  // Create arguments that add pDefines to these, without parsing again.
+  // Variant defines are applied after the defines in the parsed arguments.
+  virtual HRESULT STDMETHODCALLTYPE CreateVariant(
+    _In_count_(defineCount) const DxcDefine *pDefines, // Array of defines to add
+    _In_ UINT32 defineCount,                           // Number of defines
+    _COM_Outptr_ IDxcParsedArguments **ppResult        // Variant arguments
+  ) = 0;
+};
+
+CROSS_PLATFORM_UUIDOF(IDxcCompiler5, "9a6f2c81-3e4d-4b7a-8f10-c5d2e7b94a36")
+struct IDxcCompiler5 : public IDxcCompiler4 {
+  // Parse and validate arguments once, for compiling many sources or
+  // permutations with CompileParsed. If the arguments are invalid or only ask
+  // for help, ppArgs is null and ppResult holds what Compile would have
+  // returned; otherwise ppResult is null.
+  virtual HRESULT STDMETHODCALLTYPE ParseArguments(
+    _In_opt_count_(argCount) LPCWSTR *pArguments, // Array of pointers to arguments
+    _In_ UINT32 argCount,                         // Number of arguments
+    _COM_Outptr_result_maybenull_ IDxcParsedArguments **ppArgs, // Parsed arguments
+    _COM_Outptr_result_maybenull_ IDxcResult **ppResult         // Errors or help output
+  ) = 0;
+
+  // Same as Compile, with arguments from ParseArguments on this compiler.
+  virtual HRESULT STDMETHODCALLTYPE CompileParsed(
+    _In_ const DxcBuffer *pSource,                // Source text to compile
+    _In_ IDxcParsedArguments *pArgs,              // Parsed arguments
+    _In_opt_ IDxcIncludeHandler *pIncludeHandler, // user-provided interface to handle #include directives (optional)
+    _In_ REFIID riid, _Out_ LPVOID *ppResult      // IDxcResult: status, buffer, and errors
+  ) = 0;
+
+  // Compile pSource once per define set, as if by CompileParsed on a variant
+  // of pArgs for each set. Set i is the next pDefineCounts[i] entries of
+  // pDefines. Every variant is preprocessed first, and variants whose
+  // preprocessed text is identical are compiled once and share one result
+  // object. Sharing is skipped when the output could still depend on macro
+  // definitions: with debug info, -rootsig-define, -binding-table-define or
+  // semantic defines. Files loaded through pIncludeHandler are loaded once
+  // for all variants.
+  virtual HRESULT STDMETHODCALLTYPE CompilePermutations(
+    _In_ const DxcBuffer *pSource,                // Source text to compile
+    _In_ IDxcParsedArguments *pArgs,              // Parsed arguments shared by all permutations
+    _In_opt_count_(permutationCount) const UINT32 *pDefineCounts, // Number of defines in each set
+    _In_opt_ const DxcDefine *pDefines,           // All define sets, one after the other
+    _In_ UINT32 permutationCount,                 // Number of define sets
+    _In_opt_ IDxcIncludeHandler *pIncludeHandler, // user-provided interface to handle #include directives (optional)
+    _In_ REFIID riid,                             // IDxcResult or IDxcOperationResult
+    _Out_writes_(permutationCount) LPVOID *ppResults // One result per define set
+  ) = 0;
+};
+
+CROSS_PLATFORM_UUIDOF(IDxcCompiler6, "6e3b9d27-c4a1-4f58-92d6-0a8e5b7f13c9")
+struct IDxcCompiler6 : public IDxcCompiler5 {
+  // Disassemble a program as Disassemble does, writing the text to pOutput
+  // as it is produced instead of returning it in one blob. If pFunctionNames
+  // is provided, only the container parts and the named functions are
+  // printed, and only those function bodies are read from the program.
+  virtual HRESULT STDMETHODCALLTYPE DisassembleToStream(
+    _In_ const DxcBuffer *pObject,                // Program to disassemble: dxil container or bitcode.
+    _In_opt_count_(functionCount) LPCWSTR *pFunctionNames, // Functions to print (optional)
+    _In_ UINT32 functionCount,                    // Number of function names
+    _In_ IStream *pOutput                         // Receives the UTF-8 disassembly text
+  ) = 0;
+};
+
+struct DxcCompileEntry {
+  LPCWSTR pEntryPoint;                          // Entry point name, as for -E
+  LPCWSTR pTargetProfile;                       // Shader profile, as for -T
+};
+
+CROSS_PLATFORM_UUIDOF(IDxcCompiler7, "78046560-90ec-4d76-b684-a22dcd5b22f4")
+struct IDxcCompiler7 : public IDxcCompiler6 {
+  // Compile pSource once per entry, as if by calling Compile with pArguments
+  // followed by -E and -T for that entry. Entries are compiled concurrently
+  // and every file loaded through pIncludeHandler is loaded once for all of
+  // them. ppResults receives one result per entry, in entry order.
+  virtual HRESULT STDMETHODCALLTYPE CompileEntries(
+    _In_ const DxcBuffer *pSource,                // Source text to compile
+    _In_opt_count_(argCount) LPCWSTR *pArguments, // Arguments shared by all entries
+    _In_ UINT32 argCount,                         // Number of arguments
+    _In_count_(entryCount) const DxcCompileEntry *pEntries, // Entries to compile
+    _In_ UINT32 entryCount,                       // Number of entries
+    _In_opt_ IDxcIncludeHandler *pIncludeHandler, // user-provided interface to handle #include directives (optional)
+    _In_ REFIID riid,                             // IDxcResult or IDxcOperationResult
+    _Out_writes_(entryCount) LPVOID *ppResults    // One result per entry: status, buffer, and errors
+  ) = 0;
+};
+
+CROSS_PLATFORM_UUIDOF(IDxcCompiler8, "c3f1a6d2-4b7e-4c95-8e20-d95b3a7f6c18")
+struct IDxcCompiler8 : public IDxcCompiler7 {
+  // Describe a compile as a job that CompileJob can run on any machine with
+  // the same compiler and validator, without an include handler. The job
+  // holds the normalized arguments, the compiler fingerprint, the source and
+  // every file looked up through pIncludeHandler, each stored once under the
+  // MD5 of its contents; failed lookups are recorded too. Identical compiles
+  // produce identical jobs, so a hash of the job identifies its result. If
+  // the arguments are invalid or the compile cannot be captured, ppJob is
+  // null and ppResult holds the errors; otherwise ppResult is null.
+  virtual HRESULT STDMETHODCALLTYPE CreateCompileJob(
+    _In_ const DxcBuffer *pSource,                // Source text to compile
+    _In_opt_count_(argCount) LPCWSTR *pArguments, // Array of pointers to arguments
+    _In_ UINT32 argCount,                         // Number of arguments
+    _In_opt_ IDxcIncludeHandler *pIncludeHandler, // user-provided interface to handle #include directives (optional)
+    _COM_Outptr_result_maybenull_ IDxcBlob **ppJob,     // Serialized job
+    _COM_Outptr_result_maybenull_ IDxcResult **ppResult // Errors
+  ) = 0;
+
+  // Compile a job from CreateCompileJob as Compile would have compiled the
+  // original request, loading includes only from the job. Fails with an
+  // error result if the job was made by a different compiler or validator.
+  virtual HRESULT STDMETHODCALLTYPE CompileJob(
+    _In_ const DxcBuffer *pJob,                   // Serialized job
+    _In_ REFIID riid, _Out_ LPVOID *ppResult      // IDxcResult: status, buffer, and errors
+  ) = 0;
+};
+
+CROSS_PLATFORM_UUIDOF(IDxcCompiler9, "4f8d2b6e-91c3-4a57-b0e2-6d3c8a1f75e4")
+struct IDxcCompiler9 : public IDxcCompiler8 {
+  // Run the front end and high-level code generation once, as with -fcgl,
+  // and capture the result with the normalized arguments so that
+  // ResumeSnapshot can finish it. ppResult receives the front end's status
+  // and messages; ppSnapshot is null if it failed. Preprocessing, dumps,
+  // root signature targets, SPIR-V, debug information and
+  // -binding-table-define cannot be captured.
+  virtual HRESULT STDMETHODCALLTYPE CreateSnapshot(
+    _In_ const DxcBuffer *pSource,                // Source text to compile
+    _In_opt_count_(argCount) LPCWSTR *pArguments, // Array of pointers to arguments
+    _In_ UINT32 argCount,                         // Number of arguments
+    _In_opt_ IDxcIncludeHandler *pIncludeHandler, // user-provided interface to handle #include directives (optional)
+    _COM_Outptr_result_maybenull_ IDxcBlob **ppSnapshot, // Serialized snapshot
+    _COM_Outptr_ IDxcResult **ppResult            // Front end status and messages
+  ) = 0;
+
+  // Finish a snapshot from CreateSnapshot on a compiler with the same
+  // version and configuration, as Compile would with the snapshot's
+  // arguments followed by pArguments. Only the remaining pipeline runs, so
+  // pArguments may change code generation (-O, -specialize-cbuffer, -opt-*,
+  // validation and output options) but not the front end: -D, -I or -HV
+  // have no effect. pIncludeHandler serves files the remaining pipeline
+  // loads, such as -setrootsignature.
+  virtual HRESULT STDMETHODCALLTYPE ResumeSnapshot(
+    _In_ const DxcBuffer *pSnapshot,              // Serialized snapshot
+    _In_opt_count_(argCount) LPCWSTR *pArguments, // Arguments for this variant
+    _In_ UINT32 argCount,                         // Number of arguments
+    _In_opt_ IDxcIncludeHandler *pIncludeHandler, // user-provided interface to load files (optional)
+    _In_ REFIID riid, _Out_ LPVOID *ppResult      // IDxcResult: status, buffer, and errors
+  ) = 0;
+};
+
+CROSS_PLATFORM_UUIDOF(IDxcCompilerCache, "1cad97a9-60a8-419b-8394-8d5b1d7da98e")
+struct IDxcCompilerCache : public IUnknown {
+  // Enable caching of Compile() results on this compiler. Results are keyed
+  // on the arguments, the source, every buffer returned by the include
+  // handler and the compiler/validator versions. If pDirectory is provided,
+  // results are also persisted there and reused across processes.
+  virtual HRESULT STDMETHODCALLTYPE EnableCache(
+    _In_opt_z_ LPCWSTR pDirectory             // Existing directory for persisted results (optional)
+  ) = 0;
+
+  // Disable caching, release in-memory results and reset the counters.
+  virtual HRESULT STDMETHODCALLTYPE DisableCache() = 0;
+
+  // Number of cache hits and misses since caching was enabled.
+  virtual HRESULT STDMETHODCALLTYPE GetCacheStatistics(
+    _Out_ UINT64 *pHits, _Out_ UINT64 *pMisses) = 0;
+};
+
+CROSS_PLATFORM_UUIDOF(IDxcContextPool, "85b49a46-0650-4bda-aa75-c88d2840d09f")
+struct IDxcContextPool : public IUnknown {
+  // Reuse the LLVM context of finished compiles on this compiler for later
+  // compiles instead of building a new one for each. Outputs are unchanged.
+  // A context holding more than maxRetainedObjects uniqued types, constants
+  // and metadata after a compile is released; 0 selects the default limit.
+  virtual HRESULT STDMETHODCALLTYPE EnableContextPool(
+    _In_ UINT32 maxRetainedObjects) = 0;
+
+  // Stop reusing contexts and release the pooled ones.
+  virtual HRESULT STDMETHODCALLTYPE DisableContextPool() = 0;
+};
+
+// Size classes reported by IDxcMallocStatistics. Class i holds allocations of
+// up to 16 << i bytes; the last class holds everything larger than 4096.
+static const UINT32 DxcMallocSizeClassCount = 10;
+
+typedef struct DxcMallocStatistics {
+  UINT64 AllocationCount;     // Allocations made, including moving reallocs.
+  UINT64 FreeCount;           // Allocations released.
+  UINT64 BytesInUse;          // Requested bytes of live allocations.
+  UINT64 BytesReserved;       // Bytes currently held from the system allocator.
+  UINT64 PeakBytesReserved;   // High-water mark of BytesReserved.
+  UINT64 SizeClassAllocationCount[DxcMallocSizeClassCount];
+  UINT64 SizeClassBytesInUse[DxcMallocSizeClassCount];
+} DxcMallocStatistics;
+
+// Implemented by the IMalloc created with CLSID_DxcPooledMalloc. Pass that
+// IMalloc to DxcCreateInstance2 to have the created objects allocate from it.
+CROSS_PLATFORM_UUIDOF(IDxcMallocStatistics, "9e3a1c57-6b2d-4f08-a4c1-2d7e5b8f9a36")
+struct IDxcMallocStatistics : public IUnknown {
+  virtual HRESULT STDMETHODCALLTYPE GetStatistics(
+    _Out_ DxcMallocStatistics *pStats) = 0;
+};
+
 static const UINT32 DxcValidatorFlags_Default = 0;
 static const UINT32 DxcValidatorFlags_InPlaceEdit = 1;  // Validator is allowed to update shader blob in-place.
 static const UINT32 DxcValidatorFlags_RootSignatureOnly = 2;
 static const UINT32 DxcValidatorFlags_ModuleOnly = 4;
-static const UINT32 DxcValidatorFlags_ValidMask = 0x7;
+// Validator may reuse the result of validating the same DXIL part earlier in
+// the process, and only check the container parts that changed since.
+static const UINT32 DxcValidatorFlags_AllowCachedResult = 8;
+static const UINT32 DxcValidatorFlags_ValidMask = 0xf;
 
 CROSS_PLATFORM_UUIDOF(IDxcValidator, "A6E82BD2-1FD7-4826-9811-2857E797F49A")
 struct IDxcValidator : public IUnknown {
@@ -538,6 +858,22 @@ struct IDxcValidator2 : public IDxcValidator {
     ) = 0;
 };
 
+CROSS_PLATFORM_UUIDOF(IDxcValidator3, "5d2e8b14-7c3a-4f69-b0d5-1e9a6c4f2b83")
+struct IDxcValidator3 : public IDxcValidator2 {
+  // Validates several shaders with the same flags, as if by calling Validate
+  // on each. Shaders are validated concurrently, each on its own LLVMContext.
+  // ppResults receives one result per shader, in shader order. With
+  // DxcValidatorFlags_InPlaceEdit, each blob is signed in place, so a blob
+  // must not appear twice in ppShaders.
+  virtual HRESULT STDMETHODCALLTYPE ValidateBatch(
+    _In_count_(shaderCount) IDxcBlob *const *ppShaders, // Shaders to validate.
+    _In_ UINT32 shaderCount,                      // Number of shaders.
+    _In_ UINT32 Flags,                            // Validation flags.
+    _Out_writes_(shaderCount)
+        IDxcOperationResult **ppResults           // One result per shader: status, buffer, and errors
+    ) = 0;
+};
+
 CROSS_PLATFORM_UUIDOF(IDxcContainerBuilder, "334b1f50-2292-4b35-99a1-25588d8c17fe")
 struct IDxcContainerBuilder : public IUnknown {
   virtual HRESULT STDMETHODCALLTYPE Load(_In_ IDxcBlob *pDxilContainerHeader) = 0;                // Loads DxilContainer to the builder
@@ -546,6 +882,25 @@ struct IDxcContainerBuilder : public IUnknown {
   virtual HRESULT STDMETHODCALLTYPE SerializeContainer(_Out_ IDxcOperationResult **ppResult) = 0; // Builds a container of the given container builder state
 };
 
+CROSS_PLATFORM_UUIDOF(IDxcContainerBuilder2, "a1c6e2d4-5b37-4f0e-9d83-6e4f2b7c15a9")
+struct IDxcContainerBuilder2 : public IDxcContainerBuilder {
+  // Computes a delta that rebuilds pTarget from pBase. Parts of pTarget that
+  // are identical to a part of pBase are referenced, all others are stored.
+  virtual HRESULT STDMETHODCALLTYPE CreateDelta(
+    _In_ IDxcBlob *pBase,                         // Container the delta applies to.
+    _In_ IDxcBlob *pTarget,                       // Container the delta rebuilds.
+    _COM_Outptr_ IDxcBlob **ppDelta               // Delta.
+    ) = 0;
+  // Rebuilds the target container of a delta from CreateDelta, byte for byte.
+  // Fails with E_INVALIDARG if pBase is not the container the delta was
+  // computed against.
+  virtual HRESULT STDMETHODCALLTYPE ApplyDelta(
+    _In_ IDxcBlob *pBase,                         // Container the delta applies to.
+    _In_ IDxcBlob *pDelta,                        // Delta from CreateDelta.
+    _COM_Outptr_ IDxcBlob **ppTarget              // Rebuilt container.
+    ) = 0;
+};
+
 CROSS_PLATFORM_UUIDOF(IDxcAssembler, "091f7a26-1c1f-4948-904b-e6e3a8a771d5")
 struct IDxcAssembler : public IUnknown {
   // Assemble dxil in ll or llvm bitcode to DXIL container.
@@ -555,6 +910,19 @@ struct IDxcAssembler : public IUnknown {
     ) = 0;
 };
 
+CROSS_PLATFORM_UUIDOF(IDxcAssembler2, "3c7e9a51-d482-4f0b-a6c3-58e1b2d7f904")
+struct IDxcAssembler2 : public IDxcAssembler {
+  // Assembles several shaders, as if by calling AssembleToContainer on each.
+  // Shaders are assembled concurrently, each on its own LLVMContext.
+  // ppResults receives one result per shader, in shader order.
+  virtual HRESULT STDMETHODCALLTYPE AssembleToContainerBatch(
+    _In_count_(shaderCount) IDxcBlob *const *ppShaders, // Shaders to assemble.
+    _In_ UINT32 shaderCount,                      // Number of shaders.
+    _Out_writes_(shaderCount)
+        IDxcOperationResult **ppResults           // One result per shader: status, buffer, and errors
+    ) = 0;
+};
+
 CROSS_PLATFORM_UUIDOF(IDxcContainerReflection, "d2c21b26-8350-4bdc-976a-331ce6f4c54c")
 struct IDxcContainerReflection : public IUnknown {
   virtual HRESULT STDMETHODCALLTYPE Load(_In_ IDxcBlob *pContainer) = 0; // Container to load.
@@ -584,6 +952,51 @@ struct IDxcOptimizer : public IUnknown {
     _COM_Outptr_opt_ IDxcBlobEncoding **ppOutputText) = 0;
 };
 
+// A module parsed once by IDxcOptimizer2::CreateSession, for running several
+// pass pipelines over the same input. Each RunOptimizer works on a copy of
+// the module, so runs do not affect one another. Leading annotation passes
+// (-dxil-dbg-value-to-dbg-declare, -dxil-annotate-with-virtual-regs) are run
+// once per distinct sequence, and their module and text output are reused by
+// later runs that start the same way. Not safe for concurrent use.
+CROSS_PLATFORM_UUIDOF(IDxcOptimizerSession, "3f0a2b6c-63a1-4b8e-9d5c-8c1e7a40d2f5")
+struct IDxcOptimizerSession : public IUnknown {
+  // Same options and outputs as IDxcOptimizer::RunOptimizer.
+  virtual HRESULT STDMETHODCALLTYPE RunOptimizer(
+    _In_count_(optionCount) LPCWSTR *ppOptions, UINT32 optionCount,
+    _COM_Outptr_ IDxcBlob **pOutputModule,
+    _COM_Outptr_opt_ IDxcBlobEncoding **ppOutputText) = 0;
+};
+
+CROSS_PLATFORM_UUIDOF(IDxcOptimizer2, "b7d5a0e2-4c3f-4f86-a1d9-6e2f8b9c0a14")
+struct IDxcOptimizer2 : public IDxcOptimizer {
+  // Parses pBlob, which RunOptimizer would accept, into a reusable session.
+  virtual HRESULT STDMETHODCALLTYPE CreateSession(
+    _In_ IDxcBlob *pBlob,
+    _COM_Outptr_ IDxcOptimizerSession **ppSession) = 0;
+};
+
+// A pass pipeline parsed once by IDxcOptimizer3::CreatePipeline, for running
+// the same passes over many modules. Each RunOptimizer parses its input into
+// its own context, so the pipeline can be used by concurrent threads.
+CROSS_PLATFORM_UUIDOF(IDxcOptimizerPipeline, "8c2e4f61-0b7d-4a39-b5e2-71d3a9f6c084")
+struct IDxcOptimizerPipeline : public IUnknown {
+  // Same input and outputs as IDxcOptimizer::RunOptimizer.
+  virtual HRESULT STDMETHODCALLTYPE RunOptimizer(
+    _In_ IDxcBlob *pBlob,
+    _COM_Outptr_ IDxcBlob **pOutputModule,
+    _COM_Outptr_opt_ IDxcBlobEncoding **ppOutputText) = 0;
+};
+
+CROSS_PLATFORM_UUIDOF(IDxcOptimizer3, "d4f7b1a8-2e95-4c60-8a3b-f06c5e2d9b71")
+struct IDxcOptimizer3 : public IDxcOptimizer2 {
+  // Parses ppOptions, which RunOptimizer would accept, into a reusable
+  // pipeline. Fails with E_INVALIDARG if an option names an unknown pass or
+  // is malformed.
+  virtual HRESULT STDMETHODCALLTYPE CreatePipeline(
+    _In_count_(optionCount) LPCWSTR *ppOptions, UINT32 optionCount,
+    _COM_Outptr_ IDxcOptimizerPipeline **ppPipeline) = 0;
+};
+
 static const UINT32 DxcVersionInfoFlags_None = 0;
 static const UINT32 DxcVersionInfoFlags_Debug = 1; // Matches VS_FF_DEBUG
 static const UINT32 DxcVersionInfoFlags_Internal = 2; // Internal Validator (non-signing)
@@ -652,6 +1065,36 @@ struct IDxcPdbUtils : public IUnknown {
   virtual HRESULT STDMETHODCALLTYPE OverrideRootSignature(_In_ const WCHAR *pRootSignature) = 0;
 };
 
+// Store for full PDBs rebuilt by IDxcPdbUtils2::GetFullPDB. Keys are opaque
+// blobs made of the shader hash and the compiler versions involved. When used
+// with GetFullPDBBatch, methods are called from several threads at once.
+CROSS_PLATFORM_UUIDOF(IDxcPdbCache, "726a6797-68a6-4526-99a7-0be3cdf20423")
+struct IDxcPdbCache : public IUnknown {
+  // Returns S_OK and the stored full PDB, or S_FALSE and null if none.
+  virtual HRESULT STDMETHODCALLTYPE Lookup(
+    _In_ IDxcBlob *pKey,
+    _COM_Outptr_result_maybenull_ IDxcBlob **ppFullPDB) = 0;
+  virtual HRESULT STDMETHODCALLTYPE Store(
+    _In_ IDxcBlob *pKey, _In_ IDxcBlob *pFullPDB) = 0;
+};
+
+CROSS_PLATFORM_UUIDOF(IDxcPdbUtils2, "29c35934-2014-4505-8da6-88cdb2c94781")
+struct IDxcPdbUtils2 : public IDxcPdbUtils {
+  // Consult pCache (optional) in GetFullPDB before recompiling a slim PDB,
+  // and store PDBs it rebuilds there. Not used after OverrideArgs or
+  // OverrideRootSignature, since those change the recompiled output.
+  virtual HRESULT STDMETHODCALLTYPE SetFullPDBCache(
+    _In_opt_ IDxcPdbCache *pCache) = 0;
+
+  // Returns GetFullPDB for each of ppPDBs, rebuilding them concurrently with
+  // the compiler and cache set on this object. Does not change what is
+  // loaded in this object. If any fails, no results are returned.
+  virtual HRESULT STDMETHODCALLTYPE GetFullPDBBatch(
+    _In_count_(count) IDxcBlob *const *ppPDBs,
+    _In_ UINT32 count,
+    _Out_writes_(count) IDxcBlob **ppFullPDBs) = 0;
+};
+
 // Note: __declspec(selectany) requires 'extern'
 // On Linux __declspec(selectany) is removed and using 'extern' results in link error.
 #ifdef _MSC_VER
@@ -738,4 +1181,11 @@ CLSID_SCOPE const GUID CLSID_DxcPdbUtils = {
     0x457e,
     {0xae, 0x8c, 0xec, 0x35, 0x5f, 0xae, 0xec, 0x7c}};
 
+// {4b7e2d19-83c6-4a5f-b1e0-6f29c8d3a574}
+CLSID_SCOPE const GUID CLSID_DxcPooledMalloc = {
+    0x4b7e2d19,
+    0x83c6,
+    0x4a5f,
+    {0xb1, 0xe0, 0x6f, 0x29, 0xc8, 0xd3, 0xa5, 0x74}};
+
 #endif
@@ -131,6 +131,22 @@ struct HLSL_INTRINSIC {
   const HLSL_INTRINSIC_ARGUMENT* pArgs; // Pointer to first argument.
 };
 
+// Run of entries in a generated intrinsic table that share a name.
+struct HLSL_INTRINSIC_NAME_RANGE {
+  WORD uStart;                          // Index of the first entry with the name.
+  WORD uCount;                          // Count of entries with the name, 0 for an empty slot.
+};
+
+// Perfect hash from intrinsic name to a name range, generated by hctgen
+// for the global intrinsic tables. A name hashes with seed 0 to pick one of
+// the seeds, then with that seed to pick its slot.
+struct HLSL_INTRINSIC_NAME_INDEX {
+  const WORD *pSeeds;                   // Per-bucket hash seeds.
+  UINT uSeedCount;                      // Count of seeds, a power of two.
+  const HLSL_INTRINSIC_NAME_RANGE *pSlots; // Name ranges by hash slot.
+  UINT uSlotCount;                      // Count of slots, a power of two.
+};
+
 ///////////////////////////////////////////////////////////////////////////////
 // Interfaces.
 CROSS_PLATFORM_UUIDOF(IDxcIntrinsicTable, "f0d4da3f-f863-4660-b8b4-dfd94ded6215")
@@ -94,6 +94,13 @@ struct __declspec(uuid("76bb3c85-006d-4b72-9e10-63cd97df57f0"))
       UINT32 stackSizeInBytes,                                // Continuation stack size. Use 0 for default.
       _COM_Outptr_ IDxcOperationResult **ppResult             // Compiler output status, buffer, and errors
   ) = 0;
+
+  // If set to true then each iteration of the state machine in the linked 
+  // shader runs only the lanes at the most common next state in the wave, 
+  // which keeps lanes running the same state function together. Otherwise 
+  // every lane runs its own next state function and divergent lanes are 
+  // serialized by the dispatch switch. Off by default.
+  virtual HRESULT STDMETHODCALLTYPE SetCoherentDispatch(bool val) = 0;
 };
 
 // Note: __declspec(selectany) requires 'extern'
@@ -702,6 +702,20 @@ struct IDxcIntelliSense : public IUnknown
   virtual HRESULT STDMETHODCALLTYPE CreateUnsavedFile(_In_ LPCSTR fileName, _In_ LPCSTR contents, unsigned contentLength, _Outptr_result_nullonfailure_ IDxcUnsavedFile** pResult) = 0;
 };
 
+CROSS_PLATFORM_UUIDOF(IDxcIntelliSense2, "f8584c48-5e5e-4527-bfe5-a081dfda7444")
+struct IDxcIntelliSense2 : public IDxcIntelliSense
+{
+  // Reparses a translation unit after an edit, skipping the function bodies
+  // of included files whose contents did not change since the last parse;
+  // declarations from those files remain available, while the main file
+  // is parsed in full. Diagnostics inside the skipped bodies are kept from
+  // the last parse.
+  virtual HRESULT STDMETHODCALLTYPE ReparseTranslationUnit(
+    _In_ IDxcTranslationUnit* pTranslationUnit,
+    _In_count_(numUnsavedFiles) IDxcUnsavedFile** pUnsavedFiles,
+    unsigned numUnsavedFiles) = 0;
+};
+
 CROSS_PLATFORM_UUIDOF(IDxcIndex, "937824a0-7f5a-4815-9ba7-7fc0424f4173")
 struct IDxcIndex : public IUnknown
 {
@@ -828,6 +842,49 @@ struct IDxcCompletionString : public IUnknown
   virtual HRESULT STDMETHODCALLTYPE GetCompletionChunkText(unsigned chunkNumber, _Out_ LPSTR* pResult) = 0;
 };
 
+// Receives the results of asynchronous translation unit requests. Methods are
+// called on the translation unit's worker thread.
+CROSS_PLATFORM_UUIDOF(IDxcTranslationUnitCallback, "0d71ff68-1115-42b9-9e53-25e4218f7180")
+struct IDxcTranslationUnitCallback : public IUnknown
+{
+  // Called when a reparse has finished; its diagnostics are available from
+  // the translation unit. status is E_ABORT if a newer edit or a call to
+  // CancelAsync superseded the request.
+  virtual HRESULT STDMETHODCALLTYPE OnReparsed(HRESULT status) = 0;
+  // Called when a code completion has finished. pResults is null unless
+  // status succeeded; status is E_ABORT if a newer edit or a call to
+  // CancelAsync superseded the request.
+  virtual HRESULT STDMETHODCALLTYPE OnCodeCompleted(
+    HRESULT status, _In_opt_ IDxcCodeCompleteResults* pResults) = 0;
+};
+
+// Runs reparses and code completions on a worker thread owned by the
+// translation unit, in the order they are requested. A reparse supersedes
+// every request made before it that has not delivered its results yet. The
+// synchronous methods must not be called while requests are pending; call
+// WaitForAsync first. The last reference to the translation unit must not be
+// released from within a callback.
+CROSS_PLATFORM_UUIDOF(IDxcTranslationUnit2, "f812cf93-b83e-4dd3-94e4-3c26ba3507ba")
+struct IDxcTranslationUnit2 : public IDxcTranslationUnit
+{
+  // Queues a reparse with the given unsaved files. If skipIncludedBodies is
+  // set, the reparse is done as by IDxcIntelliSense2::ReparseTranslationUnit.
+  virtual HRESULT STDMETHODCALLTYPE ReparseAsync(
+    _In_count_(numUnsavedFiles) IDxcUnsavedFile** pUnsavedFiles,
+    unsigned numUnsavedFiles, BOOL skipIncludedBodies,
+    _In_ IDxcTranslationUnitCallback* pCallback) = 0;
+  // Queues a code completion, as by CodeCompleteAt.
+  virtual HRESULT STDMETHODCALLTYPE CodeCompleteAtAsync(
+    _In_ const char *fileName, unsigned line, unsigned column,
+    _In_count_(numUnsavedFiles) IDxcUnsavedFile** pUnsavedFiles,
+    unsigned numUnsavedFiles, DxcCodeCompleteFlags options,
+    _In_ IDxcTranslationUnitCallback* pCallback) = 0;
+  // Supersedes every pending request; their callbacks receive E_ABORT.
+  virtual HRESULT STDMETHODCALLTYPE CancelAsync() = 0;
+  // Blocks until every pending request has delivered its results.
+  virtual HRESULT STDMETHODCALLTYPE WaitForAsync() = 0;
+};
+
 // Fun fact: 'extern' is required because const is by default static in C++, so
 // CLSID_DxcIntelliSense is not visible externally (this is OK in C, since const is
 // not by default static in C)
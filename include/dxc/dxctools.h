@@ -76,4 +76,20 @@ struct IDxcRewriter2 : public IDxcRewriter {
                                                      _COM_Outptr_ IDxcOperationResult **ppResult) = 0;
 };
 
+CROSS_PLATFORM_UUIDOF(IDxcRewriter3, "8f3b6c2e-41d7-4a95-b1e0-7c5d29a4e6f3")
+struct IDxcRewriter3 : public IDxcRewriter2 {
+  // Removes unused globals for each entry point, as if by calling
+  // RemoveUnusedGlobals once per entry point, but parses pSource only once.
+  // The rewriter also keeps its most recent parse, so a later call with the
+  // same source and defines does not parse again. Files included from
+  // pSource are not checked for changes when the parse is reused.
+  virtual HRESULT STDMETHODCALLTYPE RemoveUnusedGlobalsBatch(_In_ IDxcBlobEncoding *pSource,
+                                                             _In_count_(entryPointCount) LPCWSTR *pEntryPoints,
+                                                             _In_ UINT32 entryPointCount,
+                                                             _In_count_(defineCount) DxcDefine *pDefines,
+                                                             _In_ UINT32 defineCount,
+                                                             // One result per entry point
+                                                             _Out_writes_(entryPointCount) IDxcOperationResult **ppResults) = 0;
+};
+
 #endif
@@ -11,6 +11,7 @@
 #define LLVM_ANALYSIS_DXILVALUECACHE_H
 
 #include "llvm/Pass.h"
+#include "llvm/ADT/ArrayRef.h"
 #include "llvm/IR/ValueMap.h"
 
 namespace llvm {
@@ -43,6 +44,7 @@ struct DxilValueCache : public ImmutablePass {
     bool Seen(Value *v);
     void SetSentinel(Value *V);
     void ResetUnknowns();
+    void ResetUnknowns(ArrayRef<Value *> Changed);
     void ResetAll();
     void dump() const;
   private:
@@ -79,6 +81,10 @@ public:
   Constant *GetConstValue(Value *V, DominatorTree *DT = nullptr);
   ConstantInt *GetConstInt(Value *V, DominatorTree *DT = nullptr);
   void ResetUnknowns() { ValueMap.ResetUnknowns(); }
+  // Only reset the unknown values that may depend on the values in Changed,
+  // through their operands or the reachability of their blocks. Known values
+  // and the unknowns elsewhere in the function are kept.
+  void ResetUnknowns(ArrayRef<Value *> Changed) { ValueMap.ResetUnknowns(Changed); }
   void ResetAll() { ValueMap.ResetAll(); }
   bool IsAlwaysReachable(BasicBlock *BB, DominatorTree *DT=nullptr);
   bool IsUnreachable(BasicBlock *BB, DominatorTree *DT=nullptr);
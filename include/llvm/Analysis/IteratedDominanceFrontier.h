@@ -84,10 +84,28 @@ public:
   /// would be dead.
   void calculate(SmallVectorImpl<BasicBlock *> &IDFBlocks);
 
+  // HLSL Change Begin
+  /// \brief Compute the dominance frontier of every block, for use by every
+  /// later call to calculate().
+  ///
+  /// The linear-time algorithm walks every block dominated by a defining
+  /// block, so each value defined near the entry of a large function costs a
+  /// walk of the whole function. With the frontiers computed once, each value
+  /// only costs the frontiers it reaches. Use this when calculating the IDF of
+  /// many values over the same dominator tree, which must not change until
+  /// the calculator is destroyed.
+  void computeFrontiers();
+  // HLSL Change End
+
 private:
   DominatorTree &DT;
   bool useLiveIn;
   DenseMap<DomTreeNode *, unsigned> DomLevels;
+  // HLSL Change Begin
+  bool useFrontiers = false;
+  DenseMap<DomTreeNode *, SmallVector<DomTreeNode *, 2>> Frontiers;
+  void calculateFromFrontiers(SmallVectorImpl<BasicBlock *> &IDFBlocks);
+  // HLSL Change End
   const SmallPtrSetImpl<BasicBlock *> *LiveInBlocks;
   const SmallPtrSetImpl<BasicBlock *> *DefBlocks;
   SmallVector<BasicBlock *, 32> PHIBlocks;
@@ -31,14 +31,16 @@ namespace llvm {
 
   /// Read the header of the specified bitcode buffer and prepare for lazy
   /// deserialization of function bodies. If ShouldLazyLoadMetadata is true,
-  /// lazily load metadata as well. If successful, this moves Buffer. On
-  /// error, this *does not* move Buffer.
+  /// lazily load metadata as well. If ShouldSkipDebugInfo is true, debug info
+  /// nodes, locations and intrinsics are dropped while reading (HLSL Change).
+  /// If successful, this moves Buffer. On error, this *does not* move Buffer.
   ErrorOr<std::unique_ptr<Module>>
   getLazyBitcodeModule(std::unique_ptr<MemoryBuffer> &&Buffer,
                        LLVMContext &Context,
                        DiagnosticHandlerFunction DiagnosticHandler = nullptr,
                        bool ShouldLazyLoadMetadata = false,
-                       bool ShouldTrackBitstreamUsage = false);
+                       bool ShouldTrackBitstreamUsage = false,
+                       bool ShouldSkipDebugInfo = false); // HLSL Change
 
   /// Read the header of the specified stream and prepare for lazy
   /// deserialization and streaming of function bodies.
@@ -69,6 +69,7 @@ private:
   std::unique_ptr<ValueSymbolTable> SymTab; ///< Symbol table of args/instructions // HLSL Change: use unique_ptr
   AttributeSet AttributeSets;             ///< Parameter attributes
   FunctionType *Ty;
+  unsigned DxilOpClassTag = 0;            ///< HLSL Change: see hlsl::OP
 
   /*
    * Value::SubclassData
@@ -166,6 +167,13 @@ public:
   /// from Value::setName() whenever the name of this function changes.
   void recalculateIntrinsicID();
 
+  // HLSL Change Begin
+  /// getDxilOpClassTag()/setDxilOpClassTag(Tag) - Reverse lookup from a dx.op
+  /// function to its operation class, kept by hlsl::OP. Zero means untagged.
+  unsigned getDxilOpClassTag() const { return DxilOpClassTag; }
+  void setDxilOpClassTag(unsigned Tag) { DxilOpClassTag = Tag; }
+  // HLSL Change End
+
   /// getCallingConv()/setCallingConv(CC) - These method get and set the
   /// calling convention of this function.  The enum values for the known
   /// calling conventions are defined in CallingConv.h.
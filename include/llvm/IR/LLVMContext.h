@@ -70,6 +70,17 @@ public:
   // HLSL Change - Begin
   /// Return a unique non-zero ID for the specified metadata kind if it exists.
   bool findMDKindID(StringRef Name, unsigned *ID) const;
+
+  /// Prepare a context whose modules have all been destroyed for unrelated
+  /// modules. Struct type names, the metadata kinds added after construction
+  /// and the handlers are dropped, so that types and kind IDs come out as
+  /// they would in a new context; uniqued types, constants and metadata are
+  /// kept. Returns false, changing nothing, if a module still exists.
+  bool resetForReuse();
+
+  /// Return the number of uniqued types, constants and metadata held by the
+  /// context. This only grows while the context is reused.
+  size_t getNumRetainedObjects() const;
   // HLSL Change - End
 
   /// getMDKindNames - Populate client supplied SmallVector with the name for
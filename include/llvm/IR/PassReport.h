@@ -0,0 +1,93 @@
+//===- llvm/IR/PassReport.h - Per-pass cost report --------------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// HLSL Change - new file.
+//
+// Records wall time, instruction count change and peak allocated memory for
+// every pass run on the calling thread, and writes them out as JSON. Like the
+// time trace profiler, the recorder is per-thread so concurrent compiles each
+// get their own report.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_IR_PASSREPORT_H
+#define LLVM_IR_PASSREPORT_H
+
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/Compiler.h"
+#include <stdint.h>
+
+namespace llvm {
+
+class Function;
+class Module;
+class raw_ostream;
+
+/// Tracks the bytes allocated by the compile, for the peak memory figures.
+class PassReportMemoryCounter {
+public:
+  virtual ~PassReportMemoryCounter() {}
+  /// Bytes currently allocated.
+  virtual uint64_t getCurrentBytes() = 0;
+  /// Highest number of bytes allocated since the last resetPeakBytes call.
+  virtual uint64_t getPeakBytes() = 0;
+  /// Restart peak tracking from the current number of bytes.
+  virtual void resetPeakBytes() = 0;
+};
+
+struct PassReport;
+extern LLVM_THREAD_LOCAL PassReport *PassReportInstance;
+
+/// Enable the pass report on the calling thread. \p Counter may be null, in
+/// which case no memory figures are recorded; otherwise it must outlive the
+/// report.
+void passReportInitialize(PassReportMemoryCounter *Counter);
+
+/// Discard the calling thread's pass report.
+void passReportCleanup();
+
+/// Is the pass report enabled on the calling thread?
+inline bool passReportEnabled() { return PassReportInstance != nullptr; }
+
+/// Write every pass recorded on the calling thread to \p OS as JSON. Passes
+/// that are still running are not written.
+void passReportWrite(raw_ostream &OS);
+
+/// Start recording a pass run on the whole module.
+void passReportBegin(StringRef PassName, Module &M);
+
+/// Start recording a pass run on (part of) a function.
+void passReportBegin(StringRef PassName, Function &F);
+
+/// Finish recording the innermost running pass.
+void passReportEnd();
+
+/// Records a pass for the lifetime of the object. Does nothing when the pass
+/// report is not enabled on the calling thread.
+struct PassReportScope {
+  template <typename IRUnitT>
+  PassReportScope(StringRef PassName, IRUnitT &IR)
+      : Active(PassReportInstance != nullptr) {
+    if (Active)
+      passReportBegin(PassName, IR);
+  }
+  ~PassReportScope() {
+    if (Active && PassReportInstance != nullptr)
+      passReportEnd();
+  }
+
+private:
+  PassReportScope(const PassReportScope &) = delete;
+  void operator=(const PassReportScope &) = delete;
+  bool Active;
+};
+
+} // end namespace llvm
+
+#endif
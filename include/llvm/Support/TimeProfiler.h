@@ -0,0 +1,116 @@
+//===- llvm/Support/TimeProfiler.h - Hierarchical Time Profiler -*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// HLSL Change - new file.
+//
+// Records nested, named time ranges for the calling thread and writes them out
+// in the Chrome trace-event format, which can be loaded by chrome://tracing or
+// Speedscope. Unlike the -time-passes timers, the profiler instance is
+// per-thread, so concurrent compiles each get their own trace.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_SUPPORT_TIME_PROFILER_H
+#define LLVM_SUPPORT_TIME_PROFILER_H
+
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/Compiler.h"
+#include "dxc/Tracing/DxcUsdt.h"
+
+namespace llvm {
+
+class raw_ostream;
+
+struct TimeTraceProfiler;
+extern LLVM_THREAD_LOCAL TimeTraceProfiler *TimeTraceProfilerInstance;
+
+/// Is told about every time range opened and closed on the calling thread,
+/// whether or not the profiler is enabled, e.g. to attribute memory use to
+/// the compile phases.
+class TimeTraceListener {
+public:
+  virtual ~TimeTraceListener() {}
+  virtual void rangeBegin(StringRef Name) = 0;
+  /// Close the innermost range. May come without a matching rangeBegin if
+  /// the listener was installed while the range was open.
+  virtual void rangeEnd() = 0;
+};
+extern LLVM_THREAD_LOCAL TimeTraceListener *TimeTraceListenerInstance;
+
+/// Install \p Listener on the calling thread, or remove the current one when
+/// it is null. Returns the listener it replaced.
+TimeTraceListener *timeTraceSetListener(TimeTraceListener *Listener);
+
+/// Initialize the time trace profiler for the calling thread. Must not be
+/// called when the profiler is already enabled on this thread.
+void timeTraceProfilerInitialize(StringRef ProcessName);
+
+/// Discard the calling thread's time trace profiler and everything it has
+/// recorded.
+void timeTraceProfilerCleanup();
+
+/// Is the time trace profiler enabled on the calling thread?
+inline bool timeTraceProfilerEnabled() {
+  return TimeTraceProfilerInstance != nullptr;
+}
+
+/// Write everything the calling thread's profiler recorded so far to \p OS as
+/// Chrome trace-event JSON. Ranges that are still open are not written.
+void timeTraceProfilerWrite(raw_ostream &OS);
+
+/// Write \p Str to \p OS as a quoted JSON string, escaping control
+/// characters, for the JSON reports written alongside the trace.
+void writeJSONString(raw_ostream &OS, StringRef Str);
+
+/// Open a time range on the profiler and the listener, if any. \p Detail is
+/// shown as an argument of the event, e.g. the
+/// function a pass ran on.
+void timeTraceProfilerBegin(StringRef Name, StringRef Detail);
+
+/// Close the innermost open time range on the profiler and the listener.
+void timeTraceProfilerEnd();
+
+/// The TimeTraceScope is a helper class to call the begin and end functions
+/// of the time trace profiler. When the object is constructed, it begins the
+/// range, and when it is destroyed, it closes it. Does nothing when neither
+/// the profiler nor a listener is enabled on the calling thread, except fire
+/// the range probes of builds with USDT probes.
+struct TimeTraceScope {
+  TimeTraceScope(StringRef Name, StringRef Detail = StringRef())
+      : Active(TimeTraceProfilerInstance != nullptr ||
+               TimeTraceListenerInstance != nullptr) {
+#ifdef DXC_ENABLE_USDT
+    this->Name = Name;
+    this->Detail = Detail;
+    DxcUsdt_RangeBegin(Name, Detail);
+#endif
+    if (Active)
+      timeTraceProfilerBegin(Name, Detail);
+  }
+  ~TimeTraceScope() {
+    if (Active)
+      timeTraceProfilerEnd();
+#ifdef DXC_ENABLE_USDT
+    DxcUsdt_RangeEnd(Name, Detail);
+#endif
+  }
+
+private:
+  TimeTraceScope(const TimeTraceScope &) = delete;
+  void operator=(const TimeTraceScope &) = delete;
+  bool Active;
+#ifdef DXC_ENABLE_USDT
+  StringRef Name;
+  StringRef Detail;
+#endif
+};
+
+} // end namespace llvm
+
+#endif
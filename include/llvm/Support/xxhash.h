@@ -0,0 +1,31 @@
+//===- llvm/Support/xxhash.h - XXH64 hash function -------------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// HLSL Change - new file.
+//
+// Implements the XXH64 non-cryptographic hash by Yann Collet
+// (https://github.com/Cyan4973/xxHash). Much faster than MD5 on large inputs,
+// for uses that only need a well distributed key rather than a secure digest.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_SUPPORT_XXHASH_H
+#define LLVM_SUPPORT_XXHASH_H
+
+#include "llvm/ADT/ArrayRef.h"
+#include <stdint.h>
+
+namespace llvm {
+
+/// Compute the XXH64 hash of \p Data with the given \p Seed.
+uint64_t xxHash64(ArrayRef<uint8_t> Data, uint64_t Seed = 0);
+
+} // end namespace llvm
+
+#endif
@@ -16,6 +16,8 @@
 #define LLVM_TRANSFORMS_IPO_PASSMANAGERBUILDER_H
 
 #include <vector>
+#include <map> // HLSL Change
+#include <string> // HLSL Change
 
 namespace hlsl {
   class HLSLExtensionsCodegenHelper;
@@ -132,10 +134,22 @@ public:
   hlsl::HLSLExtensionsCodegenHelper *HLSLExtensionsCodeGen = nullptr; // HLSL Change
   bool HLSLResMayAlias = false; // HLSL Change
   unsigned ScanLimit = 0; // HLSL Change
+  unsigned HLSLUnrollMaxFunctionInstructions = 0; // HLSL Change
+  unsigned HLSLUnrollMaxModuleInstructions = 0; // HLSL Change
+  unsigned HLSLUnrollTimeLimit = 0; // HLSL Change
+  unsigned HLSLMaxRegisterPressure = 0; // HLSL Change
+  std::map<std::string, std::string> HLSLSpecializedCBufferValues; // HLSL Change
   bool EnableGVN = true; // HLSL Change
   bool StructurizeLoopExitsForUnroll = false; // HLSL Change
   bool HLSLEnableLifetimeMarkers = false; // HLSL Change
   bool HLSLEnableDebugNops = false; // HLSL Change
+  bool HLSLEnableUniformityMetadata = false; // HLSL Change
+  bool HLSLEnableDot2AddFormation = false; // HLSL Change
+  bool HLSLEnableFetchClustering = false; // HLSL Change
+  bool HLSLEnableInlineCleanup = false; // HLSL Change
+  bool HLSLEnableGroupSharedPadding = false; // HLSL Change
+  bool HLSLCombineRawBufferAccesses = true; // HLSL Change
+  bool HLSLFoldUniformWaveOps = true; // HLSL Change
 
 private:
   /// ExtensionList - This is list of all of the extensions that are registered.
@@ -18,6 +18,7 @@
 #ifndef LLVM_TRANSFORMS_UTILS_CLONING_H
 #define LLVM_TRANSFORMS_UTILS_CLONING_H
 
+#include "llvm/ADT/STLExtras.h" // HLSL Change
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/Twine.h"
 #include "llvm/IR/ValueHandle.h"
@@ -51,6 +52,13 @@ class DominatorTree;
 ///
 Module *CloneModule(const Module *M);
 Module *CloneModule(const Module *M, ValueToValueMapTy &VMap);
+// HLSL Change Starts
+/// Return a copy of the specified module in which only the functions for
+/// which ShouldCloneDefinition returns true keep their bodies; the others
+/// become external declarations, as if deleteBody had been called on them.
+Module *CloneModule(const Module *M, ValueToValueMapTy &VMap,
+                    function_ref<bool(const Function *)> ShouldCloneDefinition);
+// HLSL Change Ends
 
 /// ClonedCodeInfo - This struct can be used to capture information about code
 /// being cloned, while it is being cloned.
@@ -13,6 +13,7 @@
 //===----------------------------------------------------------------------===//
 #include "llvm/Analysis/DxilConstantFolding.h"
 #include "llvm/Analysis/ConstantFolding.h"
+#include "llvm/ADT/APSInt.h"
 #include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/StringMap.h"
@@ -402,6 +403,25 @@ static Constant *ComputeBFE(Type *Ty, APInt width, APInt offset, APInt val, std:
     }
 }
 
+// Compute the masked sum of absolute differences of the bytes of ref and src,
+// skipping bytes where ref is zero, and add it to accum.
+// Only folded when the sum does not overflow, so whether the hardware wraps
+// or saturates does not matter.
+static Constant *ComputeMsad(Type *Ty, APInt ref, APInt src, APInt accum) {
+  if (ref.getBitWidth() != 32)
+    return nullptr;
+  uint64_t sum = accum.getZExtValue();
+  for (unsigned i = 0; i < 4; ++i) {
+    int64_t r = (ref.getZExtValue() >> (i * 8)) & 0xff;
+    int64_t s = (src.getZExtValue() >> (i * 8)) & 0xff;
+    if (r != 0)
+      sum += r > s ? r - s : s - r;
+  }
+  if (sum > UINT32_MAX)
+    return nullptr;
+  return ConstantInt::get(Ty, sum);
+}
+
 // Constant fold ternary integer intrinsic.
 static Constant *ConstantFoldTernaryIntIntrinsic(OP::OpCode opcode, Type *Ty, ConstantInt *Op1, ConstantInt *Op2, ConstantInt *Op3) {
   APInt C1 = Op1->getValue();
@@ -418,6 +438,7 @@ static Constant *ConstantFoldTernaryIntIntrinsic(OP::OpCode opcode, Type *Ty, Co
   }
   case OP::OpCode::Ubfe: return ComputeBFE(Ty, C1, C2, C3, [](APInt val, APInt amt) {return val.lshr(amt); });
   case OP::OpCode::Ibfe: return ComputeBFE(Ty, C1, C2, C3, [](APInt val, APInt amt) {return val.ashr(amt); });
+  case OP::OpCode::Msad: return ComputeMsad(Ty, C1, C2, C3);
   }
 
   return nullptr;
@@ -448,6 +469,137 @@ static Constant *ConstantFoldQuaternaryIntInstrinsic(OP::OpCode opcode, Type *Ty
   return ConstantInt::get(Ty, result);
 }
 
+// Constant fold IsNaN, IsInf, IsFinite and IsNormal. Unlike the other
+// float intrinsics, these are folded for NaN and inf as well.
+static Constant *ConstantFoldIsSpecialFloat(OP::OpCode opcode, Type *Ty, ConstantFP *Op) {
+  const APFloat &Val = Op->getValueAPF();
+  switch (opcode) {
+  default: break;
+  case OP::OpCode::IsNaN:    return ConstantInt::get(Ty, Val.isNaN());
+  case OP::OpCode::IsInf:    return ConstantInt::get(Ty, Val.isInfinity());
+  case OP::OpCode::IsFinite: return ConstantInt::get(Ty, !Val.isNaN() && !Val.isInfinity());
+  case OP::OpCode::IsNormal: return ConstantInt::get(Ty, Val.isNormal());
+  }
+
+  return nullptr;
+}
+
+// Convert C to the semantics of Ty. Returns null unless the conversion is
+// exact, so the result does not depend on the rounding the hardware uses.
+static Constant *ConvertFPExact(ConstantFP *C, Type *Ty) {
+  if (!IsValidOp(C))
+    return nullptr;
+  APFloat Val = C->getValueAPF();
+  bool losesInfo = false;
+  if (Val.convert(Ty->getFltSemantics(), APFloat::rmNearestTiesToEven, &losesInfo) != APFloat::opOK)
+    return nullptr;
+  return ConstantFP::get(Ty->getContext(), Val);
+}
+
+// Constant fold f32tof16. The half bits are returned in the low 16 bits.
+static Constant *ConstantFoldLegacyF32ToF16(Type *Ty, ConstantFP *Op) {
+  if (!IsValidOp(Op))
+    return nullptr;
+  APFloat Val = Op->getValueAPF();
+  bool losesInfo = false;
+  if (Val.convert(APFloat::IEEEhalf, APFloat::rmNearestTiesToEven, &losesInfo) != APFloat::opOK)
+    return nullptr;
+  return ConstantInt::get(Ty, Val.bitcastToAPInt().getZExtValue());
+}
+
+// Constant fold f16tof32, which reads the half from the low 16 bits.
+static Constant *ConstantFoldLegacyF16ToF32(Type *Ty, ConstantInt *Op) {
+  APFloat Val(APFloat::IEEEhalf, APInt(16, Op->getZExtValue() & 0xffff));
+  if (Val.isNaN())
+    return nullptr;
+  bool losesInfo = false;
+  Val.convert(Ty->getFltSemantics(), APFloat::rmNearestTiesToEven, &losesInfo);
+  return ConstantFP::get(Ty->getContext(), Val);
+}
+
+// Constant fold a double to int32 or uint32 conversion, which truncates.
+static Constant *ConstantFoldLegacyDoubleToInt(Type *Ty, ConstantFP *Op, bool isUnsigned) {
+  if (!IsValidOp(Op))
+    return nullptr;
+  APSInt Result(Ty->getScalarSizeInBits(), isUnsigned);
+  bool isExact = false;
+  APFloat::opStatus status = Op->getValueAPF().convertToInteger(Result, APFloat::rmTowardZero, &isExact);
+  if (status != APFloat::opOK && status != APFloat::opInexact)
+    return nullptr;
+  return ConstantInt::get(Ty, Result);
+}
+
+// Constant fold dot2add: acc + a.x * b.x + a.y * b.y, computed in the
+// precision of the float result.
+static Constant *ConstantFoldDot2AddHalf(Type *Ty, const DxilIntrinsicOperands &operands) {
+  ConstantFP *Acc = operands.GetConstantFloat(0);
+  SmallVector<ConstantFP *, 4> Halves;
+  for (unsigned i = 1; i < 5; ++i) {
+    ConstantFP *H = operands.GetConstantFloat(i);
+    if (!IsValidOp(H))
+      return nullptr;
+    Halves.push_back(cast<ConstantFP>(ConvertFPExact(H, Ty)));
+  }
+  if (!IsValidOp(Acc))
+    return nullptr;
+
+  ConstantFP *Dot = dyn_cast_or_null<ConstantFP>(
+      ComputeDot(Ty, { Halves[0], Halves[1] }, { Halves[2], Halves[3] }));
+  if (!Dot)
+    return nullptr;
+  APFloat Result(Acc->getValueAPF());
+  Result.add(Dot->getValueAPF(), APFloat::rmNearestTiesToEven);
+  return ConstantFP::get(Ty->getContext(), Result);
+}
+
+// Constant fold dot4add_i8packed and dot4add_u8packed.
+static Constant *ConstantFoldDot4AddPacked(OP::OpCode opcode, Type *Ty, const DxilIntrinsicOperands &operands) {
+  ConstantInt *Acc = operands.GetConstantInt(0);
+  ConstantInt *A = operands.GetConstantInt(1);
+  ConstantInt *B = operands.GetConstantInt(2);
+  if (!Acc || !A || !B)
+    return nullptr;
+
+  bool isSigned = opcode == OP::OpCode::Dot4AddI8Packed;
+  uint32_t a = (uint32_t)A->getZExtValue();
+  uint32_t b = (uint32_t)B->getZExtValue();
+  uint32_t result = (uint32_t)Acc->getZExtValue();
+  for (unsigned i = 0; i < 4; ++i) {
+    int32_t ai = (a >> (i * 8)) & 0xff;
+    int32_t bi = (b >> (i * 8)) & 0xff;
+    if (isSigned) {
+      ai = (int8_t)ai;
+      bi = (int8_t)bi;
+    }
+    result += (uint32_t)(ai * bi);
+  }
+  return ConstantInt::get(Ty, result);
+}
+
+// Constant fold pack_u8, pack_s8, pack_clamp_u8 and pack_clamp_s8.
+static Constant *ConstantFoldPack4x8(Type *Ty, const DxilIntrinsicOperands &operands) {
+  ConstantInt *Mode = operands.GetConstantInt(0);
+  if (!Mode)
+    return nullptr;
+  DXIL::PackMode packMode = static_cast<DXIL::PackMode>(Mode->getZExtValue());
+
+  uint32_t result = 0;
+  for (unsigned i = 0; i < 4; ++i) {
+    ConstantInt *C = operands.GetConstantInt(i + 1);
+    if (!C)
+      return nullptr;
+    int64_t val = C->getSExtValue();
+    switch (packMode) {
+    case DXIL::PackMode::Trunc: break;
+    case DXIL::PackMode::UClamp: val = std::min<int64_t>(std::max<int64_t>(val, 0), 255); break;
+    case DXIL::PackMode::SClamp: val = std::min<int64_t>(std::max<int64_t>(val, -128), 127); break;
+    default: return nullptr;
+    }
+    result |= ((uint32_t)val & 0xff) << (i * 8);
+  }
+  return ConstantInt::get(Ty, result);
+}
+
 // Top level function to constant fold floating point intrinsics.
 static Constant *ConstantFoldFPIntrinsic(OP::OpCode opcode, Type *Ty, const DxilIntrinsicOperands &IntrinsicOperands) {
   if (!Ty->isHalfTy() && !Ty->isFloatTy() && !Ty->isDoubleTy())
@@ -493,6 +645,31 @@ static Constant *ConstantFoldFPIntrinsic(OP::OpCode opcode, Type *Ty, const Dxil
     return ConstantFoldDot(opcode, Ty, IntrinsicOperands);
   case OP::OpCodeClass::MakeDouble:
     return ConstantFoldMakeDouble(Ty, IntrinsicOperands);
+  case OP::OpCodeClass::Dot2AddHalf:
+    return ConstantFoldDot2AddHalf(Ty, IntrinsicOperands);
+  case OP::OpCodeClass::LegacyDoubleToFloat: {
+    assert(IntrinsicOperands.Size() == 1);
+    ConstantFP *Op = IntrinsicOperands.GetConstantFloat(0);
+    if (!Op)
+      return nullptr;
+    return ConvertFPExact(Op, Ty);
+  }
+  case OP::OpCodeClass::LegacyF16ToF32: {
+    assert(IntrinsicOperands.Size() == 1);
+    ConstantInt *Op = IntrinsicOperands.GetConstantInt(0);
+    if (!Op)
+      return nullptr;
+    return ConstantFoldLegacyF16ToF32(Ty, Op);
+  }
+  case OP::OpCodeClass::BitcastI16toF16:
+  case OP::OpCodeClass::BitcastI32toF32:
+  case OP::OpCodeClass::BitcastI64toF64: {
+    assert(IntrinsicOperands.Size() == 1);
+    ConstantInt *Op = IntrinsicOperands.GetConstantInt(0);
+    if (!Op || Op->getBitWidth() != Ty->getPrimitiveSizeInBits())
+      return nullptr;
+    return ConstantFP::get(Ty->getContext(), APFloat(Ty->getFltSemantics(), Op->getValue()));
+  }
   }
 
   return nullptr;
@@ -548,6 +725,41 @@ static Constant *ConstantFoldIntIntrinsic(OP::OpCode opcode, Type *Ty, const Dxi
   }
   case OP::OpCodeClass::IsHelperLane:
     return ConstantInt::get(Ty, (uint64_t)0);
+  case OP::OpCodeClass::IsSpecialFloat: {
+    assert(IntrinsicOperands.Size() == 1);
+    ConstantFP *Op = IntrinsicOperands.GetConstantFloat(0);
+    if (!Op)
+      return nullptr;
+    return ConstantFoldIsSpecialFloat(opcode, Ty, Op);
+  }
+  case OP::OpCodeClass::LegacyF32ToF16: {
+    assert(IntrinsicOperands.Size() == 1);
+    ConstantFP *Op = IntrinsicOperands.GetConstantFloat(0);
+    if (!Op)
+      return nullptr;
+    return ConstantFoldLegacyF32ToF16(Ty, Op);
+  }
+  case OP::OpCodeClass::LegacyDoubleToSInt32:
+  case OP::OpCodeClass::LegacyDoubleToUInt32: {
+    assert(IntrinsicOperands.Size() == 1);
+    ConstantFP *Op = IntrinsicOperands.GetConstantFloat(0);
+    if (!Op)
+      return nullptr;
+    return ConstantFoldLegacyDoubleToInt(Ty, Op, opClass == OP::OpCodeClass::LegacyDoubleToUInt32);
+  }
+  case OP::OpCodeClass::BitcastF16toI16:
+  case OP::OpCodeClass::BitcastF32toI32:
+  case OP::OpCodeClass::BitcastF64toI64: {
+    assert(IntrinsicOperands.Size() == 1);
+    ConstantFP *Op = IntrinsicOperands.GetConstantFloat(0);
+    if (!Op || Op->getType()->getPrimitiveSizeInBits() != Ty->getPrimitiveSizeInBits())
+      return nullptr;
+    return ConstantInt::get(Ty, Op->getValueAPF().bitcastToAPInt());
+  }
+  case OP::OpCodeClass::Dot4AddPacked:
+    return ConstantFoldDot4AddPacked(opcode, Ty, IntrinsicOperands);
+  case OP::OpCodeClass::Pack4x8:
+    return ConstantFoldPack4x8(Ty, IntrinsicOperands);
   }
 
   return nullptr;
@@ -606,6 +818,21 @@ bool hlsl::CanConstantFoldCallTo(const Function *F) {
     case OP::OpCodeClass::Dot3:
     case OP::OpCodeClass::Dot4:
     case OP::OpCodeClass::MakeDouble:
+    case OP::OpCodeClass::Dot2AddHalf:
+    case OP::OpCodeClass::Dot4AddPacked:
+    case OP::OpCodeClass::IsSpecialFloat:
+    case OP::OpCodeClass::LegacyF16ToF32:
+    case OP::OpCodeClass::LegacyF32ToF16:
+    case OP::OpCodeClass::LegacyDoubleToFloat:
+    case OP::OpCodeClass::LegacyDoubleToSInt32:
+    case OP::OpCodeClass::LegacyDoubleToUInt32:
+    case OP::OpCodeClass::BitcastF16toI16:
+    case OP::OpCodeClass::BitcastF32toI32:
+    case OP::OpCodeClass::BitcastF64toI64:
+    case OP::OpCodeClass::BitcastI16toF16:
+    case OP::OpCodeClass::BitcastI32toF32:
+    case OP::OpCodeClass::BitcastI64toF64:
+    case OP::OpCodeClass::Pack4x8:
       return true;
     case OP::OpCodeClass::IsHelperLane: {
       const hlsl::ShaderModel *pSM =
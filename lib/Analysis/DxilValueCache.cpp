@@ -26,6 +26,7 @@
 #include "llvm/Analysis/InstructionSimplify.h"
 #include "llvm/Analysis/ConstantFolding.h"
 #include "llvm/ADT/Statistic.h"
+#include "llvm/ADT/SmallPtrSet.h"
 
 #include "llvm/Analysis/DxilValueCache.h"
 
@@ -391,6 +392,74 @@ void DxilValueCache::WeakValueMap::ResetUnknowns() {
   }
 }
 
+void DxilValueCache::WeakValueMap::ResetUnknowns(ArrayRef<Value *> Changed) {
+  if (!Sentinel)
+    return;
+
+  // Returns whether V was cached as unknown, in which case it is reset and
+  // whatever was computed from it needs to be reset too.
+  auto ResetIfUnknown = [this](Value *V) -> bool {
+    auto FindIt = Map.find(V);
+    if (FindIt == Map.end() || FindIt->second.IsStale())
+      return false;
+    if (FindIt->second.Value != Sentinel.get())
+      return false;
+    FindIt->second.Value = nullptr;
+    return true;
+  };
+
+  SmallVector<Value *, 32> WorkList;
+  SmallPtrSet<Value *, 32> Visited;
+
+  // The reachability of a block feeds the blocks it branches to and the phis
+  // that take values from it.
+  auto AddSuccessors = [&WorkList](TerminatorInst *Term) {
+    for (unsigned i = 0, e = Term->getNumSuccessors(); i < e; i++) {
+      BasicBlock *Succ = Term->getSuccessor(i);
+      WorkList.push_back(Succ);
+      for (Instruction &I : *Succ) {
+        PHINode *PN = dyn_cast<PHINode>(&I);
+        if (!PN)
+          break;
+        WorkList.push_back(PN);
+      }
+    }
+  };
+  auto AddDependents = [&](Value *V) {
+    if (Instruction *I = dyn_cast<Instruction>(V)) {
+      for (User *U : I->users())
+        WorkList.push_back(U);
+      if (TerminatorInst *Term = dyn_cast<TerminatorInst>(I))
+        AddSuccessors(Term);
+    }
+    else if (BasicBlock *BB = dyn_cast<BasicBlock>(V)) {
+      if (TerminatorInst *Term = BB->getTerminator()) {
+        WorkList.push_back(Term);
+        AddSuccessors(Term);
+      }
+    }
+  };
+
+  // The changed values themselves are always followed, cached or not, since
+  // the values computed from them may have been cached before they changed.
+  for (Value *V : Changed) {
+    ResetIfUnknown(V);
+    if (Visited.insert(V).second)
+      AddDependents(V);
+  }
+
+  // Everything else is only followed while it was unknown. A known value
+  // stays known, and a value that was never cached has nothing computed from
+  // it.
+  while (!WorkList.empty()) {
+    Value *V = WorkList.pop_back_val();
+    if (!Visited.insert(V).second)
+      continue;
+    if (ResetIfUnknown(V))
+      AddDependents(V);
+  }
+}
+
 LLVM_DUMP_METHOD
 void DxilValueCache::WeakValueMap::dump() const {
   for (auto It = Map.begin(), E = Map.end(); It != E; It++) {
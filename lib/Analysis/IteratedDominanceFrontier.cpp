@@ -19,6 +19,13 @@
 using namespace llvm;
 
 void IDFCalculator::calculate(SmallVectorImpl<BasicBlock *> &PHIBlocks) {
+  // HLSL Change Begin
+  if (useFrontiers) {
+    calculateFromFrontiers(PHIBlocks);
+    return;
+  }
+  // HLSL Change End
+
   // If we haven't computed dominator tree levels, do so now.
   if (DomLevels.empty()) {
     for (auto DFI = df_begin(DT.getRootNode()), DFE = df_end(DT.getRootNode());
@@ -93,3 +100,59 @@ void IDFCalculator::calculate(SmallVectorImpl<BasicBlock *> &PHIBlocks) {
     }
   }
 }
+
+// HLSL Change Begin
+void IDFCalculator::computeFrontiers() {
+  Frontiers.clear();
+  // Every block is in the frontier of its predecessors, and of their
+  // dominators up to, but not including, its own immediate dominator.
+  for (auto DFI = df_begin(DT.getRootNode()), DFE = df_end(DT.getRootNode());
+       DFI != DFE; ++DFI) {
+    DomTreeNode *Node = *DFI;
+    DomTreeNode *IDom = Node->getIDom();
+    for (BasicBlock *Pred : predecessors(Node->getBlock())) {
+      DomTreeNode *Runner = DT.getNode(Pred);
+      while (Runner && Runner != IDom) {
+        SmallVectorImpl<DomTreeNode *> &DF = Frontiers[Runner];
+        // Reached from an earlier predecessor, and so were its dominators.
+        if (!DF.empty() && DF.back() == Node)
+          break;
+        DF.push_back(Node);
+        Runner = Runner->getIDom();
+      }
+    }
+  }
+  useFrontiers = true;
+}
+
+void IDFCalculator::calculateFromFrontiers(
+    SmallVectorImpl<BasicBlock *> &PHIBlocks) {
+  SmallVector<DomTreeNode *, 32> Worklist;
+  SmallPtrSet<DomTreeNode *, 32> Visited;
+
+  for (BasicBlock *BB : *DefBlocks) {
+    if (DomTreeNode *Node = DT.getNode(BB))
+      Worklist.push_back(Node);
+  }
+
+  // Blocks are pruned with the live-in set exactly as in calculate(), so the
+  // same blocks are returned, though maybe in another order.
+  while (!Worklist.empty()) {
+    auto It = Frontiers.find(Worklist.pop_back_val());
+    if (It == Frontiers.end())
+      continue;
+    for (DomTreeNode *SuccNode : It->second) {
+      if (!Visited.insert(SuccNode).second)
+        continue;
+
+      BasicBlock *SuccBB = SuccNode->getBlock();
+      if (useLiveIn && !LiveInBlocks->count(SuccBB))
+        continue;
+
+      PHIBlocks.emplace_back(SuccBB);
+      if (!DefBlocks->count(SuccBB))
+        Worklist.push_back(SuccNode);
+    }
+  }
+}
+// HLSL Change End
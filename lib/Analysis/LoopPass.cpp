@@ -16,7 +16,9 @@
 #include "llvm/Analysis/LoopPass.h"
 #include "llvm/IR/IRPrintingPasses.h"
 #include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/PassReport.h" // HLSL Change
 #include "llvm/Support/Debug.h"
+#include "llvm/Support/TimeProfiler.h" // HLSL Change
 #include "llvm/Support/Timer.h"
 #include "llvm/Support/raw_ostream.h"
 using namespace llvm;
@@ -247,6 +249,11 @@ bool LPPassManager::runOnFunction(Function &F) {
       {
         PassManagerPrettyStackEntry X(P, *CurrentLoop->getHeader());
         TimeRegion PassTimer(getPassTimer(P));
+        // HLSL Change - trace the pass with the function the loop is in.
+        TimeTraceScope PassTrace(
+            P->getPassName(), CurrentLoop->getHeader()->getParent()->getName());
+        PassReportScope PassReportRange(
+            P->getPassName(), *CurrentLoop->getHeader()->getParent());
 
         Changed |= P->runOnLoop(CurrentLoop, *this);
       }
@@ -151,10 +151,16 @@ bool LLParser::ValidateEndOfModule() {
                  Twine(ForwardRefMDNodes.begin()->first) + "'");
 
   // Resolve metadata cycles.
+  // HLSL Change Begin - dense and sparse slots.
   for (auto &N : NumberedMetadata) {
+    if (N && !N->isResolved())
+      N->resolveCycles();
+  }
+  for (auto &N : SparseNumberedMetadata) {
     if (N.second && !N.second->isResolved())
       N.second->resolveCycles();
   }
+  // HLSL Change End
 
   // Look for intrinsic functions and CallInst that need to be upgraded
   for (Module::iterator FI = M->begin(), FE = M->end(); FI != FE; )
@@ -168,7 +174,13 @@ bool LLParser::ValidateEndOfModule() {
   // Because by this point we've parsed and validated everything, we can "steal"
   // the mapping from LLParser as it doesn't need it anymore.
   Slots->GlobalValues = std::move(NumberedVals);
-  Slots->MetadataNodes = std::move(NumberedMetadata);
+  // HLSL Change Begin - dense slots all come before sparse ones.
+  Slots->MetadataNodes = std::move(SparseNumberedMetadata);
+  for (unsigned ID = 0, E = NumberedMetadata.size(); ID != E; ++ID) {
+    if (NumberedMetadata[ID])
+      Slots->MetadataNodes.emplace(ID, std::move(NumberedMetadata[ID]));
+  }
+  // HLSL Change End
 
   return false;
 }
@@ -527,6 +539,43 @@ bool LLParser::ParseMDString(MDString *&Result) {
   return false;
 }
 
+// HLSL Change Begin
+/// Reserves the numbered metadata table for the definitions in F, which are
+/// the lines that start with '!' and a digit.
+void LLParser::ReserveNumberedMetadata(StringRef F) {
+  unsigned Count = 0;
+  for (size_t Pos = 0; Pos < F.size(); ++Pos) {
+    if (F[Pos] == '!' && Pos + 1 < F.size() && isdigit(F[Pos + 1]))
+      ++Count;
+    Pos = F.find('\n', Pos);
+    if (Pos == StringRef::npos)
+      break;
+  }
+  NumberedMetadata.reserve(Count);
+  // Leave room for numbering that skips a few slots.
+  MaxDenseMetadataID = 2 * Count + 64;
+}
+
+/// Returns the node numbered ID, or null if there is none yet.
+TrackingMDNodeRef *LLParser::FindNumberedMetadata(unsigned ID) {
+  if (ID < NumberedMetadata.size())
+    return NumberedMetadata[ID] ? &NumberedMetadata[ID] : nullptr;
+  auto It = SparseNumberedMetadata.find(ID);
+  if (It == SparseNumberedMetadata.end() || !It->second)
+    return nullptr;
+  return &It->second;
+}
+
+/// Returns the slot for the node numbered ID, adding an empty one if needed.
+TrackingMDNodeRef &LLParser::GetNumberedMetadata(unsigned ID) {
+  if (ID >= MaxDenseMetadataID)
+    return SparseNumberedMetadata[ID];
+  if (ID >= NumberedMetadata.size())
+    NumberedMetadata.resize(ID + 1);
+  return NumberedMetadata[ID];
+}
+// HLSL Change End
+
 // MDNode:
 //   ::= '!' MDNodeNumber
 bool LLParser::ParseMDNodeID(MDNode *&Result) {
@@ -536,8 +585,8 @@ bool LLParser::ParseMDNodeID(MDNode *&Result) {
     return true;
 
   // If not a forward reference, just return it now.
-  if (NumberedMetadata.count(MID)) {
-    Result = NumberedMetadata[MID];
+  if (TrackingMDNodeRef *N = FindNumberedMetadata(MID)) { // HLSL Change
+    Result = *N;
     return false;
   }
 
@@ -546,7 +595,7 @@ bool LLParser::ParseMDNodeID(MDNode *&Result) {
   FwdRef = std::make_pair(MDTuple::getTemporary(Context, None), Lex.getLoc());
 
   Result = FwdRef.first.get();
-  NumberedMetadata[MID].reset(Result);
+  GetNumberedMetadata(MID).reset(Result); // HLSL Change
   return false;
 }
 
@@ -606,11 +655,15 @@ bool LLParser::ParseStandaloneMetadata() {
     FI->second.first->replaceAllUsesWith(Init);
     ForwardRefMDNodes.erase(FI);
 
-    assert(NumberedMetadata[MetadataID] == Init && "Tracking VH didn't work");
+    assert(*FindNumberedMetadata(MetadataID) == Init &&
+           "Tracking VH didn't work"); // HLSL Change
   } else {
-    if (NumberedMetadata.count(MetadataID))
+    // HLSL Change Begin - look up the slot once.
+    TrackingMDNodeRef &N = GetNumberedMetadata(MetadataID);
+    if (N)
       return TokError("Metadata id is already used");
-    NumberedMetadata[MetadataID].reset(Init);
+    N.reset(Init);
+    // HLSL Change End
   }
 
   return false;
@@ -5230,6 +5283,29 @@ bool LLParser::ParseCall(Instruction *&Inst, PerFunctionState &PFS,
   // for the call, which means that RetType is just the return type.  Infer the
   // rest of the function argument types from the arguments that are present.
   FunctionType *Ty = dyn_cast<FunctionType>(RetType);
+  // HLSL Change Begin - reuse the callee of an earlier call to a dx.op
+  // function when this call's types match it.
+  bool IsDxilOpCall = !Ty && CalleeID.Kind == ValID::t_GlobalName &&
+                      StringRef(CalleeID.StrVal).startswith("dx.op.");
+  Function *DxilOpCallee = nullptr;
+  if (IsDxilOpCall) {
+    auto It = DxilOpCallees.find(CalleeID.StrVal);
+    Function *F = It != DxilOpCallees.end()
+                      ? dyn_cast_or_null<Function>(It->second)
+                      : nullptr;
+    if (F) {
+      FunctionType *FTy = F->getFunctionType();
+      bool Matches = FTy->getReturnType() == RetType && !FTy->isVarArg() &&
+                     FTy->getNumParams() == ArgList.size();
+      for (unsigned i = 0, e = ArgList.size(); Matches && i != e; ++i)
+        Matches = FTy->getParamType(i) == ArgList[i].V->getType();
+      if (Matches) {
+        DxilOpCallee = F;
+        Ty = FTy;
+      }
+    }
+  }
+  // HLSL Change End
   if (!Ty) {
     // Pull out the types of all of the arguments...
     std::vector<Type*> ParamTypes;
@@ -5244,8 +5320,17 @@ bool LLParser::ParseCall(Instruction *&Inst, PerFunctionState &PFS,
 
   // Look up the callee.
   Value *Callee;
-  if (ConvertValIDToValue(PointerType::getUnqual(Ty), CalleeID, Callee, &PFS))
-    return true;
+  // HLSL Change Begin - dx.op callees are looked up once.
+  if (DxilOpCallee) {
+    Callee = DxilOpCallee;
+  } else {
+    if (ConvertValIDToValue(PointerType::getUnqual(Ty), CalleeID, Callee, &PFS))
+      return true;
+    if (IsDxilOpCall)
+      if (Function *F = dyn_cast<Function>(Callee))
+        DxilOpCallees[CalleeID.StrVal] = F;
+  }
+  // HLSL Change End
 
   // Set up the Attribute for the function.
   SmallVector<AttributeSet, 8> Attrs;
@@ -112,7 +112,14 @@ namespace llvm {
     StringMap<std::pair<Type*, LocTy> > NamedTypes;
     std::map<unsigned, std::pair<Type*, LocTy> > NumberedTypes;
 
-    std::map<unsigned, TrackingMDNodeRef> NumberedMetadata;
+    // HLSL Change Begin - numbered metadata in a table indexed by slot.
+    // Slots are dense in practice, so the table is reserved up front from the
+    // number of definitions in the input. Slots too large for the table go to
+    // the map, so sparse numbering cannot make the table arbitrarily large.
+    std::vector<TrackingMDNodeRef> NumberedMetadata;
+    std::map<unsigned, TrackingMDNodeRef> SparseNumberedMetadata;
+    unsigned MaxDenseMetadataID;
+    // HLSL Change End
     std::map<unsigned, std::pair<TempMDTuple, LocTy>> ForwardRefMDNodes;
 
     // Global Value reference information.
@@ -136,16 +143,30 @@ namespace llvm {
     std::map<Value*, std::vector<unsigned> > ForwardRefAttrGroups;
     std::map<unsigned, AttrBuilder> NumberedAttrBuilders;
 
+    // HLSL Change Begin - DXIL calls a few dx.op functions many times.
+    // Callees of short form calls to dx.op.* functions, so that further calls
+    // reuse their type instead of rebuilding it from the arguments. Weak in
+    // case a forward reference resolves to something other than a function.
+    StringMap<WeakVH> DxilOpCallees;
+    // HLSL Change End
+
   public:
     LLParser(StringRef F, SourceMgr &SM, SMDiagnostic &Err, Module *M,
              SlotMapping *Slots = nullptr)
         : Context(M->getContext()), Lex(F, SM, Err, M->getContext()), M(M),
-          Slots(Slots), BlockAddressPFS(nullptr) {}
+          Slots(Slots), BlockAddressPFS(nullptr) {
+      ReserveNumberedMetadata(F); // HLSL Change
+    }
     bool Run();
 
     LLVMContext &getContext() { return Context; }
 
   private:
+    // HLSL Change Begin
+    void ReserveNumberedMetadata(StringRef F);
+    TrackingMDNodeRef *FindNumberedMetadata(unsigned ID);
+    TrackingMDNodeRef &GetNumberedMetadata(unsigned ID);
+    // HLSL Change End
 
     bool Error(LocTy L, const Twine &Msg) const {
       return Lex.Error(L, Msg);
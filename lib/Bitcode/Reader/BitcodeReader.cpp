@@ -44,7 +44,47 @@ enum {
 };
 
 class BitcodeReaderValueList {
-  std::vector<WeakVH> ValuePtrs;
+  // HLSL Change Begin - Globals and constants can be RAUW'd while they are in
+  // the list, when constant forward references are resolved or declarations
+  // are upgraded, so they are held by value handles. Arguments and
+  // instructions are only ever replaced through assignValue, so they are held
+  // as plain pointers; registering a handle for each of them was a large part
+  // of the time spent reading function bodies.
+  static const unsigned Untracked = ~0U;
+  struct ValueSlot {
+    Value *Ptr = nullptr;
+    unsigned TrackedIdx = Untracked;
+  };
+  std::vector<ValueSlot> ValuePtrs;
+  std::vector<WeakVH> TrackedPtrs;
+
+  Value *get(unsigned i) const {
+    const ValueSlot &Slot = ValuePtrs[i];
+    return Slot.TrackedIdx == Untracked ? Slot.Ptr
+                                        : (Value *)TrackedPtrs[Slot.TrackedIdx];
+  }
+  void set(unsigned i, Value *V) {
+    ValueSlot &Slot = ValuePtrs[i];
+    if (V && isa<Constant>(V)) {
+      Slot.Ptr = nullptr;
+      if (Slot.TrackedIdx == Untracked) {
+        Slot.TrackedIdx = TrackedPtrs.size();
+        TrackedPtrs.emplace_back(V);
+      } else {
+        TrackedPtrs[Slot.TrackedIdx] = V;
+      }
+      return;
+    }
+    release(Slot);
+    Slot.Ptr = V;
+  }
+  void release(ValueSlot &Slot) {
+    if (Slot.TrackedIdx != Untracked) {
+      TrackedPtrs[Slot.TrackedIdx] = nullptr;
+      Slot.TrackedIdx = Untracked;
+    }
+  }
+  // HLSL Change End
 
   /// As we resolve forward-referenced constants, we add information about them
   /// to this vector.  This allows us to resolve them in bulk instead of
@@ -65,24 +105,37 @@ public:
   // vector compatibility methods
   unsigned size() const { return ValuePtrs.size(); }
   void resize(unsigned N) { ValuePtrs.resize(N); }
-  void push_back(Value *V) { ValuePtrs.emplace_back(V); }
+  // HLSL Change Begin - go through set() so constants are tracked.
+  void push_back(Value *V) {
+    ValuePtrs.emplace_back();
+    set(ValuePtrs.size() - 1, V);
+  }
+  // HLSL Change End
 
   void clear() {
     assert(ResolveConstants.empty() && "Constants not resolved?");
     ValuePtrs.clear();
+    TrackedPtrs.clear(); // HLSL Change
   }
 
   Value *operator[](unsigned i) const {
     assert(i < ValuePtrs.size());
-    return ValuePtrs[i];
+    return get(i); // HLSL Change
   }
 
-  Value *back() const { return ValuePtrs.back(); }
-    void pop_back() { ValuePtrs.pop_back(); }
+  Value *back() const { return get(ValuePtrs.size() - 1); } // HLSL Change
   bool empty() const { return ValuePtrs.empty(); }
   void shrinkTo(unsigned N) {
     assert(N <= size() && "Invalid shrinkTo request!");
+    // HLSL Change Begin - drop the handles of the removed values. Values are
+    // tracked in the order they are assigned, so those of a function body are
+    // at the end.
+    for (unsigned i = N, e = ValuePtrs.size(); i != e; ++i)
+      release(ValuePtrs[i]);
     ValuePtrs.resize(N);
+    while (!TrackedPtrs.empty() && !TrackedPtrs.back())
+      TrackedPtrs.pop_back();
+    // HLSL Change End
   }
 
   Constant *getConstantFwdRef(unsigned Idx, Type *Ty);
@@ -237,6 +290,7 @@ public:
 
   bool ShouldTrackBitstreamUsage = false; // HLSL Change
   BitstreamUseTracker Tracker; // HLSL Change
+  bool ShouldSkipDebugInfo = false; // HLSL Change
 
   bool isDematerializable(const GlobalValue *GV) const override;
   std::error_code materialize(GlobalValue *GV) override;
@@ -778,23 +832,25 @@ void BitcodeReaderValueList::assignValue(Value *V, unsigned Idx) {
   if (Idx >= size())
     resize(Idx+1);
 
-  WeakVH &OldV = ValuePtrs[Idx];
+  // HLSL Change Begin - slots aren't necessarily value handles.
+  Value *OldV = get(Idx);
   if (!OldV) {
-    OldV = V;
+    set(Idx, V);
     return;
   }
 
   // Handle constants and non-constants (e.g. instrs) differently for
   // efficiency.
-  if (Constant *PHC = dyn_cast<Constant>(&*OldV)) {
+  if (Constant *PHC = dyn_cast<Constant>(OldV)) {
     ResolveConstants.push_back(std::make_pair(PHC, Idx));
-    OldV = V;
+    set(Idx, V);
   } else {
     // If there was a forward reference to this value, replace it.
-    Value *PrevVal = OldV;
     OldV->replaceAllUsesWith(V);
-    delete PrevVal;
+    set(Idx, V);
+    delete OldV;
   }
+  // HLSL Change End
 }
 
 
@@ -803,7 +859,7 @@ Constant *BitcodeReaderValueList::getConstantFwdRef(unsigned Idx,
   if (Idx >= size())
     resize(Idx + 1);
 
-  if (Value *V = ValuePtrs[Idx]) {
+  if (Value *V = get(Idx)) { // HLSL Change
     if (Ty != V->getType())
       report_fatal_error("Type mismatch in constant table!");
     return cast<Constant>(V);
@@ -811,7 +867,7 @@ Constant *BitcodeReaderValueList::getConstantFwdRef(unsigned Idx,
 
   // Create and return a placeholder, which will later be RAUW'd.
   Constant *C = new ConstantPlaceHolder(Ty, Context);
-  ValuePtrs[Idx] = C;
+  set(Idx, C); // HLSL Change
   return C;
 }
 
@@ -823,7 +879,7 @@ Value *BitcodeReaderValueList::getValueFwdRef(unsigned Idx, Type *Ty) {
   if (Idx >= size())
     resize(Idx + 1);
 
-  if (Value *V = ValuePtrs[Idx]) {
+  if (Value *V = get(Idx)) { // HLSL Change
     // If the types don't match, it's invalid.
     if (Ty && Ty != V->getType())
       return nullptr;
@@ -835,7 +891,7 @@ Value *BitcodeReaderValueList::getValueFwdRef(unsigned Idx, Type *Ty) {
 
   // Create and return a placeholder, which will later be RAUW'd.
   Value *V = new Argument(Ty);
-  ValuePtrs[Idx] = V;
+  set(Idx, V); // HLSL Change
   return V;
 }
 
@@ -1634,6 +1690,38 @@ std::error_code BitcodeReader::parseValueSymbolTable() {
 
 static int64_t unrotateSign(uint64_t U) { return U & 1 ? ~(U >> 1) : U >> 1; }
 
+// HLSL Change Begin
+static bool isDebugInfoMetadataRecord(unsigned Code) {
+  switch (Code) {
+  case bitc::METADATA_LOCATION:
+  case bitc::METADATA_GENERIC_DEBUG:
+  case bitc::METADATA_SUBRANGE:
+  case bitc::METADATA_ENUMERATOR:
+  case bitc::METADATA_BASIC_TYPE:
+  case bitc::METADATA_FILE:
+  case bitc::METADATA_DERIVED_TYPE:
+  case bitc::METADATA_COMPOSITE_TYPE:
+  case bitc::METADATA_SUBROUTINE_TYPE:
+  case bitc::METADATA_COMPILE_UNIT:
+  case bitc::METADATA_SUBPROGRAM:
+  case bitc::METADATA_LEXICAL_BLOCK:
+  case bitc::METADATA_LEXICAL_BLOCK_FILE:
+  case bitc::METADATA_NAMESPACE:
+  case bitc::METADATA_TEMPLATE_TYPE:
+  case bitc::METADATA_TEMPLATE_VALUE:
+  case bitc::METADATA_GLOBAL_VAR:
+  case bitc::METADATA_LOCAL_VAR:
+  case bitc::METADATA_EXPRESSION:
+  case bitc::METADATA_OBJC_PROPERTY:
+  case bitc::METADATA_IMPORTED_ENTITY:
+  case bitc::METADATA_MODULE:
+    return true;
+  default:
+    return false;
+  }
+}
+// HLSL Change End
+
 // HLSL Change - Begin
 // This function takes a list of strings that corresponds to the list of named
 // metadata that we want to materialize, and materialize them efficiently.
@@ -1956,6 +2044,13 @@ std::error_code BitcodeReader::parseMetadata() {
     // If it's a string metadata, use our special Uint8Record to speed
     // up reading.
     unsigned PeekCode = Stream.peekRecord(Entry.ID);
+    // Skipped debug info nodes still take their slot, as an empty tuple, so
+    // that references to them from other nodes stay resolvable.
+    if (ShouldSkipDebugInfo && isDebugInfoMetadataRecord(PeekCode)) {
+      Stream.skipRecord(Entry.ID);
+      MDValueList.assignValue(MDTuple::get(Context, None), NextMDValueNo++);
+      continue;
+    }
     unsigned Code = 0;
     Record.clear();
     if (PeekCode == bitc::METADATA_STRING) {
@@ -1987,6 +2082,11 @@ std::error_code BitcodeReader::parseMetadata() {
       if (NextBitCode != bitc::METADATA_NAMED_NODE)
         return error("METADATA_NAME not followed by METADATA_NAMED_NODE");
 
+      // HLSL Change Begin - drop the debug info roots.
+      if (ShouldSkipDebugInfo && Name.startswith("llvm.dbg."))
+        break;
+      // HLSL Change End
+
       // Read named metadata elements.
       unsigned Size = Record.size();
       NamedMDNode *NMD = TheModule->getOrInsertNamedMetadata(Name);
@@ -3707,6 +3807,7 @@ std::error_code BitcodeReader::parseFunctionBody(Function *F) {
   unsigned CurBBNo = 0;
 
   DebugLoc LastLoc;
+  SmallVector<CallInst *, 16> DebugIntrinsics; // HLSL Change
   auto getLastInstruction = [&]() -> Instruction * {
     if (CurBB && !CurBB->empty())
       return &CurBB->back();
@@ -3808,6 +3909,7 @@ std::error_code BitcodeReader::parseFunctionBody(Function *F) {
     case bitc::FUNC_CODE_DEBUG_LOC_AGAIN:  // DEBUG_LOC_AGAIN
       // This record indicates that the last instruction is at the same
       // location as the previous instruction with a location.
+      if (ShouldSkipDebugInfo) continue; // HLSL Change
       I = getLastInstruction();
 
       if (!I)
@@ -3817,6 +3919,7 @@ std::error_code BitcodeReader::parseFunctionBody(Function *F) {
       continue;
 
     case bitc::FUNC_CODE_DEBUG_LOC: {      // DEBUG_LOC: [line, col, scope, ia]
+      if (ShouldSkipDebugInfo) continue; // HLSL Change
       I = getLastInstruction();
       if (!I || Record.size() < 4)
         return error("Invalid record");
@@ -4738,6 +4841,11 @@ std::error_code BitcodeReader::parseFunctionBody(Function *F) {
         TCK = CallInst::TCK_MustTail;
       cast<CallInst>(I)->setTailCallKind(TCK);
       cast<CallInst>(I)->setAttributes(PAL);
+      // HLSL Change Begin - debug intrinsics stay until the function is
+      // read, since metadata attachments refer to instructions by position.
+      if (ShouldSkipDebugInfo && isa<DbgInfoIntrinsic>(I))
+        DebugIntrinsics.push_back(cast<CallInst>(I));
+      // HLSL Change End
       break;
     }
     case bitc::FUNC_CODE_INST_VAARG: { // VAARG: [valistty, valist, instty]
@@ -4792,6 +4900,11 @@ OutOfRecordLoop:
   // FIXME: Check for unresolved forward-declared metadata references
   // and clean up leaks.
 
+  // HLSL Change Begin - drop the debug intrinsics.
+  for (CallInst *CI : DebugIntrinsics)
+    CI->eraseFromParent();
+  // HLSL Change End
+
   // Trim the value list down to the size it was before we parsed this function.
   ValueList.shrinkTo(ModuleValueListSize);
   MDValueList.shrinkTo(ModuleMDValueListSize);
@@ -5071,7 +5184,8 @@ getLazyBitcodeModuleImpl(std::unique_ptr<MemoryBuffer> &&Buffer,
                          LLVMContext &Context, bool MaterializeAll,
                          DiagnosticHandlerFunction DiagnosticHandler,
                          bool ShouldLazyLoadMetadata = false,
-                         bool ShouldTrackBitstreamUsage = false) // HLSL Change
+                         bool ShouldTrackBitstreamUsage = false, // HLSL Change
+                         bool ShouldSkipDebugInfo = false) // HLSL Change
 {
   // HLSL Change Begin: Proper memory management with unique_ptr
   // Get the buffer identifier before we transfer the ownership to the bitcode reader,
@@ -5081,6 +5195,7 @@ getLazyBitcodeModuleImpl(std::unique_ptr<MemoryBuffer> &&Buffer,
     std::move(Buffer), Context, DiagnosticHandler);
 
   if (R) R->ShouldTrackBitstreamUsage = ShouldTrackBitstreamUsage; // HLSL Change
+  if (R) R->ShouldSkipDebugInfo = ShouldSkipDebugInfo; // HLSL Change
   ErrorOr<std::unique_ptr<Module>> Ret =
       getBitcodeModuleImpl(nullptr, BufferIdentifier, std::move(R), Context,
                            MaterializeAll, ShouldLazyLoadMetadata);
@@ -5094,10 +5209,11 @@ getLazyBitcodeModuleImpl(std::unique_ptr<MemoryBuffer> &&Buffer,
 ErrorOr<std::unique_ptr<Module>> llvm::getLazyBitcodeModule(
     std::unique_ptr<MemoryBuffer> &&Buffer, LLVMContext &Context,
     DiagnosticHandlerFunction DiagnosticHandler, bool ShouldLazyLoadMetadata,
-    bool ShouldTrackBitstreamUsage) {
+    bool ShouldTrackBitstreamUsage, bool ShouldSkipDebugInfo) {
   return getLazyBitcodeModuleImpl(std::move(Buffer), Context, false,
                                   DiagnosticHandler, ShouldLazyLoadMetadata,
-                                  ShouldTrackBitstreamUsage); // HLSL Change
+                                  ShouldTrackBitstreamUsage,
+                                  ShouldSkipDebugInfo); // HLSL Change
 }
 
 ErrorOr<std::unique_ptr<Module>> llvm::getStreamedBitcodeModule(
@@ -58,6 +58,7 @@ enum {
   FUNCTION_INST_RET_VAL_ABBREV,
   FUNCTION_INST_UNREACHABLE_ABBREV,
   FUNCTION_INST_GEP_ABBREV,
+  FUNCTION_INST_CALL_ABBREV, // HLSL Change
 };
 
 static unsigned GetEncodedCastOpcode(unsigned Opcode) {
@@ -1170,6 +1171,7 @@ static void WriteModuleMetadata(const Module *M,
   Stream.EnterSubblock(bitc::METADATA_BLOCK_ID, 3);
 
   unsigned MDSAbbrev = 0;
+  unsigned MDS6Abbrev = 0; // HLSL Change
   if (VE.hasMDString()) {
     // Abbrev for METADATA_STRING.
     IntrusiveRefCntPtr<BitCodeAbbrev> Abbv = new BitCodeAbbrev();
@@ -1177,6 +1179,16 @@ static void WriteModuleMetadata(const Module *M,
     Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::Array));
     Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::Fixed, 8));
     MDSAbbrev = Stream.EmitAbbrev(Abbv.get());
+    // HLSL Change Begin - Most metadata strings are identifiers and semantic
+    // names, so also provide a char6 encoding as for constant strings. The
+    // reader's fast path for metadata strings only handles 8-bit fixed and
+    // char6 elements, so there is no 7-bit variant.
+    Abbv = new BitCodeAbbrev();
+    Abbv->Add(BitCodeAbbrevOp(bitc::METADATA_STRING));
+    Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::Array));
+    Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::Char6));
+    MDS6Abbrev = Stream.EmitAbbrev(Abbv.get());
+    // HLSL Change End
   }
 
   // Initialize MDNode abbreviations.
@@ -1247,8 +1259,18 @@ static void WriteModuleMetadata(const Module *M,
     // Code: [strchar x N]
     Record.append(MDS->bytes_begin(), MDS->bytes_end());
 
+    // HLSL Change Begin - Use the char6 encoding when it fits.
+    unsigned AbbrevToUse = MDS6Abbrev;
+    for (uint64_t C : Record) {
+      if (!BitCodeAbbrevOp::isChar6((char)C)) {
+        AbbrevToUse = MDSAbbrev;
+        break;
+      }
+    }
+    // HLSL Change End
+
     // Emit the finished record.
-    Stream.EmitRecord(bitc::METADATA_STRING, Record, MDSAbbrev);
+    Stream.EmitRecord(bitc::METADATA_STRING, Record, AbbrevToUse); // HLSL Change
     Record.clear();
   }
 
@@ -1972,6 +1994,7 @@ static void WriteInstruction(const Instruction &I, unsigned InstID,
     FunctionType *FTy = CI.getFunctionType();
 
     Code = bitc::FUNC_CODE_INST_CALL;
+    AbbrevToUse = FUNCTION_INST_CALL_ABBREV; // HLSL Change
 
     Vals.push_back(VE.getAttributeID(CI.getAttributes()));
     Vals.push_back((CI.getCallingConv() << 1) | unsigned(CI.isTailCall()) |
@@ -2362,6 +2385,23 @@ static void WriteBlockInfo(const ValueEnumerator &VE, BitstreamWriter &Stream) {
         FUNCTION_INST_GEP_ABBREV)
       llvm_unreachable("Unexpected abbrev ordering!");
   }
+  // HLSL Change Begin - Most DXIL instructions are dx.op calls. The callee and
+  // arguments are relative value ids, with types only for forward references
+  // and varargs, so all of them fit in the trailing array.
+  { // INST_CALL abbrev for FUNCTION_BLOCK.
+    IntrusiveRefCntPtr<BitCodeAbbrev> Abbv = new BitCodeAbbrev();
+    Abbv->Add(BitCodeAbbrevOp(bitc::FUNC_CODE_INST_CALL));
+    Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::VBR, 6));   // paramattrs
+    Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::Fixed, 16)); // cc and flags
+    Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::Fixed,      // fnty
+                              VE.computeBitsRequiredForTypeIndicies()));
+    Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::Array));    // callee, args
+    Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::VBR, 6));
+    if (Stream.EmitBlockInfoAbbrev(bitc::FUNCTION_BLOCK_ID, Abbv.get()) !=
+        FUNCTION_INST_CALL_ABBREV)
+      llvm_unreachable("Unexpected abbrev ordering!");
+  }
+  // HLSL Change End
 
   Stream.ExitBlock();
 }
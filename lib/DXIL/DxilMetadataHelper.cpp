@@ -86,6 +86,7 @@ const char DxilMDHelper::kDxilPreciseAttributeMDName[]                = "dx.prec
 const char DxilMDHelper::kDxilVariableDebugLayoutMDName[]             = "dx.dbg.varlayout";
 const char DxilMDHelper::kDxilTempAllocaMDName[]                      = "dx.temp";
 const char DxilMDHelper::kDxilNonUniformAttributeMDName[]             = "dx.nonuniform";
+const char DxilMDHelper::kDxilUniformityAttributeMDName[]             = "dx.uniformity";
 const char DxilMDHelper::kHLDxilResourceAttributeMDName[]             = "dx.hl.resource.attribute";
 const char DxilMDHelper::kDxilValidatorVersionMDName[]                = "dx.valver";
 const char DxilMDHelper::kDxilDxrPayloadAnnotationsMDName[]           = "dx.dxrPayloadAnnotations";
@@ -2756,6 +2757,16 @@ void DxilMDHelper::MarkNonUniform(Instruction *I) {
   I->setMetadata(DxilMDHelper::kDxilNonUniformAttributeMDName, preciseNode);
 }
 
+void DxilMDHelper::MarkUniformity(Instruction *I, unsigned uniformity) {
+  LLVMContext &Ctx = I->getContext();
+  MDNode *uniformityNode = MDNode::get(
+    Ctx,
+    { ConstantAsMetadata::get(
+        ConstantInt::get(Type::getInt32Ty(Ctx), uniformity)) });
+
+  I->setMetadata(DxilMDHelper::kDxilUniformityAttributeMDName, uniformityNode);
+}
+
 bool DxilMDHelper::GetVariableDebugLayout(llvm::DbgDeclareInst *inst,
     unsigned &StartOffsetInBits, std::vector<DxilDIArrayDim> &ArrayDims) {
   llvm::MDTuple *Tuple = dyn_cast_or_null<MDTuple>(inst->getMetadata(DxilMDHelper::kDxilVariableDebugLayoutMDName));
@@ -19,6 +19,7 @@
 #include "dxc/DXIL/DxilSubobject.h"
 #include "dxc/DXIL/DxilInstructions.h"
 #include "dxc/DXIL/DxilCounters.h"
+#include "dxc/DXIL/DxilOpCallIndex.h"
 
 #include "llvm/IR/Constants.h"
 #include "llvm/IR/Function.h"
@@ -115,6 +116,7 @@ DxilModule::DxilModule(Module *pModule)
 , m_bDisableOptimizations(false)
 , m_bUseMinPrecision(true) // use min precision by default
 , m_bAllResourcesBound(false)
+, m_bResMayAlias(false)
 , m_IntermediateFlags(0)
 , m_AutoBindingSpace(UINT_MAX)
 , m_pSubobjects(nullptr)
@@ -140,6 +142,12 @@ LLVMContext &DxilModule::GetCtx() const { return m_Ctx; }
 Module *DxilModule::GetModule() const { return m_pModule; }
 OP *DxilModule::GetOP() const { return m_pOP.get(); }
 
+DxilOpCallIndex &DxilModule::GetOpCallIndex() {
+  if (!m_pOpCallIndex)
+    m_pOpCallIndex = make_unique<DxilOpCallIndex>(m_pOP.get());
+  return *m_pOpCallIndex;
+}
+
 void DxilModule::SetShaderModel(const ShaderModel *pSM, bool bUseMinPrecision) {
   DXASSERT(m_pSM == nullptr || (pSM != nullptr && *m_pSM == *pSM), "shader model must not change for the module");
   DXASSERT(pSM != nullptr && pSM->IsValidForDxil(), "shader model must be valid");
@@ -310,8 +318,11 @@ unsigned DxilModule::GetGlobalFlags() const {
 }
 
 void DxilModule::CollectShaderFlagsForModule(ShaderFlags &Flags) {
+  // Always scan the functions: callers rely on this to see changes, and
+  // validation must not trust flags cached from earlier in the pipeline.
   for (Function &F : GetModule()->functions()) {
     ShaderFlags funcFlags = ShaderFlags::CollectShaderFlags(&F, this);
+    m_FunctionShaderFlags[&F] = funcFlags;
     Flags.CombineShaderFlags(funcFlags);
   };
 
@@ -366,6 +377,22 @@ void DxilModule::CollectShaderFlagsForModule(ShaderFlags &Flags) {
   Flags.SetCSRawAndStructuredViaShader4X(hasCSRawAndStructuredViaShader4X);
 }
 
+ShaderFlags DxilModule::GetShaderFlagsForFunction(const llvm::Function *F) const {
+  auto it = m_FunctionShaderFlags.find(F);
+  if (it != m_FunctionShaderFlags.end())
+    return it->second;
+  ShaderFlags flags = ShaderFlags::CollectShaderFlags(F, this);
+  m_FunctionShaderFlags[F] = flags;
+  return flags;
+}
+
+void DxilModule::InvalidateShaderFlags(const llvm::Function *F) {
+  if (F)
+    m_FunctionShaderFlags.erase(F);
+  else
+    m_FunctionShaderFlags.clear();
+}
+
 void DxilModule::CollectShaderFlagsForModule() {
   CollectShaderFlagsForModule(m_ShaderFlags);
 
@@ -987,9 +1014,12 @@ static void ConvertUsedResource(std::unordered_set<unsigned> &immResID,
 void DxilModule::RemoveFunction(llvm::Function *F) {
   DXASSERT_NOMSG(F != nullptr);
   m_DxilEntryPropsMap.erase(F);
+  m_FunctionShaderFlags.erase(F);
   if (m_pTypeSystem.get()->GetFunctionAnnotation(F))
     m_pTypeSystem.get()->EraseFunctionAnnotation(F);
   m_pOP->RemoveFunction(F);
+  if (m_pOpCallIndex)
+    m_pOpCallIndex->RemoveFunction(F);
 }
 
 void DxilModule::RemoveUnusedResources() {
@@ -1340,7 +1370,10 @@ void DxilModule::ResetTypeSystem(DxilTypeSystem *pValue) {
   m_pTypeSystem.reset(pValue);
 }
 
-void DxilModule::ResetOP(hlsl::OP *hlslOP) { m_pOP.reset(hlslOP); }
+void DxilModule::ResetOP(hlsl::OP *hlslOP) {
+  m_pOP.reset(hlslOP);
+  m_pOpCallIndex.reset();
+}
 
 void DxilModule::ResetEntryPropsMap(DxilEntryPropsMap &&PropMap) {
   m_DxilEntryPropsMap.clear();
@@ -1401,36 +1434,67 @@ vector<GlobalVariable* > &DxilModule::GetLLVMUsed() {
 }
 
 // DXIL metadata serialization/deserialization.
+// Named metadata that is emitted from the in-memory form: DXIL version,
+// validator version, DXIL shader model, entry point tuples (shader
+// properties, signatures, resources), type system, view ID state, root
+// signature, function properties. Other cases for libs pending.
+// LLVM used is a global variable - handle separately.
+static bool IsEmittedDxilMetadata(StringRef name) {
+  return name == DxilMDHelper::kDxilVersionMDName ||
+         name == DxilMDHelper::kDxilValidatorVersionMDName ||
+         name == DxilMDHelper::kDxilShaderModelMDName ||
+         name == DxilMDHelper::kDxilEntryPointsMDName ||
+         name == DxilMDHelper::kDxilRootSignatureMDName ||
+         name == DxilMDHelper::kDxilIntermediateOptionsMDName ||
+         name == DxilMDHelper::kDxilResourcesMDName ||
+         name == DxilMDHelper::kDxilTypeSystemMDName ||
+         name == DxilMDHelper::kDxilViewIdStateMDName ||
+         name == DxilMDHelper::kDxilSubobjectsMDName ||
+         name == DxilMDHelper::kDxilCountersMDName ||
+         name.startswith(DxilMDHelper::kDxilTypeSystemHelperVariablePrefix);
+}
+
 void DxilModule::ClearDxilMetadata(Module &M) {
-  // Delete: DXIL version, validator version, DXIL shader model,
-  // entry point tuples (shader properties, signatures, resources)
-  // type system, view ID state, LLVM used, entry point tuples,
-  // root signature, function properties.
-  // Other cases for libs pending.
-  // LLVM used is a global variable - handle separately.
   SmallVector<NamedMDNode*, 8> nodes;
   for (NamedMDNode &b : M.named_metadata()) {
-    StringRef name = b.getName();
-    if (name == DxilMDHelper::kDxilVersionMDName ||
-      name == DxilMDHelper::kDxilValidatorVersionMDName ||
-      name == DxilMDHelper::kDxilShaderModelMDName ||
-      name == DxilMDHelper::kDxilEntryPointsMDName ||
-      name == DxilMDHelper::kDxilRootSignatureMDName ||
-      name == DxilMDHelper::kDxilIntermediateOptionsMDName ||
-      name == DxilMDHelper::kDxilResourcesMDName ||
-      name == DxilMDHelper::kDxilTypeSystemMDName ||
-      name == DxilMDHelper::kDxilViewIdStateMDName ||
-      name == DxilMDHelper::kDxilSubobjectsMDName ||
-      name == DxilMDHelper::kDxilCountersMDName ||
-      name.startswith(DxilMDHelper::kDxilTypeSystemHelperVariablePrefix)) {
+    if (IsEmittedDxilMetadata(b.getName()))
       nodes.push_back(&b);
-    }
   }
   for (size_t i = 0; i < nodes.size(); ++i) {
     M.eraseNamedMetadata(nodes[i]);
   }
 }
 
+void DxilModule::SaveDxilMetadata(DxilMetadataSnapshot &Snapshot) const {
+  Snapshot.clear();
+  for (NamedMDNode &b : m_pModule->named_metadata()) {
+    if (!IsEmittedDxilMetadata(b.getName()))
+      continue;
+    Snapshot.emplace_back(b.getName().str(), std::vector<MDNode *>());
+    for (MDNode *pNode : b.operands())
+      Snapshot.back().second.push_back(pNode);
+  }
+}
+
+void DxilModule::RestoreDxilMetadata(const DxilMetadataSnapshot &Snapshot) {
+  // Uniqued metadata nodes live as long as the context, so the saved nodes
+  // are still valid after the named metadata referencing them was erased.
+  ClearDxilMetadata(*m_pModule);
+  for (auto &Saved : Snapshot) {
+    if (Saved.first == DxilMDHelper::kDxilValidatorVersionMDName) {
+      // Also resets the validator version the metadata helper keeps.
+      m_pMDHelper->EmitValidatorVersion(m_ValMajor, m_ValMinor);
+      continue;
+    }
+    NamedMDNode *pNamed = m_pModule->getOrInsertNamedMetadata(Saved.first);
+    for (MDNode *pNode : Saved.second)
+      pNamed->addOperand(pNode);
+  }
+  // The minimum validator version the helper keeps depends on the above.
+  m_pMDHelper->SetShaderModel(m_pSM);
+  EmitLLVMUsed();
+}
+
 void DxilModule::EmitDxilMetadata() {
   m_pMDHelper->EmitDxilVersion(m_DxilMajor, m_DxilMinor);
   m_pMDHelper->EmitValidatorVersion(m_ValMajor, m_ValMinor);
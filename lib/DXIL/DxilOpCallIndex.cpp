@@ -0,0 +1,142 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// DxilOpCallIndex.cpp                                                       //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#include "dxc/DXIL/DxilOpCallIndex.h"
+#include "dxc/DXIL/DxilOperations.h"
+#include "dxc/Support/Global.h"
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/ValueHandle.h"
+
+#include <vector>
+
+using namespace llvm;
+using namespace hlsl;
+
+// Calls to one DXIL operation function, by opcode. A deleted call leaves a
+// null handle behind until the function is indexed again.
+struct DxilOpCallIndex::FunctionCalls {
+  SmallDenseMap<unsigned, std::vector<std::unique_ptr<CallHandle>>, 4> ByOpCode;
+  unsigned NumLiveCalls = 0;
+  // Uses that are not indexed calls, such as the function being passed
+  // as a call argument.
+  unsigned NumOtherUses = 0;
+
+  bool IsCurrent(const Function *F) const {
+    return NumLiveCalls + NumOtherUses == F->getNumUses();
+  }
+  void Build(Function *F);
+  // Returns false if an indexed call no longer calls F.
+  bool AppendCalls(const Function *F, DXIL::OpCode opcode,
+                   SmallVectorImpl<CallInst *> &Calls) const;
+};
+
+class DxilOpCallIndex::CallHandle final : public CallbackVH {
+public:
+  CallHandle(CallInst *CI, FunctionCalls &Owner)
+      : CallbackVH(CI), m_Owner(Owner) {}
+
+  CallInst *getCall() const { return cast_or_null<CallInst>(getValPtr()); }
+
+private:
+  FunctionCalls &m_Owner;
+
+  void deleted() override {
+    setValPtr(nullptr);
+    --m_Owner.NumLiveCalls;
+  }
+  // The call itself stays in place, so nothing changes for the index.
+  void allUsesReplacedWith(Value *) override {}
+};
+
+void DxilOpCallIndex::FunctionCalls::Build(Function *F) {
+  ByOpCode.clear();
+  NumLiveCalls = 0;
+  NumOtherUses = 0;
+  for (User *U : F->users()) {
+    CallInst *CI = dyn_cast<CallInst>(U);
+    ConstantInt *OpCodeArg = nullptr;
+    if (CI && CI->getCalledFunction() == F && CI->getNumArgOperands() > 0)
+      OpCodeArg = dyn_cast<ConstantInt>(CI->getArgOperand(0));
+    if (!OpCodeArg) {
+      ++NumOtherUses;
+      continue;
+    }
+    ByOpCode[(unsigned)OpCodeArg->getLimitedValue()].emplace_back(
+        llvm::make_unique<CallHandle>(CI, *this));
+    ++NumLiveCalls;
+  }
+}
+
+bool DxilOpCallIndex::FunctionCalls::AppendCalls(
+    const Function *F, DXIL::OpCode opcode,
+    SmallVectorImpl<CallInst *> &Calls) const {
+  auto OpCodeCalls = ByOpCode.find((unsigned)opcode);
+  if (OpCodeCalls == ByOpCode.end())
+    return true;
+  for (const std::unique_ptr<CallHandle> &H : OpCodeCalls->second) {
+    CallInst *CI = H->getCall();
+    if (!CI)
+      continue;
+    if (CI->getCalledFunction() != F)
+      return false;
+    Calls.emplace_back(CI);
+  }
+  return true;
+}
+
+DxilOpCallIndex::DxilOpCallIndex(OP *pOP) : m_pOP(pOP) {}
+
+DxilOpCallIndex::~DxilOpCallIndex() {}
+
+DxilOpCallIndex::FunctionCalls &DxilOpCallIndex::GetFunctionCalls(Function *F) {
+  std::unique_ptr<FunctionCalls> &pCalls = m_FunctionCalls[F];
+  if (!pCalls) {
+    pCalls = llvm::make_unique<FunctionCalls>();
+    pCalls->Build(F);
+  } else if (!pCalls->IsCurrent(F)) {
+    pCalls->Build(F);
+  }
+  return *pCalls;
+}
+
+void DxilOpCallIndex::GetCalls(DXIL::OpCode opcode,
+                               SmallVectorImpl<CallInst *> &Calls) {
+  for (auto &it : m_pOP->GetOpFuncList(opcode)) {
+    Function *F = it.second;
+    if (!F)
+      continue;
+    FunctionCalls &FCalls = GetFunctionCalls(F);
+    // A call retargeted to another function while calls were added to this
+    // one leaves the use count unchanged, so indexed calls are checked too.
+    size_t NumCalls = Calls.size();
+    if (!FCalls.AppendCalls(F, opcode, Calls)) {
+      Calls.resize(NumCalls);
+      FCalls.Build(F);
+      FCalls.AppendCalls(F, opcode, Calls);
+    }
+  }
+}
+
+bool DxilOpCallIndex::HasCalls(DXIL::OpCode opcode) {
+  SmallVector<CallInst *, 4> Calls;
+  GetCalls(opcode, Calls);
+  return !Calls.empty();
+}
+
+void DxilOpCallIndex::RemoveFunction(Function *F) {
+  m_FunctionCalls.erase(F);
+}
+
+void DxilOpCallIndex::Invalidate() {
+  m_FunctionCalls.clear();
+}
@@ -16,6 +16,7 @@
 
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/SmallString.h"
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/Module.h"
 #include "llvm/IR/Type.h"
@@ -503,6 +504,18 @@ llvm::StringRef OP::ConstructOverloadName(Type *Ty, DXIL::OpCode opCode,
   return funcNameStorage;
 }
 
+llvm::StringRef OP::ConstructOverloadName(Type *Ty, DXIL::OpCode opCode,
+                                          SmallVectorImpl<char> &funcNameStorage) {
+  funcNameStorage.clear();
+  if (Ty == Type::getVoidTy(Ty->getContext()))
+    return (Twine(OP::m_NamePrefix) + GetOpCodeClassName(opCode))
+        .toStringRef(funcNameStorage);
+  std::string typeNameStorage;
+  return (Twine(OP::m_NamePrefix) + GetOpCodeClassName(opCode) + "." +
+          GetTypeName(Ty, typeNameStorage))
+      .toStringRef(funcNameStorage);
+}
+
 const char *OP::GetOpCodeName(OpCode opCode) {
   DXASSERT(0 <= (unsigned)opCode && opCode < OpCode::NumOpCodes, "otherwise caller passed OOB index");
   return m_OpCodeProps[(unsigned)opCode].pOpCodeName;
@@ -1061,8 +1074,12 @@ void OP::FixOverloadNames() {
 }
 
 void OP::UpdateCache(OpCodeClass opClass, Type * Ty, llvm::Function *F) {
-  m_OpCodeClassCache[(unsigned)opClass].pOverloads[Ty] = F;
-  m_FunctionToOpClass[F] = opClass;
+  OpCodeCacheItem &Cache = m_OpCodeClassCache[(unsigned)opClass];
+  Cache.pOverloads[Ty] = F;
+  unsigned TypeSlot = GetTypeSlot(Ty);
+  if (TypeSlot < kNumScalarTypeOverloads)
+    Cache.pScalarOverloads[TypeSlot] = F;
+  F->setDxilOpClassTag((unsigned)opClass + 1);
 }
 
 Function *OP::GetOpFunc(OpCode opCode, Type *pOverloadType) {
@@ -1070,13 +1087,52 @@ Function *OP::GetOpFunc(OpCode opCode, Type *pOverloadType) {
   _Analysis_assume_(0 <= (unsigned)opCode && opCode < OpCode::NumOpCodes);
   DXASSERT(IsOverloadLegal(opCode, pOverloadType), "otherwise the caller requested illegal operation overload (eg HLSL function with unsupported types for mapped intrinsic function)");
   OpCodeClass opClass = m_OpCodeProps[(unsigned)opCode].opCodeClass;
-  Function *&F = m_OpCodeClassCache[(unsigned)opClass].pOverloads[pOverloadType];
+  OpCodeCacheItem &Cache = m_OpCodeClassCache[(unsigned)opClass];
+  unsigned TypeSlot = GetTypeSlot(pOverloadType);
+  if (TypeSlot < kNumScalarTypeOverloads) {
+    if (Function *ScalarF = Cache.pScalarOverloads[TypeSlot])
+      return ScalarF;
+  }
+  Function *&F = Cache.pOverloads[pOverloadType];
   if (F != nullptr) {
     UpdateCache(opClass, pOverloadType, F);
     return F;
   }
 
-  vector<Type*> ArgTypes;      // RetType is ArgTypes[0]
+  SmallString<64> funcName;
+  ConstructOverloadName(pOverloadType, opCode, funcName);
+
+  // Try to find exist function with the same name in the module.
+  if (Function *existF = m_pModule->getFunction(funcName)) {
+    F = existF;
+    UpdateCache(opClass, pOverloadType, F);
+    return F;
+  }
+
+  // The name is known to be free, so create the declaration directly.
+  F = Function::Create(GetOpFuncType(opCode, pOverloadType),
+                       GlobalValue::ExternalLinkage, funcName, m_pModule);
+
+  UpdateCache(opClass, pOverloadType, F);
+  F->setCallingConv(CallingConv::C);
+  F->setAttributes(GetOpFuncAttributes(opCode));
+
+  return F;
+}
+
+FunctionType *OP::GetOpFuncType(OpCode opCode, Type *pOverloadType) {
+  // Signatures only depend on the opcode class and the overload, so the ones
+  // for scalar overloads are kept to recreate removed declarations cheaply.
+  OpCodeClass opClass = m_OpCodeProps[(unsigned)opCode].opCodeClass;
+  unsigned TypeSlot = GetTypeSlot(pOverloadType);
+  FunctionType **ppScalarFT = nullptr;
+  if (TypeSlot < kNumScalarTypeOverloads) {
+    ppScalarFT = &m_OpCodeClassCache[(unsigned)opClass].pScalarFuncTypes[TypeSlot];
+    if (*ppScalarFT)
+      return *ppScalarFT;
+  }
+
+  SmallVector<Type*, 16> ArgTypes;      // RetType is ArgTypes[0]
   Type *pETy = pOverloadType;
   Type *pRes = GetHandleType();
   Type *pDim = GetDimensionsType();
@@ -1102,16 +1158,6 @@ Function *OP::GetOpFunc(OpCode opCode, Type *pOverloadType) {
   Type *resProperty = GetResourcePropertiesType();
   Type *resBind = GetResourceBindingType();
 
-  std::string funcName;
-  ConstructOverloadName(pOverloadType, opCode, funcName);
-
-  // Try to find exist function with the same name in the module.
-  if (Function *existF = m_pModule->getFunction(funcName)) {
-    F = existF;
-    UpdateCache(opClass, pOverloadType, F);
-    return F;
-  }
-
 #define A(_x) ArgTypes.emplace_back(_x)
 #define RRT(_y) A(GetResRetType(_y))
 #define CBRT(_y) A(GetCBufferRetType(_y))
@@ -1502,16 +1548,22 @@ Function *OP::GetOpFunc(OpCode opCode, Type *pOverloadType) {
   FunctionType *pFT;
   DXASSERT(ArgTypes.size() > 1, "otherwise forgot to initialize arguments");
   pFT = FunctionType::get(ArgTypes[0], ArrayRef<Type*>(&ArgTypes[1], ArgTypes.size()-1), false);
+  if (ppScalarFT)
+    *ppScalarFT = pFT;
+  return pFT;
+}
 
-  F = cast<Function>(m_pModule->getOrInsertFunction(funcName, pFT));
-
-  UpdateCache(opClass, pOverloadType, F);
-  F->setCallingConv(CallingConv::C);
-  F->addFnAttr(Attribute::NoUnwind);
-  if (m_OpCodeProps[(unsigned)opCode].FuncAttr != Attribute::None)
-    F->addFnAttr(m_OpCodeProps[(unsigned)opCode].FuncAttr);
-
-  return F;
+AttributeSet OP::GetOpFuncAttributes(OpCode opCode) {
+  Attribute::AttrKind FuncAttr = m_OpCodeProps[(unsigned)opCode].FuncAttr;
+  AttributeSet &Attrs = m_FuncAttributes[FuncAttr];
+  if (Attrs.isEmpty()) {
+    AttrBuilder B;
+    B.addAttribute(Attribute::NoUnwind);
+    if (FuncAttr != Attribute::None)
+      B.addAttribute(FuncAttr);
+    Attrs = AttributeSet::get(m_Ctx, AttributeSet::FunctionIndex, B);
+  }
+  return Attrs;
 }
 
 const SmallMapVector<llvm::Type *, llvm::Function *, 8> &
@@ -1540,26 +1592,33 @@ bool OP::IsDxilOpUsed(OpCode opcode) const {
 
 void OP::RemoveFunction(Function *F) {
   if (OP::IsDxilOpFunc(F)) {
-    OpCodeClass opClass = m_FunctionToOpClass[F];
-    for (auto it : m_OpCodeClassCache[(unsigned)opClass].pOverloads) {
+    OpCodeClass opClass;
+    if (!GetOpCodeClass(F, opClass))
+      return;
+    OpCodeCacheItem &Cache = m_OpCodeClassCache[(unsigned)opClass];
+    for (auto it : Cache.pOverloads) {
       if (it.second == F) {
-        m_OpCodeClassCache[(unsigned)opClass].pOverloads.erase(it.first);
-        m_FunctionToOpClass.erase(F);
+        Cache.pOverloads.erase(it.first);
         break;
       }
     }
+    for (Function *&ScalarF : Cache.pScalarOverloads) {
+      if (ScalarF == F)
+        ScalarF = nullptr;
+    }
+    F->setDxilOpClassTag(0);
   }
 }
 
 bool OP::GetOpCodeClass(const Function *F, OP::OpCodeClass &opClass) {
-  auto iter = m_FunctionToOpClass.find(F);
-  if (iter == m_FunctionToOpClass.end()) {
+  unsigned Tag = F->getDxilOpClassTag();
+  if (Tag == 0) {
     // When no user, cannot get opcode.
     DXASSERT(F->user_empty() || !IsDxilOpFunc(F), "dxil function without an opcode class mapping?");
     opClass = OP::OpCodeClass::NumOpClasses;
     return false;
   }
-  opClass = iter->second;
+  opClass = (OP::OpCodeClass)(Tag - 1);
   return true;
 }
 
@@ -13,6 +13,8 @@
 #include "dxc/DXIL/DxilShaderModel.h"
 #include "dxc/Support/Global.h"
 
+#include <algorithm>
+#include <iterator>
 #include <string>
 
 using std::string;
@@ -30,16 +32,60 @@ Semantic::Semantic(Kind Kind,
 {
 }
 
+namespace {
+// Open-addressed hash table of the system semantics, for name lookups during
+// signature lowering and validation. Names match case-insensitively, so the
+// hash folds case as well.
+class SemanticNameTable {
+public:
+  SemanticNameTable() {
+    std::fill(std::begin(m_Slots), std::end(m_Slots), kEmpty);
+    for (unsigned i = (unsigned)Semantic::Kind::Arbitrary + 1;
+         i < (unsigned)Semantic::Kind::Invalid; i++) {
+      unsigned slot = Hash(Semantic::Get((Semantic::Kind)i)->GetName());
+      while (m_Slots[slot] != kEmpty)
+        slot = (slot + 1) & (kNumSlots - 1);
+      m_Slots[slot] = (uint8_t)i;
+    }
+  }
+
+  const Semantic *Find(llvm::StringRef name) const {
+    for (unsigned slot = Hash(name); m_Slots[slot] != kEmpty;
+         slot = (slot + 1) & (kNumSlots - 1)) {
+      const Semantic *pSemantic = Semantic::Get((Semantic::Kind)m_Slots[slot]);
+      if (name.compare_lower(pSemantic->GetName()) == 0)
+        return pSemantic;
+    }
+    return nullptr;
+  }
+
+private:
+  // Power of two, at least twice the number of system semantics.
+  static const unsigned kNumSlots = 128;
+  static const uint8_t kEmpty = 0; // Kind::Arbitrary is never in the table.
+  static_assert((unsigned)Semantic::Kind::Invalid * 2 <= kNumSlots,
+                "semantic name table is too small");
+  uint8_t m_Slots[kNumSlots];
+
+  static unsigned Hash(llvm::StringRef name) {
+    uint32_t h = 2166136261u; // FNV-1a
+    for (char c : name) {
+      if (c >= 'A' && c <= 'Z')
+        c = c - 'A' + 'a';
+      h = (h ^ (uint8_t)c) * 16777619u;
+    }
+    return h & (kNumSlots - 1);
+  }
+};
+} // namespace
+
 const Semantic *Semantic::GetByName(llvm::StringRef name) {
   if (!HasSVPrefix(name))
     return GetArbitrary();
 
-  // The search is a simple linear scan as it is fairly infrequent operation and the list is short.
-  // The search can be improved if linear traversal has inadequate performance.
-  for (unsigned i = (unsigned)Kind::Arbitrary + 1; i < (unsigned)Kind::Invalid; i++) {
-    if (name.compare_lower(ms_SemanticTable[i].m_pszName) == 0)
-      return &ms_SemanticTable[i];
-  }
+  static const SemanticNameTable s_NameTable;
+  if (const Semantic *pSemantic = s_NameTable.Find(name))
+    return pSemantic;
 
   return GetInvalid();
 }
@@ -13,6 +13,7 @@
 #include "dxc/DXIL/DxilResource.h"
 #include "dxc/DXIL/DxilResourceBinding.h"
 #include "dxc/Support/Global.h"
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/Instructions.h"
 #include "llvm/IR/Constants.h"
@@ -241,7 +242,11 @@ static CallInst *FindCallToCreateHandle(Value *handleType) {
   return CI;
 }
 
-DxilResourceProperties GetResourcePropertyFromHandleCall(const hlsl::DxilModule *M, CallInst *handleCall) {
+// Library UAVs by global symbol, so handles don't search the UAV table.
+typedef DenseMap<const Value *, DxilResource *> UAVSymbolMap;
+
+DxilResourceProperties GetResourcePropertyFromHandleCall(const hlsl::DxilModule *M, CallInst *handleCall,
+                                                         const UAVSymbolMap &uavSymbols) {
 
   DxilResourceProperties RP;
 
@@ -269,12 +274,9 @@ DxilResourceProperties GetResourcePropertyFromHandleCall(const hlsl::DxilModule
     // If library handle, find DxilResource by checking the name
     if (LoadInst *LI = dyn_cast<LoadInst>(handleCall->getArgOperand(
             DXIL::OperandIndex::kCreateHandleForLibResOpIdx))) {
-      Value *resType = LI->getOperand(0);
-      for (auto &&res : M->GetUAVs()) {
-        if (res->GetGlobalSymbol() == resType) {
-          RP = resource_helper::loadPropsFromResourceBase(res.get());
-        }
-      }
+      auto it = uavSymbols.find(LI->getOperand(0));
+      if (it != uavSymbols.end())
+        RP = resource_helper::loadPropsFromResourceBase(it->second);
     }
   } else if (handleOp == DXIL::OpCode::AnnotateHandle) {
     DxilInst_AnnotateHandle annotateHandle(cast<Instruction>(handleCall));
@@ -309,7 +311,8 @@ struct ResKeyHash {
 // Limited to retrieving handles created by CreateHandleFromBinding and CreateHandleForLib. returns null otherwise
 // map should contain resources indexed by space, class, lower, and upper bounds
 DxilResource *GetResourceFromAnnotateHandle(const hlsl::DxilModule *M, CallInst *handleCall,
-                                     std::unordered_map<ResourceKey, DxilResource *, ResKeyHash, ResKeyEq> resMap) {
+                                     const std::unordered_map<ResourceKey, DxilResource *, ResKeyHash, ResKeyEq> &resMap,
+                                     const UAVSymbolMap &uavSymbols) {
   DxilResource *resource = nullptr;
 
   ConstantInt *HandleOpCodeConst = cast<ConstantInt>(
@@ -325,17 +328,16 @@ DxilResource *GetResourceFromAnnotateHandle(const hlsl::DxilModule *M, CallInst
       DxilInst_CreateHandleFromBinding fromBind(createCall);
       DxilResourceBinding B = resource_helper::loadBindingFromConstant(*cast<Constant>(fromBind.get_bind()));
       ResourceKey key = {B.resourceClass, B.spaceID, B.rangeLowerBound, B.rangeUpperBound};
-      resource = resMap[key];
+      auto it = resMap.find(key);
+      if (it != resMap.end())
+        resource = it->second;
     } else if (handleOp == DXIL::OpCode::CreateHandleForLib) {
       // If library handle, find DxilResource by checking the name
       if (LoadInst *LI = dyn_cast<LoadInst>(createCall->getArgOperand(
                                               DXIL::OperandIndex::kCreateHandleForLibResOpIdx))) {
-        Value *resType = LI->getOperand(0);
-        for (auto &&res : M->GetUAVs()) {
-          if (res->GetGlobalSymbol() == resType) {
-            return resource = res.get();
-          }
-        }
+        auto it = uavSymbols.find(LI->getOperand(0));
+        if (it != uavSymbols.end())
+          resource = it->second;
       }
     }
   }
@@ -396,10 +398,12 @@ ShaderFlags ShaderFlags::CollectShaderFlags(const Function *F,
 
   // Set up resource to binding handle map for 64-bit atomics usage
   std::unordered_map<ResourceKey, DxilResource *, ResKeyHash, ResKeyEq> resMap;
+  UAVSymbolMap uavSymbols;
   for (auto &res : M->GetUAVs()) {
     ResourceKey key = {(uint8_t)res->GetClass(), res->GetSpaceID(),
                        res->GetLowerBound(), res->GetUpperBound()};
     resMap.insert({key, res.get()});
+    uavSymbols.insert({res->GetGlobalSymbol(), res.get()});
     if (res->GetKind() == DXIL::ResourceKind::Texture2DMS ||
         res->GetKind() == DXIL::ResourceKind::Texture2DMSArray)
       hasWriteableMSAATextures = true;
@@ -483,7 +487,7 @@ ShaderFlags ShaderFlags::CollectShaderFlags(const Function *F,
           CallInst *handleCall = FindCallToCreateHandle(resHandle);
           // Check if this is a library handle or general create handle
           if (handleCall) {
-            DxilResourceProperties RP = GetResourcePropertyFromHandleCall(M, handleCall);
+            DxilResourceProperties RP = GetResourcePropertyFromHandleCall(M, handleCall, uavSymbols);
             if (RP.isUAV()) {
               // Validator 1.0 assumes that all uav load is multi component load.
               if (hasMulticomponentUAVLoadsBackCompat) {
@@ -518,11 +522,11 @@ ShaderFlags ShaderFlags::CollectShaderFlags(const Function *F,
           if (isInt64) {
             Value *resHandle = CI->getArgOperand(DXIL::OperandIndex::kAtomicBinOpHandleOpIdx);
             CallInst *handleCall = FindCallToCreateHandle(resHandle);
-            DxilResourceProperties RP = GetResourcePropertyFromHandleCall(M, handleCall);
+            DxilResourceProperties RP = GetResourcePropertyFromHandleCall(M, handleCall, uavSymbols);
             if (DXIL::IsTyped(RP.getResourceKind()))
                 hasAtomicInt64OnTypedResource = true;
             // set uses 64-bit flag if relevant
-            if (DxilResource *res = GetResourceFromAnnotateHandle(M, handleCall, resMap)) {
+            if (DxilResource *res = GetResourceFromAnnotateHandle(M, handleCall, resMap, uavSymbols)) {
               res->SetHasAtomic64Use(true);
             } else {
               // Assuming CreateHandleFromHeap, which indicates a descriptor
@@ -565,7 +569,7 @@ ShaderFlags ShaderFlags::CollectShaderFlags(const Function *F,
             if (!hasUAVs) {
               // If not already marked, check if UAV.
               DxilResourceProperties RP = GetResourcePropertyFromHandleCall(
-                  M, const_cast<CallInst *>(CI));
+                  M, const_cast<CallInst *>(CI), uavSymbols);
               if (RP.isUAV())
                 hasUAVs = true;
             }
@@ -86,6 +86,24 @@ const std::vector<std::unique_ptr<DxilSignatureElement> > &DxilSignature::GetEle
   return m_Elements;
 }
 
+std::vector<unsigned>
+DxilSignature::DeleteElements(const std::vector<bool> &Deleted) {
+  DXASSERT_NOMSG(Deleted.size() == m_Elements.size());
+  std::vector<unsigned> NewIDs(m_Elements.size(), UINT_MAX);
+  unsigned NewID = 0;
+  for (unsigned i = 0; i < m_Elements.size(); ++i) {
+    if (Deleted[i])
+      continue;
+    NewIDs[i] = NewID;
+    m_Elements[i]->SetID(NewID);
+    if (i != NewID)
+      m_Elements[NewID] = std::move(m_Elements[i]);
+    ++NewID;
+  }
+  m_Elements.resize(NewID);
+  return NewIDs;
+}
+
 bool DxilSignature::ShouldBeAllocated(DXIL::SemanticInterpretationKind Kind) {
   switch (Kind) {
   case DXIL::SemanticInterpretationKind::NA:
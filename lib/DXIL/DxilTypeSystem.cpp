@@ -68,16 +68,27 @@ void DxilFieldAnnotation::SetCBufferOffset(unsigned Offset) { m_CBufferOffset =
 bool DxilFieldAnnotation::HasCompType() const { return m_CompType.GetKind() != CompType::Kind::Invalid; }
 const CompType &DxilFieldAnnotation::GetCompType() const { return m_CompType; }
 void DxilFieldAnnotation::SetCompType(CompType::Kind kind) { m_CompType = CompType(kind); }
-bool DxilFieldAnnotation::HasSemanticString() const { return !m_Semantic.empty(); }
-const std::string &DxilFieldAnnotation::GetSemanticString() const { return m_Semantic; }
-llvm::StringRef DxilFieldAnnotation::GetSemanticStringRef() const { return llvm::StringRef(m_Semantic); }
-void DxilFieldAnnotation::SetSemanticString(const std::string &SemString) { m_Semantic = SemString; }
+static const std::string &GetSharedString(const std::shared_ptr<const std::string> &Str) {
+  static const std::string EmptyString;
+  return Str ? *Str : EmptyString;
+}
+static void SetSharedString(std::shared_ptr<const std::string> &Str, const std::string &Value) {
+  if (Value.empty())
+    Str.reset();
+  else if (!Str || *Str != Value)
+    Str = std::make_shared<const std::string>(Value);
+}
+
+bool DxilFieldAnnotation::HasSemanticString() const { return m_Semantic != nullptr; }
+const std::string &DxilFieldAnnotation::GetSemanticString() const { return GetSharedString(m_Semantic); }
+llvm::StringRef DxilFieldAnnotation::GetSemanticStringRef() const { return llvm::StringRef(GetSemanticString()); }
+void DxilFieldAnnotation::SetSemanticString(const std::string &SemString) { SetSharedString(m_Semantic, SemString); }
 bool DxilFieldAnnotation::HasInterpolationMode() const { return !m_InterpMode.IsUndefined(); }
 const InterpolationMode &DxilFieldAnnotation::GetInterpolationMode() const { return m_InterpMode; }
 void DxilFieldAnnotation::SetInterpolationMode(const InterpolationMode &IM) { m_InterpMode = IM; }
-bool DxilFieldAnnotation::HasFieldName() const { return !m_FieldName.empty(); }
-const std::string &DxilFieldAnnotation::GetFieldName() const { return m_FieldName; }
-void DxilFieldAnnotation::SetFieldName(const std::string &FieldName) { m_FieldName = FieldName; }
+bool DxilFieldAnnotation::HasFieldName() const { return m_FieldName != nullptr; }
+const std::string &DxilFieldAnnotation::GetFieldName() const { return GetSharedString(m_FieldName); }
+void DxilFieldAnnotation::SetFieldName(const std::string &FieldName) { SetSharedString(m_FieldName, FieldName); }
 bool DxilFieldAnnotation::IsCBVarUsed() const { return m_bCBufferVarUsed; }
 void DxilFieldAnnotation::SetCBVarUsed(bool used) { m_bCBufferVarUsed = used; }
 
@@ -328,6 +339,9 @@ void DxilTypeSystem::FinishStructAnnotation(DxilStructAnnotation &SA) {
   // Mark if empty
   if (SA.GetCBufferSize() == 0)
     SA.MarkEmptyStruct();
+
+  for (DxilFieldAnnotation &Field : SA.m_FieldAnnotations)
+    InternStrings(Field);
 }
 
 DxilStructAnnotation *DxilTypeSystem::GetStructAnnotation(const StructType *pStructType) {
@@ -477,6 +491,25 @@ void DxilTypeSystem::FinishFunctionAnnotation(DxilFunctionAnnotation &FA) {
     if (IsResourceContained(FT->getParamType(i)))
       FA.SetContainsResourceArgs();
   }
+
+  InternStrings(FA.m_retTypeAnnotation);
+  for (DxilParameterAnnotation &Param : FA.m_parameterAnnotations)
+    InternStrings(Param);
+}
+
+void DxilTypeSystem::InternStrings(DxilFieldAnnotation &FA) {
+  InternString(FA.m_Semantic);
+  InternString(FA.m_FieldName);
+}
+
+void DxilTypeSystem::InternString(std::shared_ptr<const std::string> &Str) {
+  if (!Str)
+    return;
+  auto &Pooled = m_StringPool[*Str];
+  if (Pooled)
+    Str = Pooled;
+  else
+    Pooled = Str;
 }
 
 DxilFunctionAnnotation *DxilTypeSystem::GetFunctionAnnotation(const Function *pFunction) {
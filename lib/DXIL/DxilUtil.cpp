@@ -14,6 +14,7 @@
 #include "dxc/DXIL/DxilUtil.h"
 #include "dxc/DXIL/DxilModule.h"
 #include "dxc/DXIL/DxilOperations.h"
+#include "dxc/DXIL/DxilInstructions.h"
 #include "dxc/HLSL/DxilConvergentName.h"
 #include "dxc/Support/Global.h"
 #include "llvm/ADT/StringExtras.h"
@@ -950,6 +951,21 @@ Value *GetConvergentSource(Value *V) {
   return cast<CallInst>(V)->getOperand(0);
 }
 
+Value *GetBufferKeyForHandle(Value *Handle) {
+  CallInst *CI = dyn_cast<CallInst>(Handle);
+  while (CI && OP::IsDxilOpFuncCallInst(CI, OP::OpCode::AnnotateHandle)) {
+    Handle = DxilInst_AnnotateHandle(CI).get_res();
+    CI = dyn_cast<CallInst>(Handle);
+  }
+  if (!CI || !OP::IsDxilOpFuncCallInst(CI, OP::OpCode::CreateHandleForLib))
+    return Handle;
+  DxilInst_CreateHandleForLib createHandle(CI);
+  if (LoadInst *LI = dyn_cast<LoadInst>(createHandle.get_Resource()))
+    if (GlobalVariable *GV = dyn_cast<GlobalVariable>(LI->getPointerOperand()))
+      return GV;
+  return Handle;
+}
+
 bool isCompositeType(Type *Ty) {
   return isa<ArrayType>(Ty) || isa<StructType>(Ty) || isa<VectorType>(Ty);
 }
@@ -61,6 +61,20 @@ LoadModuleFromBitcodeLazy(std::unique_ptr<llvm::MemoryBuffer> &&MB,
   return std::unique_ptr<llvm::Module>(pModule.get().release());
 }
 
+std::unique_ptr<llvm::Module>
+LoadModuleFromBitcodeWithoutDebugInfo(std::unique_ptr<llvm::MemoryBuffer> &&MB,
+                                      llvm::LLVMContext &Ctx,
+                                      std::string &DiagStr) {
+  // Note: the DiagStr is not used.
+  auto pModule = llvm::getLazyBitcodeModule(
+      std::move(MB), Ctx, nullptr, /*ShouldLazyLoadMetadata*/ false,
+      /*ShouldTrackBitstreamUsage*/ false, /*ShouldSkipDebugInfo*/ true);
+  if (!pModule) {
+    return nullptr;
+  }
+  return std::unique_ptr<llvm::Module>(pModule.get().release());
+}
+
 std::unique_ptr<llvm::Module> LoadModuleFromBitcode(llvm::StringRef BC,
                                                     llvm::LLVMContext &Ctx,
                                                     std::string &DiagStr) {
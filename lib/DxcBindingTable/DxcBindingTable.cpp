@@ -19,7 +19,9 @@
 #include "dxc/DXIL/DxilResourceBase.h"
 
 #include <ctype.h>
+#include <algorithm>
 #include <set>
+#include <vector>
 
 using namespace llvm;
 using namespace hlsl;
@@ -392,13 +394,32 @@ bool hlsl::ParseBindingTable(llvm::StringRef fileName, llvm::StringRef content,
   return true;
 }
 
-typedef std::pair<std::string, hlsl::DXIL::ResourceClass> ResourceKey;
-typedef std::map<ResourceKey, DxilResourceBase *> ResourceMap;
+namespace {
+struct BindingTableEntry {
+  StringRef name;
+  hlsl::DXIL::ResourceClass cls;
+  unsigned index;
+  unsigned space;
+
+  bool operator<(const BindingTableEntry &other) const {
+    if (int cmp = name.compare(other.name))
+      return cmp < 0;
+    return cls < other.cls;
+  }
+};
+typedef std::vector<BindingTableEntry> BindingTableEntries;
+}
 
+// Applies the entries for each resource, in table order, until one allocates it.
 template<typename T>
-static inline void GatherResources(const std::vector<std::unique_ptr<T> > &List, ResourceMap *Map) {
+static inline void ApplyBindings(const std::vector<std::unique_ptr<T> > &List, const BindingTableEntries &entries) {
   for (const std::unique_ptr<T> &ptr : List) {
-    (*Map)[ResourceKey(ptr->GetGlobalName(), ptr->GetClass())] = ptr.get();
+    BindingTableEntry key = { ptr->GetGlobalName(), ptr->GetClass(), 0, 0 };
+    for (auto it = std::lower_bound(entries.begin(), entries.end(), key);
+         it != entries.end() && !(key < *it) && !ptr->IsAllocated(); ++it) {
+      ptr->SetLowerBound(it->index);
+      ptr->SetSpaceID(it->space);
+    }
   }
 }
 
@@ -437,12 +458,10 @@ void hlsl::ApplyBindingTableFromMetadata(DxilModule &DM) {
   if (!bindings)
     return;
 
-  ResourceMap resourceMap;
-  GatherResources(DM.GetCBuffers(), &resourceMap);
-  GatherResources(DM.GetSRVs(),     &resourceMap);
-  GatherResources(DM.GetUAVs(),     &resourceMap);
-  GatherResources(DM.GetSamplers(), &resourceMap);
-
+  // Read the table into a flat array sorted by name and class, and look up
+  // each resource in it, instead of searching the resources for each entry.
+  BindingTableEntries entries;
+  entries.reserve(bindings->getNumOperands());
   for (MDNode *mdEntry : bindings->operands()) {
 
     Metadata *nameMD  = mdEntry->getOperand(DxilMDHelper::kDxilDxcBindingTableResourceName);
@@ -450,20 +469,18 @@ void hlsl::ApplyBindingTableFromMetadata(DxilModule &DM) {
     Metadata *indexMD = mdEntry->getOperand(DxilMDHelper::kDxilDxcBindingTableResourceIndex);
     Metadata *spaceMD = mdEntry->getOperand(DxilMDHelper::kDxilDxcBindingTableResourceSpace);
 
-    StringRef name = cast<MDString>(nameMD)->getString();
-    hlsl::DXIL::ResourceClass cls =
+    BindingTableEntry entry;
+    entry.name = cast<MDString>(nameMD)->getString();
+    entry.cls =
       (hlsl::DXIL::ResourceClass)cast<ConstantInt>(cast<ValueAsMetadata>(classMD)->getValue())->getLimitedValue();
-    unsigned index = cast<ConstantInt>(cast<ValueAsMetadata>(indexMD)->getValue())->getLimitedValue();
-    unsigned space = cast<ConstantInt>(cast<ValueAsMetadata>(spaceMD)->getValue())->getLimitedValue();
-
-    auto it = resourceMap.find(ResourceKey(name, cls));
-    if (it != resourceMap.end()) {
-      DxilResourceBase *resource = it->second;
-      if (!resource->IsAllocated()) {
-        resource->SetLowerBound(index);
-        resource->SetSpaceID(space);
-      }
-    }
+    entry.index = cast<ConstantInt>(cast<ValueAsMetadata>(indexMD)->getValue())->getLimitedValue();
+    entry.space = cast<ConstantInt>(cast<ValueAsMetadata>(spaceMD)->getValue())->getLimitedValue();
+    entries.push_back(entry);
   }
-}
+  std::stable_sort(entries.begin(), entries.end());
 
+  ApplyBindings(DM.GetCBuffers(), entries);
+  ApplyBindings(DM.GetSRVs(),     entries);
+  ApplyBindings(DM.GetUAVs(),     entries);
+  ApplyBindings(DM.GetSamplers(), entries);
+}
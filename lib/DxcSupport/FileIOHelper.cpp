@@ -22,6 +22,11 @@
 
 #ifdef _WIN32
 #include <intsafe.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 #endif
 
 // CP_UTF8 is defined in WinNls.h, but others we use are not defined there.
@@ -402,12 +407,147 @@ public:
   // Relatively dangerous API. This means the buffer should be pinned for as
   // long as this object is alive.
   void ClearFreeFlag() { m_MallocFree = 0; }
+
+  // Like AdjustPtrAndSize, but the owner guarantees the new range is
+  // readable even where it extends past the owner's buffer size.
+  void SetPtrAndSize(LPCVOID buffer, SIZE_T size) {
+    m_Buffer = buffer;
+    m_BufferSize = size;
+  }
 };
 
 typedef InternalDxcBlobEncoding_Impl<DxcBlobNoEncoding_Impl> InternalDxcBlobEncoding;
 typedef InternalDxcBlobEncoding_Impl<DxcBlobWide_Impl> InternalDxcBlobWide;
 typedef InternalDxcBlobEncoding_Impl<DxcBlobUtf8_Impl> InternalDxcBlobUtf8;
 
+} // namespace hlsl
+
+// Private interface to recognize mapped files among other blobs.
+CROSS_PLATFORM_UUIDOF(DxcMappedFileBlob, "6f4d0c1e-93a2-4b57-8e1d-2c7a5b9f0e36")
+// A read-only view of a whole file. Mappings are only made when the file
+// does not end on a page boundary, so the byte after the contents is a
+// readable zero and the contents can be used as a null-terminated string
+// without a copy. As with any mapping, the file must not be truncated while
+// the blob is alive.
+struct DxcMappedFileBlob : public IDxcBlobEncoding {
+private:
+  // Files smaller than this are read into memory; mapping them costs more
+  // than the copy it saves.
+  static const SIZE_T kMinMappedFileSize = 64 * 1024;
+
+  DXC_MICROCOM_TM_REF_FIELDS()
+  void *m_pView = nullptr;
+  SIZE_T m_Size = 0;
+  bool m_EncodingKnown = false;
+  UINT32 m_CodePage = 0;
+
+public:
+  DXC_MICROCOM_TM_ADDREF_RELEASE_IMPL()
+  DXC_MICROCOM_TM_CTOR(DxcMappedFileBlob)
+  HRESULT STDMETHODCALLTYPE QueryInterface(REFIID iid, void **ppvObject) override {
+    return DoBasicQueryInterface<IDxcBlob, IDxcBlobEncoding, DxcMappedFileBlob>(
+        this, iid, ppvObject);
+  }
+
+  ~DxcMappedFileBlob() {
+    if (m_pView) {
+#ifdef _WIN32
+      UnmapViewOfFile(m_pView);
+#else
+      munmap(m_pView, m_Size);
+#endif
+    }
+  }
+
+  // Maps pFileName. Returns S_FALSE if the file is not worth mapping or
+  // cannot be mapped, so that the caller can fall back to reading it.
+  HRESULT Map(LPCWSTR pFileName, bool encodingKnown, UINT32 codePage) {
+    m_EncodingKnown = encodingKnown;
+    m_CodePage = codePage;
+#ifdef _WIN32
+    HANDLE hFile = CreateFileW(pFileName, GENERIC_READ, FILE_SHARE_READ, NULL,
+                               OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (hFile == INVALID_HANDLE_VALUE)
+      return S_FALSE;
+    CHandle h(hFile);
+    LARGE_INTEGER FileSize;
+    if (!GetFileSizeEx(hFile, &FileSize) || FileSize.u.HighPart != 0)
+      return S_FALSE;
+    SYSTEM_INFO SysInfo;
+    GetSystemInfo(&SysInfo);
+    if (!IsWorthMapping(FileSize.u.LowPart, SysInfo.dwPageSize))
+      return S_FALSE;
+    HANDLE hMapping =
+        CreateFileMappingW(hFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (hMapping == nullptr)
+      return S_FALSE;
+    // The view keeps the mapping alive once its handle is closed.
+    CHandle hm(hMapping);
+    m_pView = MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, 0);
+    if (m_pView == nullptr)
+      return S_FALSE;
+    m_Size = FileSize.u.LowPart;
+#else
+    std::string FileName;
+    if (!Unicode::WideToUTF8String(pFileName, &FileName))
+      return S_FALSE;
+    int fd = open(FileName.c_str(), O_RDONLY);
+    if (fd < 0)
+      return S_FALSE;
+    struct stat FileStat;
+    if (fstat(fd, &FileStat) != 0 || !S_ISREG(FileStat.st_mode) ||
+        FileStat.st_size > UINT32_MAX ||
+        !IsWorthMapping(FileStat.st_size, sysconf(_SC_PAGESIZE))) {
+      close(fd);
+      return S_FALSE;
+    }
+    void *pView = mmap(nullptr, FileStat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (pView == MAP_FAILED)
+      return S_FALSE;
+    m_pView = pView;
+    m_Size = FileStat.st_size;
+#endif
+    return S_OK;
+  }
+
+  static bool IsWorthMapping(SIZE_T size, SIZE_T pageSize) {
+    return size >= kMinMappedFileSize && pageSize && (size % pageSize) != 0;
+  }
+
+  // Whether [pData, pData + size) ends exactly at the end of this file, so
+  // that one more (zero) byte can be read.
+  bool EndsAtFileEnd(const void *pData, SIZE_T size) const {
+    return (const char *)pData + size == (const char *)m_pView + m_Size;
+  }
+
+  virtual LPVOID STDMETHODCALLTYPE GetBufferPointer(void) override {
+    return m_pView;
+  }
+  virtual SIZE_T STDMETHODCALLTYPE GetBufferSize(void) override {
+    return m_Size;
+  }
+  virtual HRESULT STDMETHODCALLTYPE GetEncoding(_Out_ BOOL *pKnown, _Out_ UINT32 *pCodePage) override {
+    *pKnown = m_EncodingKnown ? TRUE : FALSE;
+    *pCodePage = m_CodePage;
+    return S_OK;
+  }
+};
+
+namespace hlsl {
+
+// Wraps the UTF-8 text at [pText, pText + size) of a mapped file, including
+// the zero byte past its end, as an IDxcBlobUtf8 without copying.
+static HRESULT CreateUtf8FromMappedFile(DxcMappedFileBlob *pMapped,
+                                        const char *pText, SIZE_T size,
+                                        IMalloc *pMalloc,
+                                        InternalDxcBlobUtf8 **ppUtf8) {
+  IFR(InternalDxcBlobUtf8::CreateFromBlob(pMapped, pMalloc, true, CP_UTF8,
+                                          ppUtf8));
+  (*ppUtf8)->SetPtrAndSize(pText, size + 1);
+  return S_OK;
+}
+
 static HRESULT CodePageBufferToWide(UINT32 codePage, LPCVOID bufferPointer,
                                      SIZE_T bufferSize,
                                      CDxcMallocHeapPtr<WCHAR> &wideNewCopy,
@@ -827,14 +967,38 @@ DxcCreateBlobFromFile(IMalloc *pMalloc, LPCWSTR pFileName, UINT32 *pCodePage,
   LPVOID pData;
   DWORD dataSize;
   *ppBlobEncoding = nullptr;
+
+  bool known = (pCodePage != nullptr);
+  UINT32 codePage = (pCodePage != nullptr) ? *pCodePage : 0;
+
+  if (!pMalloc)
+    pMalloc = DxcGetThreadMallocNoRef();
+
+  // Large files with unknown encoding or UTF-8 are mapped rather than read.
+  if (!known || codePage == CP_UTF8) {
+    CComPtr<DxcMappedFileBlob> pMapped = DxcMappedFileBlob::Alloc(pMalloc);
+    IFROOM(pMapped.p);
+    if (pMapped->Map(pFileName, known, codePage) == S_OK) {
+      if (!known) {
+        *ppBlobEncoding = pMapped.Detach();
+        return S_OK;
+      }
+      const char *pText = (const char *)pMapped->GetBufferPointer();
+      SIZE_T textSize = pMapped->GetBufferSize();
+      unsigned bomSize = GetBomLengthFromBytes(pText, textSize);
+      InternalDxcBlobUtf8 *pUtf8;
+      IFR(CreateUtf8FromMappedFile(pMapped, pText + bomSize,
+                                   textSize - bomSize, pMalloc, &pUtf8));
+      *ppBlobEncoding = pUtf8;
+      return S_OK;
+    }
+  }
+
   try {
     ReadBinaryFile(pMalloc, pFileName, &pData, &dataSize);
   }
   CATCH_CPP_RETURN_HRESULT();
 
-  bool known = (pCodePage != nullptr);
-  UINT32 codePage = (pCodePage != nullptr) ? *pCodePage : 0;
-
   HRESULT hr = DxcCreateBlob(pData, dataSize, false, false, known, codePage, pMalloc, ppBlobEncoding);
   if (FAILED(hr))
     pMalloc->Free(pData);
@@ -974,7 +1138,19 @@ DxcGetBlobAsUtf8(IDxcBlob *pBlob, IMalloc *pMalloc,
   // Reuse or copy the underlying blob depending on null-termination
   if (codePage == CP_UTF8) {
     utf8CharCount = blobLen;
-    if (IsBufferNullTerminated(bufferPointer, blobLen, CP_UTF8)) {
+    CComPtr<DxcMappedFileBlob> pMapped;
+    if (!IsBufferNullTerminated(bufferPointer, blobLen, CP_UTF8) &&
+        SUCCEEDED(pBlob->QueryInterface(__uuidof(DxcMappedFileBlob),
+                                        (void **)&pMapped)) &&
+        pMapped->EndsAtFileEnd(bufferPointer, blobLen)) {
+      // A mapped file is followed by a zero byte; reference it in place.
+      InternalDxcBlobUtf8 *internalEncoding;
+      hr = CreateUtf8FromMappedFile(pMapped, bufferPointer, blobLen, pMalloc,
+                                    &internalEncoding);
+      if (SUCCEEDED(hr))
+        *pBlobEncoding = internalEncoding;
+      return hr;
+    } else if (IsBufferNullTerminated(bufferPointer, blobLen, CP_UTF8)) {
       // Already null-terminated, reference other blob's memory
       InternalDxcBlobUtf8* internalEncoding;
       hr = InternalDxcBlobUtf8::CreateFromBlob(pBlob, pMalloc, true, CP_UTF8, &internalEncoding);
@@ -130,36 +130,36 @@ void DxcDefines::BuildDefines() {
   }
 }
 
-bool DxcOpts::IsRootSignatureProfile() {
+bool DxcOpts::IsRootSignatureProfile() const {
   return TargetProfile == "rootsig_1_0" ||
       TargetProfile == "rootsig_1_1";
 }
 
-bool DxcOpts::IsLibraryProfile() {
+bool DxcOpts::IsLibraryProfile() const {
   return TargetProfile.startswith("lib_");
 }
 
-bool DxcOpts::GenerateFullDebugInfo() {
+bool DxcOpts::GenerateFullDebugInfo() const {
   return DebugInfo;
 }
 
-bool DxcOpts::GeneratePDB() {
+bool DxcOpts::GeneratePDB() const {
   return DebugInfo || SourceOnlyDebug;
 }
 
-bool DxcOpts::EmbedDebugInfo() {
+bool DxcOpts::EmbedDebugInfo() const {
   return EmbedDebug;
 }
 
-bool DxcOpts::EmbedPDBName() {
+bool DxcOpts::EmbedPDBName() const {
   return GeneratePDB() || !DebugFile.empty();
 }
 
-bool DxcOpts::DebugFileIsDirectory() {
+bool DxcOpts::DebugFileIsDirectory() const {
   return !DebugFile.empty() && llvm::sys::path::is_separator(DebugFile[DebugFile.size() - 1]);
 }
 
-llvm::StringRef DxcOpts::GetPDBName() {
+llvm::StringRef DxcOpts::GetPDBName() const {
   if (!DebugFileIsDirectory())
     return DebugFile;
   return llvm::StringRef();
@@ -465,6 +465,9 @@ int ReadDxcOpts(const OptTable *optionTable, unsigned flagsToInclude,
     } else if (Args.getLastArg(OPT_default_linkage)) {
       errors << "library profile required when using -default-linkage option";
       return 1;
+    } else if (Args.hasFlag(OPT_Qlib_incremental, OPT_INVALID, false)) {
+      errors << "library profile required when using -Qlib-incremental option";
+      return 1;
     }
   }
 
@@ -555,6 +558,7 @@ int ReadDxcOpts(const OptTable *optionTable, unsigned flagsToInclude,
   opts.DebugFile = Args.getLastArgValue(OPT_Fd);
   opts.ImportBindingTable = Args.getLastArgValue(OPT_import_binding_table);
   opts.BindingTableDefine = Args.getLastArgValue(OPT_binding_table_define);
+  opts.ProfileUse = Args.getLastArgValue(OPT_fprofile_use_EQ);
   opts.ExtractPrivateFile = Args.getLastArgValue(OPT_getprivate);
   opts.Enable16BitTypes = Args.hasFlag(OPT_enable_16bit_types, OPT_INVALID, false);
   opts.OutputObject = Args.getLastArgValue(OPT_Fo);
@@ -563,6 +567,42 @@ int ReadDxcOpts(const OptTable *optionTable, unsigned flagsToInclude,
   opts.OutputReflectionFile = Args.getLastArgValue(OPT_Fre);
   opts.OutputRootSigFile = Args.getLastArgValue(OPT_Frs);
   opts.OutputShaderHashFile = Args.getLastArgValue(OPT_Fsh);
+  opts.TimeTraceFile = Args.getLastArgValue(OPT_ftime_trace_EQ);
+  opts.TimeTrace = Args.hasFlag(OPT_ftime_trace, OPT_INVALID, false) ||
+                   !opts.TimeTraceFile.empty();
+  opts.PassReportFile = Args.getLastArgValue(OPT_Qpass_report_EQ);
+  opts.PassReport = Args.hasFlag(OPT_Qpass_report, OPT_INVALID, false) ||
+                    !opts.PassReportFile.empty();
+  opts.MemoryReportFile = Args.getLastArgValue(OPT_Qmemory_report_EQ);
+  opts.MemoryReport = Args.hasFlag(OPT_Qmemory_report, OPT_INVALID, false) ||
+                      !opts.MemoryReportFile.empty();
+  llvm::StringRef memoryLimit = Args.getLastArgValue(OPT_Qmemory_limit);
+  if (!memoryLimit.empty()) {
+#ifndef _WIN32
+    // Only Windows builds route operator new through the thread IMalloc that
+    // enforces the limit; most of the compile would go unchecked elsewhere.
+    errors << "-Qmemory-limit is only supported on Windows.";
+    return 1;
+#endif
+    if (memoryLimit.getAsInteger(10, opts.MemoryLimitMB) ||
+        opts.MemoryLimitMB == 0) {
+      errors << "Unsupported value '" << memoryLimit << "' for -Qmemory-limit.";
+      return 1;
+    }
+    // The peak of a compile with a limit is always reported.
+    opts.MemoryReport = true;
+  }
+  opts.PerfReportFile = Args.getLastArgValue(OPT_Qperf_report_EQ);
+  opts.PerfReport = Args.hasFlag(OPT_Qperf_report, OPT_INVALID, false) ||
+                    !opts.PerfReportFile.empty();
+  llvm::StringRef deadline = Args.getLastArgValue(OPT_Qdeadline);
+  if (!deadline.empty()) {
+    if (deadline.getAsInteger(10, opts.DeadlineMs) || opts.DeadlineMs == 0) {
+      errors << "Unsupported value '" << deadline << "' for -Qdeadline.";
+      return 1;
+    }
+  }
+  opts.LibIncremental = Args.hasFlag(OPT_Qlib_incremental, OPT_INVALID, false);
   opts.ShowOptionNames = Args.hasFlag(OPT_fdiagnostics_show_option, OPT_fno_diagnostics_show_option, true);
   opts.UseColor = Args.hasFlag(OPT_Cc, OPT_INVALID, false);
   opts.UseInstructionNumbers = Args.hasFlag(OPT_Ni, OPT_INVALID, false);
@@ -574,14 +614,21 @@ int ReadDxcOpts(const OptTable *optionTable, unsigned flagsToInclude,
       Args.hasFlag(OPT_write_dependencies, OPT_INVALID, false);
   opts.OutputFileForDependencies =
       Args.getLastArgValue(OPT_write_dependencies_to);
+  opts.ScanDependencies = Args.hasFlag(OPT_dependency_scan, OPT_INVALID, false);
+  opts.DependencyGraphJson =
+      Args.hasFlag(OPT_dependency_graph_json, OPT_INVALID, false);
   opts.DumpDependencies =
       Args.hasFlag(OPT_dump_dependencies, OPT_INVALID, false) ||
-      opts.WriteDependencies || !opts.OutputFileForDependencies.empty();
+      opts.WriteDependencies || !opts.OutputFileForDependencies.empty() ||
+      opts.ScanDependencies || opts.DependencyGraphJson;
   opts.CodeGenHighLevel = Args.hasFlag(OPT_fcgl, OPT_INVALID, false);
   opts.AllowPreserveValues = Args.hasFlag(OPT_preserve_intermediate_values, OPT_INVALID, false);
-  opts.DebugInfo = Args.hasFlag(OPT__SLASH_Zi, OPT_INVALID, false);
+  opts.DebugLineTablesOnly = Args.hasFlag(OPT_Zi_lines, OPT_INVALID, false);
+  opts.DebugInfo = Args.hasFlag(OPT__SLASH_Zi, OPT_INVALID, false) ||
+                   opts.DebugLineTablesOnly;
   opts.DebugNameForBinary = Args.hasFlag(OPT_Zsb, OPT_INVALID, false);
   opts.DebugNameForSource = Args.hasFlag(OPT_Zss, OPT_INVALID, false);
+  opts.FastShaderHash = Args.hasFlag(OPT_Qfast_hash, OPT_INVALID, false);
   opts.VariableName = Args.getLastArgValue(OPT_Vn);
   opts.InputFile = Args.getLastArgValue(OPT_INPUT);
   opts.ForceRootSigVer = Args.getLastArgValue(OPT_force_rootsig_ver);
@@ -596,6 +643,31 @@ int ReadDxcOpts(const OptTable *optionTable, unsigned flagsToInclude,
   if (!limit.empty())
     opts.ScanLimit = std::stoul(std::string(limit));
 
+  // [unroll] budget; zero means unlimited.
+  struct {
+    unsigned Opt;
+    unsigned *Value;
+    const char *Name;
+  } unrollBudgets[] = {
+    { OPT_unroll_max_function_instructions, &opts.UnrollMaxFunctionInstructions, "unroll-max-function-instructions" },
+    { OPT_unroll_max_module_instructions, &opts.UnrollMaxModuleInstructions, "unroll-max-module-instructions" },
+    { OPT_unroll_time_limit, &opts.UnrollTimeLimit, "unroll-time-limit" },
+  };
+  for (auto &budget : unrollBudgets) {
+    llvm::StringRef value = Args.getLastArgValue(budget.Opt);
+    if (!value.empty() && value.getAsInteger(10, *budget.Value)) {
+      errors << "Unsupported value '" << value << "' for " << budget.Name << ".";
+      return 1;
+    }
+  }
+
+  // Zero means no limit.
+  llvm::StringRef pressure = Args.getLastArgValue(OPT_max_register_pressure);
+  if (!pressure.empty() && pressure.getAsInteger(10, opts.MaxRegisterPressure)) {
+    errors << "Unsupported value '" << pressure << "' for max-register-pressure.";
+    return 1;
+  }
+
   for (std::string opt : Args.getAllArgValues(OPT_opt_disable))
     opts.DxcOptimizationToggles[llvm::StringRef(opt).lower()] = false;
 
@@ -640,6 +712,23 @@ int ReadDxcOpts(const OptTable *optionTable, unsigned flagsToInclude,
     opts.DxcOptimizationSelects[optimization] = selection;
   }
 
+  std::vector<std::string> specializations = Args.getAllArgValues(OPT_specialize_cbuffer);
+  for (std::string &specialization : specializations) {
+    auto kv = ParseDefine(specialization);
+    if (kv.first.find('.') == std::string::npos || kv.second.empty()) {
+      errors << "-specialize-cbuffer expects <cbuffer>.<field>=<value>, not \""
+             << specialization << "\"";
+      return 1;
+    }
+    if (opts.SpecializedCBufferValues.count(kv.first) &&
+        kv.second.compare(opts.SpecializedCBufferValues[kv.first])) {
+      errors << "Contradictory -specialize-cbuffer values for \""
+             << kv.first << "\"";
+      return 1;
+    }
+    opts.SpecializedCBufferValues[kv.first] = kv.second;
+  }
+
   if (!opts.ForceRootSigVer.empty() && opts.ForceRootSigVer != "rootsig_1_0" &&
       opts.ForceRootSigVer != "rootsig_1_1") {
     errors << "Unsupported value '" << opts.ForceRootSigVer
@@ -710,7 +799,9 @@ int ReadDxcOpts(const OptTable *optionTable, unsigned flagsToInclude,
   }
 
   opts.DisableOptimizations = false;
-  if (Arg *A = Args.getLastArg(OPT_O0, OPT_O1, OPT_O2, OPT_O3, OPT_Od)) {
+  opts.FastDevBuild = false;
+  if (Arg *A = Args.getLastArg(OPT_O0, OPT_O1, OPT_O2, OPT_O3, OPT_Od,
+                               OPT_Odev)) {
     if (A->getOption().matches(OPT_O0))
       opts.OptLevel = 0;
     if (A->getOption().matches(OPT_O1))
@@ -723,6 +814,14 @@ int ReadDxcOpts(const OptTable *optionTable, unsigned flagsToInclude,
       opts.DisableOptimizations = true;
       opts.OptLevel = 0;
     }
+    if (A->getOption().matches(OPT_Odev)) {
+      opts.DisableOptimizations = true;
+      opts.FastDevBuild = true;
+      opts.OptLevel = 0;
+      // Debug nops only help step through lines; -opt-enable debug-nops
+      // still turns them back on.
+      opts.DxcOptimizationToggles.insert(std::make_pair("debug-nops", false));
+    }
   }
   else
     opts.OptLevel = 3;
@@ -738,6 +837,15 @@ int ReadDxcOpts(const OptTable *optionTable, unsigned flagsToInclude,
   opts.DefaultColMajor = Args.hasFlag(OPT_Zpc, OPT_INVALID, false);
   opts.DumpBin = Args.hasFlag(OPT_dumpbin, OPT_INVALID, false);
   opts.Link = Args.hasFlag(OPT_link, OPT_INVALID, false);
+  opts.Serve = Args.hasFlag(OPT_serve, OPT_INVALID, false);
+  opts.BatchFile = Args.getLastArgValue(OPT_batch);
+  llvm::StringRef batchJobs = Args.getLastArgValue(OPT_j);
+  if (!batchJobs.empty()) {
+    if (batchJobs.getAsInteger(10, opts.BatchJobs) || opts.BatchJobs == 0) {
+      errors << "Unsupported value '" << batchJobs << "' for -j.";
+      return 1;
+    }
+  }
   opts.NotUseLegacyCBufLoad = Args.hasFlag(OPT_no_legacy_cbuf_layout, OPT_INVALID, false);
   opts.NotUseLegacyCBufLoad = Args.hasFlag(OPT_not_use_legacy_cbuf_load_, OPT_INVALID, opts.NotUseLegacyCBufLoad);
   opts.PackPrefixStable = Args.hasFlag(OPT_pack_prefix_stable, OPT_INVALID, false);
@@ -759,6 +867,13 @@ int ReadDxcOpts(const OptTable *optionTable, unsigned flagsToInclude,
   opts.StripReflection = Args.hasFlag(OPT_Qstrip_reflect, OPT_INVALID, false);
   opts.KeepReflectionInDxil = Args.hasFlag(OPT_Qkeep_reflect_in_dxil, OPT_INVALID, false);
   opts.StripReflectionFromDxil = Args.hasFlag(OPT_Qstrip_reflect_from_dxil, OPT_INVALID, false);
+  // -Odev leaves reflection in the DXIL part instead of building the STAT
+  // part from a stripped copy of the module, unless reflection is asked for.
+  if (opts.FastDevBuild && opts.OutputReflectionFile.empty() &&
+      !opts.StripReflectionFromDxil) {
+    opts.StripReflection = true;
+    opts.KeepReflectionInDxil = true;
+  }
   opts.ExtractRootSignature = Args.hasFlag(OPT_extractrootsignature, OPT_INVALID, false);
   opts.DisassembleColorCoded = Args.hasFlag(OPT_Cc, OPT_INVALID, false);
   opts.DisassembleInstNumbers = Args.hasFlag(OPT_Ni, OPT_INVALID, false);
@@ -829,7 +944,8 @@ int ReadDxcOpts(const OptTable *optionTable, unsigned flagsToInclude,
     return 1;
   }
 
-  if ((flagsToInclude & hlsl::options::DriverOption) && opts.InputFile.empty()) {
+  if ((flagsToInclude & hlsl::options::DriverOption) && opts.InputFile.empty() &&
+      opts.BatchFile.empty() && !opts.Serve) {
     // Input file is required in arguments only for drivers; APIs take this through an argument.
     errors << "Required input file argument is missing. use -help to get more information.";
     return 1;
@@ -874,7 +990,8 @@ int ReadDxcOpts(const OptTable *optionTable, unsigned flagsToInclude,
   // XXX TODO: Sort this out, since it's required for new API, but a separate argument for old APIs.
   if ((flagsToInclude & hlsl::options::DriverOption) &&
       !(flagsToInclude & hlsl::options::RewriteOption) &&
-      opts.TargetProfile.empty() && !opts.DumpBin && opts.Preprocess.empty() && !opts.RecompileFromBinary
+      opts.TargetProfile.empty() && !opts.DumpBin && opts.Preprocess.empty() && !opts.RecompileFromBinary &&
+      opts.BatchFile.empty() && !opts.Serve
       ) {
     // Target profile is required in arguments only for drivers when compiling;
     // APIs take this through an argument.
@@ -949,6 +1066,12 @@ int ReadDxcOpts(const OptTable *optionTable, unsigned flagsToInclude,
     // SPIRV Change Starts
 #ifdef ENABLE_SPIRV_CODEGEN
   opts.GenSPIRV = Args.hasFlag(OPT_spirv, OPT_INVALID, false);
+  opts.OutputSpirvFile = Args.getLastArgValue(OPT_Fspv);
+  if (!opts.OutputSpirvFile.empty() &&
+      (opts.GenSPIRV || !opts.Preprocess.empty())) {
+    errors << "-Fspv cannot be used with -spirv or -P.";
+    return 1;
+  }
   opts.SpirvOptions.invertY = Args.hasFlag(OPT_fvk_invert_y, OPT_INVALID, false);
   opts.SpirvOptions.invertW = Args.hasFlag(OPT_fvk_use_dx_position_w, OPT_INVALID, false);
   opts.SpirvOptions.supportNonzeroBaseInstance =
@@ -1082,6 +1205,7 @@ int ReadDxcOpts(const OptTable *optionTable, unsigned flagsToInclude,
       !Args.getLastArgValue(OPT_fspv_debug_EQ).empty() ||
       !Args.getLastArgValue(OPT_fspv_extension_EQ).empty() ||
       !Args.getLastArgValue(OPT_fspv_target_env_EQ).empty() ||
+      !Args.getLastArgValue(OPT_Fspv).empty() ||
       !Args.getLastArgValue(OPT_Oconfig).empty() ||
       !Args.getLastArgValue(OPT_fvk_bind_register).empty() ||
       !Args.getLastArgValue(OPT_fvk_bind_globals).empty() ||
@@ -13,6 +13,7 @@
 #include <specstrings.h>
 #else
 #include <clocale>
+#include <type_traits>
 #endif
 #include <string>
 #include "dxc/Support/Global.h"
@@ -20,6 +21,48 @@
 #include "dxc/Support/WinIncludes.h"
 
 #ifndef _WIN32
+// Returns true if the first count characters of text are all 7-bit ASCII,
+// with no null character except possibly the last one. Such text converts
+// one to one in every code page, without going through the C locale. The
+// blocks are reduced without early exits so that they can be vectorized.
+template <typename TChar>
+static bool IsAsciiText(const TChar *text, size_t count) {
+  typedef typename std::make_unsigned<TChar>::type UChar;
+  const size_t kBlock = 64;
+  size_t body = count - 1; // a null terminator is allowed in the last slot
+  size_t i = 0;
+  for (; i + kBlock <= body; i += kBlock) {
+    UChar bits = 0, least = (UChar)~0;
+    for (size_t j = 0; j < kBlock; ++j) {
+      UChar c = (UChar)text[i + j];
+      bits |= c;
+      least = c < least ? c : least;
+    }
+    if (bits >= 0x80 || least == 0)
+      return false;
+  }
+  for (; i < body; ++i) {
+    UChar c = (UChar)text[i];
+    if (c >= 0x80 || c == 0)
+      return false;
+  }
+  return (UChar)text[body] < 0x80;
+}
+
+// Widens or narrows ASCII text checked with IsAsciiText, writing what
+// mbstowcs or wcstombs would: a terminator is added if there is room.
+template <typename TFrom, typename TTo>
+static int ConvertAsciiText(const TFrom *from, int count, TTo *to,
+                            int toCount) {
+  if (to == nullptr)
+    return count;
+  for (int i = 0; i < count; ++i)
+    to[i] = (TTo)from[i];
+  if (from[count - 1] != 0 && toCount > count)
+    to[count] = 0;
+  return count;
+}
+
 // MultiByteToWideChar which is a Windows-specific method.
 // This is a very simplistic implementation for non-Windows platforms. This
 // implementation completely ignores CodePage and dwFlags.
@@ -50,6 +93,10 @@ int MultiByteToWideChar(uint32_t CodePage, uint32_t /*dwFlags*/,
     return 0;
   }
 
+  if (IsAsciiText(lpMultiByteStr, cbMultiByte))
+    return ConvertAsciiText(lpMultiByteStr, cbMultiByte, lpWideCharStr,
+                            cchWideChar);
+
   size_t rv;
   const char *locale = CPToLocale(CodePage);
   locale = setlocale(LC_ALL, locale);
@@ -99,6 +146,10 @@ int WideCharToMultiByte(uint32_t CodePage, uint32_t /*dwFlags*/,
     return 0;
   }
 
+  if (IsAsciiText(lpWideCharStr, cchWideChar))
+    return ConvertAsciiText(lpWideCharStr, cchWideChar, lpMultiByteStr,
+                            cbMultiByte);
+
   size_t rv;
   const char *locale = CPToLocale(CodePage);
   locale = setlocale(LC_ALL, locale);
@@ -0,0 +1,39 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// dxcconcurrency.cpp                                                        //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Provides a helper that spreads independent work items over threads.      //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#include "dxc/Support/dxcconcurrency.h"
+#include <algorithm>
+#include <atomic>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+void hlsl::RunConcurrently(unsigned count,
+                           const std::function<void(unsigned)> &work) {
+  std::atomic<unsigned> next(0);
+  auto worker = [&]() {
+    for (unsigned i = next++; i < count; i = next++)
+      work(i);
+  };
+  unsigned threadCount = std::min<unsigned>(
+      std::max(1u, std::thread::hardware_concurrency()), count);
+  std::vector<std::thread> threads;
+  for (unsigned i = 1; i < threadCount; ++i) {
+    try {
+      threads.emplace_back(worker);
+    } catch (std::system_error &) {
+      break; // Run the remaining work on the threads that did start.
+    }
+  }
+  worker();
+  for (std::thread &thread : threads)
+    thread.join();
+}
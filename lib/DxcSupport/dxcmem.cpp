@@ -5,7 +5,7 @@
 // This file is distributed under the University of Illinois Open Source     //
 // License. See LICENSE.TXT for details.                                     //
 //                                                                           //
-// Provides support for a thread-local allocator.                            //
+// Provides support for a thread-local allocator and an arena allocator.     //
 //                                                                           //
 ///////////////////////////////////////////////////////////////////////////////
 
@@ -16,8 +16,11 @@
 
 #include "dxc/Support/WinIncludes.h"
 #include "dxc/Support/WinFunctions.h"
+#include "dxc/Support/microcom.h"
 #include "llvm/Support/ThreadLocal.h"
 #include <memory>
+#include <stdlib.h>
+#include <string.h>
 
 static llvm::sys::ThreadLocal<IMalloc> *g_ThreadMallocTls;
 static IMalloc *g_pDefaultMalloc;
@@ -98,3 +101,166 @@ DxcThreadMalloc::DxcThreadMalloc(IMalloc *pMallocOrNull) throw() {
 DxcThreadMalloc::~DxcThreadMalloc() {
     DxcSwapThreadMalloc(pPrior, nullptr);
 }
+
+void *DxcMallocAlloc(IMalloc *pMalloc, size_t size) throw() {
+  return pMalloc->Alloc(size);
+}
+
+void DxcMallocFree(IMalloc *pMalloc, void *ptr) throw() {
+  pMalloc->Free(ptr);
+}
+
+// Bump allocator over chunks taken from a backing IMalloc, or from the C heap
+// when there is none. Each allocation is preceded by a header holding its
+// size, so Realloc can copy the old contents.
+class DxcArenaMalloc : public IMalloc {
+private:
+  DXC_MICROCOM_REF_FIELD(m_dwRef)
+  CComPtr<IMalloc> m_pBacking;
+
+  static const size_t Alignment = 16;
+  static const size_t ChunkSize = 64 * 1024;
+
+  struct ChunkHeader {
+    ChunkHeader *pPrev;
+    char *pEnd;
+  };
+  struct BlockHeader {
+    size_t Size;
+  };
+  static const size_t ChunkHeaderSize =
+      (sizeof(ChunkHeader) + Alignment - 1) & ~(Alignment - 1);
+  static const size_t BlockHeaderSize =
+      (sizeof(BlockHeader) + Alignment - 1) & ~(Alignment - 1);
+
+  ChunkHeader *m_pChunk = nullptr;
+  char *m_pCur = nullptr;
+  char *m_pEnd = nullptr;
+  void *m_pLast = nullptr;
+
+  static size_t AlignSize(size_t cb) {
+    return (cb + Alignment - 1) & ~(Alignment - 1);
+  }
+  static BlockHeader *GetHeader(void *pv) {
+    return (BlockHeader *)((char *)pv - BlockHeaderSize);
+  }
+
+  bool NewChunk(size_t cbBlock) {
+    size_t cbChunk = ChunkHeaderSize + cbBlock;
+    if (cbChunk < cbBlock)
+      return false;
+    if (cbChunk < ChunkSize)
+      cbChunk = ChunkSize;
+    ChunkHeader *pChunk = (ChunkHeader *)(m_pBacking ? m_pBacking->Alloc(cbChunk)
+                                                     : malloc(cbChunk));
+    if (pChunk == nullptr)
+      return false;
+    pChunk->pPrev = m_pChunk;
+    pChunk->pEnd = (char *)pChunk + cbChunk;
+    m_pChunk = pChunk;
+    m_pCur = (char *)pChunk + ChunkHeaderSize;
+    m_pEnd = pChunk->pEnd;
+    return true;
+  }
+
+public:
+  DXC_MICROCOM_ADDREF_RELEASE_IMPL(m_dwRef)
+
+  explicit DxcArenaMalloc(IMalloc *pBacking) : m_pBacking(pBacking) {}
+
+  ~DxcArenaMalloc() {
+    while (m_pChunk != nullptr) {
+      ChunkHeader *pPrev = m_pChunk->pPrev;
+      if (m_pBacking)
+        m_pBacking->Free(m_pChunk);
+      else
+        free(m_pChunk);
+      m_pChunk = pPrev;
+    }
+  }
+
+  STDMETHODIMP QueryInterface(REFIID iid, void **ppvObject) override {
+    return DoBasicQueryInterface<IMalloc>(this, iid, ppvObject);
+  }
+
+  void *STDMETHODCALLTYPE Alloc(SIZE_T cb) override {
+    size_t cbBlock = BlockHeaderSize + AlignSize(cb);
+    if (cbBlock < cb)
+      return nullptr;
+    if ((size_t)(m_pEnd - m_pCur) < cbBlock && !NewChunk(cbBlock))
+      return nullptr;
+    BlockHeader *pHeader = (BlockHeader *)m_pCur;
+    pHeader->Size = cb;
+    m_pCur += cbBlock;
+    m_pLast = (char *)pHeader + BlockHeaderSize;
+    return m_pLast;
+  }
+
+  void *STDMETHODCALLTYPE Realloc(void *pv, SIZE_T cb) override {
+    if (pv == nullptr)
+      return Alloc(cb);
+    if (cb == 0) {
+      Free(pv);
+      return nullptr;
+    }
+    BlockHeader *pHeader = GetHeader(pv);
+    // The most recent allocation can grow or shrink in place.
+    if (pv == m_pLast) {
+      size_t cbNew = AlignSize(cb);
+      if (cbNew >= cb && (size_t)(m_pEnd - (char *)pv) >= cbNew) {
+        pHeader->Size = cb;
+        m_pCur = (char *)pv + cbNew;
+        return pv;
+      }
+    }
+    if (cb <= pHeader->Size) {
+      pHeader->Size = cb;
+      return pv;
+    }
+    size_t cbOld = pHeader->Size;
+    void *pNew = Alloc(cb);
+    if (pNew != nullptr)
+      memcpy(pNew, pv, cbOld);
+    return pNew;
+  }
+
+  void STDMETHODCALLTYPE Free(void *pv) override {
+    // Only the most recent allocation can be handed back; the rest of the
+    // memory is returned when the arena goes away.
+    if (pv != nullptr && pv == m_pLast) {
+      m_pCur = (char *)GetHeader(pv);
+      m_pLast = nullptr;
+    }
+  }
+
+  virtual SIZE_T STDMETHODCALLTYPE GetSize(void *pv) {
+    return pv == nullptr ? (SIZE_T)-1 : GetHeader(pv)->Size;
+  }
+
+  virtual int STDMETHODCALLTYPE DidAlloc(void *pv) {
+    if (pv == nullptr)
+      return -1;
+    for (ChunkHeader *pChunk = m_pChunk; pChunk; pChunk = pChunk->pPrev) {
+      if ((char *)pv > (char *)pChunk && (char *)pv < pChunk->pEnd)
+        return 1;
+    }
+    return 0;
+  }
+
+  virtual void STDMETHODCALLTYPE HeapMinimize(void) {}
+};
+
+HRESULT DxcCreateArenaMalloc(IMalloc *pBackingOrNull,
+                             IMalloc **ppArena) throw() {
+  if (ppArena == nullptr)
+    return E_POINTER;
+  *ppArena = nullptr;
+  IMalloc *pBacking =
+      pBackingOrNull ? pBackingOrNull : DxcGetThreadMallocNoRef();
+  DxcArenaMalloc *pArena = new (std::nothrow) DxcArenaMalloc(pBacking);
+  if (pArena == nullptr)
+    return E_OUTOFMEMORY;
+  pArena->AddRef();
+  *ppArena = pArena;
+  return S_OK;
+}
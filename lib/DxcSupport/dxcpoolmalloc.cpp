@@ -0,0 +1,418 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// dxcpoolmalloc.cpp                                                         //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Provides a pooled IMalloc for hosts that run many compiles concurrently.  //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#include "dxc/Support/Global.h"
+#include "dxc/Support/WinIncludes.h"
+#include "dxc/Support/microcom.h"
+#include "dxc/dxcapi.h"
+#include "llvm/Support/ThreadLocal.h"
+#include <atomic>
+#include <mutex>
+#include <stdint.h>
+#include <string.h>
+
+namespace {
+
+// Small allocations are rounded up to a power-of-two size class between
+// kMinClassSize and kMaxSmallSize; the last class holds everything larger,
+// which goes straight to the backing allocator.
+static const unsigned kSizeClassCount = DxcMallocSizeClassCount;
+static const unsigned kLargeClass = kSizeClassCount - 1;
+static const size_t kMinClassSize = 16;
+static const size_t kMaxSmallSize = kMinClassSize << (kLargeClass - 1);
+static const size_t kSlabSize = 64 * 1024;
+static const size_t kHeaderSize = 16;
+
+static unsigned GetSizeClass(size_t cb) {
+  if (cb > kMaxSmallSize)
+    return kLargeClass;
+  unsigned sizeClass = 0;
+  for (size_t classSize = kMinClassSize; classSize < cb; classSize <<= 1)
+    ++sizeClass;
+  return sizeClass;
+}
+
+static size_t GetClassSize(unsigned sizeClass) {
+  return kMinClassSize << sizeClass;
+}
+
+struct PoolThreadHeap;
+class DxcPooledMalloc;
+
+// Precedes every allocation. pOwner is null for large allocations.
+struct PoolBlockHeader {
+  PoolThreadHeap *pOwner;
+  size_t Size;
+};
+static_assert(sizeof(PoolBlockHeader) <= kHeaderSize,
+              "block header must fit in its reserved space");
+
+// Overlays the payload of a free block.
+struct PoolFreeBlock {
+  PoolFreeBlock *pNext;
+};
+
+// Precedes the blocks carved out of a slab.
+struct PoolSlab {
+  PoolSlab *pNext;
+};
+static_assert(sizeof(PoolSlab) <= kHeaderSize,
+              "slab header must fit in its reserved space");
+
+static PoolBlockHeader *GetHeader(void *pv) {
+  return (PoolBlockHeader *)((char *)pv - kHeaderSize);
+}
+
+// Adds to a counter that only the owning thread writes, without paying for an
+// interlocked operation; other threads only read it for statistics.
+template <typename T> static void AddOwned(std::atomic<T> &counter, T value) {
+  counter.store(counter.load(std::memory_order_relaxed) + value,
+                std::memory_order_relaxed);
+}
+
+// Per-thread state. Only the owning thread touches the free lists and the
+// slab; other threads hand blocks back through RemoteFrees. When the owning
+// thread exits the heap is kept, with its free lists, for the next thread
+// that allocates from the pool.
+struct PoolThreadHeap {
+  PoolThreadHeap *pNextHeap = nullptr;
+  bool InUse = true;
+  // Links the heaps of every pool the owning thread used; see ThreadHeapList.
+  DxcPooledMalloc *pPool = nullptr;
+  PoolThreadHeap *pNextOnThread = nullptr;
+  PoolThreadHeap **ppPrevOnThread = nullptr;
+  PoolFreeBlock *FreeLists[kLargeClass] = {};
+  PoolSlab *pSlabs = nullptr;
+  char *pSlabCur = nullptr;
+  char *pSlabEnd = nullptr;
+  std::atomic<PoolFreeBlock *> RemoteFrees;
+
+  // Statistics for the calls made on this thread.
+  std::atomic<uint64_t> AllocationCount;
+  std::atomic<uint64_t> FreeCount;
+  std::atomic<uint64_t> ClassAllocationCount[kSizeClassCount];
+  std::atomic<int64_t> ClassBytesInUse[kSizeClassCount];
+
+  PoolThreadHeap() : RemoteFrees(nullptr), AllocationCount(0), FreeCount(0) {
+    for (unsigned i = 0; i < kSizeClassCount; ++i) {
+      ClassAllocationCount[i].store(0, std::memory_order_relaxed);
+      ClassBytesInUse[i].store(0, std::memory_order_relaxed);
+    }
+  }
+
+  void PushRemoteFree(PoolFreeBlock *pBlock) {
+    pBlock->pNext = RemoteFrees.load(std::memory_order_relaxed);
+    while (!RemoteFrees.compare_exchange_weak(pBlock->pNext, pBlock,
+                                              std::memory_order_release,
+                                              std::memory_order_relaxed)) {
+    }
+  }
+
+  // Moves the blocks other threads freed back onto the owner's free lists.
+  void DrainRemoteFrees() {
+    PoolFreeBlock *pBlock = RemoteFrees.exchange(nullptr, std::memory_order_acquire);
+    while (pBlock != nullptr) {
+      PoolFreeBlock *pNext = pBlock->pNext;
+      unsigned sizeClass = GetSizeClass(GetHeader(pBlock)->Size);
+      pBlock->pNext = FreeLists[sizeClass];
+      FreeLists[sizeClass] = pBlock;
+      pBlock = pNext;
+    }
+  }
+};
+
+// The heaps the current thread owns, handed back to their pools when the
+// thread exits. A pool that is destroyed first unlinks its heaps, so the
+// lists are guarded by a single process-wide lock.
+struct ThreadHeapList {
+  PoolThreadHeap *pHead = nullptr;
+  ~ThreadHeapList();
+};
+static thread_local ThreadHeapList t_ThreadHeaps;
+
+static std::mutex &GetThreadHeapsLock() {
+  static std::mutex Lock;
+  return Lock;
+}
+
+static void UnlinkFromThread(PoolThreadHeap *pHeap) {
+  if (pHeap->ppPrevOnThread == nullptr)
+    return;
+  *pHeap->ppPrevOnThread = pHeap->pNextOnThread;
+  if (pHeap->pNextOnThread != nullptr)
+    pHeap->pNextOnThread->ppPrevOnThread = pHeap->ppPrevOnThread;
+  pHeap->pNextOnThread = nullptr;
+  pHeap->ppPrevOnThread = nullptr;
+}
+
+class DxcPooledMalloc : public IMalloc, public IDxcMallocStatistics {
+private:
+  DXC_MICROCOM_TM_REF_FIELDS()
+  llvm::sys::ThreadLocal<PoolThreadHeap> m_ThreadHeap;
+  std::mutex m_HeapsLock;
+  PoolThreadHeap *m_pHeaps = nullptr;
+  std::atomic<uint64_t> m_BytesReserved;
+  std::atomic<uint64_t> m_PeakBytesReserved;
+
+  void *Reserve(size_t cb) {
+    void *P = m_pMalloc->Alloc(cb);
+    if (P == nullptr)
+      return nullptr;
+    uint64_t reserved = m_BytesReserved.fetch_add(cb) + cb;
+    uint64_t peak = m_PeakBytesReserved.load(std::memory_order_relaxed);
+    while (peak < reserved &&
+           !m_PeakBytesReserved.compare_exchange_weak(peak, reserved)) {
+    }
+    return P;
+  }
+
+  void Unreserve(void *P, size_t cb) {
+    m_pMalloc->Free(P);
+    m_BytesReserved.fetch_sub(cb);
+  }
+
+  PoolThreadHeap *GetThreadHeap() {
+    PoolThreadHeap *pHeap = m_ThreadHeap.get();
+    if (pHeap != nullptr)
+      return pHeap;
+    {
+      // Prefer the heap of a thread that has exited.
+      std::lock_guard<std::mutex> lock(m_HeapsLock);
+      for (pHeap = m_pHeaps; pHeap; pHeap = pHeap->pNextHeap) {
+        if (!pHeap->InUse) {
+          pHeap->InUse = true;
+          break;
+        }
+      }
+    }
+    if (pHeap == nullptr) {
+      void *P = Reserve(sizeof(PoolThreadHeap));
+      if (P == nullptr)
+        return nullptr;
+      pHeap = new (P) PoolThreadHeap();
+      pHeap->pPool = this;
+      std::lock_guard<std::mutex> lock(m_HeapsLock);
+      pHeap->pNextHeap = m_pHeaps;
+      m_pHeaps = pHeap;
+    }
+    {
+      std::lock_guard<std::mutex> lock(GetThreadHeapsLock());
+      pHeap->pNextOnThread = t_ThreadHeaps.pHead;
+      pHeap->ppPrevOnThread = &t_ThreadHeaps.pHead;
+      if (t_ThreadHeaps.pHead != nullptr)
+        t_ThreadHeaps.pHead->ppPrevOnThread = &pHeap->pNextOnThread;
+      t_ThreadHeaps.pHead = pHeap;
+    }
+    m_ThreadHeap.set(pHeap);
+    return pHeap;
+  }
+
+  void *AllocSmall(PoolThreadHeap *pHeap, unsigned sizeClass) {
+    PoolFreeBlock *pBlock = pHeap->FreeLists[sizeClass];
+    if (pBlock == nullptr) {
+      pHeap->DrainRemoteFrees();
+      pBlock = pHeap->FreeLists[sizeClass];
+    }
+    if (pBlock != nullptr) {
+      pHeap->FreeLists[sizeClass] = pBlock->pNext;
+      return pBlock;
+    }
+    size_t stride = kHeaderSize + GetClassSize(sizeClass);
+    if ((size_t)(pHeap->pSlabEnd - pHeap->pSlabCur) < stride) {
+      PoolSlab *pSlab = (PoolSlab *)Reserve(kSlabSize);
+      if (pSlab == nullptr)
+        return nullptr;
+      pSlab->pNext = pHeap->pSlabs;
+      pHeap->pSlabs = pSlab;
+      pHeap->pSlabCur = (char *)pSlab + kHeaderSize;
+      pHeap->pSlabEnd = (char *)pSlab + kSlabSize;
+    }
+    void *P = pHeap->pSlabCur + kHeaderSize;
+    pHeap->pSlabCur += stride;
+    return P;
+  }
+
+public:
+  DXC_MICROCOM_TM_ADDREF_RELEASE_IMPL()
+
+  DxcPooledMalloc(IMalloc *pMalloc)
+      : m_dwRef(0), m_pMalloc(pMalloc), m_BytesReserved(0),
+        m_PeakBytesReserved(0) {}
+
+  ~DxcPooledMalloc() {
+    {
+      std::lock_guard<std::mutex> lock(GetThreadHeapsLock());
+      for (PoolThreadHeap *pHeap = m_pHeaps; pHeap; pHeap = pHeap->pNextHeap)
+        UnlinkFromThread(pHeap);
+    }
+    while (m_pHeaps != nullptr) {
+      PoolThreadHeap *pHeap = m_pHeaps;
+      m_pHeaps = pHeap->pNextHeap;
+      while (pHeap->pSlabs != nullptr) {
+        PoolSlab *pSlab = pHeap->pSlabs;
+        pHeap->pSlabs = pSlab->pNext;
+        m_pMalloc->Free(pSlab);
+      }
+      pHeap->~PoolThreadHeap();
+      m_pMalloc->Free(pHeap);
+    }
+  }
+
+  // Called on the owning thread as it exits, with the thread heaps lock held.
+  void ReleaseThreadHeap(PoolThreadHeap *pHeap) {
+    m_ThreadHeap.erase();
+    std::lock_guard<std::mutex> lock(m_HeapsLock);
+    pHeap->InUse = false;
+  }
+
+  STDMETHODIMP QueryInterface(REFIID iid, void **ppvObject) override {
+    return DoBasicQueryInterface<IMalloc, IDxcMallocStatistics>(this, iid,
+                                                                ppvObject);
+  }
+
+  void *STDMETHODCALLTYPE Alloc(SIZE_T cb) override {
+    PoolThreadHeap *pHeap = GetThreadHeap();
+    if (pHeap == nullptr)
+      return nullptr;
+    unsigned sizeClass = GetSizeClass(cb);
+    void *P;
+    if (sizeClass == kLargeClass) {
+      if (cb > SIZE_MAX - kHeaderSize)
+        return nullptr;
+      char *pRaw = (char *)Reserve(kHeaderSize + cb);
+      P = pRaw ? pRaw + kHeaderSize : nullptr;
+    } else {
+      P = AllocSmall(pHeap, sizeClass);
+    }
+    if (P == nullptr)
+      return nullptr;
+    PoolBlockHeader *pHeader = GetHeader(P);
+    pHeader->pOwner = sizeClass == kLargeClass ? nullptr : pHeap;
+    pHeader->Size = cb;
+    AddOwned<uint64_t>(pHeap->AllocationCount, 1);
+    AddOwned<uint64_t>(pHeap->ClassAllocationCount[sizeClass], 1);
+    AddOwned<int64_t>(pHeap->ClassBytesInUse[sizeClass], (int64_t)cb);
+    return P;
+  }
+
+  void *STDMETHODCALLTYPE Realloc(void *pv, SIZE_T cb) override {
+    if (pv == nullptr)
+      return Alloc(cb);
+    if (cb == 0) {
+      Free(pv);
+      return nullptr;
+    }
+    PoolBlockHeader *pHeader = GetHeader(pv);
+    size_t cbOld = pHeader->Size;
+    unsigned sizeClass = GetSizeClass(cbOld);
+    // A small block can be resized in place within its size class.
+    if (sizeClass != kLargeClass && sizeClass == GetSizeClass(cb)) {
+      PoolThreadHeap *pHeap = GetThreadHeap();
+      if (pHeap != nullptr) {
+        AddOwned<int64_t>(pHeap->ClassBytesInUse[sizeClass],
+                          (int64_t)cb - (int64_t)cbOld);
+        pHeader->Size = cb;
+        return pv;
+      }
+    }
+    void *pNew = Alloc(cb);
+    if (pNew == nullptr)
+      return nullptr;
+    memcpy(pNew, pv, cbOld < cb ? cbOld : cb);
+    Free(pv);
+    return pNew;
+  }
+
+  void STDMETHODCALLTYPE Free(void *pv) override {
+    if (pv == nullptr)
+      return;
+    PoolBlockHeader *pHeader = GetHeader(pv);
+    unsigned sizeClass = GetSizeClass(pHeader->Size);
+    if (PoolThreadHeap *pHeap = GetThreadHeap()) {
+      AddOwned<uint64_t>(pHeap->FreeCount, 1);
+      AddOwned<int64_t>(pHeap->ClassBytesInUse[sizeClass],
+                        -(int64_t)pHeader->Size);
+    }
+    if (sizeClass == kLargeClass) {
+      Unreserve(pHeader, kHeaderSize + pHeader->Size);
+      return;
+    }
+    PoolThreadHeap *pOwner = pHeader->pOwner;
+    PoolFreeBlock *pBlock = (PoolFreeBlock *)pv;
+    if (pOwner == m_ThreadHeap.get()) {
+      pBlock->pNext = pOwner->FreeLists[sizeClass];
+      pOwner->FreeLists[sizeClass] = pBlock;
+    } else {
+      pOwner->PushRemoteFree(pBlock);
+    }
+  }
+
+  virtual SIZE_T STDMETHODCALLTYPE GetSize(void *pv) {
+    return pv == nullptr ? (SIZE_T)-1 : GetHeader(pv)->Size;
+  }
+
+  virtual int STDMETHODCALLTYPE DidAlloc(void *pv) {
+    return -1; // don't know
+  }
+
+  virtual void STDMETHODCALLTYPE HeapMinimize(void) {}
+
+  HRESULT STDMETHODCALLTYPE
+  GetStatistics(_Out_ DxcMallocStatistics *pStats) override {
+    if (pStats == nullptr)
+      return E_POINTER;
+    memset(pStats, 0, sizeof(*pStats));
+    int64_t classBytes[kSizeClassCount] = {};
+    {
+      std::lock_guard<std::mutex> lock(m_HeapsLock);
+      for (PoolThreadHeap *pHeap = m_pHeaps; pHeap; pHeap = pHeap->pNextHeap) {
+        pStats->AllocationCount +=
+            pHeap->AllocationCount.load(std::memory_order_relaxed);
+        pStats->FreeCount += pHeap->FreeCount.load(std::memory_order_relaxed);
+        for (unsigned i = 0; i < kSizeClassCount; ++i) {
+          pStats->SizeClassAllocationCount[i] +=
+              pHeap->ClassAllocationCount[i].load(std::memory_order_relaxed);
+          classBytes[i] +=
+              pHeap->ClassBytesInUse[i].load(std::memory_order_relaxed);
+        }
+      }
+    }
+    // Per-thread byte counts can go negative when blocks are freed on another
+    // thread.  Their sum can't, except for a moment during concurrent frees.
+    for (unsigned i = 0; i < kSizeClassCount; ++i) {
+      pStats->SizeClassBytesInUse[i] = classBytes[i] > 0 ? classBytes[i] : 0;
+      pStats->BytesInUse += pStats->SizeClassBytesInUse[i];
+    }
+    pStats->BytesReserved = m_BytesReserved.load();
+    pStats->PeakBytesReserved = m_PeakBytesReserved.load();
+    return S_OK;
+  }
+};
+
+ThreadHeapList::~ThreadHeapList() {
+  std::lock_guard<std::mutex> lock(GetThreadHeapsLock());
+  while (pHead != nullptr) {
+    PoolThreadHeap *pHeap = pHead;
+    UnlinkFromThread(pHeap);
+    pHeap->pPool->ReleaseThreadHeap(pHeap);
+  }
+}
+
+} // namespace
+
+HRESULT CreateDxcPooledMalloc(_In_ REFIID riid, _Out_ LPVOID *ppv) {
+  IMalloc *pBacking = DxcGetThreadMallocNoRef();
+  void *P = pBacking->Alloc(sizeof(DxcPooledMalloc));
+  if (P == nullptr)
+    return E_OUTOFMEMORY;
+  CComPtr<DxcPooledMalloc> pPool = new (P) DxcPooledMalloc(pBacking);
+  return pPool->QueryInterface(riid, ppv);
+}
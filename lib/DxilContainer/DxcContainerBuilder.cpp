@@ -21,6 +21,7 @@
 
 #include <algorithm>
 #include "llvm/ADT/SmallVector.h"
+#include "llvm/Support/MD5.h"
 
 // This declaration is used for the locally-linked validator.
 HRESULT CreateDxcValidator(_In_ REFIID riid, _Out_ LPVOID *ppv);
@@ -160,6 +161,218 @@ HRESULT STDMETHODCALLTYPE DxcContainerBuilder::SerializeContainer(_Out_ IDxcOper
   CATCH_CPP_RETURN_HRESULT();
 }
 
+namespace {
+// A container delta, as produced by CreateDelta, is laid out as:
+//   DxilContainerDeltaHeader Header;
+//   DxilContainerDeltaPart Parts[Header.Target.PartCount];
+//   uint8_t Data[]; // Contents of the parts not taken from the base, in
+//                   // order, each padded to 4 bytes.
+// The target header is copied as is, so the container hash survives a
+// round trip.
+static const uint32_t DxilContainerDeltaMagic = 0x544C4444; // 'DDLT'
+static const uint32_t DxilContainerDeltaVersion = 1;
+static const uint32_t DxilContainerDeltaInline = UINT32_MAX;
+
+struct DxilContainerDeltaHeader {
+  uint32_t Magic;
+  uint32_t Version;
+  uint32_t BaseSizeInBytes;
+  uint8_t BaseHash[16];       // MD5 of the whole base container.
+  DxilContainerHeader Target; // Header of the container the delta rebuilds.
+};
+
+struct DxilContainerDeltaPart {
+  uint32_t PartFourCC;
+  uint32_t PartSize;
+  uint32_t BaseIndex; // Index of the identical base part, or DxilContainerDeltaInline.
+};
+}
+
+static const DxilContainerHeader *GetValidContainer(IDxcBlob *pBlob) {
+  IFTBOOL(pBlob != nullptr, E_INVALIDARG);
+  const DxilContainerHeader *pHeader =
+      IsDxilContainerLike(pBlob->GetBufferPointer(), pBlob->GetBufferSize());
+  IFTBOOL(pHeader != nullptr &&
+              IsValidDxilContainer(pHeader, pBlob->GetBufferSize()),
+          DXC_E_CONTAINER_INVALID);
+  return pHeader;
+}
+
+static void HashContainer(IDxcBlob *pBlob, uint8_t (&Hash)[16]) {
+  llvm::MD5 md5;
+  md5.update(llvm::ArrayRef<uint8_t>((const uint8_t *)pBlob->GetBufferPointer(),
+                                     pBlob->GetBufferSize()));
+  llvm::MD5::MD5Result Result;
+  md5.final(Result);
+  memcpy(Hash, Result, sizeof(Hash));
+}
+
+static uint32_t AlignDeltaData(uint32_t size) {
+  return (size + 3) & ~3u;
+}
+
+HRESULT STDMETHODCALLTYPE DxcContainerBuilder::CreateDelta(
+    _In_ IDxcBlob *pBase, _In_ IDxcBlob *pTarget,
+    _COM_Outptr_ IDxcBlob **ppDelta) {
+  if (ppDelta == nullptr)
+    return E_INVALIDARG;
+  *ppDelta = nullptr;
+  DxcThreadMalloc TM(m_pMalloc);
+  try {
+    const DxilContainerHeader *pBaseHeader = GetValidContainer(pBase);
+    const DxilContainerHeader *pTargetHeader = GetValidContainer(pTarget);
+
+    // ApplyDelta lays out parts back to back, so only such containers can be
+    // rebuilt exactly.
+    uint32_t offset = sizeof(DxilContainerHeader) +
+                      GetOffsetTableSize(pTargetHeader->PartCount);
+    for (uint32_t i = 0; i < pTargetHeader->PartCount; ++i) {
+      const DxilPartHeader *pPart = GetDxilContainerPart(pTargetHeader, i);
+      IFTBOOL((const char *)pPart - (const char *)pTargetHeader == offset,
+              DXC_E_CONTAINER_INVALID);
+      offset += sizeof(DxilPartHeader) + pPart->PartSize;
+    }
+    IFTBOOL(offset == pTargetHeader->ContainerSizeInBytes,
+            DXC_E_CONTAINER_INVALID);
+
+    DxilContainerDeltaHeader header = {};
+    header.Magic = DxilContainerDeltaMagic;
+    header.Version = DxilContainerDeltaVersion;
+    header.BaseSizeInBytes = (uint32_t)pBase->GetBufferSize();
+    HashContainer(pBase, header.BaseHash);
+    header.Target = *pTargetHeader;
+
+    llvm::SmallVector<DxilContainerDeltaPart, 8> parts;
+    for (DxilPartIterator it = begin(pTargetHeader), itEnd = end(pTargetHeader);
+         it != itEnd; ++it) {
+      const DxilPartHeader *pPart = *it;
+      DxilContainerDeltaPart deltaPart = {pPart->PartFourCC, pPart->PartSize,
+                                          DxilContainerDeltaInline};
+      for (uint32_t i = 0; i < pBaseHeader->PartCount; ++i) {
+        const DxilPartHeader *pBasePart = GetDxilContainerPart(pBaseHeader, i);
+        if (pBasePart->PartFourCC == pPart->PartFourCC &&
+            pBasePart->PartSize == pPart->PartSize &&
+            0 == memcmp(GetDxilPartData(pBasePart), GetDxilPartData(pPart),
+                        pPart->PartSize)) {
+          deltaPart.BaseIndex = i;
+          break;
+        }
+      }
+      parts.push_back(deltaPart);
+    }
+
+    CComPtr<AbstractMemoryStream> pStream;
+    IFT(CreateMemoryStream(m_pMalloc, &pStream));
+    ULONG cbWritten;
+    IFT(pStream->Write(&header, sizeof(header), &cbWritten));
+    IFT(pStream->Write(parts.data(), parts.size() * sizeof(parts[0]), &cbWritten));
+    const uint32_t zero = 0;
+    for (uint32_t i = 0; i < pTargetHeader->PartCount; ++i) {
+      if (parts[i].BaseIndex != DxilContainerDeltaInline)
+        continue;
+      const DxilPartHeader *pPart = GetDxilContainerPart(pTargetHeader, i);
+      IFT(pStream->Write(GetDxilPartData(pPart), pPart->PartSize, &cbWritten));
+      uint32_t padding = AlignDeltaData(pPart->PartSize) - pPart->PartSize;
+      if (padding)
+        IFT(pStream->Write(&zero, padding, &cbWritten));
+    }
+    IFT(pStream->QueryInterface(ppDelta));
+    return S_OK;
+  }
+  CATCH_CPP_RETURN_HRESULT();
+}
+
+HRESULT STDMETHODCALLTYPE DxcContainerBuilder::ApplyDelta(
+    _In_ IDxcBlob *pBase, _In_ IDxcBlob *pDelta,
+    _COM_Outptr_ IDxcBlob **ppTarget) {
+  if (ppTarget == nullptr)
+    return E_INVALIDARG;
+  *ppTarget = nullptr;
+  DxcThreadMalloc TM(m_pMalloc);
+  try {
+    const DxilContainerHeader *pBaseHeader = GetValidContainer(pBase);
+    IFTBOOL(pDelta != nullptr &&
+                pDelta->GetBufferSize() >= sizeof(DxilContainerDeltaHeader),
+            E_INVALIDARG);
+    const char *pDeltaData = (const char *)pDelta->GetBufferPointer();
+    const char *pDeltaEnd = pDeltaData + pDelta->GetBufferSize();
+    const DxilContainerDeltaHeader *pHeader =
+        (const DxilContainerDeltaHeader *)pDeltaData;
+    IFTBOOL(pHeader->Magic == DxilContainerDeltaMagic &&
+                pHeader->Version == DxilContainerDeltaVersion,
+            E_INVALIDARG);
+
+    // The delta only describes how to rebuild the target from the exact base
+    // it was computed against.
+    uint8_t baseHash[16];
+    HashContainer(pBase, baseHash);
+    IFTBOOL(pHeader->BaseSizeInBytes == pBase->GetBufferSize() &&
+                0 == memcmp(baseHash, pHeader->BaseHash, sizeof(baseHash)),
+            E_INVALIDARG);
+
+    const DxilContainerHeader &target = pHeader->Target;
+    size_t partsSize = (size_t)target.PartCount * sizeof(DxilContainerDeltaPart);
+    IFTBOOL(partsSize <= (size_t)(pDeltaEnd - (const char *)(pHeader + 1)),
+            DXC_E_CONTAINER_INVALID);
+    const DxilContainerDeltaPart *pParts =
+        (const DxilContainerDeltaPart *)(pHeader + 1);
+    const char *pInlineData = (const char *)(pParts + target.PartCount);
+
+    // Check every part reference before writing anything.
+    uint64_t targetSize = sizeof(DxilContainerHeader) +
+                          GetOffsetTableSize(target.PartCount);
+    uint64_t inlineSize = 0;
+    for (uint32_t i = 0; i < target.PartCount; ++i) {
+      const DxilContainerDeltaPart &part = pParts[i];
+      if (part.BaseIndex == DxilContainerDeltaInline) {
+        inlineSize += AlignDeltaData(part.PartSize);
+      } else {
+        IFTBOOL(part.BaseIndex < pBaseHeader->PartCount,
+                DXC_E_CONTAINER_INVALID);
+        const DxilPartHeader *pBasePart =
+            GetDxilContainerPart(pBaseHeader, part.BaseIndex);
+        IFTBOOL(pBasePart->PartFourCC == part.PartFourCC &&
+                    pBasePart->PartSize == part.PartSize,
+                DXC_E_CONTAINER_INVALID);
+      }
+      targetSize += sizeof(DxilPartHeader) + part.PartSize;
+    }
+    IFTBOOL(inlineSize <= (uint64_t)(pDeltaEnd - pInlineData) &&
+                targetSize == target.ContainerSizeInBytes,
+            DXC_E_CONTAINER_INVALID);
+
+    CComPtr<AbstractMemoryStream> pStream;
+    IFT(CreateMemoryStream(m_pMalloc, &pStream));
+    IFT(pStream->Reserve(target.ContainerSizeInBytes));
+    ULONG cbWritten;
+    IFT(pStream->Write(&target, sizeof(target), &cbWritten));
+    uint32_t offset = sizeof(DxilContainerHeader) +
+                      GetOffsetTableSize(target.PartCount);
+    for (uint32_t i = 0; i < target.PartCount; ++i) {
+      IFT(pStream->Write(&offset, sizeof(offset), &cbWritten));
+      offset += sizeof(DxilPartHeader) + pParts[i].PartSize;
+    }
+    for (uint32_t i = 0; i < target.PartCount; ++i) {
+      const DxilContainerDeltaPart &part = pParts[i];
+      DxilPartHeader partHeader = {part.PartFourCC, part.PartSize};
+      IFT(pStream->Write(&partHeader, sizeof(partHeader), &cbWritten));
+      const char *pData;
+      if (part.BaseIndex == DxilContainerDeltaInline) {
+        pData = pInlineData;
+        pInlineData += AlignDeltaData(part.PartSize);
+      } else {
+        pData = GetDxilPartData(
+            GetDxilContainerPart(pBaseHeader, part.BaseIndex));
+      }
+      IFT(pStream->Write(pData, part.PartSize, &cbWritten));
+    }
+    DXASSERT_NOMSG(pStream->GetPtrSize() == target.ContainerSizeInBytes);
+    IFT(pStream->QueryInterface(ppTarget));
+    return S_OK;
+  }
+  CATCH_CPP_RETURN_HRESULT();
+}
+
 UINT32 DxcContainerBuilder::ComputeContainerSize() {
   UINT32 partsSize = 0;
   for (DxilPart part : m_parts) {
@@ -10,7 +10,10 @@
 ///////////////////////////////////////////////////////////////////////////////
 
 #include "dxc/DxilContainer/DxilContainer.h"
+#include "dxc/DxilContainer/DxilPipelineStateValidation.h"
+#include "llvm/Support/xxhash.h"
 #include <algorithm>
+#include <vector>
 
 namespace hlsl {
 
@@ -137,4 +140,43 @@ DxilProgramHeader *GetDxilProgramHeader(DxilContainerHeader *pHeader, DxilFourCC
       GetDxilProgramHeader(static_cast<const DxilContainerHeader *>(pHeader), fourCC));
 }
 
+static uint64_t HashDxilPart(const DxilContainerHeader *pHeader,
+                             DxilFourCC fourCC) {
+  const DxilPartHeader *pPart = GetDxilPartByType(pHeader, fourCC);
+  if (!pPart)
+    return 0;
+  return llvm::xxHash64(llvm::ArrayRef<uint8_t>(
+      reinterpret_cast<const uint8_t *>(GetDxilPartData(pPart)),
+      pPart->PartSize));
+}
+
+bool GetDxilContainerFingerprint(const DxilContainerHeader *pHeader,
+                                 DxilContainerFingerprint *pFingerprint) {
+  memset(pFingerprint, 0, sizeof(*pFingerprint));
+  pFingerprint->InputSignature = HashDxilPart(pHeader, DFCC_InputSignature);
+  pFingerprint->OutputSignature = HashDxilPart(pHeader, DFCC_OutputSignature);
+  pFingerprint->PatchConstOrPrimSignature =
+      HashDxilPart(pHeader, DFCC_PatchConstantSignature);
+  pFingerprint->RootSignature = HashDxilPart(pHeader, DFCC_RootSignature);
+
+  const DxilPartHeader *pPSVPart =
+      GetDxilPartByType(pHeader, DFCC_PipelineStateValidation);
+  if (!pPSVPart)
+    return true;
+  DxilPipelineStateValidation PSV;
+  if (!PSV.InitFromPSV0(GetDxilPartData(pPSVPart), pPSVPart->PartSize))
+    return false;
+  // Only the version 0 fields of the bindings describe the layout; the later
+  // ones such as resource kind don't affect root signature compatibility.
+  uint32_t bindCount = PSV.GetBindCount();
+  std::vector<PSVResourceBindInfo0> bindings;
+  bindings.reserve(bindCount);
+  for (uint32_t i = 0; i < bindCount; ++i)
+    bindings.push_back(*PSV.GetPSVResourceBindInfo0(i));
+  pFingerprint->ResourceBindings = llvm::xxHash64(llvm::ArrayRef<uint8_t>(
+      reinterpret_cast<const uint8_t *>(bindings.data()),
+      bindings.size() * sizeof(PSVResourceBindInfo0)));
+  return true;
+}
+
 } // namespace hlsl
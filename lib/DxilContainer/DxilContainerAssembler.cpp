@@ -17,6 +17,9 @@
 #include "llvm/IR/Operator.h"
 #include "llvm/Bitcode/ReaderWriter.h"
 #include "llvm/Support/MD5.h"
+#include "llvm/Support/TimeProfiler.h"
+#include "llvm/Support/Endian.h"
+#include "llvm/Support/xxhash.h"
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/Transforms/Utils/Cloning.h"
 #include "dxc/DxilContainer/DxilContainer.h"
@@ -40,6 +43,8 @@
 #include "dxc/DXIL/DxilCounters.h"
 #include <algorithm>
 #include <functional>
+#include <system_error>
+#include <thread>
 
 using namespace llvm;
 using namespace hlsl;
@@ -1307,7 +1312,7 @@ private:
               m_pIndexArraysPart->AddIndex(m_FuncToDependencies[&function].begin(),
                                   m_FuncToDependencies[&function].end());
         RuntimeDataFunctionInfo info = {};
-        ShaderFlags flags = ShaderFlags::CollectShaderFlags(&function, &DM);
+        ShaderFlags flags = DM.GetShaderFlagsForFunction(&function);
         if (DM.HasDxilFunctionProps(&function)) {
           const auto &props = DM.GetDxilFunctionProps(&function);
           if (props.IsClosestHit() || props.IsAnyHit()) {
@@ -1607,6 +1612,39 @@ DxilContainerWriter *hlsl::NewDxilContainerWriter(bool bUnaligned) {
   return new DxilContainerWriter_impl(bUnaligned);
 }
 
+static void ComputeShaderHash(AbstractMemoryStream *pBitcode,
+                              bool bIncludesSource, bool bFastHash,
+                              DxilShaderHash &Hash) {
+  ArrayRef<uint8_t> Data(pBitcode->GetPtr(), pBitcode->GetPtrSize());
+  Hash.Flags = bIncludesSource ? (uint32_t)DxilShaderHashFlags::IncludesSource
+                               : (uint32_t)DxilShaderHashFlags::None;
+  if (bFastHash) {
+    static_assert(sizeof(Hash.Digest) == 2 * sizeof(uint64_t),
+                  "otherwise, digest layout must change");
+    Hash.Flags |= (uint32_t)DxilShaderHashFlags::XXHash64;
+    support::endian::write64le(Hash.Digest, llvm::xxHash64(Data, 0));
+    support::endian::write64le(Hash.Digest + 8, llvm::xxHash64(Data, 1));
+    return;
+  }
+  llvm::MD5 md5;
+  md5.update(Data);
+  md5.final(Hash.Digest);
+}
+
+namespace {
+// Joins the thread on scope exit, so that an exception thrown while the
+// thread runs cannot destroy a joinable std::thread.
+struct ScopedThreadJoin {
+  std::thread &Thread;
+  ScopedThreadJoin(std::thread &Thread) : Thread(Thread) {}
+  ~ScopedThreadJoin() { Join(); }
+  void Join() {
+    if (Thread.joinable())
+      Thread.join();
+  }
+};
+}
+
 static bool HasDebugInfoOrLineNumbers(const Module &M) {
   return
     llvm::getDebugMetadataVersionFromModule(M) != 0 ||
@@ -1683,15 +1721,23 @@ static std::unique_ptr<Module> CloneModuleForReflection(Module *pM) {
   unsigned ValMajor = 0, ValMinor = 0;
   DM.GetValidatorVersion(ValMajor, ValMinor);
 
+  // Keep the metadata of the main module, rather than emitting it again after
+  // cloning, which is costly for large type systems.
+  DxilModule::DxilMetadataSnapshot Snapshot;
+  DM.SaveDxilMetadata(Snapshot);
+
   // Emit the latest reflection metadata
   hlsl::ReEmitLatestReflectionData(pM);
 
-  // Clone module
-  std::unique_ptr<Module> reflectionModule( llvm::CloneModule(pM) );
+  // Clone module. Function bodies are not part of the reflection stream, so
+  // skip cloning them rather than deleting them afterwards.
+  ValueToValueMapTy VMap;
+  std::unique_ptr<Module> reflectionModule(
+      llvm::CloneModule(pM, VMap, [](const Function *) { return false; }));
 
-  // Now restore validator version on main module and re-emit metadata.
+  // Now restore validator version and metadata on main module.
   DM.SetValidatorVersion(ValMajor, ValMinor);
-  DM.ReEmitDxilResources();
+  DM.RestoreDxilMetadata(Snapshot);
 
   return reflectionModule;
 }
@@ -1837,9 +1883,13 @@ void hlsl::SerializeDxilContainerForModule(
     }
   }
 
-  // If metadata was stripped, re-serialize the input module.
+  // If metadata was stripped, re-serialize the input module. When there is
+  // debug info the program part is re-serialized after stripping it anyway,
+  // so the input module is then only needed for the debug part.
+  bool bHasDebugInfo = HasDebugInfoOrLineNumbers(*pModule->GetModule());
   CComPtr<AbstractMemoryStream> pInputProgramStream = pModuleBitcode;
-  if (bMetadataStripped) {
+  if (bMetadataStripped &&
+      (!bHasDebugInfo || (Flags & SerializeDxilFlags::IncludeDebugInfoPart))) {
     pInputProgramStream.Release();
     IFT(CreateMemoryStream(DxcGetThreadMallocNoRef(), &pInputProgramStream));
     raw_stream_ostream outStream(pInputProgramStream.p);
@@ -1849,10 +1899,10 @@ void hlsl::SerializeDxilContainerForModule(
   // If we have debug information present, serialize it to a debug part, then use the stripped version as the canonical program version.
   CComPtr<AbstractMemoryStream> pProgramStream = pInputProgramStream;
   bool bModuleStripped = false;
-  if (HasDebugInfoOrLineNumbers(*pModule->GetModule())) {
-    uint32_t debugInUInt32, debugPaddingBytes;
-    GetPaddedProgramPartSize(pInputProgramStream, debugInUInt32, debugPaddingBytes);
+  if (bHasDebugInfo) {
     if (Flags & SerializeDxilFlags::IncludeDebugInfoPart) {
+      uint32_t debugInUInt32, debugPaddingBytes;
+      GetPaddedProgramPartSize(pInputProgramStream, debugInUInt32, debugPaddingBytes);
       writer.AddPart(DFCC_ShaderDebugInfoDXIL, debugInUInt32 * sizeof(uint32_t) + sizeof(DxilProgramHeader), [&](AbstractMemoryStream *pStream) {
         hlsl::WriteProgramPart(pModule->GetShaderModel(), pInputProgramStream, pStream);
       });
@@ -1867,6 +1917,31 @@ void hlsl::SerializeDxilContainerForModule(
     Flags &= ~SerializeDxilFlags::DebugNameDependOnSource;
   }
 
+  bool bNeedHash = bSupportsShaderHash || pShaderHashOut ||
+                   (Flags & SerializeDxilFlags::IncludeDebugNamePart &&
+                    DebugName.empty());
+  bool bFastHash = Flags & SerializeDxilFlags::FastShaderHash;
+  DxilShaderHash HashContent;
+  bool bHashStarted = false;
+
+  // A hash of the source-dependent input bitcode does not depend on anything
+  // below, so compute it on another thread while reflection is stripped and
+  // the program is re-serialized.
+  std::thread HashThread;
+  ScopedThreadJoin HashThreadJoin(HashThread);
+  if (bNeedHash && (Flags & SerializeDxilFlags::DebugNameDependOnSource) &&
+      std::thread::hardware_concurrency() > 1) {
+    try {
+      HashThread = std::thread([&]() {
+        ComputeShaderHash(pModuleBitcode, /*bIncludesSource*/ true, bFastHash,
+                          HashContent);
+      });
+      bHashStarted = true;
+    } catch (const std::system_error &) {
+      // Hash on this thread below.
+    }
+  }
+
   uint32_t reflectPartSizeInBytes = 0;
   CComPtr<AbstractMemoryStream> pReflectionBitcodeStream;
 
@@ -1913,25 +1988,23 @@ void hlsl::SerializeDxilContainerForModule(
   }
 
   // Compute hash if needed.
-  DxilShaderHash HashContent;
   SmallString<32> HashStr;
-  if (bSupportsShaderHash || pShaderHashOut ||
-      (Flags & SerializeDxilFlags::IncludeDebugNamePart &&
-        DebugName.empty()))
-  {
-    // If the debug name should be specific to the sources, base the name on the debug
-    // bitcode, which will include the source references, line numbers, etc. Otherwise,
-    // do it exclusively on the target shader bitcode.
-    llvm::MD5 md5;
-    if (Flags & SerializeDxilFlags::DebugNameDependOnSource) {
-      md5.update(ArrayRef<uint8_t>(pModuleBitcode->GetPtr(), pModuleBitcode->GetPtrSize()));
-      HashContent.Flags = (uint32_t)DxilShaderHashFlags::IncludesSource;
+  if (bNeedHash) {
+    llvm::TimeTraceScope TimeScope("Hash");
+    if (bHashStarted) {
+      HashThreadJoin.Join();
     } else {
-      md5.update(ArrayRef<uint8_t>(pProgramStream->GetPtr(), pProgramStream->GetPtrSize()));
-      HashContent.Flags = (uint32_t)DxilShaderHashFlags::None;
+      // If the debug name should be specific to the sources, base the name on the debug
+      // bitcode, which will include the source references, line numbers, etc. Otherwise,
+      // do it exclusively on the target shader bitcode.
+      if (Flags & SerializeDxilFlags::DebugNameDependOnSource)
+        ComputeShaderHash(pModuleBitcode, /*bIncludesSource*/ true, bFastHash,
+                          HashContent);
+      else
+        ComputeShaderHash(pProgramStream, /*bIncludesSource*/ false, bFastHash,
+                          HashContent);
     }
-    md5.final(HashContent.Digest);
-    md5.stringifyResult(HashContent.Digest, HashStr);
+    llvm::MD5::stringifyResult(HashContent.Digest, HashStr);
   }
 
   // Serialize debug name if requested.
@@ -27,6 +27,9 @@
 #include "llvm/IR/IntrinsicInst.h"
 #include "llvm/IR/Module.h"
 
+#include <algorithm>
+#include <map>
+#include <set>
 #include <unordered_map>
 
 // ValidateDbgDeclare ensures that all of the bits in
@@ -63,10 +66,20 @@ struct dxil_debug_info::LiveVariables::Impl
   using LiveVarsMap =
       std::unordered_map<llvm::DIScope*, VariableInfoMap>;
 
+  // The named variables declared in a scope, sorted by declaration line.
+  using ScopeVariables = std::vector<const VariableInfo *>;
+
+  // The live variables at a given scope and source line.
+  using ScopeAndLine = std::pair<llvm::DIScope *, unsigned>;
+  using LiveVarsCache =
+      std::map<ScopeAndLine, std::vector<const VariableInfo *>>;
+
   IMalloc *m_pMalloc;
   DxcPixDxilDebugInfo *m_pDxilDebugInfo;
   llvm::Module *m_pModule;
   LiveVarsMap m_LiveVarsDbgDeclare;
+  std::unordered_map<llvm::DIScope *, ScopeVariables> m_ScopeVariables;
+  LiveVarsCache m_LiveVarsCache;
 
   void Init(
       IMalloc *pMalloc,
@@ -75,6 +88,11 @@ struct dxil_debug_info::LiveVariables::Impl
 
   void Init_DbgDeclare(llvm::DbgDeclareInst *DbgDeclare);
 
+  void Init_ScopeVariables();
+
+  const std::vector<const VariableInfo *> &
+  GetLiveVariables(llvm::DIScope *S, unsigned Line);
+
   VariableInfo *AssignValueToOffset(
       VariableInfoMap *VarInfoMap,
       llvm::DIVariable *Var,
@@ -103,6 +121,92 @@ void dxil_debug_info::LiveVariables::Impl::Init(
       Init_DbgDeclare(DbgDeclare);
     }
   }
+
+  Init_ScopeVariables();
+}
+
+void dxil_debug_info::LiveVariables::Impl::Init_ScopeVariables()
+{
+  // Sorting each scope's variables by line lets a query take the ones
+  // declared at or before its line with a binary search, instead of testing
+  // every variable in every enclosing scope.
+  auto LineOf = [](const VariableInfo *VarInfo)
+  {
+    return VarInfo->m_Variable->getLine();
+  };
+
+  for (const auto &ScopeAndVars : m_LiveVarsDbgDeclare)
+  {
+    ScopeVariables &Vars = m_ScopeVariables[ScopeAndVars.first];
+    for (const auto &VarAndInfo : ScopeAndVars.second)
+    {
+      if (VarAndInfo.first->getName().empty())
+      {
+        // No name?...
+        continue;
+      }
+      Vars.emplace_back(VarAndInfo.second.get());
+    }
+    std::stable_sort(
+        Vars.begin(),
+        Vars.end(),
+        [&](const VariableInfo *L, const VariableInfo *R)
+        {
+          return LineOf(L) < LineOf(R);
+        });
+  }
+}
+
+const std::vector<const dxil_debug_info::VariableInfo *> &
+dxil_debug_info::LiveVariables::Impl::GetLiveVariables(
+    llvm::DIScope *S,
+    unsigned Line)
+{
+  // Stepping revisits the same lines over and over: the answer depends only
+  // on the innermost scope and the line, so compute it once.
+  auto Cached = m_LiveVarsCache.find(ScopeAndLine(S, Line));
+  if (Cached != m_LiveVarsCache.end())
+  {
+    return Cached->second;
+  }
+
+  std::vector<const VariableInfo *> LiveVars;
+  std::set<llvm::StringRef> LiveVarsName;
+
+  const llvm::DITypeIdentifierMap EmptyMap;
+  for (llvm::DIScope *Scope = S; Scope != nullptr;
+       Scope = Scope->getScope().resolve(EmptyMap))
+  {
+    auto it = m_ScopeVariables.find(Scope);
+    if (it == m_ScopeVariables.end())
+    {
+      continue;
+    }
+
+    // Variables defined later in the HLSL source are not live yet.
+    auto End = std::upper_bound(
+        it->second.begin(),
+        it->second.end(),
+        Line,
+        [](unsigned Line, const VariableInfo *VarInfo)
+        {
+          return Line < VarInfo->m_Variable->getLine();
+        });
+    for (auto VarIt = it->second.begin(); VarIt != End; ++VarIt)
+    {
+      if (!LiveVarsName.insert((*VarIt)->m_Variable->getName()).second)
+      {
+        // There's a variable with the same name; use the
+        // previous one instead.
+        continue;
+      }
+
+      LiveVars.emplace_back(*VarIt);
+    }
+  }
+
+  return m_LiveVarsCache.emplace(ScopeAndLine(S, Line), std::move(LiveVars))
+      .first->second;
 }
 
 void dxil_debug_info::LiveVariables::Impl::Init_DbgDeclare(
@@ -219,9 +323,6 @@ HRESULT dxil_debug_info::LiveVariables::GetLiveVariablesAtInstruction(
   DXASSERT(IP != nullptr, "else IP should not be nullptr");
   DXASSERT(ppResult != nullptr, "else Result should not be nullptr");
 
-  std::vector<const VariableInfo *> LiveVars;
-  std::set<std::string> LiveVarsName;
-
   const llvm::DebugLoc &DL = IP->getDebugLoc();
 
   if (!DL)
@@ -235,38 +336,8 @@ HRESULT dxil_debug_info::LiveVariables::GetLiveVariablesAtInstruction(
     return E_FAIL;
   }
 
-  const llvm::DITypeIdentifierMap EmptyMap;
-  while (S != nullptr)
-  {
-    auto it = m_pImpl->m_LiveVarsDbgDeclare.find(S);
-    if (it != m_pImpl->m_LiveVarsDbgDeclare.end())
-    {
-      for (const auto &VarAndInfo :  it->second)
-      {
-        auto *Var = VarAndInfo.first;
-        llvm::StringRef VarName = Var->getName();
-        if (Var->getLine() > DL.getLine())
-        {
-          // Defined later in the HLSL source.
-          continue;
-        }
-        if (VarName.empty())
-        {
-          // No name?...
-          continue;
-        }
-        if (!LiveVarsName.insert(VarName).second)
-        {
-          // There's a variable with the same name; use the
-          // previous one instead.
-          continue;
-        }
-
-        LiveVars.emplace_back(VarAndInfo.second.get());
-      }
-    }
-    S = S->getScope().resolve(EmptyMap);
-  }
+  std::vector<const VariableInfo *> LiveVars =
+      m_pImpl->GetLiveVariables(S, DL.getLine());
 
   return CreateDxilLiveVariables(
       m_pImpl->m_pDxilDebugInfo,
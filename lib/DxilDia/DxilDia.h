@@ -14,6 +14,13 @@
 
 #include "llvm/ADT/StringRef.h"
 
+#include <cstdint>
+
+namespace llvm {
+class Instruction;
+class MDNode;
+}  // namespace llvm
+
 namespace dxil_dia {
 // Single program, single compiland allows for some simplifications.
 static constexpr DWORD HlslProgramId = 1;
@@ -25,6 +32,17 @@ static constexpr DWORD HlslCompilandEnvEntryId = 6;
 static constexpr DWORD HlslCompilandEnvDefinesId = 7;
 static constexpr DWORD HlslCompilandEnvArgumentsId = 8;
 
+// Line information of an instruction, decoded once when the session loads.
+struct InstructionLine {
+  unsigned Rva = 0;
+  std::uint32_t Line = 0;
+  std::uint32_t Column = 0;
+  DWORD FileId = 0;
+  bool HasFileId = false;  // False if the scope names no known source file.
+  llvm::MDNode *Scope = nullptr;
+  const llvm::Instruction *Inst = nullptr;
+};
+
 HRESULT ENotImpl();
 HRESULT StringRefToBSTR(llvm::StringRef value, BSTR *pRetVal);
 }  // namespace dxil_dia
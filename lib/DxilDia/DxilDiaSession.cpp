@@ -13,7 +13,9 @@
 
 #include "dxc/DxilPIXPasses/DxilPIXPasses.h"
 #include "dxc/DxilPIXPasses/DxilPIXVirtualRegisters.h"
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/STLExtras.h"
+#include "llvm/IR/DebugInfoMetadata.h"
 #include "llvm/IR/Function.h"
 #include "llvm/IR/InstIterator.h"
 #include "llvm/IR/Instruction.h"
@@ -31,6 +33,9 @@
 #include "DxilDiaTableSourceFiles.h"
 #include "DxilDiaTableSymbols.h"
 
+#include <algorithm>
+#include <climits>
+
 void dxil_dia::Session::Init(
     std::shared_ptr<llvm::LLVMContext> context,
     std::shared_ptr<llvm::Module> mod,
@@ -82,16 +87,60 @@ void dxil_dia::Session::Init(
         continue;
       }
       m_rvaMap.insert({ &i, rva });
-      m_instructions.insert({ rva, &i});
-      if (llvm::DebugLoc DL = i.getDebugLoc()) {
-        auto result = m_lineToInfoMap.emplace(DL.getLine(), LineInfo(DL.getCol(), rva, rva + 1));
-        if (!result.second) {
-          result.first->second.StartCol = std::min(result.first->second.StartCol, DL.getCol());
-          result.first->second.Last = rva + 1;
-        }
-        m_instructionLines.push_back(&i);
-      }
+      m_instructions.emplace_back(rva, &i);
+    }
+  }
+
+  // Sort by RVA so lookups and range queries are binary searches. When an
+  // RVA is repeated, the first instruction numbered with it wins.
+  std::stable_sort(m_instructions.begin(), m_instructions.end(),
+                   [](const RVAMap::value_type &a, const RVAMap::value_type &b) {
+                     return a.first < b.first;
+                   });
+  m_instructions.erase(
+      std::unique(m_instructions.begin(), m_instructions.end(),
+                  [](const RVAMap::value_type &a, const RVAMap::value_type &b) {
+                    return a.first == b.first;
+                  }),
+      m_instructions.end());
+
+  // Decode the line info of every instruction once, rather than each time a
+  // line number is queried. Source files are looked up once per scope.
+  llvm::DenseMap<llvm::MDNode *, std::pair<bool, DWORD>> scopeFiles;
+  for (const auto &entry : m_instructions) {
+    const RVA rva = entry.first;
+    const llvm::Instruction *i = entry.second;
+    const llvm::DebugLoc &DL = i->getDebugLoc();
+    if (!DL) {
+      continue;
+    }
+    auto result = m_lineToInfoMap.emplace(DL.getLine(), LineInfo(DL.getCol(), rva, rva + 1));
+    if (!result.second) {
+      result.first->second.StartCol = std::min(result.first->second.StartCol, DL.getCol());
+      result.first->second.Last = rva + 1;
     }
+
+    InstructionLine line;
+    line.Rva = rva;
+    line.Line = DL.getLine();
+    line.Column = DL.getCol();
+    line.Scope = DL.getScope();
+    line.Inst = i;
+    auto fileIt = scopeFiles.find(line.Scope);
+    if (fileIt == scopeFiles.end()) {
+      llvm::DIFile *file = nullptr;
+      if (auto *pBlock = llvm::dyn_cast_or_null<llvm::DILexicalBlock>(line.Scope))
+        file = pBlock->getFile();
+      else if (auto *pSubProgram = llvm::dyn_cast_or_null<llvm::DISubprogram>(line.Scope))
+        file = pSubProgram->getFile();
+      DWORD fileId = 0;
+      bool hasFileId =
+          file && getSourceFileIdByName(file->getFilename(), &fileId) == S_OK;
+      fileIt = scopeFiles.insert({ line.Scope, { hasFileId, fileId } }).first;
+    }
+    line.HasFileId = fileIt->second.first;
+    line.FileId = fileIt->second.second;
+    m_instructionLines.push_back(line);
   }
 
   // Sanity check to make sure rva map is same as instruction index.
@@ -100,12 +149,37 @@ void dxil_dia::Session::Init(
     DXASSERT(m_rvaMap[It->second] == It->first, "instruction mapped to wrong rva");
   }
 
-  // Initialize symbols
-  try {
-      m_symsMgr.Init(this);
-  } catch (const hlsl::Exception &) {
-      m_symsMgr = std::move(dxil_dia::SymbolManager());
-  }
+  // Symbols are built the first time one is requested.
+  m_symsMgr.Init(this);
+}
+
+const llvm::Instruction *dxil_dia::Session::FindInstruction(RVA rva) const {
+  auto range = InstructionsInRange(rva, rva + 1);
+  return range.begin() == range.end() ? nullptr : range.begin()->second;
+}
+
+llvm::iterator_range<dxil_dia::Session::RVAMap::const_iterator>
+dxil_dia::Session::InstructionsInRange(RVA first, RVA end) const {
+  auto rvaLess = [](const RVAMap::value_type &entry, RVA rva) {
+    return entry.first < rva;
+  };
+  auto begin = std::lower_bound(m_instructions.begin(), m_instructions.end(),
+                                first, rvaLess);
+  auto last = std::lower_bound(begin, m_instructions.end(),
+                               std::max(first, end), rvaLess);
+  return llvm::make_range(begin, last);
+}
+
+llvm::iterator_range<dxil_dia::Session::InstructionLines::const_iterator>
+dxil_dia::Session::InstructionLinesInRange(RVA first, RVA end) const {
+  auto rvaLess = [](const InstructionLine &line, RVA rva) {
+    return line.Rva < rva;
+  };
+  auto begin = std::lower_bound(m_instructionLines.begin(),
+                                m_instructionLines.end(), first, rvaLess);
+  auto last = std::lower_bound(begin, m_instructionLines.end(),
+                               std::max(first, end), rvaLess);
+  return llvm::make_range(begin, last);
 }
 
 HRESULT dxil_dia::Session::getSourceFileIdByName(
@@ -235,24 +309,24 @@ static HRESULT DxcDiaFindLineNumbersByRVA(
   if (!ppResult)
     return E_POINTER;
 
-  std::vector<const llvm::Instruction*> instructions;
-  auto &allInstructions = pSession->InstructionsRef();
-
-  // Gather the list of insructions that map to the given rva range.
-  for (DWORD i = rva; i < rva + length; ++i) {
-    auto It = allInstructions.find(i);
-    if (It == allInstructions.end())
-      return E_INVALIDARG;
+  if (length > UINT_MAX - rva)
+    return E_INVALIDARG;
 
-    // Only include the instruction if it has debug info for line mappings.
-    const llvm::Instruction *inst = It->second;
-    if (inst->getDebugLoc())
-      instructions.push_back(inst);
-  }
+  // Every rva in the range must map to an instruction. RVAs are unique, so
+  // that holds exactly when the range holds length instructions.
+  auto instructions = pSession->InstructionsInRange(rva, rva + length);
+  if ((DWORD)std::distance(instructions.begin(), instructions.end()) != length)
+    return E_INVALIDARG;
 
-  // Create line number table from explicit instruction list.
+  // Only the instructions with debug info for line mappings are included,
+  // and those are contiguous in the session's line table.
+  auto lines = pSession->InstructionLinesInRange(rva, rva + length);
+  const InstructionLine *pFirst =
+      lines.begin() == lines.end() ? nullptr : &*lines.begin();
   IMalloc *pMalloc = pSession->GetMallocNoRef();
-  *ppResult = CreateOnMalloc<LineNumbersTable>(pMalloc, pSession, std::move(instructions));
+  *ppResult = CreateOnMalloc<LineNumbersTable>(
+      pMalloc, pSession, pFirst,
+      (DWORD)std::distance(lines.begin(), lines.end()));
   if (*ppResult == nullptr)
     return E_OUTOFMEMORY;
   (*ppResult)->AddRef();
@@ -299,18 +373,10 @@ STDMETHODIMP dxil_dia::Session::findLinesByLinenum(
     *ppResult = nullptr;
 
     DxcThreadMalloc TM(m_pMalloc);
-    CComPtr<IDiaTable> pTable;
-    VARIANT vtIndex;
-    vtIndex.vt = VT_UI4;
-    vtIndex.uintVal = (int)Table::Kind::LineNumbers;
-    IFR(m_pEnumTables->Item(vtIndex, &pTable));
-
-    CComPtr<IDiaEnumLineNumbers> pLineTable;
-    IFR(pTable->QueryInterface(&pLineTable));
-    HRESULT hr;
-    CComPtr<IDiaLineNumber> line;
-    ULONG cnt;
-    std::vector<const llvm::Instruction *> lines;
+    DWORD fileId = 0;
+    if (file != nullptr) {
+      IFR(file->get_uniqueId(&fileId));
+    }
 
     std::function<bool(DWORD, DWORD)>column_matches = [column](DWORD colStart, DWORD colEnd) -> bool {
         return true;
@@ -322,20 +388,16 @@ STDMETHODIMP dxil_dia::Session::findLinesByLinenum(
         };
     }
 
-    pLineTable->Reset();
-    while (SUCCEEDED(hr = pLineTable->Next(1, &line, &cnt)) && hr == S_OK && cnt == 1) {
-        CComPtr<IDiaSourceFile> f;
-        DWORD ln, lnEnd, cn, cnEnd;
-        IFR(line->get_lineNumber(&ln));
-        IFR(line->get_lineNumberEnd(&lnEnd));
-        IFR(line->get_columnNumber(&cn));
-        IFR(line->get_columnNumberEnd(&cnEnd));
-        IFR(line->get_sourceFile(&f));
-        
-        if (file == f && (ln <= linenum && linenum <= lnEnd) && column_matches(cn, cnEnd)) {
-            lines.emplace_back(reinterpret_cast<LineNumber*>(line.p)->Inst());
+    // Line info is decoded at load, so scan it directly rather than through
+    // the line number table's COM objects.
+    std::vector<const InstructionLine *> lines;
+    for (const InstructionLine &line : m_instructionLines) {
+        bool file_matches = file != nullptr
+            ? line.HasFileId && line.FileId == fileId
+            : !line.HasFileId;
+        if (file_matches && line.Line == linenum && column_matches(line.Column, line.Column)) {
+            lines.emplace_back(&line);
         }
-        line.Release();
     }
 
     HRESULT result = lines.empty() ? S_FALSE : S_OK;
@@ -380,15 +442,14 @@ STDMETHODIMP dxil_dia::Session::findInlineFramesByAddr(
   *ppResult = nullptr;
 
   DxcThreadMalloc TM(m_pMalloc);
-  auto &allInstructions = InstructionsRef();
-  auto It = allInstructions.find(offset);
-  if (It == allInstructions.end()) {
+  const llvm::Instruction *pInst = FindInstruction(offset);
+  if (pInst == nullptr) {
     return E_INVALIDARG;
   }
 
   HRESULT hr;
   SymbolChildrenEnumerator *ChildrenEnum;
-  IFR(hr = m_symsMgr.DbgScopeOf(It->second, &ChildrenEnum));
+  IFR(hr = m_symsMgr.DbgScopeOf(pInst, &ChildrenEnum));
 
   *ppResult = ChildrenEnum;
   return hr;
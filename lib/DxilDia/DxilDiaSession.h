@@ -13,7 +13,6 @@
 
 #include "dxc/Support/WinIncludes.h"
 
-#include <map>
 #include <memory>
 #include <unordered_map>
 #include <vector>
@@ -22,6 +21,7 @@
 
 #include "dxc/dxcpix.h"
 #include "dxc/DXIL/DxilModule.h"
+#include "llvm/ADT/iterator_range.h"
 
 #include "dxc/Support/Global.h"
 #include "dxc/Support/microcom.h"
@@ -33,7 +33,10 @@ namespace dxil_dia {
 class Session : public IDiaSession, public IDxcPixDxilDebugInfoFactory {
 public:
   using RVA = unsigned;
-  using RVAMap = std::map<RVA, const llvm::Instruction *>;
+  // Sorted by RVA, with one entry per RVA.
+  using RVAMap = std::vector<std::pair<RVA, const llvm::Instruction *>>;
+  // Instructions with line info, sorted by RVA.
+  using InstructionLines = std::vector<InstructionLine>;
 
   struct LineInfo {
     LineInfo(std::uint32_t start_col, RVA first, RVA last)
@@ -65,7 +68,13 @@ public:
   llvm::DebugInfoFinder &InfoRef() { return *m_finder.get(); }
   const SymbolManager &SymMgr() const { return m_symsMgr; }
   const RVAMap &InstructionsRef() const { return m_instructions; }
-  const std::vector<const llvm::Instruction *> &InstructionLinesRef() const { return m_instructionLines; }
+  const InstructionLines &InstructionLinesRef() const { return m_instructionLines; }
+  // Returns the instruction at rva, or null if there is none.
+  const llvm::Instruction *FindInstruction(RVA rva) const;
+  // Returns the instructions, or the line info of the instructions, with an
+  // RVA in [first, end).
+  llvm::iterator_range<RVAMap::const_iterator> InstructionsInRange(RVA first, RVA end) const;
+  llvm::iterator_range<InstructionLines::const_iterator> InstructionLinesInRange(RVA first, RVA end) const;
   const std::unordered_map<const llvm::Instruction *, RVA> &RvaMapRef() const { return m_rvaMap; }
   const LineToInfoMap &LineToColumnStartMapRef() const { return m_lineToInfoMap; }
 
@@ -393,7 +402,7 @@ private:
   llvm::NamedMDNode *m_mainFileName;
   llvm::NamedMDNode *m_arguments;
   RVAMap m_instructions;
-  std::vector<const llvm::Instruction *> m_instructionLines; // Instructions with line info.
+  InstructionLines m_instructionLines;
   std::unordered_map<const llvm::Instruction *, RVA> m_rvaMap; // Map instruction to its RVA.
   LineToInfoMap m_lineToInfoMap;
   SymbolManager m_symsMgr;
@@ -2063,9 +2063,35 @@ dxil_dia::SymbolManager::~SymbolManager() {
 void dxil_dia::SymbolManager::Init(Session *pSes) {
   DXASSERT(m_pSession == nullptr, "SymbolManager already initialized");
   m_pSession = pSes;
+  m_bBuilt = false;
   m_symbolCtors.clear();
   m_parentToChildren.clear();
+}
+
+void dxil_dia::SymbolManager::EnsureBuilt() const {
+  if (m_bBuilt) {
+    return;
+  }
+  // Set first: symbols created while building look up their types here.
+  m_bBuilt = true;
+  if (m_pSession == nullptr) {
+    return;
+  }
+
+  DxcThreadMalloc TM(m_pSession->GetMallocNoRef());
+  try {
+    Build();
+  } catch (...) {
+    m_symbolCtors.clear();
+    m_scopeToID.clear();
+    m_symbolToLiveRange.clear();
+    m_parentToChildren.clear();
+    m_pSession = nullptr;
+  }
+}
 
+void dxil_dia::SymbolManager::Build() const {
+  Session *pSes = m_pSession;
   llvm::DebugInfoFinder &DIFinder = pSes->InfoRef();
   if (DIFinder.compile_unit_count() != 1) {
     throw hlsl::Exception(E_FAIL);
@@ -2152,6 +2178,7 @@ HRESULT dxil_dia::SymbolManager::GetSymbolByID(size_t id, Symbol **ppSym) const
   }
   *ppSym = nullptr;
 
+  EnsureBuilt();
   if (m_pSession == nullptr) {
     return E_FAIL;
   }
@@ -2169,6 +2196,7 @@ HRESULT dxil_dia::SymbolManager::GetSymbolByID(size_t id, Symbol **ppSym) const
 }
 
 HRESULT dxil_dia::SymbolManager::GetLiveRangeOf(Symbol *pSym, LiveRange *LR) const {
+  EnsureBuilt();
   const DWORD dwSymID = pSym->GetID();
   if (dwSymID <= 0 || dwSymID > m_symbolCtors.size()) {
     return E_INVALIDARG;
@@ -2187,6 +2215,7 @@ HRESULT dxil_dia::SymbolManager::GetGlobalScope(Symbol **ppSym) const {
 }
 
 HRESULT dxil_dia::SymbolManager::ChildrenOf(DWORD ID, std::vector<CComPtr<Symbol>> *pChildren) const {
+  EnsureBuilt();
   pChildren->clear();
   auto childrenList = m_parentToChildren.equal_range(ID);
   for (auto it = childrenList.first; it != childrenList.second; ++it) {
@@ -2224,6 +2253,7 @@ HRESULT dxil_dia::SymbolManager::DbgScopeOf(const llvm::Instruction *instr, Symb
     return E_FAIL;
   }
 
+  EnsureBuilt();
   auto scopeIt = m_scopeToID.find(LS);
   if (scopeIt == m_scopeToID.end()) {
     // This is a failure because all scopes should already exist in the symbol manager.
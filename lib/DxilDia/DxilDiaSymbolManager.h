@@ -64,9 +64,11 @@ public:
   SymbolManager &operator =(SymbolManager &&) = default;
   ~SymbolManager();
 
+  // Symbols are not built until one is first requested, so that opening a
+  // session only pays for the line tables.
   void Init(Session *pSes);
 
-  size_t NumSymbols() const { return m_symbolCtors.size(); }
+  size_t NumSymbols() const { EnsureBuilt(); return m_symbolCtors.size(); }
   HRESULT GetSymbolByID(size_t id, Symbol **ppSym) const;
   HRESULT GetLiveRangeOf(Symbol *pSym, LiveRange *LR) const;
   HRESULT GetGlobalScope(Symbol **ppSym) const;
@@ -76,22 +78,29 @@ public:
 private:
   HRESULT ChildrenOf(DWORD ID, std::vector<CComPtr<Symbol>> *pChildren) const;
 
+  // Builds the symbols on first use. If that fails, the manager is left with
+  // no symbols, as if the module had no debug info.
+  void EnsureBuilt() const;
+  void Build() const;
+
   // Not a CComPtr, and not AddRef'd - m_pSession is the owner of this.
-  Session *m_pSession = nullptr;
+  mutable Session *m_pSession = nullptr;
+
+  mutable bool m_bBuilt = false;
 
   // Vector of factories for all symbols in the DXIL module.
-  std::vector<std::unique_ptr<SymbolFactory>> m_symbolCtors;
+  mutable std::vector<std::unique_ptr<SymbolFactory>> m_symbolCtors;
 
   // Mapping from scope to its ID.
-  ScopeToIDMap m_scopeToID;
+  mutable ScopeToIDMap m_scopeToID;
 
   // Mapping from symbol ID to live range. Globals are live [0, end),
   // locals, [first dbg.declare, end of scope)
   // TODO: the live range information assumes structured dxil - which should hold
   // for non-optimized code - so we need something more robust. For now, this is
   // good enough.
-  IDToLiveRangeMap m_symbolToLiveRange;
+  mutable IDToLiveRangeMap m_symbolToLiveRange;
 
-  ParentToChildrenMap m_parentToChildren;
+  mutable ParentToChildrenMap m_parentToChildren;
 };
 }  // namespace dxil_dia
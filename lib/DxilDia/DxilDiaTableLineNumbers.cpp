@@ -20,15 +20,15 @@
 dxil_dia::LineNumber::LineNumber(
   /* [in] */ IMalloc *pMalloc,
   /* [in] */ Session *pSession,
-  /* [in] */ const llvm::Instruction * inst)
+  /* [in] */ const InstructionLine *line)
   : m_pMalloc(pMalloc),
     m_pSession(pSession),
-    m_inst(inst) {
+    m_line(line) {
 }
 
 const llvm::DebugLoc &dxil_dia::LineNumber::DL() const {
-  DXASSERT(bool(m_inst->getDebugLoc()), "Trying to read line info from invalid debug location");
-  return m_inst->getDebugLoc();
+  DXASSERT(bool(m_line->Inst->getDebugLoc()), "Trying to read line info from invalid debug location");
+  return m_line->Inst->getDebugLoc();
 }
 
 STDMETHODIMP dxil_dia::LineNumber::get_sourceFile(
@@ -42,25 +42,25 @@ STDMETHODIMP dxil_dia::LineNumber::get_sourceFile(
 
 STDMETHODIMP dxil_dia::LineNumber::get_lineNumber(
   /* [retval][out] */ DWORD *pRetVal) {
-  *pRetVal = DL().getLine();
+  *pRetVal = m_line->Line;
   return S_OK;
 }
 
 STDMETHODIMP dxil_dia::LineNumber::get_lineNumberEnd(
   /* [retval][out] */ DWORD *pRetVal) {
-  *pRetVal = DL().getLine();
+  *pRetVal = m_line->Line;
   return S_OK;
 }
 
 STDMETHODIMP dxil_dia::LineNumber::get_columnNumber(
   /* [retval][out] */ DWORD *pRetVal) {
-  *pRetVal = DL().getCol();
+  *pRetVal = m_line->Column;
   return S_OK;
 }
 
 STDMETHODIMP dxil_dia::LineNumber::get_columnNumberEnd(
   /* [retval][out] */ DWORD *pRetVal) {
-  *pRetVal = DL().getCol();
+  *pRetVal = m_line->Column;
   return S_OK;
 }
 
@@ -74,15 +74,7 @@ STDMETHODIMP dxil_dia::LineNumber::get_relativeVirtualAddress(
   if (pRetVal == nullptr) {
     return E_INVALIDARG;
   }
-  *pRetVal = 0;
-
-  const auto &rvaMap = m_pSession->RvaMapRef();
-  auto it = rvaMap.find(m_inst);
-  if (it == rvaMap.end()) {
-    return E_FAIL;
-  }
-
-  *pRetVal = it->second;
+  *pRetVal = m_line->Rva;
   return S_OK;
 }
 
@@ -93,12 +85,10 @@ STDMETHODIMP dxil_dia::LineNumber::get_length(
   }
   *pRetVal = 1;
 
-  if (llvm::DebugLoc DL = m_inst->getDebugLoc()) {
-    const auto &LineToColumn = m_pSession->LineToColumnStartMapRef();
-    auto it = LineToColumn.find(DL.getLine());
-    if (it != LineToColumn.end()) {
-      *pRetVal = it->second.Last - it->second.First;
-    }
+  const auto &LineToColumn = m_pSession->LineToColumnStartMapRef();
+  auto it = LineToColumn.find(m_line->Line);
+  if (it != LineToColumn.end()) {
+    *pRetVal = it->second.Last - it->second.First;
   }
 
   return S_OK;
@@ -111,12 +101,10 @@ STDMETHODIMP dxil_dia::LineNumber::get_statement(
   }
   *pRetVal = FALSE;
 
-  if (llvm::DebugLoc DL = m_inst->getDebugLoc()) {
-    const auto &LineToColumn = m_pSession->LineToColumnStartMapRef();
-    auto it = LineToColumn.find(DL.getLine());
-    if (it != LineToColumn.end()) {
-      *pRetVal = it->second.StartCol == DL.getCol();
-    }
+  const auto &LineToColumn = m_pSession->LineToColumnStartMapRef();
+  auto it = LineToColumn.find(m_line->Line);
+  if (it != LineToColumn.end()) {
+    *pRetVal = it->second.StartCol == m_line->Column;
   }
 
   return S_OK;
@@ -124,17 +112,9 @@ STDMETHODIMP dxil_dia::LineNumber::get_statement(
 
 STDMETHODIMP dxil_dia::LineNumber::get_sourceFileId(
   /* [retval][out] */ DWORD *pRetVal) {
-  llvm::MDNode *pScope = DL().getScope();
-  auto *pBlock = llvm::dyn_cast_or_null<llvm::DILexicalBlock>(pScope);
-  if (pBlock != nullptr) {
-    return m_pSession->getSourceFileIdByName(pBlock->getFile()->getFilename(), pRetVal);
-  }
-  auto *pSubProgram = llvm::dyn_cast_or_null<llvm::DISubprogram>(pScope);
-  if (pSubProgram != nullptr) {
-    return m_pSession->getSourceFileIdByName(pSubProgram->getFile()->getFilename(), pRetVal);
-  }
-  *pRetVal = 0;
-  return S_FALSE;
+  // Resolved from the scope's file name when the session was loaded.
+  *pRetVal = m_line->FileId;
+  return m_line->HasFileId ? S_OK : S_FALSE;
 }
 
 STDMETHODIMP dxil_dia::LineNumber::get_compilandId(
@@ -146,24 +126,33 @@ STDMETHODIMP dxil_dia::LineNumber::get_compilandId(
 
 dxil_dia::LineNumbersTable::LineNumbersTable(IMalloc *pMalloc, Session *pSession)
   : impl::TableBase<IDiaEnumLineNumbers, IDiaLineNumber>(pMalloc, pSession, Table::Kind::LineNumbers)
-  , m_instructions(pSession->InstructionLinesRef())
 {
-  m_count = m_instructions.size();
+  const auto &lines = pSession->InstructionLinesRef();
+  m_pFirst = lines.empty() ? nullptr : lines.data();
+  m_count = lines.size();
+}
+
+dxil_dia::LineNumbersTable::LineNumbersTable(IMalloc *pMalloc, Session *pSession, const InstructionLine *pFirst, DWORD count)
+  : impl::TableBase<IDiaEnumLineNumbers, IDiaLineNumber>(pMalloc, pSession, Table::Kind::LineNumbers)
+  , m_pFirst(pFirst)
+{
+  m_count = count;
 }
 
-dxil_dia::LineNumbersTable::LineNumbersTable(IMalloc *pMalloc, Session *pSession, std::vector<const llvm::Instruction*> &&instructions)
+dxil_dia::LineNumbersTable::LineNumbersTable(IMalloc *pMalloc, Session *pSession, std::vector<const InstructionLine *> &&lines)
   : impl::TableBase<IDiaEnumLineNumbers, IDiaLineNumber>(pMalloc, pSession, Table::Kind::LineNumbers)
-  , m_instructions(m_instructionsStorage)
-  , m_instructionsStorage(std::move(instructions))
+  , m_lines(std::move(lines))
+  , m_bContiguous(false)
 {
-  m_count = m_instructions.size();
+  m_count = m_lines.size();
 }
 
 
 HRESULT dxil_dia::LineNumbersTable::GetItem(DWORD index, IDiaLineNumber **ppItem) {
-  if (index >= m_instructions.size())
+  if (index >= m_count)
     return E_INVALIDARG;
-  *ppItem = CreateOnMalloc<LineNumber>(m_pMalloc, m_pSession, m_instructions[index]);
+  const InstructionLine *line = m_bContiguous ? m_pFirst + index : m_lines[index];
+  *ppItem = CreateOnMalloc<LineNumber>(m_pMalloc, m_pSession, line);
   if (*ppItem == nullptr)
     return E_OUTOFMEMORY;
   (*ppItem)->AddRef();
@@ -33,7 +33,7 @@ class LineNumber : public IDiaLineNumber {
 private:
   DXC_MICROCOM_TM_REF_FIELDS()
   CComPtr<Session> m_pSession;
-  const llvm::Instruction *m_inst;
+  const InstructionLine *m_line;
 
 public:
   DXC_MICROCOM_TM_ADDREF_RELEASE_IMPL()
@@ -44,11 +44,11 @@ public:
   LineNumber(
     /* [in] */ IMalloc *pMalloc,
     /* [in] */ Session *pSession,
-    /* [in] */ const llvm::Instruction * inst);
+    /* [in] */ const InstructionLine *line);
 
   const llvm::DebugLoc &DL() const;
 
-  const llvm::Instruction *Inst() const { return m_inst; }
+  const llvm::Instruction *Inst() const { return m_line->Inst; }
 
   STDMETHODIMP get_compiland(
     /* [retval][out] */ IDiaSymbol **pRetVal) override { return ENotImpl(); }
@@ -102,19 +102,24 @@ public:
   LineNumbersTable(
     /* [in] */ IMalloc *pMalloc,
     /* [in] */ Session *pSession,
-    /* [in] */ std::vector<const llvm::Instruction*> &&instructions);
+    /* [in] */ const InstructionLine *pFirst,
+    /* [in] */ DWORD count);
+
+  LineNumbersTable(
+    /* [in] */ IMalloc *pMalloc,
+    /* [in] */ Session *pSession,
+    /* [in] */ std::vector<const InstructionLine *> &&lines);
 
   HRESULT GetItem(
     /* [in] */ DWORD index, 
     /* [out] */ IDiaLineNumber **ppItem) override;
 
 private:
-  // Keep a reference to the instructions that contain the line numbers.
-  const std::vector<const llvm::Instruction *> &m_instructions;
-
-  // Provide storage space for instructions for when the table contains
-  // a subset of all instructions.
-  std::vector<const llvm::Instruction *> m_instructionsStorage;
+  // Lines owned by the session. A table usually covers a contiguous run of
+  // them starting at m_pFirst; otherwise m_lines lists them.
+  const InstructionLine *m_pFirst = nullptr;
+  std::vector<const InstructionLine *> m_lines;
+  bool m_bContiguous = true;
 };
 
 }  // namespace dxil_dia
\ No newline at end of file
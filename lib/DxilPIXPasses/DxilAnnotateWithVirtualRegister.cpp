@@ -18,6 +18,7 @@
 #include "dxc/DxilPIXPasses/DxilPIXVirtualRegisters.h"
 #include "dxc/Support/Global.h"
 #include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/MapVector.h"
 #include "llvm/ADT/StringRef.h"
 #include "llvm/IR/Constant.h"
 #include "llvm/IR/Constants.h"
@@ -81,13 +82,18 @@ private:
   void PrintSingleRegister(llvm::Instruction* pI, uint32_t Register);
   void AssignNewAllocaRegister(llvm::AllocaInst* pAlloca, std::uint32_t C);
   void PrintAllocaMember(llvm::AllocaInst* pAlloca, uint32_t Base, uint32_t Offset);
+  PixDxilRegTable::Builder &GetRegTable(llvm::Instruction *pI) {
+    return m_RegTables[pI->getParent()->getParent()];
+  }
 
   hlsl::DxilModule* m_DM;
   std::uint32_t m_uVReg;
   std::unique_ptr<llvm::ModuleSlotTracker> m_MST;
+  llvm::MapVector<llvm::Function *, PixDxilRegTable::Builder> m_RegTables;
   void Init(llvm::Module &M) {
     m_DM = &M.GetOrCreateDxilModule();
     m_uVReg = 0;
+    m_RegTables.clear();
     m_MST.reset(new llvm::ModuleSlotTracker(&M));
     auto functions = m_DM->GetExportedFunctions();
     for (auto& fn : functions) {
@@ -144,6 +150,11 @@ bool DxilAnnotateWithVirtualRegister::runOnModule(llvm::Module &M) {
     }
   }
 
+  for (auto &FnAndTable : m_RegTables) {
+    FnAndTable.second.Emit(FnAndTable.first);
+  }
+  m_RegTables.clear();
+
   if (OSOverride != nullptr) {
     *OSOverride << "\nEnd - dxil values to virtual register mapping\n";
   }
@@ -174,12 +185,7 @@ void DxilAnnotateWithVirtualRegister::AnnotateStore(llvm::Instruction *pI) {
     return;
   }
 
-  llvm::MDNode *AllocaReg = Alloca->getMetadata(PixAllocaReg::MDName);
-  if (AllocaReg == nullptr) {
-    return;
-  }
-
-  PixAllocaRegWrite::AddMD(m_DM->GetCtx(), pSt, AllocaReg, Index);
+  GetRegTable(pSt).AddAllocaRegWrite(pSt, Alloca, Index);
 }
 
 static uint32_t GetStructOffset(
@@ -357,7 +363,8 @@ void DxilAnnotateWithVirtualRegister::AnnotateGeneric(llvm::Instruction *pI) {
       // We treat it as an alias of the actual member in the alloca.
       std::uint32_t baseStructRegNum = 0;
       std::uint32_t regSize = 0;
-      if (pix_dxil::PixAllocaReg::FromInst(StructAlloca, &baseStructRegNum, & regSize)) {
+      if (GetRegTable(StructAlloca)
+              .FindAllocaReg(StructAlloca, &baseStructRegNum, &regSize)) {
         llvm::ConstantInt *OffsetAsInt =
             llvm::dyn_cast<llvm::ConstantInt>(GEP->getOperand(2));
         if (OffsetAsInt != nullptr)
@@ -366,7 +373,7 @@ void DxilAnnotateWithVirtualRegister::AnnotateGeneric(llvm::Instruction *pI) {
             OffsetAsInt->getValue().getLimitedValue());
           DXASSERT(Offset < regSize,
             "Structure member offset out of expected range");
-          PixDxilReg::AddMD(m_DM->GetCtx(), pI, baseStructRegNum + Offset);
+          GetRegTable(pI).AddReg(pI, baseStructRegNum + Offset);
         }
       }
     }
@@ -380,14 +387,14 @@ void DxilAnnotateWithVirtualRegister::AnnotateGeneric(llvm::Instruction *pI) {
 
 void DxilAnnotateWithVirtualRegister::AssignNewDxilRegister(
     llvm::Instruction *pI) {
-  PixDxilReg::AddMD(m_DM->GetCtx(), pI, m_uVReg);
+  GetRegTable(pI).AddReg(pI, m_uVReg);
   PrintSingleRegister(pI, m_uVReg);
   m_uVReg++;
 }
 
 void DxilAnnotateWithVirtualRegister::AssignNewAllocaRegister(
     llvm::AllocaInst *pAlloca, std::uint32_t C) {
-  PixAllocaReg::AddMD(m_DM->GetCtx(), pAlloca, m_uVReg, C);
+  GetRegTable(pAlloca).AddAllocaReg(pAlloca, m_uVReg, C);
   PrintAllocaMember(pAlloca, m_uVReg, C);
   m_uVReg += C;
 }
@@ -9,6 +9,7 @@
 //                                                                           //
 ///////////////////////////////////////////////////////////////////////////////
 
+#include <set>
 #include <vector>
 
 #include "dxc/DXIL/DxilFunctionProps.h"
@@ -214,6 +215,11 @@ private:
   };
 
   uint64_t m_UAVSize = 1024 * 1024;
+  // Only the instructions in the entry function's basic blocks with (0-based)
+  // indices in [m_FirstInstrumentedBlock, m_LastInstrumentedBlock] emit step
+  // records, so that a region of a large shader fits in the UAV.
+  uint32_t m_FirstInstrumentedBlock = 0;
+  uint32_t m_LastInstrumentedBlock = UINT32_MAX;
   Value *m_SelectionCriterion = nullptr;
   CallInst *m_HandleForUAV = nullptr;
   Value *m_InvocationId = nullptr;
@@ -294,6 +300,8 @@ void DxilDebugInstrumentation::applyOptions(PassOptions O) {
   GetPassOptionUnsigned(O, "parameter1", &m_Parameters.Parameters[1], 0);
   GetPassOptionUnsigned(O, "parameter2", &m_Parameters.Parameters[2], 0);
   GetPassOptionUInt64(O, "UAVSize", &m_UAVSize, 1024 * 1024);
+  GetPassOptionUInt32(O, "firstInstrumentedBlock", &m_FirstInstrumentedBlock, 0);
+  GetPassOptionUInt32(O, "lastInstrumentedBlock", &m_LastInstrumentedBlock, UINT32_MAX);
 }
 
 uint32_t DxilDebugInstrumentation::UAVDumpingGroundOffset() {
@@ -999,12 +1007,20 @@ bool DxilDebugInstrumentation::RunOnFunction(
     return false;
   }
 
-  // First record pointers to all instructions in the function:
+  // First record pointers to all instructions in the selected blocks of the
+  // function, before any instrumentation blocks are added:
   std::vector<Instruction *> AllInstructions;
-  for (inst_iterator I = inst_begin(entryFunction),
-                     E = inst_end(entryFunction);
-       I != E; ++I) {
-    AllInstructions.push_back(&*I);
+  std::set<BasicBlock *> InstrumentedBlocks;
+  uint32_t BlockIndex = 0;
+  for (auto &BB : entryFunction->getBasicBlockList()) {
+    if (BlockIndex >= m_FirstInstrumentedBlock &&
+        BlockIndex <= m_LastInstrumentedBlock) {
+      InstrumentedBlocks.insert(&BB);
+      for (auto &Inst : BB) {
+        AllInstructions.push_back(&Inst);
+      }
+    }
+    ++BlockIndex;
   }
 
   // Branchless instrumentation requires taking care of a few things:
@@ -1042,6 +1058,10 @@ bool DxilDebugInstrumentation::RunOnFunction(
 
   auto &Blocks = entryFunction->getBasicBlockList();
   for (auto &CurrentBlock : Blocks) {
+    if (InstrumentedBlocks.count(&CurrentBlock) == 0) {
+      continue;
+    }
+
     struct ValueAndPhi {
       Value *Val;
       PHINode *Phi;
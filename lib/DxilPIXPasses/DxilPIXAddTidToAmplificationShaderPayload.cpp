@@ -12,6 +12,7 @@
 
 #include "dxc/DXIL/DxilInstructions.h"
 #include "dxc/DXIL/DxilModule.h"
+#include "dxc/DXIL/DxilOpCallIndex.h"
 #include "dxc/DxilPIXPasses/DxilPIXPasses.h"
 
 #include "llvm/IR/InstIterator.h"
@@ -63,17 +64,15 @@ bool DxilPIXAddTidToAmplificationShaderPayload::runOnModule(Module &M) {
   Type* OriginalPayloadStructType = nullptr;
   ExpandedStruct expanded;
   llvm::Function* entryFunction = PIXPassHelpers::GetEntryFunction(DM);
-  for (inst_iterator I = inst_begin(entryFunction),
-                     E = inst_end(entryFunction);
-       I != E; ++I) {
-      if (auto* Instr = llvm::cast<Instruction>(&*I)) {
-          if (hlsl::OP::IsDxilOpFuncCallInst(Instr, hlsl::OP::OpCode::DispatchMesh))
-          {
-              DxilInst_DispatchMesh DispatchMesh(Instr);
-              OriginalPayloadStructPointerType = DispatchMesh.get_payload()->getType();
-              OriginalPayloadStructType = OriginalPayloadStructPointerType->getPointerElementType();
-              expanded = ExpandStructType(Ctx, OriginalPayloadStructType);
-          }
+  SmallVector<CallInst *, 1> DispatchMeshCalls;
+  DM.GetOpCallIndex().GetCalls(hlsl::OP::OpCode::DispatchMesh, DispatchMeshCalls);
+  for (CallInst *Instr : DispatchMeshCalls) {
+      if (Instr->getParent()->getParent() == entryFunction)
+      {
+          DxilInst_DispatchMesh DispatchMesh(Instr);
+          OriginalPayloadStructPointerType = DispatchMesh.get_payload()->getType();
+          OriginalPayloadStructType = OriginalPayloadStructPointerType->getPointerElementType();
+          expanded = ExpandStructType(Ctx, OriginalPayloadStructType);
       }
   }
 
@@ -0,0 +1,200 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// DxilPIXBlockCounters.cpp                                                  //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Provides a pass to count how many lanes execute each basic block of the   //
+// entry function, aggregated per wave. Used by PIX for hot-path heatmaps.   //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#include "dxc/DXIL/DxilOperations.h"
+#include "dxc/DXIL/DxilModule.h"
+#include "dxc/DXIL/DxilUtil.h"
+#include "dxc/DxilPIXPasses/DxilPIXPasses.h"
+
+#include "llvm/IR/DebugInfoMetadata.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Transforms/Utils/BasicBlockUtils.h"
+
+#include "PixPassHelpers.h"
+
+#include <vector>
+
+using namespace llvm;
+using namespace hlsl;
+
+// UAV layout, in dwords:
+//   [0]     number of waves that ran the shader
+//   [1 + i] number of lanes that executed block i of the entry function,
+//           counted only for sampled waves
+// Blocks are numbered in function order, before instrumentation. Blocks that
+// do not fit in UAVSize are not counted.
+class DxilPIXBlockCounters : public ModulePass {
+  uint32_t m_SampleRate = 1;
+  uint64_t m_UAVSize = 1024 * 1024;
+
+public:
+  static char ID; // Pass identification, replacement for typeid
+  explicit DxilPIXBlockCounters() : ModulePass(ID) {}
+  StringRef getPassName() const override {
+    return "DXIL basic block counters for PIX";
+  }
+  void applyOptions(PassOptions O) override;
+  bool runOnModule(Module &M) override;
+};
+
+void DxilPIXBlockCounters::applyOptions(PassOptions O) {
+  GetPassOptionUInt32(O, "sampleRate", &m_SampleRate, 1);
+  GetPassOptionUInt64(O, "UAVSize", &m_UAVSize, 1024 * 1024);
+}
+
+bool DxilPIXBlockCounters::runOnModule(Module &M) {
+  DxilModule &DM = M.GetOrCreateDxilModule();
+  if (DM.GetShaderModel()->IsLib()) {
+    return false;
+  }
+
+  LLVMContext &Ctx = M.getContext();
+  OP *HlslOP = DM.GetOP();
+  llvm::Function *EntryFunction = PIXPassHelpers::GetEntryFunction(DM);
+
+  // Record the original blocks, and the first source location in each,
+  // before instrumentation splits them.
+  std::vector<BasicBlock *> Blocks;
+  std::vector<DebugLoc> BlockLocations;
+  for (BasicBlock &BB : *EntryFunction) {
+    Blocks.push_back(&BB);
+    BlockLocations.emplace_back();
+    for (Instruction &I : BB) {
+      if (const DebugLoc &DL = I.getDebugLoc()) {
+        BlockLocations.back() = DL;
+        break;
+      }
+    }
+  }
+  const uint64_t CounterCapacity =
+      m_UAVSize >= 8 ? m_UAVSize / sizeof(uint32_t) - 1 : 0;
+
+  IRBuilder<> Builder(dxilutil::FirstNonAllocaInsertionPt(EntryFunction));
+  CallInst *HandleForUAV = PIXPassHelpers::CreateUAV(
+      DM, Builder, 0, "PIX_BlockCounters_Handle");
+  DM.ReEmitDxilResources();
+
+  Type *VoidTy = Type::getVoidTy(Ctx);
+  Type *I32Ty = Type::getInt32Ty(Ctx);
+  Function *IsFirstLaneFunc =
+      HlslOP->GetOpFunc(OP::OpCode::WaveIsFirstLane, VoidTy);
+  Constant *IsFirstLaneOpcode =
+      HlslOP->GetU32Const((unsigned)OP::OpCode::WaveIsFirstLane);
+  Function *BitCountFunc =
+      HlslOP->GetOpFunc(OP::OpCode::WaveAllBitCount, VoidTy);
+  Constant *BitCountOpcode =
+      HlslOP->GetU32Const((unsigned)OP::OpCode::WaveAllBitCount);
+  Function *ReadLaneFirstFunc =
+      HlslOP->GetOpFunc(OP::OpCode::WaveReadLaneFirst, I32Ty);
+  Constant *ReadLaneFirstOpcode =
+      HlslOP->GetU32Const((unsigned)OP::OpCode::WaveReadLaneFirst);
+  Function *AtomicOpFunc = HlslOP->GetOpFunc(OP::OpCode::AtomicBinOp, I32Ty);
+  Constant *AtomicBinOpcode =
+      HlslOP->GetU32Const((unsigned)OP::OpCode::AtomicBinOp);
+  Constant *AtomicAdd =
+      HlslOP->GetU32Const((unsigned)DXIL::AtomicBinOpCode::Add);
+  UndefValue *UndefArg = UndefValue::get(I32Ty);
+
+  auto AddToCounter = [&](IRBuilder<> &B, uint64_t Dword, Value *Increment) {
+    return B.CreateCall(
+        AtomicOpFunc,
+        {
+            AtomicBinOpcode, // i32, ; opcode
+            HandleForUAV,    // %dx.types.Handle, ; resource handle
+            AtomicAdd,       // i32, ; binary operation code
+            HlslOP->GetU32Const(
+                (unsigned)(Dword * sizeof(uint32_t))), // i32, ; c0: byte offset
+            UndefArg,        // i32, ; coordinate c1 (unused)
+            UndefArg,        // i32, ; coordinate c2 (unused)
+            Increment,       // i32); increment value
+        },
+        "BlockCounterResult");
+  };
+
+  // Count the wave in the entry block. Only the first lane adds to the
+  // counter, and the value it gets back is the wave's ordinal, which decides
+  // whether the wave is sampled.
+  Value *IsSampled = nullptr;
+  {
+    Value *IsFirstLane =
+        Builder.CreateCall(IsFirstLaneFunc, {IsFirstLaneOpcode}, "IsFirstLane");
+    Value *WaveIncrement = Builder.CreateZExt(IsFirstLane, I32Ty);
+    Value *PreviousWaveCount = AddToCounter(Builder, 0, WaveIncrement);
+    if (m_SampleRate > 1) {
+      Value *WaveOrdinal = Builder.CreateCall(
+          ReadLaneFirstFunc, {ReadLaneFirstOpcode, PreviousWaveCount},
+          "WaveOrdinal");
+      Value *Remainder = Builder.CreateURem(
+          WaveOrdinal, HlslOP->GetU32Const(m_SampleRate), "WaveSampleSlot");
+      IsSampled = Builder.CreateICmpEQ(Remainder, HlslOP->GetU32Const(0),
+                                       "WaveIsSampled");
+    }
+  }
+  Instruction *EntryInsertionPt = &*Builder.GetInsertPoint();
+
+  for (size_t BlockIndex = 0;
+       BlockIndex < Blocks.size() && BlockIndex < CounterCapacity;
+       ++BlockIndex) {
+    BasicBlock *BB = Blocks[BlockIndex];
+    Instruction *InsertionPt =
+        BlockIndex == 0 ? EntryInsertionPt : &*BB->getFirstInsertionPt();
+
+    // One atomic per wave: the first active lane adds the number of active
+    // lanes.
+    IRBuilder<> B(InsertionPt);
+    Value *ActiveLanes = B.CreateCall(
+        BitCountFunc, {BitCountOpcode, B.getTrue()}, "ActiveLanes");
+    Value *ShouldCount =
+        B.CreateCall(IsFirstLaneFunc, {IsFirstLaneOpcode}, "IsFirstLane");
+    if (IsSampled != nullptr) {
+      ShouldCount = B.CreateAnd(ShouldCount, IsSampled, "ShouldCount");
+    }
+
+    TerminatorInst *Then =
+        SplitBlockAndInsertIfThen(ShouldCount, InsertionPt, false);
+    IRBuilder<> ThenBuilder(Then);
+    AddToCounter(ThenBuilder, BlockIndex + 1, ActiveLanes);
+  }
+
+  DM.m_ShaderFlags.SetWaveOps(true);
+
+  // Let tools map counters back to source lines.
+  if (OSOverride != nullptr) {
+    *OSOverride << "\nBegin - block counters\n";
+    *OSOverride << "SampleRate:" << m_SampleRate << "\n";
+    for (size_t BlockIndex = 0;
+         BlockIndex < Blocks.size() && BlockIndex < CounterCapacity;
+         ++BlockIndex) {
+      // Block<index>:<byte offset of its counter>[:<line>:<file>]
+      *OSOverride << "Block" << BlockIndex << ":"
+                  << (uint64_t)((BlockIndex + 1) * sizeof(uint32_t));
+      if (const DebugLoc &DL = BlockLocations[BlockIndex]) {
+        *OSOverride << ":" << DL.getLine() << ":" << DL->getFilename();
+      }
+      *OSOverride << "\n";
+    }
+    *OSOverride << "End - block counters\n";
+  }
+
+  return true;
+}
+
+char DxilPIXBlockCounters::ID = 0;
+
+ModulePass *llvm::createDxilPIXBlockCountersPass() {
+  return new DxilPIXBlockCounters();
+}
+
+INITIALIZE_PASS(DxilPIXBlockCounters, "hlsl-dxil-pix-block-counters",
+                "DXIL basic block counters for PIX", false, false)
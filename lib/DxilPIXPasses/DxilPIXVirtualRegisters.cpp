@@ -13,8 +13,10 @@
 #include "dxc/DxilPIXPasses/DxilPIXVirtualRegisters.h"
 
 #include "dxc/Support/Global.h"
+#include "llvm/ADT/ArrayRef.h"
 #include "llvm/IR/Constant.h"
 #include "llvm/IR/Constants.h"
+#include "llvm/IR/Function.h"
 #include "llvm/IR/IRBuilder.h"
 #include "llvm/IR/InstIterator.h"
 #include "llvm/IR/Instruction.h"
@@ -63,186 +65,263 @@ bool pix_dxil::PixDxilInstNum::FromInst(llvm::Instruction *pI,
   return true;
 }
 
-void pix_dxil::PixDxilReg::AddMD(llvm::LLVMContext &Ctx, llvm::Instruction *pI,
-                                 std::uint32_t RegNum) {
-  llvm::IRBuilder<> B(Ctx);
-  pI->setMetadata(
-      llvm::StringRef(MDName),
-      llvm::MDNode::get(Ctx,
-                        {llvm::ConstantAsMetadata::get(B.getInt32(ID)),
-                         llvm::ConstantAsMetadata::get(B.getInt32(RegNum))}));
-}
+namespace {
+// Operand order of the per-function register table and the number of i32s in
+// each record of the corresponding column.
+enum RegTableColumn : unsigned {
+  RegColumn = 0,
+  AllocaColumn = 1,
+  WriteColumn = 2,
+  NumColumns = 3,
+};
+static constexpr unsigned RegStride = 2;
+static constexpr unsigned AllocaStride = 3;
+static constexpr unsigned WriteStride = 5;
 
-bool pix_dxil::PixDxilReg::FromInst(llvm::Instruction *pI,
-                                    std::uint32_t *pRegNum) {
-  *pRegNum = 0;
+static constexpr uint32_t IndexIsConst = 1;
+static constexpr uint32_t IndexIsPixInst = 2;
 
-  auto *mdNodes = pI->getMetadata(MDName);
+// Returns the index of the first element of the record for InstNum in a
+// flattened column sorted by instruction number, or -1 if there is none.
+template <typename GetElementFn>
+int FindRecord(unsigned NumElements, unsigned Stride, std::uint32_t InstNum,
+               GetElementFn GetElement) {
+  unsigned Lo = 0;
+  unsigned Hi = NumElements / Stride;
+  while (Lo < Hi) {
+    unsigned Mid = Lo + (Hi - Lo) / 2;
+    std::uint32_t MidInstNum = GetElement(Mid * Stride);
+    if (MidInstNum == InstNum) {
+      return Mid * Stride;
+    }
+    if (MidInstNum < InstNum) {
+      Lo = Mid + 1;
+    } else {
+      Hi = Mid;
+    }
+  }
+  return -1;
+}
 
-  if (mdNodes == nullptr) {
-    return false;
+int FindRecord(llvm::ArrayRef<std::uint32_t> Column, unsigned Stride,
+               std::uint32_t InstNum) {
+  return FindRecord(Column.size(), Stride, InstNum,
+                    [&](unsigned i) { return Column[i]; });
+}
+
+// A read-only view over one column of a function's register table. Columns
+// whose elements are all zero (including empty ones) are stored as
+// zeroinitializer rather than as a ConstantDataArray.
+class TableColumn {
+public:
+  bool Init(llvm::Metadata *MD) {
+    auto *C = llvm::mdconst::dyn_extract<llvm::Constant>(MD);
+    auto *AT = C ? llvm::dyn_cast<llvm::ArrayType>(C->getType()) : nullptr;
+    if (AT == nullptr) {
+      return false;
+    }
+    m_pData = llvm::dyn_cast<llvm::ConstantDataSequential>(C);
+    if (m_pData == nullptr && !llvm::isa<llvm::ConstantAggregateZero>(C)) {
+      return false;
+    }
+    m_NumElements = AT->getNumElements();
+    return true;
   }
 
-  if (mdNodes->getNumOperands() != 2) {
-    return false;
+  unsigned size() const { return m_NumElements; }
+
+  std::uint32_t operator[](unsigned Index) const {
+    return m_pData ? static_cast<std::uint32_t>(
+                         m_pData->getElementAsInteger(Index))
+                   : 0;
   }
 
-  auto *mdID =
-      llvm::mdconst::dyn_extract<llvm::ConstantInt>(mdNodes->getOperand(0));
-  if (mdID == nullptr || mdID->getLimitedValue() != ID) {
+private:
+  llvm::ConstantDataSequential *m_pData = nullptr;
+  unsigned m_NumElements = 0;
+};
+
+// Looks up the record of pI in one column of its function's register table.
+// On success, *pFirst is the index of the record's first element.
+bool FindTableRecord(llvm::Instruction *pI, RegTableColumn Column,
+                     unsigned Stride, TableColumn *pColumn, unsigned *pFirst) {
+  std::uint32_t InstNum;
+  if (!pix_dxil::PixDxilInstNum::FromInst(pI, &InstNum)) {
     return false;
   }
 
-  auto *mdRegNum =
-      llvm::mdconst::dyn_extract<llvm::ConstantInt>(mdNodes->getOperand(1));
-  if (mdRegNum == nullptr) {
+  llvm::BasicBlock *BB = pI->getParent();
+  if (BB == nullptr || BB->getParent() == nullptr) {
     return false;
   }
 
-  *pRegNum = mdRegNum->getLimitedValue();
-  return true;
-}
-
-static bool ParsePixAllocaReg(llvm::MDNode *MD, std::uint32_t *RegNum,
-                              std::uint32_t *Count) {
-  if (MD->getNumOperands() != 3) {
+  llvm::MDNode *Table =
+      BB->getParent()->getMetadata(pix_dxil::PixDxilRegTable::MDName);
+  if (Table == nullptr || Table->getNumOperands() != NumColumns) {
     return false;
   }
 
-  auto *mdID = llvm::mdconst::dyn_extract<llvm::ConstantInt>(MD->getOperand(0));
-  if (mdID == nullptr ||
-      mdID->getLimitedValue() != pix_dxil::PixAllocaReg::ID) {
+  if (!pColumn->Init(Table->getOperand(Column))) {
     return false;
   }
 
-  auto *mdRegNum =
-      llvm::mdconst::dyn_extract<llvm::ConstantInt>(MD->getOperand(1));
-  auto *mdCount =
-      llvm::mdconst::dyn_extract<llvm::ConstantInt>(MD->getOperand(2));
-
-  if (mdRegNum == nullptr || mdCount == nullptr) {
+  int First = FindRecord(pColumn->size(), Stride, InstNum,
+                         [&](unsigned i) { return (*pColumn)[i]; });
+  if (First < 0) {
     return false;
   }
 
-  *RegNum = mdRegNum->getLimitedValue();
-  *Count = mdCount->getLimitedValue();
+  *pFirst = static_cast<unsigned>(First);
   return true;
 }
+} // namespace
 
-void pix_dxil::PixAllocaReg::AddMD(llvm::LLVMContext &Ctx,
-                                   llvm::AllocaInst *pAlloca,
-                                   std::uint32_t RegNum, std::uint32_t Count) {
-  llvm::IRBuilder<> B(Ctx);
-  pAlloca->setMetadata(
-      llvm::StringRef(MDName),
-      llvm::MDNode::get(Ctx,
-                        {llvm::ConstantAsMetadata::get(B.getInt32(ID)),
-                         llvm::ConstantAsMetadata::get(B.getInt32(RegNum)),
-                         llvm::ConstantAsMetadata::get(B.getInt32(Count))}));
+void pix_dxil::PixDxilRegTable::Builder::AddReg(llvm::Instruction *pI,
+                                                std::uint32_t RegNum) {
+  std::uint32_t InstNum;
+  if (!PixDxilInstNum::FromInst(pI, &InstNum)) {
+    return;
+  }
+  m_Regs.insert(m_Regs.end(), {InstNum, RegNum});
 }
 
-bool pix_dxil::PixAllocaReg::FromInst(llvm::AllocaInst *pAlloca,
-                                      std::uint32_t *pRegBase,
-                                      std::uint32_t *pRegSize) {
+void pix_dxil::PixDxilRegTable::Builder::AddAllocaReg(
+    llvm::AllocaInst *pAlloca, std::uint32_t RegNum, std::uint32_t Count) {
+  std::uint32_t InstNum;
+  if (!PixDxilInstNum::FromInst(pAlloca, &InstNum)) {
+    return;
+  }
+  m_Allocas.insert(m_Allocas.end(), {InstNum, RegNum, Count});
+}
+
+bool pix_dxil::PixDxilRegTable::Builder::FindAllocaReg(
+    llvm::AllocaInst *pAlloca, std::uint32_t *pRegBase,
+    std::uint32_t *pRegSize) const {
   *pRegBase = 0;
   *pRegSize = 0;
 
-  auto *mdNodes = pAlloca->getMetadata(MDName);
-  if (mdNodes == nullptr) {
+  std::uint32_t InstNum;
+  if (!PixDxilInstNum::FromInst(pAlloca, &InstNum)) {
+    return false;
+  }
+
+  int First = FindRecord(m_Allocas, AllocaStride, InstNum);
+  if (First < 0) {
     return false;
   }
 
-  return ParsePixAllocaReg(mdNodes, pRegBase, pRegSize);
+  *pRegBase = m_Allocas[First + 1];
+  *pRegSize = m_Allocas[First + 2];
+  return true;
 }
 
-namespace pix_dxil {
-namespace PixAllocaRegWrite {
-static constexpr uint32_t IndexIsConst = 1;
-static constexpr uint32_t IndexIsPixInst = 2;
-} // namespace PixAllocaRegWrite
-} // namespace pix_dxil
+void pix_dxil::PixDxilRegTable::Builder::AddAllocaRegWrite(
+    llvm::StoreInst *pSt, llvm::AllocaInst *pAlloca, llvm::Value *Index) {
+  std::uint32_t InstNum;
+  if (!PixDxilInstNum::FromInst(pSt, &InstNum)) {
+    return;
+  }
 
-void pix_dxil::PixAllocaRegWrite::AddMD(llvm::LLVMContext &Ctx,
-                                        llvm::StoreInst *pSt,
-                                        llvm::MDNode *pAllocaReg,
-                                        llvm::Value *Index) {
-  llvm::IRBuilder<> B(Ctx);
-  if (auto *C = llvm::dyn_cast<llvm::ConstantInt>(Index)) {
-    pSt->setMetadata(
-        llvm::StringRef(MDName),
-        llvm::MDNode::get(
-            Ctx, {llvm::ConstantAsMetadata::get(B.getInt32(ID)), pAllocaReg,
-                  llvm::ConstantAsMetadata::get(B.getInt32(IndexIsConst)),
-                  llvm::ConstantAsMetadata::get(C)}));
+  std::uint32_t RegBase;
+  std::uint32_t RegSize;
+  if (!FindAllocaReg(pAlloca, &RegBase, &RegSize)) {
+    return;
   }
 
-  if (auto *I = llvm::dyn_cast<llvm::Instruction>(Index)) {
-    std::uint32_t InstNum;
-    if (!PixDxilInstNum::FromInst(I, &InstNum)) {
+  std::uint32_t IndexKind;
+  std::uint32_t IndexValue;
+  if (auto *C = llvm::dyn_cast<llvm::ConstantInt>(Index)) {
+    IndexKind = IndexIsConst;
+    IndexValue = static_cast<std::uint32_t>(C->getLimitedValue());
+  } else if (auto *I = llvm::dyn_cast<llvm::Instruction>(Index)) {
+    IndexKind = IndexIsPixInst;
+    if (!PixDxilInstNum::FromInst(I, &IndexValue)) {
       return;
     }
-    pSt->setMetadata(
-        llvm::StringRef(MDName),
-        llvm::MDNode::get(
-            Ctx, {llvm::ConstantAsMetadata::get(B.getInt32(ID)), pAllocaReg,
-                  llvm::ConstantAsMetadata::get(B.getInt32(IndexIsPixInst)),
-                  llvm::ConstantAsMetadata::get(B.getInt32(InstNum))}));
+  } else {
+    return;
   }
+
+  m_Writes.insert(m_Writes.end(),
+                  {InstNum, RegBase, RegSize, IndexKind, IndexValue});
 }
 
-bool pix_dxil::PixAllocaRegWrite::FromInst(llvm::StoreInst *pI,
-                                           std::uint32_t *pRegBase,
-                                           std::uint32_t *pRegSize,
-                                           llvm::Value **pIndex) {
-  *pRegBase = 0;
-  *pRegSize = 0;
-  *pIndex = nullptr;
+void pix_dxil::PixDxilRegTable::Builder::Emit(llvm::Function *F) {
+  // Records are added while walking the function's blocks in the same order
+  // the instructions were numbered, so the columns are already sorted.
+  llvm::LLVMContext &Ctx = F->getContext();
+  llvm::Metadata *Columns[NumColumns] = {
+      llvm::ConstantAsMetadata::get(
+          llvm::ConstantDataArray::get(Ctx, llvm::makeArrayRef(m_Regs))),
+      llvm::ConstantAsMetadata::get(
+          llvm::ConstantDataArray::get(Ctx, llvm::makeArrayRef(m_Allocas))),
+      llvm::ConstantAsMetadata::get(
+          llvm::ConstantDataArray::get(Ctx, llvm::makeArrayRef(m_Writes))),
+  };
+  F->setMetadata(MDName, llvm::MDNode::get(Ctx, Columns));
+
+  m_Regs.clear();
+  m_Allocas.clear();
+  m_Writes.clear();
+}
 
-  auto *mdNodes = pI->getMetadata(MDName);
-  if (mdNodes == nullptr || mdNodes->getNumOperands() != 4) {
-    return false;
-  }
+bool pix_dxil::PixDxilReg::FromInst(llvm::Instruction *pI,
+                                    std::uint32_t *pRegNum) {
+  *pRegNum = 0;
 
-  auto *mdID =
-      llvm::mdconst::dyn_extract<llvm::ConstantInt>(mdNodes->getOperand(0));
-  if (mdID == nullptr || mdID->getLimitedValue() != ID) {
+  TableColumn Data;
+  unsigned First;
+  if (!FindTableRecord(pI, RegColumn, RegStride, &Data, &First)) {
     return false;
   }
 
-  auto *mdAllocaReg = llvm::dyn_cast<llvm::MDNode>(mdNodes->getOperand(1));
-  if (mdAllocaReg == nullptr ||
-      !ParsePixAllocaReg(mdAllocaReg, pRegBase, pRegSize)) {
-    return false;
-  }
+  *pRegNum = Data[First + 1];
+  return true;
+}
 
-  auto *mdIndexType =
-      llvm::dyn_cast<llvm::ConstantAsMetadata>(mdNodes->getOperand(2));
-  if (mdIndexType == nullptr) {
-    return false;
-  }
+bool pix_dxil::PixAllocaReg::FromInst(llvm::AllocaInst *pAlloca,
+                                      std::uint32_t *pRegBase,
+                                      std::uint32_t *pRegSize) {
+  *pRegBase = 0;
+  *pRegSize = 0;
 
-  auto *cIndexType = llvm::dyn_cast<llvm::ConstantInt>(mdIndexType->getValue());
-  if (cIndexType == nullptr) {
+  TableColumn Data;
+  unsigned First;
+  if (!FindTableRecord(pAlloca, AllocaColumn, AllocaStride, &Data, &First)) {
     return false;
   }
 
-  auto *mdIndex =
-      llvm::dyn_cast<llvm::ConstantAsMetadata>(mdNodes->getOperand(3));
-  if (mdIndex == nullptr) {
-    return false;
-  }
+  *pRegBase = Data[First + 1];
+  *pRegSize = Data[First + 2];
+  return true;
+}
+
+bool pix_dxil::PixAllocaRegWrite::FromInst(llvm::StoreInst *pI,
+                                           std::uint32_t *pRegBase,
+                                           std::uint32_t *pRegSize,
+                                           llvm::Value **pIndex) {
+  *pRegBase = 0;
+  *pRegSize = 0;
+  *pIndex = nullptr;
 
-  auto *cIndex = llvm::dyn_cast<llvm::ConstantInt>(mdIndex->getValue());
-  if (cIndex == nullptr) {
+  TableColumn Data;
+  unsigned First;
+  if (!FindTableRecord(pI, WriteColumn, WriteStride, &Data, &First)) {
     return false;
   }
 
-  switch (cIndexType->getLimitedValue()) {
+  std::uint32_t IndexKind = Data[First + 3];
+  std::uint32_t IndexValue = Data[First + 4];
+
+  switch (IndexKind) {
   default:
     return false;
 
   case IndexIsConst: {
-    *pIndex = cIndex;
+    *pRegBase = Data[First + 1];
+    *pRegSize = Data[First + 2];
+    *pIndex = llvm::ConstantInt::get(
+        llvm::Type::getInt32Ty(pI->getContext()), IndexValue);
     return true;
   }
 
@@ -250,16 +329,14 @@ bool pix_dxil::PixAllocaRegWrite::FromInst(llvm::StoreInst *pI,
     for (llvm::Instruction &I :
          llvm::inst_range(pI->getParent()->getParent())) {
       uint32_t InstNum;
-      if (PixDxilInstNum::FromInst(&I, &InstNum)) {
+      if (PixDxilInstNum::FromInst(&I, &InstNum) && InstNum == IndexValue) {
+        *pRegBase = Data[First + 1];
+        *pRegSize = Data[First + 2];
         *pIndex = &I;
-        if (InstNum == cIndex->getLimitedValue()) {
-          return true;
-        }
+        return true;
       }
     }
     return false;
   }
   }
-
-  return false;
 }
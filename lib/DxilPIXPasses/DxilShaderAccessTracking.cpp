@@ -24,9 +24,11 @@
 
 #include "llvm/IR/PassManager.h"
 #include "llvm/Support/FormattedStream.h"
+#include "llvm/Transforms/Utils/BasicBlockUtils.h"
 #include "llvm/Transforms/Utils/Local.h"
 
 #include <deque>
+#include <tuple>
 
 #include "PixPassHelpers.h"
 
@@ -215,6 +217,9 @@ private:
                           OP *HlslOP, LLVMContext &Ctx,
                           ShaderAccessFlags readWrite);
   DxilResourceAndClass GetResourceFromHandle(Value* resHandle, DxilModule& DM);
+  bool IsAlreadyRecorded(DxilResourceAndClass &res, Instruction *instruction,
+                         ShaderAccessFlags readWrite);
+  void CoalesceRecordStores(DxilModule &DM, OP *HlslOP, LLVMContext &Ctx);
 
 private:
   struct DynamicResourceBinding {
@@ -232,6 +237,15 @@ private:
   std::map<llvm::Function *, CallInst *> m_FunctionToUAVHandle;
   std::map<llvm::Function *, std::map<ResourceAccessStyle, Constant *>> m_FunctionToEncodedAccess;
   std::set<RSRegisterIdentifier> m_DynamicallyIndexedBindPoints;
+
+  // When coalescing, each resource and access kind is recorded once per
+  // basic block, and only one lane of the wave stores each distinct record.
+  bool m_CoalesceWaveAccesses = false;
+  typedef std::tuple<BasicBlock *, AccessStyle, RegisterType, int, Value *,
+                     ShaderAccessFlags>
+      RecordedAccess;
+  std::set<RecordedAccess> m_RecordedAccesses;
+  std::vector<CallInst *> m_RecordStores;
 };
 
 static unsigned DeserializeInt(std::deque<char> &q) {
@@ -295,6 +309,10 @@ void DxilShaderAccessTracking::applyOptions(PassOptions O) {
   GetPassOptionInt(O, "checkForDynamicIndexing", &checkForDynamic, 0);
   m_CheckForDynamicIndexing = checkForDynamic != 0;
 
+  int coalesceWaveAccesses;
+  GetPassOptionInt(O, "coalesceWaveAccesses", &coalesceWaveAccesses, 0);
+  m_CoalesceWaveAccesses = coalesceWaveAccesses != 0;
+
   StringRef configOption;
   if (GetPassOption(O, "config", &configOption)) {
     std::deque<char> config;
@@ -351,7 +369,7 @@ void DxilShaderAccessTracking::EmitAccess(LLVMContext &Ctx, OP *HlslOP,
       HlslOP->GetOpFunc(OP::OpCode::BufferStore, Type::getInt32Ty(Ctx));
   Constant *StoreOpcode =
       HlslOP->GetU32Const((unsigned)OP::OpCode::BufferStore);
-  (void)Builder.CreateCall(
+  CallInst *Store = Builder.CreateCall(
       StoreFunc,
       {
           StoreOpcode, // i32, ; opcode
@@ -366,6 +384,66 @@ void DxilShaderAccessTracking::EmitAccess(LLVMContext &Ctx, OP *HlslOP,
           UndefIntArg,            // i32, ; value v3
           ElementMask             // i8 ; just the first value is used
       });
+  if (m_CoalesceWaveAccesses)
+    m_RecordStores.push_back(Store);
+}
+
+bool DxilShaderAccessTracking::IsAlreadyRecorded(DxilResourceAndClass &res,
+                                                 Instruction *instruction,
+                                                 ShaderAccessFlags readWrite) {
+  if (!m_CoalesceWaveAccesses)
+    return false;
+  // Every instruction of a block runs if any does, so a second access to the
+  // same resource in the same way would write the same record again.
+  Value *index = res.accessStyle == AccessStyle::FromRootSig
+                     ? res.index
+                     : res.dynamicallyBoundIndex;
+  RecordedAccess access(instruction->getParent(), res.accessStyle,
+                        res.registerType, res.RegisterSpace, index, readWrite);
+  return !m_RecordedAccesses.insert(access).second;
+}
+
+// Makes each record store conditional on being the first lane of the wave
+// to write that record: the first active lane always stores, and any other
+// lane only stores when its offset differs from the first lane's. Lanes with
+// equal offsets would store equal values, so nothing is lost. This runs after
+// all accesses are instrumented, so that splitting blocks does not change
+// which accesses IsAlreadyRecorded considers to share a block.
+void DxilShaderAccessTracking::CoalesceRecordStores(DxilModule &DM,
+                                                    OP *HlslOP,
+                                                    LLVMContext &Ctx) {
+  if (m_RecordStores.empty())
+    return;
+
+  Type *I32Ty = Type::getInt32Ty(Ctx);
+  Function *IsFirstLaneFunc = HlslOP->GetOpFunc(OP::OpCode::WaveIsFirstLane,
+                                                Type::getVoidTy(Ctx));
+  Constant *IsFirstLaneOpcode =
+      HlslOP->GetU32Const((unsigned)OP::OpCode::WaveIsFirstLane);
+  Function *ReadLaneFirstFunc =
+      HlslOP->GetOpFunc(OP::OpCode::WaveReadLaneFirst, I32Ty);
+  Constant *ReadLaneFirstOpcode =
+      HlslOP->GetU32Const((unsigned)OP::OpCode::WaveReadLaneFirst);
+
+  for (CallInst *Store : m_RecordStores) {
+    IRBuilder<> Builder(Store);
+    Value *ShouldStore = Builder.CreateCall(IsFirstLaneFunc,
+                                            {IsFirstLaneOpcode}, "IsFirstLane");
+    Value *Offset =
+        Store->getArgOperand(DXIL::OperandIndex::kBufferStoreCoord0OpIdx);
+    if (!isa<Constant>(Offset)) {
+      Value *FirstLaneOffset = Builder.CreateCall(
+          ReadLaneFirstFunc, {ReadLaneFirstOpcode, Offset}, "FirstLaneOffset");
+      Value *IsDistinct =
+          Builder.CreateICmpNE(Offset, FirstLaneOffset, "IsDistinctRecord");
+      ShouldStore = Builder.CreateOr(ShouldStore, IsDistinct, "ShouldStore");
+    }
+    TerminatorInst *Then = SplitBlockAndInsertIfThen(ShouldStore, Store, false);
+    Store->moveBefore(Then);
+  }
+  m_RecordStores.clear();
+
+  DM.m_ShaderFlags.SetWaveOps(true);
 }
 
 static ResourceAccessStyle AccessStyleFromAccessAndType(
@@ -401,6 +479,9 @@ bool DxilShaderAccessTracking::EmitResourceAccess(DxilModule &DM,
                                                   Instruction *instruction,
                                                   OP *HlslOP, LLVMContext &Ctx,
                                                   ShaderAccessFlags readWrite) {
+  if (IsAlreadyRecorded(res, instruction, readWrite))
+    return false;
+
   IRBuilder<> Builder(instruction);
   
   if (res.accessStyle == AccessStyle::FromRootSig) {
@@ -549,7 +630,7 @@ bool DxilShaderAccessTracking::EmitResourceAccess(DxilModule &DM,
           Constant *StoreOpcode =
               HlslOP->GetU32Const((unsigned)OP::OpCode::BufferStore);
           UndefValue *UndefArg = UndefValue::get(Type::getInt32Ty(Ctx));
-          (void)Builder.CreateCall(
+          CallInst *Store = Builder.CreateCall(
               StoreFunc,
               {
                   StoreOpcode,                  // i32, ; opcode
@@ -564,6 +645,8 @@ bool DxilShaderAccessTracking::EmitResourceAccess(DxilModule &DM,
                   UndefArg,                     // i32, ; value v3
                   ElementMask                   // i8 ; just the first value is used
               });
+          if (m_CoalesceWaveAccesses)
+            m_RecordStores.push_back(Store);
           return true; // did modify
       }
   }
@@ -843,6 +926,8 @@ bool DxilShaderAccessTracking::runOnModule(Module &M) {
       }
     }
 
+    CoalesceRecordStores(DM, HlslOP, Ctx);
+
     if (OSOverride != nullptr) {
       formatted_raw_ostream FOS(*OSOverride);
       FOS << "DynamicallyIndexedBindPoints=";
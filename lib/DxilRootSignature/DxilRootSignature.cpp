@@ -17,9 +17,11 @@
 #include "dxc/Support/FileIOHelper.h"
 #include "dxc/dxcapi.h"
 
+#include "llvm/ADT/Hashing.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/IR/DiagnosticPrinter.h"
 
+#include <mutex>
 #include <string>
 #include <algorithm>
 #include <utility>
@@ -190,6 +192,88 @@ void DeleteRootSignature(const DxilVersionedRootSignatureDesc * pRootSignature)
   delete pRootSignature;
 }
 
+//////////////////////////////////////////////////////////////////////////////
+// Root signature byte cache.
+
+static size_t HashBytes(const void *pData, size_t Size) {
+  return hash_value(StringRef((const char *)pData, Size));
+}
+
+RootSignatureByteCache::~RootSignatureByteCache() {
+  for (unsigned i = 0; i < m_NumEntries; ++i)
+    free(m_Entries[i].pBytes);
+}
+
+const RootSignatureByteCache::Entry *
+RootSignatureByteCache::Find(size_t Hash, const void *pKey,
+                             size_t KeySize) const {
+  for (unsigned i = 0; i < m_NumEntries; ++i) {
+    const Entry &E = m_Entries[i];
+    if (E.Hash == Hash && E.KeySize == KeySize &&
+        0 == memcmp(E.pBytes, pKey, KeySize))
+      return &E;
+  }
+  return nullptr;
+}
+
+bool RootSignatureByteCache::Lookup(const void *pKey, size_t KeySize,
+                                    std::vector<uint8_t> *pValue) {
+  size_t Hash = HashBytes(pKey, KeySize);
+  std::lock_guard<std::mutex> Lock(m_Mutex);
+  const Entry *E = Find(Hash, pKey, KeySize);
+  if (E == nullptr)
+    return false;
+  if (pValue) {
+    const uint8_t *pEntryValue = E->pBytes + E->KeySize;
+    pValue->assign(pEntryValue, pEntryValue + E->ValueSize);
+  }
+  return true;
+}
+
+void RootSignatureByteCache::Add(const void *pKey, size_t KeySize,
+                                 const void *pValue, size_t ValueSize) {
+  size_t Hash = HashBytes(pKey, KeySize);
+  std::lock_guard<std::mutex> Lock(m_Mutex);
+  if (Find(Hash, pKey, KeySize))
+    return;
+  uint8_t *pBytes = (uint8_t *)malloc(KeySize + ValueSize);
+  if (pBytes == nullptr)
+    return;
+  memcpy(pBytes, pKey, KeySize);
+  if (ValueSize)
+    memcpy(pBytes + KeySize, pValue, ValueSize);
+
+  Entry *E;
+  if (m_NumEntries < MaxEntries) {
+    E = &m_Entries[m_NumEntries++];
+  } else {
+    E = &m_Entries[m_NextReplaced];
+    m_NextReplaced = (m_NextReplaced + 1) % MaxEntries;
+    free(E->pBytes);
+  }
+  *E = {Hash, KeySize, ValueSize, pBytes};
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// Verified root signatures.
+
+// Serialized root signatures that passed standalone verification in this
+// process, matched on their full contents. A compile that serializes a root
+// signature and then validates the container holding it would otherwise
+// verify the same bytes twice.
+static RootSignatureByteCache &GetVerifiedRootSignatures() {
+  static RootSignatureByteCache Verified;
+  return Verified;
+}
+
+void MarkRootSignatureVerified(const void *pData, uint32_t Size) {
+  GetVerifiedRootSignatures().Add(pData, Size, nullptr, 0);
+}
+
+bool IsRootSignatureVerified(const void *pData, uint32_t Size) {
+  return GetVerifiedRootSignatures().Lookup(pData, Size, nullptr);
+}
+
 namespace {
 // Dump root sig.
 
@@ -328,7 +328,13 @@ void SerializeRootSignature(const DxilVersionedRootSignatureDesc *pRootSignature
   } catch (...) {
     DiagStream.flush();
     DxcCreateBlobWithEncodingOnHeapCopy(DiagString.c_str(), DiagString.size(), CP_UTF8, ppErrorBlob);
+    return;
   }
+
+  // Verified above with the same rules the validator uses.
+  if (!bAllowReservedRegisterSpace && *ppBlob)
+    MarkRootSignatureVerified((*ppBlob)->GetBufferPointer(),
+                              (uint32_t)(*ppBlob)->GetBufferSize());
 }
 
 //=============================================================================
@@ -570,4 +576,196 @@ void DeserializeRootSignature(const void *pSrcData,
   *ppRootSignature = pRootSignature;
 }
 
+//=============================================================================
+//
+// DxilRootSignatureView.
+//
+//=============================================================================
+
+bool DxilRootSignatureView::IsInBounds(uint32_t Offset, uint32_t Count,
+                                       uint32_t ElementSize) const {
+  return (uint64_t)Offset + (uint64_t)Count * ElementSize <= m_Size;
+}
+
+_Use_decl_annotations_
+bool DxilRootSignatureView::Initialize(const void *pSrcData,
+                                       uint32_t SrcDataSizeInBytes) {
+  m_pData = (const char *)pSrcData;
+  m_Size = SrcDataSizeInBytes;
+  if (pSrcData == nullptr ||
+      !IsInBounds(0, 1, sizeof(DxilContainerRootSignatureDesc)))
+    return false;
+
+  const DxilContainerRootSignatureDesc &RS = GetDesc();
+  uint32_t RangeSize;
+  uint32_t DescriptorSize;
+  switch ((DxilRootSignatureVersion)RS.Version) {
+  case DxilRootSignatureVersion::Version_1_0:
+    RangeSize = sizeof(DxilContainerDescriptorRange);
+    DescriptorSize = sizeof(DxilRootDescriptor);
+    break;
+  case DxilRootSignatureVersion::Version_1_1:
+    RangeSize = sizeof(DxilContainerDescriptorRange1);
+    DescriptorSize = sizeof(DxilContainerRootDescriptor1);
+    break;
+  default:
+    return false;
+  }
+
+  if (!IsInBounds(RS.RootParametersOffset, RS.NumParameters,
+                  sizeof(DxilContainerRootParameter)) ||
+      !IsInBounds(RS.StaticSamplersOffset, RS.NumStaticSamplers,
+                  sizeof(DxilStaticSamplerDesc)))
+    return false;
+
+  for (uint32_t iRP = 0; iRP < RS.NumParameters; iRP++) {
+    const DxilContainerRootParameter &RP = GetParameter(iRP);
+    switch ((DxilRootParameterType)RP.ParameterType) {
+    case DxilRootParameterType::DescriptorTable: {
+      if (!IsInBounds(RP.PayloadOffset, 1,
+                      sizeof(DxilContainerRootDescriptorTable)))
+        return false;
+      const DxilContainerRootDescriptorTable &Table = GetDescriptorTable(iRP);
+      if (!IsInBounds(Table.DescriptorRangesOffset, Table.NumDescriptorRanges,
+                      RangeSize))
+        return false;
+      break;
+    }
+    case DxilRootParameterType::Constants32Bit:
+      if (!IsInBounds(RP.PayloadOffset, 1, sizeof(DxilRootConstants)))
+        return false;
+      break;
+    case DxilRootParameterType::CBV:
+    case DxilRootParameterType::SRV:
+    case DxilRootParameterType::UAV:
+      if (!IsInBounds(RP.PayloadOffset, 1, DescriptorSize))
+        return false;
+      break;
+    default:
+      return false;
+    }
+  }
+  return true;
+}
+
+const DxilContainerRootSignatureDesc &DxilRootSignatureView::GetDesc() const {
+  DXASSERT_NOMSG(m_pData != nullptr);
+  return *(const DxilContainerRootSignatureDesc *)m_pData;
+}
+
+const DxilContainerRootParameter &
+DxilRootSignatureView::GetParameter(uint32_t Index) const {
+  DXASSERT(Index < GetDesc().NumParameters, "otherwise caller passed OOB index");
+  const DxilContainerRootParameter *pParams =
+      (const DxilContainerRootParameter *)(m_pData + GetDesc().RootParametersOffset);
+  return pParams[Index];
+}
+
+const DxilContainerRootDescriptorTable &
+DxilRootSignatureView::GetDescriptorTable(uint32_t Index) const {
+  const DxilContainerRootParameter &RP = GetParameter(Index);
+  DXASSERT_NOMSG((DxilRootParameterType)RP.ParameterType ==
+                 DxilRootParameterType::DescriptorTable);
+  return *(const DxilContainerRootDescriptorTable *)(m_pData + RP.PayloadOffset);
+}
+
+DxilRootSignatureVersion DxilRootSignatureView::GetVersion() const {
+  return (DxilRootSignatureVersion)GetDesc().Version;
+}
+
+DxilRootSignatureFlags DxilRootSignatureView::GetFlags() const {
+  return (DxilRootSignatureFlags)GetDesc().Flags;
+}
+
+uint32_t DxilRootSignatureView::GetNumParameters() const {
+  return GetDesc().NumParameters;
+}
+
+DxilRootParameterType
+DxilRootSignatureView::GetParameterType(uint32_t Index) const {
+  return (DxilRootParameterType)GetParameter(Index).ParameterType;
+}
+
+DxilShaderVisibility
+DxilRootSignatureView::GetShaderVisibility(uint32_t Index) const {
+  return (DxilShaderVisibility)GetParameter(Index).ShaderVisibility;
+}
+
+const DxilRootConstants &
+DxilRootSignatureView::GetConstants(uint32_t Index) const {
+  const DxilContainerRootParameter &RP = GetParameter(Index);
+  DXASSERT_NOMSG((DxilRootParameterType)RP.ParameterType ==
+                 DxilRootParameterType::Constants32Bit);
+  return *(const DxilRootConstants *)(m_pData + RP.PayloadOffset);
+}
+
+DxilRootDescriptor1 DxilRootSignatureView::GetDescriptor(uint32_t Index) const {
+  const DxilContainerRootParameter &RP = GetParameter(Index);
+  DXASSERT_NOMSG((DxilRootParameterType)RP.ParameterType ==
+                     DxilRootParameterType::CBV ||
+                 (DxilRootParameterType)RP.ParameterType ==
+                     DxilRootParameterType::SRV ||
+                 (DxilRootParameterType)RP.ParameterType ==
+                     DxilRootParameterType::UAV);
+  DxilRootDescriptor1 D;
+  if (GetVersion() == DxilRootSignatureVersion::Version_1_0) {
+    const DxilRootDescriptor *p = (const DxilRootDescriptor *)(m_pData + RP.PayloadOffset);
+    D.ShaderRegister = p->ShaderRegister;
+    D.RegisterSpace = p->RegisterSpace;
+    D.Flags = root_sig_helper::GetFlags(*p);
+  } else {
+    const DxilContainerRootDescriptor1 *p =
+        (const DxilContainerRootDescriptor1 *)(m_pData + RP.PayloadOffset);
+    D.ShaderRegister = p->ShaderRegister;
+    D.RegisterSpace = p->RegisterSpace;
+    D.Flags = (DxilRootDescriptorFlags)p->Flags;
+  }
+  return D;
+}
+
+uint32_t DxilRootSignatureView::GetNumDescriptorRanges(uint32_t Index) const {
+  return GetDescriptorTable(Index).NumDescriptorRanges;
+}
+
+DxilDescriptorRange1
+DxilRootSignatureView::GetDescriptorRange(uint32_t Index,
+                                          uint32_t RangeIndex) const {
+  const DxilContainerRootDescriptorTable &Table = GetDescriptorTable(Index);
+  DXASSERT(RangeIndex < Table.NumDescriptorRanges, "otherwise caller passed OOB index");
+  const char *pRanges = m_pData + Table.DescriptorRangesOffset;
+  DxilDescriptorRange1 R;
+  if (GetVersion() == DxilRootSignatureVersion::Version_1_0) {
+    const DxilContainerDescriptorRange &In =
+        ((const DxilContainerDescriptorRange *)pRanges)[RangeIndex];
+    R.RangeType = (DxilDescriptorRangeType)In.RangeType;
+    R.NumDescriptors = In.NumDescriptors;
+    R.BaseShaderRegister = In.BaseShaderRegister;
+    R.RegisterSpace = In.RegisterSpace;
+    R.Flags = root_sig_helper::GetFlags(In);
+    R.OffsetInDescriptorsFromTableStart = In.OffsetInDescriptorsFromTableStart;
+  } else {
+    const DxilContainerDescriptorRange1 &In =
+        ((const DxilContainerDescriptorRange1 *)pRanges)[RangeIndex];
+    R.RangeType = (DxilDescriptorRangeType)In.RangeType;
+    R.NumDescriptors = In.NumDescriptors;
+    R.BaseShaderRegister = In.BaseShaderRegister;
+    R.RegisterSpace = In.RegisterSpace;
+    R.Flags = root_sig_helper::GetFlags(In);
+    R.OffsetInDescriptorsFromTableStart = In.OffsetInDescriptorsFromTableStart;
+  }
+  return R;
+}
+
+uint32_t DxilRootSignatureView::GetNumStaticSamplers() const {
+  return GetDesc().NumStaticSamplers;
+}
+
+const DxilStaticSamplerDesc &
+DxilRootSignatureView::GetStaticSampler(uint32_t Index) const {
+  DXASSERT(Index < GetDesc().NumStaticSamplers, "otherwise caller passed OOB index");
+  const DxilStaticSamplerDesc *pSamplers =
+      (const DxilStaticSamplerDesc *)(m_pData + GetDesc().StaticSamplersOffset);
+  return pSamplers[Index];
+}
+
 } // namespace hlsl
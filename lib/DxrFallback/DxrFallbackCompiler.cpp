@@ -8,6 +8,7 @@
 #include "dxc/dxcdxrfallbackcompiler.h"
 #include "dxc/Support/dxcapi.use.h"
 #include "dxc/Support/dxcapi.impl.h"
+#include "dxc/Support/dxcconcurrency.h"
 #include "dxc/DXIL/DxilModule.h"
 #include "dxc/HLSL/DxilLinker.h"
 #include "dxc/DXIL/DxilFunctionProps.h"
@@ -15,12 +16,14 @@
 #include "dxc/DXIL/DxilInstructions.h"
 
 #include "llvm/Analysis/CallGraph.h"
+#include "llvm/Bitcode/ReaderWriter.h"
 #include "llvm/IR/InstIterator.h"
 #include "llvm/IR/Instructions.h"
 #include "llvm/IR/IRBuilder.h"
 #include "llvm/IR/LegacyPassManager.h"
 #include "llvm/IR/Module.h"
 #include "llvm/Linker/Linker.h"
+#include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Transforms/IPO.h"
 #include "llvm/Transforms/Utils/BasicBlockUtils.h"
 #include "llvm/Transforms/Utils/Cloning.h"
@@ -31,6 +34,7 @@
 #include "StateFunctionTransform.h"
 
 #include <queue>
+#include <thread>
 
 using namespace hlsl;
 using namespace llvm;
@@ -198,6 +202,16 @@ void DxrFallbackCompiler::link(std::vector<int>& shaderEntryStateIds, std::vecto
 }
 
 
+void DxrFallbackCompiler::setDispatchStrategy(DispatchStrategy val)
+{
+  m_dispatchStrategy = val;
+}
+
+void DxrFallbackCompiler::setParallelTransform(bool val)
+{
+  m_parallelTransform = val;
+}
+
 void DxrFallbackCompiler::setDebugOutputLevel(int val)
 {
   m_debugOutputLevel = val;
@@ -497,6 +511,107 @@ static void collectResources(DxilModule& DM, std::set<Value*>& resources)
 }
 
 
+static void configureTransform(
+  StateFunctionTransform& sft,
+  const std::string& shader,
+  Function* F,
+  DXIL::ShaderKind shaderKind,
+  const std::set<Value*>& resources,
+  int debugOutputLevel,
+  unsigned maxAttributeSize
+)
+{
+  if (debugOutputLevel >= 2)
+    sft.setVerbose(true);
+  if (debugOutputLevel >= 3)
+    sft.setDumpFilename("dump.ll");
+  if (shader == "Fallback_TraceRay")
+    sft.setAttributeSize(maxAttributeSize);
+  if (shaderKind != DXIL::ShaderKind::Invalid)
+    sft.setParameterInfo(getParameterTypes(F, shaderKind), shaderKind == DXIL::ShaderKind::ClosestHit);
+  sft.setResourceGlobals(resources);
+}
+
+// The transform of one shader does not depend on the others until the state
+// IDs are finalized. With enough shaders, each one is therefore transformed
+// on a worker thread, in a copy of the module in the worker's own context,
+// and its state functions are linked back into the module afterwards.
+static const unsigned kMinShadersForParallelTransform = 8;
+
+namespace {
+struct ShaderTransformResult
+{
+  std::string functionName;           // name of the shader after the transform
+  std::vector<std::string> stateFunctionNames;
+  unsigned int stackSize = 0;
+  std::string bitcode;                // the state functions, all else declared
+  std::exception_ptr exception;
+};
+}
+
+// Gives every symbol external linkage so that the copies of the module can
+// be linked back to it by name, recording the symbols that were local.
+// Returns false, changing nothing, if some symbol cannot be linked by name.
+static bool makeSymbolsLinkable(Module* mod, std::vector<std::pair<GlobalValue*, GlobalValue::LinkageTypes>>& localSymbols)
+{
+  if (!mod->alias_empty())
+    return false;
+
+  std::vector<GlobalValue*> symbols;
+  for (GlobalVariable& GV : mod->globals())
+    symbols.push_back(&GV);
+  for (Function& F : mod->functions())
+    symbols.push_back(&F);
+  for (GlobalValue* GV : symbols)
+  {
+    if (!GV->hasName())
+      return false;
+  }
+
+  for (GlobalValue* GV : symbols)
+  {
+    if (GV->hasLocalLinkage())
+    {
+      localSymbols.emplace_back(GV, GV->getLinkage());
+      GV->setLinkage(GlobalValue::ExternalLinkage);
+    }
+  }
+  return true;
+}
+
+// Leaves only the state functions defined in a copy of the module, with
+// everything they use declared, ready to be linked into the original.
+static void keepOnlyStateFunctions(Module* mod, const std::vector<Function*>& stateFunctions)
+{
+  std::set<Function*> keep(stateFunctions.begin(), stateFunctions.end());
+  for (Function& F : mod->functions())
+  {
+    if (!F.isDeclaration() && !keep.count(&F))
+      F.deleteBody();
+  }
+  for (GlobalVariable& GV : mod->globals())
+  {
+    if (GV.hasInitializer())
+    {
+      GV.setInitializer(nullptr);
+      GV.setLinkage(GlobalValue::ExternalLinkage);
+    }
+  }
+  for (auto F = mod->begin(), E = mod->end(); F != E; )
+  {
+    Function* func = &*(F++);
+    if (func->isDeclaration() && func->use_empty())
+      func->eraseFromParent();
+  }
+
+  // The original module already has the module-level metadata.
+  std::vector<NamedMDNode*> namedMetadata;
+  for (NamedMDNode& node : mod->named_metadata())
+    namedMetadata.push_back(&node);
+  for (NamedMDNode* node : namedMetadata)
+    mod->eraseNamedMetadata(node);
+}
+
 void DxrFallbackCompiler::createStateFunctions(
   IntToFuncMap& stateFunctionMap,
   std::vector<int>& shaderEntryStateIds,
@@ -506,10 +621,14 @@ void DxrFallbackCompiler::createStateFunctions(
   Type* runtimeDataArgTy
 )
 {
+  bool allShadersFound = true;
   for (auto& kv : m_shaderMap)
   {
     if (kv.second == nullptr)
+    {
       errs() << "Function not found for shader " << kv.first << "\n";
+      allShadersFound = false;
+    }
   }
 
   DxilModule& DM = m_module->GetOrCreateDxilModule();
@@ -518,22 +637,21 @@ void DxrFallbackCompiler::createStateFunctions(
 
   shaderEntryStateIds.clear();
   shaderStackSizes.clear();
+
+  if (allShadersFound && m_parallelTransform && std::thread::hardware_concurrency() >= 2 && m_debugOutputLevel < 2 &&
+      shaderNames.size() >= kMinShadersForParallelTransform &&
+      createStateFunctionsInParallel(stateFunctionMap, shaderEntryStateIds, shaderStackSizes, baseStateId, shaderNames, runtimeDataArgTy, resources))
+  {
+    return;
+  }
+
   int stateId = baseStateId;
   for (auto& shader : shaderNames)
   {
     std::vector<Function*> stateFunctions;
     Function* F = m_shaderMap[shader];
     StateFunctionTransform sft(F, shaderNames, runtimeDataArgTy);
-    if (m_debugOutputLevel >= 2)
-      sft.setVerbose(true);
-    if (m_debugOutputLevel >= 3)
-      sft.setDumpFilename("dump.ll");
-    if (shader == "Fallback_TraceRay")
-      sft.setAttributeSize(m_maxAttributeSize);
-    DXIL::ShaderKind shaderKind = getRayShaderKind(F);
-    if (shaderKind != DXIL::ShaderKind::Invalid)
-      sft.setParameterInfo(getParameterTypes(F, shaderKind), shaderKind == DXIL::ShaderKind::ClosestHit);
-    sft.setResourceGlobals(resources);
+    configureTransform(sft, shader, F, getRayShaderKind(F), resources, m_debugOutputLevel, m_maxAttributeSize);
     UINT shaderStackSize = 0;
     sft.run(stateFunctions, shaderStackSize);
 
@@ -551,6 +669,149 @@ void DxrFallbackCompiler::createStateFunctions(
   StateFunctionTransform::finalizeStateIds(m_module, shaderEntryStateIds);
 }
 
+bool DxrFallbackCompiler::createStateFunctionsInParallel(
+  IntToFuncMap& stateFunctionMap,
+  std::vector<int>& shaderEntryStateIds,
+  std::vector<unsigned int>& shaderStackSizes,
+  int baseStateId,
+  const std::vector<std::string>& shaderNames,
+  Type* runtimeDataArgTy,
+  const std::set<Value*>& resources
+)
+{
+  // The workers find resources and types in their copies by name.
+  std::vector<std::string> resourceNames;
+  for (Value* resource : resources)
+  {
+    GlobalVariable* GV = dyn_cast<GlobalVariable>(resource);
+    if (!GV)
+      return false;
+    resourceNames.push_back(GV->getName());
+  }
+  StructType* runtimeDataStructTy = nullptr;
+  if (PointerType* PT = dyn_cast<PointerType>(runtimeDataArgTy))
+    runtimeDataStructTy = dyn_cast<StructType>(PT->getElementType());
+  if (!runtimeDataStructTy || !runtimeDataStructTy->hasName())
+    return false;
+  std::string runtimeDataTypeName = runtimeDataStructTy->getName();
+  unsigned runtimeDataAddrSpace = runtimeDataArgTy->getPointerAddressSpace();
+
+  std::vector<std::pair<GlobalValue*, GlobalValue::LinkageTypes>> localSymbols;
+  if (!makeSymbolsLinkable(m_module, localSymbols))
+    return false;
+
+  std::vector<std::string> functionNames;
+  std::vector<DXIL::ShaderKind> shaderKinds;
+  for (auto& shader : shaderNames)
+  {
+    Function* F = m_shaderMap[shader];
+    functionNames.push_back(F->getName());
+    shaderKinds.push_back(getRayShaderKind(F));
+  }
+
+  std::string bitcode;
+  {
+    raw_string_ostream OS(bitcode);
+    WriteBitcodeToFile(m_module, OS);
+  }
+
+  std::vector<ShaderTransformResult> results(shaderNames.size());
+  IMalloc* pMalloc = DxcGetThreadMallocNoRef();
+  RunConcurrently((unsigned)shaderNames.size(), [&](unsigned i)
+  {
+    DxcThreadMalloc TM(pMalloc);
+    ShaderTransformResult& result = results[i];
+    try
+    {
+      // A fresh context per copy, so that type names are not uniqued
+      // against an earlier copy.
+      LLVMContext context;
+      ErrorOr<std::unique_ptr<Module>> modOrErr =
+        parseBitcodeFile(MemoryBufferRef(bitcode, "state-functions"), context);
+      IFTBOOL(!modOrErr.getError(), DXC_E_GENERAL_INTERNAL_ERROR);
+      std::unique_ptr<Module> mod = std::move(modOrErr.get());
+
+      std::set<Value*> modResources;
+      for (auto& name : resourceNames)
+      {
+        if (GlobalVariable* GV = mod->getNamedGlobal(name))
+          modResources.insert(GV);
+      }
+      StructType* modRuntimeDataTy = mod->getTypeByName(runtimeDataTypeName);
+      IFTBOOL(modRuntimeDataTy, DXC_E_GENERAL_INTERNAL_ERROR);
+
+      Function* F = mod->getFunction(functionNames[i]);
+      std::vector<Function*> stateFunctions;
+      StateFunctionTransform sft(F, shaderNames, modRuntimeDataTy->getPointerTo(runtimeDataAddrSpace));
+      configureTransform(sft, shaderNames[i], F, shaderKinds[i], modResources, m_debugOutputLevel, m_maxAttributeSize);
+      sft.run(stateFunctions, result.stackSize);
+
+      result.functionName = F->getName();
+      for (Function* stateF : stateFunctions)
+        result.stateFunctionNames.push_back(stateF->getName());
+      keepOnlyStateFunctions(mod.get(), stateFunctions);
+      raw_string_ostream OS(result.bitcode);
+      WriteBitcodeToFile(mod.get(), OS);
+    }
+    catch (...)
+    {
+      result.exception = std::current_exception();
+    }
+  });
+
+  for (ShaderTransformResult& result : results)
+  {
+    if (result.exception)
+      std::rethrow_exception(result.exception);
+  }
+
+  // Leave the shaders the way the transform leaves them in place, so that
+  // the declarations in the state functions link to them.
+  for (size_t i = 0; i < shaderNames.size(); ++i)
+  {
+    Function* F = m_shaderMap[shaderNames[i]];
+    F->deleteBody();
+    F->setName(results[i].functionName);
+  }
+
+  Linker linker(m_module);
+  for (ShaderTransformResult& result : results)
+  {
+    ErrorOr<std::unique_ptr<Module>> modOrErr =
+      parseBitcodeFile(MemoryBufferRef(result.bitcode, "state-functions"), m_module->getContext());
+    IFTBOOL(!modOrErr.getError(), DXC_E_GENERAL_INTERNAL_ERROR);
+    bool linkErr = linker.linkInModule(modOrErr.get().get());
+    IFTBOOL(!linkErr, DXC_E_GENERAL_INTERNAL_ERROR);
+    result.bitcode.clear();
+  }
+
+  for (auto& kv : localSymbols)
+  {
+    if (!kv.first->isDeclaration())
+      kv.first->setLinkage(kv.second);
+  }
+
+  DxilModule& DM = m_module->GetOrCreateDxilModule();
+  int stateId = baseStateId;
+  for (size_t i = 0; i < shaderNames.size(); ++i)
+  {
+    Function* F = m_shaderMap[shaderNames[i]];
+    shaderEntryStateIds.push_back(stateId);
+    shaderStackSizes.push_back(results[i].stackSize);
+    for (auto& name : results[i].stateFunctionNames)
+    {
+      Function* stateF = m_module->getFunction(name);
+      stateFunctionMap[stateId++] = stateF;
+      if (DM.HasDxilFunctionProps(F)) {
+        DM.CloneDxilEntryProps(F, stateF);
+      }
+    }
+  }
+
+  StateFunctionTransform::finalizeStateIds(m_module, shaderEntryStateIds);
+  return true;
+}
+
 void DxrFallbackCompiler::createLaunchParams(Function* func)
 {
   Module* mod = func->getParent();
@@ -582,6 +843,8 @@ void DxrFallbackCompiler::createStateDispatch(Function* func, const IntToFuncMap
 {
   Module* mod = func->getParent();
   Function* dispatchFunc = createDispatchFunction(stateFunctionMap, runtimeDataArgTy);
+  if (m_dispatchStrategy == DispatchStrategy::Coherent)
+    dispatchFunc = createCoherentDispatchFunction(dispatchFunc, runtimeDataArgTy);
   Function* rewrite_dispatchFunc = mod->getFunction("rewrite_dispatch");
   rewrite_dispatchFunc->replaceAllUsesWith(dispatchFunc);
   rewrite_dispatchFunc->eraseFromParent();
@@ -785,6 +1048,67 @@ Function* DxrFallbackCompiler::createDispatchFunction(const IntToFuncMap &stateF
   return dispatchFunc;
 }
 
+// The scheduler loop calls the dispatch only for lanes whose state ID is not
+// negative, so the wave intrinsics here see exactly the lanes still running.
+Function* DxrFallbackCompiler::createCoherentDispatchFunction(Function* dispatchFunc, Type* runtimeDataArgTy)
+{
+  LLVMContext& context = m_module->getContext();
+  Function* readFirstFunc = FunctionBuilder(m_module, "dx.op.waveReadLaneFirst.i32").i32().i32().i32().build();
+  Function* activeOpFunc = FunctionBuilder(m_module, "dx.op.waveActiveOp.i32").i32().i32().i32().i8().i8().build();
+  Function* bitCountFunc = FunctionBuilder(m_module, "dx.op.waveAllOp").i32().i32().i1().build();
+
+  Function* coherentFunc = FunctionBuilder(m_module, "dispatchCoherent").i32().type(runtimeDataArgTy, "runtimeData").i32("stateID").build();
+  Value* runtimeDataArg = coherentFunc->arg_begin();
+  Value* stateIdArg = ++coherentFunc->arg_begin();
+  BasicBlock* entryBlock = BasicBlock::Create(context, "entry", coherentFunc);
+  BasicBlock* runBlock = BasicBlock::Create(context, "run", coherentFunc);
+  BasicBlock* endBlock = BasicBlock::Create(context, "end", coherentFunc);
+  IRBuilder<> builder(entryBlock);
+
+  Value* waveOpArgs[] = {
+    makeInt32((int)OP::OpCode::WaveActiveOp, context), stateIdArg,
+    builder.getInt8((uint8_t)DXIL::WaveOpKind::Min), builder.getInt8((uint8_t)DXIL::SignedOpKind::Signed)
+  };
+  Value* candidates[3];
+  candidates[0] = builder.CreateCall(readFirstFunc, { makeInt32((int)OP::OpCode::WaveReadLaneFirst, context), stateIdArg }, "first");
+  candidates[1] = builder.CreateCall(activeOpFunc, waveOpArgs, "min");
+  waveOpArgs[2] = builder.getInt8((uint8_t)DXIL::WaveOpKind::Max);
+  candidates[2] = builder.CreateCall(activeOpFunc, waveOpArgs, "max");
+
+  // The candidate with the most lanes. The counts are wave-uniform, so all
+  // lanes agree on it.
+  Value* bestStateId = nullptr;
+  Value* bestCount = nullptr;
+  for (Value* candidate : candidates)
+  {
+    Value* isCandidate = builder.CreateICmpEQ(stateIdArg, candidate);
+    Value* count = builder.CreateCall(bitCountFunc, { makeInt32((int)OP::OpCode::WaveAllBitCount, context), isCandidate }, "count");
+    if (!bestStateId)
+    {
+      bestStateId = candidate;
+      bestCount = count;
+      continue;
+    }
+    Value* isBetter = builder.CreateICmpUGT(count, bestCount);
+    bestStateId = builder.CreateSelect(isBetter, candidate, bestStateId, "best");
+    bestCount = builder.CreateSelect(isBetter, count, bestCount, "best.count");
+  }
+  builder.CreateCondBr(builder.CreateICmpEQ(stateIdArg, bestStateId), runBlock, endBlock);
+
+  builder.SetInsertPoint(runBlock);
+  Value* nextStateId = builder.CreateCall(dispatchFunc, { runtimeDataArg, stateIdArg }, "nextStateId");
+  builder.CreateBr(endBlock);
+
+  // Lanes at other states keep them for the next iteration.
+  builder.SetInsertPoint(endBlock);
+  PHINode* result = builder.CreatePHI(builder.getInt32Ty(), 2, "stateID.next");
+  result->addIncoming(nextStateId, runBlock);
+  result->addIncoming(stateIdArg, entryBlock);
+  builder.CreateRet(result);
+
+  return coherentFunc;
+}
+
 std::vector<CallInst*> DxrFallbackCompiler::getCallsInShadersToFunction(const std::string& funcName)
 {
   std::vector<CallInst*> calls;
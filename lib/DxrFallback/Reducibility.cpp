@@ -1,356 +1,292 @@
 #include "Reducibility.h"
 
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/SetVector.h"
+#include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/IR/BasicBlock.h"
 #include "llvm/IR/CFG.h"
 #include "llvm/IR/Function.h"
+#include "llvm/IR/IRBuilder.h"
 #include "llvm/IR/Instructions.h"
 #include "llvm/IR/LegacyPassManager.h"
-#include "llvm/Support/raw_ostream.h"
 #include "llvm/Transforms/Utils/Cloning.h"
 #include "llvm/Transforms/Scalar.h"
 
 #include "LLVMUtils.h"
 
-#include <fstream>
+#include <algorithm>
 #include <vector>
-#include <map>
-
-#define DBGS errs
-//#define DBGS dbgs
 
 using namespace llvm;
 
-struct Node
-{
-  SetVector<Node*> in;
-  SetVector<Node*> out;
-  SetVector<BasicBlock*> blocks; // block 0 dominates all others in this node
-  size_t numInstructions = 0;
-
-  Node() {}
-  Node(BasicBlock* B) { insert(B); }
+typedef std::vector<BasicBlock*> BlockVector;
+typedef SmallPtrSet<BasicBlock*, 16> BlockSet;
 
-  void insert(BasicBlock* B)
-  {
-    numInstructions += B->size();
-    blocks.insert(B);
-  }
+// A strongly connected region of the CFG that is entered at several blocks.
+struct IrreducibleLoop
+{
+  BlockVector blocks;
+  BlockVector entries;
 };
 
 
-static void printDotGraph(const std::vector<Node*> nodes, const std::string& filename)
+static size_t countInstructions(Function* F)
 {
-  DBGS() << "Writing " << filename << " ...";
-  std::ofstream out(filename);
-  if (!out)
-  {
-    DBGS() << "FAILED\n";
-    return;
-  }
-
-  // Give nodes a numerical index to make the output cleaner
-  std::map<Node*, int> idxMap;
-  for (size_t i = 0; i < nodes.size(); ++i)
-    idxMap[nodes[i]] = i;
-
+  size_t count = 0;
+  for (BasicBlock& B : *F)
+    count += B.size();
+  return count;
+}
 
-  // Error check - make sure that all the out/in nodes are in the map
-  for (Node* N : nodes)
+// Tarjan's algorithm on the subgraph of the CFG induced by region. Iterative
+// so that long chains of blocks don't overflow the stack.
+static std::vector<BlockVector> findSCCs(const BlockVector& region, const BlockSet& inRegion)
+{
+  std::vector<BlockVector> sccs;
+  DenseMap<BasicBlock*, unsigned> index;
+  DenseMap<BasicBlock*, unsigned> lowLink;
+  BlockVector stack;
+  BlockSet onStack;
+  std::vector<std::pair<BasicBlock*, succ_iterator>> dfsStack;
+  unsigned nextIndex = 0;
+
+  auto visit = [&](BasicBlock* B)
   {
-    for (Node* P : N->in)
-    {
-      if (idxMap.find(P) == idxMap.end())
-        DBGS() << "MISSING INPUT NODE\n";
-      if (P->out.count(N) == 0)
-        DBGS() << "MISSING OUTGOING EDGE FROM PREDECESSOR.\n";
-    }
-    for (Node* S : N->out)
-    {
-      if (idxMap.find(S) == idxMap.end())
-        DBGS() << "MISSING OUTPUT NODE\n";
-      if (S->in.count(N) == 0)
-        DBGS() << "MISSING INCOMING EDGE FROM SUCCESSOR.\n";
-    }
-  }
+    index[B] = lowLink[B] = nextIndex++;
+    stack.push_back(B);
+    onStack.insert(B);
+    dfsStack.push_back(std::make_pair(B, succ_begin(B)));
+  };
 
-
-  // Print header
-  out << "digraph g {\n";
-  out << "node [\n";
-  out << "  fontsize = \"12\"\n";
-  out << "  labeljust = \"l\"\n";
-  out << "]\n";
-
-  for (unsigned i = 0; i < nodes.size(); ++i)
+  for (BasicBlock* root : region)
   {
-    Node* N = nodes[i];
+    if (index.count(root))
+      continue;
 
-    // node
-    out << "  N" << i << " [shape=record,label=\"";
-    for (BasicBlock* B : N->blocks)
-      out << B->getName().str() << "\\n";
-    out << "\"];\n";
+    visit(root);
+    while (!dfsStack.empty())
+    {
+      BasicBlock* B = dfsStack.back().first;
+      if (dfsStack.back().second != succ_end(B))
+      {
+        BasicBlock* S = *dfsStack.back().second++;
+        if (!inRegion.count(S))
+          continue;
+        if (!index.count(S))
+          visit(S);
+        else if (onStack.count(S))
+          lowLink[B] = std::min(lowLink[B], index[S]);
+        continue;
+      }
 
-    // out edges
-    for (Node* S : N->out)
-      out << "  N" << i << " -> N" << idxMap[S] << ";\n";
+      dfsStack.pop_back();
+      if (!dfsStack.empty())
+      {
+        BasicBlock* P = dfsStack.back().first;
+        lowLink[P] = std::min(lowLink[P], lowLink[B]);
+      }
 
-    // in edges
-    //for( Node* P : N->in )    
-    //  out << "  N" << idxMap[P] << " -> N" << i << " [style=dotted];\n";
+      if (lowLink[B] == index[B])
+      {
+        sccs.emplace_back();
+        BasicBlock* member;
+        do
+        {
+          member = stack.back();
+          stack.pop_back();
+          onStack.erase(member);
+          sccs.back().push_back(member);
+        } while (member != B);
+        std::reverse(sccs.back().begin(), sccs.back().end());
+      }
+    }
   }
-
-  out << "}\n";
-
-  DBGS() << "\n";
+  return sccs;
 }
 
-static void printDotGraph(const std::vector<Node*> nodes, Function* F, int step)
+static SetVector<BasicBlock*> getPredecessorsOutside(BasicBlock* B, const BlockSet& blocks)
 {
-  printDotGraph(nodes, ("red." + F->getName() + "_" + std::to_string(step) + ".dot").str());
-}
-
-
-static Node* split(Node* N, std::map<BasicBlock*, Node*>& bbToNode, bool firstSplit)
-{
-  // Remove one predecessor P from N
-  assert(N->in.size() > 1);
-  Node* P = N->in.pop_back_val();
-  P->out.remove(N);
-
-  // Point P to the clone of N, Np
-  Node* Np = new Node();
-  P->out.insert(Np);
-  Np->in.insert(P);
-
-  // Copy successors of N to Np
-  for (Node* S : N->out)
+  SetVector<BasicBlock*> preds;
+  for (BasicBlock* P : predecessors(B))
   {
-    Np->out.insert(S);
-    S->in.insert(Np);
+    if (!blocks.count(P))
+      preds.insert(P);
   }
+  return preds;
+}
 
-#if 1
-  // Run reg2mem on the whole function so we don't have to deal with phis
-  if (firstSplit)
-  {
-    runPasses(N->blocks[0]->getParent(), {
-      createDemoteRegisterToMemoryPass()
-    });
-  }
-
-
-  // Clone N into Np
-  ValueToValueMapTy VMap;
-  for (BasicBlock* B : N->blocks)
+// Copies the loop once for each entry but the first and points the edges from
+// outside the loop to that entry at its copy, so every copy has one entry.
+// Returns the bodies of the loop and of its copies, without their entries.
+// Requires reg2mem, so that no value defined in the loop is used outside it.
+static std::vector<BlockVector> splitLoop(const IrreducibleLoop& loop)
+{
+  Function* F = loop.blocks[0]->getParent();
+  BlockSet inLoop(loop.blocks.begin(), loop.blocks.end());
+  std::vector<BlockVector> bodies(1);
+  for (BasicBlock* B : loop.blocks)
   {
-    BasicBlock* Bp = CloneBasicBlock(B, VMap, ".c", B->getParent());
-    Np->insert(Bp);
-    VMap[B] = Bp;
+    if (B != loop.entries[0])
+      bodies[0].push_back(B);
   }
-  for (BasicBlock* B : Np->blocks)
-    for (Instruction& I : *B)
-      RemapInstruction(&I, VMap, RF_NoModuleLevelChanges | RF_IgnoreMissingEntries);
 
-  // Remap terminators of P from N to Np
-  for (BasicBlock* B : P->blocks)
-    RemapInstruction(B->getTerminator(), VMap, RF_NoModuleLevelChanges | RF_IgnoreMissingEntries);
-
-#else
-  // Clone N into Np
-  ValueToValueMapTy VMap;
-  for (BasicBlock* B : N->blocks)
+  for (size_t e = 1; e < loop.entries.size(); ++e)
   {
-    BasicBlock* Bp = CloneBasicBlock(B, VMap, ".c", B->getParent());
-    Np->insert(Bp);
-    VMap[B] = Bp;
-  }
-  for (BasicBlock* B : Np->blocks)
-    for (Instruction& I : *B)
-      RemapInstruction(&I, VMap, RF_NoModuleLevelChanges | RF_IgnoreMissingEntries);
-
+    BasicBlock* entry = loop.entries[e];
+    SetVector<BasicBlock*> outsidePreds = getPredecessorsOutside(entry, inLoop);
 
-  // Remove incoming values from phis in Np that don't come from actual predecessors
-  BasicBlock* NpEntry = Np->blocks[0];
-  std::set<BasicBlock*> predSet(pred_begin(NpEntry), pred_end(NpEntry));
-  auto I = NpEntry->begin();
-  while (PHINode* phi = dyn_cast<PHINode>(I++))
-  {
-    if (phi->getNumIncomingValues() == predSet.size())
-      continue;
-    for (unsigned i = 0; i < phi->getNumIncomingValues(); )
+    ValueToValueMapTy VMap;
+    BlockVector clones;
+    for (BasicBlock* B : loop.blocks)
     {
-      BasicBlock* B = phi->getIncomingBlock(i);
-      if (!predSet.count(B))
-      {
-        phi->removeIncomingValue(B);
-        continue;
-      }
-      ++i;
+      BasicBlock* Bc = CloneBasicBlock(B, VMap, ".c", F);
+      VMap[B] = Bc;
+      clones.push_back(Bc);
     }
-  }
+    for (BasicBlock* Bc : clones)
+      for (Instruction& I : *Bc)
+        RemapInstruction(&I, VMap, RF_NoModuleLevelChanges | RF_IgnoreMissingEntries);
 
+    BasicBlock* entryClone = cast<BasicBlock>(VMap[entry]);
+    for (BasicBlock* P : outsidePreds)
+      P->getTerminator()->replaceUsesOfWith(entry, entryClone);
 
-  // Remove phi references to P in N. (Do this before remapping terminators.)
-  BasicBlock* Nentry = N->blocks[0];
-  for (BasicBlock* PB : predecessors(Nentry))
-  {
-    if (P->blocks.count(PB))
-      Nentry->removePredecessor(PB);
+    clones.erase(std::find(clones.begin(), clones.end(), entryClone));
+    bodies.push_back(std::move(clones));
   }
+  return bodies;
+}
 
-  // Remap terminators of P from N to Np
-  for (BasicBlock* B : P->blocks)
-    RemapInstruction(B->getTerminator(), VMap, RF_NoModuleLevelChanges | RF_IgnoreMissingEntries);
-
-
-  // Update phis in successors of Np.
-  // There are several cases for a value Vs reaching S. Vs may be defined in N and
-  // a clone Vsp in Np or only passing through one or the other. Furthermore, Vs may 
-  // either appear in a phi in the entry block of S or not.
-  // 1) Vs defined in N (and clone Vsp in Np) and in phi:
-  //    Add incoming value [Vsp, Bp] for cloned value Vsp from predecessor basic
-  //    block Bp in Np wherever [Vs, B] appears
-  // 2) Vs defined in N (and clone Vsp in Np) and not in phi:
-  //    Add phi [Vs,B],[Vsp,Bp] if Vs reaches a use in or through S
-  // 3) Vs passing through N or Np and in phi
-  //    Change [Vs,B] to [Vs,Bp] in phis in S if Vs reached S through P
-  // 4) Vs passing through N or Np and not in a phi
-  //    Do nothing
-  // 
-  // TODO: Only 1) is implemented below and it isn't checking for definition in N
-  for (Node* S : Np->out)
+// Sends every edge to an entry of the loop, from inside or outside of it,
+// through a new block that switches on which entry the edge was going to. The
+// new block is then the only entry. Returns the body of the loop without the
+// new block. Requires reg2mem, so that the entries have no phis.
+static BlockVector addDispatcher(const IrreducibleLoop& loop)
+{
+  Function* F = loop.blocks[0]->getParent();
+  LLVMContext& context = F->getContext();
+  Instruction* allocaPoint = &*F->getEntryBlock().getFirstInsertionPt();
+  AllocaInst* selector = new AllocaInst(Type::getInt32Ty(context), "irr.entry", allocaPoint);
+
+  BasicBlock* dispatch = BasicBlock::Create(context, "irr.dispatch", F, loop.entries[0]);
+  IRBuilder<> builder(dispatch);
+  SwitchInst* sw = builder.CreateSwitch(builder.CreateLoad(selector), loop.entries[0], loop.entries.size() - 1);
+  for (size_t e = 1; e < loop.entries.size(); ++e)
+    sw->addCase(builder.getInt32(e), loop.entries[e]);
+
+  BlockSet inLoop(loop.blocks.begin(), loop.blocks.end());
+  BlockSet dispatchSet;
+  dispatchSet.insert(dispatch);
+  BlockVector body = loop.blocks;
+  for (size_t e = 0; e < loop.entries.size(); ++e)
   {
-    BasicBlock* Sentry = S->blocks[0];
-    auto I = Sentry->begin();
-    while (PHINode* phi = dyn_cast<PHINode>(I++))
+    BasicBlock* entry = loop.entries[e];
+    for (BasicBlock* P : getPredecessorsOutside(entry, dispatchSet))
     {
-      for (unsigned i = 0; i < phi->getNumIncomingValues(); ++i)
-      {
-        BasicBlock* B = phi->getIncomingBlock(i);
-        if (N->blocks.count(B))
-        {
-          Value* V = phi->getIncomingValue(i);
-          Value* Vp = VMap[V];
-          if (!Vp)
-            Vp = V; // Def not in N
-          BasicBlock* Bp = dyn_cast<BasicBlock>(VMap[B]);
-          phi->addIncoming(Vp, Bp);
-        }
-      }
+      BasicBlock* stub = BasicBlock::Create(context, entry->getName() + ".dispatch", F, entry);
+      builder.SetInsertPoint(stub);
+      builder.CreateStore(builder.getInt32(e), selector);
+      builder.CreateBr(dispatch);
+      P->getTerminator()->replaceUsesOfWith(entry, stub);
+      if (inLoop.count(P))
+        body.push_back(stub);
     }
   }
-#endif
-
-  return Np;
+  return body;
 }
 
 // Returns the number of splits
-int makeReducible(Function* F)
+int makeReducible(Function* F, ReducibilityStats* stats, size_t splitBudget)
 {
-  // Break critical edges now in case we need to do mem2reg in split(). mem2reg
-  // will break critical edges and the CFG needs to remain unchanged.
-  runPasses(F, {
-    createBreakCriticalEdgesPass()
-  });
-
-  // initialize nodes
-  std::vector<Node*> nodes;
-  std::map<BasicBlock*, Node*> bbToNode;
+  ReducibilityStats localStats;
+  if (!stats)
+    stats = &localStats;
+  *stats = ReducibilityStats();
+  stats->instructionsBefore = countInstructions(F);
+
+  // Walk the loop nesting forest of F: every strongly connected component with
+  // more than one block is a loop. A loop with one entry is reducible at its
+  // level, and its body without the header is searched for the nested loops.
+  // A loop with several entries is made single-entry first. That only adds
+  // blocks inside the loops around it, so the rest of the walk stays valid.
+  //
+  // Copying a loop for each extra entry gives the best code, but the copies
+  // can contain copies of nested irreducible loops, so the growth is
+  // exponential in the nesting depth. Copies are made while the instructions
+  // they add fit in the budget, after that dispatchers are used.
+  size_t budgetLeft = splitBudget;
+  bool demoted = false;
+  std::vector<BlockVector> worklist(1);
   for (BasicBlock& B : *F)
-  {
-    nodes.push_back(new Node(&B));
-    bbToNode[&B] = nodes.back();
-  }
+    worklist.back().push_back(&B);
 
-  // initialize edges
-  for (Node* N : nodes)
+  while (!worklist.empty())
   {
-    for (BasicBlock* B : successors(N->blocks[0]))
+    BlockVector region = std::move(worklist.back());
+    worklist.pop_back();
+    BlockSet inRegion(region.begin(), region.end());
+    for (BlockVector& scc : findSCCs(region, inRegion))
     {
-      Node* BN = bbToNode[B];
-      N->out.insert(BN);
-      BN->in.insert(N);
-    }
-  }
-
-  int step = 0;
-  bool print = false;
-  if (print) printDotGraph(nodes, F, step++);
+      if (scc.size() == 1)
+        continue; // self loops are reducible
 
-  int numSplits = 0;
-  while (!nodes.empty())
-  {
-    bool changed;
-    do
-    {
-  // It might more efficient to use a worklist based implementation instead
-  // of iterating over the vector.
-      changed = false;
-      for (size_t i = 0; i < nodes.size(); )
+      BlockSet inLoop(scc.begin(), scc.end());
+      IrreducibleLoop loop;
+      for (BasicBlock* B : scc)
       {
-        Node* N = nodes[i];
-
-        // Remove self references
-        if (N->in.count(N))
-        {
-          N->in.remove(N);
-          N->out.remove(N);
-          changed = true;
-        }
-
-        // Remove singletons
-        if (N->in.size() == 0 && N->out.size() == 0)
-        {
-          nodes.erase(nodes.begin() + i);
-          changed = true;
-          if (print) printDotGraph(nodes, F, step++);
-          continue;
-        }
-
-        // Remove nodes with only one incoming edge
-        if (N->in.size() == 1)
+        for (BasicBlock* P : predecessors(B))
         {
-          // fold into predecessor
-          Node* P = N->in.back();
-          P->blocks.insert(N->blocks.begin(), N->blocks.end());
-          P->out.remove(N);
-          for (Node* S : N->out)
+          if (!inLoop.count(P))
           {
-            S->in.remove(N);
-            P->out.insert(S);
-            S->in.insert(P);
+            loop.entries.push_back(B);
+            break;
           }
-          P->numInstructions += N->numInstructions;
-          nodes.erase(nodes.begin() + i);
-          changed = true;
-          if (print) printDotGraph(nodes, F, step++);
-          continue;
         }
+      }
 
-        i++;
+      if (loop.entries.size() <= 1)
+      {
+        // Unreachable loops have no entry, so any block can serve as the header.
+        BasicBlock* header = loop.entries.empty() ? scc[0] : loop.entries[0];
+        scc.erase(std::find(scc.begin(), scc.end(), header));
+        worklist.push_back(std::move(scc));
+        continue;
       }
-    } while (changed);
 
-    if (!nodes.empty())
-    {
-      // Duplicate the smallest node with more than one incoming edge. Better 
-      // methods exist for picking the node to split, e.g. "Making Graphs Reducible
-      // with Controlled Node Splitting" by Janssen and Corporaal.
-      size_t idxMin = ~0;
-      for (size_t i = 0; i < nodes.size(); ++i)
+      if (!demoted)
       {
-        if (nodes[i]->in.size() <= 1)
-          continue;
+        // Run reg2mem on the whole function so we don't have to deal with phis.
+        // This breaks critical edges, so start the walk over afterwards.
+        runPasses(F, {
+          createDemoteRegisterToMemoryPass()
+        });
+        demoted = true;
+        worklist.assign(1, BlockVector());
+        for (BasicBlock& B : *F)
+          worklist.back().push_back(&B);
+        break;
+      }
 
-        if (idxMin == ~0u || nodes[i]->numInstructions < nodes[idxMin]->numInstructions)
-          idxMin = i;
+      loop.blocks = std::move(scc);
+      size_t loopSize = 0;
+      for (BasicBlock* B : loop.blocks)
+        loopSize += B->size();
+      size_t splitCost = loopSize * (loop.entries.size() - 1);
+      if (splitCost <= budgetLeft)
+      {
+        for (BlockVector& body : splitLoop(loop))
+          worklist.push_back(std::move(body));
+        budgetLeft -= splitCost;
+        stats->numSplits++;
+      }
+      else
+      {
+        worklist.push_back(addDispatcher(loop));
+        stats->numDispatchers++;
       }
-      nodes.push_back(split(nodes[idxMin], bbToNode, numSplits == 0));
-      numSplits++;
-      if (print) printDotGraph(nodes, F, step++);
     }
   }
-  return numSplits;
+
+  stats->instructionsAfter = countInstructions(F);
+  return stats->numSplits;
 }
@@ -1,10 +1,28 @@
 #pragma once
 
+#include <cstddef>
+
 namespace llvm
 {
   class Function;
 }
 
-// Analyzes the reducibility of the control flow graph of F and uses node splitting
-// to make an irredicible CFG reducible. Returns the number of node splits.
-int makeReducible(llvm::Function* F);
\ No newline at end of file
+// Default for the splitBudget argument of makeReducible().
+static const size_t kDefaultSplitBudget = 4096;
+
+// What makeReducible() did to a function.
+struct ReducibilityStats
+{
+  int numSplits = 0;         // irreducible loops copied once per extra entry
+  int numDispatchers = 0;    // irreducible loops given a dispatch block instead
+  size_t instructionsBefore = 0;
+  size_t instructionsAfter = 0;
+};
+
+// Analyzes the reducibility of the control flow graph of F and makes an
+// irreducible CFG reducible. Irreducible loops are found by walking the loop
+// nesting forest of F. A loop with several entries is copied once per extra
+// entry (node splitting) while the instructions added stay within splitBudget,
+// and otherwise gets a dispatch block that all edges to its entries go through,
+// which grows the code linearly. Returns the number of node splits.
+int makeReducible(llvm::Function* F, ReducibilityStats* stats = nullptr, size_t splitBudget = kDefaultSplitBudget);
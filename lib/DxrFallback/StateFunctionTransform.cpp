@@ -531,6 +531,25 @@ public:
         return true;
       if (funcName.startswith("dx.op.createHandle"))
         return true;
+      // The same for the whole dispatch, so also after the continuation.
+      if (funcName.startswith("dx.op.dispatchRaysIndex") || funcName.startswith("dx.op.dispatchRaysDimensions"))
+        return true;
+      // Constant buffers do not change during the dispatch either, so loads
+      // from them only need their handles and offsets to be available.
+      if (funcName.startswith("dx.op.cbufferLoad"))
+      {
+        for (unsigned i = 1; i < call->getNumArgOperands(); ++i)
+        {
+          if (!isAvailableAfterCallsite(call->getArgOperand(i)))
+            return false;
+        }
+        return true;
+      }
+    }
+    else if (ExtractValueInst* extract = dyn_cast<ExtractValueInst>(inst))
+    {
+      // Typically a component of a cbufferLoadLegacy.
+      return isAvailableAfterCallsite(extract->getAggregateOperand());
     }
     else if (LoadInst* load = dyn_cast<LoadInst>(inst))
     {
@@ -550,6 +569,27 @@ public:
   }
 
 
+  // Returns true if op is a constant or a value that can be rematerialized,
+  // directly or through the alloca it was demoted to.
+  bool isAvailableAfterCallsite(Value* op)
+  {
+    if (isa<Constant>(op))
+      return true;
+    Instruction* inst = dyn_cast<Instruction>(op);
+    if (!inst)
+      return false;
+    if (LoadInst* load = dyn_cast<LoadInst>(inst))
+    {
+      if (AllocaInst* alloc = dyn_cast<AllocaInst>(load->getPointerOperand()))
+      {
+        auto it = m_allocaToVal.find(alloc);
+        return it != m_allocaToVal.end() && canRematerialize(it->second);
+      }
+    }
+    return canRematerialize(inst);
+  }
+
+
   // Rematerialize the given instruction and its dependency graph, adding 
   // any nonrematerializable values that are live in the function, but not 
   // at this callsite to the work list to insure that their values are restored.
@@ -862,6 +902,36 @@ static void extendAllocaLifetimes(LiveValues& lv)
 }
 
 
+namespace {
+// A range of the stack frame, and the callsites across which it is in use.
+struct FrameSlot
+{
+  uint64_t begin = 0;
+  uint64_t end = 0;
+  LiveValues::Indices liveAt;
+};
+}
+
+// Returns the offset for a value of the given size saved across a callsite:
+// the first place it fits in one of the free slots, or else the end of the
+// frame, offsetInBytes, which is moved past it.
+static uint64_t allocateFrameSlot(std::vector<FrameSlot>& freeSlots, uint64_t& offsetInBytes, uint64_t size, Instruction* inst, DataLayout& DL)
+{
+  for (FrameSlot& slot : freeSlots)
+  {
+    uint64_t offset = align(slot.begin, inst, DL);
+    if (offset + size <= slot.end)
+    {
+      slot.begin = offset + size;
+      return offset;
+    }
+  }
+
+  uint64_t offset = align(offsetInBytes, inst, DL);
+  offsetInBytes = offset + size;
+  return offset;
+}
+
 void StateFunctionTransform::preserveLiveValuesAcrossCallsites(_Out_ unsigned int &shaderStackSize)
 {
   if (m_callSites.empty())
@@ -916,6 +986,7 @@ void StateFunctionTransform::preserveLiveValuesAcrossCallsites(_Out_ unsigned in
   Module* mod = m_function->getParent();
   DataLayout DL(mod);
   DenseMap<Instruction*, Instruction*> allocaToStack;
+  std::vector<FrameSlot> allocaSlots;
   Instruction* insertBefore = getInstructionAfter(m_stackFrameOffset);
   for (Instruction* inst : lv.getAllLiveValues())
   {
@@ -929,7 +1000,13 @@ void StateFunctionTransform::preserveLiveValuesAcrossCallsites(_Out_ unsigned in
     alloc->replaceAllUsesWith(stackAlloca);
     allocaToStack[inst] = stackAlloca;
 
+    FrameSlot slot;
+    slot.begin = offsetInBytes;
     offsetInBytes += DL.getTypeAllocSize(alloc->getAllocatedType());
+    slot.end = offsetInBytes;
+    if (const LiveValues::Indices* indices = lv.getIndicesWhereLive(alloc))
+      slot.liveAt = *indices;
+    allocaSlots.push_back(slot);
   }
   lv.remapLiveValues(allocaToStack); // replace old allocas with stackAllocas
   for (auto& kv : allocaToStack)
@@ -967,6 +1044,15 @@ void StateFunctionTransform::preserveLiveValuesAcrossCallsites(_Out_ unsigned in
   {
     offsetInBytes = baseOffsetInBytes;
 
+    // Values saved here can also go in the slots of allocas that are not
+    // live across this callsite.
+    std::vector<FrameSlot> freeSlots;
+    for (const FrameSlot& slot : allocaSlots)
+    {
+      if (!slot.liveAt.count(i))
+        freeSlots.push_back(slot);
+    }
+
     const InstructionSetVector& liveHere = lv.getLiveValues(i);
     std::vector<Instruction*> workList(liveHere.begin(), liveHere.end());
     std::set<Instruction*> visited;
@@ -996,16 +1082,15 @@ void StateFunctionTransform::preserveLiveValuesAcrossCallsites(_Out_ unsigned in
       {
         assert(!inst->getType()->isPointerTy() && "Can not save pointers");
 
-        offsetInBytes = align(offsetInBytes, inst, DL);
+        uint64_t size = DL.getTypeAllocSize(inst->getType());
+        uint64_t slotOffset = allocateFrameSlot(freeSlots, offsetInBytes, size, inst, DL);
         AllocaInst* alloca = valToAlloca[inst];
 
         Value* saveVal = new LoadInst(alloca, addSuffix(inst->getName(), ".save"), saveInsertBefore);
-        createStackStore(saveStackFrameOffset, saveVal, offsetInBytes, saveInsertBefore);
+        createStackStore(saveStackFrameOffset, saveVal, slotOffset, saveInsertBefore);
 
-        Value* restoreVal = createStackLoad(restoreStackFrameOffset, inst, offsetInBytes, restoreInsertBefore);
+        Value* restoreVal = createStackLoad(restoreStackFrameOffset, inst, slotOffset, restoreInsertBefore);
         new StoreInst(restoreVal, alloca, restoreInsertBefore);
-
-        offsetInBytes += DL.getTypeAllocSize(inst->getType());
       }
       else if (R.getRematerializedValueFor(inst) == nullptr)
       {
@@ -15,6 +15,9 @@
 #include "dxc/DXIL/DxilOperations.h"
 #include "dxc/DXIL/DxilInstructions.h"
 
+#include "llvm/ADT/BitVector.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallVector.h"
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/Module.h"
 #include "llvm/IR/Function.h"
@@ -97,6 +100,21 @@ private:
   // Information per entry point.
   using FunctionSetType = std::unordered_set<llvm::Function *>;
   using InstructionSetType = std::unordered_set<llvm::Instruction *>;
+
+  // Inputs and ViewID reads that instructions depend on, memoized per
+  // strongly connected component of the dependence graph. The instruction
+  // reading an input or ViewID is a source; a component's set has a bit for
+  // each source that the component transitively depends on.
+  struct ContributionInfo {
+    std::vector<llvm::Instruction *> Sources;
+    llvm::DenseMap<llvm::Instruction *, unsigned> SourceIndex;
+    // Index in Sets of the component of each visited instruction, or -1 if
+    // no source contributes to it.
+    llvm::DenseMap<llvm::Instruction *, int> SetOf;
+    std::vector<llvm::BitVector> Sets;
+    void Clear();
+  };
+
   struct EntryInfo {
     llvm::Function *pEntryFunc = nullptr;
     // Sets of functions that may be reachable from an entry.
@@ -104,8 +122,10 @@ private:
     // Outputs to analyze.
     InstructionSetType Outputs;
     // Contributing instructions per output.
+    // Contributing sources per output.
     std::unordered_map<unsigned, InstructionSetType>
         ContributingInstructions[kNumStreams];
+    ContributionInfo Contributions;
 
     void Clear();
   };
@@ -139,12 +159,16 @@ private:
                                     FunctionSetType &FuncSet);
   void AnalyzeFunctions(EntryInfo &Entry);
   void CollectValuesContributingToOutputs(EntryInfo &Entry);
-  void CollectValuesContributingToOutputRec(
+  void CollectSourcesContributingToValue(
       EntryInfo &Entry, llvm::Value *pContributingValue,
       InstructionSetType &ContributingInstructions);
-  void CollectPhiCFValuesContributingToOutputRec(
-      llvm::PHINode *pPhi, EntryInfo &Entry,
-      InstructionSetType &ContributingInstructions);
+  int ComputeContributingSources(EntryInfo &Entry, llvm::Instruction *pRoot);
+  llvm::Instruction *GetContributingInstruction(EntryInfo &Entry,
+                                                llvm::Value *pValue);
+  void CollectDependences(EntryInfo &Entry, llvm::Instruction *pInst,
+                          llvm::SmallVectorImpl<llvm::Instruction *> &Deps);
+  void CollectPhiCFDependences(llvm::PHINode *pPhi,
+                               llvm::SmallVectorImpl<llvm::Instruction *> &Deps);
   const ValueSetType &CollectReachingDecls(llvm::Value *pValue);
   void CollectReachingDeclsRec(llvm::Value *pValue, ValueSetType &ReachingDecls,
                                ValueSetType &Visited);
@@ -254,6 +278,14 @@ void DxilViewIdStateBuilder::EntryInfo::Clear() {
   Outputs.clear();
   for (unsigned i = 0; i < kNumStreams; i++)
     ContributingInstructions[i].clear();
+  Contributions.Clear();
+}
+
+void DxilViewIdStateBuilder::ContributionInfo::Clear() {
+  Sources.clear();
+  SourceIndex.clear();
+  SetOf.clear();
+  Sets.clear();
 }
 
 void DxilViewIdStateBuilder::FuncInfo::Clear() {
@@ -471,7 +503,7 @@ void DxilViewIdStateBuilder::CollectValuesContributingToOutputs(EntryInfo &Entry
       pContributingInstructions = &Entry.ContributingInstructions[StreamId][index];
     }
 
-    CollectValuesContributingToOutputRec(Entry, pContributingValue, *pContributingInstructions);
+    CollectSourcesContributingToValue(Entry, pContributingValue, *pContributingInstructions);
 
     // Handle control dependence of this instruction BB.
     BasicBlock *pBB = CI->getParent();
@@ -479,7 +511,7 @@ void DxilViewIdStateBuilder::CollectValuesContributingToOutputs(EntryInfo &Entry
     FuncInfo *pFuncInfo = m_FuncInfo[F].get();
     const BasicBlockSet &CtrlDepSet = pFuncInfo->CtrlDep.GetCDBlocks(pBB);
     for (BasicBlock *B : CtrlDepSet) {
-      CollectValuesContributingToOutputRec(Entry, B->getTerminator(), *pContributingInstructions);
+      CollectSourcesContributingToValue(Entry, B->getTerminator(), *pContributingInstructions);
     }
 
     if (pContributingInstructions == &ContributingInstructionsAllRows) {
@@ -492,52 +524,163 @@ void DxilViewIdStateBuilder::CollectValuesContributingToOutputs(EntryInfo &Entry
   }
 }
 
-void DxilViewIdStateBuilder::CollectValuesContributingToOutputRec(EntryInfo &Entry,
-                                                           Value *pContributingValue,
-                                                           InstructionSetType &ContributingInstructions) {
-  if (dyn_cast<Argument>(pContributingValue)) {
+void DxilViewIdStateBuilder::CollectSourcesContributingToValue(EntryInfo &Entry,
+                                                        Value *pContributingValue,
+                                                        InstructionSetType &ContributingInstructions) {
+  Instruction *pContributingInst = GetContributingInstruction(Entry, pContributingValue);
+  if (pContributingInst == nullptr)
+    return;
+
+  const ContributionInfo &Contributions = Entry.Contributions;
+  int SetIdx = ComputeContributingSources(Entry, pContributingInst);
+  if (SetIdx < 0)
+    return;
+  const BitVector &Set = Contributions.Sets[SetIdx];
+  for (int i = Set.find_first(); i != -1; i = Set.find_next(i))
+    ContributingInstructions.emplace(Contributions.Sources[i]);
+}
+
+Instruction *DxilViewIdStateBuilder::GetContributingInstruction(EntryInfo &Entry,
+                                                                Value *pValue) {
+  if (dyn_cast<Argument>(pValue)) {
     // This must be a leftover signature argument of an entry function.
     DXASSERT_NOMSG(Entry.pEntryFunc == m_pModule->GetEntryFunction() ||
                    Entry.pEntryFunc == m_pModule->GetPatchConstantFunction());
-    return;
+    return nullptr;
   }
 
-  Instruction *pContributingInst = dyn_cast<Instruction>(pContributingValue);
-  if (pContributingInst == nullptr) {
+  Instruction *pInst = dyn_cast<Instruction>(pValue);
+  if (pInst == nullptr) {
     // Can be literal constant, global decl, branch target.
-    DXASSERT_NOMSG(isa<Constant>(pContributingValue) || isa<BasicBlock>(pContributingValue));
-    return;
+    DXASSERT_NOMSG(isa<Constant>(pValue) || isa<BasicBlock>(pValue));
+    return nullptr;
   }
 
-  BasicBlock *pBB = pContributingInst->getParent();
-  Function *F = pBB->getParent();
-  auto FuncInfoIt = m_FuncInfo.find(F);
-  DXASSERT_NOMSG(FuncInfoIt != m_FuncInfo.end());
-  if (FuncInfoIt == m_FuncInfo.end()) {
-    return;
+  Function *F = pInst->getParent()->getParent();
+  DXASSERT_NOMSG(m_FuncInfo.count(F));
+  if (!m_FuncInfo.count(F))
+    return nullptr;
+  return pInst;
+}
+
+// Computes the set of sources pRoot depends on with Tarjan's algorithm, and
+// the sets of all components visited on the way. A component's set is the
+// union of its own sources and the sets of the components it depends on, so
+// the whole dependence graph is walked at most once per entry. Returns the
+// set index of pRoot's component, or -1 if no source contributes to it.
+int DxilViewIdStateBuilder::ComputeContributingSources(EntryInfo &Entry, Instruction *pRoot) {
+  ContributionInfo &Contributions = Entry.Contributions;
+  auto itDone = Contributions.SetOf.find(pRoot);
+  if (itDone != Contributions.SetOf.end())
+    return itDone->second;
+
+  struct Frame {
+    Instruction *pInst;
+    SmallVector<Instruction *, 8> Deps;
+    unsigned NextDep;
+    unsigned LowLink;
+    BitVector Pending;
+  };
+  DenseMap<Instruction *, unsigned> DFSIndex;
+  std::vector<Instruction *> Stack;
+  std::vector<Frame> DFS;
+
+  auto Visit = [&](Instruction *pInst) {
+    unsigned Index = DFSIndex.size();
+    DFSIndex[pInst] = Index;
+    Stack.push_back(pInst);
+    DFS.emplace_back();
+    Frame &F = DFS.back();
+    F.pInst = pInst;
+    F.NextDep = 0;
+    F.LowLink = Index;
+    if (OP::IsDxilOpFuncCallInst(pInst, DXIL::OpCode::ViewID) ||
+        OP::IsDxilOpFuncCallInst(pInst, DXIL::OpCode::LoadInput) ||
+        OP::IsDxilOpFuncCallInst(pInst, DXIL::OpCode::LoadOutputControlPoint) ||
+        OP::IsDxilOpFuncCallInst(pInst, DXIL::OpCode::LoadPatchConstant)) {
+      auto itSource = Contributions.SourceIndex.insert(
+          std::make_pair(pInst, (unsigned)Contributions.Sources.size()));
+      if (itSource.second)
+        Contributions.Sources.push_back(pInst);
+      unsigned Bit = itSource.first->second;
+      F.Pending.resize(Bit + 1);
+      F.Pending.set(Bit);
+    }
+    CollectDependences(Entry, pInst, F.Deps);
+  };
+
+  Visit(pRoot);
+  while (!DFS.empty()) {
+    Frame &F = DFS.back();
+    if (F.NextDep < F.Deps.size()) {
+      Instruction *pDep = F.Deps[F.NextDep++];
+      auto itSet = Contributions.SetOf.find(pDep);
+      if (itSet != Contributions.SetOf.end()) {
+        // Component already complete.
+        if (itSet->second >= 0)
+          F.Pending |= Contributions.Sets[itSet->second];
+      } else {
+        auto itIndex = DFSIndex.find(pDep);
+        if (itIndex != DFSIndex.end())
+          F.LowLink = std::min(F.LowLink, itIndex->second); // same component
+        else
+          Visit(pDep);
+      }
+      continue;
+    }
+
+    Frame Done = std::move(F);
+    DFS.pop_back();
+    if (Done.LowLink != DFSIndex[Done.pInst]) {
+      // Part of the parent's component; the root collects the union.
+      DFS.back().LowLink = std::min(DFS.back().LowLink, Done.LowLink);
+      DFS.back().Pending |= Done.Pending;
+      continue;
+    }
+
+    int SetIdx = -1;
+    if (Done.Pending.any()) {
+      SetIdx = (int)Contributions.Sets.size();
+      Contributions.Sets.emplace_back(std::move(Done.Pending));
+    }
+    Instruction *pMember;
+    do {
+      pMember = Stack.back();
+      Stack.pop_back();
+      Contributions.SetOf[pMember] = SetIdx;
+    } while (pMember != Done.pInst);
+    if (!DFS.empty() && SetIdx >= 0)
+      DFS.back().Pending |= Contributions.Sets[SetIdx];
   }
 
-  auto itInst = ContributingInstructions.emplace(pContributingInst);
-  // Already visited instruction.
-  if (!itInst.second) return;
+  return Contributions.SetOf[pRoot];
+}
+
+// Collects the instructions whose values pInst depends on.
+void DxilViewIdStateBuilder::CollectDependences(EntryInfo &Entry, Instruction *pInst,
+                                                SmallVectorImpl<Instruction *> &Deps) {
+  auto AddDependence = [&](Value *V) {
+    if (Instruction *pDep = GetContributingInstruction(Entry, V))
+      Deps.push_back(pDep);
+  };
 
   // Handle special cases.
-  if (PHINode *phi = dyn_cast<PHINode>(pContributingInst)) {
-    CollectPhiCFValuesContributingToOutputRec(phi, Entry, ContributingInstructions);
-  } else if (isa<LoadInst>(pContributingInst) || 
-             isa<AtomicCmpXchgInst>(pContributingInst) ||
-             isa<AtomicRMWInst>(pContributingInst)) {
-    Value *pPtrValue = pContributingInst->getOperand(0);
+  if (PHINode *phi = dyn_cast<PHINode>(pInst)) {
+    CollectPhiCFDependences(phi, Deps);
+  } else if (isa<LoadInst>(pInst) ||
+             isa<AtomicCmpXchgInst>(pInst) ||
+             isa<AtomicRMWInst>(pInst)) {
+    Value *pPtrValue = pInst->getOperand(0);
     DXASSERT_NOMSG(pPtrValue->getType()->isPointerTy());
     const ValueSetType &ReachingDecls = CollectReachingDecls(pPtrValue);
     DXASSERT_NOMSG(ReachingDecls.size() > 0);
     for (Value *pDeclValue : ReachingDecls) {
       const ValueSetType &Stores = CollectStores(pDeclValue);
       for (Value *V : Stores) {
-        CollectValuesContributingToOutputRec(Entry, V, ContributingInstructions);
+        AddDependence(V);
       }
     }
-  } else if (CallInst *CI = dyn_cast<CallInst>(pContributingInst)) {
+  } else if (CallInst *CI = dyn_cast<CallInst>(pInst)) {
     if (!hlsl::OP::IsDxilOpFuncCallInst(CI)) {
       Function *F = CI->getCalledFunction();
       if (!F->empty()) {
@@ -545,7 +688,7 @@ void DxilViewIdStateBuilder::CollectValuesContributingToOutputRec(EntryInfo &Ent
         if (Entry.Functions.find(F) != Entry.Functions.end()) {
           const FuncInfo &FI = *m_FuncInfo[F];
           for (ReturnInst *pRetInst : FI.Returns) {
-            CollectValuesContributingToOutputRec(Entry, pRetInst, ContributingInstructions);
+            AddDependence(pRetInst);
           }
         }
       }
@@ -553,17 +696,17 @@ void DxilViewIdStateBuilder::CollectValuesContributingToOutputRec(EntryInfo &Ent
   }
 
   // Handle instruction inputs.
-  unsigned NumOps = pContributingInst->getNumOperands();
+  unsigned NumOps = pInst->getNumOperands();
   for (unsigned i = 0; i < NumOps; i++) {
-    Value *O = pContributingInst->getOperand(i);
-    CollectValuesContributingToOutputRec(Entry, O, ContributingInstructions);
+    AddDependence(pInst->getOperand(i));
   }
 
   // Handle control dependence of this instruction BB.
-  FuncInfo *pFuncInfo = FuncInfoIt->second.get();
+  BasicBlock *pBB = pInst->getParent();
+  FuncInfo *pFuncInfo = m_FuncInfo[pBB->getParent()].get();
   const BasicBlockSet &CtrlDepSet = pFuncInfo->CtrlDep.GetCDBlocks(pBB);
   for (BasicBlock *B : CtrlDepSet) {
-    CollectValuesContributingToOutputRec(Entry, B->getTerminator(), ContributingInstructions);
+    Deps.push_back(B->getTerminator());
   }
 }
 
@@ -572,9 +715,8 @@ void DxilViewIdStateBuilder::CollectValuesContributingToOutputRec(EntryInfo &Ent
 // However, this may be too conservative and, as such, pick up extra control dependent BBs.
 // A better "definition" point is the highest dominator where it is still legal to "insert" constant assignment.
 // In this context, "legal" means that only one value "leaves" the dominator and reaches Phi.
-void DxilViewIdStateBuilder::CollectPhiCFValuesContributingToOutputRec(PHINode *pPhi,
-                                                                EntryInfo &Entry,
-                                                                InstructionSetType &ContributingInstructions) {
+void DxilViewIdStateBuilder::CollectPhiCFDependences(PHINode *pPhi,
+                                                     SmallVectorImpl<Instruction *> &Deps) {
   Function *F = pPhi->getParent()->getParent();
   FuncInfo *pFuncInfo = m_FuncInfo[F].get();
   unordered_map<DomTreeNodeBase<BasicBlock> *, Value *> DomTreeMarkers;
@@ -649,7 +791,7 @@ void DxilViewIdStateBuilder::CollectPhiCFValuesContributingToOutputRec(PHINode *
     pBB = pDefDomNode->getBlock();
     const BasicBlockSet &CtrlDepSet = pFuncInfo->CtrlDep.GetCDBlocks(pBB);
     for (BasicBlock *B : CtrlDepSet) {
-      CollectValuesContributingToOutputRec(Entry, B->getTerminator(), ContributingInstructions);
+      Deps.push_back(B->getTerminator());
     }
   }
 }
@@ -52,11 +52,9 @@ void ControlDependence::Compute(Function *F, PostDomRelationType &PostDomRel) {
 
   // Compute reverse topological order of PDT.
   BasicBlockVector RevTopOrder;
-  BasicBlockSet VisitedBBs;
   for (BasicBlock *pBB : PostDomRel.getRoots()) {
-    ComputeRevTopOrderRec(PostDomRel, pBB, RevTopOrder, VisitedBBs);
+    ComputeRevTopOrder(PostDomRel, pBB, RevTopOrder);
   }
-  DXASSERT_NOMSG(RevTopOrder.size() == VisitedBBs.size());
 
   // Compute control dependence relation.
   for (size_t iBB = 0; iBB < RevTopOrder.size(); iBB++) {
@@ -104,21 +102,26 @@ BasicBlock *ControlDependence::GetIPostDom(PostDomRelationType &PostDomRel, Basi
   return pIDomBB;
 }
 
-void ControlDependence::ComputeRevTopOrderRec(PostDomRelationType &PostDomRel,
-                                              BasicBlock *pBB,
-                                              BasicBlockVector &RevTopOrder,
-                                              BasicBlockSet &VisitedBBs) {
-  if (VisitedBBs.find(pBB) != VisitedBBs.end()) {
+// Post-order walk of the post-dominator tree, so that every block comes after
+// the blocks it immediately post-dominates. Iterative, and visits each node
+// once, which keeps deep trees of large functions cheap.
+void ControlDependence::ComputeRevTopOrder(PostDomRelationType &PostDomRel,
+                                           BasicBlock *pRootBB,
+                                           BasicBlockVector &RevTopOrder) {
+  DomTreeNode *pRoot = PostDomRel.getNode(pRootBB);
+  if (pRoot == nullptr)
     return;
-  }
-  VisitedBBs.insert(pBB);
 
-  SmallVector<BasicBlock *, 8> Descendants;
-  PostDomRel.getDescendants(pBB, Descendants);
-  for (BasicBlock *pDescBB : Descendants) {
-    if (pDescBB != pBB)
-      ComputeRevTopOrderRec(PostDomRel, pDescBB, RevTopOrder, VisitedBBs);
+  SmallVector<std::pair<DomTreeNode *, DomTreeNode::iterator>, 16> Stack;
+  Stack.push_back(std::make_pair(pRoot, pRoot->begin()));
+  while (!Stack.empty()) {
+    DomTreeNode *pNode = Stack.back().first;
+    if (Stack.back().second != pNode->end()) {
+      DomTreeNode *pChild = *Stack.back().second++;
+      Stack.push_back(std::make_pair(pChild, pChild->begin()));
+      continue;
+    }
+    Stack.pop_back();
+    RevTopOrder.emplace_back(pNode->getBlock());
   }
-
-  RevTopOrder.emplace_back(pBB);
 }
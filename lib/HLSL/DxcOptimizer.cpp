@@ -37,9 +37,10 @@
 #include "llvm/IR/Verifier.h"
 #include "llvm/Analysis/CFGPrinter.h"
 #include "llvm/Transforms/IPO/PassManagerBuilder.h"
+#include "llvm/Transforms/Utils/Cloning.h"
 
 #include <algorithm>
-#include <list>   // should change this for string_table
+#include <map>
 #include <vector>
 
 #include "llvm/PassPrinters/PassPrinters.h"
@@ -135,7 +136,23 @@ public:
   }
 };
 
-class DxcOptimizer : public IDxcOptimizer {
+// A pass pipeline parsed from RunOptimizer options. Holds everything needed
+// to build the pass managers for a module without looking at the options
+// again.
+struct DxcPassPipeline {
+  struct Step {
+    enum StepKind { AddPass, PrintModule, UseFunctionPasses, UseModulePasses };
+    StepKind Kind = AddPass;
+    const PassInfo *PassInf = nullptr;          // For AddPass.
+    std::vector<std::pair<std::string, std::string>> Options; // Sorted by name.
+    std::string Banner;                         // For PrintModule.
+  };
+  std::vector<Step> Steps;
+  bool OutputAssembly = false;
+  bool AnalyzeOnly = false;
+};
+
+class DxcOptimizer : public IDxcOptimizer3 {
 private:
   DXC_MICROCOM_TM_REF_FIELDS()
   PassRegistry *m_registry;
@@ -145,7 +162,8 @@ public:
   DXC_MICROCOM_TM_CTOR(DxcOptimizer)
 
   HRESULT STDMETHODCALLTYPE QueryInterface(REFIID iid, void **ppvObject) override {
-    return DoBasicQueryInterface<IDxcOptimizer>(this, iid, ppvObject);
+    return DoBasicQueryInterface<IDxcOptimizer, IDxcOptimizer2,
+                                 IDxcOptimizer3>(this, iid, ppvObject);
   }
 
   HRESULT Initialize();
@@ -159,6 +177,30 @@ public:
     _In_count_(optionCount) LPCWSTR *ppOptions, UINT32 optionCount,
     _COM_Outptr_ IDxcBlob **ppOutputModule,
     _COM_Outptr_opt_ IDxcBlobEncoding **ppOutputText) override;
+  HRESULT STDMETHODCALLTYPE CreateSession(
+    _In_ IDxcBlob *pBlob,
+    _COM_Outptr_ IDxcOptimizerSession **ppSession) override;
+
+  HRESULT STDMETHODCALLTYPE CreatePipeline(
+    _In_count_(optionCount) LPCWSTR *ppOptions, UINT32 optionCount,
+    _COM_Outptr_ IDxcOptimizerPipeline **ppPipeline) override;
+
+  // Parses ppOptions into pipeline.
+  HRESULT ParsePipeline(LPCWSTR *ppOptions, UINT32 optionCount,
+                        DxcPassPipeline &pipeline);
+  // Runs pipeline over M, writing pass text output to outStream.
+  static void RunPipeline(const DxcPassPipeline &pipeline, Module &M,
+                          raw_ostream &outStream);
+  // Builds the pipeline described by ppOptions and runs it over M.
+  HRESULT RunPasses(Module &M, LPCWSTR *ppOptions, UINT32 optionCount,
+                    raw_ostream &outStream);
+  // Runs pipeline over M and writes the requested outputs.
+  HRESULT RunModule(Module &M, const DxcPassPipeline &pipeline,
+                    IDxcBlob **ppOutputModule,
+                    IDxcBlobEncoding **ppOutputText);
+  HRESULT WriteOutputs(Module &M, IDxcBlob *pOutputText,
+                       IDxcBlob **ppOutputModule,
+                       IDxcBlobEncoding **ppOutputText);
 };
 
 class CapturePassManager : public llvm::legacy::PassManagerBase {
@@ -221,30 +263,18 @@ HRESULT STDMETHODCALLTYPE DxcOptimizer::GetAvailablePass(
       GetPassArgDescriptions(m_passes[index]->getPassArgument()), ppResult);
 }
 
-HRESULT STDMETHODCALLTYPE DxcOptimizer::RunOptimizer(
-    IDxcBlob *pBlob, _In_count_(optionCount) LPCWSTR *ppOptions,
-    UINT32 optionCount, _COM_Outptr_ IDxcBlob **ppOutputModule,
-    _COM_Outptr_opt_ IDxcBlobEncoding **ppOutputText) {
-  AssignToOutOpt(nullptr, ppOutputModule);
-  AssignToOutOpt(nullptr, ppOutputText);
-  if (pBlob == nullptr)
-    return E_POINTER;
-  if (optionCount > 0 && ppOptions == nullptr)
-    return E_POINTER;
-
-  DxcThreadMalloc TM(m_pMalloc);
-
+// Parses a DXIL program, bitcode or IR text into a module.
+static std::unique_ptr<Module> ParseOptimizerInput(IDxcBlob *pBlob,
+                                                   LLVMContext &Context) {
   // Setup input buffer.
   //
-  // The ir parsing requires the buffer to be null terminated. We deal with
-  // both source and bitcode input, so the input buffer may not be null
-  // terminated; we create a new membuf that copies and appends for this.
+  // The ir parsing requires text to be null terminated, but the input may not
+  // be; unless it already is, text is copied into a new membuf that appends
+  // the terminator. Bitcode is read in place.
   //
   // If we have the beginning of a DXIL program header, skip to the bitcode.
   //
-  LLVMContext Context;
   SMDiagnostic Err;
-  std::unique_ptr<MemoryBuffer> memBuf;
   std::unique_ptr<Module> M;
   const char * pBlobContent = reinterpret_cast<const char *>(pBlob->GetBufferPointer());
   unsigned blobSize = pBlob->GetBufferSize();
@@ -258,210 +288,522 @@ HRESULT STDMETHODCALLTYPE DxcOptimizer::RunOptimizer(
   }
   else {
     StringRef bufStrRef(pBlobContent, blobSize);
-    memBuf = MemoryBuffer::getMemBufferCopy(bufStrRef);
-    M = parseIR(memBuf->getMemBufferRef(), Err, Context);
+    const unsigned char *pBytes =
+        reinterpret_cast<const unsigned char *>(pBlobContent);
+    if (isBitcode(pBytes, pBytes + blobSize)) {
+      M = parseIR(MemoryBufferRef(bufStrRef, ""), Err, Context);
+    } else if (blobSize > 0 && pBlobContent[blobSize - 1] == '\0') {
+      M = parseIR(MemoryBufferRef(bufStrRef.drop_back(), ""), Err, Context);
+    } else {
+      std::unique_ptr<MemoryBuffer> memBuf =
+          MemoryBuffer::getMemBufferCopy(bufStrRef);
+      M = parseIR(memBuf->getMemBufferRef(), Err, Context);
+    }
   }
 
-  if (M == nullptr) {
-    return DXC_E_IR_VERIFICATION_FAILED;
-  }
+  return M;
+}
 
-  legacy::PassManager ModulePasses;
-  legacy::FunctionPassManager FunctionPasses(M.get());
-  legacy::PassManagerBase *pPassManager = &ModulePasses;
+HRESULT DxcOptimizer::ParsePipeline(LPCWSTR *ppOptions, UINT32 optionCount,
+                                    DxcPassPipeline &pipeline) {
+  typedef DxcPassPipeline::Step Step;
 
-  try {
-    CComPtr<AbstractMemoryStream> pOutputStream;
-    CComPtr<IDxcBlob> pOutputBlob;
-
-    IFT(CreateMemoryStream(m_pMalloc, &pOutputStream));
-    IFT(pOutputStream.QueryInterface(&pOutputBlob));
-
-    raw_stream_ostream outStream(pOutputStream.p);
-
-    //
-    // Consider some differences from opt.exe:
-    //
-    // Create a new optimization pass for each one specified on the command line
-    // as in StandardLinkOpts, OptLevelO1, etc.
-    // No target machine, and so no passes get their target machine ctor called.
-    // No print-after-each-pass option.
-    // No printing of the pass options.
-    // No StripDebug support.
-    // No verifyModule before starting.
-    // Use of PassPipeline for new manager.
-    // No TargetInfo.
-    // No DataLayout.
-    //
-    bool OutputAssembly = false;
-    bool AnalyzeOnly = false;
-
-    // First gather flags, wherever they may be.
-    SmallVector<UINT32, 2> handled;
-    for (UINT32 i = 0; i < optionCount; ++i) {
-      if (wcseq(L"-S", ppOptions[i])) {
-        OutputAssembly = true;
-        handled.push_back(i);
-        continue;
-      }
-      if (wcseq(L"-analyze", ppOptions[i])) {
-        AnalyzeOnly = true;
-        handled.push_back(i);
-        continue;
-      }
+  //
+  // Consider some differences from opt.exe:
+  //
+  // Create a new optimization pass for each one specified on the command line
+  // as in StandardLinkOpts, OptLevelO1, etc.
+  // No target machine, and so no passes get their target machine ctor called.
+  // No print-after-each-pass option.
+  // No printing of the pass options.
+  // No StripDebug support.
+  // No verifyModule before starting.
+  // Use of PassPipeline for new manager.
+  // No TargetInfo.
+  // No DataLayout.
+  //
+
+  // First gather flags, wherever they may be.
+  SmallVector<UINT32, 2> handled;
+  for (UINT32 i = 0; i < optionCount; ++i) {
+    if (wcseq(L"-S", ppOptions[i])) {
+      pipeline.OutputAssembly = true;
+      handled.push_back(i);
+      continue;
+    }
+    if (wcseq(L"-analyze", ppOptions[i])) {
+      pipeline.AnalyzeOnly = true;
+      handled.push_back(i);
+      continue;
     }
+  }
 
-    // TODO: should really use string_table for this once that's available
-    std::list<std::string> optionsAnsi;
-    SmallVector<PassOption, 2> options;
-    for (UINT32 i = 0; i < optionCount; ++i) {
-      if (std::find(handled.begin(), handled.end(), i) != handled.end()) {
-        continue;
-      }
+  SmallVector<PassOption, 2> options;
+  for (UINT32 i = 0; i < optionCount; ++i) {
+    if (std::find(handled.begin(), handled.end(), i) != handled.end()) {
+      continue;
+    }
 
-      // Handle some special cases where we can inject a redirected output stream.
-      if (wcsstartswith(ppOptions[i], L"-print-module")) {
-        LPCWSTR pName = ppOptions[i] + _countof(L"-print-module") - 1;
-        std::string Banner;
-        if (*pName) {
-          IFTARG(*pName != L':' || *pName != L'=');
-          ++pName;
-          CW2A name8(pName);
-          Banner = "MODULE-PRINT ";
-          Banner += name8.m_psz;
-          Banner += "\n";
-        }
-        if (pPassManager == &ModulePasses)
-          pPassManager->add(llvm::createPrintModulePass(outStream, Banner));
-        continue;
+    // Handle some special cases where we can inject a redirected output stream.
+    if (wcsstartswith(ppOptions[i], L"-print-module")) {
+      LPCWSTR pName = ppOptions[i] + _countof(L"-print-module") - 1;
+      Step step;
+      step.Kind = Step::PrintModule;
+      if (*pName) {
+        IFTARG(*pName != L':' || *pName != L'=');
+        ++pName;
+        CW2A name8(pName);
+        step.Banner = "MODULE-PRINT ";
+        step.Banner += name8.m_psz;
+        step.Banner += "\n";
       }
+      pipeline.Steps.push_back(std::move(step));
+      continue;
+    }
 
-      // Handle special switches to toggle per-function prepasses vs. module passes.
-      if (wcseq(ppOptions[i], L"-opt-fn-passes")) {
-        pPassManager = &FunctionPasses;
-        continue;
-      }
-      if (wcseq(ppOptions[i], L"-opt-mod-passes")) {
-        pPassManager = &ModulePasses;
-        continue;
-      }
+    // Handle special switches to toggle per-function prepasses vs. module passes.
+    if (wcseq(ppOptions[i], L"-opt-fn-passes")) {
+      pipeline.Steps.emplace_back();
+      pipeline.Steps.back().Kind = Step::UseFunctionPasses;
+      continue;
+    }
+    if (wcseq(ppOptions[i], L"-opt-mod-passes")) {
+      pipeline.Steps.emplace_back();
+      pipeline.Steps.back().Kind = Step::UseModulePasses;
+      continue;
+    }
 
-      CW2A optName(ppOptions[i], CP_UTF8);
-      // The option syntax is
-      const char ArgDelim = ',';
-      // '-' OPTION_NAME (',' ARG_NAME ('=' ARG_VALUE)?)*
-      char *pCursor = optName.m_psz;
-      const char *pEnd = optName.m_psz + strlen(optName.m_psz);
-      if (*pCursor != '-' && *pCursor != '/') {
+    CW2A optName(ppOptions[i], CP_UTF8);
+    // The option syntax is
+    const char ArgDelim = ',';
+    // '-' OPTION_NAME (',' ARG_NAME ('=' ARG_VALUE)?)*
+    char *pCursor = optName.m_psz;
+    const char *pEnd = optName.m_psz + strlen(optName.m_psz);
+    if (*pCursor != '-' && *pCursor != '/') {
+      return E_INVALIDARG;
+    }
+    ++pCursor;
+    const char *pOptionNameStart = pCursor;
+    while (*pCursor && *pCursor != ArgDelim) {
+      ++pCursor;
+    }
+    *pCursor = '\0';
+    const llvm::PassInfo *PassInf = getPassByName(pOptionNameStart);
+    if (!PassInf) {
+      return E_INVALIDARG;
+    }
+    while (pCursor < pEnd) {
+      // *pCursor is '\0' when we overwrite ',' to get a null-terminated string
+      if (*pCursor && *pCursor != ArgDelim) {
         return E_INVALIDARG;
       }
       ++pCursor;
-      const char *pOptionNameStart = pCursor;
+      const char *pArgStart = pCursor;
       while (*pCursor && *pCursor != ArgDelim) {
         ++pCursor;
       }
-      *pCursor = '\0';
-      const llvm::PassInfo *PassInf = getPassByName(pOptionNameStart);
-      if (!PassInf) {
+      StringRef argString = StringRef(pArgStart, pCursor - pArgStart);
+      std::pair<StringRef, StringRef> nameValue = argString.split('=');
+      if (!IsPassOptionName(nameValue.first)) {
         return E_INVALIDARG;
       }
-      while (pCursor < pEnd) {
-        // *pCursor is '\0' when we overwrite ',' to get a null-terminated string
-        if (*pCursor && *pCursor != ArgDelim) {
-          return E_INVALIDARG;
-        }
-        ++pCursor;
-        const char *pArgStart = pCursor;
-        while (*pCursor && *pCursor != ArgDelim) {
-          ++pCursor;
-        }
-        StringRef argString = StringRef(pArgStart, pCursor - pArgStart);
-        std::pair<StringRef, StringRef> nameValue = argString.split('=');
-        if (!IsPassOptionName(nameValue.first)) {
-          return E_INVALIDARG;
-        }
 
-        PassOption *OptionPos = std::lower_bound(options.begin(), options.end(), nameValue, PassOptionsCompare());
-        // If empty, remove if available; otherwise upsert.
-        if (nameValue.second.empty()) {
-          if (OptionPos != options.end() && OptionPos->first == nameValue.first) {
-            options.erase(OptionPos);
-          }
+      PassOption *OptionPos = std::lower_bound(options.begin(), options.end(), nameValue, PassOptionsCompare());
+      // If empty, remove if available; otherwise upsert.
+      if (nameValue.second.empty()) {
+        if (OptionPos != options.end() && OptionPos->first == nameValue.first) {
+          options.erase(OptionPos);
+        }
+      }
+      else {
+        if (OptionPos != options.end() && OptionPos->first == nameValue.first) {
+          OptionPos->second = nameValue.second;
         }
         else {
-          if (OptionPos != options.end() && OptionPos->first == nameValue.first) {
-            OptionPos->second = nameValue.second;
-          }
-          else {
-            options.insert(OptionPos, nameValue);
-          }
+          options.insert(OptionPos, nameValue);
         }
       }
+    }
 
-      DXASSERT(PassInf->getNormalCtor(), "else pass with no default .ctor was added");
-      Pass *pass = PassInf->getNormalCtor()();
-      pass->setOSOverride(&outStream);
-      pass->applyOptions(options);
-      options.clear();
-      pPassManager->add(pass);
-      if (AnalyzeOnly) {
-        const bool Quiet = false;
-        PassKind Kind = pass->getPassKind();
-        switch (Kind) {
-        case PT_BasicBlock:
-          pPassManager->add(createBasicBlockPassPrinter(PassInf, outStream, Quiet));
-          break;
-        case PT_Region:
-          pPassManager->add(createRegionPassPrinter(PassInf, outStream, Quiet));
-          break;
-        case PT_Loop:
-          pPassManager->add(createLoopPassPrinter(PassInf, outStream, Quiet));
-          break;
-        case PT_Function:
-          pPassManager->add(createFunctionPassPrinter(PassInf, outStream, Quiet));
-          break;
-        case PT_CallGraphSCC:
-          pPassManager->add(createCallGraphPassPrinter(PassInf, outStream, Quiet));
-          break;
-        default:
-          pPassManager->add(createModulePassPrinter(PassInf, outStream, Quiet));
-          break;
-        }
+    DXASSERT(PassInf->getNormalCtor(), "else pass with no default .ctor was added");
+    Step step;
+    step.PassInf = PassInf;
+    for (const PassOption &option : options)
+      step.Options.emplace_back(option.first, option.second);
+    options.clear();
+    pipeline.Steps.push_back(std::move(step));
+  }
+
+  return S_OK;
+}
+
+void DxcOptimizer::RunPipeline(const DxcPassPipeline &pipeline, Module &M,
+                               raw_ostream &outStream) {
+  typedef DxcPassPipeline::Step Step;
+  legacy::PassManager ModulePasses;
+  legacy::FunctionPassManager FunctionPasses(&M);
+  legacy::PassManagerBase *pPassManager = &ModulePasses;
+
+  SmallVector<PassOption, 2> options;
+  for (const Step &step : pipeline.Steps) {
+    switch (step.Kind) {
+    case Step::PrintModule:
+      if (pPassManager == &ModulePasses)
+        pPassManager->add(llvm::createPrintModulePass(outStream, step.Banner));
+      continue;
+    case Step::UseFunctionPasses:
+      pPassManager = &FunctionPasses;
+      continue;
+    case Step::UseModulePasses:
+      pPassManager = &ModulePasses;
+      continue;
+    case Step::AddPass:
+      break;
+    }
+
+    const llvm::PassInfo *PassInf = step.PassInf;
+    options.clear();
+    for (const auto &option : step.Options)
+      options.push_back(PassOption(option.first, option.second));
+    Pass *pass = PassInf->getNormalCtor()();
+    pass->setOSOverride(&outStream);
+    pass->applyOptions(options);
+    pPassManager->add(pass);
+    if (pipeline.AnalyzeOnly) {
+      const bool Quiet = false;
+      PassKind Kind = pass->getPassKind();
+      switch (Kind) {
+      case PT_BasicBlock:
+        pPassManager->add(createBasicBlockPassPrinter(PassInf, outStream, Quiet));
+        break;
+      case PT_Region:
+        pPassManager->add(createRegionPassPrinter(PassInf, outStream, Quiet));
+        break;
+      case PT_Loop:
+        pPassManager->add(createLoopPassPrinter(PassInf, outStream, Quiet));
+        break;
+      case PT_Function:
+        pPassManager->add(createFunctionPassPrinter(PassInf, outStream, Quiet));
+        break;
+      case PT_CallGraphSCC:
+        pPassManager->add(createCallGraphPassPrinter(PassInf, outStream, Quiet));
+        break;
+      default:
+        pPassManager->add(createModulePassPrinter(PassInf, outStream, Quiet));
+        break;
       }
     }
+  }
 
-    ModulePasses.add(createVerifierPass());
+  ModulePasses.add(createVerifierPass());
 
-    if (OutputAssembly) {
-      ModulePasses.add(llvm::createPrintModulePass(outStream));
-    }
+  if (pipeline.OutputAssembly) {
+    ModulePasses.add(llvm::createPrintModulePass(outStream));
+  }
+
+  // Now that we have all of the passes ready, run them.
+  {
+    raw_ostream *err_ostream = &outStream;
+    ScopedFatalErrorHandler errHandler(FatalErrorHandlerStreamWrite, err_ostream);
+
+    FunctionPasses.doInitialization();
+    for (Function &F : M)
+      if (!F.isDeclaration())
+        FunctionPasses.run(F);
+    FunctionPasses.doFinalization();
+    ModulePasses.run(M);
+  }
+}
+
+HRESULT DxcOptimizer::RunPasses(Module &M, LPCWSTR *ppOptions,
+                                UINT32 optionCount, raw_ostream &outStream) {
+  DxcPassPipeline pipeline;
+  IFR(ParsePipeline(ppOptions, optionCount, pipeline));
+  RunPipeline(pipeline, M, outStream);
+  return S_OK;
+}
 
-    // Now that we have all of the passes ready, run them.
+HRESULT DxcOptimizer::WriteOutputs(Module &M, IDxcBlob *pOutputText,
+                                   IDxcBlob **ppOutputModule,
+                                   IDxcBlobEncoding **ppOutputText) {
+  if (ppOutputText != nullptr) {
+    IFR(DxcCreateBlobWithEncodingSet(pOutputText, CP_UTF8, ppOutputText));
+  }
+  if (ppOutputModule != nullptr) {
+    CComPtr<AbstractMemoryStream> pProgramStream;
+    IFR(CreateMemoryStream(m_pMalloc, &pProgramStream));
     {
-      raw_ostream *err_ostream = &outStream;
-      ScopedFatalErrorHandler errHandler(FatalErrorHandlerStreamWrite, err_ostream);
-
-      FunctionPasses.doInitialization();
-      for (Function &F : *M.get())
-        if (!F.isDeclaration())
-          FunctionPasses.run(F);
-      FunctionPasses.doFinalization();
-      ModulePasses.run(*M.get());
+      raw_stream_ostream outStream(pProgramStream.p);
+      WriteBitcodeToFile(&M, outStream, true);
     }
+    IFR(pProgramStream.QueryInterface(ppOutputModule));
+  }
+  return S_OK;
+}
 
-    outStream.flush();
-    if (ppOutputText != nullptr) {
-      IFT(DxcCreateBlobWithEncodingSet(pOutputBlob, CP_UTF8, ppOutputText));
-    }
-    if (ppOutputModule != nullptr) {
-      CComPtr<AbstractMemoryStream> pProgramStream;
-      IFT(CreateMemoryStream(m_pMalloc, &pProgramStream));
-      {
-        raw_stream_ostream outStream(pProgramStream.p);
-        WriteBitcodeToFile(M.get(), outStream, true);
+HRESULT STDMETHODCALLTYPE DxcOptimizer::RunOptimizer(
+    IDxcBlob *pBlob, _In_count_(optionCount) LPCWSTR *ppOptions,
+    UINT32 optionCount, _COM_Outptr_ IDxcBlob **ppOutputModule,
+    _COM_Outptr_opt_ IDxcBlobEncoding **ppOutputText) {
+  AssignToOutOpt(nullptr, ppOutputModule);
+  AssignToOutOpt(nullptr, ppOutputText);
+  if (pBlob == nullptr)
+    return E_POINTER;
+  if (optionCount > 0 && ppOptions == nullptr)
+    return E_POINTER;
+
+  DxcThreadMalloc TM(m_pMalloc);
+
+  LLVMContext Context;
+  std::unique_ptr<Module> M = ParseOptimizerInput(pBlob, Context);
+  if (M == nullptr) {
+    return DXC_E_IR_VERIFICATION_FAILED;
+  }
+
+  try {
+    DxcPassPipeline pipeline;
+    IFR(ParsePipeline(ppOptions, optionCount, pipeline));
+    IFT(RunModule(*M, pipeline, ppOutputModule, ppOutputText));
+  }
+  CATCH_CPP_RETURN_HRESULT();
+
+  return S_OK;
+}
+
+HRESULT DxcOptimizer::RunModule(Module &M, const DxcPassPipeline &pipeline,
+                                IDxcBlob **ppOutputModule,
+                                IDxcBlobEncoding **ppOutputText) {
+  CComPtr<AbstractMemoryStream> pOutputStream;
+  CComPtr<IDxcBlob> pOutputBlob;
+
+  IFR(CreateMemoryStream(m_pMalloc, &pOutputStream));
+  IFR(pOutputStream.QueryInterface(&pOutputBlob));
+
+  raw_stream_ostream outStream(pOutputStream.p);
+  RunPipeline(pipeline, M, outStream);
+
+  outStream.flush();
+  return WriteOutputs(M, pOutputBlob, ppOutputModule, ppOutputText);
+}
+
+// Passes that only annotate the module for later instrumentation. A run of
+// them at the start of a pipeline gives the same result for every pipeline
+// that starts the same way, so sessions run each such prefix once.
+static bool IsReusablePrefixPass(LPCWSTR pOption) {
+  return wcseq(pOption, L"-dxil-dbg-value-to-dbg-declare") ||
+         wcseq(pOption, L"-dxil-annotate-with-virtual-regs");
+}
+
+class DxcOptimizerSession : public IDxcOptimizerSession {
+private:
+  DXC_MICROCOM_TM_REF_FIELDS()
+  CComPtr<DxcOptimizer> m_pOptimizer;
+  // Declared before the modules, so that it outlives them.
+  LLVMContext m_Context;
+  std::unique_ptr<Module> m_pModule;
+  struct PrefixResult {
+    std::unique_ptr<Module> M;
+    std::string Text;
+  };
+  // Keyed by the prefix options, joined with newlines.
+  std::map<std::wstring, PrefixResult> m_Prefixes;
+
+public:
+  DXC_MICROCOM_TM_ADDREF_RELEASE_IMPL()
+  DXC_MICROCOM_TM_CTOR(DxcOptimizerSession)
+
+  HRESULT STDMETHODCALLTYPE QueryInterface(REFIID iid, void **ppvObject) override {
+    return DoBasicQueryInterface<IDxcOptimizerSession>(this, iid, ppvObject);
+  }
+
+  HRESULT Initialize(DxcOptimizer *pOptimizer, IDxcBlob *pBlob) {
+    m_pOptimizer = pOptimizer;
+    m_pModule = ParseOptimizerInput(pBlob, m_Context);
+    if (m_pModule == nullptr)
+      return DXC_E_IR_VERIFICATION_FAILED;
+    return S_OK;
+  }
+
+  HRESULT STDMETHODCALLTYPE RunOptimizer(
+      _In_count_(optionCount) LPCWSTR *ppOptions, UINT32 optionCount,
+      _COM_Outptr_ IDxcBlob **ppOutputModule,
+      _COM_Outptr_opt_ IDxcBlobEncoding **ppOutputText) override {
+    AssignToOutOpt(nullptr, ppOutputModule);
+    AssignToOutOpt(nullptr, ppOutputText);
+    if (optionCount > 0 && ppOptions == nullptr)
+      return E_POINTER;
+
+    DxcThreadMalloc TM(m_pMalloc);
+
+    try {
+      // Split off the leading annotation passes. -S and -analyze apply to
+      // the whole pipeline, so they stay with the rest; with -analyze the
+      // prefix passes must run here to get their printers.
+      std::vector<LPCWSTR> prefix, rest;
+      bool AnalyzeOnly = false;
+      UINT32 i = 0;
+      for (; i < optionCount; ++i) {
+        if (wcseq(L"-S", ppOptions[i]) || wcseq(L"-analyze", ppOptions[i])) {
+          AnalyzeOnly |= wcseq(L"-analyze", ppOptions[i]);
+          rest.push_back(ppOptions[i]);
+          continue;
+        }
+        if (!IsReusablePrefixPass(ppOptions[i]))
+          break;
+        prefix.push_back(ppOptions[i]);
+      }
+      rest.insert(rest.end(), ppOptions + i, ppOptions + optionCount);
+      if (AnalyzeOnly) {
+        prefix.clear();
+        rest.assign(ppOptions, ppOptions + optionCount);
       }
-      IFT(pProgramStream.QueryInterface(ppOutputModule));
+
+      const Module *pStart = m_pModule.get();
+      const std::string *pPrefixText = nullptr;
+      if (!prefix.empty()) {
+        std::wstring key;
+        for (LPCWSTR pOption : prefix) {
+          key += pOption;
+          key += L'\n';
+        }
+        auto it = m_Prefixes.find(key);
+        if (it == m_Prefixes.end()) {
+          PrefixResult result;
+          result.M.reset(llvm::CloneModule(m_pModule.get()));
+          raw_string_ostream textStream(result.Text);
+          IFR(m_pOptimizer->RunPasses(*result.M, prefix.data(), prefix.size(),
+                                      textStream));
+          textStream.flush();
+          it = m_Prefixes.insert(std::make_pair(key, std::move(result))).first;
+        }
+        pStart = it->second.M.get();
+        pPrefixText = &it->second.Text;
+      }
+
+      std::unique_ptr<Module> M(llvm::CloneModule(pStart));
+      // -dxil-annotate-with-virtual-regs sets the validator version on the
+      // DxilModule only, which the clone does not carry.
+      if (pStart != m_pModule.get() && pStart->HasDxilModule()) {
+        unsigned ValMajor, ValMinor;
+        pStart->GetDxilModule().GetValidatorVersion(ValMajor, ValMinor);
+        M->GetOrCreateDxilModule().SetValidatorVersion(ValMajor, ValMinor);
+      }
+
+      CComPtr<AbstractMemoryStream> pOutputStream;
+      CComPtr<IDxcBlob> pOutputBlob;
+      IFT(CreateMemoryStream(m_pMalloc, &pOutputStream));
+      IFT(pOutputStream.QueryInterface(&pOutputBlob));
+
+      raw_stream_ostream outStream(pOutputStream.p);
+      if (pPrefixText != nullptr)
+        outStream << *pPrefixText;
+      IFR(m_pOptimizer->RunPasses(*M, rest.data(), rest.size(), outStream));
+
+      outStream.flush();
+      IFT(m_pOptimizer->WriteOutputs(*M, pOutputBlob, ppOutputModule,
+                                     ppOutputText));
+
+      // Types outlive the module in the shared context; free the names of
+      // the ones this run added, or the next run's get a numeric suffix.
+      std::vector<StructType *> startTypes = pStart->getIdentifiedStructTypes();
+      std::sort(startTypes.begin(), startTypes.end());
+      for (StructType *ST : M->getIdentifiedStructTypes()) {
+        if (!std::binary_search(startTypes.begin(), startTypes.end(), ST))
+          ST->setName("");
+      }
+    }
+    CATCH_CPP_RETURN_HRESULT();
+
+    return S_OK;
+  }
+};
+
+HRESULT STDMETHODCALLTYPE DxcOptimizer::CreateSession(
+    _In_ IDxcBlob *pBlob, _COM_Outptr_ IDxcOptimizerSession **ppSession) {
+  if (ppSession == nullptr)
+    return E_POINTER;
+  *ppSession = nullptr;
+  if (pBlob == nullptr)
+    return E_POINTER;
+
+  DxcThreadMalloc TM(m_pMalloc);
+
+  try {
+    CComPtr<DxcOptimizerSession> pSession =
+        DxcOptimizerSession::Alloc(m_pMalloc);
+    IFROOM(pSession.p);
+    IFR(pSession->Initialize(this, pBlob));
+    *ppSession = pSession.Detach();
+  }
+  CATCH_CPP_RETURN_HRESULT();
+
+  return S_OK;
+}
+
+class DxcOptimizerPipeline : public IDxcOptimizerPipeline {
+private:
+  DXC_MICROCOM_TM_REF_FIELDS()
+  CComPtr<DxcOptimizer> m_pOptimizer;
+  DxcPassPipeline m_Pipeline; // Not modified after Initialize.
+
+public:
+  DXC_MICROCOM_TM_ADDREF_RELEASE_IMPL()
+  DXC_MICROCOM_TM_CTOR(DxcOptimizerPipeline)
+
+  HRESULT STDMETHODCALLTYPE QueryInterface(REFIID iid, void **ppvObject) override {
+    return DoBasicQueryInterface<IDxcOptimizerPipeline>(this, iid, ppvObject);
+  }
+
+  HRESULT Initialize(DxcOptimizer *pOptimizer, LPCWSTR *ppOptions,
+                     UINT32 optionCount) {
+    m_pOptimizer = pOptimizer;
+    return pOptimizer->ParsePipeline(ppOptions, optionCount, m_Pipeline);
+  }
+
+  HRESULT STDMETHODCALLTYPE RunOptimizer(
+      _In_ IDxcBlob *pBlob,
+      _COM_Outptr_ IDxcBlob **ppOutputModule,
+      _COM_Outptr_opt_ IDxcBlobEncoding **ppOutputText) override {
+    AssignToOutOpt(nullptr, ppOutputModule);
+    AssignToOutOpt(nullptr, ppOutputText);
+    if (pBlob == nullptr)
+      return E_POINTER;
+
+    DxcThreadMalloc TM(m_pMalloc);
+
+    LLVMContext Context;
+    std::unique_ptr<Module> M = ParseOptimizerInput(pBlob, Context);
+    if (M == nullptr) {
+      return DXC_E_IR_VERIFICATION_FAILED;
+    }
+
+    try {
+      IFT(m_pOptimizer->RunModule(*M, m_Pipeline, ppOutputModule,
+                                  ppOutputText));
     }
+    CATCH_CPP_RETURN_HRESULT();
+
+    return S_OK;
+  }
+};
+
+HRESULT STDMETHODCALLTYPE DxcOptimizer::CreatePipeline(
+    _In_count_(optionCount) LPCWSTR *ppOptions, UINT32 optionCount,
+    _COM_Outptr_ IDxcOptimizerPipeline **ppPipeline) {
+  if (ppPipeline == nullptr)
+    return E_POINTER;
+  *ppPipeline = nullptr;
+  if (optionCount > 0 && ppOptions == nullptr)
+    return E_POINTER;
+
+  DxcThreadMalloc TM(m_pMalloc);
+
+  try {
+    CComPtr<DxcOptimizerPipeline> pPipeline =
+        DxcOptimizerPipeline::Alloc(m_pMalloc);
+    IFROOM(pPipeline.p);
+    IFR(pPipeline->Initialize(this, ppOptions, optionCount));
+    *ppPipeline = pPipeline.Detach();
   }
   CATCH_CPP_RETURN_HRESULT();
 
@@ -0,0 +1,112 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// DxilClusterFetches.cpp                                                    //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Moves texture and buffer fetches up to issue them together.              //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#include "dxc/HLSL/DxilGenerationPass.h"
+#include "dxc/DXIL/DxilOperations.h"
+
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Pass.h"
+
+using namespace llvm;
+using namespace hlsl;
+
+// Fetches come out of code generation in source order, often with long
+// chains of math between fetches that do not depend on each other, and not
+// every driver schedules them early again. Within each block, this moves
+// every fetch up, in order, right after the latest of: the values it uses,
+// the previous fetch, and the last instruction that may write memory.
+// Fetches never leave their block, so those that compute derivatives
+// implicitly keep the control flow they had. Enabled with
+// -opt-enable cluster-fetches.
+namespace {
+class DxilClusterFetches : public FunctionPass {
+public:
+  static char ID; // Pass identification, replacement for typeid
+  explicit DxilClusterFetches() : FunctionPass(ID) {}
+
+  StringRef getPassName() const override {
+    return "DXIL cluster texture and buffer fetches";
+  }
+
+  void getAnalysisUsage(AnalysisUsage &AU) const override {
+    AU.setPreservesCFG();
+  }
+
+  bool runOnFunction(Function &F) override;
+
+private:
+  bool hoistFetch(Instruction *I);
+};
+
+char DxilClusterFetches::ID = 0;
+} // namespace
+
+static bool IsFetch(Instruction *I) {
+  CallInst *CI = dyn_cast<CallInst>(I);
+  if (!CI || !OP::IsDxilOpFuncCallInst(CI))
+    return false;
+  switch (OP::GetDxilOpFuncCallInst(CI)) {
+  case OP::OpCode::Sample:
+  case OP::OpCode::SampleBias:
+  case OP::OpCode::SampleLevel:
+  case OP::OpCode::SampleGrad:
+  case OP::OpCode::SampleCmp:
+  case OP::OpCode::SampleCmpLevel:
+  case OP::OpCode::SampleCmpLevelZero:
+  case OP::OpCode::TextureGather:
+  case OP::OpCode::TextureGatherCmp:
+  case OP::OpCode::TextureGatherRaw:
+  case OP::OpCode::TextureLoad:
+  case OP::OpCode::BufferLoad:
+  case OP::OpCode::RawBufferLoad:
+    return true;
+  default:
+    return false;
+  }
+}
+
+bool DxilClusterFetches::hoistFetch(Instruction *I) {
+  BasicBlock *BB = I->getParent();
+  Instruction *InsertBefore = I;
+  for (BasicBlock::iterator It(I); It != BB->begin();) {
+    Instruction *Prev = &*--It;
+    if (isa<PHINode>(Prev) || Prev->mayWriteToMemory() || IsFetch(Prev) ||
+        std::find(I->op_begin(), I->op_end(), Prev) != I->op_end())
+      break;
+    InsertBefore = Prev;
+  }
+  if (InsertBefore == I)
+    return false;
+  I->moveBefore(InsertBefore);
+  return true;
+}
+
+bool DxilClusterFetches::runOnFunction(Function &F) {
+  bool bUpdated = false;
+  for (BasicBlock &BB : F) {
+    SmallVector<Instruction *, 16> Fetches;
+    for (Instruction &I : BB) {
+      if (IsFetch(&I))
+        Fetches.push_back(&I);
+    }
+    for (Instruction *I : Fetches)
+      bUpdated |= hoistFetch(I);
+  }
+  return bUpdated;
+}
+
+FunctionPass *llvm::createDxilClusterFetchesPass() {
+  return new DxilClusterFetches();
+}
+
+INITIALIZE_PASS(DxilClusterFetches, "dxil-cluster-fetches",
+                "DXIL cluster texture and buffer fetches", false, false)
@@ -0,0 +1,165 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// DxilCoalesceCBufferLoads.cpp                                              //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Merges CBufferLoadLegacy calls that read the same row of the same         //
+// constant buffer, across basic blocks.                                     //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#include "dxc/HLSL/DxilGenerationPass.h"
+#include "dxc/DXIL/DxilOperations.h"
+#include "dxc/DXIL/DxilInstructions.h"
+#include "dxc/DXIL/DxilUtil.h"
+
+#include "llvm/ADT/DepthFirstIterator.h"
+#include "llvm/ADT/MapVector.h"
+#include "llvm/IR/Dominators.h"
+#include "llvm/IR/GlobalVariable.h"
+#include "llvm/IR/Instructions.h"
+
+using namespace llvm;
+using namespace hlsl;
+
+// Constant buffers do not change while a shader runs, so CBufferLoadLegacy
+// calls with the same buffer, row and overload always return the same value,
+// whatever stores lie between them. CSE cannot see that, since the calls are
+// only readonly, so this pass merges them using dominance:
+//   - a load dominated by an equivalent load is replaced with it;
+//   - the loads left over, which sit on different paths, are replaced with
+//     one load in their nearest common dominator, when the row is a constant
+//     and a handle to the buffer is available there.
+// For example:
+// if (b)
+//   r = cb.x;
+// else
+//   r = cb.y * 2;  // same row as cb.x
+// ends with a single load of the row before the branch.
+namespace {
+class DxilCoalesceCBufferLoads : public FunctionPass {
+public:
+  static char ID; // Pass identification, replacement for typeid
+  explicit DxilCoalesceCBufferLoads() : FunctionPass(ID) {}
+
+  StringRef getPassName() const override {
+    return "DXIL coalesce cbuffer loads";
+  }
+
+  void getAnalysisUsage(AnalysisUsage &AU) const override {
+    AU.addRequired<DominatorTreeWrapperPass>();
+    AU.addPreserved<DominatorTreeWrapperPass>();
+    AU.setPreservesCFG();
+  }
+
+  bool runOnFunction(Function &F) override;
+
+private:
+  bool coalesce(SmallVectorImpl<CallInst *> &Loads, DominatorTree &DT);
+};
+
+char DxilCoalesceCBufferLoads::ID = 0;
+
+bool IsAvailableAt(Value *V, Instruction *InsertPt, DominatorTree &DT) {
+  Instruction *I = dyn_cast<Instruction>(V);
+  return !I || DT.dominates(I, InsertPt);
+}
+
+} // namespace
+
+bool DxilCoalesceCBufferLoads::coalesce(SmallVectorImpl<CallInst *> &Loads,
+                                        DominatorTree &DT) {
+  bool bUpdated = false;
+
+  // Loads are in dominator tree preorder, so any load that dominates another
+  // comes first.
+  SmallVector<CallInst *, 4> Leaders;
+  for (CallInst *CI : Loads) {
+    CallInst *Leader = nullptr;
+    for (CallInst *L : Leaders) {
+      if (DT.dominates(L, CI)) {
+        Leader = L;
+        break;
+      }
+    }
+    if (Leader) {
+      CI->replaceAllUsesWith(Leader);
+      CI->eraseFromParent();
+      bUpdated = true;
+    } else {
+      Leaders.push_back(CI);
+    }
+  }
+  if (Leaders.size() < 2)
+    return bUpdated;
+
+  // Only hoist constant rows: a computed row might not be valid on paths
+  // that did not load it.
+  DxilInst_CBufferLoadLegacy first(Leaders[0]);
+  if (!isa<Constant>(first.get_regIndex()))
+    return bUpdated;
+
+  BasicBlock *Dom = Leaders[0]->getParent();
+  for (CallInst *L : Leaders)
+    Dom = DT.findNearestCommonDominator(Dom, L->getParent());
+  Instruction *InsertPt = Dom->getTerminator();
+
+  Value *Handle = nullptr;
+  for (CallInst *L : Leaders) {
+    Value *H = DxilInst_CBufferLoadLegacy(L).get_handle();
+    if (IsAvailableAt(H, InsertPt, DT)) {
+      Handle = H;
+      break;
+    }
+  }
+  if (!Handle)
+    return bUpdated;
+
+  CallInst *Hoisted = cast<CallInst>(Leaders[0]->clone());
+  Hoisted->setArgOperand(DxilInst_CBufferLoadLegacy::arg_handle, Handle);
+  Hoisted->setDebugLoc(DebugLoc());
+  Hoisted->insertBefore(InsertPt);
+  for (CallInst *L : Leaders) {
+    L->replaceAllUsesWith(Hoisted);
+    L->eraseFromParent();
+  }
+  return true;
+}
+
+bool DxilCoalesceCBufferLoads::runOnFunction(Function &F) {
+  DominatorTree &DT = getAnalysis<DominatorTreeWrapperPass>().getDomTree();
+
+  // (buffer, row, overload) -> loads, in dominator tree preorder.
+  typedef std::pair<std::pair<Value *, Value *>, Type *> LoadKey;
+  MapVector<LoadKey, SmallVector<CallInst *, 4>> Groups;
+  for (DomTreeNode *Node : depth_first(DT.getRootNode())) {
+    for (Instruction &I : *Node->getBlock()) {
+      CallInst *CI = dyn_cast<CallInst>(&I);
+      if (!CI || !OP::IsDxilOpFuncCallInst(CI, OP::OpCode::CBufferLoadLegacy))
+        continue;
+      DxilInst_CBufferLoadLegacy load(CI);
+      Value *Buffer = dxilutil::GetBufferKeyForHandle(load.get_handle());
+      LoadKey Key(std::make_pair(Buffer, load.get_regIndex()), CI->getType());
+      Groups[Key].push_back(CI);
+    }
+  }
+
+  bool bUpdated = false;
+  for (auto &Group : Groups) {
+    if (Group.second.size() > 1)
+      bUpdated |= coalesce(Group.second, DT);
+  }
+  return bUpdated;
+}
+
+FunctionPass *llvm::createDxilCoalesceCBufferLoadsPass() {
+  return new DxilCoalesceCBufferLoads();
+}
+
+INITIALIZE_PASS_BEGIN(DxilCoalesceCBufferLoads, "dxil-coalesce-cbuffer-loads",
+                      "DXIL coalesce cbuffer loads", false, false)
+INITIALIZE_PASS_DEPENDENCY(DominatorTreeWrapperPass)
+INITIALIZE_PASS_END(DxilCoalesceCBufferLoads, "dxil-coalesce-cbuffer-loads",
+                    "DXIL coalesce cbuffer loads", false, false)
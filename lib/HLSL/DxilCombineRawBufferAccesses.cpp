@@ -0,0 +1,436 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// DxilCombineRawBufferAccesses.cpp                                          //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Merges RawBufferLoad/RawBufferStore calls that access adjacent elements   //
+// of the same raw or structured buffer into masked vector accesses.         //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#include "dxc/HLSL/DxilGenerationPass.h"
+#include "dxc/DXIL/DxilModule.h"
+#include "dxc/DXIL/DxilOperations.h"
+#include "dxc/DXIL/DxilInstructions.h"
+#include "dxc/DXIL/DxilUtil.h"
+#include "dxc/DXIL/DxilResourceProperties.h"
+
+#include "llvm/ADT/MapVector.h"
+#include "llvm/Analysis/ValueTracking.h"
+#include "llvm/IR/GlobalVariable.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/Module.h"
+
+using namespace llvm;
+using namespace hlsl;
+
+// Scalarization leaves one RawBufferLoad or RawBufferStore per component, so
+//   float a = sb[i].x;
+//   float b = sb[i].y;
+// reads the buffer twice, with element offsets 0 and 4. This pass merges
+// accesses to the same buffer, index and overload whose offsets differ by a
+// multiple of the component size into one access of up to four components:
+//   - loads are merged within a block until something writes memory, and
+//     the merged load takes the place of the first one;
+//   - stores are merged while they follow each other with no other memory
+//     access in between, and the merged store takes the place of the last.
+// The merged access uses the alignment of the access at the lowest offset.
+// Loads whose status is used are left alone, since a merged status would
+// also reflect the other components, and so are accesses to globallycoherent
+// UAVs, whose ordering with other threads must not change.
+// DxilTranslateRawBuffer runs afterwards, so the merged accesses are still
+// lowered to BufferLoad/BufferStore or split for older DXIL versions.
+// Disabled with -opt-disable combine-raw-buffer-accesses.
+namespace {
+class DxilCombineRawBufferAccesses : public FunctionPass {
+public:
+  static char ID; // Pass identification, replacement for typeid
+  explicit DxilCombineRawBufferAccesses() : FunctionPass(ID) {}
+
+  StringRef getPassName() const override {
+    return "DXIL combine raw buffer accesses";
+  }
+
+  void getAnalysisUsage(AnalysisUsage &AU) const override {
+    AU.setPreservesCFG();
+  }
+
+  bool runOnFunction(Function &F) override;
+
+private:
+  // (buffer, index, offset base), overload.
+  typedef std::pair<std::pair<Value *, Value *>, std::pair<Value *, Type *>>
+      AccessKey;
+
+  struct Access {
+    CallInst *CI;
+    int64_t Offset;    // Constant part of the byte offset.
+    unsigned Mask;
+    unsigned Alignment;
+  };
+
+  bool getAccess(CallInst *CI, bool bStore, AccessKey &Key, Access &A);
+  bool fitsWindow(const Access &A, int64_t MinOffset, const AccessKey &Key) {
+    const int64_t CompSize = m_DL->getTypeAllocSize(Key.second.second);
+    int64_t Delta = A.Offset - MinOffset;
+    return Delta % CompSize == 0 && Delta / CompSize < 4 &&
+           ((A.Mask << (Delta / CompSize)) & ~DXIL::kCompMask_All) == 0;
+  }
+  bool isGloballyCoherent(Value *Handle);
+  bool combineLoads(const AccessKey &Key, SmallVectorImpl<Access> &Loads);
+  bool combineStores(const AccessKey &Key, ArrayRef<Access> Stores);
+
+  DxilModule *m_DM = nullptr;
+  const DataLayout *m_DL = nullptr;
+  DenseMap<Value *, bool> m_CoherentHandles;
+  // Library UAVs by global symbol, built on first use.
+  DenseMap<Value *, DxilResource *> m_UAVsBySymbol;
+};
+
+char DxilCombineRawBufferAccesses::ID = 0;
+
+// Split an offset into Base + Offset, with Base null for constants.
+void DecomposeOffset(Value *V, const DataLayout &DL, Value *&Base,
+                     int64_t &Offset) {
+  Base = V;
+  Offset = 0;
+  if (ConstantInt *C = dyn_cast<ConstantInt>(V)) {
+    Base = nullptr;
+    Offset = C->getSExtValue();
+    return;
+  }
+  BinaryOperator *BO = dyn_cast<BinaryOperator>(V);
+  if (!BO)
+    return;
+  ConstantInt *C = dyn_cast<ConstantInt>(BO->getOperand(1));
+  if (!C)
+    return;
+  Value *LHS = BO->getOperand(0);
+  switch (BO->getOpcode()) {
+  case Instruction::Add:
+    break;
+  case Instruction::Or:
+    // Address computations fold base + small constant into an or when the
+    // low bits of the base are known to be zero.
+    if (!MaskedValueIsZero(LHS, C->getValue(), DL))
+      return;
+    break;
+  default:
+    return;
+  }
+  Base = LHS;
+  Offset = C->getSExtValue();
+}
+
+Value *GetOffsetValue(IRBuilder<> &B, Value *Base, int64_t Offset) {
+  if (!Base)
+    return B.getInt32(Offset);
+  if (Offset == 0)
+    return Base;
+  return B.CreateAdd(Base, B.getInt32(Offset));
+}
+
+} // namespace
+
+bool DxilCombineRawBufferAccesses::isGloballyCoherent(Value *Handle) {
+  auto It = m_CoherentHandles.find(Handle);
+  if (It != m_CoherentHandles.end())
+    return It->second;
+
+  // Anything not traced back to a resource is treated as coherent.
+  bool bCoherent = true;
+  if (CallInst *CI = dyn_cast<CallInst>(Handle)) {
+    if (OP::IsDxilOpFuncCallInst(CI, OP::OpCode::AnnotateHandle)) {
+      DxilInst_AnnotateHandle annotateHandle(CI);
+      DxilResourceProperties RP = resource_helper::loadPropsFromAnnotateHandle(
+          annotateHandle, *m_DM->GetShaderModel());
+      bCoherent = RP.getResourceClass() == DXIL::ResourceClass::Invalid ||
+                  RP.Basic.IsGloballyCoherent;
+    } else if (OP::IsDxilOpFuncCallInst(CI, OP::OpCode::CreateHandle)) {
+      DxilInst_CreateHandle createHandle(CI);
+      ConstantInt *ResClass =
+          dyn_cast<ConstantInt>(createHandle.get_resourceClass());
+      ConstantInt *RangeID = dyn_cast<ConstantInt>(createHandle.get_rangeId());
+      if (ResClass && RangeID) {
+        DXIL::ResourceClass RC =
+            static_cast<DXIL::ResourceClass>(ResClass->getLimitedValue());
+        if (RC == DXIL::ResourceClass::SRV)
+          bCoherent = false;
+        else if (RC == DXIL::ResourceClass::UAV &&
+                 RangeID->getLimitedValue() < m_DM->GetUAVs().size())
+          bCoherent =
+              m_DM->GetUAV(RangeID->getLimitedValue()).IsGloballyCoherent();
+      }
+    } else if (OP::IsDxilOpFuncCallInst(CI, OP::OpCode::CreateHandleForLib)) {
+      Value *GV = dxilutil::GetBufferKeyForHandle(CI);
+      if (GV != CI) {
+        if (m_UAVsBySymbol.empty()) {
+          for (auto &UAV : m_DM->GetUAVs())
+            m_UAVsBySymbol.insert({UAV->GetGlobalSymbol(), UAV.get()});
+        }
+        auto UAVIt = m_UAVsBySymbol.find(GV);
+        bCoherent = UAVIt != m_UAVsBySymbol.end() &&
+                    UAVIt->second->IsGloballyCoherent();
+      }
+    }
+  }
+  m_CoherentHandles[Handle] = bCoherent;
+  return bCoherent;
+}
+
+bool DxilCombineRawBufferAccesses::getAccess(CallInst *CI, bool bStore,
+                                             AccessKey &Key, Access &A) {
+  Value *Handle, *Index, *ElementOffset, *Mask, *Alignment;
+  Type *Ty;
+  if (bStore) {
+    DxilInst_RawBufferStore store(CI);
+    Handle = store.get_uav();
+    Index = store.get_index();
+    ElementOffset = store.get_elementOffset();
+    Mask = store.get_mask();
+    Alignment = store.get_alignment();
+    Ty = store.get_value0()->getType();
+  } else {
+    DxilInst_RawBufferLoad load(CI);
+    Handle = load.get_srv();
+    Index = load.get_index();
+    ElementOffset = load.get_elementOffset();
+    Mask = load.get_mask();
+    Alignment = load.get_alignment();
+    Ty = CI->getType()->getStructElementType(0);
+    // Only merge loads whose components are read with extractvalue, and
+    // whose status is unused.
+    for (User *U : CI->users()) {
+      ExtractValueInst *EV = dyn_cast<ExtractValueInst>(U);
+      if (!EV || EV->getNumIndices() != 1 ||
+          EV->getIndices()[0] >= DXIL::kResRetStatusIndex)
+        return false;
+    }
+  }
+
+  ConstantInt *MaskC = dyn_cast<ConstantInt>(Mask);
+  ConstantInt *AlignC = dyn_cast<ConstantInt>(Alignment);
+  if (!MaskC || !AlignC || isGloballyCoherent(Handle))
+    return false;
+
+  // Raw buffers address with the index, structured buffers with the offset
+  // within the element.
+  Value *Buffer = dxilutil::GetBufferKeyForHandle(Handle);
+  Value *Base;
+  int64_t Offset;
+  if (isa<UndefValue>(ElementOffset)) {
+    DecomposeOffset(Index, *m_DL, Base, Offset);
+    Key = AccessKey(std::make_pair(Buffer, Base),
+                    std::make_pair(ElementOffset, Ty));
+  } else {
+    DecomposeOffset(ElementOffset, *m_DL, Base, Offset);
+    Key = AccessKey(std::make_pair(Buffer, Index), std::make_pair(Base, Ty));
+  }
+  A.CI = CI;
+  A.Offset = Offset;
+  A.Mask = MaskC->getLimitedValue() & DXIL::kCompMask_All;
+  A.Alignment = AlignC->getLimitedValue();
+  return A.Mask != 0;
+}
+
+
+bool DxilCombineRawBufferAccesses::combineLoads(const AccessKey &Key,
+                                                SmallVectorImpl<Access> &Loads) {
+  const int64_t CompSize = m_DL->getTypeAllocSize(Key.second.second);
+  bool bUpdated = false;
+
+  // Merge the loads that fit in the four components above the lowest offset
+  // left, then repeat with the ones that did not fit.
+  while (Loads.size() > 1) {
+    int64_t MinOffset = Loads[0].Offset;
+    for (Access &A : Loads)
+      MinOffset = std::min(MinOffset, A.Offset);
+
+    SmallVector<Access, 4> Window, Rest;
+    unsigned Mask = 0;
+    unsigned Alignment = 0;
+    for (Access &A : Loads) {
+      int64_t Delta = A.Offset - MinOffset;
+      if (!fitsWindow(A, MinOffset, Key)) {
+        Rest.push_back(A);
+        continue;
+      }
+      Window.push_back(A);
+      Mask |= A.Mask << (Delta / CompSize);
+      if (Delta == 0)
+        Alignment = Alignment ? std::min(Alignment, A.Alignment) : A.Alignment;
+    }
+
+    if (Window.size() > 1) {
+      // Loads are in block order, so the merged load goes where the first
+      // one was, and the operands it shares with the others are available.
+      CallInst *First = Window[0].CI;
+      IRBuilder<> B(First);
+      SmallVector<Value *, 6> Args(First->arg_operands());
+      if (isa<UndefValue>(DxilInst_RawBufferLoad(First).get_elementOffset()))
+        Args[DxilInst_RawBufferLoad::arg_index] =
+            GetOffsetValue(B, Key.first.second, MinOffset);
+      else
+        Args[DxilInst_RawBufferLoad::arg_elementOffset] =
+            GetOffsetValue(B, Key.second.first, MinOffset);
+      Args[DxilInst_RawBufferLoad::arg_mask] = B.getInt8(Mask);
+      Args[DxilInst_RawBufferLoad::arg_alignment] = B.getInt32(Alignment);
+      CallInst *Merged = B.CreateCall(First->getCalledFunction(), Args);
+      Merged->setDebugLoc(First->getDebugLoc());
+
+      for (Access &A : Window) {
+        unsigned Shift = (A.Offset - MinOffset) / CompSize;
+        for (auto It = A.CI->user_begin(); It != A.CI->user_end();) {
+          ExtractValueInst *EV = cast<ExtractValueInst>(*(It++));
+          B.SetInsertPoint(EV);
+          Value *NewEV =
+              B.CreateExtractValue(Merged, EV->getIndices()[0] + Shift);
+          NewEV->takeName(EV);
+          EV->replaceAllUsesWith(NewEV);
+          EV->eraseFromParent();
+        }
+        A.CI->eraseFromParent();
+      }
+      bUpdated = true;
+    }
+    Loads.clear();
+    Loads.append(Rest.begin(), Rest.end());
+  }
+  return bUpdated;
+}
+
+bool DxilCombineRawBufferAccesses::combineStores(const AccessKey &Key,
+                                                 ArrayRef<Access> Stores) {
+  if (Stores.size() < 2)
+    return false;
+  const int64_t CompSize = m_DL->getTypeAllocSize(Key.second.second);
+  int64_t MinOffset = Stores[0].Offset;
+  for (const Access &A : Stores)
+    MinOffset = std::min(MinOffset, A.Offset);
+
+  // Stores are in block order, so later ones overwrite earlier ones.
+  Value *Values[4] = {nullptr, nullptr, nullptr, nullptr};
+  unsigned Mask = 0;
+  unsigned Alignment = 0;
+  for (const Access &A : Stores) {
+    int64_t Delta = A.Offset - MinOffset;
+    unsigned Shift = Delta / CompSize;
+    for (unsigned i = 0; i < 4; ++i) {
+      if (A.Mask & (1 << i))
+        Values[Shift + i] =
+            A.CI->getArgOperand(DxilInst_RawBufferStore::arg_value0 + i);
+    }
+    Mask |= A.Mask << Shift;
+    if (Delta == 0)
+      Alignment = Alignment ? std::min(Alignment, A.Alignment) : A.Alignment;
+  }
+
+  // Every stored value is available at the last store.
+  CallInst *Last = Stores.back().CI;
+  IRBuilder<> B(Last);
+  SmallVector<Value *, 10> Args(Last->arg_operands());
+  if (isa<UndefValue>(DxilInst_RawBufferStore(Last).get_elementOffset()))
+    Args[DxilInst_RawBufferStore::arg_index] =
+        GetOffsetValue(B, Key.first.second, MinOffset);
+  else
+    Args[DxilInst_RawBufferStore::arg_elementOffset] =
+        GetOffsetValue(B, Key.second.first, MinOffset);
+  for (unsigned i = 0; i < 4; ++i)
+    Args[DxilInst_RawBufferStore::arg_value0 + i] =
+        Values[i] ? Values[i] : UndefValue::get(Key.second.second);
+  Args[DxilInst_RawBufferStore::arg_mask] = B.getInt8(Mask);
+  Args[DxilInst_RawBufferStore::arg_alignment] = B.getInt32(Alignment);
+  CallInst *Merged = B.CreateCall(Last->getCalledFunction(), Args);
+  Merged->setDebugLoc(Last->getDebugLoc());
+
+  for (const Access &A : Stores)
+    A.CI->eraseFromParent();
+  return true;
+}
+
+bool DxilCombineRawBufferAccesses::runOnFunction(Function &F) {
+  Module *M = F.getParent();
+  if (!M->HasDxilModule())
+    return false;
+  m_DM = &M->GetDxilModule();
+  m_DL = &M->getDataLayout();
+  m_CoherentHandles.clear();
+  m_UAVsBySymbol.clear();
+
+  typedef SmallVector<Access, 4> AccessList;
+  bool bUpdated = false;
+  for (BasicBlock &BB : F) {
+    // Collect the runs for the whole block before changing it.
+    SmallVector<std::pair<AccessKey, AccessList>, 8> LoadRuns, StoreRuns;
+    MapVector<AccessKey, AccessList> OpenLoads;
+    AccessKey StoreKey;
+    AccessList OpenStores;
+
+    auto closeLoads = [&]() {
+      for (auto &Group : OpenLoads)
+        if (Group.second.size() > 1)
+          LoadRuns.emplace_back(Group.first, std::move(Group.second));
+      OpenLoads.clear();
+    };
+    auto closeStores = [&]() {
+      if (OpenStores.size() > 1)
+        StoreRuns.emplace_back(StoreKey, OpenStores);
+      OpenStores.clear();
+    };
+    // Whether the stores in the run and A all fit in four components.
+    auto fitsStores = [&](const Access &A) {
+      int64_t MinOffset = A.Offset;
+      for (const Access &S : OpenStores)
+        MinOffset = std::min(MinOffset, S.Offset);
+      if (!fitsWindow(A, MinOffset, StoreKey))
+        return false;
+      for (const Access &S : OpenStores)
+        if (!fitsWindow(S, MinOffset, StoreKey))
+          return false;
+      return true;
+    };
+
+    for (Instruction &I : BB) {
+      if (!I.mayReadOrWriteMemory())
+        continue;
+      CallInst *CI = dyn_cast<CallInst>(&I);
+      AccessKey Key;
+      Access A;
+      if (CI && OP::IsDxilOpFuncCallInst(CI, OP::OpCode::RawBufferLoad)) {
+        closeStores();
+        if (getAccess(CI, /*bStore*/ false, Key, A))
+          OpenLoads[Key].push_back(A);
+        continue;
+      }
+      if (I.mayWriteToMemory())
+        closeLoads();
+      if (CI && OP::IsDxilOpFuncCallInst(CI, OP::OpCode::RawBufferStore) &&
+          getAccess(CI, /*bStore*/ true, Key, A)) {
+        if (!OpenStores.empty() && (Key != StoreKey || !fitsStores(A)))
+          closeStores();
+        StoreKey = Key;
+        OpenStores.push_back(A);
+        continue;
+      }
+      closeStores();
+    }
+    closeLoads();
+    closeStores();
+
+    for (auto &Run : LoadRuns)
+      bUpdated |= combineLoads(Run.first, Run.second);
+    for (auto &Run : StoreRuns)
+      bUpdated |= combineStores(Run.first, Run.second);
+  }
+  return bUpdated;
+}
+
+FunctionPass *llvm::createDxilCombineRawBufferAccessesPass() {
+  return new DxilCombineRawBufferAccesses();
+}
+
+INITIALIZE_PASS(DxilCombineRawBufferAccesses, "dxil-combine-raw-buffer-accesses",
+                "DXIL combine raw buffer accesses", false, false)
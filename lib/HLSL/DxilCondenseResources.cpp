@@ -459,17 +459,21 @@ static bool LegalizeResources(Module &M, DxilValueCache *DVC) {
   }
 
   // Simple DCE
+  // Erased instructions may still be on the worklist; remember them so they
+  // are skipped when popped, instead of searching the whole worklist on every
+  // erase. Nothing is allocated here, so an erased address is never reused.
+  SmallPtrSet<Instruction *, 8> Erased;
   while (DCEWorklist.size()) {
     Instruction *I = DCEWorklist.back();
     DCEWorklist.pop_back();
+    if (Erased.count(I))
+      continue;
     if (llvm::isInstructionTriviallyDead(I)) {
       for (Use &Op : I->operands())
         if (Instruction *OpI = dyn_cast<Instruction>(Op.get()))
           DCEWorklist.push_back(OpI);
       I->eraseFromParent();
-      // Remove the instruction from the worklist if it still exists in it.
-      DCEWorklist.erase(std::remove(DCEWorklist.begin(), DCEWorklist.end(), I),
-                     DCEWorklist.end());
+      Erased.insert(I);
       Changed = true;
     }
   }
@@ -477,6 +481,8 @@ static bool LegalizeResources(Module &M, DxilValueCache *DVC) {
   return Changed;
 }
 
+static void UpdateCBufferUsage(DxilModule &DM);
+
 namespace {
 class DxilLowerCreateHandleForLib : public ModulePass {
 private:
@@ -558,7 +564,7 @@ public:
     bChanged |= ResourceRegisterAllocator.AllocateRegisters(DM);
 
     // Fill in top-level CBuffer variable usage bit
-    UpdateCBufferUsage();
+    UpdateCBufferUsage(DM);
 
     if (m_bIsLib && DM.GetShaderModel()->GetMinor() == ShaderModel::kOfflineMinor)
       return bChanged;
@@ -616,7 +622,6 @@ private:
   bool PatchDynamicTBuffers(DxilModule &DM);
   bool PatchTBuffers(DxilModule &DM);
   void PatchTBufferUse(Value *V, DxilModule &DM, DenseSet<Value *> &patchedSet);
-  void UpdateCBufferUsage();
   void SetNonUniformIndexForDynamicResource(DxilModule &DM);
   void RemoveCreateHandleFromHandle(DxilModule &DM);
 };
@@ -1894,8 +1899,10 @@ bool UpdateStructTypeForLegacyLayoutOnDM(DxilModule &DM) {
 
 void DxilLowerCreateHandleForLib::FailOnPoisonResources() {
   // A previous pass replaced all undef resources with constant zero resources.
-  // If those made it here, the program is malformed.
-  for (Function &Func : this->m_DM->GetModule()->functions()) {
+  // If those made it here, the program is malformed. The constant can also be
+  // used by other modules of the context, which are not reported.
+  Module *M = m_DM->GetModule();
+  for (Function &Func : M->functions()) {
     hlsl::OP::OpCodeClass OpcodeClass;
     if (m_DM->GetOP()->GetOpCodeClass(&Func, OpcodeClass)
       && OpcodeClass == OP::OpCodeClass::CreateHandleForLib) {
@@ -1904,7 +1911,8 @@ void DxilLowerCreateHandleForLib::FailOnPoisonResources() {
       Constant *PoisonRes = ConstantAggregateZero::get(ResTy);
       for (User *PoisonUser : PoisonRes->users())
         if (Instruction *PoisonUserInst = dyn_cast<Instruction>(PoisonUser))
-          dxilutil::EmitResMappingError(PoisonUserInst);
+          if (PoisonUserInst->getModule() == M)
+            dxilutil::EmitResMappingError(PoisonUserInst);
     }
   }
 }
@@ -2125,22 +2133,23 @@ void DxilLowerCreateHandleForLib::TranslateDxilResourceUses(
                                    ? DxilInst_CreateHandleFromBinding::arg_nonUniformIndex
                                    : DxilInst_CreateHandle::arg_nonUniformIndex;
 
-
-
-
-  for (iplist<Function>::iterator F : pM->getFunctionList()) {
-    if (!F->isDeclaration()) {
-      if (!isResArray) {
-        IRBuilder<> Builder(dxilutil::FindAllocaInsertionPt(F));
-        if (m_HasDbgInfo) {
-          // TODO: set debug info.
-          // Builder.SetCurrentDebugLocation(DL);
-        }
-        handleMapOnFunction[F] =
-            Builder.CreateCall(createHandle, Args, handleName);
-      }
-    }
-  }
+  // Create the handle of a non-array resource the first time a function
+  // loads it, rather than up front in every function of the module, so the
+  // cost is proportional to the uses instead of resources times functions.
+  auto GetHandleOnFunction = [&](Function *F) -> Instruction * {
+    Instruction *&handle = handleMapOnFunction[F];
+    if (!handle) {
+      IRBuilder<> Builder(dxilutil::FindAllocaInsertionPt(F));
+      if (m_HasDbgInfo) {
+        // TODO: set debug info.
+        // Builder.SetCurrentDebugLocation(DL);
+      }
+      Args[resIdxOpIdx] = resLowerBound;
+      Args[nonUniformOpIdx] = isUniformRes;
+      handle = Builder.CreateCall(createHandle, Args, handleName);
+    }
+    return handle;
+  };
 
   for (auto U = GV->user_begin(), E = GV->user_end(); U != E;) {
     User *user = *(U++);
@@ -2149,9 +2158,9 @@ void DxilLowerCreateHandleForLib::TranslateDxilResourceUses(
       continue;
 
     if (LoadInst *ldInst = dyn_cast<LoadInst>(user)) {
+      DXASSERT(!isResArray, "load of resource array must go through GEP");
       Function *userF = ldInst->getParent()->getParent();
-      DXASSERT(handleMapOnFunction.count(userF), "must exist");
-      Instruction *handle = handleMapOnFunction[userF];
+      Instruction *handle = GetHandleOnFunction(userF);
       ReplaceResourceUserWithHandle(static_cast<DxilResource &>(res), ldInst, handle);
     } else if (GEPOperator *GEP = dyn_cast<GEPOperator>(user)) {
       Value *idx = flattenGepIdx(GEP);
@@ -2653,11 +2662,11 @@ static void CollectCBufferMemberUsage(Value *V,
   }
 }
 
-void DxilLowerCreateHandleForLib::UpdateCBufferUsage() {
-  DxilTypeSystem &TypeSys = m_DM->GetTypeSystem();
-  hlsl::OP *hlslOP = m_DM->GetOP();
-  const DataLayout &DL = m_DM->GetModule()->getDataLayout();
-  const auto &CBuffers = m_DM->GetCBuffers();
+static void UpdateCBufferUsage(DxilModule &DM) {
+  DxilTypeSystem &TypeSys = DM.GetTypeSystem();
+  hlsl::OP *hlslOP = DM.GetOP();
+  const DataLayout &DL = DM.GetModule()->getDataLayout();
+  const auto &CBuffers = DM.GetCBuffers();
   OffsetForValueMap visited;
 
   SmallVector<std::pair<GlobalVariable*, Type*>, 4> CBufferVars;
@@ -2672,7 +2681,7 @@ void DxilLowerCreateHandleForLib::UpdateCBufferUsage() {
   }
 
   // Collect tbuffers
-  for (auto &it : m_DM->GetSRVs()) {
+  for (auto &it : DM.GetSRVs()) {
     if (it->GetKind() != DXIL::ResourceKind::TBuffer)
       continue;
     GlobalVariable *GV = dyn_cast<GlobalVariable>(it->GetGlobalSymbol());
@@ -2705,7 +2714,7 @@ void DxilLowerCreateHandleForLib::UpdateCBufferUsage() {
       legacyFieldMap[FA.GetCBufferOffset()] = &FA;
       newFieldMap[(unsigned)SL->getElementOffset(i)] = &FA;
     }
-    CollectCBufferMemberUsage(GV, legacyFieldMap, newFieldMap, hlslOP, m_DM->GetUseMinPrecision(), visited);
+    CollectCBufferMemberUsage(GV, legacyFieldMap, newFieldMap, hlslOP, DM.GetUseMinPrecision(), visited);
  }
 }
 
@@ -2804,6 +2813,42 @@ ModulePass *llvm::createDxilAllocateResourcesForLibPass() {
 
 INITIALIZE_PASS(DxilAllocateResourcesForLib, "hlsl-dxil-allocate-resources-for-lib", "DXIL Allocate Resources For Library", false, false)
 
+namespace {
+
+// Libraries keep resources as global symbols after lowering. When functions
+// are removed later, as the linker does for functions left out of an export
+// list, this drops the resources nothing uses any more and recomputes which
+// cbuffer members are used, so reflection, PSV and RDAT only describe what
+// the remaining code reads. Shaders drop unused resources while lowering.
+class DxilRemoveUnusedResources : public ModulePass {
+public:
+  static char ID; // Pass identification, replacement for typeid
+  explicit DxilRemoveUnusedResources() : ModulePass(ID) {}
+
+  StringRef getPassName() const override { return "DXIL Remove Unused Resources"; }
+
+  bool runOnModule(Module &M) override {
+    DxilModule &DM = M.GetOrCreateDxilModule();
+    if (!DM.GetShaderModel()->IsLib())
+      return false;
+
+    DM.RemoveResourcesWithUnusedSymbols();
+    // Usage flags may be cleared even when no resource goes away.
+    UpdateCBufferUsage(DM);
+    return true;
+  }
+};
+
+char DxilRemoveUnusedResources::ID = 0;
+
+}
+
+ModulePass *llvm::createDxilRemoveUnusedResourcesPass() {
+  return new DxilRemoveUnusedResources();
+}
+
+INITIALIZE_PASS(DxilRemoveUnusedResources, "hlsl-dxil-remove-unused-resources", "DXIL Remove Unused Resources", false, false)
+
 
 namespace {
 struct CreateHandleFromHeapArgs {
@@ -14,6 +14,8 @@
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/InstIterator.h"
 #include "llvm/IR/Operator.h"
+#include "llvm/Support/MD5.h"
+#include "llvm/Support/raw_ostream.h"
 #include "dxc/DxilContainer/DxilContainer.h"
 #include "dxc/DXIL/DxilModule.h"
 #include "dxc/DXIL/DxilShaderModel.h"
@@ -31,6 +33,11 @@
 #include "dxc/HLSL/HLMatrixType.h"
 #include "dxc/DXIL/DxilCounters.h"
 
+#include <deque>
+#include <list>
+#include <mutex>
+#include <tuple>
+#include <unordered_map>
 #include <unordered_set>
 #include "llvm/ADT/SetVector.h"
 
@@ -85,6 +92,37 @@ public:
 class CShaderReflectionConstantBuffer;
 class CShaderReflectionType;
 
+// Owns the reflection types of a module. Types with the same layout are
+// created once and shared by every variable and member that uses them.
+class CShaderReflectionTypeTable {
+public:
+  CShaderReflectionTypeTable();
+
+  // Type returned when no type information is available.
+  CShaderReflectionType *GetEmpty() { return &m_Types.front(); }
+
+  // Get the shared reflection type for a type and its annotation.
+  CShaderReflectionType *Get(DxilModule &M, llvm::Type *type,
+                             DxilFieldAnnotation &typeAnnotation,
+                             unsigned baseOffset, bool isCBuffer);
+
+  // Create a reflection type that is not shared, for callers that modify it.
+  CShaderReflectionType *Create(DxilModule &M, llvm::Type *type,
+                                DxilFieldAnnotation &typeAnnotation,
+                                unsigned baseOffset, bool isCBuffer);
+
+private:
+  // Everything CShaderReflectionType::Initialize reads: the type, whether it
+  // is laid out in a cbuffer, its resulting offset, component type and
+  // matrix annotation.
+  typedef std::tuple<llvm::Type *, bool, unsigned, unsigned, bool, unsigned,
+                     unsigned, unsigned>
+      TypeKey;
+  // Allocated in chunks, and never moved once created.
+  std::deque<CShaderReflectionType> m_Types;
+  std::map<TypeKey, CShaderReflectionType *> m_TypesByKey;
+};
+
 enum class PublicAPI { D3D12 = 0, D3D11_47 = 1, D3D11_43 = 2 };
 
 #ifdef ADD_16_64_BIT_TYPES
@@ -106,7 +144,7 @@ public:
   bool m_bUsageInMetadata = false;
   std::vector<std::unique_ptr<CShaderReflectionConstantBuffer>>    m_CBs;
   std::vector<D3D12_SHADER_INPUT_BIND_DESC>       m_Resources;
-  std::vector<std::unique_ptr<CShaderReflectionType>> m_Types;
+  CShaderReflectionTypeTable m_Types;
 
   // Key strings owned by CShaderReflectionConstantBuffer objects
   std::map<StringRef, UINT> m_CBsByName;
@@ -317,6 +355,127 @@ HRESULT CreateDxilShaderOrLibraryReflectionFromModulePart(const DxilPartHeader *
   return CreateDxilShaderOrLibraryReflectionFromProgramHeader(pProgramHeader, pRDATPart, iid, ppvObject);
 }
 
+namespace {
+// Reflection objects shared by the whole process, by key. The least recently
+// used objects are released first once there are more than MaxEntries.
+class ReflectionCache {
+public:
+  static ReflectionCache &Get() {
+    // Never destroyed: releasing the objects at exit could call into an
+    // allocator that is already gone.
+    static ReflectionCache *pCache = new ReflectionCache();
+    return *pCache;
+  }
+
+  bool IsEnabled() {
+    std::lock_guard<std::mutex> Lock(m_Mutex);
+    return m_MaxEntries != 0;
+  }
+
+  void SetMaxEntries(unsigned MaxEntries) {
+    std::lock_guard<std::mutex> Lock(m_Mutex);
+    m_MaxEntries = MaxEntries;
+    Trim();
+  }
+
+  void Flush() {
+    std::lock_guard<std::mutex> Lock(m_Mutex);
+    m_EntriesByKey.clear();
+    m_Entries.clear();
+  }
+
+  bool Find(const std::string &Key, REFIID iid, void **ppvObject) {
+    std::lock_guard<std::mutex> Lock(m_Mutex);
+    auto it = m_EntriesByKey.find(Key);
+    if (it == m_EntriesByKey.end())
+      return false;
+    m_Entries.splice(m_Entries.begin(), m_Entries, it->second);
+    return SUCCEEDED(it->second->second->QueryInterface(iid, ppvObject));
+  }
+
+  void Add(const std::string &Key, IUnknown *pObject) {
+    std::lock_guard<std::mutex> Lock(m_Mutex);
+    if (m_MaxEntries == 0 || m_EntriesByKey.count(Key))
+      return;
+    m_Entries.emplace_front(Key, pObject);
+    m_EntriesByKey[Key] = m_Entries.begin();
+    Trim();
+  }
+
+private:
+  typedef std::pair<std::string, CComPtr<IUnknown>> Entry;
+  std::mutex m_Mutex;
+  unsigned m_MaxEntries = 0;
+  // Most recently used first.
+  std::list<Entry> m_Entries;
+  std::unordered_map<std::string, std::list<Entry>::iterator> m_EntriesByKey;
+
+  void Trim() {
+    while (m_Entries.size() > m_MaxEntries) {
+      m_EntriesByKey.erase(m_Entries.back().first);
+      m_Entries.pop_back();
+    }
+  }
+};
+
+// The shader hash, or the MD5 of the reflected parts when there is no HASH
+// part, followed by the kind and size of those parts and the interface.
+std::string GetReflectionCacheKey(const DxilPartHeader *pModulePart,
+                                  const DxilPartHeader *pRDATPart,
+                                  const DxilPartHeader *pHashPart,
+                                  REFIID iid) {
+  std::string Key;
+  raw_string_ostream OS(Key);
+  if (pHashPart && pHashPart->PartSize >= sizeof(DxilShaderHash)) {
+    OS.write(GetDxilPartData(pHashPart), sizeof(DxilShaderHash));
+  } else {
+    llvm::MD5 MD5;
+    MD5.update(ArrayRef<uint8_t>((const uint8_t *)GetDxilPartData(pModulePart),
+                                 pModulePart->PartSize));
+    if (pRDATPart)
+      MD5.update(ArrayRef<uint8_t>((const uint8_t *)GetDxilPartData(pRDATPart),
+                                   pRDATPart->PartSize));
+    llvm::MD5::MD5Result Digest;
+    MD5.final(Digest);
+    OS.write((const char *)Digest, sizeof(Digest));
+  }
+  for (const DxilPartHeader *pPart : {pModulePart, pRDATPart}) {
+    uint32_t Part[2] = {pPart ? pPart->PartFourCC : 0,
+                        pPart ? pPart->PartSize : 0};
+    OS.write((const char *)Part, sizeof(Part));
+  }
+  OS.write((const char *)&iid, sizeof(iid));
+  OS.flush();
+  return Key;
+}
+} // namespace
+
+HRESULT CreateDxilReflectionFromContainerParts(const DxilPartHeader *pModulePart, const DxilPartHeader *pRDATPart, const DxilPartHeader *pHashPart, REFIID iid, void **ppvObject) {
+  ReflectionCache &Cache = ReflectionCache::Get();
+  if (!pModulePart || !ppvObject || !Cache.IsEnabled())
+    return CreateDxilShaderOrLibraryReflectionFromModulePart(pModulePart, pRDATPart, iid, ppvObject);
+
+  std::string Key = GetReflectionCacheKey(pModulePart, pRDATPart, pHashPart, iid);
+  if (Cache.Find(Key, iid, ppvObject))
+    return S_OK;
+
+  void *pvObject = nullptr;
+  IFR(CreateDxilShaderOrLibraryReflectionFromModulePart(pModulePart, pRDATPart, iid, &pvObject));
+  CComPtr<IUnknown> pObject;
+  pObject.Attach((IUnknown *)pvObject);
+  Cache.Add(Key, pObject);
+  *ppvObject = pObject.Detach();
+  return S_OK;
+}
+
+void SetReflectionCacheSize(unsigned MaxEntries) {
+  ReflectionCache::Get().SetMaxEntries(MaxEntries);
+}
+
+void FlushReflectionCache() {
+  ReflectionCache::Get().Flush();
+}
+
 }
 
 _Use_decl_annotations_
@@ -433,7 +592,9 @@ HRESULT DxilContainerReflection::GetPartReflection(UINT32 idx, REFIID iid, void
   DxcThreadMalloc TM(m_pMalloc);
   HRESULT hr = S_OK;
 
-  IFC(hlsl::CreateDxilShaderOrLibraryReflectionFromModulePart(pPart, pRDATPart, iid, ppvObject));
+  IFC(hlsl::CreateDxilReflectionFromContainerParts(
+      pPart, pRDATPart, GetDxilPartByType(m_pHeader, DFCC_ShaderHash), iid,
+      ppvObject));
 
 Cleanup:
   return hr;
@@ -475,7 +636,7 @@ public:
     llvm::Type              *type,
     DxilFieldAnnotation     &typeAnnotation,
     unsigned int            baseOffset,
-    std::vector<std::unique_ptr<CShaderReflectionType>>& allTypes,
+    CShaderReflectionTypeTable &allTypes,
     bool                    isCBuffer);
 
   // ID3D12ShaderReflectionType
@@ -541,14 +702,14 @@ public:
 
   void Initialize(DxilModule &M,
                   DxilCBuffer &CB,
-                  std::vector<std::unique_ptr<CShaderReflectionType>>& allTypes,
+                  CShaderReflectionTypeTable &allTypes,
                   bool bUsageInMetadata);
   void InitializeStructuredBuffer(DxilModule &M,
                                   DxilResource &R,
-                                  std::vector<std::unique_ptr<CShaderReflectionType>>& allTypes);
+                                  CShaderReflectionTypeTable &allTypes);
   void InitializeTBuffer(DxilModule &M,
                          DxilResource &R,
-                         std::vector<std::unique_ptr<CShaderReflectionType>>& allTypes,
+                         CShaderReflectionTypeTable &allTypes,
                          bool bUsageInMetadata);
   LPCSTR GetName() { return m_Desc.Name; }
 
@@ -867,7 +1028,7 @@ HRESULT CShaderReflectionType::Initialize(
   llvm::Type              *inType,
   DxilFieldAnnotation     &typeAnnotation,
   unsigned int            baseOffset,
-  std::vector<std::unique_ptr<CShaderReflectionType>>& allTypes,
+  CShaderReflectionTypeTable &allTypes,
   bool                    isCBuffer)
 {
   DXASSERT_NOMSG(inType);
@@ -1146,12 +1307,9 @@ HRESULT CShaderReflectionType::Initialize(
           continue;
         }
 
-        fieldReflectionType = new CShaderReflectionType();
-        allTypes.push_back(std::unique_ptr<CShaderReflectionType>(fieldReflectionType));
-
         unsigned int elementOffset = structLayout ? (unsigned int)structLayout->getElementOffset(ff) : 0;
 
-        fieldReflectionType->Initialize(M, fieldType, fieldAnnotation, elementOffset, allTypes, isCBuffer);
+        fieldReflectionType = allTypes.Get(M, fieldType, fieldAnnotation, elementOffset, isCBuffer);
 
         m_MemberTypes.push_back(fieldReflectionType);
         m_MemberNames.push_back(fieldAnnotation.GetFieldName().c_str());
@@ -1248,11 +1406,50 @@ HRESULT CShaderReflectionType::Initialize(
   return S_OK;
 }
 
+CShaderReflectionTypeTable::CShaderReflectionTypeTable() {
+  // Add empty type for when no type info is available, instead of returning nullptr.
+  m_Types.emplace_back();
+  m_Types.back().InitializeEmpty();
+}
+
+CShaderReflectionType *CShaderReflectionTypeTable::Get(
+    DxilModule &M, llvm::Type *type, DxilFieldAnnotation &typeAnnotation,
+    unsigned baseOffset, bool isCBuffer) {
+  unsigned offset = isCBuffer ? typeAnnotation.GetCBufferOffset() - baseOffset
+                              : baseOffset;
+  bool hasMatrix = typeAnnotation.HasMatrixAnnotation();
+  unsigned orientation = 0, rows = 0, cols = 0;
+  if (hasMatrix) {
+    const DxilMatrixAnnotation &mat = typeAnnotation.GetMatrixAnnotation();
+    orientation = (unsigned)mat.Orientation;
+    rows = mat.Rows;
+    cols = mat.Cols;
+  }
+  TypeKey key(type, isCBuffer, offset,
+              (unsigned)typeAnnotation.GetCompType().GetKind(), hasMatrix,
+              orientation, rows, cols);
+  auto it = m_TypesByKey.find(key);
+  if (it != m_TypesByKey.end())
+    return it->second;
+  CShaderReflectionType *pType =
+      Create(M, type, typeAnnotation, baseOffset, isCBuffer);
+  m_TypesByKey[key] = pType;
+  return pType;
+}
+
+CShaderReflectionType *CShaderReflectionTypeTable::Create(
+    DxilModule &M, llvm::Type *type, DxilFieldAnnotation &typeAnnotation,
+    unsigned baseOffset, bool isCBuffer) {
+  m_Types.emplace_back();
+  CShaderReflectionType *pType = &m_Types.back();
+  pType->Initialize(M, type, typeAnnotation, baseOffset, *this, isCBuffer);
+  return pType;
+}
 
 void CShaderReflectionConstantBuffer::Initialize(
   DxilModule &M,
   DxilCBuffer &CB,
-  std::vector<std::unique_ptr<CShaderReflectionType>>& allTypes,
+  CShaderReflectionTypeTable &allTypes,
   bool bUsageInMetadata) {
   ZeroMemory(&m_Desc, sizeof(m_Desc));
   m_ReflectionName = CB.GetGlobalName();
@@ -1292,9 +1489,13 @@ void CShaderReflectionConstantBuffer::Initialize(
     VarDesc.uFlags = (bAllUsed || fieldAnnotation.IsCBVarUsed()) ? D3D_SVF_USED : 0;
     CShaderReflectionVariable Var;
     //Create reflection type.
-    CShaderReflectionType *pVarType = new CShaderReflectionType();
-    allTypes.push_back(std::unique_ptr<CShaderReflectionType>(pVarType));
-    pVarType->Initialize(M, ST->getContainedType(i), fieldAnnotation, fieldAnnotation.GetCBufferOffset(), allTypes, true);
+    // Elements is patched below for cbuffer arrays, so the type can't be
+    // shared in that case.
+    bool bPatchElements = CB.GetRangeSize() > 1 ||
+                          CB.GetHLSLType()->getPointerElementType()->isArrayTy();
+    CShaderReflectionType *pVarType = bPatchElements
+      ? allTypes.Create(M, ST->getContainedType(i), fieldAnnotation, fieldAnnotation.GetCBufferOffset(), true)
+      : allTypes.Get(M, ST->getContainedType(i), fieldAnnotation, fieldAnnotation.GetCBufferOffset(), true);
 
     // Replicate fxc bug, where Elements == 1 for inner struct of CB array, instead of 0.
     if (CB.GetRangeSize() > 1) {
@@ -1364,7 +1565,7 @@ static unsigned CalcResTypeSize(DxilModule &M, DxilResource &R) {
 void CShaderReflectionConstantBuffer::InitializeStructuredBuffer(
   DxilModule &M,
   DxilResource &R,
-  std::vector<std::unique_ptr<CShaderReflectionType>>& allTypes) {
+  CShaderReflectionTypeTable &allTypes) {
   ZeroMemory(&m_Desc, sizeof(m_Desc));
   m_ReflectionName = R.GetGlobalName();
   m_Desc.Type = D3D11_CT_RESOURCE_BIND_INFO;
@@ -1381,7 +1582,7 @@ void CShaderReflectionConstantBuffer::InitializeStructuredBuffer(
   CShaderReflectionVariable Var;
 
   // First type is an empty type: returned if no annotation available.
-  CShaderReflectionType *pVarType = allTypes[0].get();
+  CShaderReflectionType *pVarType = allTypes.GetEmpty();
 
   // Create reflection type, if we have the necessary annotation info
 
@@ -1403,15 +1604,12 @@ void CShaderReflectionConstantBuffer::InitializeStructuredBuffer(
   // Dxil from dxbc doesn't have annotation.
   if(annotation)
   {
-    // Actually create the reflection type.
-    pVarType = new CShaderReflectionType();
-    allTypes.push_back(std::unique_ptr<CShaderReflectionType>(pVarType));
-
     // The user-visible element type is the first field of the wrapepr `struct`
     Type *fieldType = ST->getElementType(0);
     DxilFieldAnnotation &fieldAnnotation = annotation->GetFieldAnnotation(0);
 
-    pVarType->Initialize(M, fieldType, fieldAnnotation, 0, allTypes, false);
+    // Actually create the reflection type.
+    pVarType = allTypes.Get(M, fieldType, fieldAnnotation, 0, false);
   }
 
   BYTE *pDefaultValue = nullptr;
@@ -1424,7 +1622,7 @@ void CShaderReflectionConstantBuffer::InitializeStructuredBuffer(
 void CShaderReflectionConstantBuffer::InitializeTBuffer(
     DxilModule &M,
     DxilResource &R,
-    std::vector<std::unique_ptr<CShaderReflectionType>>& allTypes,
+    CShaderReflectionTypeTable &allTypes,
     bool bUsageInMetadata) {
   ZeroMemory(&m_Desc, sizeof(m_Desc));
   m_ReflectionName = R.GetGlobalName();
@@ -1456,9 +1654,7 @@ void CShaderReflectionConstantBuffer::InitializeTBuffer(
     VarDesc.uFlags = (bAllUsed || fieldAnnotation.IsCBVarUsed()) ? D3D_SVF_USED : 0;
     CShaderReflectionVariable Var;
     //Create reflection type.
-    CShaderReflectionType *pVarType = new CShaderReflectionType();
-    allTypes.push_back(std::unique_ptr<CShaderReflectionType>(pVarType));
-    pVarType->Initialize(M, ST->getContainedType(i), fieldAnnotation, fieldAnnotation.GetCBufferOffset(), allTypes, true);
+    CShaderReflectionType *pVarType = allTypes.Get(M, ST->getContainedType(i), fieldAnnotation, fieldAnnotation.GetCBufferOffset(), true);
 
     BYTE *pDefaultValue = nullptr;
 
@@ -1847,14 +2043,6 @@ void DxilShaderReflection::SetCBufferUsage() {
 void DxilModuleReflection::CreateReflectionObjects() {
   DXASSERT_NOMSG(m_pDxilModule != nullptr);
 
-  {
-    // Add empty type for when no type info is available, instead of returning nullptr.
-    DXASSERT_NOMSG(m_Types.empty());
-    CShaderReflectionType *pEmptyType = new CShaderReflectionType();
-    m_Types.push_back(std::unique_ptr<CShaderReflectionType>(pEmptyType));
-    pEmptyType->InitializeEmpty();
-  }
-
   // Create constant buffers, resources and signatures.
   for (auto && cb : m_pDxilModule->GetCBuffers()) {
     std::unique_ptr<CShaderReflectionConstantBuffer> rcb(new CShaderReflectionConstantBuffer());
@@ -2101,13 +2289,15 @@ HRESULT DxilModuleReflection::LoadProgramHeader(const DxilProgramHeader *pProgra
     auto errorHandler = [&bBitcodeLoadError](const DiagnosticInfo &diagInfo) {
         bBitcodeLoadError |= diagInfo.getSeverity() == DS_Error;
       };
-#if 0 // We materialize eagerly, because we'll need to walk instructions to look for usage information.
-    ErrorOr<std::unique_ptr<Module>> mod =
-        getLazyBitcodeModule(std::move(pMemBuffer), Context, errorHandler);
-#else
-    ErrorOr<std::unique_ptr<Module>> mod =
-      parseBitcodeFile(pMemBuffer->getMemBufferRef(), Context, errorHandler);
-#endif
+    // Function bodies are only read when usage information is not in the
+    // metadata, or to find the resources each library function uses.
+    // Load lazily and materialize only in those cases, since for large
+    // shaders the bodies are most of the bitcode. Reflection never looks at
+    // debug info, so it is dropped while reading.
+    ErrorOr<std::unique_ptr<Module>> mod = getLazyBitcodeModule(
+        std::move(pMemBuffer), Context, errorHandler,
+        /*ShouldLazyLoadMetadata*/ false, /*ShouldTrackBitstreamUsage*/ false,
+        /*ShouldSkipDebugInfo*/ true);
     if (!mod || bBitcodeLoadError) {
       return E_INVALIDARG;
     }
@@ -2118,6 +2308,13 @@ HRESULT DxilModuleReflection::LoadProgramHeader(const DxilProgramHeader *pProgra
     m_pDxilModule->GetValidatorVersion(ValMajor, ValMinor);
     m_bUsageInMetadata = hlsl::DXIL::CompareVersions(ValMajor, ValMinor, 1, 5) >= 0;
 
+    if (!m_bUsageInMetadata || m_pDxilModule->GetShaderModel()->IsLib()) {
+      if (m_pModule->materializeAll() || bBitcodeLoadError)
+        return E_INVALIDARG;
+      // Operation functions had no users when the module was loaded.
+      m_pDxilModule->GetOP()->RefreshCache();
+    }
+
     CreateReflectionObjects();
     return S_OK;
   }
@@ -7,6 +7,10 @@
 //                                                                           //
 // Eliminate dynamic indexing on output.                                     //
 //                                                                           //
+// A dynamically indexed store that can only write a few rows becomes a      //
+// switch of direct stores. Otherwise the column is written to a temporary   //
+// and the rows it may write are copied out before every return and emit.   //
+//                                                                           //
 ///////////////////////////////////////////////////////////////////////////////
 
 #include "dxc/HLSL/DxilGenerationPass.h"
@@ -20,7 +24,10 @@
 #include "llvm/IR/Module.h"
 #include "llvm/Pass.h"
 #include "llvm/IR/IRBuilder.h"
+#include "llvm/ADT/BitVector.h"
 #include "llvm/ADT/MapVector.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/Analysis/ValueTracking.h"
 
 using namespace llvm;
 using namespace hlsl;
@@ -59,11 +66,17 @@ public:
   }
 
 private:
+  // Dynamic stores with at most this many possible rows become a switch.
+  static const unsigned kMaxSwitchRows = 4;
+
   bool EliminateDynamicOutput(hlsl::OP *hlslOP, DXIL::OpCode opcode, DxilSignature &outputSig, Function *Entry);
-  void ReplaceDynamicOutput(ArrayRef<Value *> tmpSigElts, Value * sigID, Value *zero, Function *F);
-  void StoreTmpSigToOutput(ArrayRef<Value *> tmpSigElts, unsigned row,
-                           Value *opcode, Value *sigID, Function *StoreOutput,
-                           Function *Entry);
+  void ReplaceDynamicOutput(Value *tmpSigElt, ArrayRef<CallInst *> stores,
+                            Value *zero);
+  void StoreTmpSigToOutput(Value *tmpSigElt, const BitVector &rows,
+                           unsigned col, Value *opcode, Value *sigID,
+                           Function *StoreOutput,
+                           ArrayRef<Instruction *> copyOutPts);
+  void StoreOutputBySwitch(CallInst *CI, const BitVector &rows);
 };
 
 // Wrapper for StoreOutput and StorePachConstant which has same signature.
@@ -96,6 +109,39 @@ public:
   }
 };
 
+// Marks the rows in [0, rows.size()) that rowIdx may take. Out of range
+// indices are undefined and are ignored.
+void AddPossibleRows(Value *rowIdx, BitVector &rows,
+                     SmallPtrSetImpl<Value *> &visited, const DataLayout &DL) {
+  if (ConstantInt *C = dyn_cast<ConstantInt>(rowIdx)) {
+    uint64_t r = C->getLimitedValue();
+    if (r < rows.size())
+      rows.set(r);
+    return;
+  }
+  // Values reached again through a cycle add nothing new.
+  if (!visited.insert(rowIdx).second)
+    return;
+  if (SelectInst *SI = dyn_cast<SelectInst>(rowIdx)) {
+    AddPossibleRows(SI->getTrueValue(), rows, visited, DL);
+    AddPossibleRows(SI->getFalseValue(), rows, visited, DL);
+    return;
+  }
+  if (PHINode *Phi = dyn_cast<PHINode>(rowIdx)) {
+    for (Value *V : Phi->incoming_values())
+      AddPossibleRows(V, rows, visited, DL);
+    return;
+  }
+  // Otherwise bound the index by its known zero bits.
+  unsigned bitWidth = rowIdx->getType()->getScalarSizeInBits();
+  APInt knownZero(bitWidth, 0), knownOne(bitWidth, 0);
+  computeKnownBits(rowIdx, knownZero, knownOne, DL);
+  uint64_t maxRow = (~knownZero).getLimitedValue();
+  if (knownOne.getLimitedValue() >= rows.size())
+    return;
+  rows.set(0, std::min<uint64_t>(maxRow + 1, rows.size()));
+}
+
 bool DxilEliminateOutputDynamicIndexing::EliminateDynamicOutput(
     hlsl::OP *hlslOP, DXIL::OpCode opcode, DxilSignature &outputSig,
     Function *Entry) {
@@ -122,10 +168,31 @@ bool DxilEliminateOutputDynamicIndexing::EliminateDynamicOutput(
   if (dynamicSigSet.empty())
     return false;
 
+  // Temporaries are copied to the output before every return and emit.
+  SmallVector<Instruction *, 4> copyOutPts;
+  for (BasicBlock &BB : *Entry) {
+    if (ReturnInst *RI = dyn_cast<ReturnInst>(BB.getTerminator()))
+      copyOutPts.emplace_back(RI);
+  }
+  for (DXIL::OpCode emitOp :
+       {DXIL::OpCode::EmitStream, DXIL::OpCode::EmitThenCutStream}) {
+    for (auto it : hlslOP->GetOpFuncList(emitOp)) {
+      Function *F = it.second;
+      if (!F)
+        continue;
+      for (User *U : F->users()) {
+        CallInst *CI = cast<CallInst>(U);
+        if (CI->getParent()->getParent() == Entry)
+          copyOutPts.emplace_back(CI);
+      }
+    }
+  }
+
   IRBuilder<> AllocaBuilder(dxilutil::FindAllocaInsertionPt(Entry));
 
   Value *opcodeV = AllocaBuilder.getInt32(static_cast<unsigned>(opcode));
   Value *zero = AllocaBuilder.getInt32(0);
+  const DataLayout &DL = Entry->getParent()->getDataLayout();
 
   for (auto sig : dynamicSigSet) {
     Value *sigID = sig.first;
@@ -136,66 +203,137 @@ bool DxilEliminateOutputDynamicIndexing::EliminateDynamicOutput(
     unsigned col = sigElt.GetCols();
     Type *AT = ArrayType::get(EltTy, row);
 
-    std::vector<Value *> tmpSigElts(col);
-    for (unsigned c = 0; c < col; c++) {
-      Value *newCol = AllocaBuilder.CreateAlloca(AT);
-      tmpSigElts[c] = newCol;
+    Function *F = hlslOP->GetOpFunc(opcode, EltTy);
+
+    // Only columns with a dynamic store need work; the rest keep their
+    // direct stores.
+    std::vector<SmallVector<CallInst *, 4>> colStores(col);
+    std::vector<bool> colIsDynamic(col, false);
+    for (User *U : F->users()) {
+      CallInst *CI = cast<CallInst>(U);
+      DxilOutputStore store(CI);
+      if (sigID != store.get_outputSigId())
+        continue;
+      uint64_t c = store.get_colIndex();
+      colStores[c].emplace_back(CI);
+      if (!isa<ConstantInt>(store.get_rowIndex()))
+        colIsDynamic[c] = true;
     }
 
-    Function *F = hlslOP->GetOpFunc(opcode, EltTy);
-    // Change store output to store tmpSigElts.
-    ReplaceDynamicOutput(tmpSigElts, sigID, zero, F);
-    // Store tmpSigElts to Output before return.
-    StoreTmpSigToOutput(tmpSigElts, row, opcodeV, sigID, F, Entry);
+    for (unsigned c = 0; c < col; c++) {
+      if (!colIsDynamic[c])
+        continue;
+      // Rows each store may write, and rows the column may write.
+      BitVector colRows(row);
+      std::vector<BitVector> storeRows;
+      bool bSwitch = true;
+      for (CallInst *CI : colStores[c]) {
+        DxilOutputStore store(CI);
+        BitVector rows(row);
+        SmallPtrSet<Value *, 8> visited;
+        AddPossibleRows(store.get_rowIndex(), rows, visited, DL);
+        if (rows.count() > kMaxSwitchRows)
+          bSwitch = false;
+        colRows |= rows;
+        storeRows.emplace_back(std::move(rows));
+      }
+
+      if (bSwitch) {
+        for (unsigned i = 0; i < colStores[c].size(); i++) {
+          CallInst *CI = colStores[c][i];
+          if (!isa<ConstantInt>(DxilOutputStore(CI).get_rowIndex()))
+            StoreOutputBySwitch(CI, storeRows[i]);
+        }
+        continue;
+      }
+
+      Value *tmpSigElt = AllocaBuilder.CreateAlloca(AT);
+      // Change store output to store tmpSigElt.
+      ReplaceDynamicOutput(tmpSigElt, colStores[c], zero);
+      // Store the rows tmpSigElt may hold to Output.
+      StoreTmpSigToOutput(tmpSigElt, colRows, c, opcodeV, sigID, F,
+                          copyOutPts);
+    }
   }
   return true;
 }
 
 void DxilEliminateOutputDynamicIndexing::ReplaceDynamicOutput(
-    ArrayRef<Value *> tmpSigElts, Value *sigID, Value *zero, Function *F) {
-  for (auto it = F->user_begin(); it != F->user_end();) {
-    CallInst *CI = cast<CallInst>(*(it++));
+    Value *tmpSigElt, ArrayRef<CallInst *> stores, Value *zero) {
+  for (CallInst *CI : stores) {
     DxilOutputStore store(CI);
-    if (sigID == store.get_outputSigId()) {
-      uint64_t col = store.get_colIndex();
-      Value *tmpSigElt = tmpSigElts[col];
-      IRBuilder<> Builder(CI);
-      Value *r = store.get_rowIndex();
-      // Store to tmpSigElt.
-      Value *GEP = Builder.CreateInBoundsGEP(tmpSigElt, {zero, r});
-      Builder.CreateStore(store.get_value(), GEP);
-      // Remove store output.
-      CI->eraseFromParent();
-    }
+    IRBuilder<> Builder(CI);
+    Value *r = store.get_rowIndex();
+    // Store to tmpSigElt.
+    Value *GEP = Builder.CreateInBoundsGEP(tmpSigElt, {zero, r});
+    Builder.CreateStore(store.get_value(), GEP);
+    // Remove store output.
+    CI->eraseFromParent();
   }
 }
 
 void DxilEliminateOutputDynamicIndexing::StoreTmpSigToOutput(
-    ArrayRef<Value *> tmpSigElts, unsigned row, Value *opcode, Value *sigID,
-    Function *StoreOutput, Function *Entry) {
+    Value *tmpSigElt, const BitVector &rows, unsigned col, Value *opcode,
+    Value *sigID, Function *StoreOutput, ArrayRef<Instruction *> copyOutPts) {
   Value *args[] = {opcode, sigID, /*row*/ nullptr, /*col*/ nullptr,
                    /*val*/ nullptr};
-  // Store the tmpSigElts to Output before every return.
-  for (auto &BB : Entry->getBasicBlockList()) {
-    if (ReturnInst *RI = dyn_cast<ReturnInst>(BB.getTerminator())) {
-      IRBuilder<> Builder(RI);
-      Value *zero = Builder.getInt32(0);
-      for (unsigned c = 0; c<tmpSigElts.size(); c++) {
-        Value *col = tmpSigElts[c];
-        args[DXIL::OperandIndex::kStoreOutputColOpIdx] = Builder.getInt8(c);
-        for (unsigned r = 0; r < row; r++) {
-          Value *GEP =
-              Builder.CreateInBoundsGEP(col, {zero, Builder.getInt32(r)});
-          Value *V = Builder.CreateLoad(GEP);
-          args[DXIL::OperandIndex::kStoreOutputRowOpIdx] = Builder.getInt32(r);
-          args[DXIL::OperandIndex::kStoreOutputValOpIdx] = V;
-          Builder.CreateCall(StoreOutput, args);
-        }
-      }
+  for (Instruction *InsertPt : copyOutPts) {
+    IRBuilder<> Builder(InsertPt);
+    Value *zero = Builder.getInt32(0);
+    args[DXIL::OperandIndex::kStoreOutputColOpIdx] = Builder.getInt8(col);
+    for (int r = rows.find_first(); r != -1; r = rows.find_next(r)) {
+      Value *GEP =
+          Builder.CreateInBoundsGEP(tmpSigElt, {zero, Builder.getInt32(r)});
+      Value *V = Builder.CreateLoad(GEP);
+      args[DXIL::OperandIndex::kStoreOutputRowOpIdx] = Builder.getInt32(r);
+      args[DXIL::OperandIndex::kStoreOutputValOpIdx] = V;
+      Builder.CreateCall(StoreOutput, args);
     }
   }
 }
 
+// Replaces a dynamically indexed store with a switch over the rows it may
+// write, each case storing to its row directly.
+void DxilEliminateOutputDynamicIndexing::StoreOutputBySwitch(
+    CallInst *CI, const BitVector &rows) {
+  SmallVector<Value *, 5> args(CI->arg_operands().begin(),
+                               CI->arg_operands().end());
+  Value *rowIdx = args[DXIL::OperandIndex::kStoreOutputRowOpIdx];
+  Function *StoreOutput = CI->getCalledFunction();
+  // Every possible index is out of range, so the store does nothing.
+  if (rows.none()) {
+    CI->eraseFromParent();
+    return;
+  }
+  Type *i32Ty = rowIdx->getType();
+  if (rows.count() == 1) {
+    CI->setArgOperand(DXIL::OperandIndex::kStoreOutputRowOpIdx,
+                      ConstantInt::get(i32Ty, rows.find_first()));
+    return;
+  }
+
+  BasicBlock *BB = CI->getParent();
+  Function *F = BB->getParent();
+  LLVMContext &Ctx = F->getContext();
+  BasicBlock *EndBB = BB->splitBasicBlock(CI, "output.end");
+  BB->getTerminator()->eraseFromParent();
+  SmallVector<std::pair<ConstantInt *, BasicBlock *>, 4> cases;
+  for (int r = rows.find_first(); r != -1; r = rows.find_next(r)) {
+    BasicBlock *CaseBB = BasicBlock::Create(Ctx, "output.row", F, EndBB);
+    IRBuilder<> Builder(CaseBB);
+    args[DXIL::OperandIndex::kStoreOutputRowOpIdx] = Builder.getInt32(r);
+    Builder.CreateCall(StoreOutput, args);
+    Builder.CreateBr(EndBB);
+    cases.emplace_back(cast<ConstantInt>(ConstantInt::get(i32Ty, r)), CaseBB);
+  }
+  // The index is one of the rows, so the last row takes the default.
+  SwitchInst *Switch = SwitchInst::Create(rowIdx, cases.back().second,
+                                          cases.size() - 1, BB);
+  for (unsigned i = 0; i + 1 < cases.size(); i++)
+    Switch->addCase(cases[i].first, cases[i].second);
+  CI->eraseFromParent();
+}
+
 }
 
 char DxilEliminateOutputDynamicIndexing::ID = 0;
@@ -0,0 +1,183 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// DxilFormDot2AddHalf.cpp                                                   //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Re-forms pairs of scalarized half products into Dot2AddHalf.              //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#include "dxc/HLSL/DxilGenerationPass.h"
+#include "dxc/DXIL/DxilModule.h"
+#include "dxc/DXIL/DxilOperations.h"
+#include "dxc/DXIL/DxilShaderModel.h"
+
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Transforms/Utils/Local.h"
+
+using namespace llvm;
+using namespace hlsl;
+
+// DXIL has no vector instructions, so the scalarizer splits half2 math into
+// separate operations. The one packed 16-bit operation DXIL has is
+// Dot2AddHalf (SM 6.4), and the split form of a half2 dot product added to a
+// float is easy to recognize:
+//   acc + float(a.x) * float(b.x) + float(a.y) * float(b.y)
+// Products of extended halves are exact in float, so only the order of the
+// additions changes, and fast math allows that. This pass gathers the terms
+// of each tree of fast, non-precise float additions, pairs up the products
+// of extended halves, and folds each pair into the accumulator with
+// Dot2AddHalf. Enabled with -opt-enable form-dot2add.
+namespace {
+class DxilFormDot2AddHalf : public FunctionPass {
+public:
+  static char ID; // Pass identification, replacement for typeid
+  explicit DxilFormDot2AddHalf() : FunctionPass(ID) {}
+
+  StringRef getPassName() const override {
+    return "DXIL form Dot2AddHalf";
+  }
+
+  void getAnalysisUsage(AnalysisUsage &AU) const override {
+    AU.setPreservesCFG();
+  }
+
+  bool runOnFunction(Function &F) override;
+
+private:
+  struct Product {
+    Value *Term;
+    Value *A;
+    Value *B;
+  };
+
+  bool isReassociableAdd(Value *V);
+  bool getProduct(Value *V, Product &P);
+  void gatherTerms(Value *V, SmallVectorImpl<Value *> &Terms);
+  bool formDot2Add(BinaryOperator *Root);
+
+  DxilModule *m_DM = nullptr;
+};
+
+char DxilFormDot2AddHalf::ID = 0;
+} // namespace
+
+bool DxilFormDot2AddHalf::isReassociableAdd(Value *V) {
+  BinaryOperator *BO = dyn_cast<BinaryOperator>(V);
+  return BO && BO->getOpcode() == Instruction::FAdd &&
+         BO->getType()->isFloatTy() && BO->hasUnsafeAlgebra() &&
+         !m_DM->IsPrecise(BO);
+}
+
+// Matches float(a) * float(b) with half a and b.
+bool DxilFormDot2AddHalf::getProduct(Value *V, Product &P) {
+  BinaryOperator *Mul = dyn_cast<BinaryOperator>(V);
+  if (!Mul || Mul->getOpcode() != Instruction::FMul || !Mul->hasOneUse() ||
+      !Mul->hasUnsafeAlgebra() || m_DM->IsPrecise(Mul))
+    return false;
+  FPExtInst *ExtA = dyn_cast<FPExtInst>(Mul->getOperand(0));
+  FPExtInst *ExtB = dyn_cast<FPExtInst>(Mul->getOperand(1));
+  if (!ExtA || !ExtB || !ExtA->getSrcTy()->isHalfTy() ||
+      !ExtB->getSrcTy()->isHalfTy())
+    return false;
+  P.Term = Mul;
+  P.A = ExtA->getOperand(0);
+  P.B = ExtB->getOperand(0);
+  return true;
+}
+
+// Collects the leaves of the addition tree under V. Inner additions must
+// have no other use, since they go away.
+void DxilFormDot2AddHalf::gatherTerms(Value *V,
+                                      SmallVectorImpl<Value *> &Terms) {
+  BinaryOperator *BO = cast<BinaryOperator>(V);
+  for (Value *Op : BO->operands()) {
+    if (isReassociableAdd(Op) && Op->hasOneUse())
+      gatherTerms(Op, Terms);
+    else
+      Terms.push_back(Op);
+  }
+}
+
+bool DxilFormDot2AddHalf::formDot2Add(BinaryOperator *Root) {
+  SmallVector<Value *, 8> Terms;
+  gatherTerms(Root, Terms);
+
+  SmallVector<Product, 4> Products;
+  SmallVector<Value *, 8> Others;
+  for (Value *Term : Terms) {
+    Product P;
+    if (getProduct(Term, P))
+      Products.push_back(P);
+    else
+      Others.push_back(Term);
+  }
+  if (Products.size() < 2)
+    return false;
+  // An odd product is left as it is.
+  if (Products.size() % 2) {
+    Others.push_back(Products.back().Term);
+    Products.pop_back();
+  }
+
+  IRBuilder<> B(Root);
+  B.SetFastMathFlags(Root->getFastMathFlags());
+  Value *Acc = nullptr;
+  for (Value *Other : Others)
+    Acc = Acc ? B.CreateFAdd(Acc, Other) : Other;
+  if (!Acc)
+    Acc = ConstantFP::get(Root->getType(), 0.0);
+
+  OP *HlslOP = m_DM->GetOP();
+  Function *Dot2AddFn =
+      HlslOP->GetOpFunc(OP::OpCode::Dot2AddHalf, Root->getType());
+  Constant *OpArg = HlslOP->GetU32Const((unsigned)OP::OpCode::Dot2AddHalf);
+  for (unsigned i = 0; i < Products.size(); i += 2) {
+    const Product &X = Products[i];
+    const Product &Y = Products[i + 1];
+    Acc = B.CreateCall(Dot2AddFn, {OpArg, Acc, X.A, Y.A, X.B, Y.B});
+  }
+
+  Acc->takeName(Root);
+  Root->replaceAllUsesWith(Acc);
+  RecursivelyDeleteTriviallyDeadInstructions(Root);
+  return true;
+}
+
+bool DxilFormDot2AddHalf::runOnFunction(Function &F) {
+  Module *M = F.getParent();
+  if (!M->HasDxilModule())
+    return false;
+  m_DM = &M->GetDxilModule();
+  if (!m_DM->GetShaderModel()->IsSM64Plus())
+    return false;
+
+  // Roots are additions whose result is not folded into another one.
+  SmallVector<BinaryOperator *, 16> Roots;
+  for (BasicBlock &BB : F) {
+    for (Instruction &I : BB) {
+      if (!isReassociableAdd(&I))
+        continue;
+      if (I.hasOneUse() && isReassociableAdd(*I.user_begin()))
+        continue;
+      Roots.push_back(cast<BinaryOperator>(&I));
+    }
+  }
+
+  bool bUpdated = false;
+  for (BinaryOperator *Root : Roots)
+    bUpdated |= formDot2Add(Root);
+  return bUpdated;
+}
+
+FunctionPass *llvm::createDxilFormDot2AddHalfPass() {
+  return new DxilFormDot2AddHalf();
+}
+
+INITIALIZE_PASS(DxilFormDot2AddHalf, "dxil-form-dot2add",
+                "DXIL form Dot2AddHalf", false, false)
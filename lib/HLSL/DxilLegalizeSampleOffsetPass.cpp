@@ -15,6 +15,9 @@
 #include "dxc/DXIL/DxilOperations.h"
 #include "dxc/DXIL/DxilUtil.h"
 
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SetVector.h"
+#include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/Analysis/InstructionSimplify.h"
 #include "llvm/Analysis/LoopInfo.h"
 #include "llvm/IR/DebugInfo.h"
@@ -23,6 +26,7 @@
 #include "llvm/IR/Instructions.h"
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/LegacyPassManager.h"
+#include "llvm/IR/Metadata.h"
 #include "llvm/IR/PassManager.h"
 #include "llvm/Pass.h"
 #include "llvm/Transforms/Scalar.h"
@@ -76,7 +80,7 @@ public:
       return false;
 
     // Loop unroll if has offset inside loop.
-    TryUnrollLoop(illegalOffsets, F);
+    TryUnrollLoop(illegalOffsets, F, hlslOP);
 
     // Collect offset again after mem2reg.
     std::vector<Offset> ssaIllegalOffsets;
@@ -95,7 +99,9 @@ public:
   }
 
 private:
-  void TryUnrollLoop(std::vector<Offset> &illegalOffsets, Function &F);
+  void TryUnrollLoop(std::vector<Offset> &illegalOffsets, Function &F,
+                     hlsl::OP *hlslOP);
+  void AnalyzeLoops(Function &F);
   void CollectIllegalOffsets(std::vector<Offset> &illegalOffsets,
                              Function &F, hlsl::OP *hlslOP);
   void CollectIllegalOffsets(std::vector<Offset> &illegalOffsets,
@@ -107,25 +113,60 @@ private:
 
 char DxilLegalizeSampleOffsetPass::ID = 0;
 
-bool HasIllegalOffsetInLoop(std::vector<Offset> &illegalOffsets, LoopInfo &LI,
-                            Function &F) {
-  DominatorTreeAnalysis DTA;
-  DominatorTree DT = DTA.run(F);
-  LI.Analyze(DT);
-
-  bool findOffset = false;
-
-  for (auto it : illegalOffsets) {
-    if (const Instruction *I = dyn_cast<Instruction>(it.offset)) {
-      const BasicBlock *BB = I->getParent();
-      // TODO: determine whether values are actually loop dependent, not just in a loop
-      if (LI.getLoopFor(BB)) {
-        findOffset = true;
-        break;
+// Collects the loops whose header phis an offset depends on, which are the
+// loops that have to be unrolled for it to become an immediate. Their trip
+// counts must become constant too, so the loops those depend on are added.
+// Values stored to local arrays that sroa could not split are followed
+// through memory.
+void CollectLoopsFeedingOffset(Value *offset, LoopInfo &LI,
+                               SmallSetVector<Loop *, 4> &loops) {
+  SmallVector<Value *, 16> worklist;
+  SmallPtrSet<Value *, 16> visited;
+  worklist.emplace_back(offset);
+  while (!worklist.empty()) {
+    Instruction *I = dyn_cast<Instruction>(worklist.pop_back_val());
+    if (!I || !visited.insert(I).second)
+      continue;
+    if (isa<PHINode>(I)) {
+      BasicBlock *BB = I->getParent();
+      Loop *L = LI.getLoopFor(BB);
+      if (L && L->getHeader() == BB && loops.insert(L)) {
+        SmallVector<BasicBlock *, 4> exitingBlocks;
+        L->getExitingBlocks(exitingBlocks);
+        for (BasicBlock *ExitingBB : exitingBlocks) {
+          BranchInst *BI = dyn_cast<BranchInst>(ExitingBB->getTerminator());
+          if (BI && BI->isConditional())
+            worklist.emplace_back(BI->getCondition());
+        }
+      }
+    }
+    if (isa<AllocaInst>(I) || isa<GetElementPtrInst>(I)) {
+      for (User *U : I->users()) {
+        if (isa<StoreInst>(U) || isa<GetElementPtrInst>(U))
+          worklist.emplace_back(U);
       }
     }
+    for (Value *Op : I->operands())
+      worklist.emplace_back(Op);
+  }
+}
+
+// Adds unroll(disable) to the loop id of L, returning the new loop id.
+MDNode *DisableLoopUnroll(Loop *L) {
+  LLVMContext &Ctx = L->getHeader()->getContext();
+  SmallVector<Metadata *, 4> MDs;
+  // Reserve first location for self reference to the LoopID metadata node.
+  MDs.emplace_back(nullptr);
+  if (MDNode *LoopID = L->getLoopID()) {
+    for (unsigned i = 1, e = LoopID->getNumOperands(); i < e; ++i)
+      MDs.emplace_back(LoopID->getOperand(i));
   }
-  return findOffset;
+  MDs.emplace_back(
+      MDNode::get(Ctx, MDString::get(Ctx, "llvm.loop.unroll.disable")));
+  MDNode *NewLoopID = MDNode::get(Ctx, MDs);
+  NewLoopID->replaceOperandWith(0, NewLoopID);
+  L->setLoopID(NewLoopID);
+  return NewLoopID;
 }
 
 void GetOffsetRange(DXIL::OpCode opcode, unsigned &offsetStart, unsigned &offsetEnd)
@@ -220,28 +261,72 @@ void DxilLegalizeSampleOffsetPass::FinalCheck(Function &F, hlsl::OP *hlslOP) {
   }
 }
 
+void DxilLegalizeSampleOffsetPass::AnalyzeLoops(Function &F) {
+  DominatorTreeAnalysis DTA;
+  DominatorTree DT = DTA.run(F);
+  LI.releaseMemory();
+  LI.Analyze(DT);
+}
+
 void DxilLegalizeSampleOffsetPass::TryUnrollLoop(
-    std::vector<Offset> &illegalOffsets, Function &F) {
-  legacy::FunctionPassManager PM(F.getParent());
-  // Scalarize aggregates as mem2reg only applies on scalars.
-  PM.add(createSROAPass());
-  // Always need mem2reg for simplify illegal offsets.
-  PM.add(createPromoteMemoryToRegisterPass());
-
-  bool UnrollLoop = HasIllegalOffsetInLoop(illegalOffsets, LI, F);
-  if (UnrollLoop) {
-    PM.add(createCFGSimplificationPass());
-    PM.add(createLCSSAPass());
-    PM.add(createLoopSimplifyPass());
-    PM.add(createLoopRotatePass());
-    PM.add(createLoopUnrollPass(-2, -1, 0, 0));
+    std::vector<Offset> &illegalOffsets, Function &F, hlsl::OP *hlslOP) {
+  {
+    legacy::FunctionPassManager PM(F.getParent());
+    // Scalarize aggregates as mem2reg only applies on scalars.
+    PM.add(createSROAPass());
+    // Always need mem2reg for simplify illegal offsets.
+    PM.add(createPromoteMemoryToRegisterPass());
+    PM.run(F);
   }
+
+  // Offsets the value cache can already fold need no unrolling.
+  DxilValueCache *DVC = &getAnalysis<DxilValueCache>();
+  DVC->ResetUnknowns();
+  illegalOffsets.clear();
+  CollectIllegalOffsets(illegalOffsets, F, hlslOP);
+  LegalizeOffsets(illegalOffsets);
+  illegalOffsets.clear();
+  CollectIllegalOffsets(illegalOffsets, F, hlslOP);
+
+  AnalyzeLoops(F);
+  SmallSetVector<Loop *, 4> loopsToUnroll;
+  for (const Offset &offset : illegalOffsets)
+    CollectLoopsFeedingOffset(offset.offset, LI, loopsToUnroll);
+  if (loopsToUnroll.empty())
+    return;
+
+  // Keep the other loops rolled while the unroller runs.
+  DenseMap<MDNode *, MDNode *> disabledLoopIDs;
+  SmallVector<Loop *, 8> loops(LI.begin(), LI.end());
+  while (!loops.empty()) {
+    Loop *L = loops.pop_back_val();
+    loops.append(L->begin(), L->end());
+    if (loopsToUnroll.count(L))
+      continue;
+    MDNode *LoopID = L->getLoopID();
+    disabledLoopIDs[DisableLoopUnroll(L)] = LoopID;
+  }
+
+  legacy::FunctionPassManager PM(F.getParent());
+  PM.add(createCFGSimplificationPass());
+  PM.add(createLCSSAPass());
+  PM.add(createLoopSimplifyPass());
+  PM.add(createLoopRotatePass());
+  PM.add(createLoopUnrollPass(-2, -1, 0, 0));
   PM.run(F);
 
-  if (UnrollLoop) {
-    DxilValueCache *DVC = &getAnalysis<DxilValueCache>();
-    DVC->ResetUnknowns();
+  if (!disabledLoopIDs.empty()) {
+    unsigned LoopMDKind = F.getContext().getMDKindID("llvm.loop");
+    for (BasicBlock &BB : F) {
+      TerminatorInst *TI = BB.getTerminator();
+      auto it = disabledLoopIDs.find(TI->getMetadata(LoopMDKind));
+      if (it != disabledLoopIDs.end())
+        TI->setMetadata(LoopMDKind, it->second);
+    }
   }
+
+  AnalyzeLoops(F);
+  DVC->ResetUnknowns();
 }
 
 void DxilLegalizeSampleOffsetPass::CollectIllegalOffsets(
@@ -63,6 +63,33 @@ void CollectUsedFunctions(Constant *C,
   }
 }
 
+// Collects the global variables that C refers to, directly or through
+// constant expressions, aggregates and the initializers of those globals.
+// This matches the globals whose users lead CollectUsedFunctions to C.
+void CollectUsedGlobals(Constant *C, SmallPtrSetImpl<Constant *> &visited,
+                        SmallPtrSetImpl<GlobalVariable *> &GVSet) {
+  SmallVector<Constant *, 8> workList(1, C);
+  while (!workList.empty()) {
+    Constant *Cur = workList.pop_back_val();
+    if (!visited.insert(Cur).second)
+      continue;
+    if (GlobalVariable *GV = dyn_cast<GlobalVariable>(Cur)) {
+      GVSet.insert(GV);
+      if (GV->hasInitializer())
+        workList.emplace_back(GV->getInitializer());
+      continue;
+    }
+    if (GlobalAlias *GA = dyn_cast<GlobalAlias>(Cur)) {
+      workList.emplace_back(GA->getAliasee());
+      continue;
+    }
+    if (isa<GlobalValue>(Cur))
+      continue;
+    for (Value *Op : Cur->operands())
+      workList.emplace_back(cast<Constant>(Op));
+  }
+}
+
 template <class T>
 void AddResourceMap(
     const std::vector<std::unique_ptr<T>> &resTab, DXIL::ResourceClass resClass,
@@ -124,6 +151,7 @@ public:
   DxilResourceBase *GetResource(const llvm::Constant *GV);
 
   DxilModule &GetDxilModule() { return m_DM; }
+  // Materializes F and records the functions and globals it uses.
   void LazyLoadFunction(Function *F);
   void BuildGlobalUsage();
   void CollectUsedInitFunctions(SetVector<StringRef> &addedFunctionSet,
@@ -141,6 +169,9 @@ private:
   llvm::MapVector<const llvm::Constant *, DxilResourceBase *> m_resourceMap;
   // Set of initialize functions for global variable. SetVector for deterministic iteration.
   llvm::SetVector<llvm::Function *> m_initFuncSet;
+  // Position of each global in the module, to keep usedGVs in module order.
+  llvm::DenseMap<const llvm::GlobalVariable *, unsigned> m_globalOrder;
+  bool m_bGlobalUsageBuilt = false;
 };
 
 struct DxilLinkJob;
@@ -214,6 +245,7 @@ DxilLib::DxilLib(std::unique_ptr<llvm::Module> pModule)
       // Add prefix to internal global.
       GV.setName(MID + GV.getName());
     }
+    m_globalOrder[&GV] = m_globalOrder.size();
   }
 
 }
@@ -232,14 +264,26 @@ void DxilLib::LazyLoadFunction(Function *F) {
   std::error_code EC = F->materialize();
   DXASSERT_LOCALVAR(EC, !EC, "else fail to materialize");
 
-  // Build used functions for F.
+  // Build used functions and globals for F.
+  SmallPtrSet<Constant *, 16> visited;
+  SmallPtrSet<GlobalVariable *, 8> GVSet;
   for (auto &BB : F->getBasicBlockList()) {
     for (auto &I : BB.getInstList()) {
       if (CallInst *CI = dyn_cast<CallInst>(&I)) {
         linkInfo->usedFunctions.insert(CI->getCalledFunction());
       }
+      for (Value *Op : I.operands()) {
+        if (Constant *C = dyn_cast<Constant>(Op))
+          CollectUsedGlobals(C, visited, GVSet);
+      }
     }
   }
+  SmallVector<GlobalVariable *, 8> usedGVs(GVSet.begin(), GVSet.end());
+  std::sort(usedGVs.begin(), usedGVs.end(),
+            [this](GlobalVariable *A, GlobalVariable *B) {
+              return m_globalOrder.lookup(A) < m_globalOrder.lookup(B);
+            });
+  linkInfo->usedGVs.insert(usedGVs.begin(), usedGVs.end());
 
   if (m_DM.HasDxilFunctionProps(F)) {
     DxilFunctionProps &props = m_DM.GetDxilFunctionProps(F);
@@ -252,7 +296,12 @@ void DxilLib::LazyLoadFunction(Function *F) {
   // Used globals will be build before link.
 }
 
+// Global usage of each function is recorded as it is materialized, so only
+// the init functions and the resource map are built here, once per library.
 void DxilLib::BuildGlobalUsage() {
+  if (m_bGlobalUsageBuilt)
+    return;
+  m_bGlobalUsageBuilt = true;
   Module &M = *m_pModule;
 
   // Collect init functions for static globals.
@@ -279,17 +328,6 @@ void DxilLib::BuildGlobalUsage() {
     }
   }
 
-  // Build used globals.
-  for (GlobalVariable &GV : M.globals()) {
-    llvm::SetVector<Function *> funcSet;
-    CollectUsedFunctions(&GV, funcSet);
-    for (Function *F : funcSet) {
-      DXASSERT(m_functionNameMap.count(F->getName()), "must exist in table");
-      DxilFunctionLinkInfo *linkInfo = m_functionNameMap[F->getName()].get();
-      linkInfo->usedGVs.insert(&GV);
-    }
-  }
-
   // Build resource map.
   AddResourceMap(m_DM.GetUAVs(), DXIL::ResourceClass::UAV, m_resourceMap, m_DM);
   AddResourceMap(m_DM.GetSRVs(), DXIL::ResourceClass::SRV, m_resourceMap, m_DM);
@@ -952,7 +990,6 @@ DxilLinkJob::LinkToLib(const ShaderModel *pSM) {
   if (!m_exportMap.empty()) {
     m_exportMap.BeginProcessing();
 
-    DM.ClearDxilMetadata(*pM);
     for (auto it = pM->begin(); it != pM->end();) {
       Function *F = it++;
       if (F->isDeclaration())
@@ -964,6 +1001,13 @@ DxilLinkJob::LinkToLib(const ShaderModel *pSM) {
       }
     }
 
+    // Drop resources that only the removed functions used.
+    {
+      legacy::PassManager PM;
+      PM.add(createDxilRemoveUnusedResourcesPass());
+      PM.run(*pM);
+    }
+
     if(!m_exportMap.EndProcessing()) {
       for (auto &name : m_exportMap.GetNameCollisions()) {
         std::string escaped;
@@ -1010,7 +1054,9 @@ DxilLinkJob::LinkToLib(const ShaderModel *pSM) {
       }
     }
 
-    DM.EmitDxilMetadata();
+    legacy::PassManager PM;
+    PM.add(createDxilEmitMetadataPass());
+    PM.run(*pM);
   }
 
   return pM;
@@ -1241,6 +1287,14 @@ void DxilLinkJob::RunPreparePass(Module &M) {
   // Remove unused functions.
   PM.add(createDxilDeadFunctionEliminationPass());
 
+  // Specialize functions that were not inlined for the constants their
+  // callers pass. Functions left out of an export list are removed after
+  // this, so only do it when every function is kept.
+  if (m_exportMap.empty()) {
+    PM.add(createDxilSpecializeConstantArgsPass());
+    PM.add(createDxilDeadFunctionEliminationPass());
+  }
+
   // SROA
   PM.add(createSROAPass(/*RequiresDomTree*/false, /*SkipHLSLMat*/false));
   // For static global handle.
@@ -1274,7 +1328,10 @@ void DxilLinkJob::RunPreparePass(Module &M) {
   PM.add(createComputeViewIdStatePass());
   PM.add(createDxilDeadFunctionEliminationPass());
   PM.add(createNoPausePassesPass());
-  PM.add(createDxilEmitMetadataPass());
+  // With an export list, Link() emits the metadata once the exports are
+  // processed, rather than emitting it here and again there.
+  if (m_exportMap.empty())
+    PM.add(createDxilEmitMetadataPass());
 
   PM.run(M);
 }
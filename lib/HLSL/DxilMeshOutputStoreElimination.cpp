@@ -0,0 +1,126 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// DxilMeshOutputStoreElimination.cpp                                        //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Removes mesh shader output stores that are overwritten in the same block. //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#include "dxc/HLSL/DxilGenerationPass.h"
+#include "dxc/DXIL/DxilModule.h"
+#include "dxc/DXIL/DxilOpCallIndex.h"
+#include "dxc/DXIL/DxilOperations.h"
+#include "dxc/DXIL/DxilInstructions.h"
+
+#include "llvm/ADT/SetVector.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/Module.h"
+
+#include <set>
+#include <tuple>
+#include <vector>
+
+using namespace llvm;
+using namespace hlsl;
+
+// Mesh shader outputs are written one component at a time, and cannot be
+// read back. Initializing an output and then assigning its fields, as in
+//   Vertex v = (Vertex)0;
+//   v.pos = p;
+//   verts[i] = v;
+// leaves StoreVertexOutput calls that write the same component twice, and
+// only the last one matters. Walking each block backwards, this pass removes
+// any StoreVertexOutput or StorePrimitiveOutput whose signature element, row,
+// column and vertex or primitive index are all written again later in the
+// block. Indices that are not the same value are treated as different, so
+// only stores that are certainly overwritten go away.
+// There is no DXIL operation that writes several output components at once,
+// so the remaining stores cannot be merged further.
+namespace {
+class DxilMeshOutputStoreElimination : public FunctionPass {
+public:
+  static char ID; // Pass identification, replacement for typeid
+  explicit DxilMeshOutputStoreElimination() : FunctionPass(ID) {}
+
+  StringRef getPassName() const override {
+    return "DXIL mesh output store elimination";
+  }
+
+  void getAnalysisUsage(AnalysisUsage &AU) const override {
+    AU.setPreservesCFG();
+  }
+
+  bool runOnFunction(Function &F) override;
+};
+
+char DxilMeshOutputStoreElimination::ID = 0;
+
+// opcode, sig id, row, column, vertex or primitive index.
+typedef std::tuple<unsigned, Value *, Value *, Value *, Value *> OutputKey;
+
+bool GetOutputKey(CallInst *CI, OutputKey &Key) {
+  if (OP::IsDxilOpFuncCallInst(CI, DXIL::OpCode::StoreVertexOutput)) {
+    DxilInst_StoreVertexOutput SVO(CI);
+    Key = OutputKey((unsigned)DXIL::OpCode::StoreVertexOutput,
+                    SVO.get_outputSigId(),
+                    SVO.get_rowIndex(), SVO.get_colIndex(),
+                    SVO.get_vertexIndex());
+    return true;
+  }
+  if (OP::IsDxilOpFuncCallInst(CI, DXIL::OpCode::StorePrimitiveOutput)) {
+    DxilInst_StorePrimitiveOutput SPO(CI);
+    Key = OutputKey((unsigned)DXIL::OpCode::StorePrimitiveOutput,
+                    SPO.get_outputSigId(),
+                    SPO.get_rowIndex(), SPO.get_colIndex(),
+                    SPO.get_primitiveIndex());
+    return true;
+  }
+  return false;
+}
+
+} // namespace
+
+bool DxilMeshOutputStoreElimination::runOnFunction(Function &F) {
+  Module *M = F.getParent();
+  if (!M->HasDxilModule())
+    return false;
+
+  // Only blocks with at least two output stores need a walk.
+  DxilOpCallIndex &Index = M->GetDxilModule().GetOpCallIndex();
+  SmallVector<CallInst *, 16> Stores;
+  Index.GetCalls(DXIL::OpCode::StoreVertexOutput, Stores);
+  Index.GetCalls(DXIL::OpCode::StorePrimitiveOutput, Stores);
+  SmallSetVector<BasicBlock *, 8> Blocks, MultiStoreBlocks;
+  for (CallInst *CI : Stores) {
+    BasicBlock *BB = CI->getParent();
+    if (BB->getParent() == &F && !Blocks.insert(BB))
+      MultiStoreBlocks.insert(BB);
+  }
+
+  std::vector<CallInst *> DeadStores;
+  std::set<OutputKey> Written;
+  for (BasicBlock *BB : MultiStoreBlocks) {
+    Written.clear();
+    for (auto It = BB->rbegin(), E = BB->rend(); It != E; ++It) {
+      CallInst *CI = dyn_cast<CallInst>(&*It);
+      OutputKey Key;
+      if (!CI || !GetOutputKey(CI, Key))
+        continue;
+      if (!Written.insert(Key).second)
+        DeadStores.emplace_back(CI);
+    }
+  }
+  for (CallInst *CI : DeadStores)
+    CI->eraseFromParent();
+  return !DeadStores.empty();
+}
+
+FunctionPass *llvm::createDxilMeshOutputStoreEliminationPass() {
+  return new DxilMeshOutputStoreElimination();
+}
+
+INITIALIZE_PASS(DxilMeshOutputStoreElimination, "dxil-mesh-output-dse",
+                "DXIL mesh output store elimination", false, false)
@@ -0,0 +1,384 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// DxilPackInterstageSignatures.cpp                                          //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Packs the signatures between two stages of one pipeline together.        //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#include "dxc/Support/Global.h"
+#include "dxc/DXIL/DxilModule.h"
+#include "dxc/DXIL/DxilOperations.h"
+#include "dxc/DXIL/DxilSignature.h"
+#include "dxc/DXIL/DxilSigPoint.h"
+#include "dxc/HLSL/ComputeViewIdState.h"
+#include "dxc/HLSL/DxilPackSignatureElement.h"
+
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/LegacyPassManager.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Transforms/Utils/Local.h"
+
+using namespace hlsl;
+using namespace llvm;
+
+// Each stage is compiled, and its signatures packed, on its own, so an
+// output the next stage never reads still takes up space, and the layout of
+// both sides is only as good as the declaration order. When both stages are
+// known, the producer's outputs and the consumer's inputs can be packed as
+// one: arbitrary-semantic inputs the consumer never loads are removed from
+// both sides, together with the stores that wrote them, as are stores to
+// components the consumer does not read. The remaining outputs are packed
+// under the consumer's interpolation modes, then the consumer's inputs take
+// the same locations.
+
+namespace {
+// Packs a producer output under the interpolation mode of the consumer
+// input it feeds, so that elements the consumer interpolates differently
+// do not share a row.
+class DxilInterstagePackElement : public DxilPackElement {
+  DXIL::InterpolationMode m_InterpMode;
+
+public:
+  DxilInterstagePackElement(DxilSignatureElement *pSE, bool useMinPrecision,
+                            DXIL::InterpolationMode interpMode)
+      : DxilPackElement(pSE, useMinPrecision), m_InterpMode(interpMode) {}
+  DXIL::InterpolationMode GetInterpolationMode() const override {
+    return m_InterpMode;
+  }
+};
+} // namespace
+
+static const OP::OpCode kInputSigOps[] = {
+    OP::OpCode::LoadInput, OP::OpCode::EvalSnapped,
+    OP::OpCode::EvalSampleIndex, OP::OpCode::EvalCentroid,
+    OP::OpCode::AttributeAtVertex};
+static const OP::OpCode kOutputSigOps[] = {
+    OP::OpCode::StoreOutput, OP::OpCode::StoreVertexOutput,
+    OP::OpCode::LoadOutputControlPoint};
+// Every operation above has the signature element ID as operand 1.
+static const unsigned kSigIdOpIdx = 1;
+
+static bool IsSupportedPair(DXIL::ShaderKind Producer,
+                            DXIL::ShaderKind Consumer) {
+  switch (Consumer) {
+  case DXIL::ShaderKind::Hull:
+    return Producer == DXIL::ShaderKind::Vertex;
+  case DXIL::ShaderKind::Domain:
+    return Producer == DXIL::ShaderKind::Hull;
+  case DXIL::ShaderKind::Geometry:
+    return Producer == DXIL::ShaderKind::Vertex ||
+           Producer == DXIL::ShaderKind::Domain;
+  case DXIL::ShaderKind::Pixel:
+    return Producer == DXIL::ShaderKind::Vertex ||
+           Producer == DXIL::ShaderKind::Domain ||
+           Producer == DXIL::ShaderKind::Geometry ||
+           Producer == DXIL::ShaderKind::Mesh;
+  default:
+    return false;
+  }
+}
+
+static void CollectSigCalls(Module &M, ArrayRef<OP::OpCode> OpCodes,
+                            std::vector<CallInst *> &Calls) {
+  for (Function &F : M) {
+    if (!OP::IsDxilOpFunc(&F))
+      continue;
+    for (User *U : F.users()) {
+      CallInst *CI = cast<CallInst>(U);
+      OP::OpCode Op = OP::GetDxilOpFuncCallInst(CI);
+      if (std::find(OpCodes.begin(), OpCodes.end(), Op) != OpCodes.end())
+        Calls.push_back(CI);
+    }
+  }
+}
+
+static unsigned GetSigId(CallInst *CI) {
+  return cast<ConstantInt>(CI->getArgOperand(kSigIdOpIdx))->getZExtValue();
+}
+
+// Removes the flagged elements and points the remaining calls at the new
+// element IDs. Calls that used a removed element must be gone already.
+static void DeleteSigElements(DxilModule &DM, DxilSignature &Sig,
+                              const std::vector<bool> &Deleted,
+                              ArrayRef<OP::OpCode> OpCodes) {
+  std::vector<unsigned> NewIDs = Sig.DeleteElements(Deleted);
+  std::vector<CallInst *> Calls;
+  CollectSigCalls(*DM.GetModule(), OpCodes, Calls);
+  for (CallInst *CI : Calls) {
+    unsigned NewID = NewIDs[GetSigId(CI)];
+    DXASSERT(NewID != UINT_MAX, "otherwise, call to removed element kept");
+    CI->setArgOperand(kSigIdOpIdx, DM.GetOP()->GetU32Const(NewID));
+  }
+}
+
+// Semantic index ranges of the same name overlap.
+static bool SemanticsOverlap(const DxilSignatureElement &A,
+                             const DxilSignatureElement &B) {
+  if (!A.GetSemanticName().equals_lower(B.GetSemanticName()))
+    return false;
+  unsigned AStart = A.GetSemanticStartIndex();
+  unsigned BStart = B.GetSemanticStartIndex();
+  return AStart < BStart + B.GetRows() && BStart < AStart + A.GetRows();
+}
+
+// The producer output that provides all of input In, if any.
+static DxilSignatureElement *FindSource(DxilSignature &Outputs,
+                                        const DxilSignatureElement &In) {
+  for (auto &Out : Outputs.GetElements()) {
+    if (Out->GetSemanticName().equals_lower(In.GetSemanticName()) &&
+        Out->GetSemanticStartIndex() == In.GetSemanticStartIndex() &&
+        In.GetRows() <= Out->GetRows() && In.GetCols() <= Out->GetCols())
+      return Out.get();
+  }
+  return nullptr;
+}
+
+// Removes the arbitrary-semantic inputs that Consumer never reads. The
+// usage masks of the others are made to include the components read by
+// attribute evaluation, which the compiler does not record.
+static bool RemoveUnreadInputs(DxilModule &Consumer) {
+  DxilSignature &Inputs = Consumer.GetInputSignature();
+  std::vector<CallInst *> Calls;
+  CollectSigCalls(*Consumer.GetModule(), kInputSigOps, Calls);
+  std::vector<bool> Read(Inputs.GetElements().size(), false);
+  for (CallInst *CI : Calls) {
+    unsigned ID = GetSigId(CI);
+    Read[ID] = true;
+    DxilSignatureElement &In = Inputs.GetElement(ID);
+    if (ConstantInt *Col = dyn_cast<ConstantInt>(
+            CI->getArgOperand(DXIL::OperandIndex::kLoadInputColOpIdx)))
+      In.SetUsageMask(In.GetUsageMask() | (1 << Col->getZExtValue()));
+    else
+      In.SetUsageMask((1 << In.GetCols()) - 1);
+  }
+
+  std::vector<bool> Deleted(Read.size(), false);
+  bool bDeleted = false;
+  for (auto &In : Inputs.GetElements()) {
+    unsigned ID = In->GetID();
+    if (!Read[ID] && In->IsArbitrary()) {
+      Deleted[ID] = true;
+      bDeleted = true;
+    }
+  }
+  if (bDeleted)
+    DeleteSigElements(Consumer, Inputs, Deleted, kInputSigOps);
+  return bDeleted;
+}
+
+// The consumer input that starts at the same semantic as Out, if any.
+static const DxilSignatureElement *FindReader(const DxilSignature &Inputs,
+                                              const DxilSignatureElement &Out) {
+  for (auto &In : Inputs.GetElements()) {
+    if (In->GetSemanticName().equals_lower(Out.GetSemanticName()) &&
+        In->GetSemanticStartIndex() == Out.GetSemanticStartIndex())
+      return In.get();
+  }
+  return nullptr;
+}
+
+// Removes the arbitrary-semantic outputs of Producer that no element of
+// Inputs reads, and the stores to components of the others that the
+// matching input never reads, together with the computation that only fed
+// them. Input usage masks are relative to the element, as store columns
+// are, so components line up by semantic whatever the locations.
+static bool RemoveUnreadOutputs(DxilModule &Producer,
+                                const DxilSignature &Inputs) {
+  DxilSignature &Outputs = Producer.GetOutputSignature();
+  std::vector<bool> Deleted(Outputs.GetElements().size(), false);
+  std::vector<unsigned> UnreadComps(Outputs.GetElements().size(), 0);
+  for (auto &Out : Outputs.GetElements()) {
+    if (!Out->IsArbitrary())
+      continue;
+    unsigned NumOverlaps = 0;
+    for (auto &In : Inputs.GetElements())
+      NumOverlaps += SemanticsOverlap(*Out, *In);
+    if (NumOverlaps == 0) {
+      Deleted[Out->GetID()] = true;
+      continue;
+    }
+    // Only one input covering all rows can say a component is unread.
+    const DxilSignatureElement *In = FindReader(Inputs, *Out);
+    if (NumOverlaps == 1 && In && In->GetRows() == Out->GetRows())
+      UnreadComps[Out->GetID()] =
+          ((1 << Out->GetCols()) - 1) & ~In->GetUsageMask();
+  }
+
+  std::vector<CallInst *> Calls;
+  CollectSigCalls(*Producer.GetModule(), kOutputSigOps, Calls);
+  // The patch constant function of a hull shader may read back its
+  // outputs; those have to stay.
+  for (CallInst *CI : Calls) {
+    if (OP::IsDxilOpFuncCallInst(CI, OP::OpCode::LoadOutputControlPoint)) {
+      Deleted[GetSigId(CI)] = false;
+      UnreadComps[GetSigId(CI)] = 0;
+    }
+  }
+
+  bool bUpdated = false;
+  for (CallInst *CI : Calls) {
+    unsigned ID = GetSigId(CI);
+    if (!Deleted[ID]) {
+      if (!UnreadComps[ID])
+        continue;
+      ConstantInt *Col = cast<ConstantInt>(
+          CI->getArgOperand(DXIL::OperandIndex::kStoreOutputColOpIdx));
+      if (!(UnreadComps[ID] & (1 << Col->getZExtValue())))
+        continue;
+    }
+    Value *V = CI->getArgOperand(DXIL::OperandIndex::kStoreOutputValOpIdx);
+    CI->eraseFromParent();
+    RecursivelyDeleteTriviallyDeadInstructions(V);
+    bUpdated = true;
+  }
+  for (auto &Out : Outputs.GetElements()) {
+    unsigned Mask = Out->GetUsageMask() & ~UnreadComps[Out->GetID()];
+    if (Mask != Out->GetUsageMask()) {
+      Out->SetUsageMask(Mask);
+      bUpdated = true;
+    }
+  }
+  if (std::find(Deleted.begin(), Deleted.end(), true) != Deleted.end()) {
+    DeleteSigElements(Producer, Outputs, Deleted, kOutputSigOps);
+    bUpdated = true;
+  }
+  return bUpdated;
+}
+
+// Packs the producer outputs and copies the locations to the consumer
+// inputs. Returns false, without changes, if an input has no output that
+// provides all of it.
+static bool PackMatchedElements(DxilModule &Producer, DxilModule &Consumer,
+                                DXIL::PackingStrategy packing) {
+  DxilSignature &Outputs = Producer.GetOutputSignature();
+  DxilSignature &Inputs = Consumer.GetInputSignature();
+  if (Outputs.UseMinPrecision() != Inputs.UseMinPrecision())
+    return false;
+
+  std::vector<DxilSignatureElement *> Sources;
+  for (auto &In : Inputs.GetElements()) {
+    DxilSignatureElement *Out = nullptr;
+    if (DxilSignature::ShouldBeAllocated(In->GetInterpretation())) {
+      Out = FindSource(Outputs, *In);
+      if (!Out || !DxilSignature::ShouldBeAllocated(Out->GetInterpretation()))
+        return false;
+    }
+    Sources.push_back(Out);
+  }
+
+  bool bUseMinPrecision = Outputs.UseMinPrecision();
+  std::vector<DxilInterstagePackElement> packElements;
+  for (auto &Out : Outputs.GetElements()) {
+    if (!DxilSignature::ShouldBeAllocated(Out->GetInterpretation()))
+      continue;
+    DXIL::InterpolationMode Mode = Out->GetInterpolationMode()->GetKind();
+    if (Consumer.GetShaderModel()->IsPS()) {
+      for (unsigned i = 0; i < Sources.size(); ++i) {
+        if (Sources[i] == Out.get())
+          Mode = Inputs.GetElement(i).GetInterpolationMode()->GetKind();
+      }
+    }
+    packElements.emplace_back(Out.get(), bUseMinPrecision, Mode);
+  }
+
+  DxilSignatureAllocator alloc(32, bUseMinPrecision);
+  std::vector<DxilSignatureAllocator::PackElement *> elements;
+  elements.reserve(packElements.size());
+  for (auto &SE : packElements) {
+    SE.ClearLocation();
+    elements.push_back(&SE);
+  }
+  switch (packing) {
+  case DXIL::PackingStrategy::PrefixStable:
+    alloc.PackPrefixStable(elements, 0, 32);
+    break;
+  case DXIL::PackingStrategy::Optimized:
+    alloc.PackOptimized(elements, 0, 32);
+    break;
+  default:
+    DXASSERT(false, "otherwise, invalid packing strategy supplied");
+  }
+
+  for (unsigned i = 0; i < Sources.size(); ++i) {
+    if (!Sources[i])
+      continue;
+    DxilSignatureElement &In = Inputs.GetElement(i);
+    In.SetStartRow(Sources[i]->GetStartRow());
+    In.SetStartCol(Sources[i]->GetStartCol());
+  }
+  return true;
+}
+
+// Brings the view ID state and the metadata up to date with the in-memory
+// signatures.
+static void UpdateModule(DxilModule &DM) {
+  Module &M = *DM.GetModule();
+  legacy::PassManager PM;
+  PM.add(createComputeViewIdStatePass());
+  PM.run(M);
+  DxilModule::ClearDxilMetadata(M);
+  DM.EmitDxilMetadata();
+}
+
+namespace hlsl {
+bool PackInterstageSignatures(DxilModule &Producer, DxilModule &Consumer,
+                              DXIL::PackingStrategy packing) {
+  const ShaderModel *ProducerSM = Producer.GetShaderModel();
+  const ShaderModel *ConsumerSM = Consumer.GetShaderModel();
+  if (!IsSupportedPair(ProducerSM->GetKind(), ConsumerSM->GetKind()))
+    return false;
+  // Only the rasterized stream of a geometry shader reaches the pixel
+  // shader, and mesh shader primitive attributes come from a signature of
+  // their own; both are left to the single-stage packing.
+  DxilSignature &Outputs = Producer.GetOutputSignature();
+  for (auto &Out : Outputs.GetElements()) {
+    if (Out->GetOutputStream() != 0)
+      return false;
+  }
+  if (ProducerSM->IsMS() &&
+      !Producer.GetPatchConstOrPrimSignature().GetElements().empty())
+    return false;
+
+  bool bUpdated = RemoveUnreadInputs(Consumer);
+  bUpdated |= RemoveUnreadOutputs(Producer, Consumer.GetInputSignature());
+  bUpdated |= PackMatchedElements(Producer, Consumer, packing);
+  if (bUpdated) {
+    UpdateModule(Producer);
+    UpdateModule(Consumer);
+  }
+  return bUpdated;
+}
+
+bool EliminateUnreadOutputs(DxilModule &Producer,
+                            const DxilSignature &ConsumerInputs) {
+  const ShaderModel *SM = Producer.GetShaderModel();
+  if (!(SM->IsVS() || SM->IsHS() || SM->IsDS() || SM->IsGS() || SM->IsMS()))
+    return false;
+  // Other streams do not reach the consumer.
+  for (auto &Out : Producer.GetOutputSignature().GetElements()) {
+    if (Out->GetOutputStream() != 0)
+      return false;
+  }
+  if (!RemoveUnreadOutputs(Producer, ConsumerInputs))
+    return false;
+  UpdateModule(Producer);
+  return true;
+}
+
+bool PackPipelineSignatures(ArrayRef<DxilModule *> Stages,
+                            DXIL::PackingStrategy packing) {
+  // Going from the last stage back, inputs that a stage stops reading
+  // once its own unread outputs are gone are removed from the stage
+  // before it as well.
+  bool bUpdated = false;
+  for (unsigned i = Stages.size(); i > 1; --i)
+    bUpdated |= PackInterstageSignatures(*Stages[i - 2], *Stages[i - 1],
+                                         packing);
+  return bUpdated;
+}
+} // namespace hlsl
@@ -41,6 +41,7 @@
 #include <unordered_set>
 #include <functional>
 #include <unordered_map>
+#include <map>
 #include <array>
 
 struct D3D12_VERSIONED_ROOT_SIGNATURE_DESC;
@@ -95,6 +96,20 @@ struct ShaderRecordEntry {
   bool IsInvalid() { return (unsigned int)ParameterType == (unsigned int)-1; }
 };
 
+// A contiguous register range of one resource class and space that the local
+// root signature places in the shader record. Root constants and root
+// descriptors cover a single register.
+struct ShaderRecordBinding {
+  unsigned int BaseRegister;
+  unsigned int NumRegisters;
+  ShaderRecordEntry Entry;
+};
+
+// Bindings keyed by (resource class, register space), in root parameter order.
+typedef std::map<std::pair<unsigned int, unsigned int>,
+                 std::vector<ShaderRecordBinding>>
+    ShaderRecordBindingMap;
+
 struct D3D12_VERSIONED_ROOT_SIGNATURE_DESC;
 class DxilPatchShaderRecordBindings : public ModulePass {
 public:
@@ -152,7 +167,9 @@ private:
   // Unlike the LLVM version of this function, this does not requires the InstructionToReplace and the ValueToReplaceWith to be the same instruction type
   static void ReplaceUsesOfWith(llvm::Instruction *InstructionToReplace, llvm::Value *ValueToReplaceWith);
 
-  static ShaderRecordEntry FindRootSignatureDescriptor(const DxilVersionedRootSignatureDesc &rootSignatureDescriptor, unsigned int ShaderRecordIdentifierSizeInBytes, DXIL::ResourceClass resourceClass, unsigned int baseRegisterIndex, unsigned int registerSpace);
+  void BuildResourceSymbolMap(DxilModule &DM);
+  void BuildShaderRecordBindingMap();
+  ShaderRecordEntry FindShaderRecordEntry(DXIL::ResourceClass resourceClass, unsigned int baseRegisterIndex, unsigned int registerSpace) const;
 
   // TODO: I would like to see these prefixed with m_
   llvm::Value *ShaderTableHandle = nullptr;
@@ -173,6 +190,12 @@ private:
   std::unordered_map<ViewKey, llvm::Value *, ViewKeyHasher>
       TypeToAliasedDescriptorHeap[NumViewTypes];
 
+  // Both are built once per run so that resolving each handle in the entry
+  // point is a lookup rather than a walk of the resource lists and of the
+  // root signature.
+  std::unordered_map<llvm::Value *, hlsl::DxilResourceBase *> ResourceSymbolMap;
+  ShaderRecordBindingMap ShaderRecordBindings;
+
   llvm::Function *EntryPointFunction;
 
   ShaderInfo *pInputShaderInfo;
@@ -393,6 +416,8 @@ bool DxilPatchShaderRecordBindings::runOnModule(Module &M) {
 
   ValidateParameters();
   InitializeViewTable();
+  BuildResourceSymbolMap(DM);
+  BuildShaderRecordBindingMap();
 
   PatchShaderBindings(M);
   DM.ReEmitDxilResources();
@@ -702,7 +727,20 @@ unsigned int GetResolvedRangeID(DXIL::ResourceClass resClass, Value *rangeIdVal)
   }
 }
 
-// TODO: This code is quite inefficient
+void DxilPatchShaderRecordBindings::BuildResourceSymbolMap(DxilModule &DM) {
+  // Classes are added in the order handles were previously resolved in, so
+  // that the first resource declared for a symbol wins.
+  ResourceSymbolMap.clear();
+  for (auto &cbuffer : DM.GetCBuffers())
+    ResourceSymbolMap.emplace(cbuffer->GetGlobalSymbol(), cbuffer.get());
+  for (auto &srv : DM.GetSRVs())
+    ResourceSymbolMap.emplace(srv->GetGlobalSymbol(), srv.get());
+  for (auto &uav : DM.GetUAVs())
+    ResourceSymbolMap.emplace(uav->GetGlobalSymbol(), uav.get());
+  for (auto &sampler : DM.GetSamplers())
+    ResourceSymbolMap.emplace(sampler->GetGlobalSymbol(), sampler.get());
+}
+
 bool DxilPatchShaderRecordBindings::GetHandleInfo(
   Module &M,
   DxilInst_CreateHandleForLib &createHandleStructForLib,
@@ -712,64 +750,13 @@ bool DxilPatchShaderRecordBindings::GetHandleInfo(
   _Out_ DXIL::ResourceClass &resClass,
   _Out_ llvm::Type *&resType)
 {
-  DxilModule &DM = M.GetOrCreateDxilModule();
-  LoadInst *loadRangeId = cast<LoadInst>(createHandleStructForLib.get_Resource());
-  Value *ResourceSymbol = loadRangeId->getPointerOperand();
-
-  DXIL::ResourceClass resourceClasses[] = {
-    DXIL::ResourceClass::CBuffer,
-    DXIL::ResourceClass::SRV,
-    DXIL::ResourceClass::UAV,
-    DXIL::ResourceClass::Sampler
-  };
+  LoadInst *loadRangeId = dyn_cast<LoadInst>(createHandleStructForLib.get_Resource());
+  if (!loadRangeId)
+    return false;
 
-  hlsl::DxilResourceBase *Resource = nullptr;
-  for (auto &resourceClass : resourceClasses) {
-    
-    switch (resourceClass)
-    {
-    case DXIL::ResourceClass::CBuffer:
-    {
-      auto &cbuffers = DM.GetCBuffers();
-      for (auto &cbuffer : cbuffers)
-      {
-        if (cbuffer->GetGlobalSymbol() == ResourceSymbol)
-        {
-          Resource = cbuffer.get();
-          break;
-        }
-      }
-      break;
-    }
-    case DXIL::ResourceClass::SRV:
-    case DXIL::ResourceClass::UAV:
-    {
-      auto &viewList = resourceClass == DXIL::ResourceClass::SRV ? DM.GetSRVs() : DM.GetUAVs();
-      for (auto &view : viewList)
-      {
-        if (view->GetGlobalSymbol() == ResourceSymbol)
-        {
-          Resource = view.get();
-          break;
-        }
-      }
-      break;
-    }
-    case DXIL::ResourceClass::Sampler:
-    {
-      auto &samplers = DM.GetSamplers();
-      for (auto &sampler : samplers)
-      {
-        if (sampler->GetGlobalSymbol() == ResourceSymbol)
-        {
-          Resource = sampler.get();
-          break;
-        }
-      }
-      break;
-    }
-    }
-  }
+  auto it = ResourceSymbolMap.find(loadRangeId->getPointerOperand());
+  hlsl::DxilResourceBase *Resource =
+      it != ResourceSymbolMap.end() ? it->second : nullptr;
 
   if (Resource)
   {
@@ -844,134 +831,136 @@ void DxilPatchShaderRecordBindings::PatchShaderBindings(Module &M) {
   DxilModule &DM = M.GetOrCreateDxilModule();
   OP *HlslOP = DM.GetOP();
 
-  // Don't erase instructions until the very end because it throws off the iterator
-  std::vector<llvm::Instruction *> instructionsToRemove;
+  // Gather the handles up front; patching inserts handle creations of its own.
+  std::vector<llvm::Instruction *> createHandles;
   for (BasicBlock &block : EntryPointFunction->getBasicBlockList()) {
-    auto & Instructions = block.getInstList();
-
-    for (auto &instr : Instructions) {
-      DxilInst_CreateHandleForLib createHandleForLib(&instr);
-      if (createHandleForLib) {
-        DXIL::ResourceClass resourceClass;
-        unsigned int registerSpace;
-        unsigned int registerIndex;
-        DXIL::ResourceKind kind;
-        llvm::Type *resType;
-        bool resourceIsResolved = true;
-        resourceIsResolved = GetHandleInfo(M, createHandleForLib, registerIndex, registerSpace, kind, resourceClass, resType);
-
-        if (!resourceIsResolved) continue; // TODO: This shouldn't actually be happening?
-
-        ShaderRecordEntry shaderRecord = FindRootSignatureDescriptor(
-          *pRootSignatureDesc,
-          pInputShaderInfo->ShaderRecordIdentifierSizeInBytes,
-          resourceClass,
-          registerIndex,
-          registerSpace);
-
-        const bool IsBindingSpecifiedInLocalRootSignature = !shaderRecord.IsInvalid();
-        if (IsBindingSpecifiedInLocalRootSignature) {
-          if (!DispatchRaysConstantsHandle) {
-            AddInputBinding(M);
-          }
+    for (auto &instr : block.getInstList()) {
+      if (DxilInst_CreateHandleForLib(&instr))
+        createHandles.push_back(&instr);
+    }
+  }
 
-          switch (shaderRecord.ParameterType) {
-          case DxilRootParameterType::Constants32Bit:
-          {
-            for (User *U : instr.users()) {
-              llvm::Instruction *instruction = cast<CallInst>(U);
-              if (IsCBufferLoad(instruction)) {
-                llvm::Instruction *cbufferLoadInstr = instruction;
-                IRBuilder<> Builder(cbufferLoadInstr);
-
-                llvm::Value * cbufferOffsetInBytes = CreateCBufferLoadOffsetInBytes(M, Builder, cbufferLoadInstr);
-                llvm::Value *LocalOffsetToRootConstant = CreateOffsetToShaderRecord(M, Builder, shaderRecord.RecordOffsetInBytes, cbufferOffsetInBytes);
-                llvm::Value *GlobalOffsetToRootConstant = Builder.CreateAdd(LocalOffsetToRootConstant, BaseShaderRecordOffset);
-                llvm::Value *srvBufferLoad = CreateShaderRecordBufferLoad(M, Builder, GlobalOffsetToRootConstant, cbufferLoadInstr->getType());
-                ReplaceUsesOfWith(cbufferLoadInstr, srvBufferLoad);
-              } else {
-                ThrowFailure();
-              }
-            }
-            instructionsToRemove.push_back(&instr);
-            break;
-          }
-          case DxilRootParameterType::DescriptorTable:
-          {
-            IRBuilder<> Builder(&instr);
-            llvm::Value *srvBufferLoad = LoadShaderRecordData(
-             M, 
-             Builder, 
-             BaseShaderRecordOffset,
-             shaderRecord.RecordOffsetInBytes);
-
-            llvm::Value *DescriptorTableEntryLo = Builder.CreateExtractValue(srvBufferLoad, 0, "DescriptorTableHandleLo");
-
-            unsigned int offsetToLoadInUints = offsetof(DispatchRaysConstants, SrvCbvUavDescriptorHeapStart) / sizeof(uint32_t);
-            unsigned int uintsPerRow = 4;
-            unsigned int rowToLoad = offsetToLoadInUints / uintsPerRow;
-            unsigned int extractValueOffset = offsetToLoadInUints % uintsPerRow;
-            llvm::Value *DescHeapConstants = CreateCBufferLoadLegacy(M, Builder, DispatchRaysConstantsHandle, rowToLoad);
-            llvm::Value *DescriptorHeapStartAddressLo = Builder.CreateExtractValue(DescHeapConstants, extractValueOffset, "DescriptorHeapStartHandleLo");
-
-            // TODO: The hi bits can only be ignored if the difference is guaranteed to be < 32 bytes. This is an unsafe assumption, particularly given 
-            // large descriptor sizes
-            llvm::Value *DescriptorTableOffsetInBytes = Builder.CreateSub(DescriptorTableEntryLo, DescriptorHeapStartAddressLo, "TableOffsetInBytes");
-
-            Constant *DescriptorSizeInBytes = HlslOP->GetU32Const(pInputShaderInfo->SrvCbvUavDescriptorSizeInBytes);
-            llvm::Value * DescriptorTableStartIndex = Builder.CreateExactUDiv(DescriptorTableOffsetInBytes, DescriptorSizeInBytes, "TableStartIndex");
-
-            Constant *RecordOffset = HlslOP->GetU32Const(shaderRecord.OffsetInDescriptors);
-            llvm::Value * BaseDescriptorIndex = Builder.CreateAdd(DescriptorTableStartIndex, RecordOffset, "BaseDescriptorIndex");
-
-            // TODO: Not supporting dynamic indexing yet, should be pulled from CreateHandleForLib
-            // If dynamic indexing is being used, add the apps index on top of the calculated index
-            llvm::Value * DynamicIndex = HlslOP->GetU32Const(0);
-
-            llvm::Value * DescriptorIndex = Builder.CreateAdd(BaseDescriptorIndex, DynamicIndex, "DescriptorIndex");
-            PatchCreateHandleToUseDescriptorIndex(
-                M, 
-                Builder, 
-                kind, 
-                resourceClass, 
-                resType, 
-                DescriptorIndex, 
-                createHandleForLib);
-            break;
-          }
-          case DxilRootParameterType::CBV:
-          case DxilRootParameterType::SRV:
-          case DxilRootParameterType::UAV: {
-            IRBuilder<> Builder(&instr);
-            llvm::Value *srvBufferLoad = LoadShaderRecordData(
-             M, 
-             Builder, 
-             BaseShaderRecordOffset,
-             shaderRecord.RecordOffsetInBytes);
-
-            llvm::Value *DescriptorIndex = Builder.CreateExtractValue(
-                srvBufferLoad, 1, "DescriptorHeapIndex");
-
-            // TODO: Handle offset in bytes
-            // llvm::Value *OffsetInBytes = Builder.CreateExtractValue(
-            //     srvBufferLoad, 0, "OffsetInBytes");
-
-            PatchCreateHandleToUseDescriptorIndex(
-                M,
-                Builder,
-                kind,
-                resourceClass,
-                resType,
-                DescriptorIndex,
-                createHandleForLib);
+  // Don't erase instructions until the very end because it throws off the iterator
+  std::vector<llvm::Instruction *> instructionsToRemove;
+  for (llvm::Instruction *pInstr : createHandles) {
+    llvm::Instruction &instr = *pInstr;
+    DxilInst_CreateHandleForLib createHandleForLib(&instr);
+    DXIL::ResourceClass resourceClass;
+    unsigned int registerSpace;
+    unsigned int registerIndex;
+    DXIL::ResourceKind kind;
+    llvm::Type *resType;
+    bool resourceIsResolved = true;
+    resourceIsResolved = GetHandleInfo(M, createHandleForLib, registerIndex, registerSpace, kind, resourceClass, resType);
+
+    if (!resourceIsResolved) continue; // TODO: This shouldn't actually be happening?
+
+    ShaderRecordEntry shaderRecord = FindShaderRecordEntry(
+      resourceClass,
+      registerIndex,
+      registerSpace);
+
+    const bool IsBindingSpecifiedInLocalRootSignature = !shaderRecord.IsInvalid();
+    if (IsBindingSpecifiedInLocalRootSignature) {
+      if (!DispatchRaysConstantsHandle) {
+        AddInputBinding(M);
+      }
 
-            break;
-          }
-          default:
+      switch (shaderRecord.ParameterType) {
+      case DxilRootParameterType::Constants32Bit:
+      {
+        for (User *U : instr.users()) {
+          llvm::Instruction *instruction = cast<CallInst>(U);
+          if (IsCBufferLoad(instruction)) {
+            llvm::Instruction *cbufferLoadInstr = instruction;
+            IRBuilder<> Builder(cbufferLoadInstr);
+
+            llvm::Value * cbufferOffsetInBytes = CreateCBufferLoadOffsetInBytes(M, Builder, cbufferLoadInstr);
+            llvm::Value *LocalOffsetToRootConstant = CreateOffsetToShaderRecord(M, Builder, shaderRecord.RecordOffsetInBytes, cbufferOffsetInBytes);
+            llvm::Value *GlobalOffsetToRootConstant = Builder.CreateAdd(LocalOffsetToRootConstant, BaseShaderRecordOffset);
+            llvm::Value *srvBufferLoad = CreateShaderRecordBufferLoad(M, Builder, GlobalOffsetToRootConstant, cbufferLoadInstr->getType());
+            ReplaceUsesOfWith(cbufferLoadInstr, srvBufferLoad);
+          } else {
             ThrowFailure();
-            break;
           }
         }
+        instructionsToRemove.push_back(&instr);
+        break;
+      }
+      case DxilRootParameterType::DescriptorTable:
+      {
+        IRBuilder<> Builder(&instr);
+        llvm::Value *srvBufferLoad = LoadShaderRecordData(
+         M, 
+         Builder, 
+         BaseShaderRecordOffset,
+         shaderRecord.RecordOffsetInBytes);
+
+        llvm::Value *DescriptorTableEntryLo = Builder.CreateExtractValue(srvBufferLoad, 0, "DescriptorTableHandleLo");
+
+        unsigned int offsetToLoadInUints = offsetof(DispatchRaysConstants, SrvCbvUavDescriptorHeapStart) / sizeof(uint32_t);
+        unsigned int uintsPerRow = 4;
+        unsigned int rowToLoad = offsetToLoadInUints / uintsPerRow;
+        unsigned int extractValueOffset = offsetToLoadInUints % uintsPerRow;
+        llvm::Value *DescHeapConstants = CreateCBufferLoadLegacy(M, Builder, DispatchRaysConstantsHandle, rowToLoad);
+        llvm::Value *DescriptorHeapStartAddressLo = Builder.CreateExtractValue(DescHeapConstants, extractValueOffset, "DescriptorHeapStartHandleLo");
+
+        // TODO: The hi bits can only be ignored if the difference is guaranteed to be < 32 bytes. This is an unsafe assumption, particularly given 
+        // large descriptor sizes
+        llvm::Value *DescriptorTableOffsetInBytes = Builder.CreateSub(DescriptorTableEntryLo, DescriptorHeapStartAddressLo, "TableOffsetInBytes");
+
+        Constant *DescriptorSizeInBytes = HlslOP->GetU32Const(pInputShaderInfo->SrvCbvUavDescriptorSizeInBytes);
+        llvm::Value * DescriptorTableStartIndex = Builder.CreateExactUDiv(DescriptorTableOffsetInBytes, DescriptorSizeInBytes, "TableStartIndex");
+
+        Constant *RecordOffset = HlslOP->GetU32Const(shaderRecord.OffsetInDescriptors);
+        llvm::Value * BaseDescriptorIndex = Builder.CreateAdd(DescriptorTableStartIndex, RecordOffset, "BaseDescriptorIndex");
+
+        // TODO: Not supporting dynamic indexing yet, should be pulled from CreateHandleForLib
+        // If dynamic indexing is being used, add the apps index on top of the calculated index
+        llvm::Value * DynamicIndex = HlslOP->GetU32Const(0);
+
+        llvm::Value * DescriptorIndex = Builder.CreateAdd(BaseDescriptorIndex, DynamicIndex, "DescriptorIndex");
+        PatchCreateHandleToUseDescriptorIndex(
+            M, 
+            Builder, 
+            kind, 
+            resourceClass, 
+            resType, 
+            DescriptorIndex, 
+            createHandleForLib);
+        break;
+      }
+      case DxilRootParameterType::CBV:
+      case DxilRootParameterType::SRV:
+      case DxilRootParameterType::UAV: {
+        IRBuilder<> Builder(&instr);
+        llvm::Value *srvBufferLoad = LoadShaderRecordData(
+         M, 
+         Builder, 
+         BaseShaderRecordOffset,
+         shaderRecord.RecordOffsetInBytes);
+
+        llvm::Value *DescriptorIndex = Builder.CreateExtractValue(
+            srvBufferLoad, 1, "DescriptorHeapIndex");
+
+        // TODO: Handle offset in bytes
+        // llvm::Value *OffsetInBytes = Builder.CreateExtractValue(
+        //     srvBufferLoad, 0, "OffsetInBytes");
+
+        PatchCreateHandleToUseDescriptorIndex(
+            M,
+            Builder,
+            kind,
+            resourceClass,
+            resType,
+            DescriptorIndex,
+            createHandleForLib);
+
+        break;
+      }
+      default:
+        ThrowFailure();
+        break;
       }
     }
   }
@@ -982,25 +971,6 @@ void DxilPatchShaderRecordBindings::PatchShaderBindings(Module &M) {
 
 }
 
-bool IsParameterTypeCompatibleWithResourceClass(
-  DXIL::ResourceClass resourceClass,
-  DxilRootParameterType parameterType) {
-  switch (parameterType) {
-  case DxilRootParameterType::DescriptorTable:
-    return true;
-  case DxilRootParameterType::Constants32Bit:
-  case DxilRootParameterType::CBV:
-    return resourceClass == DXIL::ResourceClass::CBuffer;
-  case DxilRootParameterType::SRV:
-    return resourceClass == DXIL::ResourceClass::SRV;
-  case DxilRootParameterType::UAV:
-    return resourceClass == DXIL::ResourceClass::UAV;
-  default:
-    ThrowFailure();
-    return false;
-  }
-}
-
 DxilRootParameterType ConvertD3D12ParameterTypeToDxil(DxilRootParameterType parameter) {
   switch (parameter) {
   case DxilRootParameterType::Constants32Bit:
@@ -1050,99 +1020,109 @@ unsigned int GetParameterTypeAlignment(DxilRootParameterType parameterType) {
 }
 
 template <typename TD3D12_ROOT_SIGNATURE_DESC>
-ShaderRecordEntry FindRootSignatureDescriptorHelper(
+void AddShaderRecordBindingsHelper(
     const TD3D12_ROOT_SIGNATURE_DESC &rootSignatureDescriptor,
     unsigned int ShaderRecordIdentifierSizeInBytes,
-    DXIL::ResourceClass resourceClass, unsigned int baseRegisterIndex,
-    unsigned int registerSpace) {
-  // Automatically fail if it's looking for a fallback binding as these never
-  // need to be patched
-  if (registerSpace != FallbackLayerRegisterSpace) {
-    unsigned int recordOffset = ShaderRecordIdentifierSizeInBytes;
-    for (unsigned int rootParamIndex = 0;
-         rootParamIndex < rootSignatureDescriptor.NumParameters;
-         rootParamIndex++) {
-      auto &rootParam = rootSignatureDescriptor.pParameters[rootParamIndex];
-      auto dxilParamType =
-          ConvertD3D12ParameterTypeToDxil(rootParam.ParameterType);
+    ShaderRecordBindingMap &bindings) {
+  unsigned int recordOffset = ShaderRecordIdentifierSizeInBytes;
+  for (unsigned int rootParamIndex = 0;
+       rootParamIndex < rootSignatureDescriptor.NumParameters;
+       rootParamIndex++) {
+    auto &rootParam = rootSignatureDescriptor.pParameters[rootParamIndex];
+    auto dxilParamType =
+        ConvertD3D12ParameterTypeToDxil(rootParam.ParameterType);
 
 #define ALIGN(alignment, num) (((num + alignment - 1) / alignment) * alignment)
-      recordOffset = ALIGN(GetParameterTypeAlignment(rootParam.ParameterType),
-                           recordOffset);
-
-      switch (rootParam.ParameterType) {
-      case DxilRootParameterType::Constants32Bit:
-        if (IsParameterTypeCompatibleWithResourceClass(resourceClass,
-                                                       dxilParamType) &&
-            baseRegisterIndex == rootParam.Constants.ShaderRegister &&
-            registerSpace == rootParam.Constants.RegisterSpace) {
-          return {dxilParamType, recordOffset, 0};
+    recordOffset = ALIGN(GetParameterTypeAlignment(rootParam.ParameterType),
+                         recordOffset);
+
+    switch (rootParam.ParameterType) {
+    case DxilRootParameterType::Constants32Bit:
+      bindings[{(unsigned int)DXIL::ResourceClass::CBuffer,
+                rootParam.Constants.RegisterSpace}]
+          .push_back({rootParam.Constants.ShaderRegister, 1,
+                      {dxilParamType, recordOffset, 0}});
+      recordOffset += rootParam.Constants.Num32BitValues * sizeof(uint32_t);
+      break;
+    case DxilRootParameterType::DescriptorTable: {
+      auto &descriptorTable = rootParam.DescriptorTable;
+
+      unsigned int rangeOffsetInDescriptors = 0;
+      for (unsigned int rangeIndex = 0;
+           rangeIndex < descriptorTable.NumDescriptorRanges; rangeIndex++) {
+        auto &range = descriptorTable.pDescriptorRanges[rangeIndex];
+        if (range.OffsetInDescriptorsFromTableStart != (unsigned)-1) {
+          rangeOffsetInDescriptors = range.OffsetInDescriptorsFromTableStart;
         }
-        recordOffset += rootParam.Constants.Num32BitValues * sizeof(uint32_t);
-        break;
-      case DxilRootParameterType::DescriptorTable: {
-        auto &descriptorTable = rootParam.DescriptorTable;
-
-        unsigned int rangeOffsetInDescriptors = 0;
-        for (unsigned int rangeIndex = 0;
-             rangeIndex < descriptorTable.NumDescriptorRanges; rangeIndex++) {
-          auto &range = descriptorTable.pDescriptorRanges[rangeIndex];
-          if (range.OffsetInDescriptorsFromTableStart != (unsigned)-1) {
-            rangeOffsetInDescriptors = range.OffsetInDescriptorsFromTableStart;
-          }
 
-          if (ConvertD3D12RangeTypeToDxil(range.RangeType) == resourceClass &&
-              range.RegisterSpace == registerSpace &&
-              range.BaseShaderRegister <= baseRegisterIndex &&
-              range.BaseShaderRegister + range.NumDescriptors >
-                  baseRegisterIndex) {
-            rangeOffsetInDescriptors +=
-                baseRegisterIndex - range.BaseShaderRegister;
-            return {dxilParamType, recordOffset, rangeOffsetInDescriptors};
-          }
+        bindings[{(unsigned int)ConvertD3D12RangeTypeToDxil(range.RangeType),
+                  range.RegisterSpace}]
+            .push_back({range.BaseShaderRegister, range.NumDescriptors,
+                        {dxilParamType, recordOffset,
+                         rangeOffsetInDescriptors}});
 
-          rangeOffsetInDescriptors += range.NumDescriptors;
-        }
-
-        recordOffset += SizeofD3D12GpuDescriptorHandle;
-        break;
+        rangeOffsetInDescriptors += range.NumDescriptors;
       }
-      case DxilRootParameterType::CBV:
-      case DxilRootParameterType::SRV:
-      case DxilRootParameterType::UAV:
-        if (IsParameterTypeCompatibleWithResourceClass(resourceClass,
-                                                       dxilParamType) &&
-            baseRegisterIndex == rootParam.Descriptor.ShaderRegister &&
-            registerSpace == rootParam.Descriptor.RegisterSpace) {
-          return {dxilParamType, recordOffset, 0};
-        }
 
-        recordOffset += SizeofD3D12GpuVA;
-        break;
-      }
+      recordOffset += SizeofD3D12GpuDescriptorHandle;
+      break;
+    }
+    case DxilRootParameterType::CBV:
+    case DxilRootParameterType::SRV:
+    case DxilRootParameterType::UAV: {
+      DXIL::ResourceClass resourceClass =
+          dxilParamType == DxilRootParameterType::CBV
+              ? DXIL::ResourceClass::CBuffer
+              : dxilParamType == DxilRootParameterType::SRV
+                    ? DXIL::ResourceClass::SRV
+                    : DXIL::ResourceClass::UAV;
+      bindings[{(unsigned int)resourceClass, rootParam.Descriptor.RegisterSpace}]
+          .push_back({rootParam.Descriptor.ShaderRegister, 1,
+                      {dxilParamType, recordOffset, 0}});
+
+      recordOffset += SizeofD3D12GpuVA;
+      break;
+    }
     }
   }
-  return ShaderRecordEntry::InvalidEntry();
 }
 
-// TODO: Consider pre-calculating this into a map
-ShaderRecordEntry DxilPatchShaderRecordBindings::FindRootSignatureDescriptor(
-  const DxilVersionedRootSignatureDesc &rootSignatureDescriptor,
-  unsigned int ShaderRecordIdentifierSizeInBytes,
-  DXIL::ResourceClass resourceClass,
-  unsigned int baseRegisterIndex,
-  unsigned int registerSpace) {
-  switch (rootSignatureDescriptor.Version) {
+void DxilPatchShaderRecordBindings::BuildShaderRecordBindingMap() {
+  ShaderRecordBindings.clear();
+  switch (pRootSignatureDesc->Version) {
   case DxilRootSignatureVersion::Version_1_0:
-    return FindRootSignatureDescriptorHelper(rootSignatureDescriptor.Desc_1_0, ShaderRecordIdentifierSizeInBytes, resourceClass, baseRegisterIndex, registerSpace);
+    AddShaderRecordBindingsHelper(pRootSignatureDesc->Desc_1_0, pInputShaderInfo->ShaderRecordIdentifierSizeInBytes, ShaderRecordBindings);
+    break;
   case DxilRootSignatureVersion::Version_1_1:
-    return FindRootSignatureDescriptorHelper(rootSignatureDescriptor.Desc_1_1, ShaderRecordIdentifierSizeInBytes, resourceClass, baseRegisterIndex, registerSpace);
+    AddShaderRecordBindingsHelper(pRootSignatureDesc->Desc_1_1, pInputShaderInfo->ShaderRecordIdentifierSizeInBytes, ShaderRecordBindings);
+    break;
   default:
     ThrowFailure();
-    return ShaderRecordEntry::InvalidEntry();
   }
 }
 
+ShaderRecordEntry DxilPatchShaderRecordBindings::FindShaderRecordEntry(
+  DXIL::ResourceClass resourceClass,
+  unsigned int baseRegisterIndex,
+  unsigned int registerSpace) const {
+  // Automatically fail if it's looking for a fallback binding as these never
+  // need to be patched
+  if (registerSpace == FallbackLayerRegisterSpace)
+    return ShaderRecordEntry::InvalidEntry();
 
+  auto it = ShaderRecordBindings.find({(unsigned int)resourceClass, registerSpace});
+  if (it == ShaderRecordBindings.end())
+    return ShaderRecordEntry::InvalidEntry();
 
-
+  // The first parameter in root signature order that covers the register wins.
+  for (const ShaderRecordBinding &binding : it->second) {
+    if (binding.BaseRegister <= baseRegisterIndex &&
+        baseRegisterIndex - binding.BaseRegister < binding.NumRegisters) {
+      ShaderRecordEntry entry = binding.Entry;
+      if (entry.ParameterType == DxilRootParameterType::DescriptorTable)
+        entry.OffsetInDescriptors += baseRegisterIndex - binding.BaseRegister;
+      return entry;
+    }
+  }
+  return ShaderRecordEntry::InvalidEntry();
+}
@@ -0,0 +1,361 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// DxilPerfReport.cpp                                                        //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Static cost estimate of a DXIL module, for -Qperf-report.                 //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#include "dxc/HLSL/DxilPerfReport.h"
+#include "dxc/HLSL/DxilRegisterPressure.h"
+#include "dxc/DXIL/DxilCounters.h"
+#include "dxc/DXIL/DxilOperations.h"
+#include "dxc/DXIL/DxilInstructions.h"
+#include "dxc/DXIL/DxilUtil.h"
+
+#include "llvm/ADT/DenseSet.h"
+#include "llvm/Analysis/LoopInfo.h"
+#include "llvm/Analysis/ScalarEvolution.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/IntrinsicInst.h"
+#include "llvm/IR/LegacyPassManager.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IR/Operator.h"
+#include "llvm/Pass.h"
+#include "llvm/Support/TimeProfiler.h"
+#include "llvm/Support/raw_ostream.h"
+
+using namespace llvm;
+using namespace hlsl;
+
+namespace {
+
+// Instruction classes, with the rough relative cost of one instruction of
+// each class that the weighted counts are folded into.
+enum class InstClass : unsigned {
+  FP32,
+  FP16,
+  FP64,
+  Int,
+  Transcendental,
+  Texture,
+  Buffer,
+  Atomic,
+  Wave,
+  CBuffer,
+  LocalMemory,
+  Branch,
+  Other,
+  Count
+};
+
+struct InstClassInfo {
+  const char *Name;
+  unsigned Cost;
+};
+
+const InstClassInfo kInstClasses[] = {
+    {"fp32", 2},    {"fp16", 1},   {"fp64", 8},           {"int", 2},
+    {"transcendental", 8},         {"texture", 32},       {"buffer", 16},
+    {"atomic", 32}, {"wave", 4},   {"cbuffer", 4},        {"localMemory", 8},
+    {"branch", 2},  {"other", 1}};
+static_assert(_countof(kInstClasses) == (unsigned)InstClass::Count,
+              "else kInstClasses is out of sync with InstClass");
+
+// Trip count assumed for loops whose trip count is not a known constant.
+const unsigned kUnknownTripCount = 8;
+
+// DxilCounters reported with the module, by the names LookupByName takes.
+const char *const kCounterNames[] = {
+    "insts",             "floats",           "ints",
+    "uints",             "branches",         "atomic",
+    "barrier",           "fence",            "sig_ld",
+    "sig_st",            "tex_norm",         "tex_bias",
+    "tex_cmp",           "tex_grad",         "tex_load",
+    "tex_store",         "gs_emit",          "gs_cut",
+    "array_local_bytes", "array_local_ldst", "array_static_bytes",
+    "array_static_ldst", "array_tgsm_bytes", "array_tgsm_ldst"};
+
+struct FunctionCost {
+  std::string Name;
+  uint64_t Static[(unsigned)InstClass::Count] = {};
+  uint64_t Weighted[(unsigned)InstClass::Count] = {};
+  unsigned PeakLive = 0;
+  unsigned Loops = 0;
+  unsigned MaxLoopDepth = 0;
+  unsigned CBufferLoads = 0;
+  unsigned CBufferRows = 0;
+  unsigned CBufferDynamicLoads = 0;
+  unsigned DynamicTemps = 0;
+  uint64_t DynamicTempBytes = 0;
+
+  uint64_t GetCost() const {
+    uint64_t Cost = 0;
+    for (unsigned i = 0; i < (unsigned)InstClass::Count; ++i)
+      Cost += Weighted[i] * kInstClasses[i].Cost;
+    return Cost;
+  }
+};
+
+InstClass ClassifyByType(Type *Ty) {
+  Ty = Ty->getScalarType();
+  if (Ty->isHalfTy())
+    return InstClass::FP16;
+  if (Ty->isFloatTy())
+    return InstClass::FP32;
+  if (Ty->isDoubleTy())
+    return InstClass::FP64;
+  if (Ty->isIntegerTy())
+    return InstClass::Int;
+  return InstClass::Other;
+}
+
+InstClass ClassifyDxilOp(CallInst *CI) {
+  OP::OpCode Op = OP::GetDxilOpFuncCallInst(CI);
+  if (OP::IsDxilOpWave(Op))
+    return InstClass::Wave;
+  switch (Op) {
+  case OP::OpCode::Cos:
+  case OP::OpCode::Sin:
+  case OP::OpCode::Tan:
+  case OP::OpCode::Acos:
+  case OP::OpCode::Asin:
+  case OP::OpCode::Atan:
+  case OP::OpCode::Hcos:
+  case OP::OpCode::Hsin:
+  case OP::OpCode::Htan:
+  case OP::OpCode::Exp:
+  case OP::OpCode::Log:
+  case OP::OpCode::Sqrt:
+  case OP::OpCode::Rsqrt:
+    return InstClass::Transcendental;
+  case OP::OpCode::Sample:
+  case OP::OpCode::SampleBias:
+  case OP::OpCode::SampleLevel:
+  case OP::OpCode::SampleGrad:
+  case OP::OpCode::SampleCmp:
+  case OP::OpCode::SampleCmpLevel:
+  case OP::OpCode::SampleCmpLevelZero:
+  case OP::OpCode::TextureGather:
+  case OP::OpCode::TextureGatherCmp:
+  case OP::OpCode::TextureGatherRaw:
+  case OP::OpCode::TextureLoad:
+  case OP::OpCode::TextureStore:
+  case OP::OpCode::TextureStoreSample:
+  case OP::OpCode::CalculateLOD:
+  case OP::OpCode::WriteSamplerFeedback:
+  case OP::OpCode::WriteSamplerFeedbackBias:
+  case OP::OpCode::WriteSamplerFeedbackLevel:
+  case OP::OpCode::WriteSamplerFeedbackGrad:
+    return InstClass::Texture;
+  case OP::OpCode::BufferLoad:
+  case OP::OpCode::BufferStore:
+  case OP::OpCode::RawBufferLoad:
+  case OP::OpCode::RawBufferStore:
+    return InstClass::Buffer;
+  case OP::OpCode::AtomicBinOp:
+  case OP::OpCode::AtomicCompareExchange:
+  case OP::OpCode::BufferUpdateCounter:
+    return InstClass::Atomic;
+  case OP::OpCode::CBufferLoad:
+  case OP::OpCode::CBufferLoadLegacy:
+    return InstClass::CBuffer;
+  default:
+    return ClassifyByType(CI->getType());
+  }
+}
+
+// Returns the class of I, or Count for instructions that are not counted,
+// such as phis and address computations.
+InstClass Classify(Instruction *I) {
+  if (CallInst *CI = dyn_cast<CallInst>(I)) {
+    if (OP::IsDxilOpFuncCallInst(CI))
+      return ClassifyDxilOp(CI);
+    if (isa<DbgInfoIntrinsic>(CI))
+      return InstClass::Count;
+    return InstClass::Other;
+  }
+  if (isa<PHINode>(I) || isa<GetElementPtrInst>(I) || isa<AllocaInst>(I) ||
+      isa<ReturnInst>(I) || isa<UnreachableInst>(I) || isa<BitCastInst>(I))
+    return InstClass::Count;
+  if (isa<BranchInst>(I) || isa<SwitchInst>(I))
+    return cast<TerminatorInst>(I)->getNumSuccessors() > 1 ? InstClass::Branch
+                                                          : InstClass::Count;
+  if (isa<LoadInst>(I) || isa<StoreInst>(I))
+    return InstClass::LocalMemory;
+  if (isa<AtomicRMWInst>(I) || isa<AtomicCmpXchgInst>(I))
+    return InstClass::Atomic;
+  if (isa<CmpInst>(I) || isa<CastInst>(I))
+    return ClassifyByType(I->getOperand(0)->getType());
+  return ClassifyByType(I->getType());
+}
+
+uint64_t SaturatingMul(uint64_t A, uint64_t B) {
+  if (A != 0 && B > UINT64_MAX / A)
+    return UINT64_MAX;
+  return A * B;
+}
+
+// Collects the cost of each function it is run on.
+class DxilPerfReportCollector : public FunctionPass {
+public:
+  static char ID;
+  std::vector<FunctionCost> Costs;
+
+  DxilPerfReportCollector() : FunctionPass(ID) {}
+
+  StringRef getPassName() const override { return "DXIL perf report"; }
+
+  void getAnalysisUsage(AnalysisUsage &AU) const override {
+    AU.addRequired<LoopInfoWrapperPass>();
+    AU.addRequired<ScalarEvolution>();
+    AU.setPreservesAll();
+  }
+
+  bool runOnFunction(Function &F) override;
+
+private:
+  uint64_t getMultiplier(Loop *L, ScalarEvolution &SE);
+  void countDynamicTemps(Function &F, FunctionCost &Cost);
+};
+
+char DxilPerfReportCollector::ID = 0;
+
+uint64_t DxilPerfReportCollector::getMultiplier(Loop *L, ScalarEvolution &SE) {
+  uint64_t Multiplier = 1;
+  for (; L; L = L->getParentLoop()) {
+    unsigned TripCount = SE.getSmallConstantTripCount(L);
+    Multiplier = SaturatingMul(Multiplier, TripCount ? TripCount
+                                                     : kUnknownTripCount);
+  }
+  return Multiplier;
+}
+
+void DxilPerfReportCollector::countDynamicTemps(Function &F,
+                                                FunctionCost &Cost) {
+  const DataLayout &DL = F.getParent()->getDataLayout();
+  for (Instruction &I : F.getEntryBlock()) {
+    AllocaInst *AI = dyn_cast<AllocaInst>(&I);
+    if (!AI || !AI->getAllocatedType()->isArrayTy())
+      continue;
+    bool bDynamic = false;
+    for (User *U : AI->users()) {
+      GEPOperator *GEP = dyn_cast<GEPOperator>(U);
+      if (GEP && !GEP->hasAllConstantIndices()) {
+        bDynamic = true;
+        break;
+      }
+    }
+    if (bDynamic) {
+      ++Cost.DynamicTemps;
+      Cost.DynamicTempBytes += DL.getTypeAllocSize(AI->getAllocatedType());
+    }
+  }
+}
+
+bool DxilPerfReportCollector::runOnFunction(Function &F) {
+  if (F.isDeclaration())
+    return false;
+  LoopInfo &LI = getAnalysis<LoopInfoWrapperPass>().getLoopInfo();
+  ScalarEvolution &SE = getAnalysis<ScalarEvolution>();
+
+  FunctionCost Cost;
+  Cost.Name = F.getName();
+  // Rows are told apart by the handle and the constant row index.
+  DenseSet<std::pair<Value *, uint64_t>> Rows;
+  for (BasicBlock &BB : F) {
+    Loop *L = LI.getLoopFor(&BB);
+    uint64_t Multiplier = getMultiplier(L, SE);
+    for (Instruction &I : BB) {
+      InstClass Class = Classify(&I);
+      if (Class == InstClass::Count)
+        continue;
+      ++Cost.Static[(unsigned)Class];
+      Cost.Weighted[(unsigned)Class] += Multiplier;
+
+      CallInst *CI = dyn_cast<CallInst>(&I);
+      if (CI && OP::IsDxilOpFuncCallInst(CI, OP::OpCode::CBufferLoadLegacy)) {
+        ++Cost.CBufferLoads;
+        DxilInst_CBufferLoadLegacy Load(CI);
+        if (ConstantInt *Row = dyn_cast<ConstantInt>(Load.get_regIndex())) {
+          if (Rows.insert(std::make_pair(Load.get_handle(),
+                                         Row->getZExtValue())).second)
+            ++Cost.CBufferRows;
+        } else {
+          ++Cost.CBufferDynamicLoads;
+        }
+      }
+    }
+  }
+  for (Loop *L : LI) {
+    SmallVector<Loop *, 8> Worklist(1, L);
+    while (!Worklist.empty()) {
+      Loop *Cur = Worklist.pop_back_val();
+      ++Cost.Loops;
+      Cost.MaxLoopDepth = std::max(Cost.MaxLoopDepth, Cur->getLoopDepth());
+      Worklist.append(Cur->begin(), Cur->end());
+    }
+  }
+  countDynamicTemps(F, Cost);
+
+  RegisterPressure RP;
+  RP.Compute(&F);
+  Cost.PeakLive = RP.GetMaxPressure();
+
+  Costs.push_back(std::move(Cost));
+  return false;
+}
+
+void WriteClassCounts(raw_ostream &OS, const uint64_t *Counts) {
+  OS << "{";
+  for (unsigned i = 0; i < (unsigned)InstClass::Count; ++i)
+    OS << (i ? "," : "") << "\"" << kInstClasses[i].Name << "\":" << Counts[i];
+  OS << "}";
+}
+
+} // namespace
+
+void hlsl::WriteDxilPerfReport(Module &M, raw_ostream &OS) {
+  DxilCounters Counters;
+  CountInstructions(M, Counters);
+
+  DxilPerfReportCollector *pCollector = new DxilPerfReportCollector();
+  legacy::FunctionPassManager FPM(&M);
+  FPM.add(pCollector);
+  FPM.doInitialization();
+  for (Function &F : M)
+    FPM.run(F);
+  FPM.doFinalization();
+
+  OS << "{\"unknownTripCount\":" << kUnknownTripCount << ",\"counters\":{";
+  for (unsigned i = 0; i < _countof(kCounterNames); ++i) {
+    uint32_t *pCounter = LookupByName(kCounterNames[i], Counters);
+    OS << (i ? "," : "") << "\"" << kCounterNames[i]
+       << "\":" << (pCounter ? *pCounter : 0);
+  }
+  OS << "},\"functions\":[";
+  uint64_t TotalCost = 0;
+  bool bFirst = true;
+  for (const FunctionCost &Cost : pCollector->Costs) {
+    OS << (bFirst ? "\n" : ",\n") << "{\"name\":";
+    writeJSONString(OS, Cost.Name);
+    OS << ",\"peakLive\":" << Cost.PeakLive << ",\"loops\":" << Cost.Loops
+       << ",\"maxLoopDepth\":" << Cost.MaxLoopDepth << ",\"static\":";
+    WriteClassCounts(OS, Cost.Static);
+    OS << ",\"weighted\":";
+    WriteClassCounts(OS, Cost.Weighted);
+    OS << ",\"cbuffer\":{\"loads\":" << Cost.CBufferLoads
+       << ",\"rows\":" << Cost.CBufferRows
+       << ",\"dynamicLoads\":" << Cost.CBufferDynamicLoads << "}"
+       << ",\"dynamicIndexTemps\":{\"count\":" << Cost.DynamicTemps
+       << ",\"bytes\":" << Cost.DynamicTempBytes << "}"
+       << ",\"cost\":" << Cost.GetCost() << "}";
+    TotalCost += Cost.GetCost();
+    bFirst = false;
+  }
+  OS << "\n],\"cost\":" << TotalCost << "}\n";
+}
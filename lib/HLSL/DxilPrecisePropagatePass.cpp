@@ -19,6 +19,7 @@
 #include "llvm/IR/Operator.h"
 #include "llvm/IR/Module.h"
 #include "llvm/Support/Casting.h"
+#include <set>
 #include <unordered_set>
 #include <vector>
 
@@ -37,6 +38,16 @@ struct FuncInfo {
 };
 typedef std::unordered_map<llvm::Function *, std::unique_ptr<FuncInfo>> FuncInfoMap;
 
+// The GEP and call users of a pointer, with the GEPs bucketed by their first
+// index after the pointer offset, so that matching a constant index only
+// visits the GEPs that can match it.
+struct GEPUserInfo {
+  DenseMap<uint64_t, SmallVector<GEPOperator *, 2>> ByConstIndex;
+  SmallVector<GEPOperator *, 2> OtherGEPs; // Non-constant or no first index.
+  SmallVector<CallInst *, 2> Calls;
+};
+typedef std::unordered_map<Value *, std::unique_ptr<GEPUserInfo>> GEPUserInfoMap;
+
 class DxilPrecisePropagatePass : public ModulePass {
 public:
   static char ID; // Pass identification, replacement for typeid
@@ -70,6 +81,8 @@ private:
   void PropagateThroughGEPs(Value *Ptr, ArrayRef<Value *> idxList,
                             ValueSet &processedGEPs);
   void PropagateOnPointerUsedInCall(Value *Ptr, CallInst *CI);
+  void PropagateIntoCallee(CallInst *CI);
+  void PropagateToCallers(Argument *Arg);
 
   void PropagateCtrlDep(FuncInfo &FI, BasicBlock *BB);
   void PropagateCtrlDep(BasicBlock *BB);
@@ -81,11 +94,18 @@ private:
   }
 
   FuncInfo &GetFuncInfo(Function *F);
+  GEPUserInfo &GetGEPUserInfo(Value *Ptr);
 
   DxilModule *m_pDM;
   std::vector<Value*> m_WorkList;
   ValueSet m_ProcessedSet;
   FuncInfoMap m_FuncInfo;
+  // Every value gets marked at most once, but the pointers walked on the way
+  // to the stores are shared between marked values. Walking one again finds
+  // nothing new, so each pointer's users and each GEP match are walked once.
+  ValueSet m_WalkedPointers;
+  std::set<std::pair<Value *, std::vector<Value *>>> m_WalkedGEPMatches;
+  GEPUserInfoMap m_GEPUsers;
 };
 
 char DxilPrecisePropagatePass::ID = 0;
@@ -119,6 +139,11 @@ void DxilPrecisePropagatePass::ProcessWorkList() {
       PropagateOnPointer(V);
     }
 
+    if (Argument *Arg = dyn_cast<Argument>(V)) {
+      PropagateToCallers(Arg);
+      continue;
+    }
+
     Instruction *I = dyn_cast<Instruction>(V);
     if (!I)
       continue;
@@ -140,6 +165,7 @@ void DxilPrecisePropagatePass::Propagate(Instruction *I) {
   if (CallInst *CI = dyn_cast<CallInst>(I)) {
     for (unsigned i = 0; i < CI->getNumArgOperands(); i++)
       AddToWorkList(CI->getArgOperand(i));
+    PropagateIntoCallee(CI);
   } else {
     for (Value *src : I->operands())
       AddToWorkList(src);
@@ -209,6 +235,8 @@ void DxilPrecisePropagatePass::PropagateOnPointer(Value *Ptr) {
 }
 
 void DxilPrecisePropagatePass::PropagateOnPointerUsers(Value *Ptr) {
+  if (!m_WalkedPointers.insert(Ptr).second)
+    return;
   // Find all store and propagate on the val operand of store.
   // For CallInst, if Ptr is used as out parameter, mark it.
   for (User *U : Ptr->users()) {
@@ -229,66 +257,109 @@ void DxilPrecisePropagatePass::PropagateOnPointerUsers(Value *Ptr) {
 
 void DxilPrecisePropagatePass::PropagateThroughGEPs(
     Value *Ptr, ArrayRef<Value*> idxList, ValueSet &processedGEPs) {
+  if (!m_WalkedGEPMatches.insert(std::make_pair(
+          Ptr, std::vector<Value *>(idxList.begin(), idxList.end()))).second)
+    return;
+
+  // Only GEPs whose first index can match the reference index are visited.
+  GEPUserInfo &Users = GetGEPUserInfo(Ptr);
+  SmallVector<GEPOperator *, 8> Candidates(Users.OtherGEPs.begin(),
+                                           Users.OtherGEPs.end());
+  ConstantInt *CFirst =
+      idxList.empty() ? nullptr : dyn_cast<ConstantInt>(idxList[0]);
+  if (CFirst) {
+    auto It = Users.ByConstIndex.find(CFirst->getLimitedValue());
+    if (It != Users.ByConstIndex.end())
+      Candidates.append(It->second.begin(), It->second.end());
+  } else {
+    for (auto &Bucket : Users.ByConstIndex)
+      Candidates.append(Bucket.second.begin(), Bucket.second.end());
+  }
+
   // recurse to matching GEP users
-  for (User *U : Ptr->users()) {
-    if (GEPOperator *GEP = dyn_cast<GEPOperator>(U)) {
-      // skip visited GEPs
-      // These are separate from processedSet because while we don't need to
-      // visit an intermediate GEP multiple times while marking a single value
-      // precise, we are not necessarily marking every value reachable from
-      // the GEP as precise, so we may need to revisit when marking a different
-      // value as precise.
-      if (!processedGEPs.insert(GEP).second)
-        continue;
+  for (GEPOperator *GEP : Candidates) {
+    // skip visited GEPs
+    // These are separate from processedSet because while we don't need to
+    // visit an intermediate GEP multiple times while marking a single value
+    // precise, we are not necessarily marking every value reachable from
+    // the GEP as precise, so we may need to revisit when marking a different
+    // value as precise.
+    if (!processedGEPs.insert(GEP).second)
+      continue;
 
-      // Mismatch if both constant and unequal, otherwise be conservative.
-      bool bMismatch = false;
-      auto idx = GEP->idx_begin();
-      idx++;
-      unsigned i = 0;
-      // FIXME: When i points outside idxList, it's an indication that this GEP
-      // is deeper than the one we are matching. This can happen with vector
-      // components or aggregates when marking the aggregate precise, such as
-      // when propagating through call with aggregate argument. This solution
-      // only prevents OOB memory access, it does not fix the underlying
-      // problems that lead to it, which will likely require significant work -
-      // perhaps even a rewrite using alias analysis or some other more accurate
-      // mechanism.
-      while (idx != GEP->idx_end() && i < idxList.size()) {
-        if (ConstantInt *C = dyn_cast<ConstantInt>(*idx)) {
-          if (ConstantInt *CRef = dyn_cast<ConstantInt>(idxList[i])) {
-            if (CRef->getLimitedValue() != C->getLimitedValue()) {
-              bMismatch = true;
-              break;
-            }
+    // Mismatch if both constant and unequal, otherwise be conservative.
+    bool bMismatch = false;
+    auto idx = GEP->idx_begin();
+    idx++;
+    unsigned i = 0;
+    // FIXME: When i points outside idxList, it's an indication that this GEP
+    // is deeper than the one we are matching. This can happen with vector
+    // components or aggregates when marking the aggregate precise, such as
+    // when propagating through call with aggregate argument. This solution
+    // only prevents OOB memory access, it does not fix the underlying
+    // problems that lead to it, which will likely require significant work -
+    // perhaps even a rewrite using alias analysis or some other more accurate
+    // mechanism.
+    while (idx != GEP->idx_end() && i < idxList.size()) {
+      if (ConstantInt *C = dyn_cast<ConstantInt>(*idx)) {
+        if (ConstantInt *CRef = dyn_cast<ConstantInt>(idxList[i])) {
+          if (CRef->getLimitedValue() != C->getLimitedValue()) {
+            bMismatch = true;
+            break;
           }
         }
-        idx++;
-        i++;
       }
-      if (bMismatch)
+      idx++;
+      i++;
+    }
+    if (bMismatch)
+      continue;
+
+    if ((unsigned)idxList.size() == i) {
+      // Mark leaf users
+      if (Processed(GEP))
         continue;
+      PropagateOnPointerUsers(GEP);
+    } else {
+      // Recurse GEP users
+      PropagateThroughGEPs(
+          GEP, ArrayRef<Value*>(idxList.data() + i, idxList.end()),
+          processedGEPs);
+    }
+  }
 
-      if ((unsigned)idxList.size() == i) {
-        // Mark leaf users
-        if (Processed(GEP))
-          continue;
-        PropagateOnPointerUsers(GEP);
-      } else {
-        // Recurse GEP users
-        PropagateThroughGEPs(
-            GEP, ArrayRef<Value*>(idxList.data() + i, idxList.end()),
-            processedGEPs);
-      }
+  // Root pointer or intermediate GEP used in call.
+  // If it may write to the pointer, we must mark the call and recurse
+  // arguments.
+  // This also widens the precise propagation to the entire aggregate
+  // pointed to by the root ptr or intermediate GEP.
+  for (CallInst *CI : Users.Calls)
+    PropagateOnPointerUsedInCall(Ptr, CI);
+}
+
+GEPUserInfo &DxilPrecisePropagatePass::GetGEPUserInfo(Value *Ptr) {
+  std::unique_ptr<GEPUserInfo> &Info = m_GEPUsers[Ptr];
+  if (Info)
+    return *Info;
+  Info = make_unique<GEPUserInfo>();
+  for (User *U : Ptr->users()) {
+    if (GEPOperator *GEP = dyn_cast<GEPOperator>(U)) {
+      auto idx = GEP->idx_begin();
+      ConstantInt *C = nullptr;
+      if (idx != GEP->idx_end() && ++idx != GEP->idx_end())
+        C = dyn_cast<ConstantInt>(*idx);
+      if (C)
+        Info->ByConstIndex[C->getLimitedValue()].emplace_back(GEP);
+      else
+        Info->OtherGEPs.emplace_back(GEP);
     } else if (CallInst *CI = dyn_cast<CallInst>(U)) {
-      // Root pointer or intermediate GEP used in call.
-      // If it may write to the pointer, we must mark the call and recurse
-      // arguments.
-      // This also widens the precise propagation to the entire aggregate
-      // pointed to by the root ptr or intermediate GEP.
-      PropagateOnPointerUsedInCall(Ptr, CI);
+      // The dx.attribute.precise calls are skipped anyway, and are erased
+      // while this is cached.
+      if (!HLModule::HasPreciseAttribute(CI->getCalledFunction()))
+        Info->Calls.emplace_back(CI);
     }
   }
+  return *Info;
 }
 
 void DxilPrecisePropagatePass::PropagateOnPointerUsedInCall(
@@ -328,6 +399,34 @@ void DxilPrecisePropagatePass::PropagateOnPointerUsedInCall(
   }
 }
 
+// Precise on a call to a function with a body applies to the values it
+// returns and the memory it writes through its pointer arguments.
+void DxilPrecisePropagatePass::PropagateIntoCallee(CallInst *CI) {
+  Function *F = CI->getCalledFunction();
+  if (!F || F->isDeclaration())
+    return;
+  if (!F->getReturnType()->isVoidTy()) {
+    for (BasicBlock &BB : *F) {
+      if (ReturnInst *RI = dyn_cast<ReturnInst>(BB.getTerminator()))
+        AddToWorkList(RI);
+    }
+  }
+  for (Argument &Arg : F->args()) {
+    if (Arg.getType()->isPointerTy())
+      AddToWorkList(&Arg);
+  }
+}
+
+// Precise on a parameter applies to what every caller passes for it.
+void DxilPrecisePropagatePass::PropagateToCallers(Argument *Arg) {
+  Function *F = Arg->getParent();
+  for (User *U : F->users()) {
+    CallInst *CI = dyn_cast<CallInst>(U);
+    if (CI && CI->getCalledFunction() == F)
+      AddToWorkList(CI->getArgOperand(Arg->getArgNo()));
+  }
+}
+
 void FuncInfo::Init(Function *F) {
   if (!pPostDom) {
     pPostDom = make_unique<DominatorTreeBase<BasicBlock> >(true);
@@ -75,14 +75,23 @@ bool InvalidateUndefResources::runOnModule(Module &M) {
   // such as by reading from resources seen in a code path that was not taken.
   // We avoid the problem by replacing undef values by another invalid
   // value that we can identify later.
+  // Constants belong to the context, which can hold other modules, so only
+  // the uses in this module are replaced.
   for (auto &F : M.functions()) {
     if (GetHLOpcodeGroupByName(&F) == HLOpcodeGroup::HLCreateHandle) {
       Type *ResTy = F.getFunctionType()->getParamType(
         HLOperandIndex::kCreateHandleResourceOpIdx);
       UndefValue *UndefRes = UndefValue::get(ResTy);
-      if (!UndefRes->use_empty()) {
+      SmallVector<Use *, 8> Uses;
+      for (Use &U : UndefRes->uses()) {
+        Instruction *I = dyn_cast<Instruction>(U.getUser());
+        if (I && I->getModule() == &M)
+          Uses.push_back(&U);
+      }
+      if (!Uses.empty()) {
         Constant *InvalidRes = ConstantAggregateZero::get(ResTy);
-        UndefRes->replaceAllUsesWith(InvalidRes);
+        for (Use *U : Uses)
+          U->set(InvalidRes);
       }
     }
   }
@@ -815,6 +824,9 @@ public:
         }
       }
 
+      // Branch weights only guide optimization and are not allowed in DXIL.
+      StripBranchWeights(M);
+
       // Turn dx.break() conditional into global
       LowerDxBreak(M);
 
@@ -856,6 +868,18 @@ public:
   }
 
 private:
+  void StripBranchWeights(Module &M) {
+    for (Function &F : M) {
+      for (BasicBlock &BB : F) {
+        // Only terminators and selects carry them.
+        for (Instruction &I : BB) {
+          if (isa<TerminatorInst>(I) || isa<SelectInst>(I))
+            I.setMetadata(LLVMContext::MD_prof, nullptr);
+        }
+      }
+    }
+  }
+
   void RemoveUnusedStaticGlobal(Module &M) {
     // Remove unused internal global.
     std::vector<GlobalVariable *> staticGVs;
@@ -0,0 +1,139 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// DxilRegisterPressure.cpp                                                  //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Estimates how many 32-bit values a DXIL function keeps live.              //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#include "dxc/HLSL/DxilRegisterPressure.h"
+
+#include "llvm/ADT/DenseSet.h"
+#include "llvm/IR/CFG.h"
+#include "llvm/IR/DerivedTypes.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/Instructions.h"
+
+using namespace llvm;
+using namespace hlsl;
+
+unsigned RegisterPressure::GetRegisterCount(Type *Ty) {
+  if (StructType *ST = dyn_cast<StructType>(Ty)) {
+    unsigned Count = 0;
+    for (Type *EltTy : ST->elements())
+      Count += GetRegisterCount(EltTy);
+    return Count;
+  }
+  if (SequentialType *SeqTy = dyn_cast<SequentialType>(Ty)) {
+    if (!Ty->isPointerTy()) {
+      uint64_t NumElts = Ty->isVectorTy() ? Ty->getVectorNumElements()
+                                          : Ty->getArrayNumElements();
+      return NumElts * GetRegisterCount(SeqTy->getElementType());
+    }
+    return 1;
+  }
+  if (Ty->isVoidTy() || Ty->isLabelTy() || Ty->isMetadataTy())
+    return 0;
+  return Ty->getPrimitiveSizeInBits() > 32 ? 2 : 1;
+}
+
+void RegisterPressure::Clear() {
+  m_Blocks.clear();
+  m_MaxPressure = 0;
+}
+
+// Marks Def live on every path from the use back up to the definition.
+void RegisterPressure::MarkUse(Instruction *Def, Use &U) {
+  BasicBlock *DefBB = Def->getParent();
+  Instruction *User = cast<Instruction>(U.getUser());
+  SmallVector<BasicBlock *, 16> WorkList;
+  if (PHINode *Phi = dyn_cast<PHINode>(User)) {
+    // Phis read their operands at the end of the incoming block.
+    BasicBlock *Pred = Phi->getIncomingBlock(U);
+    m_Blocks[Pred].LiveOut.insert(Def);
+    if (Pred == DefBB)
+      return;
+    WorkList.push_back(Pred);
+  } else {
+    if (User->getParent() == DefBB)
+      return;
+    WorkList.push_back(User->getParent());
+  }
+
+  while (!WorkList.empty()) {
+    BasicBlock *BB = WorkList.pop_back_val();
+    if (!m_Blocks[BB].LiveIn.insert(Def))
+      continue;
+    for (BasicBlock *Pred : predecessors(BB)) {
+      m_Blocks[Pred].LiveOut.insert(Def);
+      if (Pred != DefBB)
+        WorkList.push_back(Pred);
+    }
+  }
+}
+
+// Walks the block bottom up from its live-out values.
+void RegisterPressure::ComputeBlockPressure(BasicBlock *BB, BlockInfo &Info) {
+  DenseSet<Instruction *> Live;
+  unsigned Pressure = 0;
+  for (Instruction *I : Info.LiveOut) {
+    Live.insert(I);
+    Pressure += GetRegisterCount(I->getType());
+  }
+  Info.LiveOutPressure = Pressure;
+  unsigned MaxPressure = Pressure;
+
+  for (auto It = BB->rbegin(), E = BB->rend(); It != E; ++It) {
+    Instruction *I = &*It;
+    if (Live.erase(I))
+      Pressure -= GetRegisterCount(I->getType());
+    if (isa<PHINode>(I))
+      continue;
+    for (Value *V : I->operands()) {
+      Instruction *OpI = dyn_cast<Instruction>(V);
+      if (OpI && Live.insert(OpI).second)
+        Pressure += GetRegisterCount(OpI->getType());
+    }
+    MaxPressure = std::max(MaxPressure, Pressure);
+  }
+  Info.MaxPressure = MaxPressure;
+}
+
+void RegisterPressure::Compute(Function *F) {
+  Clear();
+  for (BasicBlock &BB : *F) {
+    m_Blocks[&BB];
+    for (Instruction &I : BB) {
+      for (Use &U : I.uses())
+        MarkUse(&I, U);
+    }
+  }
+  for (BasicBlock &BB : *F) {
+    BlockInfo &Info = m_Blocks[&BB];
+    ComputeBlockPressure(&BB, Info);
+    m_MaxPressure = std::max(m_MaxPressure, Info.MaxPressure);
+  }
+}
+
+const RegisterPressure::LiveSet &
+RegisterPressure::GetLiveIn(BasicBlock *BB) const {
+  return m_Blocks.find(BB)->second.LiveIn;
+}
+
+const RegisterPressure::LiveSet &
+RegisterPressure::GetLiveOut(BasicBlock *BB) const {
+  return m_Blocks.find(BB)->second.LiveOut;
+}
+
+unsigned RegisterPressure::GetLiveOutPressure(BasicBlock *BB) const {
+  auto It = m_Blocks.find(BB);
+  return It == m_Blocks.end() ? 0 : It->second.LiveOutPressure;
+}
+
+unsigned RegisterPressure::GetMaxPressure(BasicBlock *BB) const {
+  auto It = m_Blocks.find(BB);
+  return It == m_Blocks.end() ? 0 : It->second.MaxPressure;
+}
@@ -0,0 +1,206 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// DxilRematerialize.cpp                                                     //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Recomputes cheap values next to their uses to shorten live ranges.        //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#include "dxc/HLSL/DxilGenerationPass.h"
+#include "dxc/HLSL/DxilRegisterPressure.h"
+#include "dxc/DXIL/DxilOperations.h"
+
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IR/ValueHandle.h"
+#include "llvm/Transforms/Utils/Local.h"
+
+using namespace llvm;
+using namespace hlsl;
+
+// Handles and cbuffer reads are cheap to compute again and are often
+// created once at the top of the shader, then kept live across everything
+// that follows. When the estimated pressure somewhere on such a value's
+// live range goes over MaxPressure, this clones the value, and the
+// handles and loads it comes from, into each block that uses it, right
+// before the first use. Uses in the defining block keep the original.
+// MaxPressure 0 disables the pass; lower values trade more ALU work for
+// fewer live registers.
+namespace {
+class DxilRematerialize : public FunctionPass {
+public:
+  static char ID; // Pass identification, replacement for typeid
+  explicit DxilRematerialize(unsigned MaxPressure = 0)
+      : FunctionPass(ID), MaxPressure(MaxPressure) {}
+
+  StringRef getPassName() const override {
+    return "DXIL rematerialize cheap values";
+  }
+
+  void getAnalysisUsage(AnalysisUsage &AU) const override {
+    AU.setPreservesCFG();
+  }
+
+  void applyOptions(PassOptions O) override {
+    GetPassOptionUnsigned(O, "MaxPressure", &MaxPressure, 0);
+  }
+  void dumpConfig(raw_ostream &OS) override {
+    FunctionPass::dumpConfig(OS);
+    OS << ",MaxPressure=" << MaxPressure;
+  }
+
+  bool runOnFunction(Function &F) override;
+
+private:
+  unsigned MaxPressure;
+
+  bool isRematerializable(Instruction *I, unsigned Depth);
+  bool isLiveAcrossPressure(Instruction *I, RegisterPressure &RP);
+  Instruction *cloneChain(Instruction *I, Instruction *InsertBefore,
+                          DenseMap<Instruction *, Instruction *> &Clones);
+  bool rematerialize(Instruction *I);
+};
+
+char DxilRematerialize::ID = 0;
+
+// Handle, annotateHandle, cbuffer load, extractvalue.
+const unsigned kMaxChainDepth = 4;
+} // namespace
+
+bool DxilRematerialize::isRematerializable(Instruction *I, unsigned Depth) {
+  if (Depth == 0)
+    return false;
+  if (isa<ExtractValueInst>(I)) {
+    Instruction *Agg = dyn_cast<Instruction>(I->getOperand(0));
+    return Agg && isRematerializable(Agg, Depth - 1);
+  }
+  CallInst *CI = dyn_cast<CallInst>(I);
+  if (!CI || !OP::IsDxilOpFuncCallInst(CI))
+    return false;
+  switch (OP::GetDxilOpFuncCallInst(CI)) {
+  case OP::OpCode::CreateHandle:
+  case OP::OpCode::CreateHandleFromBinding:
+  case OP::OpCode::AnnotateHandle:
+  case OP::OpCode::CBufferLoad:
+  case OP::OpCode::CBufferLoadLegacy:
+    break;
+  default:
+    return false;
+  }
+  for (Value *V : CI->arg_operands()) {
+    Instruction *OpI = dyn_cast<Instruction>(V);
+    if (OpI && !isRematerializable(OpI, Depth - 1))
+      return false;
+  }
+  return true;
+}
+
+bool DxilRematerialize::isLiveAcrossPressure(Instruction *I,
+                                             RegisterPressure &RP) {
+  Function *F = I->getParent()->getParent();
+  for (BasicBlock &BB : *F) {
+    if (RP.GetMaxPressure(&BB) > MaxPressure && RP.GetLiveIn(&BB).count(I))
+      return true;
+  }
+  return false;
+}
+
+Instruction *
+DxilRematerialize::cloneChain(Instruction *I, Instruction *InsertBefore,
+                              DenseMap<Instruction *, Instruction *> &Clones) {
+  auto It = Clones.find(I);
+  if (It != Clones.end())
+    return It->second;
+  Instruction *Clone = I->clone();
+  for (unsigned i = 0; i < Clone->getNumOperands(); ++i) {
+    if (Instruction *OpI = dyn_cast<Instruction>(Clone->getOperand(i)))
+      Clone->setOperand(i, cloneChain(OpI, InsertBefore, Clones));
+  }
+  Clone->insertBefore(InsertBefore);
+  if (I->hasName())
+    Clone->setName(I->getName() + ".remat");
+  Clones[I] = Clone;
+  return Clone;
+}
+
+bool DxilRematerialize::rematerialize(Instruction *I) {
+  BasicBlock *DefBB = I->getParent();
+  // Uses in other blocks, grouped by the block the value is needed in.
+  DenseMap<BasicBlock *, SmallVector<Use *, 4>> BlockUses;
+  SmallVector<BasicBlock *, 4> Blocks;
+  for (Use &U : I->uses()) {
+    Instruction *User = cast<Instruction>(U.getUser());
+    BasicBlock *UseBB = User->getParent();
+    if (PHINode *Phi = dyn_cast<PHINode>(User))
+      UseBB = Phi->getIncomingBlock(U);
+    if (UseBB == DefBB)
+      continue;
+    auto &Uses = BlockUses[UseBB];
+    if (Uses.empty())
+      Blocks.push_back(UseBB);
+    Uses.push_back(&U);
+  }
+  if (Blocks.empty())
+    return false;
+
+  for (BasicBlock *UseBB : Blocks) {
+    auto &Uses = BlockUses[UseBB];
+    SmallPtrSet<Instruction *, 4> Users;
+    for (Use *U : Uses) {
+      if (!isa<PHINode>(U->getUser()))
+        Users.insert(cast<Instruction>(U->getUser()));
+    }
+    // Phis read the value at the end of the incoming block.
+    Instruction *InsertBefore = UseBB->getTerminator();
+    for (Instruction &J : *UseBB) {
+      if (Users.count(&J)) {
+        InsertBefore = &J;
+        break;
+      }
+    }
+    DenseMap<Instruction *, Instruction *> Clones;
+    Instruction *Clone = cloneChain(I, InsertBefore, Clones);
+    for (Use *U : Uses)
+      U->set(Clone);
+  }
+  RecursivelyDeleteTriviallyDeadInstructions(I);
+  return true;
+}
+
+bool DxilRematerialize::runOnFunction(Function &F) {
+  if (!MaxPressure)
+    return false;
+  RegisterPressure RP;
+  RP.Compute(&F);
+  if (RP.GetMaxPressure() <= MaxPressure)
+    return false;
+
+  SmallVector<WeakVH, 16> Candidates;
+  for (BasicBlock &BB : F) {
+    for (Instruction &I : BB) {
+      if (isRematerializable(&I, kMaxChainDepth) &&
+          isLiveAcrossPressure(&I, RP))
+        Candidates.emplace_back(&I);
+    }
+  }
+
+  // Visit the last value of each chain first. It takes the values it is
+  // computed from along, and those are deleted once nothing else uses them.
+  bool bUpdated = false;
+  for (auto It = Candidates.rbegin(), E = Candidates.rend(); It != E; ++It) {
+    if (Instruction *I = dyn_cast_or_null<Instruction>(*It))
+      bUpdated |= rematerialize(I);
+  }
+  return bUpdated;
+}
+
+FunctionPass *llvm::createDxilRematerializePass(unsigned MaxPressure) {
+  return new DxilRematerialize(MaxPressure);
+}
+
+INITIALIZE_PASS(DxilRematerialize, "dxil-rematerialize",
+                "DXIL rematerialize cheap values", false, false)
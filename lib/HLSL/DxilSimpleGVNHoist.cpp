@@ -11,6 +11,7 @@
 
 #include "dxc/HLSL/DxilGenerationPass.h"
 #include "dxc/DXIL/DxilOperations.h"
+#include "dxc/HLSL/DxilRegisterPressure.h"
 
 #include "llvm/IR/Dominators.h"
 #include "llvm/IR/Instructions.h"
@@ -441,19 +442,33 @@ namespace {
 //  else
 //    r = tex.Sample(ss, uv) + 3;
 // }
+// Hoisting keeps the result live from the branch on, so with MaxPressure
+// set, values stop being hoisted once the estimated pressure at the branch
+// reaches it.
 class DxilSimpleGVNHoist : public FunctionPass {
 
 public:
   static char ID; // Pass identification, replacement for typeid
-  explicit DxilSimpleGVNHoist() : FunctionPass(ID) {}
+  explicit DxilSimpleGVNHoist(unsigned MaxPressure = 0)
+      : FunctionPass(ID), MaxPressure(MaxPressure) {}
 
   StringRef getPassName() const override {
     return "DXIL simple GVN hoist";
   }
 
+  void applyOptions(PassOptions O) override {
+    GetPassOptionUnsigned(O, "MaxPressure", &MaxPressure, 0);
+  }
+  void dumpConfig(raw_ostream &OS) override {
+    FunctionPass::dumpConfig(OS);
+    OS << ",MaxPressure=" << MaxPressure;
+  }
+
   bool runOnFunction(Function &F) override;
 
 private:
+  unsigned MaxPressure;
+  RegisterPressure RP;
   bool tryToHoist(BasicBlock *BB, BasicBlock *Succ0, BasicBlock *Succ1);
 };
 
@@ -496,6 +511,9 @@ bool DxilSimpleGVNHoist::tryToHoist(BasicBlock *BB, BasicBlock *Succ0,
 
   DenseSet<uint32_t> ProcessedVN;
   Instruction *TI = BB->getTerminator();
+  // The estimate is not updated as values move, so count what this block
+  // gains here.
+  unsigned Pressure = MaxPressure ? RP.GetLiveOutPressure(BB) : 0;
   // Hoist need to be in order, so operand could hoist before its users.
   for (uint32_t VN : HoistCandidateVN) {
     // Skip processed VN
@@ -536,6 +554,12 @@ bool DxilSimpleGVNHoist::tryToHoist(BasicBlock *BB, BasicBlock *Succ0,
       // TODO: hoist operands.
       if (bHasDifferentOperand)
         continue;
+      if (MaxPressure) {
+        unsigned Count = RegisterPressure::GetRegisterCount(FirstI->getType());
+        if (Pressure + Count > MaxPressure)
+          continue;
+        Pressure += Count;
+      }
       // Move FirstI to BB.
       FirstI->removeFromParent();
       FirstI->insertBefore(TI);
@@ -556,6 +580,8 @@ bool DxilSimpleGVNHoist::tryToHoist(BasicBlock *BB, BasicBlock *Succ0,
 bool DxilSimpleGVNHoist::runOnFunction(Function &F) {
   BasicBlock &Entry = F.getEntryBlock();
   bool bUpdated = false;
+  if (MaxPressure)
+    RP.Compute(&F);
   for (auto it = po_begin(&Entry); it != po_end(&Entry); it++) {
     BasicBlock *BB = *it;
     TerminatorInst *TI = BB->getTerminator();
@@ -579,8 +605,8 @@ bool DxilSimpleGVNHoist::runOnFunction(Function &F) {
 
 }
 
-FunctionPass *llvm::createDxilSimpleGVNHoistPass() {
-  return new DxilSimpleGVNHoist();
+FunctionPass *llvm::createDxilSimpleGVNHoistPass(unsigned MaxPressure) {
+  return new DxilSimpleGVNHoist(MaxPressure);
 }
 
 INITIALIZE_PASS(DxilSimpleGVNHoist, "dxil-gvn-hoist",
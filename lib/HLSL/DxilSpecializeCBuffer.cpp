@@ -0,0 +1,350 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// DxilSpecializeCBuffer.cpp                                                 //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Replaces loads of constant buffer fields given on the command line with   //
+// their values.                                                             //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#include "dxc/HLSL/DxilGenerationPass.h"
+#include "dxc/DXIL/DxilModule.h"
+#include "dxc/DXIL/DxilOperations.h"
+#include "dxc/DXIL/DxilCBuffer.h"
+#include "dxc/DXIL/DxilInstructions.h"
+#include "dxc/DXIL/DxilTypeSystem.h"
+#include "dxc/DXIL/DxilUtil.h"
+
+#include "llvm/ADT/APFloat.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/GlobalVariable.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Pass.h"
+
+#include <cstdlib>
+
+using namespace llvm;
+using namespace hlsl;
+
+// Shaders often branch on settings held in constant buffers that are known
+// when the shader is built for a given material or quality level, e.g.
+// cbuffer Material { uint LightingModel; }. With
+// -specialize-cbuffer Material.LightingModel=2 each component read of the
+// field is replaced with the value right after DXIL generation, so the
+// passes that follow fold the branches and drop the dead code. The field
+// itself is left in the buffer and is then reported as unused by
+// reflection; the application must still bind a buffer with that layout.
+//
+// Scalar and vector fields are supported, with vector components separated
+// by commas. Nested struct fields are named with dots.
+namespace {
+class DxilSpecializeCBuffer : public ModulePass {
+public:
+  static char ID; // Pass identification, replacement for typeid
+  explicit DxilSpecializeCBuffer() : ModulePass(ID) {}
+  explicit DxilSpecializeCBuffer(
+      const std::map<std::string, std::string> &Values)
+      : ModulePass(ID), m_Values(Values) {}
+
+  StringRef getPassName() const override {
+    return "DXIL specialize cbuffer fields";
+  }
+
+  bool runOnModule(Module &M) override;
+
+private:
+  // Field bytes [Offset, Offset + Values.size() * CompSize) in the buffer.
+  struct SpecializedField {
+    unsigned Offset;
+    unsigned CompSize;
+    bool IsFloat;
+    SmallVector<StringRef, 4> Values;
+  };
+  typedef SmallVector<SpecializedField, 4> FieldList;
+
+  bool resolve(Module &M, StringRef Name, StringRef Value,
+               std::map<GlobalVariable *, FieldList> &Fields);
+  bool specialize(CallInst *Load, const FieldList &Fields);
+
+  std::map<std::string, std::string> m_Values;
+};
+
+char DxilSpecializeCBuffer::ID = 0;
+
+// Follows a handle back to the cbuffer global it was created from.
+GlobalVariable *GetCBufferGlobal(Value *Handle) {
+  CallInst *CI = dyn_cast<CallInst>(Handle);
+  if (!CI)
+    return nullptr;
+  if (OP::IsDxilOpFuncCallInst(CI, OP::OpCode::AnnotateHandle))
+    return GetCBufferGlobal(DxilInst_AnnotateHandle(CI).get_res());
+  if (!OP::IsDxilOpFuncCallInst(CI, OP::OpCode::CreateHandleForLib))
+    return nullptr;
+  DxilInst_CreateHandleForLib createHandle(CI);
+  if (LoadInst *LI = dyn_cast<LoadInst>(createHandle.get_Resource()))
+    return dyn_cast<GlobalVariable>(LI->getPointerOperand());
+  return nullptr;
+}
+
+// Finds the field at Path in ST, adding its offset to Offset. A struct with
+// a single struct field, as ConstantBuffer<T> globals are, is looked
+// through when the name is not found at its level.
+const DxilFieldAnnotation *FindField(DxilTypeSystem &TypeSys, StructType *ST,
+                                     StringRef Path, unsigned &Offset,
+                                     Type *&FieldTy) {
+  const DxilStructAnnotation *SA = TypeSys.GetStructAnnotation(ST);
+  if (!SA)
+    return nullptr;
+  std::pair<StringRef, StringRef> Split = Path.split('.');
+  for (unsigned i = 0; i < SA->GetNumFields(); ++i) {
+    const DxilFieldAnnotation &FA = SA->GetFieldAnnotation(i);
+    if (FA.GetFieldName() != Split.first)
+      continue;
+    Type *Ty = ST->getElementType(i);
+    if (Split.second.empty()) {
+      Offset += FA.GetCBufferOffset();
+      FieldTy = Ty;
+      return &FA;
+    }
+    StructType *NestedST = dyn_cast<StructType>(Ty);
+    if (!NestedST)
+      return nullptr;
+    unsigned NestedOffset = Offset + FA.GetCBufferOffset();
+    if (const DxilFieldAnnotation *Nested =
+            FindField(TypeSys, NestedST, Split.second, NestedOffset, FieldTy)) {
+      Offset = NestedOffset;
+      return Nested;
+    }
+    return nullptr;
+  }
+  if (SA->GetNumFields() == 1) {
+    if (StructType *NestedST = dyn_cast<StructType>(ST->getElementType(0))) {
+      unsigned NestedOffset =
+          Offset + SA->GetFieldAnnotation(0).GetCBufferOffset();
+      if (const DxilFieldAnnotation *Nested =
+              FindField(TypeSys, NestedST, Path, NestedOffset, FieldTy)) {
+        Offset = NestedOffset;
+        return Nested;
+      }
+    }
+  }
+  return nullptr;
+}
+
+// Returns Value as a constant of type Ty, read as a float or an integer.
+Constant *ParseComponent(StringRef Value, Type *Ty, bool IsFloat) {
+  unsigned Bits = Ty->getPrimitiveSizeInBits();
+  Type *ValueTy = Ty;
+  if (IsFloat != Ty->isFloatingPointTy()) {
+    LLVMContext &Ctx = Ty->getContext();
+    if (!IsFloat)
+      ValueTy = IntegerType::get(Ctx, Bits);
+    else if (Bits == 16)
+      ValueTy = Type::getHalfTy(Ctx);
+    else if (Bits == 32)
+      ValueTy = Type::getFloatTy(Ctx);
+    else if (Bits == 64)
+      ValueTy = Type::getDoubleTy(Ctx);
+    else
+      return nullptr;
+  }
+
+  Constant *C = nullptr;
+  if (IsFloat) {
+    SmallString<32> Str(Value);
+    char *End = nullptr;
+    double D = std::strtod(Str.c_str(), &End);
+    if (Str.empty() || *End != '\0')
+      return nullptr;
+    APFloat F(D);
+    bool LosesInfo = false;
+    F.convert(ValueTy->getFltSemantics(), APFloat::rmNearestTiesToEven,
+              &LosesInfo);
+    C = ConstantFP::get(Ty->getContext(), F);
+  } else {
+    long long Signed;
+    unsigned long long Unsigned;
+    if (Value == "true")
+      Unsigned = 1;
+    else if (Value == "false")
+      Unsigned = 0;
+    else if (!Value.getAsInteger(0, Signed))
+      Unsigned = (unsigned long long)Signed;
+    else if (Value.getAsInteger(0, Unsigned))
+      return nullptr;
+    C = ConstantInt::get(ValueTy, Unsigned);
+  }
+  return ValueTy == Ty ? C : ConstantExpr::getBitCast(C, Ty);
+}
+
+} // namespace
+
+bool DxilSpecializeCBuffer::resolve(
+    Module &M, StringRef Name, StringRef Value,
+    std::map<GlobalVariable *, FieldList> &Fields) {
+  DxilModule &DM = M.GetOrCreateDxilModule();
+  LLVMContext &Ctx = M.getContext();
+  std::pair<StringRef, StringRef> Split = Name.split('.');
+
+  const DxilCBuffer *CB = nullptr;
+  for (auto &C : DM.GetCBuffers()) {
+    if (C->GetGlobalName() == Split.first) {
+      CB = C.get();
+      break;
+    }
+  }
+  GlobalVariable *GV =
+      CB ? dyn_cast_or_null<GlobalVariable>(CB->GetGlobalSymbol()) : nullptr;
+  if (!GV) {
+    dxilutil::EmitErrorOnContext(Ctx, Twine("cannot specialize '") + Name +
+                                          "': no constant buffer named '" +
+                                          Split.first + "'.");
+    return false;
+  }
+
+  StructType *ST = dyn_cast<StructType>(GV->getType()->getPointerElementType());
+  unsigned Offset = 0;
+  Type *FieldTy = nullptr;
+  const DxilFieldAnnotation *FA =
+      ST && !Split.second.empty()
+          ? FindField(DM.GetTypeSystem(), ST, Split.second, Offset, FieldTy)
+          : nullptr;
+  if (!FA) {
+    dxilutil::EmitErrorOnContext(Ctx, Twine("cannot specialize '") + Name +
+                                          "': no field named '" +
+                                          Split.second + "' in '" +
+                                          Split.first + "'.");
+    return false;
+  }
+
+  VectorType *VT = dyn_cast<VectorType>(FieldTy);
+  Type *EltTy = VT ? VT->getElementType() : FieldTy;
+  if (FA->HasMatrixAnnotation() ||
+      !(EltTy->isFloatingPointTy() || EltTy->isIntegerTy())) {
+    dxilutil::EmitErrorOnContext(Ctx, Twine("cannot specialize '") + Name +
+                                          "': only scalar and vector fields "
+                                          "can be specialized.");
+    return false;
+  }
+
+  SpecializedField Field;
+  Field.Offset = Offset;
+  Field.CompSize = EltTy->getPrimitiveSizeInBits() / 8;
+  // Min precision values take a full 32 bits in the buffer.
+  if (Field.CompSize < 4 && DM.GetUseMinPrecision())
+    Field.CompSize = 4;
+  Field.IsFloat = EltTy->isFloatingPointTy();
+  SplitString(Value, Field.Values, ",");
+  for (StringRef &V : Field.Values)
+    V = V.trim();
+
+  unsigned NumComps = VT ? VT->getNumElements() : 1;
+  bool Valid = Field.Values.size() == NumComps;
+  for (unsigned i = 0; Valid && i < NumComps; ++i)
+    Valid = ParseComponent(Field.Values[i], EltTy, Field.IsFloat) != nullptr;
+  if (!Valid) {
+    dxilutil::EmitErrorOnContext(Ctx, Twine("cannot specialize '") + Name +
+                                          "': '" + Value + "' is not " +
+                                          Twine(NumComps) + " " +
+                                          (Field.IsFloat ? "float" : "integer") +
+                                          " value(s).");
+    return false;
+  }
+
+  Fields[GV].push_back(std::move(Field));
+  return true;
+}
+
+bool DxilSpecializeCBuffer::specialize(CallInst *Load,
+                                       const FieldList &Fields) {
+  DxilInst_CBufferLoadLegacy load(Load);
+  ConstantInt *Row = dyn_cast<ConstantInt>(load.get_regIndex());
+  if (!Row)
+    return false;
+
+  StructType *RetTy = cast<StructType>(Load->getType());
+  Type *CompTy = RetTy->getElementType(0);
+  unsigned CompSize = CompTy->getPrimitiveSizeInBits() / 8;
+  unsigned RowOffset = (unsigned)Row->getLimitedValue() * 16;
+
+  bool bUpdated = false;
+  for (auto It = Load->user_begin(); It != Load->user_end();) {
+    ExtractValueInst *EVI = dyn_cast<ExtractValueInst>(*(It++));
+    if (!EVI || EVI->getNumIndices() != 1)
+      continue;
+    unsigned Offset = RowOffset + EVI->getIndices()[0] * CompSize;
+    for (const SpecializedField &Field : Fields) {
+      if (Offset < Field.Offset ||
+          Offset >= Field.Offset + Field.Values.size() * Field.CompSize)
+        continue;
+      unsigned Delta = Offset - Field.Offset;
+      // A read that does not line up with one component is left alone.
+      if (Delta % Field.CompSize || CompSize != Field.CompSize)
+        break;
+      if (Constant *C = ParseComponent(Field.Values[Delta / Field.CompSize],
+                                       EVI->getType(), Field.IsFloat)) {
+        EVI->replaceAllUsesWith(C);
+        EVI->eraseFromParent();
+        bUpdated = true;
+      }
+      break;
+    }
+  }
+  if (Load->use_empty()) {
+    Load->eraseFromParent();
+    bUpdated = true;
+  }
+  return bUpdated;
+}
+
+bool DxilSpecializeCBuffer::runOnModule(Module &M) {
+  if (m_Values.empty() || !M.HasDxilModule())
+    return false;
+
+  std::map<GlobalVariable *, FieldList> Fields;
+  bool Resolved = true;
+  for (auto &It : m_Values)
+    Resolved &= resolve(M, It.first, It.second, Fields);
+  if (!Resolved)
+    return false;
+
+  SmallVector<CallInst *, 16> Loads;
+  for (Function &F : M.functions()) {
+    if (!F.isDeclaration() || !OP::IsDxilOpFunc(&F) ||
+        !F.getName().startswith("dx.op.cbufferLoadLegacy"))
+      continue;
+    for (User *U : F.users()) {
+      CallInst *CI = dyn_cast<CallInst>(U);
+      if (CI && OP::IsDxilOpFuncCallInst(CI, OP::OpCode::CBufferLoadLegacy))
+        Loads.push_back(CI);
+    }
+  }
+
+  bool bUpdated = false;
+  for (CallInst *CI : Loads) {
+    GlobalVariable *GV =
+        GetCBufferGlobal(DxilInst_CBufferLoadLegacy(CI).get_handle());
+    auto It = GV ? Fields.find(GV) : Fields.end();
+    if (It != Fields.end())
+      bUpdated |= specialize(CI, It->second);
+  }
+  return bUpdated;
+}
+
+ModulePass *llvm::createDxilSpecializeCBufferPass(
+    const std::map<std::string, std::string> &Values) {
+  return new DxilSpecializeCBuffer(Values);
+}
+
+ModulePass *llvm::createDxilSpecializeCBufferPass() {
+  return new DxilSpecializeCBuffer();
+}
+
+INITIALIZE_PASS(DxilSpecializeCBuffer, "dxil-specialize-cbuffer",
+                "DXIL specialize cbuffer fields", false, false)
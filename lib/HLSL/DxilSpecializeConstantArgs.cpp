@@ -0,0 +1,139 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// DxilSpecializeConstantArgs.cpp                                            //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Clones functions that are called with constant arguments.                 //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#include "dxc/HLSL/DxilGenerationPass.h"
+#include "dxc/DXIL/DxilModule.h"
+#include "dxc/DXIL/DxilTypeSystem.h"
+
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Pass.h"
+#include "llvm/Transforms/Utils/Cloning.h"
+
+using namespace llvm;
+using namespace hlsl;
+
+// Functions linked from libraries that are not inlined keep the generic
+// body even when every caller passes the same constants, for example a
+// material mode enum. For each set of constant scalar arguments a function
+// is called with, this makes an internal copy with those arguments
+// replaced by the constants and calls it instead. The cleanup passes that
+// follow then fold the branches on them. Originals left without callers
+// are removed by dead function elimination unless they are exported.
+namespace {
+class DxilSpecializeConstantArgs : public ModulePass {
+public:
+  static char ID; // Pass identification, replacement for typeid
+  explicit DxilSpecializeConstantArgs() : ModulePass(ID) {}
+
+  StringRef getPassName() const override {
+    return "DXIL specialize constant arguments";
+  }
+
+  bool runOnModule(Module &M) override;
+
+private:
+  // Constant for each argument, or null where it differs between calls.
+  typedef SmallVector<Constant *, 8> ArgConstants;
+  typedef std::pair<ArgConstants, SmallVector<CallInst *, 4>> CallGroup;
+  bool specialize(Function *F, DxilModule &DM);
+};
+
+char DxilSpecializeConstantArgs::ID = 0;
+
+// Bounds how many copies one function may get.
+const unsigned kMaxSpecializations = 4;
+} // namespace
+
+static bool IsSpecializableArg(Value *V) {
+  return isa<ConstantInt>(V) || isa<ConstantFP>(V);
+}
+
+bool DxilSpecializeConstantArgs::specialize(Function *F, DxilModule &DM) {
+  // Group the calls by the constants they pass, in order of first call.
+  std::vector<CallGroup> Groups;
+  for (User *U : F->users()) {
+    CallInst *CI = dyn_cast<CallInst>(U);
+    if (!CI || CI->getCalledFunction() != F)
+      return false;
+    ArgConstants Args;
+    bool bHasConstant = false;
+    for (Value *V : CI->arg_operands()) {
+      Constant *C = IsSpecializableArg(V) ? cast<Constant>(V) : nullptr;
+      bHasConstant |= C != nullptr;
+      Args.push_back(C);
+    }
+    if (!bHasConstant)
+      continue;
+    auto It = std::find_if(Groups.begin(), Groups.end(),
+                           [&](const CallGroup &G) { return G.first == Args; });
+    if (It == Groups.end())
+      It = Groups.insert(Groups.end(), CallGroup(Args, {}));
+    It->second.push_back(CI);
+  }
+
+  bool bUpdated = false;
+  unsigned NumSpecializations = 0;
+  DxilTypeSystem &TypeSys = DM.GetTypeSystem();
+  for (auto &Group : Groups) {
+    if (NumSpecializations++ == kMaxSpecializations)
+      break;
+    const ArgConstants &Args = Group.first;
+    Function *NewF =
+        Function::Create(F->getFunctionType(), GlobalValue::InternalLinkage,
+                         F->getName() + ".spec", F->getParent());
+    ValueToValueMapTy VMap;
+    auto NewArg = NewF->arg_begin();
+    unsigned i = 0;
+    for (Argument &Arg : F->args()) {
+      NewArg->setName(Arg.getName());
+      VMap[&Arg] = Args[i] ? static_cast<Value *>(Args[i]) : &*NewArg;
+      ++NewArg;
+      ++i;
+    }
+    SmallVector<ReturnInst *, 4> Returns;
+    CloneFunctionInto(NewF, F, VMap, /*ModuleLevelChanges*/ false, Returns);
+    if (TypeSys.GetFunctionAnnotation(F))
+      TypeSys.CopyFunctionAnnotation(NewF, F, TypeSys);
+
+    for (CallInst *CI : Group.second)
+      CI->setCalledFunction(NewF);
+    bUpdated = true;
+  }
+  return bUpdated;
+}
+
+bool DxilSpecializeConstantArgs::runOnModule(Module &M) {
+  if (!M.HasDxilModule())
+    return false;
+  DxilModule &DM = M.GetDxilModule();
+
+  SmallVector<Function *, 16> Candidates;
+  for (Function &F : M) {
+    if (F.isDeclaration() || F.arg_empty() || F.use_empty() ||
+        DM.HasDxilFunctionProps(&F) || DM.IsEntryOrPatchConstantFunction(&F))
+      continue;
+    Candidates.push_back(&F);
+  }
+
+  bool bUpdated = false;
+  for (Function *F : Candidates)
+    bUpdated |= specialize(F, DM);
+  return bUpdated;
+}
+
+ModulePass *llvm::createDxilSpecializeConstantArgsPass() {
+  return new DxilSpecializeConstantArgs();
+}
+
+INITIALIZE_PASS(DxilSpecializeConstantArgs, "dxil-specialize-constant-args",
+                "DXIL specialize constant arguments", false, false)
@@ -0,0 +1,344 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// DxilUniformityAnalysis.cpp                                                //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Uniformity is computed as the least fixed point of a forward data-flow    //
+// problem: values start uniform and only ever become more varying.          //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#include "dxc/HLSL/DxilUniformityAnalysis.h"
+#include "dxc/DXIL/DxilConstants.h"
+#include "dxc/DXIL/DxilOperations.h"
+#include "dxc/DXIL/DxilInstructions.h"
+#include "dxc/Support/Global.h"
+
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/Analysis/LoopInfo.h"
+#include "llvm/Analysis/PostDominators.h"
+#include "llvm/Analysis/ValueTracking.h"
+#include "llvm/IR/CFG.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/GlobalVariable.h"
+#include "llvm/IR/InstIterator.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/IntrinsicInst.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Support/raw_ostream.h"
+
+using namespace llvm;
+using namespace hlsl;
+
+static Uniformity Max(Uniformity A, Uniformity B) { return A < B ? B : A; }
+
+static const char *GetUniformityName(Uniformity U) {
+  switch (U) {
+  case Uniformity::Uniform:
+    return "uniform";
+  case Uniformity::WaveUniform:
+    return "wave-uniform";
+  case Uniformity::Divergent:
+    return "divergent";
+  }
+  return "divergent";
+}
+
+// How much a DXIL operation varies before its operands are considered, and
+// whether its operands are considered at all.
+static Uniformity GetDxilOpUniformity(const UniformityAnalysis &A,
+                                      CallInst *CI, bool &bUsesOperands) {
+  bUsesOperands = true;
+  DXIL::OpCode opcode = OP::GetDxilOpFuncCallInst(CI);
+  switch (OP::GetOpCodeClass(opcode)) {
+  // Pure functions of their operands.
+  case DXIL::OpCodeClass::Unary:
+  case DXIL::OpCodeClass::UnaryBits:
+  case DXIL::OpCodeClass::IsSpecialFloat:
+  case DXIL::OpCodeClass::Binary:
+  case DXIL::OpCodeClass::BinaryWithCarryOrBorrow:
+  case DXIL::OpCodeClass::BinaryWithTwoOuts:
+  case DXIL::OpCodeClass::Tertiary:
+  case DXIL::OpCodeClass::Quaternary:
+  case DXIL::OpCodeClass::Dot2:
+  case DXIL::OpCodeClass::Dot3:
+  case DXIL::OpCodeClass::Dot4:
+  case DXIL::OpCodeClass::Dot2AddHalf:
+  case DXIL::OpCodeClass::Dot4AddPacked:
+  case DXIL::OpCodeClass::BitcastF16toI16:
+  case DXIL::OpCodeClass::BitcastF32toI32:
+  case DXIL::OpCodeClass::BitcastF64toI64:
+  case DXIL::OpCodeClass::BitcastI16toF16:
+  case DXIL::OpCodeClass::BitcastI32toF32:
+  case DXIL::OpCodeClass::BitcastI64toF64:
+  case DXIL::OpCodeClass::LegacyF16ToF32:
+  case DXIL::OpCodeClass::LegacyF32ToF16:
+  case DXIL::OpCodeClass::LegacyDoubleToFloat:
+  case DXIL::OpCodeClass::LegacyDoubleToSInt32:
+  case DXIL::OpCodeClass::LegacyDoubleToUInt32:
+  case DXIL::OpCodeClass::MakeDouble:
+  case DXIL::OpCodeClass::SplitDouble:
+  case DXIL::OpCodeClass::Pack4x8:
+  case DXIL::OpCodeClass::Unpack4x8:
+  // Handles, and reads of state that does not change during the shader.
+  case DXIL::OpCodeClass::CreateHandle:
+  case DXIL::OpCodeClass::CreateHandleForLib:
+  case DXIL::OpCodeClass::CreateHandleFromBinding:
+  case DXIL::OpCodeClass::CreateHandleFromHeap:
+  case DXIL::OpCodeClass::AnnotateHandle:
+  case DXIL::OpCodeClass::CBufferLoad:
+  case DXIL::OpCodeClass::CBufferLoadLegacy:
+  case DXIL::OpCodeClass::GetDimensions:
+  case DXIL::OpCodeClass::CheckAccessFullyMapped:
+  case DXIL::OpCodeClass::RenderTargetGetSampleCount:
+  case DXIL::OpCodeClass::RenderTargetGetSamplePosition:
+  case DXIL::OpCodeClass::Texture2DMSGetSamplePosition:
+  case DXIL::OpCodeClass::WaveGetLaneCount:
+  case DXIL::OpCodeClass::DispatchRaysDimensions:
+    return Uniformity::Uniform;
+
+  // Resource reads see the same memory across a wave, but UAVs may be
+  // written by other waves between reads.
+  case DXIL::OpCodeClass::BufferLoad:
+  case DXIL::OpCodeClass::RawBufferLoad:
+  case DXIL::OpCodeClass::TextureLoad:
+  case DXIL::OpCodeClass::Sample:
+  case DXIL::OpCodeClass::SampleBias:
+  case DXIL::OpCodeClass::SampleCmp:
+  case DXIL::OpCodeClass::SampleCmpLevel:
+  case DXIL::OpCodeClass::SampleCmpLevelZero:
+  case DXIL::OpCodeClass::SampleGrad:
+  case DXIL::OpCodeClass::SampleLevel:
+  case DXIL::OpCodeClass::TextureGather:
+  case DXIL::OpCodeClass::TextureGatherCmp:
+  case DXIL::OpCodeClass::TextureGatherRaw:
+  case DXIL::OpCodeClass::CalculateLOD:
+  // A wave runs within one thread group.
+  case DXIL::OpCodeClass::GroupId:
+    return Uniformity::WaveUniform;
+
+  // Reductions across the wave, whatever each lane contributed.
+  case DXIL::OpCodeClass::WaveActiveAllEqual:
+  case DXIL::OpCodeClass::WaveActiveBallot:
+  case DXIL::OpCodeClass::WaveActiveBit:
+  case DXIL::OpCodeClass::WaveActiveOp:
+  case DXIL::OpCodeClass::WaveAllOp:
+  case DXIL::OpCodeClass::WaveAllTrue:
+  case DXIL::OpCodeClass::WaveAnyTrue:
+  case DXIL::OpCodeClass::WaveReadLaneFirst:
+    bUsesOperands = false;
+    return Uniformity::WaveUniform;
+  // Reads the same lane everywhere when the lane index is the same.
+  case DXIL::OpCodeClass::WaveReadLaneAt: {
+    bUsesOperands = false;
+    DxilInst_WaveReadLaneAt readLaneAt(CI);
+    return Max(Uniformity::WaveUniform, A.GetUniformity(readLaneAt.get_lane()));
+  }
+
+  // Thread ids, inputs, atomics, per-lane wave operations and anything not
+  // listed above.
+  default:
+    bUsesOperands = false;
+    return Uniformity::Divergent;
+  }
+}
+
+// How much a load varies, besides its address.
+static Uniformity GetLoadUniformity(LoadInst *LI) {
+  const DataLayout &DL = LI->getModule()->getDataLayout();
+  Value *Ptr = GetUnderlyingObject(LI->getPointerOperand(), DL);
+  if (GlobalVariable *GV = dyn_cast<GlobalVariable>(Ptr)) {
+    if (GV->isConstant())
+      return Uniformity::Uniform;
+    if (GV->getType()->getPointerAddressSpace() == DXIL::kTGSMAddrSpace)
+      return Uniformity::WaveUniform;
+  }
+  // Allocas and static globals hold a separate value for each thread.
+  return Uniformity::Divergent;
+}
+
+Uniformity UniformityAnalysis::ComputeInst(Instruction *I) const {
+  Uniformity U = Uniformity::Uniform;
+  bool bUsesOperands = true;
+  unsigned firstArg = 0;
+  if (CallInst *CI = dyn_cast<CallInst>(I)) {
+    if (OP::IsDxilOpFuncCallInst(CI)) {
+      U = GetDxilOpUniformity(*this, CI, bUsesOperands);
+      firstArg = 1;
+    } else if (isa<DbgInfoIntrinsic>(CI)) {
+      bUsesOperands = false;
+    } else {
+      U = Uniformity::Divergent;
+    }
+  } else if (LoadInst *LI = dyn_cast<LoadInst>(I)) {
+    U = GetLoadUniformity(LI);
+  } else if (isa<AtomicRMWInst>(I) || isa<AtomicCmpXchgInst>(I) ||
+             isa<LandingPadInst>(I) || isa<VAArgInst>(I)) {
+    U = Uniformity::Divergent;
+  }
+
+  if (bUsesOperands) {
+    for (unsigned i = firstArg; i < I->getNumOperands(); ++i) {
+      if (U == Uniformity::Divergent)
+        break;
+      Value *V = I->getOperand(i);
+      if (isa<BasicBlock>(V) || isa<Function>(V))
+        continue;
+      U = Max(U, GetUniformity(V));
+    }
+  }
+
+  auto It = m_SyncState.find(I);
+  if (It != m_SyncState.end())
+    U = Max(U, It->second);
+  return U;
+}
+
+void UniformityAnalysis::Update(Instruction *I) {
+  Uniformity U = ComputeInst(I);
+  if (U == Uniformity::Uniform)
+    return;
+  auto It = m_State.find(I);
+  if (It != m_State.end() && It->second >= U)
+    return;
+  m_State[I] = U;
+  m_WorkList.push_back(I);
+}
+
+void UniformityAnalysis::UpdateSync(Instruction *I, Uniformity U) {
+  Uniformity &Sync = m_SyncState[I];
+  if (Sync >= U)
+    return;
+  Sync = U;
+  Update(I);
+}
+
+// Lanes that take different sides of TI may meet again at a phi, which then
+// picks a different value for each of them, or may leave a loop in different
+// iterations, so that values from the loop differ once outside of it.
+void UniformityAnalysis::PropagateBranch(TerminatorInst *TI, Uniformity U) {
+  BasicBlock *BB = TI->getParent();
+  BasicBlock *IPDom = nullptr;
+  if (DomTreeNode *Node = m_pPDT->getNode(BB))
+    if (DomTreeNode *IPDomNode = Node->getIDom())
+      IPDom = IPDomNode->getBlock();
+
+  // Blocks reached from TI before its paths all meet, and the ones among
+  // them that are reached from more than one successor.
+  DenseMap<BasicBlock *, BasicBlock *> Region; // block -> first successor
+  SmallPtrSet<BasicBlock *, 8> Joins;
+  SmallPtrSet<BasicBlock *, 4> Succs;
+  for (BasicBlock *Succ : successors(BB)) {
+    if (!Succs.insert(Succ).second)
+      continue;
+    SmallPtrSet<BasicBlock *, 16> Visited;
+    SmallVector<BasicBlock *, 16> WorkList;
+    Visited.insert(Succ);
+    WorkList.push_back(Succ);
+    while (!WorkList.empty()) {
+      BasicBlock *Cur = WorkList.pop_back_val();
+      auto It = Region.find(Cur);
+      if (It == Region.end())
+        Region[Cur] = Succ;
+      else if (It->second != Succ)
+        Joins.insert(Cur);
+      if (Cur == IPDom)
+        continue;
+      for (BasicBlock *Next : successors(Cur))
+        if (Visited.insert(Next).second)
+          WorkList.push_back(Next);
+    }
+  }
+
+  for (BasicBlock *Join : Joins) {
+    for (Instruction &I : *Join) {
+      PHINode *Phi = dyn_cast<PHINode>(&I);
+      if (!Phi)
+        break;
+      if (!Phi->hasConstantValue())
+        UpdateSync(Phi, U);
+    }
+  }
+
+  for (Loop *L = m_pLI->getLoopFor(BB); L; L = L->getParentLoop()) {
+    bool bExits = !IPDom || !L->contains(IPDom);
+    for (auto &It : Region) {
+      if (bExits)
+        break;
+      bExits = !L->contains(It.first);
+    }
+    if (!bExits)
+      break;
+    for (BasicBlock *LoopBB : L->getBlocks()) {
+      for (Instruction &I : *LoopBB) {
+        for (User *User : I.users()) {
+          Instruction *UI = cast<Instruction>(User);
+          if (!L->contains(UI->getParent()))
+            UpdateSync(UI, U);
+        }
+      }
+    }
+  }
+}
+
+void UniformityAnalysis::Compute(Function *F, PostDominatorTree &PDT,
+                                 LoopInfo &LI) {
+  Clear();
+  m_pFunc = F;
+  m_pPDT = &PDT;
+  m_pLI = &LI;
+
+  for (Instruction &I : inst_range(F))
+    Update(&I);
+
+  while (!m_WorkList.empty()) {
+    Instruction *I = m_WorkList.back();
+    m_WorkList.pop_back();
+    for (User *U : I->users())
+      Update(cast<Instruction>(U));
+    if (TerminatorInst *TI = dyn_cast<TerminatorInst>(I))
+      if (TI->getNumSuccessors() > 1)
+        PropagateBranch(TI, m_State[TI]);
+  }
+}
+
+void UniformityAnalysis::Clear() {
+  m_pFunc = nullptr;
+  m_pPDT = nullptr;
+  m_pLI = nullptr;
+  m_State.clear();
+  m_SyncState.clear();
+  m_WorkList.clear();
+}
+
+Uniformity UniformityAnalysis::GetUniformity(Value *V) const {
+  if (Instruction *I = dyn_cast<Instruction>(V)) {
+    DXASSERT(I->getParent()->getParent() == m_pFunc,
+             "else instruction is not from the analyzed function");
+    auto It = m_State.find(I);
+    return It == m_State.end() ? Uniformity::Uniform : It->second;
+  }
+  // Arguments of functions that were not inlined are not known.
+  if (isa<Argument>(V))
+    return Uniformity::Divergent;
+  if (isa<Constant>(V))
+    return Uniformity::Uniform;
+  return Uniformity::Divergent;
+}
+
+void UniformityAnalysis::print(raw_ostream &OS) {
+  OS << "Uniformity for function '" << m_pFunc->getName() << "'\n";
+  for (Instruction &I : inst_range(m_pFunc)) {
+    if (I.getType()->isVoidTy() && !isa<TerminatorInst>(I))
+      continue;
+    OS << GetUniformityName(GetUniformity(&I)) << ":" << I << "\n";
+  }
+}
+
+void UniformityAnalysis::dump() {
+  print(dbgs());
+}
@@ -0,0 +1,355 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// DxilUniformityOpt.cpp                                                     //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Passes that use UniformityAnalysis to help drivers keep work scalar.      //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#include "dxc/HLSL/DxilGenerationPass.h"
+#include "dxc/HLSL/DxilUniformityAnalysis.h"
+#include "dxc/DXIL/DxilMetadataHelper.h"
+#include "dxc/DXIL/DxilModule.h"
+#include "dxc/DXIL/DxilOperations.h"
+#include "dxc/DXIL/DxilInstructions.h"
+
+#include "llvm/Analysis/LoopInfo.h"
+#include "llvm/Analysis/PostDominators.h"
+#include "llvm/Analysis/ValueTracking.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/Dominators.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/IntrinsicInst.h"
+#include "llvm/IR/Module.h"
+
+using namespace llvm;
+using namespace hlsl;
+
+namespace {
+
+// Index and flag operands of the handle creations that take a
+// NonUniformResourceIndex flag.
+bool GetNonUniformIndexOperands(CallInst *CI, unsigned &IndexIdx,
+                                unsigned &FlagIdx) {
+  if (OP::IsDxilOpFuncCallInst(CI, OP::OpCode::CreateHandle)) {
+    IndexIdx = DxilInst_CreateHandle::arg_index;
+    FlagIdx = DxilInst_CreateHandle::arg_nonUniformIndex;
+  } else if (OP::IsDxilOpFuncCallInst(CI,
+                                      OP::OpCode::CreateHandleFromBinding)) {
+    IndexIdx = DxilInst_CreateHandleFromBinding::arg_index;
+    FlagIdx = DxilInst_CreateHandleFromBinding::arg_nonUniformIndex;
+  } else if (OP::IsDxilOpFuncCallInst(CI, OP::OpCode::CreateHandleFromHeap)) {
+    IndexIdx = DxilInst_CreateHandleFromHeap::arg_index;
+    FlagIdx = DxilInst_CreateHandleFromHeap::arg_nonUniformIndex;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+// Returns what a wave operation on a wave-uniform value computes without
+// the wave operation, inserting any instructions needed before CI, or null
+// if it cannot be folded. Sums need hlslOP to count the active lanes.
+Value *FoldUniformWaveOp(CallInst *CI, hlsl::OP *hlslOP) {
+  switch (OP::GetDxilOpFuncCallInst(CI)) {
+  case OP::OpCode::WaveReadLaneFirst:
+  case OP::OpCode::WaveReadLaneAt:
+  case OP::OpCode::WaveAnyTrue:
+  case OP::OpCode::WaveAllTrue:
+    return CI->getArgOperand(1);
+  case OP::OpCode::WaveActiveAllEqual:
+    return ConstantInt::getTrue(CI->getType());
+  case OP::OpCode::WaveActiveBit: {
+    DxilInst_WaveActiveBit bitOp(CI);
+    if (!isa<ConstantInt>(bitOp.get_op()) ||
+        (DXIL::WaveBitOpKind)bitOp.get_op_val() == DXIL::WaveBitOpKind::Xor)
+      return nullptr;
+    return bitOp.get_value();
+  }
+  case OP::OpCode::WaveActiveOp: {
+    DxilInst_WaveActiveOp waveOp(CI);
+    if (!isa<ConstantInt>(waveOp.get_op()))
+      return nullptr;
+    Value *V = waveOp.get_value();
+    switch ((DXIL::WaveOpKind)waveOp.get_op_val()) {
+    case DXIL::WaveOpKind::Min:
+    case DXIL::WaveOpKind::Max:
+      return V;
+    case DXIL::WaveOpKind::Sum: {
+      // Each active lane adds the same value.
+      if (!hlslOP)
+        return nullptr;
+      IRBuilder<> Builder(CI);
+      Function *CountBits = hlslOP->GetOpFunc(OP::OpCode::WaveAllBitCount,
+                                              Builder.getVoidTy());
+      Value *Count = Builder.CreateCall(
+          CountBits,
+          {hlslOP->GetU32Const((unsigned)OP::OpCode::WaveAllBitCount),
+           Builder.getTrue()});
+      Type *Ty = V->getType();
+      if (Ty->isFloatingPointTy())
+        return Builder.CreateFMul(V, Builder.CreateUIToFP(Count, Ty));
+      return Builder.CreateMul(V, Builder.CreateZExtOrTrunc(Count, Ty));
+    }
+    case DXIL::WaveOpKind::Product:
+      return nullptr;
+    }
+    return nullptr;
+  }
+  default:
+    return nullptr;
+  }
+}
+
+} // namespace
+
+// Uses uniformity to:
+//   - clear the NonUniformResourceIndex flag of handles whose index is the
+//     same across the wave, so drivers do not loop over the lanes;
+//   - replace wave operations on wave-uniform values with what they
+//     compute, e.g. WaveReadLaneFirst(cb.x) with cb.x and WaveActiveSum(u)
+//     with u * WaveActiveCountBits(true);
+//   - move uniform computations out of blocks that only some lanes of a
+//     wave enter, up to the divergent branch. They are then computed once
+//     for the wave rather than under a partial mask, for example:
+//   if (tid < n)
+//     r = buf[tid] * (cb.scale * 2);  // cb.scale * 2 is computed before the
+//                                     // branch.
+// Only instructions that are safe to speculate are moved. Wave operations
+// are kept with -opt-disable fold-uniform-wave-ops.
+namespace {
+class DxilUniformityOpt : public FunctionPass {
+public:
+  static char ID; // Pass identification, replacement for typeid
+  explicit DxilUniformityOpt(bool FoldWaveOps = true)
+      : FunctionPass(ID), m_FoldWaveOps(FoldWaveOps) {}
+
+  StringRef getPassName() const override {
+    return "DXIL uniformity optimizations";
+  }
+
+  void getAnalysisUsage(AnalysisUsage &AU) const override {
+    AU.addRequired<DominatorTreeWrapperPass>();
+    AU.addRequired<PostDominatorTree>();
+    AU.addRequired<LoopInfoWrapperPass>();
+    AU.setPreservesCFG();
+  }
+
+  bool runOnFunction(Function &F) override;
+
+private:
+  bool m_FoldWaveOps;
+  bool clearNonUniformFlags(Function &F, UniformityAnalysis &UA);
+  bool hoistUniformInstructions(Function &F, UniformityAnalysis &UA,
+                                DominatorTree &DT, PostDominatorTree &PDT,
+                                LoopInfo &LI);
+  bool foldUniformWaveOps(Function &F, UniformityAnalysis &UA);
+};
+
+char DxilUniformityOpt::ID = 0;
+} // namespace
+
+bool DxilUniformityOpt::clearNonUniformFlags(Function &F,
+                                             UniformityAnalysis &UA) {
+  bool bUpdated = false;
+  for (BasicBlock &BB : F) {
+    for (Instruction &I : BB) {
+      CallInst *CI = dyn_cast<CallInst>(&I);
+      unsigned IndexIdx, FlagIdx;
+      if (!CI || !GetNonUniformIndexOperands(CI, IndexIdx, FlagIdx))
+        continue;
+      ConstantInt *Flag = dyn_cast<ConstantInt>(CI->getArgOperand(FlagIdx));
+      if (!Flag || Flag->isZero())
+        continue;
+      if (!UA.IsWaveUniform(CI->getArgOperand(IndexIdx)))
+        continue;
+      CI->setArgOperand(FlagIdx,
+                        ConstantInt::getFalse(Flag->getType()->getContext()));
+      bUpdated = true;
+    }
+  }
+  return bUpdated;
+}
+
+bool DxilUniformityOpt::hoistUniformInstructions(Function &F,
+                                                 UniformityAnalysis &UA,
+                                                 DominatorTree &DT,
+                                                 PostDominatorTree &PDT,
+                                                 LoopInfo &LI) {
+  bool bUpdated = false;
+  for (BasicBlock &BB : F) {
+    DomTreeNode *Node = DT.getNode(&BB);
+    if (!Node || !Node->getIDom())
+      continue;
+    BasicBlock *IDom = Node->getIDom()->getBlock();
+    TerminatorInst *Branch = IDom->getTerminator();
+    if (Branch->getNumSuccessors() < 2 || UA.IsWaveUniform(Branch))
+      continue;
+    // Blocks where the paths meet again run with the same lanes.
+    if (PDT.dominates(&BB, IDom))
+      continue;
+    // Do not move into a loop that the block is not in.
+    Loop *BlockLoop = LI.getLoopFor(&BB);
+    Loop *IDomLoop = LI.getLoopFor(IDom);
+    if (IDomLoop && (!BlockLoop || !IDomLoop->contains(BlockLoop)))
+      continue;
+
+    for (auto It = BB.begin(), E = BB.end(); It != E;) {
+      Instruction *I = &*(It++);
+      if (isa<PHINode>(I) || isa<TerminatorInst>(I) ||
+          isa<DbgInfoIntrinsic>(I) || I->mayReadOrWriteMemory() ||
+          !isSafeToSpeculativelyExecute(I) || !UA.IsWaveUniform(I))
+        continue;
+      bool bOperandsAvailable = true;
+      for (Value *V : I->operands()) {
+        Instruction *OpI = dyn_cast<Instruction>(V);
+        if (OpI && OpI->getParent() == &BB) {
+          bOperandsAvailable = false;
+          break;
+        }
+      }
+      if (!bOperandsAvailable)
+        continue;
+      I->moveBefore(Branch);
+      bUpdated = true;
+    }
+  }
+  return bUpdated;
+}
+
+bool DxilUniformityOpt::foldUniformWaveOps(Function &F,
+                                           UniformityAnalysis &UA) {
+  Module *M = F.getParent();
+  hlsl::OP *hlslOP = M->HasDxilModule() ? M->GetDxilModule().GetOP() : nullptr;
+  // Collect first: folding adds instructions the analysis has not seen.
+  SmallVector<CallInst *, 8> WaveOps;
+  for (BasicBlock &BB : F) {
+    for (Instruction &I : BB) {
+      CallInst *CI = dyn_cast<CallInst>(&I);
+      if (!CI || !OP::IsDxilOpFuncCallInst(CI))
+        continue;
+      switch (OP::GetDxilOpFuncCallInst(CI)) {
+      case OP::OpCode::WaveReadLaneFirst:
+      case OP::OpCode::WaveReadLaneAt:
+      case OP::OpCode::WaveAnyTrue:
+      case OP::OpCode::WaveAllTrue:
+      case OP::OpCode::WaveActiveAllEqual:
+      case OP::OpCode::WaveActiveBit:
+      case OP::OpCode::WaveActiveOp:
+        if (UA.IsWaveUniform(CI->getArgOperand(1)))
+          WaveOps.push_back(CI);
+        break;
+      default:
+        break;
+      }
+    }
+  }
+
+  bool bUpdated = false;
+  for (CallInst *CI : WaveOps) {
+    if (Value *Folded = FoldUniformWaveOp(CI, hlslOP)) {
+      CI->replaceAllUsesWith(Folded);
+      CI->eraseFromParent();
+      bUpdated = true;
+    }
+  }
+  return bUpdated;
+}
+
+bool DxilUniformityOpt::runOnFunction(Function &F) {
+  DominatorTree &DT = getAnalysis<DominatorTreeWrapperPass>().getDomTree();
+  PostDominatorTree &PDT = getAnalysis<PostDominatorTree>();
+  LoopInfo &LI = getAnalysis<LoopInfoWrapperPass>().getLoopInfo();
+
+  UniformityAnalysis UA;
+  UA.Compute(&F, PDT, LI);
+  bool bUpdated = clearNonUniformFlags(F, UA);
+  bUpdated |= hoistUniformInstructions(F, UA, DT, PDT, LI);
+  if (m_FoldWaveOps)
+    bUpdated |= foldUniformWaveOps(F, UA);
+  return bUpdated;
+}
+
+FunctionPass *llvm::createDxilUniformityOptPass(bool FoldWaveOps) {
+  return new DxilUniformityOpt(FoldWaveOps);
+}
+
+INITIALIZE_PASS_BEGIN(DxilUniformityOpt, "dxil-uniformity-opt",
+                      "DXIL uniformity optimizations", false, false)
+INITIALIZE_PASS_DEPENDENCY(DominatorTreeWrapperPass)
+INITIALIZE_PASS_DEPENDENCY(PostDominatorTree)
+INITIALIZE_PASS_DEPENDENCY(LoopInfoWrapperPass)
+INITIALIZE_PASS_END(DxilUniformityOpt, "dxil-uniformity-opt",
+                    "DXIL uniformity optimizations", false, false)
+
+// Marks uniform and wave-uniform values, and branches, with dx.uniformity
+// metadata so drivers can keep them in scalar registers without redoing the
+// analysis. Enabled with -opt-enable uniformity-metadata.
+namespace {
+class DxilAnnotateUniformity : public FunctionPass {
+public:
+  static char ID; // Pass identification, replacement for typeid
+  explicit DxilAnnotateUniformity() : FunctionPass(ID) {}
+
+  StringRef getPassName() const override {
+    return "DXIL annotate uniformity";
+  }
+
+  void getAnalysisUsage(AnalysisUsage &AU) const override {
+    AU.addRequired<PostDominatorTree>();
+    AU.addRequired<LoopInfoWrapperPass>();
+    AU.setPreservesAll();
+  }
+
+  bool runOnFunction(Function &F) override {
+    PostDominatorTree &PDT = getAnalysis<PostDominatorTree>();
+    LoopInfo &LI = getAnalysis<LoopInfoWrapperPass>().getLoopInfo();
+    UniformityAnalysis UA;
+    UA.Compute(&F, PDT, LI);
+
+    bool bUpdated = false;
+    for (BasicBlock &BB : F) {
+      for (Instruction &I : BB) {
+        // Values, and branches that pick between successors.
+        if (TerminatorInst *TI = dyn_cast<TerminatorInst>(&I)) {
+          if (TI->getNumSuccessors() < 2)
+            continue;
+        } else if (I.getType()->isVoidTy()) {
+          continue;
+        }
+        switch (UA.GetUniformity(&I)) {
+        case Uniformity::Uniform:
+          DxilMDHelper::MarkUniformity(&I,
+                                       DxilMDHelper::kDxilUniformityUniform);
+          break;
+        case Uniformity::WaveUniform:
+          DxilMDHelper::MarkUniformity(&I,
+                                       DxilMDHelper::kDxilUniformityWaveUniform);
+          break;
+        case Uniformity::Divergent:
+          continue;
+        }
+        bUpdated = true;
+      }
+    }
+    return bUpdated;
+  }
+};
+
+char DxilAnnotateUniformity::ID = 0;
+} // namespace
+
+FunctionPass *llvm::createDxilAnnotateUniformityPass() {
+  return new DxilAnnotateUniformity();
+}
+
+INITIALIZE_PASS_BEGIN(DxilAnnotateUniformity, "dxil-annotate-uniformity",
+                      "DXIL annotate uniformity", false, false)
+INITIALIZE_PASS_DEPENDENCY(PostDominatorTree)
+INITIALIZE_PASS_DEPENDENCY(LoopInfoWrapperPass)
+INITIALIZE_PASS_END(DxilAnnotateUniformity, "dxil-annotate-uniformity",
+                    "DXIL annotate uniformity", false, false)
@@ -43,7 +43,9 @@
 #include "llvm/IR/IntrinsicInst.h"
 #include "llvm/IR/Verifier.h"
 #include "llvm/IR/ModuleSlotTracker.h"
+#include "llvm/IR/TypeFinder.h"
 #include "llvm/ADT/BitVector.h"
+#include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Bitcode/ReaderWriter.h"
@@ -57,7 +59,13 @@
 #include "dxc/HLSL/DxilPackSignatureElement.h"
 #include "dxc/DxilRootSignature/DxilRootSignature.h"
 #include <algorithm>
+#include <atomic>
 #include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <system_error>
+#include <thread>
 
 using namespace llvm;
 using namespace std;
@@ -147,6 +155,23 @@ struct EntryStatus {
   }
 };
 
+// Diagnostics queued by the function being validated on this thread, or
+// null when diagnostics are emitted as they are found.
+typedef std::vector<std::function<void()>> DeferredDiagList;
+static thread_local DeferredDiagList *t_pDeferredDiags = nullptr;
+
+// Set while a SerialFunctionValidationScope is alive on this thread.
+static thread_local bool t_bSerialFunctionValidation = false;
+
+SerialFunctionValidationScope::SerialFunctionValidationScope()
+    : m_prevSerial(t_bSerialFunctionValidation) {
+  t_bSerialFunctionValidation = true;
+}
+
+SerialFunctionValidationScope::~SerialFunctionValidationScope() {
+  t_bSerialFunctionValidation = m_prevSerial;
+}
+
 struct ValidationContext {
   bool Failed = false;
   Module &M;
@@ -162,15 +187,28 @@ struct ValidationContext {
   std::unordered_map<Value *, unsigned> HandleResIndexMap;
   // TODO: save resource map for each createHandle/createHandleForLib.
   std::unordered_map<Value *, DxilResourceProperties> ResPropMap;
+  // Global symbols of all resources, for library targets.
+  llvm::SmallPtrSet<const Value *, 16> ResGlobalSymbols;
   std::unordered_map<Function *, std::vector<Function*>> PatchConstantFuncMap;
   std::unordered_map<Function *, std::unique_ptr<EntryStatus>> entryStatusMap;
   bool isLibProfile;
   const unsigned kDxilControlFlowHintMDKind;
   const unsigned kDxilPreciseMDKind;
   const unsigned kDxilNonUniformMDKind;
+  const unsigned kDxilUniformityMDKind;
   const unsigned kLLVMLoopMDKind;
   unsigned m_DxilMajor, m_DxilMinor;
   ModuleSlotTracker slotTracker;
+  // Guards hlsl::OP, which creates its helper types on first use.
+  std::mutex OPMutex;
+  // Dominator trees shared by the flow control, TGSM race and
+  // mesh/amplification checks. A tree is kept only while a later check of
+  // its function still needs it, see IsShaderKind. The maps are guarded
+  // by CFGMutex; a tree is only used by the thread validating its function.
+  std::unordered_map<Function *, std::unique_ptr<DominatorTree>> DomTreeMap;
+  std::unordered_map<Function *, std::unique_ptr<PostDominatorTree>>
+      PostDomTreeMap;
+  std::mutex CFGMutex;
 
   ValidationContext(Module &llvmModule, Module *DebugModule,
                     DxilModule &dxilModule)
@@ -183,6 +221,8 @@ struct ValidationContext {
             DxilMDHelper::kDxilPreciseAttributeMDName)),
         kDxilNonUniformMDKind(llvmModule.getContext().getMDKindID(
             DxilMDHelper::kDxilNonUniformAttributeMDName)),
+        kDxilUniformityMDKind(llvmModule.getContext().getMDKindID(
+            DxilMDHelper::kDxilUniformityAttributeMDName)),
         kLLVMLoopMDKind(llvmModule.getContext().getMDKindID("llvm.loop")),
         slotTracker(&llvmModule, true) {
     DxilMod.GetDxilVersion(m_DxilMajor, m_DxilMinor);
@@ -223,6 +263,44 @@ struct ValidationContext {
     }
   }
 
+  DominatorTree &GetDomTree(Function *F) {
+    std::lock_guard<std::mutex> CFGLock(CFGMutex);
+    std::unique_ptr<DominatorTree> &DT = DomTreeMap[F];
+    if (!DT) {
+      DT = llvm::make_unique<DominatorTree>();
+      DT->recalculate(*F);
+    }
+    return *DT;
+  }
+
+  PostDominatorTree &GetPostDomTree(Function *F) {
+    std::lock_guard<std::mutex> CFGLock(CFGMutex);
+    std::unique_ptr<PostDominatorTree> &PDT = PostDomTreeMap[F];
+    if (!PDT) {
+      PDT = llvm::make_unique<PostDominatorTree>();
+      PDT->runOnFunction(*F);
+    }
+    return *PDT;
+  }
+
+  // The body checks of mesh shaders reuse the dominator tree, and those of
+  // amplification shaders the post-dominator tree. Other functions free a
+  // tree as soon as the check that built it is done.
+  bool IsShaderKind(Function *F, DXIL::ShaderKind Kind) {
+    return DxilMod.HasDxilFunctionProps(F) &&
+           DxilMod.GetDxilFunctionProps(F).shaderKind == Kind;
+  }
+
+  void ReleaseDomTree(Function *F) {
+    std::lock_guard<std::mutex> CFGLock(CFGMutex);
+    DomTreeMap.erase(F);
+  }
+
+  void ReleasePostDomTree(Function *F) {
+    std::lock_guard<std::mutex> CFGLock(CFGMutex);
+    PostDomTreeMap.erase(F);
+  }
+
   void PropagateResMap(Value *V, DxilResourceBase *Res) {
     auto it = ResPropMap.find(V);
     if (it != ResPropMap.end()) {
@@ -263,14 +341,22 @@ struct ValidationContext {
     if (isLibProfile) {
       std::unordered_set<Value *> ResSet;
       // Start from all global variable in resTab.
-      for (auto &Res : DxilMod.GetCBuffers())
+      for (auto &Res : DxilMod.GetCBuffers()) {
+        ResGlobalSymbols.insert(Res->GetGlobalSymbol());
         PropagateResMap(Res->GetGlobalSymbol(), Res.get());
-      for (auto &Res : DxilMod.GetUAVs())
+      }
+      for (auto &Res : DxilMod.GetUAVs()) {
+        ResGlobalSymbols.insert(Res->GetGlobalSymbol());
         PropagateResMap(Res->GetGlobalSymbol(), Res.get());
-      for (auto &Res : DxilMod.GetSRVs())
+      }
+      for (auto &Res : DxilMod.GetSRVs()) {
+        ResGlobalSymbols.insert(Res->GetGlobalSymbol());
         PropagateResMap(Res->GetGlobalSymbol(), Res.get());
-      for (auto &Res : DxilMod.GetSamplers())
+      }
+      for (auto &Res : DxilMod.GetSamplers()) {
+        ResGlobalSymbols.insert(Res->GetGlobalSymbol());
         PropagateResMap(Res->GetGlobalSymbol(), Res.get());
+      }
     } else {
       // Scan all createHandle.
       for (auto &it : hlslOP->GetOpFuncList(DXIL::OpCode::CreateHandle)) {
@@ -388,10 +474,30 @@ struct ValidationContext {
     return entryStatusMap.find(F) != entryStatusMap.end();
   }
 
-  EntryStatus &GetEntryStatus(Function *F) { return *entryStatusMap[F]; }
+  // Only looks the status up, so that it is safe on worker threads.
+  EntryStatus &GetEntryStatus(Function *F) {
+    return *entryStatusMap.find(F)->second;
+  }
 
   DxilResourceProperties GetResourceFromVal(Value *resVal);
 
+  // Queues Emit when the calling thread is validating a function body
+  // concurrently with others; the queue is replayed in module order so the
+  // output matches serial validation. Returns false if Emit should run now.
+  bool DeferDiagnostic(std::function<void()> Emit) {
+    if (!t_pDeferredDiags)
+      return false;
+    t_pDeferredDiags->emplace_back(std::move(Emit));
+    return true;
+  }
+
+  void EmitErrorText(const std::string &Text) {
+    if (DeferDiagnostic([=] { EmitErrorText(Text); }))
+      return;
+    dxilutil::EmitErrorOnContext(M.getContext(), Text);
+    Failed = true;
+  }
+
   void EmitGlobalVariableFormatError(GlobalVariable *GV, ValidationRule rule,
                                      ArrayRef<StringRef> args) {
     std::string ruleText = GetValidationRuleText(rule);
@@ -404,8 +510,7 @@ struct ValidationContext {
 
   // This is the least desirable mechanism, as it has no context.
   void EmitError(ValidationRule rule) {
-    dxilutil::EmitErrorOnContext(M.getContext(), GetValidationRuleText(rule));
-    Failed = true;
+    EmitErrorText(GetValidationRuleText(rule));
   }
 
   void FormatRuleText(std::string &ruleText, ArrayRef<StringRef> args) {
@@ -436,16 +541,16 @@ struct ValidationContext {
   void EmitFormatError(ValidationRule rule, ArrayRef<StringRef> args) {
     std::string ruleText = GetValidationRuleText(rule);
     FormatRuleText(ruleText, args);
-    dxilutil::EmitErrorOnContext(M.getContext(), ruleText);
-    Failed = true;
+    EmitErrorText(ruleText);
   }
 
   void EmitMetaError(Metadata *Meta, ValidationRule rule) {
+    if (DeferDiagnostic([=] { EmitMetaError(Meta, rule); }))
+      return;
     std::string O;
     raw_string_ostream OSS(O);
     Meta->print(OSS, &M);
-    dxilutil::EmitErrorOnContext(M.getContext(), GetValidationRuleText(rule) + O);
-    Failed = true;
+    EmitErrorText(GetValidationRuleText(rule) + O);
   }
 
   // Use this instead of DxilResourceBase::GetGlobalName
@@ -491,8 +596,7 @@ struct ValidationContext {
 
   void EmitResourceError(const hlsl::DxilResourceBase *Res, ValidationRule rule) {
     std::string QuotedRes = " '" + GetResourceName(Res) + "'";
-    dxilutil::EmitErrorOnContext(M.getContext(), GetValidationRuleText(rule) + QuotedRes);
-    Failed = true;
+    EmitErrorText(GetValidationRuleText(rule) + QuotedRes);
   }
 
   void EmitResourceFormatError(const hlsl::DxilResourceBase *Res,
@@ -501,8 +605,7 @@ struct ValidationContext {
     std::string QuotedRes = " '" + GetResourceName(Res) + "'";
     std::string ruleText = GetValidationRuleText(rule);
     FormatRuleText(ruleText, args);
-    dxilutil::EmitErrorOnContext(M.getContext(), ruleText + QuotedRes);
-    Failed = true;
+    EmitErrorText(ruleText + QuotedRes);
   }
 
   bool IsDebugFunctionCall(Instruction *I) {
@@ -532,6 +635,8 @@ struct ValidationContext {
   }
 
   void EmitInstrErrorMsg(Instruction *I, ValidationRule Rule, std::string Msg) {
+    if (DeferDiagnostic([=] { EmitInstrErrorMsg(I, Rule, Msg); }))
+      return;
     Instruction *DbgI = GetDebugInstr(I);
     const DebugLoc L = DbgI->getDebugLoc();
     if (L) {
@@ -605,22 +710,24 @@ struct ValidationContext {
     EmitFormatError(rule, { OSS.str() });
   }
 
-  void EmitFnError(Function *F, ValidationRule rule) {
+  void EmitFnErrorText(Function *F, const std::string &Text) {
+    if (DeferDiagnostic([=] { EmitFnErrorText(F, Text); }))
+      return;
     if (pDebugModule)
       if (Function *dbgF = pDebugModule->getFunction(F->getName()))
         F = dbgF;
-    dxilutil::EmitErrorOnFunction(M.getContext(), F, GetValidationRuleText(rule));
+    dxilutil::EmitErrorOnFunction(M.getContext(), F, Text);
     Failed = true;
   }
 
+  void EmitFnError(Function *F, ValidationRule rule) {
+    EmitFnErrorText(F, GetValidationRuleText(rule));
+  }
+
   void EmitFnFormatError(Function *F, ValidationRule rule, ArrayRef<StringRef> args) {
     std::string ruleText = GetValidationRuleText(rule);
     FormatRuleText(ruleText, args);
-    if (pDebugModule)
-      if (Function *dbgF = pDebugModule->getFunction(F->getName()))
-        F = dbgF;
-    dxilutil::EmitErrorOnFunction(M.getContext(), F, ruleText);
-    Failed = true;
+    EmitFnErrorText(F, ruleText);
   }
 
   void EmitFnAttributeError(Function *F, StringRef Kind, StringRef Value) {
@@ -1252,7 +1359,7 @@ static void ValidateSignatureDxilOp(CallInst *CI, DXIL::OpCode opcode,
       ValCtx.EmitInstrFormatError(CI, ValidationRule::SmOpcodeInInvalidFunction,
                                   {"StorePatchConstant", "PatchConstant function"});
     } else {
-      auto &hullShaders = ValCtx.PatchConstantFuncMap[func];
+      auto &hullShaders = ValCtx.PatchConstantFuncMap.find(func)->second;
       for (Function *F : hullShaders) {
         EntryStatus &Status = ValCtx.GetEntryStatus(F);
         DxilEntryProps &EntryProps = DM.GetDxilEntryProps(F);
@@ -2404,9 +2511,12 @@ static bool ValidateType(Type *Ty, ValidationContext &ValCtx, bool bInner = fals
       if (ValCtx.HandleTy == Ty)
         return true;
       hlsl::OP *hlslOP = ValCtx.DxilMod.GetOP();
-      if (IsDxilBuiltinStructType(ST, hlslOP)) {
-        ValCtx.EmitTypeError(Ty, ValidationRule::InstrDxilStructUser);
-        result = false;
+      {
+        std::lock_guard<std::mutex> OPLock(ValCtx.OPMutex);
+        if (IsDxilBuiltinStructType(ST, hlslOP)) {
+          ValCtx.EmitTypeError(Ty, ValidationRule::InstrDxilStructUser);
+          result = false;
+        }
       }
 
       ValCtx.EmitTypeError(Ty, ValidationRule::DeclDxilNsReserved);
@@ -2463,7 +2573,7 @@ static bool GetNodeOperandAsInt(ValidationContext &ValCtx, MDNode *pMD, unsigned
 }
 
 static bool IsPrecise(Instruction &I, ValidationContext &ValCtx) {
-  MDNode *pMD = I.getMetadata(DxilMDHelper::kDxilPreciseAttributeMDName);
+  MDNode *pMD = I.getMetadata(ValCtx.kDxilPreciseMDKind);
   if (pMD == nullptr) {
     return false;
   }
@@ -2509,8 +2619,7 @@ static void ValidateMsIntrinsics(Function *F,
     return;
   }
 
-  DominatorTreeAnalysis DTA;
-  DominatorTree DT = DTA.run(*F);
+  DominatorTree &DT = ValCtx.GetDomTree(F);
 
   for (auto b = F->begin(), bend = F->end(); b != bend; ++b) {
     bool foundSetMeshOutputCountsInCurrentBB = false;
@@ -2616,8 +2725,7 @@ static void ValidateAsIntrinsics(Function *F, ValidationContext &ValCtx, CallIns
     return;
   }
 
-  PostDominatorTree PDT;
-  PDT.runOnFunction(*F);
+  PostDominatorTree &PDT = ValCtx.GetPostDomTree(F);
 
   if (!PDT.dominates(dispatchMesh->getParent(), &F->getEntryBlock())) {
     ValCtx.EmitInstrError(dispatchMesh, ValidationRule::InstrNonDominatingDispatchMesh);
@@ -2643,7 +2751,7 @@ static void ValidateControlFlowHint(BasicBlock &bb, ValidationContext &ValCtx) {
   if (!TI)
     return;
 
-  MDNode *pNode = TI->getMetadata(DxilMDHelper::kDxilControlFlowHintMDName);
+  MDNode *pNode = TI->getMetadata(ValCtx.kDxilControlFlowHintMDKind);
   if (!pNode)
     return;
 
@@ -2801,6 +2909,21 @@ static void ValidateNonUniformMetadata(Instruction &I, MDNode *pMD,
   }
 }
 
+static void ValidateUniformityMetadata(MDNode *pMD,
+                                       ValidationContext &ValCtx) {
+  if (pMD->getNumOperands() != 1) {
+    ValCtx.EmitMetaError(pMD, ValidationRule::MetaWellFormed);
+    return;
+  }
+  uint64_t val;
+  if (!GetNodeOperandAsInt(ValCtx, pMD, 0, &val))
+    return;
+  if (val != DxilMDHelper::kDxilUniformityUniform &&
+      val != DxilMDHelper::kDxilUniformityWaveUniform) {
+    ValCtx.EmitMetaError(pMD, ValidationRule::MetaValueRange);
+  }
+}
+
 static void ValidateInstructionMetadata(Instruction *I,
                                         ValidationContext &ValCtx) {
   SmallVector<std::pair<unsigned, MDNode *>, 2> MDNodes;
@@ -2824,6 +2947,8 @@ static void ValidateInstructionMetadata(Instruction *I,
       // noalias for DXIL validator >= 1.2
     } else if (MD.first == ValCtx.kDxilNonUniformMDKind) {
       ValidateNonUniformMetadata(*I, MD.second, ValCtx);
+    } else if (MD.first == ValCtx.kDxilUniformityMDKind) {
+      ValidateUniformityMetadata(MD.second, ValCtx);
     } else {
       ValCtx.EmitMetaError(MD.second, ValidationRule::MetaUsed);
     }
@@ -3057,9 +3182,10 @@ static void ValidateFunctionBody(Function *F, ValidationContext &ValCtx) {
         Type *Ty = EV->getAggregateOperand()->getType();
         if (StructType *ST = dyn_cast<StructType>(Ty)) {
           Value *Agg = EV->getAggregateOperand();
-          if (!isa<AtomicCmpXchgInst>(Agg) &&
-              !IsDxilBuiltinStructType(ST, ValCtx.DxilMod.GetOP())) {
-            ValCtx.EmitInstrError(EV, ValidationRule::InstrExtractValue);
+          if (!isa<AtomicCmpXchgInst>(Agg)) {
+            std::lock_guard<std::mutex> OPLock(ValCtx.OPMutex);
+            if (!IsDxilBuiltinStructType(ST, ValCtx.DxilMod.GetOP()))
+              ValCtx.EmitInstrError(EV, ValidationRule::InstrExtractValue);
           }
         } else {
           ValCtx.EmitInstrError(EV, ValidationRule::InstrExtractValue);
@@ -3215,6 +3341,9 @@ static void ValidateFunctionBody(Function *F, ValidationContext &ValCtx) {
   ValidateMsIntrinsics(F, ValCtx, setMeshOutputCounts, getMeshPayload);
 
   ValidateAsIntrinsics(F, ValCtx, dispatchMesh);
+
+  ValCtx.ReleaseDomTree(F);
+  ValCtx.ReleasePostDomTree(F);
 }
 
 static void ValidateFunction(Function &F, ValidationContext &ValCtx) {
@@ -3315,44 +3444,117 @@ static void ValidateFunction(Function &F, ValidationContext &ValCtx) {
   }
 
   // TODO: Remove attribute for lib?
-  if (!ValCtx.isLibProfile)
-    ValidateFunctionAttribute(&F, ValCtx);
+  // Reading function attributes can create attribute sets in the context,
+  // so this is queued with the diagnostics when running concurrently.
+  if (!ValCtx.isLibProfile) {
+    Function *pF = &F;
+    ValidationContext *pValCtx = &ValCtx;
+    if (!ValCtx.DeferDiagnostic(
+            [=] { ValidateFunctionAttribute(pF, *pValCtx); }))
+      ValidateFunctionAttribute(&F, ValCtx);
+  }
 
   if (F.hasMetadata()) {
     ValidateFunctionMetadata(&F, ValCtx);
   }
 }
 
+// Function bodies only read the module, so with enough of them they are
+// validated on worker threads, each queueing its diagnostics. Declarations
+// are validated serially while the queues are replayed in module order.
+// Only library bodies run concurrently: UavCounterIncMap is only updated for
+// other profiles, whose functions are all inlined into the entry anyway.
+static const unsigned kMinFunctionsForParallelValidation = 16;
+
+// A patch constant function updates the EntryStatus of its hull shaders, so
+// it is validated serially instead of racing the hull shader's own worker.
+static bool IsValidatedSerially(Function &F, ValidationContext &ValCtx) {
+  return F.isDeclaration() || ValCtx.PatchConstantFuncMap.count(&F);
+}
+
+static void ValidateFunctions(ValidationContext &ValCtx) {
+  Module &M = ValCtx.M;
+  std::vector<Function *> Definitions;
+  for (Function &F : M.functions()) {
+    if (!IsValidatedSerially(F, ValCtx))
+      Definitions.push_back(&F);
+  }
+
+  unsigned numThreads = std::min<unsigned>(std::thread::hardware_concurrency(),
+                                           Definitions.size());
+  if (!ValCtx.isLibProfile || t_bSerialFunctionValidation ||
+      numThreads < 2 ||
+      Definitions.size() < kMinFunctionsForParallelValidation) {
+    for (Function &F : M.functions())
+      ValidateFunction(F, ValCtx);
+    return;
+  }
+
+  // Create everything that body validation would otherwise create lazily in
+  // the context, so that the workers only read from it.
+  Type::getInt8PtrTy(M.getContext());
+  TypeFinder StructTypes;
+  StructTypes.run(M, /*onlyNamed*/ false);
+  for (StructType *ST : StructTypes) {
+    if (ST->isSized())
+      ValCtx.DL.getStructLayout(ST);
+  }
+
+  struct FunctionResult {
+    DeferredDiagList Diags;
+    std::exception_ptr Exception;
+  };
+  std::vector<FunctionResult> Results(Definitions.size());
+  std::atomic<unsigned> nextFunction(0);
+  auto Worker = [&]() {
+    for (;;) {
+      unsigned i = nextFunction++;
+      if (i >= Definitions.size())
+        return;
+      t_pDeferredDiags = &Results[i].Diags;
+      try {
+        ValidateFunction(*Definitions[i], ValCtx);
+      } catch (...) {
+        Results[i].Exception = std::current_exception();
+      }
+      t_pDeferredDiags = nullptr;
+    }
+  };
+
+  std::vector<std::thread> Threads;
+  for (unsigned i = 1; i < numThreads; ++i) {
+    try {
+      Threads.emplace_back(Worker);
+    } catch (const std::system_error &) {
+      // Validate the remaining functions on the threads we have.
+      break;
+    }
+  }
+  Worker();
+  for (std::thread &T : Threads)
+    T.join();
+
+  unsigned defIdx = 0;
+  for (Function &F : M.functions()) {
+    if (IsValidatedSerially(F, ValCtx)) {
+      ValidateFunction(F, ValCtx);
+      continue;
+    }
+    FunctionResult &Result = Results[defIdx++];
+    for (auto &Emit : Result.Diags)
+      Emit();
+    if (Result.Exception)
+      std::rethrow_exception(Result.Exception);
+  }
+}
+
 static void ValidateGlobalVariable(GlobalVariable &GV,
                                    ValidationContext &ValCtx) {
   bool isInternalGV =
       dxilutil::IsStaticGlobal(&GV) || dxilutil::IsSharedMemoryGlobal(&GV);
 
   if (ValCtx.isLibProfile) {
-    auto isCBufferGlobal = [&](const std::vector<std::unique_ptr<DxilCBuffer>> &ResTab) -> bool {
-      for (auto &Res : ResTab)
-        if (Res->GetGlobalSymbol() == &GV)
-          return true;
-      return false;
-    };
-    auto isResourceGlobal = [&](const std::vector<std::unique_ptr<DxilResource>> &ResTab) -> bool {
-      for (auto &Res : ResTab)
-        if (Res->GetGlobalSymbol() == &GV)
-          return true;
-      return false;
-    };
-    auto isSamplerGlobal = [&](const std::vector<std::unique_ptr<DxilSampler>> &ResTab) -> bool {
-      for (auto &Res : ResTab)
-        if (Res->GetGlobalSymbol() == &GV)
-          return true;
-      return false;
-    };
-
-    bool isRes = isCBufferGlobal(ValCtx.DxilMod.GetCBuffers());
-    isRes |= isResourceGlobal(ValCtx.DxilMod.GetUAVs());
-    isRes |= isResourceGlobal(ValCtx.DxilMod.GetSRVs());
-    isRes |= isSamplerGlobal(ValCtx.DxilMod.GetSamplers());
-    isInternalGV |= isRes;
+    isInternalGV |= ValCtx.ResGlobalSymbols.count(&GV) != 0;
 
     // Allow special dx.ishelper for library target
     if (GV.getName().compare(DXIL::kDxIsHelperGlobalName) == 0) {
@@ -3425,8 +3627,7 @@ static void ValidateTGSMRaceCondition(std::vector<StoreInst *> &fixAddrTGSMList,
     if (F.isDeclaration() || !fixAddrTGSMFuncSet.count(&F))
       continue;
 
-    PostDominatorTree PDT;
-    PDT.runOnFunction(F);
+    PostDominatorTree &PDT = ValCtx.GetPostDomTree(&F);
 
     BasicBlock *Entry = &F.getEntryBlock();
 
@@ -3439,6 +3640,8 @@ static void ValidateTGSMRaceCondition(std::vector<StoreInst *> &fixAddrTGSMList,
         }
       }
     }
+    if (!ValCtx.IsShaderKind(&F, DXIL::ShaderKind::Amplification))
+      ValCtx.ReleasePostDomTree(&F);
   }
 }
 
@@ -5251,8 +5454,7 @@ static void ValidateFlowControl(ValidationContext &ValCtx) {
     if (F.isDeclaration())
       continue;
 
-    DominatorTreeAnalysis DTA;
-    DominatorTree DT = DTA.run(F);
+    DominatorTree &DT = ValCtx.GetDomTree(&F);
     LoopInfo LI;
     LI.Analyze(DT);
     for (auto loopIt = LI.begin(); loopIt != LI.end(); loopIt++) {
@@ -5262,6 +5464,8 @@ static void ValidateFlowControl(ValidationContext &ValCtx) {
       if (exitBlocks.empty())
         ValCtx.EmitFnError(&F, ValidationRule::FlowDeadLoop);
     }
+    if (!ValCtx.IsShaderKind(&F, DXIL::ShaderKind::Mesh))
+      ValCtx.ReleaseDomTree(&F);
   }
   // fxc has ERR_CONTINUE_INSIDE_SWITCH to disallow continue in switch.
   // Not do it for now.
@@ -5375,9 +5579,7 @@ _Use_decl_annotations_ HRESULT ValidateDxilModule(
   ValidateFlowControl(ValCtx);
 
   // Validate functions.
-  for (Function &F : pModule->functions()) {
-    ValidateFunction(F, ValCtx);
-  }
+  ValidateFunctions(ValCtx);
 
   ValidateShaderFlags(ValCtx);
 
@@ -5897,12 +6099,165 @@ _Use_decl_annotations_ HRESULT ValidateLoadModuleFromContainerLazy(
                                          /*bLazyLoad*/ true);
 }
 
+namespace {
+// Containers that passed validation in this process. An entry holds the DXIL
+// part, which passed ValidateDxilModule, and the container parts that
+// ValidateDxilContainerParts checked against it. Containers relinked from
+// unchanged shaders, or validated again after editing parts the validator
+// does not look at, such as private data, are then not validated again.
+// Entries are matched on their full contents, and, like the verified root
+// signatures, are allocated with malloc, since they outlive the validation
+// that adds them. The oldest entry is replaced once the cache is full.
+class ValidatedContainers {
+public:
+  enum class Match { None, DxilPart, Container };
+
+  Match Find(const DxilPartHeader *pDxilPart, const std::string &Parts) {
+    Key K(pDxilPart, Parts);
+    std::lock_guard<std::mutex> Lock(Mutex);
+    const Entry *pEntry = FindDxilPart(K);
+    if (!pEntry)
+      return Match::None;
+    if (pEntry->PartsHash == K.PartsHash &&
+        pEntry->Parts.Size == Parts.size() &&
+        0 == memcmp(pEntry->Parts.pData, Parts.data(), Parts.size()))
+      return Match::Container;
+    return Match::DxilPart;
+  }
+
+  void Add(const DxilPartHeader *pDxilPart, const std::string &Parts) {
+    Key K(pDxilPart, Parts);
+    Buffer DxilPart, PartsCopy;
+    if (!DxilPart.Assign(GetDxilPartData(pDxilPart), pDxilPart->PartSize) ||
+        !PartsCopy.Assign(Parts.data(), Parts.size()))
+      return;
+    std::lock_guard<std::mutex> Lock(Mutex);
+    Entry *pEntry = FindDxilPart(K);
+    if (!pEntry) {
+      pEntry = &Entries[NextEntry];
+      NextEntry = (NextEntry + 1) % MaxEntries;
+      pEntry->DxilHash = K.DxilHash;
+      pEntry->DxilPart.swap(DxilPart);
+    }
+    pEntry->PartsHash = K.PartsHash;
+    pEntry->Parts.swap(PartsCopy);
+  }
+
+private:
+  struct Buffer {
+    size_t Size = 0;
+    void *pData = nullptr;
+    Buffer() = default;
+    Buffer(const Buffer &) = delete;
+    Buffer &operator=(const Buffer &) = delete;
+    ~Buffer() { free(pData); }
+    bool Assign(const void *pSrc, size_t SrcSize) {
+      free(pData);
+      pData = malloc(SrcSize ? SrcSize : 1);
+      Size = pData ? SrcSize : 0;
+      if (pData)
+        memcpy(pData, pSrc, SrcSize);
+      return pData != nullptr;
+    }
+    void swap(Buffer &Other) {
+      std::swap(Size, Other.Size);
+      std::swap(pData, Other.pData);
+    }
+  };
+  struct Entry {
+    size_t DxilHash = 0;
+    size_t PartsHash = 0;
+    Buffer DxilPart;
+    Buffer Parts;
+  };
+  struct Key {
+    const void *pDxilData;
+    uint32_t DxilSize;
+    size_t DxilHash;
+    size_t PartsHash;
+    Key(const DxilPartHeader *pDxilPart, const std::string &Parts)
+        : pDxilData(GetDxilPartData(pDxilPart)),
+          DxilSize(pDxilPart->PartSize),
+          DxilHash(hash_value(StringRef((const char *)pDxilData, DxilSize))),
+          PartsHash(hash_value(StringRef(Parts))) {}
+  };
+  static const unsigned MaxEntries = 32;
+  std::mutex Mutex;
+  Entry Entries[MaxEntries];
+  unsigned NextEntry = 0;
+
+  Entry *FindDxilPart(const Key &K) {
+    for (Entry &E : Entries) {
+      if (E.DxilPart.pData && E.DxilHash == K.DxilHash &&
+          E.DxilPart.Size == K.DxilSize &&
+          0 == memcmp(E.DxilPart.pData, K.pDxilData, K.DxilSize))
+        return &E;
+    }
+    return nullptr;
+  }
+};
+
+ValidatedContainers &GetValidatedContainers() {
+  static ValidatedContainers Validated;
+  return Validated;
+}
+
+// Returns whether ValidateDxilContainerParts looks at the contents of a part.
+bool IsPartContentsValidated(uint32_t FourCC) {
+  switch (FourCC) {
+  case DFCC_ResourceDef:
+  case DFCC_ShaderStatistics:
+  case DFCC_PrivateData:
+  case DFCC_DXIL:
+  case DFCC_ShaderDebugInfoDXIL:
+  case DFCC_ShaderDebugName:
+    return false;
+  default:
+    return true;
+  }
+}
+
+// Serializes what ValidateDxilContainerParts checks: the kind of every part,
+// in order, and the contents of the parts it looks at.
+std::string GetValidatedParts(const DxilContainerHeader *pContainer) {
+  std::string Parts;
+  raw_string_ostream OS(Parts);
+  for (auto it = begin(pContainer), itEnd = end(pContainer); it != itEnd; ++it) {
+    const DxilPartHeader *pPart = *it;
+    OS.write((const char *)&pPart->PartFourCC, sizeof(pPart->PartFourCC));
+    if (!IsPartContentsValidated(pPart->PartFourCC))
+      continue;
+    OS.write((const char *)&pPart->PartSize, sizeof(pPart->PartSize));
+    OS.write(GetDxilPartData(pPart), pPart->PartSize);
+  }
+  OS.flush();
+  return Parts;
+}
+} // namespace
+
 _Use_decl_annotations_
 HRESULT ValidateDxilContainer(const void *pContainer,
                               uint32_t ContainerSize,
                               const void *pOptDebugBitcode,
                               uint32_t OptDebugBitcodeSize,
-                              llvm::raw_ostream &DiagStream) {
+                              llvm::raw_ostream &DiagStream,
+                              bool bAllowCachedResult) {
+  const DxilPartHeader *pDxilPart = nullptr;
+  std::string ValidatedParts;
+  ValidatedContainers::Match CacheMatch = ValidatedContainers::Match::None;
+  if (bAllowCachedResult) {
+    const DxilContainerHeader *pHeader =
+        IsDxilContainerLike(pContainer, ContainerSize);
+    if (pHeader && IsValidDxilContainer(pHeader, ContainerSize))
+      pDxilPart = GetDxilPartByType(pHeader, DFCC_DXIL);
+    if (pDxilPart) {
+      ValidatedParts = GetValidatedParts(pHeader);
+      CacheMatch = GetValidatedContainers().Find(pDxilPart, ValidatedParts);
+      if (CacheMatch == ValidatedContainers::Match::Container)
+        return S_OK;
+    }
+  }
+
   LLVMContext Ctx, DbgCtx;
   std::unique_ptr<llvm::Module> pModule, pDebugModule;
 
@@ -5922,15 +6277,21 @@ HRESULT ValidateDxilContainer(const void *pContainer,
                            pDebugModule, DbgCtx, DiagStream, /*bLazyLoad*/false));
   }
 
-  // Validate DXIL Module
-  IFR(ValidateDxilModule(pModule.get(), pDebugModule.get()));
+  // Validate DXIL Module, unless this DXIL part passed before.
+  if (CacheMatch == ValidatedContainers::Match::None) {
+    IFR(ValidateDxilModule(pModule.get(), pDebugModule.get()));
+  }
 
   if (DiagContext.HasErrors() || DiagContext.HasWarnings()) {
     return DXC_E_IR_VERIFICATION_FAILED;
   }
 
-  return ValidateDxilContainerParts(pModule.get(), pDebugModule.get(),
-    IsDxilContainerLike(pContainer, ContainerSize), ContainerSize);
+  IFR(ValidateDxilContainerParts(pModule.get(), pDebugModule.get(),
+    IsDxilContainerLike(pContainer, ContainerSize), ContainerSize));
+
+  if (pDxilPart)
+    GetValidatedContainers().Add(pDxilPart, ValidatedParts);
+  return S_OK;
 }
 
 _Use_decl_annotations_
@@ -0,0 +1,92 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// HLInlineCleanup.cpp                                                       //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Light cleanup of each function before it is inlined into its callers.    //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#include "dxc/HLSL/DxilGenerationPass.h"
+#include "dxc/HLSL/HLModule.h"
+
+#include "llvm/IR/Dominators.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Pass.h"
+#include "llvm/Transforms/Utils/Local.h"
+#include "llvm/Transforms/Utils/PromoteMemToReg.h"
+
+#include <vector>
+
+using namespace llvm;
+using namespace hlsl;
+
+// HLSL inlines every call, and each caller gets a copy of whatever its
+// callees looked like straight out of code generation. When added right
+// after the always-inliner, this pass runs in the inliner's call graph
+// pass manager, so it sees each function once its own callees are inlined
+// and before it is inlined into its callers. It simplifies instructions,
+// deletes dead ones and promotes scalar and vector locals, which keeps
+// deep helper chains from growing the intermediate functions that
+// SROA_HLSL and mem2reg later have to work through. Aggregates are left
+// to SROA_Parameter_HLSL and SROA_HLSL, which know about matrices and
+// resources. Enabled with -opt-enable inline-cleanup.
+namespace {
+class HLInlineCleanup : public FunctionPass {
+public:
+  static char ID; // Pass identification, replacement for typeid
+  explicit HLInlineCleanup() : FunctionPass(ID) {}
+
+  StringRef getPassName() const override {
+    return "HLSL cleanup before inlining";
+  }
+
+  bool runOnFunction(Function &F) override;
+};
+}
+
+char HLInlineCleanup::ID = 0;
+
+// Precise locals stay in memory for DxilConditionalMem2Reg, like it
+// leaves them.
+static bool IsPromotableLocal(AllocaInst *AI) {
+  Type *Ty = AI->getAllocatedType();
+  if (Ty->isVectorTy())
+    Ty = Ty->getVectorElementType();
+  if (!Ty->isIntegerTy() && !Ty->isFloatingPointTy())
+    return false;
+  return isAllocaPromotable(AI) &&
+         !HLModule::HasPreciseAttributeWithMetadata(AI);
+}
+
+bool HLInlineCleanup::runOnFunction(Function &F) {
+  bool bUpdated = false;
+  for (BasicBlock &BB : F)
+    bUpdated |= SimplifyInstructionsInBlock(&BB, nullptr);
+
+  std::vector<AllocaInst *> Allocas;
+  BasicBlock &Entry = F.getEntryBlock();
+  for (Instruction &I : Entry) {
+    if (AllocaInst *AI = dyn_cast<AllocaInst>(&I)) {
+      if (IsPromotableLocal(AI))
+        Allocas.push_back(AI);
+    }
+  }
+  if (!Allocas.empty()) {
+    DominatorTree DT;
+    DT.recalculate(F);
+    PromoteMemToReg(Allocas, DT);
+    bUpdated = true;
+  }
+  return bUpdated;
+}
+
+FunctionPass *llvm::createHLInlineCleanupPass() {
+  return new HLInlineCleanup();
+}
+
+INITIALIZE_PASS(HLInlineCleanup, "hl-inline-cleanup",
+                "HLSL cleanup before inlining", false, false)
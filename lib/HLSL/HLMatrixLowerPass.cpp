@@ -180,6 +180,10 @@ private:
   TempOverloadPool *m_vecToMatStubs = nullptr;
 
   std::vector<Instruction *> m_deadInsts;
+
+  // Multiply-and-add intrinsics used by mul lowering, by type and opcode,
+  // so each matrix multiply doesn't have to rebuild the mangled name.
+  DenseMap<std::pair<FunctionType*, unsigned>, Function*> m_madFuncs;
 };
 }
 
@@ -223,6 +227,7 @@ bool HLMatrixLowerPass::runOnModule(Module &M) {
   m_pHLModule = nullptr;
   m_matToVecStubs = nullptr;
   m_vecToMatStubs = nullptr;
+  m_madFuncs.clear();
 
   // If you hit an assert during TempOverloadPool destruction,
   // it means that either a matrix producer was lowered,
@@ -947,9 +952,18 @@ Value *HLMatrixLowerPass::lowerHLMulIntrinsic(Value* Lhs, Value *Rhs,
   // Get the multiply-and-add intrinsic function, we'll need it
   IntrinsicOp MadOpcode = Unsigned ? IntrinsicOp::IOP_umad : IntrinsicOp::IOP_mad;
   FunctionType *MadFuncTy = FunctionType::get(ElemTy, { Builder.getInt32Ty(), ElemTy, ElemTy, ElemTy }, false);
-  Function *MadFunc = GetOrCreateHLFunction(*m_pModule, MadFuncTy, HLOpcodeGroup::HLIntrinsic, (unsigned)MadOpcode);
+  Function *&MadFunc = m_madFuncs[std::make_pair(MadFuncTy, (unsigned)MadOpcode)];
+  if (MadFunc == nullptr)
+    MadFunc = GetOrCreateHLFunction(*m_pModule, MadFuncTy, HLOpcodeGroup::HLIntrinsic, (unsigned)MadOpcode);
   Constant *MadOpcodeVal = Builder.getInt32((unsigned)MadOpcode);
 
+  // Extract every operand element once, they are each used by several products.
+  SmallVector<Value*, 16> LhsElems, RhsElems;
+  for (unsigned ElemIdx = 0; ElemIdx < LhsNumRows * LhsNumCols; ++ElemIdx)
+    LhsElems.emplace_back(Builder.CreateExtractElement(LoweredLhs, static_cast<uint64_t>(ElemIdx)));
+  for (unsigned ElemIdx = 0; ElemIdx < RhsNumRows * RhsNumCols; ++ElemIdx)
+    RhsElems.emplace_back(Builder.CreateExtractElement(LoweredRhs, static_cast<uint64_t>(ElemIdx)));
+
   // Perform the multiplication!
   Value *Result = UndefValue::get(VectorType::get(ElemTy, LhsNumRows * RhsNumCols));
   for (unsigned ResultRowIdx = 0; ResultRowIdx < ResultMatTy.getNumRows(); ++ResultRowIdx) {
@@ -960,8 +974,8 @@ Value *HLMatrixLowerPass::lowerHLMulIntrinsic(Value* Lhs, Value *Rhs,
       for (unsigned AccIdx = 0; AccIdx < AccCount; ++AccIdx) {
         unsigned LhsElemIdx = HLMatrixType::getRowMajorIndex(ResultRowIdx, AccIdx, LhsNumRows, LhsNumCols);
         unsigned RhsElemIdx = HLMatrixType::getRowMajorIndex(AccIdx, ResultColIdx, RhsNumRows, RhsNumCols);
-        Value* LhsElem = Builder.CreateExtractElement(LoweredLhs, static_cast<uint64_t>(LhsElemIdx));
-        Value* RhsElem = Builder.CreateExtractElement(LoweredRhs, static_cast<uint64_t>(RhsElemIdx));
+        Value* LhsElem = LhsElems[LhsElemIdx];
+        Value* RhsElem = RhsElems[RhsElemIdx];
         if (ResultElem == nullptr) {
           ResultElem = ElemTy->isFloatingPointTy()
             ? Builder.CreateFMul(LhsElem, RhsElem)
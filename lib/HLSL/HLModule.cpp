@@ -29,6 +29,7 @@
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/IR/GetElementPtrTypeIterator.h"
 #include "llvm/Analysis/ValueTracking.h"
+#include <algorithm>
 
 using namespace llvm;
 using std::string;
@@ -774,9 +775,19 @@ static uint64_t getRegBindingKey(unsigned CbID, unsigned ConstantIdx) {
 void HLModule::AddRegBinding(unsigned CbID, unsigned ConstantIdx, unsigned Srv, unsigned Uav,
                              unsigned Sampler) {
   uint64_t Key = getRegBindingKey(CbID, ConstantIdx);
-  m_SrvBindingInCB[Key] = Srv;
-  m_UavBindingInCB[Key] = Uav;
-  m_SamplerBindingInCB[Key] = Sampler;
+  RegBindingInCB Binding = {Key, Srv, Uav, Sampler};
+  // Bindings are added in cbuffer order, so this is normally an append.
+  if (m_RegBindingInCB.empty() || m_RegBindingInCB.back().Key < Key) {
+    m_RegBindingInCB.emplace_back(Binding);
+    return;
+  }
+  auto It = std::lower_bound(
+      m_RegBindingInCB.begin(), m_RegBindingInCB.end(), Key,
+      [](const RegBindingInCB &B, uint64_t K) { return B.Key < K; });
+  if (It != m_RegBindingInCB.end() && It->Key == Key)
+    *It = Binding;
+  else
+    m_RegBindingInCB.insert(It, Binding);
 }
 
 // Helper functions for resource in cbuffer.
@@ -889,21 +900,23 @@ unsigned HLModule::GetBindingForResourceInCB(GetElementPtrInst *CbPtr,
     GEPIt++;
 
     uint64_t Key = getRegBindingKey(ID, idx);
-    switch (RC) {
-    default:
-      break;
-    case DXIL::ResourceClass::SRV:
-      if (m_SrvBindingInCB.count(Key))
-        RegBinding = m_SrvBindingInCB[Key];
-      break;
-    case DXIL::ResourceClass::UAV:
-      if (m_UavBindingInCB.count(Key))
-        RegBinding = m_UavBindingInCB[Key];
-      break;
-    case DXIL::ResourceClass::Sampler:
-      if (m_SamplerBindingInCB.count(Key))
-        RegBinding = m_SamplerBindingInCB[Key];
-      break;
+    auto BindingIt = std::lower_bound(
+        m_RegBindingInCB.begin(), m_RegBindingInCB.end(), Key,
+        [](const RegBindingInCB &B, uint64_t K) { return B.Key < K; });
+    if (BindingIt != m_RegBindingInCB.end() && BindingIt->Key == Key) {
+      switch (RC) {
+      default:
+        break;
+      case DXIL::ResourceClass::SRV:
+        RegBinding = BindingIt->Srv;
+        break;
+      case DXIL::ResourceClass::UAV:
+        RegBinding = BindingIt->Uav;
+        break;
+      case DXIL::ResourceClass::Sampler:
+        RegBinding = BindingIt->Sampler;
+        break;
+      }
     }
     if (RegBinding == UINT_MAX)
       break;
@@ -91,6 +91,19 @@ private:
   // A global resource Texture2D T2 will be created for Texture2D T.
   // CBPtrToResourceMap[T] will return T2.
   std::unordered_map<Value *, Value *> CBPtrToResourceMap;
+  // Resource properties by the constant they were loaded from. All annotated
+  // handles of a resource share one constant, so each is decoded once no
+  // matter how many call sites use it.
+  std::unordered_map<Constant *, DxilResourceProperties> ResPropsMap;
+
+  const DxilResourceProperties &LoadResProps(Constant *Props) {
+    auto It = ResPropsMap.find(Props);
+    if (It != ResPropsMap.end())
+      return It->second;
+    return ResPropsMap
+        .emplace(Props, resource_helper::loadPropsFromConstant(*Props))
+        .first->second;
+  }
 
 public:
   HLObjectOperationLowerHelper(HLModule &HLM,
@@ -118,7 +131,7 @@ public:
     // Change kind into StructurBufferWithCounter.
     Constant *Props = cast<Constant>(CIHandle->getArgOperand(
         HLOperandIndex::kAnnotateHandleResourcePropertiesOpIdx));
-    DxilResourceProperties RP = resource_helper::loadPropsFromConstant(*Props);
+    DxilResourceProperties RP = LoadResProps(Props);
     RP.Basic.SamplerCmpOrHasCounter = true;
 
     CIHandle->setArgOperand(
@@ -176,42 +189,37 @@ public:
   DxilResourceProperties GetResPropsFromAnnotateHandle(CallInst *Anno) {
     Constant *Props = cast<Constant>(Anno->getArgOperand(
         HLOperandIndex::kAnnotateHandleResourcePropertiesOpIdx));
-    DxilResourceProperties RP = resource_helper::loadPropsFromConstant(
-        *Props);
-    return RP;
+    return LoadResProps(Props);
   }
 
 private:
   ResAttribute &FindCreateHandleResourceBase(Value *Handle) {
-    if (HandleMetaMap.count(Handle))
-      return HandleMetaMap[Handle];
+    auto It = HandleMetaMap.find(Handle);
+    if (It != HandleMetaMap.end())
+      return It->second;
 
     // Add invalid first to avoid dead loop.
-    HandleMetaMap[Handle] = {DXIL::ResourceClass::Invalid,
-                             DXIL::ResourceKind::Invalid,
-                             StructType::get(Type::getVoidTy(HLM.GetCtx()), nullptr)};
+    ResAttribute &Attrib = HandleMetaMap[Handle];
+    Attrib = {DXIL::ResourceClass::Invalid, DXIL::ResourceKind::Invalid,
+              StructType::get(Type::getVoidTy(HLM.GetCtx()), nullptr)};
     if (CallInst *CI = dyn_cast<CallInst>(Handle)) {
       hlsl::HLOpcodeGroup group =
           hlsl::GetHLOpcodeGroupByName(CI->getCalledFunction());
       if (group == HLOpcodeGroup::HLAnnotateHandle) {
         Constant *Props = cast<Constant>(CI->getArgOperand(
             HLOperandIndex::kAnnotateHandleResourcePropertiesOpIdx));
-        DxilResourceProperties RP =
-            resource_helper::loadPropsFromConstant(*Props);
+        const DxilResourceProperties &RP = LoadResProps(Props);
         Type *ResTy =
             CI->getArgOperand(HLOperandIndex::kAnnotateHandleResourceTypeOpIdx)
                 ->getType();
 
-        ResAttribute Attrib = {RP.getResourceClass(), RP.getResourceKind(),
-                               ResTy};
-
-        HandleMetaMap[Handle] = Attrib;
-        return HandleMetaMap[Handle];
+        Attrib = {RP.getResourceClass(), RP.getResourceKind(), ResTy};
+        return Attrib;
       }
     }
     Handle->getContext().emitError("cannot map resource to handle");
 
-    return HandleMetaMap[Handle];
+    return Attrib;
   }
   CallInst *FindCreateHandle(Value *handle,
                              std::unordered_set<Value *> &resSet) {
@@ -8173,7 +8181,8 @@ typedef std::unordered_map<llvm::Instruction *, llvm::Value *> HandleMap;
 static void TranslateHLExtension(Function *F,
                                  HLSLExtensionsCodegenHelper *helper,
                                  OP& hlslOp,
-                                 HLObjectOperationLowerHelper &objHelper) {
+                                 HLObjectOperationLowerHelper &objHelper,
+                                 ExtensionLoweringCache &extCache) {
   // Find all calls to the function F.
   // Store the calls in a vector for now to be replaced the loop below.
   // We use a two step "find then replace" to avoid removing uses while
@@ -8188,7 +8197,7 @@ static void TranslateHLExtension(Function *F,
   // Get the lowering strategy to use for this intrinsic.
   llvm::StringRef LowerStrategy = GetHLLowerStrategy(F);
   HLObjectExtensionLowerHelper extObjHelper(objHelper);
-  ExtensionLowering lower(LowerStrategy, helper, hlslOp, extObjHelper);
+  ExtensionLowering lower(LowerStrategy, helper, hlslOp, extObjHelper, &extCache);
 
   // Replace all calls that were successfully translated.
   for (CallInst *CI : CallsToReplace) {
@@ -8212,6 +8221,7 @@ void TranslateBuiltinOperations(
   Module *M = HLM.GetModule();
 
   SmallVector<Function *, 4> NonUniformResourceIndexIntrinsics;
+  ExtensionLoweringCache extCache;
 
   // generate dxil operation
   for (iplist<Function>::iterator F : M->getFunctionList()) {
@@ -8226,7 +8236,7 @@ void TranslateBuiltinOperations(
       continue;
     }
     if (group == HLOpcodeGroup::HLExtIntrinsic) {
-      TranslateHLExtension(F, extCodegenHelper, helper.hlslOP, objHelper);
+      TranslateHLExtension(F, extCodegenHelper, helper.hlslOP, objHelper, extCache);
       continue;
     }
     if (group == HLOpcodeGroup::HLIntrinsic) {
@@ -74,12 +74,13 @@ static std::string ParseExtraStrategyInfo(StringRef strategy)
     return SplitInfo.second;
 }
 
-ExtensionLowering::ExtensionLowering(Strategy strategy, HLSLExtensionsCodegenHelper *helper, OP& hlslOp,  HLResourceLookup &hlResourceLookup)
+ExtensionLowering::ExtensionLowering(Strategy strategy, HLSLExtensionsCodegenHelper *helper, OP& hlslOp,  HLResourceLookup &hlResourceLookup, ExtensionLoweringCache *cache)
   : m_strategy(strategy), m_helper(helper), m_hlslOp(hlslOp), m_hlResourceLookup(hlResourceLookup)
+  , m_cache(cache ? *cache : m_ownedCache)
   {}
 
-ExtensionLowering::ExtensionLowering(StringRef strategy, HLSLExtensionsCodegenHelper *helper, OP& hlslOp, HLResourceLookup &hlResourceLookup)
-  : ExtensionLowering(GetStrategy(strategy), helper, hlslOp, hlResourceLookup)
+ExtensionLowering::ExtensionLowering(StringRef strategy, HLSLExtensionsCodegenHelper *helper, OP& hlslOp, HLResourceLookup &hlResourceLookup, ExtensionLoweringCache *cache)
+  : ExtensionLowering(GetStrategy(strategy), helper, hlslOp, hlResourceLookup, cache)
   {
     m_extraStrategyInfo = ParseExtraStrategyInfo(strategy);
   }
@@ -101,6 +102,33 @@ llvm::Value *ExtensionLowering::Unknown(CallInst *CI) {
   return nullptr;
 }
 
+// Every call to a high-level extension function has the same signature, so
+// the declaration it lowers to under a given strategy is computed once.
+llvm::Function *ExtensionLowering::GetLoweredFunction(
+    CallInst *CI, Strategy strategy, function_ref<Function *()> create) {
+  auto key = std::make_pair(CI->getCalledFunction(), static_cast<unsigned>(strategy));
+  auto it = m_cache.LoweredFunctions.find(key);
+  if (it != m_cache.LoweredFunctions.end())
+    return it->second;
+
+  Function *F = create();
+  m_cache.LoweredFunctions[key] = F;
+  return F;
+}
+
+bool ExtensionLowering::GetDxilOpcode(unsigned extOpcode, OP::OpCode &dxilOpcode) {
+  auto it = m_cache.DxilOpcodes.find(extOpcode);
+  if (it == m_cache.DxilOpcodes.end()) {
+    OP::OpCode opcode;
+    if (!m_helper->GetDxilOpcode(extOpcode, opcode))
+      opcode = OP::OpCode::NumOpCodes;
+    it = m_cache.DxilOpcodes.emplace(extOpcode, opcode).first;
+  }
+
+  dxilOpcode = it->second;
+  return dxilOpcode != OP::OpCode::NumOpCodes;
+}
+
 // Interface to describe how to translate types from HL-dxil to dxil.
 class FunctionTypeTranslator {
 public:
@@ -207,7 +235,9 @@ class NoTranslationTypeTranslator : public FunctionTypeTranslator {
 };
 
 llvm::Value *ExtensionLowering::NoTranslation(CallInst *CI) {
-  Function *NoTranslationFunction = FunctionTranslator::GetLoweredFunction<NoTranslationTypeTranslator>(CI, *this);
+  Function *NoTranslationFunction = GetLoweredFunction(CI, Strategy::NoTranslation, [&] {
+    return FunctionTranslator::GetLoweredFunction<NoTranslationTypeTranslator>(CI, *this);
+  });
   if (!NoTranslationFunction)
     return nullptr;
 
@@ -365,7 +395,9 @@ private:
 //
 // You can then RAWU %r with %r.v.2. The RAWU is not done by the translate function.
 Value *ExtensionLowering::Replicate(CallInst *CI) {
-  Function *ReplicatedFunction = FunctionTranslator::GetLoweredFunction<ReplicatedFunctionTypeTranslator>(CI, *this);
+  Function *ReplicatedFunction = GetLoweredFunction(CI, Strategy::Replicate, [&] {
+    return FunctionTranslator::GetLoweredFunction<ReplicatedFunctionTypeTranslator>(CI, *this);
+  });
   if (!ReplicatedFunction)
     return NoTranslation(CI);
 
@@ -474,7 +506,9 @@ class PackedFunctionTypeTranslator : public FunctionTypeTranslator {
 };
 
 Value *ExtensionLowering::Pack(CallInst *CI) {
-  Function *PackedFunction = FunctionTranslator::GetLoweredFunction<PackedFunctionTypeTranslator>(CI, *this);
+  Function *PackedFunction = GetLoweredFunction(CI, Strategy::Pack, [&] {
+    return FunctionTranslator::GetLoweredFunction<PackedFunctionTypeTranslator>(CI, *this);
+  });
   if (!PackedFunction)
     return NoTranslation(CI);
 
@@ -634,8 +668,10 @@ Value *ExtensionLowering::Resource(CallInst *CI) {
     return CustomResource(CI);
   }
 
-  ResourceFunctionTypeTranslator resourceTypeTranslator(m_hlslOp);
-  Function *resourceFunction = FunctionTranslator::GetLoweredFunction(resourceTypeTranslator, CI, *this);
+  Function *resourceFunction = GetLoweredFunction(CI, Strategy::Resource, [&] {
+    ResourceFunctionTypeTranslator resourceTypeTranslator(m_hlslOp);
+    return FunctionTranslator::GetLoweredFunction(resourceTypeTranslator, CI, *this);
+  });
   if (!resourceFunction)
     return NoTranslation(CI);
 
@@ -1071,7 +1107,7 @@ Value *ExtensionLowering::Dxil(CallInst *CI) {
   // Map the extension opcode to the corresponding dxil opcode.
   unsigned extOpcode = GetHLOpcode(CI);
   OP::OpCode dxilOpcode;
-  if (!m_helper->GetDxilOpcode(extOpcode, dxilOpcode))
+  if (!GetDxilOpcode(extOpcode, dxilOpcode))
     return nullptr;
 
   // Find the dxil function based on the overload type.
@@ -1105,16 +1141,17 @@ Value *ExtensionLowering::Dxil(CallInst *CI) {
 // chooses a default name based on the lowergin strategy.
 class ExtensionName {
 public:
-  ExtensionName(CallInst *CI, ExtensionLowering::Strategy strategy, HLSLExtensionsCodegenHelper *helper)
+  ExtensionName(CallInst *CI, ExtensionLowering::Strategy strategy, HLSLExtensionsCodegenHelper *helper, ExtensionLoweringCache &cache)
     : m_CI(CI)
     , m_strategy(strategy)
     , m_helper(helper)
+    , m_cache(cache)
   {}
 
   std::string Get() {
     std::string name;
     if (m_helper)
-      name = GetCustomExtensionName(m_CI, *m_helper);
+      name = GetCustomExtensionName(m_CI, *m_helper, m_cache);
 
     if (!HasCustomExtensionName(name))
       name = GetDefaultCustomExtensionName(m_CI, ExtensionLowering::GetStrategyName(m_strategy));
@@ -1126,10 +1163,14 @@ private:
   CallInst *m_CI;
   ExtensionLowering::Strategy m_strategy;
   HLSLExtensionsCodegenHelper *m_helper;
+  ExtensionLoweringCache &m_cache;
 
-  static std::string GetCustomExtensionName(CallInst *CI, HLSLExtensionsCodegenHelper &helper) {
+  static std::string GetCustomExtensionName(CallInst *CI, HLSLExtensionsCodegenHelper &helper, ExtensionLoweringCache &cache) {
     unsigned opcode = GetHLOpcode(CI);
-    std::string name = helper.GetIntrinsicName(opcode);
+    auto it = cache.IntrinsicNames.find(opcode);
+    if (it == cache.IntrinsicNames.end())
+      it = cache.IntrinsicNames.emplace(opcode, helper.GetIntrinsicName(opcode)).first;
+    std::string name = it->second;
     ReplaceOverloadMarkerWithTypeName(name, CI);
 
     return name;
@@ -1260,6 +1301,6 @@ private:
 };
 
 std::string ExtensionLowering::GetExtensionName(llvm::CallInst *CI) {
-  ExtensionName name(CI, m_strategy, m_helper);
+  ExtensionName name(CI, m_strategy, m_helper, m_cache);
   return name.Get();
 }
@@ -0,0 +1,222 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// HLPadGroupShared.cpp                                                      //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Pads the rows of groupshared arrays to avoid bank conflicts.              //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#include "dxc/DXIL/DxilConstants.h"
+#include "dxc/DXIL/DxilShaderModel.h"
+#include "dxc/DXIL/DxilUtil.h"
+#include "dxc/HLSL/DxilGenerationPass.h"
+#include "dxc/HLSL/HLModule.h"
+
+#include "llvm/ADT/Statistic.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/DataLayout.h"
+#include "llvm/IR/DebugInfo.h"
+#include "llvm/IR/GetElementPtrTypeIterator.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IR/Operator.h"
+#include "llvm/Pass.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Support/MathExtras.h"
+
+#include <algorithm>
+#include <vector>
+
+using namespace llvm;
+using namespace hlsl;
+
+#define DEBUG_TYPE "hl-pad-groupshared"
+
+STATISTIC(NumPaddedArrays, "Number of groupshared arrays padded");
+STATISTIC(NumPaddingBytes, "Number of groupshared bytes added by padding");
+
+// Groupshared memory is usually split into 32 banks of 32-bit words. In a
+// groupshared float tile[32][32], threads that walk a column all hit the same
+// bank, because each row is a multiple of 32 words long. This pass adds one
+// element to the rows of such arrays, so that consecutive rows start in
+// different banks. An array is only padded when:
+// - it has at least two dimensions of 32-bit scalars;
+// - its row length shares a factor with the bank count;
+// - some access indexes an outer dimension with a non-constant value, so the
+//   access strides by whole rows;
+// - every use is a GEP, so every address can be rebuilt on the padded type;
+// - the padded arrays still fit in the groupshared size limit.
+// Element addresses only change by the padding, so stores to fixed addresses
+// stay fixed for the validator's race condition checks. Enabled with
+// -opt-enable pad-groupshared.
+namespace {
+class HLPadGroupShared : public ModulePass {
+public:
+  static char ID; // Pass identification, replacement for typeid
+  explicit HLPadGroupShared() : ModulePass(ID) {}
+
+  StringRef getPassName() const override {
+    return "HLSL pad groupshared arrays";
+  }
+
+  bool runOnModule(Module &M) override;
+};
+}
+
+char HLPadGroupShared::ID = 0;
+
+static const unsigned kNumBanks = 32;
+
+// Returns the row type of Ty, if Ty is an array of at least two dimensions of
+// 32-bit scalars.
+static ArrayType *GetPaddableRowType(Type *Ty) {
+  ArrayType *AT = dyn_cast<ArrayType>(Ty);
+  if (!AT || !AT->getElementType()->isArrayTy())
+    return nullptr;
+  while (AT->getElementType()->isArrayTy())
+    AT = cast<ArrayType>(AT->getElementType());
+  Type *EltTy = AT->getElementType();
+  if (!EltTy->isFloatTy() && !EltTy->isIntegerTy(32))
+    return nullptr;
+  return AT;
+}
+
+// Returns Ty with one more element in its innermost dimension.
+static Type *GetPaddedType(Type *Ty) {
+  ArrayType *AT = cast<ArrayType>(Ty);
+  Type *EltTy = AT->getElementType();
+  if (!EltTy->isArrayTy())
+    return ArrayType::get(EltTy, AT->getNumElements() + 1);
+  return ArrayType::get(GetPaddedType(EltTy), AT->getNumElements());
+}
+
+// Returns false if Ptr, a pointer to an array being padded, has a use other
+// than a GEP. Sets bRowStrided if a GEP indexes an outer dimension with a
+// value that is not constant.
+static bool CheckUses(Value *Ptr, bool &bRowStrided) {
+  for (User *U : Ptr->users()) {
+    GEPOperator *GEP = dyn_cast<GEPOperator>(U);
+    if (!GEP || GEP->getPointerOperand() != Ptr)
+      return false;
+    // The first index steps over whole arrays, so it is skipped. Every other
+    // index into an array of arrays strides by rows.
+    gep_type_iterator GTI = gep_type_begin(GEP), GTE = gep_type_end(GEP);
+    for (++GTI; GTI != GTE; ++GTI) {
+      ArrayType *AT = dyn_cast<ArrayType>(*GTI);
+      if (AT && AT->getElementType()->isArrayTy() &&
+          !isa<ConstantInt>(GTI.getOperand()))
+        bRowStrided = true;
+    }
+    if (GEP->getType()->getPointerElementType()->isArrayTy() &&
+        !CheckUses(GEP, bRowStrided))
+      return false;
+  }
+  return true;
+}
+
+// Rebuilds every GEP on Ptr on NewPtr, down to the element pointers, which
+// keep their type.
+static void ReplaceUses(Value *Ptr, Value *NewPtr) {
+  std::vector<User *> Users(Ptr->user_begin(), Ptr->user_end());
+  for (User *U : Users) {
+    GEPOperator *GEP = cast<GEPOperator>(U);
+    SmallVector<Value *, 4> Indices(GEP->idx_begin(), GEP->idx_end());
+    Value *NewGEP = nullptr;
+    if (GetElementPtrInst *GEPI = dyn_cast<GetElementPtrInst>(GEP)) {
+      IRBuilder<> Builder(GEPI);
+      NewGEP = GEPI->isInBounds() ? Builder.CreateInBoundsGEP(NewPtr, Indices)
+                                  : Builder.CreateGEP(NewPtr, Indices);
+    } else {
+      NewGEP = ConstantExpr::getGetElementPtr(
+          nullptr, cast<Constant>(NewPtr), Indices, GEP->isInBounds());
+    }
+    if (NewGEP->getType() == GEP->getType())
+      GEP->replaceAllUsesWith(NewGEP);
+    else
+      ReplaceUses(GEP, NewGEP);
+    if (Instruction *I = dyn_cast<Instruction>(GEP)) {
+      if (isa<Instruction>(NewGEP))
+        NewGEP->takeName(I);
+      I->eraseFromParent();
+    } else {
+      cast<Constant>(GEP)->destroyConstant();
+    }
+  }
+}
+
+bool HLPadGroupShared::runOnModule(Module &M) {
+  if (!M.HasHLModule())
+    return false;
+  HLModule &HLM = M.GetHLModule();
+  const DataLayout &DL = M.getDataLayout();
+
+  unsigned MaxSize = DXIL::kMaxTGSMSize;
+  if (HLM.GetShaderModel()->IsMS())
+    MaxSize = DXIL::kMaxMSSMSize;
+
+  std::vector<GlobalVariable *> Candidates;
+  uint64_t TGSMSize = 0;
+  for (GlobalVariable &GV : M.globals()) {
+    if (GV.getType()->getAddressSpace() != DXIL::kTGSMAddrSpace)
+      continue;
+    Type *Ty = GV.getType()->getElementType();
+    TGSMSize += DL.getTypeAllocSize(Ty);
+    ArrayType *RowTy = GetPaddableRowType(Ty);
+    if (!RowTy || GreatestCommonDivisor64(RowTy->getNumElements(), kNumBanks) == 1)
+      continue;
+    Candidates.emplace_back(&GV);
+  }
+
+  bool bHasDbgInfo = hasDebugInfo(M);
+  bool bUpdated = false;
+  for (GlobalVariable *GV : Candidates) {
+    GV->removeDeadConstantUsers();
+    bool bRowStrided = false;
+    if (!CheckUses(GV, bRowStrided) || !bRowStrided)
+      continue;
+
+    Type *Ty = GV->getType()->getElementType();
+    Type *PaddedTy = GetPaddedType(Ty);
+    uint64_t Padding = DL.getTypeAllocSize(PaddedTy) - DL.getTypeAllocSize(Ty);
+    if (TGSMSize + Padding > MaxSize)
+      continue;
+    TGSMSize += Padding;
+
+    GlobalVariable *NewGV = new GlobalVariable(
+        M, PaddedTy, GV->isConstant(), GV->getLinkage(),
+        UndefValue::get(PaddedTy), GV->getName() + ".pad",
+        /*InsertBefore*/ GV, GV->getThreadLocalMode(),
+        DXIL::kTGSMAddrSpace);
+    NewGV->setAlignment(GV->getAlignment());
+
+    if (bHasDbgInfo) {
+      DebugInfoFinder &Finder = HLM.GetOrCreateDebugInfoFinder();
+      if (dxilutil::FindGlobalVariableDebugInfo(GV, Finder))
+        HLModule::UpdateGlobalVariableDebugInfo(GV, Finder, NewGV);
+    }
+
+    DEBUG(dbgs() << "hl-pad-groupshared: " << GV->getName() << ": " << *Ty
+                 << " -> " << *PaddedTy << " (+" << Padding << " bytes)\n");
+
+    ReplaceUses(GV, NewGV);
+    std::replace(HLM.tgsm_begin(), HLM.tgsm_end(), GV, NewGV);
+    NewGV->takeName(GV);
+    GV->eraseFromParent();
+
+    ++NumPaddedArrays;
+    NumPaddingBytes += Padding;
+    bUpdated = true;
+  }
+  return bUpdated;
+}
+
+ModulePass *llvm::createHLPadGroupSharedPass() {
+  return new HLPadGroupShared();
+}
+
+INITIALIZE_PASS(HLPadGroupShared, "hl-pad-groupshared",
+                "HLSL pad groupshared arrays", false, false)
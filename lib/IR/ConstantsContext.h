@@ -556,6 +556,7 @@ private:
 public:
   typename MapTy::iterator map_begin() { return Map.begin(); }
   typename MapTy::iterator map_end() { return Map.end(); }
+  unsigned size() const { return Map.size(); } // HLSL Change
 
   void freeConstants() {
     for (auto &I : Map)
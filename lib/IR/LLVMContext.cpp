@@ -264,6 +264,57 @@ bool LLVMContext::findMDKindID(StringRef Name, unsigned *ID) const {
 }
 // HLSL Change - End
 
+// HLSL Change - Begin
+bool LLVMContext::resetForReuse() {
+  if (!pImpl->OwnedModules.empty())
+    return false;
+
+  setDiagnosticHandler(nullptr);
+  setInlineAsmDiagnosticHandler(nullptr);
+  setYieldCallback(nullptr, nullptr);
+
+  // A new struct with the name of a type from an earlier module would
+  // otherwise be renamed with a numeric suffix.
+  std::vector<StructType *> NamedTypes;
+  NamedTypes.reserve(pImpl->NamedStructTypes.size());
+  for (auto &Entry : pImpl->NamedStructTypes)
+    NamedTypes.push_back(Entry.second);
+  for (StructType *ST : NamedTypes)
+    ST->setName("");
+  pImpl->NamedStructTypesUniqueID = 0;
+
+  // The bitcode writer records every kind of the context, in ID order.
+  std::vector<std::string> AddedKinds;
+  for (const auto &Entry : pImpl->CustomMDKindNames)
+    if (Entry.second > MD_dereferenceable_or_null)
+      AddedKinds.push_back(Entry.first());
+  for (const std::string &Kind : AddedKinds)
+    pImpl->CustomMDKindNames.erase(Kind);
+
+  // Keyed on file name pointers owned by the destroyed modules' sources.
+  pImpl->DiscriminatorTable.clear();
+  pImpl->dropTriviallyDeadConstantArrays();
+  return true;
+}
+
+size_t LLVMContext::getNumRetainedObjects() const {
+  size_t Count = pImpl->IntConstants.size() + pImpl->FPConstants.size() +
+                 pImpl->CAZConstants.size() + pImpl->ArrayConstants.size() +
+                 pImpl->StructConstants.size() +
+                 pImpl->VectorConstants.size() + pImpl->CPNConstants.size() +
+                 pImpl->UVConstants.size() + pImpl->CDSConstants.size() +
+                 pImpl->ExprConstants.size() + pImpl->InlineAsms.size() +
+                 pImpl->MDStringCache.size() + pImpl->DistinctMDNodes.size() +
+                 pImpl->FunctionTypes.size() + pImpl->AnonStructTypes.size() +
+                 pImpl->ArrayTypes.size() + pImpl->VectorTypes.size() +
+                 pImpl->PointerTypes.size() + pImpl->ASPointerTypes.size() +
+                 pImpl->AttrsSetNodes.size() + pImpl->AttrsLists.size();
+#define HANDLE_MDNODE_LEAF(CLASS) Count += pImpl->CLASS##s.size();
+#include "llvm/IR/Metadata.def"
+  return Count;
+}
+// HLSL Change - End
+
 /// Return a unique non-zero ID for the specified metadata kind.
 unsigned LLVMContext::getMDKindID(StringRef Name) const {
   // If this is new, assign it its ID.
@@ -17,11 +17,13 @@
 #include "llvm/IR/LegacyPassManagers.h"
 #include "llvm/IR/LegacyPassNameParser.h"
 #include "llvm/IR/Module.h"
+#include "llvm/IR/PassReport.h" // HLSL Change
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/ManagedStatic.h"
 #include "llvm/Support/Mutex.h"
+#include "llvm/Support/TimeProfiler.h" // HLSL Change
 #include "llvm/Support/TimeValue.h"
 #include "llvm/Support/Timer.h"
 #include "llvm/Support/raw_ostream.h"
@@ -1564,6 +1566,8 @@ bool FPPassManager::runOnFunction(Function &F) {
     {
       PassManagerPrettyStackEntry X(FP, F);
       TimeRegion PassTimer(getPassTimer(FP));
+      TimeTraceScope PassTrace(FP->getPassName(), F.getName()); // HLSL Change
+      PassReportScope PassReportRange(FP->getPassName(), F); // HLSL Change
 
       LocalChanged |= FP->runOnFunction(F);
     }
@@ -1640,6 +1644,8 @@ MPPassManager::runOnModule(Module &M) {
     {
       PassManagerPrettyStackEntry X(MP, M);
       TimeRegion PassTimer(getPassTimer(MP));
+      TimeTraceScope PassTrace(MP->getPassName()); // HLSL Change
+      PassReportScope PassReportRange(MP->getPassName(), M); // HLSL Change
 
       LocalChanged |= MP->runOnModule(M);
     }
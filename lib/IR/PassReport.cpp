@@ -0,0 +1,232 @@
+//===-- PassReport.cpp - Per-pass cost report -----------------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// HLSL Change - new file.
+//
+// This file implements the pass report declared in PassReport.h.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/IR/PassReport.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/TimeProfiler.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <string>
+#include <vector>
+
+using namespace llvm;
+
+namespace llvm {
+
+LLVM_THREAD_LOCAL PassReport *PassReportInstance = nullptr;
+
+typedef std::chrono::steady_clock ClockType;
+typedef std::chrono::microseconds DurationType;
+
+static uint64_t countInstructions(const Function &F) {
+  uint64_t Count = 0;
+  for (const BasicBlock &BB : F)
+    Count += BB.size();
+  return Count;
+}
+
+static uint64_t countInstructions(const Module &M) {
+  uint64_t Count = 0;
+  for (const Function &F : M)
+    Count += countInstructions(F);
+  return Count;
+}
+
+struct PassReportEntry {
+  std::string Name;
+  std::string FunctionName;
+  const Module *M = nullptr;
+  const Function *F = nullptr;
+  unsigned Depth = 0;
+  bool Done = false;
+  ClockType::time_point Start;
+  DurationType Duration = DurationType(0);
+  uint64_t InstructionsBefore = 0;
+  uint64_t InstructionsAfter = 0;
+  uint64_t StartBytes = 0;
+  uint64_t PeakBytes = 0;
+};
+
+struct PassReport {
+  PassReport(PassReportMemoryCounter *Counter) : Counter(Counter) {}
+
+  template <typename IRUnitT>
+  void begin(StringRef PassName, IRUnitT &IR, const Module *M,
+             const Function *F) {
+    // The peak of the enclosing pass so far must be folded in before the
+    // counter is reset for this one.
+    notePeak();
+    Entries.emplace_back();
+    PassReportEntry &E = Entries.back();
+    E.Name = PassName;
+    if (F)
+      E.FunctionName = F->getName();
+    E.M = M;
+    E.F = F;
+    E.Depth = Stack.size();
+    E.InstructionsBefore = countInstructions(IR);
+    if (Counter) {
+      E.StartBytes = Counter->getCurrentBytes();
+      E.PeakBytes = E.StartBytes;
+      Counter->resetPeakBytes();
+    }
+    Stack.push_back(Entries.size() - 1);
+    // Start the clock last so the bookkeeping above is not counted.
+    E.Start = ClockType::now();
+  }
+
+  void end() {
+    if (Stack.empty())
+      return;
+    ClockType::time_point Now = ClockType::now();
+    PassReportEntry &E = Entries[Stack.back()];
+    E.Duration = std::chrono::duration_cast<DurationType>(Now - E.Start);
+    notePeak();
+    E.InstructionsAfter =
+        E.F ? countInstructions(*E.F) : countInstructions(*E.M);
+    E.Done = true;
+    Stack.pop_back();
+
+    // The enclosing pass peaked at least as high as this one did.
+    if (!Stack.empty()) {
+      PassReportEntry &Outer = Entries[Stack.back()];
+      Outer.PeakBytes = std::max(Outer.PeakBytes, E.PeakBytes);
+    }
+    if (Counter)
+      Counter->resetPeakBytes();
+
+    // Only count the outermost run of each pass towards its total, so that
+    // recursive runs are not counted twice.
+    bool IsOutermost = std::none_of(
+        Stack.begin(), Stack.end(),
+        [&](size_t Outer) { return Entries[Outer].Name == E.Name; });
+    if (IsOutermost) {
+      Total &T = Totals[E.Name];
+      ++T.Count;
+      T.Duration += E.Duration;
+      T.InstructionDelta +=
+          (int64_t)E.InstructionsAfter - (int64_t)E.InstructionsBefore;
+      T.PeakBytes = std::max(T.PeakBytes, E.PeakBytes - E.StartBytes);
+    }
+  }
+
+  // Fold the counter's peak since its last reset into the running pass.
+  void notePeak() {
+    if (!Counter || Stack.empty())
+      return;
+    PassReportEntry &E = Entries[Stack.back()];
+    E.PeakBytes = std::max(E.PeakBytes, Counter->getPeakBytes());
+  }
+
+  void write(raw_ostream &OS) const;
+
+  struct Total {
+    size_t Count = 0;
+    DurationType Duration = DurationType(0);
+    int64_t InstructionDelta = 0;
+    uint64_t PeakBytes = 0;
+  };
+
+  PassReportMemoryCounter *Counter;
+  std::vector<size_t> Stack;
+  std::vector<PassReportEntry> Entries;
+  StringMap<Total> Totals;
+};
+
+} // end namespace llvm
+
+void PassReport::write(raw_ostream &OS) const {
+  OS << "{\"passes\":[";
+  bool First = true;
+  for (const PassReportEntry &E : Entries) {
+    if (!E.Done)
+      continue;
+    OS << (First ? "\n" : ",\n");
+    First = false;
+    OS << "{\"name\":";
+    writeJSONString(OS, E.Name);
+    if (E.F) {
+      OS << ",\"function\":";
+      writeJSONString(OS, E.FunctionName);
+    }
+    OS << ",\"depth\":" << E.Depth << ",\"us\":" << (int64_t)E.Duration.count()
+       << ",\"instructionsBefore\":" << E.InstructionsBefore
+       << ",\"instructionsAfter\":" << E.InstructionsAfter;
+    if (Counter)
+      OS << ",\"peakBytes\":" << (E.PeakBytes - E.StartBytes);
+    OS << "}";
+  }
+  OS << "\n],\"totals\":[";
+
+  // Emit totals by name, longest first.
+  std::vector<const StringMapEntry<Total> *> SortedTotals;
+  for (const auto &T : Totals)
+    SortedTotals.push_back(&T);
+  std::sort(SortedTotals.begin(), SortedTotals.end(),
+            [](const StringMapEntry<Total> *A, const StringMapEntry<Total> *B) {
+              if (A->getValue().Duration != B->getValue().Duration)
+                return A->getValue().Duration > B->getValue().Duration;
+              return A->getKey() < B->getKey();
+            });
+  First = true;
+  for (const auto *T : SortedTotals) {
+    OS << (First ? "\n" : ",\n");
+    First = false;
+    OS << "{\"name\":";
+    writeJSONString(OS, T->getKey());
+    OS << ",\"count\":" << (uint64_t)T->getValue().Count
+       << ",\"us\":" << (int64_t)T->getValue().Duration.count()
+       << ",\"instructionDelta\":" << T->getValue().InstructionDelta;
+    if (Counter)
+      OS << ",\"peakBytes\":" << T->getValue().PeakBytes;
+    OS << "}";
+  }
+  OS << "\n]}\n";
+}
+
+void llvm::passReportInitialize(PassReportMemoryCounter *Counter) {
+  assert(PassReportInstance == nullptr &&
+         "Pass report should not be initialized");
+  PassReportInstance = new PassReport(Counter);
+}
+
+void llvm::passReportCleanup() {
+  delete PassReportInstance;
+  PassReportInstance = nullptr;
+}
+
+void llvm::passReportWrite(raw_ostream &OS) {
+  assert(PassReportInstance != nullptr && "Pass report can't be null");
+  PassReportInstance->write(OS);
+}
+
+void llvm::passReportBegin(StringRef PassName, Module &M) {
+  if (PassReportInstance != nullptr)
+    PassReportInstance->begin(PassName, M, &M, nullptr);
+}
+
+void llvm::passReportBegin(StringRef PassName, Function &F) {
+  if (PassReportInstance != nullptr)
+    PassReportInstance->begin(PassName, F, F.getParent(), &F);
+}
+
+void llvm::passReportEnd() {
+  if (PassReportInstance != nullptr)
+    PassReportInstance->end();
+}
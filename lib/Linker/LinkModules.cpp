@@ -813,6 +813,21 @@ bool ModuleLinker::shouldLinkFromSource(bool &LinkFromSrc,
 /// types 'Foo' but one got renamed when the module was loaded into the same
 /// LLVMContext.
 void ModuleLinker::computeTypeMapping() {
+  // HLSL Change Begin - the bitcode reader reuses a type of the context that
+  // has the same name and layout, so the source can share types with the
+  // destination. Keep those as they are rather than merging them with another
+  // type of the same layout.
+  {
+    DenseSet<StructType *> SrcTypeSet;
+    for (StructType *ST : SrcM->getIdentifiedStructTypes())
+      SrcTypeSet.insert(ST);
+    for (StructType *ST : DstM->getIdentifiedStructTypes()) {
+      if (SrcTypeSet.count(ST))
+        TypeMap.addTypeMapping(ST, ST);
+    }
+  }
+  // HLSL Change End
+
   for (GlobalValue &SGV : SrcM->globals()) {
     GlobalValue *DGV = getLinkedToGlobal(&SGV);
     if (!DGV)
@@ -0,0 +1,202 @@
+//===-- TimeProfiler.cpp - Hierarchical Time Profiler ---------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// HLSL Change - new file.
+//
+// This file implements the hierarchical time profiler declared in
+// TimeProfiler.h.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Support/TimeProfiler.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <string>
+#include <vector>
+
+using namespace llvm;
+
+namespace llvm {
+
+LLVM_THREAD_LOCAL TimeTraceProfiler *TimeTraceProfilerInstance = nullptr;
+LLVM_THREAD_LOCAL TimeTraceListener *TimeTraceListenerInstance = nullptr;
+
+typedef std::chrono::steady_clock ClockType;
+typedef std::chrono::microseconds DurationType;
+
+struct TimeTraceEntry {
+  ClockType::time_point Start;
+  DurationType Duration;
+  std::string Name;
+  std::string Detail;
+};
+
+struct TimeTraceProfiler {
+  TimeTraceProfiler(StringRef ProcessName)
+      : ProcessName(ProcessName), StartTime(ClockType::now()) {}
+
+  void begin(StringRef Name, StringRef Detail) {
+    TimeTraceEntry E;
+    E.Start = ClockType::now();
+    E.Duration = DurationType(0);
+    E.Name = Name;
+    E.Detail = Detail;
+    Stack.push_back(std::move(E));
+  }
+
+  void end() {
+    if (Stack.empty())
+      return;
+    TimeTraceEntry &E = Stack.back();
+    E.Duration =
+        std::chrono::duration_cast<DurationType>(ClockType::now() - E.Start);
+
+    // Only count the outermost range of each name towards its total, so that
+    // recursive ranges are not counted twice.
+    bool IsOutermost = std::none_of(
+        Stack.begin(), Stack.end() - 1,
+        [&](const TimeTraceEntry &Outer) { return Outer.Name == E.Name; });
+    if (IsOutermost) {
+      CountAndDuration &Total = Totals[E.Name];
+      ++Total.Count;
+      Total.Duration += E.Duration;
+    }
+
+    Entries.push_back(std::move(E));
+    Stack.pop_back();
+  }
+
+  int64_t startOffset(const TimeTraceEntry &E) const {
+    return std::chrono::duration_cast<DurationType>(E.Start - StartTime)
+        .count();
+  }
+
+  void write(raw_ostream &OS) const;
+
+  struct CountAndDuration {
+    size_t Count = 0;
+    DurationType Duration = DurationType(0);
+  };
+
+  std::string ProcessName;
+  ClockType::time_point StartTime;
+  std::vector<TimeTraceEntry> Stack;
+  std::vector<TimeTraceEntry> Entries;
+  StringMap<CountAndDuration> Totals;
+};
+
+} // end namespace llvm
+
+void llvm::writeJSONString(raw_ostream &OS, StringRef Str) {
+  OS << '"';
+  for (unsigned char C : Str) {
+    switch (C) {
+    case '"':  OS << "\\\""; break;
+    case '\\': OS << "\\\\"; break;
+    case '\n': OS << "\\n"; break;
+    case '\r': OS << "\\r"; break;
+    case '\t': OS << "\\t"; break;
+    default:
+      if (C < 0x20)
+        OS << format("\\u%04x", C);
+      else
+        OS << C;
+    }
+  }
+  OS << '"';
+}
+
+void TimeTraceProfiler::write(raw_ostream &OS) const {
+  OS << "{\"traceEvents\":[";
+  bool First = true;
+  auto writeEvent = [&](StringRef Name, int64_t Ts, int64_t Dur, uint64_t Tid) {
+    OS << (First ? "\n" : ",\n");
+    First = false;
+    OS << "{\"pid\":1,\"tid\":" << Tid << ",\"ph\":\"X\",\"ts\":" << Ts
+       << ",\"dur\":" << Dur << ",\"name\":";
+    writeJSONString(OS, Name);
+  };
+
+  for (const TimeTraceEntry &E : Entries) {
+    writeEvent(E.Name, startOffset(E), E.Duration.count(), 0);
+    if (!E.Detail.empty()) {
+      OS << ",\"args\":{\"detail\":";
+      writeJSONString(OS, E.Detail);
+      OS << "}";
+    }
+    OS << "}";
+  }
+
+  // Emit totals by name, longest first, each on its own row of the trace.
+  std::vector<const StringMapEntry<CountAndDuration> *> SortedTotals;
+  for (const auto &Total : Totals)
+    SortedTotals.push_back(&Total);
+  std::sort(SortedTotals.begin(), SortedTotals.end(),
+            [](const StringMapEntry<CountAndDuration> *A,
+               const StringMapEntry<CountAndDuration> *B) {
+              if (A->getValue().Duration != B->getValue().Duration)
+                return A->getValue().Duration > B->getValue().Duration;
+              return A->getKey() < B->getKey();
+            });
+  uint64_t Tid = 1;
+  for (const auto *Total : SortedTotals) {
+    int64_t Dur = Total->getValue().Duration.count();
+    size_t Count = Total->getValue().Count;
+    writeEvent(std::string("Total ") + Total->getKey().str(), 0, Dur, Tid++);
+    OS << ",\"args\":{\"count\":" << (uint64_t)Count
+       << ",\"avg ms\":" << (int64_t)(Dur / Count / 1000) << "}}";
+  }
+
+  OS << (First ? "\n" : ",\n");
+  OS << "{\"pid\":1,\"tid\":0,\"ph\":\"M\",\"name\":\"process_name\","
+        "\"args\":{\"name\":";
+  writeJSONString(OS, ProcessName);
+  OS << "}}\n]}\n";
+}
+
+void llvm::timeTraceProfilerInitialize(StringRef ProcessName) {
+  assert(TimeTraceProfilerInstance == nullptr &&
+         "Profiler should not be initialized");
+  TimeTraceProfilerInstance = new TimeTraceProfiler(ProcessName);
+}
+
+void llvm::timeTraceProfilerCleanup() {
+  delete TimeTraceProfilerInstance;
+  TimeTraceProfilerInstance = nullptr;
+}
+
+void llvm::timeTraceProfilerWrite(raw_ostream &OS) {
+  assert(TimeTraceProfilerInstance != nullptr &&
+         "Profiler object can't be null");
+  TimeTraceProfilerInstance->write(OS);
+}
+
+TimeTraceListener *llvm::timeTraceSetListener(TimeTraceListener *Listener) {
+  TimeTraceListener *Prior = TimeTraceListenerInstance;
+  TimeTraceListenerInstance = Listener;
+  return Prior;
+}
+
+void llvm::timeTraceProfilerBegin(StringRef Name, StringRef Detail) {
+  if (TimeTraceProfilerInstance != nullptr)
+    TimeTraceProfilerInstance->begin(Name, Detail);
+  if (TimeTraceListenerInstance != nullptr)
+    TimeTraceListenerInstance->rangeBegin(Name);
+}
+
+void llvm::timeTraceProfilerEnd() {
+  if (TimeTraceProfilerInstance != nullptr)
+    TimeTraceProfilerInstance->end();
+  if (TimeTraceListenerInstance != nullptr)
+    TimeTraceListenerInstance->rangeEnd();
+}
@@ -0,0 +1,103 @@
+//===-- xxhash.cpp - XXH64 hash function ----------------------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// HLSL Change - new file.
+//
+// This file implements the XXH64 hash declared in xxhash.h, following the
+// reference specification.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Support/xxhash.h"
+#include "llvm/Support/Endian.h"
+
+using namespace llvm;
+using namespace support;
+
+static const uint64_t PRIME64_1 = 0x9E3779B185EBCA87ULL;
+static const uint64_t PRIME64_2 = 0xC2B2AE3D27D4EB4FULL;
+static const uint64_t PRIME64_3 = 0x165667B19E3779F9ULL;
+static const uint64_t PRIME64_4 = 0x85EBCA77C2B2AE63ULL;
+static const uint64_t PRIME64_5 = 0x27D4EB2F165667C5ULL;
+
+static uint64_t rotl64(uint64_t X, int R) {
+  return (X << R) | (X >> (64 - R));
+}
+
+static uint64_t xxRound(uint64_t Acc, uint64_t Input) {
+  Acc += Input * PRIME64_2;
+  Acc = rotl64(Acc, 31);
+  Acc *= PRIME64_1;
+  return Acc;
+}
+
+static uint64_t xxMergeRound(uint64_t Acc, uint64_t Val) {
+  Val = xxRound(0, Val);
+  Acc ^= Val;
+  Acc = Acc * PRIME64_1 + PRIME64_4;
+  return Acc;
+}
+
+uint64_t llvm::xxHash64(ArrayRef<uint8_t> Data, uint64_t Seed) {
+  const uint8_t *P = Data.data();
+  const uint8_t *const BEnd = P + Data.size();
+  uint64_t H64;
+
+  if (Data.size() >= 32) {
+    // Four independent lanes over 32-byte stripes.
+    const uint8_t *const Limit = BEnd - 32;
+    uint64_t V1 = Seed + PRIME64_1 + PRIME64_2;
+    uint64_t V2 = Seed + PRIME64_2;
+    uint64_t V3 = Seed;
+    uint64_t V4 = Seed - PRIME64_1;
+    do {
+      V1 = xxRound(V1, endian::read64le(P));
+      V2 = xxRound(V2, endian::read64le(P + 8));
+      V3 = xxRound(V3, endian::read64le(P + 16));
+      V4 = xxRound(V4, endian::read64le(P + 24));
+      P += 32;
+    } while (P <= Limit);
+
+    H64 = rotl64(V1, 1) + rotl64(V2, 7) + rotl64(V3, 12) + rotl64(V4, 18);
+    H64 = xxMergeRound(H64, V1);
+    H64 = xxMergeRound(H64, V2);
+    H64 = xxMergeRound(H64, V3);
+    H64 = xxMergeRound(H64, V4);
+  } else {
+    H64 = Seed + PRIME64_5;
+  }
+
+  H64 += (uint64_t)Data.size();
+
+  while (P + 8 <= BEnd) {
+    H64 ^= xxRound(0, endian::read64le(P));
+    H64 = rotl64(H64, 27) * PRIME64_1 + PRIME64_4;
+    P += 8;
+  }
+
+  if (P + 4 <= BEnd) {
+    H64 ^= (uint64_t)endian::read32le(P) * PRIME64_1;
+    H64 = rotl64(H64, 23) * PRIME64_2 + PRIME64_3;
+    P += 4;
+  }
+
+  while (P < BEnd) {
+    H64 ^= (*P) * PRIME64_5;
+    H64 = rotl64(H64, 11) * PRIME64_1;
+    ++P;
+  }
+
+  // Final avalanche.
+  H64 ^= H64 >> 33;
+  H64 *= PRIME64_2;
+  H64 ^= H64 >> 29;
+  H64 *= PRIME64_3;
+  H64 ^= H64 >> 32;
+  return H64;
+}
@@ -207,7 +207,7 @@ void PassManagerBuilder::populateFunctionPassManager(
 }
 
 // HLSL Change Starts
-static void addHLSLPasses(bool HLSLHighLevel, unsigned OptLevel, bool OnlyWarnOnUnrollFail, bool StructurizeLoopExitsForUnroll, bool EnableLifetimeMarkers, hlsl::HLSLExtensionsCodegenHelper *ExtHelper, legacy::PassManagerBase &MPM) {
+static void addHLSLPasses(bool HLSLHighLevel, unsigned OptLevel, bool OnlyWarnOnUnrollFail, bool StructurizeLoopExitsForUnroll, bool EnableLifetimeMarkers, const PassManagerBuilder &Builder, hlsl::HLSLExtensionsCodegenHelper *ExtHelper, legacy::PassManagerBase &MPM) {
 
   // Don't do any lowering if we're targeting high-level.
   if (HLSLHighLevel) {
@@ -287,13 +287,25 @@ static void addHLSLPasses(bool HLSLHighLevel, unsigned OptLevel, bool OnlyWarnOn
   // Verify no undef resource again after promotion
   MPM.add(createInvalidateUndefResourcesPass());
 
+  // Pad groupshared rows while the arrays still have all their dimensions.
+  if (!NoOpt && Builder.HLSLEnableGroupSharedPadding)
+    MPM.add(createHLPadGroupSharedPass());
+
   MPM.add(createDxilGenerationPass(NoOpt, ExtHelper));
 
+  // Fix constant buffer fields given on the command line, before anything
+  // that could fold them.
+  if (!Builder.HLSLSpecializedCBufferValues.empty())
+    MPM.add(createDxilSpecializeCBufferPass(Builder.HLSLSpecializedCBufferValues));
+
   // Propagate precise attribute.
   MPM.add(createDxilPrecisePropagatePass());
 
-  if (!NoOpt)
+  if (!NoOpt) {
     MPM.add(createSimplifyInstPass());
+    // Merge cbuffer row loads, which CSE cannot move past stores.
+    MPM.add(createDxilCoalesceCBufferLoadsPass());
+  }
 
   // scalarize vector to scalar
   MPM.add(createScalarizerPass(!NoOpt /* AllowFolding */));
@@ -301,12 +313,19 @@ static void addHLSLPasses(bool HLSLHighLevel, unsigned OptLevel, bool OnlyWarnOn
   // Remove vector instructions
   MPM.add(createDxilEliminateVectorPass());
 
+  // Pack pairs of half products back into Dot2AddHalf.
+  if (!NoOpt && Builder.HLSLEnableDot2AddFormation)
+    MPM.add(createDxilFormDot2AddHalfPass());
+
   // Passes to handle [unroll]
   // Needs to happen after SROA since loop count may depend on
   // struct members.
   // Needs to happen before resources are lowered and before HL
   // module is gone.
-  MPM.add(createDxilLoopUnrollPass(1024, OnlyWarnOnUnrollFail, StructurizeLoopExitsForUnroll));
+  MPM.add(createDxilLoopUnrollPass(1024, OnlyWarnOnUnrollFail, StructurizeLoopExitsForUnroll,
+                                   Builder.HLSLUnrollMaxFunctionInstructions,
+                                   Builder.HLSLUnrollMaxModuleInstructions,
+                                   Builder.HLSLUnrollTimeLimit));
 
   // Default unroll pass. This is purely for optimizing loops without
   // attributes.
@@ -369,6 +388,7 @@ void PassManagerBuilder::populateModulePassManager(
       this->HLSLOnlyWarnOnUnrollFail,
       this->StructurizeLoopExitsForUnroll,
       this->HLSLEnableLifetimeMarkers,
+      *this,
       this->HLSLExtensionsCodeGen,
       MPM);
 
@@ -410,11 +430,15 @@ void PassManagerBuilder::populateModulePassManager(
 
   MPM.add(createHLLegalizeParameter()); // legalize parameters before inline.
   MPM.add(createAlwaysInlinerPass(/*InsertLifeTime*/this->HLSLEnableLifetimeMarkers));
+  // A function pass here joins the inliner's call graph pass manager, so it
+  // cleans up each function before it is inlined into its callers.
+  if (HLSLEnableInlineCleanup && !HLSLHighLevel)
+    MPM.add(createHLInlineCleanupPass());
   if (Inliner) {
     delete Inliner;
     Inliner = nullptr;
   }
-  addHLSLPasses(HLSLHighLevel, OptLevel, this->HLSLOnlyWarnOnUnrollFail, this->StructurizeLoopExitsForUnroll, this->HLSLEnableLifetimeMarkers, HLSLExtensionsCodeGen, MPM); // HLSL Change
+  addHLSLPasses(HLSLHighLevel, OptLevel, this->HLSLOnlyWarnOnUnrollFail, this->StructurizeLoopExitsForUnroll, this->HLSLEnableLifetimeMarkers, *this, HLSLExtensionsCodeGen, MPM); // HLSL Change
   // HLSL Change Ends
 
   // Add LibraryInfo if we have some.
@@ -497,7 +521,7 @@ void PassManagerBuilder::populateModulePassManager(
     if (EnableGVN) {
       MPM.add(createGVNPass(DisableGVNLoadPRE));  // Remove redundancies
       if (!HLSLResMayAlias)
-        MPM.add(createDxilSimpleGVNHoistPass());
+        MPM.add(createDxilSimpleGVNHoistPass(HLSLMaxRegisterPressure));
     }
     // HLSL Change Ends
   }
@@ -690,10 +714,23 @@ void PassManagerBuilder::populateModulePassManager(
     MPM.add(createDxilMutateResourceToHandlePass());
     MPM.add(createDxilCleanupDynamicResourceHandlePass());
     MPM.add(createDxilLowerCreateHandleForLibPass());
+    if (HLSLCombineRawBufferAccesses)
+      MPM.add(createDxilCombineRawBufferAccessesPass());
+    MPM.add(createDxilMeshOutputStoreEliminationPass());
+    MPM.add(createDxilUniformityOptPass(HLSLFoldUniformWaveOps));
+    if (HLSLEnableUniformityMetadata)
+      MPM.add(createDxilAnnotateUniformityPass());
     MPM.add(createDxilTranslateRawBuffer());
     // Always try to legalize sample offsets as loop unrolling
     // is not guaranteed for higher opt levels.
     MPM.add(createDxilLegalizeSampleOffsetPass());
+    // Shorten live ranges of handles and cbuffer values once nothing
+    // merges them again.
+    if (HLSLMaxRegisterPressure)
+      MPM.add(createDxilRematerializePass(HLSLMaxRegisterPressure));
+    // Issue independent fetches together where the driver may not.
+    if (HLSLEnableFetchClustering)
+      MPM.add(createDxilClusterFetchesPass());
     MPM.add(createDxilFinalizeModulePass());
     MPM.add(createComputeViewIdStatePass());
     MPM.add(createDxilDeadFunctionEliminationPass());
@@ -50,6 +50,10 @@
 //    Instead, we unroll to find a constant terminal condition. Give up when we
 //    fail to do so.
 //
+//    An optional budget caps the instructions cloned per function and per
+//    module, and the time spent unrolling. A loop that would go over it is
+//    kept as a loop with a warning, rather than failing the compile.
+//
 //
 //===----------------------------------------------------------------------===//
 
@@ -89,6 +93,9 @@
 
 #include "DxilRemoveUnstructuredLoopExits.h"
 
+#include <chrono>
+#include <unordered_map>
+
 using namespace llvm;
 using namespace hlsl;
 
@@ -113,11 +120,26 @@ public:
   bool OnlyWarnOnFail = false;
   bool StructurizeLoopExits = false;
 
-  DxilLoopUnroll(unsigned MaxIterationAttempt = 1024, bool OnlyWarnOnFail=false, bool StructurizeLoopExits=false) :
+  // Unroll budget; zero means unlimited.
+  unsigned MaxFunctionInstructions = 0;
+  unsigned MaxModuleInstructions = 0;
+  unsigned TimeLimitMs = 0;
+
+  // Budget spent so far, reset when a new module is seen.
+  Module *BudgetModule = nullptr;
+  std::chrono::steady_clock::time_point BudgetStart;
+  uint64_t ModuleInstructionsCloned = 0;
+  std::unordered_map<Function *, uint64_t> FunctionInstructionsCloned;
+
+  DxilLoopUnroll(unsigned MaxIterationAttempt = 1024, bool OnlyWarnOnFail=false, bool StructurizeLoopExits=false,
+                 unsigned MaxFunctionInstructions = 0, unsigned MaxModuleInstructions = 0, unsigned TimeLimitMs = 0) :
     LoopPass(ID),
     MaxIterationAttempt(MaxIterationAttempt),
     OnlyWarnOnFail(OnlyWarnOnFail),
-    StructurizeLoopExits(StructurizeLoopExits)
+    StructurizeLoopExits(StructurizeLoopExits),
+    MaxFunctionInstructions(MaxFunctionInstructions),
+    MaxModuleInstructions(MaxModuleInstructions),
+    TimeLimitMs(TimeLimitMs)
   {
     initializeDxilLoopUnrollPass(*PassRegistry::getPassRegistry());
   }
@@ -140,12 +162,20 @@ public:
   void applyOptions(PassOptions O) override {
     GetPassOptionUnsigned(O, "MaxIterationAttempt", &MaxIterationAttempt, false);
     GetPassOptionBool(O, "OnlyWarnOnFail", &OnlyWarnOnFail, false);
+    GetPassOptionUnsigned(O, "MaxFunctionInstructions", &MaxFunctionInstructions, 0);
+    GetPassOptionUnsigned(O, "MaxModuleInstructions", &MaxModuleInstructions, 0);
+    GetPassOptionUnsigned(O, "TimeLimitMs", &TimeLimitMs, 0);
   }
   void dumpConfig(raw_ostream &OS) override {
     LoopPass::dumpConfig(OS);
     OS << ",MaxIterationAttempt=" << MaxIterationAttempt;
     OS << ",OnlyWarnOnFail=" << OnlyWarnOnFail;
+    OS << ",MaxFunctionInstructions=" << MaxFunctionInstructions;
+    OS << ",MaxModuleInstructions=" << MaxModuleInstructions;
+    OS << ",TimeLimitMs=" << TimeLimitMs;
   }
+  void StartBudget(Module *M);
+  bool IsOverBudget(Function *F, uint64_t NewInstructions, std::string &Reason);
   void RecursivelyRemoveLoopOnSuccess(LPPassManager &LPM, Loop *L);
   void RecursivelyRecreateSubLoopForIteration(LPPassManager &LPM, LoopInfo *LI, Loop *OuterL, Loop *L, ClonedIteration &Iter, unsigned Depth=0);
 };
@@ -179,6 +209,79 @@ static void FailLoopUnroll(bool WarnOnly, Function *F, DebugLoc DL, const Twine
   Ctx.diagnose(DiagnosticInfoDxil(F, DL.get(), Message, severity));
 }
 
+void DxilLoopUnroll::StartBudget(Module *M) {
+  if (M == BudgetModule)
+    return;
+  BudgetModule = M;
+  BudgetStart = std::chrono::steady_clock::now();
+  ModuleInstructionsCloned = 0;
+  FunctionInstructionsCloned.clear();
+}
+
+// Returns whether cloning NewInstructions more instructions into F would go
+// over the unroll budget, and if so, which part of it in Reason.
+bool DxilLoopUnroll::IsOverBudget(Function *F, uint64_t NewInstructions, std::string &Reason) {
+  raw_string_ostream OS(Reason);
+  if (MaxFunctionInstructions &&
+      FunctionInstructionsCloned[F] + NewInstructions > MaxFunctionInstructions) {
+    OS << "it would clone more than " << MaxFunctionInstructions
+       << " instructions into the function";
+    OS.flush();
+    return true;
+  }
+  if (MaxModuleInstructions &&
+      ModuleInstructionsCloned + NewInstructions > MaxModuleInstructions) {
+    OS << "it would clone more than " << MaxModuleInstructions
+       << " instructions into the module";
+    OS.flush();
+    return true;
+  }
+  if (TimeLimitMs) {
+    auto Elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - BudgetStart);
+    if ((uint64_t)Elapsed.count() >= TimeLimitMs) {
+      OS << "unrolling took longer than " << TimeLimitMs << " ms";
+      OS.flush();
+      return true;
+    }
+  }
+  return false;
+}
+
+// Replaces any unroll hints on the loop with llvm.loop.unroll.disable, so
+// that no later unroll pass unrolls a loop that was kept to stay in budget.
+static void DisableFurtherUnrolling(Loop *L) {
+  LLVMContext &Context = L->getHeader()->getContext();
+  SmallVector<Metadata *, 4> MDs;
+  // Reserve first location for self reference to the LoopID metadata node.
+  MDs.push_back(nullptr);
+  if (MDNode *LoopID = L->getLoopID()) {
+    for (unsigned i = 1, ie = LoopID->getNumOperands(); i < ie; ++i) {
+      bool IsUnrollMetadata = false;
+      if (MDNode *MD = dyn_cast<MDNode>(LoopID->getOperand(i))) {
+        const MDString *S = dyn_cast<MDString>(MD->getOperand(0));
+        IsUnrollMetadata = S && S->getString().startswith("llvm.loop.unroll.");
+      }
+      if (!IsUnrollMetadata)
+        MDs.push_back(LoopID->getOperand(i));
+    }
+  }
+  MDs.push_back(
+      MDNode::get(Context, MDString::get(Context, "llvm.loop.unroll.disable")));
+
+  MDNode *NewLoopID = MDNode::get(Context, MDs);
+  NewLoopID->replaceOperandWith(0, NewLoopID);
+  L->setLoopID(NewLoopID);
+}
+
+static void KeepLoopOverBudget(Loop *L, Function *F, DebugLoc DL,
+                               const std::string &Reason) {
+  FailLoopUnroll(true /*warn only*/, F, DL,
+                 Twine("Loop was not unrolled because ") + Reason +
+                     ". Raise the unroll budget to unroll it.");
+  DisableFurtherUnrolling(L);
+}
+
 static bool GetConstantI1(Value *V, bool *Val=nullptr) {
   if (ConstantInt *C = dyn_cast<ConstantInt>(V)) {
     if (V->getType()->isIntegerTy(1)) {
@@ -786,6 +889,22 @@ bool DxilLoopUnroll::runOnLoop(Loop *L, LPPassManager &LPM) {
     TripCount = SE->getSmallConstantTripCount(L, ExitingBlock);
   }
 
+  // Check the budget before touching the loop, when the number of iterations
+  // is already known.
+  StartBudget(F->getParent());
+  {
+    uint64_t BodySize = 0;
+    for (BasicBlock *BB : L->getBlocks())
+      BodySize += BB->size();
+    uint64_t KnownIterations = TripCount ? TripCount
+                             : HasExplicitLoopCount ? ExplicitUnrollCount : 1;
+    std::string Reason;
+    if (IsOverBudget(F, BodySize * KnownIterations, Reason)) {
+      KeepLoopOverBudget(L, F, LoopLoc, Reason);
+      return true;
+    }
+  }
+
 
   // Analysis passes
   DominatorTree *DT = &getAnalysis<DominatorTreeWrapperPass>().getDomTree();
@@ -930,8 +1049,16 @@ bool DxilLoopUnroll::runOnLoop(Loop *L, LPPassManager &LPM) {
     MaxAttempt = ExplicitUnrollCount;
   }
 
+  uint64_t InstructionsPerIteration = 0;
+  for (BasicBlock *BB : ToBeCloned)
+    InstructionsPerIteration += BB->size();
+  std::string OverBudgetReason;
+
   for (unsigned IterationI = 0; IterationI < MaxAttempt; IterationI++) {
 
+    if (IsOverBudget(F, (IterationI + 1) * InstructionsPerIteration, OverBudgetReason))
+      break;
+
     ClonedIteration *PrevIteration = nullptr;
     if (Iterations.size())
       PrevIteration = Iterations.back().get();
@@ -1076,6 +1203,10 @@ bool DxilLoopUnroll::runOnLoop(Loop *L, LPPassManager &LPM) {
   }
 
   if (Succeeded) {
+    uint64_t InstructionsCloned = Iterations.size() * InstructionsPerIteration;
+    FunctionInstructionsCloned[F] += InstructionsCloned;
+    ModuleInstructionsCloned += InstructionsCloned;
+
     // Now that we successfully unrolled the loop L, if there were any sub loops in L,
     // we have to recreate all the sub-loops for each iteration of L that we cloned.
     for (std::unique_ptr<ClonedIteration> &IterPtr : Iterations) {
@@ -1164,15 +1295,34 @@ bool DxilLoopUnroll::runOnLoop(Loop *L, LPPassManager &LPM) {
       FailLoopUnroll(false, F, LoopLoc, "Could not unroll loop due to out of bound array access.");
     }
 
-    DVC->ResetUnknowns();
+    // Only the cloned blocks, and whatever was computed from them or from the
+    // retargeted predecessor, can have changed. Resetting every unknown in the
+    // function instead makes each unrolled loop re-evaluate all the loops
+    // unrolled before it.
+    SmallVector<Value *, 64> ChangedValues;
+    ChangedValues.push_back(Predecessor);
+    for (BasicBlock *BB : FakeExits)
+      ChangedValues.push_back(BB);
+    for (std::unique_ptr<ClonedIteration> &IterPtr : Iterations) {
+      for (BasicBlock *BB : IterPtr->Body) {
+        ChangedValues.push_back(BB);
+        for (Instruction &I : *BB)
+          ChangedValues.push_back(&I);
+      }
+    }
+    DVC->ResetUnknowns(ChangedValues);
 
     return true;
   }
 
   // If we were unsuccessful in unrolling the loop
   else {
-    // Mark loop as failed.
-    LoopsThatFailed.insert(L);
+    // Keep a loop that ran out of budget with a warning. Otherwise, mark loop
+    // as failed.
+    if (!OverBudgetReason.empty())
+      KeepLoopOverBudget(L, F, LoopLoc, OverBudgetReason);
+    else
+      LoopsThatFailed.insert(L);
 
     // Remove all the cloned blocks
     for (std::unique_ptr<ClonedIteration> &Ptr : Iterations) {
@@ -1191,7 +1341,7 @@ bool DxilLoopUnroll::runOnLoop(Loop *L, LPPassManager &LPM) {
         BB->eraseFromParent();
     }
 
-    return false;
+    return !OverBudgetReason.empty();
   }
 }
 
@@ -1218,8 +1368,11 @@ bool DxilLoopUnroll::doFinalization() {
 
 }
 
-Pass *llvm::createDxilLoopUnrollPass(unsigned MaxIterationAttempt, bool OnlyWarnOnFail, bool StructurizeLoopExits) {
-  return new DxilLoopUnroll(MaxIterationAttempt, OnlyWarnOnFail, StructurizeLoopExits);
+Pass *llvm::createDxilLoopUnrollPass(unsigned MaxIterationAttempt, bool OnlyWarnOnFail, bool StructurizeLoopExits,
+                                     unsigned MaxFunctionInstructions, unsigned MaxModuleInstructions,
+                                     unsigned TimeLimitMs) {
+  return new DxilLoopUnroll(MaxIterationAttempt, OnlyWarnOnFail, StructurizeLoopExits,
+                            MaxFunctionInstructions, MaxModuleInstructions, TimeLimitMs);
 }
 
 INITIALIZE_PASS_BEGIN(DxilLoopUnroll, "dxil-loop-unroll", "Dxil Unroll loops", false, false)
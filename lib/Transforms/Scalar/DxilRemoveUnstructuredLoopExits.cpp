@@ -120,6 +120,7 @@
 #include "llvm/Transforms/Scalar.h"
 #include "llvm/Transforms/Utils/Local.h"
 #include "llvm/Transforms/Utils/LoopUtils.h"
+#include "llvm/IR/Dominators.h"
 #include "llvm/IR/Instructions.h"
 #include "llvm/IR/Verifier.h"
 #include "llvm/IR/IntrinsicInst.h"
@@ -295,10 +296,20 @@ static BasicBlock *GetExitBlockForExitingBlock(Loop *L, BasicBlock *exiting_bloc
   return result;
 }
 
+// Update the dominator tree after top was split and bottom took over its
+// terminator: bottom is dominated by top and dominates whatever top used to.
+static void UpdateDomTreeForSplit(DominatorTree *DT, BasicBlock *top, BasicBlock *bottom) {
+  DomTreeNode *top_node = DT->getNode(top);
+  SmallVector<DomTreeNode *, 4> children(top_node->begin(), top_node->end());
+  DomTreeNode *bottom_node = DT->addNewBlock(bottom, top);
+  for (DomTreeNode *child : children)
+    DT->changeImmediateDominator(child, bottom_node);
+}
+
 // Branch over the block's content with the condition cond.
 // All values used outside the block is replaced by a phi.
 //
-static void SkipBlockWithBranch(BasicBlock *bb, Value *cond, Loop *L, LoopInfo *LI) {
+static void SkipBlockWithBranch(BasicBlock *bb, Value *cond, Loop *L, LoopInfo *LI, DominatorTree *DT) {
   BasicBlock *body = bb->splitBasicBlock(bb->getFirstNonPHI());
   body->setName("dx.struct_exit.cond_body");
   BasicBlock *end = body->splitBasicBlock(body->getTerminator());
@@ -329,6 +340,9 @@ static void SkipBlockWithBranch(BasicBlock *bb, Value *cond, Loop *L, LoopInfo *
 
   L->addBasicBlockToLoop(body, *LI);
   L->addBasicBlockToLoop(end, *LI);
+
+  UpdateDomTreeForSplit(DT, bb, end);
+  DT->addNewBlock(body, bb);
 }
 
 static unsigned GetNumPredecessors(BasicBlock *bb) {
@@ -405,13 +419,18 @@ static bool RemoveUnstructuredLoopExitsIteration(BasicBlock *exiting_block, Loop
   new_exiting_block = prop.Run(exit_values, exiting_block, latch, DT, L, LI, blocks_with_side_effect);
 
   // Stop now if we failed
-  if (!new_exiting_block)
+  if (!new_exiting_block) {
+    if (Instruction *not_inst = dyn_cast<Instruction>(exit_cond)) {
+      if (not_inst != exiting_br->getCondition() && not_inst->use_empty())
+        not_inst->eraseFromParent();
+    }
     return false;
+  }
 
   // If there are any blocks with side effects,
   for (BasicBlock *bb : blocks_with_side_effect) {
     Value *exit_cond_for_block = prop.Get(exit_cond, bb);
-    SkipBlockWithBranch(bb, exit_cond_for_block, L, LI);
+    SkipBlockWithBranch(bb, exit_cond_for_block, L, LI, DT);
   }
 
   // Make the exiting block not exit.
@@ -431,6 +450,7 @@ static bool RemoveUnstructuredLoopExitsIteration(BasicBlock *exiting_block, Loop
   new_exiting_block->setName("dx.struct_exit.new_exiting");
   new_not_exiting_block->setName(old_name);
   L->addBasicBlockToLoop(new_not_exiting_block, *LI);
+  UpdateDomTreeForSplit(DT, new_exiting_block, new_not_exiting_block);
 
   // Branch to latch_exit
   new_exiting_block->getTerminator()->eraseFromParent();
@@ -457,6 +477,7 @@ static bool RemoveUnstructuredLoopExitsIteration(BasicBlock *exiting_block, Loop
 
     // 1. Split the latch exit, since it's going to branch to the real exit block
     BasicBlock *post_exit_location = latch_exit->splitBasicBlock(latch_exit->getFirstNonPHI());
+    UpdateDomTreeForSplit(DT, latch_exit, post_exit_location);
 
     {
       // If latch exit is part of an outer loop, add its split in there too.
@@ -524,9 +545,10 @@ static bool RemoveUnstructuredLoopExitsIteration(BasicBlock *exiting_block, Loop
     BranchInst::Create(exit_block, post_exit_location, exit_cond_lcssa, latch_exit);
   }
 
-  DT->recalculate(*L->getHeader()->getParent());
-  assert(L->isLCSSAForm(*DT));
-
+  // The dominator tree is only kept up to date for blocks in the loop, which
+  // is all that the later iterations ask about: the edges that were removed
+  // or added all leave the loop, and every path into the loop still goes
+  // through the header. The whole tree is recalculated once the loop is done.
   return true;
 }
 
@@ -547,6 +569,10 @@ bool hlsl::RemoveUnstructuredLoopExits(llvm::Loop *L, llvm::LoopInfo *LI, llvm::
     return false;
   }
 
+  // Exiting blocks that could not be moved. Failures come from inner loops
+  // in the way, which later iterations do not remove, so don't try again.
+  std::unordered_set<BasicBlock *> failed_exiting_blocks;
+
   for (;;) {
     // Recompute exiting block every time, since they could change between
     // iterations
@@ -562,12 +588,16 @@ bool hlsl::RemoveUnstructuredLoopExits(llvm::Loop *L, llvm::LoopInfo *LI, llvm::
       if (exclude_set && exclude_set->count(GetExitBlockForExitingBlock(L, exiting_block)))
         continue;
 
+      if (failed_exiting_blocks.count(exiting_block))
+        continue;
+
       // As soon as we got a success, break and start a new iteration, since
       // exiting blocks could have changed.
       local_changed = RemoveUnstructuredLoopExitsIteration(exiting_block, L, LI, DT);
       if (local_changed) {
         break;
       }
+      failed_exiting_blocks.insert(exiting_block);
     }
 
     changed |= local_changed;
@@ -576,6 +606,11 @@ bool hlsl::RemoveUnstructuredLoopExits(llvm::Loop *L, llvm::LoopInfo *LI, llvm::
     }
   }
 
+  if (changed) {
+    DT->recalculate(*L->getHeader()->getParent());
+    assert(L->isLCSSAForm(*DT));
+  }
+
   return changed;
 }
 
@@ -21,6 +21,10 @@
 // a dxil backend compiler to generate more efficent code than a local array.
 // For example, it could use an immediate constant pool to represent the array.
 //
+// Multi-dimensional arrays are hoisted too. They are only flattened late in
+// the pipeline, and would otherwise stay in local memory as indexable
+// temporaries.
+//
 // We limit hoisting to those arrays that are initialized by constant values.
 // We still hoist if the array is partially initialized as long as no
 // non-constant values are written. The uninitialized values will be hoisted 
@@ -128,6 +132,9 @@ namespace {
     std::vector<Constant *> m_Values;
     bool m_IsConstArray;
 
+    Type *m_ElementType;
+    uint64_t m_NumElements;
+
     bool AnalyzeStore(StoreInst *SI);
     bool StoreConstant(int64_t index, Constant *value);
     void EnsureSize();
@@ -136,6 +143,7 @@ namespace {
     bool AllArrayUsersAreGEPOrLifetime(std::vector<GEPOperator *> &geps);
     bool AllGEPUsersAreValid(GEPOperator *gep);
     UndefValue *UndefElement();
+    Constant *GetInitializer(Type *Ty, size_t &index) const;
   };
 }
 
@@ -145,8 +153,21 @@ static ArrayType *getAllocaArrayType(AllocaInst *allocaInst) {
   return dyn_cast<ArrayType>(allocaInst->getType()->getPointerElementType());
 }
 
+// Returns the number of innermost elements in Ty, looking through nested
+// arrays, and sets EltTy to the type of those elements.
+static uint64_t getFlattenedSize(Type *Ty, Type *&EltTy) {
+  uint64_t size = 1;
+  while (ArrayType *arrayTy = dyn_cast<ArrayType>(Ty)) {
+    size *= arrayTy->getNumElements();
+    Ty = arrayTy->getElementType();
+  }
+  EltTy = Ty;
+  return size;
+}
+
 // Check if the instruction is an alloca that we should consider for hoisting.
-// The alloca must allocate and array of primitive types.
+// The alloca must allocate an array, possibly multi-dimensional, of
+// primitive types.
 static AllocaInst *isHoistableArrayAlloca(Instruction *I) {
   AllocaInst *allocaInst = dyn_cast<AllocaInst>(I);
   if (!allocaInst)
@@ -156,7 +177,9 @@ static AllocaInst *isHoistableArrayAlloca(Instruction *I) {
   if (!arrayTy)
     return nullptr;
 
-  if (!arrayTy->getElementType()->isSingleValueType())
+  Type *eltTy = nullptr;
+  getFlattenedSize(arrayTy, eltTy);
+  if (!eltTy->isSingleValueType())
     return nullptr;
 
   return allocaInst;
@@ -174,19 +197,35 @@ CandidateArray::CandidateArray(AllocaInst *AI)
 {
   assert(isHoistableArrayAlloca(AI));
   m_ArrayType = getAllocaArrayType(AI);
+  m_NumElements = getFlattenedSize(m_ArrayType, m_ElementType);
 }
 
 // Get the global variable with a constant initializer for the array.
 // Only valid to call if the array has been analyzed as a constant array.
 GlobalVariable *CandidateArray::GetGlobalArray() const {
   assert(IsConstArray());
-  Constant *initializer = ConstantArray::get(m_ArrayType, m_Values);
+  size_t index = 0;
+  Constant *initializer = GetInitializer(m_ArrayType, index);
+  assert(index == m_Values.size());
   Module *M = m_Alloca->getModule();
   GlobalVariable *GV = new GlobalVariable(*M, m_ArrayType, true, GlobalVariable::LinkageTypes::InternalLinkage, initializer, Twine(m_Alloca->getName()) + ".hca");
   GV->setUnnamedAddr(true);
   return GV;
 }
 
+// Build the initializer for Ty from the flattened values, starting at index.
+Constant *CandidateArray::GetInitializer(Type *Ty, size_t &index) const {
+  ArrayType *arrayTy = dyn_cast<ArrayType>(Ty);
+  if (!arrayTy)
+    return m_Values[index++];
+
+  std::vector<Constant *> elements;
+  elements.reserve(arrayTy->getNumElements());
+  for (uint64_t i = 0, e = arrayTy->getNumElements(); i != e; ++i)
+    elements.push_back(GetInitializer(arrayTy->getElementType(), index));
+  return ConstantArray::get(arrayTy, elements);
+}
+
 // Get a list of all the stores that write to the array through one or more
 // GetElementPtrInst operations.
 std::vector<StoreInst *> CandidateArray::GetArrayStores() const {
@@ -278,7 +317,11 @@ void CandidateArray::AnalyzeUses() {
 bool CandidateArray::AnalyzeStore(StoreInst *SI) {
   if (!isa<Constant>(SI->getValueOperand()))
     return false;
+  // Only stores of whole elements are tracked.
+  if (SI->getValueOperand()->getType() != m_ElementType)
+    return false;
   // Walk up the ladder of GetElementPtr instructions to accumulate the index
+  // into the flattened array.
   int64_t index = 0;
   for (auto iter = SI->getPointerOperand(); iter != m_Alloca;) {
     GEPOperator *gep = cast<GEPOperator>(iter);
@@ -287,24 +330,34 @@ bool CandidateArray::AnalyzeStore(StoreInst *SI) {
 
     // Deal with the 'extra 0' index from what might have been a global pointer
     // https://www.llvm.org/docs/GetElementPtr.html#why-is-the-extra-0-index-required
-    if ((gep->getNumIndices() == 2) && (gep->getPointerOperand() == m_Alloca)) {
+    if (gep->getPointerOperand() == m_Alloca) {
       // Non-zero offset is unexpected, but could occur in the wild. Bail out if
       // we see it.
       ConstantInt *ptrOffset = cast<ConstantInt>(gep->getOperand(1));
       if (!ptrOffset->isZero())
         return false;
     }
-    else if (gep->getNumIndices() != 1) {
-      return false;
-    }
 
-    // Accumulate the index
-    ConstantInt *c = cast<ConstantInt>(gep->getOperand(gep->getNumIndices()));
-    index += c->getSExtValue();
+    // Accumulate the index. The first index steps over whole pointees, and
+    // each later one over the elements of the array it indexes into.
+    Type *Ty = gep->getPointerOperandType()->getPointerElementType();
+    Type *EltTy = nullptr;
+    for (unsigned i = 1, e = gep->getNumOperands(); i != e; ++i) {
+      if (i > 1) {
+        ArrayType *arrayTy = dyn_cast<ArrayType>(Ty);
+        if (!arrayTy)
+          return false;
+        Ty = arrayTy->getElementType();
+      }
+      ConstantInt *c = cast<ConstantInt>(gep->getOperand(i));
+      index += c->getSExtValue() * (int64_t)getFlattenedSize(Ty, EltTy);
+    }
 
     iter = gep->getPointerOperand();
   }
 
+  if (index < 0)
+    return false;
   return StoreConstant(index, cast<Constant>(SI->getValueOperand()));
 }
 
@@ -328,14 +381,14 @@ bool CandidateArray::StoreConstant(int64_t index, Constant *value) {
 // for obviously non-constant arrays.
 void CandidateArray::EnsureSize() {
   if (m_Values.size() == 0) {
-    m_Values.resize(m_ArrayType->getNumElements(), UndefElement());
+    m_Values.resize(m_NumElements, UndefElement());
   }
-  assert(m_Values.size() == m_ArrayType->getNumElements());
+  assert(m_Values.size() == m_NumElements);
 }
 
 // Get an undef value of the correct type for the array.
 UndefValue *CandidateArray::UndefElement() {
-  return UndefValue::get(m_ArrayType->getElementType());
+  return UndefValue::get(m_ElementType);
 }
 
 
@@ -128,15 +128,8 @@ bool LowerTypePass::runOnFunction(Function &F, bool HasDbgInfo) {
 
 bool LowerTypePass::runOnModule(Module &M) {
   initialize(M);
-  // Load up debug information, to cross-reference values and the instructions
-  // used to load them.
   bool HasDbgInfo = llvm::hasDebugInfo(M);
-  llvm::DebugInfoFinder Finder;
-  if (HasDbgInfo) {
-    Finder.processModule(M);
-  }
 
-  std::vector<AllocaInst*> multiDimAllocas;
   for (Function &F : M.functions()) {
     if (F.isDeclaration())
       continue;
@@ -152,6 +145,17 @@ bool LowerTypePass::runOnModule(Module &M) {
     }
   }
 
+  // HLSL Change Begin - Only load up debug information, to cross-reference
+  // globals and their debug info, when some global is lowered; walking the
+  // whole module for it dominates these passes when nothing needs lowering.
+  if (vecGVs.empty())
+    return true; // Lowering allocas and checking candidates change the IR.
+  llvm::DebugInfoFinder Finder;
+  if (HasDbgInfo) {
+    Finder.processModule(M);
+  }
+  // HLSL Change End
+
   for (GlobalVariable *GV : vecGVs) {
     GlobalVariable *NewGV = lowerInternalGlobal(GV);
     // Add debug info.
@@ -1694,6 +1694,56 @@ bool isGroupShareOrConstStaticArray(GlobalVariable *GV) {
   return Ty->isArrayTy();
 }
 
+// Work list of allocas and static globals for SROAGlobalAndAllocas. Each value
+// is pushed once, either initially or as an element of the aggregate it was
+// split from, and popped once, so every aggregate is visited a bounded number
+// of times no matter how deep its type nests.
+class SROAWorkList {
+public:
+  SROAWorkList(const DataLayout &DL) : DL(DL) {}
+
+  void push(Value *V) {
+    Type *Ty = V->getType()->getPointerElementType();
+    Item I;
+    I.V = V;
+    I.Size = DL.getTypeAllocSize(Ty);
+    I.IsUnitSzStruct = Ty->isStructTy() && Ty->getStructNumElements() == 1;
+    I.NestedLevel = getNestedLevelInStruct(Ty);
+    Queue.push(I);
+  }
+
+  Value *pop() {
+    Value *V = Queue.top().V;
+    Queue.pop();
+    return V;
+  }
+
+  bool empty() const { return Queue.empty(); }
+
+private:
+  struct Item {
+    Value *V;
+    uint64_t Size;
+    unsigned NestedLevel;
+    bool IsUnitSzStruct;
+  };
+  // Make sure big alloca split first.
+  // This will simplify memcpy check between part of big alloca and small
+  // alloca. Big alloca will be split to smaller piece first, when process the
+  // alloca, it will be alloca flattened from big alloca instead of a GEP of
+  // big alloca.
+  struct SizeCmp {
+    bool operator()(const Item &a0, const Item &a1) const {
+      if (a0.Size == a1.Size && (a0.IsUnitSzStruct || a1.IsUnitSzStruct))
+        return a0.NestedLevel < a1.NestedLevel;
+      return a0.Size < a1.Size;
+    }
+  };
+
+  const DataLayout &DL;
+  std::priority_queue<Item, std::vector<Item>, SizeCmp> Queue;
+};
+
 bool SROAGlobalAndAllocas(HLModule &HLM, bool bHasDbgInfo) {
   Module &M = *HLM.GetModule();
   DxilTypeSystem &typeSys = HLM.GetTypeSystem();
@@ -1704,23 +1754,10 @@ bool SROAGlobalAndAllocas(HLModule &HLM, bool bHasDbgInfo) {
   // alloca. Big alloca will be split to smaller piece first, when process the
   // alloca, it will be alloca flattened from big alloca instead of a GEP of
   // big alloca.
-  auto size_cmp = [&DL](const Value *a0, const Value *a1) -> bool {
-    Type *a0ty = a0->getType()->getPointerElementType();
-    Type *a1ty = a1->getType()->getPointerElementType();
-    bool isUnitSzStruct0 =
-        a0ty->isStructTy() && a0ty->getStructNumElements() == 1;
-    bool isUnitSzStruct1 =
-        a1ty->isStructTy() && a1ty->getStructNumElements() == 1;
-    auto sz0 = DL.getTypeAllocSize(a0ty);
-    auto sz1 = DL.getTypeAllocSize(a1ty);
-    if (sz0 == sz1 && (isUnitSzStruct0 || isUnitSzStruct1))
-      return getNestedLevelInStruct(a0ty) < getNestedLevelInStruct(a1ty);
-    return sz0 < sz1;
-  };
-
-  std::priority_queue<Value *, std::vector<Value *>,
-                      std::function<bool(Value *, Value *)>>
-      WorkList(size_cmp);
+  // The order key of each value is computed once when it is pushed, since the
+  // queue compares entries O(log n) times per push and pop, and large struct
+  // arrays add thousands of elements.
+  SROAWorkList WorkList(DL);
 
   // Flatten internal global.
   llvm::SetVector<GlobalVariable *> staticGVs;
@@ -1776,8 +1813,7 @@ bool SROAGlobalAndAllocas(HLModule &HLM, bool bHasDbgInfo) {
 
   bool Changed = false;
   while (!WorkList.empty()) {
-    Value *V = WorkList.top();
-    WorkList.pop();
+    Value *V = WorkList.pop();
 
     if (AllocaInst *AI = dyn_cast<AllocaInst>(V)) {
       // Handle dead allocas trivially.  These can be formed by SROA'ing arrays
@@ -3766,118 +3802,122 @@ bool SROA_Helper::LowerMemcpy(Value *V, DxilFieldAnnotation *annotation,
   if (!Ty->isPointerTy()) {
     return false;
   }
-  // Get access status and collect memcpy uses.
-  // if MemcpyOnce, replace with dest with src if dest is not out param.
-  // else flat memcpy.
-  unsigned size = DL.getTypeAllocSize(Ty->getPointerElementType());
-  hlutil::PointerStatus PS(V, size, /*bLdStOnly*/ false);
-  const bool bStructElt = false;
-  PS.analyze(typeSys, bStructElt);
-
-  if (GlobalVariable *GV = dyn_cast<GlobalVariable>(V)) {
-    if (GV->hasInitializer() && !isa<UndefValue>(GV->getInitializer())) {
-      if (PS.storedType == hlutil::PointerStatus::StoredType::NotStored) {
-        PS.storedType = hlutil::PointerStatus::StoredType::InitializerStored;
-      } else if (PS.storedType ==
-                 hlutil::PointerStatus::StoredType::MemcopyDestOnce) {
-        // For single mem store, if the store does not dominate all users.
-        // Mark it as Stored.
-        // In cases like:
-        // struct A { float4 x[25]; };
-        // A a;
-        // static A a2;
-        // void set(A aa) { aa = a; }
-        // call set inside entry function then use a2.
-        if (isa<ConstantAggregateZero>(GV->getInitializer())) {
-          Instruction * Memcpy = PS.StoringMemcpy;
-          if (!ReplaceUseOfZeroInitBeforeDef(Memcpy, GV)) {
-            PS.storedType = hlutil::PointerStatus::StoredType::Stored;
+  // Each replaced memcpy is removed from V's users, so V is re-analyzed at most
+  // once per memcpy it started with.
+  for (;;) {
+    // Get access status and collect memcpy uses.
+    // if MemcpyOnce, replace with dest with src if dest is not out param.
+    // else flat memcpy.
+    unsigned size = DL.getTypeAllocSize(Ty->getPointerElementType());
+    hlutil::PointerStatus PS(V, size, /*bLdStOnly*/ false);
+    const bool bStructElt = false;
+    PS.analyze(typeSys, bStructElt);
+
+    if (GlobalVariable *GV = dyn_cast<GlobalVariable>(V)) {
+      if (GV->hasInitializer() && !isa<UndefValue>(GV->getInitializer())) {
+        if (PS.storedType == hlutil::PointerStatus::StoredType::NotStored) {
+          PS.storedType = hlutil::PointerStatus::StoredType::InitializerStored;
+        } else if (PS.storedType ==
+                   hlutil::PointerStatus::StoredType::MemcopyDestOnce) {
+          // For single mem store, if the store does not dominate all users.
+          // Mark it as Stored.
+          // In cases like:
+          // struct A { float4 x[25]; };
+          // A a;
+          // static A a2;
+          // void set(A aa) { aa = a; }
+          // call set inside entry function then use a2.
+          if (isa<ConstantAggregateZero>(GV->getInitializer())) {
+            Instruction * Memcpy = PS.StoringMemcpy;
+            if (!ReplaceUseOfZeroInitBeforeDef(Memcpy, GV)) {
+              PS.storedType = hlutil::PointerStatus::StoredType::Stored;
+            }
           }
+        } else {
+          PS.storedType = hlutil::PointerStatus::StoredType::Stored;
         }
-      } else {
-        PS.storedType = hlutil::PointerStatus::StoredType::Stored;
       }
     }
-  }
-
-  if (bAllowReplace && !PS.HasMultipleAccessingFunctions) {
-    if (PS.storedType == hlutil::PointerStatus::StoredType::MemcopyDestOnce &&
-        // Skip argument for input argument has input value, it is not dest once anymore.
-        !isa<Argument>(V)) {
-      // Replace with src of memcpy.
-      MemCpyInst *MC = PS.StoringMemcpy;
-      if (MC->getSourceAddressSpace() == MC->getDestAddressSpace()) {
-        Value *Src = MC->getOperand(1);
-        // Only remove one level bitcast generated from inline.
-        if (BitCastOperator *BC = dyn_cast<BitCastOperator>(Src))
-          Src = BC->getOperand(0);
-
-        if (GEPOperator *GEP = dyn_cast<GEPOperator>(Src)) {
-          // For GEP, the ptr could have other GEP read/write.
-          // Only scan one GEP is not enough.
-          Value *Ptr = GEP->getPointerOperand();
-          while (GEPOperator *NestedGEP = dyn_cast<GEPOperator>(Ptr))
-            Ptr = NestedGEP->getPointerOperand();
 
-          if (CallInst *PtrCI = dyn_cast<CallInst>(Ptr)) {
-            if (isReadOnlyResSubscriptOrLoad(PtrCI)) {
-              // Ptr from CBuffer/SRV is safe.
+    if (bAllowReplace && !PS.HasMultipleAccessingFunctions) {
+      if (PS.storedType == hlutil::PointerStatus::StoredType::MemcopyDestOnce &&
+          // Skip argument for input argument has input value, it is not dest once anymore.
+          !isa<Argument>(V)) {
+        // Replace with src of memcpy.
+        MemCpyInst *MC = PS.StoringMemcpy;
+        if (MC->getSourceAddressSpace() == MC->getDestAddressSpace()) {
+          Value *Src = MC->getOperand(1);
+          // Only remove one level bitcast generated from inline.
+          if (BitCastOperator *BC = dyn_cast<BitCastOperator>(Src))
+            Src = BC->getOperand(0);
+
+          if (GEPOperator *GEP = dyn_cast<GEPOperator>(Src)) {
+            // For GEP, the ptr could have other GEP read/write.
+            // Only scan one GEP is not enough.
+            Value *Ptr = GEP->getPointerOperand();
+            while (GEPOperator *NestedGEP = dyn_cast<GEPOperator>(Ptr))
+              Ptr = NestedGEP->getPointerOperand();
+
+            if (CallInst *PtrCI = dyn_cast<CallInst>(Ptr)) {
+              if (isReadOnlyResSubscriptOrLoad(PtrCI)) {
+                // Ptr from CBuffer/SRV is safe.
+                if (ReplaceMemcpy(V, Src, MC, annotation, typeSys, DL, DT)) {
+                  if (V->user_empty())
+                    return true;
+                  continue;
+                }
+              }
+            }
+          } else if (!isa<CallInst>(Src)) {
+            // Resource ptr should not be replaced.
+            // Need to make sure src not updated after current memcpy.
+            // Check Src only have 1 store now.
+            hlutil::PointerStatus SrcPS(Src, size, /*bLdStOnly*/ false);
+            SrcPS.analyze(typeSys, bStructElt);
+            if (SrcPS.storedType != hlutil::PointerStatus::StoredType::Stored) {
               if (ReplaceMemcpy(V, Src, MC, annotation, typeSys, DL, DT)) {
                 if (V->user_empty())
                   return true;
-                return LowerMemcpy(V, annotation, typeSys, DL, DT, bAllowReplace);
+                continue;
               }
             }
           }
-        } else if (!isa<CallInst>(Src)) {
-          // Resource ptr should not be replaced.
-          // Need to make sure src not updated after current memcpy.
-          // Check Src only have 1 store now.
-          hlutil::PointerStatus SrcPS(Src, size, /*bLdStOnly*/ false);
-          SrcPS.analyze(typeSys, bStructElt);
-          if (SrcPS.storedType != hlutil::PointerStatus::StoredType::Stored) {
-            if (ReplaceMemcpy(V, Src, MC, annotation, typeSys, DL, DT)) {
-              if (V->user_empty())
-                return true;
-              return LowerMemcpy(V, annotation, typeSys, DL, DT, bAllowReplace);
-            }
-          }
         }
-      }
-    } else if (PS.loadedType ==
-               hlutil::PointerStatus::LoadedType::MemcopySrcOnce) {
-      // Replace dst of memcpy.
-      MemCpyInst *MC = PS.LoadingMemcpy;
-      if (MC->getSourceAddressSpace() == MC->getDestAddressSpace()) {
-        Value *Dest = MC->getOperand(0);
-        // Only remove one level bitcast generated from inline.
-        if (BitCastOperator *BC = dyn_cast<BitCastOperator>(Dest))
-          Dest = BC->getOperand(0);
-        // For GEP, the ptr could have other GEP read/write.
-        // Only scan one GEP is not enough.
-        // And resource ptr should not be replaced.
-        if (!isa<GEPOperator>(Dest) && !isa<CallInst>(Dest) &&
-            !isa<BitCastOperator>(Dest)) {
-          // Need to make sure Dest not updated after current memcpy.
-          // Check Dest only have 1 store now.
-          hlutil::PointerStatus DestPS(Dest, size, /*bLdStOnly*/ false);
-          DestPS.analyze(typeSys, bStructElt);
-          if (DestPS.storedType != hlutil::PointerStatus::StoredType::Stored) {
-            if (ReplaceMemcpy(Dest, V, MC, annotation, typeSys, DL, DT)) {
-              // V still needs to be flattened.
-              // Lower memcpy come from Dest.
-              return LowerMemcpy(V, annotation, typeSys, DL, DT, bAllowReplace);
+      } else if (PS.loadedType ==
+                 hlutil::PointerStatus::LoadedType::MemcopySrcOnce) {
+        // Replace dst of memcpy.
+        MemCpyInst *MC = PS.LoadingMemcpy;
+        if (MC->getSourceAddressSpace() == MC->getDestAddressSpace()) {
+          Value *Dest = MC->getOperand(0);
+          // Only remove one level bitcast generated from inline.
+          if (BitCastOperator *BC = dyn_cast<BitCastOperator>(Dest))
+            Dest = BC->getOperand(0);
+          // For GEP, the ptr could have other GEP read/write.
+          // Only scan one GEP is not enough.
+          // And resource ptr should not be replaced.
+          if (!isa<GEPOperator>(Dest) && !isa<CallInst>(Dest) &&
+              !isa<BitCastOperator>(Dest)) {
+            // Need to make sure Dest not updated after current memcpy.
+            // Check Dest only have 1 store now.
+            hlutil::PointerStatus DestPS(Dest, size, /*bLdStOnly*/ false);
+            DestPS.analyze(typeSys, bStructElt);
+            if (DestPS.storedType != hlutil::PointerStatus::StoredType::Stored) {
+              if (ReplaceMemcpy(Dest, V, MC, annotation, typeSys, DL, DT)) {
+                // V still needs to be flattened.
+                // Lower memcpy come from Dest.
+                continue;
+              }
             }
           }
         }
       }
     }
-  }
 
-  for (MemCpyInst *MC : PS.memcpySet) {
-    MemcpySplitter::SplitMemCpy(MC, DL, annotation, typeSys);
+    for (MemCpyInst *MC : PS.memcpySet) {
+      MemcpySplitter::SplitMemCpy(MC, DL, annotation, typeSys);
+    }
+    return false;
   }
-  return false;
 }
 
 /// MarkEmptyStructUsers - Add instruction related to Empty struct to DeadInsts.
@@ -33,6 +33,14 @@ Module *llvm::CloneModule(const Module *M) {
 }
 
 Module *llvm::CloneModule(const Module *M, ValueToValueMapTy &VMap) {
+  // HLSL Change - forward to the filtering overload.
+  return CloneModule(M, VMap, [](const Function *) { return true; });
+}
+
+// HLSL Change - add ShouldCloneDefinition.
+Module *llvm::CloneModule(
+    const Module *M, ValueToValueMapTy &VMap,
+    function_ref<bool(const Function *)> ShouldCloneDefinition) {
   // First off, we need to create the new module.
   Module *New = new Module(M->getModuleIdentifier(), M->getContext());
   New->setDataLayout(M->getDataLayout());
@@ -89,6 +97,12 @@ Module *llvm::CloneModule(const Module *M, ValueToValueMapTy &VMap) {
   //
   for (Module::const_iterator I = M->begin(), E = M->end(); I != E; ++I) {
     Function *F = cast<Function>(VMap[I]);
+    // HLSL Change Starts - leave skipped definitions as declarations.
+    if (!I->isDeclaration() && !ShouldCloneDefinition(I)) {
+      F->setLinkage(GlobalValue::ExternalLinkage);
+      continue;
+    }
+    // HLSL Change Ends
     if (!I->isDeclaration()) {
       Function::arg_iterator DestI = F->arg_begin();
       for (Function::const_arg_iterator J = I->arg_begin(); J != I->arg_end();
@@ -100,6 +114,12 @@ Module *llvm::CloneModule(const Module *M, ValueToValueMapTy &VMap) {
       SmallVector<ReturnInst*, 8> Returns;  // Ignore returns cloned.
       CloneFunctionInto(F, I, VMap, /*ModuleLevelChanges=*/true, Returns);
 
+      // HLSL Change Begin - keep metadata attached to the function itself.
+      SmallVector<std::pair<unsigned, MDNode *>, 1> MDs;
+      I->getAllMetadata(MDs);
+      for (auto &MD : MDs)
+        F->setMetadata(MD.first, MapMetadata(MD.second, VMap));
+      // HLSL Change End
     }
 
     if (I->hasPersonalityFn())
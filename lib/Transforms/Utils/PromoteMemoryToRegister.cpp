@@ -48,6 +48,12 @@ STATISTIC(NumSingleStore,   "Number of alloca's promoted with a single store");
 STATISTIC(NumDeadAlloca,    "Number of dead alloca's removed");
 STATISTIC(NumPHIInsert,     "Number of PHI nodes inserted");
 
+// HLSL Change Begin
+/// Number of allocas needing phi placement in one function after which the
+/// dominance frontiers are computed once and shared by the rest.
+static const unsigned IDFFrontiersMinAllocas = 16;
+// HLSL Change End
+
 bool llvm::isAllocaPromotable(const AllocaInst *AI) {
   // FIXME: If the memory unit is of pointer or integer type, we can permit
   // assignments to subsections of the memory unit.
@@ -553,6 +559,7 @@ void PromoteMem2Reg::run() {
   AllocaInfo Info;
   LargeBlockInfo LBI;
   IDFCalculator IDF(DT);
+  unsigned NumIDFAllocas = 0; // HLSL Change
 
   for (unsigned AllocaNum = 0; AllocaNum != Allocas.size(); ++AllocaNum) {
     AllocaInst *AI = Allocas[AllocaNum];
@@ -654,6 +661,12 @@ void PromoteMem2Reg::run() {
     // the standard SSA construction algorithm.  Determine which blocks need phi
     // nodes and see if we can optimize out some work by avoiding insertion of
     // dead phi nodes.
+    // HLSL Change Begin - Fully inlined shaders can leave thousands of such
+    // allocas in one large function; past a few, share one computation of
+    // the dominance frontiers between them.
+    if (++NumIDFAllocas == IDFFrontiersMinAllocas)
+      IDF.computeFrontiers();
+    // HLSL Change End
     IDF.setLiveInBlocks(LiveInBlocks);
     IDF.setDefiningBlocks(DefBlocks);
     SmallVector<BasicBlock *, 32> PHIBlocks;
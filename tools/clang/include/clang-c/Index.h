@@ -1397,7 +1397,16 @@ enum CXReparse_Flags {
   /**
    * \brief Used to indicate that no special reparsing options are needed.
    */
-  CXReparse_None = 0x0
+  CXReparse_None = 0x0,
+
+  // HLSL Change Starts
+  /**
+   * \brief Used to indicate that the bodies of functions outside the main
+   * file should be skipped, unless the contents of their file changed since
+   * the last parse.
+   */
+  CXReparse_SkipIncludedFunctionBodies = 0x1
+  // HLSL Change Ends
 };
  
 /**
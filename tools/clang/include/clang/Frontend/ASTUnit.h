@@ -192,9 +192,19 @@ private:
   /// some number of calls.
   unsigned PreambleRebuildCounter;
 
+  // HLSL Change Starts
+  /// \brief Whether the current parse skips the bodies of functions in
+  /// included files whose contents did not change since the last parse.
+  bool SkipIncludedFunctionBodies;
+  // HLSL Change Ends
+
 public:
   hlsl::DxcLangExtensionsHelperApply *HlslLangExtensions; // HLSL Change
 
+  /// \brief Whether the body of \p D can be skipped by the current
+  /// parse. // HLSL Change
+  bool shouldSkipFunctionBody(Decl *D);
+
   class PreambleData {
     const FileEntry *File;
     std::vector<char> Buffer;
@@ -281,6 +291,21 @@ private:
   /// the preamble must be thrown away.
   llvm::StringMap<PreambleFileHash> FilesInPreamble;
 
+  // HLSL Change Starts
+  /// \brief The size and MD5 of each file included by the last parse, on
+  /// disk or remapped, to tell which ones the next parse finds unchanged.
+  llvm::StringMap<PreambleFileHash> IncludedFileHashes;
+
+  /// \brief Whether each included file of the current parse is unchanged
+  /// since the last one, once looked up.
+  llvm::DenseMap<const FileEntry *, bool> UnchangedIncludedFiles;
+
+  bool isUnchangedIncludedFile(const FileEntry *File);
+  void recordIncludedFileHashes();
+  void restoreSkippedBodyDiagnostics(
+      const SmallVectorImpl<StandaloneDiagnostic> &Diags);
+  // HLSL Change Ends
+
   /// \brief When non-NULL, this is the buffer used to store the contents of
   /// the main file when it has been padded for use with the precompiled
   /// preamble.
@@ -868,10 +893,17 @@ public:
   /// \brief Reparse the source files using the same command-line options that
   /// were originally used to produce this translation unit.
   ///
+  /// If \p SkipIncludedFunctionBodies is set, the bodies of functions in
+  /// files other than the main file are skipped when the file, remapped or
+  /// on disk, has the same contents as in the previous parse. Declarations
+  /// from included files stay available, and the diagnostics the previous
+  /// parse reported in the skipped bodies are kept. // HLSL Change
+  ///
   /// \returns True if a failure occurred that causes the ASTUnit not to
   /// contain any translation-unit information, false otherwise.
   bool Reparse(std::shared_ptr<PCHContainerOperations> PCHContainerOps,
-               ArrayRef<RemappedFile> RemappedFiles = None);
+               ArrayRef<RemappedFile> RemappedFiles = None,
+               bool SkipIncludedFunctionBodies = false); // HLSL Change
 
   /// \brief Perform code completion at the given file, line, and
   /// column within this translation unit.
@@ -24,6 +24,11 @@
 #include "dxc/HLSL/HLSLExtensionsCodegenHelper.h" // HLSL change
 #include "dxc/Support/SPIRVOptions.h" // SPIR-V Change
 #include "dxc/DxcBindingTable/DxcBindingTable.h" // HLSL chanhge
+#include <functional> // HLSL change
+
+namespace llvm {
+class Module; // HLSL change
+}
 
 namespace clang {
 
@@ -231,9 +236,19 @@ public:
   bool HLSLResMayAlias = false;
   /// Lookback scan limit for memory dependencies
   unsigned ScanLimit = 0;
+  /// Instructions [unroll] may clone per function and per module, and the
+  /// milliseconds it may take. Zero means unlimited.
+  unsigned HLSLUnrollMaxFunctionInstructions = 0;
+  unsigned HLSLUnrollMaxModuleInstructions = 0;
+  unsigned HLSLUnrollTimeLimit = 0;
+  /// Estimated live 32-bit values above which hoisting stops and cheap
+  /// values are rematerialized. Zero means unlimited.
+  unsigned HLSLMaxRegisterPressure = 0;
   // Optimization pass enables, disables and selects
   std::map<std::string, bool> HLSLOptimizationToggles;
   std::map<std::string, std::string> HLSLOptimizationSelects;
+  /// Constant buffer fields fixed at compile time, as <cbuffer>.<field> -> value
+  std::map<std::string, std::string> HLSLSpecializedCBufferValues;
   /// Debug option to print IR after every pass
   bool HLSLPrintAfterAll = false;
   /// Debug option to print IR after specific pass
@@ -254,6 +269,19 @@ public:
     virtual bool Parse(llvm::raw_ostream &os, hlsl::DxcBindingTable *outBindingTable) = 0;
   };
   std::shared_ptr<BindingTableParserType> BindingTableParser;
+  /// Runs the backend in place of EmitBackendOutput, e.g. one library export
+  /// at a time. EmitBackend runs the usual backend on a module of the same
+  /// context, and reports its diagnostics only when asked to. A module
+  /// returned by Run replaces the one that was passed in.
+  struct BackendRunnerType {
+    virtual ~BackendRunnerType() {};
+    virtual std::unique_ptr<llvm::Module>
+    Run(llvm::Module *M,
+        const std::function<void(llvm::Module *, bool)> &EmitBackend) = 0;
+  };
+  std::shared_ptr<BackendRunnerType> HLSLBackendRunner;
+  /// Execution counts by source file and line, loaded from -fprofile-use.
+  std::map<std::string, std::map<unsigned, uint64_t>> HLSLBlockProfile;
   // HLSL Change Ends
 
   // SPIRV Change Starts
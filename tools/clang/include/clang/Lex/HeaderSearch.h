@@ -253,6 +253,7 @@ class HeaderSearch {
   // Various statistics we track for performance analysis.
   unsigned NumIncluded;
   unsigned NumMultiIncludeFileOptzn;
+  unsigned NumSkippedIncludes; // HLSL Change
   unsigned NumFrameworkLookups, NumSubFrameworkLookups;
 
   const LangOptions &LangOpts;
@@ -619,6 +620,13 @@ public:
   StringRef getUniqueFrameworkName(StringRef Framework);
   
   void PrintStats();
+
+  // HLSL Change Begin - report skipped includes.
+  /// \brief Number of #includes that were skipped because the file was
+  /// already included and is #pragma once, or is guarded by a macro that is
+  /// already defined.
+  unsigned getNumSkippedIncludes() const { return NumSkippedIncludes; }
+  // HLSL Change End
   
   size_t getTotalMemory() const;
 
@@ -15,22 +15,12 @@
 #include "clang/SPIRV/SpirvInstruction.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/StringRef.h"
-#include "llvm/ADT/ilist.h"
-#include "llvm/ADT/ilist_node.h"
 
 namespace clang {
 namespace spirv {
 
 class SpirvVisitor;
 
-class SpirvInstructionNode : public llvm::ilist_node<SpirvInstructionNode> {
-public:
-  SpirvInstructionNode() : instruction(nullptr) {}
-  SpirvInstructionNode(SpirvInstruction *instr) : instruction(instr) {}
-
-  SpirvInstruction *instruction;
-};
-
 /// The class representing a SPIR-V basic block in memory.
 class SpirvBasicBlock {
 public:
@@ -86,18 +76,16 @@ public:
     setDebugScope(scope);
   }
 
-  /// Adds an instruction to the vector of instructions belonging to this basic
-  /// block.
-  void addInstruction(SpirvInstruction *inst) { instructions.push_back(inst); }
+  /// Adds an instruction to the list of instructions belonging to this basic
+  /// block. An instruction can belong to at most one basic block.
+  void addInstruction(SpirvInstruction *inst);
 
   /// Adds the given instruction as the first instruction of this SPIR-V basic
   /// block.
-  void addFirstInstruction(SpirvInstruction *inst) {
-    instructions.push_front(inst);
-  }
+  void addFirstInstruction(SpirvInstruction *inst);
 
   /// Return true if instructions is empty. Otherwise, return false.
-  bool empty() { return instructions.empty(); }
+  bool empty() { return firstInstruction == nullptr; }
 
   /// Returns true if the last instruction in this basic block is a termination
   /// instruction.
@@ -125,8 +113,10 @@ private:
   uint32_t labelId;      ///< The label's <result-id>
   std::string labelName; ///< The label's debug name
 
-  /// Instructions belonging to this basic block.
-  llvm::ilist<SpirvInstructionNode> instructions;
+  /// Instructions belonging to this basic block, linked through
+  /// SpirvInstruction::prevInBasicBlock/nextInBasicBlock.
+  SpirvInstruction *firstInstruction;
+  SpirvInstruction *lastInstruction;
 
   /// Successors to this basic block.
   llvm::SmallVector<SpirvBasicBlock *, 2> successors;
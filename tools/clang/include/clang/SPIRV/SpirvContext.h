@@ -21,6 +21,7 @@
 #include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/DenseMapInfo.h"
 #include "llvm/ADT/MapVector.h"
+#include "llvm/ADT/Optional.h"
 #include "llvm/ADT/StringMap.h"
 #include "llvm/Support/Allocator.h"
 
@@ -403,6 +404,39 @@ public:
     return spvStructTypeToDecl[spvTy];
   }
 
+  /// Memoized lowering of struct types. Lowering a struct lays out every
+  /// field recursively, and the same struct is lowered again for every decl
+  /// that uses it, so LowerTypeVisitor and AlignmentSizeCalculator keep their
+  /// struct results here, per (type, layout rule, majorness).
+  struct LoweredStructInfo {
+    const SpirvType *type;
+    /// Whether lowering used SPIR-V arrays for HLSL 1xN matrices.
+    bool usesArrayForMat1xN;
+  };
+  const LoweredStructInfo *getLoweredStruct(QualType type, SpirvLayoutRule rule,
+                                            llvm::Optional<bool> isRowMajor) {
+    auto found = loweredStructs.find(getLayoutKey(type, rule, isRowMajor));
+    return found == loweredStructs.end() ? nullptr : &found->second;
+  }
+  void setLoweredStruct(QualType type, SpirvLayoutRule rule,
+                        llvm::Optional<bool> isRowMajor,
+                        const LoweredStructInfo &info) {
+    loweredStructs[getLayoutKey(type, rule, isRowMajor)] = info;
+  }
+
+  /// Memoized struct alignment and size, see getLoweredStruct.
+  const std::pair<uint32_t, uint32_t> *
+  getStructAlignmentAndSize(QualType type, SpirvLayoutRule rule,
+                            llvm::Optional<bool> isRowMajor) {
+    auto found = structLayouts.find(getLayoutKey(type, rule, isRowMajor));
+    return found == structLayouts.end() ? nullptr : &found->second;
+  }
+  void setStructAlignmentAndSize(QualType type, SpirvLayoutRule rule,
+                                 llvm::Optional<bool> isRowMajor,
+                                 std::pair<uint32_t, uint32_t> result) {
+    structLayouts[getLayoutKey(type, rule, isRowMajor)] = result;
+  }
+
   /// Function to add/get the mapping from a FunctionDecl to its DebugFunction.
   void registerDebugFunctionForDecl(const FunctionDecl *decl,
                                     SpirvDebugFunction *fn) {
@@ -425,6 +459,14 @@ public:
   }
 
 private:
+  typedef std::pair<void *, unsigned> LayoutKey;
+  static LayoutKey getLayoutKey(QualType type, SpirvLayoutRule rule,
+                                llvm::Optional<bool> isRowMajor) {
+    const unsigned majorness =
+        isRowMajor.hasValue() ? (isRowMajor.getValue() ? 2 : 1) : 0;
+    return {type.getAsOpaquePtr(), static_cast<unsigned>(rule) * 3 + majorness};
+  }
+
   /// \brief The allocator used to create SPIR-V entity objects.
   ///
   /// SPIR-V entity objects are never destructed; rather, all memory associated
@@ -508,6 +550,10 @@ private:
   // Mapping from SPIR-V type to Decl for a struct type.
   llvm::DenseMap<const SpirvType *, const DeclContext *> spvStructTypeToDecl;
 
+  // Memoized struct lowering and layout, see getLoweredStruct.
+  llvm::DenseMap<LayoutKey, LoweredStructInfo> loweredStructs;
+  llvm::DenseMap<LayoutKey, std::pair<uint32_t, uint32_t>> structLayouts;
+
   // Mapping from FunctionDecl to SPIR-V debug function.
   llvm::DenseMap<const FunctionDecl *, SpirvDebugFunction *>
       declToDebugFunction;
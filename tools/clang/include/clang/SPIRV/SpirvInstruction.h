@@ -251,6 +251,15 @@ protected:
   bool isRelaxedPrecision_;
   bool isNonUniform_;
   bool isPrecise_;
+
+private:
+  friend class SpirvBasicBlock;
+
+  /// Neighbours in the owning basic block's instruction list. The list is
+  /// threaded through the instructions themselves so that adding one to a
+  /// basic block does not allocate.
+  SpirvInstruction *prevInBasicBlock;
+  SpirvInstruction *nextInBasicBlock;
 };
 
 /// \brief OpCapability instruction
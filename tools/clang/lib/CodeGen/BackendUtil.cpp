@@ -29,6 +29,7 @@
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/PrettyStackTrace.h"
 #include "llvm/Support/TargetRegistry.h"
+#include "llvm/Support/TimeProfiler.h" // HLSL Change
 #include "llvm/Support/Timer.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Target/TargetMachine.h"
@@ -334,6 +335,11 @@ void EmitAssemblyHelper::CreatePasses() {
   PMBuilder.HLSLExtensionsCodeGen = CodeGenOpts.HLSLExtensionsCodegen.get();
   PMBuilder.HLSLResMayAlias = CodeGenOpts.HLSLResMayAlias;
   PMBuilder.ScanLimit = CodeGenOpts.ScanLimit;
+  PMBuilder.HLSLUnrollMaxFunctionInstructions = CodeGenOpts.HLSLUnrollMaxFunctionInstructions;
+  PMBuilder.HLSLUnrollMaxModuleInstructions = CodeGenOpts.HLSLUnrollMaxModuleInstructions;
+  PMBuilder.HLSLUnrollTimeLimit = CodeGenOpts.HLSLUnrollTimeLimit;
+  PMBuilder.HLSLMaxRegisterPressure = CodeGenOpts.HLSLMaxRegisterPressure;
+  PMBuilder.HLSLSpecializedCBufferValues = CodeGenOpts.HLSLSpecializedCBufferValues;
 
   PMBuilder.EnableGVN = !CodeGenOpts.HLSLOptimizationToggles.count("gvn") ||
                         CodeGenOpts.HLSLOptimizationToggles.find("gvn")->second;
@@ -350,6 +356,34 @@ void EmitAssemblyHelper::CreatePasses() {
       CodeGenOpts.HLSLEnableLifetimeMarkers &&
       (!CodeGenOpts.HLSLOptimizationToggles.count("lifetime-markers") ||
        CodeGenOpts.HLSLOptimizationToggles.find("lifetime-markers")->second);
+
+  PMBuilder.HLSLEnableUniformityMetadata =
+      CodeGenOpts.HLSLOptimizationToggles.count("uniformity-metadata") &&
+      CodeGenOpts.HLSLOptimizationToggles.find("uniformity-metadata")->second;
+
+  PMBuilder.HLSLEnableDot2AddFormation =
+      CodeGenOpts.HLSLOptimizationToggles.count("form-dot2add") &&
+      CodeGenOpts.HLSLOptimizationToggles.find("form-dot2add")->second;
+
+  PMBuilder.HLSLEnableFetchClustering =
+      CodeGenOpts.HLSLOptimizationToggles.count("cluster-fetches") &&
+      CodeGenOpts.HLSLOptimizationToggles.find("cluster-fetches")->second;
+
+  PMBuilder.HLSLEnableInlineCleanup =
+      CodeGenOpts.HLSLOptimizationToggles.count("inline-cleanup") &&
+      CodeGenOpts.HLSLOptimizationToggles.find("inline-cleanup")->second;
+
+  PMBuilder.HLSLEnableGroupSharedPadding =
+      CodeGenOpts.HLSLOptimizationToggles.count("pad-groupshared") &&
+      CodeGenOpts.HLSLOptimizationToggles.find("pad-groupshared")->second;
+
+  PMBuilder.HLSLCombineRawBufferAccesses =
+      !CodeGenOpts.HLSLOptimizationToggles.count("combine-raw-buffer-accesses") ||
+      CodeGenOpts.HLSLOptimizationToggles.find("combine-raw-buffer-accesses")->second;
+
+  PMBuilder.HLSLFoldUniformWaveOps =
+      !CodeGenOpts.HLSLOptimizationToggles.count("fold-uniform-wave-ops") ||
+      CodeGenOpts.HLSLOptimizationToggles.find("fold-uniform-wave-ops")->second;
   // HLSL Change - end
 
   PMBuilder.DisableUnitAtATime = !CodeGenOpts.UnitAtATime;
@@ -672,6 +706,7 @@ bool EmitAssemblyHelper::AddEmitPasses(BackendAction Action,
 void EmitAssemblyHelper::EmitAssembly(BackendAction Action,
                                       raw_pwrite_stream *OS) {
   TimeRegion Region(llvm::TimePassesIsEnabled ? &CodeGenerationTime : nullptr);
+  TimeTraceScope TimeScope("Backend"); // HLSL Change
 
   bool UsesCodeGen = (Action != Backend_EmitNothing &&
                       Action != Backend_EmitBC &&
@@ -735,6 +770,7 @@ void EmitAssemblyHelper::EmitAssembly(BackendAction Action,
 
   if (PerFunctionPasses) {
     PrettyStackTraceString CrashInfo("Per-function optimization");
+    TimeTraceScope TimeScope("Per-function passes"); // HLSL Change
 
     PerFunctionPasses->doInitialization();
     for (Function &F : *TheModule)
@@ -745,11 +781,13 @@ void EmitAssemblyHelper::EmitAssembly(BackendAction Action,
 
   if (PerModulePasses) {
     PrettyStackTraceString CrashInfo("Per-module optimization passes");
+    TimeTraceScope TimeScope("Per-module passes"); // HLSL Change
     PerModulePasses->run(*TheModule);
   }
 
   if (CodeGenPasses) {
     PrettyStackTraceString CrashInfo("Code generation");
+    TimeTraceScope TimeScope("Code generation passes"); // HLSL Change
     CodeGenPasses->run(*TheModule);
   }
 }
@@ -133,14 +133,31 @@ private:
   // Map to save entry functions.
   StringMap<EntryFunctionInfo> entryFunctionMap;
 
-  // Map to save static global init exp.
-  std::unordered_map<Expr *, GlobalVariable *> staticConstGlobalInitMap;
-  std::unordered_map<GlobalVariable *, std::vector<Constant *>>
-      staticConstGlobalInitListMap;
-  std::unordered_map<GlobalVariable *, Function *> staticConstGlobalCtorMap;
-  // List for functions with clip plane.
-  std::vector<Function *> clipPlaneFuncList;
-  std::unordered_map<Value *, DebugLoc> debugInfoMap;
+  // Data that is only needed until FinishCodeGen. It lives in an arena so that
+  // it can be dropped in bulk once the HL module is done.
+  struct CodeGenScratch {
+    // Declared first so it outlives the containers allocated from it.
+    CComPtr<IMalloc> Arena;
+    // Map to save static global init exp.
+    ScratchMap<Expr *, GlobalVariable *> staticConstGlobalInitMap;
+    ScratchMap<GlobalVariable *, std::vector<Constant *>>
+        staticConstGlobalInitListMap;
+    ScratchMap<GlobalVariable *, Function *> staticConstGlobalCtorMap;
+    // List for functions with clip plane.
+    ScratchVector<Function *> clipPlaneFuncList;
+    ScratchMap<Value *, DebugLoc> debugInfoMap;
+    // save intrinsic opcode
+    IntrinsicMap m_IntrinsicMap;
+
+    explicit CodeGenScratch(IMalloc *pArena)
+        : Arena(pArena), staticConstGlobalInitMap(DxcMallocAllocator<int>(pArena)),
+          staticConstGlobalInitListMap(DxcMallocAllocator<int>(pArena)),
+          staticConstGlobalCtorMap(DxcMallocAllocator<int>(pArena)),
+          clipPlaneFuncList(DxcMallocAllocator<int>(pArena)),
+          debugInfoMap(DxcMallocAllocator<int>(pArena)),
+          m_IntrinsicMap(DxcMallocAllocator<int>(pArena)) {}
+  };
+  std::unique_ptr<CodeGenScratch> m_pScratch;
 
   DxilRootSignatureVersion  rootSigVer;
 
@@ -200,8 +217,6 @@ private:
   hlsl::InterpolationMode GetInterpMode(const Decl *decl, CompType compType,
                                         bool bKeepUndefined);
   hlsl::CompType GetCompType(const BuiltinType *BT);
-  // save intrinsic opcode
-  std::vector<std::pair<Function *, unsigned>> m_IntrinsicMap;
   void AddHLSLIntrinsicOpcodeToFunction(Function *, unsigned opcode);
 
   // Type annotation related.
@@ -294,6 +309,9 @@ public:
   void AddControlFlowHint(CodeGenFunction &CGF, const Stmt &S,
                           llvm::TerminatorInst *TI,
                           ArrayRef<const Attr *> Attrs) override;
+  bool GetBlockProfileCounts(CodeGenFunction &CGF, const IfStmt &S,
+                             uint64_t &ThenCount,
+                             uint64_t &ElseCount) override;
   void MarkPotentialResourceTemp(CodeGenFunction &CGF, llvm::Value *V,
                                  clang::QualType QaulTy) override;
   void FinishAutoVar(CodeGenFunction &CGF, const VarDecl &D,
@@ -334,6 +352,11 @@ CGMSHLSLRuntime::CGMSHLSLRuntime(CodeGenModule &CGM)
                        ? hlsl::DXIL::kLegacyLayoutString
                        : hlsl::DXIL::kNewLayoutString),  Entry() {
 
+  CComPtr<IMalloc> pArena;
+  if (FAILED(DxcCreateArenaMalloc(nullptr, &pArena)))
+    throw std::bad_alloc();
+  m_pScratch.reset(new CodeGenScratch(pArena));
+
   const hlsl::ShaderModel *SM =
       hlsl::ShaderModel::GetByName(CGM.getCodeGenOpts().HLSLProfile.c_str());
   // Only accept valid, 6.0 shader model.
@@ -405,7 +428,8 @@ CGMSHLSLRuntime::CGMSHLSLRuntime(CodeGenModule &CGM)
 
   m_pHLModule->SetValidatorVersion(CGM.getCodeGenOpts().HLSLValidatorMajorVer, CGM.getCodeGenOpts().HLSLValidatorMinorVer);
 
-  m_bDebugInfo = CGM.getCodeGenOpts().getDebugInfo() == CodeGenOptions::FullDebugInfo;
+  m_bDebugInfo = CGM.getCodeGenOpts().getDebugInfo() >=
+                 CodeGenOptions::DebugLineTablesOnly;
 
   // set profile
   m_pHLModule->SetShaderModel(SM);
@@ -457,7 +481,7 @@ CGMSHLSLRuntime::CGMSHLSLRuntime(CodeGenModule &CGM)
 
 void CGMSHLSLRuntime::AddHLSLIntrinsicOpcodeToFunction(Function *F,
                                                        unsigned opcode) {
-  m_IntrinsicMap.emplace_back(F,opcode);
+  m_pScratch->m_IntrinsicMap.emplace_back(F,opcode);
 }
 
 void CGMSHLSLRuntime::CheckParameterAnnotation(
@@ -2487,7 +2511,7 @@ void CGMSHLSLRuntime::EmitHLSLFunctionProlog(Function *F, const FunctionDecl *FD
         if (m_bDebugInfo) {
           CodeGenFunction CGF(CGM);
           ApplyDebugLocation applyDebugLoc(CGF, clipPlane);
-          debugInfoMap[clipPlaneVal] = CGF.Builder.getCurrentDebugLocation();
+          m_pScratch->debugInfoMap[clipPlaneVal] = CGF.Builder.getCurrentDebugLocation();
         }
       } else {
         // Must be a MemberExpr.
@@ -2499,7 +2523,7 @@ void CGMSHLSLRuntime::EmitHLSLFunctionProlog(Function *F, const FunctionDecl *FD
         if (m_bDebugInfo) {
           CodeGenFunction CGF(CGM);
           ApplyDebugLocation applyDebugLoc(CGF, clipPlane);
-          debugInfoMap[addr] = CGF.Builder.getCurrentDebugLocation();
+          m_pScratch->debugInfoMap[addr] = CGF.Builder.getCurrentDebugLocation();
         }
       }
     };
@@ -2517,7 +2541,7 @@ void CGMSHLSLRuntime::EmitHLSLFunctionProlog(Function *F, const FunctionDecl *FD
     if (Expr *clipPlane = Attr->getClipPlane6())
       AddClipPlane(clipPlane, 5);
 
-    clipPlaneFuncList.emplace_back(F);
+    m_pScratch->clipPlaneFuncList.emplace_back(F);
   }
 
   // Update function linkage based on DefaultLinkage
@@ -2539,6 +2563,109 @@ void CGMSHLSLRuntime::EmitHLSLFunctionProlog(Function *F, const FunctionDecl *FD
   }
 }
 
+// A profiled branch taken at least this many times more often one way than
+// the other keeps its control flow, so that the cold side is skipped instead
+// of being flattened into the hot one.
+static const uint64_t kSkewedBranchRatio = 8;
+
+static bool IsSkewedBranch(llvm::TerminatorInst *TI) {
+  MDNode *ProfMD = TI->getMetadata(LLVMContext::MD_prof);
+  if (!ProfMD || ProfMD->getNumOperands() != 3)
+    return false;
+  ConstantInt *W0 = mdconst::dyn_extract<ConstantInt>(ProfMD->getOperand(1));
+  ConstantInt *W1 = mdconst::dyn_extract<ConstantInt>(ProfMD->getOperand(2));
+  if (!W0 || !W1)
+    return false;
+  uint64_t Hot = std::max(W0->getZExtValue(), W1->getZExtValue());
+  uint64_t Cold = std::min(W0->getZExtValue(), W1->getZExtValue());
+  return Hot >= Cold * kSkewedBranchRatio;
+}
+
+// Finds the block profile count for lines [StartLine, EndLine] of File: the
+// largest one, or with FirstOnly the one on the first profiled line. Returns
+// false if the profile has no count there.
+static bool GetBlockProfileCount(
+    const std::map<std::string, std::map<unsigned, uint64_t>> &Profile,
+    StringRef File, unsigned StartLine, unsigned EndLine, bool FirstOnly,
+    uint64_t &Count) {
+  auto FileIt = Profile.find(File);
+  if (FileIt == Profile.end() || StartLine > EndLine)
+    return false;
+  auto It = FileIt->second.lower_bound(StartLine);
+  auto End = FileIt->second.upper_bound(EndLine);
+  if (It == End)
+    return false;
+  Count = It->second;
+  if (!FirstOnly) {
+    for (; It != End; ++It)
+      Count = std::max(Count, It->second);
+  }
+  return true;
+}
+
+bool CGMSHLSLRuntime::GetBlockProfileCounts(CodeGenFunction &CGF,
+                                            const IfStmt &S,
+                                            uint64_t &ThenCount,
+                                            uint64_t &ElseCount) {
+  const auto &Profile = CGM.getCodeGenOpts().HLSLBlockProfile;
+  if (Profile.empty())
+    return false;
+
+  // The profile is keyed by the line each block starts on, so an arm is
+  // represented by the body of its braces rather than the brace line, which
+  // is also where the condition is.
+  auto GetBody = [](const Stmt *Arm) -> const Stmt * {
+    if (const CompoundStmt *CS = dyn_cast_or_null<CompoundStmt>(Arm))
+      return CS->body_empty() ? nullptr : CS;
+    return Arm;
+  };
+  auto GetStartLoc = [](const Stmt *Arm) {
+    if (const CompoundStmt *CS = dyn_cast<CompoundStmt>(Arm))
+      return CS->body_front()->getLocStart();
+    return Arm->getLocStart();
+  };
+
+  SourceManager &SM = CGM.getContext().getSourceManager();
+  const Stmt *Then = GetBody(S.getThen());
+  if (!Then)
+    return false;
+  PresumedLoc ThenBegin = SM.getPresumedLoc(GetStartLoc(Then));
+  PresumedLoc ThenEnd = SM.getPresumedLoc(Then->getLocEnd());
+  if (ThenBegin.isInvalid() || ThenEnd.isInvalid())
+    return false;
+  StringRef File = ThenBegin.getFilename();
+  if (!GetBlockProfileCount(Profile, File, ThenBegin.getLine(),
+                            ThenEnd.getLine(), /*FirstOnly*/ false, ThenCount))
+    return false;
+
+  if (S.getElse()) {
+    const Stmt *Else = GetBody(S.getElse());
+    if (!Else)
+      return false;
+    PresumedLoc ElseBegin = SM.getPresumedLoc(GetStartLoc(Else));
+    PresumedLoc ElseEnd = SM.getPresumedLoc(Else->getLocEnd());
+    if (ElseBegin.isInvalid() || ElseEnd.isInvalid())
+      return false;
+    return GetBlockProfileCount(Profile, File, ElseBegin.getLine(),
+                                ElseEnd.getLine(), /*FirstOnly*/ false,
+                                ElseCount);
+  }
+
+  // Without an else, the first block after the if runs once for each time
+  // either way was taken.
+  if (!CGF.CurFuncDecl)
+    return false;
+  PresumedLoc FuncEnd = SM.getPresumedLoc(CGF.CurFuncDecl->getLocEnd());
+  if (FuncEnd.isInvalid())
+    return false;
+  uint64_t JoinCount = 0;
+  if (!GetBlockProfileCount(Profile, File, ThenEnd.getLine() + 1,
+                            FuncEnd.getLine(), /*FirstOnly*/ true, JoinCount))
+    return false;
+  ElseCount = JoinCount > ThenCount ? JoinCount - ThenCount : 0;
+  return true;
+}
+
 void CGMSHLSLRuntime::AddControlFlowHint(CodeGenFunction &CGF, const Stmt &S,
                                          llvm::TerminatorInst *TI,
                                          ArrayRef<const Attr *> Attrs) {
@@ -2572,6 +2699,8 @@ void CGMSHLSLRuntime::AddControlFlowHint(CodeGenFunction &CGF, const Stmt &S,
       hints.emplace_back(DXIL::ControlFlowHint::Branch);
     else if (CGF.CGM.getCodeGenOpts().HLSLAvoidControlFlow)
       hints.emplace_back(DXIL::ControlFlowHint::Flatten);
+    else if (isa<IfStmt>(&S) && IsSkewedBranch(TI))
+      hints.emplace_back(DXIL::ControlFlowHint::Branch);
   }
 
   if (bFlatten && bBranch) {
@@ -2783,7 +2912,7 @@ void CGMSHLSLRuntime::addResource(Decl *D) {
         GlobalVariable *GV = cast<GlobalVariable>(CGM.GetAddrOfGlobalVar(VD));
         // Only save const static global of struct type.
         if (GV->getType()->getElementType()->isStructTy()) {
-          staticConstGlobalInitMap[InitExp] = GV;
+          m_pScratch->staticConstGlobalInitMap[InitExp] = GV;
         }
       }
       // Add type annotation for static global variable.
@@ -3709,7 +3838,7 @@ void CGMSHLSLRuntime::FinishCodeGen() {
   llvm::Module &M = TheModule;
   // Do this before CloneShaderEntry and TranslateRayQueryConstructor to avoid
   // update valToResPropertiesMap for cloned inst.
-  FinishIntrinsics(HLM, m_IntrinsicMap, objectProperties);
+  FinishIntrinsics(HLM, m_pScratch->m_IntrinsicMap, objectProperties);
   bool bWaveEnabledStage = m_pHLModule->GetShaderModel()->IsPS() ||
                            m_pHLModule->GetShaderModel()->IsCS() ||
                            m_pHLModule->GetShaderModel()->IsLib();
@@ -3724,12 +3853,13 @@ void CGMSHLSLRuntime::FinishCodeGen() {
   FinishEntries(HLM, Entry, CGM, entryFunctionMap, HSEntryPatchConstantFuncAttr,
                 patchConstantFunctionMap, patchConstantFunctionPropsMap);
 
-  ReplaceConstStaticGlobals(staticConstGlobalInitListMap,
-                            staticConstGlobalCtorMap);
+  ReplaceConstStaticGlobals(m_pScratch->staticConstGlobalInitListMap,
+                            m_pScratch->staticConstGlobalCtorMap);
 
   // Create copy for clip plane.
-  if (!clipPlaneFuncList.empty()) {
-    FinishClipPlane(HLM, clipPlaneFuncList, debugInfoMap, CGM);
+  if (!m_pScratch->clipPlaneFuncList.empty()) {
+    FinishClipPlane(HLM, m_pScratch->clipPlaneFuncList,
+                    m_pScratch->debugInfoMap, CGM);
   }
 
   // Add Reg bindings for resource in cb.
@@ -3795,6 +3925,9 @@ void CGMSHLSLRuntime::FinishCodeGen() {
   // At this point, we have a high-level DXIL module - record this.
   SetPauseResumePasses(*m_pHLModule->GetModule(), "hlsl-hlemit",
                        "hlsl-hlensure");
+
+  // Nothing past this point reads the scratch data; drop it with its arena.
+  m_pScratch.reset();
 }
 
 RValue CGMSHLSLRuntime::EmitHLSLBuiltinCallExpr(CodeGenFunction &CGF,
@@ -4405,10 +4538,10 @@ bool CGMSHLSLRuntime::IsTrivalInitListExpr(CodeGenFunction &CGF,
   QualType Ty = E->getType();
   bool result = ExpTypeMatch(E, Ty, CGF.getContext(), CGF.getTypes());
   if (result) {
-    auto iter = staticConstGlobalInitMap.find(E);
-    if (iter != staticConstGlobalInitMap.end()) {
+    auto iter = m_pScratch->staticConstGlobalInitMap.find(E);
+    if (iter != m_pScratch->staticConstGlobalInitMap.end()) {
       GlobalVariable * GV = iter->second;
-      auto &InitConstants = staticConstGlobalInitListMap[GV];
+      auto &InitConstants = m_pScratch->staticConstGlobalInitListMap[GV];
       // Add Constant to InitList.
       for (unsigned i=0;i<E->getNumInits();i++) {
         Expr *Expr = E->getInit(i);
@@ -4436,9 +4569,9 @@ bool CGMSHLSLRuntime::IsTrivalInitListExpr(CodeGenFunction &CGF,
         break;
       }
       if (InitConstants.empty())
-        staticConstGlobalInitListMap.erase(GV);
+        m_pScratch->staticConstGlobalInitListMap.erase(GV);
       else
-        staticConstGlobalCtorMap[GV] = CGF.CurFn;
+        m_pScratch->staticConstGlobalCtorMap[GV] = CGF.CurFn;
     }
   }
   return result;
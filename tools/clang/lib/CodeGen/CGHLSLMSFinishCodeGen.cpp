@@ -211,8 +211,7 @@ bool IsHLSLBufferViewType(llvm::Type *Ty) {
 }
 #endif
 
-void LowerGetResourceFromHeap(
-    HLModule &HLM, std::vector<std::pair<Function *, unsigned>> &intrinsicMap) {
+void LowerGetResourceFromHeap(HLModule &HLM, IntrinsicMap &intrinsicMap) {
   llvm::Module &M = *HLM.GetModule();
   llvm::Type *HandleTy = HLM.GetOP()->GetHandleType();
   unsigned GetResFromHeapOp =
@@ -912,9 +911,8 @@ void AddOpcodeParamForIntrinsic(
   F->eraseFromParent();
 }
 
-void AddOpcodeParamForIntrinsics(
-    HLModule &HLM, std::vector<std::pair<Function *, unsigned>> &intrinsicMap,
-    DxilObjectProperties &objectProperties) {
+void AddOpcodeParamForIntrinsics(HLModule &HLM, IntrinsicMap &intrinsicMap,
+                                 DxilObjectProperties &objectProperties) {
   llvm::Type *HandleTy = HLM.GetOP()->GetHandleType();
   for (auto mapIter : intrinsicMap) {
     Function *F = mapIter.first;
@@ -1325,10 +1323,9 @@ bool ReplaceConstStaticGlobalUser(GEPOperator *GEP,
 
 namespace CGHLSLMSHelper {
 void ReplaceConstStaticGlobals(
-    std::unordered_map<GlobalVariable *, std::vector<Constant *>>
+    ScratchMap<GlobalVariable *, std::vector<Constant *>>
         &staticConstGlobalInitListMap,
-    std::unordered_map<GlobalVariable *, Function *>
-        &staticConstGlobalCtorMap) {
+    ScratchMap<GlobalVariable *, Function *> &staticConstGlobalCtorMap) {
 
   for (auto &iter : staticConstGlobalInitListMap) {
     GlobalVariable *GV = iter.first;
@@ -2990,11 +2987,11 @@ void ReportDisallowedTypeInExportParam(clang::CodeGen ::CodeGenModule &CGM,
 } // namespace
 
 namespace CGHLSLMSHelper {
-void FinishClipPlane(HLModule &HLM, std::vector<Function *> &clipPlaneFuncList,
-                     std::unordered_map<Value *, DebugLoc> &debugInfoMap,
+void FinishClipPlane(HLModule &HLM, ScratchVector<Function *> &clipPlaneFuncList,
+                     ScratchMap<Value *, DebugLoc> &debugInfoMap,
                      clang::CodeGen::CodeGenModule &CGM) {
-  bool bDebugInfo = CGM.getCodeGenOpts().getDebugInfo() ==
-                    clang::CodeGenOptions::FullDebugInfo;
+  bool bDebugInfo = CGM.getCodeGenOpts().getDebugInfo() >=
+                    clang::CodeGenOptions::DebugLineTablesOnly;
   Module &M = *HLM.GetModule();
 
   for (Function *F : clipPlaneFuncList) {
@@ -3260,9 +3257,8 @@ void FinishEntries(
 } // namespace CGHLSLMSHelper
 
 namespace CGHLSLMSHelper {
-void FinishIntrinsics(
-    HLModule &HLM, std::vector<std::pair<Function *, unsigned>> &intrinsicMap,
-    DxilObjectProperties &objectProperties) {
+void FinishIntrinsics(HLModule &HLM, IntrinsicMap &intrinsicMap,
+                      DxilObjectProperties &objectProperties) {
   // Lower getResourceHeap before AddOpcodeParamForIntrinsics to skip automatic
   // lower for getResourceFromHeap.
   LowerGetResourceFromHeap(HLM, intrinsicMap);
@@ -8,8 +8,10 @@
 #include "llvm/ADT/MapVector.h"
 
 #include "dxc/DXIL/DxilCBuffer.h"
+#include "dxc/Support/Global.h"
 
 #include <memory>
+#include <unordered_map>
 #include <vector>
 
 namespace clang {
@@ -45,6 +47,16 @@ class ExportMap;
 
 namespace CGHLSLMSHelper {
 
+// Containers for codegen data that is dropped in bulk once FinishCodeGen is
+// done; they allocate from a per-module arena.
+template <typename T> using ScratchVector = std::vector<T, DxcMallocAllocator<T>>;
+template <typename K, typename V>
+using ScratchMap =
+    std::unordered_map<K, V, std::hash<K>, std::equal_to<K>,
+                       DxcMallocAllocator<std::pair<const K, V>>>;
+
+typedef ScratchVector<std::pair<llvm::Function *, unsigned>> IntrinsicMap;
+
 struct EntryFunctionInfo {
   clang::SourceLocation SL = clang::SourceLocation();
   llvm::Function *Func = nullptr;
@@ -178,21 +190,21 @@ void FinishEntries(hlsl::HLModule &HLM, const EntryFunctionInfo &Entry,
                                       std::unique_ptr<hlsl::DxilFunctionProps>>
                        &patchConstantFunctionPropsMap);
 
-void FinishIntrinsics(
-    hlsl::HLModule &HLM,
-    std::vector<std::pair<llvm::Function *, unsigned>> &intrinsicMap,
-    DxilObjectProperties &valToResPropertiesMap);
+void FinishIntrinsics(hlsl::HLModule &HLM, IntrinsicMap &intrinsicMap,
+                      DxilObjectProperties &valToResPropertiesMap);
 
 void AddDxBreak(llvm::Module &M, const llvm::SmallVector<llvm::BranchInst*, 16> &DxBreaks);
 
 void ReplaceConstStaticGlobals(
-    std::unordered_map<llvm::GlobalVariable *, std::vector<llvm::Constant *>>
+    ScratchMap<llvm::GlobalVariable *, std::vector<llvm::Constant *>>
         &staticConstGlobalInitListMap,
-    std::unordered_map<llvm::GlobalVariable *, llvm::Function *> &staticConstGlobalCtorMap);
+    ScratchMap<llvm::GlobalVariable *, llvm::Function *>
+        &staticConstGlobalCtorMap);
 
-void FinishClipPlane(hlsl::HLModule &HLM, std::vector<llvm::Function *> &clipPlaneFuncList,
-                    std::unordered_map<llvm::Value *, llvm::DebugLoc> &debugInfoMap,
-                    clang::CodeGen::CodeGenModule &CGM);
+void FinishClipPlane(hlsl::HLModule &HLM,
+                     ScratchVector<llvm::Function *> &clipPlaneFuncList,
+                     ScratchMap<llvm::Value *, llvm::DebugLoc> &debugInfoMap,
+                     clang::CodeGen::CodeGenModule &CGM);
 
 void AddRegBindingsForResourceInConstantBuffer(
     hlsl::HLModule &HLM,
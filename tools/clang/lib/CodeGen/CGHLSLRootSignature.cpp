@@ -20,14 +20,36 @@
 #include "dxc/dxcapi.h"                 // stream support
 #include "clang/Parse/ParseHLSL.h" // root sig would be in Parser if part of lang
 #include "dxc/dxcapi.h"
+#include <string>
+#include <vector>
 
 using namespace llvm;
 
+// Root signatures that compiled without errors, keyed by version, flags and
+// text. Engines share a handful of root signatures across thousands of
+// shaders, so each is parsed and serialized once per process.
+static hlsl::RootSignatureByteCache &GetRootSignatureCache() {
+  static hlsl::RootSignatureByteCache Cache;
+  return Cache;
+}
+
 void clang::CompileRootSignature(
     StringRef rootSigStr, DiagnosticsEngine &Diags, SourceLocation SLoc,
     hlsl::DxilRootSignatureVersion rootSigVer,
     hlsl::DxilRootSignatureCompilationFlags flags,
     hlsl::RootSignatureHandle *pRootSigHandle) {
+  std::string Key;
+  Key.append((const char *)&rootSigVer, sizeof(rootSigVer));
+  Key.append((const char *)&flags, sizeof(flags));
+  Key.append(rootSigStr.data(), rootSigStr.size());
+  hlsl::RootSignatureByteCache &Cache = GetRootSignatureCache();
+  std::vector<uint8_t> Serialized;
+  if (Cache.Lookup(Key.data(), Key.size(), &Serialized)) {
+    pRootSigHandle->LoadSerialized(Serialized.data(),
+                                   (uint32_t)Serialized.size());
+    return;
+  }
+
   std::string OSStr;
   llvm::raw_string_ostream OS(OSStr);
   hlsl::DxilVersionedRootSignatureDesc *D = nullptr;
@@ -44,6 +66,8 @@ void clang::CompileRootSignature(
       hlsl::DeleteRootSignature(D);
     } else {
       pRootSigHandle->Assign(D, pSignature);
+      Cache.Add(Key.data(), Key.size(), pRootSigHandle->GetSerializedBytes(),
+                pRootSigHandle->GetSerializedSize());
     }
   }
 }
\ No newline at end of file
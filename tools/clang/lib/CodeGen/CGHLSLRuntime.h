@@ -42,6 +42,7 @@ class CallExpr;
 class InitListExpr;
 class Expr;
 class Stmt;
+class IfStmt;
 class ReturnStmt;
 class Attr;
 class VarDecl;
@@ -132,6 +133,10 @@ public:
 
   
   virtual void AddControlFlowHint(CodeGenFunction &CGF, const Stmt &S, llvm::TerminatorInst *TI, llvm::ArrayRef<const Attr *> Attrs) = 0;
+  // Looks up how often each arm of S ran in the -fprofile-use block profile.
+  virtual bool GetBlockProfileCounts(CodeGenFunction &CGF, const IfStmt &S,
+                                     uint64_t &ThenCount,
+                                     uint64_t &ElseCount) = 0;
 
   virtual void FinishAutoVar(CodeGenFunction &CGF, const VarDecl &D,
                              llvm::Value *V) = 0;
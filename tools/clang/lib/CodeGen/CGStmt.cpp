@@ -608,6 +608,18 @@ void CodeGenFunction::EmitIfStmt(const IfStmt &S,
   // HLSL Change Begins
   llvm::TerminatorInst *TI =
       cast<llvm::TerminatorInst>(*ThenBlock->user_begin());
+  // Weight the branch from the -fprofile-use block profile.
+  llvm::BranchInst *BI = dyn_cast<llvm::BranchInst>(TI);
+  uint64_t ThenCount = 0, ElseCount = 0;
+  if (BI && BI->isConditional() &&
+      !BI->getMetadata(llvm::LLVMContext::MD_prof) &&
+      CGM.getHLSLRuntime().GetBlockProfileCounts(*this, S, ThenCount,
+                                                 ElseCount)) {
+    if (BI->getSuccessor(0) != ThenBlock)
+      std::swap(ThenCount, ElseCount);
+    BI->setMetadata(llvm::LLVMContext::MD_prof,
+                    createProfileWeights(ThenCount, ElseCount));
+  }
   CGM.getHLSLRuntime().AddControlFlowHint(*this, S, TI, Attrs);
   CGM.getHLSLRuntime().MarkIfStmt(*this, ContBlock);
   // HLSL Change Ends
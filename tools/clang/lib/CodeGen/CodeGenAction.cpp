@@ -34,6 +34,7 @@
 #include "llvm/Pass.h"
 #include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/TimeProfiler.h" // HLSL Change
 #include "llvm/Support/Timer.h"
 #include <memory>
 using namespace clang;
@@ -122,6 +123,11 @@ namespace clang {
       if (llvm::TimePassesIsEnabled)
         LLVMIRGeneration.stopTimer();
 
+      // HLSL Change Begin - let the yield callback abort long front ends
+      if (TheModule)
+        TheModule->getContext().yield();
+      // HLSL Change End
+
       return true;
     }
 
@@ -141,6 +147,7 @@ namespace clang {
     void HandleTranslationUnit(ASTContext &C) override {
       {
         PrettyStackTraceString CrashInfo("Per-file LLVM IR generation");
+        llvm::TimeTraceScope TimeScope("CodeGen"); // HLSL Change
         if (llvm::TimePassesIsEnabled)
           LLVMIRGeneration.startTimer();
 
@@ -188,6 +195,29 @@ namespace clang {
       void *OldDiagnosticContext = Ctx.getDiagnosticContext();
       Ctx.setDiagnosticHandler(DiagnosticHandler, this);
 
+      // HLSL Change Begin - a backend runner optimizes the module its own way,
+      // then the module it leaves is written out here.
+      if (CodeGenOpts.HLSLBackendRunner && Action == Backend_EmitBC) {
+        StringRef TDesc = C.getTargetInfo().getTargetDescription();
+        auto EmitBackend = [&](llvm::Module *Part, bool Report) {
+          LLVMContext::DiagnosticHandlerTy RunnerHandler =
+              Ctx.getDiagnosticHandler();
+          void *RunnerContext = Ctx.getDiagnosticContext();
+          if (Report)
+            Ctx.setDiagnosticHandler(DiagnosticHandler, this);
+          EmitBackendOutput(Diags, CodeGenOpts, TargetOpts, LangOpts, TDesc,
+                            Part, Backend_EmitNothing, nullptr);
+          Ctx.setDiagnosticHandler(RunnerHandler, RunnerContext);
+        };
+        if (std::unique_ptr<llvm::Module> NewModule =
+                CodeGenOpts.HLSLBackendRunner->Run(TheModule.get(),
+                                                   EmitBackend))
+          TheModule = std::move(NewModule);
+        if (AsmOutStream)
+          WriteBitcodeToFile(TheModule.get(), *AsmOutStream,
+                             CodeGenOpts.EmitLLVMUseLists);
+      } else
+      // HLSL Change End
       EmitBackendOutput(Diags, CodeGenOpts, TargetOpts, LangOpts,
                         C.getTargetInfo().getTargetDescription(),
                         TheModule.get(), Action, AsmOutStream);
@@ -428,6 +458,9 @@ BackendConsumer::StackSizeDiagHandler(const llvm::DiagnosticInfoStackSize &D) {
     // We do not know how to format other severities.
     return false;
 
+  if (!Context) // HLSL Change - no declarations for IR input
+    return false;
+
   if (const Decl *ND = Gen->GetDeclForMangledName(D.getFunction().getName())) {
     Diags.Report(ND->getASTContext().getFullLoc(ND->getLocation()),
                  diag::warn_fe_frame_larger_than)
@@ -444,7 +477,8 @@ void BackendConsumer::EmitOptimizationMessage(
   assert(D.getSeverity() == llvm::DS_Remark ||
          D.getSeverity() == llvm::DS_Warning);
 
-  SourceManager &SourceMgr = Context->getSourceManager();
+  // HLSL Change - the AST's source manager, which IR input also has.
+  SourceManager &SourceMgr = Diags.getSourceManager();
   FileManager &FileMgr = SourceMgr.getFileManager();
   StringRef Filename;
   unsigned Line, Column;
@@ -464,7 +498,7 @@ void BackendConsumer::EmitOptimizationMessage(
   // function definition. We use the definition's right brace to differentiate
   // from diagnostics that genuinely relate to the function itself.
   FullSourceLoc Loc(DILoc, SourceMgr);
-  if (Loc.isInvalid())
+  if (Loc.isInvalid() && Context) // HLSL Change - no declarations for IR input
     if (const Decl *FD = Gen->GetDeclForMangledName(D.getFunction().getName()))
       Loc = FD->getASTContext().getFullLoc(FD->getBodyRBrace());
 
@@ -538,7 +572,8 @@ BackendConsumer::DxilDiagHandler(const llvm::DiagnosticInfoDxil &D) {
   unsigned DiagID;
   ComputeDiagID(D.getSeverity(), inline_asm, DiagID);
 
-  SourceManager &SourceMgr = Context->getSourceManager();
+  // HLSL Change - the AST's source manager, which IR input also has.
+  SourceManager &SourceMgr = Diags.getSourceManager();
   SourceLocation DILoc;
   std::string Message = D.getMsgStr().str();
 
@@ -780,7 +815,9 @@ void CodeGenAction::ExecuteAction() {
       CI.getDiagnostics().Report(Loc, DiagID) << Msg;
       return;
     }
-    const TargetOptions &TargetOpts = CI.getTargetOpts();
+    // HLSL Change - dxcompiler sets the triple on the target, not on the
+    // invocation.
+    const TargetOptions &TargetOpts = CI.getTarget().getTargetOpts();
     if (TheModule->getTargetTriple() != TargetOpts.Triple) {
       CI.getDiagnostics().Report(SourceLocation(),
                                  diag::warn_fe_override_module)
@@ -790,9 +827,25 @@ void CodeGenAction::ExecuteAction() {
 
     LLVMContext &Ctx = TheModule->getContext();
     Ctx.setInlineAsmDiagnosticHandler(BitcodeInlineAsmDiagHandler);
+    // HLSL Change Begin - report backend diagnostics through the compiler
+    // instance as the AST path does, instead of the context's default
+    // handler, which exits on errors. The yield callback stays installed on
+    // the context.
+    BackendConsumer Result(BA, CI.getDiagnostics(), CI.getHeaderSearchOpts(),
+                           CI.getPreprocessorOpts(), CI.getCodeGenOpts(),
+                           TargetOpts, CI.getLangOpts(),
+                           CI.getFrontendOpts().ShowTimers, getCurrentFile(),
+                           nullptr, OS, *VMContext);
+    LLVMContext::DiagnosticHandlerTy OldDiagnosticHandler =
+        Ctx.getDiagnosticHandler();
+    void *OldDiagnosticContext = Ctx.getDiagnosticContext();
+    Ctx.setDiagnosticHandler(BackendConsumer::DiagnosticHandler, &Result);
+    // HLSL Change End
     EmitBackendOutput(CI.getDiagnostics(), CI.getCodeGenOpts(), TargetOpts,
                       CI.getLangOpts(), CI.getTarget().getTargetDescription(),
                       TheModule.get(), BA, OS);
+    Ctx.setDiagnosticHandler(OldDiagnosticHandler,
+                             OldDiagnosticContext); // HLSL Change
     return;
   }
 
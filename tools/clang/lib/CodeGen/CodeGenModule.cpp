@@ -1314,6 +1314,34 @@ bool CodeGenModule::MustBeEmitted(const ValueDecl *Global) {
   if (LangOpts.EmitAllDecls)
     return true;
 
+  // HLSL Change Starts
+  // Library functions that neither export nor are shaders get internal
+  // linkage in AddHLSLFunctionInfo unless the default linkage keeps them
+  // external. Defer them like static functions, so that only the ones
+  // reachable from exports and entries are generated. A stage attribute such
+  // as numthreads makes a function an entry just like a shader attribute, and
+  // -exports may name any function, so nothing is deferred with it.
+  if (LangOpts.HLSL && LangOpts.IsHLSLLibrary &&
+      CodeGenOpts.HLSLLibraryExports.empty()) {
+    if (const auto *FD = dyn_cast<FunctionDecl>(Global)) {
+      bool DefaultIsInternal =
+          CodeGenOpts.DefaultLinkage == hlsl::DXIL::DefaultLinkage::Internal ||
+          (CodeGenOpts.DefaultLinkage == hlsl::DXIL::DefaultLinkage::Default &&
+           CodeGenOpts.HLSLProfile != "lib_6_x");
+      if (DefaultIsInternal && !FD->hasAttr<HLSLExportAttr>() &&
+          !FD->hasAttr<HLSLShaderAttr>() && !FD->hasAttr<UsedAttr>() &&
+          !FD->hasAttr<HLSLNumThreadsAttr>() &&
+          !FD->hasAttr<HLSLMaxVertexCountAttr>() &&
+          !FD->hasAttr<HLSLPatchConstantFuncAttr>() &&
+          !FD->hasAttr<HLSLDomainAttr>() &&
+          !FD->hasAttr<HLSLClipPlanesAttr>() &&
+          !FD->hasAttr<HLSLEarlyDepthStencilAttr>() &&
+          !getContext().IsPatchConstantFunctionDecl(FD))
+        return false;
+    }
+  }
+  // HLSL Change Ends
+
   return getContext().DeclMustBeEmitted(Global);
 }
 
@@ -211,6 +211,7 @@ ASTUnit::ASTUnit(bool _MainFileIsAST)
     OwnsRemappedFileBuffers(true),
     NumStoredDiagnosticsFromDriver(0),
     PreambleRebuildCounter(0),
+    SkipIncludedFunctionBodies(false),          // HLSL Change
     HlslLangExtensions(nullptr),    // HLSL Change
     NumWarningsInPreamble(0),
     ShouldCacheCodeCompletionResults(false),
@@ -876,6 +877,12 @@ public:
   // We're not interested in "interesting" decls.
   void HandleInterestingDecl(DeclGroupRef) override {}
 
+  // HLSL Change Starts
+  bool shouldSkipFunctionBody(Decl *D) override {
+    return Unit.shouldSkipFunctionBody(D);
+  }
+  // HLSL Change Ends
+
   void HandleTopLevelDeclInObjCContainer(DeclGroupRef D) override {
     for (Decl *TopLevelDecl : D)
       handleTopLevelDecl(TopLevelDecl);
@@ -1178,6 +1185,8 @@ bool ASTUnit::Parse(std::shared_ptr<PCHContainerOperations> PCHContainerOps,
 
   FailedParseDiagnostics.clear();
 
+  recordIncludedFileHashes(); // HLSL Change
+
   return false;
 
 error:
@@ -1190,6 +1199,7 @@ error:
   FailedParseDiagnostics.swap(StoredDiagnostics);
   StoredDiagnostics.clear();
   NumStoredDiagnosticsFromDriver = 0;
+  IncludedFileHashes.clear(); // HLSL Change
   return true;
 }
 
@@ -1300,7 +1310,8 @@ bool operator==(const ASTUnit::PreambleFileHash &LHS,
 }
 } // namespace clang
 
-#if 0 // HLSL Change Starts - no support for PCH
+// HLSL Change - standalone diagnostics are also kept across reparses that
+// skip included function bodies.
 static std::pair<unsigned, unsigned>
 makeStandaloneRange(CharSourceRange Range, const SourceManager &SM,
                     const LangOptions &LangOpts) {
@@ -1345,7 +1356,6 @@ makeStandaloneDiagnostic(const LangOptions &LangOpts,
 
   return OutDiag;
 }
-#endif // HLSL Change Ends - no support for PCH
 
 /// \brief Attempt to build or re-use a precompiled preamble when (re-)parsing
 /// the source file.
@@ -2087,8 +2097,79 @@ ASTUnit *ASTUnit::LoadFromCommandLine(
   return AST.release();
 }
 
+// HLSL Change Starts
+bool ASTUnit::shouldSkipFunctionBody(Decl *D) {
+  if (!SkipIncludedFunctionBodies)
+    return true; // Every body is skipped.
+  SourceLocation Loc = SourceMgr->getExpansionLoc(D->getLocation());
+  if (Loc.isInvalid() || SourceMgr->isInMainFile(Loc))
+    return false;
+  const FileEntry *File = SourceMgr->getFileEntryForID(SourceMgr->getFileID(Loc));
+  return File != nullptr && isUnchangedIncludedFile(File);
+}
+
+bool ASTUnit::isUnchangedIncludedFile(const FileEntry *File) {
+  auto Cached = UnchangedIncludedFiles.find(File);
+  if (Cached != UnchangedIncludedFiles.end())
+    return Cached->second;
+  bool Unchanged = false;
+  auto Previous = IncludedFileHashes.find(File->getName());
+  if (Previous != IncludedFileHashes.end()) {
+    bool Invalid = false;
+    const llvm::MemoryBuffer *Buffer =
+        SourceMgr->getMemoryBufferForFile(File, &Invalid);
+    Unchanged = Buffer && !Invalid &&
+                PreambleFileHash::createForMemoryBuffer(Buffer) ==
+                    Previous->second;
+  }
+  UnchangedIncludedFiles[File] = Unchanged;
+  return Unchanged;
+}
+
+void ASTUnit::recordIncludedFileHashes() {
+  IncludedFileHashes.clear();
+  const FileEntry *MainFile =
+      SourceMgr->getFileEntryForID(SourceMgr->getMainFileID());
+  for (auto I = SourceMgr->fileinfo_begin(), E = SourceMgr->fileinfo_end();
+       I != E; ++I) {
+    const llvm::MemoryBuffer *Buffer = I->second->getRawBuffer();
+    if (I->first == MainFile || Buffer == nullptr)
+      continue;
+    IncludedFileHashes[I->first->getName()] =
+        PreambleFileHash::createForMemoryBuffer(Buffer);
+  }
+}
+
+// Reports again the diagnostics of the previous parse in files whose bodies
+// were skipped as unchanged, unless this parse reported them already.
+void ASTUnit::restoreSkippedBodyDiagnostics(
+    const SmallVectorImpl<StandaloneDiagnostic> &Diags) {
+  SmallVector<StoredDiagnostic, 4> Previous;
+  TranslateStoredDiagnostics(getFileManager(), getSourceManager(), Diags,
+                             Previous);
+  size_t NumReported = StoredDiagnostics.size();
+  for (StoredDiagnostic &SD : Previous) {
+    SourceLocation Loc = SD.getLocation();
+    const FileEntry *File =
+        SourceMgr->getFileEntryForID(SourceMgr->getFileID(Loc));
+    // Only files looked up while skipping a body are known to be unchanged.
+    if (File == nullptr || !UnchangedIncludedFiles.lookup(File))
+      continue;
+    auto Reported = std::find_if(
+        StoredDiagnostics.begin(), StoredDiagnostics.begin() + NumReported,
+        [&](const StoredDiagnostic &Other) {
+          return Other.getLocation() == Loc && Other.getID() == SD.getID() &&
+                 Other.getMessage() == SD.getMessage();
+        });
+    if (Reported == StoredDiagnostics.begin() + NumReported)
+      StoredDiagnostics.push_back(SD);
+  }
+}
+// HLSL Change Ends
+
 bool ASTUnit::Reparse(std::shared_ptr<PCHContainerOperations> PCHContainerOps,
-                      ArrayRef<RemappedFile> RemappedFiles) {
+                      ArrayRef<RemappedFile> RemappedFiles,
+                      bool SkipIncludedFunctionBodies) { // HLSL Change
   if (!Invocation)
     return true;
 
@@ -2099,6 +2180,19 @@ bool ASTUnit::Reparse(std::shared_ptr<PCHContainerOperations> PCHContainerOps,
 
   // Remap files.
   PreprocessorOptions &PPOpts = Invocation->getPreprocessorOpts();
+  // HLSL Change Starts - keep the diagnostics from included files, which
+  // are reported again below if their bodies are skipped.
+  UnchangedIncludedFiles.clear();
+  SmallVector<StandaloneDiagnostic, 4> IncludedFileDiagnostics;
+  if (SkipIncludedFunctionBodies) {
+    for (const StoredDiagnostic &SD : StoredDiagnostics) {
+      FullSourceLoc Loc = SD.getLocation();
+      if (Loc.isValid() && !Loc.getManager().isInMainFile(Loc))
+        IncludedFileDiagnostics.push_back(
+            makeStandaloneDiagnostic(*LangOpts, SD));
+    }
+  }
+  // HLSL Change Ends
   for (const auto &RB : PPOpts.RemappedFileBuffers)
     delete RB.second;
 
@@ -2121,9 +2215,26 @@ bool ASTUnit::Reparse(std::shared_ptr<PCHContainerOperations> PCHContainerOps,
   if (OverrideMainBuffer)
     getDiagnostics().setNumWarnings(NumWarningsInPreamble);
 
+  // HLSL Change Starts - skip included function bodies for this parse only,
+  // and not at all if every body is skipped anyway.
+  FrontendOptions &FEOpts = Invocation->getFrontendOpts();
+  bool SkipAllFunctionBodies = FEOpts.SkipFunctionBodies;
+  this->SkipIncludedFunctionBodies =
+      SkipIncludedFunctionBodies && !SkipAllFunctionBodies;
+  if (this->SkipIncludedFunctionBodies)
+    FEOpts.SkipFunctionBodies = true;
+  // HLSL Change Ends
+
   // Parse the sources
   bool Result = Parse(PCHContainerOps, std::move(OverrideMainBuffer));
 
+  // HLSL Change Starts
+  FEOpts.SkipFunctionBodies = SkipAllFunctionBodies;
+  if (!Result && this->SkipIncludedFunctionBodies)
+    restoreSkippedBodyDiagnostics(IncludedFileDiagnostics);
+  this->SkipIncludedFunctionBodies = false;
+  // HLSL Change Ends
+
   // If we're caching global code-completion results, and the top-level 
   // declarations have changed, clear out the code-completion cache.
   if (!Result && ShouldCacheCodeCompletionResults &&
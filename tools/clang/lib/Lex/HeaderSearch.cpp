@@ -67,6 +67,7 @@ HeaderSearch::HeaderSearch(IntrusiveRefCntPtr<HeaderSearchOptions> HSOpts,
   ExternalSource = nullptr;
   NumIncluded = 0;
   NumMultiIncludeFileOptzn = 0;
+  NumSkippedIncludes = 0; // HLSL Change
   NumFrameworkLookups = NumSubFrameworkLookups = 0;
 }
 
@@ -1056,8 +1057,10 @@ bool HeaderSearch::ShouldEnterIncludeFile(Preprocessor &PP,
   } else {
     // Otherwise, if this is a #include of a file that was previously #import'd
     // or if this is the second #include of a #pragma once file, ignore it.
-    if (FileInfo.isImport)
+    if (FileInfo.isImport) {
+      ++NumSkippedIncludes; // HLSL Change
       return false;
+    }
   }
 
   // Next, check to see if the file is wrapped with #ifndef guards.  If so, and
@@ -1070,6 +1073,7 @@ bool HeaderSearch::ShouldEnterIncludeFile(Preprocessor &PP,
     if (M ? PP.isMacroDefinedInLocalModule(ControllingMacro, M)
           : PP.isMacroDefined(ControllingMacro)) {
       ++NumMultiIncludeFileOptzn;
+      ++NumSkippedIncludes; // HLSL Change
       return false;
     }
   }
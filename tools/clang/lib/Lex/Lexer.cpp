@@ -26,8 +26,98 @@
 #include "llvm/Support/ConvertUTF.h"
 #include "llvm/Support/MemoryBuffer.h"
 #include <cstring>
+// HLSL Change Begin - vector scanning helpers are defined below.
+#ifdef __SSE2__
+#include <emmintrin.h>
+#elif __ALTIVEC__
+#include <altivec.h>
+#undef bool
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define HLSL_LEXER_NEON
+#endif
+// HLSL Change End
 using namespace clang;
 
+// HLSL Change Begin - Skip runs of uninteresting characters 16 bytes at a
+// time. Each helper only steps over whole chunks that lie before BufferEnd
+// and contain no byte of interest, so the caller's scalar loop sees exactly
+// the bytes it would have reached on its own; without vector support they
+// return Ptr unchanged.
+
+/// Returns the first chunk boundary at or after Ptr whose chunk may hold a
+/// '\n', '\r' or '\0', the characters that stop the scan of a // comment.
+static inline const char *skipLineCommentBody(const char *Ptr,
+                                              const char *BufferEnd) {
+#if defined(__SSE2__)
+  const __m128i NL = _mm_set1_epi8('\n');
+  const __m128i CR = _mm_set1_epi8('\r');
+  const __m128i Zero = _mm_setzero_si128();
+  while (Ptr + 16 <= BufferEnd) {
+    __m128i V = _mm_loadu_si128((const __m128i *)Ptr);
+    __m128i Stop = _mm_or_si128(
+        _mm_or_si128(_mm_cmpeq_epi8(V, NL), _mm_cmpeq_epi8(V, CR)),
+        _mm_cmpeq_epi8(V, Zero));
+    if (_mm_movemask_epi8(Stop) != 0)
+      break;
+    Ptr += 16;
+  }
+#elif defined(HLSL_LEXER_NEON)
+  const uint8x16_t NL = vdupq_n_u8('\n');
+  const uint8x16_t CR = vdupq_n_u8('\r');
+  while (Ptr + 16 <= BufferEnd) {
+    uint8x16_t V = vld1q_u8((const uint8_t *)Ptr);
+    uint8x16_t Stop = vorrq_u8(vorrq_u8(vceqq_u8(V, NL), vceqq_u8(V, CR)),
+                               vceqzq_u8(V));
+    if (vmaxvq_u8(Stop) != 0)
+      break;
+    Ptr += 16;
+  }
+#endif
+  return Ptr;
+}
+
+/// Returns the first chunk boundary at or after Ptr whose chunk may hold a
+/// character outside [_A-Za-z0-9].
+static inline const char *skipIdentifierBody(const char *Ptr,
+                                             const char *BufferEnd) {
+#if defined(__SSE2__)
+  // Bytes at or above 0x80 are negative as signed chars and fail every range.
+  const __m128i Case = _mm_set1_epi8(0x20);
+  const __m128i BelowA = _mm_set1_epi8('a' - 1), AboveZ = _mm_set1_epi8('z' + 1);
+  const __m128i Below0 = _mm_set1_epi8('0' - 1), Above9 = _mm_set1_epi8('9' + 1);
+  const __m128i Underscore = _mm_set1_epi8('_');
+  while (Ptr + 16 <= BufferEnd) {
+    __m128i V = _mm_loadu_si128((const __m128i *)Ptr);
+    __m128i L = _mm_or_si128(V, Case);
+    __m128i Alpha = _mm_and_si128(_mm_cmpgt_epi8(L, BelowA),
+                                  _mm_cmplt_epi8(L, AboveZ));
+    __m128i Digit = _mm_and_si128(_mm_cmpgt_epi8(V, Below0),
+                                  _mm_cmplt_epi8(V, Above9));
+    __m128i Body = _mm_or_si128(_mm_or_si128(Alpha, Digit),
+                                _mm_cmpeq_epi8(V, Underscore));
+    if (_mm_movemask_epi8(Body) != 0xFFFF)
+      break;
+    Ptr += 16;
+  }
+#elif defined(HLSL_LEXER_NEON)
+  const uint8x16_t Case = vdupq_n_u8(0x20);
+  while (Ptr + 16 <= BufferEnd) {
+    uint8x16_t V = vld1q_u8((const uint8_t *)Ptr);
+    uint8x16_t L = vorrq_u8(V, Case);
+    uint8x16_t Alpha = vcleq_u8(vsubq_u8(L, vdupq_n_u8('a')), vdupq_n_u8(25));
+    uint8x16_t Digit = vcleq_u8(vsubq_u8(V, vdupq_n_u8('0')), vdupq_n_u8(9));
+    uint8x16_t Body = vorrq_u8(vorrq_u8(Alpha, Digit),
+                               vceqq_u8(V, vdupq_n_u8('_')));
+    if (vminvq_u8(Body) == 0)
+      break;
+    Ptr += 16;
+  }
+#endif
+  return Ptr;
+}
+// HLSL Change End
+
 //===----------------------------------------------------------------------===//
 // Token Class Implementation
 //===----------------------------------------------------------------------===//
@@ -1472,8 +1562,15 @@ bool Lexer::LexIdentifier(Token &Result, const char *CurPtr) {
   // Match [_A-Za-z0-9]*, we have already matched [_A-Za-z$]
   unsigned Size;
   unsigned char C = *CurPtr++;
-  while (isIdentifierBody(C))
+  // HLSL Change Begin - scan the first 16 characters one at a time, then
+  // skip the rest of long (typically generated) identifiers in chunks.
+  const char *ChunkStart = CurPtr + 15;
+  while (isIdentifierBody(C)) {
+    if (CurPtr == ChunkStart)
+      CurPtr = skipIdentifierBody(CurPtr, BufferEnd);
     C = *CurPtr++;
+  }
+  // HLSL Change End
 
   --CurPtr;   // Back up over the skipped character.
 
@@ -2050,6 +2147,7 @@ bool Lexer::SkipLineComment(Token &Result, const char *CurPtr,
   // them.  As such, optimize for this case with the inner loop.
   char C;
   do {
+    CurPtr = skipLineCommentBody(CurPtr, BufferEnd); // HLSL Change
     C = *CurPtr;
     // Skip over characters in the fast loop.
     while (C != 0 &&                // Potentially EOF.
@@ -2255,13 +2353,6 @@ static bool isEndOfBlockCommentWithEscapedNewLine(const char *CurPtr,
   return true;
 }
 
-#ifdef __SSE2__
-#include <emmintrin.h>
-#elif __ALTIVEC__
-#include <altivec.h>
-#undef bool
-#endif
-
 /// We have just read from input the / and * characters that started a comment.
 /// Read until we find the * and / characters that terminate the comment.
 /// Note that we don't bother decoding trigraphs or escaped newlines in block
@@ -2340,6 +2431,13 @@ bool Lexer::SkipBlockComment(Token &Result, const char *CurPtr,
       while (CurPtr+16 <= BufferEnd &&
              !vec_any_eq(*(const vector unsigned char*)CurPtr, Slashes))
         CurPtr += 16;
+// HLSL Change Begin - NEON is also available on arm64 hosts.
+#elif defined(HLSL_LEXER_NEON)
+      const uint8x16_t Slashes = vdupq_n_u8('/');
+      while (CurPtr+16 <= BufferEnd &&
+             vmaxvq_u8(vceqq_u8(vld1q_u8((const uint8_t*)CurPtr), Slashes)) == 0)
+        CurPtr += 16;
+// HLSL Change End
 #else
       // Scan for '/' quickly.  Many block comments are very large.
       while (CurPtr[0] != '/' &&
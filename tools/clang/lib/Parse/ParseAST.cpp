@@ -23,7 +23,9 @@
 #include "clang/Sema/Sema.h"
 #include "clang/Sema/SemaConsumer.h"
 #include "clang/Sema/SemaHLSL.h" // HLSL Change
+#include "llvm/ADT/Optional.h" // HLSL Change
 #include "llvm/Support/CrashRecoveryContext.h"
+#include "llvm/Support/TimeProfiler.h" // HLSL Change
 #include <cstdio>
 #include <memory>
 
@@ -120,6 +122,12 @@ void clang::ParseAST(Sema &S, bool PrintStats, bool SkipFunctionBodies) {
   llvm::CrashRecoveryContextCleanupRegistrar<Parser>
     CleanupParser(ParseOP.get());
 
+  // HLSL Change Begin - trace parsing and semantic analysis apart from the
+  // translation unit handling (code generation) that follows.
+  llvm::Optional<llvm::TimeTraceScope> ParseTrace;
+  ParseTrace.emplace("Parse");
+  // HLSL Change End
+
   S.getPreprocessor().EnterMainSourceFile();
   P.Initialize();
 
@@ -156,6 +164,7 @@ void clang::ParseAST(Sema &S, bool PrintStats, bool SkipFunctionBodies) {
   // errors in the front-end, without relying on code generation being
   // available.
   hlsl::DiagnoseTranslationUnit(&S);
+  ParseTrace.reset();
   // HLSL Change Ends
   Consumer->HandleTranslationUnit(S.getASTContext());
 
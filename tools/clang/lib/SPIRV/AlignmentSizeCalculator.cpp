@@ -276,6 +276,14 @@ std::pair<uint32_t, uint32_t> AlignmentSizeCalculator::getAlignmentAndSize(
     if (structType->getDecl()->field_empty() && !hasBaseStructs)
       return {1, 0};
 
+    // The same struct is laid out once per decl that uses it; every field is
+    // visited recursively each time, so reuse an earlier result. Only
+    // error-free results are stored, so diagnostics are not lost.
+    if (spvContext)
+      if (const auto *cached =
+              spvContext->getStructAlignmentAndSize(type, rule, isRowMajor))
+        return *cached;
+
     uint32_t maxAlignment = 0;
     uint32_t structSize = 0;
 
@@ -331,24 +339,27 @@ std::pair<uint32_t, uint32_t> AlignmentSizeCalculator::getAlignmentAndSize(
       structSize += memberSize;
     }
 
-    if (rule == SpirvLayoutRule::Scalar) {
-      // A structure has a scalar alignment equal to the largest scalar
-      // alignment of any of its members in VK_EXT_scalar_block_layout.
-      return {maxAlignment, structSize};
-    }
+    // A structure has a scalar alignment equal to the largest scalar
+    // alignment of any of its members in VK_EXT_scalar_block_layout.
+    if (rule != SpirvLayoutRule::Scalar) {
+      if (rule == SpirvLayoutRule::GLSLStd140 ||
+          rule == SpirvLayoutRule::RelaxedGLSLStd140 ||
+          rule == SpirvLayoutRule::FxcCTBuffer) {
+        // ... and rounded up to the base alignment of a vec4.
+        maxAlignment = roundToPow2(maxAlignment, kStd140Vec4Alignment);
+      }
 
-    if (rule == SpirvLayoutRule::GLSLStd140 ||
-        rule == SpirvLayoutRule::RelaxedGLSLStd140 ||
-        rule == SpirvLayoutRule::FxcCTBuffer) {
-      // ... and rounded up to the base alignment of a vec4.
-      maxAlignment = roundToPow2(maxAlignment, kStd140Vec4Alignment);
+      if (rule != SpirvLayoutRule::FxcCTBuffer) {
+        // The base offset of the member following the sub-structure is
+        // rounded up to the next multiple of the base alignment of the
+        // structure.
+        structSize = roundToPow2(structSize, maxAlignment);
+      }
     }
 
-    if (rule != SpirvLayoutRule::FxcCTBuffer) {
-      // The base offset of the member following the sub-structure is rounded
-      // up to the next multiple of the base alignment of the structure.
-      structSize = roundToPow2(structSize, maxAlignment);
-    }
+    if (spvContext && !astContext.getDiagnostics().hasErrorOccurred())
+      spvContext->setStructAlignmentAndSize(type, rule, isRowMajor,
+                                            {maxAlignment, structSize});
     return {maxAlignment, structSize};
   }
 
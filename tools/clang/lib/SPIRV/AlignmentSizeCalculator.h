@@ -13,6 +13,7 @@
 #include "dxc/Support/SPIRVOptions.h"
 #include "clang/AST/ASTContext.h"
 #include "clang/SPIRV/AstTypeProbe.h"
+#include "clang/SPIRV/SpirvContext.h"
 
 namespace clang {
 namespace spirv {
@@ -20,8 +21,10 @@ namespace spirv {
 /// The class responsible to translate Clang frontend types into SPIR-V types.
 class AlignmentSizeCalculator {
 public:
-  AlignmentSizeCalculator(ASTContext &astCtx, const SpirvCodeGenOptions &opts)
-      : astContext(astCtx), spvOptions(opts) {}
+  /// If |spvCtx| is given, struct layouts are memoized in it.
+  AlignmentSizeCalculator(ASTContext &astCtx, const SpirvCodeGenOptions &opts,
+                          SpirvContext *spvCtx = nullptr)
+      : astContext(astCtx), spvOptions(opts), spvContext(spvCtx) {}
 
   /// \brief Returns the alignment and size in bytes for the given type
   /// according to the given LayoutRule. If the caller has information about
@@ -69,6 +72,7 @@ private:
 private:
   ASTContext &astContext;                /// AST context
   const SpirvCodeGenOptions &spvOptions; /// SPIR-V options
+  SpirvContext *spvContext;              /// Struct layout cache, may be null
 };
 
 } // end namespace spirv
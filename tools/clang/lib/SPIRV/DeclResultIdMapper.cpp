@@ -2981,7 +2981,7 @@ bool DeclResultIdMapper::createPayloadStageVars(
   // and we need to load/store these individual member variables.
   const auto *structDecl = type->getAs<RecordType>()->getDecl();
   llvm::SmallVector<SpirvInstruction *, 4> subValues;
-  AlignmentSizeCalculator alignmentCalc(astContext, spirvOptions);
+  AlignmentSizeCalculator alignmentCalc(astContext, spirvOptions, &spvContext);
   uint32_t nextMemberOffset = 0;
 
   for (const auto *field : structDecl->fields()) {
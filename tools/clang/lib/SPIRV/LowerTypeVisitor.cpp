@@ -440,6 +440,16 @@ const SpirvType *LowerTypeVisitor::lowerType(QualType type,
       return spvType;
     }
 
+    // Structs used by many decls would otherwise have every field lowered
+    // and laid out again each time.
+    if (const auto *cached =
+            spvContext.getLoweredStruct(type, rule, isRowMajor)) {
+      useArrayForMat1xN |= cached->usesArrayForMat1xN;
+      return cached->type;
+    }
+    const bool usedArrayForMat1xN = useArrayForMat1xN;
+    useArrayForMat1xN = false;
+
     // Collect all fields' information.
     llvm::SmallVector<HybridStructType::FieldInfo, 8> fields;
 
@@ -466,6 +476,12 @@ const SpirvType *LowerTypeVisitor::lowerType(QualType type,
     const auto *spvStructType =
         spvContext.getStructType(loweredFields, decl->getName());
     spvContext.registerStructDeclForSpirvType(spvStructType, decl);
+    // Struct layout problems are diagnosed while lowering, so only error-free
+    // results are reused.
+    if (!astContext.getDiagnostics().hasErrorOccurred())
+      spvContext.setLoweredStruct(type, rule, isRowMajor,
+                                  {spvStructType, useArrayForMat1xN});
+    useArrayForMat1xN |= usedArrayForMat1xN;
     return spvStructType;
   }
 
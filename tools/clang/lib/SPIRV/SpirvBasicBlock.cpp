@@ -14,19 +14,45 @@ namespace clang {
 namespace spirv {
 
 SpirvBasicBlock::SpirvBasicBlock(llvm::StringRef name)
-    : labelId(0), labelName(name), mergeTarget(nullptr),
-      continueTarget(nullptr), debugScope(nullptr) {}
+    : labelId(0), labelName(name), firstInstruction(nullptr),
+      lastInstruction(nullptr), mergeTarget(nullptr), continueTarget(nullptr),
+      debugScope(nullptr) {}
 
 SpirvBasicBlock::~SpirvBasicBlock() {
-  for (auto instructionNode : instructions)
-    instructionNode.instruction->releaseMemory();
+  for (SpirvInstruction *inst = firstInstruction; inst;) {
+    // Releasing the instruction invalidates its link.
+    SpirvInstruction *next = inst->nextInBasicBlock;
+    inst->releaseMemory();
+    inst = next;
+  }
   if (debugScope)
     debugScope->releaseMemory();
 }
 
+void SpirvBasicBlock::addInstruction(SpirvInstruction *inst) {
+  assert(!inst->prevInBasicBlock && !inst->nextInBasicBlock &&
+         inst != firstInstruction && "instruction already in a basic block");
+  inst->prevInBasicBlock = lastInstruction;
+  if (lastInstruction)
+    lastInstruction->nextInBasicBlock = inst;
+  else
+    firstInstruction = inst;
+  lastInstruction = inst;
+}
+
+void SpirvBasicBlock::addFirstInstruction(SpirvInstruction *inst) {
+  assert(!inst->prevInBasicBlock && !inst->nextInBasicBlock &&
+         inst != firstInstruction && "instruction already in a basic block");
+  inst->nextInBasicBlock = firstInstruction;
+  if (firstInstruction)
+    firstInstruction->prevInBasicBlock = inst;
+  else
+    lastInstruction = inst;
+  firstInstruction = inst;
+}
+
 bool SpirvBasicBlock::hasTerminator() const {
-  return !instructions.empty() &&
-         isa<SpirvTerminator>(instructions.back().instruction);
+  return lastInstruction && isa<SpirvTerminator>(lastInstruction);
 }
 
 bool SpirvBasicBlock::invokeVisitor(
@@ -54,9 +80,9 @@ bool SpirvBasicBlock::invokeVisitor(
   }
 
   if (reverseOrder) {
-    for (auto iter = instructions.rbegin(); iter != instructions.rend();
-         ++iter) {
-      if (!iter->instruction->invokeVisitor(visitor))
+    for (SpirvInstruction *inst = lastInstruction; inst;
+         inst = inst->prevInBasicBlock) {
+      if (!inst->invokeVisitor(visitor))
         return false;
     }
     // For NonSemantic.Shader.DebugInfo.100 emit the block's scope only if we
@@ -114,8 +140,9 @@ bool SpirvBasicBlock::invokeVisitor(
       }
     }
 
-    for (auto iter = instructions.begin(); iter != instructions.end(); ++iter) {
-      if (!iter->instruction->invokeVisitor(visitor))
+    for (SpirvInstruction *inst = firstInstruction; inst;
+         inst = inst->nextInBasicBlock) {
+      if (!inst->invokeVisitor(visitor))
         return false;
     }
   }
@@ -367,8 +367,9 @@ SpirvDebugType *SpirvContext::getDebugTypeBasic(const SpirvType *spirvType,
                                                 SpirvConstant *size,
                                                 uint32_t encoding) {
   // Reuse existing debug type if possible.
-  if (debugTypes.find(spirvType) != debugTypes.end())
-    return debugTypes[spirvType];
+  auto found = debugTypes.find(spirvType);
+  if (found != debugTypes.end())
+    return found->second;
 
   auto *debugType = new (this) SpirvDebugTypeBasic(name, size, encoding);
   debugTypes[spirvType] = debugType;
@@ -420,8 +421,9 @@ SpirvContext::getDebugTypeArray(const SpirvType *spirvType,
                                 SpirvDebugInstruction *elemType,
                                 llvm::ArrayRef<uint32_t> elemCount) {
   // Reuse existing debug type if possible.
-  if (debugTypes.find(spirvType) != debugTypes.end())
-    return debugTypes[spirvType];
+  auto found = debugTypes.find(spirvType);
+  if (found != debugTypes.end())
+    return found->second;
 
   auto *eTy = dyn_cast<SpirvDebugType>(elemType);
   assert(eTy && "Element type must be a SpirvDebugType.");
@@ -435,8 +437,9 @@ SpirvContext::getDebugTypeVector(const SpirvType *spirvType,
                                  SpirvDebugInstruction *elemType,
                                  uint32_t elemCount) {
   // Reuse existing debug type if possible.
-  if (debugTypes.find(spirvType) != debugTypes.end())
-    return debugTypes[spirvType];
+  auto found = debugTypes.find(spirvType);
+  if (found != debugTypes.end())
+    return found->second;
 
   auto *eTy = dyn_cast<SpirvDebugType>(elemType);
   assert(eTy && "Element type must be a SpirvDebugType.");
@@ -450,8 +453,9 @@ SpirvContext::getDebugTypeFunction(const SpirvType *spirvType, uint32_t flags,
                                    SpirvDebugType *ret,
                                    llvm::ArrayRef<SpirvDebugType *> params) {
   // Reuse existing debug type if possible.
-  if (debugTypes.find(spirvType) != debugTypes.end())
-    return debugTypes[spirvType];
+  auto found = debugTypes.find(spirvType);
+  if (found != debugTypes.end())
+    return found->second;
 
   auto *debugType = new (this) SpirvDebugTypeFunction(flags, ret, params);
   debugTypes[spirvType] = debugType;
@@ -639,6 +639,15 @@ SpirvEmitter::getInterfacesForEntryPoint(SpirvFunction *entryPoint) {
   return interfacesInVector;
 }
 
+// Aborts the compile, like the DXIL path does between passes, once the
+// -Qdeadline has passed. spirv-opt runs all of its passes in one call, so
+// the checks go around it rather than between its passes.
+static void checkDeadline(const SpirvCodeGenOptions &options) {
+  if (std::chrono::steady_clock::now() > options.deadline)
+    throw hlsl::Exception(E_ABORT,
+                          "compilation exceeded the -Qdeadline time limit");
+}
+
 void SpirvEmitter::HandleTranslationUnit(ASTContext &context) {
   // Stop translating if there are errors in previous compilation stages.
   if (context.getDiagnostics().hasErrorOccurred())
@@ -685,6 +694,7 @@ void SpirvEmitter::HandleTranslationUnit(ASTContext &context) {
     doDecl(curEntryOrCallee->funcDecl);
     if (context.getDiagnostics().hasErrorOccurred())
       return;
+    checkDeadline(spirvOptions);
   }
 
   // Addressing and memory model are required in a valid SPIR-V module.
@@ -752,36 +762,41 @@ void SpirvEmitter::HandleTranslationUnit(ASTContext &context) {
   if (spirvOptions.codeGenHighLevel) {
     beforeHlslLegalization = needsLegalization;
   } else {
-    // Run legalization passes
-    if (needsLegalization) {
+    // Run legalization and optimization passes. Both are registered on the
+    // same optimizer so the module is only parsed and serialized once.
+    const bool needsOptimization =
+        theCompilerInstance.getCodeGenOpts().OptimizationLevel > 0;
+    if (needsLegalization || needsOptimization) {
       std::string messages;
-      if (!spirvToolsLegalize(&m, &messages,
-                              &dsetbindingsToCombineImageSampler)) {
-        emitFatalError("failed to legalize SPIR-V: %0", {}) << messages;
-        emitNote("please file a bug report on "
-                 "https://github.com/Microsoft/DirectXShaderCompiler/issues "
-                 "with source code if possible",
-                 {});
-        return;
-      } else if (!messages.empty()) {
-        emitWarning("SPIR-V legalization: %0", {}) << messages;
-      }
-    }
-
-    // Run optimization passes
-    if (theCompilerInstance.getCodeGenOpts().OptimizationLevel > 0) {
-      std::string messages;
-      if (!spirvToolsOptimize(&m, &messages)) {
-        emitFatalError("failed to optimize SPIR-V: %0", {}) << messages;
+      bool invalidFlags = false;
+      if (!spirvToolsLegalizeAndOptimize(&m, &messages, needsLegalization,
+                                         needsOptimization,
+                                         &dsetbindingsToCombineImageSampler,
+                                         &invalidFlags)) {
+        // Legalization passes run first, so report a failure against them
+        // whenever they were part of the run.
+        if (needsLegalization && !invalidFlags)
+          emitFatalError("failed to legalize SPIR-V: %0", {}) << messages;
+        else
+          emitFatalError("failed to optimize SPIR-V: %0", {}) << messages;
         emitNote("please file a bug report on "
                  "https://github.com/Microsoft/DirectXShaderCompiler/issues "
                  "with source code if possible",
                  {});
         return;
+      } else if (needsLegalization && !messages.empty()) {
+        // Messages from the combined run cannot be told apart by pass.
+        if (needsOptimization)
+          emitWarning("SPIR-V legalization and optimization: %0", {})
+              << messages;
+        else
+          emitWarning("SPIR-V legalization: %0", {}) << messages;
       }
     }
   }
 
+  checkDeadline(spirvOptions);
+
   // Validate the generated SPIR-V code
   if (!spirvOptions.disableValidation) {
     std::string messages;
@@ -3384,7 +3399,8 @@ SpirvEmitter::processByteAddressBufferStructuredBufferGetDimensions(
   if (isStructuredBuf) {
     // For (RW)StructuredBuffer, the stride of the runtime array (which is the
     // size of the struct) must also be written to the second argument.
-    AlignmentSizeCalculator alignmentCalc(astContext, spirvOptions);
+    AlignmentSizeCalculator alignmentCalc(astContext, spirvOptions,
+                                          &spvContext);
     uint32_t size = 0, stride = 0;
     std::tie(std::ignore, size) =
         alignmentCalc.getAlignmentAndSize(type, spirvOptions.sBufferLayoutRule,
@@ -12950,85 +12966,88 @@ bool SpirvEmitter::spirvToolsValidate(std::vector<uint32_t> *mod,
   return tools.Validate(mod->data(), mod->size(), options);
 }
 
-bool SpirvEmitter::spirvToolsOptimize(std::vector<uint32_t> *mod,
-                                      std::string *messages) {
+bool SpirvEmitter::spirvToolsLegalizeAndOptimize(
+    std::vector<uint32_t> *mod, std::string *messages, bool legalize,
+    bool optimize,
+    const std::vector<DescriptorSetAndBinding>
+        *dsetbindingsToCombineImageSampler,
+    bool *invalidFlags) {
   spvtools::Optimizer optimizer(featureManager.getTargetEnv());
-
   optimizer.SetMessageConsumer(
       [messages](spv_message_level_t /*level*/, const char * /*source*/,
                  const spv_position_t & /*position*/,
                  const char *message) { *messages += message; });
 
+  if (legalize)
+    registerSpirvToolsLegalizationPasses(&optimizer,
+                                         dsetbindingsToCombineImageSampler);
+
+  *invalidFlags = optimize && !registerSpirvToolsOptimizationPasses(&optimizer);
+  if (*invalidFlags)
+    return false;
+
   spvtools::OptimizerOptions options;
   options.set_run_validator(false);
+  return optimizer.Run(mod->data(), mod->size(), mod, options);
+}
 
+bool SpirvEmitter::registerSpirvToolsOptimizationPasses(
+    spvtools::Optimizer *optimizer) {
   if (spirvOptions.optConfig.empty()) {
     // Add performance passes.
-    optimizer.RegisterPerformancePasses();
+    optimizer->RegisterPerformancePasses();
 
     // Add propagation of volatile semantics passes.
-    optimizer.RegisterPass(spvtools::CreateSpreadVolatileSemanticsPass());
+    optimizer->RegisterPass(spvtools::CreateSpreadVolatileSemanticsPass());
 
     // Add compact ID pass.
-    optimizer.RegisterPass(spvtools::CreateCompactIdsPass());
-  } else {
-    // Command line options use llvm::SmallVector and llvm::StringRef, whereas
-    // SPIR-V optimizer uses std::vector and std::string.
-    std::vector<std::string> stdFlags;
-    for (const auto &f : spirvOptions.optConfig)
-      stdFlags.push_back(f.str());
-    if (!optimizer.RegisterPassesFromFlags(stdFlags))
-      return false;
+    optimizer->RegisterPass(spvtools::CreateCompactIdsPass());
+    return true;
   }
 
-  return optimizer.Run(mod->data(), mod->size(), mod, options);
+  // Command line options use llvm::SmallVector and llvm::StringRef, whereas
+  // SPIR-V optimizer uses std::vector and std::string.
+  std::vector<std::string> stdFlags;
+  for (const auto &f : spirvOptions.optConfig)
+    stdFlags.push_back(f.str());
+  return optimizer->RegisterPassesFromFlags(stdFlags);
 }
 
-bool SpirvEmitter::spirvToolsLegalize(std::vector<uint32_t> *mod,
-                                      std::string *messages,
-                                      const std::vector<DescriptorSetAndBinding>
-                                          *dsetbindingsToCombineImageSampler) {
-  spvtools::Optimizer optimizer(featureManager.getTargetEnv());
-  optimizer.SetMessageConsumer(
-      [messages](spv_message_level_t /*level*/, const char * /*source*/,
-                 const spv_position_t & /*position*/,
-                 const char *message) { *messages += message; });
-
-  spvtools::OptimizerOptions options;
-  options.set_run_validator(false);
-  optimizer.RegisterLegalizationPasses();
+void SpirvEmitter::registerSpirvToolsLegalizationPasses(
+    spvtools::Optimizer *optimizer,
+    const std::vector<DescriptorSetAndBinding>
+        *dsetbindingsToCombineImageSampler) {
+  optimizer->RegisterLegalizationPasses();
   // Add flattening of resources if needed.
   if (spirvOptions.flattenResourceArrays ||
       declIdMapper.requiresFlatteningCompositeResources()) {
-    optimizer.RegisterPass(
+    optimizer->RegisterPass(
         spvtools::CreateReplaceDescArrayAccessUsingVarIndexPass());
-    optimizer.RegisterPass(spvtools::CreateAggressiveDCEPass());
-    optimizer.RegisterPass(spvtools::CreateDescriptorScalarReplacementPass());
+    optimizer->RegisterPass(spvtools::CreateAggressiveDCEPass());
+    optimizer->RegisterPass(spvtools::CreateDescriptorScalarReplacementPass());
     // ADCE should be run after desc_sroa in order to remove potentially
     // illegal types such as structures containing opaque types.
-    optimizer.RegisterPass(spvtools::CreateAggressiveDCEPass());
+    optimizer->RegisterPass(spvtools::CreateAggressiveDCEPass());
   }
   if (dsetbindingsToCombineImageSampler &&
       !dsetbindingsToCombineImageSampler->empty()) {
-    optimizer.RegisterPass(spvtools::CreateConvertToSampledImagePass(
+    optimizer->RegisterPass(spvtools::CreateConvertToSampledImagePass(
         *dsetbindingsToCombineImageSampler));
     // ADCE should be run after combining images and samplers in order to
     // remove potentially illegal types such as structures containing opaque
     // types.
-    optimizer.RegisterPass(spvtools::CreateAggressiveDCEPass());
+    optimizer->RegisterPass(spvtools::CreateAggressiveDCEPass());
   }
   if (spirvOptions.reduceLoadSize) {
     // The threshold must be bigger than 1.0 to reduce all possible loads.
-    optimizer.RegisterPass(spvtools::CreateReduceLoadSizePass(1.1));
+    optimizer->RegisterPass(spvtools::CreateReduceLoadSizePass(1.1));
     // ADCE should be run after reduce-load-size pass in order to remove
     // dead instructions.
-    optimizer.RegisterPass(spvtools::CreateAggressiveDCEPass());
+    optimizer->RegisterPass(spvtools::CreateAggressiveDCEPass());
   }
-  optimizer.RegisterPass(spvtools::CreateReplaceInvalidOpcodePass());
-  optimizer.RegisterPass(spvtools::CreateCompactIdsPass());
-  optimizer.RegisterPass(spvtools::CreateSpreadVolatileSemanticsPass());
-
-  return optimizer.Run(mod->data(), mod->size(), mod, options);
+  optimizer->RegisterPass(spvtools::CreateReplaceInvalidOpcodePass());
+  optimizer->RegisterPass(spvtools::CreateCompactIdsPass());
+  optimizer->RegisterPass(spvtools::CreateSpreadVolatileSemanticsPass());
 }
 
 SpirvInstruction *
@@ -13045,7 +13064,7 @@ SpirvEmitter::doUnaryExprOrTypeTraitExpr(const UnaryExprOrTypeTraitExpr *expr) {
     return constExpr;
   }
 
-  AlignmentSizeCalculator alignmentCalc(astContext, spirvOptions);
+  AlignmentSizeCalculator alignmentCalc(astContext, spirvOptions, &spvContext);
   uint32_t size = 0, stride = 0;
   std::tie(std::ignore, size) = alignmentCalc.getAlignmentAndSize(
       expr->getArgumentType(), SpirvLayoutRule::Scalar,
@@ -36,6 +36,8 @@
 #include "DeclResultIdMapper.h"
 
 namespace spvtools {
+class Optimizer;
+
 namespace opt {
 
 // A struct for a pair of descriptor set and binding.
@@ -1086,22 +1088,30 @@ private:
                               const clang::FunctionDecl *,
                               bool isEntryFunction);
 
-  /// \brief Helper function to run SPIRV-Tools optimizer's performance passes.
-  /// Runs the SPIRV-Tools optimizer on the given SPIR-V module |mod|, and
-  /// gets the info/warning/error messages via |messages|.
+  /// \brief Helper function to run SPIRV-Tools legalization and/or
+  /// performance passes on the given SPIR-V module |mod| in a single
+  /// optimizer run, and get the info/warning/error messages via |messages|.
+  /// Sets |invalidFlags| if the -Oconfig flags could not be parsed.
   /// Returns true on success and false otherwise.
-  bool spirvToolsOptimize(std::vector<uint32_t> *mod, std::string *messages);
-
-  /// \brief Helper function to run SPIRV-Tools optimizer's legalization passes.
-  /// Runs the SPIRV-Tools legalization on the given SPIR-V module |mod|, and
-  /// gets the info/warning/error messages via |messages|. If
-  /// |dsetbindingsToCombineImageSampler| is not empty, runs
-  /// --convert-to-sampled-image pass.
-  /// Returns true on success and false otherwise.
-  bool
-  spirvToolsLegalize(std::vector<uint32_t> *mod, std::string *messages,
-                     const std::vector<spvtools::opt::DescriptorSetAndBinding>
-                         *dsetbindingsToCombineImageSampler);
+  bool spirvToolsLegalizeAndOptimize(
+      std::vector<uint32_t> *mod, std::string *messages, bool legalize,
+      bool optimize,
+      const std::vector<spvtools::opt::DescriptorSetAndBinding>
+          *dsetbindingsToCombineImageSampler,
+      bool *invalidFlags);
+
+  /// \brief Helper function to register SPIRV-Tools optimizer's performance
+  /// passes, or the passes given by -Oconfig, on |optimizer|.
+  /// Returns false if the -Oconfig flags could not be parsed.
+  bool registerSpirvToolsOptimizationPasses(spvtools::Optimizer *optimizer);
+
+  /// \brief Helper function to register SPIRV-Tools optimizer's legalization
+  /// passes on |optimizer|. If |dsetbindingsToCombineImageSampler| is not
+  /// empty, also registers the --convert-to-sampled-image pass.
+  void registerSpirvToolsLegalizationPasses(
+      spvtools::Optimizer *optimizer,
+      const std::vector<spvtools::opt::DescriptorSetAndBinding>
+          *dsetbindingsToCombineImageSampler);
 
   /// \brief Helper function to run the SPIRV-Tools validator.
   /// Runs the SPIRV-Tools validator on the given SPIR-V module |mod|, and
@@ -44,6 +44,7 @@
 #include <array>
 #include <algorithm>
 #include <float.h>
+#include <map>
 
 enum ArBasicKind {
   AR_BASIC_BOOL,
@@ -2613,6 +2614,36 @@ public:
   }
 };
 
+// Hash used by the generated intrinsic name indices; must match
+// hash_hlsl_intrinsic_name in hctdb_instrhelp.py.
+static uint32_t HashIntrinsicName(StringRef name, uint32_t seed) {
+  uint32_t h = 2166136261u ^ seed;
+  for (unsigned char c : name) {
+    h ^= c;
+    h *= 16777619u;
+  }
+  h ^= h >> 16;
+  h *= 0x85EBCA6Bu;
+  h ^= h >> 13;
+  h *= 0xC2B2AE35u;
+  h ^= h >> 16;
+  return h;
+}
+
+// Returns the run of entries in table named name, or nullptr if there are
+// none.
+static const HLSL_INTRINSIC_NAME_RANGE *
+LookupIntrinsicName(const HLSL_INTRINSIC_NAME_INDEX &index,
+                    const HLSL_INTRINSIC *table, StringRef name) {
+  uint32_t seed =
+      index.pSeeds[HashIntrinsicName(name, 0) & (index.uSeedCount - 1)];
+  const HLSL_INTRINSIC_NAME_RANGE &slot =
+      index.pSlots[HashIntrinsicName(name, seed) & (index.uSlotCount - 1)];
+  if (slot.uCount == 0 || !name.equals(table[slot.uStart].pArgs[0].pName))
+    return nullptr;
+  return &slot;
+}
+
 /// <summary>
 /// Use this class to iterate over intrinsic definitions that have the same name and parameter count.
 /// </summary>
@@ -3103,6 +3134,36 @@ private:
 
   UsedIntrinsicStore m_usedIntrinsics;
 
+  // Intrinsic method deductions, keyed on the canonical method template,
+  // the explicit template type argument and the type of each call argument.
+  // A deduction only depends on these when no argument is a literal.
+  struct IntrinsicMethodDeduction {
+    FunctionDecl *Specialization;
+    LPCSTR TableName;
+    const HLSL_INTRINSIC *Intrinsic;
+  };
+  typedef llvm::SmallVector<const void *, g_MaxIntrinsicParamCount + 2>
+      IntrinsicMethodDeductionKey;
+  std::map<IntrinsicMethodDeductionKey, IntrinsicMethodDeduction>
+      m_intrinsicMethodDeductions;
+
+  // Outcomes of CanConvert between scalar, vector and matrix types, which
+  // only depend on the structural forms of the two types. Indexed by
+  // whether the conversion is explicit, then keyed on (source, target).
+  struct NumericConversion {
+    bool Allowed;
+    ImplicitConversionKind Second;
+    ImplicitConversionKind ComponentConversion;
+    TYPE_CONVERSION_REMARKS Remarks;
+    ArTypeObjectKind TargetShapeKind;
+  };
+  typedef llvm::DenseMap<std::pair<void *, void *>, NumericConversion>
+      NumericConversionMap;
+  NumericConversionMap m_numericConversions[2];
+
+  // ScoreCast results, keyed on (left, right).
+  llvm::DenseMap<std::pair<void *, void *>, UINT64> m_castScores;
+
   /// <summary>Add all base QualTypes for each hlsl scalar types.</summary>
   void AddBaseTypes();
 
@@ -3543,120 +3604,184 @@ private:
   }
 #endif // ENABLE_SPIRV_CODEGEN
 
-  // Adds all built-in HLSL object types.
+  // Returns true if the built-in object type of the given kind is only
+  // declared when its name is first looked up or its type is first needed.
+  // Types with other side effects (descriptor heap globals, vk namespace
+  // members, the effect object placeholder) are declared up front.
+  static bool IsObjectTypeDeclaredOnDemand(ArBasicKind kind) {
+    switch (kind) {
+    case AR_OBJECT_WAVE:
+    case AR_OBJECT_LEGACY_EFFECT:
+    case AR_OBJECT_HEAP_RESOURCE:
+    case AR_OBJECT_HEAP_SAMPLER:
+#ifdef ENABLE_SPIRV_CODEGEN
+    case AR_OBJECT_VK_SPV_INTRINSIC_TYPE:
+    case AR_OBJECT_VK_SPV_INTRINSIC_RESULT_ID:
+#endif
+      return false;
+    default:
+      return true;
+    }
+  }
+
+  // Finds the index of the on-demand object type with the given name, or -1.
+  static int FindOnDemandObjectTypeIndex(StringRef name) {
+    for (unsigned i = 0; i < _countof(g_ArBasicKindsAsTypes); i++) {
+      ArBasicKind kind = g_ArBasicKindsAsTypes[i];
+      if (IsObjectTypeDeclaredOnDemand(kind) && name == g_ArBasicTypeNames[kind])
+        return i;
+    }
+    return -1;
+  }
+
+  // Adds an entry to m_objectTypeDeclsMap, keeping it sorted. Unused entries
+  // are null and sort first, so the first entry is free while any are left.
+  void AddObjectTypeDeclMapEntry(CXXRecordDecl *recordDecl, unsigned index) {
+    DXASSERT(m_objectTypeDeclsMap.front().first == nullptr,
+             "otherwise more decls were added than the map has room for");
+    auto entry = std::make_pair(recordDecl, index);
+    auto begin = m_objectTypeDeclsMap.begin();
+    auto pos = std::lower_bound(begin + 1, m_objectTypeDeclsMap.end(), entry,
+                                ObjectTypeDeclMapTypeCmp);
+    std::move(begin + 1, pos, begin);
+    *(pos - 1) = entry;
+  }
+
+  // Creates the declaration for the built-in object type at the given index
+  // of g_ArBasicKindsAsTypes.
+  CXXRecordDecl *CreateObjectTypeDecl(unsigned i) {
+    ArBasicKind kind = g_ArBasicKindsAsTypes[i];
+    DXASSERT(kind < _countof(g_ArBasicTypeNames), "g_ArBasicTypeNames has the wrong number of entries");
+    _Analysis_assume_(kind < _countof(g_ArBasicTypeNames));
+    const char* typeName = g_ArBasicTypeNames[kind];
+    uint8_t templateArgCount = g_ArBasicKindsTemplateCount[i];
+    const auto *SM =
+        hlsl::ShaderModel::GetByName(m_sema->getLangOpts().HLSLProfile.c_str());
+    CXXRecordDecl* recordDecl = nullptr;
+    if (kind == AR_OBJECT_RAY_DESC) {
+      QualType float3Ty = LookupVectorType(HLSLScalarType::HLSLScalarType_float, 3);
+      recordDecl = CreateRayDescStruct(*m_context, float3Ty);
+    } else if (kind == AR_OBJECT_TRIANGLE_INTERSECTION_ATTRIBUTES) {
+      QualType float2Type = LookupVectorType(HLSLScalarType::HLSLScalarType_float, 2);
+      recordDecl = AddBuiltInTriangleIntersectionAttributes(*m_context, float2Type);
+    } else if (IsSubobjectBasicKind(kind)) {
+      switch (kind) {
+      case AR_OBJECT_STATE_OBJECT_CONFIG:
+        recordDecl = CreateSubobjectStateObjectConfig(*m_context);
+        break;
+      case AR_OBJECT_GLOBAL_ROOT_SIGNATURE:
+        recordDecl = CreateSubobjectRootSignature(*m_context, true);
+        break;
+      case AR_OBJECT_LOCAL_ROOT_SIGNATURE:
+        recordDecl = CreateSubobjectRootSignature(*m_context, false);
+        break;
+      case AR_OBJECT_SUBOBJECT_TO_EXPORTS_ASSOC:
+        recordDecl = CreateSubobjectSubobjectToExportsAssoc(*m_context);
+        break;
+      case AR_OBJECT_RAYTRACING_SHADER_CONFIG:
+        recordDecl = CreateSubobjectRaytracingShaderConfig(*m_context);
+        break;
+      case AR_OBJECT_RAYTRACING_PIPELINE_CONFIG:
+        recordDecl = CreateSubobjectRaytracingPipelineConfig(*m_context);
+        break;
+      case AR_OBJECT_TRIANGLE_HIT_GROUP:
+        recordDecl = CreateSubobjectTriangleHitGroup(*m_context);
+        break;
+      case AR_OBJECT_PROCEDURAL_PRIMITIVE_HIT_GROUP:
+        recordDecl = CreateSubobjectProceduralPrimitiveHitGroup(*m_context);
+        break;
+      case AR_OBJECT_RAYTRACING_PIPELINE_CONFIG1:
+        recordDecl = CreateSubobjectRaytracingPipelineConfig1(*m_context);
+        break;
+      }
+    } else if (kind == AR_OBJECT_CONSTANT_BUFFER) {
+      recordDecl = DeclareConstantBufferViewType(*m_context, /*bTBuf*/false);
+    } else if (kind == AR_OBJECT_TEXTURE_BUFFER) {
+      recordDecl = DeclareConstantBufferViewType(*m_context, /*bTBuf*/true);
+    } else if (kind == AR_OBJECT_RAY_QUERY) {
+      recordDecl = DeclareRayQueryType(*m_context);
+    } else if (kind == AR_OBJECT_HEAP_RESOURCE) {
+      recordDecl = DeclareResourceType(*m_context, /*bSampler*/false);
+      if (SM->IsSM66Plus()) {
+        // create Resource ResourceDescriptorHeap;
+        DeclareBuiltinGlobal("ResourceDescriptorHeap",
+                             m_context->getRecordType(recordDecl), *m_context);
+      }
+    } else if (kind == AR_OBJECT_HEAP_SAMPLER) {
+      recordDecl = DeclareResourceType(*m_context, /*bSampler*/true);
+      if (SM->IsSM66Plus()) {
+        // create Resource SamplerDescriptorHeap;
+        DeclareBuiltinGlobal("SamplerDescriptorHeap",
+                             m_context->getRecordType(recordDecl), *m_context);
+      }
+
+    }
+    else if (kind == AR_OBJECT_FEEDBACKTEXTURE2D) {
+      recordDecl = DeclareUIntTemplatedTypeWithHandle(*m_context, "FeedbackTexture2D", "kind");
+    }
+    else if (kind == AR_OBJECT_FEEDBACKTEXTURE2D_ARRAY) {
+      recordDecl = DeclareUIntTemplatedTypeWithHandle(*m_context, "FeedbackTexture2DArray", "kind");
+    }
+#ifdef ENABLE_SPIRV_CODEGEN
+    else if (kind == AR_OBJECT_VK_SPV_INTRINSIC_TYPE && m_vkNSDecl) {
+      recordDecl = DeclareUIntTemplatedTypeWithHandleInDeclContext(
+          *m_context, m_vkNSDecl, typeName, "id");
+      recordDecl->setImplicit(true);
+    }
+    else if (kind == AR_OBJECT_VK_SPV_INTRINSIC_RESULT_ID && m_vkNSDecl) {
+      recordDecl = DeclareTemplateTypeWithHandleInDeclContext(*m_context,
+                                                              m_vkNSDecl,
+                                                              typeName, 1,
+                                                              nullptr);
+      recordDecl->setImplicit(true);
+    }
+#endif
+    else if (templateArgCount == 0) {
+      recordDecl = DeclareRecordTypeWithHandle(*m_context, typeName);
+    } else {
+      DXASSERT(templateArgCount == 1 || templateArgCount == 2, "otherwise a new case has been added");
+
+      TypeSourceInfo* typeDefault = nullptr;
+      if (TemplateHasDefaultType(kind)) {
+        QualType float4Type = LookupVectorType(HLSLScalarType_float, 4);
+        typeDefault = m_context->getTrivialTypeSourceInfo(float4Type, NoLoc);
+      }
+      recordDecl = DeclareTemplateTypeWithHandle(*m_context, typeName, templateArgCount, typeDefault);
+    }
+    return recordDecl;
+  }
+
+  // Returns the declaration for the built-in object type at the given index
+  // of g_ArBasicKindsAsTypes, creating it on first use.
+  CXXRecordDecl *GetOrCreateObjectTypeDecl(unsigned i) {
+    CXXRecordDecl *recordDecl = m_objectTypeDecls[i];
+    if (recordDecl != nullptr || g_ArBasicKindsAsTypes[i] == AR_OBJECT_WAVE)
+      return recordDecl;
+
+    recordDecl = CreateObjectTypeDecl(i);
+    m_objectTypeDecls[i] = recordDecl;
+    AddObjectTypeDeclMapEntry(recordDecl, i);
+    m_objectTypeLazyInitMask |= ((uint64_t)1)<<i;
+    for (auto &&table : m_intrinsicTables) {
+      AddIntrinsicTableMethods(table, i);
+    }
+    return recordDecl;
+  }
+
+  // Adds the built-in HLSL object types that are not declared on demand.
   void AddObjectTypes()
   {
     DXASSERT(m_context != nullptr, "otherwise caller hasn't initialized context yet");
 
-    QualType float4Type = LookupVectorType(HLSLScalarType_float, 4);
-    TypeSourceInfo *float4TypeSourceInfo = m_context->getTrivialTypeSourceInfo(float4Type, NoLoc);
     m_objectTypeLazyInitMask = 0;
     unsigned effectKindIndex = 0;
-    const auto *SM =
-        hlsl::ShaderModel::GetByName(m_sema->getLangOpts().HLSLProfile.c_str());
     for (unsigned i = 0; i < _countof(g_ArBasicKindsAsTypes); i++)
     {
       ArBasicKind kind = g_ArBasicKindsAsTypes[i];
-      if (kind == AR_OBJECT_WAVE) { // wave objects are currently unused
-        continue;
-      }
       if (kind == AR_OBJECT_LEGACY_EFFECT)
         effectKindIndex = i;
-
-      DXASSERT(kind < _countof(g_ArBasicTypeNames), "g_ArBasicTypeNames has the wrong number of entries");
-      _Analysis_assume_(kind < _countof(g_ArBasicTypeNames));
-      const char* typeName = g_ArBasicTypeNames[kind];
-      uint8_t templateArgCount = g_ArBasicKindsTemplateCount[i];
-      CXXRecordDecl* recordDecl = nullptr;
-      if (kind == AR_OBJECT_RAY_DESC) {
-        QualType float3Ty = LookupVectorType(HLSLScalarType::HLSLScalarType_float, 3);
-        recordDecl = CreateRayDescStruct(*m_context, float3Ty);
-      } else if (kind == AR_OBJECT_TRIANGLE_INTERSECTION_ATTRIBUTES) {
-        QualType float2Type = LookupVectorType(HLSLScalarType::HLSLScalarType_float, 2);
-        recordDecl = AddBuiltInTriangleIntersectionAttributes(*m_context, float2Type);
-      } else if (IsSubobjectBasicKind(kind)) {
-        switch (kind) {
-        case AR_OBJECT_STATE_OBJECT_CONFIG:
-          recordDecl = CreateSubobjectStateObjectConfig(*m_context);
-          break;
-        case AR_OBJECT_GLOBAL_ROOT_SIGNATURE:
-          recordDecl = CreateSubobjectRootSignature(*m_context, true);
-          break;
-        case AR_OBJECT_LOCAL_ROOT_SIGNATURE:
-          recordDecl = CreateSubobjectRootSignature(*m_context, false);
-          break;
-        case AR_OBJECT_SUBOBJECT_TO_EXPORTS_ASSOC:
-          recordDecl = CreateSubobjectSubobjectToExportsAssoc(*m_context);
-          break;
-        case AR_OBJECT_RAYTRACING_SHADER_CONFIG:
-          recordDecl = CreateSubobjectRaytracingShaderConfig(*m_context);
-          break;
-        case AR_OBJECT_RAYTRACING_PIPELINE_CONFIG:
-          recordDecl = CreateSubobjectRaytracingPipelineConfig(*m_context);
-          break;
-        case AR_OBJECT_TRIANGLE_HIT_GROUP:
-          recordDecl = CreateSubobjectTriangleHitGroup(*m_context);
-          break;
-        case AR_OBJECT_PROCEDURAL_PRIMITIVE_HIT_GROUP:
-          recordDecl = CreateSubobjectProceduralPrimitiveHitGroup(*m_context);
-          break;
-        case AR_OBJECT_RAYTRACING_PIPELINE_CONFIG1:
-          recordDecl = CreateSubobjectRaytracingPipelineConfig1(*m_context);
-          break;
-        }
-      } else if (kind == AR_OBJECT_CONSTANT_BUFFER) {
-        recordDecl = DeclareConstantBufferViewType(*m_context, /*bTBuf*/false);
-      } else if (kind == AR_OBJECT_TEXTURE_BUFFER) {
-        recordDecl = DeclareConstantBufferViewType(*m_context, /*bTBuf*/true);
-      } else if (kind == AR_OBJECT_RAY_QUERY) {
-        recordDecl = DeclareRayQueryType(*m_context);
-      } else if (kind == AR_OBJECT_HEAP_RESOURCE) {
-        recordDecl = DeclareResourceType(*m_context, /*bSampler*/false);
-        if (SM->IsSM66Plus()) {
-          // create Resource ResourceDescriptorHeap;
-          DeclareBuiltinGlobal("ResourceDescriptorHeap",
-                               m_context->getRecordType(recordDecl), *m_context);
-        }
-      } else if (kind == AR_OBJECT_HEAP_SAMPLER) {
-        recordDecl = DeclareResourceType(*m_context, /*bSampler*/true);
-        if (SM->IsSM66Plus()) {
-          // create Resource SamplerDescriptorHeap;
-          DeclareBuiltinGlobal("SamplerDescriptorHeap",
-                               m_context->getRecordType(recordDecl), *m_context);
-        }
-
-      }
-      else if (kind == AR_OBJECT_FEEDBACKTEXTURE2D) {
-        recordDecl = DeclareUIntTemplatedTypeWithHandle(*m_context, "FeedbackTexture2D", "kind");
-      }
-      else if (kind == AR_OBJECT_FEEDBACKTEXTURE2D_ARRAY) {
-        recordDecl = DeclareUIntTemplatedTypeWithHandle(*m_context, "FeedbackTexture2DArray", "kind");
-      }
-#ifdef ENABLE_SPIRV_CODEGEN
-      else if (kind == AR_OBJECT_VK_SPV_INTRINSIC_TYPE && m_vkNSDecl) {
-        recordDecl = DeclareUIntTemplatedTypeWithHandleInDeclContext(
-            *m_context, m_vkNSDecl, typeName, "id");
-        recordDecl->setImplicit(true);
-      }
-      else if (kind == AR_OBJECT_VK_SPV_INTRINSIC_RESULT_ID && m_vkNSDecl) {
-        recordDecl = DeclareTemplateTypeWithHandleInDeclContext(*m_context,
-                                                                m_vkNSDecl,
-                                                                typeName, 1,
-                                                                nullptr);
-        recordDecl->setImplicit(true);
-      }
-#endif
-      else if (templateArgCount == 0) {
-        recordDecl = DeclareRecordTypeWithHandle(*m_context, typeName);
-      } else {
-        DXASSERT(templateArgCount == 1 || templateArgCount == 2, "otherwise a new case has been added");
-
-        TypeSourceInfo* typeDefault = TemplateHasDefaultType(kind) ? float4TypeSourceInfo : nullptr;
-        recordDecl = DeclareTemplateTypeWithHandle(*m_context, typeName, templateArgCount, typeDefault);
-      }
-      m_objectTypeDecls[i] = recordDecl;
-      m_objectTypeDeclsMap[i] = std::make_pair(recordDecl, i);
-      m_objectTypeLazyInitMask |= ((uint64_t)1)<<i;
+      if (!IsObjectTypeDeclaredOnDemand(kind))
+        GetOrCreateObjectTypeDecl(i);
     }
 
     // Create an alias for SamplerState. 'sampler' is very commonly used.
@@ -3669,7 +3794,6 @@ private:
       samplerDecl->setImplicit(true);
 
       // Create decls for each deprecated effect object type:
-      unsigned effectObjBase = _countof(g_ArBasicKindsAsTypes);
       // TypeSourceInfo* effectObjTypeSource = m_context->getTrivialTypeSourceInfo(GetBasicKindType(AR_OBJECT_LEGACY_EFFECT));
       for (unsigned i = 0; i < _countof(g_DeprecatedEffectObjectNames); i++) {
         IdentifierInfo& idInfo = m_context->Idents.get(StringRef(g_DeprecatedEffectObjectNames[i]), tok::TokenKind::identifier);
@@ -3677,12 +3801,9 @@ private:
         CXXRecordDecl *effectObjDecl = CXXRecordDecl::Create(*m_context, TagTypeKind::TTK_Struct, currentDeclContext, NoLoc, NoLoc, &idInfo);
         currentDeclContext->addDecl(effectObjDecl);
         effectObjDecl->setImplicit(true);
-        m_objectTypeDeclsMap[i+effectObjBase] = std::make_pair(effectObjDecl, effectKindIndex);
+        AddObjectTypeDeclMapEntry(effectObjDecl, effectKindIndex);
       }
     }
-
-    // Make sure it's in order.
-    std::sort(m_objectTypeDeclsMap.begin(), m_objectTypeDeclsMap.end(), ObjectTypeDeclMapTypeCmp);
   }
 
   FunctionDecl* AddSubscriptSpecialization(
@@ -3747,6 +3868,9 @@ public:
     memset(m_scalarTypes, 0, sizeof(m_scalarTypes));
     memset(m_scalarTypeDefs, 0, sizeof(m_scalarTypeDefs));
     memset(m_baseTypes, 0, sizeof(m_baseTypes));
+    memset(m_objectTypeDecls, 0, sizeof(m_objectTypeDecls));
+    m_objectTypeDeclsMap.fill(std::make_pair(nullptr, 0));
+    m_objectTypeLazyInitMask = 0;
   }
 
   ~HLSLExternalSource() { }
@@ -3780,11 +3904,10 @@ public:
     }
 #endif // ENABLE_SPIRV_CODEGEN
 
+    // Methods from registered intrinsic tables are added as object types are
+    // declared.
     AddObjectTypes();
     AddStdIsEqualImplementation(context, S);
-    for (auto &&intrinsic : m_intrinsicTables) {
-      AddIntrinsicTableMethods(intrinsic);
-    }
 
 #ifdef ENABLE_SPIRV_CODEGEN
     if (m_sema->getLangOpts().SPIRV) {
@@ -3974,6 +4097,18 @@ public:
       TypedefDecl *strDecl = GetStringTypedef();
       R.addDecl(strDecl);
     }
+    // Built-in object types are declared the first time they are looked up.
+    else {
+      int objectIndex = FindOnDemandObjectTypeIndex(nameIdentifier);
+      if (objectIndex != -1) {
+        CXXRecordDecl *recordDecl = GetOrCreateObjectTypeDecl(objectIndex);
+        if (ClassTemplateDecl *templateDecl = recordDecl->getDescribedClassTemplate())
+          R.addDecl(templateDecl);
+        else
+          R.addDecl(recordDecl);
+        return true;
+      }
+    }
     return false;
   }
 
@@ -4211,38 +4346,43 @@ public:
     return AR_BASIC_UNKNOWN;
   }
 
+  // Adds the methods the table defines for the object type at the given index
+  // of g_ArBasicKindsAsTypes, which must already be declared.
+  void AddIntrinsicTableMethods(_In_ IDxcIntrinsicTable *table, unsigned i) {
+    DXASSERT_NOMSG(table != nullptr);
+    ArBasicKind kind = g_ArBasicKindsAsTypes[i];
+    const char *typeName = g_ArBasicTypeNames[kind];
+    uint8_t templateArgCount = g_ArBasicKindsTemplateCount[i];
+    DXASSERT(templateArgCount <= 2, "otherwise a new case has been added");
+    int startDepth = (templateArgCount == 0) ? 0 : 1;
+    CXXRecordDecl *recordDecl = m_objectTypeDecls[i];
+    DXASSERT_NOMSG(recordDecl != nullptr);
+
+    // This is a variation of AddObjectMethods using the new table.
+    const HLSL_INTRINSIC *pIntrinsic = nullptr;
+    const HLSL_INTRINSIC *pPrior = nullptr;
+    UINT64 lookupCookie = 0;
+    CA2W wideTypeName(typeName, CP_UTF8);
+    HRESULT found = table->LookupIntrinsic(wideTypeName, L"*", &pIntrinsic, &lookupCookie);
+    while (pIntrinsic != nullptr && SUCCEEDED(found)) {
+      if (!AreIntrinsicTemplatesEquivalent(pIntrinsic, pPrior)) {
+        AddObjectIntrinsicTemplate(recordDecl, startDepth, pIntrinsic);
+        // NOTE: this only works with the current implementation because
+        // intrinsics are alive as long as the table is alive.
+        pPrior = pIntrinsic;
+      }
+      found = table->LookupIntrinsic(wideTypeName, L"*", &pIntrinsic, &lookupCookie);
+    }
+  }
+
   void AddIntrinsicTableMethods(_In_ IDxcIntrinsicTable *table) {
     DXASSERT_NOMSG(table != nullptr);
 
     // Function intrinsics are added on-demand, objects get template methods.
+    // Object types declared later pick up the methods when they are created.
     for (unsigned i = 0; i < _countof(g_ArBasicKindsAsTypes); i++) {
-      // Grab information already processed by AddObjectTypes.
-      ArBasicKind kind = g_ArBasicKindsAsTypes[i];
-      const char *typeName = g_ArBasicTypeNames[kind];
-      uint8_t templateArgCount = g_ArBasicKindsTemplateCount[i];
-      DXASSERT(templateArgCount <= 2, "otherwise a new case has been added");
-      int startDepth = (templateArgCount == 0) ? 0 : 1;
-      CXXRecordDecl *recordDecl = m_objectTypeDecls[i];
-      if (recordDecl == nullptr) {
-        DXASSERT(kind == AR_OBJECT_WAVE, "else objects other than reserved not initialized");
-        continue;
-      }
-
-      // This is a variation of AddObjectMethods using the new table.
-      const HLSL_INTRINSIC *pIntrinsic = nullptr;
-      const HLSL_INTRINSIC *pPrior = nullptr;
-      UINT64 lookupCookie = 0;
-      CA2W wideTypeName(typeName, CP_UTF8);
-      HRESULT found = table->LookupIntrinsic(wideTypeName, L"*", &pIntrinsic, &lookupCookie);
-      while (pIntrinsic != nullptr && SUCCEEDED(found)) {
-        if (!AreIntrinsicTemplatesEquivalent(pIntrinsic, pPrior)) {
-          AddObjectIntrinsicTemplate(recordDecl, startDepth, pIntrinsic);
-          // NOTE: this only works with the current implementation because
-          // intrinsics are alive as long as the table is alive.
-          pPrior = pIntrinsic;
-        }
-        found = table->LookupIntrinsic(wideTypeName, L"*", &pIntrinsic, &lookupCookie);
-      }
+      if (m_objectTypeDecls[i] != nullptr)
+        AddIntrinsicTableMethods(table, i);
     }
   }
 
@@ -4376,7 +4516,7 @@ public:
         const ArBasicKind* match = std::find(g_ArBasicKindsAsTypes, &g_ArBasicKindsAsTypes[_countof(g_ArBasicKindsAsTypes)], kind);
         DXASSERT(match != &g_ArBasicKindsAsTypes[_countof(g_ArBasicKindsAsTypes)], "otherwise can't find constant in basic kinds");
         size_t index = match - g_ArBasicKindsAsTypes;
-        return m_context->getTagDeclType(this->m_objectTypeDecls[index]);
+        return m_context->getTagDeclType(GetOrCreateObjectTypeDecl(index));
     }
 
     case AR_OBJECT_SAMPLER1D:
@@ -4499,17 +4639,22 @@ public:
     size_t tableSize,
     StringRef typeName,
     StringRef nameIdentifier,
-    size_t argumentCount)
-  {
-    // This is implemented by a linear scan for now.
-    // We tested binary search on tables, and there was no performance gain on
-    // samples probably for the following reasons.
-    // 1. The tables are not big enough to make noticable difference
-    // 2. The user of this function assumes that it returns the first entry in
-    // the table that matches name and argument count. So even in the binary
-    // search, we have to scan backwards until the entry does not match the name
-    // or arg count. For linear search this is not a problem
-    for (unsigned int i = 0; i < tableSize; i++) {
+    size_t argumentCount,
+    _In_opt_ const HLSL_INTRINSIC_NAME_INDEX *pNameIndex = nullptr)
+  {
+    // The user of this function assumes that it returns the first entry in
+    // the table that matches name and argument count. Entries are sorted by
+    // name, so with a name index only the run of entries with the name needs
+    // to be scanned. Method tables are small and don't have an index; those
+    // are scanned linearly.
+    size_t start = 0, end = tableSize;
+    if (pNameIndex) {
+      const HLSL_INTRINSIC_NAME_RANGE *pRange =
+          LookupIntrinsicName(*pNameIndex, table, nameIdentifier);
+      start = pRange ? pRange->uStart : tableSize;
+      end = pRange ? (size_t)pRange->uStart + pRange->uCount : tableSize;
+    }
+    for (size_t i = start; i < end; i++) {
       const HLSL_INTRINSIC* pIntrinsic = &table[i];
 
       const bool isVariadicFn = IsVariadicIntrinsicFunction(pIntrinsic);
@@ -4566,15 +4711,18 @@ public:
     StringRef nameIdentifier = idInfo->getName();
     const HLSL_INTRINSIC *table = g_Intrinsics;
     auto tableCount = _countof(g_Intrinsics);
+    const HLSL_INTRINSIC_NAME_INDEX *pNameIndex = &g_Intrinsics_NameIndex;
 #ifdef ENABLE_SPIRV_CODEGEN
     if (isVkNamespace) {
       table = g_VkIntrinsics;
       tableCount = _countof(g_VkIntrinsics);
+      pNameIndex = &g_VkIntrinsics_NameIndex;
     }
 #endif // ENABLE_SPIRV_CODEGEN
 
     IntrinsicDefIter cursor = FindIntrinsicByNameAndArgCount(
-        table, tableCount, StringRef(), nameIdentifier, Args.size());
+        table, tableCount, StringRef(), nameIdentifier, Args.size(),
+        pNameIndex);
     IntrinsicDefIter end = IntrinsicDefIter::CreateEnd(
         table, tableCount, IntrinsicTableDefIter::CreateEnd(m_intrinsicTables));
 
@@ -5266,6 +5414,7 @@ public:
 
   // Overload support.
   UINT64 ScoreCast(QualType leftType, QualType rightType);
+  UINT64 ComputeCastScore(QualType leftType, QualType rightType);
   UINT64 ScoreFunction(OverloadCandidateSet::iterator &Cand);
   UINT64 ScoreImplicitConversionSequence(const ImplicitConversionSequence *s);
   unsigned GetNumElements(QualType anyType);
@@ -7165,6 +7314,19 @@ UINT64 HLSLExternalSource::ScoreCast(QualType pLType, QualType pRType)
     return 0;
   }
 
+  // Every candidate of an overloaded call scores the same argument types.
+  auto key = std::make_pair(pLType.getAsOpaquePtr(), pRType.getAsOpaquePtr());
+  auto found = m_castScores.find(key);
+  if (found != m_castScores.end())
+    return found->second;
+  UINT64 uScore = ComputeCastScore(pLType, pRType);
+  m_castScores[key] = uScore;
+  return uScore;
+}
+
+UINT64 HLSLExternalSource::ComputeCastScore(QualType pLType, QualType pRType)
+{
+
   UINT64 uScore = 0;
   UINT uLSize = GetNumElements(pLType);
   UINT uRSize = GetNumElements(pRType);
@@ -8767,6 +8929,24 @@ bool HLSLExternalSource::CanConvert(
   }
 
   ArTypeInfo TargetInfo, SourceInfo;
+
+  // Reuse the outcome of an earlier conversion between numeric types.
+  {
+    NumericConversionMap &conversions = m_numericConversions[explicitConversion];
+    auto found = conversions.find(
+        std::make_pair(source.getAsOpaquePtr(), target.getAsOpaquePtr()));
+    if (found != conversions.end()) {
+      const NumericConversion &conversion = found->second;
+      if (!conversion.Allowed)
+        return false;
+      Second = conversion.Second;
+      ComponentConversion = conversion.ComponentConversion;
+      Remarks = conversion.Remarks;
+      TargetInfo.ShapeKind = conversion.TargetShapeKind;
+      goto lSuccess;
+    }
+  }
+
   CollectInfo(target, &TargetInfo);
   CollectInfo(source, &SourceInfo);
 
@@ -8893,13 +9073,21 @@ bool HLSLExternalSource::CanConvert(
     }
   }
 
-  // Convert scalar/vector/matrix dimensions
-  if (!ConvertDimensions(TargetInfo, SourceInfo, Second, Remarks))
-    return false;
-
-  // Convert component type
-  if (!ConvertComponent(TargetInfo, SourceInfo, ComponentConversion, Remarks))
-    return false;
+  // Convert scalar/vector/matrix dimensions, then component type
+  {
+    NumericConversion conversion;
+    conversion.Allowed =
+        ConvertDimensions(TargetInfo, SourceInfo, Second, Remarks) &&
+        ConvertComponent(TargetInfo, SourceInfo, ComponentConversion, Remarks);
+    conversion.Second = Second;
+    conversion.ComponentConversion = ComponentConversion;
+    conversion.Remarks = Remarks;
+    conversion.TargetShapeKind = TargetInfo.ShapeKind;
+    m_numericConversions[explicitConversion][std::make_pair(
+        source.getAsOpaquePtr(), target.getAsOpaquePtr())] = conversion;
+    if (!conversion.Allowed)
+      return false;
+  }
 
 lSuccess:
   if (standard)
@@ -9783,6 +9971,47 @@ Sema::TemplateDeductionResult HLSLExternalSource::DeduceTemplateArgumentsForHLSL
     return Sema::TemplateDeductionResult::TDK_NonDeducedMismatch;
   }
 
+  StringRef nameIdentifier = FunctionTemplate->getName();
+  auto reportInvalidObjectElement = [&](LPCSTR tableName,
+                                        const HLSL_INTRINSIC *intrinsic) {
+    if (IsBuiltinTable(tableName) && !IsValidateObjectElement(intrinsic, objectElement)) {
+      UINT numEles = GetNumElements(objectElement);
+      std::string typeName(g_ArBasicTypeNames[GetTypeElementKind(objectElement)]);
+      if (numEles > 1) typeName += std::to_string(numEles);
+      m_sema->Diag(Args[0]->getExprLoc(), diag::err_hlsl_invalid_resource_type_on_intrinsic) <<
+          nameIdentifier << typeName;
+    }
+  };
+
+  // Reuse the deduction of an earlier call with the same argument types.
+  // Literal arguments are excluded, as their values can pick the concrete
+  // types.
+  IntrinsicMethodDeductionKey deductionKey;
+  bool canReuseDeduction =
+      ExplicitTemplateArgs == nullptr || ExplicitTemplateArgs->size() == 0 ||
+      (ExplicitTemplateArgs->size() == 1 && !functionTemplateTypeArg.isNull());
+  if (canReuseDeduction) {
+    deductionKey.push_back(FunctionTemplate->getCanonicalDecl());
+    deductionKey.push_back(functionTemplateTypeArg.getAsOpaquePtr());
+    for (Expr *arg : Args) {
+      ArBasicKind argKind = GetTypeElementKind(arg->getType());
+      if (argKind == AR_BASIC_LITERAL_INT || argKind == AR_BASIC_LITERAL_FLOAT) {
+        canReuseDeduction = false;
+        break;
+      }
+      deductionKey.push_back(arg->getType().getAsOpaquePtr());
+    }
+  }
+  if (canReuseDeduction) {
+    auto found = m_intrinsicMethodDeductions.find(deductionKey);
+    if (found != m_intrinsicMethodDeductions.end()) {
+      Specialization = found->second.Specialization;
+      reportInvalidObjectElement(found->second.TableName,
+                                 found->second.Intrinsic);
+      return Sema::TemplateDeductionResult::TDK_Success;
+    }
+  }
+
   // Find the table of intrinsics based on the object type.
   const HLSL_INTRINSIC* intrinsics = nullptr;
   size_t intrinsicCount = 0;
@@ -9798,9 +10027,10 @@ Sema::TemplateDeductionResult HLSLExternalSource::DeduceTemplateArgumentsForHLSL
     "otherwise FindIntrinsicTable failed to lookup a valid object, "
     "or the parser let a user-defined template object through");
 
-  // Look for an intrinsic for which we can match arguments.
+  // Look for an intrinsic for which we can match arguments. Candidates that
+  // fail to match may report errors, which a reused deduction would not.
+  DiagnosticErrorTrap deductionErrors(m_sema->getDiagnostics());
   std::vector<QualType> argTypes;
-  StringRef nameIdentifier = FunctionTemplate->getName();
   IntrinsicDefIter cursor = FindIntrinsicByNameAndArgCount(intrinsics, intrinsicCount, objectName, nameIdentifier, Args.size());
   IntrinsicDefIter end = IntrinsicDefIter::CreateEnd(intrinsics, intrinsicCount, IntrinsicTableDefIter::CreateEnd(m_intrinsicTables));
 
@@ -9868,13 +10098,11 @@ Sema::TemplateDeductionResult HLSLExternalSource::DeduceTemplateArgumentsForHLSL
     DXASSERT_NOMSG(Specialization->getPrimaryTemplate()->getCanonicalDecl() ==
       FunctionTemplate->getCanonicalDecl());
 
-    if (IsBuiltinTable(tableName) && !IsValidateObjectElement(*cursor, objectElement)) {
-      UINT numEles = GetNumElements(objectElement);
-      std::string typeName(g_ArBasicTypeNames[GetTypeElementKind(objectElement)]);
-      if (numEles > 1) typeName += std::to_string(numEles);
-      m_sema->Diag(Args[0]->getExprLoc(), diag::err_hlsl_invalid_resource_type_on_intrinsic) <<
-          nameIdentifier << typeName;
+    if (canReuseDeduction && !deductionErrors.hasErrorOccurred()) {
+      IntrinsicMethodDeduction deduction = { Specialization, tableName, *cursor };
+      m_intrinsicMethodDeductions[deductionKey] = deduction;
     }
+    reportInvalidObjectElement(tableName, *cursor);
     return Sema::TemplateDeductionResult::TDK_Success;
   }
 
@@ -0,0 +1,13 @@
+// Library function selected by a mode argument, kept out of line.
+
+[noinline]
+export float shade(float v, uint mode) {
+  switch (mode) {
+  case 0:
+    return v;
+  case 1:
+    return v * 2;
+  default:
+    return sqrt(v);
+  }
+}
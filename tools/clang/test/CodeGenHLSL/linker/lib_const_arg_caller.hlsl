@@ -0,0 +1,7 @@
+// Calls the library function with the same constant mode twice.
+
+float shade(float v, uint mode);
+
+export float caller(float v) {
+  return shade(v, 1) + shade(v + 1, 1);
+}
@@ -0,0 +1,17 @@
+// Each exported function uses its own resource.
+
+RWBuffer<float> KeptBuf : register(u0);
+RWBuffer<float> DroppedBuf : register(u1);
+
+cbuffer Params : register(b0) {
+  float KeptScale;
+  float DroppedScale;
+};
+
+export void keep(uint i) {
+  KeptBuf[i] = KeptScale;
+}
+
+export void drop(uint i) {
+  DroppedBuf[i] = DroppedScale;
+}
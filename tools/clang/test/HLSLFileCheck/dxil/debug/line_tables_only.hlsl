@@ -0,0 +1,19 @@
+// RUN: %dxc -E main -T ps_6_0 %s -Zi-lines -Od | FileCheck %s
+// RUN: %dxc -E main -T ps_6_0 %s -Zi-lines | FileCheck %s
+
+// -Zi-lines keeps the line of each instruction, but no variables or types.
+
+// CHECK-NOT: @llvm.dbg.value
+// CHECK-NOT: @llvm.dbg.declare
+// CHECK: call float @dx.op.unary.f32(i32 13,
+// CHECK-SAME: line:16
+// CHECK: call float @dx.op.unary.f32(i32 12,
+// CHECK-SAME: line:17
+// CHECK: !DICompileUnit({{.*}}emissionKind: 2
+// CHECK-NOT: {{^}}!{{[0-9]+}} = !DILocalVariable
+
+float main(float a : A) : SV_Target {
+  float x = sin(a);
+  float y = cos(x);
+  return x * y;
+}
@@ -0,0 +1,10 @@
+// RUN: %dxilver 1.5 | %dxc -E main -T ps_6_0 %s -Qfast_hash | FileCheck %s -check-prefix=FAST
+// RUN: %dxilver 1.5 | %dxc -E main -T ps_6_0 %s | FileCheck %s -check-prefix=MD5
+
+// The HASH part records which algorithm produced the digest.
+// FAST: ; shader hash: {{[0-9a-f]+}} (xxhash64)
+// MD5: ; shader hash: {{[0-9a-f]+}}{{$}}
+
+float4 main(float4 a : A) : SV_Target {
+  return a * 2;
+}
@@ -0,0 +1,32 @@
+// RUN: %dxc -E main -T cs_6_0 -unroll-max-function-instructions 40 %s | FileCheck %s -check-prefix=FUNC
+// RUN: %dxc -E main -T cs_6_0 -unroll-max-function-instructions 40 %s | FileCheck %s -check-prefix=FUNCWARN -input-file=stderr
+// RUN: %dxc -E main -T cs_6_0 -unroll-max-module-instructions 40 %s | FileCheck %s -check-prefix=MOD
+// RUN: %dxc -E main -T cs_6_0 -unroll-max-module-instructions 40 %s | FileCheck %s -check-prefix=MODWARN -input-file=stderr
+// RUN: %dxc -E main -T cs_6_0 -unroll-max-function-instructions 100000 %s | FileCheck %s -check-prefix=FITS
+
+// A loop that would clone more instructions than the unroll budget allows is
+// kept with a warning, instead of failing the compile.
+
+// FUNCWARN: warning: Loop was not unrolled because it would clone more than 40 instructions into the function
+// FUNC: define void @main()
+// FUNC: phi
+
+// MODWARN: warning: Loop was not unrolled because it would clone more than 40 instructions into the module
+// MOD: define void @main()
+// MOD: phi
+
+// FITS: define void @main()
+// FITS-NOT: phi
+// FITS: ret void
+
+RWStructuredBuffer<float> output : register(u0);
+
+[numthreads(1, 1, 1)]
+void main(uint3 tid : SV_DispatchThreadID) {
+  float acc = output[tid.x];
+  [unroll]
+  for (uint i = 0; i < 64; i++) {
+    acc = acc * acc + (float)i;
+  }
+  output[tid.x] = acc;
+}
@@ -0,0 +1,33 @@
+// RUN: %dxc -E main -T cs_6_0 %s | FileCheck %s
+
+// 256 iterations of a 4x4 matrix kernel, each with an inner loop over the
+// rows, all fully unrolled. The value cache is only reset for the blocks each
+// unroll cloned, so the cost stays linear in the number of iterations. Also
+// useful for timing the unroller with -Qpass-report.
+
+// CHECK: @main
+// CHECK-NOT: phi
+// CHECK: call void @dx.op.bufferStore.f32(
+// CHECK: ret void
+
+StructuredBuffer<float4x4> input : register(t0);
+RWStructuredBuffer<float4x4> output : register(u0);
+
+[numthreads(1, 1, 1)]
+void main() {
+  float4x4 m = input[0];
+  float4x4 acc = input[1];
+
+  [unroll]
+  for (uint i = 0; i < 256; i++) {
+    [unroll]
+    for (uint r = 0; r < 4; r++) {
+      if (r == (i & 3))
+        acc[r] = mul(acc[r], m) + m[r];
+      else
+        acc[r] = acc[r] * 0.5f + (float)i;
+    }
+  }
+
+  output[0] = acc;
+}
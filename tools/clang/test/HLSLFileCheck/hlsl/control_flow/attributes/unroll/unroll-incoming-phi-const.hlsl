@@ -1,4 +1,4 @@
-// RUN: %dxc -E main -T cs_6_0 -HV 2016 %s | FileCheck %s
+// RUN: %dxc -E main -T cs_6_0 -HV 2016 -opt-disable combine-raw-buffer-accesses %s | FileCheck %s
 
 // Make sure we still produced second loop, and unrolled outer and inner loops,
 // producing two stores, and no more.
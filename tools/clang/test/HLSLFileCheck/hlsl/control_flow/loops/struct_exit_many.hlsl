@@ -0,0 +1,43 @@
+// RUN: %dxc -E main -T ps_6_0 -opt-enable structurize-loop-exits-for-unroll %s | FileCheck %s
+// RUN: %dxc -E main -T ps_6_0 -opt-enable structurize-loop-exits-for-unroll %s -DFORCE_UNROLL | FileCheck %s
+
+// A loop with well over a hundred unstructured exits. Each exit is moved to
+// the latch on its own, so this checks that the cost of doing that stays
+// bounded rather than growing with the number of exits already moved.
+
+// CHECK: @main
+// CHECK: ret void
+
+#ifdef FORCE_UNROLL
+#define UNROLL [unroll]
+#else
+#define UNROLL
+#endif
+
+#define EXIT(n)                     \
+  if ((c | (i + (n))) & b) {        \
+    uav0[i + (n)] += a;             \
+    return (n);                     \
+  }
+
+#define EXIT4(n) EXIT(n) EXIT(n + 1) EXIT(n + 2) EXIT(n + 3)
+#define EXIT16(n) EXIT4(n) EXIT4(n + 4) EXIT4(n + 8) EXIT4(n + 12)
+#define EXIT128(n) EXIT16(n) EXIT16(n + 16) EXIT16(n + 32) EXIT16(n + 48) \
+                   EXIT16(n + 64) EXIT16(n + 80) EXIT16(n + 96) EXIT16(n + 112)
+
+RWTexture1D<float> uav0;
+
+float main(uint a : A, uint b : B, uint c : C) : SV_Target {
+
+  float ret = 0;
+
+  UNROLL for(uint i = 1; i <= 2; i++) {
+
+    if ((a * i) & c) {
+      ret += sin(i * b);
+      EXIT128(0)
+    }
+  }
+
+  return ret;
+}
@@ -1,4 +1,4 @@
-// RUN: %dxc -E main -T ps_6_0  %s | FileCheck %s
+// RUN: %dxc -E main -T ps_6_0 -opt-disable combine-raw-buffer-accesses %s | FileCheck %s
 
 // Make sure static global a not alias with local t.
 
@@ -0,0 +1,36 @@
+// RUN: %dxc -E main -T cs_6_4 -enable-16bit-types %s | FileCheck %s
+
+// Calls with constant arguments to these DXIL ops are folded away.
+
+// CHECK-NOT: @dx.op.legacyF32ToF16
+// CHECK-NOT: @dx.op.legacyF16ToF32
+// CHECK-NOT: @dx.op.isSpecialFloat
+// CHECK-NOT: @dx.op.dot4AddPacked
+// CHECK-NOT: @dx.op.dot2AddHalf
+// CHECK-NOT: @dx.op.tertiary
+
+// The stores to consecutive dwords are merged four at a time.
+// f32tof16(1.5) == 0x3e00
+// f16tof32(0x3c00) == 1.0
+// isnan(NaN)
+// isinf(1.0)
+// CHECK: call void @dx.op.rawBufferStore.i32({{.*}}, i32 0, i32 undef, i32 15872, i32 1065353216, i32 1, i32 0, i8 15,
+// dot4add_i8packed(0xff, 2, 0) == -1 * 2
+// dot4add_u8packed(0xff, 2, 10) == 255 * 2 + 10
+// dot2add((1, 2), (3, 4), 0.5) == 11.5
+// msad4(0x0a04, (0x00ff0c01, 0), (5, 0, 0, 0)).x == |4 - 1| + |10 - 12| + 5
+// CHECK: call void @dx.op.rawBufferStore.i32({{.*}}, i32 16, i32 undef, i32 -2, i32 520, i32 1094189056, i32 10, i8 15,
+
+RWByteAddressBuffer buf;
+
+[numthreads(1, 1, 1)]
+void main() {
+  buf.Store(0, f32tof16(1.5));
+  buf.Store(4, asuint(f16tof32(0x3c00)));
+  buf.Store(8, (uint)isnan(asfloat(0x7fc00000)));
+  buf.Store(12, (uint)isinf(1.0f));
+  buf.Store(16, (uint)dot4add_i8packed(0xff, 2, 0));
+  buf.Store(20, dot4add_u8packed(0xff, 2, 10));
+  buf.Store(24, asuint(dot2add(half2(1, 2), half2(3, 4), 0.5f)));
+  buf.Store(28, msad4(0x0a04, uint2(0x00ff0c01, 0), uint4(5, 0, 0, 0)).x);
+}
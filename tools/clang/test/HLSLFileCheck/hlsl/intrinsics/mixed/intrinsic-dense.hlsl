@@ -0,0 +1,41 @@
+// RUN: %dxc -E main -T cs_6_0 %s | FileCheck %s
+
+// Many calls to global intrinsics, including names that have overloads with
+// different argument counts, all resolved through the intrinsic name index.
+// Also useful for timing intrinsic lookup with -ftime-trace.
+
+// CHECK-DAG: call i32 @dx.op.atomicBinOp.i32(
+// CHECK-DAG: call float @dx.op.waveActiveOp.f32(
+// CHECK-DAG: call i32 @dx.op.wavePrefixOp.i32(
+// CHECK-DAG: call float @dx.op.waveReadLaneAt.f32(
+// CHECK-DAG: call i32 @dx.op.unaryBits.i32(
+// CHECK-DAG: call float @dx.op.dot3.f32(
+// CHECK-DAG: call float @dx.op.tertiary.f32(
+// CHECK-DAG: call float @dx.op.unary.f32(
+
+RWStructuredBuffer<float4> floats : register(u0);
+RWByteAddressBuffer bytes : register(u1);
+groupshared uint counter;
+
+[numthreads(64, 1, 1)]
+void main(uint3 tid : SV_DispatchThreadID) {
+  float4 v = floats[tid.x];
+  uint original;
+  InterlockedAdd(counter, 1);
+  InterlockedAdd(counter, tid.x, original);
+  bytes.InterlockedAdd(0, original);
+
+  float s = WaveActiveSum(v.x) + WaveActiveMax(v.y) + WaveActiveMin(v.z);
+  uint p = WavePrefixSum(tid.x) + WaveActiveCountBits(v.w > 0);
+  float r = WaveReadLaneAt(v.x, 0) + WaveReadLaneFirst(v.y);
+
+  float3 n = normalize(cross(v.xyz, float3(0, 1, 0)));
+  float d = dot(n, v.xyz) + length(v) + distance(v.xy, v.zw);
+  float m = mad(v.x, v.y, v.z) + lerp(v.x, v.y, 0.5) + clamp(v.w, 0, 1);
+  float e = sqrt(abs(v.x)) + rsqrt(abs(v.y) + 1) + exp2(v.z) + log2(abs(v.w) + 1) +
+            sin(v.x) + cos(v.y) + saturate(v.z) + frac(v.w) + floor(v.x) + ceil(v.y);
+  uint b = countbits(p) + firstbithigh(p) + firstbitlow(p) + reversebits(p) +
+           asuint(d) + f32tof16(m) + max(p, 1u) + min(p, 7u);
+
+  floats[tid.x] = float4(s + r, d + m, e, (float)(b + original));
+}
@@ -1,20 +1,20 @@
-// RUN: %dxc -E test_wavereadlaneat -T vs_6_0 /DTYPE=float /DRET_TYPE=float %s | FileCheck %s -check-prefix=RDLNAT_FLT
-// RUN: %dxc -E test_wavereadlaneat -T vs_6_2 -enable-16bit-types /DTYPE=half /DRET_TYPE=half %s | FileCheck %s -check-prefix=RDLNAT_HALF
-// RUN: %dxc -E test_wavereadlaneat -T vs_6_0 /DTYPE=min16float /DRET_TYPE=min16float %s | FileCheck %s -check-prefix=RDLNAT_MIN16FLT
-// RUN: %dxc -E test_wavereadlaneat -T vs_6_0 /DTYPE=int /DRET_TYPE=int %s | FileCheck %s -check-prefix=RDLNAT_INT
-// RUN: %dxc -E test_wavereadlaneat -T vs_6_0 /DTYPE=uint /DRET_TYPE=uint %s | FileCheck %s -check-prefix=RDLNAT_UINT
-// RUN: %dxc -E test_wavereadlaneat -T vs_6_0 /DTYPE=double /DRET_TYPE=float %s | FileCheck %s -check-prefix=RDLNAT_DBL
-// RUN: %dxc -E test_wavereadlaneat -T vs_6_0 /DTYPE=bool /DRET_TYPE=bool %s | FileCheck %s -check-prefix=RDLNAT_BOOL
-// RUN: %dxc -E test_wavereadlaneat -T vs_6_0 /DTYPE=bool3 /DRET_TYPE=bool3 %s | FileCheck %s -check-prefix=RDLNAT_BOOL_VEC3
-// RUN: %dxc -E test_wavereadlaneat -T vs_6_0 /DTYPE=int2x3 /DRET_TYPE=int %s | FileCheck %s -check-prefix=RDLNAT_MAT
-// RUN: %dxc -E test_wavereadlanefirst -T vs_6_0 /DTYPE=float /DRET_TYPE=float %s | FileCheck %s -check-prefix=RDLNFRST_FLT
-// RUN: %dxc -E test_wavereadlanefirst -T vs_6_2 -enable-16bit-types /DTYPE=half /DRET_TYPE=half %s | FileCheck %s -check-prefix=RDLNFRST_HALF
-// RUN: %dxc -E test_wavereadlanefirst -T vs_6_0 /DTYPE=min16float /DRET_TYPE=min16float %s | FileCheck %s -check-prefix=RDLNFRST_MIN16FLT
-// RUN: %dxc -E test_wavereadlanefirst -T vs_6_0 /DTYPE=int /DRET_TYPE=int %s | FileCheck %s -check-prefix=RDLNFRST_INT
-// RUN: %dxc -E test_wavereadlanefirst -T vs_6_0 /DTYPE=uint /DRET_TYPE=uint %s | FileCheck %s -check-prefix=RDLNFRST_UINT
-// RUN: %dxc -E test_wavereadlanefirst -T vs_6_0 /DTYPE=bool /DRET_TYPE=bool %s | FileCheck %s -check-prefix=RDLNFRST_BOOL
-// RUN: %dxc -E test_wavereadlanefirst -T vs_6_0 /DTYPE=bool3 /DRET_TYPE=bool3 %s | FileCheck %s -check-prefix=RDLNFRST_BOOL_VEC3
-// RUN: %dxc -E test_wavereadlanefirst -T vs_6_0 /DTYPE=int2x3 /DRET_TYPE=int %s | FileCheck %s -check-prefix=RDLNFRST_MAT
+// RUN: %dxc -E test_wavereadlaneat -T vs_6_0 /DTYPE=float /DRET_TYPE=float -opt-disable fold-uniform-wave-ops %s | FileCheck %s -check-prefix=RDLNAT_FLT
+// RUN: %dxc -E test_wavereadlaneat -T vs_6_2 -enable-16bit-types /DTYPE=half /DRET_TYPE=half -opt-disable fold-uniform-wave-ops %s | FileCheck %s -check-prefix=RDLNAT_HALF
+// RUN: %dxc -E test_wavereadlaneat -T vs_6_0 /DTYPE=min16float /DRET_TYPE=min16float -opt-disable fold-uniform-wave-ops %s | FileCheck %s -check-prefix=RDLNAT_MIN16FLT
+// RUN: %dxc -E test_wavereadlaneat -T vs_6_0 /DTYPE=int /DRET_TYPE=int -opt-disable fold-uniform-wave-ops %s | FileCheck %s -check-prefix=RDLNAT_INT
+// RUN: %dxc -E test_wavereadlaneat -T vs_6_0 /DTYPE=uint /DRET_TYPE=uint -opt-disable fold-uniform-wave-ops %s | FileCheck %s -check-prefix=RDLNAT_UINT
+// RUN: %dxc -E test_wavereadlaneat -T vs_6_0 /DTYPE=double /DRET_TYPE=float -opt-disable fold-uniform-wave-ops %s | FileCheck %s -check-prefix=RDLNAT_DBL
+// RUN: %dxc -E test_wavereadlaneat -T vs_6_0 /DTYPE=bool /DRET_TYPE=bool -opt-disable fold-uniform-wave-ops %s | FileCheck %s -check-prefix=RDLNAT_BOOL
+// RUN: %dxc -E test_wavereadlaneat -T vs_6_0 /DTYPE=bool3 /DRET_TYPE=bool3 -opt-disable fold-uniform-wave-ops %s | FileCheck %s -check-prefix=RDLNAT_BOOL_VEC3
+// RUN: %dxc -E test_wavereadlaneat -T vs_6_0 /DTYPE=int2x3 /DRET_TYPE=int -opt-disable fold-uniform-wave-ops %s | FileCheck %s -check-prefix=RDLNAT_MAT
+// RUN: %dxc -E test_wavereadlanefirst -T vs_6_0 /DTYPE=float /DRET_TYPE=float -opt-disable fold-uniform-wave-ops %s | FileCheck %s -check-prefix=RDLNFRST_FLT
+// RUN: %dxc -E test_wavereadlanefirst -T vs_6_2 -enable-16bit-types /DTYPE=half /DRET_TYPE=half -opt-disable fold-uniform-wave-ops %s | FileCheck %s -check-prefix=RDLNFRST_HALF
+// RUN: %dxc -E test_wavereadlanefirst -T vs_6_0 /DTYPE=min16float /DRET_TYPE=min16float -opt-disable fold-uniform-wave-ops %s | FileCheck %s -check-prefix=RDLNFRST_MIN16FLT
+// RUN: %dxc -E test_wavereadlanefirst -T vs_6_0 /DTYPE=int /DRET_TYPE=int -opt-disable fold-uniform-wave-ops %s | FileCheck %s -check-prefix=RDLNFRST_INT
+// RUN: %dxc -E test_wavereadlanefirst -T vs_6_0 /DTYPE=uint /DRET_TYPE=uint -opt-disable fold-uniform-wave-ops %s | FileCheck %s -check-prefix=RDLNFRST_UINT
+// RUN: %dxc -E test_wavereadlanefirst -T vs_6_0 /DTYPE=bool /DRET_TYPE=bool -opt-disable fold-uniform-wave-ops %s | FileCheck %s -check-prefix=RDLNFRST_BOOL
+// RUN: %dxc -E test_wavereadlanefirst -T vs_6_0 /DTYPE=bool3 /DRET_TYPE=bool3 -opt-disable fold-uniform-wave-ops %s | FileCheck %s -check-prefix=RDLNFRST_BOOL_VEC3
+// RUN: %dxc -E test_wavereadlanefirst -T vs_6_0 /DTYPE=int2x3 /DRET_TYPE=int -opt-disable fold-uniform-wave-ops %s | FileCheck %s -check-prefix=RDLNFRST_MAT
 
 // This file should contain tests to cover all supported overloads of WaveIntrinsics used for reduction operations
 // TODO: Currently only covers WaveReadFirstLane and WaveReadLaneAt. Add coverage for others.
@@ -1,4 +1,4 @@
-// RUN: %dxc -E main -T ps_6_0 %s | FileCheck %s
+// RUN: %dxc -E main -T ps_6_0 -opt-disable fold-uniform-wave-ops %s | FileCheck %s
 
 // CHECK: Wave level operations
 // CHECK: call i1 @dx.op.waveIsFirstLane(i32 110
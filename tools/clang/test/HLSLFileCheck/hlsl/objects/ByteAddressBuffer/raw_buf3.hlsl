@@ -1,4 +1,4 @@
-// RUN: %dxc -E main -T ps_6_0 -HV 2018 %s | FileCheck %s
+// RUN: %dxc -E main -T ps_6_0 -HV 2018 -opt-disable combine-raw-buffer-accesses %s | FileCheck %s
 
 // CHECK-NOT: @dx.op.rawBufferLoad
 // CHECK: call %dx.types.ResRet.i32 @dx.op.bufferLoad.i32
@@ -1,4 +1,4 @@
-// RUN: %dxc -E main -T vs_6_2 -HV 2018 -enable-16bit-types %s | FileCheck %s
+// RUN: %dxc -E main -T vs_6_2 -HV 2018 -enable-16bit-types -opt-disable combine-raw-buffer-accesses %s | FileCheck %s
 
 // Tests that ByteAddressBuffer.Store<T> works with all type shapes
 
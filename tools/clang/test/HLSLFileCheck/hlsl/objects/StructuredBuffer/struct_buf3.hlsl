@@ -1,4 +1,4 @@
-// RUN: %dxilver 1.2 | %dxc -E main -T ps_6_2 %s | FileCheck %s
+// RUN: %dxilver 1.2 | %dxc -E main -T ps_6_2 -opt-disable combine-raw-buffer-accesses %s | FileCheck %s
 
 // CHECK: call %dx.types.ResRet.i32 @dx.op.rawBufferLoad.i32
 // CHECK: trunc i32 %{{[a-zA-Z0-9]+}} to i16
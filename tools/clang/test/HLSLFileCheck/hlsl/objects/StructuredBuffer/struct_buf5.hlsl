@@ -1,4 +1,4 @@
-// RUN: %dxilver 1.2 | %dxc -E main -T ps_6_2 -enable-16bit-types %s | FileCheck %s
+// RUN: %dxilver 1.2 | %dxc -E main -T ps_6_2 -enable-16bit-types -opt-disable combine-raw-buffer-accesses %s | FileCheck %s
 // CHECK: call %dx.types.ResRet.i16 @dx.op.rawBufferLoad.i16
 // CHECK: call %dx.types.ResRet.i16 @dx.op.rawBufferLoad.i16
 // CHECK: call %dx.types.ResRet.i16 @dx.op.rawBufferLoad.i16
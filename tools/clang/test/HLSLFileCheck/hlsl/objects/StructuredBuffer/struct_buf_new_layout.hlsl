@@ -1,4 +1,4 @@
-// RUN: %dxilver 1.2 | %dxc -E main -T ps_6_2 -enable-16bit-types -HV 2018 %s  | FileCheck %s
+// RUN: %dxilver 1.2 | %dxc -E main -T ps_6_2 -enable-16bit-types -HV 2018 -opt-disable combine-raw-buffer-accesses %s  | FileCheck %s
 
 struct MyStruct1
 {
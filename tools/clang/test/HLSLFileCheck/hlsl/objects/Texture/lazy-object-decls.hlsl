@@ -0,0 +1,29 @@
+// RUN: %dxc -T ps_6_5 -ast-dump %s | FileCheck %s
+// RUN: %dxc -T ps_6_5 %s | FileCheck %s -check-prefix=DXIL
+
+// Built-in object types are declared the first time they are used. Types
+// first named in the shader, and types first needed by another built-in's
+// methods, still get their template arguments and methods.
+
+// CHECK: VarDecl {{.*}} used tex 'Texture2D<float4>'
+// CHECK: VarDecl {{.*}} used q 'RayQuery<RAY_FLAG_NONE>':'RayQuery<0>'
+// CHECK: MemberExpr {{.*}} .TraceRayInline
+// CHECK: MemberExpr {{.*}} .Sample
+// CHECK: MemberExpr {{.*}} .CommittedRayT
+
+// DXIL: @dx.op.allocateRayQuery(i32 178, i32 0)
+// DXIL: @dx.op.rayQuery_TraceRayInline(
+// DXIL: @dx.op.sample.f32(
+// DXIL: @dx.op.rayQuery_StateScalar.f32(i32 200,
+
+Texture2D<float4> tex : register(t0);
+SamplerState samp : register(s0);
+RaytracingAccelerationStructure scene : register(t1);
+
+float4 main(float2 uv : TEXCOORD) : SV_Target {
+  RayQuery<RAY_FLAG_NONE> q;
+  RayDesc ray = { float3(uv, 0), 0, float3(0, 0, 1), 1 };
+  q.TraceRayInline(scene, RAY_FLAG_NONE, 0xFF, ray);
+  q.Proceed();
+  return tex.Sample(samp, uv) * q.CommittedRayT();
+}
@@ -0,0 +1,14 @@
+// RUN: %dxc -E main -T ps_6_0 %s | FileCheck %s
+
+// Calls with the same argument types share one deduction, which still
+// reports the element type error at each call.
+
+// CHECK: sample_repeated_error.hlsl:12:{{[0-9]+}}: error: cannot Sample from resource containing uint
+// CHECK: sample_repeated_error.hlsl:13:{{[0-9]+}}: error: cannot Sample from resource containing uint
+
+Texture2D<uint> tid;
+SamplerState             g_s:     register(s0);
+float4 main(float2 p: A) : SV_Target {
+  return tid.Sample(g_s, p) +
+         tid.Sample(g_s, p);
+}
@@ -0,0 +1,20 @@
+// RUN: %dxc -E main -T ps_6_0 %s | FileCheck %s
+
+// Comments and identifiers long enough to be skipped in 16-byte chunks must
+// lex the same as short ones.
+
+// CHECK: call void @dx.op.storeOutput.f32(i32 5, i32 0, i32 0, i8 0, float 7.000000e+00)
+
+static const float a_very_long_identifier_used_by_generated_code_0 = 1; /* a
+ block comment that runs well past one chunk / with slashes / inside it **/
+static const float a_very_long_identifier_used_by_generated_code_1 = 2;
+static const float a_very_long_identifier_used_by_generated_code_01 = 4;
+
+float4 main() : SV_Target {
+  float r = 0; // a line comment that runs well past one chunk and continues \
+  r = 100;
+  r += a_very_long_identifier_used_by_generated_code_0;
+  r += a_very_long_identifier_used_by_generated_code_1;
+  r += a_very_long_identifier_used_by_generated_code_01;
+  return r;
+}
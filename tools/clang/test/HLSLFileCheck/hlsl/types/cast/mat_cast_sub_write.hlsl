@@ -1,4 +1,4 @@
-// RUN: %dxc /T ps_6_0 /E main %s | FileCheck %s
+// RUN: %dxc /T ps_6_0 /E main -opt-disable combine-raw-buffer-accesses %s | FileCheck %s
 
 // Make sure cast then subscript works.
 
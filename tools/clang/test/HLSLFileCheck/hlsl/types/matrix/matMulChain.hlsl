@@ -0,0 +1,33 @@
+// RUN: %dxc -E main -T vs_6_0 %s | FileCheck %s
+// RUN: %dxc -E main -T vs_6_0 -Od %s | FileCheck %s
+
+// Hundreds of matrix multiplies, as in skinning and transform chains.
+// Each mul is expanded into element products and mads during matrix lowering.
+
+// CHECK: @main
+// CHECK: fmul fast float
+// CHECK: call float @dx.op.tertiary.f32(i32 46
+// CHECK: call void @dx.op.storeOutput.f32(i32 5, i32 0, i32 0, i8 3
+
+cbuffer Bones : register(b0)
+{
+  float4x4 g_Bones[64];
+  float4x4 g_ViewProj;
+};
+
+#define SKIN1(i) acc += mul(mul(pos, g_Bones[(idx + i) & 63]), g_ViewProj) * w;
+#define SKIN4(i) SKIN1(i) SKIN1(i + 1) SKIN1(i + 2) SKIN1(i + 3)
+#define SKIN16(i) SKIN4(i) SKIN4(i + 4) SKIN4(i + 8) SKIN4(i + 12)
+#define SKIN64(i) SKIN16(i) SKIN16(i + 16) SKIN16(i + 32) SKIN16(i + 48)
+
+float4 main(float4 pos : POSITION, uint idx : BLENDINDICES, float w : BLENDWEIGHT) : SV_Position
+{
+  float4 acc = 0;
+  SKIN64(0)
+  SKIN64(64)
+  float4x4 m = g_ViewProj;
+  m = mul(m, g_Bones[idx & 63]);
+  m = mul(m, g_Bones[(idx + 1) & 63]);
+  m = mul(transpose(m), m);
+  return acc + mul(pos, m);
+}
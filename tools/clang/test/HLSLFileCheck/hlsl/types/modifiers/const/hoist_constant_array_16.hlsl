@@ -0,0 +1,15 @@
+// RUN: %dxc -Emain -Tps_6_0 %s | %FileCheck %s
+// CHECK:     = internal constant [6 x float] [float 1.000000e+00, float 2.000000e+00, float undef, float 4.000000e+00, float 5.000000e+00, float 6.000000e+00]
+// CHECK-NOT: alloca
+
+// Multi-dimensional arrays are hoisted before they are flattened.
+
+float main(int i : I, int j : J) : SV_Target {
+    float A[2][3];
+    A[0][0] = 1;
+    A[0][1] = 2;
+    A[1][0] = 4;
+    A[1][1] = 5;
+    A[1][2] = 6;
+    return A[i][j];
+}
@@ -0,0 +1,29 @@
+// RUN: %dxc -T lib_6_3 -default-linkage external %s | FileCheck %s
+
+// Test that precise applies retroactively to instructions producing a given
+// value in functions that are not inlined, through return values and out
+// parameters.
+
+// CHECK: define {{.*}}square
+// CHECK-NOT: fmul fast float
+// CHECK: fmul float
+// CHECK: ret float
+
+// CHECK: define {{.*}}twice
+// CHECK-NOT: fadd fast float
+// CHECK: fadd float
+// CHECK: ret void
+
+[noinline]
+float square(float f) { return f * f; }
+
+[noinline]
+void twice(float f, out float result) { result = f + f; }
+
+export float make_precise(float f)
+{
+  precise float pf = square(f);
+  precise float pt;
+  twice(f, pt);
+  return pf + pt;
+}
@@ -0,0 +1,59 @@
+; RUN: %opt %s -dxil-cluster-fetches -S | FileCheck %s
+
+; Both samples move above the math between them. The second one stays after
+; the first, and the load after the UAV store does not cross it.
+; CHECK: %uv = call float @dx.op.loadInput.f32(i32 4, i32 0, i32 0, i8 0, i32 undef)
+; CHECK-NEXT: %s0 = call %dx.types.ResRet.f32 @dx.op.sample.f32(i32 60,
+; CHECK-NEXT: %s1 = call %dx.types.ResRet.f32 @dx.op.sample.f32(i32 60,
+; CHECK-NEXT: %a = fmul fast float %uv, 3.000000e+00
+; CHECK: call void @dx.op.bufferStore.f32(
+; CHECK-NEXT: %l = call %dx.types.ResRet.f32 @dx.op.bufferLoad.f32(i32 68,
+; CHECK-NEXT: %f = fadd fast float %e, %d
+
+; A fetch that uses a value stays after it.
+; CHECK: %v = fadd fast float %x1, %lx
+; CHECK-NEXT: %s2 = call %dx.types.ResRet.f32 @dx.op.sample.f32(i32 60, %dx.types.Handle %tex, %dx.types.Handle %smp, float %v,
+
+target datalayout = "e-m:e-p:32:32-i1:32-i8:32-i16:32-i32:32-i64:64-f16:32-f32:32-f64:64-n8:16:32:64"
+target triple = "dxil-ms-dx"
+
+%dx.types.Handle = type { i8* }
+%dx.types.ResRet.f32 = type { float, float, float, float, i32 }
+
+define void @main() {
+entry:
+  %tex = call %dx.types.Handle @dx.op.createHandle(i32 57, i8 0, i32 0, i32 0, i1 false)
+  %smp = call %dx.types.Handle @dx.op.createHandle(i32 57, i8 3, i32 0, i32 0, i1 false)
+  %uav = call %dx.types.Handle @dx.op.createHandle(i32 57, i8 1, i32 0, i32 0, i1 false)
+  %uv = call float @dx.op.loadInput.f32(i32 4, i32 0, i32 0, i8 0, i32 undef)
+  %a = fmul fast float %uv, 3.000000e+00
+  %b = fadd fast float %a, 1.000000e+00
+  %s0 = call %dx.types.ResRet.f32 @dx.op.sample.f32(i32 60, %dx.types.Handle %tex, %dx.types.Handle %smp, float %uv, float %uv, float undef, float undef, i32 0, i32 0, i32 undef, float undef)
+  %x0 = extractvalue %dx.types.ResRet.f32 %s0, 0
+  %c = fmul fast float %x0, %b
+  %d = fadd fast float %c, %a
+  %s1 = call %dx.types.ResRet.f32 @dx.op.sample.f32(i32 60, %dx.types.Handle %tex, %dx.types.Handle %smp, float %uv, float 0.000000e+00, float undef, float undef, i32 0, i32 0, i32 undef, float undef)
+  %x1 = extractvalue %dx.types.ResRet.f32 %s1, 0
+  %e = fmul fast float %x1, %d
+  call void @dx.op.bufferStore.f32(i32 69, %dx.types.Handle %uav, i32 0, i32 undef, float %e, float %e, float %e, float %e, i8 15)
+  %f = fadd fast float %e, %d
+  %l = call %dx.types.ResRet.f32 @dx.op.bufferLoad.f32(i32 68, %dx.types.Handle %uav, i32 1, i32 undef)
+  %lx = extractvalue %dx.types.ResRet.f32 %l, 0
+  %v = fadd fast float %x1, %lx
+  %s2 = call %dx.types.ResRet.f32 @dx.op.sample.f32(i32 60, %dx.types.Handle %tex, %dx.types.Handle %smp, float %v, float %v, float undef, float undef, i32 0, i32 0, i32 undef, float undef)
+  %x2 = extractvalue %dx.types.ResRet.f32 %s2, 0
+  %r = fadd fast float %x2, %f
+  call void @dx.op.storeOutput.f32(i32 5, i32 0, i32 0, i8 0, float %r)
+  ret void
+}
+
+declare %dx.types.Handle @dx.op.createHandle(i32, i8, i32, i32, i1) #0
+declare float @dx.op.loadInput.f32(i32, i32, i32, i8, i32) #1
+declare %dx.types.ResRet.f32 @dx.op.sample.f32(i32, %dx.types.Handle, %dx.types.Handle, float, float, float, float, i32, i32, i32, float) #0
+declare %dx.types.ResRet.f32 @dx.op.bufferLoad.f32(i32, %dx.types.Handle, i32, i32) #0
+declare void @dx.op.bufferStore.f32(i32, %dx.types.Handle, i32, i32, float, float, float, float, i8) #2
+declare void @dx.op.storeOutput.f32(i32, i32, i32, i8, float) #2
+
+attributes #0 = { nounwind readonly }
+attributes #1 = { nounwind readnone }
+attributes #2 = { nounwind }
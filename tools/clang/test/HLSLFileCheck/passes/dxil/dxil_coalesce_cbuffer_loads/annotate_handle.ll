@@ -0,0 +1,67 @@
+; RUN: %opt %s -dxil-coalesce-cbuffer-loads -S | FileCheck %s
+
+; Shader model 6.6 annotates the handle for each access. Loads of row 0 through
+; separately annotated handles for the same cbuffer still become one load
+; before the branch.
+
+; CHECK-LABEL: entry:
+; CHECK: %a = call %dx.types.Handle @dx.op.annotateHandle(i32 216, %dx.types.Handle %h, %dx.types.ResourceProperties { i32 13, i32 32 })
+; CHECK-NEXT: [[ROW0:%.*]] = call %dx.types.CBufRet.f32 @dx.op.cbufferLoadLegacy.f32(i32 59, %dx.types.Handle %a, i32 0)
+; CHECK-NEXT: br i1 %c
+
+; CHECK-LABEL: then:
+; CHECK-NEXT: %ax = extractvalue %dx.types.CBufRet.f32 [[ROW0]], 0
+
+; CHECK-LABEL: else:
+; CHECK-NOT: cbufferLoadLegacy
+; CHECK: %by = extractvalue %dx.types.CBufRet.f32 [[ROW0]], 1
+
+target datalayout = "e-m:e-p:32:32-i1:32-i8:32-i16:32-i32:32-i64:64-f16:32-f32:32-f64:64-n8:16:32:64"
+target triple = "dxil-ms-dx"
+
+%CB = type { <4 x float>, <4 x float> }
+%dx.types.Handle = type { i8* }
+%dx.types.ResourceProperties = type { i32, i32 }
+%dx.types.CBufRet.f32 = type { float, float, float, float }
+
+@CB = external constant %CB
+
+define float @main(i1 %c) {
+entry:
+  %cb = load %CB, %CB* @CB
+  %h = call %dx.types.Handle @dx.op.createHandleForLib.CB(i32 160, %CB %cb)
+  %a = call %dx.types.Handle @dx.op.annotateHandle(i32 216, %dx.types.Handle %h, %dx.types.ResourceProperties { i32 13, i32 32 })
+  br i1 %c, label %then, label %else
+
+then:
+  %x = call %dx.types.CBufRet.f32 @dx.op.cbufferLoadLegacy.f32(i32 59, %dx.types.Handle %a, i32 0)
+  %ax = extractvalue %dx.types.CBufRet.f32 %x, 0
+  br label %exit
+
+else:
+  call void @"\01?sideEffect@@YAXXZ"()
+  %cb2 = load %CB, %CB* @CB
+  %h2 = call %dx.types.Handle @dx.op.createHandleForLib.CB(i32 160, %CB %cb2)
+  %a2 = call %dx.types.Handle @dx.op.annotateHandle(i32 216, %dx.types.Handle %h2, %dx.types.ResourceProperties { i32 13, i32 32 })
+  %y = call %dx.types.CBufRet.f32 @dx.op.cbufferLoadLegacy.f32(i32 59, %dx.types.Handle %a2, i32 0)
+  %by = extractvalue %dx.types.CBufRet.f32 %y, 1
+  br label %exit
+
+exit:
+  %r = phi float [ %ax, %then ], [ %by, %else ]
+  ret float %r
+}
+
+declare void @"\01?sideEffect@@YAXXZ"()
+
+; Function Attrs: nounwind readonly
+declare %dx.types.Handle @dx.op.createHandleForLib.CB(i32, %CB) #0
+
+; Function Attrs: nounwind readnone
+declare %dx.types.Handle @dx.op.annotateHandle(i32, %dx.types.Handle, %dx.types.ResourceProperties) #1
+
+; Function Attrs: nounwind readonly
+declare %dx.types.CBufRet.f32 @dx.op.cbufferLoadLegacy.f32(i32, %dx.types.Handle, i32) #0
+
+attributes #0 = { nounwind readonly }
+attributes #1 = { nounwind readnone }
@@ -0,0 +1,26 @@
+// RUN: %dxc -E main -T ps_6_0 %s | FileCheck %s
+// RUN: %dxc -E main -T ps_6_6 %s | FileCheck %s
+
+// Both branches read the same cbuffer row after a UAV store, which keeps
+// CSE from merging the loads. Only one load should be left.
+
+// CHECK: call %dx.types.CBufRet.f32 @dx.op.cbufferLoadLegacy.f32(i32 59, %dx.types.Handle %{{.*}}, i32 0)
+// CHECK-NOT: call %dx.types.CBufRet.f32 @dx.op.cbufferLoadLegacy
+
+cbuffer C {
+  float4 v;
+};
+
+RWBuffer<float> U;
+
+float main(uint i : I, float x : X) : SV_Target {
+  float r;
+  if (x > 0) {
+    U[i] = 1;
+    r = v.x;
+  } else {
+    U[i + 1] = 2;
+    r = v.y * 2;
+  }
+  return r;
+}
@@ -0,0 +1,70 @@
+; RUN: %opt %s -dxil-coalesce-cbuffer-loads -S | FileCheck %s
+
+; Loads of row 0 on both sides of the branch become one load before it, even
+; through separate handles and calls in between. The reload in %else is
+; dominated by the first load there, and the dynamic row is left alone.
+
+; CHECK-LABEL: entry:
+; CHECK: %h = call %dx.types.Handle @dx.op.createHandleForLib.CB(i32 160, %CB %cb)
+; CHECK-NEXT: [[ROW0:%.*]] = call %dx.types.CBufRet.f32 @dx.op.cbufferLoadLegacy.f32(i32 59, %dx.types.Handle %h, i32 0)
+; CHECK-NEXT: br i1 %c
+
+; CHECK-LABEL: then:
+; CHECK-NEXT: %ax = extractvalue %dx.types.CBufRet.f32 [[ROW0]], 0
+
+; CHECK-LABEL: else:
+; CHECK-NOT: i32 0)
+; CHECK: %by = extractvalue %dx.types.CBufRet.f32 [[ROW0]], 1
+; CHECK-NOT: i32 0)
+; CHECK: %dz = extractvalue %dx.types.CBufRet.f32 [[ROW0]], 2
+; CHECK: call %dx.types.CBufRet.f32 @dx.op.cbufferLoadLegacy.f32(i32 59, %dx.types.Handle %h, i32 %row)
+
+target datalayout = "e-m:e-p:32:32-i1:32-i8:32-i16:32-i32:32-i64:64-f16:32-f32:32-f64:64-n8:16:32:64"
+target triple = "dxil-ms-dx"
+
+%CB = type { <4 x float>, <4 x float> }
+%dx.types.Handle = type { i8* }
+%dx.types.CBufRet.f32 = type { float, float, float, float }
+
+@CB = external constant %CB
+
+define float @main(i1 %c, i32 %row) {
+entry:
+  %cb = load %CB, %CB* @CB
+  %h = call %dx.types.Handle @dx.op.createHandleForLib.CB(i32 160, %CB %cb)
+  br i1 %c, label %then, label %else
+
+then:
+  %a = call %dx.types.CBufRet.f32 @dx.op.cbufferLoadLegacy.f32(i32 59, %dx.types.Handle %h, i32 0)
+  %ax = extractvalue %dx.types.CBufRet.f32 %a, 0
+  br label %exit
+
+else:
+  call void @"\01?sideEffect@@YAXXZ"()
+  %cb2 = load %CB, %CB* @CB
+  %h2 = call %dx.types.Handle @dx.op.createHandleForLib.CB(i32 160, %CB %cb2)
+  %b = call %dx.types.CBufRet.f32 @dx.op.cbufferLoadLegacy.f32(i32 59, %dx.types.Handle %h2, i32 0)
+  %by = extractvalue %dx.types.CBufRet.f32 %b, 1
+  call void @"\01?sideEffect@@YAXXZ"()
+  %d = call %dx.types.CBufRet.f32 @dx.op.cbufferLoadLegacy.f32(i32 59, %dx.types.Handle %h2, i32 0)
+  %dz = extractvalue %dx.types.CBufRet.f32 %d, 2
+  %e = call %dx.types.CBufRet.f32 @dx.op.cbufferLoadLegacy.f32(i32 59, %dx.types.Handle %h, i32 %row)
+  %ew = extractvalue %dx.types.CBufRet.f32 %e, 3
+  %s0 = fadd float %by, %dz
+  %s = fadd float %s0, %ew
+  br label %exit
+
+exit:
+  %r = phi float [ %ax, %then ], [ %s, %else ]
+  ret float %r
+}
+
+declare void @"\01?sideEffect@@YAXXZ"()
+
+; Function Attrs: nounwind readonly
+declare %dx.types.Handle @dx.op.createHandleForLib.CB(i32, %CB) #0
+
+; Function Attrs: nounwind readonly
+declare %dx.types.CBufRet.f32 @dx.op.cbufferLoadLegacy.f32(i32, %dx.types.Handle, i32) #0
+
+attributes #0 = { nounwind readonly }
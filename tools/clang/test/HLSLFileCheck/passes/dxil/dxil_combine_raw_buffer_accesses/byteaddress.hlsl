@@ -0,0 +1,16 @@
+// RUN: %dxc -E main -T cs_6_2 %s | FileCheck %s
+
+// Dword reads at consecutive byte offsets from the same base become one
+// masked load.
+
+// CHECK: call %dx.types.ResRet.i32 @dx.op.rawBufferLoad.i32(i32 139, %dx.types.Handle %{{.*}}, i32 %{{.*}}, i32 undef, i8 7, i32 4)
+// CHECK-NOT: call %dx.types.ResRet.i32 @dx.op.rawBufferLoad
+
+ByteAddressBuffer In;
+RWStructuredBuffer<uint> Out;
+
+[numthreads(64, 1, 1)]
+void main(uint i : SV_DispatchThreadID) {
+  uint base = i * 16;
+  Out[i] = In.Load(base) + In.Load(base + 4) * In.Load(base + 8);
+}
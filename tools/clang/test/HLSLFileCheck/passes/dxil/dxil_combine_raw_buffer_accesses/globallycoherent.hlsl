@@ -0,0 +1,22 @@
+// RUN: %dxc -E main -T cs_6_2 %s | FileCheck %s
+
+// Accesses to globallycoherent UAVs are left as they are.
+
+// CHECK: call %dx.types.ResRet.f32 @dx.op.rawBufferLoad.f32(i32 139, %dx.types.Handle %{{.*}}, i32 %{{.*}}, i32 0, i8 1, i32 4)
+// CHECK: call %dx.types.ResRet.f32 @dx.op.rawBufferLoad.f32(i32 139, %dx.types.Handle %{{.*}}, i32 %{{.*}}, i32 4, i8 1, i32 4)
+// CHECK: call void @dx.op.rawBufferStore.f32(i32 140, %dx.types.Handle %{{.*}}, i32 %{{.*}}, i32 0, float %{{.*}}, float undef, float undef, float undef, i8 1, i32 4)
+// CHECK: call void @dx.op.rawBufferStore.f32(i32 140, %dx.types.Handle %{{.*}}, i32 %{{.*}}, i32 4, float %{{.*}}, float undef, float undef, float undef, i8 1, i32 4)
+
+struct S {
+  float a;
+  float b;
+};
+
+globallycoherent RWStructuredBuffer<S> Buf;
+
+[numthreads(64, 1, 1)]
+void main(uint i : SV_DispatchThreadID) {
+  float sum = Buf[i].a + Buf[i].b;
+  Buf[i + 1].a = sum;
+  Buf[i + 1].b = sum * 2;
+}
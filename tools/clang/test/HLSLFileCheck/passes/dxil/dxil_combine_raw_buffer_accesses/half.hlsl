@@ -0,0 +1,21 @@
+// RUN: %dxc -E main -T cs_6_2 -enable-16bit-types %s | FileCheck %s
+
+// 16-bit fields are merged using their own component size.
+
+// CHECK: call %dx.types.ResRet.f16 @dx.op.rawBufferLoad.f16(i32 139, %dx.types.Handle %{{.*}}, i32 %{{.*}}, i32 0, i8 15, i32 2)
+// CHECK-NOT: call %dx.types.ResRet.f16 @dx.op.rawBufferLoad
+
+struct S {
+  half a;
+  half b;
+  half c;
+  half d;
+};
+
+StructuredBuffer<S> In;
+RWStructuredBuffer<half> Out;
+
+[numthreads(64, 1, 1)]
+void main(uint i : SV_DispatchThreadID) {
+  Out[i] = In[i].a * In[i].b + In[i].c * In[i].d;
+}
@@ -0,0 +1,30 @@
+// RUN: %dxc -E main -T cs_6_2 %s | FileCheck %s
+// RUN: %dxc -E main -T cs_6_2 -opt-disable combine-raw-buffer-accesses %s | FileCheck %s -check-prefix=NOCOMBINE
+
+// Field reads of one structured buffer element become one masked load, and
+// the field writes one masked store.
+
+// CHECK: call %dx.types.ResRet.f32 @dx.op.rawBufferLoad.f32(i32 139, %dx.types.Handle %{{.*}}, i32 %{{.*}}, i32 0, i8 7, i32 4)
+// CHECK-NOT: call %dx.types.ResRet.f32 @dx.op.rawBufferLoad
+// CHECK: call void @dx.op.rawBufferStore.f32(i32 140, %dx.types.Handle %{{.*}}, i32 %{{.*}}, i32 0, float %{{.*}}, float %{{.*}}, float undef, float undef, i8 3, i32 4)
+// CHECK-NOT: call void @dx.op.rawBufferStore
+
+// NOCOMBINE: call %dx.types.ResRet.f32 @dx.op.rawBufferLoad.f32(i32 139, %dx.types.Handle %{{.*}}, i32 %{{.*}}, i32 0, i8 1, i32 4)
+// NOCOMBINE: call %dx.types.ResRet.f32 @dx.op.rawBufferLoad.f32(i32 139, %dx.types.Handle %{{.*}}, i32 %{{.*}}, i32 4, i8 1, i32 4)
+// NOCOMBINE: call %dx.types.ResRet.f32 @dx.op.rawBufferLoad.f32(i32 139, %dx.types.Handle %{{.*}}, i32 %{{.*}}, i32 8, i8 1, i32 4)
+
+struct S {
+  float a;
+  float b;
+  float c;
+};
+
+StructuredBuffer<S> In;
+RWStructuredBuffer<S> Out;
+
+[numthreads(64, 1, 1)]
+void main(uint i : SV_DispatchThreadID) {
+  float sum = In[i].a + In[i].b + In[i].c;
+  Out[i].a = sum;
+  Out[i].b = sum * 2;
+}
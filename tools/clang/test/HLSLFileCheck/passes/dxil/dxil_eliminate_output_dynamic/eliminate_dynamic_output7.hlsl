@@ -0,0 +1,23 @@
+// RUN: %dxc -Emain -Tvs_6_0 %s | %opt -S -hlsl-dxil-eliminate-output-dynamic | %FileCheck %s
+
+// A store that can only write two rows becomes a switch of direct stores.
+// CHECK-NOT: alloca
+// CHECK: switch i32 %{{.+}}, label %[[row1:.+]] [
+// CHECK-NEXT: i32 0, label %[[row0:.+]]
+// CHECK: [[row0]]:
+// CHECK-NEXT: storeOutput.f32(i32 5, i32 1, i32 0, i8 0
+// CHECK: [[row1]]:
+// CHECK-NEXT: storeOutput.f32(i32 5, i32 1, i32 1, i8 0
+// CHECK-NOT: storeOutput.f32(i32 5, i32 1, i32 %
+// CHECK: storeOutput.f32(i32 5, i32 1, i32 5, i8 0, float 1.000000e+00)
+
+int  idx;
+float4 c[16];
+
+float4 main(out float o[16] : I, float4 pos: POS) : SV_POSITION {
+
+    o[idx & 1] = c[idx].x;
+    o[5] = 1;
+
+    return pos;
+}
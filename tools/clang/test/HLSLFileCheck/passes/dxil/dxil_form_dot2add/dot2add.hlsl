@@ -0,0 +1,20 @@
+// RUN: %dxc -E main -T cs_6_4 -enable-16bit-types -opt-enable form-dot2add %s | FileCheck %s
+// RUN: %dxc -E main -T cs_6_4 -enable-16bit-types %s | FileCheck %s -check-prefix=OFF
+
+// The scalarized half2 dot product added to a float becomes one Dot2AddHalf.
+
+// CHECK: call float @dx.op.dot2AddHalf.f32(i32 162, float %{{.*}}, half %{{.*}}, half %{{.*}}, half %{{.*}}, half %{{.*}})
+// CHECK-NOT: fmul
+
+// OFF-NOT: dot2AddHalf
+
+StructuredBuffer<half2> A;
+StructuredBuffer<half2> B;
+RWStructuredBuffer<float> Out;
+
+[numthreads(64, 1, 1)]
+void main(uint i : SV_DispatchThreadID) {
+  half2 a = A[i];
+  half2 b = B[i];
+  Out[i] = Out[i] + (float)a.x * (float)b.x + (float)a.y * (float)b.y;
+}
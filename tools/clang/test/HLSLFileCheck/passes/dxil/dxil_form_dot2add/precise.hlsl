@@ -0,0 +1,20 @@
+// RUN: %dxc -E main -T cs_6_4 -enable-16bit-types -opt-enable form-dot2add %s | FileCheck %s
+// RUN: %dxc -E main -T cs_6_2 -enable-16bit-types -opt-enable form-dot2add %s | FileCheck %s
+
+// Precise math keeps its order, and Dot2AddHalf needs shader model 6.4.
+
+// CHECK-NOT: dot2AddHalf
+// CHECK: fmul
+// CHECK-NOT: dot2AddHalf
+
+StructuredBuffer<half2> A;
+StructuredBuffer<half2> B;
+RWStructuredBuffer<float> Out;
+
+[numthreads(64, 1, 1)]
+void main(uint i : SV_DispatchThreadID) {
+  half2 a = A[i];
+  half2 b = B[i];
+  precise float r = Out[i] + (float)a.x * (float)b.x + (float)a.y * (float)b.y;
+  Out[i] = r;
+}
@@ -0,0 +1,39 @@
+; RUN: %opt %s -dxil-gvn-hoist -S | FileCheck %s
+; RUN: %opt %s -dxil-gvn-hoist,MaxPressure=2 -S | FileCheck %s -check-prefix=LIMIT
+
+; The product both paths compute is hoisted above the branch, unless the
+; values already live there reach the limit.
+; CHECK-LABEL: entry:
+; CHECK: %m = mul i32 %x2, %y2
+; CHECK-NEXT: br i1 %c
+
+; LIMIT-LABEL: entry:
+; LIMIT-NOT: mul
+; LIMIT-LABEL: then:
+; LIMIT: %m = mul i32 %x2, %y2
+; LIMIT-LABEL: else:
+; LIMIT: mul i32 %x2, %y2
+
+target datalayout = "e-m:e-p:32:32-i1:32-i8:32-i16:32-i32:32-i64:64-f16:32-f32:32-f64:64-n8:16:32:64"
+target triple = "dxil-ms-dx"
+
+define i32 @main(i32 %x, i32 %y, i1 %c) {
+entry:
+  %x2 = add i32 %x, 1
+  %y2 = add i32 %y, 1
+  br i1 %c, label %then, label %else
+
+then:
+  %m = mul i32 %x2, %y2
+  %t = add i32 %m, 1
+  br label %exit
+
+else:
+  %n = mul i32 %x2, %y2
+  %e = sub i32 %n, 1
+  br label %exit
+
+exit:
+  %r = phi i32 [ %t, %then ], [ %e, %else ]
+  ret i32 %r
+}
@@ -0,0 +1,41 @@
+// RUN: %dxc -E main -T ms_6_5 %s | FileCheck %s
+
+// Outputs stored once as zero and then with their final value only keep the
+// last store of each component.
+
+// CHECK: call void @dx.op.storeVertexOutput.f32(i32 171, i32 1, i32 0, i8 0, float 0.000000e+00, i32 %[[tid:[0-9]+]])
+// CHECK: call void @dx.op.storeVertexOutput.f32(i32 171, i32 0, i32 0, i8 0, float %{{.+}}, i32 %[[tid]])
+// CHECK: call void @dx.op.storeVertexOutput.f32(i32 171, i32 0, i32 0, i8 1, float %{{.+}}, i32 %[[tid]])
+// CHECK: call void @dx.op.storeVertexOutput.f32(i32 171, i32 0, i32 0, i8 2, float %{{.+}}, i32 %[[tid]])
+// CHECK: call void @dx.op.storeVertexOutput.f32(i32 171, i32 0, i32 0, i8 3, float 1.000000e+00, i32 %[[tid]])
+// CHECK-NOT: call void @dx.op.storeVertexOutput
+// CHECK: call void @dx.op.storePrimitiveOutput.i32(i32 172, i32 0, i32 0, i8 0, i32 %{{.+}}, i32 %[[tid]])
+// CHECK-NOT: call void @dx.op.storePrimitiveOutput
+
+struct MSvert {
+  float4 pos : SV_Position;
+  float fog : FOG;
+};
+
+struct MSprim {
+  uint id : SV_PrimitiveID;
+};
+
+StructuredBuffer<float3> positions;
+
+[outputtopology("triangle")]
+[numthreads(32, 1, 1)]
+void main(
+    in uint tid : SV_GroupThreadID,
+    out vertices MSvert verts[32],
+    out primitives MSprim prims[32],
+    out indices uint3 idx[32])
+{
+  SetMeshOutputCounts(32, 32);
+  MSvert v = (MSvert)0;
+  verts[tid] = v;
+  verts[tid].pos = float4(positions[tid], 1.0f);
+  prims[tid].id = 0;
+  prims[tid].id = tid;
+  idx[tid] = uint3(tid, tid, tid);
+}
@@ -0,0 +1,53 @@
+; RUN: %opt %s -dxil-rematerialize,MaxPressure=2 -S | FileCheck %s
+; RUN: %opt %s -dxil-rematerialize -S | FileCheck %s -check-prefix=OFF
+; RUN: %opt %s -dxil-rematerialize,MaxPressure=64 -S | FileCheck %s -check-prefix=OFF
+
+; The cbuffer value is live across a block that keeps more values live than
+; allowed, so it is read again, with its handle, right before its use.
+; CHECK-LABEL: entry:
+; CHECK-NOT: cbufferLoadLegacy
+; CHECK-LABEL: body:
+; CHECK: %cbh.remat = call %dx.types.Handle @dx.op.createHandle(i32 57, i8 2, i32 0, i32 0, i1 false)
+; CHECK-NEXT: %row.remat = call %dx.types.CBufRet.f32 @dx.op.cbufferLoadLegacy.f32(i32 59, %dx.types.Handle %cbh.remat, i32 0)
+; CHECK-NEXT: %s.remat = extractvalue %dx.types.CBufRet.f32 %row.remat, 0
+; CHECK-NEXT: %r = fmul fast float %x3, %s.remat
+
+; Without a limit, or under it, nothing moves.
+; OFF-NOT: remat
+
+target datalayout = "e-m:e-p:32:32-i1:32-i8:32-i16:32-i32:32-i64:64-f16:32-f32:32-f64:64-n8:16:32:64"
+target triple = "dxil-ms-dx"
+
+%dx.types.Handle = type { i8* }
+%dx.types.CBufRet.f32 = type { float, float, float, float }
+
+define void @main() {
+entry:
+  %cbh = call %dx.types.Handle @dx.op.createHandle(i32 57, i8 2, i32 0, i32 0, i1 false)
+  %row = call %dx.types.CBufRet.f32 @dx.op.cbufferLoadLegacy.f32(i32 59, %dx.types.Handle %cbh, i32 0)
+  %s = extractvalue %dx.types.CBufRet.f32 %row, 0
+  %tid = call i32 @dx.op.threadId.i32(i32 93, i32 0)
+  %a = uitofp i32 %tid to float
+  %b = fadd fast float %a, 1.000000e+00
+  %c = fadd fast float %a, 2.000000e+00
+  %d = fadd fast float %a, 3.000000e+00
+  br label %body
+
+body:
+  %x1 = fmul fast float %a, %b
+  %x2 = fmul fast float %x1, %c
+  %x3 = fmul fast float %x2, %d
+  %r = fmul fast float %x3, %s
+  %uav = call %dx.types.Handle @dx.op.createHandle(i32 57, i8 1, i32 0, i32 0, i1 false)
+  call void @dx.op.bufferStore.f32(i32 69, %dx.types.Handle %uav, i32 %tid, i32 undef, float %r, float %r, float %r, float %r, i8 15)
+  ret void
+}
+
+declare %dx.types.Handle @dx.op.createHandle(i32, i8, i32, i32, i1) #0
+declare %dx.types.CBufRet.f32 @dx.op.cbufferLoadLegacy.f32(i32, %dx.types.Handle, i32) #0
+declare i32 @dx.op.threadId.i32(i32, i32) #1
+declare void @dx.op.bufferStore.f32(i32, %dx.types.Handle, i32, i32, float, float, float, float, i8) #2
+
+attributes #0 = { nounwind readonly }
+attributes #1 = { nounwind readnone }
+attributes #2 = { nounwind }
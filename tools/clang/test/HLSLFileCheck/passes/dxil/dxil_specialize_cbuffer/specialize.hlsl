@@ -0,0 +1,30 @@
+// RUN: %dxc -E main -T ps_6_0 -specialize-cbuffer Material.Mode=2 -specialize-cbuffer Material.Tint=1,0.5,0 %s | FileCheck %s
+// RUN: %dxc -E main -T ps_6_0 %s | FileCheck %s -check-prefix=OFF
+// RUN: %dxc -E main -T ps_6_0 -specialize-cbuffer Material.Missing=1 %s | FileCheck %s -check-prefix=ERR
+
+// Reads of the specialized fields become constants, so the switch folds
+// away and only Scale is still loaded from the buffer.
+
+// CHECK: call %dx.types.CBufRet.f32 @dx.op.cbufferLoadLegacy.f32
+// CHECK-NOT: cbufferLoadLegacy
+// CHECK-NOT: switch
+// CHECK: call void @dx.op.storeOutput.f32(i32 5, i32 0, i32 0, i8 1, float 5.000000e-01)
+
+// OFF: cbufferLoadLegacy.i32
+// OFF: switch
+
+// ERR: cannot specialize 'Material.Missing': no field named 'Missing' in 'Material'.
+
+cbuffer Material {
+  uint Mode;
+  float3 Tint;
+  float Scale;
+};
+
+float4 main() : SV_Target {
+  switch (Mode) {
+  case 0: return Scale;
+  case 1: return float4(Tint, 1) * Scale;
+  default: return float4(Tint, Scale);
+  }
+}
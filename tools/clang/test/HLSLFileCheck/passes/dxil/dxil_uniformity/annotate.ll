@@ -0,0 +1,58 @@
+; RUN: %opt %s -dxil-annotate-uniformity -S | FileCheck %s
+
+; CHECK: %tid = call i32 @dx.op.threadId.i32(i32 93, i32 0){{$}}
+; CHECK: %n = extractvalue %dx.types.CBufRet.i32 %row, 0, !dx.uniformity [[UNIFORM:![0-9]+]]
+; CHECK: %sum = call i32 @dx.op.waveActiveOp.i32(i32 119, i32 %tid, i8 0, i8 1), !dx.uniformity [[WAVE:![0-9]+]]
+; CHECK: %c = icmp ult i32 %tid, %n{{$}}
+; CHECK: br i1 %c, label %loop, label %exit{{$}}
+
+; %i counts iterations, which differ between lanes once out of the loop.
+; CHECK-LABEL: loop:
+; CHECK: %i = phi i32 [ 0, %entry ], [ %next, %loop ], !dx.uniformity [[UNIFORM]]
+; CHECK: br i1 %more, label %loop, label %exit{{$}}
+; CHECK-LABEL: exit:
+; CHECK: %r = phi i32 [ %n, %entry ], [ %i, %loop ]{{$}}
+; CHECK: %x = add i32 %sum, %n, !dx.uniformity [[WAVE]]
+
+; CHECK: [[UNIFORM]] = !{i32 0}
+; CHECK: [[WAVE]] = !{i32 1}
+
+target datalayout = "e-m:e-p:32:32-i1:32-i8:32-i16:32-i32:32-i64:64-f16:32-f32:32-f64:64-n8:16:32:64"
+target triple = "dxil-ms-dx"
+
+%dx.types.Handle = type { i8* }
+%dx.types.CBufRet.i32 = type { i32, i32, i32, i32 }
+
+define void @main() {
+entry:
+  %tid = call i32 @dx.op.threadId.i32(i32 93, i32 0)
+  %cbh = call %dx.types.Handle @dx.op.createHandle(i32 57, i8 2, i32 0, i32 0, i1 false)
+  %row = call %dx.types.CBufRet.i32 @dx.op.cbufferLoadLegacy.i32(i32 59, %dx.types.Handle %cbh, i32 0)
+  %n = extractvalue %dx.types.CBufRet.i32 %row, 0
+  %sum = call i32 @dx.op.waveActiveOp.i32(i32 119, i32 %tid, i8 0, i8 1)
+  %c = icmp ult i32 %tid, %n
+  br i1 %c, label %loop, label %exit
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %next, %loop ]
+  %next = add i32 %i, 1
+  %more = icmp ult i32 %next, %tid
+  br i1 %more, label %loop, label %exit
+
+exit:
+  %r = phi i32 [ %n, %entry ], [ %i, %loop ]
+  %x = add i32 %sum, %n
+  %uav = call %dx.types.Handle @dx.op.createHandle(i32 57, i8 1, i32 0, i32 0, i1 false)
+  call void @dx.op.bufferStore.i32(i32 69, %dx.types.Handle %uav, i32 %tid, i32 undef, i32 %r, i32 %x, i32 %r, i32 %x, i8 15)
+  ret void
+}
+
+declare i32 @dx.op.threadId.i32(i32, i32) #0
+declare i32 @dx.op.waveActiveOp.i32(i32, i32, i8, i8) #1
+declare %dx.types.Handle @dx.op.createHandle(i32, i8, i32, i32, i1) #2
+declare %dx.types.CBufRet.i32 @dx.op.cbufferLoadLegacy.i32(i32, %dx.types.Handle, i32) #2
+declare void @dx.op.bufferStore.i32(i32, %dx.types.Handle, i32, i32, i32, i32, i32, i32, i8) #1
+
+attributes #0 = { nounwind readnone }
+attributes #1 = { nounwind }
+attributes #2 = { nounwind readonly }
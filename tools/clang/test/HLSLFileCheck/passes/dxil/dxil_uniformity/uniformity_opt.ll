@@ -0,0 +1,71 @@
+; RUN: %opt %s -dxil-uniformity-opt -S | FileCheck %s
+
+; NonUniformResourceIndex is dropped from handles indexed by a cbuffer value
+; or by a value read from the first lane, but kept for the thread id.
+; CHECK: %uni = call %dx.types.Handle @dx.op.createHandle(i32 57, i8 1, i32 0, i32 %n, i1 false)
+; CHECK: %wave = call %dx.types.Handle @dx.op.createHandle(i32 57, i8 1, i32 1, i32 %first, i1 false)
+; CHECK: %div = call %dx.types.Handle @dx.op.createHandle(i32 57, i8 1, i32 2, i32 %tid, i1 true)
+
+; The uniform product is computed before the divergent branch, the one that
+; depends on the thread id stays in the branch.
+; CHECK: %s2 = mul i32 %scale, 2
+; CHECK-NEXT: br i1 %c, label %then, label %exit
+; CHECK-LABEL: then:
+; CHECK-NEXT: %v = mul i32 %tid, %s2
+
+; Behind a uniform branch, nothing moves.
+; CHECK-LABEL: exit:
+; CHECK: br i1 %u, label %uthen, label %done
+; CHECK-LABEL: uthen:
+; CHECK-NEXT: %s3 = mul i32 %scale, 3
+
+target datalayout = "e-m:e-p:32:32-i1:32-i8:32-i16:32-i32:32-i64:64-f16:32-f32:32-f64:64-n8:16:32:64"
+target triple = "dxil-ms-dx"
+
+%dx.types.Handle = type { i8* }
+%dx.types.CBufRet.i32 = type { i32, i32, i32, i32 }
+
+define void @main() {
+entry:
+  %tid = call i32 @dx.op.threadId.i32(i32 93, i32 0)
+  %cbh = call %dx.types.Handle @dx.op.createHandle(i32 57, i8 2, i32 0, i32 0, i1 false)
+  %row = call %dx.types.CBufRet.i32 @dx.op.cbufferLoadLegacy.i32(i32 59, %dx.types.Handle %cbh, i32 0)
+  %n = extractvalue %dx.types.CBufRet.i32 %row, 0
+  %scale = extractvalue %dx.types.CBufRet.i32 %row, 1
+  %first = call i32 @dx.op.waveReadLaneFirst.i32(i32 118, i32 %tid)
+  %uni = call %dx.types.Handle @dx.op.createHandle(i32 57, i8 1, i32 0, i32 %n, i1 true)
+  %wave = call %dx.types.Handle @dx.op.createHandle(i32 57, i8 1, i32 1, i32 %first, i1 true)
+  %div = call %dx.types.Handle @dx.op.createHandle(i32 57, i8 1, i32 2, i32 %tid, i1 true)
+  %c = icmp ult i32 %tid, %n
+  br i1 %c, label %then, label %exit
+
+then:
+  %s2 = mul i32 %scale, 2
+  %v = mul i32 %tid, %s2
+  call void @dx.op.bufferStore.i32(i32 69, %dx.types.Handle %uni, i32 %tid, i32 undef, i32 %v, i32 %v, i32 %v, i32 %v, i8 15)
+  call void @dx.op.bufferStore.i32(i32 69, %dx.types.Handle %wave, i32 %tid, i32 undef, i32 %v, i32 %v, i32 %v, i32 %v, i8 15)
+  call void @dx.op.bufferStore.i32(i32 69, %dx.types.Handle %div, i32 %tid, i32 undef, i32 %v, i32 %v, i32 %v, i32 %v, i8 15)
+  br label %exit
+
+exit:
+  %u = icmp ugt i32 %n, 4
+  br i1 %u, label %uthen, label %done
+
+uthen:
+  %s3 = mul i32 %scale, 3
+  call void @dx.op.bufferStore.i32(i32 69, %dx.types.Handle %uni, i32 %tid, i32 undef, i32 %s3, i32 %s3, i32 %s3, i32 %s3, i8 15)
+  br label %done
+
+done:
+  ret void
+}
+
+declare i32 @dx.op.threadId.i32(i32, i32) #0
+declare i32 @dx.op.waveReadLaneFirst.i32(i32, i32) #1
+declare %dx.types.Handle @dx.op.createHandle(i32, i8, i32, i32, i1) #2
+declare %dx.types.CBufRet.i32 @dx.op.cbufferLoadLegacy.i32(i32, %dx.types.Handle, i32) #2
+declare void @dx.op.bufferStore.i32(i32, %dx.types.Handle, i32, i32, i32, i32, i32, i32, i8) #1
+
+attributes #0 = { nounwind readnone }
+attributes #1 = { nounwind }
+attributes #2 = { nounwind readonly }
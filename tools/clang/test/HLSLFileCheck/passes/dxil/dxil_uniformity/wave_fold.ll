@@ -0,0 +1,55 @@
+; RUN: %opt %s -dxil-uniformity-opt -S | FileCheck %s
+
+; Wave operations on a cbuffer value are replaced with the value, and
+; WaveActiveAllEqual on it with true. Those on the thread id stay.
+; CHECK-NOT: waveReadLaneFirst.i32(i32 118, i32 %n)
+; CHECK-NOT: waveActiveOp.i32(i32 119, i32 %n
+; CHECK-NOT: waveActiveAllEqual.i32(i32 115, i32 %n)
+; CHECK: %tfirst = call i32 @dx.op.waveReadLaneFirst.i32(i32 118, i32 %tid)
+; CHECK: %tmax = call i32 @dx.op.waveActiveOp.i32(i32 119, i32 %tid, i8 3, i8 1)
+; CHECK: call void @dx.op.bufferStore.i32(i32 69, %dx.types.Handle %buf, i32 %tid, i32 undef, i32 %n, i32 %n, i32 %tfirst, i32 %tmax, i8 15)
+; CHECK: %eqi = zext i1 true to i32
+
+; Xor depends on the number of lanes, so it is kept.
+; CHECK: %xor = call i32 @dx.op.waveActiveBit.i32(i32 120, i32 %n, i8 2)
+; CHECK: call void @dx.op.bufferStore.i32(i32 69, %dx.types.Handle %buf, i32 0, i32 undef, i32 %eqi, i32 %xor, i32 %n, i32 %n, i8 15)
+
+target datalayout = "e-m:e-p:32:32-i1:32-i8:32-i16:32-i32:32-i64:64-f16:32-f32:32-f64:64-n8:16:32:64"
+target triple = "dxil-ms-dx"
+
+%dx.types.Handle = type { i8* }
+%dx.types.CBufRet.i32 = type { i32, i32, i32, i32 }
+
+define void @main() {
+entry:
+  %tid = call i32 @dx.op.threadId.i32(i32 93, i32 0)
+  %cbh = call %dx.types.Handle @dx.op.createHandle(i32 57, i8 2, i32 0, i32 0, i1 false)
+  %buf = call %dx.types.Handle @dx.op.createHandle(i32 57, i8 1, i32 0, i32 0, i1 false)
+  %row = call %dx.types.CBufRet.i32 @dx.op.cbufferLoadLegacy.i32(i32 59, %dx.types.Handle %cbh, i32 0)
+  %n = extractvalue %dx.types.CBufRet.i32 %row, 0
+  %first = call i32 @dx.op.waveReadLaneFirst.i32(i32 118, i32 %n)
+  %max = call i32 @dx.op.waveActiveOp.i32(i32 119, i32 %n, i8 3, i8 1)
+  %tfirst = call i32 @dx.op.waveReadLaneFirst.i32(i32 118, i32 %tid)
+  %tmax = call i32 @dx.op.waveActiveOp.i32(i32 119, i32 %tid, i8 3, i8 1)
+  call void @dx.op.bufferStore.i32(i32 69, %dx.types.Handle %buf, i32 %tid, i32 undef, i32 %first, i32 %max, i32 %tfirst, i32 %tmax, i8 15)
+  %eq = call i1 @dx.op.waveActiveAllEqual.i32(i32 115, i32 %n)
+  %eqi = zext i1 %eq to i32
+  %xor = call i32 @dx.op.waveActiveBit.i32(i32 120, i32 %n, i8 2)
+  %or = call i32 @dx.op.waveActiveBit.i32(i32 120, i32 %n, i8 1)
+  %and = call i32 @dx.op.waveActiveBit.i32(i32 120, i32 %n, i8 0)
+  call void @dx.op.bufferStore.i32(i32 69, %dx.types.Handle %buf, i32 0, i32 undef, i32 %eqi, i32 %xor, i32 %or, i32 %and, i8 15)
+  ret void
+}
+
+declare i32 @dx.op.threadId.i32(i32, i32) #0
+declare i32 @dx.op.waveReadLaneFirst.i32(i32, i32) #1
+declare i32 @dx.op.waveActiveOp.i32(i32, i32, i8, i8) #1
+declare i1 @dx.op.waveActiveAllEqual.i32(i32, i32) #1
+declare i32 @dx.op.waveActiveBit.i32(i32, i32, i8) #1
+declare %dx.types.Handle @dx.op.createHandle(i32, i8, i32, i32, i1) #2
+declare %dx.types.CBufRet.i32 @dx.op.cbufferLoadLegacy.i32(i32, %dx.types.Handle, i32) #2
+declare void @dx.op.bufferStore.i32(i32, %dx.types.Handle, i32, i32, i32, i32, i32, i32, i8) #1
+
+attributes #0 = { nounwind readnone }
+attributes #1 = { nounwind }
+attributes #2 = { nounwind readonly }
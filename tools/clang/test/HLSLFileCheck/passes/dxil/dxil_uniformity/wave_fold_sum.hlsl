@@ -0,0 +1,21 @@
+// RUN: %dxc -T cs_6_0 -E main %s | FileCheck %s
+// RUN: %dxc -T cs_6_0 -E main -opt-disable fold-uniform-wave-ops %s | FileCheck %s -check-prefix=NOFOLD
+
+// A wave sum of a cbuffer value is the value times the active lane count.
+// CHECK: %[[n:.+]] = extractvalue %dx.types.CBufRet.i32 %{{.+}}, 0
+// CHECK-NOT: waveActiveOp
+// CHECK: %[[count:.+]] = call i32 @dx.op.waveAllOp(i32 135, i1 true)
+// CHECK: mul i32 %[[n]], %[[count]]
+
+// NOFOLD: call i32 @dx.op.waveActiveOp.i32(i32 119,
+
+cbuffer C {
+  uint n;
+};
+
+RWByteAddressBuffer buf;
+
+[numthreads(64, 1, 1)]
+void main(uint tid : SV_DispatchThreadID) {
+  buf.Store(tid * 4, WaveActiveSum(n));
+}
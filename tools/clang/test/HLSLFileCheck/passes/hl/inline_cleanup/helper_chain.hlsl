@@ -0,0 +1,40 @@
+// RUN: %dxc -E main -T ps_6_0 -opt-enable inline-cleanup %s | FileCheck %s
+// RUN: %dxc -E main -T ps_6_0 -opt-enable inline-cleanup -Zi %s | FileCheck %s
+// RUN: %dxc -E main -T ps_6_0 %s | FileCheck %s
+
+// Helpers that call each other get cleaned up before they are inlined, and
+// the result is the same as without the cleanup.
+
+// CHECK: @main
+// CHECK: %[[x:.+]] = call i32 @dx.op.loadInput.i32
+// CHECK: %[[m:.+]] = mul i32 %[[x]], 6561
+// CHECK: add i32 %[[m]], 1
+// CHECK-NOT: call {{.*}}@"\01?
+// CHECK: ret void
+
+uint f0(uint x) {
+  uint t = x;
+  t *= 3;
+  return t;
+}
+
+uint f1(uint x) {
+  uint t = f0(x);
+  return f0(t);
+}
+
+uint f2(uint x) {
+  uint t = f1(x);
+  return f1(t);
+}
+
+void f3(uint x, out uint y) {
+  uint t = f2(x);
+  y = f2(t) + 1;
+}
+
+uint main(uint a : A) : SV_Target {
+  uint r;
+  f3(a, r);
+  return r;
+}
@@ -0,0 +1,25 @@
+// RUN: %dxc /Od /Tps_6_0 /Emain %s | FileCheck %s
+
+// Only the loop whose induction variable feeds the offsets is unrolled.
+// CHECK: @dx.op.sample.f32(i32 60, {{.*}}, i32 -2, i32 0, i32 undef
+// CHECK: @dx.op.sample.f32(i32 60, {{.*}}, i32 -1, i32 0, i32 undef
+// CHECK: @dx.op.sample.f32(i32 60, {{.*}}, i32 0, i32 0, i32 undef
+// CHECK: @dx.op.sample.f32(i32 60, {{.*}}, i32 1, i32 0, i32 undef
+// CHECK: @dx.op.sample.f32(i32 60, {{.*}}, i32 2, i32 0, i32 undef
+// The weight loop feeds no offset and stays rolled.
+// CHECK: phi i32
+// CHECK: br i1
+
+Texture2D t;
+SamplerState s;
+float4 w[8];
+
+float4 main(float2 uv : TEXCOORD) : SV_Target {
+  float4 c = 0;
+  for (int i = -2; i <= 2; i++)
+    c += t.Sample(s, uv, int2(i, 0));
+  float f = 0;
+  for (uint j = 0; j < 8; j++)
+    f += w[j].x;
+  return c * f;
+}
@@ -0,0 +1,30 @@
+// RUN: %dxc -E main -T cs_6_0 -opt-enable pad-groupshared %s | FileCheck %s
+// RUN: %dxc -E main -T cs_6_0 -opt-enable pad-groupshared -Zi %s | FileCheck %s
+// RUN: %dxc -E main -T cs_6_0 %s | FileCheck %s -check-prefix=NOPAD
+
+// A transpose through a tile reads it by columns, so its rows get padded to
+// 33 elements. The row index of every access is scaled by the padded length.
+// The other tile is only indexed by constant rows, so it is left alone.
+
+// CHECK: addrspace(3) global [1056 x float]
+// CHECK: addrspace(3) global [64 x float]
+// CHECK: mul i32 %{{.+}}, 33
+// CHECK-NOT: mul i32 %{{.+}}, 32
+// CHECK: ret void
+
+// NOPAD: addrspace(3) global [1024 x float]
+// NOPAD: addrspace(3) global [64 x float]
+
+RWStructuredBuffer<float> buf;
+
+groupshared float tile[32][32];
+groupshared float rows[2][32];
+
+[numthreads(32, 32, 1)]
+void main(uint3 tid : SV_GroupThreadID, uint gi : SV_GroupIndex) {
+  tile[tid.y][tid.x] = buf[gi];
+  if (tid.y < 2)
+    rows[1][tid.x] = buf[tid.x];
+  GroupMemoryBarrierWithGroupSync();
+  buf[gi] = tile[tid.x][tid.y] + rows[1][tid.y];
+}
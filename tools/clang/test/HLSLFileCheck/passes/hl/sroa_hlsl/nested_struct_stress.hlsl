@@ -0,0 +1,35 @@
+// RUN: %dxc -E main -T cs_6_0 %s | FileCheck %s
+
+// Stress test for SROA on a struct with 4096 nested members, copied through a
+// local, a static global and a function parameter. Every one of the split
+// elements goes through the SROA work list, so this is also useful for timing
+// the pass with -Qpass-report. The struct comes from a cbuffer, since
+// structured buffer elements are limited to 2048 bytes.
+
+// CHECK-NOT: alloca
+// CHECK: call %dx.types.CBufRet.f32 @dx.op.cbufferLoadLegacy.f32(
+// CHECK: call void @dx.op.bufferStore.f32(
+// CHECK: ret void
+
+struct L0 { float a, b, c, d, e, f, g, h; };
+struct L1 { L0 a, b, c, d, e, f, g, h; };
+struct L2 { L1 a, b, c, d, e, f, g, h; };
+struct L3 { L2 a, b, c, d, e, f, g, h; };
+
+cbuffer CB : register(b0) {
+  L3 input;
+};
+RWStructuredBuffer<float> output : register(u0);
+
+static L3 copy;
+
+float sum(L3 v) {
+  return v.a.a.a.a + v.b.c.d.e + v.h.h.h.h;
+}
+
+[numthreads(1, 1, 1)]
+void main() {
+  L3 local = input;
+  copy = local;
+  output[0] = sum(copy) + local.d.e.f.g;
+}
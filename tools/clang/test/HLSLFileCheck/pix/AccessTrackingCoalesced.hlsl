@@ -0,0 +1,30 @@
+// RUN: %dxc -ECSMain -Tcs_6_0 %s | %opt -S -hlsl-dxil-pix-shader-access-instrumentation,config=S0:1:1i1;U0:2:10i0;.0;0;0.,coalesceWaveAccesses=1 | %FileCheck %s
+
+// The two loads from inBuffer share a block and a record, so only one store
+// is emitted for them, and only the first lane of the wave makes it:
+// CHECK: call %dx.types.ResRet.i32 @dx.op.bufferLoad.i32(i32 68, %dx.types.Handle %inBuffer
+// CHECK: %IsFirstLane = call i1 @dx.op.waveIsFirstLane(i32 110)
+// CHECK-NEXT: br i1 %IsFirstLane
+// CHECK: call void @dx.op.bufferStore.i32(i32 69, %dx.types.Handle %PIX_CountUAV_Handle
+// CHECK-NOT: %PIX_CountUAV_Handle
+// CHECK: call %dx.types.ResRet.i32 @dx.op.bufferLoad.i32(i32 68, %dx.types.Handle %inBuffer
+
+// The dynamically indexed write is stored by the first lane, and by any lane
+// whose record differs from the first lane's:
+// CHECK: %FirstLaneOffset = call i32 @dx.op.waveReadLaneFirst.i32(i32 118, i32
+// CHECK: %IsDistinctRecord = icmp ne i32
+// CHECK: %ShouldStore = or i1
+// CHECK-NEXT: br i1 %ShouldStore
+// CHECK: call void @dx.op.bufferStore.i32(i32 69, %dx.types.Handle %PIX_CountUAV_Handle
+// CHECK: call void @dx.op.bufferStore.i32(i32 69, %dx.types.Handle %bufferArray
+
+ByteAddressBuffer inBuffer : register(t0);
+RWByteAddressBuffer bufferArray[] : register(u0);
+
+[numthreads(64, 1, 1)]
+void CSMain(uint tid : SV_GroupIndex)
+{
+  uint dynamicBufferIndex = inBuffer.Load(0) + inBuffer.Load(tid * 4);
+
+  bufferArray[dynamicBufferIndex].Store(0, 1);
+}
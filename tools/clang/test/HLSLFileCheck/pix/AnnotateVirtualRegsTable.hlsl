@@ -0,0 +1,17 @@
+// RUN: %dxc -Emain -Tps_6_0 %s -Od | %opt -S -dxil-annotate-with-virtual-regs | %FileCheck %s
+
+// Check that the virtual register numbering is stored as one table attached
+// to the function rather than as metadata on each instruction:
+
+// CHECK: define void @main() {{.*}}!pix-dxil-reg-table ![[TABLE:[0-9]+]]
+// CHECK-NOT: !pix-dxil-reg !
+// CHECK-NOT: !pix-alloca-reg
+// CHECK: ret void
+// CHECK: ![[TABLE]] = !{[{{[0-9]+}} x i32] [i32 {{[0-9]+}}, i32 {{[0-9]+}}{{.*}}], {{.*}}, {{.*}}}
+
+float4 main(float4 color : COLOR, uint index : INDEX) : SV_Target
+{
+  float values[4] = { color.x, color.y, color.z, color.w };
+  values[index & 3] *= 2;
+  return float4(values[0], values[1], values[2], values[3]);
+}
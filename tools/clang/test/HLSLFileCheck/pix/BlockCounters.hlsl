@@ -0,0 +1,28 @@
+// RUN: %dxc -EFlowControlCS -Tcs_6_0 %s | %opt -S -hlsl-dxil-pix-block-counters | %FileCheck %s
+// RUN: %dxc -EFlowControlCS -Tcs_6_0 %s | %opt -S -hlsl-dxil-pix-block-counters,sampleRate=4 | %FileCheck -check-prefix=SAMPLED %s
+
+// The wave count goes to offset 0, and each block's lane count is added by
+// the first active lane only:
+// CHECK: %PIX_BlockCounters_Handle = call %dx.types.Handle @dx.op.createHandle(
+// CHECK: call i1 @dx.op.waveIsFirstLane(i32 110)
+// CHECK: call i32 @dx.op.atomicBinOp.i32(i32 78, %dx.types.Handle %PIX_BlockCounters_Handle, i32 0, i32 0
+// CHECK: call i32 @dx.op.waveAllOp(i32 135, i1 true)
+// CHECK: call i32 @dx.op.atomicBinOp.i32(i32 78, %dx.types.Handle %PIX_BlockCounters_Handle, i32 0, i32 4
+// CHECK: call i32 @dx.op.atomicBinOp.i32(i32 78, %dx.types.Handle %PIX_BlockCounters_Handle, i32 0, i32 8
+
+// With sampling, the wave ordinal decides whether the wave is counted:
+// SAMPLED: call i32 @dx.op.waveReadLaneFirst.i32(i32 118
+// SAMPLED: urem i32 %WaveOrdinal, 4
+// SAMPLED: and i1 %IsFirstLane{{[0-9]*}}, %WaveIsSampled
+
+RWByteAddressBuffer Output : register(u0);
+
+[numthreads(64, 1, 1)]
+void FlowControlCS(uint tid : SV_GroupIndex)
+{
+  uint ret = 0;
+  if (Output.Load(tid * 4) > 1) {
+    ret = Output.Load(tid * 4 + 256);
+  }
+  Output.Store(tid * 4, ret);
+}
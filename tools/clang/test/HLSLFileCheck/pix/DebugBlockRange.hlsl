@@ -0,0 +1,18 @@
+// RUN: %dxc -EFlowControlPS -Tps_6_0 %s -Od | %opt -S -dxil-annotate-with-virtual-regs -hlsl-dxil-debug-instrumentation,lastInstrumentedBlock=0 | %FileCheck %s
+
+// Only the entry block is instrumented, so the phi in the block after the
+// if/else gets no instrumentation blocks on its incoming edges:
+// CHECK: call i32 @dx.op.atomicBinOp.i32(i32 78
+// CHECK-NOT: PIXDebug
+
+
+float4 FlowControlPS(in uint value : value ) : SV_Target
+{
+  float4 ret = float4(0, 0, 0, 0);
+  if (value > 1) {
+    ret = float4(0, 0, 0, 2);
+  } else {
+    ret = float4(0, 0, 0, 1);
+  }
+  return ret;
+}
@@ -5,8 +5,8 @@
 // CHECK: groupId
 
 // check intrinsic used.
-// CHECK: textureLoad
 // CHECK: bufferLoad
+// CHECK: textureLoad
 // CHECK: IMin
 // CHECK: IMax
 // CHECK: dot3
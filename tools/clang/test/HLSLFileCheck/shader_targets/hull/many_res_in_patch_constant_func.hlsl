@@ -0,0 +1,61 @@
+// RUN: %dxc -E main -T hs_6_0 %s | FileCheck %s
+// RUN: %dxc -E main -T hs_6_0 %s | FileCheck %s -check-prefix=PATCH
+
+// Many resources used only by the patch constant function. Their handles are
+// created where they are loaded, so the control point function gets none.
+// CHECK: define void @main()
+// CHECK-NOT: @dx.op.createHandle
+// CHECK: ret void
+
+// PATCH: define void @"\01?HSPerPatchFunc@@YA?AUHSPerPatchData@@XZ"()
+// PATCH-DAG: call %dx.types.Handle @dx.op.createHandle(i32 57, i8 0, i32 0, i32 0, i1 false)
+// PATCH-DAG: call %dx.types.Handle @dx.op.createHandle(i32 57, i8 0, i32 255, i32 255, i1 false)
+
+#define DECL2(p) Buffer<float> p##0; Buffer<float> p##1;
+#define DECL4(p) DECL2(p##0) DECL2(p##1)
+#define DECL8(p) DECL4(p##0) DECL4(p##1)
+#define DECL16(p) DECL8(p##0) DECL8(p##1)
+#define DECL32(p) DECL16(p##0) DECL16(p##1)
+#define DECL64(p) DECL32(p##0) DECL32(p##1)
+#define DECL128(p) DECL64(p##0) DECL64(p##1)
+#define DECL256(p) DECL128(p##0) DECL128(p##1)
+
+#define SUM2(p) (p##0[0] + p##1[0])
+#define SUM4(p) (SUM2(p##0) + SUM2(p##1))
+#define SUM8(p) (SUM4(p##0) + SUM4(p##1))
+#define SUM16(p) (SUM8(p##0) + SUM8(p##1))
+#define SUM32(p) (SUM16(p##0) + SUM16(p##1))
+#define SUM64(p) (SUM32(p##0) + SUM32(p##1))
+#define SUM128(p) (SUM64(p##0) + SUM64(p##1))
+#define SUM256(p) (SUM128(p##0) + SUM128(p##1))
+
+DECL256(buf)
+
+struct HSPerPatchData
+{
+	float	edges[3] : SV_TessFactor;
+	float	inside   : SV_InsideTessFactor;
+};
+
+HSPerPatchData HSPerPatchFunc()
+{
+  HSPerPatchData d;
+
+  d.edges[0] = -5;
+  d.edges[1] = -6;
+  d.edges[2] = -7;
+  d.inside = SUM256(buf);
+
+  return d;
+}
+
+// hull per-control point shader
+[domain("tri")]
+[partitioning("fractional_odd")]
+[outputtopology("triangle_cw")]
+[patchconstantfunc("HSPerPatchFunc")]
+[outputcontrolpoints(3)]
+void main( const uint id : SV_OutputControlPointID )
+{
+
+}
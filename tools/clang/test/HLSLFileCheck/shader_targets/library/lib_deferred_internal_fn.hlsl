@@ -0,0 +1,31 @@
+// RUN: %dxc -T lib_6_3 -fcgl %s | FileCheck %s
+// RUN: %dxc -T lib_6_3 -default-linkage external -fcgl %s | FileCheck %s -check-prefix=EXTERNAL
+
+// Functions that end up internal are only generated when something calls
+// them, even before dead function elimination.
+// CHECK-NOT: unused_fn
+// CHECK: define float @"\01?export_fn
+// CHECK: define internal float @"\01?used_fn
+// CHECK-NOT: unused_fn
+// CHECK: define <4 x float> @PSMain
+// CHECK-NOT: unused_fn
+// CHECK: define void @CSMain
+// CHECK-NOT: unused_fn
+
+// With external default linkage every function is kept.
+// EXTERNAL-DAG: define float @"\01?unused_fn
+// EXTERNAL-DAG: define float @"\01?used_fn
+// EXTERNAL-DAG: define float @"\01?export_fn
+
+float unused_fn() { return 1.0; }
+float used_fn() { return 2.0; }
+export float export_fn() { return used_fn(); }
+
+[shader("pixel")]
+float4 PSMain() : SV_Target {
+  return export_fn();
+}
+
+// A stage attribute alone also makes a function an entry, which is kept.
+[numthreads(1, 1, 1)]
+void CSMain() {}
@@ -0,0 +1,60 @@
+// RUN: %dxc -T lib_6_3 %s | FileCheck %s
+
+// Enough functions for bodies to be validated concurrently; diagnostics must
+// still be reported in module order.
+
+// CHECK: Instructions should not read uninitialized value
+// CHECK: of function '{{.*}}f0@@
+// CHECK: Instructions should not read uninitialized value
+// CHECK: of function '{{.*}}f1@@
+// CHECK: Instructions should not read uninitialized value
+// CHECK: of function '{{.*}}f2@@
+// CHECK: Instructions should not read uninitialized value
+// CHECK: of function '{{.*}}f3@@
+// CHECK: Instructions should not read uninitialized value
+// CHECK: of function '{{.*}}f4@@
+// CHECK: Instructions should not read uninitialized value
+// CHECK: of function '{{.*}}f5@@
+// CHECK: Instructions should not read uninitialized value
+// CHECK: of function '{{.*}}f6@@
+// CHECK: Instructions should not read uninitialized value
+// CHECK: of function '{{.*}}f7@@
+// CHECK: Instructions should not read uninitialized value
+// CHECK: of function '{{.*}}f8@@
+// CHECK: Instructions should not read uninitialized value
+// CHECK: of function '{{.*}}f9@@
+// CHECK: Instructions should not read uninitialized value
+// CHECK: of function '{{.*}}f10@@
+// CHECK: Instructions should not read uninitialized value
+// CHECK: of function '{{.*}}f11@@
+// CHECK: Instructions should not read uninitialized value
+// CHECK: of function '{{.*}}f12@@
+// CHECK: Instructions should not read uninitialized value
+// CHECK: of function '{{.*}}f13@@
+// CHECK: Instructions should not read uninitialized value
+// CHECK: of function '{{.*}}f14@@
+// CHECK: Instructions should not read uninitialized value
+// CHECK: of function '{{.*}}f15@@
+// CHECK: Instructions should not read uninitialized value
+// CHECK: of function '{{.*}}f16@@
+// CHECK: Instructions should not read uninitialized value
+// CHECK: of function '{{.*}}f17@@
+
+export float f0(float b) { float a; return b + a; }
+export float f1(float b) { float a; return b + a; }
+export float f2(float b) { float a; return b + a; }
+export float f3(float b) { float a; return b + a; }
+export float f4(float b) { float a; return b + a; }
+export float f5(float b) { float a; return b + a; }
+export float f6(float b) { float a; return b + a; }
+export float f7(float b) { float a; return b + a; }
+export float f8(float b) { float a; return b + a; }
+export float f9(float b) { float a; return b + a; }
+export float f10(float b) { float a; return b + a; }
+export float f11(float b) { float a; return b + a; }
+export float f12(float b) { float a; return b + a; }
+export float f13(float b) { float a; return b + a; }
+export float f14(float b) { float a; return b + a; }
+export float f15(float b) { float a; return b + a; }
+export float f16(float b) { float a; return b + a; }
+export float f17(float b) { float a; return b + a; }
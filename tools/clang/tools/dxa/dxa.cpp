@@ -26,6 +26,7 @@
 #include "llvm/Support/raw_ostream.h"
 #include <dia2.h>
 #include <intsafe.h>
+#include <vector>
 
 using namespace llvm;
 using namespace llvm::opt;
@@ -36,8 +37,12 @@ static cl::opt<bool> Help("help", cl::desc("Print help"));
 static cl::alias Help_h("h", cl::aliasopt(Help));
 static cl::alias Help_q("?", cl::aliasopt(Help));
 
-static cl::opt<std::string> InputFilename(cl::Positional,
-                                          cl::desc("<input .llvm file>"));
+static cl::list<std::string> InputFilenames(cl::Positional,
+                                            cl::desc("<input .llvm files>"),
+                                            cl::ZeroOrMore);
+
+// The input when only one is given, which every mode but assembly requires.
+static std::string InputFilename;
 
 static cl::opt<std::string> OutputFilename("o",
                                            cl::desc("Override output filename"),
@@ -75,6 +80,10 @@ public:
   DxaContext(DxcDllSupport &dxcSupport) : m_dxcSupport(dxcSupport) {}
 
   void Assemble();
+  // Assembles every input concurrently, writing each container next to its
+  // input, and prints a summary in input order. Returns the number of inputs
+  // that failed.
+  unsigned AssembleBatch(const std::vector<std::string> &InputFilenames);
   bool ExtractFile(const char *pName);
   bool ExtractPart(const char *pName);
   void ListFiles();
@@ -83,6 +92,78 @@ public:
   void DumpRDAT();
 };
 
+// Returns the default output name for the container assembled from
+// InputFilename.
+static std::string GetAssembledFilename(StringRef IFN) {
+  if (IFN == "-")
+    return "-";
+  std::string Result = (IFN.endswith(".ll") ? IFN.drop_back(3) : IFN).str();
+  Result = (IFN.endswith(".bc") ? IFN.drop_back(3) : IFN).str();
+  Result += ".dxbc";
+  return Result;
+}
+
+// Returns the text of an operation result's error buffer.
+static std::string GetErrorText(IDxcOperationResult *pResult) {
+  CComPtr<IDxcBlobEncoding> text;
+  IFT(pResult->GetErrorBuffer(&text));
+  if (!text || text->GetBufferSize() == 0)
+    return std::string();
+  const char *pStart = (const char *)text->GetBufferPointer();
+  return std::string(pStart, strnlen(pStart, text->GetBufferSize()));
+}
+
+unsigned DxaContext::AssembleBatch(const std::vector<std::string> &InputFilenames) {
+  UINT32 inputCount = (UINT32)InputFilenames.size();
+  std::vector<CComPtr<IDxcBlobEncoding>> sources(inputCount);
+  std::vector<IDxcBlob *> shaders(inputCount);
+  for (UINT32 i = 0; i < inputCount; ++i) {
+    ReadFileIntoBlob(m_dxcSupport, StringRefWide(InputFilenames[i]),
+                     &sources[i]);
+    shaders[i] = sources[i];
+  }
+
+  CComPtr<IDxcAssembler> pAssembler;
+  CComPtr<IDxcAssembler2> pAssembler2;
+  IFT(m_dxcSupport.CreateInstance(CLSID_DxcAssembler, &pAssembler));
+  std::vector<CComPtr<IDxcOperationResult>> results(inputCount);
+  if (SUCCEEDED(pAssembler.QueryInterface(&pAssembler2))) {
+    std::vector<IDxcOperationResult *> pResults(inputCount);
+    IFT(pAssembler2->AssembleToContainerBatch(shaders.data(), inputCount,
+                                              pResults.data()));
+    for (UINT32 i = 0; i < inputCount; ++i)
+      results[i].Attach(pResults[i]);
+  } else {
+    // Older assemblers have no batch entry point.
+    for (UINT32 i = 0; i < inputCount; ++i)
+      IFT(pAssembler->AssembleToContainer(shaders[i], &results[i]));
+  }
+
+  unsigned failedCount = 0;
+  for (UINT32 i = 0; i < inputCount; ++i) {
+    const char *pName = InputFilenames[i].c_str();
+    HRESULT status;
+    IFT(results[i]->GetStatus(&status));
+    CComPtr<IDxcBlob> pContainer;
+    if (SUCCEEDED(status))
+      IFT(results[i]->GetResult(&pContainer));
+    if (pContainer.p == nullptr) {
+      ++failedCount;
+      printf("%s: Assembly failed.\n", pName);
+      std::string errors = GetErrorText(results[i]);
+      if (!errors.empty())
+        printf("%s\n", errors.c_str());
+      continue;
+    }
+    std::string outputName = GetAssembledFilename(InputFilenames[i]);
+    WriteBlobToFile(pContainer, StringRefWide(outputName), DXC_CP_ACP);
+    printf("%s: Output written to \"%s\"\n", pName, outputName.c_str());
+  }
+  printf("%u of %u assembled, %u failed.\n", inputCount - failedCount,
+         inputCount, failedCount);
+  return failedCount;
+}
+
 void DxaContext::Assemble() {
   CComPtr<IDxcOperationResult> pAssembleResult;
 
@@ -111,16 +192,8 @@ void DxaContext::Assemble() {
     IFT(pAssembleResult->GetResult(&pContainer));
     if (pContainer.p != nullptr) {
       // Infer the output filename if needed.
-      if (OutputFilename.empty()) {
-        if (InputFilename == "-") {
-          OutputFilename = "-";
-        } else {
-          StringRef IFN = InputFilename;
-          OutputFilename = (IFN.endswith(".ll") ? IFN.drop_back(3) : IFN).str();
-          OutputFilename = (IFN.endswith(".bc") ? IFN.drop_back(3) : IFN).str();
-          OutputFilename += ".dxbc";
-        }
-      }
+      if (OutputFilename.empty())
+        OutputFilename = GetAssembledFilename(InputFilename);
 
       WriteBlobToFile(pContainer, StringRefWide(OutputFilename), DXC_CP_ACP);
       printf("Output written to \"%s\"\n", OutputFilename.c_str());
@@ -254,7 +327,7 @@ bool DxaContext::ExtractPart(const char *pName) {
     if (InputFilename == "-") {
       OutputFilename = "-";
     } else {
-      OutputFilename = InputFilename.getValue();
+      OutputFilename = InputFilename;
       OutputFilename += ".";
       if (extractModule) {
         OutputFilename += "ll";
@@ -402,11 +475,18 @@ int __cdecl main(int argc, _In_reads_z_(argc) char **argv) {
     // Parse command line options.
     cl::ParseCommandLineOptions(argc, argv, "dxil assembly\n");
 
-    if (InputFilename == "" || Help) {
+    if (InputFilenames.empty() || InputFilenames[0] == "" || Help) {
       cl::PrintHelpMessage();
       return 2;
     }
-
+    if (InputFilenames.size() > 1 &&
+        (ListParts || ListFiles || !ExtractPart.empty() ||
+         !ExtractFile.empty() || DumpRootSig || DumpRDAT ||
+         !OutputFilename.empty())) {
+      printf("Only assembly without -o accepts several input files.\n");
+      return 2;
+    }
+    InputFilename = InputFilenames[0];
 
     DxcDllSupport dxcSupport;
     dxc::EnsureEnabled(dxcSupport);
@@ -437,6 +517,13 @@ int __cdecl main(int argc, _In_reads_z_(argc) char **argv) {
       pStage = "Dump RDAT";
       context.DumpRDAT();
     }
+    else if (InputFilenames.size() > 1) {
+      pStage = "Assembling";
+      std::vector<std::string> inputs(InputFilenames.begin(),
+                                      InputFilenames.end());
+      if (context.AssembleBatch(inputs) != 0)
+        return 1;
+    }
     else {
       pStage = "Assembling";
       context.Assemble();
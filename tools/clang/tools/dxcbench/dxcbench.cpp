@@ -0,0 +1,461 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// dxcbench.cpp                                                              //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Provides the entry point for the dxc-bench compile throughput tool.       //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+//
+// Compiles each shader of a corpus list several times in-process through
+// IDxcCompiler3 and writes, per shader, the wall time, the per-phase times
+// from -ftime-trace, the number and size of allocations made through the
+// compiler's IMalloc, and the process peak working set, as JSON.
+// utils/hct/hctbench-compare.py compares two such reports.
+//
+//   dxc-bench -corpus tools/clang/tools/dxcbench/corpus.txt
+//             -root tools/clang/test [-n 5] [-filter text] [-o out.json]
+//
+// With -startup it instead times loading the library, the first IDxcUtils
+// call and creating the compiler. A library is only loaded cold once per
+// process, so that is a single sample; run it several times.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "dxc/Support/Global.h"
+#include "dxc/Support/Unicode.h"
+#include "dxc/Support/WinIncludes.h"
+#include "dxc/Support/WinFunctions.h"
+#include "dxc/Support/microcom.h"
+#include "dxc/dxcapi.h"
+#include "dxc/Support/dxcapi.use.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+// Phases recorded by -ftime-trace that are reported. Passes have totals of
+// their own in the trace, which -Qpass-report covers better.
+static const char *const kPhases[] = {
+    "Compile", "Parse", "CodeGen", "Backend", "Assemble container",
+    "Validation", "Hash", "PDB"};
+
+// Forwards to the COM allocator and counts what the compiler allocates.
+class CountingMalloc : public IMalloc {
+private:
+  DXC_MICROCOM_REF_FIELD(m_dwRef)
+  CComPtr<IMalloc> m_pMalloc;
+  std::atomic<uint64_t> m_Count;
+  std::atomic<uint64_t> m_Bytes;
+
+public:
+  DXC_MICROCOM_ADDREF_RELEASE_IMPL(m_dwRef)
+
+  CountingMalloc(IMalloc *pMalloc)
+      : m_pMalloc(pMalloc), m_Count(0), m_Bytes(0) {}
+
+  STDMETHODIMP QueryInterface(REFIID iid, void **ppvObject) override {
+    return DoBasicQueryInterface<IMalloc>(this, iid, ppvObject);
+  }
+
+  void *STDMETHODCALLTYPE Alloc(SIZE_T cb) override {
+    ++m_Count;
+    m_Bytes += cb;
+    return m_pMalloc->Alloc(cb);
+  }
+  void *STDMETHODCALLTYPE Realloc(void *pv, SIZE_T cb) override {
+    ++m_Count;
+    m_Bytes += cb;
+    return m_pMalloc->Realloc(pv, cb);
+  }
+  void STDMETHODCALLTYPE Free(void *pv) override { m_pMalloc->Free(pv); }
+  virtual SIZE_T STDMETHODCALLTYPE GetSize(void *pv) {
+    return (SIZE_T)-1; // don't know
+  }
+  virtual int STDMETHODCALLTYPE DidAlloc(void *pv) {
+    return -1; // don't know
+  }
+  virtual void STDMETHODCALLTYPE HeapMinimize(void) {}
+
+  void Reset() {
+    m_Count = 0;
+    m_Bytes = 0;
+  }
+  uint64_t GetCount() const { return m_Count; }
+  uint64_t GetBytes() const { return m_Bytes; }
+};
+
+static uint64_t GetPeakRSSKB() {
+#ifdef _WIN32
+  PROCESS_MEMORY_COUNTERS Counters;
+  if (!GetProcessMemoryInfo(GetCurrentProcess(), &Counters, sizeof(Counters)))
+    return 0;
+  return Counters.PeakWorkingSetSize / 1024;
+#else
+  struct rusage Usage;
+  if (getrusage(RUSAGE_SELF, &Usage) != 0)
+    return 0;
+#ifdef __APPLE__
+  return Usage.ru_maxrss / 1024; // Bytes on macOS.
+#else
+  return Usage.ru_maxrss;
+#endif
+#endif
+}
+
+struct CorpusEntry {
+  std::string File;
+  std::string Profile;
+  std::string Entry;
+  std::vector<std::string> Args;
+
+  std::string GetName() const {
+    std::string Name = File + " " + Profile;
+    for (const std::string &Arg : Args)
+      Name += " " + Arg;
+    return Name;
+  }
+};
+
+struct Sample {
+  double WallMs = 0;
+  std::map<std::string, double> PhaseMs;
+  uint64_t Allocations = 0;
+  uint64_t AllocatedBytes = 0;
+};
+
+static bool ReadCorpus(const std::string &Path,
+                       std::vector<CorpusEntry> &Entries) {
+  std::ifstream In(Path);
+  if (!In)
+    return false;
+  std::string Line;
+  while (std::getline(In, Line)) {
+    std::istringstream Words(Line);
+    CorpusEntry E;
+    if (!(Words >> E.File) || E.File[0] == '#')
+      continue;
+    if (!(Words >> E.Profile >> E.Entry)) {
+      fprintf(stderr, "dxc-bench: malformed corpus line: %s\n", Line.c_str());
+      return false;
+    }
+    std::string Arg;
+    while (Words >> Arg)
+      E.Args.push_back(Arg);
+    Entries.push_back(E);
+  }
+  return true;
+}
+
+// Reads the "Total <phase>" durations out of the time trace.
+static void ReadPhaseTimes(const std::string &Trace,
+                           std::map<std::string, double> &PhaseMs) {
+  static const char kName[] = "\"name\":\"Total ";
+  static const char kDur[] = "\"dur\":";
+  std::istringstream Lines(Trace);
+  std::string Line;
+  while (std::getline(Lines, Line)) {
+    size_t NamePos = Line.find(kName);
+    size_t DurPos = Line.find(kDur);
+    if (NamePos == std::string::npos || DurPos == std::string::npos)
+      continue;
+    NamePos += sizeof(kName) - 1;
+    std::string Name = Line.substr(NamePos, Line.find('"', NamePos) - NamePos);
+    if (std::find(std::begin(kPhases), std::end(kPhases), Name) ==
+        std::end(kPhases))
+      continue;
+    double DurUs = std::strtod(Line.c_str() + DurPos + sizeof(kDur) - 1,
+                               nullptr);
+    PhaseMs[Name] = DurUs / 1000.0;
+  }
+}
+
+static HRESULT CompileOnce(IDxcCompiler3 *pCompiler, IDxcUtils *pUtils,
+                           CountingMalloc *pMalloc, IDxcBlobEncoding *pSource,
+                           const std::wstring &Path,
+                           const std::vector<std::wstring> &Args,
+                           Sample &S, std::string &Errors) {
+  CComPtr<IDxcIncludeHandler> pIncludeHandler;
+  IFR(pUtils->CreateDefaultIncludeHandler(&pIncludeHandler));
+  std::vector<LPCWSTR> ArgPtrs;
+  ArgPtrs.push_back(Path.c_str());
+  for (const std::wstring &Arg : Args)
+    ArgPtrs.push_back(Arg.c_str());
+  DxcBuffer Buffer;
+  Buffer.Ptr = pSource->GetBufferPointer();
+  Buffer.Size = pSource->GetBufferSize();
+  Buffer.Encoding = DXC_CP_ACP;
+
+  pMalloc->Reset();
+  CComPtr<IDxcResult> pResult;
+  auto Start = std::chrono::steady_clock::now();
+  IFR(pCompiler->Compile(&Buffer, ArgPtrs.data(), (UINT32)ArgPtrs.size(),
+                         pIncludeHandler, IID_PPV_ARGS(&pResult)));
+  auto End = std::chrono::steady_clock::now();
+  S.WallMs = std::chrono::duration<double, std::milli>(End - Start).count();
+  S.Allocations = pMalloc->GetCount();
+  S.AllocatedBytes = pMalloc->GetBytes();
+
+  HRESULT Status;
+  IFR(pResult->GetStatus(&Status));
+  if (FAILED(Status)) {
+    CComPtr<IDxcBlobUtf8> pErrors;
+    if (SUCCEEDED(pResult->GetOutput(DXC_OUT_ERRORS, IID_PPV_ARGS(&pErrors),
+                                     nullptr)) &&
+        pErrors)
+      Errors.assign(pErrors->GetStringPointer(), pErrors->GetStringLength());
+    return Status;
+  }
+  CComPtr<IDxcBlobUtf8> pTrace;
+  if (SUCCEEDED(pResult->GetOutput(DXC_OUT_TIME_TRACE, IID_PPV_ARGS(&pTrace),
+                                   nullptr)) &&
+      pTrace)
+    ReadPhaseTimes(std::string(pTrace->GetStringPointer(),
+                               pTrace->GetStringLength()),
+                   S.PhaseMs);
+  return S_OK;
+}
+
+static double Median(std::vector<double> Values) {
+  if (Values.empty())
+    return 0;
+  std::sort(Values.begin(), Values.end());
+  size_t Mid = Values.size() / 2;
+  return Values.size() % 2 ? Values[Mid] : (Values[Mid - 1] + Values[Mid]) / 2;
+}
+
+static std::string JSONString(const std::string &Str) {
+  std::string Out = "\"";
+  for (char C : Str) {
+    if (C == '"' || C == '\\')
+      Out += '\\';
+    if (C == '\n')
+      Out += "\\n";
+    else if (C == '\r' || C == '\t')
+      Out += ' ';
+    else
+      Out += C;
+  }
+  return Out + "\"";
+}
+
+static void WriteEntry(std::ostream &OS, const CorpusEntry &E,
+                       const std::vector<Sample> &Samples,
+                       const std::string &Errors, uint64_t PeakRSSKB) {
+  OS << "    {\"name\":" << JSONString(E.GetName())
+     << ", \"file\":" << JSONString(E.File)
+     << ", \"profile\":" << JSONString(E.Profile);
+  if (Samples.empty()) {
+    OS << ", \"status\":\"failed\", \"errors\":" << JSONString(Errors) << "}";
+    return;
+  }
+  std::vector<double> Wall;
+  std::map<std::string, std::vector<double>> Phases;
+  for (const Sample &S : Samples) {
+    Wall.push_back(S.WallMs);
+    for (const auto &Phase : S.PhaseMs)
+      Phases[Phase.first].push_back(Phase.second);
+  }
+  OS << ", \"status\":\"ok\""
+     << ", \"wall_ms\":{\"median\":" << Median(Wall)
+     << ", \"min\":" << *std::min_element(Wall.begin(), Wall.end()) << "}"
+     << ", \"phases_ms\":{";
+  bool First = true;
+  for (const char *Phase : kPhases) {
+    auto It = Phases.find(Phase);
+    if (It == Phases.end())
+      continue;
+    OS << (First ? "" : ", ") << JSONString(Phase) << ":" << Median(It->second);
+    First = false;
+  }
+  // Allocations do not vary between runs, so the last one stands for all.
+  OS << "}, \"allocations\":" << Samples.back().Allocations
+     << ", \"allocated_bytes\":" << Samples.back().AllocatedBytes
+     << ", \"peak_rss_kb\":" << PeakRSSKB << "}";
+}
+
+static void PrintUsage() {
+  fprintf(stderr,
+          "usage: dxc-bench -corpus <file> [-root <dir>] [-n <iterations>]\n"
+          "                 [-filter <text>] [-o <file>]\n"
+          "       dxc-bench -startup\n");
+}
+
+static double MsSince(std::chrono::steady_clock::time_point Start) {
+  return std::chrono::duration<double, std::milli>(
+             std::chrono::steady_clock::now() - Start)
+      .count();
+}
+
+static void RunStartup() {
+  auto Start = std::chrono::steady_clock::now();
+  dxc::DxcDllSupport DxcSupport;
+  IFT(DxcSupport.Initialize());
+  double LoadMs = MsSince(Start);
+
+  Start = std::chrono::steady_clock::now();
+  CComPtr<IDxcUtils> pUtils;
+  CComPtr<IDxcBlobEncoding> pBlob;
+  IFT(DxcSupport.CreateInstance(CLSID_DxcUtils, &pUtils));
+  static const char kSource[] = "float4 main() : SV_Target { return 0; }";
+  IFT(pUtils->CreateBlob(kSource, sizeof(kSource) - 1, DXC_CP_UTF8, &pBlob));
+  double UtilsMs = MsSince(Start);
+
+  Start = std::chrono::steady_clock::now();
+  CComPtr<IDxcCompiler3> pCompiler;
+  IFT(DxcSupport.CreateInstance(CLSID_DxcCompiler, &pCompiler));
+  double CompilerMs = MsSince(Start);
+
+  printf("{\"version\":1, \"load_ms\":%g, \"utils_first_call_ms\":%g, "
+         "\"compiler_create_ms\":%g, \"peak_rss_kb\":%llu}\n",
+         LoadMs, UtilsMs, CompilerMs, (unsigned long long)GetPeakRSSKB());
+}
+
+int main(int argc, const char **argv) {
+  if (FAILED(DxcInitThreadMalloc())) return 1;
+  DxcSetThreadMallocToDefault();
+
+  if (argc == 2 && std::string(argv[1]) == "-startup") {
+    try {
+      RunStartup();
+      return 0;
+    } catch (const ::hlsl::Exception &hlslException) {
+      fprintf(stderr, "dxc-bench: failed - error code 0x%08x.\n",
+              (unsigned)hlslException.hr);
+    }
+    return 1;
+  }
+
+  std::string CorpusPath, Root = ".", Filter, OutPath;
+  unsigned Iterations = 5;
+  for (int i = 1; i < argc; ++i) {
+    std::string Arg = argv[i];
+    if (i + 1 == argc) {
+      PrintUsage();
+      return 1;
+    }
+    if (Arg == "-corpus")
+      CorpusPath = argv[++i];
+    else if (Arg == "-root")
+      Root = argv[++i];
+    else if (Arg == "-n")
+      Iterations = std::max(1, atoi(argv[++i]));
+    else if (Arg == "-filter")
+      Filter = argv[++i];
+    else if (Arg == "-o")
+      OutPath = argv[++i];
+    else {
+      PrintUsage();
+      return 1;
+    }
+  }
+  std::vector<CorpusEntry> Entries;
+  if (CorpusPath.empty()) {
+    PrintUsage();
+    return 1;
+  }
+  if (!ReadCorpus(CorpusPath, Entries)) {
+    fprintf(stderr, "dxc-bench: cannot read corpus %s\n", CorpusPath.c_str());
+    return 1;
+  }
+
+  try {
+    dxc::DxcDllSupport DxcSupport;
+    IFT(DxcSupport.Initialize());
+    CComPtr<IMalloc> pDefaultMalloc;
+    IFT(CoGetMalloc(1, &pDefaultMalloc));
+    CComPtr<CountingMalloc> pMalloc = new CountingMalloc(pDefaultMalloc);
+    CComPtr<IDxcCompiler3> pCompiler;
+    CComPtr<IDxcUtils> pUtils;
+    IFT(DxcSupport.CreateInstance2(pMalloc, CLSID_DxcCompiler, &pCompiler));
+    IFT(DxcSupport.CreateInstance(CLSID_DxcUtils, &pUtils));
+
+    std::ostringstream OS;
+    OS << "{\n  \"version\":1, \"iterations\":" << Iterations
+       << ",\n  \"entries\":[\n";
+    bool First = true;
+    unsigned NumFailed = 0;
+    double TotalMs = 0;
+    for (const CorpusEntry &E : Entries) {
+      if (!Filter.empty() && E.GetName().find(Filter) == std::string::npos)
+        continue;
+      std::wstring Path = Unicode::UTF8ToWideStringOrThrow(
+          (Root + "/" + E.File).c_str());
+      std::vector<std::wstring> Args;
+      if (E.Entry != "-") {
+        Args.push_back(L"-E");
+        Args.push_back(Unicode::UTF8ToWideStringOrThrow(E.Entry.c_str()));
+      }
+      Args.push_back(L"-T");
+      Args.push_back(Unicode::UTF8ToWideStringOrThrow(E.Profile.c_str()));
+      Args.push_back(L"-ftime-trace");
+      for (const std::string &Arg : E.Args)
+        Args.push_back(Unicode::UTF8ToWideStringOrThrow(Arg.c_str()));
+
+      std::vector<Sample> Samples;
+      std::string Errors;
+      CComPtr<IDxcBlobEncoding> pSource;
+      if (FAILED(pUtils->LoadFile(Path.c_str(), nullptr, &pSource))) {
+        Errors = "cannot read " + E.File;
+      } else {
+        // The first compile warms up caches and is not counted.
+        for (unsigned i = 0; i <= Iterations; ++i) {
+          Sample S;
+          if (FAILED(CompileOnce(pCompiler, pUtils, pMalloc, pSource, Path,
+                                 Args, S, Errors))) {
+            Samples.clear();
+            break;
+          }
+          if (i > 0)
+            Samples.push_back(S);
+        }
+      }
+      if (Samples.empty()) {
+        ++NumFailed;
+        fprintf(stderr, "dxc-bench: %s failed\n%s", E.GetName().c_str(),
+                Errors.c_str());
+      } else {
+        for (const Sample &S : Samples)
+          TotalMs += S.WallMs / Samples.size();
+        fprintf(stderr, "dxc-bench: %s done\n", E.GetName().c_str());
+      }
+      OS << (First ? "" : ",\n");
+      First = false;
+      WriteEntry(OS, E, Samples, Errors, GetPeakRSSKB());
+    }
+    OS << "\n  ],\n  \"total_wall_ms\":" << TotalMs
+       << ", \"peak_rss_kb\":" << GetPeakRSSKB()
+       << ", \"failed\":" << NumFailed << "\n}\n";
+
+    if (OutPath.empty()) {
+      fputs(OS.str().c_str(), stdout);
+    } else {
+      std::ofstream Out(OutPath);
+      Out << OS.str();
+      if (!Out) {
+        fprintf(stderr, "dxc-bench: cannot write %s\n", OutPath.c_str());
+        return 1;
+      }
+    }
+    return NumFailed ? 1 : 0;
+  } catch (const ::hlsl::Exception &hlslException) {
+    fprintf(stderr, "dxc-bench: failed - error code 0x%08x.\n",
+            (unsigned)hlslException.hr);
+  } catch (std::bad_alloc &) {
+    fprintf(stderr, "dxc-bench: out of memory.\n");
+  }
+  return 1;
+}
@@ -0,0 +1,291 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// dxcfuzzer.cpp                                                             //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Provides the entry point for the dxc-fuzzer compile-time fuzzing tool.    //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+//
+// Runs libFuzzer over IDxcCompiler3::Compile, looking for inputs that are
+// slow to compile rather than for crashes. The first bytes of an input pick
+// the target profile and a combination of compiler flags, and the rest is
+// the HLSL source, so mutations explore flags and source together.
+//
+// Every compile is timed. Once enough compiles have run, an input whose
+// compile takes more than -slow_factor times the median of recent compiles,
+// and at least -slow_min_ms, is written to -slow_dir as slow-<sha1>, with
+// the arguments and time next to it in slow-<sha1>.txt.
+//
+//   dxc-fuzzer -max_len=4096 [-slow_dir=slow] [-slow_factor=10]
+//              [-slow_min_ms=100] [libFuzzer flags] corpus_dir
+//
+// A recorded input is reduced with
+//
+//   dxc-fuzzer -minimize_slow=slow/slow-<sha1> [-slow_min_ms=100]
+//
+// which removes lines, then smaller and smaller runs of bytes, from the
+// source as long as the compile stays at least half as slow as the original
+// and over -slow_min_ms, and writes the result to slow-<sha1>.min.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "dxc/Support/Global.h"
+#include "dxc/Support/WinIncludes.h"
+#include "dxc/Support/WinFunctions.h"
+#include "dxc/dxcapi.h"
+#include "dxc/Support/dxcapi.use.h"
+
+#include "llvm/Support/FileSystem.h"
+
+#include "FuzzerInterface.h"
+#include "FuzzerInternal.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+// Byte 0 of an input selects the profile; bytes 1 and 2 are a mask over
+// kFlagSets; the source starts at kHeaderSize.
+const unsigned kHeaderSize = 3;
+
+const wchar_t *const kProfiles[] = {L"ps_6_0", L"vs_6_0", L"cs_6_0",
+                                    L"ps_6_2", L"cs_6_5", L"ps_6_6",
+                                    L"lib_6_3"};
+
+// Bits 0 and 1 of the mask pick the optimization level, and each further
+// bit adds one entry of this table.
+const wchar_t *const kOptLevels[] = {L"-O0", L"-O1", L"-O2", L"-O3"};
+const wchar_t *const kFlagSets[][2] = {
+    {L"-Od", nullptr},
+    {L"-Zi", L"-Qembed_debug"},
+    {L"-enable-16bit-types", nullptr},
+    {L"-HV", L"2018"},
+    {L"-Zpr", nullptr},
+    {L"-Gis", nullptr},
+    {L"-all-resources-bound", nullptr},
+    {L"-Gfa", nullptr},
+    {L"-Gfp", nullptr},
+    {L"-denorm", L"ftz"},
+    {L"-Vd", nullptr},
+    {L"-enable-lifetime-markers", nullptr},
+    {L"-Gec", nullptr},
+    {L"-Zpc", nullptr},
+};
+
+// Recent compile times, and the median the slow threshold is taken from.
+const size_t kWindowSize = 1024;
+const size_t kWarmupCompiles = 128;
+const size_t kMedianInterval = 64;
+
+struct SlowSettings {
+  std::string Dir = "slow";
+  double Factor = 10.0;
+  double MinMs = 100.0;
+};
+
+SlowSettings g_Slow;
+dxc::DxcDllSupport g_DxcSupport;
+CComPtr<IDxcCompiler3> g_pCompiler;
+std::vector<double> g_Window;
+size_t g_NumCompiles = 0;
+double g_MedianMs = 0;
+
+void GetArgs(const uint8_t *Data, size_t Size, std::vector<LPCWSTR> &Args) {
+  uint8_t Profile = Size > 0 ? Data[0] : 0;
+  unsigned Mask = (Size > 1 ? Data[1] : 0) | (Size > 2 ? Data[2] << 8 : 0);
+  const wchar_t *ProfileName = kProfiles[Profile % _countof(kProfiles)];
+  Args.push_back(L"fuzz.hlsl");
+  Args.push_back(L"-T");
+  Args.push_back(ProfileName);
+  if (wcsncmp(ProfileName, L"lib_", 4) != 0) {
+    Args.push_back(L"-E");
+    Args.push_back(L"main");
+  }
+  Args.push_back(kOptLevels[Mask & 3]);
+  for (unsigned i = 0; i < _countof(kFlagSets); ++i) {
+    if ((Mask & (4u << i)) == 0)
+      continue;
+    Args.push_back(kFlagSets[i][0]);
+    if (kFlagSets[i][1])
+      Args.push_back(kFlagSets[i][1]);
+  }
+}
+
+// Compiles the input and returns the wall time in milliseconds. Failed
+// compiles are timed like any other, since slow diagnostics are bugs too.
+double CompileInput(const uint8_t *Data, size_t Size) {
+  std::vector<LPCWSTR> Args;
+  GetArgs(Data, Size, Args);
+  DxcBuffer Buffer;
+  Buffer.Ptr = Size > kHeaderSize ? Data + kHeaderSize : nullptr;
+  Buffer.Size = Size > kHeaderSize ? Size - kHeaderSize : 0;
+  Buffer.Encoding = DXC_CP_UTF8;
+
+  CComPtr<IDxcResult> pResult;
+  auto Start = std::chrono::steady_clock::now();
+  g_pCompiler->Compile(&Buffer, Args.data(), (UINT32)Args.size(), nullptr,
+                       IID_PPV_ARGS(&pResult));
+  auto End = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::milli>(End - Start).count();
+}
+
+std::string GetArgsString(const uint8_t *Data, size_t Size) {
+  std::vector<LPCWSTR> Args;
+  GetArgs(Data, Size, Args);
+  std::string Result;
+  for (LPCWSTR Arg : Args) {
+    if (!Result.empty())
+      Result += ' ';
+    for (; *Arg; ++Arg)
+      Result += (char)*Arg;
+  }
+  return Result;
+}
+
+void RecordSlowInput(const uint8_t *Data, size_t Size, double Ms) {
+  static bool DirCreated = false;
+  if (!DirCreated) {
+    llvm::sys::fs::create_directories(g_Slow.Dir);
+    DirCreated = true;
+  }
+  fuzzer::Unit U(Data, Data + Size);
+  std::string Path = fuzzer::DirPlusFile(g_Slow.Dir, "slow-" + fuzzer::Hash(U));
+  fuzzer::WriteToFile(U, Path);
+  std::ofstream Info(Path + ".txt");
+  Info << "args: " << GetArgsString(Data, Size) << "\n"
+       << "ms: " << Ms << "\n"
+       << "median_ms: " << g_MedianMs << "\n";
+  fuzzer::Printf("dxc-fuzzer: %.1f ms (median %.1f ms) written to %s\n", Ms,
+                 g_MedianMs, Path.c_str());
+}
+
+void InitCompiler() {
+  if (g_pCompiler)
+    return;
+  if (FAILED(DxcInitThreadMalloc()))
+    exit(1);
+  DxcSetThreadMallocToDefault();
+  if (FAILED(g_DxcSupport.Initialize()) ||
+      FAILED(g_DxcSupport.CreateInstance(CLSID_DxcCompiler, &g_pCompiler))) {
+    fuzzer::Printf("dxc-fuzzer: cannot load dxcompiler\n");
+    exit(1);
+  }
+}
+
+bool ConsumeFlag(const char *Arg, const char *Name, std::string &Value) {
+  size_t Len = strlen(Name);
+  if (Arg[0] != '-' || strncmp(Arg + 1, Name, Len) != 0 || Arg[Len + 1] != '=')
+    return false;
+  Value = Arg + Len + 2;
+  return true;
+}
+
+// Times a compile of U twice and keeps the faster, to ride out noise.
+double TimeInput(const fuzzer::Unit &U) {
+  double First = CompileInput(U.data(), U.size());
+  return std::min(First, CompileInput(U.data(), U.size()));
+}
+
+int MinimizeSlowInput(const std::string &Path) {
+  fuzzer::Unit U = fuzzer::FileToVector(Path);
+  if (U.size() <= kHeaderSize) {
+    fuzzer::Printf("dxc-fuzzer: %s has no source to reduce\n", Path.c_str());
+    return 1;
+  }
+  double OriginalMs = TimeInput(U);
+  double TargetMs = std::max(OriginalMs / 2, g_Slow.MinMs);
+  fuzzer::Printf("dxc-fuzzer: %s compiles in %.1f ms, keeping over %.1f ms\n",
+                 Path.c_str(), OriginalMs, TargetMs);
+  if (OriginalMs < TargetMs) {
+    fuzzer::Printf("dxc-fuzzer: input is not slow\n");
+    return 1;
+  }
+
+  // Try removing each line, then each run of Chunk bytes for shrinking
+  // Chunk, keeping any removal after which the compile is still slow.
+  auto TryRemove = [&](size_t Begin, size_t End) {
+    fuzzer::Unit Candidate(U.begin(), U.begin() + Begin);
+    Candidate.insert(Candidate.end(), U.begin() + End, U.end());
+    if (TimeInput(Candidate) < TargetMs)
+      return false;
+    U.swap(Candidate);
+    return true;
+  };
+  for (size_t Begin = kHeaderSize; Begin < U.size();) {
+    auto NewLine = std::find(U.begin() + Begin, U.end(), '\n');
+    size_t End = NewLine == U.end() ? U.size() : NewLine - U.begin() + 1;
+    if (!TryRemove(Begin, End))
+      Begin = End;
+  }
+  for (size_t Chunk = 64; Chunk > 0; Chunk /= 2) {
+    for (size_t Begin = kHeaderSize; Begin < U.size();) {
+      size_t End = std::min(U.size(), Begin + Chunk);
+      if (!TryRemove(Begin, End))
+        Begin = End;
+    }
+  }
+
+  std::string OutPath = Path + ".min";
+  fuzzer::WriteToFile(U, OutPath);
+  fuzzer::Printf("dxc-fuzzer: reduced to %zu bytes in %s\nargs: %s\n",
+                 U.size() - kHeaderSize, OutPath.c_str(),
+                 GetArgsString(U.data(), U.size()).c_str());
+  return 0;
+}
+
+} // namespace
+
+extern "C" void LLVMFuzzerTestOneInput(const uint8_t *Data, size_t Size) {
+  InitCompiler();
+  double Ms = CompileInput(Data, Size);
+  ++g_NumCompiles;
+  if (g_Window.size() < kWindowSize)
+    g_Window.push_back(Ms);
+  else
+    g_Window[g_NumCompiles % kWindowSize] = Ms;
+
+  if (g_NumCompiles < kWarmupCompiles)
+    return;
+  if (g_MedianMs == 0 || g_NumCompiles % kMedianInterval == 0) {
+    std::vector<double> Sorted(g_Window);
+    std::nth_element(Sorted.begin(), Sorted.begin() + Sorted.size() / 2,
+                     Sorted.end());
+    g_MedianMs = Sorted[Sorted.size() / 2];
+  }
+  if (Ms >= g_Slow.MinMs && Ms > g_MedianMs * g_Slow.Factor)
+    RecordSlowInput(Data, Size, Ms);
+}
+
+int main(int argc, char **argv) {
+  // Take out the flags of this tool; libFuzzer rejects flags it does not
+  // know. Workers started by -jobs therefore use the default settings.
+  std::vector<char *> FuzzerArgs;
+  std::string MinimizePath, Value;
+  for (int i = 0; i < argc; ++i) {
+    if (i > 0 && ConsumeFlag(argv[i], "slow_dir", Value))
+      g_Slow.Dir = Value;
+    else if (i > 0 && ConsumeFlag(argv[i], "slow_factor", Value))
+      g_Slow.Factor = atof(Value.c_str());
+    else if (i > 0 && ConsumeFlag(argv[i], "slow_min_ms", Value))
+      g_Slow.MinMs = atof(Value.c_str());
+    else if (i > 0 && ConsumeFlag(argv[i], "minimize_slow", Value))
+      MinimizePath = Value;
+    else
+      FuzzerArgs.push_back(argv[i]);
+  }
+  FuzzerArgs.push_back(nullptr);
+
+  if (!MinimizePath.empty()) {
+    InitCompiler();
+    return MinimizeSlowInput(MinimizePath);
+  }
+  return fuzzer::FuzzerDriver((int)FuzzerArgs.size() - 1, FuzzerArgs.data(),
+                              LLVMFuzzerTestOneInput);
+}
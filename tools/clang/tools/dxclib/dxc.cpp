@@ -61,11 +61,17 @@
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/Path.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/StringSaver.h"
 #ifdef _WIN32
 #include <dia2.h>
 #include <comdef.h>
 #endif
 #include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
 #include <unordered_map>
 
 #ifdef _WIN32
@@ -124,6 +130,8 @@ class DxcContext {
 private:
   DxcOpts &m_Opts;
   DxcDllSupport &m_dxcSupport;
+  IDxcIncludeHandler *m_pIncludeHandler;
+  IDxcCompiler *m_pCompiler;
 
   int ActOnBlob(IDxcBlob *pBlob);
   int ActOnBlob(IDxcBlob *pBlob, IDxcBlob *pDebugBlob, LPCWSTR pDebugBlobName);
@@ -145,12 +153,20 @@ private:
 
   template <typename TInterface>
   HRESULT CreateInstance(REFCLSID clsid, _Outptr_ TInterface** pResult) {
+  if (m_pCompiler && IsEqualCLSID(clsid, CLSID_DxcCompiler))
+    return m_pCompiler->QueryInterface(__uuidof(TInterface), (void **)pResult);
   return m_dxcSupport.CreateInstance(clsid, pResult);
   }
 
 public:
-  DxcContext(DxcOpts &Opts, DxcDllSupport &dxcSupport)
-      : m_Opts(Opts), m_dxcSupport(dxcSupport) {
+  // pIncludeHandler, when set, is used for every compile instead of a new
+  // default handler, and pCompiler instead of a new compiler; -batch and
+  // -serve pass a shared include cache and compiler.
+  DxcContext(DxcOpts &Opts, DxcDllSupport &dxcSupport,
+             IDxcIncludeHandler *pIncludeHandler = nullptr,
+             IDxcCompiler *pCompiler = nullptr)
+      : m_Opts(Opts), m_dxcSupport(dxcSupport),
+        m_pIncludeHandler(pIncludeHandler), m_pCompiler(pCompiler) {
   }
 
   int  Compile();
@@ -501,15 +517,19 @@ HRESULT DxcContext::ReadFileIntoPartContent(hlsl::DxilFourCC fourCC, LPCWSTR fil
   // If root signature, check if it's a dxil container that contains rootsignature part, then construct a blob of root signature part
   if (fourCC == hlsl::DxilFourCC::DFCC_RootSignature) {
     CComPtr<IDxcBlob> pResult;
-    CComHeapPtr<BYTE> pData;
-    DWORD dataSize;
-    hlsl::ReadBinaryFile(fileName, (void**)&pData, &dataSize);
-    DXASSERT(pData != nullptr, "otherwise ReadBinaryFile should throw an exception");
-    hlsl::DxilContainerHeader *pHeader = hlsl::IsDxilContainerLike(pData.m_pData, dataSize);
+    CComPtr<IDxcBlobEncoding> pFile;
+    ReadFileIntoBlob(m_dxcSupport, fileName, &pFile);
+    void *pData = pFile->GetBufferPointer();
+    uint32_t dataSize = pFile->GetBufferSize();
+    hlsl::DxilContainerHeader *pHeader = hlsl::IsDxilContainerLike(pData, dataSize);
     IFRBOOL(hlsl::IsValidDxilContainer(pHeader, dataSize), E_INVALIDARG);
     hlsl::DxilPartHeader *pPartHeader = hlsl::GetDxilPartByType(pHeader, hlsl::DxilFourCC::DFCC_RootSignature);
     IFRBOOL(pPartHeader != nullptr, E_INVALIDARG);
-    hlsl::DxcCreateBlobOnHeapCopy(hlsl::GetDxilPartData(pPartHeader), pPartHeader->PartSize, &pResult);
+    // Reference the part in place rather than copying it.
+    UINT32 partOffset = (UINT32)((const char *)hlsl::GetDxilPartData(pPartHeader) -
+                                 (const char *)pData);
+    IFR(hlsl::DxcCreateBlobFromBlob(pFile, partOffset, pPartHeader->PartSize,
+                                    &pResult));
     *ppResult = pResult.Detach();
   }
   return S_OK;
@@ -780,8 +800,9 @@ int DxcContext::Compile() {
       Recompile(pSource, pLibrary, pCompiler, args, outputPDBPath, pDebugBlob,
                 &pCompileResult);
     } else {
-      CComPtr<IDxcIncludeHandler> pIncludeHandler;
-      IFT(pLibrary->CreateIncludeHandler(&pIncludeHandler));
+      CComPtr<IDxcIncludeHandler> pIncludeHandler = m_pIncludeHandler;
+      if (!pIncludeHandler)
+        IFT(pLibrary->CreateIncludeHandler(&pIncludeHandler));
 
       // Upgrade profile to 6.0 version from minimum recognized shader model
       llvm::StringRef TargetProfile = m_Opts.TargetProfile;
@@ -837,6 +858,22 @@ int DxcContext::Compile() {
     WriteOperationErrorsToConsole(pCompileResult, m_Opts.OutputWarnings);
   }
 
+  // Timings are written out even when the compile failed.
+  if (!m_Opts.TimeTraceFile.empty() || !m_Opts.PassReportFile.empty() ||
+      !m_Opts.MemoryReportFile.empty()) {
+    CComPtr<IDxcResult> pResult;
+    if (SUCCEEDED(pCompileResult->QueryInterface(&pResult))) {
+      if (!m_Opts.TimeTraceFile.empty())
+        WriteDxcOutputToFile(DXC_OUT_TIME_TRACE, pResult, m_Opts.DefaultTextCodePage);
+      if (!m_Opts.PassReportFile.empty())
+        WriteDxcOutputToFile(DXC_OUT_PASS_REPORT, pResult, m_Opts.DefaultTextCodePage);
+      if (!m_Opts.MemoryReportFile.empty())
+        WriteDxcOutputToFile(DXC_OUT_MEMORY_REPORT, pResult, m_Opts.DefaultTextCodePage);
+      if (!m_Opts.PerfReportFile.empty())
+        WriteDxcOutputToFile(DXC_OUT_PERF_REPORT, pResult, m_Opts.DefaultTextCodePage);
+    }
+  }
+
   HRESULT status;
   IFT(pCompileResult->GetStatus(&status));
   if (SUCCEEDED(status) || m_Opts.AstDump || m_Opts.OptDump ||
@@ -852,6 +889,7 @@ int DxcContext::Compile() {
         WriteDxcOutputToFile(DXC_OUT_ROOT_SIGNATURE, pResult, m_Opts.DefaultTextCodePage);
         WriteDxcOutputToFile(DXC_OUT_SHADER_HASH, pResult, m_Opts.DefaultTextCodePage);
         WriteDxcOutputToFile(DXC_OUT_REFLECTION, pResult, m_Opts.DefaultTextCodePage);
+        WriteDxcOutputToFile(DXC_OUT_SPIRV, pResult, m_Opts.DefaultTextCodePage);
         WriteDxcExtraOuputs(pResult);
       }
     }
@@ -935,9 +973,10 @@ void DxcContext::Preprocess() {
     args.push_back(a.data());
 
   CComPtr<IDxcLibrary> pLibrary;
-  CComPtr<IDxcIncludeHandler> pIncludeHandler;
+  CComPtr<IDxcIncludeHandler> pIncludeHandler = m_pIncludeHandler;
   IFT(CreateInstance(CLSID_DxcLibrary, &pLibrary));
-  IFT(pLibrary->CreateIncludeHandler(&pIncludeHandler));
+  if (!pIncludeHandler)
+    IFT(pLibrary->CreateIncludeHandler(&pIncludeHandler));
 
   ReadFileIntoBlob(m_dxcSupport, StringRefWide(m_Opts.InputFile), &pSource);
   IFT(CreateInstance(CLSID_DxcCompiler, &pCompiler));
@@ -1304,6 +1343,240 @@ static LONG CALLBACK ExceptionFilter(PEXCEPTION_POINTERS pExceptionInfo)
 #endif
 
 
+// Runs the action selected by Opts, other than help and version output.
+static int ActOnOptions(DxcContext &context, const DxcOpts &Opts,
+                        const char **ppStage) {
+  int retVal = 0;
+  // TODO: implement all other actions.
+  if (!Opts.Preprocess.empty()) {
+    *ppStage = "Preprocessing";
+    context.Preprocess();
+  }
+  else if (Opts.DumpBin) {
+    *ppStage = "Dumping existing binary";
+    retVal = context.DumpBinary();
+  }
+  else if (Opts.Link) {
+    *ppStage = "Linking";
+    retVal = context.Link();
+  }
+  else {
+    *ppStage = "Compilation";
+    retVal = context.Compile();
+  }
+  return retVal;
+}
+
+namespace {
+// One command line of a -batch file.
+struct BatchJob {
+  std::string CommandLine;
+  std::vector<std::string> Args;
+  std::string Error;
+  int Result = 0;
+};
+}
+
+// Splits one line of a -batch file or -serve request into arguments, the
+// same way the platform splits a command line.
+static void TokenizeJobLine(llvm::StringRef Line,
+                            std::vector<std::string> &Args) {
+  llvm::BumpPtrAllocator allocator;
+  llvm::BumpPtrStringSaver saver(allocator);
+  llvm::SmallVector<const char *, 16> tokens;
+#ifdef _WIN32
+  llvm::cl::TokenizeWindowsCommandLine(Line, saver, tokens);
+#else
+  llvm::cl::TokenizeGNUCommandLine(Line, saver, tokens);
+#endif
+  Args.assign(tokens.begin(), tokens.end());
+}
+
+// Creates an include cache to share between jobs, or returns null if the
+// loaded compiler does not provide one.
+static void CreateSharedIncludeCache(DxcDllSupport &dxcSupport,
+                                     IDxcIncludeHandler **ppResult) {
+  *ppResult = nullptr;
+  CComPtr<IDxcUtils2> pUtils;
+  CComPtr<IDxcIncludeCache> pCache;
+  if (SUCCEEDED(dxcSupport.CreateInstance(CLSID_DxcUtils, &pUtils)) &&
+      SUCCEEDED(pUtils->CreateIncludeCache(nullptr, &pCache))) {
+    *ppResult = pCache.Detach();
+  }
+}
+
+// Creates a compiler to share between jobs that reuses its LLVM contexts, or
+// returns null if the loaded compiler cannot pool them.
+static void CreateSharedCompiler(DxcDllSupport &dxcSupport,
+                                 IDxcCompiler **ppResult) {
+  *ppResult = nullptr;
+  CComPtr<IDxcCompiler> pCompiler;
+  CComPtr<IDxcContextPool> pPool;
+  if (SUCCEEDED(dxcSupport.CreateInstance(CLSID_DxcCompiler, &pCompiler)) &&
+      SUCCEEDED(pCompiler.QueryInterface(&pPool)) &&
+      SUCCEEDED(pPool->EnableContextPool(0))) {
+    *ppResult = pCompiler.Detach();
+  }
+}
+
+static void RunBatchJob(BatchJob &Job, DxcDllSupport &dxcSupport,
+                        IDxcIncludeHandler *pIncludeHandler,
+                        IDxcCompiler *pCompiler) {
+  const char *pStage = "Argument processing";
+  try {
+    std::vector<llvm::StringRef> argRefs(Job.Args.begin(), Job.Args.end());
+    MainArgs argStrings(argRefs);
+    DxcOpts opts;
+    std::string errorString;
+    llvm::raw_string_ostream errorStream(errorString);
+    Job.Result = ReadDxcOpts(getHlslOptTable(), DxcFlags, argStrings, opts,
+                             errorStream);
+    errorStream.flush();
+    Job.Error = errorString;
+    if (Job.Result != 0)
+      return;
+    if (!opts.BatchFile.empty() || opts.Serve) {
+      Job.Error = "-batch and -serve cannot be used inside a job.";
+      Job.Result = 1;
+      return;
+    }
+    if (opts.EntryPoint.empty() && !opts.RecompileFromBinary) {
+      opts.EntryPoint = "main";
+    }
+
+    DxcContext context(opts, dxcSupport, pIncludeHandler, pCompiler);
+    Job.Result = ActOnOptions(context, opts, &pStage);
+  } catch (const ::hlsl::Exception &hlslException) {
+    const char *msg = hlslException.what();
+    char printBuffer[64];
+    if (msg == nullptr || *msg == '\0') {
+      sprintf_s(printBuffer, _countof(printBuffer), "error code 0x%08x",
+                hlslException.hr);
+      msg = printBuffer;
+    }
+    Job.Error = std::string(pStage) + " failed : " + msg;
+    Job.Result = 1;
+  } catch (std::bad_alloc &) {
+    Job.Error = std::string(pStage) + " failed - out of memory.";
+    Job.Result = 1;
+  } catch (...) {
+    Job.Error = std::string(pStage) + " failed - unknown error.";
+    Job.Result = 1;
+  }
+}
+
+// Runs each non-empty line of Opts.BatchFile as its own dxc command line.
+// Lines starting with '#' are comments. All jobs share the compiler loaded by
+// dxcSupport and one include cache, so process startup, DLL initialization
+// and header loads are paid once.
+static int RunBatch(const DxcOpts &Opts, DxcDllSupport &dxcSupport) {
+  CComPtr<IDxcBlobEncoding> pBatchBlob;
+  ReadFileIntoBlob(dxcSupport, StringRefWide(Opts.BatchFile), &pBatchBlob);
+  llvm::StringRef batchText((const char *)pBatchBlob->GetBufferPointer(),
+                            pBatchBlob->GetBufferSize());
+  if (batchText.startswith("\xEF\xBB\xBF"))
+    batchText = batchText.drop_front(3);
+
+  std::vector<BatchJob> jobs;
+  llvm::SmallVector<llvm::StringRef, 64> lines;
+  batchText.split(lines, "\n", -1, false);
+  for (llvm::StringRef line : lines) {
+    line = line.trim();
+    if (line.empty() || line[0] == '#')
+      continue;
+    jobs.emplace_back();
+    jobs.back().CommandLine = line;
+    TokenizeJobLine(line, jobs.back().Args);
+  }
+
+  CComPtr<IDxcIncludeHandler> pIncludeCache;
+  CreateSharedIncludeCache(dxcSupport, &pIncludeCache);
+  CComPtr<IDxcCompiler> pCompiler;
+  CreateSharedCompiler(dxcSupport, &pCompiler);
+
+  unsigned threadCount = Opts.BatchJobs;
+  if (threadCount == 0)
+    threadCount = std::max(1u, std::thread::hardware_concurrency());
+  threadCount = std::min<size_t>(threadCount, std::max<size_t>(jobs.size(), 1));
+
+  std::atomic<size_t> nextJob(0);
+  std::atomic<size_t> failedCount(0);
+  std::mutex outputLock;
+  auto worker = [&]() {
+    DxcSetThreadMallocToDefault();
+    for (size_t i = nextJob++; i < jobs.size(); i = nextJob++) {
+      BatchJob &job = jobs[i];
+      RunBatchJob(job, dxcSupport, pIncludeCache, pCompiler);
+      if (job.Result != 0)
+        ++failedCount;
+      std::lock_guard<std::mutex> lock(outputLock);
+      if (!job.Error.empty())
+        fprintf(stderr, "%s\n", job.Error.c_str());
+      printf("[%u/%u] %s: %s\n", (unsigned)i + 1, (unsigned)jobs.size(),
+             job.Result == 0 ? "succeeded" : "failed", job.CommandLine.c_str());
+      fflush(stdout);
+    }
+    DxcClearThreadMalloc();
+  };
+
+  auto start = std::chrono::steady_clock::now();
+  std::vector<std::thread> threads;
+  for (unsigned i = 0; i < threadCount; ++i)
+    threads.emplace_back(worker);
+  for (std::thread &t : threads)
+    t.join();
+  double seconds = std::chrono::duration<double>(
+                       std::chrono::steady_clock::now() - start).count();
+
+  printf("%u jobs, %u failed, %u threads, %.2f s (%.1f jobs/s)\n",
+         (unsigned)jobs.size(), (unsigned)failedCount.load(), threadCount,
+         seconds, seconds > 0 ? jobs.size() / seconds : 0.0);
+  return failedCount == 0 ? 0 : 1;
+}
+
+// Reads dxc command lines from stdin, one per line, and runs each as soon as
+// it arrives, until "exit" or end of input. The compiler, validator and
+// include cache stay loaded between requests; the include cache reloads
+// headers whose size or write time changed, so edits are picked up.
+//
+// Requests run one at a time. Anything a request writes to stdout or stderr
+// is followed on stdout by a line "dxc-serve: <exit code>", after both
+// streams are flushed, so a client can read up to that line to collect the
+// request's output.
+static int RunServer(DxcDllSupport &dxcSupport) {
+  CComPtr<IDxcIncludeHandler> pIncludeCache;
+  CreateSharedIncludeCache(dxcSupport, &pIncludeCache);
+  CComPtr<IDxcCompiler> pCompiler;
+  CreateSharedCompiler(dxcSupport, &pCompiler);
+
+  std::string line;
+  char buffer[4096];
+  while (fgets(buffer, _countof(buffer), stdin)) {
+    line += buffer;
+    if (line.back() != '\n' && !feof(stdin))
+      continue;
+    llvm::StringRef request = llvm::StringRef(line).trim();
+    if (request == "exit")
+      break;
+    if (request.empty() || request[0] == '#') {
+      line.clear();
+      continue;
+    }
+
+    BatchJob job;
+    job.CommandLine = request;
+    TokenizeJobLine(request, job.Args);
+    line.clear();
+    RunBatchJob(job, dxcSupport, pIncludeCache, pCompiler);
+    if (!job.Error.empty())
+      fprintf(stderr, "%s\n", job.Error.c_str());
+    fflush(stderr);
+    printf("dxc-serve: %d\n", job.Result);
+    fflush(stdout);
+  }
+  return 0;
+}
+
 #ifdef _WIN32
 int dxc::main(int argc, const wchar_t **argv_) {
 #else
@@ -1388,22 +1661,14 @@ int dxc::main(int argc, const char **argv_) {
       return 0;
     }
 
-    // TODO: implement all other actions.
-    if (!dxcOpts.Preprocess.empty()) {
-      pStage = "Preprocessing";
-      context.Preprocess();
-    }
-    else if (dxcOpts.DumpBin) {
-      pStage = "Dumping existing binary";
-      retVal = context.DumpBinary();
-    }
-    else if (dxcOpts.Link) {
-      pStage = "Linking";
-      retVal = context.Link();
-    }
-    else {
-      pStage = "Compilation";
-      retVal = context.Compile();
+    if (dxcOpts.Serve) {
+      pStage = "Serving";
+      retVal = RunServer(dxcSupport);
+    } else if (!dxcOpts.BatchFile.empty()) {
+      pStage = "Batch compilation";
+      retVal = RunBatch(dxcOpts, dxcSupport);
+    } else {
+      retVal = ActOnOptions(context, dxcOpts, &pStage);
     }
   } catch (const ::hlsl::Exception &hlslException) {
     try {
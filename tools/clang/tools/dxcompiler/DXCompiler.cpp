@@ -19,6 +19,8 @@
 #endif
 #include "dxillib.h"
 
+#include <mutex>
+
 namespace hlsl {
 HRESULT SetupRegistryPassForHLSL();
 HRESULT SetupRegistryPassForPIX();
@@ -58,8 +60,6 @@ static HRESULT InitMaybeFail() throw() {
     goto Cleanup;
   }
   fsSetup = true;
-  IFC(hlsl::SetupRegistryPassForHLSL());
-  IFC(hlsl::SetupRegistryPassForPIX());
   IFC(DxilLibInitialize());
   if (hlsl::options::initHlslOptTable()) {
     hr = E_FAIL;
@@ -80,18 +80,48 @@ Cleanup:
   }
   return hr;
 }
+// Registering every pass is most of the work of loading the library, and
+// objects like IDxcUtils or IDxcContainerReflection never run one, so the
+// registry is filled when the first object that may run passes is created.
+HRESULT DxcSetupPassRegistry() throw() {
+  static std::mutex Mutex;
+  static bool Attempted = false;
+  static HRESULT Result = E_FAIL;
+  HRESULT hr = S_OK;
+  try {
+    std::lock_guard<std::mutex> Lock(Mutex);
+    if (Attempted)
+      return Result;
+    Attempted = true;
+    // The registry lives until unload, so it must not come from the
+    // allocator of whoever happens to create the first object.
+    DxcThreadMalloc TM(nullptr);
+    hr = hlsl::SetupRegistryPassForHLSL();
+    if (SUCCEEDED(hr))
+      hr = hlsl::SetupRegistryPassForPIX();
+    Result = hr;
+  }
+  CATCH_CPP_ASSIGN_HRESULT();
+  return hr;
+}
+
 #if defined(LLVM_ON_UNIX)
 HRESULT __attribute__ ((constructor)) DllMain() {
-  return InitMaybeFail();
+  DxcEtw_DXCompilerInitialization_Start();
+  HRESULT hr = InitMaybeFail();
+  DxcEtw_DXCompilerInitialization_Stop(hr);
+  return hr;
 }
 
 void __attribute__ ((destructor)) DllShutdown() {
+  DxcEtw_DXCompilerShutdown_Start();
   DxcSetThreadMallocToDefault();
   ::hlsl::options::cleanupHlslOptTable();
   ::llvm::sys::fs::CleanupPerThreadFileSystem();
   ::llvm::llvm_shutdown();
   DxcClearThreadMalloc();
   DxcCleanupThreadMalloc();
+  DxcEtw_DXCompilerShutdown_Stop(S_OK);
 }
 #else // LLVM_ON_UNIX
 BOOL WINAPI DllMain(HINSTANCE hinstDLL, DWORD Reason, LPVOID reserved) {
@@ -39,6 +39,8 @@ HRESULT CreateDxcOptimizer(_In_ REFIID riid, _Out_ LPVOID *ppv);
 HRESULT CreateDxcContainerBuilder(_In_ REFIID riid, _Out_ LPVOID *ppv);
 HRESULT CreateDxcLinker(_In_ REFIID riid, _Out_ LPVOID *ppv);
 HRESULT CreateDxcPdbUtils(_In_ REFIID riid, _Out_ LPVOID *ppv);
+HRESULT CreateDxcPooledMalloc(_In_ REFIID riid, _Out_ LPVOID *ppv);
+HRESULT DxcSetupPassRegistry() throw();
 
 namespace hlsl {
 void CreateDxcContainerReflection(IDxcContainerReflection **ppResult);
@@ -80,6 +82,13 @@ static HRESULT ThreadMallocDxcCreateInstance(
                   _Out_ LPVOID   *ppv) {
   HRESULT hr = S_OK;
   *ppv = nullptr;
+  // Anything but these may run LLVM passes, which need the registry.
+  if (!IsEqualCLSID(rclsid, CLSID_DxcUtils) &&
+      !IsEqualCLSID(rclsid, CLSID_DxcCompilerArgs) &&
+      !IsEqualCLSID(rclsid, CLSID_DxcContainerReflection) &&
+      !IsEqualCLSID(rclsid, CLSID_DxcPooledMalloc)) {
+    IFR(DxcSetupPassRegistry());
+  }
   if (IsEqualCLSID(rclsid, CLSID_DxcCompiler)) {
     hr = CreateDxcCompiler(riid, ppv);
   }
@@ -105,6 +114,9 @@ static HRESULT ThreadMallocDxcCreateInstance(
   else if (IsEqualCLSID(rclsid, CLSID_DxcIntelliSense)) {
     hr = CreateDxcIntelliSense(riid, ppv);
   }
+  else if (IsEqualCLSID(rclsid, CLSID_DxcPooledMalloc)) {
+    hr = CreateDxcPooledMalloc(riid, ppv);
+  }
 // Note: The following targets are not yet enabled for non-Windows platforms.
 #ifdef _WIN32
   else if (IsEqualCLSID(rclsid, CLSID_DxcRewriter)) {
@@ -18,6 +18,7 @@
 #include "dxc/DXIL/DxilModule.h"
 #include "dxc/Support/dxcapi.impl.h"
 #include "dxc/Support/dxcfilesystem.h"
+#include "dxc/Support/dxcconcurrency.h"
 #include "dxillib.h"
 #include "dxcutil.h"
 
@@ -28,6 +29,8 @@
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/Support/SourceMgr.h"
 
+#include <vector>
+
 using namespace llvm;
 using namespace hlsl;
 
@@ -45,7 +48,7 @@ static bool HasDebugInfo(const Module &M) {
   return false;
 }
 
-class DxcAssembler : public IDxcAssembler {
+class DxcAssembler : public IDxcAssembler2 {
 private:
   DXC_MICROCOM_TM_REF_FIELDS()      
 public:
@@ -53,7 +56,8 @@ public:
   DXC_MICROCOM_TM_CTOR(DxcAssembler)
 
   HRESULT STDMETHODCALLTYPE QueryInterface(REFIID iid, void **ppvObject) override {
-    return DoBasicQueryInterface<IDxcAssembler>(this, iid, ppvObject);
+    return DoBasicQueryInterface<IDxcAssembler, IDxcAssembler2>(this, iid,
+                                                                 ppvObject);
   }
 
   // Assemble dxil in ll or llvm bitcode to dxbc container.
@@ -61,6 +65,14 @@ public:
       _In_ IDxcBlob *pShader, // Shader to assemble.
       _COM_Outptr_ IDxcOperationResult **ppResult // Assemble output status, buffer, and errors
       ) override;
+
+  // IDxcAssembler2
+  HRESULT STDMETHODCALLTYPE AssembleToContainerBatch(
+      _In_count_(shaderCount) IDxcBlob *const *ppShaders, // Shaders to assemble.
+      _In_ UINT32 shaderCount,                    // Number of shaders.
+      _Out_writes_(shaderCount)
+          IDxcOperationResult **ppResults         // One result per shader: status, buffer, and errors
+      ) override;
 };
 
 // Assemble dxil in ll or llvm bitcode to dxbc container.
@@ -171,6 +183,46 @@ HRESULT STDMETHODCALLTYPE DxcAssembler::AssembleToContainer(
   return hr;
 }
 
+HRESULT STDMETHODCALLTYPE DxcAssembler::AssembleToContainerBatch(
+    _In_count_(shaderCount) IDxcBlob *const *ppShaders, // Shaders to assemble.
+    _In_ UINT32 shaderCount,                    // Number of shaders.
+    _Out_writes_(shaderCount)
+        IDxcOperationResult **ppResults         // One result per shader: status, buffer, and errors
+    ) {
+  if ((shaderCount > 0 && ppShaders == nullptr) || ppResults == nullptr)
+    return E_POINTER;
+  for (UINT32 i = 0; i < shaderCount; ++i) {
+    ppResults[i] = nullptr;
+    if (ppShaders[i] == nullptr)
+      return E_POINTER;
+  }
+
+  DxcThreadMalloc TM(m_pMalloc);
+  try {
+    std::vector<HRESULT> shaderResults(shaderCount, E_FAIL);
+    // AssembleToContainer parses each shader into an LLVMContext of its own,
+    // so shaders share no state but the validator version cache.
+    RunConcurrently(shaderCount, [&](UINT32 i) {
+      DxcThreadMalloc TM(m_pMalloc);
+      shaderResults[i] = AssembleToContainer(ppShaders[i], &ppResults[i]);
+    });
+
+    for (UINT32 i = 0; i < shaderCount; ++i) {
+      if (FAILED(shaderResults[i])) {
+        for (UINT32 j = 0; j < shaderCount; ++j) {
+          if (ppResults[j]) {
+            ppResults[j]->Release();
+            ppResults[j] = nullptr;
+          }
+        }
+        return shaderResults[i];
+      }
+    }
+    return S_OK;
+  }
+  CATCH_CPP_RETURN_HRESULT();
+}
+
 HRESULT CreateDxcAssembler(_In_ REFIID riid, _Out_ LPVOID *ppv) {
   CComPtr<DxcAssembler> result = DxcAssembler::Alloc(DxcGetThreadMallocNoRef());
   if (result == nullptr) {
@@ -0,0 +1,284 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// dxccompilejob.cpp                                                         //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Hermetic compile jobs for IDxcCompiler8 and compile snapshots for         //
+// IDxcCompiler9.                                                            //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#include "dxc/Support/WinIncludes.h"
+#include "dxc/Support/Global.h"
+#include "dxc/Support/FileIOHelper.h"
+#include "dxc/Support/microcom.h"
+
+#include "dxccompilercache.h"
+#include "dxccompilejob.h"
+
+#include <mutex>
+
+using namespace llvm;
+using namespace hlsl;
+
+namespace {
+
+static const uint32_t kJobMagic = 0x4A435844; // 'DXCJ'
+static const uint32_t kJobVersion = 1;
+static const uint32_t kSnapshotMagic = 0x53435844; // 'DXCS'
+static const uint32_t kSnapshotVersion = 1;
+
+typedef dxcutil::DxcCompileJobDescription::Lookup Lookup;
+
+// Returns the recorded outcome of a lookup, with contents that point into
+// the job.
+static HRESULT ServeLookup(const dxcutil::DxcCompileJobDescription &Job,
+                           const Lookup &L, IMalloc *pMalloc,
+                           IDxcBlob **ppIncludeSource) {
+  auto it = L.Found ? Job.Blobs.find(L.Digest) : Job.Blobs.end();
+  if (it == Job.Blobs.end())
+    return E_FAIL;
+  CComPtr<IDxcBlobEncoding> pBlob;
+  IFR(DxcCreateBlob(it->second.data(), it->second.size(), /*bPinned*/ true,
+                    /*bCopy*/ false, L.EncodingKnown, L.CodePage, pMalloc,
+                    &pBlob));
+  return pBlob.QueryInterface(ppIncludeSource);
+}
+
+class DxcRecordingIncludeHandler : public IDxcIncludeHandler {
+private:
+  DXC_MICROCOM_TM_REF_FIELDS()
+  CComPtr<IDxcIncludeHandler> m_pInner;
+  dxcutil::DxcCompileJobDescription *m_pJob = nullptr;
+  std::mutex m_Mutex;
+
+  // Loads pFilename through the inner handler into the job. Must be called
+  // with m_Mutex held.
+  Lookup Record(LPCWSTR pFilename) {
+    Lookup L;
+    CComPtr<IDxcBlob> pBlob;
+    if (m_pInner && SUCCEEDED(m_pInner->LoadSource(pFilename, &pBlob)) &&
+        pBlob) {
+      BOOL known = FALSE;
+      CComPtr<IDxcBlobEncoding> pEncoding;
+      if (SUCCEEDED(pBlob.QueryInterface(&pEncoding)))
+        IFT(pEncoding->GetEncoding(&known, &L.CodePage));
+      L.Found = true;
+      L.EncodingKnown = known != FALSE;
+      if (!L.EncodingKnown)
+        L.CodePage = 0;
+      L.Digest = m_pJob->AddBlob(pBlob->GetBufferPointer(),
+                                 pBlob->GetBufferSize());
+    }
+    return L;
+  }
+
+public:
+  DXC_MICROCOM_TM_ADDREF_RELEASE_IMPL()
+  DXC_MICROCOM_TM_CTOR(DxcRecordingIncludeHandler)
+
+  void Initialize(IDxcIncludeHandler *pInner,
+                  dxcutil::DxcCompileJobDescription *pJob) {
+    m_pInner = pInner;
+    m_pJob = pJob;
+  }
+
+  HRESULT STDMETHODCALLTYPE QueryInterface(REFIID iid, void **ppvObject) override {
+    return DoBasicQueryInterface<IDxcIncludeHandler>(this, iid, ppvObject);
+  }
+
+  // Serves the contents from the job rather than the inner handler's blob,
+  // so the recording compile sees exactly what CompileJob will.
+  HRESULT STDMETHODCALLTYPE LoadSource(
+    _In_ LPCWSTR pFilename,                                   // Candidate filename.
+    _COM_Outptr_result_maybenull_ IDxcBlob **ppIncludeSource  // Resultant source object for included file, nullptr if not found.
+    ) override {
+    if (pFilename == nullptr || ppIncludeSource == nullptr)
+      return E_INVALIDARG;
+    *ppIncludeSource = nullptr;
+    DxcThreadMalloc TM(m_pMalloc);
+    try {
+      std::lock_guard<std::mutex> lock(m_Mutex);
+      auto it = m_pJob->Lookups.find(pFilename);
+      if (it == m_pJob->Lookups.end())
+        it = m_pJob->Lookups.insert(std::make_pair(std::wstring(pFilename),
+                                                   Record(pFilename))).first;
+      return ServeLookup(*m_pJob, it->second, m_pMalloc, ppIncludeSource);
+    }
+    CATCH_CPP_RETURN_HRESULT();
+  }
+};
+
+class DxcJobIncludeHandler : public IDxcIncludeHandler {
+private:
+  DXC_MICROCOM_TM_REF_FIELDS()
+  const dxcutil::DxcCompileJobDescription *m_pJob = nullptr;
+
+public:
+  DXC_MICROCOM_TM_ADDREF_RELEASE_IMPL()
+  DXC_MICROCOM_TM_CTOR(DxcJobIncludeHandler)
+
+  void Initialize(const dxcutil::DxcCompileJobDescription *pJob) {
+    m_pJob = pJob;
+  }
+
+  HRESULT STDMETHODCALLTYPE QueryInterface(REFIID iid, void **ppvObject) override {
+    return DoBasicQueryInterface<IDxcIncludeHandler>(this, iid, ppvObject);
+  }
+
+  HRESULT STDMETHODCALLTYPE LoadSource(
+    _In_ LPCWSTR pFilename,                                   // Candidate filename.
+    _COM_Outptr_result_maybenull_ IDxcBlob **ppIncludeSource  // Resultant source object for included file, nullptr if not found.
+    ) override {
+    if (pFilename == nullptr || ppIncludeSource == nullptr)
+      return E_INVALIDARG;
+    *ppIncludeSource = nullptr;
+    DxcThreadMalloc TM(m_pMalloc);
+    try {
+      auto it = m_pJob->Lookups.find(pFilename);
+      if (it == m_pJob->Lookups.end())
+        return E_FAIL;
+      return ServeLookup(*m_pJob, it->second, m_pMalloc, ppIncludeSource);
+    }
+    CATCH_CPP_RETURN_HRESULT();
+  }
+};
+
+} // namespace
+
+namespace dxcutil {
+
+std::string DxcCompileJobDescription::AddBlob(const void *pData, size_t size) {
+  std::string digest = DxcCompileCache::HashData(pData, size);
+  if (Blobs.find(digest) == Blobs.end())
+    Blobs[digest].assign((const char *)pData, size);
+  return digest;
+}
+
+void DxcCompileJobDescription::Write(std::string &Buffer) const {
+  DxcRecordWriter W(Buffer);
+  W.WriteU32(kJobMagic);
+  W.WriteU32(kJobVersion);
+  W.WriteBytes(Fingerprint);
+  W.WriteU32((uint32_t)Arguments.size());
+  for (const std::string &Arg : Arguments)
+    W.WriteBytes(Arg);
+  W.WriteU32(SourceEncoding);
+  W.WriteBytes(SourceDigest);
+  W.WriteU32((uint32_t)Lookups.size());
+  for (const auto &L : Lookups) {
+    W.WriteWide(L.first);
+    W.WriteU32(L.second.Found ? 1 : 0);
+    W.WriteU32(L.second.EncodingKnown ? 1 : 0);
+    W.WriteU32(L.second.CodePage);
+    W.WriteBytes(L.second.Digest);
+  }
+  W.WriteU32((uint32_t)Blobs.size());
+  for (const auto &B : Blobs) {
+    W.WriteBytes(B.first);
+    W.WriteBytes(B.second);
+  }
+}
+
+bool DxcCompileJobDescription::Read(const void *pData, size_t size) {
+  DxcRecordReader R(pData, size);
+  uint32_t magic, version, count;
+  if (!R.ReadU32(magic) || magic != kJobMagic || !R.ReadU32(version) ||
+      version != kJobVersion || !R.ReadBytes(Fingerprint) ||
+      !R.ReadU32(count))
+    return false;
+  // Counts are not trusted to size anything before the data is read.
+  for (uint32_t i = 0; i < count; ++i) {
+    Arguments.emplace_back();
+    if (!R.ReadBytes(Arguments.back()))
+      return false;
+  }
+  if (!R.ReadU32(SourceEncoding) || !R.ReadBytes(SourceDigest) ||
+      !R.ReadU32(count))
+    return false;
+  for (uint32_t i = 0; i < count; ++i) {
+    std::wstring Name;
+    Lookup L;
+    uint32_t found, known;
+    if (!R.ReadWide(Name) || !R.ReadU32(found) || !R.ReadU32(known) ||
+        !R.ReadU32(L.CodePage) || !R.ReadBytes(L.Digest))
+      return false;
+    L.Found = found != 0;
+    L.EncodingKnown = known != 0;
+    Lookups[Name] = std::move(L);
+  }
+  if (!R.ReadU32(count))
+    return false;
+  for (uint32_t i = 0; i < count; ++i) {
+    std::string Digest, Contents;
+    if (!R.ReadBytes(Digest) || !R.ReadBytes(Contents) ||
+        DxcCompileCache::HashString(Contents) != Digest)
+      return false;
+    Blobs[Digest] = std::move(Contents);
+  }
+  if (Blobs.find(SourceDigest) == Blobs.end())
+    return false;
+  for (const auto &L : Lookups) {
+    if (L.second.Found && Blobs.find(L.second.Digest) == Blobs.end())
+      return false;
+  }
+  return R.AtEnd();
+}
+
+void DxcCompileSnapshot::Write(std::string &Buffer) const {
+  DxcRecordWriter W(Buffer);
+  W.WriteU32(kSnapshotMagic);
+  W.WriteU32(kSnapshotVersion);
+  W.WriteBytes(Fingerprint);
+  W.WriteU32((uint32_t)Arguments.size());
+  for (const std::string &Arg : Arguments)
+    W.WriteBytes(Arg);
+  W.WriteBytes(Module);
+}
+
+bool DxcCompileSnapshot::Read(const void *pData, size_t size) {
+  DxcRecordReader R(pData, size);
+  uint32_t magic, version, count;
+  if (!R.ReadU32(magic) || magic != kSnapshotMagic || !R.ReadU32(version) ||
+      version != kSnapshotVersion || !R.ReadBytes(Fingerprint) ||
+      !R.ReadU32(count))
+    return false;
+  for (uint32_t i = 0; i < count; ++i) {
+    Arguments.emplace_back();
+    if (!R.ReadBytes(Arguments.back()))
+      return false;
+  }
+  return R.ReadBytes(Module) && !Module.empty() && R.AtEnd();
+}
+
+HRESULT CreateRecordingIncludeHandler(IMalloc *pMalloc,
+                                      IDxcIncludeHandler *pInner,
+                                      DxcCompileJobDescription &Job,
+                                      IDxcIncludeHandler **ppHandler) {
+  if (ppHandler == nullptr)
+    return E_POINTER;
+  *ppHandler = nullptr;
+  CComPtr<DxcRecordingIncludeHandler> pHandler =
+      DxcRecordingIncludeHandler::Alloc(pMalloc);
+  IFROOM(pHandler.p);
+  pHandler->Initialize(pInner, &Job);
+  *ppHandler = pHandler.Detach();
+  return S_OK;
+}
+
+HRESULT CreateJobIncludeHandler(IMalloc *pMalloc,
+                                const DxcCompileJobDescription &Job,
+                                IDxcIncludeHandler **ppHandler) {
+  if (ppHandler == nullptr)
+    return E_POINTER;
+  *ppHandler = nullptr;
+  CComPtr<DxcJobIncludeHandler> pHandler = DxcJobIncludeHandler::Alloc(pMalloc);
+  IFROOM(pHandler.p);
+  pHandler->Initialize(&Job);
+  *ppHandler = pHandler.Detach();
+  return S_OK;
+}
+
+} // namespace dxcutil
@@ -0,0 +1,82 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// dxccompilejob.h                                                           //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Hermetic compile jobs for IDxcCompiler8 and compile snapshots for         //
+// IDxcCompiler9.                                                            //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "dxc/dxcapi.h"
+#include "llvm/ADT/StringRef.h"
+#include <map>
+#include <string>
+#include <vector>
+
+namespace dxcutil {
+
+/// A compile reduced to its inputs, so that it can run where neither the
+/// original files nor the include handler exist.
+///
+/// File contents live in Blobs under the hex MD5 of their bytes; the source
+/// and each include lookup refer to them by that digest. Maps keep every
+/// part in a fixed order, so the same compile always serializes to the same
+/// bytes.
+struct DxcCompileJobDescription {
+  /// The outcome of one name looked up through the include handler.
+  struct Lookup {
+    bool Found = false;
+    bool EncodingKnown = false;
+    UINT32 CodePage = 0;
+    std::string Digest; // Key into Blobs, when Found.
+  };
+
+  std::string Fingerprint; // Digest of the compiler, validator and options.
+  std::vector<std::string> Arguments; // Normalized arguments, in UTF-8.
+  UINT32 SourceEncoding = 0;
+  std::string SourceDigest;
+  std::map<std::wstring, Lookup> Lookups;
+  std::map<std::string, std::string> Blobs;
+
+  /// Adds a copy of the data to Blobs if it is not there yet, and returns
+  /// its digest.
+  std::string AddBlob(const void *pData, size_t size);
+
+  void Write(std::string &Buffer) const;
+  /// Returns false if the data is not a job, or if any stored contents do
+  /// not match their digest.
+  bool Read(const void *pData, size_t size);
+};
+
+/// A compile stopped after high-level code generation, to be finished once
+/// per variant by IDxcCompiler9::ResumeSnapshot.
+struct DxcCompileSnapshot {
+  std::string Fingerprint; // Digest of the compiler, validator and options.
+  std::vector<std::string> Arguments; // Normalized arguments, in UTF-8.
+  std::string Module; // High-level module bitcode.
+
+  void Write(std::string &Buffer) const;
+  /// Returns false if the data is not a snapshot.
+  bool Read(const void *pData, size_t size);
+};
+
+/// Creates an include handler that forwards to pInner and records the
+/// outcome of the first lookup of each name in Job. Later lookups of a name
+/// return the recorded outcome. Job must outlive the handler, which may be
+/// used from several threads at once.
+HRESULT CreateRecordingIncludeHandler(
+    _In_ IMalloc *pMalloc, _In_opt_ IDxcIncludeHandler *pInner,
+    DxcCompileJobDescription &Job, _COM_Outptr_ IDxcIncludeHandler **ppHandler);
+
+/// Creates an include handler that serves the lookups recorded in Job and
+/// fails every other name. Job must outlive the handler.
+HRESULT CreateJobIncludeHandler(_In_ IMalloc *pMalloc,
+                                const DxcCompileJobDescription &Job,
+                                _COM_Outptr_ IDxcIncludeHandler **ppHandler);
+
+} // namespace dxcutil
@@ -0,0 +1,316 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// dxccompilercache.cpp                                                      //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Content-addressed cache of compile results for dxcompiler.                //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#include "dxc/Support/WinIncludes.h"
+#include "dxc/Support/Global.h"
+#include "dxc/Support/FileIOHelper.h"
+#include "dxc/Support/Unicode.h"
+#include "dxc/Support/dxcapi.impl.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Support/MD5.h"
+
+#include "dxccompilercache.h"
+
+using namespace llvm;
+using namespace hlsl;
+
+namespace {
+
+static const uint32_t kCacheFileMagic = 0x43435844; // 'DXCC'
+static const uint32_t kCacheFileVersion = 1;
+
+} // namespace
+
+namespace dxcutil {
+
+std::string DxcCompileCache::HashData(const void *pData, size_t size) {
+  MD5 md5;
+  md5.update(ArrayRef<uint8_t>((const uint8_t *)pData, size));
+  MD5::MD5Result result;
+  md5.final(result);
+  SmallString<32> str;
+  MD5::stringifyResult(result, str);
+  return str.str();
+}
+
+HRESULT DxcCompileCache::Enable(LPCWSTR pDirectory) {
+  std::lock_guard<std::mutex> lock(m_Mutex);
+  m_bEnabled = true;
+  m_Directory = pDirectory ? pDirectory : L"";
+  return S_OK;
+}
+
+void DxcCompileCache::Disable() {
+  std::lock_guard<std::mutex> lock(m_Mutex);
+  m_bEnabled = false;
+  m_Directory.clear();
+  m_Entries.clear();
+  m_Order.clear();
+  m_Bytes = 0;
+  m_Hits = m_Misses = 0;
+}
+
+void DxcCompileCache::GetStatistics(UINT64 *pHits, UINT64 *pMisses) {
+  std::lock_guard<std::mutex> lock(m_Mutex);
+  *pHits = m_Hits;
+  *pMisses = m_Misses;
+}
+
+void DxcCompileCache::LoadDependency(IDxcIncludeHandler *pIncludeHandler,
+                                     LPCWSTR pName, UINT32 codePage,
+                                     Dependency &Dep) {
+  Dep.Name = pName;
+  Dep.Found = false;
+  Dep.Digest.clear();
+  if (!pIncludeHandler)
+    return;
+  CComPtr<IDxcBlob> pBlob;
+  if (FAILED(pIncludeHandler->LoadSource(pName, &pBlob)) || !pBlob)
+    return;
+  CComPtr<IDxcBlobUtf8> pUtf8;
+  if (FAILED(DxcGetBlobAsUtf8(pBlob, DxcGetThreadMallocNoRef(), &pUtf8,
+                              codePage)))
+    return;
+  Dep.Found = true;
+  Dep.Digest = HashData(pUtf8->GetStringPointer(), pUtf8->GetStringLength());
+}
+
+bool DxcCompileCache::DependenciesMatch(const Entry &E,
+                                        IDxcIncludeHandler *pIncludeHandler,
+                                        UINT32 codePage) {
+  for (const Dependency &Recorded : E.Deps) {
+    Dependency Current;
+    LoadDependency(pIncludeHandler, Recorded.Name.c_str(), codePage, Current);
+    if (Current.Found != Recorded.Found || Current.Digest != Recorded.Digest)
+      return false;
+  }
+  return true;
+}
+
+HRESULT DxcCompileCache::CreateResult(const Entry &E, IDxcResult **ppResult) {
+  CComPtr<DxcResult> pResult = DxcResult::Alloc(DxcGetThreadMallocNoRef());
+  IFROOM(pResult.p);
+  for (const Output &O : E.Outputs) {
+    DxcOutputObject object;
+    object.kind = O.Kind;
+    if (O.CodePage) {
+      CComPtr<IDxcBlobEncoding> pBlob;
+      IFR(DxcCreateBlobWithEncodingOnHeapCopy(
+          O.Data.data(), O.Data.size(), O.CodePage, &pBlob));
+      object.object = pBlob;
+    } else {
+      CComPtr<IDxcBlob> pBlob;
+      IFR(DxcCreateBlobOnHeapCopy(O.Data.data(), O.Data.size(), &pBlob));
+      object.object = pBlob;
+    }
+    if (O.HasName)
+      IFR(object.SetName(O.Name.c_str()));
+    IFR(pResult->SetOutput(object));
+  }
+  IFR(pResult->SetStatusAndPrimaryResult(E.Status, E.PrimaryOutput));
+  *ppResult = pResult.Detach();
+  return S_OK;
+}
+
+size_t DxcCompileCache::GetEntrySize(const Entry &E) {
+  size_t size = sizeof(Entry);
+  for (const Dependency &D : E.Deps)
+    size += D.Name.size() * sizeof(wchar_t) + D.Digest.size();
+  for (const Output &O : E.Outputs)
+    size += O.Name.size() * sizeof(wchar_t) + O.Data.size();
+  return size;
+}
+
+void DxcCompileCache::AddEntry(StringRef Key, EntryPtr E) {
+  size_t size = GetEntrySize(*E);
+  if (size > kMaxBytes)
+    return;
+  auto inserted = m_Entries.insert(std::make_pair(Key.str(), EntryPtr()));
+  if (inserted.second)
+    m_Order.push_back(Key.str());
+  else
+    m_Bytes -= GetEntrySize(*inserted.first->second);
+  m_Bytes += size;
+  inserted.first->second = std::move(E);
+  while (m_Bytes > kMaxBytes) {
+    auto oldest = m_Entries.find(m_Order.front());
+    m_Bytes -= GetEntrySize(*oldest->second);
+    m_Entries.erase(oldest);
+    m_Order.pop_front();
+  }
+}
+
+bool DxcCompileCache::Lookup(StringRef Key, IDxcIncludeHandler *pIncludeHandler,
+                             UINT32 codePage, IDxcResult **ppResult) {
+  *ppResult = nullptr;
+  EntryPtr E;
+  std::wstring directory;
+  {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    auto it = m_Entries.find(Key);
+    if (it != m_Entries.end())
+      E = it->second;
+    else
+      directory = m_Directory;
+  }
+  if (!E && !directory.empty()) {
+    std::shared_ptr<Entry> pRead = std::make_shared<Entry>();
+    if (ReadEntry(directory, Key, *pRead)) {
+      E = pRead;
+      std::lock_guard<std::mutex> lock(m_Mutex);
+      // Keep it only if the cache was not disabled or moved meanwhile.
+      if (m_Directory == directory)
+        AddEntry(Key, E);
+    }
+  }
+
+  // The entry is immutable once added, so the include handler is called
+  // without the lock.
+  bool hit = E && DependenciesMatch(*E, pIncludeHandler, codePage) &&
+             SUCCEEDED(CreateResult(*E, ppResult));
+  std::lock_guard<std::mutex> lock(m_Mutex);
+  if (hit)
+    ++m_Hits;
+  else
+    ++m_Misses;
+  return hit;
+}
+
+void DxcCompileCache::Store(StringRef Key, std::vector<Dependency> &&Deps,
+                            IDxcResult *pResult) {
+  Entry E;
+  E.Deps = std::move(Deps);
+  if (FAILED(pResult->GetStatus(&E.Status)))
+    return;
+  E.PrimaryOutput = pResult->PrimaryOutput();
+  for (unsigned i = DXC_OUT_NONE + 1; i <= kNumDxcOutputTypes; ++i) {
+    DXC_OUT_KIND kind = (DXC_OUT_KIND)i;
+    if (!pResult->HasOutput(kind))
+      continue;
+    CComPtr<IDxcBlob> pBlob;
+    CComPtr<IDxcBlobWide> pName;
+    // Outputs that aren't blobs (such as extra outputs) can't be recreated.
+    if (FAILED(pResult->GetOutput(kind, IID_PPV_ARGS(&pBlob), &pName)))
+      return;
+    Output O;
+    O.Kind = kind;
+    O.Data.assign((const char *)pBlob->GetBufferPointer(),
+                  pBlob->GetBufferSize());
+    CComPtr<IDxcBlobEncoding> pEncoding;
+    BOOL known = FALSE;
+    if (DxcGetOutputType(kind) == DxcOutputType_Text &&
+        SUCCEEDED(pBlob.QueryInterface(&pEncoding)) &&
+        SUCCEEDED(pEncoding->GetEncoding(&known, &O.CodePage)) && !known)
+      O.CodePage = 0;
+    if (pName) {
+      O.HasName = true;
+      O.Name = pName->GetStringPointer();
+    }
+    E.Outputs.push_back(std::move(O));
+  }
+
+  EntryPtr pStored = std::make_shared<Entry>(std::move(E));
+  std::wstring directory;
+  {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    directory = m_Directory;
+  }
+  if (!directory.empty())
+    WriteEntry(directory, Key, *pStored);
+  std::lock_guard<std::mutex> lock(m_Mutex);
+  AddEntry(Key, std::move(pStored));
+}
+
+std::wstring DxcCompileCache::GetEntryPath(const std::wstring &Directory,
+                                           StringRef Key) {
+  std::wstring path = Directory;
+  if (!path.empty() && path.back() != L'/' && path.back() != L'\\')
+    path += L'/';
+  path += Unicode::UTF8ToWideStringOrThrow(Key.str().c_str());
+  path += L".dxccache";
+  return path;
+}
+
+bool DxcCompileCache::ReadEntry(const std::wstring &Directory, StringRef Key,
+                                Entry &E) {
+  CDxcMallocHeapPtr<char> pData(DxcGetThreadMallocNoRef());
+  DWORD dataSize = 0;
+  try {
+    ReadBinaryFile(pData.GetMallocNoRef(),
+                   GetEntryPath(Directory, Key).c_str(),
+                   (void **)&pData.m_pData, &dataSize);
+  } catch (...) {
+    // A missing or unreadable file is just a miss.
+    return false;
+  }
+
+  DxcRecordReader R(pData.m_pData, dataSize);
+  uint32_t magic, version, status, primary, count;
+  if (!R.ReadU32(magic) || magic != kCacheFileMagic ||
+      !R.ReadU32(version) || version != kCacheFileVersion ||
+      !R.ReadU32(status) || !R.ReadU32(primary) || !R.ReadU32(count))
+    return false;
+  E.Status = (HRESULT)status;
+  E.PrimaryOutput = (DXC_OUT_KIND)primary;
+  E.Deps.resize(count);
+  for (Dependency &D : E.Deps) {
+    uint32_t found;
+    if (!R.ReadWide(D.Name) || !R.ReadU32(found) || !R.ReadBytes(D.Digest))
+      return false;
+    D.Found = found != 0;
+  }
+  if (!R.ReadU32(count))
+    return false;
+  E.Outputs.resize(count);
+  for (Output &O : E.Outputs) {
+    uint32_t kind, hasName;
+    if (!R.ReadU32(kind) || !R.ReadU32(O.CodePage) || !R.ReadU32(hasName) ||
+        !R.ReadWide(O.Name) || !R.ReadBytes(O.Data))
+      return false;
+    if (kind == DXC_OUT_NONE || kind > kNumDxcOutputTypes)
+      return false;
+    O.Kind = (DXC_OUT_KIND)kind;
+    O.HasName = hasName != 0;
+  }
+  return R.AtEnd();
+}
+
+void DxcCompileCache::WriteEntry(const std::wstring &Directory, StringRef Key,
+                                 const Entry &E) {
+  std::string buffer;
+  DxcRecordWriter W(buffer);
+  W.WriteU32(kCacheFileMagic);
+  W.WriteU32(kCacheFileVersion);
+  W.WriteU32((uint32_t)E.Status);
+  W.WriteU32((uint32_t)E.PrimaryOutput);
+  W.WriteU32((uint32_t)E.Deps.size());
+  for (const Dependency &D : E.Deps) {
+    W.WriteWide(D.Name);
+    W.WriteU32(D.Found ? 1 : 0);
+    W.WriteBytes(D.Digest);
+  }
+  W.WriteU32((uint32_t)E.Outputs.size());
+  for (const Output &O : E.Outputs) {
+    W.WriteU32((uint32_t)O.Kind);
+    W.WriteU32(O.CodePage);
+    W.WriteU32(O.HasName ? 1 : 0);
+    W.WriteWide(O.Name);
+    W.WriteBytes(O.Data);
+  }
+  try {
+    WriteBinaryFile(GetEntryPath(Directory, Key).c_str(), buffer.data(),
+                    (DWORD)buffer.size());
+  } catch (...) {
+    // Persisting is best-effort; the in-memory entry is still usable.
+  }
+}
+
+} // namespace dxcutil
@@ -0,0 +1,170 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// dxccompilercache.h                                                        //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Content-addressed cache of compile results for dxcompiler.                //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "dxc/dxcapi.h"
+#include "dxc/Support/microcom.h"
+#include "dxc/Support/Unicode.h"
+#include "llvm/ADT/StringRef.h"
+#include <atomic>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace dxcutil {
+
+/// Writes the length-prefixed records of persisted cache entries and
+/// compile jobs.
+class DxcRecordWriter {
+  std::string &m_Buffer;
+public:
+  DxcRecordWriter(std::string &Buffer) : m_Buffer(Buffer) {}
+  void WriteU32(uint32_t V) { m_Buffer.append((const char *)&V, sizeof(V)); }
+  void WriteBytes(llvm::StringRef Bytes) {
+    WriteU32((uint32_t)Bytes.size());
+    m_Buffer.append(Bytes.data(), Bytes.size());
+  }
+  void WriteWide(const std::wstring &Str) {
+    WriteBytes(Unicode::WideToUTF8StringOrThrow(Str.c_str()));
+  }
+};
+
+/// Reads records written by DxcRecordWriter, failing on truncated data.
+class DxcRecordReader {
+  const char *m_pCur;
+  const char *m_pEnd;
+public:
+  DxcRecordReader(const void *pData, size_t size)
+      : m_pCur((const char *)pData), m_pEnd((const char *)pData + size) {}
+  bool ReadU32(uint32_t &V) {
+    if ((size_t)(m_pEnd - m_pCur) < sizeof(V))
+      return false;
+    memcpy(&V, m_pCur, sizeof(V));
+    m_pCur += sizeof(V);
+    return true;
+  }
+  bool ReadBytes(std::string &Bytes) {
+    uint32_t size;
+    if (!ReadU32(size) || (size_t)(m_pEnd - m_pCur) < size)
+      return false;
+    Bytes.assign(m_pCur, size);
+    m_pCur += size;
+    return true;
+  }
+  bool ReadWide(std::wstring &Str) {
+    std::string Utf8;
+    return ReadBytes(Utf8) &&
+           Unicode::UTF8ToWideString(Utf8.data(), Utf8.size(), &Str);
+  }
+  bool AtEnd() const { return m_pCur == m_pEnd; }
+};
+
+/// Cache of compile results keyed on everything that can affect them.
+///
+/// The primary key is a digest of the compiler and validator versions, the
+/// normalized command-line arguments and the main source text. Includes
+/// cannot be known before preprocessing, so each entry also records every
+/// lookup made through the include handler (including failed ones) along
+/// with a digest of the returned contents. A lookup is a hit only if
+/// replaying those lookups against the current include handler produces the
+/// same results, so the compiler never has to build a CompilerInstance.
+///
+/// When a directory is provided, entries are also written to
+/// <directory>/<key>.dxccache and read back on an in-memory miss. The
+/// directory must already exist.
+///
+/// The oldest entries are dropped from memory once they hold more than
+/// kMaxBytes. The lock is only held to find and add entries: file I/O and
+/// the include handler calls that check dependencies run without it.
+class DxcCompileCache {
+public:
+  static const size_t kMaxBytes = 256 << 20;
+
+  struct Dependency {
+    std::wstring Name;
+    bool Found = false;
+    std::string Digest; // Hex MD5 of the UTF-8 contents, when Found.
+  };
+
+  static std::string HashData(const void *pData, size_t size);
+  static std::string HashString(llvm::StringRef Str) {
+    return HashData(Str.data(), Str.size());
+  }
+
+  HRESULT Enable(_In_opt_z_ LPCWSTR pDirectory);
+  void Disable();
+  bool IsEnabled() const { return m_bEnabled; }
+  void GetStatistics(_Out_ UINT64 *pHits, _Out_ UINT64 *pMisses);
+
+  /// Looks up Key and replays the entry's dependencies against
+  /// pIncludeHandler. On a hit, *ppResult receives a result identical to the
+  /// one originally stored. Counts a hit or miss either way.
+  bool Lookup(llvm::StringRef Key, _In_opt_ IDxcIncludeHandler *pIncludeHandler,
+              UINT32 codePage, _COM_Outptr_ IDxcResult **ppResult);
+
+  /// Records pResult under Key. Only results made of blob outputs can be
+  /// cached; anything else is silently skipped.
+  void Store(llvm::StringRef Key, std::vector<Dependency> &&Deps,
+             _In_ IDxcResult *pResult);
+
+  /// Loads pName through pIncludeHandler the way DxcArgsFileSystem does and
+  /// fills in a dependency record for it.
+  static void LoadDependency(_In_opt_ IDxcIncludeHandler *pIncludeHandler,
+                             _In_z_ LPCWSTR pName, UINT32 codePage,
+                             Dependency &Dep);
+
+private:
+  struct Output {
+    DXC_OUT_KIND Kind = DXC_OUT_NONE;
+    UINT32 CodePage = 0; // 0 for binary outputs.
+    bool HasName = false;
+    std::wstring Name;
+    std::string Data;
+  };
+  struct Entry {
+    HRESULT Status = S_OK;
+    DXC_OUT_KIND PrimaryOutput = DXC_OUT_NONE;
+    std::vector<Dependency> Deps;
+    std::vector<Output> Outputs;
+  };
+
+  typedef std::shared_ptr<const Entry> EntryPtr;
+
+  static std::wstring GetEntryPath(const std::wstring &Directory,
+                                   llvm::StringRef Key);
+  static bool ReadEntry(const std::wstring &Directory, llvm::StringRef Key,
+                        Entry &E);
+  static void WriteEntry(const std::wstring &Directory, llvm::StringRef Key,
+                         const Entry &E);
+  static size_t GetEntrySize(const Entry &E);
+  static bool DependenciesMatch(const Entry &E,
+                                IDxcIncludeHandler *pIncludeHandler,
+                                UINT32 codePage);
+  static HRESULT CreateResult(const Entry &E, IDxcResult **ppResult);
+  /// Adds or replaces the entry for Key and drops the oldest entries over
+  /// the budget. Must be called with m_Mutex held.
+  void AddEntry(llvm::StringRef Key, EntryPtr E);
+
+  std::mutex m_Mutex;
+  std::atomic<bool> m_bEnabled{false}; // Read without the lock.
+  std::wstring m_Directory;
+  std::map<std::string, EntryPtr> m_Entries;
+  std::deque<std::string> m_Order; // Keys, oldest first.
+  size_t m_Bytes = 0;
+  UINT64 m_Hits = 0;
+  UINT64 m_Misses = 0;
+};
+
+} // namespace dxcutil
@@ -0,0 +1,75 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// dxccontextpool.cpp                                                        //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Pool of LLVM contexts reused across compiles.                             //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/IR/LLVMContext.h"
+
+#include "dxccontextpool.h"
+
+using namespace llvm;
+
+namespace dxcutil {
+
+DxcContextPool::DxcContextPool()
+    : m_Enabled(false), m_MaxRetainedObjects(kDefaultMaxRetainedObjects) {}
+
+DxcContextPool::~DxcContextPool() {}
+
+void DxcContextPool::Enable(size_t maxRetainedObjects) {
+  std::lock_guard<std::mutex> lock(m_Mutex);
+  m_Enabled = true;
+  m_MaxRetainedObjects =
+      maxRetainedObjects ? maxRetainedObjects : kDefaultMaxRetainedObjects;
+}
+
+void DxcContextPool::Disable() {
+  std::vector<std::unique_ptr<LLVMContext>> contexts;
+  {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_Enabled = false;
+    contexts.swap(m_Contexts);
+  }
+}
+
+std::unique_ptr<LLVMContext> DxcContextPool::Acquire() {
+  {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    if (!m_Contexts.empty()) {
+      std::unique_ptr<LLVMContext> pContext = std::move(m_Contexts.back());
+      m_Contexts.pop_back();
+      return pContext;
+    }
+  }
+  return llvm::make_unique<LLVMContext>();
+}
+
+void DxcContextPool::Release(std::unique_ptr<LLVMContext> pContext) {
+  size_t maxRetainedObjects;
+  {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    if (!m_Enabled)
+      return;
+    maxRetainedObjects = m_MaxRetainedObjects;
+  }
+  if (pContext->getNumRetainedObjects() > maxRetainedObjects ||
+      !pContext->resetForReuse())
+    return;
+  std::lock_guard<std::mutex> lock(m_Mutex);
+  if (m_Enabled)
+    m_Contexts.push_back(std::move(pContext));
+}
+
+PooledLLVMContext::~PooledLLVMContext() {
+  if (m_Reusable)
+    m_Pool.Release(std::move(m_pContext));
+}
+
+} // namespace dxcutil
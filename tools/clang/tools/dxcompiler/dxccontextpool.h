@@ -0,0 +1,75 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// dxccontextpool.h                                                          //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Pool of LLVM contexts reused across compiles.                             //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace llvm {
+class LLVMContext;
+}
+
+namespace dxcutil {
+
+/// Pool of LLVMContexts that finished compiles hand back for later ones.
+///
+/// A new context has to build its type tables, metadata kinds, attribute
+/// lists and common constants again, and tears them down when it goes. A
+/// pooled context keeps them. LLVMContext::resetForReuse drops what would
+/// make a later compile's output differ from one in a new context, so
+/// reusing a context does not change any output.
+///
+/// Uniqued objects are never freed while the context lives, so a context
+/// that holds more than the limit after a compile is destroyed instead of
+/// being put back. Disabled until Enable is called.
+class DxcContextPool {
+public:
+  static const size_t kDefaultMaxRetainedObjects = 1 << 20;
+
+  DxcContextPool();
+  ~DxcContextPool();
+
+  void Enable(size_t maxRetainedObjects);
+  void Disable();
+
+  /// Returns a pooled context, or a new one if none is available.
+  std::unique_ptr<llvm::LLVMContext> Acquire();
+  /// Puts back a context whose modules have all been destroyed.
+  void Release(std::unique_ptr<llvm::LLVMContext> pContext);
+
+private:
+  std::mutex m_Mutex;
+  bool m_Enabled;
+  size_t m_MaxRetainedObjects;
+  std::vector<std::unique_ptr<llvm::LLVMContext>> m_Contexts;
+};
+
+/// Holds a context for one compile. The context goes back to the pool when
+/// the holder is destroyed, which must be after every module in it, but only
+/// if SetReusable was called; one abandoned by an exception is destroyed.
+class PooledLLVMContext {
+public:
+  PooledLLVMContext(DxcContextPool &Pool)
+      : m_Pool(Pool), m_pContext(Pool.Acquire()), m_Reusable(false) {}
+  ~PooledLLVMContext();
+
+  llvm::LLVMContext &get() { return *m_pContext; }
+  void SetReusable() { m_Reusable = true; }
+
+private:
+  DxcContextPool &m_Pool;
+  std::unique_ptr<llvm::LLVMContext> m_pContext;
+  bool m_Reusable;
+};
+
+} // namespace dxcutil
@@ -28,6 +28,7 @@
 #include "llvm/IR/DebugInfoMetadata.h"
 #include "llvm/Support/FormattedStream.h"
 #include "llvm/Support/Format.h"
+#include "llvm/Support/MemoryBuffer.h"
 #include <assert.h> // Needed for DxilPipelineStateValidation.h
 #include "dxc/DxilContainer/DxilPipelineStateValidation.h"
 #include "dxc/DxilContainer/DxilContainer.h"
@@ -55,7 +56,7 @@ bool SigElementHasStream(const DxilProgramSignatureElement &pSignature) {
 }
 
 void PrintSignature(LPCSTR pName, const DxilProgramSignature *pSignature,
-                           bool bIsInput, raw_string_ostream &OS,
+                           bool bIsInput, raw_ostream &OS,
                            StringRef comment) {
   OS << comment << "\n"
      << comment << " " << pName << " signature:\n"
@@ -269,7 +270,7 @@ void PrintSignature(LPCSTR pName, const DxilProgramSignature *pSignature,
   OS << comment << "\n";
 }
 
-void PintCompMaskNameCompact(raw_string_ostream &OS, unsigned CompMask) {
+void PintCompMaskNameCompact(raw_ostream &OS, unsigned CompMask) {
   char Mask[5];
   memset(Mask, '\0', sizeof(Mask));
   unsigned idx = 0;
@@ -285,7 +286,7 @@ void PintCompMaskNameCompact(raw_string_ostream &OS, unsigned CompMask) {
 }
 
 void PrintDxilSignature(LPCSTR pName, const DxilSignature &Signature,
-                               raw_string_ostream &OS, StringRef comment) {
+                               raw_ostream &OS, StringRef comment) {
   const std::vector<std::unique_ptr<DxilSignatureElement>> &sigElts =
       Signature.GetElements();
   if (sigElts.size() == 0)
@@ -353,7 +354,7 @@ PCSTR g_pFeatureInfoNames[] = {
 static_assert(_countof(g_pFeatureInfoNames) == ShaderFeatureInfoCount, "g_pFeatureInfoNames needs to be updated");
 
 void PrintFeatureInfo(const DxilShaderFeatureInfo *pFeatureInfo,
-                             raw_string_ostream &OS, StringRef comment) {
+                             raw_ostream &OS, StringRef comment) {
   uint64_t featureFlags = pFeatureInfo->FeatureFlags;
   if (!featureFlags)
     return;
@@ -367,7 +368,7 @@ void PrintFeatureInfo(const DxilShaderFeatureInfo *pFeatureInfo,
 }
 
 void PrintResourceFormat(DxilResourceBase &res, unsigned alignment,
-                                raw_string_ostream &OS) {
+                                raw_ostream &OS) {
   switch (res.GetClass()) {
   case DxilResourceBase::Class::CBuffer:
   case DxilResourceBase::Class::Sampler:
@@ -396,7 +397,7 @@ void PrintResourceFormat(DxilResourceBase &res, unsigned alignment,
 }
 
 void PrintResourceDim(DxilResourceBase &res, unsigned alignment,
-                             raw_string_ostream &OS) {
+                             raw_ostream &OS) {
   switch (res.GetClass()) {
   case DxilResourceBase::Class::CBuffer:
   case DxilResourceBase::Class::Sampler:
@@ -438,7 +439,7 @@ void PrintResourceDim(DxilResourceBase &res, unsigned alignment,
   }
 }
 
-void PrintResourceBinding(DxilResourceBase &res, raw_string_ostream &OS,
+void PrintResourceBinding(DxilResourceBase &res, raw_ostream &OS,
                                  StringRef comment) {
   OS << comment << " " << left_justify(res.GetGlobalName(), 31);
 
@@ -464,7 +465,7 @@ void PrintResourceBinding(DxilResourceBase &res, raw_string_ostream &OS,
     OS << right_justify("unbounded", 6) << "\n";
 }
 
-void PrintResourceBindings(DxilModule &M, raw_string_ostream &OS,
+void PrintResourceBindings(DxilModule &M, raw_ostream &OS,
                                   StringRef comment) {
   OS << comment << "\n"
      << comment << " Resource Bindings:\n"
@@ -531,7 +532,7 @@ void PrintInputsContributingToOutputs(
   }
 }
 
-void PrintViewIdState(DxilModule &M, raw_string_ostream &OS,
+void PrintViewIdState(DxilModule &M, raw_ostream &OS,
                              StringRef comment) {
   if (!M.GetModule()->getNamedMetadata("dx.viewIdState"))
     return;
@@ -659,7 +660,7 @@ static const char *HitGroupTypeToString(DXIL::HitGroupType type) {
 }
 
 template <typename _T>
-void PrintFlags(raw_string_ostream &OS, uint32_t Flags) {
+void PrintFlags(raw_ostream &OS, uint32_t Flags) {
   if (!Flags) {
     OS << "0";
     return;
@@ -675,7 +676,7 @@ void PrintFlags(raw_string_ostream &OS, uint32_t Flags) {
 }
 
 void PrintSubobjects(const DxilSubobjects &subobjects,
-                     raw_string_ostream &OS,
+                     raw_ostream &OS,
                      StringRef comment) {
   if (subobjects.GetSubobjects().empty())
     return;
@@ -792,7 +793,7 @@ void PrintSubobjects(const DxilSubobjects &subobjects,
 }
 
 void PrintStructLayout(StructType *ST, DxilTypeSystem &typeSys, const DataLayout *DL,
-                       raw_string_ostream &OS, StringRef comment,
+                       raw_ostream &OS, StringRef comment,
                        StringRef varName, unsigned offset,
                        unsigned indent, unsigned arraySize,
                        unsigned sizeOfStruct = 0);
@@ -832,7 +833,7 @@ void PrintTypeAndName(llvm::Type *Ty, DxilFieldAnnotation &annotation,
 
 void PrintFieldLayout(llvm::Type *Ty, DxilFieldAnnotation &annotation,
                       DxilTypeSystem &typeSys, const DataLayout* DL,
-                      raw_string_ostream &OS,
+                      raw_ostream &OS,
                       StringRef comment, unsigned offset,
                       unsigned indent, unsigned offsetIndent,
                       unsigned sizeToPrint = 0) {
@@ -902,7 +903,7 @@ void PrintFieldLayout(llvm::Type *Ty, DxilFieldAnnotation &annotation,
 
 // null DataLayout => assume constant buffer layout
 void PrintStructLayout(StructType *ST, DxilTypeSystem &typeSys, const DataLayout *DL,
-                       raw_string_ostream &OS, StringRef comment,
+                       raw_ostream &OS, StringRef comment,
                        StringRef varName, unsigned offset,
                        unsigned indent, unsigned offsetIndent,
                        unsigned sizeOfStruct) {
@@ -950,7 +951,7 @@ void PrintStructLayout(StructType *ST, DxilTypeSystem &typeSys, const DataLayout
 void PrintStructBufferDefinition(DxilResource *buf,
                                         DxilTypeSystem &typeSys,
                                         const DataLayout &DL,
-                                        raw_string_ostream &OS,
+                                        raw_ostream &OS,
                                         StringRef comment) {
   const unsigned offsetIndent = 50;
 
@@ -997,7 +998,7 @@ void PrintStructBufferDefinition(DxilResource *buf,
 }
 
 void PrintTBufferDefinition(DxilResource *buf, DxilTypeSystem &typeSys,
-                                   raw_string_ostream &OS, StringRef comment) {
+                                   raw_ostream &OS, StringRef comment) {
   const unsigned offsetIndent = 50;
   llvm::Type *Ty = buf->GetHLSLType()->getPointerElementType();
   // For TextureBuffer<> buf[2], the array size is in Resource binding count
@@ -1023,7 +1024,7 @@ void PrintTBufferDefinition(DxilResource *buf, DxilTypeSystem &typeSys,
 }
 
 void PrintCBufferDefinition(DxilCBuffer *buf, DxilTypeSystem &typeSys,
-                                   raw_string_ostream &OS, StringRef comment) {
+                                   raw_ostream &OS, StringRef comment) {
   const unsigned offsetIndent = 50;
   llvm::Type *Ty = buf->GetHLSLType()->getPointerElementType();
   // For ConstantBuffer<> buf[2], the array size is in Resource binding count
@@ -1049,7 +1050,7 @@ void PrintCBufferDefinition(DxilCBuffer *buf, DxilTypeSystem &typeSys,
   OS << comment << "\n";
 }
 
-void PrintBufferDefinitions(DxilModule &M, raw_string_ostream &OS,
+void PrintBufferDefinitions(DxilModule &M, raw_ostream &OS,
                                    StringRef comment) {
   OS << comment << "\n"
      << comment << " Buffer Definitions:\n"
@@ -1286,7 +1287,7 @@ public:
 
 void PrintPipelineStateValidationRuntimeInfo(const char *pBuffer,
                                                     DXIL::ShaderKind shaderKind,
-                                                    raw_string_ostream &OS,
+                                                    raw_ostream &OS,
                                                     StringRef comment) {
   OS << comment << "\n"
      << comment << " Pipeline Runtime Information: \n"
@@ -1525,7 +1526,8 @@ void PrintPipelineStateValidationRuntimeInfo(const char *pBuffer,
 
 namespace dxcutil {
 
-HRESULT Disassemble(IDxcBlob *pProgram, raw_string_ostream &Stream) {
+HRESULT Disassemble(IDxcBlob *pProgram, raw_ostream &Stream,
+                    ArrayRef<std::string> functionNames) {
   CComPtr<IDxcBlob> pPdbContainerBlob;
   {
     CComPtr<IStream> pStream;
@@ -1600,6 +1602,8 @@ HRESULT Disassemble(IDxcBlob *pProgram, raw_string_ostream &Stream) {
         Stream << format("%.2x", pHashContent->Digest[i]);
       if (pHashContent->Flags & (uint32_t)DxilShaderHashFlags::IncludesSource)
         Stream << " (includes source)";
+      if (pHashContent->Flags & (uint32_t)DxilShaderHashFlags::XXHash64)
+        Stream << " (xxhash64)";
       Stream << "\n";
     }
 
@@ -1662,6 +1666,35 @@ HRESULT Disassemble(IDxcBlob *pProgram, raw_string_ostream &Stream) {
 
   std::string DiagStr;
   llvm::LLVMContext llvmContext;
+  DxcAssemblyAnnotationWriter w;
+
+  // Only read the bodies of the requested functions.
+  if (!functionNames.empty()) {
+    std::unique_ptr<llvm::Module> pModule(dxilutil::LoadModuleFromBitcodeLazy(
+        llvm::MemoryBuffer::getMemBuffer(llvm::StringRef(pIL, pILLength), "",
+                                         false),
+        llvmContext, DiagStr));
+    if (pModule.get() == nullptr) {
+      return DXC_E_IR_VERIFICATION_FAILED;
+    }
+    for (const std::string &name : functionNames) {
+      llvm::Function *F = pModule->getFunction(name);
+      if (F == nullptr) {
+        Stream << "; function not found: " << name << "\n";
+        continue;
+      }
+      if (F->materialize()) {
+        return DXC_E_IR_VERIFICATION_FAILED;
+      }
+      Stream << "\n";
+      F->print(Stream, &w);
+      // Release the body before reading the next one.
+      F->dematerialize();
+    }
+    Stream.flush();
+    return S_OK;
+  }
+
   std::unique_ptr<llvm::Module> pModule(dxilutil::LoadModuleFromBitcode(
     llvm::StringRef(pIL, pILLength), llvmContext, DiagStr));
   if (pModule.get() == nullptr) {
@@ -1718,7 +1751,6 @@ HRESULT Disassemble(IDxcBlob *pProgram, raw_string_ostream &Stream) {
       PrintSubobjects(*dxilModule.GetSubobjects(), Stream, /*comment*/ ";");
     }
   }
-  DxcAssemblyAnnotationWriter w;
   pModule->print(Stream, &w);
   //if (pReflectionModule) {
   //  Stream << "\n========== Reflection Module from STAT part ==========\n";
@@ -21,6 +21,8 @@
 #include "dxc/Support/Unicode.h"
 #include "clang/Frontend/CompilerInstance.h"
 
+#include <unordered_map>
+
 #ifndef _WIN32
 #include <sys/stat.h>
 #include <unistd.h>
@@ -82,32 +84,24 @@ enum class SpecialValue {
   Output = 4
 };
 
-// We use 10 bits for Offset to support MaxIncludedFiles include files,
-// and we use 16 bits for Length to support nearly arbitrary path length.
+// A handle is an index into the table for its kind: included files for File
+// handles, directories for FileDir and SearchDir handles. Handles double as
+// CRT file descriptors, so they must remain positive when taken as an int.
 struct HandleBits {
-  unsigned Offset : 10;
-  unsigned Length : 16;
+  unsigned Index : 26;
   unsigned Kind : 4;
 };
 struct DxcArgsHandle {
   DxcArgsHandle(HANDLE h) : Handle(h) {}
-  DxcArgsHandle(unsigned fileIndex) {
-    Handle = 0;
-    Bits.Offset = fileIndex;
-    Bits.Length = 0;
-    Bits.Kind = (unsigned)HandleKind::File;
-  }
-  DxcArgsHandle(HandleKind HK, unsigned fileIndex, unsigned dirLength) {
+  DxcArgsHandle(HandleKind HK, unsigned index) {
     Handle = 0;
-    Bits.Offset = fileIndex;
-    Bits.Length = dirLength;
+    Bits.Index = index;
     Bits.Kind = (unsigned)HK;
   }
   DxcArgsHandle(SpecialValue V) {
     Handle = 0;
-    Bits.Offset = (unsigned)V;
-    Bits.Length = 0;
-    Bits.Kind = (unsigned)HandleKind::Special;;
+    Bits.Index = (unsigned)V;
+    Bits.Kind = (unsigned)HandleKind::Special;
   }
 
   union {
@@ -128,13 +122,12 @@ struct DxcArgsHandle {
   }
   unsigned GetFileIndex() const {
     DXASSERT_NOMSG(IsFileKind());
-    return Bits.Offset;
+    return Bits.Index;
   }
   SpecialValue GetSpecialValue() const {
     DXASSERT_NOMSG(GetKind() == HandleKind::Special);
-    return (SpecialValue)Bits.Offset;
+    return (SpecialValue)Bits.Index;
   }
-  unsigned Length() const { return Bits.Length; }
 };
 
 static_assert(sizeof(DxcArgsHandle) == sizeof(HANDLE), "else can't transparently typecast");
@@ -144,10 +137,50 @@ const DxcArgsHandle StdOutHandle(SpecialValue::StdOut);
 const DxcArgsHandle StdErrHandle(SpecialValue::StdErr);
 const DxcArgsHandle OutputHandle(SpecialValue::Output);
 
-/// Max number of included files (1:1 to their directories) or search directories.
-/// If programs include more than a handful, DxcArgsFileSystem will need to do better than linear scans.
-/// If this is fired, ERROR_OUT_OF_STRUCTURES will be returned by an attempt to open a file.
-static const size_t MaxIncludedFiles = 1000;
+/// Max number of included files, and separately of known directories, as
+/// limited by the handle encoding. If this is reached, ERROR_OUT_OF_STRUCTURES
+/// will be returned by an attempt to open a file.
+static const size_t MaxIncludedFiles = (1 << 26) - 1;
+
+static bool IsPathSeparator(wchar_t ch) { return ch == L'\\' || ch == L'/'; }
+
+/// Returns a spelling of Path with "." and ".." components and repeated
+/// separators collapsed, used as the identity of an included file so that
+/// "./inc/../a.h" and "./a.h" are the same file. Leading ".." components and
+/// the root (leading separators or a drive designator) are kept.
+static std::wstring GetPathIdentity(const std::wstring &Path) {
+  size_t pos = 0;
+  while (pos < Path.size() && IsPathSeparator(Path[pos]))
+    ++pos;
+  std::wstring root(pos, L'/');
+  std::vector<std::wstring> parts;
+  while (pos < Path.size()) {
+    size_t end = pos;
+    while (end < Path.size() && !IsPathSeparator(Path[end]))
+      ++end;
+    std::wstring part = Path.substr(pos, end - pos);
+    if (part == L"..") {
+      if (!parts.empty() && parts.back() != L"..") {
+        if (parts.back().back() != L':') // Can't go above a drive.
+          parts.pop_back();
+      } else if (root.empty()) {
+        parts.push_back(part);
+      }
+    } else if (part != L".") {
+      parts.push_back(part);
+    }
+    pos = end;
+    while (pos < Path.size() && IsPathSeparator(Path[pos]))
+      ++pos;
+  }
+  std::wstring result = root;
+  for (size_t i = 0; i < parts.size(); ++i) {
+    if (i != 0)
+      result += L'/';
+    result += parts[i];
+  }
+  return result;
+}
 
 bool IsAbsoluteOrCurDirRelativeW(LPCWSTR Path) {
   if (!Path || !Path[0]) return FALSE;
@@ -183,6 +216,94 @@ bool IsAbsoluteOrCurDirRelativeW(LPCWSTR Path) {
   return FALSE;
 }
 
+// Copies the preprocessor directives of Text to Out and blanks out everything
+// else, keeping every newline so that line numbers are unchanged. Comments and
+// string literals are skipped over, so that a '#' inside either does not start
+// a directive; block comments inside a directive are kept whole, as they may
+// span lines without ending it.
+static void MinimizeToDirectives(StringRef Text, std::string &Out) {
+  Out.clear();
+  Out.reserve(Text.size() / 4);
+  const char *p = Text.begin(), *end = Text.end();
+  auto skipBlockComment = [&](bool bCopy) {
+    const char *start = p;
+    p += 2;
+    while (p < end && !(p[0] == '*' && p + 1 < end && p[1] == '/')) {
+      if (!bCopy && *p == '\n')
+        Out += '\n';
+      ++p;
+    }
+    p = p < end ? p + 2 : end;
+    if (bCopy)
+      Out.append(start, p);
+  };
+  auto skipQuoted = [&](char quote) {
+    for (++p; p < end && *p != quote && *p != '\n'; ++p) {
+      if (*p == '\\' && p + 1 < end && p[1] != '\n')
+        ++p;
+    }
+    if (p < end && *p == quote)
+      ++p;
+  };
+
+  bool bAtLineStart = true;
+  while (p < end) {
+    char ch = *p;
+    if (ch == '\n') {
+      Out += '\n';
+      bAtLineStart = true;
+      ++p;
+    } else if (ch == '/' && p + 1 < end && p[1] == '*') {
+      skipBlockComment(/*bCopy*/ false);
+    } else if (ch == '/' && p + 1 < end && p[1] == '/') {
+      // Line comments end at the first newline not escaped by a backslash.
+      while (p < end && *p != '\n') {
+        if (*p == '\\' && p + 1 < end && p[1] == '\n') {
+          Out += '\n';
+          ++p;
+        }
+        ++p;
+      }
+    } else if (ch == '#' && bAtLineStart) {
+      // Copy the directive through its end of line, following line
+      // continuations and keeping quoted text verbatim.
+      while (p < end && *p != '\n') {
+        if (*p == '/' && p + 1 < end && p[1] == '*') {
+          skipBlockComment(/*bCopy*/ true);
+          continue;
+        }
+        if (*p == '/' && p + 1 < end && p[1] == '/')
+          break;
+        if (*p == '"' || *p == '\'') {
+          const char *start = p;
+          skipQuoted(*p);
+          Out.append(start, p);
+          continue;
+        }
+        if (*p == '\\' && p + 1 < end && p[1] == '\n') {
+          Out += "\\\n";
+          p += 2;
+          continue;
+        }
+        if (*p == '\\' && p + 2 < end && p[1] == '\r' && p[2] == '\n') {
+          Out += "\\\n";
+          p += 3;
+          continue;
+        }
+        Out += *p++;
+      }
+      bAtLineStart = false;
+    } else if (ch == '"' || ch == '\'') {
+      skipQuoted(ch);
+      bAtLineStart = false;
+    } else {
+      if (ch != ' ' && ch != '\t' && ch != '\r' && ch != '\f' && ch != '\v')
+        bAtLineStart = false;
+      ++p;
+    }
+  }
+}
+
 }
 
 namespace dxcutil {
@@ -231,8 +352,10 @@ private:
   LPCWSTR m_pOutputStreamName;
   std::wstring m_pAbsOutputStreamName;
   CComPtr<IDxcIncludeHandler> m_includeLoader;
+  CComPtr<IDxcIncludeCache> m_includeCache; // m_includeLoader, if it is a cache
   std::vector<std::wstring> m_searchEntries;
   bool m_bDisplayIncludeProcess;
+  bool m_bDirectivesOnly;
   UINT32 m_DefaultCodePage;
 
   // Some constraints of the current design: opening the same file twice
@@ -245,70 +368,138 @@ private:
       : Blob(pBlob), BlobStream(pStream), Name(name) { }
   };
   llvm::SmallVector<IncludedFile, 4> m_includedFiles;
-
-  static bool IsDirOf(LPCWSTR lpDir, size_t dirLen, const std::wstring &fileName) {
-    if (fileName.size() <= dirLen) return false;
-    if (0 != wcsncmp(lpDir, fileName.data(), dirLen)) return false;
-
-    // Prefix matches, c:\\ to c:\\foo.hlsl or ./bar to ./bar/file.hlsl
-    // Ensure there are no additional characters, don't match ./ba if ./bar.hlsl exists
-    if (lpDir[dirLen - 1] == '\\' || lpDir[dirLen - 1] == '/') {
-      // The file name was already terminated in a separator.
-      return true;
+  // Index into m_includedFiles by name, and by GetPathIdentity of the name.
+  // Names that only differ in spelling share one entry, and so one handle
+  // and file ID, which lets clang recognize an already-included header.
+  std::unordered_map<std::wstring, size_t> m_includedFileIndex;
+  std::unordered_map<std::wstring, size_t> m_includedFileIdentities;
+  // The error for every GetPathIdentity whose load failed. Header search
+  // probes each search directory for every include, and search directories
+  // spelled more than one way probe the same file under several names;
+  // each misses through the include handler once.
+  std::unordered_map<std::wstring, DWORD> m_failedFileIdentities;
+  // Every directory that contains an included file or is, or contains, a
+  // search directory, without trailing separators, mapped to its handle.
+  std::unordered_map<std::wstring, HANDLE> m_dirHandles;
+
+  // Every name passed to the include handler along with its result, so that
+  // callers can fingerprint the inputs of a compilation.
+  std::vector<std::pair<std::wstring, CComPtr<IDxcBlobUtf8>>> m_includeLookups;
+
+  // Strips trailing separators, so that "./dir" and "./dir/" are the same.
+  static std::wstring DirKey(LPCWSTR lpDir, size_t dirLen) {
+    while (dirLen > 0 && IsPathSeparator(lpDir[dirLen - 1]))
+      --dirLen;
+    return std::wstring(lpDir, dirLen);
+  }
+
+  // Records every directory that path is in. If bIncludeSelf, path is itself
+  // a directory and is recorded too.
+  void AddDirsOf(const std::wstring &path, HandleKind kind, bool bIncludeSelf) {
+    size_t end = path.size();
+    if (!bIncludeSelf) {
+      while (end > 0 && !IsPathSeparator(path[end - 1]))
+        --end;
+      if (end == 0)
+        return;
+    }
+    for (;;) {
+      std::wstring key = DirKey(path.data(), end);
+      if (m_dirHandles.count(key) != 0)
+        return; // Its parents have been recorded too.
+      if (m_dirHandles.size() == MaxIncludedFiles)
+        throw hlsl::Exception(HRESULT_FROM_WIN32(ERROR_OUT_OF_STRUCTURES));
+      HANDLE handle = DxcArgsHandle(kind, m_dirHandles.size()).Handle;
+      m_dirHandles.emplace(key, handle);
+      end = key.size();
+      while (end > 0 && !IsPathSeparator(path[end - 1]))
+        --end;
+      if (end == 0)
+        return;
     }
-
-    return fileName.data()[dirLen] == '\\' || fileName.data()[dirLen] == '/';
   }
 
-  static bool IsDirPrefixOrSame(LPCWSTR lpDir, size_t dirLen, const std::wstring &path) {
-    if (0 == wcscmp(lpDir, path.c_str())) return true;
-    return IsDirOf(lpDir, dirLen, path);
+  void AddIncludedFile(IncludedFile &&file) {
+    m_includedFileIndex.emplace(file.Name, m_includedFiles.size());
+    m_includedFileIdentities.emplace(GetPathIdentity(file.Name),
+                                     m_includedFiles.size());
+    AddDirsOf(file.Name, HandleKind::FileDir, /*bIncludeSelf*/ false);
+    m_includedFiles.push_back(std::move(file));
   }
 
   HANDLE TryFindDirHandle(LPCWSTR lpDir) const {
-    size_t dirLen = wcslen(lpDir);
-    for (size_t i = 0; i < m_includedFiles.size(); ++i) {
-      const std::wstring &fileName = m_includedFiles[i].Name;
-      if (IsDirOf(lpDir, dirLen, fileName)) {
-        return DxcArgsHandle(HandleKind::FileDir, i, dirLen).Handle;
-      }
-    }
-    for (size_t i = 0; i < m_searchEntries.size(); ++i) {
-      if (IsDirPrefixOrSame(lpDir, dirLen, m_searchEntries[i])) {
-        return DxcArgsHandle(HandleKind::SearchDir, i, dirLen).Handle;
-      }
+    auto it = m_dirHandles.find(DirKey(lpDir, wcslen(lpDir)));
+    if (it != m_dirHandles.end()) {
+      return it->second;
     }
     return INVALID_HANDLE_VALUE;
   }
   DWORD TryFindOrOpen(LPCWSTR lpFileName, size_t &index) {
-    for (size_t i = 0; i < m_includedFiles.size(); ++i) {
-      if (0 == wcscmp(lpFileName, m_includedFiles[i].Name.data())) {
-        index = i;
-        return ERROR_SUCCESS;
-      }
+    auto it = m_includedFileIndex.find(lpFileName);
+    if (it != m_includedFileIndex.end()) {
+      index = it->second;
+      return ERROR_SUCCESS;
+    }
+    std::wstring fileName(lpFileName);
+    std::wstring identity = GetPathIdentity(fileName);
+    auto identityIt = m_includedFileIdentities.find(identity);
+    if (identityIt != m_includedFileIdentities.end()) {
+      index = identityIt->second;
+      m_includedFileIndex.emplace(std::move(fileName), index);
+      return ERROR_SUCCESS;
     }
+    auto failedIt = m_failedFileIdentities.find(identity);
+    if (failedIt != m_failedFileIdentities.end())
+      return failedIt->second;
 
+    DWORD error = TryOpen(lpFileName, index);
+    if (error != ERROR_SUCCESS && error != ERROR_OUT_OF_STRUCTURES)
+      m_failedFileIdentities.emplace(std::move(identity), error);
+    return error;
+  }
+  DWORD TryOpen(LPCWSTR lpFileName, size_t &index) {
     if (m_includeLoader.p != nullptr) {
       if (m_includedFiles.size() == MaxIncludedFiles) {
         return ERROR_OUT_OF_STRUCTURES;
       }
 
-      CComPtr<::IDxcBlob> fileBlob;
-      HRESULT hr = m_includeLoader->LoadSource(lpFileName, &fileBlob);
-      if (FAILED(hr)) {
-        return ERROR_UNHANDLED_EXCEPTION;
-      }
-      if (fileBlob.p != nullptr) {
-        CComPtr<IDxcBlobUtf8> fileBlobUtf8;
-        if (FAILED(hlsl::DxcGetBlobAsUtf8(fileBlob, DxcGetThreadMallocNoRef(),
+      CComPtr<IDxcBlobUtf8> fileBlobUtf8;
+      if (m_includeCache.p != nullptr) {
+        // The cache returns blobs already converted to UTF-8 and shared with
+        // other compiles.
+        if (FAILED(m_includeCache->LoadSourceUtf8(lpFileName, m_DefaultCodePage,
+                                                  &fileBlobUtf8))) {
+          m_includeLookups.emplace_back(std::wstring(lpFileName), nullptr);
+          return ERROR_UNHANDLED_EXCEPTION;
+        }
+      } else {
+        CComPtr<::IDxcBlob> fileBlob;
+        HRESULT hr = m_includeLoader->LoadSource(lpFileName, &fileBlob);
+        if (FAILED(hr)) {
+          m_includeLookups.emplace_back(std::wstring(lpFileName), nullptr);
+          return ERROR_UNHANDLED_EXCEPTION;
+        }
+        if (fileBlob.p != nullptr &&
+            FAILED(hlsl::DxcGetBlobAsUtf8(fileBlob, DxcGetThreadMallocNoRef(),
                                           &fileBlobUtf8, m_DefaultCodePage))) {
+          m_includeLookups.emplace_back(std::wstring(lpFileName), nullptr);
           return ERROR_UNHANDLED_EXCEPTION;
         }
+      }
+      if (fileBlobUtf8.p != nullptr) {
+        m_includeLookups.emplace_back(std::wstring(lpFileName), fileBlobUtf8);
+        if (m_bDirectivesOnly) {
+          CComPtr<IDxcBlobUtf8> pMinimized;
+          if (FAILED(CreateDirectivesOnlyBlob(fileBlobUtf8, &pMinimized))) {
+            return ERROR_UNHANDLED_EXCEPTION;
+          }
+          fileBlobUtf8 = pMinimized;
+        }
         CComPtr<IStream> fileStream;
         if (FAILED(hlsl::CreateReadOnlyBlobStream(fileBlobUtf8, &fileStream))) {
           return ERROR_UNHANDLED_EXCEPTION;
         }
-        m_includedFiles.emplace_back(std::wstring(lpFileName), fileBlobUtf8, fileStream);
+        AddIncludedFile(IncludedFile(std::wstring(lpFileName), fileBlobUtf8, fileStream));
         index = m_includedFiles.size() - 1;
 
         if (m_bDisplayIncludeProcess) {
@@ -324,11 +515,24 @@ private:
         }
         return ERROR_SUCCESS;
       }
+      m_includeLookups.emplace_back(std::wstring(lpFileName), nullptr);
     }
     return ERROR_NOT_FOUND;
   }
+  static HRESULT CreateDirectivesOnlyBlob(IDxcBlobUtf8 *pBlob,
+                                          IDxcBlobUtf8 **ppResult) {
+    std::string directives;
+    MinimizeToDirectives(
+        StringRef(pBlob->GetStringPointer(), pBlob->GetStringLength()),
+        directives);
+    CComPtr<IDxcBlobEncoding> pEncoding;
+    IFR(DxcCreateBlobWithEncodingOnMallocCopy(
+        DxcGetThreadMallocNoRef(), directives.data(), directives.size(),
+        CP_UTF8, &pEncoding));
+    return DxcGetBlobAsUtf8(pEncoding, DxcGetThreadMallocNoRef(), ppResult);
+  }
   static HANDLE IncludedFileIndexToHandle(size_t index) {
-    return DxcArgsHandle(index).Handle;
+    return DxcArgsHandle(HandleKind::File, index).Handle;
   }
   bool IsKnownHandle(HANDLE h) const {
     return !DxcArgsHandle(h).IsSpecialUnknown();
@@ -344,14 +548,28 @@ public:
                         _In_opt_ IDxcIncludeHandler *pHandler,
                         _In_opt_ UINT32 defaultCodePage)
       : m_pSource(pSource), m_pSourceName(pSourceName), m_pOutputStreamName(nullptr), m_includeLoader(pHandler),
-        m_bDisplayIncludeProcess(false), m_DefaultCodePage(defaultCodePage) {
+        m_bDisplayIncludeProcess(false), m_bDirectivesOnly(false),
+        m_DefaultCodePage(defaultCodePage) {
     MakeAbsoluteOrCurDirRelativeW(m_pSourceName, m_pAbsSourceName);
+    if (pHandler != nullptr)
+      pHandler->QueryInterface(&m_includeCache);
     IFT(CreateReadOnlyBlobStream(m_pSource, &m_pSourceStream));
-    m_includedFiles.push_back(IncludedFile(std::wstring(m_pSourceName), m_pSource, m_pSourceStream));
+    AddIncludedFile(IncludedFile(std::wstring(m_pSourceName), m_pSource, m_pSourceStream));
   }
   void EnableDisplayIncludeProcess() override {
     m_bDisplayIncludeProcess = true;
   }
+  void EnableDirectivesOnly() override {
+    m_bDirectivesOnly = true;
+    // Files opened from here on are minimized as they are loaded.
+    for (IncludedFile &file : m_includedFiles) {
+      CComPtr<IDxcBlobUtf8> pMinimized;
+      IFT(CreateDirectivesOnlyBlob(file.Blob, &pMinimized));
+      file.Blob = pMinimized;
+      file.BlobStream.Release();
+      IFT(CreateReadOnlyBlobStream(file.Blob, &file.BlobStream));
+    }
+  }
   void WriteStdErrToStream(raw_string_ostream &s) override {
     s.write((char*)m_pStdErrStream->GetPtr(), m_pStdErrStream->GetPtrSize());
     s.flush();
@@ -397,9 +615,6 @@ public:
     // are fully-qualified or relative to the current directory.
     const std::vector<clang::HeaderSearchOptions::Entry> &entries =
       compiler.getHeaderSearchOpts().UserEntries;
-    if (entries.size() > MaxIncludedFiles) {
-      throw hlsl::Exception(HRESULT_FROM_WIN32(ERROR_OUT_OF_STRUCTURES));
-    }
     for (unsigned i = 0, e = entries.size(); i != e; ++i) {
       const clang::HeaderSearchOptions::Entry &E = entries[i];
       if (dxcutil::IsAbsoluteOrCurDirRelative(E.Path.c_str())) {
@@ -410,6 +625,7 @@ public:
         ws += Unicode::UTF8ToWideStringOrThrow(E.Path.c_str());
         m_searchEntries.emplace_back(std::move(ws));
       }
+      AddDirsOf(m_searchEntries.back(), HandleKind::SearchDir, /*bIncludeSelf*/ true);
     }
   }
 
@@ -427,6 +643,12 @@ public:
     return S_OK;
   }
 
+  void EnumerateIncludeLookups(
+      const std::function<void(LPCWSTR, IDxcBlobUtf8 *)> &Fn) override {
+    for (const auto &lookup : m_includeLookups)
+      Fn(lookup.first.c_str(), lookup.second);
+  }
+
   ~DxcArgsFileSystemImpl() override { };
   BOOL FindNextFileW(
     _In_   HANDLE hFindFile,
@@ -0,0 +1,254 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// dxcincludecache.cpp                                                       //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Include handler that shares loaded files between compiles.               //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#include "dxc/Support/WinIncludes.h"
+#include "dxc/Support/Global.h"
+#include "dxc/Support/FileIOHelper.h"
+#include "dxc/Support/Unicode.h"
+#include "dxc/Support/microcom.h"
+#include "llvm/ADT/SmallVector.h"
+
+#include "dxcincludecache.h"
+
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#ifndef _WIN32
+#include <sys/stat.h>
+#endif
+
+using namespace hlsl;
+
+namespace {
+
+// Identifies a version of a file on disk.
+struct FileStamp {
+  bool Exists = false;
+  UINT64 Size = 0;
+  UINT64 WriteTime = 0;
+  bool operator==(const FileStamp &Other) const {
+    return Exists == Other.Exists && Size == Other.Size &&
+           WriteTime == Other.WriteTime;
+  }
+};
+
+static FileStamp GetFileStamp(LPCWSTR pFileName) {
+  FileStamp stamp;
+#ifdef _WIN32
+  WIN32_FILE_ATTRIBUTE_DATA data;
+  if (GetFileAttributesExW(pFileName, GetFileExInfoStandard, &data)) {
+    stamp.Exists = true;
+    stamp.Size = ((UINT64)data.nFileSizeHigh << 32) | data.nFileSizeLow;
+    stamp.WriteTime = ((UINT64)data.ftLastWriteTime.dwHighDateTime << 32) |
+                      data.ftLastWriteTime.dwLowDateTime;
+  }
+#else
+  std::string utf8Name;
+  struct stat fileStat;
+  if (Unicode::WideToUTF8String(pFileName, &utf8Name) &&
+      stat(utf8Name.c_str(), &fileStat) == 0) {
+    stamp.Exists = true;
+    stamp.Size = fileStat.st_size;
+    // Nanosecond resolution, so that two edits within one second that keep
+    // the size still change the stamp.
+#ifdef __APPLE__
+    const struct timespec &mtime = fileStat.st_mtimespec;
+#else
+    const struct timespec &mtime = fileStat.st_mtim;
+#endif
+    stamp.WriteTime = (UINT64)mtime.tv_sec * 1000000000ull + mtime.tv_nsec;
+  }
+#endif
+  return stamp;
+}
+
+class DxcIncludeCache : public IDxcIncludeCache {
+private:
+  DXC_MICROCOM_TM_REF_FIELDS()
+  CComPtr<IDxcIncludeHandler> m_pInner;
+  bool m_bFromDisk = false;
+
+  struct LoadedFile {
+    HRESULT hr = E_FAIL;
+    CComPtr<IDxcBlobEncoding> pBlob; // Private copy, null if not found.
+    FileStamp Stamp;                 // Only used for files loaded from disk.
+    // UTF-8 conversions of pBlob, keyed on the code page used to convert.
+    llvm::SmallVector<std::pair<UINT32, CComPtr<IDxcBlobUtf8>>, 1> Utf8;
+  };
+  std::mutex m_Mutex;
+  std::unordered_map<std::wstring, LoadedFile> m_Files;
+  UINT64 m_Hits = 0;
+  UINT64 m_Misses = 0;
+
+  // Copies the inner handler's blob, so that the cached copy does not depend
+  // on the thread safety of a caller-provided blob implementation.
+  HRESULT CopyBlob(IDxcBlob *pBlob, IDxcBlobEncoding **ppCopy) {
+    BOOL known = FALSE;
+    UINT32 codePage = 0;
+    CComPtr<IDxcBlobEncoding> pEncoding;
+    if (SUCCEEDED(pBlob->QueryInterface(&pEncoding)))
+      IFR(pEncoding->GetEncoding(&known, &codePage));
+    return DxcCreateBlob(pBlob->GetBufferPointer(), pBlob->GetBufferSize(),
+                         /*bPinned*/ false, /*bCopy*/ true, known != FALSE,
+                         codePage, m_pMalloc, ppCopy);
+  }
+
+  // Returns the cached entry for pFilename, loading it if it is missing or
+  // its file changed on disk. Must be called with m_Mutex held.
+  LoadedFile &FindOrLoad(LPCWSTR pFilename) {
+    FileStamp stamp;
+    if (m_bFromDisk)
+      stamp = GetFileStamp(pFilename);
+
+    auto it = m_Files.find(pFilename);
+    if (it != m_Files.end() && (!m_bFromDisk || it->second.Stamp == stamp)) {
+      ++m_Hits;
+      return it->second;
+    }
+
+    ++m_Misses;
+    LoadedFile file;
+    if (m_bFromDisk) {
+      file.Stamp = stamp;
+      if (stamp.Exists)
+        file.hr = DxcCreateBlobFromFile(m_pMalloc, pFilename, nullptr,
+                                        &file.pBlob);
+    } else if (m_pInner) {
+      CComPtr<IDxcBlob> pBlob;
+      file.hr = m_pInner->LoadSource(pFilename, &pBlob);
+      if (SUCCEEDED(file.hr) && pBlob)
+        IFT(CopyBlob(pBlob, &file.pBlob));
+    }
+    if (it != m_Files.end()) {
+      it->second = std::move(file);
+      return it->second;
+    }
+    return m_Files.insert(std::make_pair(std::wstring(pFilename),
+                                         std::move(file))).first->second;
+  }
+
+public:
+  DXC_MICROCOM_TM_ADDREF_RELEASE_IMPL()
+  DXC_MICROCOM_TM_CTOR(DxcIncludeCache)
+
+  void Initialize(IDxcIncludeHandler *pInner, bool bFromDisk) {
+    m_pInner = pInner;
+    m_bFromDisk = bFromDisk;
+  }
+
+  HRESULT STDMETHODCALLTYPE QueryInterface(REFIID iid, void **ppvObject) override {
+    return DoBasicQueryInterface<IDxcIncludeCache, IDxcIncludeHandler>(
+        this, iid, ppvObject);
+  }
+
+  HRESULT STDMETHODCALLTYPE LoadSource(
+    _In_ LPCWSTR pFilename,                                   // Candidate filename.
+    _COM_Outptr_result_maybenull_ IDxcBlob **ppIncludeSource  // Resultant source object for included file, nullptr if not found.
+    ) override {
+    if (pFilename == nullptr || ppIncludeSource == nullptr)
+      return E_INVALIDARG;
+    *ppIncludeSource = nullptr;
+    DxcThreadMalloc TM(m_pMalloc);
+    try {
+      std::lock_guard<std::mutex> lock(m_Mutex);
+      LoadedFile &file = FindOrLoad(pFilename);
+      if (file.pBlob)
+        IFR(file.pBlob.QueryInterface(ppIncludeSource));
+      return file.hr;
+    }
+    CATCH_CPP_RETURN_HRESULT();
+  }
+
+  HRESULT STDMETHODCALLTYPE LoadSourceUtf8(
+    _In_z_ LPCWSTR pFilename, _In_ UINT32 codePage,
+    _COM_Outptr_result_maybenull_ IDxcBlobUtf8 **ppIncludeSource) override {
+    if (pFilename == nullptr || ppIncludeSource == nullptr)
+      return E_INVALIDARG;
+    *ppIncludeSource = nullptr;
+    DxcThreadMalloc TM(m_pMalloc);
+    try {
+      std::lock_guard<std::mutex> lock(m_Mutex);
+      LoadedFile &file = FindOrLoad(pFilename);
+      if (!file.pBlob)
+        return file.hr;
+      for (auto &converted : file.Utf8) {
+        if (converted.first == codePage)
+          return converted.second.QueryInterface(ppIncludeSource);
+      }
+      CComPtr<IDxcBlobUtf8> pUtf8;
+      IFR(DxcGetBlobAsUtf8(file.pBlob, m_pMalloc, &pUtf8, codePage));
+      file.Utf8.emplace_back(codePage, pUtf8);
+      *ppIncludeSource = pUtf8.Detach();
+      return file.hr;
+    }
+    CATCH_CPP_RETURN_HRESULT();
+  }
+
+  HRESULT STDMETHODCALLTYPE Invalidate(_In_opt_z_ LPCWSTR pFilename) override {
+    DxcThreadMalloc TM(m_pMalloc);
+    try {
+      std::lock_guard<std::mutex> lock(m_Mutex);
+      if (pFilename == nullptr)
+        m_Files.clear();
+      else
+        m_Files.erase(pFilename);
+      return S_OK;
+    }
+    CATCH_CPP_RETURN_HRESULT();
+  }
+
+  HRESULT STDMETHODCALLTYPE GetCacheStatistics(_Out_ UINT64 *pHits,
+                                               _Out_ UINT64 *pMisses) override {
+    if (pHits == nullptr || pMisses == nullptr)
+      return E_INVALIDARG;
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    *pHits = m_Hits;
+    *pMisses = m_Misses;
+    return S_OK;
+  }
+};
+
+HRESULT CreateDxcIncludeCache(IMalloc *pMalloc, IDxcIncludeHandler *pInner,
+                              bool bFromDisk, IDxcIncludeCache **ppCache) {
+  if (ppCache == nullptr)
+    return E_POINTER;
+  *ppCache = nullptr;
+  CComPtr<DxcIncludeCache> pCache = DxcIncludeCache::Alloc(pMalloc);
+  IFROOM(pCache.p);
+  pCache->Initialize(pInner, bFromDisk);
+  *ppCache = pCache.Detach();
+  return S_OK;
+}
+
+} // namespace
+
+namespace dxcutil {
+
+HRESULT CreateSharedIncludeHandler(IMalloc *pMalloc,
+                                   IDxcIncludeHandler *pInner,
+                                   IDxcIncludeHandler **ppHandler) {
+  if (ppHandler == nullptr)
+    return E_POINTER;
+  *ppHandler = nullptr;
+  CComPtr<IDxcIncludeCache> pCache;
+  IFR(CreateDxcIncludeCache(pMalloc, pInner, /*bFromDisk*/ false, &pCache));
+  *ppHandler = pCache.Detach();
+  return S_OK;
+}
+
+HRESULT CreateIncludeCache(IMalloc *pMalloc, IDxcIncludeHandler *pInner,
+                           IDxcIncludeCache **ppCache) {
+  return CreateDxcIncludeCache(pMalloc, pInner, /*bFromDisk*/ pInner == nullptr,
+                               ppCache);
+}
+
+} // namespace dxcutil
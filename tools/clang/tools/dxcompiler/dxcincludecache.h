@@ -0,0 +1,33 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// dxcincludecache.h                                                         //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Include handler that shares loaded files between compiles.               //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "dxc/dxcapi.h"
+
+namespace dxcutil {
+
+/// Creates an include handler that forwards each distinct file name to
+/// pInner once and serves later requests for it from memory, including
+/// failed lookups. The returned handler may be used from several threads at
+/// once; pInner is only ever called while holding a lock.
+HRESULT CreateSharedIncludeHandler(_In_ IMalloc *pMalloc,
+                                   _In_opt_ IDxcIncludeHandler *pInner,
+                                   _COM_Outptr_ IDxcIncludeHandler **ppHandler);
+
+/// Creates the include cache returned by IDxcUtils2::CreateIncludeCache. This
+/// is the same handler as above, except that a null pInner loads files from
+/// disk and revalidates them against their size and last write time.
+HRESULT CreateIncludeCache(_In_ IMalloc *pMalloc,
+                           _In_opt_ IDxcIncludeHandler *pInner,
+                           _COM_Outptr_ IDxcIncludeCache **ppCache);
+
+} // namespace dxcutil
@@ -0,0 +1,494 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// dxcincrementallib.cpp                                                     //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Incremental optimization of library targets for -Qlib-incremental.        //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#include "dxc/Support/WinIncludes.h"
+#include "dxc/Support/Global.h"
+#include "dxc/DXIL/DxilConstants.h"
+#include "dxc/DXIL/DxilModule.h"
+#include "dxc/DXIL/DxilSubobject.h"
+#include "dxc/DXIL/DxilUtil.h"
+#include "dxc/HLSL/DxilExportMap.h"
+#include "dxc/HLSL/DxilLinker.h"
+#include "dxc/HLSL/HLModule.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SetVector.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/Bitcode/ReaderWriter.h"
+#include "llvm/IR/AssemblyAnnotationWriter.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/DiagnosticInfo.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/FormattedStream.h"
+#include "llvm/Support/TimeProfiler.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Transforms/Utils/Cloning.h"
+#include <algorithm>
+#include <set>
+#include <vector>
+
+#include "dxccompilercache.h"
+#include "dxcincrementallib.h"
+
+using namespace llvm;
+using namespace hlsl;
+
+namespace {
+
+// Records where each function starts in the printed module.
+class FunctionOffsetWriter : public AssemblyAnnotationWriter {
+public:
+  std::vector<std::pair<const Function *, uint64_t>> Offsets;
+
+  void emitFunctionAnnot(const Function *F,
+                         formatted_raw_ostream &OS) override {
+    Offsets.emplace_back(F, OS.tell());
+  }
+};
+
+// The module printed once, split into the text of each function and the
+// text of everything else.
+struct ModuleText {
+  std::string Text;
+  DenseMap<const Function *, StringRef> Functions;
+  std::string GlobalsHash;
+};
+
+// Records whether a warning or an error was diagnosed while it is alive,
+// instead of reporting it.
+class DiagnosticFlagScope {
+public:
+  DiagnosticFlagScope(LLVMContext &Ctx)
+      : m_Ctx(Ctx), m_OldHandler(Ctx.getDiagnosticHandler()),
+        m_OldContext(Ctx.getDiagnosticContext()) {
+    Ctx.setDiagnosticHandler(&Handler, this);
+  }
+  ~DiagnosticFlagScope() {
+    m_Ctx.setDiagnosticHandler(m_OldHandler, m_OldContext);
+  }
+
+  bool Diagnosed = false;
+
+private:
+  static void Handler(const DiagnosticInfo &DI, void *Context) {
+    if (DI.getSeverity() == DS_Error || DI.getSeverity() == DS_Warning)
+      ((DiagnosticFlagScope *)Context)->Diagnosed = true;
+  }
+
+  LLVMContext &m_Ctx;
+  LLVMContext::DiagnosticHandlerTy m_OldHandler;
+  void *m_OldContext;
+};
+
+// A shader entry or export, with the functions it reaches.
+struct Partition {
+  const Function *Root = nullptr;
+  SetVector<const Function *> Definitions; // Starting with Root.
+  SmallPtrSet<const Function *, 16> Declarations;
+  SmallPtrSet<const GlobalVariable *, 16> Globals;
+  std::string Key;
+  std::string Bitcode;
+};
+
+} // namespace
+
+static void PrintModuleText(const Module &M, ModuleText &MT) {
+  FunctionOffsetWriter Writer;
+  {
+    raw_string_ostream OS(MT.Text);
+    M.print(OS, &Writer);
+  }
+
+  // Functions are printed one after the other, so each one runs up to the
+  // next; the last one ends with its closing brace or declaration line.
+  StringRef Text = MT.Text;
+  size_t FunctionsBegin = Text.size(), FunctionsEnd = Text.size();
+  for (size_t i = 0; i < Writer.Offsets.size(); ++i) {
+    const Function *F = Writer.Offsets[i].first;
+    size_t Begin = Writer.Offsets[i].second;
+    size_t End;
+    if (i + 1 < Writer.Offsets.size()) {
+      End = Writer.Offsets[i + 1].second;
+    } else if (F->isDeclaration()) {
+      End = Text.find('\n', Text.find("declare ", Begin));
+      End = End == StringRef::npos ? Text.size() : End + 1;
+    } else {
+      End = Text.find("\n}\n", Begin);
+      End = End == StringRef::npos ? Text.size() : End + 3;
+    }
+    if (i == 0)
+      FunctionsBegin = Begin;
+    FunctionsEnd = End;
+    MT.Functions[F] = Text.slice(Begin, End);
+  }
+
+  std::string Globals = Text.substr(0, FunctionsBegin).str();
+  Globals += Text.substr(FunctionsEnd);
+  MT.GlobalsHash = dxcutil::DxcCompileCache::HashString(Globals);
+}
+
+// The part of a function's text that its callers depend on.
+static StringRef GetDeclarationText(const Function *F, StringRef Text) {
+  if (F->isDeclaration())
+    return Text;
+  size_t BodyBegin = Text.find(" {\n");
+  return BodyBegin == StringRef::npos ? Text : Text.substr(0, BodyBegin);
+}
+
+// Adds the functions and global variables that F refers to, directly or
+// through constant expressions.
+static void CollectReferences(const Function &F,
+                              SmallVectorImpl<const Function *> &Functions,
+                              SmallPtrSetImpl<const GlobalVariable *> &Globals) {
+  SmallVector<const Constant *, 16> Worklist;
+  SmallPtrSet<const Constant *, 16> Visited;
+  for (const BasicBlock &BB : F)
+    for (const Instruction &I : BB)
+      for (const Value *Op : I.operands())
+        if (const Constant *C = dyn_cast<Constant>(Op))
+          if (Visited.insert(C).second)
+            Worklist.push_back(C);
+
+  while (!Worklist.empty()) {
+    const Constant *C = Worklist.pop_back_val();
+    if (const Function *Callee = dyn_cast<Function>(C)) {
+      Functions.push_back(Callee);
+    } else if (const GlobalVariable *GV = dyn_cast<GlobalVariable>(C)) {
+      Globals.insert(GV);
+    } else if (!isa<GlobalValue>(C)) {
+      for (const Value *Op : C->operands())
+        if (const Constant *OpC = dyn_cast<Constant>(Op))
+          if (Visited.insert(OpC).second)
+            Worklist.push_back(OpC);
+    }
+  }
+}
+
+// Statics and groupshared variables would no longer be shared if the
+// functions using them go to different partitions.
+static bool IsSharedState(const GlobalVariable *GV) {
+  return !GV->isConstant() &&
+         (GV->hasLocalLinkage() ||
+          GV->getType()->getPointerAddressSpace() == DXIL::kTGSMAddrSpace);
+}
+
+// HLModule keeps the function properties in an unordered map, so put
+// dx.fnprops in module order to print the same text on every compile.
+static void SortFunctionProps(Module &M) {
+  NamedMDNode *FnProps = M.getNamedMetadata("dx.fnprops");
+  if (!FnProps)
+    return;
+  DenseMap<const Function *, unsigned> Order;
+  unsigned Index = 0;
+  for (Function &F : M)
+    Order[&F] = Index++;
+  std::vector<std::pair<unsigned, MDNode *>> Props;
+  for (MDNode *Op : FnProps->operands()) {
+    Index = UINT_MAX;
+    if (Op->getNumOperands())
+      if (auto *VAM = dyn_cast_or_null<ValueAsMetadata>(Op->getOperand(0)))
+        if (auto *F = dyn_cast<Function>(VAM->getValue()))
+          Index = Order.lookup(F);
+    Props.emplace_back(Index, Op);
+  }
+  std::stable_sort(Props.begin(), Props.end(),
+                   [](const std::pair<unsigned, MDNode *> &A,
+                      const std::pair<unsigned, MDNode *> &B) {
+                     return A.first < B.first;
+                   });
+  FnProps->dropAllReferences();
+  for (auto &Prop : Props)
+    FnProps->addOperand(Prop.second);
+}
+
+static void RemoveNewNamedMetadata(Module &M,
+                                   const std::set<std::string> &OldNames) {
+  SmallVector<NamedMDNode *, 16> NewNodes;
+  for (NamedMDNode &NMD : M.named_metadata())
+    if (!OldNames.count(NMD.getName()))
+      NewNodes.push_back(&NMD);
+  for (NamedMDNode *NMD : NewNodes)
+    M.eraseNamedMetadata(NMD);
+}
+
+// The linker appends the named metadata of every partition, such as
+// llvm.ident, so each copy of an operand past the first is dropped.
+static void RemoveDuplicateNamedMetadataOperands(Module &M) {
+  for (NamedMDNode &NMD : M.named_metadata()) {
+    SetVector<MDNode *> Operands;
+    for (MDNode *Op : NMD.operands())
+      Operands.insert(Op);
+    if (Operands.size() == NMD.getNumOperands())
+      continue;
+    NMD.dropAllReferences();
+    for (MDNode *Op : Operands)
+      NMD.addOperand(Op);
+  }
+}
+
+// The linker adds the functions in the order of the partitions and marks all
+// of them to be inlined. Put the definitions back in the order of M, followed
+// by the declarations, and only keep the attribute where M has it, as in a
+// normal compile.
+static void RestoreFunctionOrderAndInlining(const Module &M, Module &Linked) {
+  Module::FunctionListType &Functions = Linked.getFunctionList();
+  for (const Function &F : M) {
+    Function *LinkedF = Linked.getFunction(F.getName());
+    if (!LinkedF || LinkedF->isDeclaration())
+      continue;
+    if (!F.hasFnAttribute(Attribute::AlwaysInline))
+      LinkedF->removeFnAttr(Attribute::AlwaysInline);
+    Functions.splice(Functions.end(), Functions, LinkedF);
+  }
+  SmallVector<Function *, 16> Declarations;
+  for (Function &F : Linked)
+    if (F.isDeclaration())
+      Declarations.push_back(&F);
+  for (Function *F : Declarations)
+    Functions.splice(Functions.end(), Functions, F);
+}
+
+// Optimizes a copy of Base that only has the definitions of P, and writes
+// the result to P.Bitcode. Fails if the backend diagnosed anything.
+static bool OptimizePartition(
+    const Module &Base, Partition &P, const std::set<std::string> &OldNames,
+    const std::function<void(Module *, bool)> &EmitBackend) {
+  ValueToValueMapTy VMap;
+  std::unique_ptr<Module> Part(
+      CloneModule(&Base, VMap, [&](const Function *F) {
+        return P.Definitions.count(F) != 0;
+      }));
+
+  // Load the high-level module back from the metadata, then drop the
+  // metadata so that the partition looks like a module straight out of
+  // CodeGen. Erasing what the partition does not use also erases its
+  // function properties and annotations.
+  Part->GetOrCreateHLModule();
+  RemoveNewNamedMetadata(*Part, OldNames);
+  for (Module::iterator it = Part->begin(); it != Part->end();) {
+    Function *F = it++;
+    if (F->isDeclaration() && F->use_empty())
+      F->eraseFromParent();
+  }
+
+  DiagnosticFlagScope DiagFlag(Part->getContext());
+  EmitBackend(Part.get(), /*Report*/ false);
+  if (DiagFlag.Diagnosed)
+    return false;
+
+  raw_string_ostream OS(P.Bitcode);
+  WriteBitcodeToFile(Part.get(), OS, true);
+  OS.flush();
+  return true;
+}
+
+namespace dxcutil {
+
+bool DxcLibPartitionCache::Lookup(StringRef Key, std::string &Bitcode) {
+  std::lock_guard<std::mutex> lock(m_Mutex);
+  auto it = m_Entries.find(Key);
+  if (it == m_Entries.end())
+    return false;
+  Bitcode = it->second;
+  return true;
+}
+
+void DxcLibPartitionCache::Store(StringRef Key, std::string &&Bitcode) {
+  std::lock_guard<std::mutex> lock(m_Mutex);
+  if (Bitcode.size() > kMaxBytes)
+    return;
+  auto inserted = m_Entries.insert(std::make_pair(Key.str(), std::string()));
+  if (!inserted.second)
+    return;
+  m_Bytes += Bitcode.size();
+  inserted.first->second = std::move(Bitcode);
+  m_Order.push_back(Key.str());
+  while (m_Bytes > kMaxBytes) {
+    auto oldest = m_Entries.find(m_Order.front());
+    m_Bytes -= oldest->second.size();
+    m_Entries.erase(oldest);
+    m_Order.pop_front();
+  }
+}
+
+std::unique_ptr<Module> DxcIncrementalLibRunner::Run(
+    Module *M, const std::function<void(Module *, bool)> &EmitBackend) {
+  if (std::unique_ptr<Module> Linked = RunPartitions(M, EmitBackend))
+    return Linked;
+  EmitBackend(M, /*Report*/ true);
+  return nullptr;
+}
+
+std::unique_ptr<Module> DxcIncrementalLibRunner::RunPartitions(
+    Module *M, const std::function<void(Module *, bool)> &EmitBackend) {
+  if (!M->HasHLModule() || M->getNamedMetadata("llvm.dbg.cu") ||
+      M->getGlobalVariable("llvm.global_ctors"))
+    return nullptr;
+  HLModule &HLM = M->GetHLModule();
+  if (!HLM.GetLLVMUsed().empty())
+    return nullptr;
+
+  std::vector<std::string> RootNames;
+  for (Function &F : *M) {
+    if (F.isDeclaration() || F.hasLocalLinkage())
+      continue;
+    if (HLM.HasDxilFunctionProps(&F) &&
+        (HLM.GetDxilFunctionProps(&F).IsHS() || !F.use_empty()))
+      return nullptr;
+    RootNames.push_back(F.getName());
+  }
+  if (RootNames.size() < 2)
+    return nullptr;
+
+  // Copies of M only get what is in its metadata, so emit the high-level
+  // metadata for the copy and remove it from M again.
+  std::set<std::string> OldNames;
+  for (NamedMDNode &NMD : M->named_metadata())
+    OldNames.insert(NMD.getName());
+  HLM.EmitHLMetadata();
+  std::unique_ptr<Module> Base(CloneModule(M));
+  RemoveNewNamedMetadata(*M, OldNames);
+
+  SortFunctionProps(*Base);
+  ModuleText MT;
+  PrintModuleText(*Base, MT);
+
+  SmallPtrSet<const Function *, 32> Roots;
+  for (const std::string &Name : RootNames)
+    Roots.insert(Base->getFunction(Name));
+
+  std::vector<Partition> Partitions(RootNames.size());
+  DenseMap<const GlobalVariable *, const Function *> SharedStateUsers;
+  for (size_t i = 0; i < RootNames.size(); ++i) {
+    Partition &P = Partitions[i];
+    P.Root = Base->getFunction(RootNames[i]);
+    SmallVector<const Function *, 16> Worklist(1, P.Root);
+    while (!Worklist.empty()) {
+      const Function *F = Worklist.pop_back_val();
+      if (!P.Definitions.insert(F))
+        continue;
+      SmallVector<const Function *, 16> Callees;
+      CollectReferences(*F, Callees, P.Globals);
+      for (const Function *Callee : Callees) {
+        if (Callee->isDeclaration() || Roots.count(Callee))
+          P.Declarations.insert(Callee);
+        else
+          Worklist.push_back(Callee);
+      }
+    }
+
+    for (const GlobalVariable *GV : P.Globals) {
+      if (!IsSharedState(GV))
+        continue;
+      const Function *&User = SharedStateUsers[GV];
+      if (User && User != P.Root)
+        return nullptr;
+      User = P.Root;
+    }
+
+    std::vector<std::string> Hashes;
+    for (const Function *F : P.Definitions)
+      Hashes.push_back(DxcCompileCache::HashString(MT.Functions[F]));
+    for (const Function *F : P.Declarations)
+      Hashes.push_back(DxcCompileCache::HashString(
+          GetDeclarationText(F, MT.Functions[F])));
+    std::sort(Hashes.begin(), Hashes.end());
+
+    std::string KeyData;
+    raw_string_ostream K(KeyData);
+    K << m_Fingerprint << '\0' << MT.GlobalsHash << '\0' << P.Root->getName()
+      << '\0';
+    for (const std::string &Hash : Hashes)
+      K << Hash << '\0';
+    K.flush();
+    P.Key = DxcCompileCache::HashString(KeyData);
+  }
+
+  // Each partition shows up in the time trace as reused or optimized.
+  for (Partition &P : Partitions) {
+    if (m_Cache.Lookup(P.Key, P.Bitcode)) {
+      llvm::TimeTraceScope TimeScope("Reuse partition", P.Root->getName());
+      continue;
+    }
+    llvm::TimeTraceScope TimeScope("Optimize partition", P.Root->getName());
+    if (!OptimizePartition(*Base, P, OldNames, EmitBackend))
+      return nullptr;
+    std::string Bitcode = P.Bitcode;
+    m_Cache.Store(P.Key, std::move(Bitcode));
+  }
+
+  llvm::TimeTraceScope TimeScope("Link partitions");
+  LLVMContext &Ctx = M->getContext();
+  DiagnosticFlagScope DiagFlag(Ctx);
+  std::unique_ptr<DxilLinker> Linker(
+      DxilLinker::CreateLinker(Ctx, m_ValMajor, m_ValMinor));
+
+  // The options the backend recorded in the DxilModule are the same for
+  // every partition; only the subobjects of the first one are kept, as each
+  // partition has all of them.
+  std::unique_ptr<DxilSubobjects> Subobjects;
+  std::string DataLayout;
+  bool DisableOptimization = false, AllResourcesBound = false;
+  bool ResMayAlias = false, ForceZeroStoreLifetimes = false;
+  bool LegacyResourceReservation = false;
+  uint32_t AutoBindingSpace = UINT_MAX;
+  for (size_t i = 0; i < Partitions.size(); ++i) {
+    std::string DiagStr;
+    std::unique_ptr<Module> PartM =
+        dxilutil::LoadModuleFromBitcode(Partitions[i].Bitcode, Ctx, DiagStr);
+    if (!PartM)
+      return nullptr;
+    if (i == 0) {
+      DxilModule &DM = PartM->GetOrCreateDxilModule();
+      Subobjects.reset(DM.ReleaseSubobjects());
+      DataLayout = PartM->getDataLayoutStr();
+      DisableOptimization = DM.GetDisableOptimization();
+      AllResourcesBound = DM.GetAllResourcesBound();
+      ResMayAlias = DM.GetResMayAlias();
+      ForceZeroStoreLifetimes = DM.GetForceZeroStoreLifetimes();
+      LegacyResourceReservation = DM.GetLegacyResourceReservation();
+      AutoBindingSpace = DM.GetAutoBindingSpace();
+    }
+    StringRef Name = RootNames[i];
+    if (!Linker->RegisterLib(Name, std::move(PartM), nullptr) ||
+        !Linker->AttachLib(Name))
+      return nullptr;
+  }
+
+  dxilutil::ExportMap Exports;
+  std::unique_ptr<Module> Linked = Linker->Link("", m_Profile, Exports);
+  if (!Linked || DiagFlag.Diagnosed)
+    return nullptr;
+
+  Linked->setModuleIdentifier(M->getModuleIdentifier());
+  Linked->setDataLayout(DataLayout);
+  RemoveDuplicateNamedMetadataOperands(*Linked);
+  RestoreFunctionOrderAndInlining(*M, *Linked);
+  DxilModule &DM = Linked->GetOrCreateDxilModule();
+  DM.SetDisableOptimization(DisableOptimization);
+  DM.SetAllResourcesBound(AllResourcesBound);
+  DM.SetResMayAlias(ResMayAlias);
+  DM.SetForceZeroStoreLifetimes(ForceZeroStoreLifetimes);
+  DM.SetLegacyResourceReservation(LegacyResourceReservation);
+  DM.SetAutoBindingSpace(AutoBindingSpace);
+  if (Subobjects)
+    DM.ResetSubobjects(Subobjects.release());
+  // The linker collected the flags with its own options; collect them again
+  // with the options of the partitions.
+  DM.m_ShaderFlags = ShaderFlags();
+  DM.CollectShaderFlagsForModule();
+  DxilModule::ClearDxilMetadata(*Linked);
+  DM.EmitDxilMetadata();
+  return Linked;
+}
+
+} // namespace dxcutil
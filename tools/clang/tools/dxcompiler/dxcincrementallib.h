@@ -0,0 +1,91 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// dxcincrementallib.h                                                       //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Incremental optimization of library targets for -Qlib-incremental.        //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "clang/Frontend/CodeGenOptions.h"
+#include "llvm/ADT/StringRef.h"
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+namespace dxcutil {
+
+/// Optimized partitions of libraries, kept across the compiles of one
+/// compiler object. Each entry is the DXIL bitcode of one partition. The
+/// oldest entries are dropped once the cache holds more than kMaxBytes.
+class DxcLibPartitionCache {
+public:
+  static const size_t kMaxBytes = 256 << 20;
+
+  bool Lookup(llvm::StringRef Key, std::string &Bitcode);
+  void Store(llvm::StringRef Key, std::string &&Bitcode);
+
+private:
+  std::mutex m_Mutex;
+  std::map<std::string, std::string> m_Entries;
+  std::deque<std::string> m_Order; // Keys, oldest first.
+  size_t m_Bytes = 0;
+};
+
+/// Runs the backend of a library a partition at a time, reusing the
+/// partitions that did not change since an earlier compile.
+///
+/// There is a partition for each shader entry and export: the function and
+/// the internal functions it reaches, with the other entries and exports it
+/// calls left as declarations. A partition is keyed on the text of its
+/// functions and of every declaration they use, the module outside of
+/// function bodies, and the options. The optimized partitions are then
+/// linked with the DXIL linker, which runs the module-level passes on the
+/// result.
+///
+/// The output is not always that of a normal compile. A partition is
+/// optimized without the bodies of the exports it calls, and after the link
+/// only the passes of the linker run: calls between exports are inlined and
+/// simplified, but there is no GVN, instcombine or loop optimization across
+/// them.
+///
+/// Whenever a partition could behave differently from the whole module,
+/// the whole module is optimized as usual instead: for debug info, hull
+/// shaders, global constructors, or mutable statics and groupshared
+/// variables reached from more than one partition. So is a module for
+/// which any partition or the link reports a diagnostic, so that the
+/// diagnostics match a normal compile.
+class DxcIncrementalLibRunner
+    : public clang::CodeGenOptions::BackendRunnerType {
+public:
+  /// Fingerprint identifies everything but the source that affects the
+  /// output, such as the compiler version and the arguments.
+  DxcIncrementalLibRunner(DxcLibPartitionCache &Cache,
+                          llvm::StringRef Fingerprint, llvm::StringRef Profile,
+                          unsigned ValMajor, unsigned ValMinor)
+      : m_Cache(Cache), m_Fingerprint(Fingerprint), m_Profile(Profile),
+        m_ValMajor(ValMajor), m_ValMinor(ValMinor) {}
+
+  std::unique_ptr<llvm::Module>
+  Run(llvm::Module *M,
+      const std::function<void(llvm::Module *, bool)> &EmitBackend) override;
+
+private:
+  std::unique_ptr<llvm::Module>
+  RunPartitions(llvm::Module *M,
+                const std::function<void(llvm::Module *, bool)> &EmitBackend);
+
+  DxcLibPartitionCache &m_Cache;
+  std::string m_Fingerprint;
+  std::string m_Profile;
+  unsigned m_ValMajor;
+  unsigned m_ValMinor;
+};
+
+} // namespace dxcutil
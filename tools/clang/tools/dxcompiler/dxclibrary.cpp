@@ -21,6 +21,7 @@
 #include "dxc/dxctools.h"
 #include "dxc/DxilContainer/DxilContainer.h"
 #include "dxc/DXIL/DxilPDB.h"
+#include "dxcincludecache.h"
 
 #include <unordered_set>
 #include <vector>
@@ -33,6 +34,9 @@ using namespace hlsl;
 namespace hlsl {
 HRESULT CreateDxilShaderOrLibraryReflectionFromProgramHeader(const DxilProgramHeader *pProgramHeader, const DxilPartHeader *pRDATPart, REFIID iid, void **ppvObject);
 HRESULT CreateDxilShaderOrLibraryReflectionFromModulePart(const DxilPartHeader *pModulePart, const DxilPartHeader *pRDATPart, REFIID iid, void **ppvObject);
+HRESULT CreateDxilReflectionFromContainerParts(const DxilPartHeader *pModulePart, const DxilPartHeader *pRDATPart, const DxilPartHeader *pHashPart, REFIID iid, void **ppvObject);
+void SetReflectionCacheSize(unsigned MaxEntries);
+void FlushReflectionCache();
 }
 #endif
 
@@ -220,7 +224,7 @@ public:
     _In_ IDxcBlob *pBlob, _COM_Outptr_ IDxcBlobEncoding **pBlobEncoding) override;
 };
 
-class DxcUtils : public IDxcUtils {
+class DxcUtils : public IDxcUtils3 {
   friend class DxcLibrary;
 private:
   DXC_MICROCOM_TM_REF_FIELDS()
@@ -231,7 +235,7 @@ public:
   DXC_MICROCOM_TM_ALLOC(DxcUtils)
 
   HRESULT STDMETHODCALLTYPE QueryInterface(REFIID iid, void **ppvObject) override {
-    HRESULT hr = DoBasicQueryInterface<IDxcUtils>(this, iid, ppvObject);
+    HRESULT hr = DoBasicQueryInterface<IDxcUtils3, IDxcUtils2, IDxcUtils>(this, iid, ppvObject);
     if (FAILED(hr)) {
       return DoBasicQueryInterface<IDxcLibrary>(&m_Library, iid, ppvObject);
     }
@@ -308,6 +312,38 @@ public:
     return S_OK;
   }
 
+  virtual HRESULT STDMETHODCALLTYPE CreateIncludeCache(
+    _In_opt_ IDxcIncludeHandler *pInner,
+    _COM_Outptr_ IDxcIncludeCache **ppResult) override {
+    DxcThreadMalloc TM(m_pMalloc);
+    return dxcutil::CreateIncludeCache(m_pMalloc, pInner, ppResult);
+  }
+
+  virtual HRESULT STDMETHODCALLTYPE SetReflectionCacheSize(
+    UINT32 maxEntries) override {
+#ifdef _WIN32
+    try {
+      hlsl::SetReflectionCacheSize(maxEntries);
+      return S_OK;
+    }
+    CATCH_CPP_RETURN_HRESULT();
+#else
+    return E_NOTIMPL;
+#endif
+  }
+
+  virtual HRESULT STDMETHODCALLTYPE FlushReflectionCache() override {
+#ifdef _WIN32
+    try {
+      hlsl::FlushReflectionCache();
+      return S_OK;
+    }
+    CATCH_CPP_RETURN_HRESULT();
+#else
+    return E_NOTIMPL;
+#endif
+  }
+
   virtual HRESULT STDMETHODCALLTYPE GetBlobAsUtf8(
     _In_ IDxcBlob *pBlob, _COM_Outptr_ IDxcBlobUtf8 **pBlobEncoding) override {
     DxcThreadMalloc TM(m_pMalloc);
@@ -361,6 +397,7 @@ public:
       CComPtr<IDxcBlob> pPdbContainerBlob;
       const DxilPartHeader *pModulePart = nullptr;
       const DxilPartHeader *pRDATPart = nullptr;
+      const DxilPartHeader *pHashPart = nullptr;
 
       const DxilContainerHeader *pHeader = IsDxilContainerLike(pData->Ptr, pData->Size);
       if (!pHeader) {
@@ -400,6 +437,9 @@ public:
             IFRBOOL(!pRDATPart, DXC_E_DUPLICATE_PART);  // Should only be one
             pRDATPart = pPart;
             break;
+          case DFCC_ShaderHash:
+            pHashPart = pPart;
+            break;
           }
         }
 
@@ -435,7 +475,7 @@ public:
         }
       }
 
-      return hlsl::CreateDxilShaderOrLibraryReflectionFromModulePart(pModulePart, pRDATPart, iid, ppvReflection);
+      return hlsl::CreateDxilReflectionFromContainerParts(pModulePart, pRDATPart, pHashPart, iid, ppvReflection);
     }
     CATCH_CPP_RETURN_HRESULT();
 #else
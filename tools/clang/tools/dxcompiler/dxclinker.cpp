@@ -15,12 +15,14 @@
 #include "dxc/Support/Global.h"
 #include "dxc/Support/FileIOHelper.h"
 #include "dxc/Support/dxcapi.impl.h"
+#include "dxc/Support/dxcconcurrency.h"
 #include "dxc/Support/microcom.h"
 #include "dxc/dxcapi.h"
 #include "dxillib.h"
 
 #include "llvm/ADT/SmallVector.h"
 #include <algorithm>
+#include <mutex>
 
 #include "dxc/HLSL/DxilLinker.h"
 #include "dxc/HLSL/DxilValidation.h"
@@ -43,7 +45,7 @@ using namespace llvm;
 // This declaration is used for the locally-linked validator.
 HRESULT CreateDxcValidator(_In_ REFIID riid, _Out_ LPVOID *ppv);
 
-class DxcLinker : public IDxcLinker, public IDxcContainerEvent {
+class DxcLinker : public IDxcLinker2, public IDxcContainerEvent {
 public:
   DXC_MICROCOM_TM_ADDREF_RELEASE_IMPL()
   DXC_MICROCOM_TM_CTOR(DxcLinker)
@@ -69,6 +71,16 @@ public:
           *ppResult // Linker output status, buffer, and errors
   ) override;
 
+  HRESULT STDMETHODCALLTYPE LinkBatch(
+      _In_count_(jobCount) const DxcLinkJob *pJobs, // Jobs to link
+      _In_ UINT32 jobCount,                         // Number of jobs
+      _In_count_(libCount)
+          const LPCWSTR *pLibNames, // Array of library names to link
+      _In_ UINT32 libCount,         // Number of libraries to link
+      _Out_writes_(jobCount) IDxcOperationResult *
+          *ppResults // One result per job: status, buffer, and errors
+  ) override;
+
   HRESULT STDMETHODCALLTYPE RegisterDxilContainerEventHandler(
       IDxcContainerEventsHandler *pHandler, UINT64 *pCookie) override {
     DxcThreadMalloc TM(m_pMalloc);
@@ -88,7 +100,8 @@ public:
   }
 
   HRESULT STDMETHODCALLTYPE QueryInterface(REFIID riid, void **ppvObject) {
-    return DoBasicQueryInterface<IDxcLinker>(this, riid, ppvObject);
+    return DoBasicQueryInterface<IDxcLinker, IDxcLinker2>(this, riid,
+                                                          ppvObject);
   }
 
   void Initialize() {
@@ -107,23 +120,21 @@ private:
   LLVMContext m_Ctx;
   std::unique_ptr<DxilLinker> m_pLinker;
   CComPtr<IDxcContainerEventsHandler> m_pDxcContainerEventsHandler;
-  std::vector<CComPtr<IDxcBlob>> m_blobs; // Keep blobs live for lazy load.
+  std::mutex m_EventsHandlerMutex; // Serializes handler calls from LinkBatch.
+  // Keep blobs live for lazy load, and to reload them for LinkBatch.
+  std::vector<std::pair<std::string, CComPtr<IDxcBlob>>> m_libs;
+
+  HRESULT LoadLib(DxilLinker &linker, LLVMContext &Ctx, const char *pLibName,
+                  IDxcBlob *pBlob);
+  HRESULT LinkWith(DxilLinker &linker, LLVMContext &Ctx, LPCWSTR pEntryName,
+                   LPCWSTR pTargetProfile, const LPCWSTR *pLibNames,
+                   UINT32 libCount, const LPCWSTR *pArguments, UINT32 argCount,
+                   IDxcOperationResult **ppResult);
 };
 
-HRESULT
-DxcLinker::RegisterLibrary(_In_opt_ LPCWSTR pLibName, // Name of the library.
-                           _In_ IDxcBlob *pBlob       // Library to add.
-) {
-  if (!pLibName || !pBlob)
-    return E_INVALIDARG;
-  DXASSERT(m_pLinker.get(), "else Initialize() not called or failed silently");
-  DxcThreadMalloc TM(m_pMalloc);
-  // Prepare UTF8-encoded versions of API values.
-  CW2A pUtf8LibName(pLibName, CP_UTF8);
-  // Already exist lib with same name.
-  if (m_pLinker->HasLibNameRegistered(pUtf8LibName.m_psz))
-    return E_INVALIDARG;
-
+// Loads a library lazily into Ctx and registers it with linker.
+HRESULT DxcLinker::LoadLib(DxilLinker &linker, LLVMContext &Ctx,
+                           const char *pLibName, IDxcBlob *pBlob) {
   try {
     std::unique_ptr<llvm::Module> pModule, pDebugModule;
 
@@ -137,20 +148,41 @@ DxcLinker::RegisterLibrary(_In_opt_ LPCWSTR pLibName, // Name of the library.
 
     IFR(ValidateLoadModuleFromContainerLazy(
         pBlob->GetBufferPointer(), pBlob->GetBufferSize(), pModule,
-        pDebugModule, m_Ctx, m_Ctx, DiagStream));
+        pDebugModule, Ctx, Ctx, DiagStream));
 
-    if (m_pLinker->RegisterLib(pUtf8LibName.m_psz, std::move(pModule),
-                               std::move(pDebugModule))) {
-      m_blobs.emplace_back(pBlob);
+    if (linker.RegisterLib(pLibName, std::move(pModule),
+                           std::move(pDebugModule)))
       return S_OK;
-    } else {
-      return E_INVALIDARG;
-    }
+    return E_INVALIDARG;
   } catch (hlsl::Exception &) {
     return E_INVALIDARG;
   }
 }
 
+HRESULT
+DxcLinker::RegisterLibrary(_In_opt_ LPCWSTR pLibName, // Name of the library.
+                           _In_ IDxcBlob *pBlob       // Library to add.
+) {
+  if (!pLibName || !pBlob)
+    return E_INVALIDARG;
+  DXASSERT(m_pLinker.get(), "else Initialize() not called or failed silently");
+  DxcThreadMalloc TM(m_pMalloc);
+  // Prepare UTF8-encoded versions of API values.
+  CW2A pUtf8LibName(pLibName, CP_UTF8);
+  // Already exist lib with same name.
+  if (m_pLinker->HasLibNameRegistered(pUtf8LibName.m_psz))
+    return E_INVALIDARG;
+
+  HRESULT hr = LoadLib(*m_pLinker, m_Ctx, pUtf8LibName.m_psz, pBlob);
+  if (SUCCEEDED(hr)) {
+    try {
+      m_libs.emplace_back(pUtf8LibName.m_psz, pBlob);
+    }
+    CATCH_CPP_ASSIGN_HRESULT();
+  }
+  return hr;
+}
+
 // Links the shader and produces a shader blob that the Direct3D runtime can
 // use.
 HRESULT STDMETHODCALLTYPE DxcLinker::Link(
@@ -168,6 +200,105 @@ HRESULT STDMETHODCALLTYPE DxcLinker::Link(
   if (!pTargetProfile || !pLibNames || libCount == 0 || !ppResult)
     return E_INVALIDARG;
   DxcThreadMalloc TM(m_pMalloc);
+  return LinkWith(*m_pLinker, m_Ctx, pEntryName, pTargetProfile, pLibNames,
+                  libCount, pArguments, argCount, ppResult);
+}
+
+HRESULT STDMETHODCALLTYPE DxcLinker::LinkBatch(
+    _In_count_(jobCount) const DxcLinkJob *pJobs, // Jobs to link
+    _In_ UINT32 jobCount,                         // Number of jobs
+    _In_count_(libCount)
+        const LPCWSTR *pLibNames, // Array of library names to link
+    _In_ UINT32 libCount,         // Number of libraries to link
+    _Out_writes_(jobCount) IDxcOperationResult *
+        *ppResults // One result per job: status, buffer, and errors
+) {
+  if ((jobCount > 0 && !pJobs) || !pLibNames || libCount == 0 || !ppResults)
+    return E_INVALIDARG;
+  for (UINT32 i = 0; i < jobCount; ++i) {
+    ppResults[i] = nullptr;
+    if (!pJobs[i].pTargetProfile ||
+        (pJobs[i].ArgCount > 0 && !pJobs[i].pArguments))
+      return E_INVALIDARG;
+  }
+
+  DxcThreadMalloc TM(m_pMalloc);
+  try {
+    UINT32 valMajor, valMinor;
+    dxcutil::GetValidatorVersion(&valMajor, &valMinor);
+
+    std::vector<HRESULT> jobResults(jobCount, E_FAIL);
+    // LLVMContext is not thread safe, so each job links on a context of its
+    // own with its own lazily loaded copy of the libraries. The registered
+    // blobs are shared read-only. Contexts are reused by later jobs, so at
+    // most one per thread is created.
+    struct LinkerContext {
+      LLVMContext Ctx; // Declared before the linker, so that it outlives it.
+      std::unique_ptr<DxilLinker> pLinker;
+      HRESULT hr = S_OK;
+    };
+    std::mutex freeContextsMutex;
+    std::vector<std::unique_ptr<LinkerContext>> freeContexts;
+    RunConcurrently(jobCount, [&](UINT32 i) {
+      DxcThreadMalloc TM(m_pMalloc);
+      try {
+        std::unique_ptr<LinkerContext> pContext;
+        {
+          std::lock_guard<std::mutex> lock(freeContextsMutex);
+          if (!freeContexts.empty()) {
+            pContext = std::move(freeContexts.back());
+            freeContexts.pop_back();
+          }
+        }
+        if (!pContext) {
+          pContext.reset(new LinkerContext());
+          pContext->pLinker.reset(
+              DxilLinker::CreateLinker(pContext->Ctx, valMajor, valMinor));
+          for (auto &lib : m_libs) {
+            if (FAILED(pContext->hr))
+              break;
+            pContext->hr = LoadLib(*pContext->pLinker, pContext->Ctx,
+                                   lib.first.c_str(), lib.second);
+          }
+        }
+        if (SUCCEEDED(pContext->hr)) {
+          pContext->pLinker->DetachAll();
+          jobResults[i] =
+              LinkWith(*pContext->pLinker, pContext->Ctx, pJobs[i].pEntryName,
+                       pJobs[i].pTargetProfile, pLibNames, libCount,
+                       pJobs[i].pArguments, pJobs[i].ArgCount, &ppResults[i]);
+        } else {
+          jobResults[i] = pContext->hr;
+        }
+        std::lock_guard<std::mutex> lock(freeContextsMutex);
+        freeContexts.push_back(std::move(pContext));
+      } catch (...) {
+        // Jobs without a result report failure below.
+      }
+    });
+    freeContexts.clear();
+
+    for (UINT32 i = 0; i < jobCount; ++i) {
+      if (FAILED(jobResults[i])) {
+        for (UINT32 j = 0; j < jobCount; ++j) {
+          if (ppResults[j]) {
+            ppResults[j]->Release();
+            ppResults[j] = nullptr;
+          }
+        }
+        return jobResults[i];
+      }
+    }
+    return S_OK;
+  }
+  CATCH_CPP_RETURN_HRESULT();
+}
+
+HRESULT DxcLinker::LinkWith(DxilLinker &linker, LLVMContext &Ctx,
+                            LPCWSTR pEntryName, LPCWSTR pTargetProfile,
+                            const LPCWSTR *pLibNames, UINT32 libCount,
+                            const LPCWSTR *pArguments, UINT32 argCount,
+                            IDxcOperationResult **ppResult) {
   // Prepare UTF8-encoded versions of API values.
   CW2A pUtf8TargetProfile(pTargetProfile, CP_UTF8);
   CW2A pUtf8EntryPoint(pEntryName, CP_UTF8);
@@ -175,7 +306,7 @@ HRESULT STDMETHODCALLTYPE DxcLinker::Link(
   CComPtr<AbstractMemoryStream> pOutputStream;
 
   // Detach previous libraries.
-  m_pLinker->DetachAll();
+  linker.DetachAll();
 
   HRESULT hr = S_OK;
   try {
@@ -210,11 +341,11 @@ HRESULT STDMETHODCALLTYPE DxcLinker::Link(
     raw_stream_ostream DiagStream(pDiagStream);
     llvm::DiagnosticPrinterRawOStream DiagPrinter(DiagStream);
     PrintDiagnosticContext DiagContext(DiagPrinter);
-    m_Ctx.setDiagnosticHandler(PrintDiagnosticContext::PrintDiagnosticHandler,
-                               &DiagContext, true);
+    Ctx.setDiagnosticHandler(PrintDiagnosticContext::PrintDiagnosticHandler,
+                             &DiagContext, true);
 
     if (opts.ValVerMajor != UINT32_MAX) {
-      m_pLinker->SetValidatorVersion(opts.ValVerMajor, opts.ValVerMinor);
+      linker.SetValidatorVersion(opts.ValVerMajor, opts.ValVerMinor);
     }
 
     bool needsValidation = !opts.DisableValidation;
@@ -230,7 +361,7 @@ HRESULT STDMETHODCALLTYPE DxcLinker::Link(
     bool bSuccess = true;
     for (unsigned i = 0; i < libCount; i++) {
       CW2A pUtf8LibName(pLibNames[i], CP_UTF8);
-      bSuccess &= m_pLinker->AttachLib(pUtf8LibName.m_psz);
+      bSuccess &= linker.AttachLib(pUtf8LibName.m_psz);
     }
 
     dxilutil::ExportMap exportMap;
@@ -241,7 +372,7 @@ HRESULT STDMETHODCALLTYPE DxcLinker::Link(
 
     bool hasErrorOccurred = !bSuccess;
     if (bSuccess) {
-      std::unique_ptr<Module> pM = m_pLinker->Link(
+      std::unique_ptr<Module> pM = linker.Link(
           opts.EntryPoint, pUtf8TargetProfile.m_psz, exportMap);
       if (pM) {
         const IntrusiveRefCntPtr<clang::DiagnosticIDs> Diags(
@@ -269,6 +400,9 @@ HRESULT STDMETHODCALLTYPE DxcLinker::Link(
         if (opts.DebugNameForSource) {
           SerializeFlags |= SerializeDxilFlags::DebugNameDependOnSource;
         }
+        if (opts.FastShaderHash) {
+          SerializeFlags |= SerializeDxilFlags::FastShaderHash;
+        }
         // Validation.
         HRESULT valHR = S_OK;
         dxcutil::AssembleInputs inputs(
@@ -283,6 +417,7 @@ HRESULT STDMETHODCALLTYPE DxcLinker::Link(
         // Callback after valid DXIL is produced
         if (SUCCEEDED(valHR)) {
           CComPtr<IDxcBlob> pTargetBlob;
+          std::lock_guard<std::mutex> lock(m_EventsHandlerMutex);
           if (m_pDxcContainerEventsHandler != nullptr) {
             HRESULT hr = m_pDxcContainerEventsHandler->OnDxilContainerBuilt(
                 pOutputBlob, &pTargetBlob);
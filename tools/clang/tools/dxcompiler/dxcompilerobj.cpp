@@ -16,17 +16,24 @@
 #include "clang/Basic/TargetInfo.h"
 #include "clang/Frontend/CompilerInstance.h"
 #include "clang/Lex/Preprocessor.h"
+#include "clang/Lex/HeaderSearch.h"
 #include "clang/Lex/HLSLMacroExpander.h"
 #include "clang/Frontend/ASTUnit.h"
 #include "clang/Frontend/TextDiagnosticPrinter.h"
 #include "clang/Sema/SemaHLSL.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/ADT/StringSet.h"
 #include "llvm/Bitcode/ReaderWriter.h"
 #include "clang/Frontend/FrontendActions.h"
 #include "clang/CodeGen/CodeGenAction.h"
 #include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/PassReport.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/TimeProfiler.h"
 #include "llvm/Transforms/Utils/Cloning.h"
 #include "dxc/Support/WinIncludes.h"
 #include "dxc/HLSL/HLSLExtensionsCodegenHelper.h"
+#include "dxc/HLSL/DxilPerfReport.h"
 #include "dxc/DxilRootSignature/DxilRootSignature.h"
 #include "dxcutil.h"
 #include "dxc/Support/dxcfilesystem.h"
@@ -45,16 +52,27 @@
 #include "dxc/Support/dxcapi.impl.h"
 #include "dxc/Support/DxcLangExtensionsHelper.h"
 #include "dxc/Support/HLSLOptions.h"
+#include "dxc/Support/dxcconcurrency.h"
 
 #ifdef _WIN32
 #include "dxcetw.h"
 #endif
 #include "dxillib.h"
+#include "dxccompilercache.h"
+#include "dxccompilejob.h"
+#include "dxccontextpool.h"
+#include "dxcincludecache.h"
+#include "dxcincrementallib.h"
 #include "dxcshadersourceinfo.h"
 #include "dxcompileradapter.h"
 #include "dxcversion.inc"
 #include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <cfloat>
+#include <functional>
+#include <mutex>
+#include <unordered_map>
 
 // SPIRV change starts
 #ifdef ENABLE_SPIRV_CODEGEN
@@ -566,6 +584,510 @@ static void CreateDefineStrings(
   }
 }
 
+// Enables the time trace profiler on the calling thread until destroyed,
+// unless an enclosing compile on the same thread already enabled it.
+class TimeTraceSession {
+  bool m_bOwner = false;
+public:
+  ~TimeTraceSession() {
+    if (m_bOwner)
+      llvm::timeTraceProfilerCleanup();
+  }
+  void Start() {
+    if (!llvm::timeTraceProfilerEnabled()) {
+      llvm::timeTraceProfilerInitialize("dxcompiler");
+      m_bOwner = true;
+    }
+  }
+  bool IsOwner() const { return m_bOwner; }
+};
+
+// Compile phases that the memory report breaks the figures down by. These
+// are the outer time trace ranges; passes run inside them are not phases.
+static const char *const kMemoryReportPhases[] = {
+    "Compile",   "Preprocess",         "Parse",
+    "CodeGen",   "Backend",            "Per-function passes",
+    "Per-module passes", "Code generation passes", "Assemble container",
+    "Validation", "Hash",              "PDB"};
+
+// Forwards to another allocator and keeps track of the blocks allocated
+// through it, for the memory figures in the pass report and the memory
+// report. Blocks that were allocated before it was installed are forwarded
+// but not counted. As a time trace listener, it also attributes allocations
+// and the high-water mark to the compile phase they happen in. Only Windows
+// builds route operator new through the thread IMalloc (see DXCompiler.cpp);
+// elsewhere it sees just the blocks allocated through IMalloc directly, so
+// the figures fall well short of the memory the compile uses.
+class MeasuringMalloc : public IMalloc,
+                        public llvm::PassReportMemoryCounter,
+                        public llvm::TimeTraceListener {
+private:
+  DXC_MICROCOM_TM_REF_FIELDS()
+  typedef std::unordered_map<
+      void *, size_t, std::hash<void *>, std::equal_to<void *>,
+      DxcMallocAllocator<std::pair<void *const, size_t>>>
+      SizeMap;
+  std::mutex m_Lock;
+  SizeMap m_Sizes; // Allocates directly from m_pMalloc, so is not counted.
+  uint64_t m_CurrentBytes = 0;
+  uint64_t m_PeakBytes = 0;    // Since the last resetPeakBytes call.
+  uint64_t m_HighWaterBytes = 0;
+  uint64_t m_Allocations = 0;
+  uint64_t m_AllocatedBytes = 0;
+  uint64_t m_LimitBytes = 0; // Zero means no limit.
+  bool m_bCounting = true;
+  bool m_bLimitExceeded = false;
+
+  struct PhaseStats {
+    unsigned Count = 0;
+    uint64_t Allocations = 0;
+    uint64_t AllocatedBytes = 0;
+    uint64_t PeakBytes = 0;
+  };
+  struct OpenRange {
+    int Phase; // Index into kMemoryReportPhases, or -1 for other ranges.
+    uint64_t AllocationsAtStart;
+    uint64_t AllocatedBytesAtStart;
+    uint64_t PeakBytes;
+  };
+  PhaseStats m_Phases[_countof(kMemoryReportPhases)];
+  // Like m_Sizes, allocates from m_pMalloc so that it is never counted.
+  std::vector<OpenRange, DxcMallocAllocator<OpenRange>> m_Ranges;
+
+  void Track(void *P, size_t cb) {
+    if (!m_bCounting)
+      return;
+    try {
+      m_Sizes[P] = cb;
+    } catch (std::bad_alloc &) {
+      return; // Leave the block uncounted.
+    }
+    m_CurrentBytes += cb;
+    m_PeakBytes = std::max(m_PeakBytes, m_CurrentBytes);
+    m_HighWaterBytes = std::max(m_HighWaterBytes, m_CurrentBytes);
+    ++m_Allocations;
+    m_AllocatedBytes += cb;
+    if (!m_Ranges.empty())
+      m_Ranges.back().PeakBytes =
+          std::max(m_Ranges.back().PeakBytes, m_CurrentBytes);
+  }
+  void Untrack(void *P) {
+    auto It = m_Sizes.find(P);
+    if (It == m_Sizes.end())
+      return;
+    m_CurrentBytes -= It->second;
+    m_Sizes.erase(It);
+  }
+  // Whether replacing the block at P, if any, with one of cb bytes would
+  // take the counted bytes over the limit.
+  bool ExceedsLimit(void *P, size_t cb) {
+    std::lock_guard<std::mutex> lock(m_Lock);
+    if (m_LimitBytes == 0 || !m_bCounting)
+      return false;
+    uint64_t Freed = 0;
+    if (P != nullptr) {
+      auto It = m_Sizes.find(P);
+      if (It != m_Sizes.end())
+        Freed = It->second;
+    }
+    if (m_CurrentBytes - Freed + cb <= m_LimitBytes)
+      return false;
+    m_bLimitExceeded = true;
+    return true;
+  }
+
+public:
+  DXC_MICROCOM_TM_ADDREF_RELEASE_IMPL()
+
+  MeasuringMalloc(IMalloc *pMalloc)
+      : m_dwRef(0), m_pMalloc(pMalloc),
+        m_Sizes(SizeMap::allocator_type(pMalloc)),
+        m_Ranges(DxcMallocAllocator<OpenRange>(pMalloc)) {}
+
+  STDMETHODIMP QueryInterface(REFIID iid, void **ppvObject) override {
+    return DoBasicQueryInterface<IMalloc>(this, iid, ppvObject);
+  }
+
+  void *STDMETHODCALLTYPE Alloc(SIZE_T cb) override {
+    if (ExceedsLimit(nullptr, cb))
+      return nullptr;
+    void *P = m_pMalloc->Alloc(cb);
+    if (P != nullptr) {
+      std::lock_guard<std::mutex> lock(m_Lock);
+      Track(P, cb);
+    }
+    return P;
+  }
+
+  void *STDMETHODCALLTYPE Realloc(void *pv, SIZE_T cb) override {
+    if (ExceedsLimit(pv, cb))
+      return nullptr;
+    void *P = m_pMalloc->Realloc(pv, cb);
+    if (P != nullptr || cb == 0) {
+      std::lock_guard<std::mutex> lock(m_Lock);
+      if (pv != nullptr)
+        Untrack(pv);
+      if (P != nullptr)
+        Track(P, cb);
+    }
+    return P;
+  }
+
+  void STDMETHODCALLTYPE Free(void *pv) override {
+    if (pv != nullptr) {
+      std::lock_guard<std::mutex> lock(m_Lock);
+      Untrack(pv);
+    }
+    m_pMalloc->Free(pv);
+  }
+
+  virtual SIZE_T STDMETHODCALLTYPE GetSize(void *pv) {
+    std::lock_guard<std::mutex> lock(m_Lock);
+    auto It = m_Sizes.find(pv);
+    return It == m_Sizes.end() ? (SIZE_T)-1 : It->second;
+  }
+
+  virtual int STDMETHODCALLTYPE DidAlloc(void *pv) {
+    return -1; // don't know
+  }
+
+  virtual void STDMETHODCALLTYPE HeapMinimize(void) {}
+
+  uint64_t getCurrentBytes() override {
+    std::lock_guard<std::mutex> lock(m_Lock);
+    return m_CurrentBytes;
+  }
+  uint64_t getPeakBytes() override {
+    std::lock_guard<std::mutex> lock(m_Lock);
+    return m_PeakBytes;
+  }
+  void resetPeakBytes() override {
+    std::lock_guard<std::mutex> lock(m_Lock);
+    m_PeakBytes = m_CurrentBytes;
+  }
+
+  void rangeBegin(StringRef Name) override {
+    int Phase = -1;
+    for (unsigned i = 0; i < _countof(kMemoryReportPhases); ++i) {
+      if (Name == kMemoryReportPhases[i]) {
+        Phase = i;
+        break;
+      }
+    }
+    std::lock_guard<std::mutex> lock(m_Lock);
+    try {
+      m_Ranges.push_back(
+          {Phase, m_Allocations, m_AllocatedBytes, m_CurrentBytes});
+    } catch (std::bad_alloc &) {
+      // Leave the range out; its end pops the enclosing one early, which
+      // only blurs the phase figures.
+    }
+  }
+
+  void rangeEnd() override {
+    std::lock_guard<std::mutex> lock(m_Lock);
+    if (m_Ranges.empty())
+      return;
+    OpenRange R = m_Ranges.back();
+    m_Ranges.pop_back();
+    if (!m_Ranges.empty())
+      m_Ranges.back().PeakBytes =
+          std::max(m_Ranges.back().PeakBytes, R.PeakBytes);
+    if (R.Phase < 0)
+      return;
+    // Like the time trace totals, only count the outermost range of a phase.
+    for (const OpenRange &Outer : m_Ranges) {
+      if (Outer.Phase == R.Phase)
+        return;
+    }
+    PhaseStats &Stats = m_Phases[R.Phase];
+    ++Stats.Count;
+    Stats.Allocations += m_Allocations - R.AllocationsAtStart;
+    Stats.AllocatedBytes += m_AllocatedBytes - R.AllocatedBytesAtStart;
+    Stats.PeakBytes = std::max(Stats.PeakBytes, R.PeakBytes);
+  }
+
+  // Writes the figures for the whole compile and for each phase that ran, in
+  // the order of kMemoryReportPhases. Peaks are the highest number of bytes
+  // allocated at once, counting blocks still held from earlier phases.
+  void WriteReport(raw_ostream &OS) {
+    std::lock_guard<std::mutex> lock(m_Lock);
+    OS << "{\"peakBytes\":" << m_HighWaterBytes
+       << ",\"allocations\":" << m_Allocations
+       << ",\"allocatedBytes\":" << m_AllocatedBytes
+       << ",\"phases\":[";
+    bool First = true;
+    for (unsigned i = 0; i < _countof(kMemoryReportPhases); ++i) {
+      const PhaseStats &Stats = m_Phases[i];
+      if (Stats.Count == 0)
+        continue;
+      OS << (First ? "\n" : ",\n") << "{\"name\":\"" << kMemoryReportPhases[i]
+         << "\",\"count\":" << Stats.Count
+         << ",\"allocations\":" << Stats.Allocations
+         << ",\"allocatedBytes\":" << Stats.AllocatedBytes
+         << ",\"peakBytes\":" << Stats.PeakBytes << "}";
+      First = false;
+    }
+    OS << "\n]}\n";
+  }
+
+  // Fails allocations that would take the counted bytes over \p Bytes, so
+  // that they throw std::bad_alloc; zero removes the limit.
+  void SetLimit(uint64_t Bytes) {
+    std::lock_guard<std::mutex> lock(m_Lock);
+    m_LimitBytes = Bytes;
+  }
+  bool LimitExceeded() {
+    std::lock_guard<std::mutex> lock(m_Lock);
+    return m_bLimitExceeded;
+  }
+
+  // Blocks allocated from here on are no longer counted; frees of counted
+  // blocks still are, so the table drains as they go away.
+  void StopCounting() {
+    std::lock_guard<std::mutex> lock(m_Lock);
+    m_bCounting = false;
+  }
+};
+
+// Wraps the calling thread's allocator in a MeasuringMalloc until destroyed,
+// for the pass report and the memory report, and listens to the time trace
+// ranges for the phases. Like TimeTraceSession, an enclosing compile on the
+// same thread keeps ownership of the measurement.
+class MemoryMeasurementSession {
+  CComPtr<MeasuringMalloc> m_pMalloc;
+  llvm::Optional<DxcThreadMalloc> m_TM;
+public:
+  ~MemoryMeasurementSession() {
+    if (m_pMalloc) {
+      llvm::timeTraceSetListener(nullptr);
+      m_TM.reset();
+      m_pMalloc->StopCounting();
+    }
+  }
+  void Start() {
+    if (m_pMalloc || llvm::TimeTraceListenerInstance != nullptr)
+      return;
+    IMalloc *pBacking = DxcGetThreadMallocNoRef();
+    void *P = pBacking->Alloc(sizeof(MeasuringMalloc));
+    if (P == nullptr)
+      throw std::bad_alloc();
+    m_pMalloc = new (P) MeasuringMalloc(pBacking);
+    m_TM.emplace(m_pMalloc.p);
+    llvm::timeTraceSetListener(m_pMalloc.p);
+  }
+  MeasuringMalloc *GetMalloc() const { return m_pMalloc; }
+};
+
+// Enables the pass report on the calling thread until destroyed, with memory
+// measured by \p memory. Like TimeTraceSession, an enclosing compile on the
+// same thread keeps ownership of the report.
+class PassReportSession {
+  bool m_bOwner = false;
+public:
+  ~PassReportSession() {
+    if (m_bOwner)
+      llvm::passReportCleanup();
+  }
+  void Start(MemoryMeasurementSession &memory) {
+    if (llvm::passReportEnabled())
+      return;
+    memory.Start();
+    llvm::passReportInitialize(memory.GetMalloc());
+    m_bOwner = true;
+  }
+  bool IsOwner() const { return m_bOwner; }
+};
+
+// Records which file includes which, for the JSON dependency graph.
+class IncludeGraphCollector : public clang::PPCallbacks {
+  clang::SourceManager &m_SM;
+  llvm::StringSet<> m_Seen;
+public:
+  std::vector<std::pair<std::string, std::string>> Edges;
+  IncludeGraphCollector(clang::SourceManager &SM) : m_SM(SM) {}
+  void InclusionDirective(SourceLocation HashLoc, const Token &IncludeTok,
+                          StringRef FileName, bool IsAngled,
+                          CharSourceRange FilenameRange, const FileEntry *File,
+                          StringRef SearchPath, StringRef RelativePath,
+                          const clang::Module *Imported) override {
+    const FileEntry *Includer =
+        m_SM.getFileEntryForID(m_SM.getFileID(m_SM.getExpansionLoc(HashLoc)));
+    if (File == nullptr || Includer == nullptr)
+      return;
+    std::string key = Includer->getName();
+    key += '\0';
+    key += File->getName();
+    if (m_Seen.insert(key).second)
+      Edges.emplace_back(Includer->getName(), File->getName());
+  }
+};
+
+// Writes a path in a makefile rule, which Make and Ninja read alike.
+static void WriteMakePath(raw_ostream &OS, StringRef Path) {
+  for (char ch : Path) {
+    if (ch == ' ' || ch == '#')
+      OS << '\\';
+    else if (ch == '$')
+      OS << '$';
+    OS << ch;
+  }
+}
+
+static void WriteJSONString(raw_ostream &OS, StringRef Str) {
+  OS << '"';
+  for (unsigned char ch : Str) {
+    switch (ch) {
+    case '"':  OS << "\\\""; break;
+    case '\\': OS << "\\\\"; break;
+    case '\n': OS << "\\n"; break;
+    case '\r': OS << "\\r"; break;
+    case '\t': OS << "\\t"; break;
+    default:
+      if (ch < 0x20)
+        OS << llvm::format("\\u%04x", ch);
+      else
+        OS << ch;
+    }
+  }
+  OS << '"';
+}
+
+static void WriteDependencyGraphJson(
+    raw_ostream &OS, StringRef Target, llvm::ArrayRef<std::string> Deps,
+    llvm::ArrayRef<std::pair<std::string, std::string>> Edges) {
+  OS << "{\n  \"target\": ";
+  WriteJSONString(OS, Target);
+  OS << ",\n  \"dependencies\": [";
+  for (size_t i = 0; i < Deps.size(); ++i) {
+    OS << (i == 0 ? "\n    " : ",\n    ");
+    WriteJSONString(OS, Deps[i]);
+  }
+  OS << "\n  ],\n  \"includes\": [";
+  for (size_t i = 0; i < Edges.size(); ++i) {
+    OS << (i == 0 ? "\n    " : ",\n    ") << "{ \"from\": ";
+    WriteJSONString(OS, Edges[i].first);
+    OS << ", \"to\": ";
+    WriteJSONString(OS, Edges[i].second);
+    OS << " }";
+  }
+  OS << "\n  ]\n}\n";
+}
+
+// Parses a block profile for -fprofile-use. Each entry has the form
+//   Block<index>:<count>:<line>:<file>
+// which is the mapping written by the hlsl-dxil-pix-block-counters pass with
+// each counter offset replaced by the count read back from its UAV. Blocks
+// that start on the same line keep the largest count. Other lines, such as
+// the section markers, are ignored.
+static bool ParseBlockProfile(
+    StringRef fileName, StringRef content, raw_ostream &os,
+    std::map<std::string, std::map<unsigned, uint64_t>> *outProfile) {
+  SmallVector<StringRef, 64> lines;
+  content.split(lines, "\n");
+  for (unsigned lineIndex = 0; lineIndex < lines.size(); ++lineIndex) {
+    StringRef line = lines[lineIndex].trim();
+    if (!line.startswith("Block"))
+      continue;
+    SmallVector<StringRef, 4> fields;
+    line.drop_front(strlen("Block")).split(fields, ":", /*MaxSplit*/ 3);
+    unsigned blockIndex = 0;
+    uint64_t count = 0;
+    unsigned sourceLine = 0;
+    if (fields.size() < 2 || fields[0].getAsInteger(10, blockIndex) ||
+        fields[1].getAsInteger(10, count) ||
+        (fields.size() > 2 && (fields.size() != 4 ||
+                               fields[2].getAsInteger(10, sourceLine)))) {
+      os << fileName << "(" << (lineIndex + 1)
+         << "): malformed block profile entry '" << line << "'.";
+      os.flush();
+      return false;
+    }
+    // Blocks without a source location cannot guide code generation.
+    if (fields.size() < 4)
+      continue;
+    uint64_t &lineCount = (*outProfile)[fields[3]][sourceLine];
+    lineCount = std::max(lineCount, count);
+  }
+  return true;
+}
+
+// Options parsed once by IDxcCompiler5::ParseArguments, shared by the
+// parsed arguments and every variant made from them. Not modified after
+// parsing.
+struct DxcParsedOptions {
+  std::vector<std::wstring> Arguments;
+  hlsl::options::MainArgs MainArgs;
+  hlsl::options::DxcOpts Opts;
+  std::string Warnings;
+};
+
+// Private interface to recognize parsed arguments made by this module.
+CROSS_PLATFORM_UUIDOF(DxcParsedArguments, "5b0e93d4-7a2c-4e61-b8f5-3c9d04a7e1b2")
+struct DxcParsedArguments : public IDxcParsedArguments {
+private:
+  DXC_MICROCOM_TM_REF_FIELDS()
+  std::shared_ptr<const DxcParsedOptions> m_pOptions;
+  // Variant defines, as "name=value".
+  std::vector<std::string> m_ExtraDefines;
+  // The parsed arguments followed by a -D for each variant define.
+  std::vector<std::wstring> m_ExtraArguments;
+  std::vector<LPCWSTR> m_Arguments;
+
+public:
+  DXC_MICROCOM_TM_ADDREF_RELEASE_IMPL()
+  DXC_MICROCOM_TM_CTOR(DxcParsedArguments)
+  HRESULT STDMETHODCALLTYPE QueryInterface(REFIID iid, void **ppvObject) override {
+    return DoBasicQueryInterface<IDxcParsedArguments, DxcParsedArguments>(
+        this, iid, ppvObject);
+  }
+
+  void Initialize(std::shared_ptr<const DxcParsedOptions> pOptions,
+                  std::vector<std::string> extraDefines) {
+    m_pOptions = std::move(pOptions);
+    m_ExtraDefines = std::move(extraDefines);
+    for (const std::string &define : m_ExtraDefines) {
+      CA2W wideDefine(define.c_str(), CP_UTF8);
+      m_ExtraArguments.emplace_back(L"-D");
+      m_ExtraArguments.emplace_back(wideDefine.m_psz);
+    }
+    for (const std::wstring &arg : m_pOptions->Arguments)
+      m_Arguments.push_back(arg.c_str());
+    for (const std::wstring &arg : m_ExtraArguments)
+      m_Arguments.push_back(arg.c_str());
+  }
+
+  const DxcParsedOptions &GetOptions() const { return *m_pOptions; }
+  ArrayRef<std::string> GetExtraDefines() const { return m_ExtraDefines; }
+
+  LPCWSTR* STDMETHODCALLTYPE GetArguments() override {
+    return m_Arguments.data();
+  }
+  UINT32 STDMETHODCALLTYPE GetCount() override {
+    return static_cast<UINT32>(m_Arguments.size());
+  }
+
+  HRESULT STDMETHODCALLTYPE CreateVariant(
+    _In_count_(defineCount) const DxcDefine *pDefines,
+    _In_ UINT32 defineCount,
+    _COM_Outptr_ IDxcParsedArguments **ppResult) override {
+    if (ppResult == nullptr || (defineCount > 0 && pDefines == nullptr))
+      return E_INVALIDARG;
+    *ppResult = nullptr;
+    DxcThreadMalloc TM(m_pMalloc);
+    try {
+      std::vector<std::string> extraDefines = m_ExtraDefines;
+      CreateDefineStrings(pDefines, defineCount, extraDefines);
+      CComPtr<DxcParsedArguments> pVariant = DxcParsedArguments::Alloc(m_pMalloc);
+      IFROOM(pVariant.p);
+      pVariant->Initialize(m_pOptions, std::move(extraDefines));
+      *ppResult = pVariant.Detach();
+      return S_OK;
+    }
+    CATCH_CPP_RETURN_HRESULT();
+  }
+};
+
 static HRESULT ErrorWithString(const std::string &error, REFIID riid, void **ppResult) {
   CComPtr<IDxcResult> pResult;
   IFT(DxcResult::Create(E_FAIL, DXC_OUT_NONE,
@@ -574,7 +1096,42 @@ static HRESULT ErrorWithString(const std::string &error, REFIID riid, void **ppR
   return S_OK;
 }
 
-class DxcCompiler : public IDxcCompiler3,
+// Yield callback that aborts a compile once its -Qdeadline has passed.
+static void CheckCompileDeadline(llvm::LLVMContext *, void *pDeadline) {
+  if (std::chrono::steady_clock::now() >
+      *(const std::chrono::steady_clock::time_point *)pDeadline)
+    throw hlsl::Exception(E_ABORT,
+                          "compilation exceeded the -Qdeadline time limit");
+}
+
+// If the compile failed because it went over its -Qmemory-limit, lifts the
+// limit and returns a result that says so, in place of a plain out of memory
+// failure.
+static bool HitMemoryLimit(MemoryMeasurementSession &memory,
+                           const hlsl::options::DxcOpts &opts, REFIID riid,
+                           LPVOID *ppResult) {
+  MeasuringMalloc *pMalloc = memory.GetMalloc();
+  if (pMalloc == nullptr || !pMalloc->LimitExceeded())
+    return false;
+  pMalloc->SetLimit(0);
+  try {
+    std::string msg = "error: compilation exceeded the -Qmemory-limit of " +
+                      std::to_string(opts.MemoryLimitMB) + " MB";
+    CComPtr<IDxcResult> pResult;
+    return SUCCEEDED(DxcResult::Create(
+               E_OUTOFMEMORY, DXC_OUT_NONE,
+               {DxcOutputObject::ErrorOutput(CP_UTF8, msg.c_str(),
+                                             msg.size())},
+               &pResult)) &&
+           SUCCEEDED(pResult->QueryInterface(riid, ppResult));
+  } catch (...) {
+    return false;
+  }
+}
+
+class DxcCompiler : public IDxcCompiler9,
+                    public IDxcCompilerCache,
+                    public IDxcContextPool,
                     public IDxcLangExtensions3,
                     public IDxcContainerEvent,
                     public IDxcVersionInfo3,
@@ -586,31 +1143,162 @@ class DxcCompiler : public IDxcCompiler3,
 {
 private:
   DXC_MICROCOM_TM_REF_FIELDS()
-  DxcLangExtensionsHelper m_langExtensionsHelper;
-  CComPtr<IDxcContainerEventsHandler> m_pDxcContainerEventsHandler;
+
+  // Settings that apply to every compile. A published configuration is never
+  // modified: each compile takes the current one when it starts and reads it
+  // without locking, while updates copy it, change the copy and publish that.
+  // This lets one compiler object serve concurrent compiles.
+  struct Configuration {
+    DxcLangExtensionsHelper LangExtensions;
+    CComPtr<IDxcContainerEventsHandler> ContainerEventsHandler;
+  };
+  typedef std::shared_ptr<Configuration> ConfigurationPtr;
+  ConfigurationPtr m_pConfig;
+  std::mutex m_ConfigUpdateLock;
   DxcCompilerAdapter m_DxcCompilerAdapter;
+  dxcutil::DxcCompileCache m_CompileCache;
+  dxcutil::DxcContextPool m_ContextPool;
+  dxcutil::DxcLibPartitionCache m_LibPartitionCache;
+
+  ConfigurationPtr GetConfiguration() { return std::atomic_load(&m_pConfig); }
+
+  template <typename TUpdate> HRESULT UpdateConfiguration(TUpdate update) {
+    try {
+      std::lock_guard<std::mutex> lock(m_ConfigUpdateLock);
+      ConfigurationPtr pUpdated = std::make_shared<Configuration>(*m_pConfig);
+      HRESULT hr = update(*pUpdated);
+      if (SUCCEEDED(hr))
+        std::atomic_store(&m_pConfig, pUpdated);
+      return hr;
+    }
+    CATCH_CPP_RETURN_HRESULT();
+  }
+  template <typename TUpdate> HRESULT UpdateLangExtensions(TUpdate update) {
+    return UpdateConfiguration(
+        [&](Configuration &config) { return update(config.LangExtensions); });
+  }
+
+  // Language extensions can change the output in ways that a cache key
+  // cannot capture, so nothing is cached for compiles that use them.
+  static bool HasLangExtensions(Configuration &config) {
+    DxcLangExtensionsHelper &langExtensions = config.LangExtensions;
+    return !langExtensions.GetSemanticDefines().empty() ||
+           !langExtensions.GetSemanticDefineExclusions().empty() ||
+           !langExtensions.GetNonOptSemanticDefines().empty() ||
+           !langExtensions.GetDefines().empty() ||
+           !langExtensions.GetIntrinsicTables().empty();
+  }
+
+  // Container event handlers can change the output too.
+  bool IsCompileCacheable(Configuration &config) {
+    return m_CompileCache.IsEnabled() && !config.ContainerEventsHandler &&
+           !HasLangExtensions(config);
+  }
+
+  std::string ComputeCompileCacheKey(Configuration &config,
+                                     const DxcBuffer *pSource,
+                                     const hlsl::options::DxcOpts &opts,
+                                     ArrayRef<std::string> extraDefines) {
+    std::string keyData;
+    raw_string_ostream key(keyData);
+    WriteCompileOptionsKey(key, config, opts, extraDefines);
+    key << pSource->Encoding << '\0';
+    key << StringRef((const char *)pSource->Ptr, pSource->Size);
+    key.flush();
+    return dxcutil::DxcCompileCache::HashString(keyData);
+  }
+
+  // Writes everything but the source that can affect the output of a
+  // compile: the compiler and validator versions and the arguments.
+  static void WriteCompileOptionsKey(raw_ostream &key, Configuration &config,
+                                     const hlsl::options::DxcOpts &opts,
+                                     ArrayRef<std::string> extraDefines) {
+    key << RC_FILE_VERSION << '\0';
+#ifdef SUPPORT_QUERY_GIT_COMMIT_INFO
+    key << getGitCommitHash() << '\0';
+#endif // SUPPORT_QUERY_GIT_COMMIT_INFO
+    unsigned valMajor = opts.ValVerMajor, valMinor = opts.ValVerMinor;
+    if (valMajor == UINT_MAX)
+      dxcutil::GetValidatorVersion(&valMajor, &valMinor);
+    key << valMajor << '.' << valMinor << (DxilLibIsEnabled() ? "+dxil" : "")
+        << '\0';
+    key << config.LangExtensions.GetTargetTriple() << '\0';
+    // Rendering each parsed argument normalizes aliases and spellings,
+    // so that -Zi and /Zi, or -DX and -D X, produce the same key.
+    for (const llvm::opt::Arg *A : opts.Args)
+      key << A->getAsString(opts.Args) << '\0';
+    for (const std::string &define : extraDefines)
+      key << "-D" << define << '\0';
+  }
+
+  void StoreCompileCacheResult(StringRef cacheKey,
+                               dxcutil::DxcArgsFileSystem *msfPtr,
+                               IDxcIncludeHandler *pIncludeHandler,
+                               const hlsl::options::DxcOpts &opts,
+                               IDxcResult *pResult) {
+    typedef dxcutil::DxcCompileCache::Dependency Dependency;
+    std::vector<Dependency> deps;
+    msfPtr->EnumerateIncludeLookups([&deps](LPCWSTR pName, IDxcBlobUtf8 *pBlob) {
+      Dependency dep;
+      dep.Name = pName;
+      if (pBlob) {
+        dep.Found = true;
+        dep.Digest = dxcutil::DxcCompileCache::HashData(
+            pBlob->GetStringPointer(), pBlob->GetStringLength());
+      }
+      deps.push_back(std::move(dep));
+    });
+    // Files loaded directly through the include handler by Compile.
+    for (StringRef file : { opts.RootSignatureSource, opts.PrivateSource,
+                            opts.ImportBindingTable, opts.ProfileUse }) {
+      if (file.empty())
+        continue;
+      hlsl::options::StringRefWide wstrRef(file);
+      deps.emplace_back();
+      dxcutil::DxcCompileCache::LoadDependency(
+          pIncludeHandler, wstrRef, opts.DefaultTextCodePage, deps.back());
+    }
+    m_CompileCache.Store(cacheKey, std::move(deps), pResult);
+  }
 
 public:
-  DxcCompiler(IMalloc *pMalloc) : m_dwRef(0), m_pMalloc(pMalloc), m_DxcCompilerAdapter(this, pMalloc) {}
+  DxcCompiler(IMalloc *pMalloc)
+      : m_dwRef(0), m_pMalloc(pMalloc),
+        m_pConfig(std::make_shared<Configuration>()),
+        m_DxcCompilerAdapter(this, pMalloc) {}
   DXC_MICROCOM_TM_ADDREF_RELEASE_IMPL()
   DXC_MICROCOM_TM_ALLOC(DxcCompiler)
-  DXC_LANGEXTENSIONS_HELPER_IMPL(m_langExtensionsHelper)
+  DXC_LANGEXTENSIONS_HELPER_UPDATE_IMPL(UpdateLangExtensions)
 
   HRESULT STDMETHODCALLTYPE RegisterDxilContainerEventHandler(IDxcContainerEventsHandler *pHandler, UINT64 *pCookie) override {
-    DXASSERT(m_pDxcContainerEventsHandler == nullptr, "else events handler is already registered");
+    DxcThreadMalloc TM(m_pMalloc);
     *pCookie = 1; // Only one EventsHandler supported
-    m_pDxcContainerEventsHandler = pHandler;
-    return S_OK;
+    return UpdateConfiguration([&](Configuration &config) {
+      DXASSERT(config.ContainerEventsHandler == nullptr, "else events handler is already registered");
+      config.ContainerEventsHandler = pHandler;
+      return S_OK;
+    });
   };
   HRESULT STDMETHODCALLTYPE UnRegisterDxilContainerEventHandler(UINT64 cookie) override {
-    DXASSERT(m_pDxcContainerEventsHandler != nullptr, "else unregister should not have been called");
-    m_pDxcContainerEventsHandler.Release();
-    return S_OK;
+    DxcThreadMalloc TM(m_pMalloc);
+    return UpdateConfiguration([&](Configuration &config) {
+      DXASSERT(config.ContainerEventsHandler != nullptr, "else unregister should not have been called");
+      config.ContainerEventsHandler.Release();
+      return S_OK;
+    });
   }
 
   HRESULT STDMETHODCALLTYPE QueryInterface(REFIID iid, void **ppvObject) override {
     HRESULT hr = DoBasicQueryInterface<
       IDxcCompiler3,
+      IDxcCompiler4,
+      IDxcCompiler5,
+      IDxcCompiler6,
+      IDxcCompiler7,
+      IDxcCompiler8,
+      IDxcCompiler9,
+      IDxcCompilerCache,
+      IDxcContextPool,
       IDxcLangExtensions,
       IDxcLangExtensions2,
       IDxcLangExtensions3,
@@ -645,48 +1333,217 @@ public:
 
     *ppResult = nullptr;
 
+    DxcThreadMalloc TM(m_pMalloc);
+    try {
+      // Parse command-line options into DxcOpts
+      int argCountInt;
+      IFT(UIntToInt(argCount, &argCountInt));
+      hlsl::options::MainArgs mainArgs(argCountInt, pArguments, 0);
+      hlsl::options::DxcOpts opts;
+      std::string optionWarnings;
+      CComPtr<IDxcOperationResult> pOptionsResult;
+      if (!ParseCompileOptions(mainArgs, opts, optionWarnings, &pOptionsResult))
+        return pOptionsResult->QueryInterface(riid, ppResult);
+      return CompileWithOptions(pSource, opts, optionWarnings, pArguments,
+                                argCount, {}, /*highLevelSource*/ false,
+                                pIncludeHandler, riid, ppResult);
+    }
+    CATCH_CPP_RETURN_HRESULT();
+  }
+
+  // Parses and validates compile arguments into opts, and any option
+  // warnings into warnings. Returns false, with the result for the caller in
+  // ppResult, if the arguments are invalid or only asked for help.
+  bool ParseCompileOptions(hlsl::options::MainArgs &mainArgs,
+                           hlsl::options::DxcOpts &opts, std::string &warnings,
+                           _COM_Outptr_ IDxcOperationResult **ppResult) {
+    *ppResult = nullptr;
+    bool finished = false;
+    CComPtr<AbstractMemoryStream> pOptionErrorStream;
+    IFT(CreateMemoryStream(m_pMalloc, &pOptionErrorStream));
+    dxcutil::ReadOptsAndValidate(mainArgs, opts, pOptionErrorStream, ppResult, finished);
+    if (finished)
+      return false;
+    warnings.assign((const char *)pOptionErrorStream->GetPtr(),
+                    (size_t)pOptionErrorStream->GetPtrSize());
+    return true;
+  }
+
+  // Compiles pSource with options that are already parsed and validated.
+  // opts is not modified, so one parse can be shared by concurrent compiles.
+  // pArguments are the arguments opts was parsed from, and extraDefines are
+  // "name=value" defines applied after the ones in opts.
+#ifdef ENABLE_SPIRV_CODEGEN
+  // Compiles pSource for D3D12 and Vulkan concurrently, as two Compile calls
+  // without -Fspv, one of them with -spirv. Returns the DXIL result with the
+  // SPIR-V module added as DXC_OUT_SPIRV and the SPIR-V compile's messages
+  // after its own. The targets parse with different language options, so
+  // each runs its own front end; they share the loaded include files.
+  HRESULT CompileDualTarget(_In_ const DxcBuffer *pSource,
+                            const hlsl::options::DxcOpts &opts,
+                            _In_opt_count_(argCount) LPCWSTR *pArguments,
+                            _In_ UINT32 argCount,
+                            _In_opt_ IDxcIncludeHandler *pIncludeHandler,
+                            _In_ REFIID riid, _Out_ LPVOID *ppResult) {
+    DxcThreadMalloc TM(m_pMalloc);
+    try {
+      // Drop -Fspv and its file from the arguments; parsed option indices
+      // match pArguments, which may carry extra defines after them.
+      std::vector<bool> dropped(argCount, false);
+      for (const llvm::opt::Arg *A : opts.Args.filtered(options::OPT_Fspv)) {
+        for (unsigned i = A->getIndex(); i <= A->getIndex() + 1 && i < argCount; ++i)
+          dropped[i] = true;
+      }
+      std::vector<LPCWSTR> targetArgs[2];
+      for (UINT32 i = 0; i < argCount; ++i) {
+        if (!dropped[i])
+          targetArgs[0].push_back(pArguments[i]);
+      }
+      targetArgs[1] = targetArgs[0];
+      targetArgs[1].push_back(L"-spirv");
+
+      CComPtr<IDxcIncludeHandler> pSharedIncludeHandler;
+      IFT(dxcutil::CreateSharedIncludeHandler(m_pMalloc, pIncludeHandler,
+                                              &pSharedIncludeHandler));
+      CComPtr<IDxcResult> pTargetResults[2];
+      HRESULT targetHRs[2] = { E_FAIL, E_FAIL };
+      RunConcurrently(2, [&](UINT32 i) {
+        targetHRs[i] = Compile(pSource, targetArgs[i].data(),
+                               (UINT32)targetArgs[i].size(),
+                               pSharedIncludeHandler,
+                               IID_PPV_ARGS(&pTargetResults[i]));
+      });
+      IFT(targetHRs[0]);
+      IFT(targetHRs[1]);
+      IDxcResult *pDxil = pTargetResults[0];
+      IDxcResult *pSpirv = pTargetResults[1];
+
+      HRESULT dxilStatus, spirvStatus;
+      IFT(pDxil->GetStatus(&dxilStatus));
+      IFT(pSpirv->GetStatus(&spirvStatus));
+
+      CComPtr<DxcResult> pResult = DxcResult::Alloc(m_pMalloc);
+      IFTOOM(pResult.p);
+      IFT(pResult->SetEncoding(opts.DefaultTextCodePage));
+      for (unsigned i = DXC_OUT_NONE + 1; i <= kNumDxcOutputTypes; ++i) {
+        DXC_OUT_KIND kind = (DXC_OUT_KIND)i;
+        if (kind == DXC_OUT_ERRORS || !pDxil->HasOutput(kind))
+          continue;
+        DxcOutputObject object;
+        IFT(pDxil->GetOutput(kind, IID_PPV_ARGS(&object.object), &object.name));
+        object.kind = kind;
+        IFT(pResult->SetOutput(object));
+      }
+
+      std::string messages;
+      for (IDxcResult *pTarget : { pDxil, pSpirv }) {
+        CComPtr<IDxcBlobEncoding> pErrors;
+        IFT(pTarget->GetErrorBuffer(&pErrors));
+        if (IsBlobNullOrEmpty(pErrors))
+          continue;
+        CComPtr<IDxcBlobUtf8> pErrorsUtf8;
+        IFT(hlsl::DxcGetBlobAsUtf8(pErrors, m_pMalloc, &pErrorsUtf8));
+        messages.append(pErrorsUtf8->GetStringPointer(),
+                        pErrorsUtf8->GetStringLength());
+      }
+      IFT(pResult->SetOutputString(DXC_OUT_ERRORS, messages.c_str(),
+                                   messages.size()));
+      IFT(pResult->SetOutputName(DXC_OUT_ERRORS, opts.OutputWarningsFile));
+
+      if (SUCCEEDED(spirvStatus)) {
+        CComPtr<IDxcBlob> pSpirvModule;
+        IFT(pSpirv->GetResult(&pSpirvModule));
+        IFT(pResult->SetOutputObject(DXC_OUT_SPIRV, pSpirvModule));
+        IFT(pResult->SetOutputName(DXC_OUT_SPIRV, opts.OutputSpirvFile));
+      }
+      IFT(pResult->SetStatusAndPrimaryResult(
+          FAILED(dxilStatus) ? dxilStatus : spirvStatus,
+          pDxil->PrimaryOutput()));
+      IFT(pResult->QueryInterface(riid, ppResult));
+      return S_OK;
+    }
+    CATCH_CPP_RETURN_HRESULT();
+  }
+#endif // ENABLE_SPIRV_CODEGEN
+
+  HRESULT CompileWithOptions(
+    _In_ const DxcBuffer *pSource,
+    const hlsl::options::DxcOpts &opts,
+    StringRef optionWarnings,
+    _In_opt_count_(argCount) LPCWSTR *pArguments,
+    _In_ UINT32 argCount,
+    ArrayRef<std::string> extraDefines,
+    bool highLevelSource,
+    _In_opt_ IDxcIncludeHandler *pIncludeHandler,
+    _In_ REFIID riid, _Out_ LPVOID *ppResult) {
+    *ppResult = nullptr;
+
+#ifdef ENABLE_SPIRV_CODEGEN
+    if (!opts.OutputSpirvFile.empty())
+      return CompileDualTarget(pSource, opts, pArguments, argCount,
+                               pIncludeHandler, riid, ppResult);
+#endif // ENABLE_SPIRV_CODEGEN
+
     HRESULT hr = S_OK;
     CComPtr<IDxcBlobUtf8> utf8Source;
     CComPtr<AbstractMemoryStream> pOutputStream;
-    CComPtr<IDxcOperationResult> pDxcOperationResult;
     bool bCompileStarted = false;
     bool bPreprocessStarted = false;
     DxilShaderHash ShaderHashContent;
     DxcThreadMalloc TM(m_pMalloc);
+    ConfigurationPtr pConfig = GetConfiguration();
+    TimeTraceSession timeTrace;
+    MemoryMeasurementSession memoryMeasurement;
+    PassReportSession passReport;
+    // -Qdeadline counts from here. Through the yield callback of the context,
+    // LLVM checks it between passes and CodeGen between top-level decls.
+    std::chrono::steady_clock::time_point deadline =
+        opts.DeadlineMs ? std::chrono::steady_clock::now() +
+                              std::chrono::milliseconds(opts.DeadlineMs)
+                        : std::chrono::steady_clock::time_point::max();
 
     try {
       DefaultFPEnvScope fpEnvScope;
 
       IFT(CreateMemoryStream(m_pMalloc, &pOutputStream));
 
-      // Parse command-line options into DxcOpts
-      int argCountInt;
-      IFT(UIntToInt(argCount, &argCountInt));
-      hlsl::options::MainArgs mainArgs(argCountInt, pArguments, 0);
-      hlsl::options::DxcOpts opts;
       std::string warnings;
       raw_string_ostream w(warnings);
-      {
-        bool finished = false;
-        CComPtr<AbstractMemoryStream> pOptionErrorStream;
-        IFT(CreateMemoryStream(m_pMalloc, &pOptionErrorStream));
-        dxcutil::ReadOptsAndValidate(mainArgs, opts, pOptionErrorStream, &pDxcOperationResult, finished);
-        if (finished) {
-          IFT(pDxcOperationResult->QueryInterface(riid, ppResult));
+      w << optionWarnings;
+
+      // A cached result has no timings or reports, so traced and reported
+      // compiles always run.
+      std::string cacheKey;
+      if (IsCompileCacheable(*pConfig) && !opts.TimeTrace && !opts.PassReport &&
+          !opts.MemoryReport && !opts.PerfReport) {
+        cacheKey = ComputeCompileCacheKey(*pConfig, pSource, opts, extraDefines);
+        CComPtr<IDxcResult> pCachedResult;
+        if (m_CompileCache.Lookup(cacheKey, pIncludeHandler,
+                                  opts.DefaultTextCodePage, &pCachedResult)) {
+          IFT(pCachedResult->QueryInterface(riid, ppResult));
           hr = S_OK;
           goto Cleanup;
         }
-        if (pOptionErrorStream->GetPtrSize() > 0) {
-          w << StringRef((const char*)pOptionErrorStream->GetPtr(), (size_t)pOptionErrorStream->GetPtrSize());
-        }
       }
 
       bool isPreprocessing = !opts.Preprocess.empty();
+      if (opts.TimeTrace)
+        timeTrace.Start();
+      if (opts.PassReport)
+        passReport.Start(memoryMeasurement);
+      if (opts.MemoryReport)
+        memoryMeasurement.Start();
+      if (opts.MemoryLimitMB && memoryMeasurement.GetMalloc())
+        memoryMeasurement.GetMalloc()->SetLimit(uint64_t(opts.MemoryLimitMB)
+                                                << 20);
+      llvm::Optional<llvm::TimeTraceScope> compileTrace;
       if (isPreprocessing) {
         DxcEtw_DXCompilerPreprocess_Start();
+        compileTrace.emplace("Preprocess");
         bPreprocessStarted = true;
       } else {
         DxcEtw_DXCompilerCompile_Start();
+        compileTrace.emplace("Compile");
         bCompileStarted = true;
       }
 
@@ -764,6 +1621,10 @@ public:
       IFT(pResult->SetOutputName(DXC_OUT_SHADER_HASH, opts.OutputShaderHashFile));
       IFT(pResult->SetOutputName(DXC_OUT_ERRORS, opts.OutputWarningsFile));
       IFT(pResult->SetOutputName(DXC_OUT_ROOT_SIGNATURE, opts.OutputRootSigFile));
+      IFT(pResult->SetOutputName(DXC_OUT_TIME_TRACE, opts.TimeTraceFile));
+      IFT(pResult->SetOutputName(DXC_OUT_PASS_REPORT, opts.PassReportFile));
+      IFT(pResult->SetOutputName(DXC_OUT_MEMORY_REPORT, opts.MemoryReportFile));
+      IFT(pResult->SetOutputName(DXC_OUT_PERF_REPORT, opts.PerfReportFile));
 
       if (opts.DisplayIncludeProcess)
         msfPtr->EnableDisplayIncludeProcess();
@@ -777,16 +1638,23 @@ public:
       // Not very efficient but also not very important.
       std::vector<std::string> defines;
       CreateDefineStrings(opts.Defines.data(), opts.Defines.size(), defines);
+      defines.insert(defines.end(), extraDefines.begin(), extraDefines.end());
 
       // Setup a compiler instance.
       raw_stream_ostream outStream(pOutputStream.p);
-      llvm::LLVMContext llvmContext; // LLVMContext should outlive CompilerInstance
+      // LLVMContext should outlive CompilerInstance
+      dxcutil::PooledLLVMContext pooledContext(m_ContextPool);
+      llvm::LLVMContext &llvmContext = pooledContext.get();
+      if (opts.DeadlineMs)
+        llvmContext.setYieldCallback(CheckCompileDeadline, &deadline);
       std::unique_ptr<llvm::Module> debugModule;
       CComPtr<AbstractMemoryStream> pReflectionStream;
       CompilerInstance compiler;
       std::unique_ptr<TextDiagnosticPrinter> diagPrinter =
           llvm::make_unique<TextDiagnosticPrinter>(w, &compiler.getDiagnosticOpts());
-      SetupCompilerForCompile(compiler, &m_langExtensionsHelper, pUtf8SourceName, diagPrinter.get(), defines, opts, pArguments, argCount);
+      SetupCompilerForCompile(compiler, &pConfig->LangExtensions, pUtf8SourceName, diagPrinter.get(), defines, opts, pArguments, argCount);
+      for (const std::string &define : extraDefines)
+        compiler.getCodeGenOpts().HLSLArguments.emplace_back("-D" + define);
       msfPtr->SetupForCompilerInstance(compiler);
 
       // The clang entry point (cc1_main) would now create a compiler invocation
@@ -808,6 +1676,7 @@ public:
       // validator can be used as a fallback.
       bool produceFullContainer = false;
       bool needsValidation = false;
+      bool keepReflectionInDxil = opts.KeepReflectionInDxil;
       bool validateRootSigContainer = false;
 
       if (isPreprocessing) {
@@ -896,6 +1765,32 @@ public:
           }
         }
 
+        if (opts.ProfileUse.size()) {
+          hlsl::options::StringRefWide wstrRef(opts.ProfileUse);
+          CComPtr<IDxcBlob> pBlob;
+          std::string error;
+          llvm::raw_string_ostream os(error);
+          if (!pIncludeHandler) {
+            os << Twine("Block profile file '") + opts.ProfileUse + "' specified, but no include handler was given.";
+            os.flush();
+            return ErrorWithString(error, riid, ppResult);
+          }
+          else if (SUCCEEDED(pIncludeHandler->LoadSource(wstrRef, &pBlob))) {
+            bool succ = ParseBlockProfile(
+              opts.ProfileUse,
+              StringRef((const char *)pBlob->GetBufferPointer(), pBlob->GetBufferSize()),
+              os, &compiler.getCodeGenOpts().HLSLBlockProfile);
+
+            if (!succ)
+              return ErrorWithString(error, riid, ppResult);
+          }
+          else {
+            os << Twine("Could not load block profile file '") + opts.ProfileUse + "'.";
+            os.flush();
+            return ErrorWithString(error, riid, ppResult);
+          }
+        }
+
         if (compiler.getCodeGenOpts().HLSLProfile == "rootsig_1_1") {
           rootSigMajor = 1;
           rootSigMinor = 1;
@@ -919,7 +1814,7 @@ public:
 
         if (compiler.getCodeGenOpts().HLSLProfile == "lib_6_x") {
           // Currently do not support stripping reflection from offline linking target.
-          opts.KeepReflectionInDxil = true;
+          keepReflectionInDxil = true;
         }
 
         if (opts.ValVerMajor != UINT_MAX) {
@@ -949,6 +1844,10 @@ public:
         dumpAction.EndSourceFile();
         outStream.flush();
       } else if (opts.DumpDependencies) {
+        // With -Mscan, the preprocessor only sees the directives of each
+        // file, which is all that decides what gets included.
+        if (opts.ScanDependencies)
+          msfPtr->EnableDirectivesOnly();
         auto dependencyCollector = std::make_shared<DependencyCollector>();
         compiler.addDependencyCollector(dependencyCollector);
         compiler.createPreprocessor(clang::TranslationUnitKind::TU_Complete);
@@ -956,21 +1855,35 @@ public:
         clang::PreprocessOnlyAction preprocessAction;
         FrontendInputFile file(pUtf8SourceName, IK_HLSL);
         preprocessAction.BeginSourceFile(compiler, file);
+        IncludeGraphCollector *includeGraph = nullptr;
+        if (opts.DependencyGraphJson && compiler.hasPreprocessor()) {
+          includeGraph = new IncludeGraphCollector(compiler.getSourceManager());
+          compiler.getPreprocessor().addPPCallbacks(
+              std::unique_ptr<PPCallbacks>(includeGraph));
+        }
         preprocessAction.Execute();
-        preprocessAction.EndSourceFile();
 
-        outStream << (opts.OutputObject.empty() ? opts.InputFile
-                                                : opts.OutputObject);
-        bool firstDependency = true;
-        for (auto &dependency : dependencyCollector->getDependencies()) {
-          if (firstDependency) {
-            outStream << ": " << dependency;
-            firstDependency = false;
-            continue;
+        StringRef target = opts.OutputObject.empty() ? opts.InputFile
+                                                     : opts.OutputObject;
+        if (includeGraph != nullptr) {
+          WriteDependencyGraphJson(outStream, target,
+                                   dependencyCollector->getDependencies(),
+                                   includeGraph->Edges);
+        } else if (!opts.DependencyGraphJson) {
+          WriteMakePath(outStream, target);
+          bool firstDependency = true;
+          for (auto &dependency : dependencyCollector->getDependencies()) {
+            if (firstDependency) {
+              outStream << ": ";
+              firstDependency = false;
+            } else {
+              outStream << " \\\n ";
+            }
+            WriteMakePath(outStream, dependency);
           }
-          outStream << " \\\n " << dependency;
+          outStream << "\n";
         }
-        outStream << "\n";
+        preprocessAction.EndSourceFile();
         outStream.flush();
       } else if (opts.OptDump) {
         EmitOptDumpAction action(&llvmContext);
@@ -1014,16 +1927,19 @@ public:
         // Since SpirvOptions is passed to the SPIR-V CodeGen as a whole
         // structure, we need to copy a few non-spirv-specific options into the
         // structure.
-        opts.SpirvOptions.enable16BitTypes = opts.Enable16BitTypes;
-        opts.SpirvOptions.codeGenHighLevel = opts.CodeGenHighLevel;
-        opts.SpirvOptions.defaultRowMajor = opts.DefaultRowMajor;
-        opts.SpirvOptions.disableValidation = opts.DisableValidation;
+        clang::spirv::SpirvCodeGenOptions spirvOptions = opts.SpirvOptions;
+        spirvOptions.enable16BitTypes = opts.Enable16BitTypes;
+        spirvOptions.codeGenHighLevel = opts.CodeGenHighLevel;
+        spirvOptions.defaultRowMajor = opts.DefaultRowMajor;
+        spirvOptions.disableValidation = opts.DisableValidation;
+        spirvOptions.deadline = deadline;
         // Store a string representation of command line options.
         if (opts.DebugInfo)
-          for (auto opt : mainArgs.getArrayRef())
-            opts.SpirvOptions.clOptions += " " + std::string(opt);
+          for (unsigned i = 0; i != opts.Args.getNumInputArgStrings(); ++i)
+            spirvOptions.clOptions +=
+                " " + std::string(opts.Args.getArgString(i));
 
-        compiler.getCodeGenOpts().SpirvOptions = opts.SpirvOptions;
+        compiler.getCodeGenOpts().SpirvOptions = spirvOptions;
         clang::EmitSpirvAction action;
         FrontendInputFile file(pUtf8SourceName, IK_HLSL);
         action.BeginSourceFile(compiler, file);
@@ -1034,8 +1950,30 @@ public:
 #endif
       // SPIRV change ends
       else if (!isPreprocessing) {
+        // The offline target is linked later anyway, and libraries before
+        // 6.3 cannot call functions of other libraries.
+        const ShaderModel *SM =
+            ShaderModel::GetByName(opts.TargetProfile.str().c_str());
+        if (opts.LibIncremental && !opts.CodeGenHighLevel && SM->IsLib() &&
+            SM->IsSM63Plus() && opts.TargetProfile != "lib_6_x" &&
+            !HasLangExtensions(*pConfig)) {
+          std::string fingerprint;
+          raw_string_ostream fingerprintOS(fingerprint);
+          WriteCompileOptionsKey(fingerprintOS, *pConfig, opts, extraDefines);
+          fingerprintOS.flush();
+          compiler.getCodeGenOpts().HLSLBackendRunner =
+              std::make_shared<dxcutil::DxcIncrementalLibRunner>(
+                  m_LibPartitionCache,
+                  dxcutil::DxcCompileCache::HashString(fingerprint),
+                  opts.TargetProfile,
+                  compiler.getCodeGenOpts().HLSLValidatorMajorVer,
+                  compiler.getCodeGenOpts().HLSLValidatorMinorVer);
+        }
+
         EmitBCAction action(&llvmContext);
-        FrontendInputFile file(pUtf8SourceName, IK_HLSL);
+        // A high-level module from a snapshot only runs the backend.
+        FrontendInputFile file(pUtf8SourceName,
+                               highLevelSource ? IK_LLVM_IR : IK_HLSL);
         bool compileOK;
         if (action.BeginSourceFile(compiler, file)) {
           action.Execute();
@@ -1067,7 +2005,10 @@ public:
           // Implies name part
           SerializeFlags |= SerializeDxilFlags::IncludeDebugNamePart;
         }
-        if (!opts.KeepReflectionInDxil) {
+        if (opts.FastShaderHash) {
+          SerializeFlags |= SerializeDxilFlags::FastShaderHash;
+        }
+        if (!keepReflectionInDxil) {
           SerializeFlags |= SerializeDxilFlags::StripReflectionFromDxilPart;
         }
         if (!opts.StripReflection) {
@@ -1118,11 +2059,22 @@ public:
         if (compileOK && !opts.CodeGenHighLevel) {
           HRESULT valHR = S_OK;
           CComPtr<AbstractMemoryStream> pRootSigStream;
-          IFT(CreateMemoryStream(DxcGetThreadMallocNoRef(), &pReflectionStream));
+          // -Odev only builds the reflection output when it is asked for.
+          if (!opts.FastDevBuild || !opts.OutputReflectionFile.empty() ||
+              opts.SourceOnlyDebug)
+            IFT(CreateMemoryStream(DxcGetThreadMallocNoRef(), &pReflectionStream));
           IFT(CreateMemoryStream(DxcGetThreadMallocNoRef(), &pRootSigStream));
 
           std::unique_ptr<llvm::Module> serializeModule( action.takeModule() );
 
+          if (opts.PerfReport) {
+            std::string reportJson;
+            raw_string_ostream reportOS(reportJson);
+            hlsl::WriteDxilPerfReport(*serializeModule, reportOS);
+            reportOS.flush();
+            IFT(pResult->SetOutputString(DXC_OUT_PERF_REPORT, reportJson.c_str(), reportJson.size()));
+          }
+
           // Clone and save the copy.
           if (opts.GenerateFullDebugInfo()) {
             debugModule.reset(llvm::CloneModule(serializeModule.get()));
@@ -1133,6 +2085,8 @@ public:
               SerializeFlags, pOutputStream, opts.GetPDBName(),
               &compiler.getDiagnostics(), &ShaderHashContent, pReflectionStream,
               pRootSigStream, pRootSignatureBlob, pPrivateBlob);
+          // Validation can use the debug copy rather than cloning again.
+          inputs.pDebugModule = debugModule.get();
 
           if (needsValidation) {
             valHR = dxcutil::ValidateAndAssembleToContainer(inputs);
@@ -1143,8 +2097,8 @@ public:
           // Callback after valid DXIL is produced
           if (SUCCEEDED(valHR)) {
             CComPtr<IDxcBlob> pTargetBlob;
-            if (m_pDxcContainerEventsHandler != nullptr) {
-              HRESULT hr = m_pDxcContainerEventsHandler->OnDxilContainerBuilt(pOutputBlob, &pTargetBlob);
+            if (pConfig->ContainerEventsHandler != nullptr) {
+              HRESULT hr = pConfig->ContainerEventsHandler->OnDxilContainerBuilt(pOutputBlob, &pTargetBlob);
               if (SUCCEEDED(hr) && pTargetBlob != nullptr) {
                 std::swap(pOutputBlob, pTargetBlob);
               }
@@ -1186,6 +2140,12 @@ public:
 
       // Add std err to warnings.
       msfPtr->WriteStdErrToStream(w);
+      if (opts.DisplayIncludeProcess && compiler.hasPreprocessor()) {
+        HeaderSearch &headers = compiler.getPreprocessor().getHeaderSearchInfo();
+        w << "Skipped [" << headers.getNumSkippedIncludes()
+          << "] includes of #pragma once or guarded files\n";
+        w.flush();
+      }
       CComPtr<IStream> pErrorStream;
       msfPtr->GetStdOutpuHandleStream(&pErrorStream);
       CComPtr<IDxcBlob> pErrorBlob;
@@ -1207,6 +2167,7 @@ public:
       // SPIRV change ends
 
       if (!hasErrorOccurred && writePDB) {
+        llvm::TimeTraceScope pdbTrace("PDB");
         CComPtr<IDxcBlob> pStrippedContainer;
         {
           // Create the shader source information for PDB
@@ -1271,19 +2232,55 @@ public:
         } // PDB in private
       } // Write PDB
 
+      if (timeTrace.IsOwner()) {
+        compileTrace.reset();
+        std::string traceJson;
+        raw_string_ostream traceOS(traceJson);
+        llvm::timeTraceProfilerWrite(traceOS);
+        traceOS.flush();
+        IFT(pResult->SetOutputString(DXC_OUT_TIME_TRACE, traceJson.c_str(), traceJson.size()));
+      }
+
+      if (passReport.IsOwner()) {
+        std::string reportJson;
+        raw_string_ostream reportOS(reportJson);
+        llvm::passReportWrite(reportOS);
+        reportOS.flush();
+        IFT(pResult->SetOutputString(DXC_OUT_PASS_REPORT, reportJson.c_str(), reportJson.size()));
+      }
+
+      if (opts.MemoryReport && memoryMeasurement.GetMalloc()) {
+        compileTrace.reset();
+        std::string reportJson;
+        raw_string_ostream reportOS(reportJson);
+        memoryMeasurement.GetMalloc()->WriteReport(reportOS);
+        reportOS.flush();
+        IFT(pResult->SetOutputString(DXC_OUT_MEMORY_REPORT, reportJson.c_str(), reportJson.size()));
+      }
+
       IFT(primaryOutput.SetObject(pOutputBlob, opts.DefaultTextCodePage));
       IFT(pResult->SetOutput(primaryOutput));
       IFT(pResult->SetStatusAndPrimaryResult(hasErrorOccurred ? E_FAIL : S_OK, primaryOutput.kind));
+      if (!cacheKey.empty() && !hasErrorOccurred)
+        StoreCompileCacheResult(cacheKey, msfPtr, pIncludeHandler, opts, pResult);
       IFT(pResult->QueryInterface(riid, ppResult));
+      pooledContext.SetReusable();
 
       hr = S_OK;
     } catch (std::bad_alloc &) {
       hr = E_OUTOFMEMORY;
+      if (HitMemoryLimit(memoryMeasurement, opts, riid, ppResult))
+        hr = S_OK;
     } catch (hlsl::Exception &e) {
       _Analysis_assume_(DXC_FAILED(e.hr));
       CComPtr<IDxcResult> pResult;
       hr = e.hr;
-      std::string msg("Internal Compiler error: ");
+      if (e.hr == E_OUTOFMEMORY &&
+          HitMemoryLimit(memoryMeasurement, opts, riid, ppResult)) {
+        hr = S_OK;
+        goto Cleanup;
+      }
+      std::string msg(e.hr == E_ABORT ? "error: " : "Internal Compiler error: ");
       msg += e.msg;
       if (SUCCEEDED(DxcResult::Create(e.hr, DXC_OUT_NONE, {
               DxcOutputObject::ErrorOutput(CP_UTF8,
@@ -1305,6 +2302,770 @@ public:
     return hr;
   }
 
+  HRESULT STDMETHODCALLTYPE ParseArguments(
+    _In_opt_count_(argCount) LPCWSTR *pArguments,
+    _In_ UINT32 argCount,
+    _COM_Outptr_result_maybenull_ IDxcParsedArguments **ppArgs,
+    _COM_Outptr_result_maybenull_ IDxcResult **ppResult) override {
+    if (ppArgs == nullptr || ppResult == nullptr ||
+        (argCount > 0 && pArguments == nullptr))
+      return E_INVALIDARG;
+    *ppArgs = nullptr;
+    *ppResult = nullptr;
+
+    DxcThreadMalloc TM(m_pMalloc);
+    try {
+      int argCountInt;
+      IFT(UIntToInt(argCount, &argCountInt));
+      std::shared_ptr<DxcParsedOptions> pOptions =
+          std::make_shared<DxcParsedOptions>();
+      pOptions->Arguments.assign(pArguments, pArguments + argCount);
+      std::vector<LPCWSTR> argPtrs;
+      for (const std::wstring &arg : pOptions->Arguments)
+        argPtrs.push_back(arg.c_str());
+      pOptions->MainArgs =
+          hlsl::options::MainArgs(argCountInt, argPtrs.data(), 0);
+      CComPtr<IDxcOperationResult> pOptionsResult;
+      if (!ParseCompileOptions(pOptions->MainArgs, pOptions->Opts,
+                               pOptions->Warnings, &pOptionsResult))
+        return pOptionsResult->QueryInterface(ppResult);
+
+      CComPtr<DxcParsedArguments> pArgs = DxcParsedArguments::Alloc(m_pMalloc);
+      IFROOM(pArgs.p);
+      pArgs->Initialize(std::move(pOptions), {});
+      *ppArgs = pArgs.Detach();
+      return S_OK;
+    }
+    CATCH_CPP_RETURN_HRESULT();
+  }
+
+  HRESULT STDMETHODCALLTYPE CompileParsed(
+    _In_ const DxcBuffer *pSource,
+    _In_ IDxcParsedArguments *pArgs,
+    _In_opt_ IDxcIncludeHandler *pIncludeHandler,
+    _In_ REFIID riid, _Out_ LPVOID *ppResult) override {
+    if (pSource == nullptr || pArgs == nullptr || ppResult == nullptr)
+      return E_INVALIDARG;
+    if (!(IsEqualIID(riid, __uuidof(IDxcResult)) ||
+          IsEqualIID(riid, __uuidof(IDxcOperationResult))))
+      return E_INVALIDARG;
+    *ppResult = nullptr;
+
+    // Only arguments parsed by this module carry options.
+    CComPtr<DxcParsedArguments> pParsed;
+    if (FAILED(pArgs->QueryInterface(__uuidof(DxcParsedArguments),
+                                     (void **)&pParsed)))
+      return E_INVALIDARG;
+
+    const DxcParsedOptions &options = pParsed->GetOptions();
+    return CompileWithOptions(pSource, options.Opts, options.Warnings,
+                              pParsed->GetArguments(), pParsed->GetCount(),
+                              pParsed->GetExtraDefines(),
+                              /*highLevelSource*/ false, pIncludeHandler,
+                              riid, ppResult);
+  }
+
+  // Results can only be shared between permutations with identical
+  // preprocessed text if nothing else in the output depends on the defines.
+  bool CanSharePermutationResults(const hlsl::options::DxcOpts &opts) {
+    ConfigurationPtr pConfig = GetConfiguration();
+    return !opts.EmbedPDBName() && !opts.DebugNameForSource &&
+           opts.Preprocess.empty() && opts.RootSignatureDefine.empty() &&
+           opts.BindingTableDefine.empty() &&
+           pConfig->LangExtensions.GetSemanticDefines().empty() &&
+           pConfig->LangExtensions.GetNonOptSemanticDefines().empty();
+  }
+
+  // Preprocesses pSource with pArguments into text. Returns false if that
+  // fails, in which case the source is compiled on its own.
+  bool PreprocessToText(const DxcBuffer *pSource, LPCWSTR *pArguments,
+                        UINT32 argCount, IDxcIncludeHandler *pIncludeHandler,
+                        std::string &text) {
+    std::vector<LPCWSTR> args(pArguments, pArguments + argCount);
+    args.push_back(L"-P");
+    args.push_back(L"preprocessed.hlsl");
+    CComPtr<IDxcResult> pResult;
+    HRESULT status;
+    CComPtr<IDxcBlobUtf8> pText;
+    if (FAILED(Compile(pSource, args.data(), (UINT32)args.size(),
+                       pIncludeHandler, IID_PPV_ARGS(&pResult))) ||
+        FAILED(pResult->GetStatus(&status)) || FAILED(status) ||
+        FAILED(pResult->GetOutput(DXC_OUT_HLSL, IID_PPV_ARGS(&pText),
+                                  nullptr)) ||
+        pText == nullptr)
+      return false;
+    text.assign(pText->GetStringPointer(), pText->GetStringLength());
+    return true;
+  }
+
+  HRESULT STDMETHODCALLTYPE CompilePermutations(
+    _In_ const DxcBuffer *pSource,
+    _In_ IDxcParsedArguments *pArgs,
+    _In_opt_count_(permutationCount) const UINT32 *pDefineCounts,
+    _In_opt_ const DxcDefine *pDefines,
+    _In_ UINT32 permutationCount,
+    _In_opt_ IDxcIncludeHandler *pIncludeHandler,
+    _In_ REFIID riid,
+    _Out_writes_(permutationCount) LPVOID *ppResults) override {
+    if (pSource == nullptr || pArgs == nullptr || ppResults == nullptr ||
+        (permutationCount > 0 && pDefineCounts == nullptr))
+      return E_INVALIDARG;
+    if (!(IsEqualIID(riid, __uuidof(IDxcResult)) ||
+          IsEqualIID(riid, __uuidof(IDxcOperationResult))))
+      return E_INVALIDARG;
+    UINT64 defineCount = 0;
+    for (UINT32 i = 0; i < permutationCount; ++i) {
+      ppResults[i] = nullptr;
+      defineCount += pDefineCounts[i];
+    }
+    if (defineCount > 0 && pDefines == nullptr)
+      return E_INVALIDARG;
+
+    CComPtr<DxcParsedArguments> pParsed;
+    if (FAILED(pArgs->QueryInterface(__uuidof(DxcParsedArguments),
+                                     (void **)&pParsed)))
+      return E_INVALIDARG;
+
+    DxcThreadMalloc TM(m_pMalloc);
+    try {
+      CComPtr<IDxcIncludeHandler> pSharedIncludeHandler;
+      IFT(dxcutil::CreateSharedIncludeHandler(m_pMalloc, pIncludeHandler,
+                                              &pSharedIncludeHandler));
+
+      std::vector<CComPtr<IDxcParsedArguments>> variants(permutationCount);
+      const DxcDefine *pSet = pDefines;
+      for (UINT32 i = 0; i < permutationCount; ++i) {
+        IFT(pParsed->CreateVariant(pSet, pDefineCounts[i], &variants[i]));
+        pSet += pDefineCounts[i];
+      }
+
+      // representative[i] is the permutation whose result permutation i uses.
+      std::vector<UINT32> representative(permutationCount);
+      for (UINT32 i = 0; i < permutationCount; ++i)
+        representative[i] = i;
+      if (CanSharePermutationResults(pParsed->GetOptions().Opts)) {
+        std::vector<std::string> texts(permutationCount);
+        std::vector<char> preprocessed(permutationCount, false);
+        RunConcurrently(permutationCount, [&](UINT32 i) {
+          preprocessed[i] = PreprocessToText(
+              pSource, variants[i]->GetArguments(), variants[i]->GetCount(),
+              pSharedIncludeHandler, texts[i]);
+        });
+        llvm::StringMap<UINT32> firstByText;
+        for (UINT32 i = 0; i < permutationCount; ++i) {
+          if (preprocessed[i])
+            representative[i] = firstByText.insert({ texts[i], i }).first->second;
+        }
+      }
+
+      std::vector<UINT32> unique;
+      for (UINT32 i = 0; i < permutationCount; ++i) {
+        if (representative[i] == i)
+          unique.push_back(i);
+      }
+      std::vector<HRESULT> compileResults(permutationCount, S_OK);
+      RunConcurrently((UINT32)unique.size(), [&](UINT32 j) {
+        UINT32 i = unique[j];
+        compileResults[i] = CompileParsed(pSource, variants[i],
+                                          pSharedIncludeHandler, riid,
+                                          &ppResults[i]);
+      });
+
+      for (UINT32 i = 0; i < permutationCount; ++i) {
+        if (FAILED(compileResults[i])) {
+          for (UINT32 j = 0; j < permutationCount; ++j) {
+            if (ppResults[j]) {
+              ((IUnknown *)ppResults[j])->Release();
+              ppResults[j] = nullptr;
+            }
+          }
+          return compileResults[i];
+        }
+      }
+      for (UINT32 i = 0; i < permutationCount; ++i) {
+        if (representative[i] != i) {
+          ppResults[i] = ppResults[representative[i]];
+          ((IUnknown *)ppResults[i])->AddRef();
+        }
+      }
+      return S_OK;
+    }
+    CATCH_CPP_RETURN_HRESULT();
+  }
+
+  // Computes the key under which a batch job can share its compile with the
+  // other jobs: a hash of its preprocessed text and of every argument except
+  // the defines, which the text already reflects, and the output names,
+  // which each job keeps. Leaves key empty if the job must be compiled on its
+  // own. parsed receives the job's parsed options.
+  HRESULT ComputeBatchShareKey(const DxcCompileJob &job,
+                               IDxcIncludeHandler *pIncludeHandler,
+                               DxcParsedOptions &parsed, std::string &key) {
+    key.clear();
+    try {
+      int argCountInt;
+      IFT(UIntToInt(job.ArgCount, &argCountInt));
+      parsed.MainArgs =
+          hlsl::options::MainArgs(argCountInt, job.pArguments, 0);
+      CComPtr<IDxcOperationResult> pOptionsResult;
+      const hlsl::options::DxcOpts &opts = parsed.Opts;
+      if (!ParseCompileOptions(parsed.MainArgs, parsed.Opts,
+                               parsed.Warnings, &pOptionsResult) ||
+          !CanSharePermutationResults(opts))
+        return S_OK;
+      std::string text;
+      if (!PreprocessToText(job.pSource, job.pArguments, job.ArgCount,
+                            pIncludeHandler, text))
+        return S_OK;
+
+      std::string keyData;
+      raw_string_ostream keyStream(keyData);
+      for (const llvm::opt::Arg *A : opts.Args) {
+        if (A->getOption().matches(options::OPT_D) ||
+            A->getOption().matches(options::OPT_Fo) ||
+            A->getOption().matches(options::OPT_Fe) ||
+            A->getOption().matches(options::OPT_Fre) ||
+            A->getOption().matches(options::OPT_Frs) ||
+            A->getOption().matches(options::OPT_Fsh) ||
+            A->getOption().matches(options::OPT_Fc) ||
+            A->getOption().matches(options::OPT_Fh) ||
+            A->getOption().matches(options::OPT_Vn) ||
+            A->getOption().matches(options::OPT_ftime_trace_EQ) ||
+            A->getOption().matches(options::OPT_Qpass_report_EQ))
+          continue;
+        keyStream << A->getAsString(opts.Args) << '\0';
+      }
+      keyStream << '\0' << text;
+      keyStream.flush();
+      key = dxcutil::DxcCompileCache::HashString(keyData);
+      return S_OK;
+    }
+    CATCH_CPP_RETURN_HRESULT();
+  }
+
+  // Creates a result with the outputs of pShared, named as the job with opts
+  // would have named them.
+  HRESULT CreateSharedBatchResult(IDxcResult *pShared,
+                                  const hlsl::options::DxcOpts &opts,
+                                  REFIID riid, LPVOID *ppResult) {
+    HRESULT status;
+    IFR(pShared->GetStatus(&status));
+    DXC_OUT_KIND primary = pShared->PrimaryOutput();
+    std::pair<DXC_OUT_KIND, StringRef> ownNames[] = {
+      { primary, opts.OutputObject },
+      { DXC_OUT_REFLECTION, opts.OutputReflectionFile },
+      { DXC_OUT_SHADER_HASH, opts.OutputShaderHashFile },
+      { DXC_OUT_ERRORS, opts.OutputWarningsFile },
+      { DXC_OUT_ROOT_SIGNATURE, opts.OutputRootSigFile },
+      { DXC_OUT_TIME_TRACE, opts.TimeTraceFile },
+      { DXC_OUT_PASS_REPORT, opts.PassReportFile },
+      { DXC_OUT_MEMORY_REPORT, opts.MemoryReportFile },
+      { DXC_OUT_PERF_REPORT, opts.PerfReportFile },
+      { DXC_OUT_SPIRV, opts.OutputSpirvFile },
+    };
+
+    CComPtr<DxcResult> pResult = DxcResult::Alloc(m_pMalloc);
+    IFROOM(pResult.p);
+    IFR(pResult->SetEncoding(opts.DefaultTextCodePage));
+    for (unsigned i = DXC_OUT_NONE + 1; i <= kNumDxcOutputTypes; ++i) {
+      DXC_OUT_KIND kind = (DXC_OUT_KIND)i;
+      if (!pShared->HasOutput(kind))
+        continue;
+      DxcOutputObject object;
+      CComPtr<IDxcBlobWide> pName;
+      IFR(pShared->GetOutput(kind, IID_PPV_ARGS(&object.object), &pName));
+      object.kind = kind;
+      auto own = std::find_if(
+          std::begin(ownNames), std::end(ownNames),
+          [kind](const std::pair<DXC_OUT_KIND, StringRef> &N) {
+            return N.first == kind;
+          });
+      if (own != std::end(ownNames)) {
+        IFR(object.SetName(own->second));
+      } else {
+        IFR(object.SetName(pName));
+      }
+      IFR(pResult->SetOutput(object));
+    }
+    IFR(pResult->SetStatusAndPrimaryResult(status, primary));
+    return pResult->QueryInterface(riid, ppResult);
+  }
+
+  // Compile several jobs concurrently, sharing loaded include files. Jobs
+  // with the same share key are compiled once.
+  HRESULT STDMETHODCALLTYPE CompileBatch(
+    _In_count_(jobCount) const DxcCompileJob *pJobs, // Jobs to compile
+    _In_ UINT32 jobCount,                         // Number of jobs
+    _In_opt_ IDxcIncludeHandler *pIncludeHandler, // user-provided interface to handle #include directives (optional)
+    _In_ REFIID riid,                             // IDxcResult or IDxcOperationResult
+    _Out_writes_(jobCount) LPVOID *ppResults      // One result per job: status, buffer, and errors
+  ) override {
+    if ((jobCount > 0 && pJobs == nullptr) || ppResults == nullptr)
+      return E_INVALIDARG;
+    for (UINT32 i = 0; i < jobCount; ++i) {
+      ppResults[i] = nullptr;
+      if (pJobs[i].pSource == nullptr ||
+          (pJobs[i].ArgCount > 0 && pJobs[i].pArguments == nullptr))
+        return E_INVALIDARG;
+    }
+    if (!(IsEqualIID(riid, __uuidof(IDxcResult)) ||
+          IsEqualIID(riid, __uuidof(IDxcOperationResult))))
+      return E_INVALIDARG;
+
+    DxcThreadMalloc TM(m_pMalloc);
+    try {
+      CComPtr<IDxcIncludeHandler> pSharedIncludeHandler;
+      IFT(dxcutil::CreateSharedIncludeHandler(m_pMalloc, pIncludeHandler,
+                                              &pSharedIncludeHandler));
+
+      std::vector<DxcParsedOptions> jobOptions(jobCount);
+      std::vector<std::string> shareKeys(jobCount);
+      RunConcurrently(jobCount, [&](UINT32 i) {
+        ComputeBatchShareKey(pJobs[i], pSharedIncludeHandler, jobOptions[i],
+                             shareKeys[i]);
+      });
+
+      // representative[i] is the job whose compile job i shares.
+      std::vector<UINT32> representative(jobCount);
+      std::vector<UINT32> unique;
+      llvm::StringMap<UINT32> firstByKey;
+      for (UINT32 i = 0; i < jobCount; ++i) {
+        representative[i] =
+            shareKeys[i].empty()
+                ? i
+                : firstByKey.insert({ shareKeys[i], i }).first->second;
+        if (representative[i] == i)
+          unique.push_back(i);
+      }
+
+      std::vector<HRESULT> jobResults(jobCount, E_FAIL);
+      RunConcurrently((UINT32)unique.size(), [&](UINT32 j) {
+        UINT32 i = unique[j];
+        jobResults[i] = Compile(pJobs[i].pSource, pJobs[i].pArguments,
+                                pJobs[i].ArgCount, pSharedIncludeHandler,
+                                riid, &ppResults[i]);
+      });
+      for (UINT32 i = 0; i < jobCount; ++i) {
+        UINT32 r = representative[i];
+        if (r == i || FAILED(jobResults[r]))
+          continue;
+        CComPtr<IDxcResult> pShared;
+        jobResults[i] = ((IUnknown *)ppResults[r])->QueryInterface(&pShared);
+        if (SUCCEEDED(jobResults[i]))
+          jobResults[i] = CreateSharedBatchResult(pShared, jobOptions[i].Opts,
+                                                  riid, &ppResults[i]);
+      }
+
+      for (UINT32 i = 0; i < jobCount; ++i) {
+        if (FAILED(jobResults[i])) {
+          for (UINT32 j = 0; j < jobCount; ++j) {
+            if (ppResults[j]) {
+              ((IUnknown *)ppResults[j])->Release();
+              ppResults[j] = nullptr;
+            }
+          }
+          return jobResults[i];
+        }
+      }
+      return S_OK;
+    }
+    CATCH_CPP_RETURN_HRESULT();
+  }
+
+  // Compile one source for several entry points, sharing loaded include
+  // files. Each entry is a full compile: the profile selects predefined
+  // macros and semantic rules, so nothing before code generation can be
+  // shared between entries.
+  HRESULT STDMETHODCALLTYPE CompileEntries(
+    _In_ const DxcBuffer *pSource,
+    _In_opt_count_(argCount) LPCWSTR *pArguments,
+    _In_ UINT32 argCount,
+    _In_count_(entryCount) const DxcCompileEntry *pEntries,
+    _In_ UINT32 entryCount,
+    _In_opt_ IDxcIncludeHandler *pIncludeHandler,
+    _In_ REFIID riid,
+    _Out_writes_(entryCount) LPVOID *ppResults) override {
+    if (pSource == nullptr || ppResults == nullptr ||
+        (argCount > 0 && pArguments == nullptr) ||
+        (entryCount > 0 && pEntries == nullptr))
+      return E_INVALIDARG;
+    for (UINT32 i = 0; i < entryCount; ++i) {
+      ppResults[i] = nullptr;
+      if (pEntries[i].pEntryPoint == nullptr ||
+          pEntries[i].pTargetProfile == nullptr)
+        return E_INVALIDARG;
+    }
+    if (!(IsEqualIID(riid, __uuidof(IDxcResult)) ||
+          IsEqualIID(riid, __uuidof(IDxcOperationResult))))
+      return E_INVALIDARG;
+
+    DxcThreadMalloc TM(m_pMalloc);
+    try {
+      CComPtr<IDxcIncludeHandler> pSharedIncludeHandler;
+      IFT(dxcutil::CreateSharedIncludeHandler(m_pMalloc, pIncludeHandler,
+                                              &pSharedIncludeHandler));
+
+      // The last -E and -T win, so the entry's follow the shared arguments.
+      std::vector<std::vector<LPCWSTR>> entryArgs(entryCount);
+      for (UINT32 i = 0; i < entryCount; ++i) {
+        entryArgs[i].assign(pArguments, pArguments + argCount);
+        entryArgs[i].push_back(L"-E");
+        entryArgs[i].push_back(pEntries[i].pEntryPoint);
+        entryArgs[i].push_back(L"-T");
+        entryArgs[i].push_back(pEntries[i].pTargetProfile);
+      }
+
+      std::vector<HRESULT> entryResults(entryCount, E_FAIL);
+      RunConcurrently(entryCount, [&](UINT32 i) {
+        entryResults[i] = Compile(pSource, entryArgs[i].data(),
+                                  (UINT32)entryArgs[i].size(),
+                                  pSharedIncludeHandler, riid, &ppResults[i]);
+      });
+
+      for (UINT32 i = 0; i < entryCount; ++i) {
+        if (FAILED(entryResults[i])) {
+          for (UINT32 j = 0; j < entryCount; ++j) {
+            if (ppResults[j]) {
+              ((IUnknown *)ppResults[j])->Release();
+              ppResults[j] = nullptr;
+            }
+          }
+          return entryResults[i];
+        }
+      }
+      return S_OK;
+    }
+    CATCH_CPP_RETURN_HRESULT();
+  }
+
+  // Renders parsed arguments with one spelling per option: aliases become
+  // the option they stand for, every option takes its first prefix, and
+  // values that may be joined or separate are separate.
+  static void NormalizeArguments(const llvm::opt::ArgList &args,
+                                 std::vector<std::string> &normalized) {
+    for (const llvm::opt::Arg *A : args) {
+      const llvm::opt::Option &option = A->getOption();
+      std::string spelling = option.getPrefixedName();
+      switch (option.getRenderStyle()) {
+      case llvm::opt::Option::RenderValuesStyle:
+        normalized.insert(normalized.end(), A->getValues().begin(),
+                          A->getValues().end());
+        break;
+      case llvm::opt::Option::RenderCommaJoinedStyle:
+        for (unsigned i = 0, e = A->getNumValues(); i != e; ++i)
+          spelling += (i ? "," : "") + std::string(A->getValue(i));
+        normalized.push_back(spelling);
+        break;
+      case llvm::opt::Option::RenderJoinedStyle:
+        normalized.push_back(spelling + A->getValue(0));
+        normalized.insert(normalized.end(), A->getValues().begin() + 1,
+                          A->getValues().end());
+        break;
+      case llvm::opt::Option::RenderSeparateStyle:
+        normalized.push_back(spelling);
+        normalized.insert(normalized.end(), A->getValues().begin(),
+                          A->getValues().end());
+        break;
+      }
+    }
+  }
+
+  // Parses the normalized arguments of a compile job or snapshot into
+  // options. Returns false, with the result for the caller in ppResult, if
+  // they are invalid.
+  bool ParseCompileJobOptions(const std::vector<std::string> &arguments,
+                              DxcParsedOptions &parsed,
+                              std::vector<LPCWSTR> &argPtrs,
+                              _COM_Outptr_ IDxcOperationResult **ppResult) {
+    std::vector<StringRef> args(arguments.begin(), arguments.end());
+    parsed.MainArgs = hlsl::options::MainArgs(args);
+    for (const std::string &arg : arguments)
+      parsed.Arguments.push_back(Unicode::UTF8ToWideStringOrThrow(arg.c_str()));
+    for (const std::wstring &arg : parsed.Arguments)
+      argPtrs.push_back(arg.c_str());
+    return ParseCompileOptions(parsed.MainArgs, parsed.Opts, parsed.Warnings,
+                               ppResult);
+  }
+
+  std::string ComputeCompileJobFingerprint(Configuration &config,
+                                           const hlsl::options::DxcOpts &opts) {
+    std::string fingerprint;
+    raw_string_ostream fingerprintOS(fingerprint);
+    WriteCompileOptionsKey(fingerprintOS, config, opts, {});
+    fingerprintOS.flush();
+    return dxcutil::DxcCompileCache::HashString(fingerprint);
+  }
+
+  // The includes of a job are the lookups made by a -Mscan pass over the
+  // source, which only lexes directives but resolves the same files as a
+  // full compile, plus the files that Compile loads itself.
+  HRESULT STDMETHODCALLTYPE CreateCompileJob(
+    _In_ const DxcBuffer *pSource,
+    _In_opt_count_(argCount) LPCWSTR *pArguments,
+    _In_ UINT32 argCount,
+    _In_opt_ IDxcIncludeHandler *pIncludeHandler,
+    _COM_Outptr_result_maybenull_ IDxcBlob **ppJob,
+    _COM_Outptr_result_maybenull_ IDxcResult **ppResult) override {
+    if (pSource == nullptr || ppJob == nullptr || ppResult == nullptr ||
+        (argCount > 0 && pArguments == nullptr))
+      return E_INVALIDARG;
+    *ppJob = nullptr;
+    *ppResult = nullptr;
+
+    DxcThreadMalloc TM(m_pMalloc);
+    try {
+      ConfigurationPtr pConfig = GetConfiguration();
+      int argCountInt;
+      IFT(UIntToInt(argCount, &argCountInt));
+      hlsl::options::MainArgs mainArgs(argCountInt, pArguments, 0);
+      hlsl::options::DxcOpts opts;
+      std::string warnings;
+      CComPtr<IDxcOperationResult> pOptionsResult;
+      if (!ParseCompileOptions(mainArgs, opts, warnings, &pOptionsResult))
+        return pOptionsResult->QueryInterface(ppResult);
+      // Neither is part of the job, so a worker could not reproduce them.
+      if (HasLangExtensions(*pConfig) || pConfig->ContainerEventsHandler)
+        return ErrorWithString("error: compile jobs cannot capture language "
+                               "extensions or container event handlers",
+                               IID_PPV_ARGS(ppResult));
+
+      dxcutil::DxcCompileJobDescription job;
+      NormalizeArguments(opts.Args, job.Arguments);
+
+      // Everything else is taken from the normalized arguments, as
+      // CompileJob will see them.
+      DxcParsedOptions jobOptions;
+      std::vector<LPCWSTR> jobArgs;
+      pOptionsResult.Release();
+      if (!ParseCompileJobOptions(job.Arguments, jobOptions, jobArgs,
+                                  &pOptionsResult))
+        return pOptionsResult->QueryInterface(ppResult);
+      const hlsl::options::DxcOpts &jobOpts = jobOptions.Opts;
+      job.Fingerprint = ComputeCompileJobFingerprint(*pConfig, jobOpts);
+      job.SourceEncoding = pSource->Encoding;
+      job.SourceDigest = job.AddBlob(pSource->Ptr, pSource->Size);
+
+      CComPtr<IDxcIncludeHandler> pRecorder;
+      IFT(dxcutil::CreateRecordingIncludeHandler(m_pMalloc, pIncludeHandler,
+                                                 job, &pRecorder));
+      std::vector<LPCWSTR> scanArgs = jobArgs;
+      scanArgs.push_back(L"-Mscan");
+      CComPtr<IDxcResult> pScanResult;
+      IFT(Compile(pSource, scanArgs.data(), (UINT32)scanArgs.size(), pRecorder,
+                  IID_PPV_ARGS(&pScanResult)));
+      for (StringRef file : { jobOpts.RootSignatureSource,
+                              jobOpts.PrivateSource,
+                              jobOpts.ImportBindingTable, jobOpts.ProfileUse }) {
+        if (file.empty())
+          continue;
+        hlsl::options::StringRefWide wstrRef(file);
+        CComPtr<IDxcBlob> pFile;
+        pRecorder->LoadSource(wstrRef, &pFile);
+      }
+
+      std::string buffer;
+      job.Write(buffer);
+      IFT(DxcCreateBlobOnHeapCopy(buffer.data(), buffer.size(), ppJob));
+      return S_OK;
+    }
+    CATCH_CPP_RETURN_HRESULT();
+  }
+
+  HRESULT STDMETHODCALLTYPE CompileJob(
+    _In_ const DxcBuffer *pJob,
+    _In_ REFIID riid, _Out_ LPVOID *ppResult) override {
+    if (pJob == nullptr || ppResult == nullptr)
+      return E_INVALIDARG;
+    if (!(IsEqualIID(riid, __uuidof(IDxcResult)) ||
+          IsEqualIID(riid, __uuidof(IDxcOperationResult))))
+      return E_INVALIDARG;
+    *ppResult = nullptr;
+
+    DxcThreadMalloc TM(m_pMalloc);
+    try {
+      ConfigurationPtr pConfig = GetConfiguration();
+      dxcutil::DxcCompileJobDescription job;
+      if (!job.Read(pJob->Ptr, pJob->Size))
+        return ErrorWithString("error: invalid compile job", riid, ppResult);
+
+      DxcParsedOptions jobOptions;
+      std::vector<LPCWSTR> jobArgs;
+      CComPtr<IDxcOperationResult> pOptionsResult;
+      if (!ParseCompileJobOptions(job.Arguments, jobOptions, jobArgs,
+                                  &pOptionsResult))
+        return pOptionsResult->QueryInterface(riid, ppResult);
+      if (HasLangExtensions(*pConfig) || pConfig->ContainerEventsHandler)
+        return ErrorWithString("error: compile jobs cannot run with language "
+                               "extensions or container event handlers",
+                               riid, ppResult);
+      if (ComputeCompileJobFingerprint(*pConfig, jobOptions.Opts) !=
+          job.Fingerprint)
+        return ErrorWithString("error: compile job was created by a "
+                               "different compiler or validator",
+                               riid, ppResult);
+
+      CComPtr<IDxcIncludeHandler> pJobIncludeHandler;
+      IFT(dxcutil::CreateJobIncludeHandler(m_pMalloc, job,
+                                           &pJobIncludeHandler));
+      const std::string &source = job.Blobs.find(job.SourceDigest)->second;
+      DxcBuffer sourceBuffer = { source.data(), source.size(),
+                                 job.SourceEncoding };
+      return CompileWithOptions(&sourceBuffer, jobOptions.Opts,
+                                jobOptions.Warnings, jobArgs.data(),
+                                (UINT32)jobArgs.size(), {},
+                                /*highLevelSource*/ false, pJobIncludeHandler,
+                                riid, ppResult);
+    }
+    CATCH_CPP_RETURN_HRESULT();
+  }
+
+  // Returns why a compile with opts cannot be split at high-level code
+  // generation, or null if it can. The resumed compile reads the module in
+  // place of the source, so nothing after that point may need the source
+  // text or the preprocessor.
+  static const char *GetSnapshotOptionsError(const hlsl::options::DxcOpts &opts) {
+    bool generatesCode = opts.Preprocess.empty() && !opts.AstDump &&
+                         !opts.OptDump && !opts.DumpDependencies &&
+                         !opts.CodeGenHighLevel &&
+                         !opts.IsRootSignatureProfile();
+#ifdef ENABLE_SPIRV_CODEGEN
+    generatesCode &= !opts.GenSPIRV && opts.OutputSpirvFile.empty();
+#endif
+    if (!generatesCode)
+      return "error: only DXIL code generation can be snapshotted";
+    if (opts.GeneratePDB())
+      return "error: snapshots cannot carry debug information";
+    if (!opts.BindingTableDefine.empty())
+      return "error: snapshots cannot use -binding-table-define";
+    if (!opts.RootSignatureDefine.empty())
+      return "error: snapshots cannot use -rootsig-define";
+    return nullptr;
+  }
+
+  HRESULT STDMETHODCALLTYPE CreateSnapshot(
+    _In_ const DxcBuffer *pSource,
+    _In_opt_count_(argCount) LPCWSTR *pArguments,
+    _In_ UINT32 argCount,
+    _In_opt_ IDxcIncludeHandler *pIncludeHandler,
+    _COM_Outptr_result_maybenull_ IDxcBlob **ppSnapshot,
+    _COM_Outptr_ IDxcResult **ppResult) override {
+    if (pSource == nullptr || ppSnapshot == nullptr || ppResult == nullptr ||
+        (argCount > 0 && pArguments == nullptr))
+      return E_INVALIDARG;
+    *ppSnapshot = nullptr;
+    *ppResult = nullptr;
+
+    DxcThreadMalloc TM(m_pMalloc);
+    try {
+      ConfigurationPtr pConfig = GetConfiguration();
+      int argCountInt;
+      IFT(UIntToInt(argCount, &argCountInt));
+      hlsl::options::MainArgs mainArgs(argCountInt, pArguments, 0);
+      hlsl::options::DxcOpts opts;
+      std::string warnings;
+      CComPtr<IDxcOperationResult> pOptionsResult;
+      if (!ParseCompileOptions(mainArgs, opts, warnings, &pOptionsResult))
+        return pOptionsResult->QueryInterface(ppResult);
+
+      // Like a job, the snapshot keeps the normalized arguments, and the
+      // fingerprint is taken from them as ResumeSnapshot will see them.
+      dxcutil::DxcCompileSnapshot snapshot;
+      NormalizeArguments(opts.Args, snapshot.Arguments);
+      DxcParsedOptions snapshotOptions;
+      std::vector<LPCWSTR> snapshotArgs;
+      pOptionsResult.Release();
+      if (!ParseCompileJobOptions(snapshot.Arguments, snapshotOptions,
+                                  snapshotArgs, &pOptionsResult))
+        return pOptionsResult->QueryInterface(ppResult);
+      if (const char *pError = GetSnapshotOptionsError(snapshotOptions.Opts))
+        return ErrorWithString(pError, IID_PPV_ARGS(ppResult));
+      snapshot.Fingerprint =
+          ComputeCompileJobFingerprint(*pConfig, snapshotOptions.Opts);
+
+      std::vector<LPCWSTR> highLevelArgs = snapshotArgs;
+      highLevelArgs.push_back(L"-fcgl");
+      CComPtr<IDxcResult> pHighLevelResult;
+      IFT(Compile(pSource, highLevelArgs.data(), (UINT32)highLevelArgs.size(),
+                  pIncludeHandler, IID_PPV_ARGS(&pHighLevelResult)));
+      HRESULT status;
+      IFT(pHighLevelResult->GetStatus(&status));
+      if (SUCCEEDED(status)) {
+        CComPtr<IDxcBlob> pModule;
+        IFT(pHighLevelResult->GetOutput(DXC_OUT_OBJECT, IID_PPV_ARGS(&pModule),
+                                        nullptr));
+        snapshot.Module.assign((const char *)pModule->GetBufferPointer(),
+                               pModule->GetBufferSize());
+        std::string buffer;
+        snapshot.Write(buffer);
+        IFT(DxcCreateBlobOnHeapCopy(buffer.data(), buffer.size(), ppSnapshot));
+      }
+      *ppResult = pHighLevelResult.Detach();
+      return S_OK;
+    }
+    CATCH_CPP_RETURN_HRESULT();
+  }
+
+  HRESULT STDMETHODCALLTYPE ResumeSnapshot(
+    _In_ const DxcBuffer *pSnapshot,
+    _In_opt_count_(argCount) LPCWSTR *pArguments,
+    _In_ UINT32 argCount,
+    _In_opt_ IDxcIncludeHandler *pIncludeHandler,
+    _In_ REFIID riid, _Out_ LPVOID *ppResult) override {
+    if (pSnapshot == nullptr || ppResult == nullptr ||
+        (argCount > 0 && pArguments == nullptr))
+      return E_INVALIDARG;
+    if (!(IsEqualIID(riid, __uuidof(IDxcResult)) ||
+          IsEqualIID(riid, __uuidof(IDxcOperationResult))))
+      return E_INVALIDARG;
+    *ppResult = nullptr;
+
+    DxcThreadMalloc TM(m_pMalloc);
+    try {
+      ConfigurationPtr pConfig = GetConfiguration();
+      dxcutil::DxcCompileSnapshot snapshot;
+      if (!snapshot.Read(pSnapshot->Ptr, pSnapshot->Size))
+        return ErrorWithString("error: invalid compile snapshot", riid,
+                               ppResult);
+
+      DxcParsedOptions snapshotOptions;
+      std::vector<LPCWSTR> snapshotArgs;
+      CComPtr<IDxcOperationResult> pOptionsResult;
+      if (!ParseCompileJobOptions(snapshot.Arguments, snapshotOptions,
+                                  snapshotArgs, &pOptionsResult))
+        return pOptionsResult->QueryInterface(riid, ppResult);
+      if (ComputeCompileJobFingerprint(*pConfig, snapshotOptions.Opts) !=
+          snapshot.Fingerprint)
+        return ErrorWithString("error: compile snapshot was created by a "
+                               "different compiler, validator or "
+                               "configuration",
+                               riid, ppResult);
+
+      // Later arguments win, so the variant's override the snapshot's.
+      std::vector<std::string> arguments = snapshot.Arguments;
+      for (UINT32 i = 0; i < argCount; ++i)
+        arguments.push_back(Unicode::WideToUTF8StringOrThrow(pArguments[i]));
+      DxcParsedOptions variantOptions;
+      std::vector<LPCWSTR> variantArgs;
+      pOptionsResult.Release();
+      if (!ParseCompileJobOptions(arguments, variantOptions, variantArgs,
+                                  &pOptionsResult))
+        return pOptionsResult->QueryInterface(riid, ppResult);
+      if (const char *pError = GetSnapshotOptionsError(variantOptions.Opts))
+        return ErrorWithString(pError, riid, ppResult);
+
+      // The source is read as a string, which drops a trailing null, so pass
+      // the terminator too; the bitcode itself may end with a zero byte.
+      DxcBuffer moduleBuffer = { snapshot.Module.c_str(),
+                                 snapshot.Module.size() + 1, DXC_CP_UTF8 };
+      return CompileWithOptions(&moduleBuffer, variantOptions.Opts,
+                                variantOptions.Warnings, variantArgs.data(),
+                                (UINT32)variantArgs.size(), {},
+                                /*highLevelSource*/ true, pIncludeHandler,
+                                riid, ppResult);
+    }
+    CATCH_CPP_RETURN_HRESULT();
+  }
+
   // Disassemble a program.
   virtual HRESULT STDMETHODCALLTYPE Disassemble(
     _In_ const DxcBuffer *pObject,                // Program to disassemble: dxil container or bitcode.
@@ -1366,11 +3127,60 @@ public:
     return hr;
   }
 
+  HRESULT STDMETHODCALLTYPE DisassembleToStream(
+    _In_ const DxcBuffer *pObject,
+    _In_opt_count_(functionCount) LPCWSTR *pFunctionNames,
+    _In_ UINT32 functionCount,
+    _In_ IStream *pOutput) override {
+    if (pObject == nullptr || pOutput == nullptr ||
+        (functionCount > 0 && pFunctionNames == nullptr))
+      return E_INVALIDARG;
+
+    HRESULT hr = S_OK;
+    DxcEtw_DXCompilerDisassemble_Start();
+    DxcThreadMalloc TM(m_pMalloc);
+    try {
+      DefaultFPEnvScope fpEnvScope;
+
+      ::llvm::sys::fs::MSFileSystem *msfPtr;
+      IFT(CreateMSFileSystemForDisk(&msfPtr));
+      std::unique_ptr<::llvm::sys::fs::MSFileSystem> msf(msfPtr);
+
+      ::llvm::sys::fs::AutoPerThreadSystem pts(msf.get());
+      IFTLLVM(pts.error_code());
+
+      std::vector<std::string> functionNames;
+      for (UINT32 i = 0; i < functionCount; ++i) {
+        if (pFunctionNames[i] == nullptr)
+          IFT(E_INVALIDARG);
+        CW2A name(pFunctionNames[i], CP_UTF8);
+        functionNames.emplace_back(name.m_psz);
+      }
+
+      CComPtr<IDxcBlobEncoding> pProgram;
+      IFT(hlsl::DxcCreateBlob(pObject->Ptr, pObject->Size, true, false, false, 0, nullptr, &pProgram))
+      raw_com_stream_ostream Stream(pOutput);
+      hr = dxcutil::Disassemble(pProgram, Stream, functionNames);
+      HRESULT hrWrite = Stream.GetStatus();
+      if (SUCCEEDED(hr))
+        hr = hrWrite;
+    } catch (std::bad_alloc &) {
+      hr = E_OUTOFMEMORY;
+    } catch (hlsl::Exception &e) {
+      _Analysis_assume_(DXC_FAILED(e.hr));
+      hr = e.hr;
+    } catch (...) {
+      hr = E_FAIL;
+    }
+    DxcEtw_DXCompilerDisassemble_Stop(hr);
+    return hr;
+  }
+
   void SetupCompilerForCompile(CompilerInstance &compiler,
                                _In_ DxcLangExtensionsHelper *helper,
                                _In_ LPCSTR pMainFile, _In_ TextDiagnosticPrinter *diagPrinter,
                                _In_ std::vector<std::string>& defines,
-                               _In_ hlsl::options::DxcOpts &Opts,
+                               _In_ const hlsl::options::DxcOpts &Opts,
                                _In_count_(argCount) LPCWSTR *pArguments,
                                _In_ UINT32 argCount) {
     // Setup a compiler instance.
@@ -1402,7 +3212,11 @@ public:
     if (Opts.GenerateFullDebugInfo()) {
       CodeGenOptions &CGOpts = compiler.getCodeGenOpts();
       // HLSL Change - begin
-      CGOpts.setDebugInfo(CodeGenOptions::FullDebugInfo);
+      // -Zi-lines keeps the line table and sources, so profilers can still
+      // map instructions back to source, without variables or types.
+      CGOpts.setDebugInfo(Opts.DebugLineTablesOnly
+                              ? CodeGenOptions::DebugLineTablesOnly
+                              : CodeGenOptions::FullDebugInfo);
       CGOpts.HLSLEmbedSourcesInModule = true;
       // HLSL Change - end
       // CGOpts.setDebugInfo(CodeGenOptions::FullDebugInfo); // HLSL change
@@ -1509,8 +3323,13 @@ public:
     compiler.getCodeGenOpts().HLSLOnlyWarnOnUnrollFail = Opts.EnableFXCCompatMode;
     compiler.getCodeGenOpts().HLSLResMayAlias = Opts.ResMayAlias;
     compiler.getCodeGenOpts().ScanLimit = Opts.ScanLimit;
+    compiler.getCodeGenOpts().HLSLUnrollMaxFunctionInstructions = Opts.UnrollMaxFunctionInstructions;
+    compiler.getCodeGenOpts().HLSLUnrollMaxModuleInstructions = Opts.UnrollMaxModuleInstructions;
+    compiler.getCodeGenOpts().HLSLUnrollTimeLimit = Opts.UnrollTimeLimit;
+    compiler.getCodeGenOpts().HLSLMaxRegisterPressure = Opts.MaxRegisterPressure;
     compiler.getCodeGenOpts().HLSLOptimizationToggles = Opts.DxcOptimizationToggles;
     compiler.getCodeGenOpts().HLSLOptimizationSelects = Opts.DxcOptimizationSelects;
+    compiler.getCodeGenOpts().HLSLSpecializedCBufferValues = Opts.SpecializedCBufferValues;
     compiler.getCodeGenOpts().HLSLAllResourcesBound = Opts.AllResourcesBound;
     compiler.getCodeGenOpts().HLSLIgnoreOptSemDefs = Opts.IgnoreOptSemDefs;
     compiler.getCodeGenOpts().HLSLIgnoreSemDefs = Opts.IgnoreSemDefs;
@@ -1556,7 +3375,7 @@ public:
     compiler.getCodeGenOpts().setInlining(
         clang::CodeGenOptions::OnlyAlwaysInlining);
 
-    compiler.getCodeGenOpts().HLSLExtensionsCodegen = std::make_shared<HLSLExtensionsCodegenHelperImpl>(compiler, m_langExtensionsHelper, Opts.RootSignatureDefine);
+    compiler.getCodeGenOpts().HLSLExtensionsCodegen = std::make_shared<HLSLExtensionsCodegenHelperImpl>(compiler, *helper, Opts.RootSignatureDefine);
 
     // AutoBindingSpace also enables automatic binding for libraries if set. UINT_MAX == unset
     compiler.getCodeGenOpts().HLSLDefaultSpace = Opts.AutoBindingSpace;
@@ -1576,6 +3395,34 @@ public:
     }
   }
 
+  // IDxcCompilerCache
+  HRESULT STDMETHODCALLTYPE EnableCache(_In_opt_z_ LPCWSTR pDirectory) override {
+    return m_CompileCache.Enable(pDirectory);
+  }
+  HRESULT STDMETHODCALLTYPE DisableCache() override {
+    m_CompileCache.Disable();
+    return S_OK;
+  }
+  HRESULT STDMETHODCALLTYPE GetCacheStatistics(_Out_ UINT64 *pHits,
+                                               _Out_ UINT64 *pMisses) override {
+    if (pHits == nullptr || pMisses == nullptr)
+      return E_INVALIDARG;
+    m_CompileCache.GetStatistics(pHits, pMisses);
+    return S_OK;
+  }
+
+  // IDxcContextPool
+  HRESULT STDMETHODCALLTYPE EnableContextPool(
+      _In_ UINT32 maxRetainedObjects) override {
+    m_ContextPool.Enable(maxRetainedObjects);
+    return S_OK;
+  }
+  HRESULT STDMETHODCALLTYPE DisableContextPool() override {
+    DxcThreadMalloc TM(m_pMalloc);
+    m_ContextPool.Disable();
+    return S_OK;
+  }
+
   // IDxcVersionInfo
   HRESULT STDMETHODCALLTYPE GetVersion(_Out_ UINT32 *pMajor, _Out_ UINT32 *pMinor) override {
     if (pMajor == nullptr || pMinor == nullptr)
@@ -39,6 +39,7 @@
 
 #include "dxcshadersourceinfo.h"
 #include "dxc/Support/dxcfilesystem.h"
+#include "dxc/Support/dxcconcurrency.h"
 
 #include <vector>
 #include <locale>
@@ -242,20 +243,25 @@ struct PdbRecompilerIncludeHandler : public IDxcIncludeHandler {
   }
 };
 
-struct DxcPdbUtils : public IDxcPdbUtils, public IDxcPixDxilDebugInfoFactory
+struct DxcPdbUtils : public IDxcPdbUtils2, public IDxcPixDxilDebugInfoFactory
 {
 private:
   DXC_MICROCOM_TM_REF_FIELDS()
 
   struct Source_File {
     std::wstring Name;
-    CComPtr<IDxcBlobEncoding> Content;
+    CComPtr<IDxcBlobEncoding> Content; // Null until LoadSourceContents()
   };
 
   CComPtr<IDxcBlob> m_InputBlob;
   CComPtr<IDxcBlob> m_pDebugProgramBlob;
   CComPtr<IDxcBlob> m_ContainerBlob;
   std::vector<Source_File> m_SourceFiles;
+  // Source info part whose contents have not been decoded yet. Points into
+  // m_ContainerBlob. Sources are only decompressed when first requested,
+  // since most callers only want the hash, name or arguments.
+  const hlsl::DxilSourceInfo *m_pPendingSourceInfo = nullptr;
+  UINT32 m_PendingSourceInfoSize = 0;
 
   std::wstring m_EntryPoint;
   std::wstring m_TargetProfile;
@@ -271,6 +277,11 @@ private:
   // NOTE: This is not set to null by Reset() since it doesn't
   // necessarily change across different PDBs.
   CComPtr<IDxcCompiler3> m_pCompiler;
+  // Likewise not cleared by Reset().
+  CComPtr<IDxcPdbCache> m_pFullPDBCache;
+  // Set once the arguments stored in the PDB have been overridden, after
+  // which recompiled PDBs no longer match the cache key.
+  bool m_bArgsOverridden = false;
 
   struct ArgPair {
     std::wstring Name;
@@ -295,6 +306,8 @@ private:
     m_InputBlob = nullptr;
     m_ContainerBlob = nullptr;
     m_SourceFiles.clear();
+    m_pPendingSourceInfo = nullptr;
+    m_PendingSourceInfoSize = 0;
     m_Name.clear();
     m_MainFileName.clear();
     m_HashBlob = nullptr;
@@ -303,6 +316,7 @@ private:
     m_VersionCommitSha.clear();
     m_VersionString.clear();
     m_pCachedRecompileResult = nullptr;
+    m_bArgsOverridden = false;
     ResetAllArgs();
   }
 
@@ -310,6 +324,31 @@ private:
     return m_SourceFiles.size();
   }
 
+  // Decodes the source contents recorded by HandleDxilContainer.
+  HRESULT LoadSourceContents() {
+    if (!m_pPendingSourceInfo)
+      return S_OK;
+
+    hlsl::SourceInfoReader reader;
+    if (!reader.Init(m_pPendingSourceInfo, m_PendingSourceInfoSize))
+      return E_FAIL;
+    if (reader.GetSourcesCount() != m_SourceFiles.size())
+      return E_FAIL;
+
+    for (unsigned i = 0; i < reader.GetSourcesCount(); i++) {
+      hlsl::SourceInfoReader::Source source_data = reader.GetSource(i);
+      IFR(hlsl::DxcCreateBlob(
+        source_data.Content.data(), source_data.Content.size(),
+        /*bPinned*/false, /*bCopy*/true,
+        /*encodingKnown*/true, CP_UTF8,
+        m_pMalloc, &m_SourceFiles[i].Content));
+    }
+
+    m_pPendingSourceInfo = nullptr;
+    m_PendingSourceInfoSize = 0;
+    return S_OK;
+  }
+
   HRESULT PopulateSourcesFromProgramHeaderOrBitcode(IDxcBlob *pProgramBlob) {
     UINT32 bitcode_size = 0;
     const char *bitcode = nullptr;
@@ -479,7 +518,7 @@ private:
       {
         const hlsl::DxilSourceInfo *header = (const hlsl::DxilSourceInfo *)(part+1);
         hlsl::SourceInfoReader reader;
-        if (!reader.Init(header, part->PartSize)) {
+        if (!reader.Init(header, part->PartSize, /*bLoadContents*/false)) {
           Reset();
           return E_FAIL;
         }
@@ -500,17 +539,12 @@ private:
           m_EntryPoint = L"main";
         }
 
-        // Sources
+        // Sources. Only the names are read here; see LoadSourceContents.
         for (unsigned i = 0; i < reader.GetSourcesCount(); i++) {
           hlsl::SourceInfoReader::Source source_data = reader.GetSource(i);
 
           Source_File source;
           source.Name = ToWstring(source_data.Name);
-          IFR(hlsl::DxcCreateBlob(
-            source_data.Content.data(), source_data.Content.size(),
-            /*bPinned*/false, /*bCopy*/true,
-            /*encodingKnown*/true, CP_UTF8,
-            m_pMalloc, &source.Content));
 
           // First file is the main file
           if (i == 0) {
@@ -519,6 +553,10 @@ private:
 
           m_SourceFiles.push_back(std::move(source));
         }
+        if (reader.GetSourcesCount()) {
+          m_pPendingSourceInfo = header;
+          m_PendingSourceInfoSize = part->PartSize;
+        }
 
       } break;
 
@@ -614,7 +652,7 @@ public:
   DxcPdbUtils(IMalloc *pMalloc) : m_dwRef(0), m_pMalloc(pMalloc) {}
 
   HRESULT STDMETHODCALLTYPE QueryInterface(REFIID iid, void **ppvObject) override {
-    return DoBasicQueryInterface<IDxcPdbUtils, IDxcPixDxilDebugInfoFactory>(this, iid, ppvObject);
+    return DoBasicQueryInterface<IDxcPdbUtils2, IDxcPdbUtils, IDxcPixDxilDebugInfoFactory>(this, iid, ppvObject);
   }
 
   HRESULT STDMETHODCALLTYPE Load(_In_ IDxcBlob *pPdbOrDxil) override {
@@ -690,6 +728,13 @@ public:
     if (uIndex >= m_SourceFiles.size()) return E_INVALIDARG;
     if (!ppResult) return E_POINTER;
     *ppResult = nullptr;
+    try {
+      DxcThreadMalloc TM(m_pMalloc);
+      IFR(LoadSourceContents());
+    }
+    catch (const std::bad_alloc &) {
+      return E_OUTOFMEMORY;
+    }
     return m_SourceFiles[uIndex].Content.QueryInterface(ppResult);
   }
 
@@ -767,6 +812,7 @@ public:
 
       // Clear the cached compile result
       m_pCachedRecompileResult = nullptr;
+      m_bArgsOverridden = true;
     }
     CATCH_CPP_RETURN_HRESULT()
 
@@ -803,6 +849,7 @@ public:
 
       // Clear the cached compile result
       m_pCachedRecompileResult = nullptr;
+      m_bArgsOverridden = true;
     }
     CATCH_CPP_RETURN_HRESULT()
 
@@ -824,6 +871,7 @@ public:
     // Fail early if there are no source files.
     if (m_SourceFiles.empty())
       return E_FAIL;
+    IFR(LoadSourceContents());
 
     if (!m_pCompiler)
       IFR(DxcCreateInstance2(m_pMalloc, CLSID_DxcCompiler, IID_PPV_ARGS(&m_pCompiler)));
@@ -889,6 +937,22 @@ public:
       return m_InputBlob.QueryInterface(ppFullPDB);
     }
 
+    DxcThreadMalloc TM(m_pMalloc);
+
+    CComPtr<IDxcBlob> pCacheKey;
+    if (m_pFullPDBCache && !m_bArgsOverridden) {
+      // The key names the compiler that does the rebuild, so create it now.
+      if (!m_pCompiler)
+        IFR(DxcCreateInstance2(m_pMalloc, CLSID_DxcCompiler, IID_PPV_ARGS(&m_pCompiler)));
+      IFR(GetFullPDBCacheKey(&pCacheKey));
+      if (pCacheKey) {
+        CComPtr<IDxcBlob> pCachedPDB;
+        IFR(m_pFullPDBCache->Lookup(pCacheKey, &pCachedPDB));
+        if (pCachedPDB)
+          return pCachedPDB.QueryInterface(ppFullPDB);
+      }
+    }
+
     CComPtr<IDxcResult> pResult;
 
     IFR(CompileForFullPDB(&pResult));
@@ -904,9 +968,114 @@ public:
     CComPtr<IDxcBlobWide> pFullPDBName;
     IFR(pResult->GetOutput(DXC_OUT_PDB, IID_PPV_ARGS(&pFullPDB), &pFullPDBName));
 
+    if (pCacheKey)
+      IFR(m_pFullPDBCache->Store(pCacheKey, pFullPDB));
+
     return pFullPDB.QueryInterface(ppFullPDB);
   }
 
+  // Builds the key under which the full PDB for the loaded slim PDB is
+  // cached: the shader hash, the version of the compiler that produced the
+  // PDB, and the version of the compiler used to rebuild it. Returns S_FALSE
+  // and no key if the PDB has no hash.
+  HRESULT GetFullPDBCacheKey(_COM_Outptr_result_maybenull_ IDxcBlob **ppKey) {
+    *ppKey = nullptr;
+    if (!m_HashBlob)
+      return S_FALSE;
+
+    try {
+      std::string key((const char *)m_HashBlob->GetBufferPointer(),
+                      m_HashBlob->GetBufferSize());
+      if (m_HasVersionInfo) {
+        key.append((const char *)&m_VersionInfo, sizeof(m_VersionInfo));
+        key.append(m_VersionCommitSha);
+        key.push_back('\0');
+        key.append(m_VersionString);
+      }
+      key.push_back('\0');
+
+      CComPtr<IDxcVersionInfo> pCompilerVersion;
+      if (SUCCEEDED(m_pCompiler.QueryInterface(&pCompilerVersion))) {
+        UINT32 compilerVersion[3] = {};
+        IFR(pCompilerVersion->GetVersion(&compilerVersion[0], &compilerVersion[1]));
+        IFR(pCompilerVersion->GetFlags(&compilerVersion[2]));
+        key.append((const char *)compilerVersion, sizeof(compilerVersion));
+
+        CComPtr<IDxcVersionInfo2> pCompilerVersion2;
+        if (SUCCEEDED(pCompilerVersion.QueryInterface(&pCompilerVersion2))) {
+          UINT32 commitCount = 0;
+          CComHeapPtr<char> commitHash;
+          IFR(pCompilerVersion2->GetCommitInfo(&commitCount, &commitHash));
+          key.append((const char *)&commitCount, sizeof(commitCount));
+          if (commitHash)
+            key.append(commitHash);
+        }
+      }
+
+      IFR(hlsl::DxcCreateBlobOnHeapCopy(key.data(), key.size(), ppKey));
+    }
+    CATCH_CPP_RETURN_HRESULT()
+
+    return S_OK;
+  }
+
+  // Loads pPdb into a new object sharing this one's compiler and cache, and
+  // rebuilds its full PDB. Used by the workers of GetFullPDBBatch.
+  HRESULT GetFullPDBForBatch(_In_ IDxcBlob *pPdb, _COM_Outptr_ IDxcBlob **ppFullPDB) {
+    DxcThreadMalloc TM(m_pMalloc);
+    CComPtr<DxcPdbUtils> pJob = CreateOnMalloc<DxcPdbUtils>(m_pMalloc);
+    if (!pJob)
+      return E_OUTOFMEMORY;
+    IFR(pJob->SetCompiler(m_pCompiler));
+    IFR(pJob->SetFullPDBCache(m_pFullPDBCache));
+    IFR(pJob->Load(pPdb));
+    return pJob->GetFullPDB(ppFullPDB);
+  }
+
+  virtual HRESULT STDMETHODCALLTYPE SetFullPDBCache(_In_opt_ IDxcPdbCache *pCache) override {
+    m_pFullPDBCache = pCache;
+    return S_OK;
+  }
+
+  virtual HRESULT STDMETHODCALLTYPE GetFullPDBBatch(
+      _In_count_(count) IDxcBlob *const *ppPDBs,
+      _In_ UINT32 count,
+      _Out_writes_(count) IDxcBlob **ppFullPDBs) override {
+    if ((count > 0 && ppPDBs == nullptr) || ppFullPDBs == nullptr)
+      return E_POINTER;
+    for (UINT32 i = 0; i < count; ++i) {
+      ppFullPDBs[i] = nullptr;
+      if (ppPDBs[i] == nullptr)
+        return E_INVALIDARG;
+    }
+
+    DxcThreadMalloc TM(m_pMalloc);
+    try {
+      // Create the compiler up front so every job shares it.
+      if (!m_pCompiler)
+        IFR(DxcCreateInstance2(m_pMalloc, CLSID_DxcCompiler, IID_PPV_ARGS(&m_pCompiler)));
+
+      std::vector<HRESULT> jobResults(count, E_FAIL);
+      hlsl::RunConcurrently(count, [&](UINT32 i) {
+        jobResults[i] = GetFullPDBForBatch(ppPDBs[i], &ppFullPDBs[i]);
+      });
+
+      for (UINT32 i = 0; i < count; ++i) {
+        if (FAILED(jobResults[i])) {
+          for (UINT32 j = 0; j < count; ++j) {
+            if (ppFullPDBs[j]) {
+              ppFullPDBs[j]->Release();
+              ppFullPDBs[j] = nullptr;
+            }
+          }
+          return jobResults[i];
+        }
+      }
+      return S_OK;
+    }
+    CATCH_CPP_RETURN_HRESULT();
+  }
+
   virtual HRESULT STDMETHODCALLTYPE GetHash(_COM_Outptr_ IDxcBlob **ppResult) override {
     if (!ppResult) return E_POINTER;
     *ppResult = nullptr;
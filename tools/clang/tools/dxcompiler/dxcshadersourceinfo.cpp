@@ -36,7 +36,7 @@ static size_t PointerByteOffset(const void *a, const void *b) {
   return (const uint8_t *)a - (const uint8_t *)b;
 }
 
-bool SourceInfoReader::Init(const hlsl::DxilSourceInfo *SourceInfo, unsigned sourceInfoSize) {
+bool SourceInfoReader::Init(const hlsl::DxilSourceInfo *SourceInfo, unsigned sourceInfoSize, bool bLoadContents) {
   if (sizeof(*SourceInfo) > sourceInfoSize)
     return false;
   if (SourceInfo->AlignedSizeInBytes > sourceInfoSize)
@@ -147,6 +147,13 @@ bool SourceInfoReader::Init(const hlsl::DxilSourceInfo *SourceInfo, unsigned sou
       if (PointerByteOffset(header+1, section) + header->EntriesSizeInBytes > sectionSizeInBytes)
         return false;
 
+      if (!bLoadContents) {
+        // The count is still needed by readers that only want names.
+        assert(m_Sources.size() == 0 || m_Sources.size() == header->Count);
+        m_Sources.resize(header->Count);
+        break;
+      }
+
       const hlsl::DxilSourceInfo_SourceContentsEntry *firstEntry = nullptr;
       if (header->CompressType == hlsl::DxilSourceInfo_SourceContentsCompressType::Zlib) {
         m_UncompressedSources.reserve(header->UncompressedEntriesSizeInBytes);
@@ -47,7 +47,10 @@ struct SourceInfoReader {
   unsigned GetArgPairCount() const { return m_ArgPairs.size(); }
 
   // Note: The memory for SourceInfo must outlive this structure.
-  bool Init(const hlsl::DxilSourceInfo *SourceInfo, unsigned sourceInfoSize);
+  // If bLoadContents is false, the source contents section is not
+  // decompressed and every Source's Content is left empty.
+  bool Init(const hlsl::DxilSourceInfo *SourceInfo, unsigned sourceInfoSize,
+            bool bLoadContents = true);
 };
 
 // Herper for writing the shader source part.
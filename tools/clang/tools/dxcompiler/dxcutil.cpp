@@ -17,6 +17,7 @@
 #include "dxcutil.h"
 #include "dxillib.h"
 #include "clang/Basic/Diagnostic.h"
+#include "llvm/ADT/Optional.h"
 #include "llvm/Bitcode/ReaderWriter.h"
 #include "llvm/IR/DiagnosticInfo.h"
 #include "llvm/IR/DiagnosticPrinter.h"
@@ -24,6 +25,8 @@
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/Module.h"
 #include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Mutex.h"
+#include "llvm/Support/TimeProfiler.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Transforms/Utils/Cloning.h"
 #include "dxc/Support/dxcapi.impl.h"
@@ -93,10 +96,43 @@ AssembleInputs::AssembleInputs(std::unique_ptr<llvm::Module> &&pM,
     pPrivateBlob(pPrivateBlob)
 {}
 
+namespace {
+// The version of the validator CreateValidator picks. It only changes when
+// dxil.dll is loaded or unloaded, so it is cached per dxillib generation
+// rather than asking a new validator on every compile.
+struct ValidatorVersionCache {
+  llvm::sys::Mutex Lock;
+  bool Valid = false;
+  unsigned Generation = 0;
+  unsigned Major = 0;
+  unsigned Minor = 0;
+};
+
+ValidatorVersionCache &GetValidatorVersionCache() {
+  static ValidatorVersionCache Cache;
+  return Cache;
+}
+} // namespace
+
 void GetValidatorVersion(unsigned *pMajor, unsigned *pMinor) {
   if (pMajor == nullptr || pMinor == nullptr)
     return;
 
+  // This makes the first attempt to load dxil.dll if none was made yet,
+  // which bumps the generation.
+  DxilLibIsEnabled();
+  unsigned Generation = DxilLibGetGeneration();
+
+  ValidatorVersionCache &Cache = GetValidatorVersionCache();
+  {
+    llvm::sys::ScopedLock Guard(Cache.Lock);
+    if (Cache.Valid && Cache.Generation == Generation) {
+      *pMajor = Cache.Major;
+      *pMinor = Cache.Minor;
+      return;
+    }
+  }
+
   CComPtr<IDxcValidator> pValidator;
   CreateValidator(pValidator);
 
@@ -108,9 +144,16 @@ void GetValidatorVersion(unsigned *pMajor, unsigned *pMinor) {
     *pMajor = 1;
     *pMinor = 0;
   }
+
+  llvm::sys::ScopedLock Guard(Cache.Lock);
+  Cache.Valid = true;
+  Cache.Generation = Generation;
+  Cache.Major = *pMajor;
+  Cache.Minor = *pMinor;
 }
 
 void AssembleToContainer(AssembleInputs &inputs) {
+  llvm::TimeTraceScope TimeScope("Assemble container");
   CComPtr<AbstractMemoryStream> pContainerStream;
   IFT(CreateMemoryStream(inputs.pMalloc, &pContainerStream));
   if (!(inputs.SerializeFlags & SerializeDxilFlags::StripRootSignature) && inputs.pRootSigBlob) {
@@ -161,7 +204,8 @@ HRESULT ValidateAndAssembleToContainer(AssembleInputs &inputs) {
 
   // If we have debug info, this will be a clone of the module before debug info is stripped.
   // This is used with internal validator to provide more useful error messages.
-  std::unique_ptr<llvm::Module> llvmModuleWithDebugInfo;
+  llvm::Module *llvmModuleWithDebugInfo = inputs.pDebugModule;
+  std::unique_ptr<llvm::Module> llvmModuleWithDebugInfoClone;
 
   CComPtr<IDxcValidator> pValidator;
   bool bInternalValidator = CreateValidator(pValidator);
@@ -188,8 +232,10 @@ HRESULT ValidateAndAssembleToContainer(AssembleInputs &inputs) {
     // to make a clone to avoid SerializeDxilContainerForModule stripping all
     // the debug info. The debug info will be stripped from the orginal module,
     // but preserved in the cloned module.
-    if (llvm::getDebugMetadataVersionFromModule(*inputs.pM) != 0) {
-      llvmModuleWithDebugInfo.reset(llvm::CloneModule(inputs.pM.get()));
+    if (!llvmModuleWithDebugInfo &&
+        llvm::getDebugMetadataVersionFromModule(*inputs.pM) != 0) {
+      llvmModuleWithDebugInfoClone.reset(llvm::CloneModule(inputs.pM.get()));
+      llvmModuleWithDebugInfo = llvmModuleWithDebugInfoClone.get();
     }
   }
 
@@ -216,11 +262,13 @@ HRESULT ValidateAndAssembleToContainer(AssembleInputs &inputs) {
   AssembleToContainer(inputs);
 
   CComPtr<IDxcOperationResult> pValResult;
+  llvm::Optional<llvm::TimeTraceScope> validationTrace;
+  validationTrace.emplace("Validation");
   // Important: in-place edit is required so the blob is reused and thus
   // dxil.dll can be released.
   if (bInternalValidator) {
     IFT(RunInternalValidator(pValidator, inputs.pM.get(),
-                             llvmModuleWithDebugInfo.get(), inputs.pOutputContainerBlob,
+                             llvmModuleWithDebugInfo, inputs.pOutputContainerBlob,
                              DxcValidatorFlags_InPlaceEdit, &pValResult));
   } else {
     if (pValidator2 && llvmModuleWithDebugInfo) {
@@ -229,7 +277,7 @@ HRESULT ValidateAndAssembleToContainer(AssembleInputs &inputs) {
       CComPtr<AbstractMemoryStream> pDebugModuleStream;
       IFT(CreateMemoryStream(DxcGetThreadMallocNoRef(), &pDebugModuleStream));
       raw_stream_ostream outStream(pDebugModuleStream.p);
-      WriteBitcodeToFile(llvmModuleWithDebugInfo.get(), outStream, true);
+      WriteBitcodeToFile(llvmModuleWithDebugInfo, outStream, true);
       outStream.flush();
 
       DxcBuffer debugModule = {};
@@ -244,6 +292,7 @@ HRESULT ValidateAndAssembleToContainer(AssembleInputs &inputs) {
                                &pValResult));
     }
   }
+  validationTrace.reset();
   IFT(pValResult->GetStatus(&valHR));
   if (inputs.pDiag) {
     if (FAILED(valHR)) {
@@ -14,6 +14,7 @@
 #include "dxc/dxcapi.h"
 #include "dxc/Support/microcom.h"
 #include <memory>
+#include "llvm/ADT/ArrayRef.h"
 #include "llvm/ADT/StringRef.h"
 
 namespace clang {
@@ -24,7 +25,7 @@ namespace llvm {
 class LLVMContext;
 class MemoryBuffer;
 class Module;
-class raw_string_ostream;
+class raw_ostream;
 class Twine;
 } // namespace llvm
 
@@ -63,6 +64,9 @@ struct AssembleInputs {
   hlsl::AbstractMemoryStream *pRootSigOut = nullptr;
   CComPtr<IDxcBlob> pRootSigBlob = nullptr;
   CComPtr<IDxcBlob> pPrivateBlob = nullptr;
+  // Copy of pM made before debug info is stripped, if the caller already has
+  // one. Validation uses it instead of cloning pM again; it is not modified.
+  llvm::Module *pDebugModule = nullptr;
 };
 HRESULT ValidateAndAssembleToContainer(AssembleInputs &inputs);
 HRESULT ValidateRootSignatureInContainer(
@@ -70,7 +74,11 @@ HRESULT ValidateRootSignatureInContainer(
 HRESULT SetRootSignature(hlsl::DxilModule *pModule, CComPtr<IDxcBlob> pSource);
 void GetValidatorVersion(unsigned *pMajor, unsigned *pMinor);
 void AssembleToContainer(AssembleInputs &inputs);
-HRESULT Disassemble(IDxcBlob *pProgram, llvm::raw_string_ostream &Stream);
+// Writes the disassembly of pProgram to Stream. If functionNames isn't empty,
+// only those functions are read from the module and printed, after the
+// container parts.
+HRESULT Disassemble(IDxcBlob *pProgram, llvm::raw_ostream &Stream,
+                    llvm::ArrayRef<std::string> functionNames = {});
 void ReadOptsAndValidate(hlsl::options::MainArgs &mainArgs,
                          hlsl::options::DxcOpts &opts,
                          hlsl::AbstractMemoryStream *pOutputStream,
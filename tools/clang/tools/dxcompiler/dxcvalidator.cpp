@@ -24,8 +24,11 @@
 #include "dxc/Support/microcom.h"
 #include "dxc/Support/FileIOHelper.h"
 #include "dxc/Support/dxcapi.impl.h"
+#include "dxc/Support/dxcconcurrency.h"
 #include "dxc/DxilRootSignature/DxilRootSignature.h"
 
+#include <vector>
+
 #ifdef _WIN32
 #include "dxcetw.h"
 #endif
@@ -54,7 +57,7 @@ struct DiagRestore {
   }
 };
 
-class DxcValidator : public IDxcValidator2,
+class DxcValidator : public IDxcValidator3,
 #ifdef SUPPORT_QUERY_GIT_COMMIT_INFO
                      public IDxcVersionInfo2
 #else
@@ -80,7 +83,8 @@ public:
   DXC_MICROCOM_TM_CTOR(DxcValidator)
 
   HRESULT STDMETHODCALLTYPE QueryInterface(REFIID iid, void **ppvObject) override {
-    return DoBasicQueryInterface<IDxcValidator, IDxcValidator2, IDxcVersionInfo>(this, iid, ppvObject);
+    return DoBasicQueryInterface<IDxcValidator, IDxcValidator2, IDxcValidator3,
+                                 IDxcVersionInfo>(this, iid, ppvObject);
   }
 
   // For internal use only.
@@ -107,6 +111,15 @@ public:
     _COM_Outptr_ IDxcOperationResult **ppResult   // Validation output status, buffer, and errors
     ) override;
 
+  // IDxcValidator3
+  HRESULT STDMETHODCALLTYPE ValidateBatch(
+    _In_count_(shaderCount) IDxcBlob *const *ppShaders, // Shaders to validate.
+    _In_ UINT32 shaderCount,                      // Number of shaders.
+    _In_ UINT32 Flags,                            // Validation flags.
+    _Out_writes_(shaderCount)
+        IDxcOperationResult **ppResults           // One result per shader: status, buffer, and errors
+    ) override;
+
   // IDxcVersionInfo
   HRESULT STDMETHODCALLTYPE GetVersion(_Out_ UINT32 *pMajor, _Out_ UINT32 *pMinor) override;
   HRESULT STDMETHODCALLTYPE GetFlags(_Out_ UINT32 *pFlags) override;
@@ -175,6 +188,55 @@ HRESULT STDMETHODCALLTYPE DxcValidator::ValidateWithDebug(
   return hr;
 }
 
+HRESULT STDMETHODCALLTYPE DxcValidator::ValidateBatch(
+  _In_count_(shaderCount) IDxcBlob *const *ppShaders, // Shaders to validate.
+  _In_ UINT32 shaderCount,                      // Number of shaders.
+  _In_ UINT32 Flags,                            // Validation flags.
+  _Out_writes_(shaderCount)
+      IDxcOperationResult **ppResults           // One result per shader: status, buffer, and errors
+) {
+  if ((shaderCount > 0 && ppShaders == nullptr) || ppResults == nullptr)
+    return E_INVALIDARG;
+  for (UINT32 i = 0; i < shaderCount; ++i) {
+    ppResults[i] = nullptr;
+    if (ppShaders[i] == nullptr)
+      return E_INVALIDARG;
+  }
+  if (Flags & ~DxcValidatorFlags_ValidMask)
+    return E_INVALIDARG;
+  if ((Flags & DxcValidatorFlags_ModuleOnly) && (Flags & (DxcValidatorFlags_InPlaceEdit | DxcValidatorFlags_RootSignatureOnly)))
+    return E_INVALIDARG;
+
+  DxcThreadMalloc TM(m_pMalloc);
+  try {
+    std::vector<HRESULT> shaderResults(shaderCount, E_FAIL);
+    // Each validation loads its modules into a context of its own, so the
+    // type names the validator checks never collide with an earlier shader's.
+    // The shaders already keep every thread busy, so each one validates its
+    // functions serially.
+    RunConcurrently(shaderCount, [&](UINT32 i) {
+      DxcThreadMalloc TM(m_pMalloc);
+      SerialFunctionValidationScope serialScope;
+      shaderResults[i] = ValidateWithOptModules(ppShaders[i], Flags, nullptr,
+                                                nullptr, &ppResults[i]);
+    });
+
+    for (UINT32 i = 0; i < shaderCount; ++i) {
+      if (FAILED(shaderResults[i])) {
+        for (UINT32 j = 0; j < shaderCount; ++j) {
+          if (ppResults[j]) {
+            ppResults[j]->Release();
+            ppResults[j] = nullptr;
+          }
+        }
+        return shaderResults[i];
+      }
+    }
+    return S_OK;
+  }
+  CATCH_CPP_RETURN_HRESULT();
+}
+
 HRESULT DxcValidator::ValidateWithOptModules(
   _In_ IDxcBlob *pShader,                       // Shader to validate.
   _In_ UINT32 Flags,                            // Validation flags.
@@ -278,7 +340,9 @@ HRESULT DxcValidator::RunValidation(
     if (Flags & DxcValidatorFlags_ModuleOnly) {
       return ValidateDxilBitcode((const char*)pShader->GetBufferPointer(), (uint32_t)pShader->GetBufferSize(), DiagStream);
     } else {
-      return ValidateDxilContainer(pShader->GetBufferPointer(), pShader->GetBufferSize(), DiagStream);
+      return ValidateDxilContainer(pShader->GetBufferPointer(), pShader->GetBufferSize(),
+                                   nullptr, 0, DiagStream,
+                                   (Flags & DxcValidatorFlags_AllowCachedResult) != 0);
     }
   }
 
@@ -318,6 +382,12 @@ HRESULT DxcValidator::RunRootSignatureValidation(
     // Container has shader part, make sure we have PSV.
     IFRBOOL(pPSVPart, DXC_E_MISSING_PART);
   }
+  // Without a shader there is only the standalone verification left, which
+  // root signatures compiled in this process have already passed.
+  if (!pProgramHeader &&
+      IsRootSignatureVerified(GetDxilPartData(pRSPart), pRSPart->PartSize)) {
+    return S_OK;
+  }
   try {
     RootSignatureHandle RSH;
     RSH.LoadSerialized((const uint8_t*)GetDxilPartData(pRSPart), pRSPart->PartSize);
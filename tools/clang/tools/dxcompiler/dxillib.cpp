@@ -13,6 +13,7 @@
 #include "dxc/Support/Global.h" // For DXASSERT
 #include "dxc/Support/dxcapi.use.h"
 #include "llvm/Support/Mutex.h"
+#include <atomic>
 
 using namespace dxc;
 
@@ -20,6 +21,8 @@ static DxcDllSupport g_DllSupport;
 static HRESULT g_DllLibResult = S_OK;
 
 static llvm::sys::Mutex *cs = nullptr;
+// Bumped whenever dxil.dll may have been loaded or unloaded.
+static std::atomic<unsigned> g_DllLibGeneration(0);
 
 // Check if we can successfully get IDxcValidator from dxil.dll
 // This function is to prevent multiple attempts to load dxil.dll 
@@ -30,6 +33,7 @@ HRESULT DxilLibInitialize() {
   g_DllLibResult = g_DllSupport.InitializeForDll(L"dxil.dll", "DxcCreateInstance");
   cs->unlock();
 #endif
+  ++g_DllLibGeneration;
   return S_OK;
 }
 
@@ -44,6 +48,7 @@ HRESULT DxilLibCleanup(DxilLibCleanUpType type) {
   else {
     hr = E_INVALIDARG;
   }
+  ++g_DllLibGeneration;
   delete cs;
   cs = nullptr;
   return hr;
@@ -58,6 +63,7 @@ bool DxilLibIsEnabled() {
   if (SUCCEEDED(g_DllLibResult)) {
     if (!g_DllSupport.IsEnabled()) {
       g_DllLibResult = g_DllSupport.InitializeForDll(L"dxil.dll", "DxcCreateInstance");
+      ++g_DllLibGeneration;
     }
   }
   cs->unlock();
@@ -68,6 +74,9 @@ bool DxilLibIsEnabled() {
 #endif
 }
 
+unsigned DxilLibGetGeneration() {
+  return g_DllLibGeneration;
+}
 
 HRESULT DxilLibCreateInstance(_In_ REFCLSID rclsid, _In_ REFIID riid, _In_ IUnknown **ppInterface) {
   DXASSERT_NOMSG(ppInterface != nullptr);
@@ -32,6 +32,10 @@ HRESULT DxilLibCleanup(DxilLibCleanUpType type);
 // Check if can access dxil.dll
 bool DxilLibIsEnabled();
 
+// Changes every time dxil.dll is loaded or unloaded, so that anything cached
+// from it can tell when it is stale.
+unsigned DxilLibGetGeneration();
+
 HRESULT DxilLibCreateInstance(_In_ REFCLSID rclsid, _In_ REFIID riid, _In_ IUnknown **ppInterface);
 
 template <class TInterface>
@@ -20,9 +20,11 @@
 //
 // RUN
 // ===
-// $ <dxc-build-dir>\bin\dxil2spv <input-file>
+// $ <dxc-build-dir>\bin\dxil2spv <input-file> [<input-file>...]
 //
-//   where <input-file> may be either a DXIL bitcode file or DXIL IR.
+//   where each <input-file> may be either a DXIL bitcode file or DXIL IR.
+//   Several input files are translated in order in one process, and their
+//   outputs are written one after another.
 //
 // OUTPUT
 // ======
@@ -32,6 +34,7 @@
 #include "dxc/Support/ErrorCodes.h"
 #include "dxc/Support/Global.h"
 #include "dxc/Support/HLSLOptions.h"
+#include "dxc/Support/Unicode.h"
 #include "dxc/Support/WinAdapter.h"
 #include "dxc/Support/dxcapi.use.h"
 #include "dxc/dxcapi.h"
@@ -65,13 +68,11 @@ int main(int argc, const char **argv_) {
     llvm::errs() << "Required input file argument is missing\n";
     return DXC_E_GENERAL_INTERNAL_ERROR;
   }
-  hlsl::options::StringRefWide filename(argv_[1]);
 
-  // Read input file.
+  // The dxcompiler library and the diagnostics setup are shared by every
+  // input file.
   dxc::DxcDllSupport dxcSupport;
   IFT(dxcSupport.Initialize());
-  CComPtr<IDxcBlobEncoding> blob;
-  ReadFileIntoBlob(dxcSupport, filename, &blob);
 
   // Setup a compiler instance with diagnostics.
   clang::CompilerInstance instance;
@@ -80,7 +81,44 @@ int main(int argc, const char **argv_) {
   instance.createDiagnostics(diagnosticPrinter, false);
   instance.setOutStream(&llvm::outs());
 
-  // Run translator.
-  clang::dxil2spv::Translator translator(instance);
-  return translator.Run(blob);
+  int result = 0;
+  for (int i = 1; i < argc; ++i) {
+    hlsl::options::StringRefWide filename(argv_[i]);
+
+    // A file that cannot be read or translated is reported, and the
+    // remaining inputs are still translated.
+    int fileResult;
+    try {
+      // Read input file.
+      CComPtr<IDxcBlobEncoding> blob;
+      ReadFileIntoBlob(dxcSupport, filename, &blob);
+
+      // Run translator. Each input gets its own SPIR-V context and builder so
+      // that types and IDs do not leak from one module into the next.
+      clang::dxil2spv::Translator translator(instance);
+      fileResult = translator.Run(blob);
+    } catch (const ::hlsl::Exception &hlslException) {
+      std::string name;
+#ifdef _WIN32
+      Unicode::WideToUTF8String(argv_[i], &name);
+#else
+      name = argv_[i];
+#endif // _WIN32
+      llvm::errs() << name << ": ";
+      if (hlslException.msg.empty()) {
+        llvm::errs() << "error code 0x";
+        llvm::errs().write_hex(static_cast<uint32_t>(hlslException.hr));
+      } else {
+        llvm::errs() << hlslException.msg;
+      }
+      llvm::errs() << "\n";
+      fileResult = DXC_E_GENERAL_INTERNAL_ERROR;
+    } catch (const std::bad_alloc &) {
+      llvm::errs() << "out of memory\n";
+      fileResult = DXC_E_GENERAL_INTERNAL_ERROR;
+    }
+    if (fileResult != 0)
+      result = fileResult;
+  }
+  return result;
 }
@@ -132,6 +132,7 @@ private:
   DXC_MICROCOM_TM_REF_FIELDS()
     bool m_findCalledShaders = false;
   int m_debugOutput = 0;
+  bool m_coherentDispatch = false;
 
   // Only used for test purposes when exports aren't explicitly listed
   std::unique_ptr<DxrFallbackCompiler::IntToFuncNameMap> m_pCachedMap;
@@ -156,6 +157,12 @@ public:
     return S_OK;
   }
 
+  __override HRESULT STDMETHODCALLTYPE SetCoherentDispatch(bool val)
+  {
+    m_coherentDispatch = val;
+    return S_OK;
+  }
+
   __override HRESULT STDMETHODCALLTYPE PatchShaderBindingTables(
       _In_ const LPCWSTR pEntryName,
       _In_ DxcShaderBytecode *pShaderBytecode,
@@ -499,6 +506,7 @@ HRESULT STDMETHODCALLTYPE DxcDxrFallbackCompiler::Link(
 
         DxrFallbackCompiler compiler(M.get(), shaderNames, maxAttributeSize, stackSizeInBytes, m_findCalledShaders);
         compiler.setDebugOutputLevel(m_debugOutput);
+        compiler.setDispatchStrategy(m_coherentDispatch ? DxrFallbackCompiler::DispatchStrategy::Coherent : DxrFallbackCompiler::DispatchStrategy::Serial);
         shaderEntryStateIds.resize(shaderCount);
         shaderStackSizes.resize(shaderCount);
         for (UINT i = 0; i < shaderCount; i++)
@@ -695,6 +703,7 @@ HRESULT STDMETHODCALLTYPE DxcDxrFallbackCompiler::Compile(
     std::vector<unsigned int> shaderStackSizes;
     DxrFallbackCompiler compiler(M.get(), shaderNames, maxAttributeSize, 0, m_findCalledShaders);
     compiler.setDebugOutputLevel(m_debugOutput);
+    compiler.setDispatchStrategy(m_coherentDispatch ? DxrFallbackCompiler::DispatchStrategy::Coherent : DxrFallbackCompiler::DispatchStrategy::Serial);
     compiler.compile(shaderEntryStateIds, shaderStackSizes, m_pCachedMap.get());
     if (m_debugOutput)
     {
@@ -23,6 +23,8 @@
 #include "llvm/Support//MSFileSystem.h"
 #include "llvm/Support/FileSystem.h"
 
+#include <vector>
+
 using namespace dxc;
 using namespace llvm;
 using namespace llvm::opt;
@@ -32,8 +34,8 @@ static cl::opt<bool> Help("help", cl::desc("Print help"));
 static cl::alias Help_h("h", cl::aliasopt(Help));
 static cl::alias Help_q("?", cl::aliasopt(Help));
 
-static cl::opt<std::string>
-InputFilename(cl::Positional, cl::desc("<input dxil file>"));
+static cl::list<std::string>
+InputFilenames(cl::Positional, cl::desc("<input dxil files>"), cl::ZeroOrMore);
 
 static cl::opt<std::string> OutputFilename("o",
                                            cl::desc("Override output filename for signed container"),
@@ -46,10 +48,108 @@ public:
   DxvContext(DxcDllSupport &dxcSupport)
       : m_dxcSupport(dxcSupport) {}
 
-  void Validate();
+  void Validate(const std::string &InputFilename);
+  // Validates every input concurrently and prints a summary in input order.
+  // Returns the number of inputs that failed.
+  unsigned ValidateBatch(const std::vector<std::string> &InputFilenames);
 };
 
-void DxvContext::Validate() {
+// Returns the text of an operation result's error buffer.
+static std::string GetErrorText(IDxcOperationResult *pResult) {
+  CComPtr<IDxcBlobEncoding> text;
+  IFT(pResult->GetErrorBuffer(&text));
+  if (!text || text->GetBufferSize() == 0)
+    return std::string();
+  const char *pStart = (const char *)text->GetBufferPointer();
+  return std::string(pStart, strnlen(pStart, text->GetBufferSize()));
+}
+
+unsigned DxvContext::ValidateBatch(const std::vector<std::string> &InputFilenames) {
+  UINT32 inputCount = (UINT32)InputFilenames.size();
+  std::vector<std::string> errors(inputCount);
+  std::vector<CComPtr<IDxcBlob>> containers(inputCount);
+
+  CComPtr<IDxcAssembler> pAssembler;
+  for (UINT32 i = 0; i < inputCount; ++i) {
+    CComPtr<IDxcBlobEncoding> pSource;
+    ReadFileIntoBlob(m_dxcSupport, StringRefWide(InputFilenames[i]), &pSource);
+    if (hlsl::IsValidDxilContainer(
+            hlsl::IsDxilContainerLike(pSource->GetBufferPointer(),
+                                      pSource->GetBufferSize()),
+            pSource->GetBufferSize())) {
+      containers[i] = pSource;
+      continue;
+    }
+    // Otherwise assume assembly to container is required.
+    if (!pAssembler)
+      IFT(m_dxcSupport.CreateInstance(CLSID_DxcAssembler, &pAssembler));
+    CComPtr<IDxcOperationResult> pAsmResult;
+    HRESULT resultStatus;
+    IFT(pAssembler->AssembleToContainer(pSource, &pAsmResult));
+    IFT(pAsmResult->GetStatus(&resultStatus));
+    if (FAILED(resultStatus))
+      errors[i] = GetErrorText(pAsmResult);
+    else
+      IFT(pAsmResult->GetResult(&containers[i]));
+  }
+
+  // Inputs that failed to assemble are left out of the batch.
+  std::vector<IDxcBlob *> shaders;
+  std::vector<UINT32> shaderInputs;
+  for (UINT32 i = 0; i < inputCount; ++i) {
+    if (containers[i]) {
+      shaders.emplace_back(containers[i]);
+      shaderInputs.emplace_back(i);
+    }
+  }
+
+  CComPtr<IDxcValidator> pValidator;
+  CComPtr<IDxcValidator3> pValidator3;
+  IFT(m_dxcSupport.CreateInstance(CLSID_DxcValidator, &pValidator));
+  std::vector<CComPtr<IDxcOperationResult>> results(shaders.size());
+  if (SUCCEEDED(pValidator.QueryInterface(&pValidator3))) {
+    std::vector<IDxcOperationResult *> pResults(shaders.size());
+    IFT(pValidator3->ValidateBatch(shaders.data(), (UINT32)shaders.size(),
+                                   DxcValidatorFlags_InPlaceEdit,
+                                   pResults.data()));
+    for (size_t i = 0; i < shaders.size(); ++i)
+      results[i].Attach(pResults[i]);
+  } else {
+    // Older validators have no batch entry point.
+    for (size_t i = 0; i < shaders.size(); ++i)
+      IFT(pValidator->Validate(shaders[i], DxcValidatorFlags_InPlaceEdit,
+                               &results[i]));
+  }
+
+  std::vector<bool> failed(inputCount, false);
+  for (UINT32 i = 0; i < inputCount; ++i)
+    failed[i] = !containers[i];
+  for (size_t i = 0; i < shaders.size(); ++i) {
+    HRESULT status;
+    IFT(results[i]->GetStatus(&status));
+    if (FAILED(status)) {
+      failed[shaderInputs[i]] = true;
+      errors[shaderInputs[i]] = GetErrorText(results[i]);
+    }
+  }
+
+  unsigned failedCount = 0;
+  for (UINT32 i = 0; i < inputCount; ++i) {
+    if (!failed[i]) {
+      printf("%s: Validation succeeded.\n", InputFilenames[i].c_str());
+      continue;
+    }
+    ++failedCount;
+    printf("%s: Validation failed.\n", InputFilenames[i].c_str());
+    if (!errors[i].empty())
+      printf("%s\n", errors[i].c_str());
+  }
+  printf("%u of %u passed, %u failed.\n", inputCount - failedCount,
+         inputCount, failedCount);
+  return failedCount;
+}
+
+void DxvContext::Validate(const std::string &InputFilename) {
   {
     CComPtr<IDxcBlobEncoding> pSource;
     ReadFileIntoBlob(m_dxcSupport, StringRefWide(InputFilename), &pSource);
@@ -145,17 +245,28 @@ int __cdecl main(int argc,  _In_reads_z_(argc) const char **argv) {
     // Parse command line options.
     cl::ParseCommandLineOptions(argc, argv, "dxil validator\n");
 
-    if (InputFilename == "" || Help) {
+    if (InputFilenames.empty() || Help) {
       cl::PrintHelpMessage();
       return 2;
     }
+    if (InputFilenames.size() > 1 && !OutputFilename.empty()) {
+      printf("-o may only be used with a single input file.\n");
+      return 2;
+    }
 
     DxcDllSupport dxcSupport;
     dxc::EnsureEnabled(dxcSupport);
 
     DxvContext context(dxcSupport);
     pStage = "Validation";
-    context.Validate();
+    if (InputFilenames.size() > 1) {
+      std::vector<std::string> inputs(InputFilenames.begin(),
+                                      InputFilenames.end());
+      if (context.ValidateBatch(inputs) != 0)
+        return 1;
+    } else {
+      context.Validate(InputFilenames[0]);
+    }
   } catch (const ::hlsl::Exception &hlslException) {
     try {
       const char *msg = hlslException.what();
@@ -3343,6 +3343,7 @@ struct ReparseTranslationUnitInfo {
   ArrayRef<CXUnsavedFile> unsaved_files;
   unsigned options;
   CXErrorCode &result;
+  ::llvm::sys::fs::MSFileSystemRef fsr; // HLSL Change
 };
 
 static void clang_reparseTranslationUnit_Impl(void *UserData) {
@@ -3350,7 +3351,6 @@ static void clang_reparseTranslationUnit_Impl(void *UserData) {
       static_cast<ReparseTranslationUnitInfo *>(UserData);
   CXTranslationUnit TU = RTUI->TU;
   unsigned options = RTUI->options;
-  (void) options;
 
   // Check arguments.
   if (isNotUsableTU(TU)) {
@@ -3359,6 +3359,14 @@ static void clang_reparseTranslationUnit_Impl(void *UserData) {
     return;
   }
 
+  // HLSL Change Starts
+  if (RTUI->fsr) {
+    // No need to clean up in this case - this means we run in our own thread
+    // (otherwise caller owns the thread and should set this up).
+    ::llvm::sys::fs::SetCurrentThreadFileSystem(RTUI->fsr);
+  }
+  // HLSL Change Ends
+
   // Reset the associated diagnostics.
   delete static_cast<CXDiagnosticSetImpl*>(TU->Diagnostics);
   TU->Diagnostics = nullptr;
@@ -3384,7 +3392,8 @@ static void clang_reparseTranslationUnit_Impl(void *UserData) {
   }
 
   if (!CXXUnit->Reparse(CXXIdx->getPCHContainerOperations(),
-                        *RemappedFiles.get()))
+                        *RemappedFiles.get(),
+                        options & CXReparse_SkipIncludedFunctionBodies)) // HLSL Change
     RTUI->result = CXError_Success;
   else if (isASTReadError(CXXUnit))
     RTUI->result = CXError_ASTReadError;
@@ -3404,13 +3413,15 @@ int clang_reparseTranslationUnit(CXTranslationUnit TU,
   CXErrorCode result = CXError_Failure;
   ReparseTranslationUnitInfo RTUI = {
       TU, llvm::makeArrayRef(unsaved_files, num_unsaved_files), options,
-      result};
+      result, nullptr};
 
   if (getenv("LIBCLANG_NOTHREADS")) {
     clang_reparseTranslationUnit_Impl(&RTUI);
     return result;
   }
 
+  RTUI.fsr = ::llvm::sys::fs::GetCurrentThreadFileSystem(); // HLSL Change
+
   llvm::CrashRecoveryContext CRC;
 
   if (!RunSafely(CRC, clang_reparseTranslationUnit_Impl, &RTUI)) {
@@ -1254,6 +1254,18 @@ HRESULT DxcIntelliSense::CreateUnsavedFile(LPCSTR fileName, LPCSTR contents, uns
   return DxcBasicUnsavedFile::Create(fileName, contents, contentLength, pResult);
 }
 
+_Use_decl_annotations_
+HRESULT DxcIntelliSense::ReparseTranslationUnit(
+  IDxcTranslationUnit* pTranslationUnit,
+  IDxcUnsavedFile** pUnsavedFiles,
+  unsigned numUnsavedFiles)
+{
+  if (pTranslationUnit == nullptr) return E_INVALIDARG;
+  DxcTranslationUnit* tuImpl = reinterpret_cast<DxcTranslationUnit*>(pTranslationUnit);
+  return tuImpl->ReparseWithOptions(pUnsavedFiles, numUnsavedFiles,
+                                    CXReparse_SkipIncludedFunctionBodies);
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 
 void DxcSourceLocation::Initialize(const CXSourceLocation& location)
@@ -1469,10 +1481,21 @@ HRESULT DxcToken::GetSpelling(LPSTR* pValue)
 DxcTranslationUnit::DxcTranslationUnit(IMalloc *pMalloc)
     : m_dwRef(0), m_pMalloc(pMalloc)
     , m_tu(nullptr)
+    , m_asyncGeneration(0), m_asyncBusy(false), m_asyncStop(false)
 {
 }
 
 DxcTranslationUnit::~DxcTranslationUnit() {
+  // Pending requests are delivered as aborted before the worker exits.
+  {
+    std::lock_guard<std::mutex> lock(m_asyncLock);
+    m_asyncStop = true;
+    ++m_asyncGeneration;
+  }
+  m_asyncChanged.notify_all();
+  if (m_asyncWorker.joinable())
+    m_asyncWorker.join();
+
   if (m_tu != nullptr) {
     // TODO: until an interface to file access is defined and implemented, simply fall back to pure Win32/CRT calls.
     // Also, note that this can throw / fail in a destructor, which is a big no-no.
@@ -1617,14 +1640,31 @@ _Use_decl_annotations_
 HRESULT DxcTranslationUnit::Reparse(
   IDxcUnsavedFile** unsaved_files,
   unsigned num_unsaved_files)
+{
+  return ReparseWithOptions(unsaved_files, num_unsaved_files,
+                            clang_defaultReparseOptions(m_tu));
+}
+
+_Use_decl_annotations_
+HRESULT DxcTranslationUnit::ReparseWithOptions(
+  IDxcUnsavedFile** unsaved_files,
+  unsigned num_unsaved_files,
+  unsigned options)
 {
   HRESULT hr;
   CXUnsavedFile* local_unsaved_files;
   DxcThreadMalloc TM(m_pMalloc);
+
+  // TODO: until an interface to file access is defined and implemented, simply fall back to pure Win32/CRT calls.
+  ::llvm::sys::fs::MSFileSystem* msfPtr;
+  IFR(CreateMSFileSystemForDisk(&msfPtr));
+  std::unique_ptr<::llvm::sys::fs::MSFileSystem> msf(msfPtr);
+  ::llvm::sys::fs::AutoPerThreadSystem pts(msf.get());
+
   hr = SetupUnsavedFiles(unsaved_files, num_unsaved_files, &local_unsaved_files);
   if (FAILED(hr)) return hr;
   int reparseResult = clang_reparseTranslationUnit(
-    m_tu, num_unsaved_files, local_unsaved_files, clang_defaultReparseOptions(m_tu));
+    m_tu, num_unsaved_files, local_unsaved_files, options);
   CleanupUnsavedFiles(local_unsaved_files, num_unsaved_files);
   return reparseResult == 0 ? S_OK : E_FAIL;
 }
@@ -1833,6 +1873,157 @@ HRESULT DxcTranslationUnit::CodeCompleteAt(
   return S_OK;
 }
 
+HRESULT DxcTranslationUnit::EnqueueAsync(AsyncRequest &&request)
+{
+  try
+  {
+    {
+      std::lock_guard<std::mutex> lock(m_asyncLock);
+      if (m_asyncStop) return E_FAIL;
+      // A reparse makes everything requested before it stale.
+      if (request.IsReparse)
+        ++m_asyncGeneration;
+      request.Generation = m_asyncGeneration;
+      m_asyncQueue.push_back(std::move(request));
+      if (!m_asyncWorker.joinable())
+        m_asyncWorker = std::thread(&DxcTranslationUnit::AsyncWorkerMain, this);
+    }
+    m_asyncChanged.notify_all();
+    return S_OK;
+  }
+  CATCH_CPP_RETURN_HRESULT();
+}
+
+void DxcTranslationUnit::RunAsyncRequest(AsyncRequest &request, uint64_t generation)
+{
+  HRESULT hr = E_ABORT;
+  CComPtr<IDxcCodeCompleteResults> results;
+  if (request.Generation == generation) {
+    std::vector<IDxcUnsavedFile *> files;
+    for (IDxcUnsavedFile *pFile : request.UnsavedFiles)
+      files.push_back(pFile);
+    IDxcUnsavedFile **pFiles = files.empty() ? nullptr : files.data();
+    if (request.IsReparse)
+      hr = ReparseWithOptions(pFiles, files.size(), request.Options);
+    else
+      hr = CodeCompleteAt(request.FileName.c_str(), request.Line,
+                          request.Column, pFiles, files.size(),
+                          (DxcCodeCompleteFlags)request.Options, &results);
+
+    // Drop results that a newer edit arrived for in the meantime.
+    std::lock_guard<std::mutex> lock(m_asyncLock);
+    if (request.Generation != m_asyncGeneration) {
+      hr = E_ABORT;
+      results.Release();
+    }
+  }
+  if (request.IsReparse)
+    request.Callback->OnReparsed(hr);
+  else
+    request.Callback->OnCodeCompleted(hr, results);
+}
+
+void DxcTranslationUnit::AsyncWorkerMain()
+{
+  DxcThreadMalloc TM(m_pMalloc);
+
+  // TODO: until an interface to file access is defined and implemented, simply fall back to pure Win32/CRT calls.
+  ::llvm::sys::fs::MSFileSystem* msfPtr = nullptr;
+  HRESULT hrFileSystem = CreateMSFileSystemForDisk(&msfPtr);
+  std::unique_ptr<::llvm::sys::fs::MSFileSystem> msf(msfPtr);
+  ::llvm::sys::fs::AutoPerThreadSystem pts(msf.get());
+  if (SUCCEEDED(hrFileSystem) && pts.error_code())
+    hrFileSystem = E_FAIL;
+
+  std::unique_lock<std::mutex> lock(m_asyncLock);
+  for (;;) {
+    m_asyncChanged.wait(lock, [this]() {
+      return m_asyncStop || !m_asyncQueue.empty();
+    });
+    if (m_asyncQueue.empty())
+      break;
+    AsyncRequest request = std::move(m_asyncQueue.front());
+    m_asyncQueue.pop_front();
+    m_asyncBusy = true;
+    uint64_t generation = m_asyncGeneration;
+    lock.unlock();
+
+    if (FAILED(hrFileSystem)) {
+      if (request.IsReparse)
+        request.Callback->OnReparsed(hrFileSystem);
+      else
+        request.Callback->OnCodeCompleted(hrFileSystem, nullptr);
+    } else {
+      RunAsyncRequest(request, generation);
+    }
+    request.Callback.Release();
+
+    lock.lock();
+    m_asyncBusy = false;
+    m_asyncChanged.notify_all();
+  }
+}
+
+_Use_decl_annotations_
+HRESULT DxcTranslationUnit::ReparseAsync(
+  IDxcUnsavedFile** pUnsavedFiles, unsigned numUnsavedFiles,
+  BOOL skipIncludedBodies, IDxcTranslationUnitCallback* pCallback)
+{
+  if (pCallback == nullptr) return E_INVALIDARG;
+  if (numUnsavedFiles && pUnsavedFiles == nullptr) return E_INVALIDARG;
+  AsyncRequest request;
+  request.IsReparse = true;
+  request.UnsavedFiles.assign(pUnsavedFiles, pUnsavedFiles + numUnsavedFiles);
+  request.Options =
+      skipIncludedBodies
+          ? static_cast<unsigned>(CXReparse_SkipIncludedFunctionBodies)
+          : static_cast<unsigned>(clang_defaultReparseOptions(m_tu));
+  request.Line = request.Column = 0;
+  request.Callback = pCallback;
+  return EnqueueAsync(std::move(request));
+}
+
+_Use_decl_annotations_
+HRESULT DxcTranslationUnit::CodeCompleteAtAsync(
+  const char *fileName, unsigned line, unsigned column,
+  IDxcUnsavedFile** pUnsavedFiles, unsigned numUnsavedFiles,
+  DxcCodeCompleteFlags options, IDxcTranslationUnitCallback* pCallback)
+{
+  if (fileName == nullptr || pCallback == nullptr) return E_INVALIDARG;
+  if (numUnsavedFiles && pUnsavedFiles == nullptr) return E_INVALIDARG;
+  AsyncRequest request;
+  request.IsReparse = false;
+  request.UnsavedFiles.assign(pUnsavedFiles, pUnsavedFiles + numUnsavedFiles);
+  request.Options = options;
+  request.FileName = fileName;
+  request.Line = line;
+  request.Column = column;
+  request.Callback = pCallback;
+  return EnqueueAsync(std::move(request));
+}
+
+HRESULT DxcTranslationUnit::CancelAsync()
+{
+  {
+    std::lock_guard<std::mutex> lock(m_asyncLock);
+    ++m_asyncGeneration;
+  }
+  m_asyncChanged.notify_all();
+  return S_OK;
+}
+
+HRESULT DxcTranslationUnit::WaitForAsync()
+{
+  std::unique_lock<std::mutex> lock(m_asyncLock);
+  // A callback waiting for itself would never return.
+  if (std::this_thread::get_id() == m_asyncWorker.get_id())
+    return E_UNEXPECTED;
+  m_asyncChanged.wait(lock, [this]() {
+    return m_asyncQueue.empty() && !m_asyncBusy;
+  });
+  return S_OK;
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 
 _Use_decl_annotations_
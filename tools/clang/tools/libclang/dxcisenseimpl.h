@@ -17,6 +17,11 @@
 #include "dxc/dxcapi.internal.h"
 #include "dxc/Support/microcom.h"
 #include "dxc/Support/DxcLangExtensionsHelper.h"
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
 
 // Forward declarations.
 class DxcCursor;
@@ -189,7 +194,7 @@ public:
       _Outptr_result_nullonfailure_ IDxcTranslationUnit** pTranslationUnit) override;
 };
 
-class DxcIntelliSense : public IDxcIntelliSense, public IDxcLangExtensions3 {
+class DxcIntelliSense : public IDxcIntelliSense2, public IDxcLangExtensions3 {
 private:
   DXC_MICROCOM_TM_REF_FIELDS()
   hlsl::DxcLangExtensionsHelper m_langHelper;
@@ -200,8 +205,9 @@ public:
   DXC_LANGEXTENSIONS_HELPER_IMPL(m_langHelper);
 
   HRESULT STDMETHODCALLTYPE QueryInterface(REFIID iid, void **ppvObject) override {
-    return DoBasicQueryInterface<IDxcIntelliSense, IDxcLangExtensions,
-                                 IDxcLangExtensions2, IDxcLangExtensions3>(
+    return DoBasicQueryInterface<IDxcIntelliSense, IDxcIntelliSense2,
+                                 IDxcLangExtensions, IDxcLangExtensions2,
+                                 IDxcLangExtensions3>(
         this, iid, ppvObject);
   }
 
@@ -218,6 +224,12 @@ public:
   HRESULT STDMETHODCALLTYPE CreateUnsavedFile(
     _In_ LPCSTR fileName, _In_ LPCSTR contents, unsigned contentLength,
     _Outptr_result_nullonfailure_ IDxcUnsavedFile** pResult) override;
+
+  // IDxcIntelliSense2
+  HRESULT STDMETHODCALLTYPE ReparseTranslationUnit(
+    _In_ IDxcTranslationUnit* pTranslationUnit,
+    _In_count_(numUnsavedFiles) IDxcUnsavedFile** pUnsavedFiles,
+    unsigned numUnsavedFiles) override;
 };
 
 class DxcSourceLocation : public IDxcSourceLocation
@@ -296,22 +308,50 @@ public:
   HRESULT STDMETHODCALLTYPE GetSpelling(_Outptr_result_maybenull_ LPSTR* pValue) override;
 };
 
-class DxcTranslationUnit : public IDxcTranslationUnit
+class DxcTranslationUnit : public IDxcTranslationUnit2
 {
 private:
     DXC_MICROCOM_TM_REF_FIELDS()
     CXTranslationUnit m_tu;
+
+    // A request queued for the worker thread.
+    struct AsyncRequest {
+      bool IsReparse;
+      std::vector<CComPtr<IDxcUnsavedFile>> UnsavedFiles;
+      unsigned Options;
+      std::string FileName;
+      unsigned Line, Column;
+      CComPtr<IDxcTranslationUnitCallback> Callback;
+      uint64_t Generation;
+    };
+    // Guards the fields below. A request is stale once m_asyncGeneration has
+    // moved past the value it was queued with.
+    std::mutex m_asyncLock;
+    std::condition_variable m_asyncChanged;
+    std::deque<AsyncRequest> m_asyncQueue;
+    std::thread m_asyncWorker;
+    uint64_t m_asyncGeneration;
+    bool m_asyncBusy;
+    bool m_asyncStop;
+
+    HRESULT EnqueueAsync(AsyncRequest &&request);
+    void RunAsyncRequest(AsyncRequest &request, uint64_t generation);
+    void AsyncWorkerMain();
 public:
     DXC_MICROCOM_TM_ADDREF_RELEASE_IMPL()
     DXC_MICROCOM_TM_ALLOC(DxcTranslationUnit)
     HRESULT STDMETHODCALLTYPE QueryInterface(REFIID iid, void** ppvObject) override
     {
-      return DoBasicQueryInterface<IDxcTranslationUnit>(this, iid, ppvObject);
+      return DoBasicQueryInterface<IDxcTranslationUnit, IDxcTranslationUnit2>(this, iid, ppvObject);
     }
 
     DxcTranslationUnit(IMalloc *pMalloc);
     ~DxcTranslationUnit();
     void Initialize(CXTranslationUnit tu);
+    // Reparses with the given CXReparse_Flags.
+    HRESULT ReparseWithOptions(
+      _In_count_(num_unsaved_files) IDxcUnsavedFile** unsaved_files,
+      unsigned num_unsaved_files, unsigned options);
 
     HRESULT STDMETHODCALLTYPE GetCursor(_Outptr_ IDxcCursor** pCursor) override;
     HRESULT STDMETHODCALLTYPE Tokenize(
@@ -347,6 +387,19 @@ public:
       _In_ DxcCodeCompleteFlags options,
       _Outptr_result_nullonfailure_ IDxcCodeCompleteResults **pResult)
       override;
+
+    // IDxcTranslationUnit2
+    HRESULT STDMETHODCALLTYPE ReparseAsync(
+      _In_count_(numUnsavedFiles) IDxcUnsavedFile** pUnsavedFiles,
+      unsigned numUnsavedFiles, BOOL skipIncludedBodies,
+      _In_ IDxcTranslationUnitCallback* pCallback) override;
+    HRESULT STDMETHODCALLTYPE CodeCompleteAtAsync(
+      _In_ const char *fileName, unsigned line, unsigned column,
+      _In_count_(numUnsavedFiles) IDxcUnsavedFile** pUnsavedFiles,
+      unsigned numUnsavedFiles, DxcCodeCompleteFlags options,
+      _In_ IDxcTranslationUnitCallback* pCallback) override;
+    HRESULT STDMETHODCALLTYPE CancelAsync() override;
+    HRESULT STDMETHODCALLTYPE WaitForAsync() override;
 };
 
 class DxcType : public IDxcType
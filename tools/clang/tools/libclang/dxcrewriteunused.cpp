@@ -26,6 +26,7 @@
 #include "clang/Frontend/ASTUnit.h"
 #include "clang/Frontend/FrontendActions.h"
 #include "clang/Frontend/TextDiagnosticPrinter.h"
+#include "llvm/ADT/Hashing.h"
 #include "llvm/Support/Host.h"
 #include "clang/Sema/SemaHLSL.h"
 
@@ -44,6 +45,8 @@
 #include "dxc/Support/dxcfilesystem.h"
 #include "dxc/Support/HLSLOptions.h"
 
+#include <mutex>
+
 // From dxcutil.h
 namespace dxcutil {
 bool IsAbsoluteOrCurDirRelative(const llvm::Twine &T);
@@ -125,79 +128,58 @@ static void SaveTypeDecl(TagDecl *tagDecl,
   }
 }
 
+// What a function, a global variable's initializer or a cbuffer refers to.
+struct DeclReferences {
+  // Functions to visit.
+  SmallVector<FunctionDecl *, 8> functions;
+  // Declarations without a body of the functions visited, kept for their
+  // callers.
+  SmallVector<FunctionDecl *, 4> keptDecls;
+  SmallVector<VarDecl *, 8> vars;
+  SmallVector<TagDecl *, 8> types;
+};
+
 class VarReferenceVisitor : public RecursiveASTVisitor<VarReferenceVisitor> {
 private:
-  SmallPtrSetImpl<VarDecl*>& m_unusedGlobals;
-  SmallPtrSetImpl<FunctionDecl*>& m_visitedFunctions;
-  SmallVectorImpl<FunctionDecl*>& m_pendingFunctions;
-  SmallPtrSetImpl<TypeDecl *> &m_visitedTypes;
-
-  void AddRecordType(TagDecl *tagDecl) {
-    SaveTypeDecl(tagDecl, m_visitedTypes);
-  }
+  DeclReferences &m_refs;
 
 public:
-  VarReferenceVisitor(
-    SmallPtrSetImpl<VarDecl*>& unusedGlobals,
-    SmallPtrSetImpl<FunctionDecl*>& visitedFunctions,
-    SmallVectorImpl<FunctionDecl*>& pendingFunctions,
-    SmallPtrSetImpl<TypeDecl *> &types)  :
-    m_unusedGlobals(unusedGlobals),
-    m_visitedFunctions(visitedFunctions),
-    m_pendingFunctions(pendingFunctions),
-    m_visitedTypes(types) {
-  }
+  VarReferenceVisitor(DeclReferences &refs) : m_refs(refs) {}
 
   bool VisitDeclRefExpr(DeclRefExpr* ref) {
     ValueDecl* valueDecl = ref->getDecl();
     if (FunctionDecl* fnDecl = dyn_cast_or_null<FunctionDecl>(valueDecl)) {
       FunctionDecl *fnDeclWithbody = getFunctionWithBody(fnDecl);
       if (fnDeclWithbody) {
-        if (!m_visitedFunctions.count(fnDeclWithbody)) {
-          m_pendingFunctions.push_back(fnDeclWithbody);
-        }
+        m_refs.functions.push_back(fnDeclWithbody);
       }
       if (fnDeclWithbody && fnDeclWithbody != fnDecl) {
         // In case fnDecl is only a decl, setDecl to fnDeclWithbody.
         ref->setDecl(fnDeclWithbody);
         // Keep the fnDecl for now, since it might be predecl.
-        m_visitedFunctions.insert(fnDecl);
+        m_refs.keptDecls.push_back(fnDecl);
       }
     }
     else if (VarDecl* varDecl = dyn_cast_or_null<VarDecl>(valueDecl)) {
-      m_unusedGlobals.erase(varDecl);
-      if (TagDecl *tagDecl = varDecl->getType()->getAsTagDecl()) {
-        AddRecordType(tagDecl);
-      }
-      if (Expr *initExp = varDecl->getInit()) {
-        if (InitListExpr *initList =
-                dyn_cast<InitListExpr>(initExp)) {
-          TraverseInitListExpr(initList);
-        } else if (ImplicitCastExpr *initCast = dyn_cast<ImplicitCastExpr>(initExp)) {
-          TraverseImplicitCastExpr(initCast);
-        } else if (DeclRefExpr *initRef = dyn_cast<DeclRefExpr>(initExp)) {
-          TraverseDeclRefExpr(initRef);
-        }
-      }
+      // The initializer is visited with the variable's own references.
+      m_refs.vars.push_back(varDecl);
     }
     return true;
   }
   bool VisitMemberExpr(MemberExpr *expr) {
     // Save nested struct type.
     if (TagDecl *tagDecl = expr->getType()->getAsTagDecl()) {
-      m_visitedTypes.insert(tagDecl);
+      m_refs.types.push_back(tagDecl);
     }
     return true;
   }
   bool VisitCXXMemberCallExpr(CXXMemberCallExpr *expr) {
     if (FunctionDecl *fnDecl =
             dyn_cast_or_null<FunctionDecl>(expr->getCalleeDecl())) {
-      if (!m_visitedFunctions.count(fnDecl)) {
-        m_pendingFunctions.push_back(fnDecl);
-      }
+      m_refs.functions.push_back(fnDecl);
     }
     if (CXXRecordDecl *recordDecl = expr->getRecordDecl()) {
-      AddRecordType(recordDecl);
+      m_refs.types.push_back(recordDecl);
     }
     return true;
   }
@@ -207,12 +189,12 @@ public:
     for (Decl *decl : bufDecl->decls()) {
       if (VarDecl *constDecl = dyn_cast<VarDecl>(decl)) {
         if (TagDecl *tagDecl = constDecl->getType()->getAsTagDecl()) {
-          AddRecordType(tagDecl);
+          m_refs.types.push_back(tagDecl);
         }
       } else if (isa<EmptyDecl>(decl)) {
         // Nothing to do for this declaration.
       } else if (CXXRecordDecl *recordDecl = dyn_cast<CXXRecordDecl>(decl)) {
-        m_visitedTypes.insert(recordDecl);
+        m_refs.types.push_back(recordDecl);
       } else if (isa<FunctionDecl>(decl)) {
         // A function within an cbuffer is effectively a top-level function,
         // as it only refers to globally scoped declarations.
@@ -224,6 +206,85 @@ public:
     }
     return true;
   }
+
+  // Visits the parts of a global variable that keep other declarations.
+  void TraverseVarReferences(VarDecl *varDecl) {
+    if (TagDecl *tagDecl = varDecl->getType()->getAsTagDecl()) {
+      m_refs.types.push_back(tagDecl);
+    }
+    if (Expr *initExp = varDecl->getInit()) {
+      if (InitListExpr *initList =
+              dyn_cast<InitListExpr>(initExp)) {
+        TraverseInitListExpr(initList);
+      } else if (ImplicitCastExpr *initCast = dyn_cast<ImplicitCastExpr>(initExp)) {
+        TraverseImplicitCastExpr(initCast);
+      } else if (DeclRefExpr *initRef = dyn_cast<DeclRefExpr>(initExp)) {
+        TraverseDeclRefExpr(initRef);
+      }
+    }
+  }
+};
+
+// References of each declaration, collected the first time it is reached.
+// Finding what an entry point uses then walks each function body at most
+// once, however many entry points are stripped against the same parse.
+class DeclReferenceGraph {
+public:
+  const DeclReferences &getReferences(Decl *decl) {
+    std::unique_ptr<DeclReferences> &refs = m_refs[decl];
+    if (!refs) {
+      refs = llvm::make_unique<DeclReferences>();
+      VarReferenceVisitor visitor(*refs);
+      if (VarDecl *varDecl = dyn_cast<VarDecl>(decl))
+        visitor.TraverseVarReferences(varDecl);
+      else
+        visitor.TraverseDecl(decl);
+    }
+    return *refs;
+  }
+
+private:
+  DenseMap<Decl *, std::unique_ptr<DeclReferences>> m_refs;
+};
+
+// Collects the functions, variables and types reachable from the given roots.
+// Functions referred to by cbuffer roots are not visited.
+struct ReachableDecls {
+  SmallPtrSet<FunctionDecl *, 128> functions;
+  SmallPtrSet<VarDecl *, 128> vars;
+  SmallPtrSet<TypeDecl *, 32> types;
+
+  void addFunction(DeclReferenceGraph &graph, FunctionDecl *entryFnDecl) {
+    SmallVector<Decl *, 32> pending;
+    pending.push_back(entryFnDecl);
+    visit(graph, pending, /*bVisitFunctions*/ true);
+  }
+  void addCBuffer(DeclReferenceGraph &graph, HLSLBufferDecl *CBDecl) {
+    SmallVector<Decl *, 32> pending;
+    pending.push_back(CBDecl);
+    visit(graph, pending, /*bVisitFunctions*/ false);
+  }
+
+private:
+  void visit(DeclReferenceGraph &graph, SmallVectorImpl<Decl *> &pending,
+             bool bVisitFunctions) {
+    while (!pending.empty()) {
+      const DeclReferences &refs = graph.getReferences(pending.pop_back_val());
+      if (bVisitFunctions) {
+        for (FunctionDecl *fnDecl : refs.functions) {
+          if (functions.insert(fnDecl).second)
+            pending.push_back(fnDecl);
+        }
+      }
+      functions.insert(refs.keptDecls.begin(), refs.keptDecls.end());
+      for (VarDecl *varDecl : refs.vars) {
+        if (vars.insert(varDecl).second)
+          pending.push_back(varDecl);
+      }
+      for (TagDecl *tagDecl : refs.types)
+        SaveTypeDecl(tagDecl, types);
+    }
+  }
 };
 
 // Collect all global constants.
@@ -698,6 +759,7 @@ HRESULT GenerateAST(DxcLangExtensionsHelper *pExtHelper, LPCSTR pFileName,
 }
 
 HRESULT CollectRewriteHelper(TranslationUnitDecl *tu, LPCSTR pEntryPoint,
+                             DeclReferenceGraph &graph,
                              RewriteHelper &helper, bool bRemoveGlobals,
                              bool bRemoveFunctions, raw_ostream &w) {
   ASTContext &C = tu->getASTContext();
@@ -784,20 +846,17 @@ HRESULT CollectRewriteHelper(TranslationUnitDecl *tu, LPCSTR pEntryPoint,
   }
 
   // Traverse reachable functions and variables.
-  SmallPtrSet<FunctionDecl *, 128> visitedFunctions;
-  SmallVector<FunctionDecl *, 32> pendingFunctions;
-  SmallPtrSet<TypeDecl *, 32> visitedTypes;
-  VarReferenceVisitor visitor(unusedGlobals, visitedFunctions, pendingFunctions,
-                              visitedTypes);
-  pendingFunctions.push_back(entryFnDecl);
-  while (!pendingFunctions.empty()) {
-    FunctionDecl *pendingDecl = pendingFunctions.pop_back_val();
-    visitedFunctions.insert(pendingDecl);
-    visitor.TraverseDecl(pendingDecl);
-  }
+  ReachableDecls reachable;
+  reachable.functions.insert(entryFnDecl);
+  reachable.addFunction(graph, entryFnDecl);
   // Traverse cbuffers to save types for cbuffer constant.
   for (auto *CBDecl : cbufferDecls) {
-    visitor.TraverseDecl(CBDecl);
+    reachable.addCBuffer(graph, CBDecl);
+  }
+  SmallPtrSet<FunctionDecl *, 128> &visitedFunctions = reachable.functions;
+  SmallPtrSet<TypeDecl *, 32> &visitedTypes = reachable.types;
+  for (VarDecl *varDecl : reachable.vars) {
+    unusedGlobals.erase(varDecl);
   }
 
   // Don't bother doing work if there are no globals to remove.
@@ -915,8 +974,9 @@ static HRESULT DoRewriteUnused( TranslationUnitDecl *tu,
                                 bool bRemoveFunctions,
                                 raw_ostream &w) {
   RewriteHelper helper;
-  HRESULT hr = CollectRewriteHelper(tu, pEntryPoint, helper, bRemoveGlobals,
-                                    bRemoveFunctions, w);
+  DeclReferenceGraph graph;
+  HRESULT hr = CollectRewriteHelper(tu, pEntryPoint, graph, helper,
+                                    bRemoveGlobals, bRemoveFunctions, w);
   if (hr != S_OK)
     return hr;
 
@@ -966,43 +1026,142 @@ static HRESULT DoRewriteUnused( TranslationUnitDecl *tu,
   return S_OK;
 }
 
-static HRESULT
-DoRewriteUnused(_In_ DxcLangExtensionsHelper *pHelper, _In_ LPCSTR pFileName,
-                _In_ ASTUnit::RemappedFile *pRemap, _In_ LPCSTR pEntryPoint,
-                _In_ DxcDefine *pDefines, _In_ UINT32 defineCount,
-                bool bRemoveGlobals, bool bRemoveFunctions,
-                std::string &warnings, std::string &result,
-                _In_opt_ dxcutil::DxcArgsFileSystem *msfPtr) {
+// Hides declarations from the printer until destroyed. Printing skips
+// implicit declarations, so marking them implicit leaves the AST otherwise
+// unchanged, and it can be stripped again for another entry point.
+class HiddenDecls {
+public:
+  ~HiddenDecls() {
+    for (Decl *decl : m_decls)
+      decl->setImplicit(false);
+  }
+  void hide(Decl *decl) {
+    if (!decl->isImplicit()) {
+      decl->setImplicit();
+      m_decls.push_back(decl);
+    }
+  }
 
-  raw_string_ostream o(result);
-  raw_string_ostream w(warnings);
+private:
+  SmallVector<Decl *, 128> m_decls;
+};
 
-  ASTHelper astHelper;
+// Prints tu without the declarations that helper found unused, the way
+// DoRewriteUnused would leave it, but without removing anything.
+static void PrintWithoutUnused(TranslationUnitDecl *tu, RewriteHelper &helper,
+                               raw_ostream &o) {
+  HiddenDecls hidden;
+  for (VarDecl *unusedGlobal : helper.unusedGlobals) {
+    if (const RecordType *recordTy = unusedGlobal->getType()->getAs<RecordType>()) {
+      RecordDecl *recordDecl = recordTy->getDecl();
+      // Hide an anonymous struct along with the last variable it declares.
+      if (recordDecl && recordDecl->getName().empty() &&
+          --helper.anonymousRecordRefCounts[recordDecl] == 0)
+        hidden.hide(recordDecl);
+    }
+    hidden.hide(unusedGlobal);
+  }
+  for (FunctionDecl *unusedFn : helper.unusedFunctions)
+    hidden.hide(unusedFn);
+  for (TypeDecl *unusedTy : helper.unusedTypes)
+    hidden.hide(unusedTy);
+
+  ASTContext &C = tu->getASTContext();
+  PrintingPolicy p = PrintingPolicy(C.getPrintingPolicy());
+  p.Indentation = 1;
+  tu->print(o, p);
+}
+
+// A parse of one source with one set of defines. DxcRewriter keeps the most
+// recent one, so stripping the same source again, or for several entry
+// points, reuses the AST and the references collected so far.
+struct UnusedRewriteParse {
+  size_t hash;
+  std::string source;
+  std::string defines;
+  std::unique_ptr<::llvm::sys::fs::MSFileSystem> msf;
+  std::unique_ptr<ASTHelper> astHelper;
+  DeclReferenceGraph graph;
+  std::string warnings;
+
+  static size_t computeHash(StringRef source, StringRef defines) {
+    return hash_combine(hash_value(source), hash_value(defines));
+  }
+  bool matches(size_t otherHash, StringRef otherSource,
+               StringRef otherDefines) const {
+    return hash == otherHash && source == otherSource &&
+           defines == otherDefines;
+  }
+
+  ~UnusedRewriteParse() {
+    // Tear down the compiler on the file system it read includes through.
+    ::llvm::sys::fs::AutoPerThreadSystem pts(msf.get());
+    astHelper.reset();
+  }
+};
+
+// Parses pSource with pDefines, with includes read from disk.
+static std::unique_ptr<UnusedRewriteParse>
+ParseForRewriteUnused(_In_ DxcLangExtensionsHelper *pHelper,
+                      _In_ IDxcBlobUtf8 *pSource, size_t hash,
+                      std::string &&defines, _In_ DxcDefine *pDefines,
+                      _In_ UINT32 defineCount) {
+  LPCSTR fakeName = "input.hlsl";
+  std::unique_ptr<UnusedRewriteParse> parse =
+      llvm::make_unique<UnusedRewriteParse>();
+  parse->hash = hash;
+  parse->source.assign(pSource->GetStringPointer(),
+                       pSource->GetStringLength());
+  parse->defines = std::move(defines);
+
+  ::llvm::sys::fs::MSFileSystem *msfPtr;
+  IFT(CreateMSFileSystemForDisk(&msfPtr));
+  parse->msf.reset(msfPtr);
+  ::llvm::sys::fs::AutoPerThreadSystem pts(msfPtr);
+  IFTLLVM(pts.error_code());
+
+  std::unique_ptr<llvm::MemoryBuffer> pBuffer(
+      llvm::MemoryBuffer::getMemBufferCopy(parse->source, fakeName));
+  std::unique_ptr<ASTUnit::RemappedFile> pRemap(
+      new ASTUnit::RemappedFile(fakeName, pBuffer.release()));
+
+  raw_string_ostream w(parse->warnings);
   hlsl::options::DxcOpts opts;
   opts.HLSLVersion = hlsl::LangStd::v2015;
+  parse->astHelper = llvm::make_unique<ASTHelper>();
+  GenerateAST(pHelper, fakeName, pRemap.get(), pDefines, defineCount,
+              *parse->astHelper, opts, nullptr, w);
+  w.flush();
+  return parse;
+}
 
-  GenerateAST(pHelper, pFileName, pRemap, pDefines, defineCount, astHelper,
-              opts, msfPtr, w);
+static HRESULT DoRewriteUnused(_In_ UnusedRewriteParse &parse,
+                               _In_ LPCSTR pEntryPoint, bool bRemoveGlobals,
+                               bool bRemoveFunctions, std::string &warnings,
+                               std::string &result) {
+  raw_string_ostream o(result);
+  raw_string_ostream w(warnings);
+  w << parse.warnings;
 
+  ASTHelper &astHelper = *parse.astHelper;
   if (astHelper.bHasErrors)
     return E_FAIL;
 
+  ::llvm::sys::fs::AutoPerThreadSystem pts(parse.msf.get());
+  IFTLLVM(pts.error_code());
+
   TranslationUnitDecl *tu = astHelper.tu;
-  HRESULT hr =
-      DoRewriteUnused(tu, pEntryPoint, bRemoveGlobals, bRemoveFunctions, w);
+  RewriteHelper helper;
+  HRESULT hr = CollectRewriteHelper(tu, pEntryPoint, parse.graph, helper,
+                                    bRemoveGlobals, bRemoveFunctions, w);
   if (FAILED(hr))
     return hr;
 
-  ASTContext &C = tu->getASTContext();
   if (hr == S_FALSE) {
     w << "//no unused globals found - no work to be done\n";
-    StringRef contents = C.getSourceManager().getBufferData(
-        C.getSourceManager().getMainFileID());
-    o << contents;
+    o << parse.source;
   } else {
-    PrintingPolicy p = PrintingPolicy(C.getPrintingPolicy());
-    p.Indentation = 1;
-    tu->print(o, p);
+    PrintWithoutUnused(tu, helper, o);
   }
 
   WriteMacroDefines(astHelper.semanticMacros, o);
@@ -1319,8 +1478,9 @@ HRESULT DoReWriteWithLineDirective(
     ASTContext &C = tu->getASTContext();
     rewriter.setSourceMgr(C.getSourceManager(), C.getLangOpts());
     if (opts.RWOpt.RemoveUnusedGlobals || opts.RWOpt.RemoveUnusedFunctions) {
-      HRESULT hr = CollectRewriteHelper(tu, opts.EntryPoint.data(), rwHelper,
-                           opts.RWOpt.RemoveUnusedGlobals,
+      DeclReferenceGraph graph;
+      HRESULT hr = CollectRewriteHelper(tu, opts.EntryPoint.data(), graph,
+                           rwHelper, opts.RWOpt.RemoveUnusedGlobals,
                            opts.RWOpt.RemoveUnusedFunctions, w);
       if (hr == E_FAIL)
         return hr;
@@ -1551,10 +1711,44 @@ HRESULT DoRewriteGlobalCB(_In_ DxcLangExtensionsHelper *pExtHelper,
 
 } // namespace
 
-class DxcRewriter : public IDxcRewriter2, public IDxcLangExtensions3 {
+class DxcRewriter : public IDxcRewriter3, public IDxcLangExtensions3 {
 private:
   DXC_MICROCOM_TM_REF_FIELDS()
   DxcLangExtensionsHelper m_langExtensionsHelper;
+  // The most recent parse for RemoveUnusedGlobals, reused while the source
+  // and defines stay the same. Held locked while in use.
+  std::mutex m_unusedParseMutex;
+  std::unique_ptr<UnusedRewriteParse> m_unusedParse;
+
+  // Returns the parse of pSource with pDefines, reusing the previous one if
+  // it matches. m_unusedParseMutex must be held.
+  UnusedRewriteParse &GetUnusedParse(_In_ IDxcBlobUtf8 *pSource,
+                                     _In_ DxcDefine *pDefines,
+                                     _In_ UINT32 defineCount) {
+    StringRef source(pSource->GetStringPointer(), pSource->GetStringLength());
+    std::string defines = DefinesToString(pDefines, defineCount);
+    size_t hash = UnusedRewriteParse::computeHash(source, defines);
+    if (!m_unusedParse || !m_unusedParse->matches(hash, source, defines)) {
+      m_unusedParse.reset();
+      m_unusedParse =
+          ParseForRewriteUnused(&m_langExtensionsHelper, pSource, hash,
+                                std::move(defines), pDefines, defineCount);
+    }
+    return *m_unusedParse;
+  }
+
+  static HRESULT CreateUnusedResult(HRESULT status, const std::string &rewrite,
+                                    const std::string &errors,
+                                    _COM_Outptr_ IDxcOperationResult **ppResult) {
+    LPCWSTR pOutputName = nullptr;  // TODO: Fill this in
+    return DxcResult::Create(status, DXC_OUT_HLSL, {
+        DxcOutputObject::StringOutput(DXC_OUT_HLSL, CP_UTF8,  // TODO: Support DefaultTextCodePage
+          rewrite.c_str(), pOutputName),
+        DxcOutputObject::ErrorOutput(CP_UTF8,   // TODO Support DefaultTextCodePage
+          errors.c_str())
+      }, ppResult);
+  }
+
 public:
   DXC_MICROCOM_TM_ADDREF_RELEASE_IMPL()
   DXC_MICROCOM_TM_CTOR(DxcRewriter)
@@ -1562,7 +1756,7 @@ public:
 
   HRESULT STDMETHODCALLTYPE QueryInterface(REFIID iid,
                                            void **ppvObject) override {
-    return DoBasicQueryInterface<IDxcRewriter2, IDxcRewriter,
+    return DoBasicQueryInterface<IDxcRewriter3, IDxcRewriter2, IDxcRewriter,
                                  IDxcLangExtensions, IDxcLangExtensions2, IDxcLangExtensions3>(
         this, iid, ppvObject);
   }
@@ -1584,38 +1778,76 @@ public:
     CComPtr<IDxcBlobUtf8> utf8Source;
     IFR(hlsl::DxcGetBlobAsUtf8(pSource, m_pMalloc, &utf8Source));
 
-    LPCSTR fakeName = "input.hlsl";
-
     try {
-      ::llvm::sys::fs::MSFileSystem* msfPtr;
-      IFT(CreateMSFileSystemForDisk(&msfPtr));
-      std::unique_ptr<::llvm::sys::fs::MSFileSystem> msf(msfPtr);
-      ::llvm::sys::fs::AutoPerThreadSystem pts(msf.get());
-      IFTLLVM(pts.error_code());
-
-      StringRef Data(utf8Source->GetStringPointer(), utf8Source->GetStringLength());
-      std::unique_ptr<llvm::MemoryBuffer> pBuffer(llvm::MemoryBuffer::getMemBufferCopy(Data, fakeName));
-      std::unique_ptr<ASTUnit::RemappedFile> pRemap(new ASTUnit::RemappedFile(fakeName, pBuffer.release()));
+      std::lock_guard<std::mutex> lock(m_unusedParseMutex);
+      UnusedRewriteParse &parse =
+          GetUnusedParse(utf8Source, pDefines, defineCount);
 
       CW2A utf8EntryPoint(pEntryPoint, CP_UTF8);
 
       std::string errors;
       std::string rewrite;
-      LPCWSTR pOutputName = nullptr;  // TODO: Fill this in
-      HRESULT status = DoRewriteUnused(
-          &m_langExtensionsHelper, fakeName, pRemap.get(), utf8EntryPoint,
-          pDefines, defineCount, true /*removeGlobals*/,
-          false /*removeFunctions*/, errors, rewrite, nullptr);
-      return DxcResult::Create(status, DXC_OUT_HLSL, {
-          DxcOutputObject::StringOutput(DXC_OUT_HLSL, CP_UTF8,  // TODO: Support DefaultTextCodePage
-            rewrite.c_str(), pOutputName),
-          DxcOutputObject::ErrorOutput(CP_UTF8,   // TODO Support DefaultTextCodePage
-            errors.c_str())
-        }, ppResult);
+      HRESULT status = DoRewriteUnused(parse, utf8EntryPoint,
+                                       true /*removeGlobals*/,
+                                       false /*removeFunctions*/, errors,
+                                       rewrite);
+      return CreateUnusedResult(status, rewrite, errors, ppResult);
     }
     CATCH_CPP_RETURN_HRESULT();
   }
 
+  HRESULT STDMETHODCALLTYPE RemoveUnusedGlobalsBatch(
+      _In_ IDxcBlobEncoding *pSource,
+      _In_count_(entryPointCount) LPCWSTR *pEntryPoints,
+      _In_ UINT32 entryPointCount,
+      _In_count_(defineCount) DxcDefine *pDefines, _In_ UINT32 defineCount,
+      _Out_writes_(entryPointCount) IDxcOperationResult **ppResults) override {
+    if (pSource == nullptr || ppResults == nullptr ||
+        (entryPointCount > 0 && pEntryPoints == nullptr) ||
+        (defineCount > 0 && pDefines == nullptr))
+      return E_INVALIDARG;
+    for (UINT32 i = 0; i < entryPointCount; ++i) {
+      ppResults[i] = nullptr;
+      if (pEntryPoints[i] == nullptr)
+        return E_INVALIDARG;
+    }
+
+    DxcThreadMalloc TM(m_pMalloc);
+
+    CComPtr<IDxcBlobUtf8> utf8Source;
+    IFR(hlsl::DxcGetBlobAsUtf8(pSource, m_pMalloc, &utf8Source));
+
+    HRESULT hr = S_OK;
+    try {
+      std::lock_guard<std::mutex> lock(m_unusedParseMutex);
+      UnusedRewriteParse &parse =
+          GetUnusedParse(utf8Source, pDefines, defineCount);
+
+      for (UINT32 i = 0; i < entryPointCount && SUCCEEDED(hr); ++i) {
+        CW2A utf8EntryPoint(pEntryPoints[i], CP_UTF8);
+
+        std::string errors;
+        std::string rewrite;
+        HRESULT status = DoRewriteUnused(parse, utf8EntryPoint,
+                                         true /*removeGlobals*/,
+                                         false /*removeFunctions*/, errors,
+                                         rewrite);
+        hr = CreateUnusedResult(status, rewrite, errors, &ppResults[i]);
+      }
+    }
+    CATCH_CPP_ASSIGN_HRESULT();
+
+    if (FAILED(hr)) {
+      for (UINT32 i = 0; i < entryPointCount; ++i) {
+        if (ppResults[i]) {
+          ppResults[i]->Release();
+          ppResults[i] = nullptr;
+        }
+      }
+    }
+    return hr;
+  }
+
   HRESULT STDMETHODCALLTYPE 
   RewriteUnchanged(_In_ IDxcBlobEncoding *pSource,
                    _In_count_(defineCount) DxcDefine *pDefines,
@@ -0,0 +1,28 @@
+// Enough ray shaders for DxrFallbackCompiler to transform them in parallel.
+
+RWStructuredBuffer<int> output : register(u1);
+
+struct Params
+{
+  int val;
+};
+
+#define SHADER_PAIR(n)                            \
+  [shader("raygeneration")]                       \
+  void raygen##n()                                \
+  {                                               \
+    Params p = { n };                             \
+    CallShader(n, p);                             \
+    output[n] = p.val;                            \
+  }                                               \
+                                                  \
+  [shader("callable")]                            \
+  void callable##n(inout Params p)                \
+  {                                               \
+    p.val += output[p.val + n];                   \
+  }
+
+SHADER_PAIR(0)
+SHADER_PAIR(1)
+SHADER_PAIR(2)
+SHADER_PAIR(3)
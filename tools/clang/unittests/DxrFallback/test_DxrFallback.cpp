@@ -6,14 +6,24 @@
 #include "dxc/Support/FileIOHelper.h"
 #include "dxc/Support/dxcapi.impl.h"
 #include "dxc/dxcdxrfallbackcompiler.h"
+#include "dxc/DXIL/DxilModule.h"
+#include "dxc/DXIL/DxilUtil.h"
+#include "dxc/DxilContainer/DxilContainer.h"
+#include "dxc/DxrFallback/DxrFallbackCompiler.h"
+#include "dxc/HLSL/DxilLinker.h"
 #include "dxc/support/dxcapi.use.h"
 
+#include "llvm/Analysis/ReducibilityAnalysis.h"
+#include "llvm/AsmParser/Parser.h"
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/Module.h"
+#include "llvm/IR/Verifier.h"
 #include "llvm/Support/FileSystem.h"
 #include "llvm/Support/MSFileSystem.h"
+#include "llvm/Support/raw_ostream.h"
 
 #include "defaultTestFilePath.h"
+#include "Reducibility.h"
 #include "ShaderTester.h"
 #undef IGNORE
 #undef OPAQUE
@@ -28,6 +38,8 @@ using namespace dxc;
 using namespace llvm;
 using namespace hlsl;
 
+namespace hlsl { HRESULT SetupRegistryPassForHLSL(); }
+
 const int DEBUG_OUTPUT_LEVEL = 1;
 
 std::string ws2s(const std::wstring& wide)
@@ -801,6 +813,188 @@ TestData* test_custom(Payload expectedPayload, int geomOpaque, const std::vector
 }
 
 
+// Returns a function with depth nested irreducible loops. Loop k is entered
+// at both xk and yk from loop k-1 and contains loop k+1, so splitting every
+// loop copies the function 2^depth times. Depth 0 gives one reducible loop.
+static std::string makeNestedIrreducibleFunction(int depth)
+{
+  bool reducible = depth == 0;
+  if (reducible)
+    depth = 1;
+
+  auto block = [](const std::string& name, const std::string& branch)
+  {
+    std::string text = name + ":\n";
+    for (int i = 0; i < 3; ++i)
+    {
+      std::string v = "%" + name + "." + std::to_string(i);
+      text += "  " + v + " = load i32, i32* %p\n";
+      text += "  store i32 " + v + ", i32* %p\n";
+    }
+    return text + "  " + branch + "\n";
+  };
+
+  std::string text = "define void @f(i32* %p, i1 %c) {\n";
+  text += reducible ? "entry:\n  br label %x0\n" : "entry:\n  br i1 %c, label %x0, label %y0\n";
+  for (int k = 0; k < depth; ++k)
+  {
+    std::string x = "x" + std::to_string(k);
+    std::string y = "y" + std::to_string(k);
+    std::string inner = std::to_string(k + 1);
+    std::string outer = k ? "%y" + std::to_string(k - 1) : "%done";
+    if (k + 1 < depth)
+      text += block(x, "br i1 %c, label %x" + inner + ", label %y" + inner);
+    else
+      text += block(x, "br label %" + y);
+    text += block(y, "br i1 %c, label %" + x + ", label " + outer);
+  }
+  text += "done:\n  ret void\n}\n";
+  return text;
+}
+
+// Runs makeReducible() on nested irreducible loops with several budgets and
+// prints how much the code grew. Returns the number of failures.
+static int runReducibilityTests()
+{
+  const size_t unlimited = ~size_t(0);
+  struct Case { int depth; size_t budget; };
+  const Case cases[] = {
+    { 0, kDefaultSplitBudget },
+    { 1, kDefaultSplitBudget },
+    { 4, unlimited },
+    { 8, unlimited },
+    { 4, 0 },
+    { 8, 0 },
+    { 16, 0 },
+    { 8, kDefaultSplitBudget },
+    { 16, kDefaultSplitBudget },
+    { 32, kDefaultSplitBudget },
+  };
+
+  std::cout << "Reducibility: depth budget instructions splits dispatchers\n";
+  int numFailed = 0;
+  for (const Case& c : cases)
+  {
+    LLVMContext context;
+    SMDiagnostic err;
+    std::unique_ptr<Module> M = parseAssemblyString(makeNestedIrreducibleFunction(c.depth), err, context);
+    Function* F = M ? M->getFunction("f") : nullptr;
+    if (!F)
+    {
+      std::cout << "FAILED to parse depth " << c.depth << "\n";
+      numFailed++;
+      continue;
+    }
+
+    ReducibilityStats stats;
+    makeReducible(F, &stats, c.budget);
+    std::cout << "  " << c.depth << " " << (c.budget == unlimited ? std::string("unlimited") : std::to_string(c.budget))
+      << " " << stats.instructionsBefore << " -> " << stats.instructionsAfter
+      << " " << stats.numSplits << " " << stats.numDispatchers << "\n";
+
+    bool passed = !verifyFunction(*F) && IsReducible(*F, IrreducibilityAction::Ignore);
+    if (c.depth == 0)
+      passed = passed && stats.numSplits == 0 && stats.numDispatchers == 0 && stats.instructionsAfter == stats.instructionsBefore;
+    else if (c.budget == unlimited)
+      passed = passed && stats.numSplits == (1 << c.depth) - 1 && stats.numDispatchers == 0;
+    else
+      passed = passed && stats.instructionsAfter <= 3 * (stats.instructionsBefore + c.budget);
+    if (c.budget == 0)
+      passed = passed && stats.numSplits == 0;
+    if (!passed)
+    {
+      std::cout << "FAILED\n";
+      numFailed++;
+    }
+  }
+  return numFailed;
+}
+
+
+// Links the libraries and runs DxrFallbackCompiler::compile() on the
+// shaders, returning the resulting module text and state IDs.
+static std::string compileStateFunctions(const std::vector<CComPtr<IDxcBlob>>& libs, const std::vector<std::string>& shaderNames, bool parallel)
+{
+  LLVMContext context;
+  std::unique_ptr<DxilLinker> pLinker(DxilLinker::CreateLinker(context, 1, 3));
+  for (size_t i = 0; i < libs.size(); ++i)
+  {
+    const DxilContainerHeader* pContainer = IsDxilContainerLike(libs[i]->GetBufferPointer(), libs[i]->GetBufferSize());
+    const DxilPartHeader* pPart = pContainer ? GetDxilPartByType(pContainer, DFCC_DXIL) : nullptr;
+    IFTBOOL(pPart, DXC_E_CONTAINER_MISSING_DXIL);
+    const char* pIL = nullptr;
+    uint32_t ILLength = 0;
+    GetDxilProgramBitcode(reinterpret_cast<const DxilProgramHeader*>(GetDxilPartData(pPart)), &pIL, &ILLength);
+    std::string diagStr;
+    std::unique_ptr<Module> M = dxilutil::LoadModuleFromBitcode(StringRef(pIL, ILLength), context, diagStr);
+    IFTBOOL(M, DXC_E_IR_VERIFICATION_FAILED);
+    M->GetOrCreateDxilModule();
+    pLinker->RegisterLib(std::to_string(i), std::move(M), nullptr);
+    pLinker->AttachLib(std::to_string(i));
+  }
+  dxilutil::ExportMap exportMap;
+  std::unique_ptr<Module> M = pLinker->Link("", "lib_6_3", exportMap);
+  IFTBOOL(M, DXC_E_GENERAL_INTERNAL_ERROR);
+
+  std::vector<int> shaderEntryStateIds;
+  std::vector<unsigned int> shaderStackSizes;
+  DxrFallbackCompiler::IntToFuncNameMap cachedMap;
+  DxrFallbackCompiler compiler(M.get(), shaderNames, 32, 0, false);
+  compiler.setParallelTransform(parallel);
+  compiler.compile(shaderEntryStateIds, shaderStackSizes, &cachedMap);
+
+  std::string text;
+  raw_string_ostream OS(text);
+  for (size_t i = 0; i < shaderNames.size(); ++i)
+    OS << shaderNames[i] << " " << shaderEntryStateIds[i] << " " << shaderStackSizes[i] << "\n";
+  M->print(OS, nullptr);
+  OS.flush();
+  return text;
+}
+
+// Checks that transforming shaders into state functions on several threads
+// gives the same module as transforming them one at a time. Returns the
+// number of failures.
+static int runParallelTransformTests(const std::string& basePath)
+{
+  // The linker runs passes from the LLVM libraries linked into this test,
+  // not from the compiler DLL, so they have to be registered here.
+  IFT(SetupRegistryPassForHLSL());
+  // The transform hands this thread's allocator on to its worker threads.
+  IFT(DxcInitThreadMalloc());
+  DxcSetThreadMallocToDefault();
+
+  DxcDllSupport dxcSupport;
+  dxc::EnsureEnabled(dxcSupport);
+  std::vector<CComPtr<IDxcBlob>> libs;
+  for (const char* filename : { "testParallel.hlsl", "testLib.hlsl" })
+  {
+    CComPtr<IDxcBlob> pLib;
+    LPCWSTR args[] = { L"-O3" };
+    CompileToDxilFromFile(dxcSupport, s2ws(basePath + filename).c_str(), L"", L"lib_6_3", args, _countof(args), nullptr, 0, &pLib);
+    libs.push_back(pLib);
+  }
+
+  // As many shaders as the parallel transform needs to be used.
+  const std::vector<std::string> shaderNames = {
+    "raygen0", "raygen1", "raygen2", "raygen3",
+    "callable0", "callable1", "callable2", "callable3",
+  };
+  std::string serial = compileStateFunctions(libs, shaderNames, false);
+  std::string parallel = compileStateFunctions(libs, shaderNames, true);
+  DxcClearThreadMalloc();
+  DxcCleanupThreadMalloc();
+  std::cout << "Parallel transform of " << shaderNames.size() << " shaders: ";
+  if (serial != parallel)
+  {
+    std::cout << "FAILED, the module differs from the serial transform\n";
+    return 1;
+  }
+  std::cout << "matches the serial transform\n";
+  return 0;
+}
+
+
 void printUsageAndExit()
 {
   std::cerr
@@ -850,6 +1044,12 @@ int main(int argc, const char* argv[])
       std::cout << "Testing on device " << deviceName << std::endl;
 
     int numFailed = 0;
+    if (1)
+    {
+      numFailed += runReducibilityTests();
+      numFailed += runParallelTransformTests(basePath);
+    }
+
     if (1)
     {
       RtCompilerTester tester(deviceName, basePath);
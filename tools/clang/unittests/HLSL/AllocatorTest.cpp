@@ -547,6 +547,7 @@ public:
   TEST_METHOD(Intersections)
   TEST_METHOD(GapFilling)
   TEST_METHOD(Allocate)
+  TEST_METHOD(FragmentedSearch)
 
   void InitScenarios() {
     struct P {
@@ -766,3 +767,44 @@ TEST_F(AllocatorTest, Allocate) {
     TestSizesFn();
   }
 }
+
+TEST_F(AllocatorTest, FragmentedSearch) {
+  WEX::TestExecution::SetVerifyOutput verifySettings(WEX::TestExecution::VerifyOutputSettings::LogOnlyFailures);
+  // Reserve every even register, leaving single register gaps below the end,
+  // then mix searches and allocations of different sizes.
+  const unsigned count = 2000;
+  const unsigned end = count * 2 - 2;
+  ElementVector elements;
+  elements.reserve(count * 2);
+  Allocator alloc(0, UINT_MAX);
+  for (unsigned i = 0; i < count; ++i) {
+    elements.emplace_back(i, i * 2, i * 2);
+    VERIFY_IS_NULL(alloc.Insert(&elements.back(), i * 2, i * 2));
+  }
+
+  for (unsigned i = 0; i < count; ++i) {
+    unsigned pos = 0;
+    // Larger ranges only fit past the last reserved register.
+    VERIFY_IS_TRUE(alloc.Find(2, pos));
+    VERIFY_ARE_EQUAL(end + 1 + i * 2, pos);
+    elements.emplace_back(UINT_MAX, pos, pos + 1);
+    VERIFY_IS_TRUE(alloc.Allocate(&elements.back(), 2, pos));
+    VERIFY_ARE_EQUAL(end + 1 + i * 2, pos);
+
+    // Single registers keep filling the gaps in order.
+    if (i * 2 + 1 < end) {
+      pos = 0;
+      VERIFY_IS_TRUE(alloc.Find(1, pos));
+      VERIFY_ARE_EQUAL(i * 2 + 1, pos);
+      VERIFY_IS_NULL(alloc.Insert(&elements[0], pos, pos));
+    }
+  }
+
+  // A search that starts past the remembered position is not affected by it.
+  unsigned pos = end + count * 2 + 10;
+  VERIFY_IS_TRUE(alloc.Find(4, pos));
+  VERIFY_ARE_EQUAL(end + count * 2 + 10, pos);
+  pos = 0;
+  VERIFY_IS_TRUE(alloc.Find(4, pos));
+  VERIFY_ARE_EQUAL(end + 1 + count * 2, pos);
+}
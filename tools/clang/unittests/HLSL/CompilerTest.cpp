@@ -22,6 +22,8 @@
 #include <sstream>
 #include <algorithm>
 #include <cfloat>
+#include <thread>
+#include <mutex>
 #include "dxc/DxilContainer/DxilContainer.h"
 #include "dxc/Support/WinIncludes.h"
 #include "dxc/dxcapi.h"
@@ -47,8 +49,10 @@
 #include "dxc/Support/Global.h"
 #include "dxc/Support/dxcapi.use.h"
 #include "dxc/Support/microcom.h"
+#include "dxc/Support/FileIOHelper.h"
 #include "dxc/Support/HLSLOptions.h"
 #include "dxc/Support/Unicode.h"
+#include "dxc/dxcapi.internal.h"
 
 #include <fstream>
 #include "llvm/Support/FileSystem.h"
@@ -158,8 +162,10 @@ public:
   TEST_METHOD(CompileWhenEmptyThenFails)
   TEST_METHOD(CompileWhenIncorrectThenFails)
   TEST_METHOD(CompileWhenWorksThenDisassembleWorks)
+  TEST_METHOD(CompileWhenDisassembledThenAssembleBatchWorks)
   TEST_METHOD(CompileWhenDebugWorksThenStripDebug)
   TEST_METHOD(CompileWhenWorksThenAddRemovePrivate)
+  TEST_METHOD(CompileWhenWorksThenContainerDeltaRoundTrips)
   TEST_METHOD(CompileThenAddCustomDebugName)
   TEST_METHOD(CompileThenTestReflectionWithProgramHeader)
   TEST_METHOD(CompileThenTestPdbUtils)
@@ -168,6 +174,7 @@ public:
   TEST_METHOD(CompileThenTestPdbUtilsStripped)
   TEST_METHOD(CompileThenTestPdbUtilsEmptyEntry)
   TEST_METHOD(CompileThenTestPdbUtilsRelativePath)
+  TEST_METHOD(CompileThenTestPdbUtilsFullPDBCache)
   TEST_METHOD(CompileWithRootSignatureThenStripRootSignature)
   TEST_METHOD(CompileThenSetRootSignatureThenValidate)
   TEST_METHOD(CompileSetPrivateThenWithStripPrivate)
@@ -179,6 +186,7 @@ public:
     const std::wstring &errors = std::wstring(),
     bool noIncludeHandler = false);
   TEST_METHOD(CompileWithResourceBindingFileThenOK)
+  TEST_METHOD(CompileWithBlockProfileThenBranchHinted)
 
   TEST_METHOD(CompileWhenIncludeThenLoadInvoked)
   TEST_METHOD(CompileWhenIncludeThenLoadUsed)
@@ -190,6 +198,30 @@ public:
   TEST_METHOD(CompileWhenIncludeMissingThenFail)
   TEST_METHOD(CompileWhenIncludeHasPathThenOK)
   TEST_METHOD(CompileWhenIncludeEmptyThenOK)
+  TEST_METHOD(CompileWhenCacheEnabledThenIncludeChangeMisses)
+  TEST_METHOD(CompileWhenContextPoolEnabledThenOutputUnchanged)
+  TEST_METHOD(CompileBatchWhenSharedIncludeThenLoadedOnce)
+  TEST_METHOD(CompileBatchWhenPreprocessedSameThenCompiledOnce)
+  TEST_METHOD(CompileEntriesWhenStagesThenMatchCompile)
+  TEST_METHOD(CompileJobWhenNoIncludeHandlerThenMatchCompile)
+  TEST_METHOD(CompileWhenSnapshotThenResumeVariants)
+  TEST_METHOD(CompileParsedWhenVariantThenMatchesCompile)
+  TEST_METHOD(CompilePermutationsWhenPreprocessedSameThenShared)
+  TEST_METHOD(CompileWhenIncludeCacheThenLoadedOnce)
+  TEST_METHOD(DisassembleToStreamWhenFunctionsNamedThenOnlyThosePrinted)
+  TEST_METHOD(CompileWhenSharedAcrossThreadsThenResultsMatch)
+  TEST_METHOD(CompileWhenManyIncludesThenOK)
+  TEST_METHOD(CompileWhenIncludedTwiceThenSkipped)
+  TEST_METHOD(CompileWhenSearchDirMissesThenLoadAttemptedOnce)
+  TEST_METHOD(CompileWhenScanDependenciesThenDirectivesFollowed)
+  TEST_METHOD(CompileWhenPooledMallocThenStatisticsReported)
+  TEST_METHOD(CompileWhenTimeTraceThenPhasesReported)
+  TEST_METHOD(CompileWhenPassReportThenPassesReported)
+  TEST_METHOD(CompileWhenMemoryReportThenPhasesReported)
+  TEST_METHOD(CompileWhenMemoryLimitThenEnforced)
+  TEST_METHOD(CompileWhenLibIncrementalThenReused)
+  TEST_METHOD(CompileWhenPerfReportThenCostsReported)
+  TEST_METHOD(CompileWhenWarningsThenErrorsInResultEncoding)
 
   TEST_METHOD(CompileWhenODumpThenPassConfig)
   TEST_METHOD(CompileWhenODumpThenOptimizerMatch)
@@ -878,6 +910,63 @@ TEST_F(CompilerTest, CompileWhenWorksThenDisassembleWorks) {
   // WEX::Logging::Log::Comment(disassembleStringW.m_psz);
 }
 
+TEST_F(CompilerTest, CompileWhenDisassembledThenAssembleBatchWorks) {
+  CComPtr<IDxcCompiler> pCompiler;
+  CComPtr<IDxcAssembler> pAssembler;
+  CComPtr<IDxcAssembler2> pAssembler2;
+  VERIFY_SUCCEEDED(CreateCompiler(&pCompiler));
+  VERIFY_SUCCEEDED(m_dllSupport.CreateInstance(CLSID_DxcAssembler, &pAssembler));
+  VERIFY_SUCCEEDED(pAssembler.QueryInterface(&pAssembler2));
+
+  const char *sources[] = {
+      "float4 main() : SV_Target { return 0; }",
+      "float4 main(float4 a : A) : SV_Target { return sin(a) + cos(a); }"};
+  CComPtr<IDxcBlobEncoding> pTexts[_countof(sources) + 1];
+  for (unsigned i = 0; i < _countof(sources); ++i) {
+    CComPtr<IDxcBlobEncoding> pSource;
+    CComPtr<IDxcOperationResult> pResult;
+    CComPtr<IDxcBlob> pProgram;
+    CreateBlobFromText(sources[i], &pSource);
+    VERIFY_SUCCEEDED(pCompiler->Compile(pSource, L"source.hlsl", L"main",
+                                        L"ps_6_0", nullptr, 0, nullptr, 0,
+                                        nullptr, &pResult));
+    VerifyOperationSucceeded(pResult);
+    VERIFY_SUCCEEDED(pResult->GetResult(&pProgram));
+    VERIFY_SUCCEEDED(pCompiler->Disassemble(pProgram, &pTexts[i]));
+  }
+  CreateBlobFromText("not assembly", &pTexts[_countof(sources)]);
+
+  IDxcBlob *pShaders[_countof(pTexts)];
+  IDxcOperationResult *pResults[_countof(pTexts)];
+  for (unsigned i = 0; i < _countof(pTexts); ++i)
+    pShaders[i] = pTexts[i];
+  VERIFY_SUCCEEDED(pAssembler2->AssembleToContainerBatch(
+      pShaders, _countof(pShaders), pResults));
+
+  for (unsigned i = 0; i < _countof(pTexts); ++i) {
+    CComPtr<IDxcOperationResult> pResult;
+    pResult.Attach(pResults[i]);
+    HRESULT status;
+    VERIFY_SUCCEEDED(pResult->GetStatus(&status));
+    if (i == _countof(sources)) {
+      VERIFY_FAILED(status);
+      continue;
+    }
+    VERIFY_SUCCEEDED(status);
+
+    // The batch result matches assembling the text on its own.
+    CComPtr<IDxcOperationResult> pSingleResult;
+    CComPtr<IDxcBlob> pContainer, pSingleContainer;
+    VERIFY_SUCCEEDED(pAssembler->AssembleToContainer(pShaders[i], &pSingleResult));
+    VERIFY_SUCCEEDED(pResult->GetResult(&pContainer));
+    VERIFY_SUCCEEDED(pSingleResult->GetResult(&pSingleContainer));
+    VERIFY_ARE_EQUAL(pSingleContainer->GetBufferSize(), pContainer->GetBufferSize());
+    VERIFY_IS_TRUE(0 == memcmp(pSingleContainer->GetBufferPointer(),
+                               pContainer->GetBufferPointer(),
+                               pContainer->GetBufferSize()));
+  }
+}
+
 #ifdef _WIN32 // Container builder unsupported
 
 TEST_F(CompilerTest, CompileWhenDebugWorksThenStripDebug) {
@@ -977,6 +1066,53 @@ TEST_F(CompilerTest, CompileWhenWorksThenAddRemovePrivate) {
   VERIFY_IS_NULL(pPartHeader);
 }
 
+TEST_F(CompilerTest, CompileWhenWorksThenContainerDeltaRoundTrips) {
+  CComPtr<IDxcCompiler> pCompiler;
+  CComPtr<IDxcOperationResult> pResult;
+  CComPtr<IDxcBlobEncoding> pSource;
+  CComPtr<IDxcBlob> pBase;
+
+  VERIFY_SUCCEEDED(CreateCompiler(&pCompiler));
+  CreateBlobFromText("float4 main() : SV_Target {\r\n"
+    "  return 0;\r\n"
+    "}",
+    &pSource);
+  VERIFY_SUCCEEDED(pCompiler->Compile(pSource, L"source.hlsl", L"main",
+    L"ps_6_0", nullptr, 0, nullptr, 0,
+    nullptr, &pResult));
+  VERIFY_SUCCEEDED(pResult->GetResult(&pBase));
+
+  // The target only differs from the base by an extra part.
+  CComPtr<IDxcContainerBuilder> pBuilder;
+  VERIFY_SUCCEEDED(CreateContainerBuilder(&pBuilder));
+  CComPtr<IDxcBlobEncoding> pPrivate;
+  CreateBlobFromText("private data", &pPrivate);
+  VERIFY_SUCCEEDED(pBuilder->Load(pBase));
+  VERIFY_SUCCEEDED(pBuilder->AddPart(hlsl::DxilFourCC::DFCC_PrivateData, pPrivate));
+  pResult.Release();
+  VERIFY_SUCCEEDED(pBuilder->SerializeContainer(&pResult));
+  CComPtr<IDxcBlob> pTarget;
+  VERIFY_SUCCEEDED(pResult->GetResult(&pTarget));
+
+  CComPtr<IDxcContainerBuilder2> pBuilder2;
+  VERIFY_SUCCEEDED(pBuilder.QueryInterface(&pBuilder2));
+  CComPtr<IDxcBlob> pDelta;
+  VERIFY_SUCCEEDED(pBuilder2->CreateDelta(pBase, pTarget, &pDelta));
+  VERIFY_IS_TRUE(pDelta->GetBufferSize() < pTarget->GetBufferSize());
+
+  CComPtr<IDxcBlob> pRebuilt;
+  VERIFY_SUCCEEDED(pBuilder2->ApplyDelta(pBase, pDelta, &pRebuilt));
+  VERIFY_ARE_EQUAL(pRebuilt->GetBufferSize(), pTarget->GetBufferSize());
+  VERIFY_IS_TRUE(0 == memcmp(pRebuilt->GetBufferPointer(),
+                             pTarget->GetBufferPointer(),
+                             pTarget->GetBufferSize()));
+
+  // A delta only applies to the container it was computed against.
+  pRebuilt.Release();
+  VERIFY_ARE_EQUAL(E_INVALIDARG,
+                   pBuilder2->ApplyDelta(pTarget, pDelta, &pRebuilt));
+}
+
 TEST_F(CompilerTest, CompileThenAddCustomDebugName) {
   // container builders prior to 1.3 did not support adding debug name parts
   if (m_ver.SkipDxilVersion(1, 3)) return;
@@ -1966,6 +2102,119 @@ TEST_F(CompilerTest, CompileThenTestPdbUtilsRelativePath) {
   VERIFY_IS_TRUE(pPdbUtils->IsFullPDB());
 }
 
+class TestPdbCache : public IDxcPdbCache {
+  DXC_MICROCOM_REF_FIELD(m_dwRef)
+public:
+  DXC_MICROCOM_ADDREF_RELEASE_IMPL(m_dwRef)
+  TestPdbCache() : m_dwRef(0) {}
+  HRESULT STDMETHODCALLTYPE QueryInterface(REFIID iid, void **ppvObject) override {
+    return DoBasicQueryInterface<IDxcPdbCache>(this, iid, ppvObject);
+  }
+
+  std::mutex Mutex;
+  std::map<std::string, CComPtr<IDxcBlob>> Entries;
+  unsigned LookupCount = 0;
+  unsigned HitCount = 0;
+  unsigned StoreCount = 0;
+
+  static std::string KeyOf(IDxcBlob *pKey) {
+    return std::string((const char *)pKey->GetBufferPointer(),
+                       pKey->GetBufferSize());
+  }
+  HRESULT STDMETHODCALLTYPE Lookup(IDxcBlob *pKey, IDxcBlob **ppFullPDB) override {
+    std::lock_guard<std::mutex> lock(Mutex);
+    *ppFullPDB = nullptr;
+    ++LookupCount;
+    auto it = Entries.find(KeyOf(pKey));
+    if (it == Entries.end())
+      return S_FALSE;
+    ++HitCount;
+    return it->second.QueryInterface(ppFullPDB);
+  }
+  HRESULT STDMETHODCALLTYPE Store(IDxcBlob *pKey, IDxcBlob *pFullPDB) override {
+    std::lock_guard<std::mutex> lock(Mutex);
+    ++StoreCount;
+    Entries[KeyOf(pKey)] = pFullPDB;
+    return S_OK;
+  }
+};
+
+TEST_F(CompilerTest, CompileThenTestPdbUtilsFullPDBCache) {
+  std::string main_source = R"x(
+      cbuffer MyCbuffer : register(b1) {
+        float4 my_cbuf_foo;
+      }
+
+      float4 main() : SV_Target {
+        return my_cbuf_foo;
+      }
+  )x";
+
+  CComPtr<IDxcCompiler3> pCompiler;
+  VERIFY_SUCCEEDED(m_dllSupport.CreateInstance(CLSID_DxcCompiler, &pCompiler));
+
+  DxcBuffer SourceBuf = {};
+  SourceBuf.Ptr = main_source.c_str();
+  SourceBuf.Size = main_source.size();
+  SourceBuf.Encoding = CP_UTF8;
+
+  std::vector<const WCHAR *> args;
+  args.push_back(L"/Tps_6_0");
+  args.push_back(L"/Zs");
+  args.push_back(L"shader.hlsl");
+
+  CComPtr<IDxcResult> pResult;
+  VERIFY_SUCCEEDED(pCompiler->Compile(&SourceBuf, args.data(), args.size(), nullptr, IID_PPV_ARGS(&pResult)));
+
+  CComPtr<IDxcBlob> pPdb;
+  CComPtr<IDxcBlobWide> pPdbName;
+  VERIFY_SUCCEEDED(pResult->GetOutput(DXC_OUT_PDB, IID_PPV_ARGS(&pPdb), &pPdbName));
+
+  CComPtr<IDxcPdbUtils2> pPdbUtils;
+  VERIFY_SUCCEEDED(m_dllSupport.CreateInstance(CLSID_DxcPdbUtils, &pPdbUtils));
+
+  CComPtr<TestPdbCache> pCache = new TestPdbCache();
+  VERIFY_SUCCEEDED(pPdbUtils->SetFullPDBCache(pCache));
+  VERIFY_SUCCEEDED(pPdbUtils->Load(pPdb));
+
+  // The first request rebuilds the PDB and stores it.
+  CComPtr<IDxcBlob> pFullPdb;
+  VERIFY_SUCCEEDED(pPdbUtils->GetFullPDB(&pFullPdb));
+  VERIFY_ARE_EQUAL(1u, pCache->StoreCount);
+  VERIFY_ARE_EQUAL(0u, pCache->HitCount);
+
+  // Reloading the same PDB finds it in the cache.
+  VERIFY_SUCCEEDED(pPdbUtils->Load(pPdb));
+  CComPtr<IDxcBlob> pCachedPdb;
+  VERIFY_SUCCEEDED(pPdbUtils->GetFullPDB(&pCachedPdb));
+  VERIFY_ARE_EQUAL(1u, pCache->StoreCount);
+  VERIFY_ARE_EQUAL(1u, pCache->HitCount);
+  VERIFY_ARE_EQUAL(pFullPdb.p, pCachedPdb.p);
+
+  // Batch requests share the cache and leave the loaded PDB alone.
+  IDxcBlob *pBatch[] = { pPdb, pPdb, pPdb };
+  IDxcBlob *pBatchResults[_countof(pBatch)] = {};
+  VERIFY_SUCCEEDED(pPdbUtils->GetFullPDBBatch(pBatch, _countof(pBatch), pBatchResults));
+  for (IDxcBlob *pBatchResult : pBatchResults) {
+    VERIFY_IS_NOT_NULL(pBatchResult);
+    CComPtr<IDxcPdbUtils> pCheck;
+    VERIFY_SUCCEEDED(m_dllSupport.CreateInstance(CLSID_DxcPdbUtils, &pCheck));
+    VERIFY_SUCCEEDED(pCheck->Load(pBatchResult));
+    VERIFY_IS_TRUE(pCheck->IsFullPDB());
+    pBatchResult->Release();
+  }
+  VERIFY_ARE_EQUAL(1u, pCache->StoreCount);
+  VERIFY_IS_FALSE(pPdbUtils->IsFullPDB());
+
+  // Overridden arguments change the output, so bypass the cache.
+  DxcArgPair argPair = { L"Od", L"" };
+  VERIFY_SUCCEEDED(pPdbUtils->OverrideArgs(&argPair, 1));
+  unsigned lookups = pCache->LookupCount;
+  CComPtr<IDxcBlob> pOverriddenPdb;
+  VERIFY_SUCCEEDED(pPdbUtils->GetFullPDB(&pOverriddenPdb));
+  VERIFY_ARE_EQUAL(lookups, pCache->LookupCount);
+}
+
 
 TEST_F(CompilerTest, CompileThenTestPdbUtilsEmptyEntry) {
   std::string main_source = R"x(
@@ -2291,6 +2540,73 @@ TEST_F(CompilerTest, CompileWithResourceBindingFileThenOK) {
     )", L"Unexpected newline inside quotation.");
 }
 
+TEST_F(CompilerTest, CompileWithBlockProfileThenBranchHinted) {
+  CComPtr<IDxcCompiler> pCompiler;
+  CComPtr<IDxcBlobEncoding> pSource;
+  VERIFY_SUCCEEDED(CreateCompiler(&pCompiler));
+  CreateBlobFromText(
+    "RWByteAddressBuffer u;\n"
+    "[numthreads(64, 1, 1)] void main(uint i : SV_GroupIndex) {\n"
+    "  uint v = u.Load(i * 4);\n"
+    "  if (v > 100) {\n"
+    "    v = u.Load(v) * 3;\n"
+    "  }\n"
+    "  u.Store(i * 4, v);\n"
+    "}\n", &pSource);
+
+  auto Compile = [&](const char *pProfile, IDxcOperationResult **ppResult) {
+    CComPtr<TestIncludeHandler> pInclude =
+        new TestIncludeHandler(m_dllSupport);
+    pInclude->CallResults.emplace_back(pProfile);
+    LPCWSTR args[] = { L"-fprofile-use=profile.txt" };
+    VERIFY_SUCCEEDED(pCompiler->Compile(pSource, L"source.hlsl", L"main",
+      L"cs_6_0", args, _countof(args), nullptr, 0, pInclude, ppResult));
+  };
+  auto Disassemble = [&](IDxcOperationResult *pResult) {
+    CComPtr<IDxcBlob> pProgram;
+    CComPtr<IDxcBlobEncoding> pText;
+    VERIFY_SUCCEEDED(pResult->GetResult(&pProgram));
+    VERIFY_SUCCEEDED(pCompiler->Disassemble(pProgram, &pText));
+    return BlobToUtf8(pText);
+  };
+
+  // The if body ran for 10 of 1000 lanes, so its branch is kept rather than
+  // flattened. The branch weights themselves do not make it to the DXIL.
+  {
+    CComPtr<IDxcOperationResult> pResult;
+    Compile("Begin - block counters\n"
+            "Block0:1000:3:source.hlsl\n"
+            "Block1:10:5:source.hlsl\n"
+            "Block2:1000:7:source.hlsl\n"
+            "End - block counters\n", &pResult);
+    VerifyOperationSucceeded(pResult);
+    std::string disassembly = Disassemble(pResult);
+    VERIFY_ARE_NOT_EQUAL(std::string::npos,
+                         disassembly.find("dx.controlflow.hints"));
+    VERIFY_ARE_EQUAL(std::string::npos, disassembly.find("!prof"));
+  }
+
+  // An evenly split branch is left for the optimizer to decide.
+  {
+    CComPtr<IDxcOperationResult> pResult;
+    Compile("Block0:1000:3:source.hlsl\n"
+            "Block1:500:5:source.hlsl\n"
+            "Block2:1000:7:source.hlsl\n", &pResult);
+    VerifyOperationSucceeded(pResult);
+    VERIFY_ARE_EQUAL(std::string::npos,
+                     Disassemble(pResult).find("dx.controlflow.hints"));
+  }
+
+  // Malformed entries are reported.
+  {
+    CComPtr<IDxcOperationResult> pResult;
+    Compile("Block0:many:3:source.hlsl\n", &pResult);
+    std::string errors = VerifyOperationFailed(pResult);
+    VERIFY_ARE_NOT_EQUAL(std::string::npos,
+                         errors.find("malformed block profile entry"));
+  }
+}
+
 TEST_F(CompilerTest, CompileWithRootSignatureThenStripRootSignature) {
   CComPtr<IDxcCompiler> pCompiler;
   CComPtr<IDxcOperationResult> pResult;
@@ -2784,6 +3100,1225 @@ TEST_F(CompilerTest, CompileWhenIncludeFlagsThenIncludeUsed) {
 #endif
 }
 
+TEST_F(CompilerTest, CompileWhenCacheEnabledThenIncludeChangeMisses) {
+  CComPtr<IDxcCompiler3> pCompiler;
+  CComPtr<IDxcCompilerCache> pCache;
+  VERIFY_SUCCEEDED(m_dllSupport.CreateInstance(CLSID_DxcCompiler, &pCompiler));
+  VERIFY_SUCCEEDED(pCompiler.QueryInterface(&pCache));
+  VERIFY_SUCCEEDED(pCache->EnableCache(nullptr));
+
+  std::string source = "#include \"helper.h\"\r\n"
+                       "float4 main() : SV_Target { return ZERO; }";
+  DxcBuffer SourceBuf = { source.c_str(), source.size(), CP_UTF8 };
+  LPCWSTR args[] = { L"-Tps_6_0", L"source.hlsl" };
+
+  // Every compile and every cache lookup loads helper.h once.
+  CComPtr<TestIncludeHandler> pInclude = new TestIncludeHandler(m_dllSupport);
+  pInclude->CallResults.emplace_back("#define ZERO 0");
+  pInclude->CallResults.emplace_back("#define ZERO 0");
+  pInclude->CallResults.emplace_back("#define ZERO 1");
+  pInclude->CallResults.emplace_back("#define ZERO 1");
+
+  CComPtr<IDxcResult> pFirst, pSecond, pThird;
+  VERIFY_SUCCEEDED(pCompiler->Compile(&SourceBuf, args, _countof(args),
+                                      pInclude, IID_PPV_ARGS(&pFirst)));
+  VerifyOperationSucceeded(pFirst);
+  VERIFY_SUCCEEDED(pCompiler->Compile(&SourceBuf, args, _countof(args),
+                                      pInclude, IID_PPV_ARGS(&pSecond)));
+  VerifyOperationSucceeded(pSecond);
+
+  UINT64 hits = 0, misses = 0;
+  VERIFY_SUCCEEDED(pCache->GetCacheStatistics(&hits, &misses));
+  VERIFY_ARE_EQUAL(1ULL, hits);
+  VERIFY_ARE_EQUAL(1ULL, misses);
+
+  CComPtr<IDxcBlob> pFirstObject, pSecondObject;
+  VERIFY_SUCCEEDED(pFirst->GetOutput(DXC_OUT_OBJECT, IID_PPV_ARGS(&pFirstObject), nullptr));
+  VERIFY_SUCCEEDED(pSecond->GetOutput(DXC_OUT_OBJECT, IID_PPV_ARGS(&pSecondObject), nullptr));
+  VERIFY_ARE_EQUAL(pFirstObject->GetBufferSize(), pSecondObject->GetBufferSize());
+  VERIFY_IS_TRUE(0 == memcmp(pFirstObject->GetBufferPointer(),
+                             pSecondObject->GetBufferPointer(),
+                             pFirstObject->GetBufferSize()));
+  VERIFY_ARE_EQUAL(pFirst->HasOutput(DXC_OUT_SHADER_HASH),
+                   pSecond->HasOutput(DXC_OUT_SHADER_HASH));
+
+  // A changed include must not be served from the cache.
+  VERIFY_SUCCEEDED(pCompiler->Compile(&SourceBuf, args, _countof(args),
+                                      pInclude, IID_PPV_ARGS(&pThird)));
+  VerifyOperationSucceeded(pThird);
+  VERIFY_SUCCEEDED(pCache->GetCacheStatistics(&hits, &misses));
+  VERIFY_ARE_EQUAL(1ULL, hits);
+  VERIFY_ARE_EQUAL(2ULL, misses);
+}
+
+TEST_F(CompilerTest, CompileWhenContextPoolEnabledThenOutputUnchanged) {
+  // Both shaders declare struct S, differently, and use different metadata.
+  std::string sourceA = "struct S { float4 v; uint i; };\r\n"
+                        "cbuffer C { S s; };\r\n"
+                        "float4 main() : SV_Target { return s.v * s.i; }";
+  std::string sourceB = "struct S { int2 v; };\r\n"
+                        "RWStructuredBuffer<S> b;\r\n"
+                        "[numthreads(8, 1, 1)]\r\n"
+                        "void main(uint id : SV_DispatchThreadID) {\r\n"
+                        "  precise float f = b[id].v.x * 0.5;\r\n"
+                        "  b[id].v = (int)f;\r\n"
+                        "}";
+  DxcBuffer SourceA = { sourceA.c_str(), sourceA.size(), CP_UTF8 };
+  DxcBuffer SourceB = { sourceB.c_str(), sourceB.size(), CP_UTF8 };
+  LPCWSTR argsA[] = { L"-Tps_6_0", L"a.hlsl" };
+  LPCWSTR argsB[] = { L"-Tcs_6_0", L"b.hlsl" };
+
+  auto compile = [&](IDxcCompiler3 *pCompiler, const DxcBuffer &Source,
+                     LPCWSTR *pArgs, UINT32 argCount, IDxcBlob **ppObject) {
+    CComPtr<IDxcResult> pResult;
+    VERIFY_SUCCEEDED(pCompiler->Compile(&Source, pArgs, argCount, nullptr,
+                                        IID_PPV_ARGS(&pResult)));
+    VerifyOperationSucceeded(pResult);
+    VERIFY_SUCCEEDED(pResult->GetOutput(DXC_OUT_OBJECT, IID_PPV_ARGS(ppObject),
+                                        nullptr));
+  };
+  auto verifySame = [](IDxcBlob *pExpected, IDxcBlob *pActual) {
+    VERIFY_ARE_EQUAL(pExpected->GetBufferSize(), pActual->GetBufferSize());
+    VERIFY_IS_TRUE(0 == memcmp(pExpected->GetBufferPointer(),
+                               pActual->GetBufferPointer(),
+                               pExpected->GetBufferSize()));
+  };
+
+  CComPtr<IDxcCompiler3> pFresh;
+  CComPtr<IDxcBlob> pExpectedA, pExpectedB;
+  VERIFY_SUCCEEDED(m_dllSupport.CreateInstance(CLSID_DxcCompiler, &pFresh));
+  compile(pFresh, SourceA, argsA, _countof(argsA), &pExpectedA);
+  compile(pFresh, SourceB, argsB, _countof(argsB), &pExpectedB);
+
+  CComPtr<IDxcCompiler3> pCompiler;
+  CComPtr<IDxcContextPool> pPool;
+  VERIFY_SUCCEEDED(m_dllSupport.CreateInstance(CLSID_DxcCompiler, &pCompiler));
+  VERIFY_SUCCEEDED(pCompiler.QueryInterface(&pPool));
+  VERIFY_SUCCEEDED(pPool->EnableContextPool(0));
+
+  // Each compile after the first reuses the context of the one before.
+  CComPtr<IDxcBlob> pA1, pB, pA2;
+  compile(pCompiler, SourceA, argsA, _countof(argsA), &pA1);
+  compile(pCompiler, SourceB, argsB, _countof(argsB), &pB);
+  compile(pCompiler, SourceA, argsA, _countof(argsA), &pA2);
+  verifySame(pExpectedA, pA1);
+  verifySame(pExpectedB, pB);
+  verifySame(pExpectedA, pA2);
+
+  VERIFY_SUCCEEDED(pPool->DisableContextPool());
+  CComPtr<IDxcBlob> pB2;
+  compile(pCompiler, SourceB, argsB, _countof(argsB), &pB2);
+  verifySame(pExpectedB, pB2);
+}
+
+TEST_F(CompilerTest, CompileBatchWhenSharedIncludeThenLoadedOnce) {
+  CComPtr<IDxcCompiler4> pCompiler;
+  VERIFY_SUCCEEDED(m_dllSupport.CreateInstance(CLSID_DxcCompiler, &pCompiler));
+
+  std::string source = "#include \"helper.h\"\r\n"
+                       "float4 main() : SV_Target { return ZERO + VALUE; }";
+  DxcBuffer SourceBuf = { source.c_str(), source.size(), CP_UTF8 };
+
+  // Count the include handler calls made by a single compile.
+  LPCWSTR singleArgs[] = { L"-Tps_6_0", L"-DVALUE=0", L"source.hlsl" };
+  CComPtr<TestIncludeHandler> pSingleInclude = new TestIncludeHandler(m_dllSupport);
+  pSingleInclude->CallResults.emplace_back("#define ZERO 0");
+  CComPtr<IDxcResult> pSingleResult;
+  VERIFY_SUCCEEDED(pCompiler->Compile(&SourceBuf, singleArgs, _countof(singleArgs),
+                                      pSingleInclude, IID_PPV_ARGS(&pSingleResult)));
+  VerifyOperationSucceeded(pSingleResult);
+
+  LPCWSTR args0[] = { L"-Tps_6_0", L"-DVALUE=0", L"source.hlsl" };
+  LPCWSTR args1[] = { L"-Tps_6_0", L"-DVALUE=1", L"source.hlsl" };
+  LPCWSTR args2[] = { L"-Tps_6_0", L"-DVALUE=2", L"source.hlsl" };
+  DxcCompileJob jobs[] = {
+    { &SourceBuf, args0, _countof(args0) },
+    { &SourceBuf, args1, _countof(args1) },
+    { &SourceBuf, args2, _countof(args2) },
+  };
+  CComPtr<TestIncludeHandler> pInclude = new TestIncludeHandler(m_dllSupport);
+  pInclude->CallResults.emplace_back("#define ZERO 0");
+  IDxcResult *pResults[_countof(jobs)] = {};
+  VERIFY_SUCCEEDED(pCompiler->CompileBatch(jobs, _countof(jobs), pInclude,
+                                           __uuidof(IDxcResult),
+                                           (LPVOID *)pResults));
+  for (IDxcResult *pResult : pResults) {
+    CComPtr<IDxcResult> pOwned;
+    pOwned.Attach(pResult);
+    VerifyOperationSucceeded(pOwned);
+  }
+
+  // The whole batch makes the same calls as a single compile.
+  VERIFY_ARE_EQUAL(pSingleInclude->GetAllFileNames(),
+                   pInclude->GetAllFileNames());
+}
+
+TEST_F(CompilerTest, CompileEntriesWhenStagesThenMatchCompile) {
+  CComPtr<IDxcCompiler7> pCompiler;
+  VERIFY_SUCCEEDED(m_dllSupport.CreateInstance(CLSID_DxcCompiler, &pCompiler));
+
+  std::string source = "#include \"helper.h\"\r\n"
+                       "float4 VSMain(float4 p : POSITION) : SV_Position { return p * ONE; }\r\n"
+                       "float4 PSMain() : SV_Target { return ONE; }";
+  DxcBuffer SourceBuf = { source.c_str(), source.size(), CP_UTF8 };
+
+  DxcCompileEntry entries[] = {
+    { L"VSMain", L"vs_6_0" },
+    { L"PSMain", L"ps_6_0" },
+  };
+  LPCWSTR sharedArgs[] = { L"source.hlsl" };
+  CComPtr<TestIncludeHandler> pInclude = new TestIncludeHandler(m_dllSupport);
+  pInclude->CallResults.emplace_back("#define ONE 1");
+  IDxcResult *pResults[_countof(entries)] = {};
+  VERIFY_SUCCEEDED(pCompiler->CompileEntries(
+      &SourceBuf, sharedArgs, _countof(sharedArgs), entries, _countof(entries),
+      pInclude, __uuidof(IDxcResult), (LPVOID *)pResults));
+  // One include load serves every entry.
+  VERIFY_ARE_EQUAL_WSTR(L"./helper.h;", pInclude->GetAllFileNames().c_str());
+
+  for (UINT32 i = 0; i < _countof(entries); ++i) {
+    CComPtr<IDxcResult> pResult;
+    pResult.Attach(pResults[i]);
+    VerifyOperationSucceeded(pResult);
+    CComPtr<IDxcBlob> pObject;
+    VERIFY_SUCCEEDED(pResult->GetResult(&pObject));
+
+    LPCWSTR args[] = { L"-E", entries[i].pEntryPoint,
+                       L"-T", entries[i].pTargetProfile, L"source.hlsl" };
+    CComPtr<TestIncludeHandler> pSingleInclude = new TestIncludeHandler(m_dllSupport);
+    pSingleInclude->CallResults.emplace_back("#define ONE 1");
+    CComPtr<IDxcResult> pSingleResult;
+    VERIFY_SUCCEEDED(pCompiler->Compile(&SourceBuf, args, _countof(args),
+                                        pSingleInclude, IID_PPV_ARGS(&pSingleResult)));
+    VerifyOperationSucceeded(pSingleResult);
+    CComPtr<IDxcBlob> pSingleObject;
+    VERIFY_SUCCEEDED(pSingleResult->GetResult(&pSingleObject));
+    VERIFY_ARE_EQUAL(pSingleObject->GetBufferSize(), pObject->GetBufferSize());
+    VERIFY_ARE_EQUAL(0, memcmp(pSingleObject->GetBufferPointer(),
+                               pObject->GetBufferPointer(),
+                               pObject->GetBufferSize()));
+  }
+}
+
+TEST_F(CompilerTest, CompileJobWhenNoIncludeHandlerThenMatchCompile) {
+  CComPtr<IDxcCompiler8> pCompiler;
+  VERIFY_SUCCEEDED(m_dllSupport.CreateInstance(CLSID_DxcCompiler, &pCompiler));
+
+  std::string source = "#include \"helper.h\"\r\n"
+                       "float4 main() : SV_Target { return ONE; }";
+  DxcBuffer SourceBuf = { source.c_str(), source.size(), CP_UTF8 };
+  // Arguments already in normalized form, which the embedded PDB records.
+  LPCWSTR args[] = { L"-T", L"ps_6_0", L"-Zi", L"-Qembed_debug",
+                     L"source.hlsl" };
+
+  CComPtr<TestIncludeHandler> pInclude = new TestIncludeHandler(m_dllSupport);
+  pInclude->CallResults.emplace_back("#define ONE 1");
+  CComPtr<IDxcBlob> pJob;
+  CComPtr<IDxcResult> pJobErrors;
+  VERIFY_SUCCEEDED(pCompiler->CreateCompileJob(&SourceBuf, args, _countof(args),
+                                               pInclude, &pJob, &pJobErrors));
+  VERIFY_IS_TRUE(pJob != nullptr);
+  VERIFY_IS_TRUE(pJobErrors == nullptr);
+
+  // The same request always makes the same job.
+  CComPtr<TestIncludeHandler> pAgainInclude = new TestIncludeHandler(m_dllSupport);
+  pAgainInclude->CallResults.emplace_back("#define ONE 1");
+  CComPtr<IDxcBlob> pAgainJob;
+  CComPtr<IDxcResult> pAgainErrors;
+  VERIFY_SUCCEEDED(pCompiler->CreateCompileJob(&SourceBuf, args, _countof(args),
+                                               pAgainInclude, &pAgainJob,
+                                               &pAgainErrors));
+  VERIFY_ARE_EQUAL(pJob->GetBufferSize(), pAgainJob->GetBufferSize());
+  VERIFY_ARE_EQUAL(0, memcmp(pJob->GetBufferPointer(),
+                             pAgainJob->GetBufferPointer(),
+                             pJob->GetBufferSize()));
+
+  DxcBuffer JobBuf = { pJob->GetBufferPointer(), pJob->GetBufferSize(), 0 };
+  CComPtr<IDxcResult> pJobResult;
+  VERIFY_SUCCEEDED(pCompiler->CompileJob(&JobBuf, IID_PPV_ARGS(&pJobResult)));
+  VerifyOperationSucceeded(pJobResult);
+  CComPtr<IDxcBlob> pJobObject;
+  VERIFY_SUCCEEDED(pJobResult->GetResult(&pJobObject));
+
+  CComPtr<TestIncludeHandler> pSingleInclude = new TestIncludeHandler(m_dllSupport);
+  pSingleInclude->CallResults.emplace_back("#define ONE 1");
+  CComPtr<IDxcResult> pSingleResult;
+  VERIFY_SUCCEEDED(pCompiler->Compile(&SourceBuf, args, _countof(args),
+                                      pSingleInclude, IID_PPV_ARGS(&pSingleResult)));
+  VerifyOperationSucceeded(pSingleResult);
+  CComPtr<IDxcBlob> pSingleObject;
+  VERIFY_SUCCEEDED(pSingleResult->GetResult(&pSingleObject));
+  VERIFY_ARE_EQUAL(pSingleObject->GetBufferSize(), pJobObject->GetBufferSize());
+  VERIFY_ARE_EQUAL(0, memcmp(pSingleObject->GetBufferPointer(),
+                             pJobObject->GetBufferPointer(),
+                             pJobObject->GetBufferSize()));
+
+  // A damaged job is refused rather than compiled.
+  std::string damaged((const char *)pJob->GetBufferPointer(),
+                      pJob->GetBufferSize());
+  damaged[damaged.size() - 1] ^= 1;
+  DxcBuffer DamagedBuf = { damaged.data(), damaged.size(), 0 };
+  CComPtr<IDxcResult> pDamagedResult;
+  VERIFY_SUCCEEDED(pCompiler->CompileJob(&DamagedBuf,
+                                         IID_PPV_ARGS(&pDamagedResult)));
+  HRESULT status;
+  VERIFY_SUCCEEDED(pDamagedResult->GetStatus(&status));
+  VERIFY_FAILED(status);
+}
+
+TEST_F(CompilerTest, CompileWhenSnapshotThenResumeVariants) {
+  CComPtr<IDxcCompiler9> pCompiler;
+  VERIFY_SUCCEEDED(m_dllSupport.CreateInstance(CLSID_DxcCompiler, &pCompiler));
+
+  std::string source = "cbuffer Material { uint Mode; float Scale; };\r\n"
+                       "float4 main() : SV_Target {\r\n"
+                       "  return Mode == 1 ? Scale * 3 : Scale;\r\n"
+                       "}";
+  DxcBuffer SourceBuf = { source.c_str(), source.size(), CP_UTF8 };
+  LPCWSTR args[] = { L"-T", L"ps_6_0", L"source.hlsl" };
+
+  CComPtr<IDxcBlob> pSnapshot;
+  CComPtr<IDxcResult> pSnapshotResult;
+  VERIFY_SUCCEEDED(pCompiler->CreateSnapshot(&SourceBuf, args, _countof(args),
+                                             nullptr, &pSnapshot,
+                                             &pSnapshotResult));
+  VerifyOperationSucceeded(pSnapshotResult);
+  VERIFY_IS_TRUE(pSnapshot != nullptr);
+  DxcBuffer SnapshotBuf = { pSnapshot->GetBufferPointer(),
+                            pSnapshot->GetBufferSize(), 0 };
+
+  // Each variant only runs the pipeline after high-level code generation.
+  LPCWSTR modes[] = { L"Material.Mode=0", L"Material.Mode=1" };
+  std::string texts[_countof(modes)];
+  for (unsigned i = 0; i < _countof(modes); ++i) {
+    LPCWSTR variantArgs[] = { L"-specialize-cbuffer", modes[i] };
+    CComPtr<IDxcResult> pResult;
+    VERIFY_SUCCEEDED(pCompiler->ResumeSnapshot(&SnapshotBuf, variantArgs,
+                                               _countof(variantArgs), nullptr,
+                                               IID_PPV_ARGS(&pResult)));
+    VerifyOperationSucceeded(pResult);
+    CComPtr<IDxcBlob> pObject;
+    VERIFY_SUCCEEDED(pResult->GetResult(&pObject));
+    texts[i] = DisassembleProgram(m_dllSupport, pObject);
+    VERIFY_IS_TRUE(texts[i].find("select") == std::string::npos);
+  }
+  VERIFY_IS_TRUE(texts[0].find("3.000000e+00") == std::string::npos);
+  VERIFY_IS_TRUE(texts[1].find("3.000000e+00") != std::string::npos);
+
+  // Options that need the source again are refused.
+  LPCWSTR preprocessArgs[] = { L"-P", L"out.hlsl" };
+  CComPtr<IDxcResult> pPreprocessResult;
+  VERIFY_SUCCEEDED(pCompiler->ResumeSnapshot(&SnapshotBuf, preprocessArgs,
+                                             _countof(preprocessArgs), nullptr,
+                                             IID_PPV_ARGS(&pPreprocessResult)));
+  HRESULT status;
+  VERIFY_SUCCEEDED(pPreprocessResult->GetStatus(&status));
+  VERIFY_FAILED(status);
+  LPCWSTR rootSigArgs[] = { L"-rootsig-define", L"RS" };
+  CComPtr<IDxcResult> pRootSigResult;
+  VERIFY_SUCCEEDED(pCompiler->ResumeSnapshot(&SnapshotBuf, rootSigArgs,
+                                             _countof(rootSigArgs), nullptr,
+                                             IID_PPV_ARGS(&pRootSigResult)));
+  VERIFY_SUCCEEDED(pRootSigResult->GetStatus(&status));
+  VERIFY_FAILED(status);
+
+  // A backend error in a resumed variant fails that compile with the error.
+  std::string loopSource = "float4 main(uint n : N) : SV_Target {\r\n"
+                           "  float4 r = 0;\r\n"
+                           "  [unroll] for (uint i = 0; i < n; i++) r += i;\r\n"
+                           "  return r;\r\n"
+                           "}";
+  DxcBuffer LoopSourceBuf = { loopSource.c_str(), loopSource.size(), CP_UTF8 };
+  CComPtr<IDxcBlob> pLoopSnapshot;
+  CComPtr<IDxcResult> pLoopSnapshotResult;
+  VERIFY_SUCCEEDED(pCompiler->CreateSnapshot(&LoopSourceBuf, args,
+                                             _countof(args), nullptr,
+                                             &pLoopSnapshot,
+                                             &pLoopSnapshotResult));
+  VerifyOperationSucceeded(pLoopSnapshotResult);
+  DxcBuffer LoopSnapshotBuf = { pLoopSnapshot->GetBufferPointer(),
+                                pLoopSnapshot->GetBufferSize(), 0 };
+  CComPtr<IDxcResult> pLoopResult;
+  VERIFY_SUCCEEDED(pCompiler->ResumeSnapshot(&LoopSnapshotBuf, nullptr, 0,
+                                             nullptr,
+                                             IID_PPV_ARGS(&pLoopResult)));
+  VERIFY_SUCCEEDED(pLoopResult->GetStatus(&status));
+  VERIFY_FAILED(status);
+  CComPtr<IDxcBlobUtf8> pErrors;
+  VERIFY_SUCCEEDED(pLoopResult->GetOutput(DXC_OUT_ERRORS,
+                                          IID_PPV_ARGS(&pErrors), nullptr));
+  VERIFY_IS_NOT_NULL(strstr(pErrors->GetStringPointer(),
+                            "Could not unroll loop"));
+}
+
+TEST_F(CompilerTest, CompileBatchWhenPreprocessedSameThenCompiledOnce) {
+  CComPtr<IDxcCompiler4> pCompiler;
+  VERIFY_SUCCEEDED(m_dllSupport.CreateInstance(CLSID_DxcCompiler, &pCompiler));
+
+  std::string source = "float4 main() : SV_Target { return VALUE; }";
+  DxcBuffer SourceBuf = { source.c_str(), source.size(), CP_UTF8 };
+
+  // The first two jobs only differ by a define the source never tests and
+  // by their output names.
+  LPCWSTR args0[] = { L"-Tps_6_0", L"-DVALUE=1", L"-DUNUSED=1",
+                      L"-Fo", L"first.cso", L"source.hlsl" };
+  LPCWSTR args1[] = { L"-Tps_6_0", L"-DVALUE=1", L"-DUNUSED=2",
+                      L"-Fo", L"second.cso", L"source.hlsl" };
+  LPCWSTR args2[] = { L"-Tps_6_0", L"-DVALUE=2",
+                      L"-Fo", L"third.cso", L"source.hlsl" };
+  DxcCompileJob jobs[] = {
+    { &SourceBuf, args0, _countof(args0) },
+    { &SourceBuf, args1, _countof(args1) },
+    { &SourceBuf, args2, _countof(args2) },
+  };
+  IDxcResult *pResults[_countof(jobs)] = {};
+  VERIFY_SUCCEEDED(pCompiler->CompileBatch(jobs, _countof(jobs), nullptr,
+                                           __uuidof(IDxcResult),
+                                           (LPVOID *)pResults));
+  std::vector<CComPtr<IDxcBlob>> objects;
+  LPCWSTR expectedNames[] = { L"first.cso", L"second.cso", L"third.cso" };
+  for (UINT32 i = 0; i < _countof(jobs); ++i) {
+    CComPtr<IDxcResult> pResult;
+    pResult.Attach(pResults[i]);
+    VerifyOperationSucceeded(pResult);
+    objects.emplace_back();
+    CComPtr<IDxcBlobWide> pName;
+    VERIFY_SUCCEEDED(pResult->GetOutput(DXC_OUT_OBJECT,
+                                        IID_PPV_ARGS(&objects.back()), &pName));
+    VERIFY_IS_NOT_NULL(pName.p);
+    VERIFY_ARE_EQUAL_WSTR(expectedNames[i], pName->GetStringPointer());
+  }
+
+  // Each job keeps its own output name, but the first two share one object.
+  VERIFY_ARE_EQUAL(objects[0].p, objects[1].p);
+  VERIFY_ARE_NOT_EQUAL(objects[0].p, objects[2].p);
+}
+
+TEST_F(CompilerTest, CompileParsedWhenVariantThenMatchesCompile) {
+  CComPtr<IDxcCompiler5> pCompiler;
+  VERIFY_SUCCEEDED(m_dllSupport.CreateInstance(CLSID_DxcCompiler, &pCompiler));
+
+  std::string source = "float4 main() : SV_Target { return VALUE; }";
+  DxcBuffer SourceBuf = { source.c_str(), source.size(), CP_UTF8 };
+
+  // Invalid arguments come back as a failed result.
+  {
+    LPCWSTR badArgs[] = { L"-Tps_6_0", L"-not-an-option", L"source.hlsl" };
+    CComPtr<IDxcParsedArguments> pArgs;
+    CComPtr<IDxcResult> pResult;
+    VERIFY_SUCCEEDED(pCompiler->ParseArguments(badArgs, _countof(badArgs),
+                                               &pArgs, &pResult));
+    VERIFY_IS_NULL(pArgs.p);
+    VERIFY_IS_NOT_NULL(pResult.p);
+    HRESULT status;
+    VERIFY_SUCCEEDED(pResult->GetStatus(&status));
+    VERIFY_FAILED(status);
+  }
+
+  LPCWSTR baseArgs[] = { L"-Tps_6_0", L"-DVALUE=1", L"source.hlsl" };
+  CComPtr<IDxcParsedArguments> pBase;
+  CComPtr<IDxcResult> pParseResult;
+  VERIFY_SUCCEEDED(pCompiler->ParseArguments(baseArgs, _countof(baseArgs),
+                                             &pBase, &pParseResult));
+  VERIFY_IS_NULL(pParseResult.p);
+
+  // A variant define is applied after the parsed ones.
+  DxcDefine variantDefine = { L"VALUE", L"2" };
+  CComPtr<IDxcParsedArguments> pVariant;
+  VERIFY_SUCCEEDED(pBase->CreateVariant(&variantDefine, 1, &pVariant));
+  VERIFY_ARE_EQUAL(pBase->GetCount() + 2, pVariant->GetCount());
+
+  LPCWSTR variantArgs[] = { L"-Tps_6_0", L"-DVALUE=1", L"source.hlsl",
+                            L"-DVALUE=2" };
+  struct { IDxcParsedArguments *pParsed; LPCWSTR *pArgs; UINT32 ArgCount; }
+  cases[] = { { pBase, baseArgs, _countof(baseArgs) },
+              { pVariant, variantArgs, _countof(variantArgs) } };
+  for (auto &c : cases) {
+    CComPtr<IDxcResult> pParsedResult;
+    CComPtr<IDxcResult> pResult;
+    VERIFY_SUCCEEDED(pCompiler->CompileParsed(&SourceBuf, c.pParsed, nullptr,
+                                              IID_PPV_ARGS(&pParsedResult)));
+    VerifyOperationSucceeded(pParsedResult);
+    VERIFY_SUCCEEDED(pCompiler->Compile(&SourceBuf, c.pArgs, c.ArgCount,
+                                        nullptr, IID_PPV_ARGS(&pResult)));
+    VerifyOperationSucceeded(pResult);
+
+    CComPtr<IDxcBlob> pParsedObject, pObject;
+    VERIFY_SUCCEEDED(pParsedResult->GetOutput(DXC_OUT_OBJECT,
+                                              IID_PPV_ARGS(&pParsedObject), nullptr));
+    VERIFY_SUCCEEDED(pResult->GetOutput(DXC_OUT_OBJECT,
+                                        IID_PPV_ARGS(&pObject), nullptr));
+    VERIFY_ARE_EQUAL(pObject->GetBufferSize(), pParsedObject->GetBufferSize());
+    VERIFY_ARE_EQUAL(0, memcmp(pObject->GetBufferPointer(),
+                               pParsedObject->GetBufferPointer(),
+                               pObject->GetBufferSize()));
+  }
+}
+
+TEST_F(CompilerTest, CompilePermutationsWhenPreprocessedSameThenShared) {
+  CComPtr<IDxcCompiler5> pCompiler;
+  VERIFY_SUCCEEDED(m_dllSupport.CreateInstance(CLSID_DxcCompiler, &pCompiler));
+
+  std::string source = "float4 main() : SV_Target { return VALUE; }";
+  DxcBuffer SourceBuf = { source.c_str(), source.size(), CP_UTF8 };
+  LPCWSTR args[] = { L"-Tps_6_0", L"source.hlsl" };
+  CComPtr<IDxcParsedArguments> pArgs;
+  CComPtr<IDxcResult> pParseResult;
+  VERIFY_SUCCEEDED(pCompiler->ParseArguments(args, _countof(args), &pArgs,
+                                             &pParseResult));
+
+  // The first two sets only differ by a define the source never tests.
+  DxcDefine defines[] = {
+    { L"VALUE", L"1" }, { L"UNUSED", L"1" },
+    { L"VALUE", L"1" }, { L"UNUSED", L"2" },
+    { L"VALUE", L"2" },
+  };
+  UINT32 defineCounts[] = { 2, 2, 1 };
+  IDxcResult *pResults[_countof(defineCounts)] = {};
+  VERIFY_SUCCEEDED(pCompiler->CompilePermutations(
+      &SourceBuf, pArgs, defineCounts, defines, _countof(defineCounts),
+      nullptr, __uuidof(IDxcResult), (LPVOID *)pResults));
+  std::vector<CComPtr<IDxcResult>> results;
+  for (IDxcResult *pResult : pResults) {
+    results.emplace_back();
+    results.back().Attach(pResult);
+    VerifyOperationSucceeded(pResult);
+  }
+  VERIFY_ARE_EQUAL(results[0].p, results[1].p);
+  VERIFY_ARE_NOT_EQUAL(results[0].p, results[2].p);
+}
+
+TEST_F(CompilerTest, DisassembleToStreamWhenFunctionsNamedThenOnlyThosePrinted) {
+  CComPtr<IDxcCompiler6> pCompiler;
+  VERIFY_SUCCEEDED(m_dllSupport.CreateInstance(CLSID_DxcCompiler, &pCompiler));
+
+  std::string source = "export float foo() { return 1; }\r\n"
+                       "export float bar() { return 2; }";
+  DxcBuffer SourceBuf = { source.c_str(), source.size(), CP_UTF8 };
+  LPCWSTR args[] = { L"-Tlib_6_3", L"source.hlsl" };
+  CComPtr<IDxcResult> pResult;
+  VERIFY_SUCCEEDED(pCompiler->Compile(&SourceBuf, args, _countof(args),
+                                      nullptr, IID_PPV_ARGS(&pResult)));
+  VerifyOperationSucceeded(pResult);
+  CComPtr<IDxcBlob> pProgram;
+  VERIFY_SUCCEEDED(pResult->GetOutput(DXC_OUT_OBJECT, IID_PPV_ARGS(&pProgram),
+                                      nullptr));
+  DxcBuffer ProgramBuf = { pProgram->GetBufferPointer(),
+                           pProgram->GetBufferSize(), 0 };
+
+  CComPtr<IMalloc> pMalloc;
+  VERIFY_SUCCEEDED(CoGetMalloc(1, &pMalloc));
+
+  // Without names, the stream receives what Disassemble returns.
+  CComPtr<IDxcResult> pDisassembly;
+  VERIFY_SUCCEEDED(pCompiler->Disassemble(&ProgramBuf,
+                                          IID_PPV_ARGS(&pDisassembly)));
+  CComPtr<IDxcBlobUtf8> pText;
+  VERIFY_SUCCEEDED(pDisassembly->GetOutput(DXC_OUT_DISASSEMBLY,
+                                           IID_PPV_ARGS(&pText), nullptr));
+  CComPtr<hlsl::AbstractMemoryStream> pFullStream;
+  VERIFY_SUCCEEDED(hlsl::CreateMemoryStream(pMalloc, &pFullStream));
+  VERIFY_SUCCEEDED(pCompiler->DisassembleToStream(&ProgramBuf, nullptr, 0,
+                                                  pFullStream));
+  std::string fullText((const char *)pFullStream->GetPtr(),
+                       pFullStream->GetPtrSize());
+  VERIFY_ARE_EQUAL(std::string(pText->GetStringPointer(),
+                               pText->GetStringLength()),
+                   fullText);
+  VERIFY_IS_TRUE(fullText.find("?foo@@YAMXZ") != std::string::npos);
+  VERIFY_IS_TRUE(fullText.find("?bar@@YAMXZ") != std::string::npos);
+
+  LPCWSTR names[] = { L"\x01?foo@@YAMXZ", L"missing" };
+  CComPtr<hlsl::AbstractMemoryStream> pStream;
+  VERIFY_SUCCEEDED(hlsl::CreateMemoryStream(pMalloc, &pStream));
+  VERIFY_SUCCEEDED(pCompiler->DisassembleToStream(&ProgramBuf, names,
+                                                  _countof(names), pStream));
+  std::string text((const char *)pStream->GetPtr(), pStream->GetPtrSize());
+  VERIFY_IS_TRUE(text.find("define float @\"\\01?foo@@YAMXZ\"()") !=
+                 std::string::npos);
+  VERIFY_IS_TRUE(text.find("?bar@@YAMXZ") == std::string::npos);
+  VERIFY_IS_TRUE(text.find("; function not found: missing") !=
+                 std::string::npos);
+}
+
+TEST_F(CompilerTest, CompileWhenSharedAcrossThreadsThenResultsMatch) {
+  CComPtr<IDxcCompiler3> pCompiler;
+  CComPtr<IDxcLangExtensions3> pLangExtensions;
+  VERIFY_SUCCEEDED(m_dllSupport.CreateInstance(CLSID_DxcCompiler, &pCompiler));
+  VERIFY_SUCCEEDED(pCompiler.QueryInterface(&pLangExtensions));
+
+  std::string source = "float4 main() : SV_Target { return VALUE; }";
+  DxcBuffer SourceBuf = { source.c_str(), source.size(), CP_UTF8 };
+  const int threadCount = 8;
+  const int compilesPerThread = 4;
+
+  auto Compile = [&](int value, std::string &object) -> HRESULT {
+    std::wstring define = L"-DVALUE=" + std::to_wstring(value);
+    LPCWSTR args[] = { L"-Tps_6_0", define.c_str(), L"source.hlsl" };
+    CComPtr<IDxcResult> pResult;
+    CComPtr<IDxcBlob> pObject;
+    HRESULT hr = pCompiler->Compile(&SourceBuf, args, _countof(args), nullptr,
+                                    IID_PPV_ARGS(&pResult));
+    if (SUCCEEDED(hr))
+      pResult->GetStatus(&hr);
+    if (SUCCEEDED(hr))
+      hr = pResult->GetOutput(DXC_OUT_OBJECT, IID_PPV_ARGS(&pObject), nullptr);
+    if (SUCCEEDED(hr))
+      object.assign((const char *)pObject->GetBufferPointer(),
+                    pObject->GetBufferSize());
+    return hr;
+  };
+
+  std::string expected[threadCount];
+  for (int i = 0; i < threadCount; ++i)
+    VERIFY_SUCCEEDED(Compile(i, expected[i]));
+
+  // Every thread compiles through the same object, while another keeps
+  // updating its configuration with the value it already has.
+  HRESULT hr[threadCount][compilesPerThread];
+  std::string actual[threadCount][compilesPerThread];
+  std::atomic<bool> compiling(true);
+  std::thread updater([&]() {
+    while (compiling)
+      pLangExtensions->SetTargetTriple("dxil-ms-dx");
+  });
+  std::vector<std::thread> threads;
+  for (int i = 0; i < threadCount; ++i) {
+    threads.emplace_back([&, i]() {
+      for (int j = 0; j < compilesPerThread; ++j)
+        hr[i][j] = Compile(i, actual[i][j]);
+    });
+  }
+  for (std::thread &thread : threads)
+    thread.join();
+  compiling = false;
+  updater.join();
+
+  for (int i = 0; i < threadCount; ++i) {
+    for (int j = 0; j < compilesPerThread; ++j) {
+      VERIFY_SUCCEEDED(hr[i][j]);
+      VERIFY_IS_TRUE(expected[i] == actual[i][j]);
+    }
+  }
+}
+
+TEST_F(CompilerTest, CompileWhenIncludeCacheThenLoadedOnce) {
+  CComPtr<IDxcCompiler3> pCompiler;
+  CComPtr<IDxcUtils2> pUtils;
+  VERIFY_SUCCEEDED(m_dllSupport.CreateInstance(CLSID_DxcCompiler, &pCompiler));
+  VERIFY_SUCCEEDED(m_dllSupport.CreateInstance(CLSID_DxcUtils, &pUtils));
+
+  std::string source = "#include \"helper.h\"\r\n"
+                       "float4 main() : SV_Target { return ZERO; }";
+  DxcBuffer SourceBuf = { source.c_str(), source.size(), CP_UTF8 };
+  LPCWSTR args[] = { L"-Tps_6_0", L"source.hlsl" };
+
+  CComPtr<TestIncludeHandler> pSingleInclude = new TestIncludeHandler(m_dllSupport);
+  pSingleInclude->CallResults.emplace_back("#define ZERO 0");
+  CComPtr<IDxcResult> pSingleResult;
+  VERIFY_SUCCEEDED(pCompiler->Compile(&SourceBuf, args, _countof(args),
+                                      pSingleInclude, IID_PPV_ARGS(&pSingleResult)));
+  VerifyOperationSucceeded(pSingleResult);
+
+  CComPtr<TestIncludeHandler> pInclude = new TestIncludeHandler(m_dllSupport);
+  pInclude->CallResults.emplace_back("#define ZERO 0");
+  CComPtr<IDxcIncludeCache> pCache;
+  VERIFY_SUCCEEDED(pUtils->CreateIncludeCache(pInclude, &pCache));
+
+  // A second compiler instance shares the same cache.
+  CComPtr<IDxcCompiler3> pCompiler2;
+  VERIFY_SUCCEEDED(m_dllSupport.CreateInstance(CLSID_DxcCompiler, &pCompiler2));
+  for (IDxcCompiler3 *pEach : { pCompiler.p, pCompiler2.p }) {
+    CComPtr<IDxcResult> pResult;
+    VERIFY_SUCCEEDED(pEach->Compile(&SourceBuf, args, _countof(args), pCache,
+                                    IID_PPV_ARGS(&pResult)));
+    VerifyOperationSucceeded(pResult);
+  }
+
+  // Both compiles together make the calls of a single compile; the second
+  // one is served entirely from the cache.
+  VERIFY_ARE_EQUAL(pSingleInclude->GetAllFileNames(),
+                   pInclude->GetAllFileNames());
+  UINT64 hits = 0, misses = 0;
+  VERIFY_SUCCEEDED(pCache->GetCacheStatistics(&hits, &misses));
+  VERIFY_IS_TRUE(misses > 0);
+  VERIFY_IS_TRUE(hits >= misses);
+
+  // After invalidation the file is loaded again.
+  VERIFY_SUCCEEDED(pCache->Invalidate(nullptr));
+  pInclude->callIndex = 0;
+  CComPtr<IDxcResult> pResult;
+  VERIFY_SUCCEEDED(pCompiler->Compile(&SourceBuf, args, _countof(args), pCache,
+                                      IID_PPV_ARGS(&pResult)));
+  VerifyOperationSucceeded(pResult);
+  VERIFY_ARE_EQUAL(pSingleInclude->CallInfos.size() * 2,
+                   pInclude->CallInfos.size());
+}
+
+TEST_F(CompilerTest, CompileWhenManyIncludesThenOK) {
+  CComPtr<IDxcCompiler3> pCompiler;
+  VERIFY_SUCCEEDED(m_dllSupport.CreateInstance(CLSID_DxcCompiler, &pCompiler));
+
+  // More distinct files than the old limit of 1000 include handles.
+  const unsigned includeCount = 1500;
+  std::string source;
+  CComPtr<TestIncludeHandler> pInclude = new TestIncludeHandler(m_dllSupport);
+  for (unsigned i = 0; i < includeCount; ++i) {
+    source += "#include \"inc" + std::to_string(i) + ".h\"\n";
+    pInclude->CallResults.emplace_back("// empty");
+  }
+  source += "float4 main() : SV_Target { return 0; }";
+  DxcBuffer SourceBuf = { source.c_str(), source.size(), CP_UTF8 };
+
+  LPCWSTR args[] = { L"-Tps_6_0", L"source.hlsl" };
+  CComPtr<IDxcResult> pResult;
+  VERIFY_SUCCEEDED(pCompiler->Compile(&SourceBuf, args, _countof(args), pInclude,
+                                      IID_PPV_ARGS(&pResult)));
+  VerifyOperationSucceeded(pResult);
+  VERIFY_ARE_EQUAL((size_t)includeCount, pInclude->CallInfos.size());
+}
+
+TEST_F(CompilerTest, CompileWhenIncludedTwiceThenSkipped) {
+  CComPtr<IDxcCompiler3> pCompiler;
+  VERIFY_SUCCEEDED(m_dllSupport.CreateInstance(CLSID_DxcCompiler, &pCompiler));
+
+  std::string source = "#include \"guarded.h\"\n"
+                       "#include \"once.h\"\n"
+                       "#include \"guarded.h\"\n"
+                       "#include \"once.h\"\n"
+                       "float4 main() : SV_Target { return GUARDED + ONCE; }";
+  DxcBuffer SourceBuf = { source.c_str(), source.size(), CP_UTF8 };
+  CComPtr<TestIncludeHandler> pInclude = new TestIncludeHandler(m_dllSupport);
+  pInclude->CallResults.emplace_back(
+      "#ifndef GUARDED_H\n#define GUARDED_H\n#define GUARDED 1\n#endif\n");
+  pInclude->CallResults.emplace_back("#pragma once\n#define ONCE 2\n");
+
+  LPCWSTR args[] = { L"-Tps_6_0", L"-Vi", L"source.hlsl" };
+  CComPtr<IDxcResult> pResult;
+  VERIFY_SUCCEEDED(pCompiler->Compile(&SourceBuf, args, _countof(args), pInclude,
+                                      IID_PPV_ARGS(&pResult)));
+  VerifyOperationSucceeded(pResult);
+
+  // Each file is loaded once and its second include is skipped.
+  VERIFY_ARE_EQUAL_WSTR(L"./guarded.h;./once.h;",
+                        pInclude->GetAllFileNames().c_str());
+  CComPtr<IDxcBlobUtf8> pErrors;
+  VERIFY_SUCCEEDED(pResult->GetOutput(DXC_OUT_ERRORS, IID_PPV_ARGS(&pErrors), nullptr));
+  VERIFY_IS_NOT_NULL(strstr(pErrors->GetStringPointer(), "Skipped [2] includes"));
+
+  // Two spellings of one path name the same file, so a #pragma once header
+  // is loaded once.
+  std::string spellings = "#include \"./inc/../a.h\"\n"
+                          "#include \"./a.h\"\n"
+                          "float4 main() : SV_Target { return A; }";
+  DxcBuffer SpellingsBuf = { spellings.c_str(), spellings.size(), CP_UTF8 };
+  CComPtr<TestIncludeHandler> pSpellingsInclude = new TestIncludeHandler(m_dllSupport);
+  pSpellingsInclude->CallResults.emplace_back("#pragma once\nstatic const float A = 1;\n");
+  pSpellingsInclude->CallResults.emplace_back("static const float A = 2;\n");
+  CComPtr<IDxcResult> pSpellingsResult;
+  VERIFY_SUCCEEDED(pCompiler->Compile(&SpellingsBuf, args, _countof(args),
+                                      pSpellingsInclude,
+                                      IID_PPV_ARGS(&pSpellingsResult)));
+  VerifyOperationSucceeded(pSpellingsResult);
+  VERIFY_ARE_EQUAL(1u, pSpellingsInclude->CallInfos.size());
+}
+
+TEST_F(CompilerTest, CompileWhenSearchDirMissesThenLoadAttemptedOnce) {
+  CComPtr<IDxcCompiler3> pCompiler;
+  VERIFY_SUCCEEDED(m_dllSupport.CreateInstance(CLSID_DxcCompiler, &pCompiler));
+
+  std::string source = "#include <a.h>\n"
+                       "float4 main() : SV_Target { return A; }";
+  DxcBuffer SourceBuf = { source.c_str(), source.size(), CP_UTF8 };
+  CComPtr<TestIncludeHandler> pInclude = new TestIncludeHandler(m_dllSupport);
+  pInclude->CallResults.emplace_back();                // inc0/a.h
+  pInclude->CallResults.emplace_back("#define A 1\n");      // inc1/a.h
+
+  // The second search directory is the first one spelled another way.
+  LPCWSTR args[] = { L"-Tps_6_0", L"-Iinc0", L"-Isub/../inc0", L"-Iinc1",
+                     L"source.hlsl" };
+  CComPtr<IDxcResult> pResult;
+  VERIFY_SUCCEEDED(pCompiler->Compile(&SourceBuf, args, _countof(args), pInclude,
+                                      IID_PPV_ARGS(&pResult)));
+  VerifyOperationSucceeded(pResult);
+
+  // The miss in inc0 is not asked of the handler again under the second
+  // spelling.
+  VERIFY_ARE_EQUAL(2u, pInclude->CallInfos.size());
+  for (const auto &info : pInclude->CallInfos)
+    VERIFY_ARE_EQUAL(std::wstring::npos, info.Filename.find(L"sub"));
+}
+
+TEST_F(CompilerTest, CompileWhenScanDependenciesThenDirectivesFollowed) {
+  CComPtr<IDxcCompiler3> pCompiler;
+  VERIFY_SUCCEEDED(m_dllSupport.CreateInstance(CLSID_DxcCompiler, &pCompiler));
+
+  std::string source = "#include \"a.h\"\n"
+                       "/* #include \"comment.h\"\n"
+                       "#include \"comment.h\" */\n"
+                       "static const string s = \"#include \\\"string.h\\\"\";\n"
+                       "#if FROM_A\n"
+                       "  #include \"b.h\"\n"
+                       "#else\n"
+                       "#include \"never.h\"\n"
+                       "#endif\n"
+                       "float4 main() : SV_Target { return 0; }";
+  DxcBuffer SourceBuf = { source.c_str(), source.size(), CP_UTF8 };
+
+  LPCWSTR scanArgs[] = { L"-Tps_6_0", L"-Mscan", L"source.hlsl" };
+  LPCWSTR jsonArgs[] = { L"-Tps_6_0", L"-Mscan", L"-Mjson", L"source.hlsl" };
+  for (unsigned i = 0; i < 2; ++i) {
+    CComPtr<TestIncludeHandler> pInclude = new TestIncludeHandler(m_dllSupport);
+    pInclude->CallResults.emplace_back("#define FROM_A 1\nfloat a;\n");
+    pInclude->CallResults.emplace_back("float b;\n");
+
+    CComPtr<IDxcResult> pResult;
+    VERIFY_SUCCEEDED(pCompiler->Compile(&SourceBuf, i ? jsonArgs : scanArgs,
+                                        i ? _countof(jsonArgs) : _countof(scanArgs),
+                                        pInclude, IID_PPV_ARGS(&pResult)));
+    VerifyOperationSucceeded(pResult);
+
+    // Only the included files that the directives reach are loaded.
+    VERIFY_ARE_EQUAL_WSTR(L"./a.h;./b.h;", pInclude->GetAllFileNames().c_str());
+    CComPtr<IDxcBlobUtf8> pText;
+    VERIFY_SUCCEEDED(pResult->GetOutput(DXC_OUT_TEXT, IID_PPV_ARGS(&pText), nullptr));
+    std::string text(pText->GetStringPointer(), pText->GetStringLength());
+    VERIFY_IS_TRUE(text.find("b.h") != std::string::npos);
+    VERIFY_IS_TRUE(text.find("never.h") == std::string::npos);
+    if (i) {
+      VERIFY_IS_TRUE(text.find("\"dependencies\": [") != std::string::npos);
+      VERIFY_IS_TRUE(text.find("\"to\": \"./b.h\"") != std::string::npos);
+    } else {
+      VERIFY_IS_TRUE(text.find("source.hlsl: ") == 0);
+    }
+  }
+}
+
+TEST_F(CompilerTest, CompileWhenPooledMallocThenStatisticsReported) {
+  CComPtr<IMalloc> pMalloc;
+  VERIFY_SUCCEEDED(m_dllSupport.CreateInstance(CLSID_DxcPooledMalloc, &pMalloc));
+  CComPtr<IDxcMallocStatistics> pStatistics;
+  VERIFY_SUCCEEDED(pMalloc.QueryInterface(&pStatistics));
+
+  {
+    CComPtr<IDxcCompiler> pCompiler;
+    CComPtr<IDxcOperationResult> pResult;
+    CComPtr<IDxcBlobEncoding> pSource;
+    VERIFY_SUCCEEDED(m_dllSupport.CreateInstance2(pMalloc, CLSID_DxcCompiler, &pCompiler));
+    CreateBlobFromText("float4 main() : SV_Target { return 1; }", &pSource);
+    VERIFY_SUCCEEDED(pCompiler->Compile(pSource, L"source.hlsl", L"main",
+                                        L"ps_6_0", nullptr, 0, nullptr, 0,
+                                        nullptr, &pResult));
+    VerifyOperationSucceeded(pResult);
+  }
+
+  DxcMallocStatistics stats;
+  VERIFY_SUCCEEDED(pStatistics->GetStatistics(&stats));
+  VERIFY_IS_TRUE(stats.AllocationCount > 0);
+  VERIFY_IS_TRUE(stats.FreeCount > 0);
+  VERIFY_IS_TRUE(stats.PeakBytesReserved >= stats.BytesReserved);
+  UINT64 classCount = 0;
+  for (UINT32 i = 0; i < DxcMallocSizeClassCount; ++i)
+    classCount += stats.SizeClassAllocationCount[i];
+  VERIFY_ARE_EQUAL(stats.AllocationCount, classCount);
+
+  // A block freed on another thread returns to the thread that allocated it.
+  CComPtr<IMalloc> pFreshMalloc;
+  VERIFY_SUCCEEDED(m_dllSupport.CreateInstance(CLSID_DxcPooledMalloc, &pFreshMalloc));
+  void *pBlock = pFreshMalloc->Alloc(24);
+  VERIFY_IS_NOT_NULL(pBlock);
+  std::thread([&]() { pFreshMalloc->Free(pBlock); }).join();
+  void *pReused = pFreshMalloc->Alloc(20);
+  VERIFY_ARE_EQUAL(pBlock, pReused);
+  pFreshMalloc->Free(pReused);
+
+  // The heap of a thread that has exited is reused by the next thread.
+  void *pExitedBlock = nullptr;
+  std::thread([&]() {
+    pExitedBlock = pFreshMalloc->Alloc(40);
+    pFreshMalloc->Free(pExitedBlock);
+  }).join();
+  CComPtr<IDxcMallocStatistics> pFreshStatistics;
+  VERIFY_SUCCEEDED(pFreshMalloc.QueryInterface(&pFreshStatistics));
+  VERIFY_SUCCEEDED(pFreshStatistics->GetStatistics(&stats));
+  UINT64 reservedAfterFirstThread = stats.BytesReserved;
+  void *pNextThreadBlock = nullptr;
+  std::thread([&]() {
+    pNextThreadBlock = pFreshMalloc->Alloc(40);
+    pFreshMalloc->Free(pNextThreadBlock);
+  }).join();
+  VERIFY_ARE_EQUAL(pExitedBlock, pNextThreadBlock);
+  VERIFY_SUCCEEDED(pFreshStatistics->GetStatistics(&stats));
+  VERIFY_ARE_EQUAL(reservedAfterFirstThread, stats.BytesReserved);
+}
+
+TEST_F(CompilerTest, CompileWhenTimeTraceThenPhasesReported) {
+  CComPtr<IDxcCompiler3> pCompiler;
+  VERIFY_SUCCEEDED(m_dllSupport.CreateInstance(CLSID_DxcCompiler, &pCompiler));
+
+  const char *source = "float4 main() : SV_Target { return 0; }";
+  DxcBuffer SourceBuf = { source, strlen(source), CP_UTF8 };
+
+  // No trace unless one is asked for.
+  LPCWSTR args[] = { L"-Tps_6_0", L"source.hlsl" };
+  CComPtr<IDxcResult> pResult;
+  VERIFY_SUCCEEDED(pCompiler->Compile(&SourceBuf, args, _countof(args),
+                                      nullptr, IID_PPV_ARGS(&pResult)));
+  VerifyOperationSucceeded(pResult);
+  VERIFY_IS_FALSE(pResult->HasOutput(DXC_OUT_TIME_TRACE));
+
+  LPCWSTR traceArgs[] = { L"-Tps_6_0", L"-ftime-trace", L"source.hlsl" };
+  pResult.Release();
+  VERIFY_SUCCEEDED(pCompiler->Compile(&SourceBuf, traceArgs,
+                                      _countof(traceArgs), nullptr,
+                                      IID_PPV_ARGS(&pResult)));
+  VerifyOperationSucceeded(pResult);
+  VERIFY_IS_TRUE(pResult->HasOutput(DXC_OUT_TIME_TRACE));
+  CComPtr<IDxcBlobUtf8> pTrace;
+  VERIFY_SUCCEEDED(pResult->GetOutput(DXC_OUT_TIME_TRACE,
+                                      IID_PPV_ARGS(&pTrace), nullptr));
+  std::string trace(pTrace->GetStringPointer(), pTrace->GetStringLength());
+  VERIFY_IS_TRUE(trace.find("\"traceEvents\"") != std::string::npos);
+  for (const char *phase : { "Compile", "Parse", "CodeGen", "Backend",
+                             "Assemble container", "Validation", "Hash" }) {
+    std::string name = std::string("\"name\":\"") + phase + "\"";
+    VERIFY_IS_TRUE(trace.find(name) != std::string::npos);
+    std::string total = std::string("\"name\":\"Total ") + phase + "\"";
+    VERIFY_IS_TRUE(trace.find(total) != std::string::npos);
+  }
+  // Passes are reported individually.
+  VERIFY_IS_TRUE(trace.find("\"name\":\"HLSL DXIL Finalize Module\"") !=
+                 std::string::npos);
+}
+
+TEST_F(CompilerTest, CompileWhenPassReportThenPassesReported) {
+  CComPtr<IDxcCompiler3> pCompiler;
+  VERIFY_SUCCEEDED(m_dllSupport.CreateInstance(CLSID_DxcCompiler, &pCompiler));
+
+  const char *source = "float4 main(float4 a : A) : SV_Target {\n"
+                       "  float4 r = 0;\n"
+                       "  for (int i = 0; i < 4; ++i) r += a * i;\n"
+                       "  return r;\n"
+                       "}";
+  DxcBuffer SourceBuf = { source, strlen(source), CP_UTF8 };
+
+  LPCWSTR args[] = { L"-Tps_6_0", L"source.hlsl" };
+  CComPtr<IDxcResult> pResult;
+  VERIFY_SUCCEEDED(pCompiler->Compile(&SourceBuf, args, _countof(args),
+                                      nullptr, IID_PPV_ARGS(&pResult)));
+  VerifyOperationSucceeded(pResult);
+  VERIFY_IS_FALSE(pResult->HasOutput(DXC_OUT_PASS_REPORT));
+
+  LPCWSTR reportArgs[] = { L"-Tps_6_0", L"-Qpass-report", L"source.hlsl" };
+  pResult.Release();
+  VERIFY_SUCCEEDED(pCompiler->Compile(&SourceBuf, reportArgs,
+                                      _countof(reportArgs), nullptr,
+                                      IID_PPV_ARGS(&pResult)));
+  VerifyOperationSucceeded(pResult);
+  CComPtr<IDxcBlobUtf8> pReport;
+  VERIFY_SUCCEEDED(pResult->GetOutput(DXC_OUT_PASS_REPORT,
+                                      IID_PPV_ARGS(&pReport), nullptr));
+  std::string report(pReport->GetStringPointer(), pReport->GetStringLength());
+  VERIFY_IS_TRUE(report.find("{\"passes\":[") == 0);
+  VERIFY_IS_TRUE(report.find("\"totals\":[") != std::string::npos);
+  VERIFY_IS_TRUE(report.find("{\"name\":\"DXIL Generator\",\"depth\":") !=
+                 std::string::npos);
+  // Function passes name the function they ran on, and every pass carries
+  // its instruction counts and memory.
+  VERIFY_IS_TRUE(report.find("\"function\":\"main\"") != std::string::npos);
+  VERIFY_IS_TRUE(report.find("\"instructionsAfter\":") != std::string::npos);
+  VERIFY_IS_TRUE(report.find("\"peakBytes\":") != std::string::npos);
+}
+
+TEST_F(CompilerTest, CompileWhenMemoryReportThenPhasesReported) {
+  CComPtr<IDxcCompiler3> pCompiler;
+  VERIFY_SUCCEEDED(m_dllSupport.CreateInstance(CLSID_DxcCompiler, &pCompiler));
+
+  const char *source = "float4 main(float4 a : A) : SV_Target { return a; }";
+  DxcBuffer SourceBuf = { source, strlen(source), CP_UTF8 };
+
+  LPCWSTR args[] = { L"-Tps_6_0", L"source.hlsl" };
+  CComPtr<IDxcResult> pResult;
+  VERIFY_SUCCEEDED(pCompiler->Compile(&SourceBuf, args, _countof(args),
+                                      nullptr, IID_PPV_ARGS(&pResult)));
+  VerifyOperationSucceeded(pResult);
+  VERIFY_IS_FALSE(pResult->HasOutput(DXC_OUT_MEMORY_REPORT));
+
+  LPCWSTR reportArgs[] = { L"-Tps_6_0", L"-Qmemory-report", L"source.hlsl" };
+  pResult.Release();
+  VERIFY_SUCCEEDED(pCompiler->Compile(&SourceBuf, reportArgs,
+                                      _countof(reportArgs), nullptr,
+                                      IID_PPV_ARGS(&pResult)));
+  VerifyOperationSucceeded(pResult);
+  CComPtr<IDxcBlobUtf8> pReport;
+  VERIFY_SUCCEEDED(pResult->GetOutput(DXC_OUT_MEMORY_REPORT,
+                                      IID_PPV_ARGS(&pReport), nullptr));
+  std::string report(pReport->GetStringPointer(), pReport->GetStringLength());
+  VERIFY_IS_TRUE(report.find("{\"peakBytes\":") == 0);
+  VERIFY_IS_TRUE(report.find("\"allocations\":") != std::string::npos);
+  // The phases are the same ranges as in the time trace.
+  VERIFY_IS_TRUE(report.find("{\"name\":\"Compile\",\"count\":1,") !=
+                 std::string::npos);
+  VERIFY_IS_TRUE(report.find("{\"name\":\"Parse\",") != std::string::npos);
+  VERIFY_IS_TRUE(report.find("{\"name\":\"Backend\",") != std::string::npos);
+  // The report does not depend on the time trace being enabled.
+  VERIFY_IS_FALSE(pResult->HasOutput(DXC_OUT_TIME_TRACE));
+}
+
+TEST_F(CompilerTest, CompileWhenMemoryLimitThenEnforced) {
+  CComPtr<IDxcCompiler3> pCompiler;
+  VERIFY_SUCCEEDED(m_dllSupport.CreateInstance(CLSID_DxcCompiler, &pCompiler));
+
+  const char *source = "float4 main(float4 a : A) : SV_Target { return a; }";
+  DxcBuffer SourceBuf = { source, strlen(source), CP_UTF8 };
+  LPCWSTR args[] = { L"-Tps_6_0", L"-Qmemory-limit", L"4096", L"source.hlsl" };
+  CComPtr<IDxcResult> pResult;
+  CComPtr<IDxcBlobUtf8> pErrors;
+  HRESULT status;
+
+#ifdef _WIN32
+  // The peak is reported when the compile fits in the limit.
+  VERIFY_SUCCEEDED(pCompiler->Compile(&SourceBuf, args, _countof(args),
+                                      nullptr, IID_PPV_ARGS(&pResult)));
+  VerifyOperationSucceeded(pResult);
+  CComPtr<IDxcBlobUtf8> pReport;
+  VERIFY_SUCCEEDED(pResult->GetOutput(DXC_OUT_MEMORY_REPORT,
+                                      IID_PPV_ARGS(&pReport), nullptr));
+  std::string report(pReport->GetStringPointer(), pReport->GetStringLength());
+  VERIFY_IS_TRUE(report.find("{\"peakBytes\":") == 0);
+
+  // Setting up the front end alone takes more than a megabyte.
+  LPCWSTR smallArgs[] = { L"-Tps_6_0", L"-Qmemory-limit", L"1",
+                          L"source.hlsl" };
+  pResult.Release();
+  VERIFY_SUCCEEDED(pCompiler->Compile(&SourceBuf, smallArgs,
+                                      _countof(smallArgs), nullptr,
+                                      IID_PPV_ARGS(&pResult)));
+  VERIFY_SUCCEEDED(pResult->GetStatus(&status));
+  VERIFY_ARE_EQUAL(E_OUTOFMEMORY, status);
+  VERIFY_SUCCEEDED(pResult->GetOutput(DXC_OUT_ERRORS,
+                                      IID_PPV_ARGS(&pErrors), nullptr));
+  VERIFY_IS_TRUE(strstr(pErrors->GetStringPointer(), "-Qmemory-limit") !=
+                 nullptr);
+
+  // The compiler is still usable afterwards.
+  pResult.Release();
+  VERIFY_SUCCEEDED(pCompiler->Compile(&SourceBuf, args, _countof(args),
+                                      nullptr, IID_PPV_ARGS(&pResult)));
+  VerifyOperationSucceeded(pResult);
+#else
+  // operator new only goes through the thread IMalloc on Windows, so the
+  // limit is rejected rather than silently not enforced.
+  VERIFY_SUCCEEDED(pCompiler->Compile(&SourceBuf, args, _countof(args),
+                                      nullptr, IID_PPV_ARGS(&pResult)));
+  VERIFY_SUCCEEDED(pResult->GetStatus(&status));
+  VERIFY_FAILED(status);
+  VERIFY_SUCCEEDED(pResult->GetOutput(DXC_OUT_ERRORS,
+                                      IID_PPV_ARGS(&pErrors), nullptr));
+  VERIFY_IS_TRUE(strstr(pErrors->GetStringPointer(),
+                        "-Qmemory-limit is only supported on Windows") !=
+                 nullptr);
+#endif // _WIN32
+}
+
+TEST_F(CompilerTest, CompileWhenLibIncrementalThenReused) {
+  CComPtr<IDxcCompiler3> pCompiler;
+  VERIFY_SUCCEEDED(m_dllSupport.CreateInstance(CLSID_DxcCompiler, &pCompiler));
+  CComPtr<IDxcValidator> pValidator;
+  VERIFY_SUCCEEDED(m_dllSupport.CreateInstance(CLSID_DxcValidator, &pValidator));
+
+  std::string source =
+      "RWByteAddressBuffer buf : register(u0);\n"
+      "export float scale(float x) { return x * 2; }\n"
+      "export float offset(float x) { return x + 1; }\n"
+      "[shader(\"raygeneration\")]\n"
+      "void RayGen() { buf.Store(0, asuint(scale(offset(1.0)))); }\n";
+  LPCWSTR args[] = { L"-Tlib_6_3", L"-Qlib-incremental", L"-ftime-trace",
+                     L"source.hlsl" };
+  LPCWSTR normalArgs[] = { L"-Tlib_6_3", L"source.hlsl" };
+  // Returns the validated library. With pOptimized and pReused, also returns
+  // the names of the partitions the time trace lists as optimized and reused.
+  auto compile = [&](const std::string &text, LPCWSTR *pArgs, UINT32 argCount,
+                     std::string *pOptimized, std::string *pReused) {
+    DxcBuffer SourceBuf = { text.c_str(), text.size(), CP_UTF8 };
+    CComPtr<IDxcResult> pResult;
+    VERIFY_SUCCEEDED(pCompiler->Compile(&SourceBuf, pArgs, argCount,
+                                        nullptr, IID_PPV_ARGS(&pResult)));
+    VerifyOperationSucceeded(pResult);
+    CComPtr<IDxcBlob> pObject;
+    VERIFY_SUCCEEDED(pResult->GetOutput(DXC_OUT_OBJECT,
+                                        IID_PPV_ARGS(&pObject), nullptr));
+    CComPtr<IDxcOperationResult> pValResult;
+    VERIFY_SUCCEEDED(pValidator->Validate(pObject, DxcValidatorFlags_Default,
+                                          &pValResult));
+    VerifyOperationSucceeded(pValResult);
+    if (pOptimized) {
+      CComPtr<IDxcBlobUtf8> pTrace;
+      VERIFY_SUCCEEDED(pResult->GetOutput(DXC_OUT_TIME_TRACE,
+                                          IID_PPV_ARGS(&pTrace), nullptr));
+      std::string trace(pTrace->GetStringPointer(),
+                        pTrace->GetStringLength());
+      // Each name is the part of the mangled name between '?' and '@'.
+      auto collect = [&](const char *event, std::string *pNames) {
+        std::string name = std::string("\"name\":\"") + event + "\"";
+        pNames->clear();
+        for (size_t pos = trace.find(name); pos != std::string::npos;
+             pos = trace.find(name, pos + 1)) {
+          size_t begin = trace.find('?', trace.find("\"detail\":\"", pos));
+          *pNames += trace.substr(begin, trace.find('@', begin) - begin);
+        }
+      };
+      collect("Optimize partition", pOptimized);
+      collect("Reuse partition", pReused);
+    }
+    return std::string((const char *)pObject->GetBufferPointer(),
+                       pObject->GetBufferSize());
+  };
+  // The code can differ from a normal compile, but not what the runtime sees
+  // of the library: its features, and its functions and resources.
+  auto verifySameInterface = [](const std::string &lib,
+                                const std::string &normalLib) {
+    for (hlsl::DxilFourCC part : { hlsl::DFCC_FeatureInfo,
+                                   hlsl::DFCC_RuntimeData }) {
+      const hlsl::DxilPartHeader *pPart = hlsl::GetDxilPartByType(
+          hlsl::IsDxilContainerLike(lib.data(), lib.size()), part);
+      const hlsl::DxilPartHeader *pNormalPart = hlsl::GetDxilPartByType(
+          hlsl::IsDxilContainerLike(normalLib.data(), normalLib.size()),
+          part);
+      VERIFY_IS_NOT_NULL(pPart);
+      VERIFY_IS_NOT_NULL(pNormalPart);
+      VERIFY_ARE_EQUAL(pNormalPart->PartSize, pPart->PartSize);
+      VERIFY_IS_TRUE(0 == memcmp(hlsl::GetDxilPartData(pNormalPart),
+                                 hlsl::GetDxilPartData(pPart),
+                                 pPart->PartSize));
+    }
+  };
+
+  // The first compile optimizes every partition.
+  std::string optimized, reused;
+  std::string first =
+      compile(source, args, _countof(args), &optimized, &reused);
+  VERIFY_ARE_EQUAL_STR("?scale?offset?RayGen", optimized.c_str());
+  VERIFY_ARE_EQUAL_STR("", reused.c_str());
+  verifySameInterface(first, compile(source, normalArgs,
+                                     _countof(normalArgs), nullptr, nullptr));
+
+  // A recompile reuses every partition and produces the same library.
+  VERIFY_IS_TRUE(first ==
+                 compile(source, args, _countof(args), &optimized, &reused));
+  VERIFY_ARE_EQUAL_STR("", optimized.c_str());
+  VERIFY_ARE_EQUAL_STR("?scale?offset?RayGen", reused.c_str());
+
+  // Editing one export only optimizes that export again: RayGen calls scale
+  // through a declaration, so its partition is reused.
+  std::string edited = source;
+  edited.replace(edited.find("x * 2"), 5, "x * 3");
+  std::string incremental =
+      compile(edited, args, _countof(args), &optimized, &reused);
+  VERIFY_ARE_EQUAL_STR("?scale", optimized.c_str());
+  VERIFY_ARE_EQUAL_STR("?offset?RayGen", reused.c_str());
+  VERIFY_IS_TRUE(first != incremental);
+  verifySameInterface(incremental, compile(edited, normalArgs,
+                                           _countof(normalArgs), nullptr,
+                                           nullptr));
+}
+
+TEST_F(CompilerTest, CompileWhenPerfReportThenCostsReported) {
+  CComPtr<IDxcCompiler3> pCompiler;
+  VERIFY_SUCCEEDED(m_dllSupport.CreateInstance(CLSID_DxcCompiler, &pCompiler));
+
+  const char *source =
+      "Texture2D<float4> t : register(t0);\n"
+      "SamplerState s : register(s0);\n"
+      "cbuffer C : register(b0) { float4 c0; float4 c1; uint n; };\n"
+      "float4 main(float2 uv : TEXCOORD) : SV_Target {\n"
+      "  float4 r = c0;\n"
+      "  [loop] for (uint i = 0; i < 4; ++i)\n"
+      "    r += t.Sample(s, uv + i) * c1;\n"
+      "  return sin(r);\n"
+      "}\n";
+  DxcBuffer SourceBuf = { source, strlen(source), CP_UTF8 };
+
+  LPCWSTR args[] = { L"-Tps_6_0", L"-Qperf-report", L"source.hlsl" };
+  CComPtr<IDxcResult> pResult;
+  VERIFY_SUCCEEDED(pCompiler->Compile(&SourceBuf, args, _countof(args),
+                                      nullptr, IID_PPV_ARGS(&pResult)));
+  VerifyOperationSucceeded(pResult);
+  CComPtr<IDxcBlobUtf8> pReport;
+  VERIFY_SUCCEEDED(pResult->GetOutput(DXC_OUT_PERF_REPORT,
+                                      IID_PPV_ARGS(&pReport), nullptr));
+  std::string report(pReport->GetStringPointer(), pReport->GetStringLength());
+  VERIFY_IS_TRUE(report.find("\"counters\":{\"insts\":") != std::string::npos);
+  VERIFY_IS_TRUE(report.find("{\"name\":\"main\",") != std::string::npos);
+  VERIFY_IS_TRUE(report.find("\"loops\":1,") != std::string::npos);
+  // The sample in the loop runs four times.
+  VERIFY_IS_TRUE(report.find("\"static\":{") != std::string::npos);
+  VERIFY_IS_TRUE(report.find("\"texture\":4,") != std::string::npos);
+  // c0 and c1 are two rows, however many times they are loaded.
+  VERIFY_IS_TRUE(report.find("\"rows\":2,") != std::string::npos);
+  VERIFY_IS_TRUE(report.find("\"peakLive\":") != std::string::npos);
+
+  // Library function names start with \01, which JSON needs escaped.
+  const char *libSource = "export float foo(float a) { return a * 2; }\n";
+  DxcBuffer LibSourceBuf = { libSource, strlen(libSource), CP_UTF8 };
+  LPCWSTR libArgs[] = { L"-Tlib_6_x", L"-Qperf-report", L"source.hlsl" };
+  CComPtr<IDxcResult> pLibResult;
+  VERIFY_SUCCEEDED(pCompiler->Compile(&LibSourceBuf, libArgs,
+                                      _countof(libArgs), nullptr,
+                                      IID_PPV_ARGS(&pLibResult)));
+  VerifyOperationSucceeded(pLibResult);
+  CComPtr<IDxcBlobUtf8> pLibReport;
+  VERIFY_SUCCEEDED(pLibResult->GetOutput(DXC_OUT_PERF_REPORT,
+                                         IID_PPV_ARGS(&pLibReport), nullptr));
+  std::string libReport(pLibReport->GetStringPointer(),
+                        pLibReport->GetStringLength());
+  VERIFY_IS_TRUE(libReport.find("{\"name\":\"\\u0001?foo@@") !=
+                 std::string::npos);
+  VERIFY_IS_TRUE(libReport.find('\x01') == std::string::npos);
+}
+
+TEST_F(CompilerTest, CompileWhenWarningsThenErrorsInResultEncoding) {
+  CComPtr<IDxcCompiler3> pCompiler;
+  VERIFY_SUCCEEDED(m_dllSupport.CreateInstance(CLSID_DxcCompiler, &pCompiler));
+
+  const char *source =
+      "float4 main() : SV_Target {\n"
+      "  float2 f = float4(1, 2, 3, 4);\n"
+      "  return f.xyxy;\n"
+      "}\n";
+  DxcBuffer SourceBuf = { source, strlen(source), CP_UTF8 };
+
+  LPCWSTR argsUtf8[] = { L"-Tps_6_0", L"-encoding", L"utf8", L"source.hlsl" };
+  CComPtr<IDxcResult> pResult;
+  VERIFY_SUCCEEDED(pCompiler->Compile(&SourceBuf, argsUtf8, _countof(argsUtf8),
+                                      nullptr, IID_PPV_ARGS(&pResult)));
+  VerifyOperationSucceeded(pResult);
+  CComPtr<IDxcBlobUtf8> pErrorsUtf8;
+  VERIFY_SUCCEEDED(pResult->GetOutput(DXC_OUT_ERRORS,
+                                      IID_PPV_ARGS(&pErrorsUtf8), nullptr));
+  std::string errors(pErrorsUtf8->GetStringPointer(),
+                     pErrorsUtf8->GetStringLength());
+  VERIFY_IS_TRUE(errors.find("implicit truncation") != std::string::npos);
+  // The output is stored once; asking again returns the same buffer.
+  CComPtr<IDxcBlobEncoding> pErrorBuffer;
+  VERIFY_SUCCEEDED(pResult->GetErrorBuffer(&pErrorBuffer));
+  VERIFY_ARE_EQUAL(pErrorsUtf8->GetBufferPointer(),
+                   pErrorBuffer->GetBufferPointer());
+
+  LPCWSTR argsWide[] = { L"-Tps_6_0", L"-encoding", L"wide", L"source.hlsl" };
+  pResult.Release();
+  VERIFY_SUCCEEDED(pCompiler->Compile(&SourceBuf, argsWide, _countof(argsWide),
+                                      nullptr, IID_PPV_ARGS(&pResult)));
+  VerifyOperationSucceeded(pResult);
+  CComPtr<IDxcBlobWide> pErrorsWide;
+  VERIFY_SUCCEEDED(pResult->GetOutput(DXC_OUT_ERRORS,
+                                      IID_PPV_ARGS(&pErrorsWide), nullptr));
+  std::wstring errorsWide(pErrorsWide->GetStringPointer(),
+                          pErrorsWide->GetStringLength());
+  VERIFY_ARE_EQUAL_WSTR(Unicode::UTF8ToWideStringOrThrow(errors.c_str()).c_str(),
+                        errorsWide.c_str());
+}
+
 TEST_F(CompilerTest, CompileWhenIncludeMissingThenFail) {
   CComPtr<IDxcCompiler> pCompiler;
   CComPtr<IDxcOperationResult> pResult;
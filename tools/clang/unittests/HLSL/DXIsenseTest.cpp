@@ -12,6 +12,7 @@
 #include "dxc/Test/CompilationResult.h"
 #include "dxc/Test/HLSLTestData.h"
 #include <stdint.h>
+#include <future>
 
 #ifdef _WIN32
 #include "WexTestClass.h"
@@ -117,6 +118,7 @@ protected:
   TEST_METHOD(TUWhenRegionInactiveThenEndIsBeforeEndifHash)
   TEST_METHOD(TUWhenRegionInactiveThenStartIsAtIfdefEol)
   TEST_METHOD(TUWhenUnsaveFileThenOK)
+  TEST_METHOD(TUWhenReparseReusingIncludesThenBodiesSkipped)
 
   TEST_METHOD(QualifiedNameClass)
   TEST_METHOD(QualifiedNameVariable)
@@ -124,6 +126,8 @@ protected:
   TEST_METHOD(TypeWhenICEThenEval)
 
   TEST_METHOD(CompletionWhenResultsAvailable)
+  TEST_METHOD(CompletionWhenAsyncThenResultsDelivered)
+  TEST_METHOD(TUWhenAsyncReparseThenEarlierRequestsAborted)
 };
 
 bool DXIntellisenseTest::DXIntellisenseTestClassSetup() {
@@ -502,6 +506,86 @@ TEST_F(DXIntellisenseTest, TUWhenUnsaveFileThenOK) {
   }
 }
 
+TEST_F(DXIntellisenseTest, TUWhenReparseReusingIncludesThenBodiesSkipped) {
+  const char mainName[] = "main.hlsl";
+  const char includeName[] = "./inc.h";
+  const char mainProgram[] =
+    "#include \"inc.h\"\n"
+    "float4 main() : SV_Target { return helper(); }";
+  const char editedProgram[] =
+    "#include \"inc.h\"\n"
+    "float4 main() : SV_Target { return helper() * 2; }";
+  const char include[] = "float4 helper() { return undeclared_name; }";
+  const char editedInclude[] = "float4 helper() { return other_undeclared_name; }";
+
+  HlslIntellisenseSupport support;
+  VERIFY_SUCCEEDED(support.Initialize());
+  CComPtr<IDxcIntelliSense> isense;
+  CComPtr<IDxcIntelliSense2> isense2;
+  CComPtr<IDxcIndex> tuIndex;
+  CComPtr<IDxcTranslationUnit> tu;
+  DxcTranslationUnitFlags localOptions;
+  VERIFY_SUCCEEDED(support.CreateIntellisense(&isense));
+  VERIFY_SUCCEEDED(isense.QueryInterface(&isense2));
+  VERIFY_SUCCEEDED(isense->CreateIndex(&tuIndex));
+  VERIFY_SUCCEEDED(isense->GetDefaultEditingTUOptions(&localOptions));
+
+  auto createFiles = [&](const char *program, const char *inc,
+                         CComPtr<IDxcUnsavedFile> (&files)[2]) {
+    files[0].Release();
+    files[1].Release();
+    VERIFY_SUCCEEDED(isense->CreateUnsavedFile(mainName, program, strlen(program), &files[0]));
+    VERIFY_SUCCEEDED(isense->CreateUnsavedFile(includeName, inc, strlen(inc), &files[1]));
+  };
+  CComPtr<IDxcUnsavedFile> files[2];
+  createFiles(mainProgram, include, files);
+  IDxcUnsavedFile *pFiles[] = { files[0], files[1] };
+  VERIFY_SUCCEEDED(tuIndex->ParseTranslationUnit(mainName, nullptr, 0,
+    pFiles, 2, localOptions, &tu));
+
+  // The first parse checks the body in the included file.
+  unsigned numDiagnostics;
+  VERIFY_SUCCEEDED(tu->GetNumDiagnostics(&numDiagnostics));
+  VERIFY_ARE_EQUAL(1U, numDiagnostics);
+
+  // Editing only the main file reuses the included declarations and skips
+  // the body, while helper() still resolves and the error in its body is
+  // still reported.
+  createFiles(editedProgram, include, files);
+  pFiles[0] = files[0];
+  pFiles[1] = files[1];
+  VERIFY_SUCCEEDED(isense2->ReparseTranslationUnit(tu, pFiles, 2));
+  VERIFY_SUCCEEDED(tu->GetNumDiagnostics(&numDiagnostics));
+  VERIFY_ARE_EQUAL(1U, numDiagnostics);
+  {
+    CComPtr<IDxcDiagnostic> pDiag;
+    CComHeapPtr<char> pText;
+    VERIFY_SUCCEEDED(tu->GetDiagnostic(0, &pDiag));
+    VERIFY_SUCCEEDED(pDiag->GetSpelling(&pText));
+    VERIFY_IS_NOT_NULL(strstr(pText, "'undeclared_name'"));
+  }
+
+  // Editing the included file parses its body again.
+  createFiles(editedProgram, editedInclude, files);
+  pFiles[0] = files[0];
+  pFiles[1] = files[1];
+  VERIFY_SUCCEEDED(isense2->ReparseTranslationUnit(tu, pFiles, 2));
+  VERIFY_SUCCEEDED(tu->GetNumDiagnostics(&numDiagnostics));
+  VERIFY_ARE_EQUAL(1U, numDiagnostics);
+  {
+    CComPtr<IDxcDiagnostic> pDiag;
+    CComHeapPtr<char> pText;
+    VERIFY_SUCCEEDED(tu->GetDiagnostic(0, &pDiag));
+    VERIFY_SUCCEEDED(pDiag->GetSpelling(&pText));
+    VERIFY_IS_NOT_NULL(strstr(pText, "'other_undeclared_name'"));
+  }
+
+  // A plain reparse still checks every body.
+  VERIFY_SUCCEEDED(tu->Reparse(pFiles, 2));
+  VERIFY_SUCCEEDED(tu->GetNumDiagnostics(&numDiagnostics));
+  VERIFY_ARE_EQUAL(1U, numDiagnostics);
+}
+
 TEST_F(DXIntellisenseTest, QualifiedNameClass) {
   char program[] =
     "class TheClass {\r\n"
@@ -879,3 +963,106 @@ TEST_F(DXIntellisenseTest, CompletionWhenResultsAvailable)
   VERIFY_SUCCEEDED(completionString->GetCompletionChunkText(0, &completionChunkText));
   VERIFY_ARE_EQUAL_STR("MyStruct", completionChunkText);
 }
+
+// Records the statuses an asynchronous request delivers.
+class TestTranslationUnitCallback : public IDxcTranslationUnitCallback {
+  DXC_MICROCOM_REF_FIELD(m_dwRef)
+public:
+  DXC_MICROCOM_ADDREF_RELEASE_IMPL(m_dwRef)
+  TestTranslationUnitCallback() : m_dwRef(0) {}
+  HRESULT STDMETHODCALLTYPE QueryInterface(REFIID iid, void** ppvObject) override {
+    return DoBasicQueryInterface<IDxcTranslationUnitCallback>(this, iid, ppvObject);
+  }
+  std::vector<HRESULT> Statuses;
+  CComPtr<IDxcCodeCompleteResults> Results;
+  HRESULT STDMETHODCALLTYPE OnReparsed(HRESULT status) override {
+    Statuses.push_back(status);
+    return S_OK;
+  }
+  HRESULT STDMETHODCALLTYPE OnCodeCompleted(HRESULT status, IDxcCodeCompleteResults *pResults) override {
+    Statuses.push_back(status);
+    Results = pResults;
+    return S_OK;
+  }
+};
+
+// Holds the async worker inside its callback until Unblock is signaled, so
+// that tests can queue several requests behind it.
+class BlockingTranslationUnitCallback : public TestTranslationUnitCallback {
+public:
+  std::promise<void> Unblock;
+  HRESULT STDMETHODCALLTYPE OnCodeCompleted(HRESULT status, IDxcCodeCompleteResults *pResults) override {
+    Unblock.get_future().wait();
+    return TestTranslationUnitCallback::OnCodeCompleted(status, pResults);
+  }
+};
+
+TEST_F(DXIntellisenseTest, CompletionWhenAsyncThenResultsDelivered)
+{
+  char program[] =
+    "struct MyStruct {};"
+    "MyStr";
+  CompilationResult result(CompilationResult::CreateForProgram(program, _countof(program)));
+  CComPtr<IDxcTranslationUnit2> TU2;
+  VERIFY_SUCCEEDED(result.TU->QueryInterface(&TU2));
+  const char* fileName = "filename.hlsl";
+  CComPtr<IDxcUnsavedFile> unsavedFile;
+  VERIFY_SUCCEEDED(TrivialDxcUnsavedFile::Create(fileName, program, &unsavedFile));
+  CComPtr<TestTranslationUnitCallback> callback = new TestTranslationUnitCallback();
+  VERIFY_SUCCEEDED(TU2->CodeCompleteAtAsync(fileName, 2, 1, &unsavedFile.p, 1,
+                                            DxcCodeCompleteFlags_None, callback));
+  VERIFY_SUCCEEDED(TU2->WaitForAsync());
+  VERIFY_ARE_EQUAL(1U, callback->Statuses.size());
+  VERIFY_SUCCEEDED(callback->Statuses[0]);
+  VERIFY_IS_NOT_NULL(callback->Results.p);
+  unsigned numResults;
+  VERIFY_SUCCEEDED(callback->Results->GetNumResults(&numResults));
+  VERIFY_IS_GREATER_THAN_OR_EQUAL(numResults, 1u);
+}
+
+TEST_F(DXIntellisenseTest, TUWhenAsyncReparseThenEarlierRequestsAborted)
+{
+  char program[] = "float4 main() : SV_Target { return 0; }";
+  char edited[] = "float4 main() : SV_Target { return undeclared_name; }";
+  CompilationResult result(CompilationResult::CreateForProgram(program, _countof(program)));
+  CComPtr<IDxcTranslationUnit2> TU2;
+  VERIFY_SUCCEEDED(result.TU->QueryInterface(&TU2));
+  const char* fileName = "filename.hlsl";
+  CComPtr<IDxcUnsavedFile> firstFile, editedFile;
+  VERIFY_SUCCEEDED(TrivialDxcUnsavedFile::Create(fileName, program, &firstFile));
+  VERIFY_SUCCEEDED(TrivialDxcUnsavedFile::Create(fileName, edited, &editedFile));
+
+  // Keep the worker busy until both reparses are queued, so the first one
+  // is always stale by the time it is dequeued.
+  CComPtr<BlockingTranslationUnitCallback> blocker = new BlockingTranslationUnitCallback();
+  CComPtr<TestTranslationUnitCallback> first = new TestTranslationUnitCallback();
+  CComPtr<TestTranslationUnitCallback> second = new TestTranslationUnitCallback();
+  CComPtr<TestTranslationUnitCallback> cancelled = new TestTranslationUnitCallback();
+  VERIFY_SUCCEEDED(TU2->CodeCompleteAtAsync(fileName, 1, 1, &firstFile.p, 1,
+                                            DxcCodeCompleteFlags_None, blocker));
+  VERIFY_SUCCEEDED(TU2->ReparseAsync(&firstFile.p, 1, FALSE, first));
+  VERIFY_SUCCEEDED(TU2->ReparseAsync(&editedFile.p, 1, FALSE, second));
+  blocker->Unblock.set_value();
+  VERIFY_SUCCEEDED(TU2->WaitForAsync());
+  VERIFY_ARE_EQUAL(1U, blocker->Statuses.size());
+  VERIFY_ARE_EQUAL(1U, first->Statuses.size());
+  VERIFY_ARE_EQUAL(E_ABORT, first->Statuses[0]);
+  VERIFY_ARE_EQUAL(1U, second->Statuses.size());
+  VERIFY_SUCCEEDED(second->Statuses[0]);
+
+  // Diagnostics are those of the last edit.
+  unsigned numDiagnostics;
+  VERIFY_SUCCEEDED(result.TU->GetNumDiagnostics(&numDiagnostics));
+  VERIFY_ARE_EQUAL(1U, numDiagnostics);
+
+  // Likewise keep the reparse queued until after it is cancelled.
+  CComPtr<BlockingTranslationUnitCallback> cancelBlocker = new BlockingTranslationUnitCallback();
+  VERIFY_SUCCEEDED(TU2->CodeCompleteAtAsync(fileName, 1, 1, &firstFile.p, 1,
+                                            DxcCodeCompleteFlags_None, cancelBlocker));
+  VERIFY_SUCCEEDED(TU2->ReparseAsync(&firstFile.p, 1, FALSE, cancelled));
+  VERIFY_SUCCEEDED(TU2->CancelAsync());
+  cancelBlocker->Unblock.set_value();
+  VERIFY_SUCCEEDED(TU2->WaitForAsync());
+  VERIFY_ARE_EQUAL(1U, cancelled->Statuses.size());
+  VERIFY_ARE_EQUAL(E_ABORT, cancelled->Statuses[0]);
+}
@@ -100,6 +100,7 @@ public:
   TEST_METHOD(CompileWhenOkThenCheckRDAT2)
   TEST_METHOD(CompileWhenOkThenCheckReflection1)
   TEST_METHOD(DxcUtils_CreateReflection)
+  TEST_METHOD(DxcUtils_CreateReflectionCached)
   TEST_METHOD(CompileWhenOKThenIncludesFeatureInfo)
   TEST_METHOD(CompileWhenOKThenIncludesSignatures)
   TEST_METHOD(CompileWhenSigSquareThenIncludeSplit)
@@ -1065,6 +1066,15 @@ TEST_F(DxilContainerTest, CompileWhenOkThenCheckRDAT) {
       VERIFY_IS_TRUE(pReflection->InitFromRDAT(pBlob->GetBufferPointer(), pBlob->GetBufferSize()));
       DxilLibraryDesc lib_reflection = pReflection->GetLibraryReflection();
       VERIFY_ARE_EQUAL(lib_reflection.NumFunctions, 4);
+      for (uint32_t j = 0; j < lib_reflection.NumFunctions; ++j) {
+        const DxilFunctionDesc *pFunction = &lib_reflection.pFunction[j];
+        VERIFY_ARE_EQUAL(pReflection->FindFunction(pFunction->Name), pFunction);
+      }
+      VERIFY_IS_NULL(pReflection->FindFunction(L"function_missing"));
+      uint32_t numAssociations = 1;
+      VERIFY_IS_NULL(pReflection->GetAssociationsForExport(
+          lib_reflection.pFunction[0].Name, &numAssociations));
+      VERIFY_ARE_EQUAL(numAssociations, 0);
       for (uint32_t j = 0; j < 3; ++j) {
         DxilFunctionDesc function = lib_reflection.pFunction[j];
         std::string cur_str = str;
@@ -1649,6 +1659,56 @@ TEST_F(DxilContainerTest, DxcUtils_CreateReflection) {
     }
   }
 }
+
+TEST_F(DxilContainerTest, DxcUtils_CreateReflectionCached) {
+  CComPtr<IDxcUtils3> pUtils;
+  VERIFY_SUCCEEDED(m_dllSupport.CreateInstance(CLSID_DxcUtils, &pUtils));
+  CComPtr<IDxcCompiler> pCompiler;
+  VERIFY_SUCCEEDED(CreateCompiler(&pCompiler));
+  CComPtr<IDxcBlobEncoding> pSource;
+  CreateBlobFromText(Ref1_Shader, &pSource);
+  CComPtr<IDxcOperationResult> pResult;
+  VERIFY_SUCCEEDED(pCompiler->Compile(pSource, L"hlsl.hlsl", L"function2",
+                                      L"vs_6_3", nullptr, 0, nullptr, 0,
+                                      nullptr, &pResult));
+  HRESULT hr;
+  VERIFY_SUCCEEDED(pResult->GetStatus(&hr));
+  VERIFY_SUCCEEDED(hr);
+  CComPtr<IDxcBlob> pProgram;
+  VERIFY_SUCCEEDED(pResult->GetResult(&pProgram));
+  DxcBuffer buffer = { pProgram->GetBufferPointer(), pProgram->GetBufferSize(), 0 };
+
+  auto Reflect = [&]() {
+    CComPtr<ID3D12ShaderReflection> pReflection;
+    VERIFY_SUCCEEDED(pUtils->CreateReflection(&buffer, IID_PPV_ARGS(&pReflection)));
+    D3D12_SHADER_DESC desc;
+    VERIFY_SUCCEEDED(pReflection->GetDesc(&desc));
+    VERIFY_ARE_EQUAL(desc.ConstantBuffers, 2u);
+    return pReflection;
+  };
+
+  // Not shared unless enabled.
+  VERIFY_ARE_NOT_EQUAL(Reflect().p, Reflect().p);
+
+  VERIFY_SUCCEEDED(pUtils->SetReflectionCacheSize(4));
+  CComPtr<ID3D12ShaderReflection> pFirst = Reflect();
+  VERIFY_ARE_EQUAL(pFirst.p, Reflect().p);
+
+  // GetPartReflection shares the object too.
+  CComPtr<IDxcContainerReflection> pContainerReflection;
+  VERIFY_SUCCEEDED(m_dllSupport.CreateInstance(CLSID_DxcContainerReflection, &pContainerReflection));
+  VERIFY_SUCCEEDED(pContainerReflection->Load(pProgram));
+  UINT32 idxPart = 0;
+  VERIFY_SUCCEEDED(pContainerReflection->FindFirstPartKind(DXC_PART_DXIL, &idxPart));
+  CComPtr<ID3D12ShaderReflection> pPartReflection;
+  VERIFY_SUCCEEDED(pContainerReflection->GetPartReflection(idxPart, IID_PPV_ARGS(&pPartReflection)));
+  VERIFY_ARE_EQUAL(pFirst.p, pPartReflection.p);
+
+  VERIFY_SUCCEEDED(pUtils->FlushReflectionCache());
+  VERIFY_ARE_NOT_EQUAL(pFirst.p, Reflect().p);
+
+  VERIFY_SUCCEEDED(pUtils->SetReflectionCacheSize(0));
+}
 #endif // _WIN32 - Reflection unsupported
 
 TEST_F(DxilContainerTest, CompileWhenOKThenIncludesFeatureInfo) {
@@ -1997,6 +2057,10 @@ TEST_F(DxilContainerTest, DxilContainerUnitTest) {
   VERIFY_IS_NOT_NULL(hlsl::GetDxilProgramHeader(pHeader, hlsl::DxilFourCC::DFCC_ShaderDebugInfoDXIL));
   VERIFY_IS_NOT_NULL(hlsl::GetDxilPartByType(pHeader, hlsl::DxilFourCC::DFCC_DXIL));
   VERIFY_IS_NOT_NULL(hlsl::GetDxilPartByType(pHeader, hlsl::DxilFourCC::DFCC_ShaderDebugInfoDXIL));
+  hlsl::DxilContainerFingerprint debugFingerprint;
+  VERIFY_IS_TRUE(hlsl::GetDxilContainerFingerprint(pHeader, &debugFingerprint));
+  VERIFY_ARE_NOT_EQUAL(debugFingerprint.OutputSignature, 0);
+  VERIFY_ARE_NOT_EQUAL(debugFingerprint.ResourceBindings, 0);
   
   pResult.Release();
   pProgram.Release();
@@ -2012,6 +2076,10 @@ TEST_F(DxilContainerTest, DxilContainerUnitTest) {
   VERIFY_IS_NULL(hlsl::GetDxilProgramHeader(pHeader, hlsl::DxilFourCC::DFCC_ShaderDebugInfoDXIL));
   VERIFY_IS_NOT_NULL(hlsl::GetDxilPartByType(pHeader, hlsl::DxilFourCC::DFCC_DXIL));
   VERIFY_IS_NULL(hlsl::GetDxilPartByType(pHeader, hlsl::DxilFourCC::DFCC_ShaderDebugInfoDXIL));
+  // Debug info doesn't change the pipeline-facing parts.
+  hlsl::DxilContainerFingerprint fingerprint;
+  VERIFY_IS_TRUE(hlsl::GetDxilContainerFingerprint(pHeader, &fingerprint));
+  VERIFY_ARE_EQUAL(0, memcmp(&fingerprint, &debugFingerprint, sizeof(fingerprint)));
 
   // Test Empty DxilContainer
   hlsl::DxilContainerHeader header;
@@ -2020,5 +2088,8 @@ TEST_F(DxilContainerTest, DxilContainerUnitTest) {
   VERIFY_IS_NOT_NULL(hlsl::IsDxilContainerLike(&header, header.ContainerSizeInBytes));
   VERIFY_IS_NULL(hlsl::GetDxilProgramHeader(&header, hlsl::DxilFourCC::DFCC_DXIL));
   VERIFY_IS_NULL(hlsl::GetDxilPartByType(&header, hlsl::DxilFourCC::DFCC_DXIL));
+  VERIFY_IS_TRUE(hlsl::GetDxilContainerFingerprint(&header, &fingerprint));
+  VERIFY_ARE_EQUAL(fingerprint.InputSignature, 0);
+  VERIFY_ARE_EQUAL(fingerprint.ResourceBindings, 0);
 
 }
@@ -18,6 +18,9 @@
 #include "dxc/DXIL/DxilInstructions.h"
 #include "dxc/DxilContainer/DxilContainer.h"
 #include "dxc/DXIL/DxilModule.h"
+#include "dxc/DXIL/DxilOpCallIndex.h"
+#include "dxc/DXIL/DxilUtil.h"
+#include "dxc/HLSL/DxilPackSignatureElement.h"
 #include "llvm/Support/Regex.h"
 #include "llvm/Support/MSFileSystem.h"
 #include "llvm/Support/FileSystem.h"
@@ -25,7 +28,10 @@
 #include "llvm/Support/ErrorOr.h"
 #include "llvm/Bitcode/ReaderWriter.h"
 #include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/IRBuilder.h"
 #include "llvm/IR/InstIterator.h"
+#include "llvm/IR/IntrinsicInst.h"
+#include "llvm/IR/Verifier.h"
 
 using namespace hlsl;
 using namespace llvm;
@@ -71,6 +77,12 @@ public:
 
   TEST_METHOD(PayloadQualifier)
 
+  TEST_METHOD(LoadWithoutDebugInfo)
+
+  TEST_METHOD(PackInterstageSignatures)
+  TEST_METHOD(EliminateUnreadOutputs)
+  TEST_METHOD(OpCallIndex)
+
   void VerifyValidatorVersionFails(
     LPCWSTR shaderModel, const std::vector<LPCWSTR> &arguments,
     const std::vector<LPCSTR> &expectedErrors);
@@ -127,19 +139,19 @@ public:
     return DisassembleProgram(m_dllSupport, pBlob);
   }
 
-  DxilModule &GetDxilModule() {
+  llvm::StringRef GetProgramBitcode(DxilFourCC partKind = DFCC_DXIL) {
     // Make sure we compiled successfully.
-    CComPtr<IDxcBlob> pBlob;
-    CheckOperationSucceeded(pCompileResult, &pBlob);
+    pResultBlob.Release();
+    CheckOperationSucceeded(pCompileResult, &pResultBlob);
     
     // Verify we have a valid dxil container.
     const DxilContainerHeader *pContainer =
-      IsDxilContainerLike(pBlob->GetBufferPointer(), pBlob->GetBufferSize());
+      IsDxilContainerLike(pResultBlob->GetBufferPointer(), pResultBlob->GetBufferSize());
     VERIFY_IS_NOT_NULL(pContainer);
-    VERIFY_IS_TRUE(IsValidDxilContainer(pContainer, pBlob->GetBufferSize()));
+    VERIFY_IS_TRUE(IsValidDxilContainer(pContainer, pResultBlob->GetBufferSize()));
         
-    // Get Dxil part from container.
-    DxilPartIterator it = std::find_if(begin(pContainer), end(pContainer), DxilPartIsType(DFCC_DXIL));
+    // Get the program part from container.
+    DxilPartIterator it = std::find_if(begin(pContainer), end(pContainer), DxilPartIsType(partKind));
     VERIFY_IS_FALSE(it == end(pContainer));
     
     const DxilProgramHeader *pProgramHeader =
@@ -150,10 +162,13 @@ public:
     const char *pIL;
     uint32_t pILLength;
     GetDxilProgramBitcode(pProgramHeader, &pIL, &pILLength);
-      
+    return llvm::StringRef(pIL, pILLength);
+  }
+
+  DxilModule &GetDxilModule() {
     // Parse llvm bitcode into a module.
     std::unique_ptr<llvm::MemoryBuffer> pBitcodeBuf(
-          llvm::MemoryBuffer::getMemBuffer(llvm::StringRef(pIL, pILLength), "", false));
+          llvm::MemoryBuffer::getMemBuffer(GetProgramBitcode(), "", false));
     llvm::ErrorOr<std::unique_ptr<llvm::Module>>
       pModule(llvm::parseBitcodeFile(pBitcodeBuf->getMemBufferRef(), m_llvmContext));
     if (std::error_code ec = pModule.getError()) {
@@ -179,6 +194,7 @@ public:
   CComPtr<IDxcCompiler> pCompiler;
   CComPtr<IDxcBlobEncoding> pCodeBlob;
   CComPtr<IDxcOperationResult> pCompileResult;
+  CComPtr<IDxcBlob> pResultBlob;
   llvm::LLVMContext m_llvmContext;
   std::unique_ptr<llvm::Module> m_module;
   std::unique_ptr<::llvm::sys::fs::MSFileSystem> m_msf;
@@ -620,4 +636,181 @@ TEST_F(DxilModuleTest, PayloadQualifier) {
                            DXIL::PayloadAccessShaderStage::Anyhit));
     }
   }
-}
\ No newline at end of file
+}
+
+TEST_F(DxilModuleTest, LoadWithoutDebugInfo) {
+  std::vector<LPCWSTR> arguments = { L"/Zi", L"/Qembed_debug" };
+  Compiler c(m_dllSupport);
+  c.Compile(
+    "float4 main(float4 a : A, uint n : N) : SV_Target {\n"
+    "  float4 r = 0;\n"
+    "  [loop] for (uint i = 0; i < n; ++i) r += a * i;\n"
+    "  return r;\n"
+    "}\n",
+    L"ps_6_0", arguments, {});
+
+  std::string DiagStr;
+  std::unique_ptr<Module> M = dxilutil::LoadModuleFromBitcodeWithoutDebugInfo(
+      MemoryBuffer::getMemBuffer(
+          c.GetProgramBitcode(DFCC_ShaderDebugInfoDXIL), "", false),
+      c.m_llvmContext, DiagStr);
+  VERIFY_IS_NOT_NULL(M.get());
+  VERIFY_IS_FALSE((bool)M->materializeAll());
+
+  // The program itself is intact: it still loads as a DxilModule and the
+  // IR is well formed.
+  VERIFY_IS_NOT_NULL(M->GetOrCreateDxilModule().GetEntryFunction());
+  VERIFY_IS_FALSE(verifyModule(*M));
+
+  VERIFY_IS_NULL(M->getNamedMetadata("llvm.dbg.cu"));
+  for (Function &F : *M) {
+    for (Instruction &I : inst_range(F)) {
+      VERIFY_IS_FALSE(isa<DbgInfoIntrinsic>(I));
+      VERIFY_IS_FALSE((bool)I.getDebugLoc());
+    }
+  }
+}
+
+TEST_F(DxilModuleTest, PackInterstageSignatures) {
+  const char *interface =
+    "struct VSOut {\n"
+    "  float4 pos : SV_Position;\n"
+    "  float2 uv : TEXCOORD0;\n"
+    "  float3 unused : TEXCOORD1;\n"
+    "  nointerpolation uint id : ID;\n"
+    "};\n";
+  std::string vs = std::string(interface) +
+    "VSOut main(float4 pos : POSITION, float3 n : NORMAL, uint id : ID) {\n"
+    "  VSOut o;\n"
+    "  o.pos = pos;\n"
+    "  o.uv = pos.xy;\n"
+    "  o.unused = n;\n"
+    "  o.id = id;\n"
+    "  return o;\n"
+    "}\n";
+  std::string ps = std::string(interface) +
+    "float4 main(VSOut i) : SV_Target {\n"
+    "  return float4(i.uv, i.id, 1);\n"
+    "}\n";
+
+  Compiler cVS(m_dllSupport);
+  cVS.Compile(vs.c_str(), L"vs_6_0");
+  DxilModule &VS = cVS.GetDxilModule();
+  Compiler cPS(m_dllSupport);
+  cPS.Compile(ps.c_str(), L"ps_6_0");
+  DxilModule &PS = cPS.GetDxilModule();
+
+  VERIFY_IS_TRUE(PackInterstageSignatures(VS, PS,
+                                          DXIL::PackingStrategy::Optimized));
+
+  // TEXCOORD1 is gone from both sides, together with the store that wrote
+  // it and the NORMAL load that fed it.
+  DxilSignature &Outputs = VS.GetOutputSignature();
+  DxilSignature &Inputs = PS.GetInputSignature();
+  VERIFY_ARE_EQUAL(3u, Outputs.GetElements().size());
+  VERIFY_ARE_EQUAL(3u, Inputs.GetElements().size());
+  unsigned NumStores = 0;
+  for (Function &F : *VS.GetModule()) {
+    for (User *U : F.users()) {
+      Instruction *I = cast<Instruction>(U);
+      if (OP::IsDxilOpFuncCallInst(I, OP::OpCode::StoreOutput))
+        ++NumStores;
+      // NORMAL, input 1, is no longer loaded.
+      if (OP::IsDxilOpFuncCallInst(I, OP::OpCode::LoadInput))
+        VERIFY_ARE_NOT_EQUAL(
+            1u, cast<ConstantInt>(I->getOperand(1))->getZExtValue());
+    }
+  }
+  VERIFY_ARE_EQUAL(7u, NumStores);
+
+  for (auto &In : Inputs.GetElements()) {
+    VERIFY_IS_FALSE(In->GetSemanticName().equals_lower("TEXCOORD") &&
+                    In->GetSemanticStartIndex() == 1);
+    bool bFound = false;
+    for (auto &Out : Outputs.GetElements()) {
+      if (Out->GetSemanticName().equals_lower(In->GetSemanticName()) &&
+          Out->GetSemanticStartIndex() == In->GetSemanticStartIndex()) {
+        VERIFY_ARE_EQUAL(Out->GetStartRow(), In->GetStartRow());
+        VERIFY_ARE_EQUAL(Out->GetStartCol(), In->GetStartCol());
+        bFound = true;
+      }
+    }
+    VERIFY_IS_TRUE(bFound);
+  }
+}
+
+TEST_F(DxilModuleTest, EliminateUnreadOutputs) {
+  Compiler cVS(m_dllSupport);
+  cVS.Compile(
+    "struct VSOut {\n"
+    "  float4 pos : SV_Position;\n"
+    "  float4 uv : TEXCOORD0;\n"
+    "  float4 color : COLOR;\n"
+    "};\n"
+    "VSOut main(float4 pos : POSITION, float4 c : COLOR) {\n"
+    "  VSOut o;\n"
+    "  o.pos = pos;\n"
+    "  o.uv = pos * 2;\n"
+    "  o.color = c;\n"
+    "  return o;\n"
+    "}\n",
+    L"vs_6_0");
+  DxilModule &VS = cVS.GetDxilModule();
+  Compiler cPS(m_dllSupport);
+  cPS.Compile(
+    "float4 main(float4 pos : SV_Position, float4 uv : TEXCOORD0) : SV_Target {\n"
+    "  return uv.xyxy;\n"
+    "}\n",
+    L"ps_6_0");
+  DxilModule &PS = cPS.GetDxilModule();
+
+  VERIFY_IS_TRUE(EliminateUnreadOutputs(VS, PS.GetInputSignature()));
+
+  // COLOR is gone, and only TEXCOORD0.xy is still written.
+  DxilSignature &Outputs = VS.GetOutputSignature();
+  VERIFY_ARE_EQUAL(2u, Outputs.GetElements().size());
+  for (auto &Out : Outputs.GetElements()) {
+    VERIFY_IS_FALSE(Out->GetSemanticName().equals_lower("COLOR"));
+    if (Out->GetSemanticName().equals_lower("TEXCOORD"))
+      VERIFY_ARE_EQUAL(0x3u, (unsigned)Out->GetUsageMask());
+  }
+  unsigned NumStores = 0;
+  for (Function &F : *VS.GetModule()) {
+    for (User *U : F.users()) {
+      if (OP::IsDxilOpFuncCallInst(cast<Instruction>(U),
+                                   OP::OpCode::StoreOutput))
+        ++NumStores;
+    }
+  }
+  VERIFY_ARE_EQUAL(6u, NumStores);
+}
+
+TEST_F(DxilModuleTest, OpCallIndex) {
+  Compiler c(m_dllSupport);
+  c.Compile(
+    "float4 main(float4 a : A) : SV_Target {\n"
+    "  return float4(sin(a.x), cos(a.y), sin(a.z), a.w);\n"
+    "}\n");
+  DxilModule &DM = c.GetDxilModule();
+  DxilOpCallIndex &Index = DM.GetOpCallIndex();
+
+  SmallVector<CallInst *, 4> Sins, Coses;
+  Index.GetCalls(OP::OpCode::Sin, Sins);
+  Index.GetCalls(OP::OpCode::Cos, Coses);
+  VERIFY_ARE_EQUAL(2u, Sins.size());
+  VERIFY_ARE_EQUAL(1u, Coses.size());
+  VERIFY_IS_FALSE(Index.HasCalls(OP::OpCode::Tan));
+
+  // Deleted calls drop out, and added calls are found.
+  CallInst *Cos = Coses[0];
+  IRBuilder<> Builder(Cos);
+  Builder.CreateCall(Cos->getCalledFunction(),
+                     {DM.GetOP()->GetU32Const((unsigned)OP::OpCode::Sin),
+                      Cos->getArgOperand(1)});
+  Cos->replaceAllUsesWith(Cos->getArgOperand(1));
+  Cos->eraseFromParent();
+  Sins.clear();
+  Index.GetCalls(OP::OpCode::Sin, Sins);
+  VERIFY_ARE_EQUAL(3u, Sins.size());
+  VERIFY_IS_FALSE(Index.HasCalls(OP::OpCode::Cos));
+}
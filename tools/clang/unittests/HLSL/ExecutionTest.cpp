@@ -273,6 +273,7 @@ public:
 
   TEST_METHOD(OutOfBoundsTest);
   TEST_METHOD(SaturateTest);
+  TEST_METHOD(GpuTimingFlagSetsTest);
   TEST_METHOD(SignTest);
   TEST_METHOD(Int64Test);
   TEST_METHOD(LifetimeIntrinsicTest)
@@ -2947,6 +2948,80 @@ TEST_F(ExecutionTest, OutOfBoundsTest) {
   }
 }
 
+// Compiles a shader op with each of a list of flag sets and logs the GPU time
+// of its Draw/Dispatch call for each, relative to the first. The op, the
+// file it is read from and the flag sets, separated by '|', can be set with
+// the GpuTiming.Name, GpuTiming.File and GpuTiming.FlagSets runtime
+// parameters, e.g. /p:GpuTiming.FlagSets="-O0|-O3|-O3 -enable-16bit-types".
+// Ops without a Timing element run 3 times untimed and then 20 times timed.
+TEST_F(ExecutionTest, GpuTimingFlagSetsTest) {
+  WEX::TestExecution::SetVerifyOutput verifySettings(WEX::TestExecution::VerifyOutputSettings::LogOnlyFailures);
+  WEX::Common::String fileParam, nameParam, flagSetsParam;
+  std::wstring fileName = L"ShaderOpArith.xml";
+  std::string opName = "GpuTiming";
+  std::string flagSets = "-O0|-O3";
+  if (SUCCEEDED(WEX::TestExecution::RuntimeParameters::TryGetValue(L"GpuTiming.File", fileParam)))
+    fileName = (LPCWSTR)fileParam;
+  if (SUCCEEDED(WEX::TestExecution::RuntimeParameters::TryGetValue(L"GpuTiming.Name", nameParam)))
+    opName = CW2A((LPCWSTR)nameParam, CP_UTF8).m_psz;
+  if (SUCCEEDED(WEX::TestExecution::RuntimeParameters::TryGetValue(L"GpuTiming.FlagSets", flagSetsParam)))
+    flagSets = CW2A((LPCWSTR)flagSetsParam, CP_UTF8).m_psz;
+
+  CComPtr<IStream> pStream;
+  ReadHlslDataIntoNewStream(fileName.c_str(), &pStream);
+
+  CComPtr<ID3D12Device> pDevice;
+  if (!CreateDevice(&pDevice))
+    return;
+
+  std::shared_ptr<st::ShaderOpSet> ShaderOpSet =
+      std::make_shared<st::ShaderOpSet>();
+  st::ParseShaderOpSetFromStream(pStream, ShaderOpSet.get());
+  st::ShaderOp *pShaderOp = ShaderOpSet->GetShaderOp(opName.c_str());
+  VERIFY_IS_NOT_NULL(pShaderOp);
+  if (pShaderOp->Timing.Repeat == 0) {
+    pShaderOp->Timing.Warmup = 3;
+    pShaderOp->Timing.Repeat = 20;
+  }
+  std::vector<std::string> baseArguments;
+  for (st::ShaderOpShader &S : pShaderOp->Shaders)
+    baseArguments.push_back(S.Arguments ? S.Arguments : "");
+
+  double baselineMs = 0;
+  size_t begin = 0;
+  while (begin <= flagSets.size()) {
+    size_t end = flagSets.find('|', begin);
+    if (end == std::string::npos)
+      end = flagSets.size();
+    std::string flags = flagSets.substr(begin, end - begin);
+    begin = end + 1;
+
+    for (size_t i = 0; i < pShaderOp->Shaders.size(); ++i) {
+      // Arguments are split on single spaces, so only join non-empty parts.
+      std::string arguments = baseArguments[i];
+      if (!arguments.empty() && !flags.empty())
+        arguments += " ";
+      arguments += flags;
+      pShaderOp->Shaders[i].Arguments =
+          pShaderOp->Strings.insert(arguments.c_str());
+    }
+    std::shared_ptr<ShaderOpTestResult> test = RunShaderOpTestAfterParse(
+        pDevice, m_support, opName.c_str(), nullptr, ShaderOpSet);
+    std::vector<double> timesMs;
+    test->Test->GetGpuTimes(&timesMs);
+    VERIFY_ARE_EQUAL(timesMs.size(), (size_t)pShaderOp->Timing.Repeat);
+
+    std::sort(timesMs.begin(), timesMs.end());
+    double medianMs = timesMs[timesMs.size() / 2];
+    if (baselineMs == 0)
+      baselineMs = medianMs;
+    double deltaPercent =
+        baselineMs == 0 ? 0 : (medianMs - baselineMs) * 100.0 / baselineMs;
+    LogCommentFmt(L"%S: median %.4f ms, min %.4f ms, %+.1f%%", flags.c_str(),
+                  medianMs, timesMs.front(), deltaPercent);
+  }
+}
+
 TEST_F(ExecutionTest, SaturateTest) {
   WEX::TestExecution::SetVerifyOutput verifySettings(WEX::TestExecution::VerifyOutputSettings::LogOnlyFailures);
   CComPtr<IStream> pStream;
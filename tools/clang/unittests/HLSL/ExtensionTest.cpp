@@ -544,6 +544,7 @@ public:
   TEST_METHOD(IntrinsicWhenAvailableThenUsed)
   TEST_METHOD(CustomIntrinsicName)
   TEST_METHOD(NoLowering)
+  TEST_METHOD(LoweredDeclarationSharedAcrossCalls)
   TEST_METHOD(PackedLowering)
   TEST_METHOD(ReplicateLoweringWhenOnlyVectorIsResult)
   TEST_METHOD(UnsignedOpcodeIsUnchanged)
@@ -1183,6 +1184,39 @@ TEST_F(ExtensionTest, NoLowering) {
     disassembly.find("call <2 x i32> @test_nolower.i32(i32 5, <2 x i32>"));
 }
 
+TEST_F(ExtensionTest, LoweredDeclarationSharedAcrossCalls) {
+  Compiler c(m_dllSupport);
+  c.RegisterIntrinsicTable(new TestIntrinsicTable());
+  c.Compile(
+    "float2 main(float2 v : V, float2 w : W, int2 i : I) : SV_Target {\n"
+    "  float2 a = test_poly(v);\n"
+    "  float2 b = test_poly(w);\n"
+    "  int2   c = test_poly(i);\n"
+    "  float2 d = test_pack_2(v, w);\n"
+    "  float2 e = test_pack_2(w, v);\n"
+    "  return a + b + c + d + e;\n"
+    "}\n",
+    { L"/Vd" }, {}
+  );
+  std::string disassembly = c.Disassemble();
+
+  auto count = [&](const char *text) {
+    size_t n = 0;
+    for (size_t pos = disassembly.find(text); pos != disassembly.npos;
+         pos = disassembly.find(text, pos + 1))
+      ++n;
+    return n;
+  };
+
+  // - every call with the same extension signature uses one declaration
+  VERIFY_ARE_EQUAL(4u, count("call float @test_poly.float(i32 3, float"));
+  VERIFY_ARE_EQUAL(1u, count("declare float @test_poly.float("));
+  VERIFY_ARE_EQUAL(2u, count("call i32 @test_poly.i32(i32 3, i32"));
+  VERIFY_ARE_EQUAL(1u, count("declare i32 @test_poly.i32("));
+  VERIFY_ARE_EQUAL(2u, count("call { float, float } @test_pack_2.float(i32 8, { float, float }"));
+  VERIFY_ARE_EQUAL(1u, count("declare { float, float } @test_pack_2.float("));
+}
+
 TEST_F(ExtensionTest, PackedLowering) {
   Compiler c(m_dllSupport);
   c.RegisterIntrinsicTable(new TestIntrinsicTable());
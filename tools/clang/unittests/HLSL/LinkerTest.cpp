@@ -42,6 +42,7 @@ public:
   TEST_METHOD(RunLinkResource);
   TEST_METHOD(RunLinkResourceWithBinding);
   TEST_METHOD(RunLinkAllProfiles);
+  TEST_METHOD(RunLinkBatch);
   TEST_METHOD(RunLinkFailNoDefine);
   TEST_METHOD(RunLinkFailReDefine);
   TEST_METHOD(RunLinkGlobalInit);
@@ -52,7 +53,9 @@ public:
   TEST_METHOD(RunLinkResRet);
   TEST_METHOD(RunLinkToLib);
   TEST_METHOD(RunLinkToLibExport);
+  TEST_METHOD(RunLinkToLibSpecializeConstantArgs);
   TEST_METHOD(RunLinkToLibExportShadersOnly);
+  TEST_METHOD(RunLinkToLibExportRemovesUnusedResources);
   TEST_METHOD(RunLinkFailReDefineGlobal);
   TEST_METHOD(RunLinkFailProfileMismatch);
   TEST_METHOD(RunLinkFailEntryNoProps);
@@ -272,6 +275,50 @@ TEST_F(LinkerTest, RunLinkAllProfiles) {
   Link(L"cs_main", L"cs_6_0", pLinker, {libName, libResName}, {},{});
 }
 
+TEST_F(LinkerTest, RunLinkBatch) {
+  CComPtr<IDxcLinker> pLinker;
+  CreateLinker(&pLinker);
+  CComPtr<IDxcLinker2> pLinker2;
+  VERIFY_SUCCEEDED(pLinker.QueryInterface(&pLinker2));
+
+  LPCWSTR libName = L"entry";
+  CComPtr<IDxcBlob> pEntryLib;
+  CompileLib(L"..\\CodeGenHLSL\\lib_entries2.hlsl", &pEntryLib);
+  RegisterDxcModule(libName, pEntryLib, pLinker);
+
+  DxcLinkJob jobs[] = {
+    { L"vs_main", L"vs_6_0", nullptr, 0 },
+    { L"hs_main", L"hs_6_0", nullptr, 0 },
+    { L"ds_main", L"ds_6_0", nullptr, 0 },
+    { L"gs_main", L"gs_6_0", nullptr, 0 },
+    { L"ps_main", L"ps_6_0", nullptr, 0 },
+  };
+  const UINT32 jobCount = _countof(jobs);
+  IDxcOperationResult *pResults[jobCount];
+  VERIFY_SUCCEEDED(pLinker2->LinkBatch(jobs, jobCount, &libName, 1, pResults));
+
+  CComPtr<IDxcCompiler> pCompiler;
+  VERIFY_SUCCEEDED(m_dllSupport.CreateInstance(CLSID_DxcCompiler, &pCompiler));
+  for (UINT32 i = 0; i < jobCount; ++i) {
+    CComPtr<IDxcOperationResult> pResult;
+    pResult.Attach(pResults[i]);
+    CComPtr<IDxcBlob> pProgram;
+    CheckOperationSucceeded(pResult, &pProgram);
+
+    // Each batch result matches linking the job on its own.
+    CComPtr<IDxcOperationResult> pSingleResult;
+    VERIFY_SUCCEEDED(pLinker->Link(jobs[i].pEntryName, jobs[i].pTargetProfile,
+                                   &libName, 1, nullptr, 0, &pSingleResult));
+    CComPtr<IDxcBlob> pSingleProgram;
+    CheckOperationSucceeded(pSingleResult, &pSingleProgram);
+
+    CComPtr<IDxcBlobEncoding> pDisassembly, pSingleDisassembly;
+    VERIFY_SUCCEEDED(pCompiler->Disassemble(pProgram, &pDisassembly));
+    VERIFY_SUCCEEDED(pCompiler->Disassemble(pSingleProgram, &pSingleDisassembly));
+    VERIFY_ARE_EQUAL(BlobToUtf8(pSingleDisassembly), BlobToUtf8(pDisassembly));
+  }
+}
+
 TEST_F(LinkerTest, RunLinkFailNoDefine) {
   CComPtr<IDxcBlob> pEntryLib;
   CompileLib(L"..\\CodeGenHLSL\\lib_cs_entry.hlsl", &pEntryLib);
@@ -483,6 +530,31 @@ TEST_F(LinkerTest, RunLinkToLib) {
   Link(L"", L"lib_6_3", pLinker, {libName, libName2}, {"!llvm.dbg.cu"}, {}, option);
 }
 
+TEST_F(LinkerTest, RunLinkToLibSpecializeConstantArgs) {
+  CComPtr<IDxcBlob> pCallerLib;
+  CompileLib(L"..\\CodeGenHLSL\\linker\\lib_const_arg_caller.hlsl",
+             &pCallerLib);
+  CComPtr<IDxcBlob> pCalleeLib;
+  CompileLib(L"..\\CodeGenHLSL\\linker\\lib_const_arg_callee.hlsl",
+             &pCalleeLib);
+
+  CComPtr<IDxcLinker> pLinker;
+  CreateLinker(&pLinker);
+
+  LPCWSTR libName = L"caller";
+  RegisterDxcModule(libName, pCallerLib, pLinker);
+
+  LPCWSTR libName2 = L"callee";
+  RegisterDxcModule(libName2, pCalleeLib, pLinker);
+
+  // Both calls go to one copy for mode 1, and the exported original stays.
+  Link(L"", L"lib_6_3", pLinker, {libName, libName2},
+       {"define internal float @\"\\01?shade@@YAMMI@Z.spec\"",
+        "call float @\"\\01?shade@@YAMMI@Z.spec\"",
+        "define float @\"\\01?shade@@YAMMI@Z\""},
+       {"shade@@YAMMI@Z.spec1"});
+}
+
 TEST_F(LinkerTest, RunLinkToLibExport) {
   CComPtr<IDxcBlob> pEntryLib;
   CompileLib(L"..\\CodeGenHLSL\\linker\\lib_mat_entry2.hlsl",
@@ -505,6 +577,21 @@ TEST_F(LinkerTest, RunLinkToLibExport) {
     {L"-exports", L"renamed_test,cloned_test=\\01?mat_test@@YA?AV?$vector@M$02@@V?$vector@M$03@@0AIAV?$matrix@M$03$02@@@Z;main"});
 }
 
+TEST_F(LinkerTest, RunLinkToLibExportRemovesUnusedResources) {
+  CComPtr<IDxcBlob> pLib;
+  CompileLib(L"..\\CodeGenHLSL\\linker\\lib_export_resources.hlsl", &pLib);
+
+  CComPtr<IDxcLinker> pLinker;
+  CreateLinker(&pLinker);
+
+  LPCWSTR libName = L"lib";
+  RegisterDxcModule(libName, pLib, pLinker);
+
+  // The buffer only the unexported function wrote is gone.
+  Link(L"", L"lib_6_3", pLinker, {libName}, {"KeptBuf", "Params"},
+       {"DroppedBuf"}, {L"-exports", L"keep"});
+}
+
 TEST_F(LinkerTest, RunLinkToLibExportShadersOnly) {
   CComPtr<IDxcBlob> pEntryLib;
   CompileLib(L"..\\CodeGenHLSL\\linker\\lib_mat_entry2.hlsl",
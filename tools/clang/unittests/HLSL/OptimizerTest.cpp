@@ -20,6 +20,7 @@
 #include <cassert>
 #include <sstream>
 #include <algorithm>
+#include <thread>
 #include "dxc/DxilContainer/DxilContainer.h"
 #include "dxc/Support/WinIncludes.h"
 #include "dxc/dxcapi.h"
@@ -66,6 +67,8 @@ public:
   TEST_METHOD(OptimizerWhenSlice2ThenOK)
   TEST_METHOD(OptimizerWhenSlice3ThenOK)
   TEST_METHOD(OptimizerWhenSliceWithIntermediateOptionsThenOK)
+  TEST_METHOD(OptimizerSessionWhenRunTwiceThenMatchesRunOptimizer)
+  TEST_METHOD(OptimizerPipelineWhenRunConcurrentlyThenMatchesRunOptimizer)
 
   void OptimizerWhenSliceNThenOK(int optLevel);
   void OptimizerWhenSliceNThenOK(int optLevel, LPCSTR pText, LPCWSTR pTarget, llvm::ArrayRef<LPCWSTR> args = {});
@@ -81,6 +84,23 @@ public:
     return m_dllSupport.CreateInstance(CLSID_DxcContainerBuilder, ppResult);
   }
 
+  // The optimizer takes a DXIL program, not the container it comes in.
+  void GetDxilProgram(IDxcBlob *pContainer, IDxcBlob **ppProgram) {
+    const hlsl::DxilContainerHeader *pHeader =
+        hlsl::IsDxilContainerLike(pContainer->GetBufferPointer(),
+                                  pContainer->GetBufferSize());
+    VERIFY_IS_NOT_NULL(pHeader);
+    const hlsl::DxilPartHeader *pPart =
+        hlsl::GetDxilPartByType(pHeader, hlsl::DFCC_DXIL);
+    VERIFY_IS_NOT_NULL(pPart);
+    CComPtr<IDxcLibrary> pLibrary;
+    CComPtr<IDxcBlobEncoding> pProgram;
+    VERIFY_SUCCEEDED(m_dllSupport.CreateInstance(CLSID_DxcLibrary, &pLibrary));
+    VERIFY_SUCCEEDED(pLibrary->CreateBlobWithEncodingOnHeapCopy(
+        hlsl::GetDxilPartData(pPart), pPart->PartSize, CP_ACP, &pProgram));
+    *ppProgram = pProgram.Detach();
+  }
+
   void VerifyOperationSucceeded(IDxcOperationResult *pResult) {
     HRESULT result;
     VERIFY_SUCCEEDED(pResult->GetStatus(&result));
@@ -120,6 +140,142 @@ TEST_F(OptimizerTest, OptimizerWhenSliceWithIntermediateOptionsThenOK) {
   OptimizerWhenSliceNThenOK(1, SampleProgram, L"ps_6_0", { L"-flegacy-resource-reservation" });
 }
 
+TEST_F(OptimizerTest, OptimizerSessionWhenRunTwiceThenMatchesRunOptimizer) {
+  LPCSTR SampleProgram =
+    "RWBuffer<float> g_Out;\r\n"
+    "[numthreads(8, 1, 1)]\r\n"
+    "void main(uint id : SV_DispatchThreadID) {\r\n"
+    "  g_Out[id] = id * 2.0f;\r\n"
+    "}";
+  CComPtr<IDxcCompiler> pCompiler;
+  CComPtr<IDxcOptimizer> pOptimizer;
+  CComPtr<IDxcOptimizer2> pOptimizer2;
+  CComPtr<IDxcOptimizerSession> pSession;
+  CComPtr<IDxcOperationResult> pResult;
+  CComPtr<IDxcBlobEncoding> pSource;
+  CComPtr<IDxcBlob> pContainer;
+  CComPtr<IDxcBlob> pProgram;
+
+  VERIFY_SUCCEEDED(CreateCompiler(&pCompiler));
+  Utf8ToBlob(m_dllSupport, SampleProgram, &pSource);
+  LPCWSTR args[] = { L"/Od", L"/Zi" };
+  VERIFY_SUCCEEDED(pCompiler->Compile(pSource, L"source.hlsl", L"main",
+    L"cs_6_0", args, _countof(args), nullptr, 0, nullptr, &pResult));
+  VerifyOperationSucceeded(pResult);
+  VERIFY_SUCCEEDED(pResult->GetResult(&pContainer));
+  GetDxilProgram(pContainer, &pProgram);
+
+  VERIFY_SUCCEEDED(m_dllSupport.CreateInstance(CLSID_DxcOptimizer, &pOptimizer));
+  VERIFY_SUCCEEDED(pOptimizer.QueryInterface(&pOptimizer2));
+  VERIFY_SUCCEEDED(pOptimizer2->CreateSession(pProgram, &pSession));
+
+  // The annotation prefix is shared between the two runs; the second one
+  // must still see an unmodified module.
+  LPCWSTR passes[] = { L"-dxil-annotate-with-virtual-regs",
+                       L"-hlsl-dxil-pix-block-counters", L"-S" };
+  LPCWSTR sampledPasses[] = { L"-dxil-annotate-with-virtual-regs",
+                              L"-hlsl-dxil-pix-block-counters,sampleRate=4",
+                              L"-S" };
+  std::string expected[2];
+  std::string actual[2];
+  LPCWSTR *passLists[2] = { passes, sampledPasses };
+  UINT32 passCounts[2] = { _countof(passes), _countof(sampledPasses) };
+  for (int i = 0; i < 2; ++i) {
+    CComPtr<IDxcBlob> pModule;
+    CComPtr<IDxcBlobEncoding> pText;
+    VERIFY_SUCCEEDED(pOptimizer->RunOptimizer(pProgram, passLists[i],
+      passCounts[i], &pModule, &pText));
+    expected[i] = BlobToUtf8(pText);
+  }
+  for (int run = 0; run < 2; ++run) {
+    for (int i = 0; i < 2; ++i) {
+      CComPtr<IDxcBlob> pModule;
+      CComPtr<IDxcBlobEncoding> pText;
+      VERIFY_SUCCEEDED(pSession->RunOptimizer(passLists[i], passCounts[i],
+        &pModule, &pText));
+      actual[i] = BlobToUtf8(pText);
+      VERIFY_ARE_EQUAL(expected[i], actual[i]);
+    }
+  }
+}
+
+TEST_F(OptimizerTest, OptimizerPipelineWhenRunConcurrentlyThenMatchesRunOptimizer) {
+  LPCSTR SamplePrograms[] = {
+    "RWBuffer<float> g_Out;\r\n"
+    "[numthreads(8, 1, 1)]\r\n"
+    "void main(uint id : SV_DispatchThreadID) {\r\n"
+    "  g_Out[id] = id * 2.0f;\r\n"
+    "}",
+    "RWBuffer<float> g_Out;\r\n"
+    "[numthreads(8, 1, 1)]\r\n"
+    "void main(uint id : SV_DispatchThreadID) {\r\n"
+    "  if (id > 3) g_Out[id] = id;\r\n"
+    "}",
+  };
+  const int programCount = _countof(SamplePrograms);
+  CComPtr<IDxcCompiler> pCompiler;
+  CComPtr<IDxcOptimizer> pOptimizer;
+  CComPtr<IDxcOptimizer3> pOptimizer3;
+  CComPtr<IDxcOptimizerPipeline> pPipeline;
+  CComPtr<IDxcBlob> pPrograms[programCount];
+
+  VERIFY_SUCCEEDED(CreateCompiler(&pCompiler));
+  for (int i = 0; i < programCount; ++i) {
+    CComPtr<IDxcOperationResult> pResult;
+    CComPtr<IDxcBlobEncoding> pSource;
+    CComPtr<IDxcBlob> pContainer;
+    Utf8ToBlob(m_dllSupport, SamplePrograms[i], &pSource);
+    LPCWSTR args[] = { L"/Od", L"/Zi" };
+    VERIFY_SUCCEEDED(pCompiler->Compile(pSource, L"source.hlsl", L"main",
+      L"cs_6_0", args, _countof(args), nullptr, 0, nullptr, &pResult));
+    VerifyOperationSucceeded(pResult);
+    VERIFY_SUCCEEDED(pResult->GetResult(&pContainer));
+    GetDxilProgram(pContainer, &pPrograms[i]);
+  }
+
+  VERIFY_SUCCEEDED(m_dllSupport.CreateInstance(CLSID_DxcOptimizer, &pOptimizer));
+  VERIFY_SUCCEEDED(pOptimizer.QueryInterface(&pOptimizer3));
+
+  // Unknown passes are rejected when the pipeline is created.
+  LPCWSTR badPasses[] = { L"-not-a-pass" };
+  VERIFY_ARE_EQUAL(E_INVALIDARG, pOptimizer3->CreatePipeline(
+    badPasses, _countof(badPasses), &pPipeline));
+  VERIFY_IS_NULL(pPipeline.p);
+
+  LPCWSTR passes[] = { L"-dxil-annotate-with-virtual-regs",
+                       L"-hlsl-dxil-pix-block-counters,sampleRate=4", L"-S" };
+  VERIFY_SUCCEEDED(pOptimizer3->CreatePipeline(passes, _countof(passes),
+                                               &pPipeline));
+
+  std::string expected[programCount];
+  for (int i = 0; i < programCount; ++i) {
+    CComPtr<IDxcBlob> pModule;
+    CComPtr<IDxcBlobEncoding> pText;
+    VERIFY_SUCCEEDED(pOptimizer->RunOptimizer(pPrograms[i], passes,
+      _countof(passes), &pModule, &pText));
+    expected[i] = BlobToUtf8(pText);
+  }
+
+  HRESULT hr[programCount];
+  std::string actual[programCount];
+  std::vector<std::thread> threads;
+  for (int i = 0; i < programCount; ++i) {
+    threads.emplace_back([&, i]() {
+      CComPtr<IDxcBlob> pModule;
+      CComPtr<IDxcBlobEncoding> pText;
+      hr[i] = pPipeline->RunOptimizer(pPrograms[i], &pModule, &pText);
+      if (SUCCEEDED(hr[i]))
+        actual[i] = BlobToUtf8(pText);
+    });
+  }
+  for (std::thread &thread : threads)
+    thread.join();
+  for (int i = 0; i < programCount; ++i) {
+    VERIFY_SUCCEEDED(hr[i]);
+    VERIFY_ARE_EQUAL(expected[i], actual[i]);
+  }
+}
+
 void OptimizerTest::OptimizerWhenSliceNThenOK(int optLevel) {
   LPCSTR SampleProgram =
     "Texture2D g_Tex;\r\n"
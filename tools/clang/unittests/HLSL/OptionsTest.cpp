@@ -69,6 +69,10 @@ public:
   TEST_METHOD(ReadOptionsWhenJoinedThenOK)
   TEST_METHOD(ReadOptionsWhenNoEntryThenOK)
   TEST_METHOD(ReadOptionsForOutputObject)
+  TEST_METHOD(ReadOptionsForDeadline)
+  TEST_METHOD(ReadOptionsForOdev)
+  TEST_METHOD(ReadOptionsForZiLines)
+  TEST_METHOD(ReadOptionsForSpecializeCBuffer)
 
   TEST_METHOD(ReadOptionsForDxcWhenApiArgMissingThenFail)
   TEST_METHOD(ReadOptionsForApiWhenApiArgMissingThenOK)
@@ -136,6 +140,96 @@ TEST_F(OptionsTest, ReadOptionsForOutputObject) {
   VERIFY_ARE_EQUAL_STR("hlsl.dxbc", o->OutputObject.data());  
 }
 
+TEST_F(OptionsTest, ReadOptionsForDeadline) {
+  const wchar_t *Args[] = {L"exe.exe", L"/E", L"main", L"/T", L"ps_6_0",
+                           L"hlsl.hlsl", L"-Qdeadline", L"250"};
+  MainArgsArr ArgsArr(Args);
+  std::unique_ptr<DxcOpts> o = ReadOptsTest(ArgsArr, DxcFlags);
+  VERIFY_ARE_EQUAL(250u, o->DeadlineMs);
+
+  const wchar_t *ArgsZero[] = {L"exe.exe", L"/E", L"main", L"/T", L"ps_6_0",
+                               L"hlsl.hlsl", L"-Qdeadline", L"0"};
+  MainArgsArr ArgsZeroArr(ArgsZero);
+  ReadOptsTest(ArgsZeroArr, DxcFlags, true, true);
+}
+
+TEST_F(OptionsTest, ReadOptionsForOdev) {
+  const wchar_t *Args[] = {L"exe.exe", L"/E", L"main", L"/T", L"ps_6_0",
+                           L"hlsl.hlsl", L"-Odev"};
+  MainArgsArr ArgsArr(Args);
+  std::unique_ptr<DxcOpts> o = ReadOptsTest(ArgsArr, DxcFlags);
+  VERIFY_IS_TRUE(o->FastDevBuild);
+  VERIFY_IS_TRUE(o->DisableOptimizations);
+  VERIFY_ARE_EQUAL(0u, o->OptLevel);
+  VERIFY_IS_FALSE(o->DxcOptimizationToggles.at("debug-nops"));
+  VERIFY_IS_TRUE(o->StripReflection);
+  VERIFY_IS_TRUE(o->KeepReflectionInDxil);
+
+  // Reflection and debug nops that are asked for are kept.
+  const wchar_t *ArgsAsked[] = {L"exe.exe", L"/E", L"main", L"/T", L"ps_6_0",
+                                L"hlsl.hlsl", L"-Odev", L"-Fre", L"hlsl.refl",
+                                L"-opt-enable", L"debug-nops"};
+  MainArgsArr ArgsAskedArr(ArgsAsked);
+  o = ReadOptsTest(ArgsAskedArr, DxcFlags);
+  VERIFY_IS_TRUE(o->FastDevBuild);
+  VERIFY_IS_TRUE(o->DxcOptimizationToggles.at("debug-nops"));
+  VERIFY_IS_FALSE(o->StripReflection);
+  VERIFY_IS_FALSE(o->KeepReflectionInDxil);
+
+  // A later optimization level overrides -Odev.
+  const wchar_t *ArgsO3[] = {L"exe.exe", L"/E", L"main", L"/T", L"ps_6_0",
+                             L"hlsl.hlsl", L"-Odev", L"-O3"};
+  MainArgsArr ArgsO3Arr(ArgsO3);
+  o = ReadOptsTest(ArgsO3Arr, DxcFlags);
+  VERIFY_IS_FALSE(o->FastDevBuild);
+  VERIFY_ARE_EQUAL(3u, o->OptLevel);
+}
+
+TEST_F(OptionsTest, ReadOptionsForZiLines) {
+  const wchar_t *Args[] = {L"exe.exe", L"/E", L"main", L"/T", L"ps_6_0",
+                           L"hlsl.hlsl", L"-Zi-lines"};
+  MainArgsArr ArgsArr(Args);
+  std::unique_ptr<DxcOpts> o = ReadOptsTest(ArgsArr, DxcFlags);
+  VERIFY_IS_TRUE(o->DebugLineTablesOnly);
+  VERIFY_IS_TRUE(o->GenerateFullDebugInfo());
+
+  const wchar_t *ArgsZi[] = {L"exe.exe", L"/E", L"main", L"/T", L"ps_6_0",
+                             L"hlsl.hlsl", L"-Zi"};
+  MainArgsArr ArgsZiArr(ArgsZi);
+  o = ReadOptsTest(ArgsZiArr, DxcFlags);
+  VERIFY_IS_FALSE(o->DebugLineTablesOnly);
+  VERIFY_IS_TRUE(o->GenerateFullDebugInfo());
+
+  const wchar_t *ArgsZs[] = {L"exe.exe", L"/E", L"main", L"/T", L"ps_6_0",
+                             L"hlsl.hlsl", L"-Zi-lines", L"-Zs"};
+  MainArgsArr ArgsZsArr(ArgsZs);
+  ReadOptsTest(ArgsZsArr, DxcFlags, true, true);
+}
+
+TEST_F(OptionsTest, ReadOptionsForSpecializeCBuffer) {
+  const wchar_t *Args[] = {L"exe.exe", L"/E", L"main", L"/T", L"ps_6_0",
+                           L"hlsl.hlsl",
+                           L"-specialize-cbuffer", L"Material.Mode=2",
+                           L"-specialize-cbufferMaterial.Tint=1,0.5,0"};
+  MainArgsArr ArgsArr(Args);
+  std::unique_ptr<DxcOpts> o = ReadOptsTest(ArgsArr, DxcFlags);
+  VERIFY_ARE_EQUAL(2u, o->SpecializedCBufferValues.size());
+  VERIFY_ARE_EQUAL_STR("2", o->SpecializedCBufferValues.at("Material.Mode").c_str());
+  VERIFY_ARE_EQUAL_STR("1,0.5,0", o->SpecializedCBufferValues.at("Material.Tint").c_str());
+
+  const wchar_t *ArgsNoField[] = {L"exe.exe", L"/E", L"main", L"/T", L"ps_6_0",
+                                  L"hlsl.hlsl", L"-specialize-cbuffer", L"Mode=2"};
+  MainArgsArr ArgsNoFieldArr(ArgsNoField);
+  ReadOptsTest(ArgsNoFieldArr, DxcFlags, true, true);
+
+  const wchar_t *ArgsConflict[] = {L"exe.exe", L"/E", L"main", L"/T", L"ps_6_0",
+                                   L"hlsl.hlsl",
+                                   L"-specialize-cbuffer", L"Material.Mode=2",
+                                   L"-specialize-cbuffer", L"Material.Mode=3"};
+  MainArgsArr ArgsConflictArr(ArgsConflict);
+  ReadOptsTest(ArgsConflictArr, DxcFlags, true, true);
+}
+
 TEST_F(OptionsTest, ReadOptionsConflict) {
   const wchar_t *matrixArgs[] = {
       L"exe.exe",   L"/E",        L"main",    L"/T",           L"ps_6_0",
@@ -88,6 +88,7 @@ public:
   TEST_METHOD(RunKeepUserMacro);
   TEST_METHOD(RunExtractUniforms);
   TEST_METHOD(RunGlobalsUsedInMethod);
+  TEST_METHOD(RunRemoveUnusedGlobalsBatch);
   TEST_METHOD(RunRewriterFails)
 
   dxc::DxcDllSupport m_dllSupport;
@@ -746,3 +747,50 @@ TEST_F(RewriterTest, RunRewriterFails) {
 
   VERIFY_IS_TRUE(errorStr.find(L"Length is only allowed for HLSL 2016 and lower.") >= 0);
 }
+
+TEST_F(RewriterTest, RunRemoveUnusedGlobalsBatch) {
+  CComPtr<IDxcRewriter> pRewriter;
+  CComPtr<IDxcRewriter3> pRewriter3;
+  VERIFY_SUCCEEDED(CreateRewriter(&pRewriter));
+  VERIFY_SUCCEEDED(pRewriter->QueryInterface(&pRewriter3));
+
+  const char source[] =
+      "float4 ga; float4 gb;\n"
+      "float4 useA() { return ga; }\n"
+      "float4 mainA() : SV_Target { return useA(); }\n"
+      "float4 mainB() : SV_Target { return gb; }\n";
+  CComPtr<IDxcBlobEncoding> pSource;
+  CreateBlobPinned(source, sizeof(source) - 1, CP_UTF8, &pSource);
+
+  LPCWSTR entryPoints[] = {L"mainA", L"mainB", L"missing"};
+  CComPtr<IDxcOperationResult> pResults[_countof(entryPoints)];
+  VERIFY_SUCCEEDED(pRewriter3->RemoveUnusedGlobalsBatch(
+      pSource, entryPoints, _countof(entryPoints), nullptr, 0,
+      &pResults[0].p));
+
+  std::string rewrites[_countof(entryPoints)];
+  for (unsigned i = 0; i < _countof(entryPoints); ++i) {
+    HRESULT hrStatus;
+    VERIFY_SUCCEEDED(pResults[i]->GetStatus(&hrStatus));
+    if (i == 2) {
+      VERIFY_FAILED(hrStatus);
+      continue;
+    }
+    VERIFY_SUCCEEDED(hrStatus);
+    CComPtr<IDxcBlob> pResult;
+    VERIFY_SUCCEEDED(pResults[i]->GetResult(&pResult));
+    rewrites[i] = BlobToUtf8(pResult);
+  }
+  VERIFY_IS_TRUE(rewrites[0].find("ga") != std::string::npos);
+  VERIFY_IS_TRUE(rewrites[0].find("gb") == std::string::npos);
+  VERIFY_IS_TRUE(rewrites[1].find("gb") != std::string::npos);
+  VERIFY_IS_TRUE(rewrites[1].find("ga") == std::string::npos);
+
+  // The same source again reuses the parse and gives the same result.
+  CComPtr<IDxcOperationResult> pSingleResult;
+  VERIFY_SUCCEEDED(pRewriter->RemoveUnusedGlobals(pSource, L"mainA", nullptr,
+                                                  0, &pSingleResult));
+  CComPtr<IDxcBlob> pSingle;
+  VERIFY_SUCCEEDED(pSingleResult->GetResult(&pSingle));
+  VERIFY_ARE_EQUAL(rewrites[0], BlobToUtf8(pSingle));
+}
@@ -357,6 +357,14 @@ void ShaderOpTest::CreateDescriptorHeaps() {
   queryHeapDesc.Count = 1;
   queryHeapDesc.Type = D3D12_QUERY_HEAP_TYPE_PIPELINE_STATISTICS;
   CHECK_HR(m_pDevice->CreateQueryHeap(&queryHeapDesc, IID_PPV_ARGS(&m_pQueryHeap)));
+
+  // Create timestamp query heap, with a pair of queries per timed run.
+  if (m_pShaderOp->Timing.Repeat != 0) {
+    ZeroMemory(&queryHeapDesc, sizeof(queryHeapDesc));
+    queryHeapDesc.Count = m_pShaderOp->Timing.Repeat * 2;
+    queryHeapDesc.Type = D3D12_QUERY_HEAP_TYPE_TIMESTAMP;
+    CHECK_HR(m_pDevice->CreateQueryHeap(&queryHeapDesc, IID_PPV_ARGS(&m_pTimestampHeap)));
+  }
 }
 
 void ShaderOpTest::CreateDevice() {
@@ -683,6 +691,18 @@ void ShaderOpTest::CreateResources() {
     SetObjectName(m_pQueryBuffer, "Query Pipeline Readback Buffer");
   }
 
+  // Create a buffer to receive timestamps.
+  if (m_pShaderOp->Timing.Repeat != 0) {
+    CD3DX12_HEAP_PROPERTIES readback(D3D12_HEAP_TYPE_READBACK);
+    CD3DX12_RESOURCE_DESC readbackDesc(CD3DX12_RESOURCE_DESC::Buffer(
+        m_pShaderOp->Timing.Repeat * 2 * sizeof(UINT64)));
+    CHECK_HR(m_pDevice->CreateCommittedResource(
+      &readback, D3D12_HEAP_FLAG_NONE, &readbackDesc,
+      D3D12_RESOURCE_STATE_COPY_DEST, nullptr,
+      IID_PPV_ARGS(&m_pTimestampBuffer)));
+    SetObjectName(m_pTimestampBuffer, "Query Timestamp Readback Buffer");
+  }
+
   CHECK_HR(pList->Close());
   ExecuteCommandList(ResCommandList.Queue, pList);
   WaitForSignal(ResCommandList.Queue, m_pFence, m_hFence, m_FenceValue++);
@@ -822,6 +842,22 @@ void ShaderOpTest::GetPipelineStats(D3D12_QUERY_DATA_PIPELINE_STATISTICS *pStats
   memcpy(pStats, M.data(), sizeof(*pStats));
 }
 
+void ShaderOpTest::GetGpuTimes(std::vector<double> *pTimesMs) {
+  pTimesMs->clear();
+  UINT repeat = m_pShaderOp->Timing.Repeat;
+  if (repeat == 0)
+    return;
+  UINT64 frequency;
+  CHECK_HR(m_CommandList.Queue->GetTimestampFrequency(&frequency));
+  MappedData M;
+  M.reset(m_pTimestampBuffer, repeat * 2 * sizeof(UINT64));
+  const UINT64 *pStamps = (const UINT64 *)M.data();
+  for (UINT i = 0; i < repeat; ++i) {
+    pTimesMs->push_back((double)(pStamps[i * 2 + 1] - pStamps[i * 2]) *
+                        1000.0 / (double)frequency);
+  }
+}
+
 void ShaderOpTest::GetReadBackData(LPCSTR pResourceName, MappedData *pData) {
   pResourceName = m_pShaderOp->Strings.insert(pResourceName); // Unique
   ShaderOpResourceData &D = m_ResourceData.at(pResourceName);
@@ -844,6 +880,31 @@ static void SetDescriptorHeaps(ID3D12GraphicsCommandList *pList,
     pList->SetDescriptorHeaps((UINT)localHeaps.size(), localHeaps.data());
 }
 
+void ShaderOpTest::RecordTimedRuns(ID3D12GraphicsCommandList *pList,
+                                   const std::function<void()> &recordRun) {
+  const ShaderOpTiming &T = m_pShaderOp->Timing;
+  if (T.Repeat == 0) {
+    recordRun();
+    return;
+  }
+  for (UINT i = 0; i < T.Warmup + T.Repeat; ++i) {
+    if (i != 0) {
+      // Keep runs from overlapping on the GPU.
+      CD3DX12_RESOURCE_BARRIER barrier = CD3DX12_RESOURCE_BARRIER::UAV(nullptr);
+      pList->ResourceBarrier(1, &barrier);
+    }
+    bool timed = i >= T.Warmup;
+    UINT query = (i - T.Warmup) * 2;
+    if (timed)
+      pList->EndQuery(m_pTimestampHeap, D3D12_QUERY_TYPE_TIMESTAMP, query);
+    recordRun();
+    if (timed)
+      pList->EndQuery(m_pTimestampHeap, D3D12_QUERY_TYPE_TIMESTAMP, query + 1);
+  }
+  pList->ResolveQueryData(m_pTimestampHeap, D3D12_QUERY_TYPE_TIMESTAMP, 0,
+                          T.Repeat * 2, m_pTimestampBuffer, 0);
+}
+
 void ShaderOpTest::RunCommandList() {
   ID3D12GraphicsCommandList *pList = m_CommandList.List.p;
   if (m_pShaderOp->IsCompute()) {
@@ -851,8 +912,10 @@ void ShaderOpTest::RunCommandList() {
     pList->SetComputeRootSignature(m_pRootSignature);
     SetDescriptorHeaps(pList, m_DescriptorHeaps);
     SetRootValues(pList, m_pShaderOp->IsCompute());
-    pList->Dispatch(m_pShaderOp->DispatchX, m_pShaderOp->DispatchY,
-                    m_pShaderOp->DispatchZ);
+    RecordTimedRuns(pList, [&]() {
+      pList->Dispatch(m_pShaderOp->DispatchX, m_pShaderOp->DispatchY,
+                      m_pShaderOp->DispatchZ);
+    });
   } else {
     pList->SetPipelineState(m_pPSO);
     pList->SetGraphicsRootSignature(m_pRootSignature);
@@ -909,7 +972,7 @@ void ShaderOpTest::RunCommandList() {
       CComPtr<ID3D12GraphicsCommandList6> pList6;
       CHECK_HR(m_CommandList.List.p->QueryInterface(&pList6));
       pList6->BeginQuery(m_pQueryHeap, D3D12_QUERY_TYPE_PIPELINE_STATISTICS, 0);
-      pList6->DispatchMesh(1, 1, 1);
+      RecordTimedRuns(pList, [&]() { pList6->DispatchMesh(1, 1, 1); });
       pList6->EndQuery(m_pQueryHeap, D3D12_QUERY_TYPE_PIPELINE_STATISTICS, 0);
       pList6->ResolveQueryData(m_pQueryHeap, D3D12_QUERY_TYPE_PIPELINE_STATISTICS,
                               0, 1, m_pQueryBuffer, 0);
@@ -944,7 +1007,9 @@ void ShaderOpTest::RunCommandList() {
       UINT vertexCountPerInstance = vertexCount / instanceCount;
 
       pList->BeginQuery(m_pQueryHeap, D3D12_QUERY_TYPE_PIPELINE_STATISTICS, 0);
-      pList->DrawInstanced(vertexCountPerInstance, instanceCount, 0, 0);
+      RecordTimedRuns(pList, [&]() {
+        pList->DrawInstanced(vertexCountPerInstance, instanceCount, 0, 0);
+      });
       pList->EndQuery(m_pQueryHeap, D3D12_QUERY_TYPE_PIPELINE_STATISTICS, 0);
       pList->ResolveQueryData(m_pQueryHeap, D3D12_QUERY_TYPE_PIPELINE_STATISTICS,
                               0, 1, m_pQueryBuffer, 0);
@@ -1146,6 +1211,7 @@ private:
   void ParseRootValues(IXmlReader *pReader, std::vector<ShaderOpRootValue> *pRootValues);
   void ParseResource(IXmlReader *pReader, ShaderOpResource *pResource);
   void ParseShader(IXmlReader *pReader, ShaderOpShader *pShader);
+  void ParseTiming(IXmlReader *pReader, ShaderOpTiming *pTiming);
 
 public:
   void ParseShaderOpSet(IStream *pStream, ShaderOpSet *pShaderOpSet);
@@ -1966,6 +2032,13 @@ void ShaderOpParser::ParseViewport(IXmlReader* pReader, D3D12_VIEWPORT *pViewpor
   }
 }
 
+void ShaderOpParser::ParseTiming(IXmlReader *pReader, ShaderOpTiming *pTiming) {
+  if (!ReadAtElementName(pReader, L"Timing"))
+    return;
+  CHECK_HR(ReadAttrUINT(pReader, L"Warmup", &pTiming->Warmup, 0));
+  CHECK_HR(ReadAttrUINT(pReader, L"Repeat", &pTiming->Repeat, 1));
+}
+
 void ShaderOpParser::ParseRootValue(IXmlReader *pReader, ShaderOpRootValue *pRootValue) {
   if (!ReadAtElementName(pReader, L"RootValue"))
     return;
@@ -2086,6 +2159,9 @@ void ShaderOpParser::ParseShaderOp(IXmlReader *pReader, ShaderOp *pShaderOp) {
       else if (0 == wcscmp(pLocalName, L"RootValues")) {
         ParseRootValues(pReader, &pShaderOp->RootValues);
       }
+      else if (0 == wcscmp(pLocalName, L"Timing")) {
+        ParseTiming(pReader, &pShaderOp->Timing);
+      }
     }
     else if (nt == XmlNodeType_EndElement) {
       UINT depth;
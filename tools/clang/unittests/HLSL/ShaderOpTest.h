@@ -177,6 +177,16 @@ public:
   D3D12_VIEWPORT     Viewport;    // Viewport to use; if Width == 0 use the full render target
 };
 
+// Use this class to time the Draw/Dispatch call with GPU timestamps. The call
+// is recorded Warmup + Repeat times in the same command list, with a UAV
+// barrier between runs; shaders should produce the same results when run
+// again on their own output.
+class ShaderOpTiming {
+public:
+  UINT Warmup = 0; // Untimed runs before the timed ones.
+  UINT Repeat = 0; // Timed runs; timing is off when zero.
+};
+
 // Use this class to hold all information needed for a Draw/Dispatch call.
 class ShaderOp {
 public:
@@ -187,6 +197,7 @@ public:
   std::vector<ShaderOpShader> Shaders;
   std::vector<ShaderOpRootValue> RootValues;
   std::vector<ShaderOpRenderTarget> RenderTargets;
+  ShaderOpTiming Timing;
   LPCSTR Name = nullptr;
   LPCSTR RootSignature = nullptr;
   bool UseWarpDevice = true;
@@ -251,6 +262,7 @@ class ShaderOpTest {
 public:
   typedef std::function<void(LPCSTR Name, std::vector<BYTE> &Data, ShaderOp *pShaderOp)> TInitCallbackFn;
   void GetPipelineStats(D3D12_QUERY_DATA_PIPELINE_STATISTICS *pStats);
+  void GetGpuTimes(std::vector<double> *pTimesMs);
   void GetReadBackData(LPCSTR pResourceName, MappedData *pData);
   void RunShaderOp(ShaderOp *pShaderOp);
   void RunShaderOp(std::shared_ptr<ShaderOp> pShaderOp);
@@ -282,6 +294,8 @@ private:
   CComPtr<ID3D12RootSignature> m_pRootSignature;
   CComPtr<ID3D12QueryHeap> m_pQueryHeap;
   CComPtr<ID3D12Resource> m_pQueryBuffer;
+  CComPtr<ID3D12QueryHeap> m_pTimestampHeap;
+  CComPtr<ID3D12Resource> m_pTimestampBuffer;
   dxc::DxcDllSupport *m_pDxcSupport = nullptr;
   CommandListRefs m_CommandList;
   HANDLE m_hFence;
@@ -302,6 +316,8 @@ private:
   void CreateResources();
   void CreateRootSignature();
   void CreateShaders();
+  void RecordTimedRuns(ID3D12GraphicsCommandList *pList,
+                       const std::function<void()> &recordRun);
   void RunCommandList();
   void SetRootValues(ID3D12GraphicsCommandList *pList, bool isCompute);
 };
@@ -243,6 +243,7 @@ public:
   TEST_METHOD(WhenPSVMismatchThenFail)
   TEST_METHOD(WhenRDATMismatchThenFail)
   TEST_METHOD(WhenFeatureInfoMismatchThenFail)
+  TEST_METHOD(WhenCachedAndPartMismatchThenFail)
   TEST_METHOD(RayShaderWithSignaturesFail)
 
   TEST_METHOD(ViewIDInCSFail)
@@ -296,6 +297,8 @@ public:
 
   TEST_METHOD(ValidateRootSigContainer)
   TEST_METHOD(ValidatePrintfNotAllowed)
+  TEST_METHOD(ValidateBatchWhenMixedThenResultsInOrder)
+  TEST_METHOD(ValidateBatchWhenInPlaceEditThenEachShaderValidated)
 
   TEST_METHOD(ValidateVersionNotAllowed)
   TEST_METHOD(CreateHandleNotAllowedSM66)
@@ -542,7 +545,8 @@ public:
   // compile one or two sources, validate module from 1 with container parts from 2, check messages
   bool ReplaceContainerPartsCheckMsgs(LPCSTR pSource1, LPCSTR pSource2, LPCSTR pShaderModel,
                                      llvm::ArrayRef<DxilFourCC> PartsToReplace,
-                                     llvm::ArrayRef<LPCSTR> pErrorMsgs) {
+                                     llvm::ArrayRef<LPCSTR> pErrorMsgs,
+                                     UINT32 Flags = DxcValidatorFlags_Default) {
     CComPtr<IDxcBlob> pProgram1, pProgram2;
     if (!CompileSource(pSource1, pShaderModel, &pProgram1))
       return false;
@@ -601,7 +605,7 @@ public:
     pOutputStream->Reserve(pContainerWriter->size());
     pContainerWriter->write(pOutputStream);
 
-    CheckValidationMsgs((const char *)pOutputStream->GetPtr(), pOutputStream->GetPtrSize(), pErrorMsgs, /*bRegex*/false);
+    CheckValidationMsgs((const char *)pOutputStream->GetPtr(), pOutputStream->GetPtrSize(), pErrorMsgs, /*bRegex*/false, Flags);
     return true;
   }
 };
@@ -3064,6 +3068,30 @@ TEST_F(ValidationTest, WhenFeatureInfoMismatchThenFail) {
   );
 }
 
+TEST_F(ValidationTest, WhenCachedAndPartMismatchThenFail) {
+  // Older DXIL.dll validators do not know the flag.
+  if (!m_ver.m_InternalValidator)
+    return;
+  LPCSTR pSource =
+    "float4 main(uint2 foo : FOO) : SV_Target { return asdouble(foo.x, foo.y) * 2.0; }";
+  CComPtr<IDxcBlob> pProgram;
+  CompileSource(pSource, "ps_6_0", &pProgram);
+  CheckValidationMsgs(pProgram, nullptr, false, DxcValidatorFlags_AllowCachedResult);
+  CheckValidationMsgs(pProgram, nullptr, false, DxcValidatorFlags_AllowCachedResult);
+  // The DXIL part was validated above, but the feature info no longer matches.
+  ReplaceContainerPartsCheckMsgs(
+    pSource,
+    "float4 main() : SV_Target { return 0; }",
+    "ps_6_0",
+    {DFCC_FeatureInfo},
+    {
+      "Container part 'Feature Info' does not match expected for module.",
+      "Validation failed."
+    },
+    DxcValidatorFlags_AllowCachedResult
+  );
+}
+
 TEST_F(ValidationTest, RayShaderWithSignaturesFail) {
   if (m_ver.SkipDxilVersion(1, 3)) return;
   RewriteAssemblyCheckMsg(
@@ -3856,6 +3884,95 @@ TEST_F(ValidationTest, ValidateRootSigContainer) {
     DxcValidatorFlags_RootSignatureOnly | DxcValidatorFlags_InPlaceEdit);
 }
 
+// Returns false if the validator has no batch entry point, as with an
+// external DXIL.dll.
+static bool CreateBatchValidator(dxc::DxcDllSupport &dllSupport,
+                                 IDxcValidator3 **ppValidator) {
+  CComPtr<IDxcValidator> pValidator;
+  VERIFY_SUCCEEDED(dllSupport.CreateInstance(CLSID_DxcValidator, &pValidator));
+  if (FAILED(pValidator.QueryInterface(ppValidator))) {
+    WEX::Logging::Log::Comment(L"Test skipped due to validator without IDxcValidator3.");
+    return false;
+  }
+  return true;
+}
+
+TEST_F(ValidationTest, ValidateBatchWhenMixedThenResultsInOrder) {
+  CComPtr<IDxcValidator3> pValidator;
+  if (!CreateBatchValidator(m_dllSupport, &pValidator))
+    return;
+
+  CComPtr<IDxcBlob> pPass;
+  if (!CompileSource("float4 main() : SV_Target { return 1; }", "ps_6_0", &pPass))
+    return;
+  CComPtr<IDxcBlobEncoding> pFailSource;
+  Utf8ToBlob(m_dllSupport, "[numthreads(8,8,1)] void main() {}", &pFailSource);
+  CComPtr<IDxcBlob> pFailText, pFail;
+  if (!RewriteAssemblyToText(pFailSource, "cs_6_0", nullptr, 0, nullptr, 0,
+                             {"!{i32 8, i32 8, i32 1"},
+                             {"!{i32 1025, i32 1, i32 1"}, &pFailText))
+    return;
+  AssembleToContainer(m_dllSupport, pFailText, &pFail);
+
+  // Enough shaders that several workers run; every third one fails.
+  const UINT32 shaderCount = 12;
+  std::vector<IDxcBlob *> shaders;
+  for (UINT32 i = 0; i < shaderCount; ++i)
+    shaders.push_back(i % 3 == 1 ? pFail.p : pPass.p);
+  std::vector<IDxcOperationResult *> pResults(shaderCount);
+  VERIFY_SUCCEEDED(pValidator->ValidateBatch(shaders.data(), shaderCount,
+                                             DxcValidatorFlags_Default,
+                                             pResults.data()));
+  for (UINT32 i = 0; i < shaderCount; ++i) {
+    CComPtr<IDxcOperationResult> pResult;
+    pResult.Attach(pResults[i]);
+    VERIFY_IS_NOT_NULL(pResult.p);
+    if (i % 3 == 1)
+      CheckOperationResultMsgs(pResult, {"Declared Thread Group X size 1025 outside valid range"}, false, false);
+    else
+      CheckOperationResultMsgs(pResult, {}, false, false);
+  }
+
+  // Module-only validation cannot edit a container in place.
+  VERIFY_ARE_EQUAL(E_INVALIDARG,
+                   pValidator->ValidateBatch(shaders.data(), shaderCount,
+                                             DxcValidatorFlags_ModuleOnly |
+                                                 DxcValidatorFlags_InPlaceEdit,
+                                             pResults.data()));
+}
+
+TEST_F(ValidationTest, ValidateBatchWhenInPlaceEditThenEachShaderValidated) {
+  CComPtr<IDxcValidator3> pValidator;
+  if (!CreateBatchValidator(m_dllSupport, &pValidator))
+    return;
+
+  // In-place edits need a distinct blob per shader.
+  const UINT32 shaderCount = 4;
+  std::vector<CComPtr<IDxcBlob>> programs(shaderCount);
+  std::vector<IDxcBlob *> shaders;
+  for (UINT32 i = 0; i < shaderCount; ++i) {
+    std::string source = "float4 main() : SV_Target { return " +
+                         std::to_string(i) + "; }";
+    if (!CompileSource(source.c_str(), "ps_6_0", &programs[i]))
+      return;
+    shaders.push_back(programs[i]);
+  }
+  std::vector<IDxcOperationResult *> pResults(shaderCount);
+  VERIFY_SUCCEEDED(pValidator->ValidateBatch(shaders.data(), shaderCount,
+                                             DxcValidatorFlags_InPlaceEdit,
+                                             pResults.data()));
+  for (UINT32 i = 0; i < shaderCount; ++i) {
+    CComPtr<IDxcOperationResult> pResult;
+    pResult.Attach(pResults[i]);
+    CheckOperationResultMsgs(pResult, {}, false, false);
+    // Each shader is still a valid container after the in-place edit.
+    VERIFY_IS_TRUE(IsValidDxilContainer(
+        IsDxilContainerLike(programs[i]->GetBufferPointer(),
+                            programs[i]->GetBufferSize()),
+        programs[i]->GetBufferSize()));
+  }
+}
+
 TEST_F(ValidationTest, ValidatePrintfNotAllowed) {
   TestCheck(L"..\\CodeGenHLSL\\printf.hlsl");
 }
@@ -8,6 +8,7 @@
 //===----------------------------------------------------------------------===//
 
 #include "FileTestFixture.h"
+#include "FileTestUtils.h"
 #include "WholeFileTestFixture.h"
 
 namespace {
@@ -3051,4 +3052,44 @@ TEST_F(FileTest, DefineSpirvMacro) {
   runFileTest("ifdef.spirv.hlsl", Expect::Failure);
 }
 
+// === Dual-target compile tests ===
+
+TEST(DualTargetTest, CompileWhenFspvThenDxilAndSpirvReturned) {
+  dxc::DxcDllSupport dllSupport;
+  ASSERT_TRUE(SUCCEEDED(dllSupport.Initialize()));
+  CComPtr<IDxcCompiler3> pCompiler;
+  ASSERT_TRUE(
+      SUCCEEDED(dllSupport.CreateInstance(CLSID_DxcCompiler, &pCompiler)));
+
+  // Each target is preprocessed with its own predefined macros.
+  const char *source = "float4 main() : SV_Target {\n"
+                       "#ifdef __spirv__\n"
+                       "  return 1;\n"
+                       "#else\n"
+                       "  return 0;\n"
+                       "#endif\n"
+                       "}\n";
+  DxcBuffer sourceBuf = {source, strlen(source), CP_UTF8};
+  LPCWSTR args[] = {L"-E", L"main", L"-T", L"ps_6_0", L"-Fspv", L"out.spv"};
+  CComPtr<IDxcResult> pResult;
+  ASSERT_TRUE(SUCCEEDED(pCompiler->Compile(&sourceBuf, args, _countof(args),
+                                           nullptr, IID_PPV_ARGS(&pResult))));
+  HRESULT status;
+  ASSERT_TRUE(SUCCEEDED(pResult->GetStatus(&status)));
+  ASSERT_TRUE(SUCCEEDED(status));
+
+  CComPtr<IDxcBlob> pDxil;
+  ASSERT_TRUE(SUCCEEDED(pResult->GetResult(&pDxil)));
+  ASSERT_GE(pDxil->GetBufferSize(), 4u);
+  EXPECT_EQ(0, memcmp(pDxil->GetBufferPointer(), "DXBC", 4));
+
+  CComPtr<IDxcBlob> pSpirv;
+  CComPtr<IDxcBlobWide> pName;
+  ASSERT_TRUE(SUCCEEDED(
+      pResult->GetOutput(DXC_OUT_SPIRV, IID_PPV_ARGS(&pSpirv), &pName)));
+  ASSERT_GE(pSpirv->GetBufferSize(), 4u);
+  EXPECT_EQ(0x07230203u, *(const uint32_t *)pSpirv->GetBufferPointer());
+  EXPECT_EQ(std::wstring(L"out.spv"), std::wstring(pName->GetStringPointer()));
+}
+
 } // namespace
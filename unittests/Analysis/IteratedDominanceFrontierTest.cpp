@@ -0,0 +1,106 @@
+//===- IteratedDominanceFrontierTest.cpp - IDF tests ----------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Analysis/IteratedDominanceFrontier.h"
+#include "llvm/IR/BasicBlock.h"
+#include "llvm/IR/Dominators.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "gtest/gtest.h"
+#include <algorithm>
+#include <memory>
+
+using namespace llvm;
+
+namespace {
+
+// Builds @test with NumBlocks blocks, each branching to two blocks chosen by
+// a fixed pseudo-random sequence, so the CFG has loops and irreducible parts.
+// Some blocks are also left unreachable.
+static std::unique_ptr<Module> makeRandomCFG(LLVMContext &Context,
+                                             unsigned NumBlocks,
+                                             unsigned Seed) {
+  std::unique_ptr<Module> M(new Module("test", Context));
+  FunctionType *FTy = FunctionType::get(Type::getVoidTy(Context),
+                                        { Type::getInt1Ty(Context) }, false);
+  Function *F = Function::Create(FTy, Function::ExternalLinkage, "test",
+                                 M.get());
+  std::vector<BasicBlock *> Blocks;
+  for (unsigned i = 0; i < NumBlocks; ++i)
+    Blocks.push_back(BasicBlock::Create(Context, "", F));
+
+  IRBuilder<> Builder(Context);
+  Value *Cond = &*F->arg_begin();
+  for (unsigned i = 0; i < NumBlocks; ++i) {
+    Builder.SetInsertPoint(Blocks[i]);
+    Seed = Seed * 1103515245 + 12345;
+    if ((Seed >> 16) % 8 == 0) {
+      Builder.CreateRetVoid();
+      continue;
+    }
+    // The entry block can't be a branch target.
+    Seed = Seed * 1103515245 + 12345;
+    BasicBlock *T = Blocks[1 + (Seed >> 16) % (NumBlocks - 1)];
+    Seed = Seed * 1103515245 + 12345;
+    BasicBlock *E = Blocks[1 + (Seed >> 16) % (NumBlocks - 1)];
+    Builder.CreateCondBr(Cond, T, E);
+  }
+  return M;
+}
+
+static std::vector<BasicBlock *> calculateSorted(IDFCalculator &IDF) {
+  SmallVector<BasicBlock *, 32> PHIBlocks;
+  IDF.calculate(PHIBlocks);
+  std::vector<BasicBlock *> Result(PHIBlocks.begin(), PHIBlocks.end());
+  std::sort(Result.begin(), Result.end());
+  return Result;
+}
+
+// Computing the dominance frontiers once must not change any result.
+TEST(IteratedDominanceFrontierTest, FrontiersMatchLinearTime) {
+  LLVMContext Context;
+  for (unsigned Seed = 1; Seed <= 20; ++Seed) {
+    std::unique_ptr<Module> M = makeRandomCFG(Context, 40, Seed);
+    Function *F = M->getFunction("test");
+    DominatorTree DT;
+    DT.recalculate(*F);
+    std::vector<BasicBlock *> Blocks;
+    for (BasicBlock &BB : *F)
+      Blocks.push_back(&BB);
+
+    IDFCalculator Linear(DT), Frontiers(DT);
+    Frontiers.computeFrontiers();
+
+    unsigned Mask = Seed;
+    for (unsigned i = 0; i < Blocks.size(); ++i) {
+      SmallPtrSet<BasicBlock *, 32> DefBlocks, LiveInBlocks;
+      DefBlocks.insert(Blocks[i]);
+      DefBlocks.insert(Blocks[(i * 7 + Seed) % Blocks.size()]);
+      for (BasicBlock *BB : Blocks) {
+        Mask = Mask * 1103515245 + 12345;
+        if ((Mask >> 16) % 4 != 0)
+          LiveInBlocks.insert(BB);
+      }
+
+      Linear.setDefiningBlocks(DefBlocks);
+      Frontiers.setDefiningBlocks(DefBlocks);
+      Linear.resetLiveInBlocks();
+      Frontiers.resetLiveInBlocks();
+      EXPECT_EQ(calculateSorted(Linear), calculateSorted(Frontiers));
+
+      Linear.setLiveInBlocks(LiveInBlocks);
+      Frontiers.setLiveInBlocks(LiveInBlocks);
+      EXPECT_EQ(calculateSorted(Linear), calculateSorted(Frontiers));
+    }
+  }
+}
+
+} // end anonymous namespace
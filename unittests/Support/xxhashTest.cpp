@@ -0,0 +1,36 @@
+//===- llvm/unittest/Support/xxhashTest.cpp - XXH64 tests -----------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements unit tests for the XXH64 hash.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/xxhash.h"
+#include "gtest/gtest.h"
+
+using namespace llvm;
+
+namespace {
+uint64_t HashString(StringRef Str, uint64_t Seed = 0) {
+  return xxHash64(ArrayRef<uint8_t>((const uint8_t *)Str.data(), Str.size()),
+                  Seed);
+}
+
+TEST(xxhashTest, Basic) {
+  EXPECT_EQ(0xef46db3751d8e999ULL, HashString(""));
+  EXPECT_EQ(0xd24ec4f1a98c6e5bULL, HashString("a"));
+  EXPECT_EQ(0x44bc2cf5ad770999ULL, HashString("abc"));
+  // Long enough for the striped loop and every tail case.
+  EXPECT_EQ(0xfbcea83c8a378bf1ULL,
+            HashString("Nobody inspects the spammish repetition"));
+  EXPECT_NE(HashString("abc"), HashString("abc", 1));
+}
+}
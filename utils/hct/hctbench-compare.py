@@ -0,0 +1,73 @@
+# Copyright (C) Microsoft Corporation. All rights reserved.
+# This file is distributed under the University of Illinois Open Source License. See LICENSE.TXT for details.
+"""hctbench-compare.py - Compare two dxc-bench reports and flag regressions.
+
+  python hctbench-compare.py baseline.json current.json [--threshold 5]
+
+A shader regresses when a measure grows by more than the threshold percent
+and, for times, by more than --min-ms. The exit code is 1 when anything
+regressed or failed to compile, so the script can gate a compiler drop.
+"""
+import argparse
+import json
+import sys
+
+def load_entries(path):
+    with open(path) as f:
+        report = json.load(f)
+    return report, dict((e['name'], e) for e in report['entries'])
+
+def measures(entry):
+    """Yields (measure, value, is_time) for an entry that compiled."""
+    yield ('wall_ms', entry['wall_ms']['median'], True)
+    for phase, ms in sorted(entry.get('phases_ms', {}).items()):
+        yield ('phase ' + phase, ms, True)
+    yield ('allocations', entry['allocations'], False)
+    yield ('allocated_bytes', entry['allocated_bytes'], False)
+
+def main():
+    parser = argparse.ArgumentParser(description="Compare dxc-bench reports.")
+    parser.add_argument('baseline')
+    parser.add_argument('current')
+    parser.add_argument('--threshold', type=float, default=5.0,
+                        help="percent increase that counts as a regression")
+    parser.add_argument('--min-ms', type=float, default=0.5,
+                        help="time increase below which nothing is flagged")
+    args = parser.parse_args()
+
+    base_report, base = load_entries(args.baseline)
+    cur_report, cur = load_entries(args.current)
+    regressions = []
+    for name, entry in sorted(cur.items()):
+        if entry['status'] != 'ok':
+            regressions.append('%s: failed to compile' % name)
+            continue
+        old = base.get(name)
+        if old is None or old['status'] != 'ok':
+            continue
+        old_measures = dict((m, v) for m, v, _ in measures(old))
+        for measure, value, is_time in measures(entry):
+            old_value = old_measures.get(measure)
+            if not old_value:
+                continue
+            change = (value - old_value) * 100.0 / old_value
+            if change <= args.threshold:
+                continue
+            if is_time and value - old_value <= args.min_ms:
+                continue
+            regressions.append('%s: %s %s -> %s (+%.1f%%)' %
+                               (name, measure, old_value, value, change))
+
+    old_rss = base_report.get('peak_rss_kb', 0)
+    new_rss = cur_report.get('peak_rss_kb', 0)
+    if old_rss and (new_rss - old_rss) * 100.0 / old_rss > args.threshold:
+        regressions.append('peak_rss_kb %d -> %d' % (old_rss, new_rss))
+
+    print('total_wall_ms %.1f -> %.1f' % (base_report.get('total_wall_ms', 0),
+                                          cur_report.get('total_wall_ms', 0)))
+    for line in regressions:
+        print('REGRESSION ' + line)
+    return 1 if regressions else 0
+
+if __name__ == '__main__':
+    sys.exit(main())
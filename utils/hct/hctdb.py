@@ -2132,24 +2132,32 @@ class db_dxil(object):
             {'n':'UAVSize','t':'int','c':1}])
         add_pass('hlsl-dxil-pix-shader-access-instrumentation', 'DxilShaderAccessTracking', 'HLSL DXIL shader access tracking for PIX', [
             {'n':'config','t':'int','c':1},
-            {'n':'checkForDynamicIndexing','t':'bool','c':1}])
+            {'n':'checkForDynamicIndexing','t':'bool','c':1},
+            {'n':'coalesceWaveAccesses','t':'bool','c':1}])
         add_pass('hlsl-dxil-debug-instrumentation', 'DxilDebugInstrumentation', 'HLSL DXIL debug instrumentation for PIX', [
             {'n':'UAVSize','t':'int','c':1},
             {'n':'parameter0','t':'int','c':1},
             {'n':'parameter1','t':'int','c':1},
-            {'n':'parameter2','t':'int','c':1}])
+            {'n':'parameter2','t':'int','c':1},
+            {'n':'firstInstrumentedBlock','t':'int','c':1},
+            {'n':'lastInstrumentedBlock','t':'int','c':1}])
         add_pass('dxil-annotate-with-virtual-regs', 'DxilAnnotateWithVirtualRegister', 'Annotates each instruction in the DXIL module with a virtual register number', [])
         add_pass('dxil-dbg-value-to-dbg-declare', 'DxilDbgValueToDbgDeclare', 'Converts llvm.dbg.value uses to llvm.dbg.declare.', [])
         add_pass('hlsl-dxil-reduce-msaa-to-single', 'DxilReduceMSAAToSingleSample', 'HLSL DXIL Reduce all MSAA reads to single-sample reads', [])
         add_pass('hlsl-dxil-PIX-add-tid-to-as-payload', 'DxilPIXAddTidToAmplificationShaderPayload', 'HLSL DXIL Add flat thread id to payload from AS to MS', [
             {'n':'dispatchArgY','t':'int','c':1},
             {'n':'dispatchArgZ','t':'int','c':1}])
+        add_pass('hlsl-dxil-pix-block-counters', 'DxilPIXBlockCounters', 'DXIL basic block counters for PIX', [
+            {'n':'sampleRate','t':'int','c':1},
+            {'n':'UAVSize','t':'int','c':1}])
 
         category_lib="dxil_gen"
 
         add_pass('hlsl-hlemit', 'HLEmitMetadata', 'HLSL High-Level Metadata Emit.', [])
         add_pass("hl-expand-store-intrinsics", "HLExpandStoreIntrinsics", "Expand HLSL store intrinsics", [])
         add_pass("hl-legalize-parameter", "HLLegalizeParameter", "Legalize parameter", [])
+        add_pass("hl-inline-cleanup", "HLInlineCleanup", "HLSL cleanup before inlining", [])
+        add_pass("hl-pad-groupshared", "HLPadGroupShared", "HLSL pad groupshared arrays", [])
         add_pass('scalarrepl-param-hlsl', 'SROA_Parameter_HLSL', 'Scalar Replacement of Aggregates HLSL (parameters)', [])
         add_pass('static-global-to-alloca', 'LowerStaticGlobalIntoAlloca', 'Lower static global into Alloca', [])
         add_pass('hlmatrixlower', 'HLMatrixLowerPass', 'HLSL High-Level Matrix Lower', [])
@@ -2167,7 +2175,21 @@ class db_dxil(object):
         add_pass('simplify-inst', 'SimplifyInst', 'Simplify Instructions', [])
         add_pass('hlsl-dxil-precise', 'DxilPrecisePropagatePass', 'DXIL precise attribute propagate', [])
         add_pass('dxil-legalize-sample-offset', 'DxilLegalizeSampleOffsetPass', 'DXIL legalize sample offset', [])
-        add_pass('dxil-gvn-hoist', 'DxilSimpleGVNHoist', 'DXIL simple gvn hoist', [])
+        add_pass('dxil-gvn-hoist', 'DxilSimpleGVNHoist', 'DXIL simple gvn hoist', [
+            {'n':'MaxPressure', 't':'unsigned', 'c':1, 'd':'Estimated number of live 32-bit values at which hoisting stops, or 0 for no limit.'},
+        ])
+        add_pass('dxil-coalesce-cbuffer-loads', 'DxilCoalesceCBufferLoads', 'DXIL coalesce cbuffer loads', [])
+        add_pass('dxil-combine-raw-buffer-accesses', 'DxilCombineRawBufferAccesses', 'DXIL combine raw buffer accesses', [])
+        add_pass('dxil-mesh-output-dse', 'DxilMeshOutputStoreElimination', 'DXIL mesh output store elimination', [])
+        add_pass('dxil-uniformity-opt', 'DxilUniformityOpt', 'DXIL uniformity optimizations', [])
+        add_pass('dxil-annotate-uniformity', 'DxilAnnotateUniformity', 'DXIL annotate uniformity', [])
+        add_pass('dxil-form-dot2add', 'DxilFormDot2AddHalf', 'DXIL form Dot2AddHalf', [])
+        add_pass('dxil-rematerialize', 'DxilRematerialize', 'DXIL rematerialize cheap values', [
+            {'n':'MaxPressure', 't':'unsigned', 'c':1, 'd':'Estimated number of live 32-bit values above which cheap values are recomputed at their uses, or 0 to disable.'},
+        ])
+        add_pass('dxil-cluster-fetches', 'DxilClusterFetches', 'DXIL cluster texture and buffer fetches', [])
+        add_pass('dxil-specialize-constant-args', 'DxilSpecializeConstantArgs', 'DXIL specialize constant arguments', [])
+        add_pass('dxil-specialize-cbuffer', 'DxilSpecializeCBuffer', 'DXIL specialize cbuffer fields', [])
         add_pass('hlsl-hlensure', 'HLEnsureMetadata', 'HLSL High-Level Metadata Ensure', [])
         add_pass('multi-dim-one-dim', 'MultiDimArrayToOneDimArray', 'Flatten multi-dim array into one-dim array', [])
         add_pass('resource-handle', 'ResourceToHandle', 'Lower resource into handle', [])
@@ -2177,6 +2199,7 @@ class db_dxil(object):
         add_pass('hlsl-dxil-lower-handle-for-lib', 'DxilLowerCreateHandleForLib', 'DXIL Lower createHandleForLib', [])
         add_pass('hlsl-dxil-cleanup-dynamic-resource-handle', 'DxilCleanupDynamicResourceHandle', 'DXIL Cleanup dynamic resource handle calls', [])
         add_pass('hlsl-dxil-allocate-resources-for-lib', 'DxilAllocateResourcesForLib', 'DXIL Allocate Resources For Library', [])
+        add_pass('hlsl-dxil-remove-unused-resources', 'DxilRemoveUnusedResources', 'DXIL Remove Unused Resources', [])
         add_pass('hlsl-dxil-convergent-mark', 'DxilConvergentMark', 'Mark convergent', [])
         add_pass('hlsl-dxil-convergent-clear', 'DxilConvergentClear', 'Clear convergent before dxil emit', [])
         add_pass('hlsl-dxil-eliminate-output-dynamic', 'DxilEliminateOutputDynamicIndexing', 'DXIL eliminate ouptut dynamic indexing', [])
@@ -2244,6 +2267,9 @@ class db_dxil(object):
         add_pass('dxil-loop-unroll', 'DxilLoopUnroll', 'DxilLoopUnroll', [
             {'n':'MaxIterationAttempt', 't':'unsigned', 'c':1, 'd':'Maximum number of iterations to attempt when iteratively unrolling.'},
             {'n':'OnlyWarnOnFail', 't':'bool', 'c':1, 'd':'Whether to just warn when unrolling fails.'},
+            {'n':'MaxFunctionInstructions', 't':'unsigned', 'c':1, 'd':'Maximum number of instructions to clone into a function, or 0 for no limit.'},
+            {'n':'MaxModuleInstructions', 't':'unsigned', 'c':1, 'd':'Maximum number of instructions to clone into the module, or 0 for no limit.'},
+            {'n':'TimeLimitMs', 't':'unsigned', 'c':1, 'd':'Maximum number of milliseconds to spend unrolling, or 0 for no limit.'},
         ])
         add_pass('dxil-erase-dead-region', 'DxilEraseDeadRegion', 'DxilEraseDeadRegion', [])
         add_pass('dxil-remove-dead-blocks', 'DxilRemoveDeadBlocks', 'DxilRemoveDeadBlocks', [])
@@ -712,11 +712,80 @@ def get_hlsl_intrinsic_stats():
     result += "static const int g_MaxIntrinsicParamCount = %d; // Count of parameters (without return) for longest intrinsic argument list - '%s'\n" % (max_param_count, max_param_count_name)
     return result
 
+# Namespaces whose tables get a name index for FindIntrinsicByNameAndArgCount.
+# Method tables are small enough that a scan is as fast as a hash.
+hlsl_intrinsic_name_index_namespaces = ["Intrinsics", "VkIntrinsics"]
+
+def hash_hlsl_intrinsic_name(name, seed):
+    # Must match HashIntrinsicName in SemaHLSL.cpp: FNV-1a with a seeded
+    # offset basis, followed by the murmur3 finalizer.
+    h = (2166136261 ^ seed) & 0xFFFFFFFF
+    for c in name.encode('ascii'):
+        h ^= c
+        h = (h * 16777619) & 0xFFFFFFFF
+    h ^= h >> 16
+    h = (h * 0x85EBCA6B) & 0xFFFFFFFF
+    h ^= h >> 13
+    h = (h * 0xC2B2AE35) & 0xFFFFFFFF
+    h ^= h >> 16
+    return h
+
+def get_hlsl_intrinsic_name_index(ns, names):
+    # Build a perfect hash (hash and displace) from each distinct name to the
+    # run of table entries with that name. Entries are sorted by name, so the
+    # first entry of a run is the first entry of the table with that name.
+    ranges = []
+    for idx, name in enumerate(names):
+        if ranges and ranges[-1][0] == name:
+            ranges[-1][2] += 1
+        else:
+            assert name not in [r[0] for r in ranges], "intrinsic names must be contiguous"
+            ranges.append([name, idx, 1])
+    def pow2_at_least(n):
+        p = 1
+        while p < n:
+            p *= 2
+        return p
+    seed_count = pow2_at_least(max(1, len(ranges) // 4))
+    slot_count = pow2_at_least(2 * len(ranges))
+    buckets = [[] for _ in range(seed_count)]
+    for r in ranges:
+        buckets[hash_hlsl_intrinsic_name(r[0], 0) & (seed_count - 1)].append(r)
+    seeds = [0] * seed_count
+    slots = [None] * slot_count
+    for b in sorted(range(seed_count), key=lambda b: (-len(buckets[b]), b)):
+        if not buckets[b]:
+            continue
+        for seed in range(1, 0x10000):
+            pos = [hash_hlsl_intrinsic_name(r[0], seed) & (slot_count - 1) for r in buckets[b]]
+            if len(set(pos)) == len(pos) and all(slots[p] is None for p in pos):
+                break
+        else:
+            assert False, "no perfect hash seed found for g_%s" % ns
+        seeds[b] = seed
+        for p, r in zip(pos, buckets[b]):
+            slots[p] = r
+    result = "static const WORD g_%s_NameSeeds[] =\n{\n" % ns
+    for i in range(0, seed_count, 16):
+        result += "    " + " ".join("%d," % v for v in seeds[i:i+16]) + "\n"
+    result += "};\n\n"
+    result += "static const HLSL_INTRINSIC_NAME_RANGE g_%s_NameSlots[] =\n{\n" % ns
+    for r in slots:
+        if r is None:
+            result += "    {0, 0},\n"
+        else:
+            result += "    {%d, %d}, // %s\n" % (r[1], r[2], r[0])
+    result += "};\n\n"
+    result += "static const HLSL_INTRINSIC_NAME_INDEX g_%s_NameIndex =\n" % ns
+    result += "{\n    g_%s_NameSeeds, %d, g_%s_NameSlots, %d\n};\n" % (ns, seed_count, ns, slot_count)
+    return result
+
 def get_hlsl_intrinsics():
     db = get_db_hlsl()
     result = ""
     last_ns = ""
     ns_table = ""
+    ns_names = []
     is_vk_table = False  # SPIRV Change
     id_prefix = ""
     arg_idx = 0
@@ -727,6 +796,8 @@ def get_hlsl_intrinsics():
             id_prefix = "IOP" if last_ns == "Intrinsics" or last_ns == "VkIntrinsics" else "MOP" # SPIRV Change
             if (len(ns_table)):
                 result += ns_table + "};\n"
+                if ns_names[0] in hlsl_intrinsic_name_index_namespaces:
+                    result += "\n" + get_hlsl_intrinsic_name_index(ns_names[0], ns_names[1:])
                 # SPIRV Change Starts
                 if is_vk_table:
                     result += "\n#endif // ENABLE_SPIRV_CODEGEN\n"
@@ -741,6 +812,7 @@ def get_hlsl_intrinsics():
                 result += "#ifdef ENABLE_SPIRV_CODEGEN\n\n"
             # SPIRV Change Ends
             arg_idx = 0
+            ns_names = [last_ns]
         ns_table += "    {(UINT)%s::%s_%s, %s, %s, %s, %d, %d, g_%s_Args%s},\n" % (opcode_namespace, id_prefix, i.name, str(i.readonly).lower(), str(i.readnone).lower(), str(i.wave).lower(), i.overload_param_index,len(i.params), last_ns, arg_idx)
         result += "static const HLSL_INTRINSIC_ARGUMENT g_%s_Args%s[] =\n{\n" % (last_ns, arg_idx)
         for p in i.params:
@@ -749,12 +821,16 @@ def get_hlsl_intrinsics():
                 # First parameter defines intrinsic name for parsing in HLSL.
                 # Prepend '$hidden$' for hidden intrinsic so it can't be used in HLSL.
                 name = "$hidden$" + name
+            if p is i.params[0]:
+                ns_names.append(name)
             result += "    {\"%s\", %s, %s, %s, %s, %s, %s, %s},\n" % (
                 name, p.param_qual, p.template_id, p.template_list,
                 p.component_id, p.component_list, p.rows, p.cols)
         result += "};\n\n"
         arg_idx += 1
     result += ns_table + "};\n"
+    if ns_names[0] in hlsl_intrinsic_name_index_namespaces:
+        result += "\n" + get_hlsl_intrinsic_name_index(ns_names[0], ns_names[1:])
     result += "\n#endif // ENABLE_SPIRV_CODEGEN\n" if is_vk_table else ""  # SPIRV Change
     return result
 
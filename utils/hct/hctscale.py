@@ -0,0 +1,252 @@
+# Copyright (C) Microsoft Corporation. All rights reserved.
+# This file is distributed under the University of Illinois Open Source License. See LICENSE.TXT for details.
+"""hctscale.py - Find compile steps that grow superlinearly with shader size.
+
+  python hctscale.py --dxc path/to/dxc [--out dir] [--shape name ...]
+
+Each shape below synthesizes a shader from a size parameter: many resources,
+deeply nested structs, long [unroll] loops, libraries with many functions,
+big switch statements and large cbuffers. The shader is compiled at doubling
+sizes with -ftime-trace, and the growth of the compile and of every phase and
+pass in the trace is fitted as time ~ size^k over the sizes.
+
+A step is reported as superlinear when k exceeds --max-exponent and it takes
+at least --min-ms at the largest size. The exit code is 1 in that case, or
+when a compile fails. Timings go to <out>/scale.csv, and to one plot per
+shape, <out>/<shape>.png, when matplotlib is available.
+"""
+import argparse
+import csv
+import json
+import math
+import os
+import subprocess
+import sys
+import time
+
+# Shape generators. Each takes the size and returns (source, profile, entry).
+
+def gen_resources(n):
+    lines = []
+    for i in range(n):
+        lines.append('Texture2D<float4> t%d : register(t%d);' % (i, i))
+    lines.append('SamplerState s : register(s0);')
+    lines.append('float4 main(float2 uv : TEXCOORD) : SV_Target {')
+    lines.append('  float4 r = 0;')
+    for i in range(n):
+        lines.append('  r += t%d.Sample(s, uv);' % i)
+    lines.append('  return r;')
+    lines.append('}')
+    return '\n'.join(lines), 'ps_6_0', 'main'
+
+def gen_struct_nesting(n):
+    lines = ['struct S0 { float4 v; float f; };']
+    for i in range(1, n + 1):
+        lines.append('struct S%d { S%d inner; float4 v; };' % (i, i - 1))
+    lines.append('cbuffer C { S%d g; };' % n)
+    lines.append('float4 main() : SV_Target {')
+    lines.append('  S%d s = g;' % n)
+    path = 's'
+    lines.append('  float4 r = %s.v;' % path)
+    for i in range(n, 0, -1):
+        path += '.inner'
+        lines.append('  r += %s.v;' % path)
+    lines.append('  return r;')
+    lines.append('}')
+    return '\n'.join(lines), 'ps_6_0', 'main'
+
+def gen_unroll(n):
+    source = '\n'.join([
+        'RWStructuredBuffer<float> b : register(u0);',
+        '[numthreads(64, 1, 1)]',
+        'void main(uint id : SV_DispatchThreadID) {',
+        '  float r = b[id];',
+        '  [unroll]',
+        '  for (uint i = 0; i < %d; ++i)' % n,
+        '    r = r * b[id + i] + i;',
+        '  b[id] = r;',
+        '}'])
+    return source, 'cs_6_0', 'main'
+
+def gen_lib_functions(n):
+    lines = ['RWByteAddressBuffer b : register(u0);']
+    lines.append('float f0(float x) { return x * 2 + b.Load(0); }')
+    for i in range(1, n):
+        lines.append('export float f%d(float x) { return f%d(x) + %d; }' %
+                     (i, i - 1, i))
+    return '\n'.join(lines), 'lib_6_3', ''
+
+def gen_switch(n):
+    lines = ['RWStructuredBuffer<uint> b : register(u0);',
+             '[numthreads(64, 1, 1)]',
+             'void main(uint id : SV_DispatchThreadID) {',
+             '  uint r;',
+             '  switch (b[id]) {']
+    for i in range(n):
+        lines.append('  case %d: r = b[id + %d] * %d; break;' % (i, i, i + 1))
+    lines.append('  default: r = 0; break;')
+    lines.append('  }')
+    lines.append('  b[id] = r;')
+    lines.append('}')
+    return '\n'.join(lines), 'cs_6_0', 'main'
+
+def gen_cbuffer(n):
+    lines = ['cbuffer C : register(b0) {']
+    for i in range(n):
+        lines.append('  float4 c%d;' % i)
+    lines.append('};')
+    lines.append('float4 main() : SV_Target {')
+    lines.append('  float4 r = 0;')
+    for i in range(n):
+        lines.append('  r += c%d;' % i)
+    lines.append('  return r;')
+    lines.append('}')
+    return '\n'.join(lines), 'ps_6_0', 'main'
+
+# name: (generator, sizes at --scale 1)
+SHAPES = {
+    'resources': (gen_resources, [16, 32, 64, 128, 256]),
+    'struct_nesting': (gen_struct_nesting, [8, 16, 32, 64]),
+    'unroll': (gen_unroll, [64, 128, 256, 512, 1024]),
+    'lib_functions': (gen_lib_functions, [64, 128, 256, 512, 1024]),
+    'switch': (gen_switch, [64, 128, 256, 512, 1024]),
+    'cbuffer': (gen_cbuffer, [128, 256, 512, 1024, 2048]),
+}
+
+def read_trace_totals(path):
+    """Returns {step: ms} from the "Total <step>" events of a time trace."""
+    with open(path) as f:
+        trace = json.load(f)
+    totals = {}
+    for event in trace.get('traceEvents', []):
+        name = event.get('name', '')
+        if event.get('ph') == 'X' and name.startswith('Total '):
+            totals[name[len('Total '):]] = event['dur'] / 1000.0
+    return totals
+
+def compile_shader(dxc, work_dir, name, source, profile, entry, extra_args):
+    """Compiles one shader and returns ({step: ms}, error text or None)."""
+    hlsl_path = os.path.join(work_dir, name + '.hlsl')
+    trace_path = os.path.join(work_dir, name + '.trace.json')
+    with open(hlsl_path, 'w') as f:
+        f.write(source)
+    args = [dxc, '-T', profile, '-ftime-trace=' + trace_path,
+            '-Fo', os.path.join(work_dir, name + '.bin')]
+    if entry:
+        args += ['-E', entry]
+    args += extra_args + [hlsl_path]
+    start = time.time()
+    proc = subprocess.Popen(args, stdout=subprocess.PIPE,
+                            stderr=subprocess.STDOUT)
+    output = proc.communicate()[0]
+    wall_ms = (time.time() - start) * 1000.0
+    if proc.returncode != 0:
+        return None, output.decode('utf-8', 'replace')
+    totals = read_trace_totals(trace_path)
+    totals['dxc process'] = wall_ms
+    return totals, None
+
+def fit_exponent(sizes, times):
+    """Least-squares slope of log(time) over log(size)."""
+    points = [(math.log(s), math.log(t)) for s, t in zip(sizes, times) if t > 0]
+    if len(points) < 2:
+        return 0.0
+    mean_x = sum(x for x, _ in points) / len(points)
+    mean_y = sum(y for _, y in points) / len(points)
+    var = sum((x - mean_x) ** 2 for x, _ in points)
+    if var == 0:
+        return 0.0
+    return sum((x - mean_x) * (y - mean_y) for x, y in points) / var
+
+def plot_shape(out_dir, shape, sizes, series, flagged):
+    try:
+        import matplotlib
+        matplotlib.use('Agg')
+        import matplotlib.pyplot as plt
+    except ImportError:
+        return
+    fig, ax = plt.subplots()
+    for step, times in sorted(series.items()):
+        if step not in flagged and step not in ('Compile', 'dxc process'):
+            continue
+        ax.plot(sizes, times, marker='o', label=step)
+    ax.set_xscale('log')
+    ax.set_yscale('log')
+    ax.set_xlabel(shape + ' size')
+    ax.set_ylabel('ms')
+    ax.set_title(shape)
+    ax.legend(fontsize='small')
+    fig.savefig(os.path.join(out_dir, shape + '.png'))
+    plt.close(fig)
+
+def main():
+    parser = argparse.ArgumentParser(description="Scale-test dxc on synthesized shaders.")
+    parser.add_argument('--dxc', required=True, help="dxc executable to test")
+    parser.add_argument('--out', default='scale', help="directory for shaders, traces and results")
+    parser.add_argument('--shape', action='append', choices=sorted(SHAPES.keys()),
+                        help="shape to test; all shapes when omitted")
+    parser.add_argument('--scale', type=int, default=1,
+                        help="multiply every size by this factor")
+    parser.add_argument('--spirv', action='store_true',
+                        help="also compile the non-library shapes to SPIR-V")
+    parser.add_argument('--max-exponent', type=float, default=1.5,
+                        help="growth exponent above which a step is superlinear")
+    parser.add_argument('--min-ms', type=float, default=50.0,
+                        help="time at the largest size below which nothing is flagged")
+    args = parser.parse_args()
+
+    if not os.path.isdir(args.out):
+        os.makedirs(args.out)
+    shapes = args.shape or sorted(SHAPES.keys())
+    variants = [('', [])]
+    if args.spirv:
+        variants.append(('_spirv', ['-spirv']))
+
+    rows = []
+    problems = []
+    for shape in shapes:
+        gen, base_sizes = SHAPES[shape]
+        sizes = [s * args.scale for s in base_sizes]
+        for suffix, extra_args in variants:
+            label = shape + suffix
+            _, profile, _ = gen(sizes[0])
+            if extra_args and profile.startswith('lib_'):
+                continue
+            series = {}
+            for size in sizes:
+                source, profile, entry = gen(size)
+                totals, error = compile_shader(args.dxc, args.out,
+                                               '%s_%d' % (label, size), source,
+                                               profile, entry, extra_args)
+                if totals is None:
+                    problems.append('%s at size %d failed to compile:\n%s' %
+                                    (label, size, error))
+                    break
+                print('%-20s %6d %10.1f ms' % (label, size, totals['dxc process']))
+                for step, ms in totals.items():
+                    series.setdefault(step, []).append(ms)
+                    rows.append((label, size, step, ms))
+            # Keep steps that ran at every size that compiled.
+            done = len(series.get('dxc process', []))
+            series = dict((s, t) for s, t in series.items() if len(t) == done)
+            flagged = set()
+            for step, times in sorted(series.items()):
+                k = fit_exponent(sizes[:done], times)
+                if k > args.max_exponent and times[-1] >= args.min_ms:
+                    flagged.add(step)
+                    problems.append('%s: %s grows as size^%.2f (%.1f ms at size %d)' %
+                                    (label, step, k, times[-1], sizes[done - 1]))
+            plot_shape(args.out, label, sizes[:done], series, flagged)
+
+    with open(os.path.join(args.out, 'scale.csv'), 'w') as f:
+        writer = csv.writer(f)
+        writer.writerow(['shape', 'size', 'step', 'ms'])
+        for row in rows:
+            writer.writerow(row)
+
+    for line in problems:
+        print('SCALE ' + line)
+    return 1 if problems else 0
+
+if __name__ == '__main__':
+    sys.exit(main())